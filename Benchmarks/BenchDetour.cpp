@@ -0,0 +1,273 @@
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Benchmarks.h"
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshLandmarks.h"
+#include "DetourNavMeshNeighbourhood.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourRandomPointIndex.h"
+
+namespace Bench
+{
+namespace
+{
+const int QUERY_COUNT = 1000;
+const int PATH_COUNT = 200;
+const int MAX_PATH = 256;
+const int GOAL_COUNT = 40;
+const int DISTANCE_SOURCES = 20;
+const int DISTANCE_TARGETS = 200;
+const int WALK_COUNT = 100;
+const int WALK_STEPS = 20;
+const float WALK_STEP = 0.05f;
+const float NEIGHBOURHOOD_RADIUS = 4.0f;
+const int MAX_NEIGHBOURHOOD = 64;
+
+Random s_random(0);
+
+float frand()
+{
+	return s_random.next();
+}
+
+void benchMesh(Runner& runner, const char* fileName)
+{
+	std::string base = fileName;
+	base.erase(base.rfind('.'));
+	const std::string names[] = {
+		"detour/addTile/", "detour/findNearestPoly/", "detour/findPath/", "detour/findPathAnyAngle/",
+		"detour/findPathLandmarks/", "detour/findPathToNearest/", "detour/findDistances/", "detour/findStraightPath/", "detour/raycast/", "detour/findRandomPoint/", "detour/randomPointIndex/",
+		"detour/findLocalNeighbourhood/", "detour/findLocalNeighbourhood/reused/"
+	};
+	bool any = false;
+	for (const std::string& name : names)
+		any |= runner.enabled(name + base);
+	if (!any)
+		return;
+
+	InputMesh mesh;
+	TiledNavMeshData data;
+	if (!loadMesh(runner.getOptions(), fileName, mesh) || !buildTiledNavMeshData(mesh, 48, data))
+		return;
+
+	// Adds all tiles to an empty nav mesh, which includes stitching them to their neighbours.
+	dtNavMesh* nav = 0;
+	std::vector<unsigned char*> copies;
+	runner.run("detour/addTile/" + mesh.name, (int)data.tiles.size(), [&] {
+		nav = createNavMesh(data, false);
+		copies.clear();
+		for (const TiledNavMeshData::Tile& tile : data.tiles)
+		{
+			unsigned char* copy = (unsigned char*)dtAlloc(tile.data.size(), DT_ALLOC_PERM);
+			memcpy(copy, &tile.data[0], tile.data.size());
+			copies.push_back(copy);
+		}
+	}, [&] {
+		for (size_t i = 0; i < copies.size(); ++i)
+			nav->addTile(copies[i], (int)data.tiles[i].data.size(), DT_TILE_FREE_DATA, 0, 0);
+	}, [&] {
+		dtFreeNavMesh(nav);
+		nav = 0;
+	});
+
+	nav = createNavMesh(data);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	if (!nav || !query || dtStatusFailed(query->init(nav, 2048)))
+	{
+		fprintf(stderr, "Could not create the nav mesh of '%s'.\n", mesh.name.c_str());
+		dtFreeNavMeshQuery(query);
+		dtFreeNavMesh(nav);
+		return;
+	}
+
+	// The same random points are used by every run.
+	dtQueryFilter filter;
+	s_random = Random(1234);
+	std::vector<dtPolyRef> refs(QUERY_COUNT * 2);
+	std::vector<float> points(QUERY_COUNT * 2 * 3);
+	for (int i = 0; i < QUERY_COUNT * 2; ++i)
+		query->findRandomPoint(&filter, frand, &refs[i], &points[i * 3]);
+
+	const float halfExtents[3] = { 2.0f, 4.0f, 2.0f };
+	std::vector<float> jittered(points);
+	for (int i = 0; i < QUERY_COUNT; ++i)
+	{
+		jittered[i * 3 + 0] += frand() * 2.0f - 1.0f;
+		jittered[i * 3 + 1] += frand() * 2.0f - 1.0f;
+		jittered[i * 3 + 2] += frand() * 2.0f - 1.0f;
+	}
+	runner.run("detour/findNearestPoly/" + mesh.name, QUERY_COUNT, [&] {
+		for (int i = 0; i < QUERY_COUNT; ++i)
+		{
+			dtPolyRef ref = 0;
+			float nearest[3];
+			query->findNearestPoly(&jittered[i * 3], halfExtents, &filter, &ref, nearest);
+		}
+	});
+
+	// Random points with the linear search of the query and with the index.
+	runner.run("detour/findRandomPoint/" + mesh.name, QUERY_COUNT, [&] {
+		for (int i = 0; i < QUERY_COUNT; ++i)
+		{
+			dtPolyRef ref = 0;
+			float pt[3];
+			query->findRandomPoint(&filter, frand, &ref, pt);
+		}
+	});
+	dtRandomPointIndex* randomIndex = dtAllocRandomPointIndex();
+	if (randomIndex && dtStatusSucceed(randomIndex->init(nav, &filter)) && dtStatusSucceed(randomIndex->update()))
+	{
+		runner.run("detour/randomPointIndex/" + mesh.name, QUERY_COUNT, [&] {
+			for (int i = 0; i < QUERY_COUNT; ++i)
+			{
+				dtPolyRef ref = 0;
+				float pt[3];
+				randomIndex->findRandomPoint(query, frand, &ref, pt);
+			}
+		});
+	}
+	dtFreeRandomPointIndex(randomIndex);
+
+	// Local searches around slowly walking centers, from scratch and with the polygons kept between the steps.
+	// Each walk starts at a random point and stays with its start polygon.
+	dtPolyRef neighbours[MAX_NEIGHBOURHOOD];
+	runner.run("detour/findLocalNeighbourhood/" + mesh.name, WALK_COUNT * WALK_STEPS, [&] {
+		for (int i = 0; i < WALK_COUNT; ++i)
+		{
+			float center[3];
+			dtVcopy(center, &points[i * 3]);
+			for (int j = 0; j < WALK_STEPS; ++j, center[0] += WALK_STEP)
+			{
+				int count = 0;
+				query->findLocalNeighbourhood(refs[i], center, NEIGHBOURHOOD_RADIUS, &filter, neighbours, 0, &count,
+											  MAX_NEIGHBOURHOOD);
+			}
+		}
+	});
+	std::vector<dtNavMeshNeighbourhood*> neighbourhoods(WALK_COUNT);
+	for (int i = 0; i < WALK_COUNT; ++i)
+	{
+		neighbourhoods[i] = dtAllocNavMeshNeighbourhood();
+		if (neighbourhoods[i])
+			neighbourhoods[i]->init(256, WALK_STEPS * WALK_STEP * 0.5f);
+	}
+	runner.run("detour/findLocalNeighbourhood/reused/" + mesh.name, WALK_COUNT * WALK_STEPS, [&] {
+		for (int i = 0; i < WALK_COUNT; ++i)
+		{
+			float center[3];
+			dtVcopy(center, &points[i * 3]);
+			for (int j = 0; j < WALK_STEPS; ++j, center[0] += WALK_STEP)
+			{
+				int count = 0;
+				query->findLocalNeighbourhood(refs[i], center, NEIGHBOURHOOD_RADIUS, &filter, neighbourhoods[i],
+											  neighbours, 0, &count, MAX_NEIGHBOURHOOD);
+			}
+		}
+	});
+	for (int i = 0; i < WALK_COUNT; ++i)
+		dtFreeNavMeshNeighbourhood(neighbourhoods[i]);
+
+	// Paths between pairs of random points.
+	std::vector<dtPolyRef> paths(PATH_COUNT * MAX_PATH);
+	std::vector<int> pathCounts(PATH_COUNT, 0);
+	runner.run("detour/findPath/" + mesh.name, PATH_COUNT, [&] {
+		for (int i = 0; i < PATH_COUNT; ++i)
+		{
+			const int a = i * 2, b = i * 2 + 1;
+			query->findPath(refs[a], refs[b], &points[a * 3], &points[b * 3], &filter,
+							&paths[i * MAX_PATH], &pathCounts[i], MAX_PATH);
+		}
+	});
+	runner.run("detour/findPathAnyAngle/" + mesh.name, PATH_COUNT, [&] {
+		for (int i = 0; i < PATH_COUNT; ++i)
+		{
+			const int a = i * 2, b = i * 2 + 1;
+			query->findPath(refs[a], refs[b], &points[a * 3], &points[b * 3], &filter,
+							&paths[i * MAX_PATH], &pathCounts[i], MAX_PATH, DT_FINDPATH_ANY_ANGLE);
+		}
+	});
+	dtNavMeshLandmarks* landmarks = dtAllocNavMeshLandmarks();
+	if (landmarks && dtStatusSucceed(landmarks->init(nav, 8)) && dtStatusSucceed(landmarks->update()))
+	{
+		query->setLandmarks(landmarks);
+		runner.run("detour/findPathLandmarks/" + mesh.name, PATH_COUNT, [&] {
+			for (int i = 0; i < PATH_COUNT; ++i)
+			{
+				const int a = i * 2, b = i * 2 + 1;
+				query->findPath(refs[a], refs[b], &points[a * 3], &points[b * 3], &filter,
+								&paths[i * MAX_PATH], &pathCounts[i], MAX_PATH);
+			}
+		});
+		query->setLandmarks(0);
+	}
+	dtFreeNavMeshLandmarks(landmarks);
+
+	// Paths to the nearest of a set of goals, in one search each.
+	runner.run("detour/findPathToNearest/" + mesh.name, PATH_COUNT, [&] {
+		for (int i = 0; i < PATH_COUNT; ++i)
+		{
+			const int a = i * 2;
+			const int goals = (i * GOAL_COUNT) % (QUERY_COUNT * 2 - GOAL_COUNT);
+			query->findPathToNearest(refs[a], &points[a * 3], &refs[goals], &points[goals * 3], GOAL_COUNT,
+									 &filter, &paths[i * MAX_PATH], &pathCounts[i], MAX_PATH);
+		}
+	});
+
+	// Costs from a few sources to many targets, a row of a distance matrix per search.
+	std::vector<float> distances(DISTANCE_TARGETS);
+	runner.run("detour/findDistances/" + mesh.name, DISTANCE_SOURCES, [&] {
+		for (int i = 0; i < DISTANCE_SOURCES; ++i)
+		{
+			query->findDistances(refs[i], &points[i * 3], &refs[QUERY_COUNT], &points[QUERY_COUNT * 3],
+								 DISTANCE_TARGETS, &filter, FLT_MAX, &distances[0]);
+		}
+	});
+	for (int i = 0; i < PATH_COUNT; ++i)
+	{
+		const int a = i * 2, b = i * 2 + 1;
+		query->findPath(refs[a], refs[b], &points[a * 3], &points[b * 3], &filter,
+						&paths[i * MAX_PATH], &pathCounts[i], MAX_PATH);
+	}
+
+	runner.run("detour/findStraightPath/" + mesh.name, PATH_COUNT, [&] {
+		float straight[MAX_PATH * 3];
+		int straightCount = 0;
+		for (int i = 0; i < PATH_COUNT; ++i)
+		{
+			if (!pathCounts[i])
+				continue;
+			const int a = i * 2, b = i * 2 + 1;
+			query->findStraightPath(&points[a * 3], &points[b * 3], &paths[i * MAX_PATH], pathCounts[i],
+									straight, 0, 0, &straightCount, MAX_PATH, DT_STRAIGHTPATH_AREA_CROSSINGS);
+		}
+	});
+
+	// Rays between consecutive random points, most of them hit a wall.
+	runner.run("detour/raycast/" + mesh.name, QUERY_COUNT, [&] {
+		dtPolyRef visited[MAX_PATH];
+		for (int i = 0; i < QUERY_COUNT; ++i)
+		{
+			const int a = i, b = (i + 1) % QUERY_COUNT;
+			float t = 0.0f;
+			float normal[3];
+			int visitedCount = 0;
+			query->raycast(refs[a], &points[a * 3], &points[b * 3], &filter, &t, normal, visited,
+						   &visitedCount, MAX_PATH);
+		}
+	});
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+} // anonymous namespace
+
+void benchDetour(Runner& runner)
+{
+	benchMesh(runner, "nav_test.obj");
+	benchMesh(runner, "dungeon.obj");
+}
+} // namespace Bench
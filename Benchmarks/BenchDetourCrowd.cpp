@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <string.h>
+#include <memory>
+
+#include "Benchmarks.h"
+#include "CrowdScenario.h"
+#include "DetourCrowd.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+
+namespace Bench
+{
+namespace
+{
+const int FRAME_COUNT = 10;
+const float FRAME_TIME = 0.1f;
+const int IDLE_MOVING_EVERY = 10;
+const float CLUSTER_SIZE = 4.0f;
+const int SCENARIO_TICKS = 60;
+const int SCENARIO_THREADS = 4;
+
+Random s_random(0);
+
+float frand()
+{
+	return s_random.next();
+}
+
+// Sends every movingEvery-th agent to a new random point on the nav mesh.
+void retarget(dtCrowd* crowd, const int movingEvery)
+{
+	const dtNavMeshQuery* query = crowd->getNavMeshQuery();
+	for (int i = 0; i < crowd->getAgentCount(); i += movingEvery)
+	{
+		if (!crowd->getAgent(i)->active)
+			continue;
+		dtPolyRef ref = 0;
+		float pos[3];
+		if (dtStatusSucceed(query->findRandomPoint(crowd->getFilter(0), frand, &ref, pos)))
+			crowd->requestMoveTarget(i, ref, pos);
+	}
+}
+
+// With idle set, only one agent in IDLE_MOVING_EVERY moves and the rest are left to sleep.
+// With clustered set, the agents share their neighbour and boundary queries by cluster.
+void benchCrowd(Runner& runner, dtNavMesh* nav, const std::string& meshName, const int agentCount, const bool idle,
+				const bool clustered)
+{
+	const std::string name = "crowd/update/" + meshName + "/" + std::to_string(agentCount) + (idle ? "/idle" : "") +
+		(clustered ? "/clustered" : "");
+	if (!runner.enabled(name))
+		return;
+
+	dtCrowd* crowd = dtAllocCrowd();
+	if (!crowd || !crowd->init(agentCount, 0.6f, nav))
+	{
+		fprintf(stderr, "Could not create a crowd of %d agents.\n", agentCount);
+		dtFreeCrowd(crowd);
+		return;
+	}
+	if (clustered)
+		crowd->setClusterSize(CLUSTER_SIZE);
+
+	dtCrowdAgentParams params;
+	memset(&params, 0, sizeof(params));
+	params.radius = 0.6f;
+	params.height = 2.0f;
+	params.maxAcceleration = 8.0f;
+	params.maxSpeed = 3.5f;
+	params.collisionQueryRange = params.radius * 12.0f;
+	params.pathOptimizationRange = params.radius * 30.0f;
+	params.separationWeight = 2.0f;
+	params.updateFlags = DT_CROWD_ANTICIPATE_TURNS | DT_CROWD_OPTIMIZE_VIS | DT_CROWD_OPTIMIZE_TOPO |
+		DT_CROWD_OBSTACLE_AVOIDANCE | DT_CROWD_SEPARATION;
+	if (idle)
+		params.updateFlags |= DT_CROWD_SLEEP;
+	params.obstacleAvoidanceType = 3;
+
+	s_random = Random(4321);
+	const dtNavMeshQuery* query = crowd->getNavMeshQuery();
+	for (int i = 0; i < agentCount; ++i)
+	{
+		dtPolyRef ref = 0;
+		float pos[3];
+		if (dtStatusSucceed(query->findRandomPoint(crowd->getFilter(0), frand, &ref, pos)))
+			crowd->addAgent(pos, &params);
+	}
+
+	// Every repetition starts with new targets, so that path requests are part of the measured frames.
+	const int movingEvery = idle ? IDLE_MOVING_EVERY : 1;
+	runner.run(name, agentCount * FRAME_COUNT, [&] {
+		retarget(crowd, movingEvery);
+	}, [&] {
+		for (int i = 0; i < FRAME_COUNT; ++i)
+			crowd->update(FRAME_TIME, 0);
+	}, [] {});
+
+	dtFreeCrowd(crowd);
+}
+
+// Runs the first ticks of a scenario, from a new spawn for every repetition.
+void benchScenario(Runner& runner, dtNavMesh* nav, const std::string& meshName, const ScenarioType type,
+				   const int threads)
+{
+	const std::string name = std::string("crowd/scenario/") + getScenarioName(type) + "/" + meshName +
+		(threads > 1 ? "/threads" + std::to_string(threads) : "");
+	if (!runner.enabled(name))
+		return;
+
+	ScenarioSettings settings;
+	settings.type = type;
+	settings.threads = threads;
+	std::unique_ptr<CrowdScenario> scenario;
+	int agentCount = 0;
+	bool ok = true;
+	runner.run(name, SCENARIO_TICKS, [&] {
+		scenario.reset(new CrowdScenario());
+		ok = ok && scenario->init(nav, settings);
+		agentCount = scenario->getSettings().agentCount;
+	}, [&] {
+		for (int i = 0; ok && i < SCENARIO_TICKS; ++i)
+			scenario->tick(FRAME_TIME);
+	}, [&] {
+		scenario.reset();
+	});
+	if (!ok)
+		fprintf(stderr, "Could not run the %s scenario with %d agents.\n", getScenarioName(type), agentCount);
+}
+} // anonymous namespace
+
+void benchDetourCrowd(Runner& runner)
+{
+	const int agentCounts[] = { 100, 1000, 5000 };
+	bool any = false;
+	for (const int count : agentCounts)
+	{
+		any |= runner.enabled("crowd/update/nav_test/" + std::to_string(count));
+		any |= runner.enabled("crowd/update/nav_test/" + std::to_string(count) + "/idle");
+		any |= runner.enabled("crowd/update/nav_test/" + std::to_string(count) + "/clustered");
+	}
+	any |= runner.enabled("crowd/scenario/crossing/nav_test");
+	any |= runner.enabled("crowd/scenario/bottleneck/nav_test");
+	if (!any)
+		return;
+
+	InputMesh mesh;
+	TiledNavMeshData data;
+	if (!loadMesh(runner.getOptions(), "nav_test.obj", mesh) || !buildTiledNavMeshData(mesh, 48, data))
+		return;
+	dtNavMesh* nav = createNavMesh(data);
+	if (!nav)
+	{
+		fprintf(stderr, "Could not create the nav mesh of '%s'.\n", mesh.name.c_str());
+		return;
+	}
+
+	for (const int count : agentCounts)
+	{
+		benchCrowd(runner, nav, mesh.name, count, false, false);
+		benchCrowd(runner, nav, mesh.name, count, true, false);
+		benchCrowd(runner, nav, mesh.name, count, false, true);
+	}
+
+	// The walkers are left to --scenario, ten thousand agents take too long for the default run.
+	const ScenarioType scenarios[] = { SCENARIO_CROSSING, SCENARIO_BOTTLENECK };
+	for (const ScenarioType type : scenarios)
+	{
+		benchScenario(runner, nav, mesh.name, type, 1);
+		benchScenario(runner, nav, mesh.name, type, SCENARIO_THREADS);
+	}
+
+	dtFreeNavMesh(nav);
+}
+} // namespace Bench
@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "Benchmarks.h"
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourTileCache.h"
+#include "DetourTileCacheBuilder.h"
+#include "DetourTileCacheCompressor.h"
+#include "RecastTileBuild.h"
+
+namespace Bench
+{
+namespace
+{
+const int TILE_SIZE = 48;
+const int EXPECTED_LAYERS_PER_TILE = 4;
+const int OBSTACLE_COUNT = 32;
+const int LAYER_CACHE_SIZE = 16 * 1024 * 1024;
+
+Random s_random(0);
+
+float frand()
+{
+	return s_random.next();
+}
+
+struct MeshProcess : public dtTileCacheMeshProcess
+{
+	void process(dtNavMeshCreateParams* params, unsigned char*, unsigned short* polyFlags) override
+	{
+		for (int i = 0; i < params->polyCount; ++i)
+			polyFlags[i] = 1;
+	}
+};
+
+// Builds the compressed layers of a tile and adds them to the tile cache. Returns the number of layers added.
+int addTileLayers(rcContext* ctx, const InputMesh& mesh, const rcConfig& cfg, const int tx, const int ty,
+				  dtTileCacheCompressor* comp, dtTileCache* tileCache)
+{
+	rcConfig tileCfg;
+	rcCalcTileConfig(cfg, tx, ty, tileCfg);
+
+	rcHeightfield* solid = rcAllocHeightfield();
+	rcCompactHeightfield* chf = rcAllocCompactHeightfield();
+	rcHeightfieldLayerSet* lset = rcAllocHeightfieldLayerSet();
+	int added = 0;
+	if (solid && chf && lset &&
+		rcCreateHeightfield(ctx, *solid, tileCfg.width, tileCfg.height, tileCfg.bmin, tileCfg.bmax, tileCfg.cs, tileCfg.ch) &&
+		rasterizeMesh(ctx, mesh, tileCfg.walkableClimb, *solid))
+	{
+		rcFilterLowHangingWalkableObstacles(ctx, tileCfg.walkableClimb, *solid);
+		rcFilterLedgeSpans(ctx, tileCfg.walkableHeight, tileCfg.walkableClimb, *solid);
+		rcFilterWalkableLowHeightSpans(ctx, tileCfg.walkableHeight, *solid);
+
+		if (rcBuildCompactHeightfield(ctx, tileCfg.walkableHeight, tileCfg.walkableClimb, *solid, *chf) &&
+			rcErodeWalkableArea(ctx, tileCfg.walkableRadius, *chf) &&
+			rcBuildHeightfieldLayers(ctx, *chf, tileCfg.borderSize, tileCfg.walkableHeight, *lset))
+		{
+			for (int i = 0; i < lset->nlayers; ++i)
+			{
+				const rcHeightfieldLayer* layer = &lset->layers[i];
+
+				dtTileCacheLayerHeader header;
+				header.magic = DT_TILECACHE_MAGIC;
+				header.version = DT_TILECACHE_VERSION;
+				header.tx = tx;
+				header.ty = ty;
+				header.tlayer = i;
+				dtVcopy(header.bmin, layer->bmin);
+				dtVcopy(header.bmax, layer->bmax);
+				header.width = (unsigned char)layer->width;
+				header.height = (unsigned char)layer->height;
+				header.minx = (unsigned char)layer->minx;
+				header.maxx = (unsigned char)layer->maxx;
+				header.miny = (unsigned char)layer->miny;
+				header.maxy = (unsigned char)layer->maxy;
+				header.hmin = (unsigned short)layer->hmin;
+				header.hmax = (unsigned short)layer->hmax;
+
+				unsigned char* data = 0;
+				int dataSize = 0;
+				if (dtStatusFailed(dtBuildTileCacheLayer(comp, &header, layer->heights, layer->areas, layer->cons,
+														 &data, &dataSize)))
+					continue;
+				if (dtStatusFailed(tileCache->addTile(data, dataSize, DT_COMPRESSEDTILE_FREE_DATA, 0)))
+				{
+					dtFree(data);
+					continue;
+				}
+				added++;
+			}
+		}
+	}
+	rcFreeHeightField(solid);
+	rcFreeCompactHeightfield(chf);
+	rcFreeHeightfieldLayerSet(lset);
+	return added;
+}
+
+void updateUntilDone(dtTileCache* tileCache, dtNavMesh* nav)
+{
+	bool upToDate = false;
+	while (!upToDate)
+	{
+		if (dtStatusFailed(tileCache->update(0.0f, nav, &upToDate)))
+			break;
+	}
+}
+
+// Times the tile builds and the obstacle rebuilds of the mesh with one of the rebuild modes.
+void benchRebuildMode(Runner& runner, const InputMesh& mesh, const rcConfig& cfg, const int rebuildMode,
+					  const int layerCacheSize, const std::string& suffix)
+{
+	if (!runner.enabled("tilecache/buildNavMeshTiles/" + mesh.name + suffix) &&
+		!runner.enabled("tilecache/obstacles/" + mesh.name + suffix))
+		return;
+
+	int tilesX = 0, tilesY = 0;
+	rcCalcTileGridSize(cfg, &tilesX, &tilesY);
+
+	dtTileCacheParams tcparams;
+	memset(&tcparams, 0, sizeof(tcparams));
+	rcVcopy(tcparams.orig, cfg.bmin);
+	tcparams.cs = cfg.cs;
+	tcparams.ch = cfg.ch;
+	tcparams.width = TILE_SIZE;
+	tcparams.height = TILE_SIZE;
+	tcparams.walkableHeight = cfg.walkableHeight * cfg.ch;
+	tcparams.walkableRadius = cfg.walkableRadius * cfg.cs;
+	tcparams.walkableClimb = cfg.walkableClimb * cfg.ch;
+	tcparams.maxSimplificationError = cfg.maxSimplificationError;
+	tcparams.maxTiles = tilesX * tilesY * EXPECTED_LAYERS_PER_TILE;
+	tcparams.maxObstacles = OBSTACLE_COUNT * 2;
+	tcparams.rebuildMode = rebuildMode;
+	tcparams.layerCacheSize = layerCacheSize;
+
+	TiledNavMeshData navParams;
+	const int tileBits = rcMin((int)dtIlog2(dtNextPow2(tcparams.maxTiles)), 14);
+	rcVcopy(navParams.orig, cfg.bmin);
+	navParams.tileSize = TILE_SIZE * cfg.cs;
+	navParams.maxTiles = 1 << tileBits;
+	navParams.maxPolys = 1 << (22 - tileBits);
+
+	dtTileCacheAlloc talloc;
+	dtTileCacheRLECompressor tcomp;
+	MeshProcess tmproc;
+	dtTileCache* tileCache = dtAllocTileCache();
+	dtNavMesh* nav = createNavMesh(navParams, false);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	if (!tileCache || !nav || !query || dtStatusFailed(tileCache->init(&tcparams, &talloc, &tcomp, &tmproc)))
+	{
+		fprintf(stderr, "Could not create the tile cache of '%s'.\n", mesh.name.c_str());
+		dtFreeNavMeshQuery(query);
+		dtFreeNavMesh(nav);
+		dtFreeTileCache(tileCache);
+		return;
+	}
+
+	rcContext ctx(false);
+	int layerCount = 0;
+	for (int y = 0; y < tilesY; ++y)
+		for (int x = 0; x < tilesX; ++x)
+			layerCount += addTileLayers(&ctx, mesh, cfg, x, y, &tcomp, tileCache);
+	for (int y = 0; y < tilesY; ++y)
+		for (int x = 0; x < tilesX; ++x)
+			tileCache->buildNavMeshTilesAt(x, y, nav);
+
+	runner.run("tilecache/buildNavMeshTiles/" + mesh.name + suffix, layerCount, [&] {
+		for (int y = 0; y < tilesY; ++y)
+			for (int x = 0; x < tilesX; ++x)
+				tileCache->buildNavMeshTilesAt(x, y, nav);
+	});
+
+	// Adds and removes a set of cylinder obstacles, rebuilding the tiles they touch both times.
+	float positions[OBSTACLE_COUNT * 3];
+	for (int i = 0; i < OBSTACLE_COUNT; ++i)
+		dtVcopy(&positions[i * 3], cfg.bmin);
+	s_random = Random(5678);
+	dtQueryFilter filter;
+	if (dtStatusSucceed(query->init(nav, 2048)))
+	{
+		for (int i = 0; i < OBSTACLE_COUNT; ++i)
+		{
+			dtPolyRef ref = 0;
+			query->findRandomPoint(&filter, frand, &ref, &positions[i * 3]);
+		}
+	}
+
+	dtObstacleRef refs[OBSTACLE_COUNT];
+	runner.run("tilecache/obstacles/" + mesh.name + suffix, OBSTACLE_COUNT, [&] {
+		for (int i = 0; i < OBSTACLE_COUNT; ++i)
+			tileCache->addObstacle(&positions[i * 3], 1.0f, 2.0f, &refs[i]);
+		updateUntilDone(tileCache, nav);
+		for (int i = 0; i < OBSTACLE_COUNT; ++i)
+			tileCache->removeObstacle(refs[i]);
+		updateUntilDone(tileCache, nav);
+	});
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+	dtFreeTileCache(tileCache);
+}
+} // anonymous namespace
+
+void benchDetourTileCache(Runner& runner)
+{
+	const std::string names[] = {
+		"tilecache/buildNavMeshTiles/nav_test", "tilecache/obstacles/nav_test",
+		"tilecache/buildNavMeshTiles/nav_test/layerCache", "tilecache/obstacles/nav_test/layerCache",
+		"tilecache/buildNavMeshTiles/nav_test/dirtyRegions", "tilecache/obstacles/nav_test/dirtyRegions"
+	};
+	bool any = false;
+	for (const std::string& name : names)
+		any |= runner.enabled(name);
+	if (!any)
+		return;
+
+	InputMesh mesh;
+	if (!loadMesh(runner.getOptions(), "nav_test.obj", mesh))
+		return;
+
+	rcConfig cfg;
+	initConfig(mesh, cfg);
+	cfg.tileSize = TILE_SIZE;
+	cfg.borderSize = cfg.walkableRadius + 3;
+
+	benchRebuildMode(runner, mesh, cfg, DT_TILECACHE_REBUILD_FULL, 0, "");
+	benchRebuildMode(runner, mesh, cfg, DT_TILECACHE_REBUILD_FULL, LAYER_CACHE_SIZE, "/layerCache");
+	benchRebuildMode(runner, mesh, cfg, DT_TILECACHE_REBUILD_DIRTY_REGIONS, 0, "/dirtyRegions");
+}
+} // namespace Bench
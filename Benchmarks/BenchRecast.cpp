@@ -0,0 +1,331 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "Benchmarks.h"
+#include "DetourAlloc.h"
+#include "DetourNavMeshBuilder.h"
+#include "Recast.h"
+#include "RecastMeshIndex.h"
+
+namespace Bench
+{
+namespace
+{
+// The intermediate results of a solo mesh build, each stage is timed from the results of the previous one.
+struct SoloBuild
+{
+	rcConfig cfg;
+	rcHeightfield* solid;
+	rcCompactHeightfield* chf;
+	rcContourSet* cset;
+	rcPolyMesh* pmesh;
+	rcPolyMeshDetail* dmesh;
+
+	SoloBuild() : solid(0), chf(0), cset(0), pmesh(0), dmesh(0) {}
+	~SoloBuild()
+	{
+		rcFreeHeightField(solid);
+		rcFreeCompactHeightfield(chf);
+		rcFreeContourSet(cset);
+		rcFreePolyMesh(pmesh);
+		rcFreePolyMeshDetail(dmesh);
+	}
+};
+
+bool rasterize(rcContext* ctx, const InputMesh& mesh, const rcConfig& cfg, rcHeightfield*& solid)
+{
+	rcFreeHeightField(solid);
+	solid = rcAllocHeightfield();
+	return solid && rcCreateHeightfield(ctx, *solid, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch) &&
+		rasterizeMesh(ctx, mesh, cfg.walkableClimb, *solid);
+}
+
+// Rasterizes all triangles of the mesh into a column heightfield and merges them into its spans.
+bool rasterizeColumns(rcContext* ctx, const InputMesh& mesh, const rcConfig& cfg, rcColumnHeightfield& columns)
+{
+	std::vector<unsigned char> areas(mesh.getTriCount(), 0);
+	rcMarkWalkableTriangles(ctx, 45.0f, &mesh.verts[0], mesh.getVertCount(), &mesh.tris[0], mesh.getTriCount(), &areas[0]);
+	return rcCreateColumnHeightfield(ctx, columns, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch) &&
+		rcRasterizeTriangles(ctx, &mesh.verts[0], mesh.getVertCount(), &mesh.tris[0], &areas[0], mesh.getTriCount(),
+							 columns, cfg.walkableClimb) &&
+		rcSortColumnHeightfield(ctx, columns);
+}
+
+void filter(rcContext* ctx, const rcConfig& cfg, rcHeightfield& solid)
+{
+	rcFilterLowHangingWalkableObstacles(ctx, cfg.walkableClimb, solid);
+	rcFilterLedgeSpans(ctx, cfg.walkableHeight, cfg.walkableClimb, solid);
+	rcFilterWalkableLowHeightSpans(ctx, cfg.walkableHeight, solid);
+}
+
+bool buildCompact(rcContext* ctx, const rcConfig& cfg, const rcHeightfield& solid, rcCompactHeightfield*& chf)
+{
+	rcFreeCompactHeightfield(chf);
+	chf = rcAllocCompactHeightfield();
+	return chf && rcBuildCompactHeightfield(ctx, cfg.walkableHeight, cfg.walkableClimb, solid, *chf) &&
+		rcErodeWalkableArea(ctx, cfg.walkableRadius, *chf);
+}
+
+bool buildWatershedRegions(rcContext* ctx, const rcConfig& cfg, rcCompactHeightfield& chf)
+{
+	return rcBuildDistanceField(ctx, chf) && rcBuildRegions(ctx, chf, 0, cfg.minRegionArea, cfg.mergeRegionArea);
+}
+
+bool buildContours(rcContext* ctx, const rcConfig& cfg, const rcCompactHeightfield& chf, rcContourSet*& cset)
+{
+	rcFreeContourSet(cset);
+	cset = rcAllocContourSet();
+	return cset && rcBuildContours(ctx, chf, cfg.maxSimplificationError, cfg.maxEdgeLen, *cset);
+}
+
+bool buildPolyMesh(rcContext* ctx, const rcConfig& cfg, const rcContourSet& cset, rcPolyMesh*& pmesh)
+{
+	rcFreePolyMesh(pmesh);
+	pmesh = rcAllocPolyMesh();
+	return pmesh && rcBuildPolyMesh(ctx, cset, cfg.maxVertsPerPoly, *pmesh);
+}
+
+bool buildDetailMesh(rcContext* ctx, const rcConfig& cfg, const rcPolyMesh& pmesh, const rcCompactHeightfield& chf,
+					 rcPolyMeshDetail*& dmesh)
+{
+	rcFreePolyMeshDetail(dmesh);
+	dmesh = rcAllocPolyMeshDetail();
+	return dmesh && rcBuildPolyMeshDetail(ctx, pmesh, chf, cfg.detailSampleDist, cfg.detailSampleMaxError, *dmesh);
+}
+
+void fillCreateParams(const SoloBuild& build, dtNavMeshCreateParams& params)
+{
+	const rcConfig& cfg = build.cfg;
+	memset(&params, 0, sizeof(params));
+	params.verts = build.pmesh->verts;
+	params.vertCount = build.pmesh->nverts;
+	params.polys = build.pmesh->polys;
+	params.polyAreas = build.pmesh->areas;
+	params.polyFlags = build.pmesh->flags;
+	params.polyCount = build.pmesh->npolys;
+	params.nvp = build.pmesh->nvp;
+	params.detailMeshes = build.dmesh->meshes;
+	params.detailVerts = build.dmesh->verts;
+	params.detailVertsCount = build.dmesh->nverts;
+	params.detailTris = build.dmesh->tris;
+	params.detailTriCount = build.dmesh->ntris;
+	params.walkableHeight = cfg.walkableHeight * cfg.ch;
+	params.walkableRadius = cfg.walkableRadius * cfg.cs;
+	params.walkableClimb = cfg.walkableClimb * cfg.ch;
+	rcVcopy(params.bmin, build.pmesh->bmin);
+	rcVcopy(params.bmax, build.pmesh->bmax);
+	params.cs = cfg.cs;
+	params.ch = cfg.ch;
+	params.buildBvTree = true;
+}
+
+void benchMesh(Runner& runner, const char* fileName)
+{
+	std::string base = fileName;
+	base.erase(base.rfind('.'));
+	const std::string stages[] = {
+		"recast/markWalkable/", "recast/rasterize/", "recast/filter/", "recast/compact/", "recast/filteredCompact/", "recast/columns/rasterize/",
+		"recast/columns/filteredCompact/", "recast/regions/monotone/",
+		"recast/regions/layers/", "recast/regions/watershed/", "recast/contours/", "recast/polymesh/",
+		"recast/detailmesh/", "detour/createNavMeshData/"
+	};
+	bool any = false;
+	for (const std::string& stage : stages)
+		any |= runner.enabled(stage + base);
+	if (!any)
+		return;
+
+	InputMesh mesh;
+	if (!loadMesh(runner.getOptions(), fileName, mesh))
+		return;
+
+	rcContext ctx(false);
+	SoloBuild build;
+	rcConfig& cfg = build.cfg;
+	initConfig(mesh, cfg);
+
+	std::vector<unsigned char> areas(mesh.getTriCount());
+	runner.run("recast/markWalkable/" + mesh.name, mesh.getTriCount(), [&] {
+		rcMarkWalkableTriangles(&ctx, cfg.walkableSlopeAngle, &mesh.verts[0], mesh.getVertCount(), &mesh.tris[0],
+								mesh.getTriCount(), &areas[0]);
+	});
+
+	// Each stage leaves its result in the build for the next stage.
+	runner.run("recast/rasterize/" + mesh.name, mesh.getTriCount(), [&] {
+		rcFreeHeightField(build.solid);
+		build.solid = rcAllocHeightfield();
+		rcCreateHeightfield(&ctx, *build.solid, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch);
+	}, [&] {
+		rasterizeMesh(&ctx, mesh, cfg.walkableClimb, *build.solid);
+	}, [] {});
+
+	runner.run("recast/filter/" + mesh.name, cfg.width * cfg.height, [&] {
+		rasterize(&ctx, mesh, cfg, build.solid);
+	}, [&] {
+		filter(&ctx, cfg, *build.solid);
+	}, [] {});
+
+	// The filters and the compaction in one call, without the erosion of the compact stage.
+	runner.run("recast/filteredCompact/" + mesh.name, cfg.width * cfg.height, [&] {
+		rasterize(&ctx, mesh, cfg, build.solid);
+		rcFreeCompactHeightfield(build.chf);
+		build.chf = rcAllocCompactHeightfield();
+	}, [&] {
+		rcBuildFilteredCompactHeightfield(&ctx, RC_FILTER_LOW_HANGING_OBSTACLES | RC_FILTER_LEDGE_SPANS |
+			RC_FILTER_WALKABLE_LOW_HEIGHT, cfg.walkableHeight, cfg.walkableClimb, *build.solid, *build.chf);
+	}, [] {});
+
+	// The same stages with the spans of each column stored next to each other.
+	rcColumnHeightfield* columns = rcAllocColumnHeightfield();
+	runner.run("recast/columns/rasterize/" + mesh.name, mesh.getTriCount(), [&] {
+		rasterizeColumns(&ctx, mesh, cfg, *columns);
+	});
+	runner.run("recast/columns/filteredCompact/" + mesh.name, cfg.width * cfg.height, [&] {
+		rasterizeColumns(&ctx, mesh, cfg, *columns);
+		rcFreeCompactHeightfield(build.chf);
+		build.chf = rcAllocCompactHeightfield();
+	}, [&] {
+		rcBuildFilteredCompactHeightfield(&ctx, RC_FILTER_LOW_HANGING_OBSTACLES | RC_FILTER_LEDGE_SPANS |
+			RC_FILTER_WALKABLE_LOW_HEIGHT, cfg.walkableHeight, cfg.walkableClimb, *columns, *build.chf);
+	}, [] {});
+	rcFreeColumnHeightfield(columns);
+
+	if (!rasterize(&ctx, mesh, cfg, build.solid))
+	{
+		fprintf(stderr, "Could not rasterize '%s'.\n", mesh.name.c_str());
+		return;
+	}
+	filter(&ctx, cfg, *build.solid);
+
+	runner.run("recast/compact/" + mesh.name, rcGetHeightFieldSpanCount(&ctx, *build.solid), [&] {
+		buildCompact(&ctx, cfg, *build.solid, build.chf);
+	});
+	if (!buildCompact(&ctx, cfg, *build.solid, build.chf))
+	{
+		fprintf(stderr, "Could not build the compact heightfield of '%s'.\n", mesh.name.c_str());
+		return;
+	}
+
+	// All partitionings overwrite the regions of the previous one, watershed goes last for the later stages.
+	const int spanCount = build.chf->spanCount;
+	runner.run("recast/regions/monotone/" + mesh.name, spanCount, [&] {
+		rcBuildRegionsMonotone(&ctx, *build.chf, 0, cfg.minRegionArea, cfg.mergeRegionArea);
+	});
+	runner.run("recast/regions/layers/" + mesh.name, spanCount, [&] {
+		rcBuildLayerRegions(&ctx, *build.chf, 0, cfg.minRegionArea);
+	});
+	runner.run("recast/regions/watershed/" + mesh.name, spanCount, [&] {
+		buildWatershedRegions(&ctx, cfg, *build.chf);
+	});
+	if (!buildWatershedRegions(&ctx, cfg, *build.chf))
+	{
+		fprintf(stderr, "Could not build the regions of '%s'.\n", mesh.name.c_str());
+		return;
+	}
+
+	runner.run("recast/contours/" + mesh.name, spanCount, [&] {
+		buildContours(&ctx, cfg, *build.chf, build.cset);
+	});
+	if (!buildContours(&ctx, cfg, *build.chf, build.cset))
+	{
+		fprintf(stderr, "Could not build the contours of '%s'.\n", mesh.name.c_str());
+		return;
+	}
+
+	runner.run("recast/polymesh/" + mesh.name, build.cset->nconts, [&] {
+		buildPolyMesh(&ctx, cfg, *build.cset, build.pmesh);
+	});
+	if (!buildPolyMesh(&ctx, cfg, *build.cset, build.pmesh))
+	{
+		fprintf(stderr, "Could not build the polygon mesh of '%s'.\n", mesh.name.c_str());
+		return;
+	}
+	for (int i = 0; i < build.pmesh->npolys; ++i)
+		build.pmesh->flags[i] = 1;
+
+	runner.run("recast/detailmesh/" + mesh.name, build.pmesh->npolys, [&] {
+		buildDetailMesh(&ctx, cfg, *build.pmesh, *build.chf, build.dmesh);
+	});
+	if (!buildDetailMesh(&ctx, cfg, *build.pmesh, *build.chf, build.dmesh))
+	{
+		fprintf(stderr, "Could not build the detail mesh of '%s'.\n", mesh.name.c_str());
+		return;
+	}
+
+	dtNavMeshCreateParams params;
+	fillCreateParams(build, params);
+	unsigned char* navData = 0;
+	int navDataSize = 0;
+	if (!dtCreateNavMeshData(&params, &navData, &navDataSize))
+	{
+		fprintf(stderr, "Could not create the nav mesh data of '%s'.\n", mesh.name.c_str());
+		return;
+	}
+	dtFree(navData);
+
+	runner.run("detour/createNavMeshData/" + mesh.name, build.pmesh->npolys, [] {}, [&] {
+		dtCreateNavMeshData(&params, &navData, &navDataSize);
+	}, [&] {
+		dtFree(navData);
+		navData = 0;
+	});
+	params.bvTreeSplit = DT_BVTREE_SPLIT_SAH;
+	runner.run("detour/createNavMeshData/" + mesh.name + "/sah", build.pmesh->npolys, [] {}, [&] {
+		dtCreateNavMeshData(&params, &navData, &navDataSize);
+	}, [&] {
+		dtFree(navData);
+		navData = 0;
+	});
+}
+
+// Builds the triangle index of the demo and casts rays between random points of the mesh bounds.
+void benchMeshIndex(Runner& runner, const char* fileName)
+{
+	const int RAY_COUNT = 1000;
+
+	std::string base = fileName;
+	base.erase(base.rfind('.'));
+	if (!runner.enabled("recast/meshIndex/build/" + base) && !runner.enabled("recast/meshIndex/raycast/" + base))
+		return;
+
+	InputMesh mesh;
+	if (!loadMesh(runner.getOptions(), fileName, mesh))
+		return;
+
+	rcContext ctx(false);
+	rcTriMeshIndex index;
+	runner.run("recast/meshIndex/build/" + mesh.name, mesh.getTriCount(), [&] {
+		rcBuildTriMeshIndex(&ctx, &mesh.verts[0], mesh.getVertCount(), &mesh.tris[0], mesh.getTriCount(), 256, index);
+	});
+	if (!rcBuildTriMeshIndex(&ctx, &mesh.verts[0], mesh.getVertCount(), &mesh.tris[0], mesh.getTriCount(), 256, index))
+	{
+		fprintf(stderr, "Could not build the triangle index of '%s'.\n", mesh.name.c_str());
+		return;
+	}
+
+	Random random(2468);
+	std::vector<float> points(RAY_COUNT * 2 * 3);
+	for (int i = 0; i < RAY_COUNT * 2; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+			points[i * 3 + j] = mesh.bmin[j] + random.next() * (mesh.bmax[j] - mesh.bmin[j]);
+	}
+	runner.run("recast/meshIndex/raycast/" + mesh.name, RAY_COUNT, [&] {
+		for (int i = 0; i < RAY_COUNT; ++i)
+		{
+			float t = 0.0f;
+			rcRaycastTriMeshIndex(index, &mesh.verts[0], &points[i * 6], &points[i * 6 + 3], t);
+		}
+	});
+}
+} // anonymous namespace
+
+void benchRecast(Runner& runner)
+{
+	benchMesh(runner, "nav_test.obj");
+	benchMesh(runner, "dungeon.obj");
+	benchMesh(runner, "undulating.obj");
+	benchMeshIndex(runner, "nav_test.obj");
+	benchMeshIndex(runner, "dungeon.obj");
+}
+} // namespace Bench
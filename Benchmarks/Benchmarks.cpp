@@ -0,0 +1,374 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Benchmarks.h"
+#include "CrowdScenario.h"
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+#include "RecastTileBuild.h"
+
+namespace Bench
+{
+void Runner::report(const std::string& name, const int items, std::vector<double>& samples)
+{
+	std::sort(samples.begin(), samples.end());
+	const int n = (int)samples.size();
+	double sum = 0.0;
+	for (int i = 0; i < n; ++i)
+		sum += samples[i];
+	const double median = (n & 1) ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) * 0.5;
+	const double mean = sum / n;
+
+	printf("{\"name\":\"%s\",\"repetitions\":%d,\"items\":%d,\"min_ns\":%.0f,\"median_ns\":%.0f,"
+		   "\"mean_ns\":%.0f,\"max_ns\":%.0f,\"median_ns_per_item\":%.1f}\n",
+		   name.c_str(), n, items, samples[0], median, mean, samples[n - 1],
+		   items > 0 ? median / items : median);
+	fflush(stdout);
+}
+
+bool loadMesh(const Options& options, const char* fileName, InputMesh& mesh)
+{
+	const std::string path = options.meshDir + "/" + fileName;
+	FILE* fp = fopen(path.c_str(), "r");
+	if (!fp)
+	{
+		fprintf(stderr, "Could not open '%s'.\n", path.c_str());
+		return false;
+	}
+
+	mesh.name = fileName;
+	const std::string::size_type dot = mesh.name.rfind('.');
+	if (dot != std::string::npos)
+		mesh.name.erase(dot);
+	mesh.verts.clear();
+	mesh.tris.clear();
+
+	char line[512];
+	while (fgets(line, sizeof(line), fp))
+	{
+		if (line[0] == 'v' && line[1] == ' ')
+		{
+			float v[3];
+			if (sscanf(line + 2, "%f %f %f", &v[0], &v[1], &v[2]) == 3)
+				mesh.verts.insert(mesh.verts.end(), v, v + 3);
+		}
+		else if (line[0] == 'f' && line[1] == ' ')
+		{
+			int face[32];
+			int n = 0;
+			for (char* s = line + 2; *s && n < 32; )
+			{
+				while (*s == ' ' || *s == '\t')
+					++s;
+				if (*s == '\0' || *s == '\n' || *s == '\r')
+					break;
+				const int vi = atoi(s);
+				face[n++] = vi < 0 ? mesh.getVertCount() + vi : vi - 1;
+				while (*s && *s != ' ' && *s != '\t')
+					++s;
+			}
+			for (int i = 2; i < n; ++i)
+			{
+				mesh.tris.push_back(face[0]);
+				mesh.tris.push_back(face[i - 1]);
+				mesh.tris.push_back(face[i]);
+			}
+		}
+	}
+	fclose(fp);
+
+	if (mesh.tris.empty())
+	{
+		fprintf(stderr, "'%s' has no triangles.\n", path.c_str());
+		return false;
+	}
+
+	rcCalcBounds(&mesh.verts[0], mesh.getVertCount(), mesh.bmin, mesh.bmax);
+	mesh.triBounds.resize(mesh.getTriCount() * 4);
+	for (int i = 0; i < mesh.getTriCount(); ++i)
+	{
+		float* b = &mesh.triBounds[i * 4];
+		const float* v0 = &mesh.verts[mesh.tris[i * 3 + 0] * 3];
+		b[0] = b[2] = v0[0];
+		b[1] = b[3] = v0[2];
+		for (int j = 1; j < 3; ++j)
+		{
+			const float* v = &mesh.verts[mesh.tris[i * 3 + j] * 3];
+			b[0] = rcMin(b[0], v[0]);
+			b[1] = rcMin(b[1], v[2]);
+			b[2] = rcMax(b[2], v[0]);
+			b[3] = rcMax(b[3], v[2]);
+		}
+	}
+	return true;
+}
+
+void initConfig(const InputMesh& mesh, rcConfig& cfg)
+{
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.cs = 0.3f;
+	cfg.ch = 0.2f;
+	cfg.walkableSlopeAngle = 45.0f;
+	cfg.walkableHeight = (int)ceilf(2.0f / cfg.ch);
+	cfg.walkableClimb = (int)floorf(0.9f / cfg.ch);
+	cfg.walkableRadius = (int)ceilf(0.6f / cfg.cs);
+	cfg.maxEdgeLen = (int)(12.0f / cfg.cs);
+	cfg.maxSimplificationError = 1.3f;
+	cfg.minRegionArea = 8 * 8;
+	cfg.mergeRegionArea = 20 * 20;
+	cfg.maxVertsPerPoly = 6;
+	cfg.detailSampleDist = 6.0f * cfg.cs;
+	cfg.detailSampleMaxError = 1.0f * cfg.ch;
+	rcVcopy(cfg.bmin, mesh.bmin);
+	rcVcopy(cfg.bmax, mesh.bmax);
+	rcCalcGridSize(cfg.bmin, cfg.bmax, cfg.cs, &cfg.width, &cfg.height);
+}
+
+bool rasterizeMesh(rcContext* ctx, const InputMesh& mesh, const int walkableClimb, rcHeightfield& heightfield)
+{
+	std::vector<int> tris;
+	for (int i = 0; i < mesh.getTriCount(); ++i)
+	{
+		const float* b = &mesh.triBounds[i * 4];
+		if (b[0] > heightfield.bmax[0] || b[2] < heightfield.bmin[0] ||
+			b[1] > heightfield.bmax[2] || b[3] < heightfield.bmin[2])
+			continue;
+		tris.insert(tris.end(), &mesh.tris[i * 3], &mesh.tris[i * 3] + 3);
+	}
+	const int ntris = (int)tris.size() / 3;
+	if (!ntris)
+		return true;
+
+	std::vector<unsigned char> areas(ntris, 0);
+	rcMarkWalkableTriangles(ctx, 45.0f, &mesh.verts[0], mesh.getVertCount(), &tris[0], ntris, &areas[0]);
+	return rcRasterizeTriangles(ctx, &mesh.verts[0], mesh.getVertCount(), &tris[0], &areas[0], ntris,
+								heightfield, walkableClimb);
+}
+
+namespace
+{
+class NavMeshTileBuilder : public rcTileBuildCallbacks
+{
+public:
+	NavMeshTileBuilder(const InputMesh& mesh, TiledNavMeshData& data) : m_mesh(mesh), m_data(data) {}
+
+	bool rasterizeTile(rcContext* context, const rcConfig& tileCfg, const int, const int,
+					   rcHeightfield& heightfield) override
+	{
+		return rasterizeMesh(context, m_mesh, tileCfg.walkableClimb, heightfield);
+	}
+
+	bool createTileData(rcContext*, const rcConfig& tileCfg, const int tx, const int ty,
+						rcPolyMesh& polyMesh, rcPolyMeshDetail& detailMesh,
+						unsigned char** outData, int* outDataSize) override
+	{
+		*outData = 0;
+		*outDataSize = 0;
+		if (!polyMesh.npolys)
+			return true;
+		for (int i = 0; i < polyMesh.npolys; ++i)
+			polyMesh.flags[i] = 1;
+
+		dtNavMeshCreateParams params;
+		memset(&params, 0, sizeof(params));
+		params.verts = polyMesh.verts;
+		params.vertCount = polyMesh.nverts;
+		params.polys = polyMesh.polys;
+		params.polyAreas = polyMesh.areas;
+		params.polyFlags = polyMesh.flags;
+		params.polyCount = polyMesh.npolys;
+		params.nvp = polyMesh.nvp;
+		params.detailMeshes = detailMesh.meshes;
+		params.detailVerts = detailMesh.verts;
+		params.detailVertsCount = detailMesh.nverts;
+		params.detailTris = detailMesh.tris;
+		params.detailTriCount = detailMesh.ntris;
+		params.walkableHeight = tileCfg.walkableHeight * tileCfg.ch;
+		params.walkableRadius = tileCfg.walkableRadius * tileCfg.cs;
+		params.walkableClimb = tileCfg.walkableClimb * tileCfg.ch;
+		params.tileX = tx;
+		params.tileY = ty;
+		rcVcopy(params.bmin, polyMesh.bmin);
+		rcVcopy(params.bmax, polyMesh.bmax);
+		params.cs = tileCfg.cs;
+		params.ch = tileCfg.ch;
+		params.buildBvTree = true;
+		return dtCreateNavMeshData(&params, outData, outDataSize);
+	}
+
+	void addTile(const int tx, const int ty, unsigned char* data, const int dataSize) override
+	{
+		TiledNavMeshData::Tile tile;
+		tile.x = tx;
+		tile.y = ty;
+		tile.data.assign(data, data + dataSize);
+		m_data.tiles.push_back(tile);
+		dtFree(data);
+	}
+
+private:
+	const InputMesh& m_mesh;
+	TiledNavMeshData& m_data;
+};
+} // anonymous namespace
+
+bool buildTiledNavMeshData(const InputMesh& mesh, const int tileSize, TiledNavMeshData& data)
+{
+	rcTileBuildConfig buildCfg;
+	memset(&buildCfg, 0, sizeof(buildCfg));
+	initConfig(mesh, buildCfg.cfg);
+	buildCfg.cfg.tileSize = tileSize;
+	buildCfg.cfg.borderSize = buildCfg.cfg.walkableRadius + 3;
+	buildCfg.partitionType = RC_PARTITION_WATERSHED;
+	buildCfg.filterFlags = RC_FILTER_LOW_HANGING_OBSTACLES | RC_FILTER_LEDGE_SPANS | RC_FILTER_WALKABLE_LOW_HEIGHT;
+
+	int tilesX = 0, tilesY = 0;
+	rcCalcTileGridSize(buildCfg.cfg, &tilesX, &tilesY);
+	const int tileBits = rcMin((int)dtIlog2(dtNextPow2(tilesX * tilesY)), 14);
+
+	rcVcopy(data.orig, mesh.bmin);
+	data.tileSize = tileSize * buildCfg.cfg.cs;
+	data.maxTiles = 1 << tileBits;
+	data.maxPolys = 1 << (22 - tileBits);
+	data.tiles.clear();
+
+	rcContext ctx(false);
+	NavMeshTileBuilder builder(mesh, data);
+	if (!rcBuildTiles(&ctx, buildCfg, builder, 0, 0) || data.tiles.empty())
+	{
+		fprintf(stderr, "Could not build the tiles of '%s'.\n", mesh.name.c_str());
+		return false;
+	}
+	return true;
+}
+
+dtNavMesh* createNavMesh(const TiledNavMeshData& data, const bool addTiles)
+{
+	dtNavMeshParams params;
+	memset(&params, 0, sizeof(params));
+	rcVcopy(params.orig, data.orig);
+	params.tileWidth = data.tileSize;
+	params.tileHeight = data.tileSize;
+	params.maxTiles = data.maxTiles;
+	params.maxPolys = data.maxPolys;
+
+	dtNavMesh* nav = dtAllocNavMesh();
+	if (!nav || dtStatusFailed(nav->init(&params)))
+	{
+		dtFreeNavMesh(nav);
+		return 0;
+	}
+	for (size_t i = 0; addTiles && i < data.tiles.size(); ++i)
+	{
+		const TiledNavMeshData::Tile& tile = data.tiles[i];
+		const int dataSize = (int)tile.data.size();
+		unsigned char* copy = (unsigned char*)dtAlloc(dataSize, DT_ALLOC_PERM);
+		if (!copy)
+			break;
+		memcpy(copy, &tile.data[0], dataSize);
+		if (dtStatusFailed(nav->addTile(copy, dataSize, DT_TILE_FREE_DATA, 0, 0)))
+			dtFree(copy);
+	}
+	return nav;
+}
+} // namespace Bench
+
+static void printUsage(const char* name)
+{
+	printf("Usage: %s [--filter <text>] [--repetitions <count>] [--meshes <dir>]\n", name);
+	printf("       %s --scenario crossing|bottleneck|walkers [scenario options]\n", name);
+	printf("  --filter       Only run the benchmarks whose name contains the text.\n");
+	printf("  --repetitions  The number of timed repetitions of each benchmark. (Default: 5)\n");
+	printf("  --meshes       The directory of the demo meshes. (Default: %s)\n", RC_BENCH_MESH_DIR);
+	printf("  --scenario     Run a crowd scenario instead of the benchmarks.\n");
+	printf("Scenario options:\n");
+	printf("  --mesh         The demo mesh to run on. (Default: nav_test.obj)\n");
+	printf("  --agents       The number of agents. (Default: 200 crossing, 400 bottleneck, 10000 walkers)\n");
+	printf("  --ticks        The number of crowd updates, 30 per second. (Default: 900)\n");
+	printf("  --seed         The seed of the spawn points and targets. (Default: 1)\n");
+	printf("  --threads      The number of threads updating the crowd. (Default: 1)\n");
+	printf("  --avoidance    The avoidance configuration, 0-3 sampled, 4 ORCA or -1 for none. (Default: 3)\n");
+	printf("  --lod          The agent LOD: full, reduced, corridor or frozen. (Default: full)\n");
+	printf("  --lod-interval The update interval of the reduced agents. (Default: 4)\n");
+	printf("  --cluster      The size of the agent clusters, 0 to disable them. (Default: 0)\n");
+	printf("  --per-tick     Print the update time and state hash of every tick.\n");
+}
+
+static bool parseLOD(const char* name, CrowdAgentLOD& lod)
+{
+	const char* names[] = { "full", "reduced", "corridor", "frozen" };
+	for (int i = 0; i < 4; ++i)
+	{
+		if (strcmp(name, names[i]) == 0)
+		{
+			lod = (CrowdAgentLOD)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+int main(int argc, char** argv)
+{
+	Bench::Options options;
+	options.meshDir = RC_BENCH_MESH_DIR;
+	Bench::ScenarioSettings scenario;
+	bool runScenario = false;
+	const char* scenarioMesh = "nav_test.obj";
+	int ticks = 900;
+	bool perTick = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		const bool hasValue = i + 1 < argc;
+		if (strcmp(argv[i], "--filter") == 0 && hasValue)
+			options.filter = argv[++i];
+		else if (strcmp(argv[i], "--repetitions") == 0 && hasValue)
+			options.repetitions = rcMax(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--meshes") == 0 && hasValue)
+			options.meshDir = argv[++i];
+		else if (strcmp(argv[i], "--scenario") == 0 && hasValue && Bench::parseScenarioType(argv[i + 1], scenario.type))
+		{
+			runScenario = true;
+			++i;
+		}
+		else if (strcmp(argv[i], "--mesh") == 0 && hasValue)
+			scenarioMesh = argv[++i];
+		else if (strcmp(argv[i], "--agents") == 0 && hasValue)
+			scenario.agentCount = rcMax(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--ticks") == 0 && hasValue)
+			ticks = rcMax(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+			scenario.seed = (unsigned int)strtoul(argv[++i], 0, 10);
+		else if (strcmp(argv[i], "--threads") == 0 && hasValue)
+			scenario.threads = rcMax(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--avoidance") == 0 && hasValue)
+			scenario.avoidance = rcClamp(atoi(argv[++i]), -1, 4);
+		else if (strcmp(argv[i], "--lod") == 0 && hasValue && parseLOD(argv[i + 1], scenario.lod))
+			++i;
+		else if (strcmp(argv[i], "--lod-interval") == 0 && hasValue)
+			scenario.lodInterval = rcMax(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--cluster") == 0 && hasValue)
+			scenario.clusterSize = rcMax(0.0f, (float)atof(argv[++i]));
+		else if (strcmp(argv[i], "--per-tick") == 0)
+			perTick = true;
+		else
+		{
+			printUsage(argv[0]);
+			return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+		}
+	}
+
+	if (runScenario)
+		return Bench::runCrowdScenario(options, scenario, scenarioMesh, ticks, perTick);
+
+	Bench::Runner runner(options);
+	Bench::benchRecast(runner);
+	Bench::benchDetour(runner);
+	Bench::benchDetourCrowd(runner);
+	Bench::benchDetourTileCache(runner);
+	return 0;
+}
@@ -0,0 +1,141 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "Recast.h"
+
+class dtNavMesh;
+
+// A small harness for timing the hot paths of the libraries.
+//
+// Every benchmark runs its body once to warm up and then a fixed number of
+// repetitions. The setup and teardown functions run around every repetition
+// and are not timed. The results are written to stdout, one JSON object per
+// line, so that they can be compared between builds with a script.
+namespace Bench
+{
+struct Options
+{
+	std::string filter;		// Only benchmarks whose name contains the filter are run.
+	std::string meshDir;	// The directory of the input meshes.
+	int repetitions = 5;	// The number of timed repetitions of each benchmark.
+};
+
+class Runner
+{
+public:
+	explicit Runner(const Options& options) : m_options(options) {}
+
+	const Options& getOptions() const { return m_options; }
+
+	// True if the benchmark passes the filter. Used to skip the setup of filtered out benchmarks.
+	bool enabled(const std::string& name) const
+	{
+		return m_options.filter.empty() || name.find(m_options.filter) != std::string::npos;
+	}
+
+	// Times @p body, which processes @p items items per call, e.g. triangles or queries.
+	template<class Setup, class Body, class Teardown>
+	void run(const std::string& name, const int items, Setup setup, Body body, Teardown teardown)
+	{
+		if (!enabled(name))
+			return;
+
+		setup();
+		body();
+		teardown();
+
+		std::vector<double> samples;
+		for (int i = 0; i < m_options.repetitions; ++i)
+		{
+			setup();
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			body();
+			const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+			teardown();
+			samples.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+		}
+		report(name, items, samples);
+	}
+
+	template<class Body>
+	void run(const std::string& name, const int items, Body body)
+	{
+		run(name, items, [] {}, body, [] {});
+	}
+
+private:
+	void report(const std::string& name, const int items, std::vector<double>& samples);
+
+	Options m_options;
+};
+
+// A triangle mesh loaded from an .obj file.
+struct InputMesh
+{
+	std::string name;
+	std::vector<float> verts;
+	std::vector<int> tris;
+	std::vector<float> triBounds;	// The xz-bounds of each triangle. [(minx, minz, maxx, maxz) * triCount]
+	float bmin[3];
+	float bmax[3];
+
+	int getVertCount() const { return (int)verts.size() / 3; }
+	int getTriCount() const { return (int)tris.size() / 3; }
+};
+
+// Loads a mesh from the mesh directory. Logs an error and returns false if the file cannot be read.
+bool loadMesh(const Options& options, const char* fileName, InputMesh& mesh);
+
+// The build settings of the demo for a human sized agent. Sets the bounds and grid size from the mesh.
+void initConfig(const InputMesh& mesh, rcConfig& cfg);
+
+// Marks and rasterizes the triangles overlapping the xz-bounds of the heightfield.
+bool rasterizeMesh(rcContext* ctx, const InputMesh& mesh, const int walkableClimb, rcHeightfield& heightfield);
+
+// The tile data of a tiled nav mesh, kept so that the tiles can be added to new nav meshes.
+struct TiledNavMeshData
+{
+	struct Tile
+	{
+		int x, y;
+		std::vector<unsigned char> data;
+	};
+
+	float orig[3];
+	float tileSize;
+	int maxTiles;
+	int maxPolys;
+	std::vector<Tile> tiles;
+};
+
+// Builds the tiles of a nav mesh of @p tileSize cells per side, all polygons have the flags 1.
+bool buildTiledNavMeshData(const InputMesh& mesh, const int tileSize, TiledNavMeshData& data);
+
+// Creates a nav mesh for the tiles of @p data, or null on failure. Copies of all tiles are added if @p addTiles is set.
+dtNavMesh* createNavMesh(const TiledNavMeshData& data, const bool addTiles = true);
+
+// A deterministic random number generator, so that every run uses the same queries.
+struct Random
+{
+	unsigned int state;
+	explicit Random(unsigned int seed) : state(seed) {}
+
+	float next()
+	{
+		state = state * 1664525u + 1013904223u;
+		return (float)(state >> 8) / (float)(1 << 24);
+	}
+};
+
+void benchRecast(Runner& runner);
+void benchDetour(Runner& runner);
+void benchDetourCrowd(Runner& runner);
+void benchDetourTileCache(Runner& runner);
+} // namespace Bench
+
+#endif // BENCHMARKS_H
@@ -0,0 +1,479 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "CrowdScenario.h"
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+
+namespace Bench
+{
+namespace
+{
+const float AGENT_RADIUS = 0.6f;
+const float AREA_PER_AGENT = 4.0f;		// The spawn area of an agent in the groups. [Units: wu^2]
+const float ARRIVAL_DISTANCE = 1.5f;	// How close to the target an agent has arrived. [Units: wu]
+const int END_POINT_ATTEMPTS = 64;
+const int MAX_PATH = 256;
+const float PI = 3.14159265f;
+
+Random s_random(0);
+
+float frand()
+{
+	return s_random.next();
+}
+
+double getClockUsec()
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The avoidance configurations of the crowd tool of the demo: 0-3 sample the velocities
+// with increasing quality, 4 solves the ORCA constraints.
+void initAvoidanceParams(dtCrowd* crowd)
+{
+	dtObstacleAvoidanceParams params;
+	memcpy(&params, crowd->getObstacleAvoidanceParams(0), sizeof(dtObstacleAvoidanceParams));
+	const unsigned char quality[4][3] = { { 5, 2, 1 }, { 5, 2, 2 }, { 7, 2, 3 }, { 7, 3, 3 } };
+	params.velBias = 0.5f;
+	for (int i = 0; i < 4; ++i)
+	{
+		params.adaptiveDivs = quality[i][0];
+		params.adaptiveRings = quality[i][1];
+		params.adaptiveDepth = quality[i][2];
+		crowd->setObstacleAvoidanceParams(i, &params);
+	}
+	params.solver = DT_OBSTACLE_AVOIDANCE_ORCA;
+	crowd->setObstacleAvoidanceParams(4, &params);
+}
+
+// FNV-1a, so that the hashes are the same on every platform with the same float layout.
+void hashBytes(unsigned long long& hash, const void* data, const size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+}
+
+const unsigned long long HASH_SEED = 14695981039346656037ull;
+
+void addTimes(dtCrowdUpdateTimes& sum, const dtCrowdUpdateTimes& times)
+{
+	sum.pathValidity += times.pathValidity;
+	sum.moveRequests += times.moveRequests;
+	sum.topologyOptimization += times.topologyOptimization;
+	sum.proximityGrid += times.proximityGrid;
+	sum.boundary += times.boundary;
+	sum.neighbours += times.neighbours;
+	sum.corners += times.corners;
+	sum.steering += times.steering;
+	sum.planning += times.planning;
+	sum.integrate += times.integrate;
+	sum.collisions += times.collisions;
+	sum.moveAlongSurface += times.moveAlongSurface;
+	sum.other += times.other;
+	sum.total += times.total;
+}
+} // anonymous namespace
+
+bool parseScenarioType(const char* name, ScenarioType& type)
+{
+	for (int i = SCENARIO_CROSSING; i <= SCENARIO_WALKERS; ++i)
+	{
+		if (strcmp(name, getScenarioName((ScenarioType)i)) == 0)
+		{
+			type = (ScenarioType)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* getScenarioName(const ScenarioType type)
+{
+	switch (type)
+	{
+	case SCENARIO_CROSSING: return "crossing";
+	case SCENARIO_BOTTLENECK: return "bottleneck";
+	case SCENARIO_WALKERS: return "walkers";
+	}
+	return "";
+}
+
+ThreadPoolDispatcher::ThreadPoolDispatcher(const int workerCount) : m_workerCount(rcMax(1, workerCount))
+{
+	for (int i = 1; i < m_workerCount; ++i)
+		m_threads.emplace_back(&ThreadPoolDispatcher::work, this, i);
+}
+
+ThreadPoolDispatcher::~ThreadPoolDispatcher()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_start.notify_all();
+	for (std::thread& thread : m_threads)
+		thread.join();
+}
+
+void ThreadPoolDispatcher::dispatch(dtJobFunc func, void* userData, const int jobCount)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_func = func;
+		m_userData = userData;
+		m_jobCount = jobCount;
+		m_nextJob = 0;
+		m_busyWorkers = (int)m_threads.size();
+		m_round++;
+	}
+	m_start.notify_all();
+
+	runJobs(0);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [this] { return m_busyWorkers == 0; });
+}
+
+void ThreadPoolDispatcher::runJobs(const int workerIndex)
+{
+	for (int i = m_nextJob++; i < m_jobCount; i = m_nextJob++)
+		m_func(m_userData, i, workerIndex);
+}
+
+void ThreadPoolDispatcher::work(const int workerIndex)
+{
+	unsigned int round = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_start.wait(lock, [&] { return m_quit || m_round != round; });
+			if (m_quit)
+				return;
+			round = m_round;
+		}
+
+		runJobs(workerIndex);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (--m_busyWorkers == 0)
+			m_done.notify_one();
+	}
+}
+
+CrowdScenario::~CrowdScenario()
+{
+	if (m_crowd)
+		m_crowd->setJobDispatcher(nullptr);
+	delete m_dispatcher;
+	dtFreeCrowd(m_crowd);
+	dtFreeNavMeshQuery(m_query);
+}
+
+bool CrowdScenario::init(dtNavMesh* nav, const ScenarioSettings& settings)
+{
+	m_settings = settings;
+	if (!m_settings.agentCount)
+	{
+		const int defaultCounts[] = { 200, 400, 10000 };
+		m_settings.agentCount = defaultCounts[m_settings.type];
+	}
+	const int agentCount = m_settings.agentCount;
+
+	m_query = dtAllocNavMeshQuery();
+	m_crowd = dtAllocCrowd();
+	if (!m_query || dtStatusFailed(m_query->init(nav, 2048)) || !m_crowd ||
+		!m_crowd->init(agentCount, AGENT_RADIUS, nav))
+	{
+		fprintf(stderr, "Could not create a crowd of %d agents.\n", agentCount);
+		return false;
+	}
+	if (m_settings.threads > 1)
+	{
+		m_dispatcher = new ThreadPoolDispatcher(m_settings.threads);
+		if (!m_crowd->setJobDispatcher(m_dispatcher))
+		{
+			fprintf(stderr, "Could not create the queries of %d crowd workers.\n", m_settings.threads);
+			return false;
+		}
+	}
+	initAvoidanceParams(m_crowd);
+	m_crowd->setLODUpdateInterval(m_settings.lodInterval);
+	m_crowd->setClusterSize(m_settings.clusterSize);
+
+	memset(&m_params, 0, sizeof(m_params));
+	m_params.radius = AGENT_RADIUS;
+	m_params.height = 2.0f;
+	m_params.maxAcceleration = 8.0f;
+	m_params.maxSpeed = 3.5f;
+	m_params.collisionQueryRange = m_params.radius * 12.0f;
+	m_params.pathOptimizationRange = m_params.radius * 30.0f;
+	m_params.separationWeight = 2.0f;
+	m_params.updateFlags = DT_CROWD_ANTICIPATE_TURNS | DT_CROWD_OPTIMIZE_VIS | DT_CROWD_OPTIMIZE_TOPO |
+		DT_CROWD_SEPARATION;
+	if (m_settings.avoidance >= 0)
+	{
+		m_params.updateFlags |= DT_CROWD_OBSTACLE_AVOIDANCE;
+		m_params.obstacleAvoidanceType = (unsigned char)m_settings.avoidance;
+	}
+	m_params.lod = (unsigned char)m_settings.lod;
+
+	m_targets.assign(agentCount * 3, 0.0f);
+	m_arrived.assign(agentCount, false);
+	m_arrivals = 0;
+	s_random = Random(m_settings.seed);
+
+	if (m_settings.type == SCENARIO_WALKERS)
+	{
+		for (int i = 0; i < agentCount; ++i)
+		{
+			dtPolyRef ref = 0;
+			float pos[3];
+			if (dtStatusFailed(m_query->findRandomPoint(m_crowd->getFilter(0), frand, &ref, pos)))
+				continue;
+			const int idx = m_crowd->addAgent(pos, &m_params);
+			if (idx >= 0)
+				sendToRandomPoint(idx);
+		}
+	}
+	else
+	{
+		float start[3], end[3];
+		dtPolyRef startRef = 0, endRef = 0;
+		if (!findEndPoints(start, startRef, end, endRef))
+		{
+			fprintf(stderr, "Could not find the end points of the scenario.\n");
+			return false;
+		}
+
+		if (m_settings.type == SCENARIO_CROSSING)
+		{
+			// Each group spawns in a disc around one end point and scatters over the other disc.
+			const int half = agentCount / 2;
+			const float radius = sqrtf(half * AREA_PER_AGENT / PI);
+			if (!spawnAround(start, startRef, radius, end, endRef, half) ||
+				!spawnAround(end, endRef, radius, start, startRef, agentCount - half))
+				return false;
+		}
+		else
+		{
+			// Everyone walks to the same point, and leaves the crowd there.
+			const float radius = sqrtf(agentCount * AREA_PER_AGENT / PI);
+			if (!spawnAround(start, startRef, radius, end, endRef, agentCount))
+				return false;
+		}
+	}
+
+	if (m_crowd->getActiveAgentCount() < agentCount)
+		fprintf(stderr, "Only %d of %d agents could be added.\n", m_crowd->getActiveAgentCount(), agentCount);
+	return true;
+}
+
+// Picks the pair of random points furthest apart which are connected by a complete path.
+bool CrowdScenario::findEndPoints(float* start, dtPolyRef& startRef, float* end, dtPolyRef& endRef)
+{
+	const dtQueryFilter* filter = m_crowd->getFilter(0);
+	dtPolyRef path[MAX_PATH];
+	float bestDist = -1.0f;
+	for (int i = 0; i < END_POINT_ATTEMPTS; ++i)
+	{
+		dtPolyRef refs[2];
+		float pos[2][3];
+		if (dtStatusFailed(m_query->findRandomPoint(filter, frand, &refs[0], pos[0])) ||
+			dtStatusFailed(m_query->findRandomPoint(filter, frand, &refs[1], pos[1])))
+			continue;
+		const float dist = dtVdist(pos[0], pos[1]);
+		if (dist <= bestDist)
+			continue;
+
+		int pathCount = 0;
+		const dtStatus status = m_query->findPath(refs[0], refs[1], pos[0], pos[1], filter, path, &pathCount, MAX_PATH);
+		if (dtStatusFailed(status) || dtStatusDetail(status, DT_PARTIAL_RESULT) || !pathCount ||
+			path[pathCount - 1] != refs[1])
+			continue;
+
+		bestDist = dist;
+		startRef = refs[0];
+		endRef = refs[1];
+		dtVcopy(start, pos[0]);
+		dtVcopy(end, pos[1]);
+	}
+	return bestDist >= 0.0f;
+}
+
+bool CrowdScenario::spawnAround(const float* center, const dtPolyRef centerRef, const float radius,
+								const float* target, const dtPolyRef targetRef, const int count)
+{
+	const dtQueryFilter* filter = m_crowd->getFilter(0);
+	const bool scatter = m_settings.type == SCENARIO_CROSSING;
+	for (int i = 0; i < count; ++i)
+	{
+		dtPolyRef ref = 0;
+		float pos[3];
+		if (dtStatusFailed(m_query->findRandomPointAroundCircle(centerRef, center, radius, filter, frand, &ref, pos)))
+			continue;
+		const int idx = m_crowd->addAgent(pos, &m_params);
+		if (idx < 0)
+			continue;
+
+		dtPolyRef goalRef = targetRef;
+		float* goal = &m_targets[idx * 3];
+		dtVcopy(goal, target);
+		if (scatter && dtStatusFailed(m_query->findRandomPointAroundCircle(targetRef, target, radius, filter, frand,
+																		   &goalRef, goal)))
+		{
+			goalRef = targetRef;
+			dtVcopy(goal, target);
+		}
+		if (!m_crowd->requestMoveTarget(idx, goalRef, goal))
+		{
+			fprintf(stderr, "Could not request the target of agent %d.\n", idx);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool CrowdScenario::sendToRandomPoint(const int idx)
+{
+	dtPolyRef ref = 0;
+	float* target = &m_targets[idx * 3];
+	if (dtStatusFailed(m_query->findRandomPoint(m_crowd->getFilter(0), frand, &ref, target)))
+		return false;
+	m_arrived[idx] = false;
+	return m_crowd->requestMoveTarget(idx, ref, target);
+}
+
+void CrowdScenario::tick(const float dt)
+{
+	// The agents are visited in pool order, so that the new targets do not depend on the update.
+	for (int i = 0; i < m_crowd->getAgentCount(); ++i)
+	{
+		const dtCrowdAgent* agent = m_crowd->getAgent(i);
+		if (!agent->active)
+			continue;
+		const bool failed = agent->targetState == DT_CROWDAGENT_TARGET_FAILED;
+		const bool arrived = !m_arrived[i] && dtVdist2DSqr(agent->npos, &m_targets[i * 3]) <
+			ARRIVAL_DISTANCE * ARRIVAL_DISTANCE;
+		if (arrived)
+		{
+			m_arrived[i] = true;
+			m_arrivals++;
+		}
+
+		switch (m_settings.type)
+		{
+		case SCENARIO_CROSSING:
+			break;
+		case SCENARIO_BOTTLENECK:
+			if (arrived)
+				m_crowd->removeAgent(i);
+			break;
+		case SCENARIO_WALKERS:
+			if (arrived || failed)
+				sendToRandomPoint(i);
+			break;
+		}
+	}
+
+	m_crowd->update(dt, 0);
+}
+
+unsigned long long CrowdScenario::hashState() const
+{
+	unsigned long long hash = HASH_SEED;
+	for (int i = 0; i < m_crowd->getAgentCount(); ++i)
+	{
+		const dtCrowdAgent* agent = m_crowd->getAgent(i);
+		if (!agent->active)
+			continue;
+		const dtPolyRef ref = agent->corridor.getFirstPoly();
+		hashBytes(hash, &i, sizeof(i));
+		hashBytes(hash, &agent->state, sizeof(agent->state));
+		hashBytes(hash, &agent->targetState, sizeof(agent->targetState));
+		hashBytes(hash, agent->npos, sizeof(agent->npos));
+		hashBytes(hash, agent->vel, sizeof(agent->vel));
+		hashBytes(hash, &ref, sizeof(ref));
+	}
+	return hash;
+}
+
+int runCrowdScenario(const Options& options, const ScenarioSettings& settings, const char* meshFile,
+					 const int ticks, const bool perTick)
+{
+	InputMesh mesh;
+	TiledNavMeshData data;
+	if (!loadMesh(options, meshFile, mesh) || !buildTiledNavMeshData(mesh, 48, data))
+		return 1;
+	dtNavMesh* nav = createNavMesh(data);
+	if (!nav)
+	{
+		fprintf(stderr, "Could not create the nav mesh of '%s'.\n", mesh.name.c_str());
+		return 1;
+	}
+
+	int result = 1;
+	{
+		CrowdScenario scenario;
+		if (scenario.init(nav, settings))
+		{
+			const float dt = 1.0f / 30.0f;
+			dtCrowd* crowd = scenario.getCrowd();
+			crowd->setUpdateClock(getClockUsec);
+			const dtCrowdUpdateTimes& times = crowd->getUpdateTimes();
+
+			dtCrowdUpdateTimes sum;
+			memset(&sum, 0, sizeof(sum));
+			std::vector<double> tickTimes;
+			long long agentUpdates = 0;
+			unsigned long long runHash = HASH_SEED;
+			for (int tick = 0; tick < ticks; ++tick)
+			{
+				scenario.tick(dt);
+				const unsigned long long hash = scenario.hashState();
+				hashBytes(runHash, &hash, sizeof(hash));
+
+				addTimes(sum, times);
+				tickTimes.push_back(times.total);
+				agentUpdates += crowd->getActiveAgentCount();
+
+				if (perTick)
+				{
+					printf("{\"tick\":%d,\"agents\":%d,\"update_us\":%.1f,\"hash\":\"%016llx\"}\n",
+						   tick, crowd->getActiveAgentCount(), times.total, hash);
+				}
+			}
+
+			std::sort(tickTimes.begin(), tickTimes.end());
+			const ScenarioSettings& used = scenario.getSettings();
+			printf("{\"scenario\":\"%s\",\"mesh\":\"%s\",\"agents\":%d,\"ticks\":%d,\"seed\":%u,\"threads\":%d,"
+				   "\"avoidance\":%d,\"lod\":%d,\"cluster\":%.2f,\"arrivals\":%d,\"update_ms\":%.3f,"
+				   "\"median_tick_us\":%.1f,\"max_tick_us\":%.1f,\"agent_updates_per_s\":%.0f,\"hash\":\"%016llx\",",
+				   getScenarioName(used.type), mesh.name.c_str(), used.agentCount, ticks, used.seed, used.threads,
+				   used.avoidance, (int)used.lod, used.clusterSize, scenario.getArrivalCount(), sum.total / 1000.0,
+				   tickTimes.empty() ? 0.0 : tickTimes[tickTimes.size() / 2],
+				   tickTimes.empty() ? 0.0 : tickTimes.back(),
+				   sum.total > 0.0 ? agentUpdates / (sum.total / 1e6) : 0.0, runHash);
+			printf("\"stages_ms\":{\"pathValidity\":%.3f,\"moveRequests\":%.3f,\"topologyOptimization\":%.3f,"
+				   "\"proximityGrid\":%.3f,\"boundary\":%.3f,\"neighbours\":%.3f,\"corners\":%.3f,\"steering\":%.3f,"
+				   "\"planning\":%.3f,\"integrate\":%.3f,\"collisions\":%.3f,\"moveAlongSurface\":%.3f,\"other\":%.3f}}\n",
+				   sum.pathValidity / 1000.0, sum.moveRequests / 1000.0, sum.topologyOptimization / 1000.0,
+				   sum.proximityGrid / 1000.0, sum.boundary / 1000.0, sum.neighbours / 1000.0, sum.corners / 1000.0,
+				   sum.steering / 1000.0, sum.planning / 1000.0, sum.integrate / 1000.0, sum.collisions / 1000.0,
+				   sum.moveAlongSurface / 1000.0, sum.other / 1000.0);
+			fflush(stdout);
+			result = 0;
+		}
+	}
+
+	dtFreeNavMesh(nav);
+	return result;
+}
+} // namespace Bench
@@ -0,0 +1,124 @@
+#ifndef CROWDSCENARIO_H
+#define CROWDSCENARIO_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Benchmarks.h"
+#include "DetourCrowd.h"
+
+class dtNavMeshQuery;
+
+// Scripted crowd simulations for comparing crowd update configurations.
+//
+// A scenario spawns its agents and sends them to their targets the same way
+// on every run, so that two runs with the same settings and seed produce the
+// same agent states tick by tick. Settings which should not change the result,
+// like the number of threads, can be checked against each other with the
+// state hashes, the others are compared by their timings.
+namespace Bench
+{
+enum ScenarioType
+{
+	SCENARIO_CROSSING,		// Two groups swap places, crossing each other halfway.
+	SCENARIO_BOTTLENECK,	// A wide group converges on one target.
+	SCENARIO_WALKERS		// Agents walk between random points, getting a new target on arrival.
+};
+
+struct ScenarioSettings
+{
+	ScenarioType type = SCENARIO_CROSSING;
+	int agentCount = 0;			// The number of agents, zero for the default of the scenario.
+	unsigned int seed = 1;		// The seed of the spawn points and targets.
+	int threads = 1;			// The number of threads updating the crowd, one to update it serially.
+	int avoidance = 3;			// The avoidance configuration, see initAvoidanceParams, or -1 to disable avoidance.
+	CrowdAgentLOD lod = DT_CROWDAGENT_LOD_FULL;	// The update level of detail of all agents.
+	int lodInterval = 4;		// The number of frames between the updates of the reduced agents.
+	float clusterSize = 0.0f;	// The size of the agent clusters, zero to update the agents on their own.
+};
+
+// Parses a scenario name. Returns false if the name is unknown.
+bool parseScenarioType(const char* name, ScenarioType& type);
+
+const char* getScenarioName(const ScenarioType type);
+
+// Runs the jobs of the crowd update on a pool of threads kept for the whole run,
+// the calling thread is worker 0.
+class ThreadPoolDispatcher : public dtJobDispatcher
+{
+public:
+	explicit ThreadPoolDispatcher(const int workerCount);
+	~ThreadPoolDispatcher() override;
+
+	int getWorkerCount() const override { return m_workerCount; }
+	void dispatch(dtJobFunc func, void* userData, const int jobCount) override;
+
+private:
+	void runJobs(const int workerIndex);
+	void work(const int workerIndex);
+
+	int m_workerCount;
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_start;
+	std::condition_variable m_done;
+	dtJobFunc m_func = nullptr;
+	void* m_userData = nullptr;
+	int m_jobCount = 0;
+	std::atomic<int> m_nextJob{0};
+	int m_busyWorkers = 0;		// The pool threads still running jobs of the current round.
+	unsigned int m_round = 0;	// Incremented by every dispatch.
+	bool m_quit = false;
+};
+
+class CrowdScenario
+{
+public:
+	CrowdScenario() = default;
+	~CrowdScenario();
+
+	// Creates the crowd and spawns the agents. Logs an error and returns false on failure.
+	bool init(dtNavMesh* nav, const ScenarioSettings& settings);
+
+	// Updates the targets of the scenario and then the crowd by @p dt seconds.
+	void tick(const float dt);
+
+	// Hashes the state of the active agents: position, velocity, state and corridor.
+	unsigned long long hashState() const;
+
+	dtCrowd* getCrowd() const { return m_crowd; }
+	const ScenarioSettings& getSettings() const { return m_settings; }
+
+	// The number of times an agent reached its target.
+	int getArrivalCount() const { return m_arrivals; }
+
+private:
+	CrowdScenario(const CrowdScenario&) = delete;
+	CrowdScenario& operator=(const CrowdScenario&) = delete;
+
+	bool findEndPoints(float* start, dtPolyRef& startRef, float* end, dtPolyRef& endRef);
+	bool spawnAround(const float* center, const dtPolyRef centerRef, const float radius, const float* target,
+					 const dtPolyRef targetRef, const int count);
+	bool sendToRandomPoint(const int idx);
+
+	ScenarioSettings m_settings;
+	dtCrowd* m_crowd = nullptr;
+	dtNavMeshQuery* m_query = nullptr;
+	ThreadPoolDispatcher* m_dispatcher = nullptr;
+	dtCrowdAgentParams m_params;
+	std::vector<float> m_targets;		// The target of every agent. [(x, y, z) * agentCount]
+	std::vector<bool> m_arrived;		// True once the agent reached its target, reset by a new target.
+	int m_arrivals = 0;
+};
+
+// Runs a scenario on a demo mesh for @p ticks updates and prints the timings and state hashes.
+// Returns the exit code of the benchmark executable.
+int runCrowdScenario(const Options& options, const ScenarioSettings& settings, const char* meshFile,
+					 const int ticks, const bool perTick);
+} // namespace Bench
+
+#endif // CROWDSCENARIO_H
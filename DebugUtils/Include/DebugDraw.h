@@ -71,6 +71,21 @@ struct duDebugDraw
 
 	/// Compute a color for given area.
 	virtual unsigned int areaToCol(unsigned int area);
+
+	/// Create a buffer to record geometry into once, and draw many times with drawBuffer().
+	/// The default buffer keeps the vertices in memory, a renderer can return a buffer which also
+	/// keeps them on the GPU.
+	/// @return the buffer, free it with destroyBuffer().
+	virtual class duDebugDrawBuffer* createBuffer();
+
+	/// Free a buffer created by createBuffer().
+	///  @param buffer [in] the buffer to free.
+	virtual void destroyBuffer(class duDebugDrawBuffer* buffer);
+
+	/// Draw the geometry recorded in a buffer. The default implementation submits the vertices
+	/// again with begin(), vertex() and end(), a renderer can draw each batch with one call instead.
+	///  @param buffer [in] the buffer to draw.
+	virtual void drawBuffer(const class duDebugDrawBuffer& buffer);
 };
 
 inline unsigned int duRGBA(int r, int g, int b, int a)
@@ -221,5 +236,67 @@ private:
 	duDisplayList& operator=(const duDisplayList&);
 };
 
+/// Geometry recorded in batches of primitives, and drawn with duDebugDraw::drawBuffer().
+/// Any debug draw function can record into a buffer. Textures and uv coordinates are not recorded,
+/// and area colors are those of the debug draw which created the buffer.
+class duDebugDrawBuffer : public duDebugDraw
+{
+public:
+	/// The vertices recorded between one begin() and end().
+	struct Batch
+	{
+		duDebugDrawPrimitives prim;
+		float size;
+		bool depthMask;
+		int first;			///< The index of the first vertex of the batch.
+		int count;			///< The number of vertices of the batch.
+	};
+
+	/// @param owner [in] the debug draw providing the area colors, or null for the default colors.
+	explicit duDebugDrawBuffer(duDebugDraw* owner = 0);
+	virtual ~duDebugDrawBuffer();
+	virtual void depthMask(bool state);
+	virtual void texture(bool state);
+	virtual void begin(duDebugDrawPrimitives prim, float size = 1.0f);
+	virtual void vertex(const float* pos, unsigned int color);
+	virtual void vertex(const float x, const float y, const float z, unsigned int color);
+	virtual void vertex(const float* pos, unsigned int color, const float* uv);
+	virtual void vertex(const float x, const float y, const float z, unsigned int color, const float u, const float v);
+	virtual void end();
+	virtual unsigned int areaToCol(unsigned int area);
+
+	/// Remove the recorded geometry, before recording it again.
+	virtual void clear();
+
+	int getBatchCount() const { return m_batchCount; }
+	const Batch& getBatch(int i) const { return m_batches[i]; }
+	int getVertexCount() const { return m_size; }
+	/// The vertex positions. [(x, y, z) * getVertexCount()]
+	const float* getPositions() const { return m_pos; }
+	/// The vertex colors. [Size: getVertexCount()]
+	const unsigned int* getColors() const { return m_color; }
+	/// The depth mask state at the end of the recording.
+	bool getDepthMask() const { return m_depthMask; }
+	/// Changes every time the buffer is cleared, so that a renderer knows when to update its copy.
+	unsigned int getVersion() const { return m_version; }
+
+private:
+	duDebugDraw* m_owner;
+	float* m_pos;
+	unsigned int* m_color;
+	int m_size;
+	int m_cap;
+	Batch* m_batches;
+	int m_batchCount;
+	int m_batchCap;
+	bool m_depthMask;
+	bool m_open;
+	unsigned int m_version;
+
+	// Explicitly disabled copy constructor and copy assignment operator.
+	duDebugDrawBuffer(const duDebugDrawBuffer&);
+	duDebugDrawBuffer& operator=(const duDebugDrawBuffer&);
+};
+
 
 #endif // DEBUGDRAW_H
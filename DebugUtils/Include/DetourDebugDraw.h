@@ -38,6 +38,48 @@ void duDebugDrawNavMeshPortals(struct duDebugDraw* dd, const dtNavMesh& mesh);
 void duDebugDrawNavMeshPolysWithFlags(struct duDebugDraw* dd, const dtNavMesh& mesh, const unsigned short polyFlags, const unsigned int col);
 void duDebugDrawNavMeshPoly(struct duDebugDraw* dd, const dtNavMesh& mesh, dtPolyRef ref, const unsigned int col);
 
+/// Draws a navigation mesh like duDebugDrawNavMesh(), keeping the geometry of each tile in a buffer
+/// of the debug draw. Only the tiles which changed since the last draw are tessellated again, the
+/// other tiles are drawn from their buffers.
+/// A tile changes when its reference changes, or when the reference of a tile next to it changes,
+/// which can change the links drawn on its borders.
+class duNavMeshDebugCache
+{
+public:
+	/// @param dd [in] the debug draw creating and drawing the buffers, must outlive the cache.
+	explicit duNavMeshDebugCache(struct duDebugDraw* dd);
+	~duNavMeshDebugCache();
+
+	/// Draws the navigation mesh. DU_DRAWNAVMESH_CLOSEDLIST is ignored.
+	///  @param mesh [in] the navigation mesh.
+	///  @param flags [in] the draw flags. (See: #DrawNavMeshFlags)
+	void draw(const dtNavMesh& mesh, unsigned char flags);
+
+	/// Frees the buffers of all tiles, e.g. before drawing another navigation mesh.
+	void clear();
+
+	/// The number of tiles tessellated by the last draw.
+	int getRecordedTileCount() const { return m_recordedTiles; }
+
+private:
+	struct Entry
+	{
+		dtTileRef ref;
+		unsigned int neighbours;
+		unsigned char flags;
+		class duDebugDrawBuffer* buffer;
+	};
+
+	struct duDebugDraw* m_dd;
+	Entry* m_entries;
+	int m_entryCount;
+	int m_recordedTiles;
+
+	// Explicitly disabled copy constructor and copy assignment operator.
+	duNavMeshDebugCache(const duNavMeshDebugCache&);
+	duNavMeshDebugCache& operator=(const duNavMeshDebugCache&);
+};
+
 void duDebugDrawTileCacheLayerAreas(struct duDebugDraw* dd, const dtTileCacheLayer& layer, const float cs, const float ch);
 void duDebugDrawTileCacheLayerRegions(struct duDebugDraw* dd, const dtTileCacheLayer& layer, const float cs, const float ch);
 void duDebugDrawTileCacheContours(duDebugDraw* dd, const struct dtTileCacheContourSet& lcset,
@@ -27,6 +27,33 @@ duDebugDraw::~duDebugDraw()
 	// Empty
 }
 
+duDebugDrawBuffer* duDebugDraw::createBuffer()
+{
+	return new duDebugDrawBuffer(this);
+}
+
+void duDebugDraw::destroyBuffer(duDebugDrawBuffer* buffer)
+{
+	delete buffer;
+}
+
+void duDebugDraw::drawBuffer(const duDebugDrawBuffer& buffer)
+{
+	const float* pos = buffer.getPositions();
+	const unsigned int* color = buffer.getColors();
+	for (int i = 0; i < buffer.getBatchCount(); ++i)
+	{
+		const duDebugDrawBuffer::Batch& batch = buffer.getBatch(i);
+		depthMask(batch.depthMask);
+		begin(batch.prim, batch.size);
+		for (int j = batch.first; j < batch.first + batch.count; ++j)
+			vertex(&pos[j*3], color[j]);
+		end();
+	}
+	if (buffer.getBatchCount())
+		depthMask(buffer.getDepthMask());
+}
+
 unsigned int duDebugDraw::areaToCol(unsigned int area)
 {
 	if (area == 0)
@@ -609,3 +636,125 @@ void duDisplayList::draw(struct duDebugDraw* dd)
 		dd->vertex(&m_pos[i*3], m_color[i]);
 	dd->end();
 }
+
+duDebugDrawBuffer::duDebugDrawBuffer(duDebugDraw* owner) :
+	m_owner(owner),
+	m_pos(0),
+	m_color(0),
+	m_size(0),
+	m_cap(0),
+	m_batches(0),
+	m_batchCount(0),
+	m_batchCap(0),
+	m_depthMask(true),
+	m_open(false),
+	m_version(0)
+{
+}
+
+duDebugDrawBuffer::~duDebugDrawBuffer()
+{
+	delete [] m_pos;
+	delete [] m_color;
+	delete [] m_batches;
+}
+
+void duDebugDrawBuffer::depthMask(bool state)
+{
+	m_depthMask = state;
+}
+
+void duDebugDrawBuffer::texture(bool /*state*/)
+{
+}
+
+void duDebugDrawBuffer::begin(duDebugDrawPrimitives prim, float size)
+{
+	if (m_batchCount+1 > m_batchCap)
+	{
+		const int cap = m_batchCap ? m_batchCap*2 : 8;
+		Batch* batches = new Batch[cap];
+		if (m_batchCount)
+			memcpy(batches, m_batches, sizeof(Batch)*m_batchCount);
+		delete [] m_batches;
+		m_batches = batches;
+		m_batchCap = cap;
+	}
+	Batch& batch = m_batches[m_batchCount];
+	batch.prim = prim;
+	batch.size = size;
+	batch.depthMask = m_depthMask;
+	batch.first = m_size;
+	batch.count = 0;
+	m_open = true;
+}
+
+void duDebugDrawBuffer::vertex(const float x, const float y, const float z, unsigned int color)
+{
+	if (!m_open)
+		return;
+	if (m_size+1 > m_cap)
+	{
+		const int cap = m_cap ? m_cap*2 : 512;
+		float* newPos = new float[cap*3];
+		unsigned int* newColor = new unsigned int[cap];
+		if (m_size)
+		{
+			memcpy(newPos, m_pos, sizeof(float)*3*m_size);
+			memcpy(newColor, m_color, sizeof(unsigned int)*m_size);
+		}
+		delete [] m_pos;
+		delete [] m_color;
+		m_pos = newPos;
+		m_color = newColor;
+		m_cap = cap;
+	}
+	float* p = &m_pos[m_size*3];
+	p[0] = x;
+	p[1] = y;
+	p[2] = z;
+	m_color[m_size] = color;
+	m_size++;
+}
+
+void duDebugDrawBuffer::vertex(const float* pos, unsigned int color)
+{
+	vertex(pos[0], pos[1], pos[2], color);
+}
+
+void duDebugDrawBuffer::vertex(const float* pos, unsigned int color, const float* /*uv*/)
+{
+	vertex(pos[0], pos[1], pos[2], color);
+}
+
+void duDebugDrawBuffer::vertex(const float x, const float y, const float z, unsigned int color,
+							   const float /*u*/, const float /*v*/)
+{
+	vertex(x, y, z, color);
+}
+
+void duDebugDrawBuffer::end()
+{
+	if (!m_open)
+		return;
+	m_open = false;
+	// Empty batches are dropped.
+	Batch& batch = m_batches[m_batchCount];
+	batch.count = m_size - batch.first;
+	if (batch.count > 0)
+		m_batchCount++;
+}
+
+unsigned int duDebugDrawBuffer::areaToCol(unsigned int area)
+{
+	return m_owner ? m_owner->areaToCol(area) : duDebugDraw::areaToCol(area);
+}
+
+void duDebugDrawBuffer::clear()
+{
+	m_size = 0;
+	m_batchCount = 0;
+	m_depthMask = true;
+	m_open = false;
+	m_version++;
+}
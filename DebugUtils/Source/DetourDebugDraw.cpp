@@ -21,6 +21,7 @@
 #include "DetourNavMesh.h"
 #include "DetourCommon.h"
 #include "DetourNode.h"
+#include <string.h>
 
 
 static float distancePtLine2d(const float* pt, const float* p, const float* q)
@@ -83,22 +84,18 @@ static void drawPolyBoundaries(duDebugDraw* dd, const dtMeshTile* tile,
 				if (p->neis[j] != 0) continue;
 			}
 			
-			const float* v0 = &tile->verts[p->verts[j]*3];
-			const float* v1 = &tile->verts[p->verts[(j+1) % nj]*3];
+			float v0[3], v1[3];
+			dtGetTileVertex(tile, p->verts[j], v0);
+			dtGetTileVertex(tile, p->verts[(j+1) % nj], v1);
 			
 			// Draw detail mesh edges which align with the actual poly edge.
 			// This is really slow.
 			for (int k = 0; k < pd->triCount; ++k)
 			{
 				const unsigned char* t = &tile->detailTris[(pd->triBase+k)*4];
-				const float* tv[3];
+				float tv[3][3];
 				for (int m = 0; m < 3; ++m)
-				{
-					if (t[m] < p->vertCount)
-						tv[m] = &tile->verts[p->verts[t[m]]*3];
-					else
-						tv[m] = &tile->detailVerts[(pd->vertBase+(t[m]-p->vertCount))*3];
-				}
+					dtGetDetailTriVertex(tile, p, pd, t[m], tv[m]);
 				for (int m = 0, n = 2; m < 3; n=m++)
 				{
 					if ((dtGetDetailTriEdgeFlags(t[3], n) & DT_DETAIL_EDGE_BOUNDARY) == 0)
@@ -152,10 +149,9 @@ static void drawMeshTile(duDebugDraw* dd, const dtNavMesh& mesh, const dtNavMesh
 			const unsigned char* t = &tile->detailTris[(pd->triBase+j)*4];
 			for (int k = 0; k < 3; ++k)
 			{
-				if (t[k] < p->vertCount)
-					dd->vertex(&tile->verts[p->verts[t[k]]*3], col);
-				else
-					dd->vertex(&tile->detailVerts[(pd->vertBase+t[k]-p->vertCount)*3], col);
+				float v[3];
+				dtGetDetailTriVertex(tile, p, pd, t[k], v);
+				dd->vertex(v, col);
 			}
 		}
 	}
@@ -183,8 +179,9 @@ static void drawMeshTile(duDebugDraw* dd, const dtNavMesh& mesh, const dtNavMesh
 				col = duDarkenCol(duTransCol(dd->areaToCol(p->getArea()), 220));
 
 			const dtOffMeshConnection* con = &tile->offMeshCons[i - tile->header->offMeshBase];
-			const float* va = &tile->verts[p->verts[0]*3];
-			const float* vb = &tile->verts[p->verts[1]*3];
+			float va[3], vb[3];
+			dtGetTileVertex(tile, p->verts[0], va);
+			dtGetTileVertex(tile, p->verts[1], vb);
 
 			// Check to see if start and end end-points have links.
 			bool startSet = false;
@@ -226,7 +223,8 @@ static void drawMeshTile(duDebugDraw* dd, const dtNavMesh& mesh, const dtNavMesh
 	dd->begin(DU_DRAW_POINTS, 3.0f);
 	for (int i = 0; i < tile->header->vertCount; ++i)
 	{
-		const float* v = &tile->verts[i*3];
+		float v[3];
+		dtGetTileVertex(tile, i, v);
 		dd->vertex(v[0], v[1], v[2], vcol);
 	}
 	dd->end();
@@ -241,7 +239,7 @@ void duDebugDrawNavMesh(duDebugDraw* dd, const dtNavMesh& mesh, unsigned char fl
 	for (int i = 0; i < mesh.getMaxTiles(); ++i)
 	{
 		const dtMeshTile* tile = mesh.getTile(i);
-		if (!tile->header) continue;
+		if (!tile->header || (tile->flags & DT_TILE_RETIRED)) continue;
 		drawMeshTile(dd, mesh, 0, tile, flags);
 	}
 }
@@ -255,11 +253,109 @@ void duDebugDrawNavMeshWithClosedList(struct duDebugDraw* dd, const dtNavMesh& m
 	for (int i = 0; i < mesh.getMaxTiles(); ++i)
 	{
 		const dtMeshTile* tile = mesh.getTile(i);
-		if (!tile->header) continue;
+		if (!tile->header || (tile->flags & DT_TILE_RETIRED)) continue;
 		drawMeshTile(dd, mesh, q, tile, flags);
 	}
 }
 
+duNavMeshDebugCache::duNavMeshDebugCache(duDebugDraw* dd) :
+	m_dd(dd),
+	m_entries(0),
+	m_entryCount(0),
+	m_recordedTiles(0)
+{
+}
+
+duNavMeshDebugCache::~duNavMeshDebugCache()
+{
+	clear();
+	delete [] m_entries;
+}
+
+void duNavMeshDebugCache::clear()
+{
+	for (int i = 0; i < m_entryCount; ++i)
+	{
+		if (m_entries[i].buffer)
+			m_dd->destroyBuffer(m_entries[i].buffer);
+		m_entries[i].buffer = 0;
+	}
+}
+
+// Combines the references of the tiles around a tile, including the tile itself.
+static unsigned int getNeighbourhoodKey(const dtNavMesh& mesh, const dtMeshTile* tile)
+{
+	static const int MAX_TILES = 32;
+	const dtMeshTile* tiles[MAX_TILES];
+	unsigned int key = 2166136261u;
+	for (int dy = -1; dy <= 1; ++dy)
+	{
+		for (int dx = -1; dx <= 1; ++dx)
+		{
+			const int n = mesh.getTilesAt(tile->header->x + dx, tile->header->y + dy, tiles, MAX_TILES);
+			for (int i = 0; i < n; ++i)
+			{
+				const dtTileRef ref = mesh.getTileRef(tiles[i]);
+				key = (key ^ (unsigned int)ref) * 16777619u;
+				key = (key ^ (unsigned int)(ref >> 16 >> 16)) * 16777619u;
+				key = (key ^ (tiles[i]->flags & DT_TILE_RETIRED)) * 16777619u;
+			}
+		}
+	}
+	return key;
+}
+
+void duNavMeshDebugCache::draw(const dtNavMesh& mesh, unsigned char flags)
+{
+	m_recordedTiles = 0;
+	if (!m_dd) return;
+
+	flags &= ~DU_DRAWNAVMESH_CLOSEDLIST;
+
+	// The tile count grows with sparse navigation meshes.
+	const int maxTiles = mesh.getMaxTiles();
+	if (maxTiles > m_entryCount)
+	{
+		Entry* entries = new Entry[maxTiles];
+		memset(entries, 0, sizeof(Entry)*maxTiles);
+		if (m_entryCount)
+			memcpy(entries, m_entries, sizeof(Entry)*m_entryCount);
+		delete [] m_entries;
+		m_entries = entries;
+		m_entryCount = maxTiles;
+	}
+
+	for (int i = 0; i < maxTiles; ++i)
+	{
+		const dtMeshTile* tile = mesh.getTile(i);
+		Entry& entry = m_entries[i];
+		if (!tile->header || (tile->flags & DT_TILE_RETIRED))
+		{
+			if (entry.buffer)
+				m_dd->destroyBuffer(entry.buffer);
+			entry.buffer = 0;
+			continue;
+		}
+
+		const dtTileRef ref = mesh.getTileRef(tile);
+		const unsigned int neighbours = getNeighbourhoodKey(mesh, tile);
+		if (!entry.buffer || entry.ref != ref || entry.neighbours != neighbours || entry.flags != flags)
+		{
+			if (!entry.buffer)
+				entry.buffer = m_dd->createBuffer();
+			if (!entry.buffer)
+				continue;
+			entry.buffer->clear();
+			drawMeshTile(entry.buffer, mesh, 0, tile, flags);
+			entry.ref = ref;
+			entry.neighbours = neighbours;
+			entry.flags = flags;
+			m_recordedTiles++;
+		}
+		m_dd->drawBuffer(*entry.buffer);
+	}
+}
+
 void duDebugDrawNavMeshNodes(struct duDebugDraw* dd, const dtNavMeshQuery& query)
 {
 	if (!dd) return;
@@ -327,7 +423,7 @@ void duDebugDrawNavMeshBVTree(duDebugDraw* dd, const dtNavMesh& mesh)
 	for (int i = 0; i < mesh.getMaxTiles(); ++i)
 	{
 		const dtMeshTile* tile = mesh.getTile(i);
-		if (!tile->header) continue;
+		if (!tile->header || (tile->flags & DT_TILE_RETIRED)) continue;
 		drawMeshTileBVTree(dd, tile);
 	}
 }
@@ -357,8 +453,9 @@ static void drawMeshTilePortal(duDebugDraw* dd, const dtMeshTile* tile)
 					continue;
 				
 				// Create new links
-				const float* va = &tile->verts[poly->verts[j]*3];
-				const float* vb = &tile->verts[poly->verts[(j+1) % nv]*3];
+				float va[3], vb[3];
+				dtGetTileVertex(tile, poly->verts[j], va);
+				dtGetTileVertex(tile, poly->verts[(j+1) % nv], vb);
 				
 				if (side == 0 || side == 4)
 				{
@@ -411,7 +508,7 @@ void duDebugDrawNavMeshPortals(duDebugDraw* dd, const dtNavMesh& mesh)
 	for (int i = 0; i < mesh.getMaxTiles(); ++i)
 	{
 		const dtMeshTile* tile = mesh.getTile(i);
-		if (!tile->header) continue;
+		if (!tile->header || (tile->flags & DT_TILE_RETIRED)) continue;
 		drawMeshTilePortal(dd, tile);
 	}
 }
@@ -424,7 +521,7 @@ void duDebugDrawNavMeshPolysWithFlags(struct duDebugDraw* dd, const dtNavMesh& m
 	for (int i = 0; i < mesh.getMaxTiles(); ++i)
 	{
 		const dtMeshTile* tile = mesh.getTile(i);
-		if (!tile->header) continue;
+		if (!tile->header || (tile->flags & DT_TILE_RETIRED)) continue;
 		dtPolyRef base = mesh.getPolyRefBase(tile);
 
 		for (int j = 0; j < tile->header->polyCount; ++j)
@@ -472,10 +569,9 @@ void duDebugDrawNavMeshPoly(duDebugDraw* dd, const dtNavMesh& mesh, dtPolyRef re
 			const unsigned char* t = &tile->detailTris[(pd->triBase+i)*4];
 			for (int j = 0; j < 3; ++j)
 			{
-				if (t[j] < poly->vertCount)
-					dd->vertex(&tile->verts[poly->verts[t[j]]*3], c);
-				else
-					dd->vertex(&tile->detailVerts[(pd->vertBase+t[j]-poly->vertCount)*3], c);
+				float v[3];
+				dtGetDetailTriVertex(tile, poly, pd, t[j], v);
+				dd->vertex(v, c);
 			}
 		}
 		dd->end();
@@ -609,7 +705,7 @@ void duDebugDrawTileCacheLayerRegions(struct duDebugDraw* dd, const dtTileCacheL
 			const int lidx = x+y*w;
 			const int lh = (int)layer.heights[lidx];
 			if (lh == 0xff) continue;
-			const unsigned char reg = layer.regs[lidx];
+			const unsigned short reg = layer.regs[lidx];
 			
 			unsigned int col = duLerpCol(color, duIntToCol(reg, 255), 192);
 			
@@ -20,6 +20,7 @@
 #define DETOURALLOCATOR_H
 
 #include <stddef.h>
+#include <new>
 
 /// Provides hint values to the memory allocator on how long the
 /// memory is expected to be used.
@@ -58,4 +59,52 @@ void* dtAlloc(size_t size, dtAllocHint hint);
 /// @see dtAlloc
 void dtFree(void* ptr);
 
+/// An allocator object, used to route the memory of a navigation mesh, query or crowd
+/// to its own heap, e.g. to keep a budget per world. The default implementation
+/// forwards to #dtAlloc and #dtFree.
+/// @see dtNavMesh::init, dtNavMeshQuery::init, dtCrowd::init
+struct dtAllocator
+{
+	virtual ~dtAllocator();
+
+	/// Allocates a memory block.
+	///  @param[in]		size	The size, in bytes of memory, to allocate.
+	///  @param[in]		hint	A hint to the allocator on how long the memory is expected to be in use.
+	///  @return A pointer to the beginning of the allocated memory block, or null if the allocation failed.
+	virtual void* alloc(size_t size, dtAllocHint hint)
+	{
+		return dtAlloc(size, hint);
+	}
+
+	/// Deallocates a memory block. If @p ptr is null, this does nothing.
+	///  @param[in]		ptr		A pointer to a memory block previously allocated using #alloc.
+	virtual void free(void* ptr)
+	{
+		dtFree(ptr);
+	}
+};
+
+/// Returns the allocator which forwards to #dtAlloc and #dtFree.
+dtAllocator* dtGetDefaultAllocator();
+
+/// Allocates and default constructs an object with an allocator.
+///  @param[in]		allocator	The allocator.
+///  @return The object, or null if the allocation failed.
+template<class T> T* dtAllocObject(dtAllocator* allocator)
+{
+	void* mem = allocator->alloc(sizeof(T), DT_ALLOC_PERM);
+	return mem ? new(mem) T : 0;
+}
+
+/// Destructs and frees an object allocated with #dtAllocObject. If @p ptr is null, this does nothing.
+///  @param[in]		allocator	The allocator the object was allocated with.
+///  @param[in]		ptr			The object.
+template<class T> void dtFreeObject(dtAllocator* allocator, T* ptr)
+{
+	if (!ptr)
+		return;
+	ptr->~T();
+	allocator->free(ptr);
+}
+
 #endif
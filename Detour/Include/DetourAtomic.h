@@ -0,0 +1,99 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURATOMIC_H
+#define DETOURATOMIC_H
+
+// The loads and stores used to publish data to concurrent readers.
+//
+// Loads have acquire and stores release semantics, so that everything written
+// before a store is visible to a reader that loads the stored value. GCC and
+// Clang use their __atomic builtins, MSVC its interlocked functions, which are
+// full barriers. Other compilers fall back to volatile accesses, with which the
+// data is only safe to read on the publishing thread.
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(_MSC_VER)
+inline unsigned int dtAtomicLoad(const unsigned int* p)
+{
+	return (unsigned int)_InterlockedCompareExchange((volatile long*)p, 0, 0);
+}
+inline void dtAtomicStore(unsigned int* p, const unsigned int v)
+{
+	_InterlockedExchange((volatile long*)p, (long)v);
+}
+template<class T> inline T* dtAtomicLoad(T* const* p)
+{
+	return (T*)_InterlockedCompareExchangePointer((void* volatile*)p, 0, 0);
+}
+template<class T> inline void dtAtomicStore(T** p, T* v)
+{
+	_InterlockedExchangePointer((void* volatile*)p, (void*)v);
+}
+inline void dtAtomicFence()
+{
+	long dummy = 0;
+	_InterlockedExchange(&dummy, 1);
+}
+#elif defined(__GNUC__) || defined(__clang__)
+inline unsigned int dtAtomicLoad(const unsigned int* p)
+{
+	return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+inline void dtAtomicStore(unsigned int* p, const unsigned int v)
+{
+	__atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+template<class T> inline T* dtAtomicLoad(T* const* p)
+{
+	return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+template<class T> inline void dtAtomicStore(T** p, T* v)
+{
+	__atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+inline void dtAtomicFence()
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+#else
+inline unsigned int dtAtomicLoad(const unsigned int* p)
+{
+	return *(const volatile unsigned int*)p;
+}
+inline void dtAtomicStore(unsigned int* p, const unsigned int v)
+{
+	*(volatile unsigned int*)p = v;
+}
+template<class T> inline T* dtAtomicLoad(T* const* p)
+{
+	return *(T* const volatile*)p;
+}
+template<class T> inline void dtAtomicStore(T** p, T* v)
+{
+	*(T* volatile*)p = v;
+}
+inline void dtAtomicFence()
+{
+}
+#endif
+
+#endif // DETOURATOMIC_H
@@ -432,6 +432,20 @@ void dtCalcPolyCenter(float* tc, const unsigned short* idx, int nidx, const floa
 bool dtOverlapPolyPoly2D(const float* polya, const int npolya,
 						 const float* polyb, const int npolyb);
 
+/// Enables or disables the SIMD versions of #dtIntersectSegmentPoly2D, #dtPointInPolygon
+/// and #dtDistancePtPolyEdgesSqr.
+///
+/// They are used by default for polygons of up to 8 vertices when Detour is compiled for
+/// SSE2 or AArch64, unless DT_NO_SIMD is defined. They return the same results as the scalar
+/// versions, provided the compiler does not contract multiplies and adds into fused operations.
+///  @param[in]		enabled		True to use the SIMD versions.
+/// @return False if the SIMD versions are not available.
+bool dtSetSimdGeometry(bool enabled);
+
+/// Returns true if the SIMD versions of the polygon tests are used.
+/// @see dtSetSimdGeometry
+bool dtGetSimdGeometry();
+
 /// @}
 /// @name Miscellanious functions.
 /// @{
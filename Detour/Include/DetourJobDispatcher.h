@@ -0,0 +1,60 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURJOBDISPATCHER_H
+#define DETOURJOBDISPATCHER_H
+
+/// A function executed once per job index by a #dtJobDispatcher.
+///  @param[in]		userData	The user data passed to dtJobDispatcher::dispatch.
+///  @param[in]		jobIndex	The index of the job to execute. [Limits: 0 <= value < jobCount]
+///  @param[in]		workerIndex	The index of the worker executing the job. [Limits: 0 <= value < dtJobDispatcher::getWorkerCount()]
+typedef void (*dtJobFunc)(void* userData, const int jobIndex, const int workerIndex);
+
+/// Provides an interface for running the updates of the crowd, the path queue,
+/// the tile cache and the query service concurrently, e.g. on the job system
+/// or thread pool of the host application.
+///
+/// The default implementation runs all jobs serially on the calling thread.
+/// Implementations that run jobs concurrently must ensure that no two jobs
+/// with the same worker index run at the same time, so that per-worker
+/// queries and allocators can be used without locking.
+///
+/// @ingroup detour
+/// @see dtCrowd::setJobDispatcher, dtPathQueue::setJobDispatcher,
+///      dtTileCache::setJobDispatcher, dtQueryService::setJobDispatcher
+class dtJobDispatcher
+{
+public:
+	virtual ~dtJobDispatcher() {}
+
+	/// Returns the number of workers that can run jobs concurrently.
+	/// @return The number of workers. [Limit: >= 1]
+	virtual int getWorkerCount() const { return 1; }
+
+	/// Runs the job function for every job index and returns once all jobs have completed.
+	///  @param[in]		func		The job function.
+	///  @param[in]		userData	The user data passed to each job.
+	///  @param[in]		jobCount	The number of jobs to run.
+	virtual void dispatch(dtJobFunc func, void* userData, const int jobCount)
+	{
+		for (int i = 0; i < jobCount; ++i)
+			func(userData, i, 0);
+	}
+};
+
+#endif // DETOURJOBDISPATCHER_H
@@ -20,6 +20,7 @@
 #define DETOURNAVMESH_H
 
 #include "DetourAlloc.h"
+#include "DetourAtomic.h"
 #include "DetourStatus.h"
 
 // Undefine (or define in a build config) the following line to use 64bit polyref.
@@ -70,7 +71,7 @@ static const int DT_VERTS_PER_POLYGON = 6;
 static const int DT_NAVMESH_MAGIC = 'D'<<24 | 'N'<<16 | 'A'<<8 | 'V';
 
 /// A version number used to detect compatibility of navigation tile data.
-static const int DT_NAVMESH_VERSION = 7;
+static const int DT_NAVMESH_VERSION = 15;
 
 /// A magic number used to detect the compatibility of navigation tile states.
 static const int DT_NAVMESH_STATE_MAGIC = 'D'<<24 | 'N'<<16 | 'M'<<8 | 'S';
@@ -90,6 +91,19 @@ static const unsigned int DT_NULL_LINK = 0xffffffff;
 /// A flag that indicates that an off-mesh connection can be traversed in both directions. (Is bidirectional.)
 static const unsigned int DT_OFFMESH_CON_BIDIR = 1;
 
+/// A flag that indicates that the polygons the end points of an off-mesh connection land on
+/// inside its own tile were resolved when the tile was built.
+/// @see dtOffMeshConnection::startPoly, dtOffMeshConnection::endPoly
+static const unsigned int DT_OFFMESH_CON_RESOLVED = 2;
+
+/// A value that indicates that an off-mesh connection end point does not land on a polygon of its tile.
+static const unsigned short DT_OFFMESH_CON_NO_POLY = 0xffff;
+
+/// The number of groups the off-mesh connections of a tile are sorted into, one for each
+/// neighbour tile side and one for the connections ending inside the tile.
+/// @see dtMeshHeader::offMeshSideBase
+static const int DT_OFFMESH_SIDE_GROUPS = 9;
+
 /// The maximum number of user defined area ids.
 /// @ingroup detour
 static const int DT_MAX_AREAS = 64;
@@ -98,8 +112,34 @@ static const int DT_MAX_AREAS = 64;
 /// For an example, see dtNavMesh::addTile().
 enum dtTileFlags
 {
-	/// The navigation mesh owns the tile memory and is responsible for freeing it.
-	DT_TILE_FREE_DATA = 0x01
+	/// The navigation mesh owns the tile memory and is responsible for freeing it,
+	/// using the allocator the navigation mesh was initialized with.
+	DT_TILE_FREE_DATA = 0x01,
+
+	/// The tile has been removed, but its memory is kept alive for concurrent readers.
+	/// Set by the navigation mesh. (See: dtNavMesh::setDeferredTileRelease)
+	DT_TILE_RETIRED = 0x02,
+
+	/// The tile is an instance of tile data shared with other tiles. The instance data
+	/// is owned by the navigation mesh, the shared data by the caller.
+	/// Set by the navigation mesh. (See: dtNavMesh::addTileInstance)
+	DT_TILE_INSTANCE = 0x04,
+
+	/// The tile is not yet connected to its neighbour tiles. When passed to dtNavMesh::addTile,
+	/// the tile is connected later by dtNavMesh::connectPendingTiles.
+	DT_TILE_PENDING_LINKS = 0x08
+};
+
+/// Navigation mesh flags used by dtNavMesh::init().
+enum dtNavMeshFlags
+{
+	/// The tiles are allocated on demand instead of up front, and dtNavMeshParams::maxTiles
+	/// only limits the number of tiles. (See: dtNavMesh::init)
+	DT_NAVMESH_SPARSE_TILES = 0x01,
+
+	/// The portal endpoints of the polygon edge links are cached when the links are created,
+	/// so dtNavMeshQuery::getPortalPoints does not need to recompute them. (See: dtMeshTile::linkPortals)
+	DT_NAVMESH_PORTAL_CACHE = 0x02
 };
 
 /// Vertex flags returned by dtNavMeshQuery::findStraightPath.
@@ -118,10 +158,11 @@ enum dtStraightPathOptions
 };
 
 
-/// Options for dtNavMeshQuery::initSlicedFindPath and updateSlicedFindPath
+/// Options for dtNavMeshQuery::findPath, initSlicedFindPath and updateSlicedFindPath
 enum dtFindPathOptions
 {
-	DT_FINDPATH_ANY_ANGLE	= 0x02		///< use raycasts during pathfind to "shortcut" (raycast still consider costs)
+	DT_FINDPATH_ANY_ANGLE	= 0x02,		///< use raycasts during pathfind to "shortcut" (raycast still consider costs)
+	DT_FINDPATH_BIDIRECTIONAL = 0x04	///< search from both the start and the end polygon (See: dtNavMeshQuery::init)
 };
 
 /// Options for dtNavMeshQuery::raycast
@@ -196,6 +237,28 @@ struct dtPolyDetail
 	unsigned char triCount;			///< The number of triangles in the sub-mesh.
 };
 
+/// A uniform grid of the detail triangles of a polygon, used to speed up height queries.
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtMeshTile
+struct dtDetailGrid
+{
+	float bmin[2];					///< The minimum xz-bounds of the grid. [(x, z)]
+	float invCellSize[2];			///< The inverse size of a grid cell. [(x, z)]
+	unsigned int cellBase;			///< The offset of the cells in the dtMeshTile::detailGridCells array.
+	unsigned char size;				///< The number of cells along each axis. (Zero if the polygon has no grid.)
+};
+
+/// A grid of the distances to the nearest wall, sampled over the bounds of a polygon.
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtMeshTile, dtNavMeshQuery::getWallDistance
+struct dtWallDistGrid
+{
+	float bmin[2];					///< The position of the first sample. [(x, z)]
+	float invSpacing[2];			///< The inverse distance between the samples. [(x, z)]
+	unsigned int sampleBase;		///< The offset of the samples in the dtMeshTile::wallDistSamples array.
+	unsigned char size[2];			///< The number of samples along each axis. [(x, z)] (Zero if the polygon has no grid.)
+};
+
 /// Defines a link between polygons.
 /// @note This structure is rarely if ever used by the end user.
 /// @see dtMeshTile
@@ -219,6 +282,40 @@ struct dtBVNode
 	int i;							///< The node's index. (Negative for escape sequence.)
 };
 
+/// The number of children of a wide bounding volume node.
+static const int DT_BVWIDE_WIDTH = 4;
+
+/// Wide bounding volume node.
+/// Stores the bounds of up to #DT_BVWIDE_WIDTH children in SoA form, so that a query
+/// box can be tested against all of them at once.
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtMeshTile
+struct dtBVWideNode
+{
+	unsigned short bmin[3][DT_BVWIDE_WIDTH];	///< Minimum bounds of the children's AABBs. [(x, y, z) * width]
+	unsigned short bmax[3][DT_BVWIDE_WIDTH];	///< Maximum bounds of the children's AABBs. [(x, y, z) * width]
+
+	/// The children. The index of the child node if >= 0, otherwise a leaf
+	/// referencing the polygon at index (-child - 1).
+	int child[DT_BVWIDE_WIDTH];
+
+	int childCount;								///< The number of children in use.
+};
+
+/// A polygon edge on the border of a tile which links to a neighbour tile.
+/// The portal edges of a tile are sorted by side, and then by #bmin, so that the
+/// edges overlapping an edge of a neighbour tile can be found with a binary search.
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtMeshTile
+struct dtPortalEdge
+{
+	float bmin;				///< The minimum coordinate of the edge along the side.
+	float bmax;				///< The maximum of the coordinates of the edges up to and including this one along the side.
+	unsigned short poly;	///< The index of the polygon of the edge.
+	unsigned char edge;		///< The index of the edge in the polygon.
+	unsigned char side;		///< The side of the tile the edge is on.
+};
+
 /// Defines an navigation mesh off-mesh connection within a dtMeshTile object.
 /// An off-mesh connection is a user defined traversable connection made up to two vertices.
 struct dtOffMeshConnection
@@ -242,6 +339,14 @@ struct dtOffMeshConnection
 
 	/// The id of the offmesh connection. (User assigned when the navigation mesh is built.)
 	unsigned int userId;
+
+	/// The index of the polygon the start point lands on, or #DT_OFFMESH_CON_NO_POLY.
+	/// (Only valid if #DT_OFFMESH_CON_RESOLVED is set in #flags.)
+	unsigned short startPoly;
+
+	/// The index of the polygon the end point lands on if the end point is inside the tile,
+	/// or #DT_OFFMESH_CON_NO_POLY. (Only valid if #DT_OFFMESH_CON_RESOLVED is set in #flags.)
+	unsigned short endPoly;
 };
 
 /// Provides high level information related to a dtMeshTile object.
@@ -256,7 +361,7 @@ struct dtMeshHeader
 	unsigned int userId;	///< The user defined id of the tile.
 	int polyCount;			///< The number of polygons in the tile.
 	int vertCount;			///< The number of vertices in the tile.
-	int maxLinkCount;		///< The number of allocated links.
+	int maxLinkCount;		///< The number of links allocated in the tile data.
 	int detailMeshCount;	///< The number of sub-meshes in the detail mesh.
 	
 	/// The number of unique vertices in the detail mesh. (In addition to the polygon vertices.)
@@ -274,6 +379,47 @@ struct dtMeshHeader
 	
 	/// The bounding volume quantization factor. 
 	float bvQuantFactor;
+
+	/// The number of wide bounding volume nodes. (Zero if the wide bounding volumes are disabled.)
+	int bvWideNodeCount;
+
+	/// The number of vertices stored quantized in dtMeshTile::quantVerts. The rest of the
+	/// vertices are stored in dtMeshTile::verts. (Zero if the vertices are not quantized.)
+	int quantVertCount;
+
+	float quantCellSize;		///< The xz-plane cell size of the quantized vertices.
+	float quantCellHeight;		///< The y-axis cell height of the quantized vertices.
+
+	/// The number of detail vertices stored quantized in dtMeshTile::quantDetailVerts. The rest of the
+	/// detail vertices are stored in dtMeshTile::detailVerts. (Zero if the detail vertices are not quantized.)
+	int quantDetailVertCount;
+
+	float quantDetailBmin[3];	///< The minimum bounds of the quantized detail vertices. [(x, y, z)]
+	float quantDetailScale[3];	///< The size of a quantization step of the detail vertices. [(x, y, z)]
+
+	int detailGridCount;		///< The number of detail grids. (Zero if the detail grids are disabled.)
+	int detailGridCellCount;	///< The number of detail grid cell offsets.
+	int detailGridTriCount;		///< The number of triangle indices in the detail grid cells.
+
+	/// The index of the first off-mesh connection ending at each neighbour side, followed by the index
+	/// of the first connection ending inside the tile. The connections are sorted by end point side.
+	/// [Size: #DT_OFFMESH_SIDE_GROUPS]
+	int offMeshSideBase[DT_OFFMESH_SIDE_GROUPS];
+
+	int portalEdgeCount;		///< The number of portal edges.
+
+	/// The index of the first portal edge on each side of the tile. [Size: 8]
+	int portalSideBase[8];
+
+	/// The number of polygon edge clearances. (Zero if the tile was built without them.)
+	int edgeClearanceCount;
+
+	/// The width of a step of the polygon edge clearances. [Unit: wu]
+	float edgeClearanceScale;
+
+	int wallDistGridCount;		///< The number of wall distance grids. (Zero if the tile was built without them.)
+	int wallDistSampleCount;	///< The number of wall distance samples.
+	float wallDistScale;		///< The length of a step of the wall distance samples. [Unit: wu]
 };
 
 /// Defines a navigation mesh tile.
@@ -285,11 +431,14 @@ struct dtMeshTile
 	unsigned int linksFreeList;			///< Index to the next free link.
 	dtMeshHeader* header;				///< The tile header.
 	dtPoly* polys;						///< The tile polygons. [Size: dtMeshHeader::polyCount]
-	float* verts;						///< The tile vertices. [(x, y, z) * dtMeshHeader::vertCount]
-	dtLink* links;						///< The tile links. [Size: dtMeshHeader::maxLinkCount]
+	/// The tile vertices after the quantized vertices. Use #dtGetTileVertex to access the vertices of a tile.
+	/// [(x, y, z) * (dtMeshHeader::vertCount - dtMeshHeader::quantVertCount)]
+	float* verts;
+	dtLink* links;						///< The tile links. [Size: #linkCapacity]
 	dtPolyDetail* detailMeshes;			///< The tile's detail sub-meshes. [Size: dtMeshHeader::detailMeshCount]
 	
-	/// The detail mesh's unique vertices. [(x, y, z) * dtMeshHeader::detailVertCount]
+	/// The detail mesh's unique vertices after the quantized detail vertices. Use #dtGetDetailVertex
+	/// to access the detail vertices of a tile. [(x, y, z) * (dtMeshHeader::detailVertCount - dtMeshHeader::quantDetailVertCount)]
 	float* detailVerts;	
 
 	/// The detail mesh's triangles. [(vertA, vertB, vertC, triFlags) * dtMeshHeader::detailTriCount].
@@ -301,11 +450,74 @@ struct dtMeshTile
 	dtBVNode* bvTree;
 
 	dtOffMeshConnection* offMeshCons;		///< The tile off-mesh connections. [Size: dtMeshHeader::offMeshConCount]
+
+	/// The tile wide bounding volume nodes. [Size: dtMeshHeader::bvWideNodeCount]
+	/// (Will be null if wide bounding volumes are disabled.)
+	dtBVWideNode* bvWideTree;
+
+	/// The quantized tile vertices, in cells relative to dtMeshHeader::bmin.
+	/// (Will be null if the vertices are not quantized.) [(x, y, z) * dtMeshHeader::quantVertCount]
+	unsigned short* quantVerts;
+
+	/// The quantized detail mesh vertices, in steps relative to dtMeshHeader::quantDetailBmin.
+	/// (Will be null if the detail vertices are not quantized.) [(x, y, z) * dtMeshHeader::quantDetailVertCount]
+	unsigned short* quantDetailVerts;
+
+	/// The detail triangle grids of the polygons. [Size: dtMeshHeader::detailGridCount]
+	/// (Will be null if the detail grids are disabled.)
+	dtDetailGrid* detailGrids;
+
+	/// The offsets of the grid cells in #detailGridTris. A grid of size n has n*n+1 offsets,
+	/// the last one being the end of the last cell. [Size: dtMeshHeader::detailGridCellCount]
+	unsigned int* detailGridCells;
+
+	/// The indices of the detail triangles overlapping each grid cell, relative to
+	/// dtPolyDetail::triBase. [Size: dtMeshHeader::detailGridTriCount]
+	unsigned char* detailGridTris;
+
+	/// The polygon edges linking to the neighbour tiles, sorted by side. [Size: dtMeshHeader::portalEdgeCount]
+	dtPortalEdge* portalEdges;
+
+	/// The clearance of each polygon edge beyond dtMeshHeader::walkableRadius, in steps of
+	/// dtMeshHeader::edgeClearanceScale. A value of 0xff does not limit the clearance.
+	/// Use #dtPassEdgeClearance to test the edges. (Will be null if the tile was built
+	/// without clearances.) [Size: dtMeshHeader::polyCount * #DT_VERTS_PER_POLYGON]
+	unsigned char* edgeClearance;
+
+	/// The wall distance grids of the ground polygons. [Size: dtMeshHeader::wallDistGridCount]
+	/// (Will be null if the tile was built without wall distances.)
+	dtWallDistGrid* wallDistGrids;
+
+	/// The distances to the nearest wall at the grid samples, in steps of dtMeshHeader::wallDistScale,
+	/// stored row by row along x. [Size: dtMeshHeader::wallDistSampleCount]
+	unsigned char* wallDistSamples;
 		
 	unsigned char* data;					///< The tile data. (Not directly accessed under normal situations.)
 	int dataSize;							///< Size of the tile data.
 	int flags;								///< Tile flags. (See: #dtTileFlags)
+
+	/// The tile data shared by an instanced tile, or null. The #data of an instance only holds
+	/// the header, the polygons, the links and the sections which are in world space.
+	/// (See: dtNavMesh::addTileInstance)
+	const unsigned char* sharedData;
+
 	dtMeshTile* next;						///< The next free tile, or the next tile in the spatial grid.
+
+	/// The portal endpoints of the polygon edge links, or null if not cached. (See: #DT_NAVMESH_PORTAL_CACHE)
+	/// [(leftX, leftY, leftZ, rightX, rightY, rightZ) * #linkCapacity]
+	float* linkPortals;
+
+	/// The number of links the tile can hold. Starts at dtMeshHeader::maxLinkCount, and grows
+	/// if the tile is connected to more neighbours than the tile data has room for.
+	int linkCapacity;
+
+	int linkCount;							///< The number of links in use.
+
+	unsigned int index;						///< The index of the tile in the navigation mesh.
+
+	/// The navigation mesh generation at which the tile was last added, removed or had
+	/// its polygon flags or areas changed. (See: dtNavMesh::getGeneration)
+	unsigned int generation;
 private:
 	dtMeshTile(const dtMeshTile&);
 	dtMeshTile& operator=(const dtMeshTile&);
@@ -320,6 +532,118 @@ inline int dtGetDetailTriEdgeFlags(unsigned char triFlags, int edgeIndex)
 	return (triFlags >> (edgeIndex * 2)) & 0x3;
 }
 
+/// Gets the position of a tile vertex, dequantizing it if needed.
+///  @param[in]		tile	The tile.
+///  @param[in]		i		The index of the vertex. [Limit: 0 <= index < dtMeshHeader::vertCount]
+///  @param[out]	pos		The position of the vertex. [(x, y, z)]
+inline void dtGetTileVertex(const dtMeshTile* tile, const int i, float* pos)
+{
+	const dtMeshHeader* header = tile->header;
+	if (i < header->quantVertCount)
+	{
+		const unsigned short* q = &tile->quantVerts[i*3];
+		pos[0] = header->bmin[0] + q[0] * header->quantCellSize;
+		pos[1] = header->bmin[1] + q[1] * header->quantCellHeight;
+		pos[2] = header->bmin[2] + q[2] * header->quantCellSize;
+	}
+	else
+	{
+		const float* v = &tile->verts[(i - header->quantVertCount)*3];
+		pos[0] = v[0];
+		pos[1] = v[1];
+		pos[2] = v[2];
+	}
+}
+
+/// Gets the position of a unique detail mesh vertex, dequantizing it if needed.
+///  @param[in]		tile	The tile.
+///  @param[in]		i		The index of the detail vertex. [Limit: 0 <= index < dtMeshHeader::detailVertCount]
+///  @param[out]	pos		The position of the vertex. [(x, y, z)]
+inline void dtGetDetailVertex(const dtMeshTile* tile, const int i, float* pos)
+{
+	const dtMeshHeader* header = tile->header;
+	if (i < header->quantDetailVertCount)
+	{
+		const unsigned short* q = &tile->quantDetailVerts[i*3];
+		pos[0] = header->quantDetailBmin[0] + q[0] * header->quantDetailScale[0];
+		pos[1] = header->quantDetailBmin[1] + q[1] * header->quantDetailScale[1];
+		pos[2] = header->quantDetailBmin[2] + q[2] * header->quantDetailScale[2];
+	}
+	else
+	{
+		const float* v = &tile->detailVerts[(i - header->quantDetailVertCount)*3];
+		pos[0] = v[0];
+		pos[1] = v[1];
+		pos[2] = v[2];
+	}
+}
+
+/// Gets the position of a vertex of a detail triangle.
+///  @param[in]		tile	The tile containing the polygon.
+///  @param[in]		poly	The polygon the detail triangle belongs to.
+///  @param[in]		pd		The detail sub-mesh of the polygon.
+///  @param[in]		index	The vertex index stored in the detail triangle.
+///  @param[out]	pos		The position of the vertex. [(x, y, z)]
+inline void dtGetDetailTriVertex(const dtMeshTile* tile, const dtPoly* poly, const dtPolyDetail* pd,
+								 const unsigned char index, float* pos)
+{
+	if (index < poly->vertCount)
+		dtGetTileVertex(tile, poly->verts[index], pos);
+	else
+		dtGetDetailVertex(tile, (int)(pd->vertBase + (index - poly->vertCount)), pos);
+}
+
+/// Returns true if an agent of the radius can cross the polygon edge.
+/// Edges of tiles built without clearances, and the links of off-mesh connections, can always be crossed.
+///  @param[in]		tile	The tile containing the polygon.
+///  @param[in]		poly	The polygon.
+///  @param[in]		edge	The index of the edge in the polygon. (See: dtLink::edge)
+///  @param[in]		radius	The radius of the agent. [Unit: wu]
+inline bool dtPassEdgeClearance(const dtMeshTile* tile, const dtPoly* poly, const int edge, const float radius)
+{
+	const dtMeshHeader* header = tile->header;
+	if (!tile->edgeClearance || edge >= DT_VERTS_PER_POLYGON || radius <= header->walkableRadius)
+		return true;
+	const unsigned char c = tile->edgeClearance[(int)(poly - tile->polys)*DT_VERTS_PER_POLYGON + edge];
+	return c == 0xff || radius <= header->walkableRadius + c*header->edgeClearanceScale;
+}
+
+/// The link usage of a navigation mesh.
+/// @see dtNavMesh::getLinkStats
+struct dtNavMeshLinkStats
+{
+	int linkCount;			///< The number of links in use.
+	int linkCapacity;		///< The number of links the tiles can hold.
+	int builtLinkCapacity;	///< The number of links allocated in the tile data. (dtMeshHeader::maxLinkCount)
+	int overflowTileCount;	///< The number of tiles whose links have outgrown the tile data.
+	int overflowCount;		///< The number of times the links of a tile had to grow. (Since init.)
+	int lostLinkCount;		///< The number of links which could not be allocated. (Since init.)
+};
+
+/// The memory used by a navigation mesh, broken down by category. [Units: bytes]
+/// The tile data is counted whether or not it is owned by the navigation mesh. Of an instanced
+/// tile only the instance data is counted, not the shared data. (See: dtNavMesh::addTileInstance)
+/// @see dtNavMesh::getMemStats, dtNavMesh::getTileMemStats
+struct dtNavMeshMemStats
+{
+	int tileCount;			///< The number of tiles counted.
+	size_t tiles;			///< The navigation mesh object, the tile array, the tile lookup and the retired items.
+	size_t headers;			///< The tile headers.
+	size_t polys;			///< The polygons.
+	size_t verts;			///< The polygon vertices, including the quantized vertices.
+	size_t links;			///< The links in the tile data and the links grown by the navigation mesh.
+	size_t unusedLinks;		///< The part of #links which is not in use, e.g. because of an over-provisioned dtMeshHeader::maxLinkCount.
+	size_t linkPortals;		///< The cached portal endpoints of the links. (See: #DT_NAVMESH_PORTAL_CACHE)
+	size_t detail;			///< The detail meshes, vertices and triangles, including the quantized vertices and the triangle grids.
+	size_t bvTree;			///< The bounding volume trees, including the wide trees.
+	size_t offMeshCons;		///< The off-mesh connections.
+	size_t portalEdges;		///< The portal edges.
+	size_t edgeClearance;	///< The polygon edge clearances.
+	size_t wallDistance;	///< The wall distance grids and samples.
+	size_t other;			///< The tile data not covered by the other categories, e.g. the unused end of a tile buffer.
+	size_t total;			///< The sum of all categories, except #unusedLinks which is part of #links.
+};
+
 /// Configuration parameters used to define multi-tile navigation meshes.
 /// The values are used to allocate space during the initialization of a navigation mesh.
 /// @see dtNavMesh::init()
@@ -329,10 +653,53 @@ struct dtNavMeshParams
 	float orig[3];					///< The world space origin of the navigation mesh's tile space. [(x, y, z)]
 	float tileWidth;				///< The width of each tile. (Along the x-axis.)
 	float tileHeight;				///< The height of each tile. (Along the z-axis.)
-	int maxTiles;					///< The maximum number of tiles the navigation mesh can contain. This and maxPolys are used to calculate how many bits are needed to identify tiles and polygons uniquely.
+	int maxTiles;					///< The maximum number of tiles the navigation mesh can contain. This and maxPolys are used to calculate how many bits are needed to identify tiles and polygons uniquely. (Zero for the most tiles the references can address when using #DT_NAVMESH_SPARSE_TILES.)
 	int maxPolys;					///< The maximum number of polygons each tile can contain. This and maxTiles are used to calculate how many bits are needed to identify tiles and polygons uniquely.
 };
 
+/// The kinds of navigation mesh changes. (See: dtNavMeshChange)
+enum dtNavMeshChangeType
+{
+	DT_CHANGE_TILE_ADDED = 0,		///< A tile was added.
+	DT_CHANGE_TILE_REMOVED,			///< A tile was removed. Its references are no longer valid.
+	DT_CHANGE_POLY_FLAGS,			///< The flags of a polygon changed.
+	DT_CHANGE_POLY_AREA,			///< The area of a polygon changed.
+	DT_CHANGE_TILE_STATE,			///< The polygon flags and areas of a tile were restored.
+	DT_CHANGE_TILE_LINKED			///< A tile added with #DT_TILE_PENDING_LINKS was connected to its neighbours.
+};
+
+/// Describes a change of a navigation mesh tile.
+/// @see dtNavMeshChangeListener
+struct dtNavMeshChange
+{
+	int type;						///< The kind of change. (See: #dtNavMeshChangeType)
+	dtTileRef tileRef;				///< The reference of the tile. (The old reference if the tile was removed.)
+	dtPolyRef polyRef;				///< The reference of the changed polygon, or zero if the whole tile changed.
+	int tileX;						///< The x-location of the tile.
+	int tileY;						///< The y-location of the tile.
+	int tileLayer;					///< The layer of the tile.
+	unsigned int generation;		///< The generation of the tile after the change. (See: dtNavMesh::getGeneration)
+};
+
+class dtNavMesh;
+
+/// Receives the changes of a navigation mesh, so that caches of the navigation mesh
+/// data can be invalidated without rescanning the tiles.
+/// @see dtNavMesh::setChangeListener
+struct dtNavMeshChangeListener
+{
+	virtual ~dtNavMeshChangeListener();
+
+	/// Called after each change of the navigation mesh, once the change is complete.
+	/// The listener must not change the navigation mesh.
+	///  @param[in]	nav		The navigation mesh that changed.
+	///  @param[in]	change	The change.
+	virtual void navMeshChanged(const dtNavMesh* nav, const dtNavMeshChange& change) = 0;
+};
+
+struct dtRetiredItem;
+struct dtTileSlot;
+
 /// A navigation mesh based on tiles of convex polygons.
 /// @ingroup detour
 class dtNavMesh
@@ -346,20 +713,39 @@ public:
 
 	/// Initializes the navigation mesh for tiled use.
 	///  @param[in]	params		Initialization parameters.
+	///  @param[in]	flags		The navigation mesh flags. (See: #dtNavMeshFlags) [Default: 0]
+	///  @param[in]	allocator	The allocator of the navigation mesh memory. Must outlive the navigation mesh. [opt]
 	/// @return The status flags for the operation.
-	dtStatus init(const dtNavMeshParams* params);
+	dtStatus init(const dtNavMeshParams* params, const int flags = 0, dtAllocator* allocator = 0);
 
 	/// Initializes the navigation mesh for single tile use.
 	///  @param[in]	data		Data of the new tile. (See: #dtCreateNavMeshData)
 	///  @param[in]	dataSize	The data size of the new tile.
 	///  @param[in]	flags		The tile flags. (See: #dtTileFlags)
+	///  @param[in]	allocator	The allocator of the navigation mesh memory. Must outlive the navigation mesh. [opt]
 	/// @return The status flags for the operation.
 	///  @see dtCreateNavMeshData
-	dtStatus init(unsigned char* data, const int dataSize, const int flags);
+	dtStatus init(unsigned char* data, const int dataSize, const int flags, dtAllocator* allocator = 0);
+
+	/// The allocator of the navigation mesh memory.
+	dtAllocator* getAllocator() const { return m_allocator; }
 	
 	/// The navigation mesh initialization params.
 	const dtNavMeshParams* getParams() const;
 
+	/// The navigation mesh flags.
+	/// @return The flags the navigation mesh was initialized with. (See: #dtNavMeshFlags)
+	int getFlags() const { return m_flags; }
+
+	/// Adds a dense lookup of the tiles within a rectangle of tile locations.
+	///  @param[in]	minX		The x-location of the first column of the grid.
+	///  @param[in]	minY		The y-location of the first row of the grid.
+	///  @param[in]	width		The number of columns of the grid, or zero to remove the grid. [Limit: >= 0]
+	///  @param[in]	height		The number of rows of the grid, or zero to remove the grid. [Limit: >= 0]
+	///  @param[in]	maxLayers	The number of layers of each grid cell. [Limit: > 0 if the grid is not empty]
+	/// @return The status flags for the operation.
+	dtStatus setTileGrid(int minX, int minY, int width, int height, int maxLayers);
+
 	/// Adds a tile to the navigation mesh.
 	///  @param[in]		data		Data for the new tile mesh. (See: #dtCreateNavMeshData)
 	///  @param[in]		dataSize	Data size of the new tile mesh.
@@ -368,6 +754,17 @@ public:
 	///  @param[out]	result		The tile reference. (If the tile was succesfully added.) [opt]
 	/// @return The status flags for the operation.
 	dtStatus addTile(unsigned char* data, int dataSize, int flags, dtTileRef lastRef, dtTileRef* result);
+
+	/// Adds an instance of shared tile data to the navigation mesh, translated by an offset.
+	///  @param[in]		data		The shared data of the tile mesh. (See: #dtCreateNavMeshData)
+	///  @param[in]		dataSize	Data size of the shared tile mesh.
+	///  @param[in]		offset		The translation of the instance. The xz-offset must be a whole
+	///  							number of tiles. [(x, y, z)]
+	///  @param[in]		lastRef		The desired reference for the tile. (When reloading a tile.) [opt] [Default: 0]
+	///  @param[out]	result		The tile reference. (If the tile was succesfully added.) [opt]
+	/// @return The status flags for the operation.
+	dtStatus addTileInstance(const unsigned char* data, int dataSize, const float* offset,
+							 dtTileRef lastRef, dtTileRef* result);
 	
 	/// Removes the specified tile from the navigation mesh.
 	///  @param[in]		ref			The reference of the tile to remove.
@@ -376,6 +773,89 @@ public:
 	/// @return The status flags for the operation.
 	dtStatus removeTile(dtTileRef ref, unsigned char** data, int* dataSize);
 
+	/// Connects tiles added with #DT_TILE_PENDING_LINKS to their neighbour tiles, in the order
+	/// they were added.
+	///  @param[in]		maxTiles		The maximum number of tiles to connect. [Limit: > 0]
+	///  @param[out]	connectedTiles	The number of tiles connected. [opt]
+	/// @return The status flags for the operation. #DT_IN_PROGRESS if tiles are still pending.
+	dtStatus connectPendingTiles(int maxTiles, int* connectedTiles = 0);
+
+	/// The number of tiles waiting to be connected to their neighbours.
+	/// @return The number of pending tiles.
+	int getPendingTileCount() const { return m_pendingTileCount; }
+
+	/// @}
+
+	/// @{
+	/// @name Concurrent Readers
+
+	/// Enables or disables deferred release of removed tiles and links.
+	/// Must not be toggled while tiles are retired.
+	///  @param[in]	defer	True if removed tiles should be retired instead of released.
+	void setDeferredTileRelease(bool defer) { m_deferRelease = defer; }
+
+	/// Returns true if removed tiles are retired instead of released.
+	bool getDeferredTileRelease() const { return m_deferRelease; }
+
+	/// The update epoch of the navigation mesh.
+	/// The epoch is advanced by every successful call to #addTile and #removeTile, and by
+	/// every tile connected by #connectPendingTiles. It is published after the update, so a
+	/// reader that reads the new epoch also finds the update in the tile lookup.
+	/// @return The current update epoch.
+	unsigned int getEpoch() const { return dtAtomicLoad(&m_epoch); }
+
+	/// The change generation of the navigation mesh.
+	/// The generation is advanced by every tile add and remove, and by every change of
+	/// polygon flags or areas. The changed tile records the new generation.
+	/// @return The current generation.
+	unsigned int getGeneration() const { return m_generation; }
+
+	/// Gets the generation at which the tile of the polygon reference was last changed.
+	/// The reference does not need to be valid, only its tile index is used.
+	///  @param[in]	ref		The polygon reference.
+	/// @return The generation of the tile, or zero if the tile index is out of range.
+	unsigned int getTileGeneration(dtPolyRef ref) const;
+
+	/// Sets the listener notified of every tile add and remove, polygon flag and area change,
+	/// and tile state restore. Changes that leave the data as it was are not reported.
+	///  @param[in]	listener	The listener, or null for none. Must outlive its use by the navigation mesh.
+	void setChangeListener(dtNavMeshChangeListener* listener) { m_changeListener = listener; }
+
+	/// The listener notified of the changes of the navigation mesh, or null.
+	dtNavMeshChangeListener* getChangeListener() const { return m_changeListener; }
+
+	/// Releases the tiles and links that were retired no later than the specified epoch.
+	///  @param[in]	oldestReaderEpoch	The oldest epoch still observed by a concurrent reader.
+	/// @return The number of tiles released.
+	int releaseRetiredTiles(unsigned int oldestReaderEpoch);
+
+	/// The number of retired tiles and links waiting to be released.
+	/// @return The number of retired items.
+	int getRetiredCount() const { return m_retiredCount; }
+
+	/// @}
+
+	/// @{
+	/// @name Link Usage
+
+	/// Gets the link usage of all the tiles in the navigation mesh.
+	///  @param[out]	stats	The link usage.
+	void getLinkStats(dtNavMeshLinkStats* stats) const;
+
+	/// @}
+
+	/// @{
+	/// @name Memory Usage
+
+	/// Gets the memory used by the navigation mesh and all its tiles.
+	///  @param[out]	stats	The memory usage.
+	void getMemStats(dtNavMeshMemStats* stats) const;
+
+	/// Gets the memory used by a tile of the navigation mesh. #dtNavMeshMemStats::tiles is not counted.
+	///  @param[in]		tile	The tile.
+	///  @param[out]	stats	The memory usage of the tile.
+	void getTileMemStats(const dtMeshTile* tile, dtNavMeshMemStats* stats) const;
+
 	/// @}
 
 	/// @{
@@ -422,6 +902,7 @@ public:
 	const dtMeshTile* getTileByRef(dtTileRef ref) const;
 	
 	/// The maximum number of tiles supported by the navigation mesh.
+	/// With #DT_NAVMESH_SPARSE_TILES this is the number of tiles allocated so far, which grows as tiles are added.
 	/// @return The maximum number of tiles supported by the navigation mesh.
 	int getMaxTiles() const;
 	
@@ -629,6 +1110,10 @@ private:
 							const dtMeshTile* tile, int side,
 							dtPolyRef* con, float* conarea, int maxcon) const;
 	
+	/// Adds a tile whose header is at the start of @p data, see #addTile and #addTileInstance.
+	dtStatus addTileData(unsigned char* data, int dataSize, int flags, const unsigned char* sharedData,
+						 const float* offset, dtTileRef lastRef, dtTileRef* result);
+
 	/// Builds internal polygons links for a tile.
 	void connectIntLinks(dtMeshTile* tile);
 	/// Builds internal polygons links for a tile.
@@ -641,6 +1126,38 @@ private:
 	
 	/// Removes external links at specified side.
 	void unconnectLinks(dtMeshTile* tile, dtMeshTile* target);
+
+	/// Adds an item to the list of retired tiles, links and link memory.
+	bool retire(const dtMeshTile* tile, unsigned int link, void* memory);
+
+	/// Allocates a link in the tile, growing the tile links if they have run out.
+	unsigned int allocLink(dtMeshTile* tile);
+	/// Moves the tile links to a larger array owned by the navigation mesh.
+	bool growLinks(dtMeshTile* tile);
+	/// Resets the tile and returns it to the free list.
+	void releaseTile(dtMeshTile* tile);
+	/// Notifies the change listener, if any, of a change of the tile.
+	void notifyChange(int type, dtTileRef tileRef, dtPolyRef polyRef, const dtMeshHeader* header, unsigned int generation) const;
+
+	/// Returns the tile at the specified index. The index must be less than #m_maxTiles.
+	inline dtMeshTile* getTileByIndex(unsigned int i) const
+	{
+		return m_tilePages[i >> m_tilePageBits] + (i & m_tilePageMask);
+	}
+	/// Allocates another page of tiles and adds them to the free list. (Sparse tiles only.)
+	bool allocTilePage();
+	/// Adds the tile to the position lookup.
+	void insertTileLookup(dtMeshTile* tile);
+	/// Removes the tile from the position lookup.
+	void removeTileLookup(dtMeshTile* tile);
+	/// Grows the open addressing position lookup to the specified size. (Sparse tiles only.)
+	bool resizeTileSlots(int size);
+	/// Returns the tile grid slot of the tile location, or -1 if it is not in the tile grid.
+	int getTileGridSlot(const int x, const int y, const int layer) const;
+	/// Connects the tile to the neighbour tiles which are not pending.
+	void connectNeighbourTiles(dtMeshTile* tile);
+	/// Makes room for one more pending tile.
+	bool reservePendingTile();
 	
 
 	// TODO: These methods are duplicates from dtNavMeshQuery, but are needed for off-mesh connection finding.
@@ -656,16 +1173,44 @@ private:
 	/// Returns closest point on polygon.
 	void closestPointOnPoly(dtPolyRef ref, const float* pos, float* closest, bool* posOverPoly) const;
 	
+	dtAllocator* m_allocator;			///< The allocator of the navigation mesh memory.
 	dtNavMeshParams m_params;			///< Current initialization params. TODO: do not store this info twice.
 	float m_orig[3];					///< Origin of the tile (0,0)
 	float m_tileWidth, m_tileHeight;	///< Dimensions of each tile.
-	int m_maxTiles;						///< Max number of tiles.
+	int m_flags;						///< Navigation mesh flags. (See: #dtNavMeshFlags)
+	int m_maxTiles;						///< Number of allocated tiles.
+	int m_tileLimit;					///< Max number of tiles.
 	int m_tileLutSize;					///< Tile hash lookup size (must be pot).
 	int m_tileLutMask;					///< Tile hash lookup mask.
 
-	dtMeshTile** m_posLookup;			///< Tile hash lookup.
+	dtMeshTile** m_posLookup;			///< Tile hash lookup, chained through dtMeshTile::next.
+	dtTileSlot* m_tileSlots;			///< Open addressing tile hash lookup. (Sparse tiles only.)
+	int m_tileSlotCount;				///< Number of used slots in the open addressing lookup.
+	dtMeshTile** m_tileGrid;			///< Dense tile lookup, the layers of each cell next to each other. [Size: width * height * layers]
+	unsigned short* m_tileGridCounts;	///< Number of tiles in each cell of the dense tile lookup.
+	int m_tileGridMinX, m_tileGridMinY;	///< Location of the first cell of the dense tile lookup.
+	int m_tileGridWidth, m_tileGridHeight;	///< Number of columns and rows of the dense tile lookup.
+	int m_tileGridLayers;				///< Number of layers of each cell of the dense tile lookup.
+	int m_tileGridOverflow;				///< Number of tiles outside of the dense tile lookup.
 	dtMeshTile* m_nextFree;				///< Freelist of tiles.
-	dtMeshTile* m_tiles;				///< List of tiles.
+	dtMeshTile** m_tilePages;			///< Pages of tiles. (A single page unless sparse.)
+	int m_tilePageCount;				///< Number of allocated tile pages.
+	int m_tilePageCapacity;				///< Capacity of the tile page array.
+	unsigned int m_tilePageBits;		///< Number of tile index bits addressing a tile within a page.
+	unsigned int m_tilePageMask;		///< Mask of the tile index bits addressing a tile within a page.
+
+	unsigned int m_epoch;				///< Update epoch, advanced by each tile add and remove.
+	unsigned int m_generation;			///< Change generation, advanced by each tile and polygon state change.
+	dtNavMeshChangeListener* m_changeListener;	///< Listener notified of the changes, or null.
+	bool m_deferRelease;				///< True if removed tiles and links are retired until released.
+	dtRetiredItem* m_retired;			///< Retired tiles and links.
+	int m_retiredCount;					///< Number of retired items.
+	int m_retiredCapacity;				///< Capacity of the retired items array.
+	int m_linkOverflowCount;			///< Number of times the links of a tile had to grow.
+	int m_lostLinkCount;				///< Number of links which could not be allocated.
+	dtTileRef* m_pendingTiles;			///< Tiles waiting to be connected to their neighbours, in the order they were added.
+	int m_pendingTileCount;				///< Number of pending tiles.
+	int m_pendingTileCapacity;			///< Capacity of the pending tile array.
 		
 #ifndef DT_POLYREF64
 	unsigned int m_saltBits;			///< Number of salt bits in the tile ID.
@@ -770,6 +1315,12 @@ off-mesh connections.  In this case the associated pointer will be null.
 If a detail mesh exists it will share vertices with the base polygon mesh.  
 Only the vertices unique to the detail mesh will be stored in #detailVerts.
 
+The vertices may be stored quantized, see dtNavMeshCreateParams::quantizeVerts
+and dtNavMeshCreateParams::quantizeDetailVerts. Use #dtGetTileVertex,
+#dtGetDetailVertex and #dtGetDetailTriVertex to read them. Quantized
+vertices are decoded one at a time, so only the polygon being queried is
+ever decoded.
+
 @warning Tiles returned by a dtNavMesh object are not guarenteed to be populated.
 For example: The tile at a location might not have been loaded yet, or may have been removed.
 In this case, pointers will be null.  So if in doubt, check the polygon count in the 
@@ -781,4 +1332,12 @@ tile's header to determine if a tile has polygons defined.
 For a properly built navigation mesh, vertex A will always be within the bounds of the mesh. 
 Vertex B is not required to be within the bounds of the mesh.
 
+@var unsigned short dtOffMeshConnection::startPoly
+@par
+
+dtCreateNavMeshData() resolves the polygons the end points land on within the
+tile, so that adding the tile does not need to search for them. The end point
+of a connection leading to a neighbour tile is still searched for when the
+neighbour is connected.
+
 */
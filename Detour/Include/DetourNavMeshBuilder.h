@@ -21,6 +21,18 @@
 
 #include "DetourAlloc.h"
 
+/// The ways of splitting the polygons of a tile when building its bounding volume trees.
+/// @see dtNavMeshCreateParams::bvTreeSplit
+enum dtBVTreeSplit
+{
+	/// Splits the polygons in half along the longest axis of the node. (Default)
+	DT_BVTREE_SPLIT_MEDIAN = 0,
+
+	/// Splits the polygons where the surface area heuristic estimates the lowest query cost.
+	/// Takes longer to build, and gives tighter nodes on tiles with polygons of uneven size.
+	DT_BVTREE_SPLIT_SAH
+};
+
 /// Represents the source data used to build an navigation mesh tile.
 /// @ingroup detour
 struct dtNavMeshCreateParams
@@ -39,6 +51,10 @@ struct dtNavMeshCreateParams
 	int polyCount;							///< Number of polygons in the mesh. [Limit: >= 1]
 	int nvp;								///< Number maximum number of vertices per polygon. [Limit: >= 3]
 
+	/// The clearance of each polygon edge, in the units of the distance field. [Size: #polyCount * #nvp] [opt]
+	/// (See: #rcPolyMesh::edgeClearance)
+	const unsigned short* polyEdgeClearance;
+
 	/// @}
 	/// @name Height Detail Attributes (Optional)
 	/// See #rcPolyMeshDetail for details related to these attributes.
@@ -101,6 +117,29 @@ struct dtNavMeshCreateParams
 	/// @note The BVTree is not normally needed for layered navigation meshes.
 	bool buildBvTree;
 
+	/// True if a wide bounding volume tree should also be built for the tile.
+	/// The wide tree speeds up polygon queries on dense tiles. Requires #buildBvTree.
+	bool buildWideBvTree;
+
+	/// How the polygons are split when building the bounding volume trees. (See: #dtBVTreeSplit)
+	int bvTreeSplit;
+
+	/// True if the polygon vertices should be stored as cell coordinates instead of floats.
+	/// The vertices are decoded exactly, so the quantized tile behaves the same way.
+	bool quantizeVerts;
+
+	/// True if the detail mesh vertices should be stored as 16-bit steps within their bounds instead of floats.
+	/// A vertex moves by at most half a step, 1/131070th of the extent of the detail vertices on each axis.
+	bool quantizeDetailVerts;
+
+	/// True if a grid of the detail triangles should be built for the polygons with many detail triangles.
+	/// The grids let height queries skip most of the triangles of the polygon.
+	bool buildDetailGrids;
+
+	/// True if the distances to the nearest wall should be sampled over the polygons, so that
+	/// dtNavMeshQuery::getWallDistance can look them up instead of searching for the walls.
+	bool buildWallDistances;
+
 	/// @}
 };
 
@@ -112,6 +151,22 @@ struct dtNavMeshCreateParams
 /// @return True if the tile data was successfully created.
 bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData, int* outDataSize);
 
+/// Calculates the exact size of the tile data dtCreateNavMeshData would create from the parameters.
+/// @ingroup detour
+///  @param[in]		params		Tile creation data.
+///  @param[out]	outDataSize	The size of the tile data.
+/// @return True if the tile data can be created from the parameters.
+bool dtCalcNavMeshDataSize(dtNavMeshCreateParams* params, int* outDataSize);
+
+/// Builds navigation mesh tile data into a buffer owned by the caller.
+/// @ingroup detour
+///  @param[in]		params		Tile creation data.
+///  @param[out]	data		The buffer to write the tile data to. Must be aligned to 4 bytes.
+///  @param[in]		dataSize	The size of the buffer. [Limit: >= the size from dtCalcNavMeshDataSize]
+///  @param[out]	outDataSize	The size of the tile data written to the buffer.
+/// @return True if the tile data was successfully created.
+bool dtWriteNavMeshData(dtNavMeshCreateParams* params, unsigned char* data, const int dataSize, int* outDataSize);
+
 /// Swaps the endianness of the tile data's header (#dtMeshHeader).
 ///  @param[in,out]	data		The tile data array.
 ///  @param[in]		dataSize	The size of the data array.
@@ -143,7 +198,12 @@ The standard navigation mesh build process is to create tile data using dtCreate
 to a navigation mesh using either the dtNavMesh single tile <tt>init()</tt> function or the dtNavMesh::addTile()
 function.
 
-@see dtCreateNavMeshData
+To build the tile data into memory owned by the caller, such as a slot of a preallocated arena or a
+file mapping, get the size of the data with dtCalcNavMeshDataSize and write it with dtWriteNavMeshData.
+Add the tile to the navigation mesh without the #DT_TILE_FREE_DATA flag so that the mesh does not try
+to free the buffer.
+
+@see dtCreateNavMeshData, dtCalcNavMeshDataSize, dtWriteNavMeshData
 
 */
 
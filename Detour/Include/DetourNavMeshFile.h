@@ -0,0 +1,119 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURNAVMESHFILE_H
+#define DETOURNAVMESHFILE_H
+
+#include <stddef.h>
+#include "DetourNavMesh.h"
+#include "DetourStatus.h"
+
+/// A magic number used to detect compatibility of navigation mesh files.
+static const int DT_NAVMESH_FILE_MAGIC = 'D'<<24 | 'N'<<16 | 'M'<<8 | 'F'; ///< 'DNMF'
+
+/// A version number used to detect compatibility of navigation mesh files.
+static const int DT_NAVMESH_FILE_VERSION = 2;
+
+/// The default alignment of the tiles in a navigation mesh file.
+static const int DT_NAVMESH_FILE_PAGE_SIZE = 4096;
+
+/// The header of a navigation mesh file.
+/// @note This structure is rarely if ever used by the end user.
+struct dtNavMeshFileHeader
+{
+	int magic;					///< File magic number. (See: #DT_NAVMESH_FILE_MAGIC)
+	int version;				///< File format version number. (See: #DT_NAVMESH_FILE_VERSION)
+	int pageSize;				///< The alignment of the tile data.
+	int tileCount;				///< The number of tiles in the tile directory.
+	int navMeshFlags;			///< The navigation mesh flags. (See: #dtNavMeshFlags)
+	dtNavMeshParams params;		///< The navigation mesh initialization params.
+};
+
+/// A navigation mesh file tile directory entry.
+/// @note This structure is rarely if ever used by the end user.
+struct dtNavMeshFileTile
+{
+	unsigned int refLow;		///< The low 32 bits of the tile reference.
+	unsigned int refHigh;		///< The high 32 bits of the tile reference. (Zero unless #DT_POLYREF64 is used.)
+	unsigned int page;			///< The index of the page the tile data starts at.
+	int dataSize;				///< The size of the tile data.
+};
+
+/// Builds a navigation mesh file from all tiles of the navigation mesh, except the instanced tiles.
+///  @param[in]		nav				The navigation mesh.
+///  @param[out]	outData			The resulting file data. Free with #dtFree.
+///  @param[out]	outDataSize		The size of the file data.
+///  @param[in]		pageSize		The alignment of the tile data. [Limit: power of two >= 64]
+/// @returns The status flags for the operation.
+///  @see dtInitNavMeshFromFile
+dtStatus dtCreateNavMeshFile(const dtNavMesh* nav, unsigned char** outData, size_t* outDataSize,
+							 const int pageSize = DT_NAVMESH_FILE_PAGE_SIZE);
+
+/// Validates a navigation mesh file and returns its tile directory.
+///  @param[in]		data			The file data.
+///  @param[in]		dataSize		The size of the file data.
+///  @param[out]	header			The file header. [opt]
+///  @param[out]	tiles			The tile directory. [(#dtNavMeshFileTile) * dtNavMeshFileHeader::tileCount] [opt]
+/// @returns The status flags for the operation.
+dtStatus dtGetNavMeshFileTiles(const unsigned char* data, const size_t dataSize,
+							   const dtNavMeshFileHeader** header, const dtNavMeshFileTile** tiles);
+
+/// Returns the reference of a tile in the tile directory.
+inline dtTileRef dtGetNavMeshFileTileRef(const dtNavMeshFileTile& tile)
+{
+#ifdef DT_POLYREF64
+	return ((dtTileRef)tile.refHigh << 32) | (dtTileRef)tile.refLow;
+#else
+	return (dtTileRef)tile.refLow;
+#endif
+}
+
+/// Initializes the navigation mesh from a navigation mesh file, adding the tiles in place.
+/// The tiles are not copied, and keep the references they had when the file was created.
+///  @param[in]		nav				The navigation mesh to initialize.
+///  @param[in]		data			The file data. Must stay valid while the navigation mesh uses the tiles.
+///  @param[in]		dataSize		The size of the file data.
+/// @returns The status flags for the operation.
+dtStatus dtInitNavMeshFromFile(dtNavMesh* nav, unsigned char* data, const size_t dataSize);
+
+#endif // DETOURNAVMESHFILE_H
+
+///////////////////////////////////////////////////////////////////////////
+
+// This section contains detailed documentation for members that don't have
+// a source file. It reduces clutter in the main section of the header.
+
+/**
+
+@fn dtStatus dtCreateNavMeshFile(const dtNavMesh* nav, unsigned char** outData, size_t* outDataSize, const int pageSize)
+@par
+
+A navigation mesh file holds the navigation mesh params and a directory of
+the tiles, followed by the tile data. Each tile starts at a page boundary,
+so the file can be memory mapped and the tiles handed to dtNavMesh::addTile
+without copying them.
+
+dtNavMesh writes the links of the tiles into the tile data, so the file must
+be mapped copy-on-write (e.g. `MAP_PRIVATE` or `PAGE_WRITECOPY`). Only the
+pages holding the links are copied, the rest stay shared with the page cache.
+
+The file uses the native endianness, like the tile data.
+
+@see dtInitNavMeshFromFile, dtGetNavMeshFileTiles
+
+*/
@@ -0,0 +1,179 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURNAVMESHHIERARCHY_H
+#define DETOURNAVMESHHIERARCHY_H
+
+#include "DetourNavMesh.h"
+#include "DetourStatus.h"
+#include "DetourTileRefTracker.h"
+
+class dtNavMeshQuery;
+class dtQueryFilter;
+class dtNodePool;
+class dtNodeQueue;
+
+/// A run of adjacent portal edges on one side of a tile.
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtHierarchyTile
+struct dtHierarchyEntrance
+{
+	float pos[3];				///< The midpoint of the representative portal edge. [(x, y, z)]
+	dtPolyRef ref;				///< The polygon owning the representative portal edge.
+	unsigned short firstPoly;	///< Index of the first polygon of the run in dtHierarchyTile::polys.
+	unsigned short polyCount;	///< The number of polygons in the run.
+	unsigned char side;			///< The side of the tile the portals are on.
+};
+
+/// The abstract graph of a single navigation mesh tile.
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtNavMeshHierarchy
+struct dtHierarchyTile
+{
+	dtTileRef ref;						///< The tile the entrances were built from. (Zero if not built.)
+	dtHierarchyEntrance* entrances;		///< The tile entrances. [Size: entranceCount]
+	int entranceCount;					///< The number of entrances.
+
+	/// The cost of travelling between entrances inside the tile. FLT_MAX if the
+	/// entrances are not connected. [Size: entranceCount * entranceCount]
+	float* costs;
+
+	unsigned short* polys;				///< The polygon indices of the entrance runs.
+	int polyCount;						///< The number of polygon indices.
+};
+
+/// Provides long-distance pathfinding over a coarse graph of tile portals.
+/// @ingroup detour
+class dtNavMeshHierarchy
+{
+public:
+	dtNavMeshHierarchy();
+	~dtNavMeshHierarchy();
+
+	/// Initializes the hierarchy.
+	///  @param[in]		nav			The navigation mesh to build the hierarchy for.
+	///  @param[in]		filter		The filter used for the traversal costs. Must stay valid while the hierarchy is used.
+	///  @param[in]		maxNodes	Maximum number of abstract search nodes. [Limits: 0 < value <= 65535]
+	/// @returns The status flags for the operation.
+	dtStatus init(const dtNavMesh* nav, const dtQueryFilter* filter, const int maxNodes);
+
+	/// Builds the abstract graph of the tiles that were added, removed or replaced
+	/// since the previous update.
+	///  @param[out]	updatedTileCount	The number of tiles that were rebuilt. [opt]
+	/// @returns The status flags for the operation.
+	dtStatus update(int* updatedTileCount = 0);
+
+	/// Finds a path from the start polygon to the end polygon by first searching the
+	/// abstract graph, and then refining the path tile by tile with @p query.
+	///  @param[in]		query		The query used to refine the path.
+	///  @param[in]		startRef	The reference id of the start polygon.
+	///  @param[in]		endRef		The reference id of the end polygon.
+	///  @param[in]		startPos	A position within the start polygon. [(x, y, z)]
+	///  @param[in]		endPos		A position within the end polygon. [(x, y, z)]
+	///  @param[out]	path		An ordered list of polygon references representing the path. (Start to end.)
+	///  							[(polyRef) * @p pathCount]
+	///  @param[out]	pathCount	The number of polygons returned in the @p path array.
+	///  @param[in]		maxPath		The maximum number of polygons the @p path array can hold. [Limit: >= 1]
+	/// @returns The status flags for the query.
+	dtStatus findPath(dtNavMeshQuery* query, dtPolyRef startRef, dtPolyRef endRef,
+					  const float* startPos, const float* endPos,
+					  dtPolyRef* path, int* pathCount, const int maxPath);
+
+	/// Gets the abstract graph of the tile at the specified index.
+	///  @param[in]		i			The tile index. [Limit: 0 >= index < dtNavMesh::getMaxTiles()]
+	/// @returns The abstract graph of the tile.
+	const dtHierarchyTile* getTile(int i) const;
+
+	/// Gets the navigation mesh the hierarchy was built for.
+	/// @returns The navigation mesh the hierarchy was built for.
+	const dtNavMesh* getAttachedNavMesh() const { return m_nav; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtNavMeshHierarchy(const dtNavMeshHierarchy&);
+	dtNavMeshHierarchy& operator=(const dtNavMeshHierarchy&);
+
+	/// Builds the entrances and the costs between them for a tile.
+	bool buildTile(const dtMeshTile* tile, dtHierarchyTile& htile);
+
+	/// Frees the abstract graph of a tile.
+	void freeTile(dtHierarchyTile& htile);
+
+	/// Calculates the cost from a position to each of the entrances of a tile, staying inside the tile.
+	void calcEntranceCosts(const dtMeshTile* tile, const dtHierarchyTile& htile,
+						   dtPolyRef startRef, const float* startPos, float* costs);
+
+	/// Returns the entrance of the tile on the specified side that contains the polygon, or -1.
+	int findEntrance(const dtHierarchyTile& htile, const unsigned int polyIndex, const unsigned char side) const;
+
+	const dtNavMesh* m_nav;				///< The navigation mesh.
+	const dtQueryFilter* m_filter;		///< The filter used for the traversal costs.
+	dtHierarchyTile* m_tiles;			///< The abstract graphs of the tiles. [Size: dtNavMesh::getMaxTiles()]
+	int m_maxTiles;						///< The number of tiles.
+	dtTileRefTracker m_tracker;			///< Finds the tiles changed since the previous update.
+
+	dtNodePool* m_tileNodePool;			///< Node pool for the searches inside a tile.
+	dtNodeQueue* m_tileOpenList;		///< Open list for the searches inside a tile.
+	dtNodePool* m_nodePool;				///< Node pool for the abstract graph search.
+	dtNodeQueue* m_openList;			///< Open list for the abstract graph search.
+	float* m_startCosts;				///< Scratch costs from the start position to the start tile entrances.
+	float* m_endCosts;					///< Scratch costs from the end tile entrances to the end position.
+	int m_maxEntrances;					///< The capacity of the scratch cost arrays.
+};
+
+/// Allocates a navigation mesh hierarchy object using the Detour allocator.
+/// @return A navigation mesh hierarchy that is ready for initialization, or null on failure.
+///  @ingroup detour
+dtNavMeshHierarchy* dtAllocNavMeshHierarchy();
+
+/// Frees the specified navigation mesh hierarchy object using the Detour allocator.
+///  @param[in]		hierarchy		A navigation mesh hierarchy allocated using #dtAllocNavMeshHierarchy
+///  @ingroup detour
+void dtFreeNavMeshHierarchy(dtNavMeshHierarchy* hierarchy);
+
+#endif // DETOURNAVMESHHIERARCHY_H
+
+///////////////////////////////////////////////////////////////////////////
+
+// This section contains detailed documentation for members that don't have
+// a source file. It reduces clutter in the main section of the header.
+
+/**
+
+@class dtNavMeshHierarchy
+
+The hierarchy lets #findPath search paths spanning many tiles with a small
+node pool. Each tile is abstracted into entrances, runs of adjacent portal
+edges on one of its sides. The cost of travelling between the entrances of a
+tile is precomputed, and entrances connect to the entrances of the neighbour
+tiles through the tile links.
+
+A path is found by searching the abstract graph first, and then refining
+it with dtNavMeshQuery::findPath between consecutive entrances. Each of those
+searches only spans one or two tiles. The result is close to, but not always
+exactly, the shortest path. Use a path corridor to smooth it while following it.
+
+The hierarchy is incremental. Call #update after tiles have been added or
+removed, for example after dtTileCache::update. Only the tiles that changed
+are re-costed, since the costs of a tile only depend on the tile itself.
+
+Off-mesh connections between tiles are not part of the abstract graph.
+
+@see dtNavMeshQuery::findPath
+
+*/
@@ -0,0 +1,182 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#ifndef DETOURNAVMESHLANDMARKS_H
+#define DETOURNAVMESHLANDMARKS_H
+
+#include <float.h>
+#include "DetourNavMesh.h"
+#include "DetourStatus.h"
+#include "DetourTileRefTracker.h"
+
+/// The maximum number of landmarks of a #dtNavMeshLandmarks.
+static const int DT_MAX_LANDMARKS = 16;
+
+/// The landmark distances of the polygons of a single navigation mesh tile.
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtNavMeshLandmarks
+struct dtLandmarkTile
+{
+	dtTileRef ref;				///< The tile the distances were computed for. (Zero if not computed.)
+	unsigned int salt;			///< The salt of #ref.
+
+	/// The shortest and the longest distance from each landmark to the portals of each polygon.
+	/// FLT_MAX if the polygon can not be reached from the landmark.
+	/// [(min, max) * dtNavMeshLandmarks::getLandmarkCount() * polyCount]
+	float* dists;
+
+	int polyCount;				///< The number of polygons.
+};
+
+/// Landmark distances which give path searches a lower bound of the remaining
+/// path cost that is aware of walls. (ALT heuristic)
+/// @ingroup detour
+class dtNavMeshLandmarks
+{
+public:
+	dtNavMeshLandmarks();
+	~dtNavMeshLandmarks();
+
+	/// Initializes the landmarks.
+	///  @param[in]		nav				The navigation mesh to compute the distances for.
+	///  @param[in]		landmarkCount	The number of landmarks. [Limits: 0 < value <= #DT_MAX_LANDMARKS]
+	/// @returns The status flags for the operation.
+	dtStatus init(const dtNavMesh* nav, const int landmarkCount);
+
+	/// Updates the distances after tiles were added, removed or replaced since the
+	/// previous update.
+	///  @param[out]	updatedTileCount	The number of tiles whose distances were computed. [opt]
+	/// @returns The status flags for the operation.
+	dtStatus update(int* updatedTileCount = 0);
+
+	/// The number of landmarks.
+	/// @returns The number of landmarks.
+	int getLandmarkCount() const { return m_landmarkCount; }
+
+	/// Gets the polygon of a landmark.
+	///  @param[in]		i			The landmark index. [Limit: 0 <= index < #getLandmarkCount()]
+	/// @returns The polygon reference, or zero if the landmark is not placed.
+	dtPolyRef getLandmark(int i) const { return i >= 0 && i < m_landmarkCount ? m_landmarks[i] : 0; }
+
+	/// Gets the landmark distances of a polygon.
+	///  @param[in]		ref			The polygon reference.
+	/// @returns The (min, max) distances to each landmark, or null if they are not known.
+	const float* getPolyDistances(dtPolyRef ref) const;
+
+	/// Returns a lower bound of the path cost between two polygons, assuming area costs
+	/// of at least 1.
+	///  @param[in]		a			The landmark distances of the first polygon.
+	///  @param[in]		b			The landmark distances of the second polygon.
+	/// @returns The lower bound of the path cost, or zero if none is known.
+	float getLowerBound(const float* a, const float* b) const
+	{
+		float bound = 0.0f;
+		for (int i = 0; i < m_landmarkCount*2; i += 2)
+		{
+			if (a[i] == FLT_MAX || b[i] == FLT_MAX)
+				continue;
+			const float ab = a[i] - b[i+1];
+			const float ba = b[i] - a[i+1];
+			if (ab > bound)
+				bound = ab;
+			if (ba > bound)
+				bound = ba;
+		}
+		return bound;
+	}
+
+	/// Gets the distances of the tile at the specified index.
+	///  @param[in]		i			The tile index. [Limit: 0 >= index < dtNavMesh::getMaxTiles()]
+	/// @returns The distances of the tile.
+	const dtLandmarkTile* getTile(int i) const;
+
+	/// Gets the navigation mesh the landmarks were computed for.
+	/// @returns The navigation mesh the landmarks were computed for.
+	const dtNavMesh* getAttachedNavMesh() const { return m_nav; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtNavMeshLandmarks(const dtNavMeshLandmarks&);
+	dtNavMeshLandmarks& operator=(const dtNavMeshLandmarks&);
+
+	/// Frees the distances of a tile.
+	void freeTile(dtLandmarkTile& ltile);
+
+	/// Computes the distances of all tiles, placing the missing landmarks.
+	dtStatus computeDistances(int* updatedTileCount);
+
+	const dtNavMesh* m_nav;				///< The navigation mesh.
+	dtLandmarkTile* m_tiles;			///< The distances of the tiles. [Size: dtNavMesh::getMaxTiles()]
+	int m_maxTiles;						///< The number of tiles.
+	dtPolyRef m_landmarks[DT_MAX_LANDMARKS];	///< The landmark polygons.
+	int m_landmarkCount;				///< The number of landmarks.
+	dtTileRefTracker m_tracker;			///< Finds the tiles changed since the previous update.
+};
+
+/// Allocates a landmarks object using the Detour allocator.
+/// @return A landmarks object that is ready for initialization, or null on failure.
+///  @ingroup detour
+dtNavMeshLandmarks* dtAllocNavMeshLandmarks();
+
+/// Frees the specified landmarks object using the Detour allocator.
+///  @param[in]		landmarks	A landmarks object allocated using #dtAllocNavMeshLandmarks
+///  @ingroup detour
+void dtFreeNavMeshLandmarks(dtNavMeshLandmarks* landmarks);
+
+#endif // DETOURNAVMESHLANDMARKS_H
+
+///////////////////////////////////////////////////////////////////////////
+
+// This section contains detailed documentation for members that don't have
+// a source file. It reduces clutter in the main section of the header.
+
+/**
+
+@class dtNavMeshLandmarks
+
+The straight line distance to the goal does not see walls, so a search with it
+visits every polygon which is closer to the goal as the crow flies than the
+path around a wall. The landmarks store the graph distance of every polygon to
+a few landmark polygons, and by the triangle inequality a path from polygon
+@e a to polygon @e b costs at least |dist(L, b) - dist(L, a)| for any landmark
+@e L. Attach the landmarks to a query with dtNavMeshQuery::setLandmarks, which
+then uses the larger of both bounds.
+
+The distances are measured between the portal midpoints, which are the points
+the path searches move through, so the bound is valid for the search costs but
+can exceed the length of the straightened path. Every polygon stores the range
+of the distances of its portals, which keeps the bound valid wherever a search
+enters the polygon. All links are used regardless of filters and direction, so
+the bound is valid for any filter with area costs of at least 1, the same
+assumption the straight line heuristic makes.
+
+The landmarks are placed by the first #update, the first one as far as
+possible from an arbitrary polygon of the largest connected part of the mesh,
+the others as far as possible from the landmarks placed before. Polygons which
+can not be reached from the landmarks fall back to the straight line distance.
+
+The update is incremental. When tiles were only removed, the distances of the
+other tiles are kept, since removing polygons can only make paths longer. When
+tiles were added or replaced, which can make paths shorter, all distances are
+computed again, and the landmarks whose polygons were removed are placed again.
+Computing the distances visits every portal once per landmark. The update is
+cheap when the navigation mesh has not changed, and can be called every frame.
+Changes to polygon flags or areas do not affect the distances.
+
+*/
@@ -0,0 +1,192 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#ifndef DETOURNAVMESHLEVELS_H
+#define DETOURNAVMESHLEVELS_H
+
+#include "DetourNavMesh.h"
+#include "DetourStatus.h"
+#include "DetourTileRefTracker.h"
+
+class dtNavMeshQuery;
+class dtQueryFilter;
+
+/// The polygon mapping of a single navigation mesh tile to the other level.
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtNavMeshLevels
+struct dtNavMeshLevelTile
+{
+	dtTileRef ref;			///< The tile the mapping was built from. (Zero if not built.)
+	float bmin[3];			///< The minimum bounds of the tile. [(x, y, z)]
+	float bmax[3];			///< The maximum bounds of the tile. [(x, y, z)]
+	dtPolyRef* refs;		///< The polygon of the other level at the center of each polygon, or zero. [Size: polyCount]
+	int polyCount;			///< The number of polygons.
+};
+
+/// Maps polygons between a detailed navigation mesh and a coarse navigation mesh of the same world.
+/// @ingroup detour
+class dtNavMeshLevels
+{
+public:
+	dtNavMeshLevels();
+	~dtNavMeshLevels();
+
+	/// Initializes the mapping.
+	///  @param[in]		fine			The detailed navigation mesh.
+	///  @param[in]		coarse			The coarse navigation mesh.
+	///  @param[in]		halfExtents		The search distance along each axis between the levels. [(x, y, z)]
+	///  @param[in]		filter			The filter the mapped polygons must pass. Must stay valid while the mapping is used.
+	/// @returns The status flags for the operation.
+	dtStatus init(const dtNavMesh* fine, const dtNavMesh* coarse, const float* halfExtents,
+				  const dtQueryFilter* filter);
+
+	/// Builds the mapping of the tiles that were added, removed or replaced on either
+	/// level since the previous update, and of the tiles of the other level they overlap.
+	///  @param[out]	updatedTileCount	The number of tiles that were rebuilt. [opt]
+	/// @returns The status flags for the operation.
+	dtStatus update(int* updatedTileCount = 0);
+
+	/// Gets the coarse polygon at the center of a detailed polygon.
+	///  @param[in]		fineRef		The reference id of the detailed polygon.
+	/// @returns The reference id of the coarse polygon, or zero if there is none.
+	dtPolyRef getCoarsePoly(dtPolyRef fineRef) const { return getMappedPoly(FINE, fineRef); }
+
+	/// Gets the detailed polygon at the center of a coarse polygon.
+	///  @param[in]		coarseRef	The reference id of the coarse polygon.
+	/// @returns The reference id of the detailed polygon, or zero if there is none.
+	dtPolyRef getFinePoly(dtPolyRef coarseRef) const { return getMappedPoly(COARSE, coarseRef); }
+
+	/// Moves a location on the detailed navigation mesh to the coarse navigation mesh.
+	///  @param[in]		fineRef			The reference id of the detailed polygon containing the location.
+	///  @param[in]		pos				The location. [(x, y, z)]
+	///  @param[out]	coarseRef		The reference id of the coarse polygon.
+	///  @param[out]	coarsePos		The location on the coarse polygon. [(x, y, z)]
+	/// @returns The status flags for the query.
+	dtStatus findCoarseLocation(dtPolyRef fineRef, const float* pos, dtPolyRef* coarseRef, float* coarsePos) const
+	{
+		return findLocation(FINE, fineRef, pos, coarseRef, coarsePos);
+	}
+
+	/// Moves a location on the coarse navigation mesh to the detailed navigation mesh.
+	///  @param[in]		coarseRef		The reference id of the coarse polygon containing the location.
+	///  @param[in]		pos				The location. [(x, y, z)]
+	///  @param[out]	fineRef			The reference id of the detailed polygon.
+	///  @param[out]	finePos			The location on the detailed polygon. [(x, y, z)]
+	/// @returns The status flags for the query.
+	dtStatus findFineLocation(dtPolyRef coarseRef, const float* pos, dtPolyRef* fineRef, float* finePos) const
+	{
+		return findLocation(COARSE, coarseRef, pos, fineRef, finePos);
+	}
+
+	/// Gets the mapping of a tile of the detailed navigation mesh.
+	///  @param[in]		i			The tile index. [Limit: 0 >= index < dtNavMesh::getMaxTiles()]
+	/// @returns The mapping of the tile.
+	const dtNavMeshLevelTile* getFineTile(int i) const { return getTile(FINE, i); }
+
+	/// Gets the mapping of a tile of the coarse navigation mesh.
+	///  @param[in]		i			The tile index. [Limit: 0 >= index < dtNavMesh::getMaxTiles()]
+	/// @returns The mapping of the tile.
+	const dtNavMeshLevelTile* getCoarseTile(int i) const { return getTile(COARSE, i); }
+
+	/// Gets the detailed navigation mesh.
+	/// @returns The detailed navigation mesh.
+	const dtNavMesh* getFineNavMesh() const { return m_levels[FINE].nav; }
+
+	/// Gets the coarse navigation mesh.
+	/// @returns The coarse navigation mesh.
+	const dtNavMesh* getCoarseNavMesh() const { return m_levels[COARSE].nav; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtNavMeshLevels(const dtNavMeshLevels&);
+	dtNavMeshLevels& operator=(const dtNavMeshLevels&);
+
+	enum { FINE = 0, COARSE = 1 };
+
+	/// The state of one of the navigation meshes.
+	struct Level
+	{
+		const dtNavMesh* nav;			///< The navigation mesh.
+		dtNavMeshQuery* query;			///< The query used to find polygons on the navigation mesh.
+		dtNavMeshLevelTile* tiles;		///< The mappings of the tiles. [Size: dtNavMesh::getMaxTiles()]
+		int maxTiles;					///< The number of tiles.
+		dtTileRefTracker tracker;		///< Finds the tiles changed since the previous update.
+	};
+
+	const dtNavMeshLevelTile* getTile(const int level, int i) const;
+	dtPolyRef getMappedPoly(const int level, dtPolyRef ref) const;
+	dtStatus findLocation(const int level, dtPolyRef ref, const float* pos, dtPolyRef* outRef, float* outPos) const;
+
+	/// Maps the polygons of a tile to the other level.
+	bool buildTile(const dtMeshTile* tile, const Level& other, dtNavMeshLevelTile& ltile);
+
+	/// Frees the mapping of a tile.
+	void freeTile(dtNavMeshLevelTile& ltile);
+
+	Level m_levels[2];					///< The detailed and the coarse level.
+	float m_halfExtents[3];				///< The search distance between the levels.
+	const dtQueryFilter* m_filter;		///< The filter the mapped polygons must pass.
+};
+
+/// Allocates a navigation mesh levels object using the Detour allocator.
+/// @return A navigation mesh levels object that is ready for initialization, or null on failure.
+///  @ingroup detour
+dtNavMeshLevels* dtAllocNavMeshLevels();
+
+/// Frees the specified navigation mesh levels object using the Detour allocator.
+///  @param[in]		levels		A navigation mesh levels object allocated using #dtAllocNavMeshLevels
+///  @ingroup detour
+void dtFreeNavMeshLevels(dtNavMeshLevels* levels);
+
+#endif // DETOURNAVMESHLEVELS_H
+
+///////////////////////////////////////////////////////////////////////////
+
+// This section contains detailed documentation for members that don't have
+// a source file. It reduces clutter in the main section of the header.
+
+/**
+
+@class dtNavMeshLevels
+
+Agents far away from the player, such as traffic or background patrols, do
+not need the full resolution of the navigation mesh. A coarse navigation mesh
+of the same world, for example built with a several times larger
+rcConfig::cs and rcConfig::maxSimplificationError, has far fewer polygons,
+so its path searches and corridors are much cheaper.
+
+The levels object keeps the mapping tables between the two meshes. Every
+ground polygon of each level is mapped to the polygon of the other level
+found nearest to its center. #findCoarseLocation and #findFineLocation move
+an agent position between the levels, usually in constant time, by checking
+the mapped polygon and its neighbours before falling back to a nearest
+polygon search.
+
+To switch the level of detail of a crowd agent, keep one dtCrowd per level.
+Remove the agent from one crowd, add it to the other at the location found by
+#findCoarseLocation or #findFineLocation, and move its target the same way
+before calling dtCrowd::requestMoveTarget.
+
+The mapping is incremental. Call #update after tiles have been added or
+removed on either level. The changed tiles are rebuilt, and so are the tiles
+of the other level overlapping them.
+
+Off-mesh connections are not mapped.
+
+*/
@@ -0,0 +1,205 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#ifndef DETOURNAVMESHNEIGHBOURHOOD_H
+#define DETOURNAVMESHNEIGHBOURHOOD_H
+
+#include "DetourNavMesh.h"
+#include "DetourStatus.h"
+
+class dtQueryFilter;
+
+/// Flags of the links of the polygons in a dtNavMeshNeighbourhood.
+enum dtNeighbourhoodEdgeFlags
+{
+	DT_NEIGHBOURHOOD_EDGE_PASSABLE = 0x01,	///< The neighbour passes the filter and the edge is wide enough for the agent.
+	DT_NEIGHBOURHOOD_EDGE_OFFMESH = 0x02	///< The neighbour is an off-mesh connection.
+};
+
+/// A link of a polygon in a dtNavMeshNeighbourhood, in the order of the polygon links.
+/// @note This structure is rarely if ever used by the end user.
+struct dtNeighbourhoodEdge
+{
+	dtPolyRef ref;				///< The polygon the link leads to.
+	int index;					///< The index of the polygon the link leads to in the set, or -1 if it is not kept.
+	float portal[6];			///< The portal of the link, only set for passable links. [(left xyz, right xyz)]
+	unsigned char flags;		///< The edge flags. (See: #dtNeighbourhoodEdgeFlags)
+};
+
+/// A polygon in a dtNavMeshNeighbourhood.
+/// @note This structure is rarely if ever used by the end user.
+struct dtNeighbourhoodPoly
+{
+	dtPolyRef ref;				///< The polygon reference.
+	unsigned int generation;	///< The navigation mesh generation the links were read at.
+	int firstEdge;				///< The index of the first link in the edge array.
+	int edgeCount;				///< The number of links.
+	float bounds[4];			///< The bounds of the polygon on the xz-plane. [(minX, minZ, maxX, maxZ)]
+};
+
+/// Keeps the polygons around a moving position between the local searches of a dtNavMeshQuery.
+/// @ingroup detour
+/// @see dtNavMeshQuery::findPolysAroundCircle, dtNavMeshQuery::findLocalNeighbourhood
+class dtNavMeshNeighbourhood
+{
+public:
+	dtNavMeshNeighbourhood();
+	~dtNavMeshNeighbourhood();
+
+	/// Initializes the neighbourhood.
+	///  @param[in]		maxPolys	The maximum number of polygons kept. [Limit: > 0]
+	///  @param[in]		margin		How far the position can move before the polygons are searched again. [Limit: >= 0] [Units: wu]
+	/// @returns The status flags for the operation.
+	dtStatus init(const int maxPolys, const float margin);
+
+	/// Forgets the polygons, for example after the filter the searches use was changed.
+	void reset();
+
+	/// Gets the number of polygons kept.
+	/// @returns The number of polygons.
+	int getPolyCount() const { return m_polyCount[m_current]; }
+
+	/// Gets a polygon kept by the neighbourhood.
+	///  @param[in]		i		The index of the polygon. [Limits: 0 <= value < #getPolyCount()]
+	/// @returns The polygon.
+	const dtNeighbourhoodPoly* getPoly(const int i) const { return &m_polys[m_current][i]; }
+
+	/// Gets the center of the last search of the polygons.
+	/// @returns The center. [(x, y, z)]
+	const float* getCenter() const { return m_center; }
+
+	/// Gets the radius of the last search of the polygons, including the margin.
+	/// @returns The radius, or a negative value if the kept polygons cannot answer queries. [Units: wu]
+	float getRadius() const { return m_radius; }
+
+	/// Gets how far the position can move before the polygons are searched again.
+	/// @returns The margin. [Units: wu]
+	float getMargin() const { return m_margin; }
+
+	/// Gets the number of times the polygons were searched again.
+	/// @returns The number of searches.
+	int getSearchCount() const { return m_searchCount; }
+
+	/// Gets the number of queries answered from the kept polygons without a search.
+	/// @returns The number of reuses.
+	int getReuseCount() const { return m_reuseCount; }
+
+	/// Gets the number of polygons whose links were read from the navigation mesh by the searches.
+	/// The polygons which were kept from the previous search are not counted.
+	/// @returns The number of polygons read.
+	int getReadCount() const { return m_readCount; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtNavMeshNeighbourhood(const dtNavMeshNeighbourhood&);
+	dtNavMeshNeighbourhood& operator=(const dtNavMeshNeighbourhood&);
+
+	friend class dtNavMeshQuery;
+
+	/// Returns the index of the polygon in the kept or the next set of polygons, or -1.
+	int findPoly(const int set, const dtPolyRef ref) const;
+
+	/// Clears the next set of polygons.
+	void beginSearch();
+
+	/// Adds a polygon with room for the links to the next set. Returns null if it is full.
+	dtNeighbourhoodPoly* addPoly(const dtPolyRef ref, const int edgeCount);
+
+	/// Makes the next set of polygons the kept one.
+	void endSearch(const float* center, const float radius, const bool complete);
+
+	/// Starts a search over the kept polygons, after which no polygon is marked.
+	void beginMarks();
+
+	/// Gets the links of a polygon of a set.
+	dtNeighbourhoodEdge* getEdges(const int set, const dtNeighbourhoodPoly& poly) const { return &m_edges[set][poly.firstEdge]; }
+
+	dtNeighbourhoodPoly* m_polys[2];	///< The kept and the next set of polygons. [Size: #m_maxPolys]
+	dtNeighbourhoodEdge* m_edges[2];	///< The links of the polygons of the sets. [Size: #m_maxEdges]
+	int* m_hash[2];						///< The polygon indices of the sets by reference, -1 if empty. [Size: #m_hashSize]
+	int m_polyCount[2];					///< The number of polygons in the sets.
+	int m_edgeCount[2];					///< The number of links in the sets.
+	int m_current;						///< The index of the kept set.
+	int m_maxPolys;						///< The number of polygons a set can hold.
+	int m_maxEdges;						///< The number of links a set can hold.
+	int m_hashSize;						///< The size of the hash tables, a power of two.
+	unsigned int* m_marks;				///< The visit stamps of the kept polygons, used by the searches. [Size: #m_maxPolys]
+	unsigned int m_stamp;				///< The visit stamp of the current search.
+	int* m_results;						///< The indices of the kept polygons found by a search. [Size: #m_maxPolys]
+
+	float m_margin;						///< How far the position can move before the polygons are searched again. [Units: wu]
+	float m_center[3];					///< The center of the last search. [(x, y, z)]
+	float m_radius;						///< The radius of the last search, negative if the kept set is not usable. [Units: wu]
+
+	const dtNavMesh* m_nav;				///< The navigation mesh of the kept polygons.
+	const dtQueryFilter* m_filter;		///< The filter of the kept polygons.
+	unsigned int m_epoch;				///< The navigation mesh epoch of the last search.
+	unsigned int m_generation;			///< The navigation mesh generation the kept polygons were validated at.
+
+	int m_searchCount;					///< The number of searches.
+	int m_reuseCount;					///< The number of queries answered without a search.
+	int m_readCount;					///< The number of polygons read from the navigation mesh.
+};
+
+/// Allocates a neighbourhood object using the Detour allocator.
+/// @return A neighbourhood that is ready for initialization, or null on failure.
+///  @ingroup detour
+dtNavMeshNeighbourhood* dtAllocNavMeshNeighbourhood();
+
+/// Frees the specified neighbourhood object using the Detour allocator.
+///  @param[in]		neighbourhood		A neighbourhood allocated using #dtAllocNavMeshNeighbourhood
+///  @ingroup detour
+void dtFreeNavMeshNeighbourhood(dtNavMeshNeighbourhood* neighbourhood);
+
+#endif // DETOURNAVMESHNEIGHBOURHOOD_H
+
+///////////////////////////////////////////////////////////////////////////
+
+// This section contains detailed documentation for members that don't have
+// a source file. It reduces clutter in the main section of the header.
+
+/**
+
+@class dtNavMeshNeighbourhood
+
+dtNavMeshQuery::findPolysAroundCircle and dtNavMeshQuery::findLocalNeighbourhood
+read the links of every polygon they reach from the tiles, run the filter on
+the neighbours and build the portals, on every call. Called every frame with
+a slightly moved center, that is the same work each time.
+
+A neighbourhood passed to these searches keeps the polygons reachable from the
+start polygon through the portals within the search radius plus a margin,
+together with their links and portals. While the center stays within the
+margin the searches run on the kept links only. When it moves further, the
+polygons are searched again around the new center: kept polygons are reused,
+only the polygons that came into range are read from the navigation mesh, and
+the ones that went out of range are dropped.
+
+The kept polygons are revalidated against the tile generations when polygon
+flags or areas change, and the ones in changed tiles are read again. All of
+them are dropped when tiles are added or removed, or when the searches use a
+different filter object. Changes made to the filter itself are not detected,
+call #reset after them.
+
+The results are the same as the searches without a neighbourhood, except
+that dtNavMeshQuery::findLocalNeighbourhood is not limited by the size of its
+small node pool. If the neighbourhood is too small for the polygons in range,
+the searches run without it.
+
+*/
@@ -20,8 +20,11 @@
 #define DETOURNAVMESHQUERY_H
 
 #include "DetourNavMesh.h"
+#include "DetourNavMeshLandmarks.h"
 #include "DetourStatus.h"
+#include "DetourTimeBudget.h"
 
+class dtNavMeshNeighbourhood;
 
 // Define DT_VIRTUAL_QUERYFILTER if you wish to derive a custom filter from dtQueryFilter.
 // On certain platforms indirect or virtual function call is expensive. The default
@@ -30,6 +33,16 @@
 
 //#define DT_VIRTUAL_QUERYFILTER 1
 
+// Define DT_QUERY_STATS if you wish dtNavMeshQuery to count the work done by its
+// queries. (See: dtQueryStats) The counters are updated in the inner loops of the
+// searches, so they are compiled out by default.
+
+//#define DT_QUERY_STATS 1
+
+/// Names the filter type of the templated queries, so that it is not deduced from the arguments.
+/// @see dtNavMeshQuery::findPath
+template <class T> struct dtQueryFilterType { typedef T Type; };
+
 /// Defines polygon filtering and traversal costs for navigation mesh query operations.
 /// @ingroup detour
 class dtQueryFilter
@@ -37,6 +50,7 @@ class dtQueryFilter
 	float m_areaCost[DT_MAX_AREAS];		///< Cost per area type. (Used by default implementation.)
 	unsigned short m_includeFlags;		///< Flags for polygons that can be visited. (Used by default implementation.)
 	unsigned short m_excludeFlags;		///< Flags for polygons that should not be visited. (Used by default implementation.)
+	float m_agentRadius;				///< The radius of the agent, used to skip too narrow polygon edges.
 	
 public:
 	dtQueryFilter();
@@ -115,10 +129,24 @@ public:
 	/// @param[in]		flags		The new flags.
 	inline void setExcludeFlags(const unsigned short flags) { m_excludeFlags = flags; }	
 
+	/// Returns the radius of the agent.
+	/// The queries do not cross polygon edges which are narrower than the agent,
+	/// on tiles built with edge clearances. (See: #dtPassEdgeClearance)
+	inline float getAgentRadius() const { return m_agentRadius; }
+
+	/// Sets the radius of the agent. The default of zero crosses all edges.
+	/// @param[in]		radius		The new radius of the agent. [Unit: wu]
+	inline void setAgentRadius(const float radius) { m_agentRadius = radius; }
+
 	///@}
 
 };
 
+/// Returns the agent radius of a filter of the templated queries.
+/// Filters which do not derive from #dtQueryFilter cross all edges.
+inline float dtGetFilterAgentRadius(const dtQueryFilter* filter) { return filter->getAgentRadius(); }
+inline float dtGetFilterAgentRadius(const void* /*filter*/) { return 0.0f; }
+
 /// Provides information about raycast hit
 /// filled by dtNavMeshQuery::raycast
 /// @ingroup detour
@@ -146,6 +174,83 @@ struct dtRaycastHit
 	float pathCost;
 };
 
+/// A move of a position along the surface of the navigation mesh,
+/// processed by dtNavMeshQuery::moveAlongSurfaceBatch.
+/// @ingroup detour
+struct dtSurfaceMove
+{
+	dtPolyRef startRef;				///< The reference id of the start polygon.
+	float startPos[3];				///< A position of the mover within the start polygon. [(x, y, z)]
+	float endPos[3];				///< The desired end position of the mover. [(x, y, z)]
+	const dtQueryFilter* filter;	///< The polygon filter to apply to the move.
+
+	/// The polygons visited during the move. [Size: #maxVisited]
+	dtPolyRef* visited;
+
+	/// The maximum number of polygons the #visited array can hold.
+	int maxVisited;
+
+	/// The result position of the mover, on the surface of the last visited polygon. [(x, y, z)]
+	float resultPos[3];
+
+	/// The number of polygons visited during the move.
+	int visitedCount;
+
+	/// The status flags of the move.
+	dtStatus status;
+};
+
+/// The portals of the leading polygons of a corridor, kept between calls to
+/// dtNavMeshQuery::findStraightPath along the same corridor.
+/// The owner provides the arrays and is responsible for resetting #count when the
+/// corridor or the navigation mesh changes.
+/// @ingroup detour
+struct dtPortalCache
+{
+	float* portals;			///< The left and right points of each portal. [(left xyz, right xyz) * #capacity]
+	unsigned char* types;	///< The type of the polygon entered through each portal. [(type) * #capacity]
+	int count;				///< The number of cached portals, from the start of the corridor.
+	int capacity;			///< The number of portals the arrays can hold.
+};
+
+/// Counts the work done by the queries of a dtNavMeshQuery.
+/// The counters are only updated when Detour is compiled with DT_QUERY_STATS defined,
+/// otherwise they stay zero. Counted by dtNavMeshQuery::findPath, the multi-goal path
+/// searches, the sliced path find functions, dtNavMeshQuery::raycast,
+/// dtNavMeshQuery::moveAlongSurface, dtNavMeshQuery::findPolysAroundCircle and
+/// dtNavMeshQuery::findDistances.
+/// @see dtNavMeshQuery::getStats
+/// @ingroup detour
+struct dtQueryStats
+{
+	int queryCount;			///< The number of finished queries.
+	int nodesExpanded;		///< The number of polygons expanded by the searches, or crossed by the raycasts.
+	int maxNodesUsed;		///< The largest number of search nodes used by a single query.
+	int tilesTouched;		///< The number of times a query stepped into a polygon of another tile.
+	int filterCalls;		///< The number of calls to dtQueryFilter::passFilter.
+	int costCalls;			///< The number of calls to dtQueryFilter::getCost.
+	int outOfNodesCount;	///< The number of queries which ran out of search nodes. (See: #DT_OUT_OF_NODES)
+};
+
+/// The memory used by a navigation mesh query, broken down by category. [Units: bytes]
+/// @see dtNavMeshQuery::getMemStats
+struct dtNavMeshQueryMemStats
+{
+	size_t query;			///< The query object.
+	size_t nodePool;		///< The node pool of the path searches.
+	size_t tinyNodePool;	///< The small node pool of the local searches.
+	size_t openList;		///< The open list of the path searches.
+	size_t backSearch;		///< The node pool and open list of the backward searches. (See: #DT_FINDPATH_BIDIRECTIONAL)
+	size_t total;			///< The sum of all categories.
+};
+
+/// Adds the counters of one set of query statistics to another.
+/// The largest number of nodes used is the maximum of both.
+///  @param[in,out]	stats	The statistics to add to.
+///  @param[in]		other	The statistics to add.
+/// @ingroup detour
+void dtAddQueryStats(dtQueryStats* stats, const dtQueryStats* other);
+
 /// Provides custom polygon query behavior.
 /// Used by dtNavMeshQuery::queryPolygons.
 /// @ingroup detour
@@ -169,10 +274,15 @@ public:
 	~dtNavMeshQuery();
 	
 	/// Initializes the query object.
-	///  @param[in]		nav			Pointer to the dtNavMesh object to use for all queries.
-	///  @param[in]		maxNodes	Maximum number of search nodes. [Limits: 0 < value <= 65535]
+	///  @param[in]		nav				Pointer to the dtNavMesh object to use for all queries.
+	///  @param[in]		maxNodes		Maximum number of search nodes. [Limits: 0 < value <= 65535]
+	///  @param[in]		maxBackNodes	Maximum number of search nodes for the backward half of
+	///  								bidirectional path searches. [Limits: 0 <= value <= 65535]
+	///  								(See: #DT_FINDPATH_BIDIRECTIONAL)
+	///  @param[in]		allocator		The allocator of the query memory. Must outlive the query. [opt]
 	/// @returns The status flags for the query.
-	dtStatus init(const dtNavMesh* nav, const int maxNodes);
+	dtStatus init(const dtNavMesh* nav, const int maxNodes, const int maxBackNodes = 0,
+				  dtAllocator* allocator = 0);
 	
 	/// @name Standard Pathfinding Functions
 	/// @{
@@ -187,11 +297,67 @@ public:
 	///  							[(polyRef) * @p pathCount]
 	///  @param[out]	pathCount	The number of polygons returned in the @p path array.
 	///  @param[in]		maxPath		The maximum number of polygons the @p path array can hold. [Limit: >= 1]
+	///  @param[in]		options		Query options. (See: #dtFindPathOptions)
 	dtStatus findPath(dtPolyRef startRef, dtPolyRef endRef,
 					  const float* startPos, const float* endPos,
 					  const dtQueryFilter* filter,
+					  dtPolyRef* path, int* pathCount, const int maxPath,
+					  const unsigned int options = 0) const;
+
+	/// Finds a path from the start polygon to the end polygon, calling the filter
+	/// directly instead of through #dtQueryFilter. (Defined in DetourFindPath.h)
+	///  @param[in]		startRef	The reference id of the start polygon.
+	///  @param[in]		endRef		The reference id of the end polygon.
+	///  @param[in]		startPos	A position within the start polygon. [(x, y, z)]
+	///  @param[in]		endPos		A position within the end polygon. [(x, y, z)]
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	///  @param[out]	path		An ordered list of polygon references representing the path. (Start to end.) 
+	///  							[(polyRef) * @p pathCount]
+	///  @param[out]	pathCount	The number of polygons returned in the @p path array.
+	///  @param[in]		maxPath		The maximum number of polygons the @p path array can hold. [Limit: >= 1]
+	/// @returns The status flags for the query.
+	template <class TFilter>
+	dtStatus findPath(dtPolyRef startRef, dtPolyRef endRef,
+					  const float* startPos, const float* endPos,
+					  const typename dtQueryFilterType<TFilter>::Type* filter,
 					  dtPolyRef* path, int* pathCount, const int maxPath) const;
 
+	/// Finds a path from the start polygon to the goal which is the cheapest to reach, in a
+	/// single search.
+	///  @param[in]		startRef		The reference id of the start polygon.
+	///  @param[in]		startPos		A position within the start polygon. [(x, y, z)]
+	///  @param[in]		goalRefs		The reference ids of the goal polygons. [(polyRef) * @p goalCount]
+	///  @param[in]		goalPositions	A position within each goal polygon. [(x, y, z) * @p goalCount]
+	///  @param[in]		goalCount		The number of goals. [Limit: > 0]
+	///  @param[in]		filter			The polygon filter to apply to the query.
+	///  @param[out]	path			An ordered list of polygon references representing the path. (Start to goal.) 
+	///  								[(polyRef) * @p pathCount]
+	///  @param[out]	pathCount		The number of polygons returned in the @p path array.
+	///  @param[in]		maxPath			The maximum number of polygons the @p path array can hold. [Limit: >= 1]
+	///  @param[out]	goalIndex		The index of the goal reached, or -1 if no goal could be reached. [opt]
+	/// @returns The status flags for the query.
+	dtStatus findPathToNearest(dtPolyRef startRef, const float* startPos,
+							   const dtPolyRef* goalRefs, const float* goalPositions, const int goalCount,
+							   const dtQueryFilter* filter,
+							   dtPolyRef* path, int* pathCount, const int maxPath, int* goalIndex = 0) const;
+
+	/// Finds the goals which are the cheapest to reach from the start polygon, in a single search.
+	///  @param[in]		startRef		The reference id of the start polygon.
+	///  @param[in]		startPos		A position within the start polygon. [(x, y, z)]
+	///  @param[in]		goalRefs		The reference ids of the goal polygons. [(polyRef) * @p goalCount]
+	///  @param[in]		goalPositions	A position within each goal polygon. [(x, y, z) * @p goalCount]
+	///  @param[in]		goalCount		The number of goals. [Limit: > 0]
+	///  @param[in]		filter			The polygon filter to apply to the query.
+	///  @param[out]	resultGoals		The indices of the goals found, cheapest first. [(index) * @p resultCount]
+	///  @param[out]	resultCosts		The search cost from @p startPos to each goal found. [(cost) * @p resultCount]
+	///  @param[out]	resultCount		The number of goals found.
+	///  @param[in]		maxResult		The maximum number of goals the result arrays can hold. [Limit: > 0]
+	/// @returns The status flags for the query.
+	dtStatus findNearestGoals(dtPolyRef startRef, const float* startPos,
+							  const dtPolyRef* goalRefs, const float* goalPositions, const int goalCount,
+							  const dtQueryFilter* filter,
+							  int* resultGoals, float* resultCosts, int* resultCount, const int maxResult) const;
+
 	/// Finds the straight path from the start to the end position within the polygon corridor.
 	///  @param[in]		startPos			Path start position. [(x, y, z)]
 	///  @param[in]		endPos				Path end position. [(x, y, z)]
@@ -203,11 +369,14 @@ public:
 	///  @param[out]	straightPathCount	The number of points in the straight path.
 	///  @param[in]		maxStraightPath		The maximum number of points the straight path arrays can hold.  [Limit: > 0]
 	///  @param[in]		options				Query options. (see: #dtStraightPathOptions)
+	///  @param[in,out]	portalCache			The portals of the start of @p path from earlier calls, extended
+	///  									with the portals computed by this call. [opt]
 	/// @returns The status flags for the query.
 	dtStatus findStraightPath(const float* startPos, const float* endPos,
 							  const dtPolyRef* path, const int pathSize,
 							  float* straightPath, unsigned char* straightPathFlags, dtPolyRef* straightPathRefs,
-							  int* straightPathCount, const int maxStraightPath, const int options = 0) const;
+							  int* straightPathCount, const int maxStraightPath, const int options = 0,
+							  dtPortalCache* portalCache = 0) const;
 
 	///@}
 	/// @name Sliced Pathfinding Functions
@@ -229,12 +398,32 @@ public:
 								const float* startPos, const float* endPos,
 								const dtQueryFilter* filter, const unsigned int options = 0);
 
+	/// Initializes a sliced path query to the goal which is the cheapest to reach.
+	/// (See: #findPathToNearest)
+	///  @param[in]		startRef		The reference id of the start polygon.
+	///  @param[in]		startPos		A position within the start polygon. [(x, y, z)]
+	///  @param[in]		goalRefs		The reference ids of the goal polygons. [(polyRef) * @p goalCount]
+	///  @param[in]		goalPositions	A position within each goal polygon. [(x, y, z) * @p goalCount]
+	///  @param[in]		goalCount		The number of goals. [Limit: > 0]
+	///  @param[in]		filter			The polygon filter to apply to the query.
+	/// @returns The status flags for the query.
+	dtStatus initSlicedFindPathToNearest(dtPolyRef startRef, const float* startPos,
+										 const dtPolyRef* goalRefs, const float* goalPositions, const int goalCount,
+										 const dtQueryFilter* filter);
+
 	/// Updates an in-progress sliced path query.
 	///  @param[in]		maxIter		The maximum number of iterations to perform.
 	///  @param[out]	doneIters	The actual number of iterations completed. [opt]
 	/// @returns The status flags for the query.
 	dtStatus updateSlicedFindPath(const int maxIter, int* doneIters);
 
+	/// Updates an in-progress sliced path query until it completes or the time budget runs out.
+	///  @param[in]		budget		The time budget. The clock is read every dtTimeBudget::checkIterations iterations.
+	///  @param[out]	doneIters	The actual number of iterations completed. [opt]
+	///  @param[out]	usedTime	The time spent in the update. [opt] [Units: us]
+	/// @returns The status flags for the query.
+	dtStatus updateSlicedFindPath(const dtTimeBudget& budget, int* doneIters, double* usedTime = 0);
+
 	/// Finalizes and returns the results of a sliced path query.
 	///  @param[out]	path		An ordered list of polygon references representing the path. (Start to end.) 
 	///  							[(polyRef) * @p pathCount]
@@ -242,6 +431,15 @@ public:
 	///  @param[in]		maxPath		The max number of polygons the path array can hold. [Limit: >= 1]
 	/// @returns The status flags for the query.
 	dtStatus finalizeSlicedFindPath(dtPolyRef* path, int* pathCount, const int maxPath);
+
+	/// Finalizes and returns the results of a sliced path query to the nearest goal.
+	///  @param[out]	path		An ordered list of polygon references representing the path. (Start to goal.) 
+	///  							[(polyRef) * @p pathCount]
+	///  @param[out]	pathCount	The number of polygons returned in the @p path array.
+	///  @param[in]		maxPath		The max number of polygons the path array can hold. [Limit: >= 1]
+	///  @param[out]	goalIndex	The index of the goal reached, or -1 if no goal was reached. [opt]
+	/// @returns The status flags for the query.
+	dtStatus finalizeSlicedFindPathToNearest(dtPolyRef* path, int* pathCount, const int maxPath, int* goalIndex);
 	
 	/// Finalizes and returns the results of an incomplete sliced path query, returning the path to the furthest
 	/// polygon on the existing path that was visited during the search.
@@ -275,6 +473,25 @@ public:
 								   const dtQueryFilter* filter,
 								   dtPolyRef* resultRef, dtPolyRef* resultParent, float* resultCost,
 								   int* resultCount, const int maxResult) const;
+
+	/// Finds the polygons along the navigation graph that touch the specified circle, reusing the
+	/// polygons kept by a neighbourhood from the previous searches around a nearby center.
+	///  @param[in]		startRef		The reference id of the polygon where the search starts.
+	///  @param[in]		centerPos		The center of the search circle. [(x, y, z)]
+	///  @param[in]		radius			The radius of the search circle.
+	///  @param[in]		filter			The polygon filter to apply to the query.
+	///  @param[in,out]	neighbourhood	The polygons kept between the searches. (See: dtNavMeshNeighbourhood)
+	///  @param[out]	resultRef		The reference ids of the polygons touched by the circle. [opt]
+	///  @param[out]	resultParent	The reference ids of the parent polygons for each result. 
+	///  								Zero if a result polygon has no parent. [opt]
+	///  @param[out]	resultCost		The search cost from @p centerPos to the polygon. [opt]
+	///  @param[out]	resultCount		The number of polygons found. [opt]
+	///  @param[in]		maxResult		The maximum number of polygons the result arrays can hold.
+	/// @returns The status flags for the query.
+	dtStatus findPolysAroundCircle(dtPolyRef startRef, const float* centerPos, const float radius,
+								   const dtQueryFilter* filter, dtNavMeshNeighbourhood* neighbourhood,
+								   dtPolyRef* resultRef, dtPolyRef* resultParent, float* resultCost,
+								   int* resultCount, const int maxResult) const;
 	
 	/// Finds the polygons along the naviation graph that touch the specified convex polygon.
 	///  @param[in]		startRef		The reference id of the polygon where the search starts.
@@ -293,6 +510,24 @@ public:
 								  const dtQueryFilter* filter,
 								  dtPolyRef* resultRef, dtPolyRef* resultParent, float* resultCost,
 								  int* resultCount, const int maxResult) const;
+
+	/// Finds the search costs from the start polygon to a set of target polygons, in a single search.
+	///  @param[in]		startRef		The reference id of the polygon where the search starts.
+	///  @param[in]		startPos		A position within the start polygon. [(x, y, z)]
+	///  @param[in]		targetRefs		The reference ids of the target polygons. [(polyRef) * @p targetCount]
+	///  @param[in]		targetPositions	A position within each target polygon, or null to measure the cost
+	///  								to where the search enters the polygons. [opt] [(x, y, z) * @p targetCount]
+	///  @param[in]		targetCount		The number of targets.
+	///  @param[in]		filter			The polygon filter to apply to the query.
+	///  @param[in]		maxCost			The search cost beyond which targets are not reached. [Limit: >= 0]
+	///  @param[out]	resultCosts		The search cost to each target, or FLT_MAX if the target was not reached.
+	///  								[(cost) * @p targetCount]
+	///  @param[out]	reachedCount	The number of targets reached. [opt]
+	/// @returns The status flags for the query.
+	dtStatus findDistances(dtPolyRef startRef, const float* startPos,
+						   const dtPolyRef* targetRefs, const float* targetPositions, const int targetCount,
+						   const dtQueryFilter* filter, const float maxCost,
+						   float* resultCosts, int* reachedCount = 0) const;
 	
 	/// Gets a path from the explored nodes in the previous search.
 	///  @param[in]		endRef		The reference id of the end polygon.
@@ -305,7 +540,8 @@ public:
 	///  				if @p path cannot contain the entire path. In this case it is filled to capacity with a partial path.
 	///  				Otherwise returns DT_SUCCESS.
 	///  @remarks		The result of this function depends on the state of the query object. For that reason it should only
-	///  				be used immediately after one of the two Dijkstra searches, findPolysAroundCircle or findPolysAroundShape.
+	///  				be used immediately after one of the Dijkstra searches, findPolysAroundCircle, findPolysAroundShape,
+	///  				findNearestGoals or findDistances.
 	dtStatus getPathFromDijkstraSearch(dtPolyRef endRef, dtPolyRef* path, int* pathCount, int maxPath) const;
 
 	/// @}
@@ -339,6 +575,21 @@ public:
 							 const dtQueryFilter* filter,
 							 dtPolyRef* nearestRef, float* nearestPt, bool* isOverPoly) const;
 	
+	/// Finds the polygons nearest to each of the specified center points.
+	/// [opt] means the specified parameter can be a null pointer, in that case the output parameter will not be set.
+	///
+	///  @param[in]		centers		The centers of the search boxes. [(x, y, z) * @p count]
+	///  @param[in]		halfExtents	The search distances along each axis. [(x, y, z) * @p count]
+	///  @param[in]		count		The number of points to query.
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	///  @param[out]	nearestRefs	The reference ids of the nearest polygons. Set to 0 if no polygon is found. [Size: @p count]
+	///  @param[out]	nearestPts	The nearest points on the polygons. Unchanged if no polygon is found. [opt] [(x, y, z) * @p count]
+	///  @param[out]	isOverPoly 	Set to true if the point's X/Z coordinate lies inside the polygon. Unchanged if no polygon is found. [opt] [Size: @p count]
+	/// @returns The status flags for the query.
+	dtStatus findNearestPolys(const float* centers, const float* halfExtents, const int count,
+							  const dtQueryFilter* filter,
+							  dtPolyRef* nearestRefs, float* nearestPts, bool* isOverPoly) const;
+	
 	/// Finds polygons that overlap the search box.
 	///  @param[in]		center		The center of the search box. [(x, y, z)]
 	///  @param[in]		halfExtents		The search distance along each axis. [(x, y, z)]
@@ -375,6 +626,24 @@ public:
 									dtPolyRef* resultRef, dtPolyRef* resultParent,
 									int* resultCount, const int maxResult) const;
 
+	/// Finds the non-overlapping navigation polygons in the local neighbourhood around the center position,
+	/// reusing the polygons kept by a neighbourhood from the previous searches around a nearby center.
+	///  @param[in]		startRef		The reference id of the polygon where the search starts.
+	///  @param[in]		centerPos		The center of the query circle. [(x, y, z)]
+	///  @param[in]		radius			The radius of the query circle.
+	///  @param[in]		filter			The polygon filter to apply to the query.
+	///  @param[in,out]	neighbourhood	The polygons kept between the searches. (See: dtNavMeshNeighbourhood)
+	///  @param[out]	resultRef		The reference ids of the polygons touched by the circle.
+	///  @param[out]	resultParent	The reference ids of the parent polygons for each result. 
+	///  								Zero if a result polygon has no parent. [opt]
+	///  @param[out]	resultCount		The number of polygons found.
+	///  @param[in]		maxResult		The maximum number of polygons the result arrays can hold.
+	/// @returns The status flags for the query.
+	dtStatus findLocalNeighbourhood(dtPolyRef startRef, const float* centerPos, const float radius,
+									const dtQueryFilter* filter, dtNavMeshNeighbourhood* neighbourhood,
+									dtPolyRef* resultRef, dtPolyRef* resultParent,
+									int* resultCount, const int maxResult) const;
+
 	/// Moves from the start to the end position constrained to the navigation mesh.
 	///  @param[in]		startRef		The reference id of the start polygon.
 	///  @param[in]		startPos		A position of the mover within the start polygon. [(x, y, x)]
@@ -388,6 +657,13 @@ public:
 	dtStatus moveAlongSurface(dtPolyRef startRef, const float* startPos, const float* endPos,
 							  const dtQueryFilter* filter,
 							  float* resultPos, dtPolyRef* visited, int* visitedCount, const int maxVisitedSize) const;
+
+	/// Moves a set of positions along the surface of the navigation mesh, and places 
+	/// the results on the surface of the last polygon visited by each move.
+	///  @param[in,out]	moves		The moves to process. [(move) * @p count]
+	///  @param[in]		count		The number of moves.
+	/// @returns The status flags for the batch. The status of each move is stored with the move.
+	dtStatus moveAlongSurfaceBatch(dtSurfaceMove* moves, const int count) const;
 	
 	/// Casts a 'walkability' ray along the surface of the navigation mesh from 
 	/// the start position toward the end position.
@@ -422,6 +698,18 @@ public:
 					 const dtQueryFilter* filter, const unsigned int options,
 					 dtRaycastHit* hit, dtPolyRef prevRef = 0) const;
 
+	/// Casts several 'walkability' rays along the surface of the navigation mesh at once.
+	///  @param[in]		startRefs	The reference ids of the start polygons. [Size: @p count]
+	///  @param[in]		startPos	Positions within the start polygons representing
+	///  							the start of the rays. [(x, y, z) * @p count]
+	///  @param[in]		endPos		The positions to cast the rays toward. [(x, y, z) * @p count]
+	///  @param[in]		count		The number of rays.
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	///  @param[in]		options		govern how the raycasts behave. See dtRaycastOptions
+	///  @param[out]	hits		The raycast hit structures which will be filled by the results. [Size: @p count]
+	/// @returns The status flags for the query.
+	dtStatus raycasts(const dtPolyRef* startRefs, const float* startPos, const float* endPos, const int count,
+					  const dtQueryFilter* filter, const unsigned int options, dtRaycastHit* hits) const;
 
 	/// Finds the distance from the specified position to the nearest polygon wall.
 	///  @param[in]		startRef		The reference id of the polygon containing @p centerPos.
@@ -436,6 +724,14 @@ public:
 	dtStatus findDistanceToWall(dtPolyRef startRef, const float* centerPos, const float maxRadius,
 								const dtQueryFilter* filter,
 								float* hitDist, float* hitPos, float* hitNormal) const;
+
+	/// Looks up the distance from the specified position to the nearest wall in the wall
+	/// distances of the tile, which is much faster than #findDistanceToWall.
+	///  @param[in]		ref				The reference id of the polygon containing @p pos.
+	///  @param[in]		pos				The position. [(x, y, z)]
+	///  @param[out]	dist			The interpolated distance to the nearest wall.
+	/// @returns The status flags for the query. Fails if the tile was built without wall distances.
+	dtStatus getWallDistance(dtPolyRef ref, const float* pos, float* dist) const;
 	
 	/// Returns the segments for the specified polygon, optionally including portals.
 	///  @param[in]		ref				The reference id of the polygon.
@@ -452,6 +748,7 @@ public:
 
 	/// Returns random location on navmesh.
 	/// Polygons are chosen weighted by area. The search runs in linear related to number of polygon.
+	/// Use #dtRandomPointIndex when many points are needed.
 	///  @param[in]		filter			The polygon filter to apply to the query.
 	///  @param[in]		frand			Function returning a random number [0..1).
 	///  @param[out]	randomRef		The reference id of the random location.
@@ -520,17 +817,49 @@ public:
 	/// @return The navigation mesh the query object is using.
 	const dtNavMesh* getAttachedNavMesh() const { return m_nav; }
 
+	/// Gets the work done by the queries since the statistics were last reset.
+	/// Only counted when compiled with DT_QUERY_STATS defined.
+	/// @return The query statistics.
+	const dtQueryStats& getStats() const { return m_stats; }
+
+	/// Resets the query statistics to zero.
+	void resetStats();
+
+	/// Gets the memory used by the query object and its node pools.
+	///  @param[out]	stats	The memory usage.
+	void getMemStats(dtNavMeshQueryMemStats* stats) const;
+
+	/// Gets the total memory used by the query object and its node pools. [Units: bytes]
+	size_t getMemUsed() const;
+
+	/// Sets the landmarks which improve the heuristic of the path searches.
+	///  @param[in]		landmarks	The landmarks of the attached navigation mesh, or null to
+	///  							use the straight line distance only.
+	/// @returns The status flags for the operation.
+	dtStatus setLandmarks(const dtNavMeshLandmarks* landmarks);
+
+	/// Gets the landmarks used by the path searches.
+	/// @return The landmarks, or null if none are set.
+	const dtNavMeshLandmarks* getLandmarks() const { return m_landmarks; }
+
 	/// @}
 	
 private:
 	// Explicitly disabled copy constructor and copy assignment operator
 	dtNavMeshQuery(const dtNavMeshQuery&);
 	dtNavMeshQuery& operator=(const dtNavMeshQuery&);
+
+	/// Frees the node pools and open lists.
+	void freeNodePools();
 	
 	/// Queries polygons within a tile.
 	void queryPolygonsInTile(const dtMeshTile* tile, const float* qmin, const float* qmax,
 							 const dtQueryFilter* filter, dtPolyQuery* query) const;
 
+	/// Updates the nearest polygon of a point if the specified polygon is closer.
+	void updateNearestPoly(const dtMeshTile* tile, const dtPolyRef ref, const float* center,
+						   float& nearestDistSqr, dtPolyRef& nearestRef, float* nearestPt, bool& overPoly) const;
+
 	/// Returns portal points between two polygons.
 	dtStatus getPortalPoints(dtPolyRef from, dtPolyRef to, float* left, float* right,
 							 unsigned char& fromType, unsigned char& toType) const;
@@ -538,6 +867,25 @@ private:
 							 dtPolyRef to, const dtPoly* toPoly, const dtMeshTile* toTile,
 							 float* left, float* right) const;
 	
+	/// Returns the portal points of a link of a polygon, without searching the link list for it.
+	dtStatus getLinkPortalPoints(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile,
+								 const unsigned int linkIdx, const dtPoly* toPoly, const dtMeshTile* toTile,
+								 float* left, float* right) const;
+
+	/// Makes the neighbourhood hold every polygon the searches of the circle can reach.
+	/// Returns false if it cannot hold them.
+	bool updateNeighbourhood(dtNavMeshNeighbourhood* neighbourhood, dtPolyRef startRef, const float* centerPos,
+							 const float radius, const dtQueryFilter* filter) const;
+
+	/// Adds a polygon to the next set of the neighbourhood, from the kept set if it is still valid.
+	bool addNeighbourhoodPoly(dtNavMeshNeighbourhood* neighbourhood, dtPolyRef ref, const dtQueryFilter* filter,
+							  const bool validate) const;
+
+	/// Returns the portal mid point of a link of a polygon, without searching the link list for it.
+	dtStatus getLinkMidPoint(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile,
+							 const unsigned int linkIdx, const dtPoly* toPoly, const dtMeshTile* toTile,
+							 float* mid) const;
+
 	/// Returns edge mid point between two polygons.
 	dtStatus getEdgeMidPoint(dtPolyRef from, dtPolyRef to, float* mid) const;
 	dtStatus getEdgeMidPoint(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile,
@@ -556,8 +904,37 @@ private:
 
 	// Gets the path leading to the specified end node.
 	dtStatus getPathToNode(struct dtNode* endNode, dtPolyRef* path, int* pathCount, int maxPath) const;
+
+	/// Copies the landmark distances of a polygon. Returns false if they are not known.
+	bool getLandmarkDistances(dtPolyRef ref, float* dists) const;
+
+	/// Returns the landmark lower bound of the path cost from a polygon to the goal distances.
+	float getLandmarkBound(const float* goalDists, dtPolyRef ref) const;
+
+	/// The state of a raycast between polygons.
+	struct dtRaycastState
+	{
+		dtPolyRef curRef, prevRef;
+		const dtMeshTile* tile, *prevTile;
+		const dtPoly* poly, *prevPoly;
+		float curPos[3];
+		int n;						///< The number of visited polygons stored.
+	};
+
+	/// Initializes the state of a raycast starting from the specified polygon.
+	void initRaycast(dtRaycastState& state, dtPolyRef startRef, const float* startPos,
+					 dtPolyRef prevRef, dtRaycastHit* hit) const;
+
+	/// Moves a raycast across the current polygon, given the intersection of the ray with it.
+	/// Returns false when the ray has ended or hit a wall.
+	bool advanceRaycast(dtRaycastState& state, const float* startPos, const float* endPos,
+						const dtQueryFilter* filter, const unsigned int options, dtRaycastHit* hit,
+						const float* verts, const int nv, const float tmax, const int segMax,
+						dtStatus& status) const;
 	
+	dtAllocator* m_allocator;			///< The allocator of the query memory.
 	const dtNavMesh* m_nav;				///< Pointer to navmesh data.
+	const dtNavMeshLandmarks* m_landmarks;	///< The landmarks of the path search heuristic.
 
 	struct dtQueryData
 	{
@@ -569,12 +946,71 @@ private:
 		const dtQueryFilter* filter;
 		unsigned int options;
 		float raycastLimitSqr;
+		struct dtNode* meetNodes[2];	///< The forward and backward nodes joining the best path of a bidirectional search.
+		float meetCost;					///< The cost of the best path found by a bidirectional search.
+		int direction;					///< The direction a bidirectional search expands next. (0 = forward, 1 = backward)
+		float goalDists[2][DT_MAX_LANDMARKS*2];	///< The landmark distances of the end and the start polygon.
+		bool hasGoalDists[2];			///< True if the landmark distances of the end or the start polygon are known.
+		const dtPolyRef* goalRefs;		///< The goal polygons of a multi-goal search, or null.
+		const float* goalPositions;		///< The goal positions of a multi-goal search.
+		int goalCount;					///< The number of goals of a multi-goal search.
+		int* resultGoals;				///< The cheapest goals found so far, sorted by cost.
+		float* resultCosts;				///< The costs of the cheapest goals found so far.
+		int resultCount;				///< The number of goals found so far.
+		int maxResult;					///< The number of goals after which a multi-goal search stops.
+		int goalIndex;					///< The result of a sliced multi-goal search.
+		float goalCost;					///< The cost of the result of a sliced multi-goal search.
 	};
 	dtQueryData m_query;				///< Sliced query state.
 
+	/// Initializes a unidirectional path search.
+	void initSearch(dtQueryData& query) const;
+
+	/// Expands up to @p maxIter nodes of a unidirectional path search.
+	dtStatus expandSearch(dtQueryData& query, const int maxIter, int* doneIters) const;
+
+	/// Initializes a multi-goal path search.
+	void initGoalSearch(dtQueryData& query) const;
+
+	/// Expands up to @p maxIter nodes of a multi-goal path search.
+	dtStatus expandGoalSearch(dtQueryData& query, const int maxIter, int* doneIters) const;
+
+	/// Validates the goals of a multi-goal path search.
+	bool validGoals(const dtPolyRef* goalRefs, const float* goalPositions, const int goalCount) const;
+
+	/// Gets the path to the best node of a unidirectional path search, following the raycast shortcuts.
+	void getShortcutPath(dtQueryData& query, dtPolyRef* path, int* pathCount, const int maxPath) const;
+
+	/// Initializes a bidirectional path search.
+	void initBidirectionalSearch(dtQueryData& query) const;
+
+	/// Expands the best open node of one direction of a bidirectional path search.
+	dtStatus expandBidirectionalSearch(dtQueryData& query, const int direction) const;
+
+	/// Returns true if a bidirectional path search is finished.
+	bool isBidirectionalSearchDone(const dtQueryData& query) const;
+
+	/// Gets the path through the meeting nodes of a bidirectional path search.
+	dtStatus getPathToMeeting(const dtQueryData& query, dtPolyRef* path, int* pathCount, int maxPath) const;
+
+	/// Counts a finished query in the statistics.
+	void countQuery(const dtStatus status, const int nodeCount) const;
+
+	/// Moves along the surface, the parameters have been validated.
+	dtStatus moveAlongSurfaceUnchecked(dtPolyRef startRef, const float* startPos, const float* endPos,
+									   const dtQueryFilter* filter, float* resultPos,
+									   dtPolyRef* visited, int* visitedCount, const int maxVisitedSize) const;
+
+	/// Gets the height of a polygon at a position, including off-mesh connections.
+	bool getPolyHeight(const dtMeshTile* tile, const dtPoly* poly, const float* pos, float* height) const;
+
+	mutable dtQueryStats m_stats;		///< The work done by the queries. (See: #DT_QUERY_STATS)
+
 	class dtNodePool* m_tinyNodePool;	///< Pointer to small node pool.
 	class dtNodePool* m_nodePool;		///< Pointer to node pool.
 	class dtNodeQueue* m_openList;		///< Pointer to open list queue.
+	class dtNodePool* m_backNodePool;	///< Pointer to node pool of the backward search.
+	class dtNodeQueue* m_backOpenList;	///< Pointer to open list queue of the backward search.
 };
 
 /// Allocates a query object using the Detour allocator.
@@ -46,10 +46,20 @@ struct dtNode
 
 static const int DT_MAX_STATES_PER_NODE = 1 << DT_NODE_STATE_BITS;	// number of extra states per node. See dtNode::state
 
+/// A node pool hash table slot. The key is stored in the slot so that
+/// lookups do not need to touch the nodes.
+struct dtNodePoolSlot
+{
+	dtPolyRef id;			///< The polygon ref of the node.
+	dtNodeIndex idx;		///< The index of the node.
+	unsigned char state;	///< The extra state of the node.
+	unsigned char gen;		///< The pool generation the slot was filled in. The slot is empty if it is not current.
+};
+
 class dtNodePool
 {
 public:
-	dtNodePool(int maxNodes, int hashSize);
+	dtNodePool(int maxNodes, int hashSize, dtAllocator* allocator = 0);
 	~dtNodePool();
 	void clear();
 
@@ -81,15 +91,16 @@ public:
 	{
 		return sizeof(*this) +
 			sizeof(dtNode)*m_maxNodes +
-			sizeof(dtNodeIndex)*m_maxNodes +
-			sizeof(dtNodeIndex)*m_hashSize;
+			sizeof(dtNodePoolSlot)*m_hashSize;
 	}
 	
 	inline int getMaxNodes() const { return m_maxNodes; }
 	
+	// The hash table is open addressed, each bucket holds at most one node.
+	// Iterating getFirst() and getNext() over all the buckets visits every node once.
 	inline int getHashSize() const { return m_hashSize; }
-	inline dtNodeIndex getFirst(int bucket) const { return m_first[bucket]; }
-	inline dtNodeIndex getNext(int i) const { return m_next[i]; }
+	inline dtNodeIndex getFirst(int bucket) const { return m_slots[bucket].gen == m_gen ? m_slots[bucket].idx : DT_NULL_IDX; }
+	inline dtNodeIndex getNext(int /*i*/) const { return DT_NULL_IDX; }
 	inline int getNodeCount() const { return m_nodeCount; }
 	
 private:
@@ -97,27 +108,43 @@ private:
 	dtNodePool(const dtNodePool&);
 	dtNodePool& operator=(const dtNodePool&);
 	
+	dtAllocator* m_allocator;
 	dtNode* m_nodes;
-	dtNodeIndex* m_first;
-	dtNodeIndex* m_next;
+	dtNodePoolSlot* m_slots;
 	const int m_maxNodes;
 	const int m_hashSize;
 	int m_nodeCount;
+	unsigned char m_gen;
+};
+
+// Define DT_NODE_QUEUE_ARITY to change the number of children per node of the open list heap.
+// Wider heaps are shallower, which makes push and modify cheaper, and the children of a node
+// share a cache line. Use 2 to get the classic binary heap.
+#ifndef DT_NODE_QUEUE_ARITY
+#define DT_NODE_QUEUE_ARITY 4
+#endif
+
+/// An open list entry. The key is stored next to the node so that
+/// the heap can be ordered without touching the nodes.
+struct dtNodeQueueEntry
+{
+	float total;		///< The sort key, a copy of dtNode::total.
+	dtNode* node;		///< The node.
 };
 
 class dtNodeQueue
 {
 public:
-	dtNodeQueue(int n);
+	dtNodeQueue(int n, dtAllocator* allocator = 0);
 	~dtNodeQueue();
 	
 	inline void clear() { m_size = 0; }
 	
-	inline dtNode* top() { return m_heap[0]; }
+	inline dtNode* top() { return m_heap[0].node; }
 	
 	inline dtNode* pop()
 	{
-		dtNode* result = m_heap[0];
+		dtNode* result = m_heap[0].node;
 		m_size--;
 		trickleDown(0, m_heap[m_size]);
 		return result;
@@ -125,17 +152,23 @@ public:
 	
 	inline void push(dtNode* node)
 	{
+		dtNodeQueueEntry entry;
+		entry.total = node->total;
+		entry.node = node;
 		m_size++;
-		bubbleUp(m_size-1, node);
+		bubbleUp(m_size-1, entry);
 	}
 	
 	inline void modify(dtNode* node)
 	{
 		for (int i = 0; i < m_size; ++i)
 		{
-			if (m_heap[i] == node)
+			if (m_heap[i].node == node)
 			{
-				bubbleUp(i, node);
+				dtNodeQueueEntry entry;
+				entry.total = node->total;
+				entry.node = node;
+				bubbleUp(i, entry);
 				return;
 			}
 		}
@@ -146,7 +179,7 @@ public:
 	inline int getMemUsed() const
 	{
 		return sizeof(*this) +
-		sizeof(dtNode*) * (m_capacity + 1);
+		sizeof(dtNodeQueueEntry) * (m_capacity + 1);
 	}
 	
 	inline int getCapacity() const { return m_capacity; }
@@ -156,10 +189,11 @@ private:
 	dtNodeQueue(const dtNodeQueue&);
 	dtNodeQueue& operator=(const dtNodeQueue&);
 
-	void bubbleUp(int i, dtNode* node);
-	void trickleDown(int i, dtNode* node);
+	void bubbleUp(int i, const dtNodeQueueEntry& entry);
+	void trickleDown(int i, const dtNodeQueueEntry& entry);
 	
-	dtNode** m_heap;
+	dtAllocator* m_allocator;
+	dtNodeQueueEntry* m_heap;
 	const int m_capacity;
 	int m_size;
 };		
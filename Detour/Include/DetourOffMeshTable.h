@@ -0,0 +1,179 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#ifndef DETOUROFFMESHTABLE_H
+#define DETOUROFFMESHTABLE_H
+
+#include "DetourNavMesh.h"
+#include "DetourStatus.h"
+#include "DetourTileRefTracker.h"
+
+class dtQueryFilter;
+
+/// The precomputed traversal data of an off-mesh connection.
+/// @see dtOffMeshConnectionTable
+struct dtOffMeshConnectionEntry
+{
+	dtPolyRef ref;				///< The polygon reference of the connection.
+	dtPolyRef startRef;			///< The polygon the start point is linked to, or zero if it is not connected.
+	dtPolyRef endRef;			///< The polygon the end point is linked to, or zero if it is not connected.
+	float startPos[3];			///< The start point of the connection. [(x, y, z)]
+	float endPos[3];			///< The end point of the connection. [(x, y, z)]
+	float length;				///< The distance between the endpoints. [Units: wu]
+	float cost[2];				///< The cost of the traversal from the start to the end, and from the end to the start.
+	unsigned int userId;		///< The user id of the connection.
+	unsigned short flags;		///< The polygon flags of the connection.
+	unsigned char area;			///< The area id of the connection.
+	unsigned char bidir;		///< Non-zero if the connection can be traversed in both directions.
+};
+
+/// The off-mesh connections of a single navigation mesh tile.
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtOffMeshConnectionTable
+struct dtOffMeshConnectionTile
+{
+	dtTileRef ref;						///< The tile the entries were built from. (Zero if not built.)
+	unsigned int generation;			///< The tile generation the entries were built at.
+	unsigned int salt;					///< The salt of the tile.
+	int polyBase;						///< The index of the first off-mesh connection polygon in the tile.
+	dtOffMeshConnectionEntry* cons;		///< The entries of the connections. [Size: conCount]
+	int conCount;						///< The number of connections.
+};
+
+/// Keeps the endpoints and traversal costs of the off-mesh connections of a navigation mesh,
+/// indexed by polygon reference.
+/// @ingroup detour
+class dtOffMeshConnectionTable
+{
+public:
+	dtOffMeshConnectionTable();
+	~dtOffMeshConnectionTable();
+
+	/// Initializes the table.
+	///  @param[in]		nav			The navigation mesh of the connections.
+	///  @param[in]		filter		The filter used to compute the traversal costs, or null to use
+	///  							the lengths of the connections. Must stay valid while the table is used. [opt]
+	/// @returns The status flags for the operation.
+	dtStatus init(const dtNavMesh* nav, const dtQueryFilter* filter);
+
+	/// Builds the entries of the tiles that were added, removed, replaced or had
+	/// their polygon flags or areas changed since the previous update.
+	///  @param[out]	updatedTileCount	The number of tiles that were rebuilt. [opt]
+	/// @returns The status flags for the operation.
+	dtStatus update(int* updatedTileCount = 0);
+
+	/// Marks all tiles to be rebuilt by the next #update, for example after the
+	/// area costs of the filter were changed.
+	void invalidate();
+
+	/// Gets the entry of an off-mesh connection.
+	///  @param[in]		ref			The polygon reference of the off-mesh connection.
+	/// @returns The entry, or null if the reference is not an off-mesh connection or the table is out of date.
+	const dtOffMeshConnectionEntry* getConnection(dtPolyRef ref) const;
+
+	/// Gets the endpoints of an off-mesh connection, ordered for the direction of travel.
+	/// The result is the same as dtNavMesh::getOffMeshConnectionPolyEndPoints.
+	///  @param[in]		prevRef		The reference of the polygon before the connection.
+	///  @param[in]		ref			The polygon reference of the off-mesh connection.
+	///  @param[out]	startPos	The start position of the traversal. [(x, y, z)]
+	///  @param[out]	endPos		The end position of the traversal. [(x, y, z)]
+	/// @returns The status flags for the query.
+	dtStatus getEndPoints(dtPolyRef prevRef, dtPolyRef ref, float* startPos, float* endPos) const;
+
+	/// Gets the traversal cost of an off-mesh connection entered from the specified polygon.
+	///  @param[in]		prevRef		The reference of the polygon before the connection.
+	///  @param[in]		ref			The polygon reference of the off-mesh connection.
+	///  @param[out]	cost		The cost of the traversal.
+	/// @returns The status flags for the query.
+	dtStatus getCost(dtPolyRef prevRef, dtPolyRef ref, float* cost) const;
+
+	/// Gets the number of off-mesh connections in the table.
+	/// @returns The number of connections.
+	int getConnectionCount() const { return m_conCount; }
+
+	/// Gets the connections of the tile at the specified index.
+	///  @param[in]		i			The tile index. [Limit: 0 >= index < dtNavMesh::getMaxTiles()]
+	/// @returns The connections of the tile.
+	const dtOffMeshConnectionTile* getTile(int i) const;
+
+	/// Gets the navigation mesh the table was built for.
+	/// @returns The navigation mesh the table was built for.
+	const dtNavMesh* getAttachedNavMesh() const { return m_nav; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtOffMeshConnectionTable(const dtOffMeshConnectionTable&);
+	dtOffMeshConnectionTable& operator=(const dtOffMeshConnectionTable&);
+
+	/// Fills the entries of a tile from its current links and polygons.
+	void buildEntries(const dtMeshTile* tile, dtOffMeshConnectionTile& ctile) const;
+
+	/// Frees the entries of a tile.
+	void freeTile(dtOffMeshConnectionTile& ctile);
+
+	const dtNavMesh* m_nav;				///< The navigation mesh.
+	const dtQueryFilter* m_filter;		///< The filter of the traversal costs, or null.
+	dtOffMeshConnectionTile* m_tiles;	///< The connections of the tiles. [Size: dtNavMesh::getMaxTiles()]
+	int m_maxTiles;						///< The number of tiles.
+	int m_conCount;						///< The number of connections in all tiles.
+	dtTileRefTracker m_tracker;			///< Finds the tiles changed since the previous update.
+};
+
+/// Allocates an off-mesh connection table object using the Detour allocator.
+/// @return An off-mesh connection table that is ready for initialization, or null on failure.
+///  @ingroup detour
+dtOffMeshConnectionTable* dtAllocOffMeshConnectionTable();
+
+/// Frees the specified off-mesh connection table object using the Detour allocator.
+///  @param[in]		table		An off-mesh connection table allocated using #dtAllocOffMeshConnectionTable
+///  @ingroup detour
+void dtFreeOffMeshConnectionTable(dtOffMeshConnectionTable* table);
+
+#endif // DETOUROFFMESHTABLE_H
+
+///////////////////////////////////////////////////////////////////////////
+
+// This section contains detailed documentation for members that don't have
+// a source file. It reduces clutter in the main section of the header.
+
+/**
+
+@class dtOffMeshConnectionTable
+
+dtNavMesh::getOffMeshConnectionPolyEndPoints decodes the reference, validates
+the tile and walks the links of the connection polygon on every call, and the
+traversal cost has to be evaluated with the filter each time. The table keeps
+one entry per off-mesh connection with the endpoints, the polygons they are
+linked to, and the costs of both directions, stored by tile in the order of
+the connection polygons. A lookup is a reference decode and an array access.
+
+The table is incremental. Call #update after tiles have been added or removed,
+or polygon flags or areas changed. Tiles that were added or changed are
+rebuilt. When tiles were added or removed, the links of the connections of
+the other tiles are read again, since a connection may land in a neighbour.
+
+Lookups fail until the next #update once tiles have been added or removed,
+and for the connections of a tile whose flags or areas changed. The filter
+costs are computed with the polygons the endpoints are linked to, a custom
+filter which depends on the state of those polygons needs #invalidate after
+they change.
+
+@see dtNavMesh::getOffMeshConnectionPolyEndPoints, dtCrowd::setOffMeshConnectionTable
+
+*/
@@ -0,0 +1,197 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#ifndef DETOURQUERYSERVICE_H
+#define DETOURQUERYSERVICE_H
+
+#include "DetourAlloc.h"
+#include "DetourJobDispatcher.h"
+#include "DetourNavMesh.h"
+#include "DetourStatus.h"
+
+class dtNavMeshQuery;
+class dtQueryFilter;
+
+/// The kinds of requests run by a #dtQueryService.
+enum dtQueryRequestType
+{
+	DT_QUERY_FIND_PATH = 0,			///< dtNavMeshQuery::findPath from the start to the end.
+	DT_QUERY_RAYCAST,				///< dtNavMeshQuery::raycast from the start toward the end.
+	DT_QUERY_FIND_NEAREST_POLY,		///< dtNavMeshQuery::findNearestPoly around the start position.
+	DT_QUERY_FIND_DISTANCES			///< dtNavMeshQuery::findDistances from the start to the targets.
+};
+
+struct dtQueryRequest;
+
+/// A function called on the worker thread once a request has completed.
+///  @param[in]		request		The completed request.
+///  @param[in]		userData	The user data of the request.
+typedef void (*dtQueryRequestCallback)(dtQueryRequest* request, void* userData);
+
+/// A request run by a #dtQueryService. Only the fields used by the type of the request need to be set.
+/// @ingroup detour
+struct dtQueryRequest
+{
+	/// @name Input
+	/// @{
+	int type;						///< The kind of request. (See: #dtQueryRequestType)
+	const dtQueryFilter* filter;	///< The polygon filter of the query.
+	unsigned int options;			///< The path (#dtFindPathOptions) or raycast (#dtRaycastOptions) options.
+	dtPolyRef startRef;				///< The start polygon of a path or raycast.
+	dtPolyRef endRef;				///< The end polygon of a path.
+	float startPos[3];				///< The start of a path or raycast, or the center of a nearest polygon search. [(x, y, z)]
+	float endPos[3];				///< The end of a path or raycast. [(x, y, z)]
+	float halfExtents[3];			///< The search distance of a nearest polygon search along each axis. [(x, y, z)]
+	const dtPolyRef* targetRefs;	///< The target polygons of a distance search. [Size: #targetCount]
+	const float* targetPositions;	///< A position within each target polygon of a distance search. [opt] [(x, y, z) * #targetCount]
+	int targetCount;				///< The number of targets of a distance search.
+	float maxCost;					///< The search cost beyond which the targets of a distance search are not reached.
+	float* costs;					///< The search cost to each target, or FLT_MAX if it was not reached. [Size: #targetCount]
+	dtPolyRef* path;				///< The path, or the visited polygons of a raycast. [opt for raycasts] [Size: #maxPath]
+	int maxPath;					///< The maximum number of polygons #path can hold.
+	dtQueryRequestCallback callback;	///< Called on the worker once the request has completed. [opt]
+	void* userData;					///< The user data passed to #callback.
+	/// @}
+
+	/// @name Output
+	/// @{
+	dtStatus status;				///< The status of the query.
+	int pathCount;					///< The number of polygons in #path.
+	float t;						///< The raycast hit parameter. (FLT_MAX if no wall was hit.)
+	float hitNormal[3];				///< The normal of the wall hit by the raycast. [(x, y, z)]
+	dtPolyRef nearestRef;			///< The nearest polygon, or zero if none was found.
+	float nearestPt[3];				///< The nearest point on #nearestRef. [(x, y, z)]
+	int reachedCount;				///< The number of targets reached by a distance search.
+	/// @}
+};
+
+/// Runs batches of path, raycast, nearest polygon and distance requests on a pool of
+/// navigation mesh queries, one local and one path query per worker.
+/// @ingroup detour
+class dtQueryService
+{
+public:
+	dtQueryService();
+	~dtQueryService();
+
+	/// Initializes the service.
+	///  @param[in]		nav				The navigation mesh to query.
+	///  @param[in]		workerCount		The number of workers. [Limit: >= 1]
+	///  @param[in]		localMaxNodes	The search nodes of the local queries. [Limits: 0 < value <= 65535]
+	///  @param[in]		pathMaxNodes	The search nodes of the path queries. [Limits: 0 < value <= 65535]
+	///  @param[in]		allocator		The allocator of the service memory. Must outlive the service. [opt]
+	/// @returns The status flags for the operation.
+	dtStatus init(const dtNavMesh* nav, const int workerCount, const int localMaxNodes, const int pathMaxNodes,
+				  dtAllocator* allocator = 0);
+
+	/// Sets the dispatcher used to run the requests on several workers.
+	///  @param[in]		dispatcher	The dispatcher, or null to run the requests serially. Must stay valid while set.
+	/// @returns The status flags for the operation. Fails if the dispatcher has more workers than the service.
+	dtStatus setJobDispatcher(dtJobDispatcher* dispatcher);
+
+	/// Sets the distance below which paths are searched with the local query first.
+	/// A path which runs out of local search nodes is searched again with the path query.
+	///  @param[in]		dist		The distance between the path ends. [Limit: >= 0] [Units: wu]
+	void setLocalPathDistance(const float dist) { m_localPathDist = dist; }
+
+	/// The distance below which paths are searched with the local query first. [Units: wu]
+	float getLocalPathDistance() const { return m_localPathDist; }
+
+	/// Runs the requests and returns once all of them have completed.
+	///  @param[in,out]	requests	The requests. [Size: @p count]
+	///  @param[in]		count		The number of requests.
+	/// @returns The status flags for the operation. Fails only if the service is not initialized,
+	/// the status of each request is in dtQueryRequest::status.
+	dtStatus run(dtQueryRequest* requests, const int count);
+
+	/// The number of workers.
+	int getWorkerCount() const { return m_workerCount; }
+
+	/// Gets the local query of a worker, used for the raycasts, the nearest polygon searches and the short paths.
+	///  @param[in]		worker		The worker index. [Limits: 0 <= value < #getWorkerCount]
+	const dtNavMeshQuery* getLocalQuery(const int worker) const { return m_localQueries[worker]; }
+
+	/// Gets the path query of a worker, used for the paths.
+	///  @param[in]		worker		The worker index. [Limits: 0 <= value < #getWorkerCount]
+	const dtNavMeshQuery* getPathQuery(const int worker) const { return m_pathQueries[worker]; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtQueryService(const dtQueryService&);
+	dtQueryService& operator=(const dtQueryService&);
+
+	void purge();
+	void runRequest(dtQueryRequest& request, const int worker) const;
+	static void runJob(void* userData, const int jobIndex, const int workerIndex);
+
+	dtAllocator* m_allocator;
+	dtJobDispatcher* m_dispatcher;
+	int m_workerCount;
+	dtNavMeshQuery** m_localQueries;	///< The local queries. [Size: #m_workerCount]
+	dtNavMeshQuery** m_pathQueries;		///< The path queries. [Size: #m_workerCount]
+	float m_localPathDist;
+
+	dtQueryRequest* m_requests;			///< The requests of the current run.
+	int m_requestCount;
+	int m_jobCount;
+};
+
+/// Allocates a query service object using the Detour allocator.
+/// @return A query service that is ready for initialization, or null on failure.
+///  @ingroup detour
+dtQueryService* dtAllocQueryService();
+
+/// Frees the specified query service object using the Detour allocator.
+///  @param[in]		service		A query service allocated using #dtAllocQueryService
+///  @ingroup detour
+void dtFreeQueryService(dtQueryService* service);
+
+#endif // DETOURQUERYSERVICE_H
+
+///////////////////////////////////////////////////////////////////////////
+
+// This section contains detailed documentation for members that don't have
+// a source file. It reduces clutter in the main section of the header.
+
+/**
+
+@class dtQueryService
+
+Engines usually keep a query per worker thread and queue their path, raycast
+and nearest polygon requests to them. The service owns those queries. Each
+worker has a local query with a small node pool, and a path query with a
+large one, so that the workers do not all pay for the memory of the longest
+searches on every query.
+
+A batch passed to #run is split into several jobs per worker. Each job takes
+every n-th request, so that neighbouring expensive requests end up in
+different jobs, and a dispatcher which hands out jobs to idle workers keeps
+them all busy. Without a dispatcher, the requests run on the calling thread
+with the queries of worker zero.
+
+A distance matrix is a batch of #DT_QUERY_FIND_DISTANCES requests, one per
+row, each searching from one source to all the targets. The rows run on the
+path queries of the workers in parallel.
+
+The queries read the navigation mesh concurrently, so the mesh must not be
+changed during #run.
+
+@see dtNavMeshQuery, dtJobDispatcher
+
+*/
@@ -0,0 +1,145 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#ifndef DETOURRANDOMPOINTINDEX_H
+#define DETOURRANDOMPOINTINDEX_H
+
+#include "DetourNavMesh.h"
+#include "DetourStatus.h"
+#include "DetourTileRefTracker.h"
+
+class dtNavMeshQuery;
+class dtQueryFilter;
+
+/// The sampling distribution of the polygons of a single navigation mesh tile.
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtRandomPointIndex
+struct dtRandomPointTile
+{
+	dtTileRef ref;				///< The tile the distribution was built from. (Zero if not built.)
+	unsigned short* polys;		///< The indices of the polygons which pass the filter. [Size: polyCount]
+	float* areas;				///< The running sum of the polygon areas. [Size: polyCount]
+	int polyCount;				///< The number of polygons.
+};
+
+/// Finds random points on a navigation mesh in logarithmic time.
+/// @ingroup detour
+class dtRandomPointIndex
+{
+public:
+	dtRandomPointIndex();
+	~dtRandomPointIndex();
+
+	/// Initializes the index.
+	///  @param[in]		nav			The navigation mesh to sample.
+	///  @param[in]		filter		The filter the polygons must pass. Must stay valid while the index is used.
+	/// @returns The status flags for the operation.
+	dtStatus init(const dtNavMesh* nav, const dtQueryFilter* filter);
+
+	/// Builds the distribution of the tiles that were added, removed or replaced,
+	/// or had their polygon flags or areas changed, since the previous update.
+	///  @param[out]	updatedTileCount	The number of tiles that were rebuilt. [opt]
+	/// @returns The status flags for the operation.
+	dtStatus update(int* updatedTileCount = 0);
+
+	/// Marks all tiles to be rebuilt by the next #update, for example after the
+	/// filter was changed.
+	void invalidate();
+
+	/// Returns random location on navmesh.
+	/// Polygons are chosen weighted by area across all tiles.
+	///  @param[in]		query			The query used to place the point on the detail mesh.
+	///  @param[in]		frand			Function returning a random number [0..1).
+	///  @param[out]	randomRef		The reference id of the random location.
+	///  @param[out]	randomPt		The random location. [(x, y, z)]
+	/// @returns The status flags for the query.
+	dtStatus findRandomPoint(const dtNavMeshQuery* query, float (*frand)(),
+							 dtPolyRef* randomRef, float* randomPt) const;
+
+	/// The total area of the polygons in the index. [Units: wu^2]
+	/// @returns The total area.
+	float getTotalArea() const { return m_tileCount ? m_tileAreas[m_tileCount-1] : 0.0f; }
+
+	/// Gets the distribution of the tile at the specified index.
+	///  @param[in]		i			The tile index. [Limit: 0 >= index < dtNavMesh::getMaxTiles()]
+	/// @returns The distribution of the tile.
+	const dtRandomPointTile* getTile(int i) const;
+
+	/// Gets the navigation mesh the index was built for.
+	/// @returns The navigation mesh the index was built for.
+	const dtNavMesh* getAttachedNavMesh() const { return m_nav; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtRandomPointIndex(const dtRandomPointIndex&);
+	dtRandomPointIndex& operator=(const dtRandomPointIndex&);
+
+	/// Builds the polygon distribution of a tile.
+	bool buildTile(const dtMeshTile* tile, dtRandomPointTile& rtile);
+
+	/// Frees the polygon distribution of a tile.
+	void freeTile(dtRandomPointTile& rtile);
+
+	const dtNavMesh* m_nav;				///< The navigation mesh.
+	const dtQueryFilter* m_filter;		///< The filter the polygons must pass.
+	dtRandomPointTile* m_tiles;			///< The distributions of the tiles. [Size: dtNavMesh::getMaxTiles()]
+	int m_maxTiles;						///< The number of tiles.
+	dtTileRefTracker m_tracker;			///< Finds the tiles changed since the previous update.
+
+	int* m_tileIndices;					///< The indices of the tiles with a non-zero area. [Size: #m_tileCount]
+	float* m_tileAreas;					///< The running sum of the tile areas. [Size: #m_tileCount]
+	int m_tileCount;					///< The number of tiles with a non-zero area.
+};
+
+/// Allocates a random point index object using the Detour allocator.
+/// @return A random point index that is ready for initialization, or null on failure.
+///  @ingroup detour
+dtRandomPointIndex* dtAllocRandomPointIndex();
+
+/// Frees the specified random point index object using the Detour allocator.
+///  @param[in]		index		A random point index allocated using #dtAllocRandomPointIndex
+///  @ingroup detour
+void dtFreeRandomPointIndex(dtRandomPointIndex* index);
+
+#endif // DETOURRANDOMPOINTINDEX_H
+
+///////////////////////////////////////////////////////////////////////////
+
+// This section contains detailed documentation for members that don't have
+// a source file. It reduces clutter in the main section of the header.
+
+/**
+
+@class dtRandomPointIndex
+
+dtNavMeshQuery::findRandomPoint visits every tile slot and every polygon of
+the chosen tile on each call, and picks tiles with equal weight. The index
+instead keeps the running sums of the polygon areas of each tile, and of the
+tile areas, for the polygons which pass its filter. A point is then found with
+two binary searches, and is uniformly distributed over the area of the mesh.
+
+The index is incremental. Call #update after tiles have been added or
+removed, or polygon flags or areas changed, for example after
+dtTileCache::update. Only the tiles that changed are rebuilt.
+
+Off-mesh connections are never returned.
+
+@see dtNavMeshQuery::findRandomPoint
+
+*/
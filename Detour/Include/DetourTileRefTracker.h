@@ -0,0 +1,146 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURTILEREFTRACKER_H
+#define DETOURTILEREFTRACKER_H
+
+#include <string.h>
+#include "DetourAlloc.h"
+#include "DetourNavMesh.h"
+#include "DetourStatus.h"
+
+/// Finds the tiles of a navigation mesh which changed since they were last
+/// processed, for the structures which keep data per tile.
+/// @ingroup detour
+class dtTileRefTracker
+{
+public:
+	dtTileRefTracker();
+	~dtTileRefTracker();
+
+	/// Sets the navigation mesh to track. All its tiles are reported as changed
+	/// by the next #update.
+	///  @param[in]		nav					The navigation mesh to track.
+	///  @param[in]		trackGenerations	True to also report the tiles whose polygon flags or areas changed.
+	void init(const dtNavMesh* nav, const bool trackGenerations);
+
+	/// Returns true if the navigation mesh has not changed since the previous #commit.
+	/// @return True if there are no changed tiles.
+	bool isUpToDate() const;
+
+	/// Returns true if no tiles were added or removed since the previous #commit.
+	/// @return True if the epoch of the navigation mesh is the committed one.
+	bool isEpochUpToDate() const;
+
+	/// Finds the tiles which changed since the previous #commit.
+	/// @returns The status flags for the operation.
+	dtStatus update();
+
+	/// Records the tiles found by the previous #update as processed.
+	void commit();
+
+	/// Reports all tiles as changed by the next #update.
+	void invalidate();
+
+	/// Returns true if tiles were added or removed between the previous #commit and
+	/// the previous #update, rather than only having their polygon flags or areas changed.
+	/// @return True if the epoch of the navigation mesh changed.
+	bool hasEpochChanged() const { return !m_committed || m_scanEpoch != m_epoch; }
+
+	/// The number of tiles of the navigation mesh as of the previous #update.
+	/// @return The number of tiles.
+	int getMaxTiles() const { return m_maxTiles; }
+
+	/// The number of tiles found by the previous #update.
+	/// @return The number of changed tiles.
+	int getChangedTileCount() const { return m_changedCount; }
+
+	/// Gets the index of a tile found by the previous #update.
+	///  @param[in]		i		The index of the changed tile. [Limit: 0 <= i < #getChangedTileCount]
+	/// @return The tile index.
+	int getChangedTile(const int i) const { return m_changed[i]; }
+
+	/// Gets the reference of the tile at the index if it is in use, or zero.
+	///  @param[in]		i		The tile index. [Limit: 0 <= i < #getMaxTiles]
+	/// @return The tile reference.
+	dtTileRef getTileRef(const int i) const;
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtTileRefTracker(const dtTileRefTracker&);
+	dtTileRefTracker& operator=(const dtTileRefTracker&);
+
+	const dtNavMesh* m_nav;			///< The tracked navigation mesh.
+	bool m_trackGenerations;		///< True if the changes of the tile generations are reported.
+	dtTileRef* m_refs;				///< The tile references of the previous commit. [Size: #m_maxTiles]
+	unsigned int* m_generations;	///< The tile generations of the previous commit. [Size: #m_maxTiles]
+	int* m_changed;					///< The indices of the changed tiles. [Size: #m_changedCount]
+	int m_changedCount;				///< The number of changed tiles.
+	int m_maxTiles;					///< The number of tiles.
+	unsigned int m_epoch;			///< The navigation mesh epoch of the previous commit.
+	unsigned int m_generation;		///< The navigation mesh generation of the previous commit.
+	unsigned int m_scanEpoch;		///< The navigation mesh epoch of the previous update.
+	unsigned int m_scanGeneration;	///< The navigation mesh generation of the previous update.
+	bool m_committed;				///< True once the tiles were committed after #init or #invalidate.
+};
+
+/// Grows a table with an entry per tile, keeping the existing entries and zeroing the new ones.
+///  @param[in,out]	table		The table.
+///  @param[in]		count		The number of entries of the table.
+///  @param[in]		maxTiles	The number of tiles the table must hold.
+/// @return False if out of memory, the table is then unchanged.
+template<class T> bool dtGrowTileTable(T*& table, const int count, const int maxTiles)
+{
+	if (maxTiles <= count)
+		return true;
+	T* grown = (T*)dtAlloc(sizeof(T)*maxTiles, DT_ALLOC_PERM);
+	if (!grown)
+		return false;
+	memset((void*)grown, 0, sizeof(T)*maxTiles);
+	if (count)
+		memcpy((void*)grown, table, sizeof(T)*count);
+	dtFree(table);
+	table = grown;
+	return true;
+}
+
+#endif // DETOURTILEREFTRACKER_H
+
+///////////////////////////////////////////////////////////////////////////
+
+// This section contains detailed documentation for members that don't have
+// a source file. It reduces clutter in the main section of the header.
+
+/**
+
+@class dtTileRefTracker
+
+A tile is reported as changed when its tile reference changes, so tiles
+which were removed and added again at the same location are found too. With
+generation tracking, tiles whose polygon flags or areas were changed are
+reported as well. (See: dtMeshTile::generation)
+
+Call #update, process the changed tiles, and then #commit. If processing
+fails, skip the #commit, and the same tiles are reported again by the next
+#update. The tracker is cheap to check when the navigation mesh has not
+changed, so the structures using it can be updated every frame.
+
+Navigation meshes with sparse tiles allocate more tiles as they are added,
+use dtGrowTileTable to grow the tables of the tile data to #getMaxTiles.
+
+*/
@@ -0,0 +1,227 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURTILESTREAMER_H
+#define DETOURTILESTREAMER_H
+
+#include <stddef.h>
+#include "DetourNavMesh.h"
+#include "DetourStatus.h"
+
+/// The state of a tile load reported by dtTileSource::pollTile.
+/// @ingroup detour
+enum dtTileSourceState
+{
+	DT_TILE_SOURCE_PENDING,		///< The tile is still loading.
+	DT_TILE_SOURCE_READY,		///< The tile data is ready.
+	DT_TILE_SOURCE_MISSING,		///< There is no tile at the location.
+	DT_TILE_SOURCE_FAILED		///< The tile could not be loaded.
+};
+
+/// Provides the tile data streamed by a #dtTileStreamer, e.g. from a file,
+/// a memory mapped navigation mesh file or the network.
+///
+/// Loads are asynchronous: #requestTile starts a load and #pollTile is called
+/// on later updates until the load completes. A source that loads tiles
+/// synchronously can return the data from the first poll.
+/// @ingroup detour
+class dtTileSource
+{
+public:
+	virtual ~dtTileSource() {}
+
+	/// Starts loading the tile at the specified location.
+	///  @param[in]		tx			The x-location of the tile.
+	///  @param[in]		ty			The y-location of the tile.
+	/// @return False if the load could not be started. It is requested again on a later update.
+	virtual bool requestTile(const int tx, const int ty) = 0;
+
+	/// Polls the state of a requested tile.
+	///  @param[in]		tx			The x-location of the tile.
+	///  @param[in]		ty			The y-location of the tile.
+	///  @param[out]	data		The tile data. (If the tile is ready.)
+	///  @param[out]	dataSize	The size of the tile data. (If the tile is ready.)
+	///  @param[out]	changed		True if the data differs from the previous time the tile was loaded. (If the tile is ready.)
+	/// @return The state of the load.
+	virtual dtTileSourceState pollTile(const int tx, const int ty, unsigned char** data, int* dataSize, bool* changed) = 0;
+
+	/// Cancels the load of a tile that is no longer needed.
+	///  @param[in]		tx			The x-location of the tile.
+	///  @param[in]		ty			The y-location of the tile.
+	virtual void cancelTile(const int /*tx*/, const int /*ty*/) {}
+
+	/// Frees the data of a tile that was unloaded.
+	///  @param[in]		data		The tile data returned by #pollTile.
+	///  @param[in]		dataSize	The size of the tile data.
+	virtual void freeTile(unsigned char* data, const int /*dataSize*/) { dtFree(data); }
+};
+
+/// Configuration parameters used to define the working set of a #dtTileStreamer.
+/// @ingroup detour
+struct dtTileStreamerParams
+{
+	float loadRadius;			///< Tiles closer than this to a focus point are loaded. [Unit: wu] [Limit: > 0]
+	float unloadRadius;			///< Tiles farther than this from all focus points are unloaded. [Unit: wu] [Limit: >= loadRadius]
+	size_t maxResidentBytes;	///< The maximum size of the loaded tile data. (Zero for no limit.)
+	int maxPendingLoads;		///< The maximum number of tile loads in flight. [Limit: > 0]
+	int maxEntries;				///< The number of tile locations tracked, including unloaded ones. [Limit: >= dtNavMesh::getMaxTiles()]
+	int maxLinkedTilesPerUpdate;	///< The maximum number of loaded tiles connected to their neighbours per update. (Zero to connect them as they are added.) [Limit: >= 0]
+};
+
+/// Keeps the tiles of a navigation mesh around a set of focus points loaded.
+/// @ingroup detour
+class dtTileStreamer
+{
+public:
+	dtTileStreamer();
+	~dtTileStreamer();
+
+	/// Initializes the streamer.
+	///  @param[in]		nav			The navigation mesh to stream. Must not be using deferred tile release.
+	///  @param[in]		source		The tile source. Must stay valid while the streamer is used.
+	///  @param[in]		params		The streaming parameters.
+	/// @return The status flags for the operation.
+	dtStatus init(dtNavMesh* nav, dtTileSource* source, const dtTileStreamerParams* params);
+
+	/// Completes pending loads, unloads tiles outside of the working set and
+	/// requests the missing tiles nearest to the focus points.
+	///  @param[in]		focusPoints		The focus points. [(x, y, z) * @p focusCount]
+	///  @param[in]		focusCount		The number of focus points.
+	///  @param[out]	loadedTiles		The number of tiles added to the navigation mesh. [opt]
+	///  @param[out]	unloadedTiles	The number of tiles removed from the navigation mesh. [opt]
+	/// @return The status flags for the operation.
+	dtStatus update(const float* focusPoints, const int focusCount, int* loadedTiles = 0, int* unloadedTiles = 0);
+
+	/// Removes all streamed tiles from the navigation mesh and cancels the pending loads.
+	void unloadAll();
+
+	/// Sets the maximum size of the loaded tile data.
+	///  @param[in]		maxBytes	The maximum size of the loaded tile data. (Zero for no limit.)
+	void setMaxResidentBytes(const size_t maxBytes) { m_params.maxResidentBytes = maxBytes; }
+
+	/// The size of the loaded tile data.
+	size_t getResidentBytes() const { return m_residentBytes; }
+
+	/// The number of loaded tiles.
+	int getResidentTileCount() const { return m_residentCount; }
+
+	/// The number of tile loads in flight.
+	int getPendingLoadCount() const { return m_pendingCount; }
+
+	/// The streaming parameters.
+	const dtTileStreamerParams* getParams() const { return &m_params; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtTileStreamer(const dtTileStreamer&);
+	dtTileStreamer& operator=(const dtTileStreamer&);
+
+	enum EntryState
+	{
+		ENTRY_FREE,
+		ENTRY_UNLOADED,		///< Not loaded, remembers the last tile reference.
+		ENTRY_PENDING,		///< Requested from the source.
+		ENTRY_RESIDENT,		///< Added to the navigation mesh.
+		ENTRY_MISSING,		///< The source has no tile at the location.
+		ENTRY_EVICTED		///< Unloaded to stay within the memory budget.
+	};
+
+	struct Entry
+	{
+		int tx, ty;
+		dtTileRef ref;			///< The tile reference while resident, the last reference otherwise.
+		unsigned char* data;
+		int dataSize;
+		int next;				///< The next entry in the same bucket, or the free list.
+		unsigned char state;
+	};
+
+	Entry* findEntry(const int tx, const int ty);
+	Entry* allocEntry(const int tx, const int ty);
+	void freeEntry(Entry* entry);
+	void unloadEntry(Entry* entry, const unsigned char state);
+	float getTileDistSqr(const int tx, const int ty, const float* focusPoints, const int focusCount) const;
+	static int compareCandidates(const void* va, const void* vb);
+
+	dtNavMesh* m_nav;
+	dtTileSource* m_source;
+	dtTileStreamerParams m_params;
+
+	Entry* m_entries;			///< The tracked tile locations. [Size: dtTileStreamerParams::maxEntries]
+	int* m_buckets;				///< The first entry of each hash bucket, or -1. [Size: #m_bucketMask + 1]
+	int m_bucketMask;
+	int m_nextFree;				///< The first free entry, or -1.
+
+	struct Candidate
+	{
+		float distSqr;
+		int entry;
+	};
+	Candidate* m_candidates;	///< Scratch space for sorting the entries. [Size: dtTileStreamerParams::maxEntries]
+
+	size_t m_residentBytes;
+	int m_residentCount;
+	int m_pendingCount;
+};
+
+/// Allocates a tile streamer object using the Detour allocator.
+/// @return A tile streamer that is ready for initialization, or null on failure.
+///  @ingroup detour
+dtTileStreamer* dtAllocTileStreamer();
+
+/// Frees the specified tile streamer object using the Detour allocator.
+///  @param[in]		streamer		A tile streamer allocated using #dtAllocTileStreamer
+///  @ingroup detour
+void dtFreeTileStreamer(dtTileStreamer* streamer);
+
+#endif // DETOURTILESTREAMER_H
+
+///////////////////////////////////////////////////////////////////////////
+
+// This section contains detailed documentation for members that don't have
+// a source file. It reduces clutter in the main section of the header.
+
+/**
+
+@class dtTileStreamer
+
+The streamer adds and removes the tiles of a navigation mesh so that the
+tiles around the focus points, e.g. the players, are loaded. Tiles closer
+than dtTileStreamerParams::loadRadius to a focus point are requested from
+the tile source, nearest first, and tiles farther than
+dtTileStreamerParams::unloadRadius from all focus points are removed. The
+gap between the two radii prevents tiles on the border from being loaded
+and unloaded over and over again.
+
+When the loaded tile data exceeds dtTileStreamerParams::maxResidentBytes,
+the tiles farthest from the focus points are evicted. Evicted tiles are
+loaded again once they fit in the budget.
+
+The streamer remembers the reference of each tile it unloads, and adds the
+tile back with the same reference the next time it is loaded, unless the
+source reports that the tile data changed. While a tile is unloaded the
+references to its polygons are invalid, so path corridors detect them as
+stale; once the unchanged tile is back they are valid again. A changed tile
+gets a new salt, so the old references stay invalid.
+
+The streamed tiles are owned by the source. The streamer must be freed or
+#unloadAll called before the navigation mesh is freed.
+
+@see dtTileSource, dtNavMesh::addTile
+
+*/
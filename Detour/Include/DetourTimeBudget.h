@@ -0,0 +1,63 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURTIMEBUDGET_H
+#define DETOURTIMEBUDGET_H
+
+/// Returns the current time in microseconds.
+/// It is called every few iterations of a time budgeted update, so it should be cheap.
+/// @ingroup detour
+typedef double (*dtTimeFunc)();
+
+/// A wall-clock deadline for time budgeted updates.
+///
+/// The same budget can be passed to several updates in turn, for example to
+/// share one frame budget between path replanning and tile cache rebuilds.
+/// Each update returns once the deadline has passed, so it may overrun the
+/// deadline by the cost of up to #checkIterations iterations.
+///
+/// @ingroup detour
+/// @see dtInitTimeBudget
+struct dtTimeBudget
+{
+	dtTimeFunc getTime;		///< The clock.
+	double deadline;		///< The time after which the updates return. [Units: us]
+	int checkIterations;	///< The number of iterations between reads of the clock. [Limit: > 0]
+};
+
+/// Initializes a time budget ending the specified amount of time from now.
+///  @param[out]	budget			The budget to initialize.
+///  @param[in]		getTime			The clock.
+///  @param[in]		duration		The length of the budget. [Units: us]
+///  @param[in]		checkIterations	The number of iterations between reads of the clock. [Limit: > 0]
+/// @ingroup detour
+inline void dtInitTimeBudget(dtTimeBudget& budget, dtTimeFunc getTime, const double duration, const int checkIterations = 16)
+{
+	budget.getTime = getTime;
+	budget.deadline = getTime() + duration;
+	budget.checkIterations = checkIterations > 0 ? checkIterations : 1;
+}
+
+/// Returns true if the deadline of the budget has passed.
+/// @ingroup detour
+inline bool dtTimeBudgetExpired(const dtTimeBudget& budget)
+{
+	return budget.getTime() >= budget.deadline;
+}
+
+#endif // DETOURTIMEBUDGET_H
@@ -48,3 +48,15 @@ void dtFree(void* ptr)
 	if (ptr)
 		sFreeFunc(ptr);
 }
+
+dtAllocator::~dtAllocator()
+{
+	// Defined out of line to fix the weak v-tables warning
+}
+
+static dtAllocator sDefaultAllocator;
+
+dtAllocator* dtGetDefaultAllocator()
+{
+	return &sDefaultAllocator;
+}
@@ -19,6 +19,263 @@
 #include "DetourCommon.h"
 #include "DetourMath.h"
 
+// Define DT_NO_SIMD to use the scalar polygon tests on all platforms.
+// The NEON versions need the vector division of AArch64.
+#if defined(DT_NO_SIMD)
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DT_COMMON_SSE2
+#define DT_COMMON_SIMD
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && (defined(__aarch64__) || defined(_M_ARM64))
+#include <arm_neon.h>
+#define DT_COMMON_NEON
+#define DT_COMMON_SIMD
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(DT_COMMON_SIMD)
+
+static bool s_simdGeometry = true;
+
+// The SIMD polygon tests process four edges at a time, two vectors cover the
+// polygons of up to DT_VERTS_PER_POLYGON vertices. They use the same operations
+// in the same order as the scalar tests, and select instead of branching, so the
+// results are bit-identical.
+static const int SIMD_MAX_VERTS = 8;
+
+#if defined(DT_COMMON_SSE2)
+typedef __m128 dtSimdFloat;
+typedef __m128 dtSimdMask;
+static inline dtSimdFloat simdLoad(const float* p) { return _mm_loadu_ps(p); }
+static inline dtSimdFloat simdSet(const float v) { return _mm_set1_ps(v); }
+static inline dtSimdFloat simdSet4(const float a, const float b, const float c, const float d) { return _mm_setr_ps(a, b, c, d); }
+static inline dtSimdFloat simdAdd(const dtSimdFloat a, const dtSimdFloat b) { return _mm_add_ps(a, b); }
+static inline dtSimdFloat simdSub(const dtSimdFloat a, const dtSimdFloat b) { return _mm_sub_ps(a, b); }
+static inline dtSimdFloat simdMul(const dtSimdFloat a, const dtSimdFloat b) { return _mm_mul_ps(a, b); }
+static inline dtSimdFloat simdDiv(const dtSimdFloat a, const dtSimdFloat b) { return _mm_div_ps(a, b); }
+static inline dtSimdMask simdLess(const dtSimdFloat a, const dtSimdFloat b) { return _mm_cmplt_ps(a, b); }
+static inline dtSimdMask simdGreater(const dtSimdFloat a, const dtSimdFloat b) { return _mm_cmpgt_ps(a, b); }
+static inline dtSimdMask simdAnd(const dtSimdMask a, const dtSimdMask b) { return _mm_and_ps(a, b); }
+static inline dtSimdMask simdXor(const dtSimdMask a, const dtSimdMask b) { return _mm_xor_ps(a, b); }
+static inline dtSimdFloat simdSelect(const dtSimdMask m, const dtSimdFloat a, const dtSimdFloat b)
+{
+	return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
+static inline int simdBits(const dtSimdMask m) { return _mm_movemask_ps(m); }
+static inline void simdStore(float* p, const dtSimdFloat v) { _mm_storeu_ps(p, v); }
+#else
+typedef float32x4_t dtSimdFloat;
+typedef uint32x4_t dtSimdMask;
+static inline dtSimdFloat simdLoad(const float* p) { return vld1q_f32(p); }
+static inline dtSimdFloat simdSet(const float v) { return vdupq_n_f32(v); }
+static inline dtSimdFloat simdSet4(const float a, const float b, const float c, const float d)
+{
+	const float v[4] = { a, b, c, d };
+	return vld1q_f32(v);
+}
+static inline dtSimdFloat simdAdd(const dtSimdFloat a, const dtSimdFloat b) { return vaddq_f32(a, b); }
+static inline dtSimdFloat simdSub(const dtSimdFloat a, const dtSimdFloat b) { return vsubq_f32(a, b); }
+static inline dtSimdFloat simdMul(const dtSimdFloat a, const dtSimdFloat b) { return vmulq_f32(a, b); }
+static inline dtSimdFloat simdDiv(const dtSimdFloat a, const dtSimdFloat b) { return vdivq_f32(a, b); }
+static inline dtSimdMask simdLess(const dtSimdFloat a, const dtSimdFloat b) { return vcltq_f32(a, b); }
+static inline dtSimdMask simdGreater(const dtSimdFloat a, const dtSimdFloat b) { return vcgtq_f32(a, b); }
+static inline dtSimdMask simdAnd(const dtSimdMask a, const dtSimdMask b) { return vandq_u32(a, b); }
+static inline dtSimdMask simdXor(const dtSimdMask a, const dtSimdMask b) { return veorq_u32(a, b); }
+static inline dtSimdFloat simdSelect(const dtSimdMask m, const dtSimdFloat a, const dtSimdFloat b) { return vbslq_f32(m, a, b); }
+static inline int simdBits(const dtSimdMask m)
+{
+	static const int32_t shifts[4] = { 0, 1, 2, 3 };
+	return (int)vaddvq_u32(vshlq_u32(vshrq_n_u32(m, 31), vld1q_s32(shifts)));
+}
+static inline void simdStore(float* p, const dtSimdFloat v) { vst1q_f32(p, v); }
+#endif
+
+static inline int bitParity(int bits)
+{
+	bits ^= bits >> 4;
+	bits ^= bits >> 2;
+	bits ^= bits >> 1;
+	return bits & 1;
+}
+
+// The xz-coordinates of the polygon edges from vertex j to vertex j+1, four edges at a time.
+// The lanes are gathered in registers, going through memory would stall the vector loads.
+struct dtSimdPolyEdges
+{
+	dtSimdFloat px, pz;	///< The start vertex of each edge.
+	dtSimdFloat qx, qz;	///< The end vertex of each edge.
+};
+
+static inline void loadPolyEdges(const float* verts, const int nverts, const int j, dtSimdPolyEdges& e)
+{
+	int k[5];
+	for (int i = 0; i < 5; ++i)
+		k[i] = j+i < nverts ? (j+i)*3 : 0;
+	e.px = simdSet4(verts[k[0]+0], verts[k[1]+0], verts[k[2]+0], verts[k[3]+0]);
+	e.pz = simdSet4(verts[k[0]+2], verts[k[1]+2], verts[k[2]+2], verts[k[3]+2]);
+	e.qx = simdSet4(verts[k[1]+0], verts[k[2]+0], verts[k[3]+0], verts[k[4]+0]);
+	e.qz = simdSet4(verts[k[1]+2], verts[k[2]+2], verts[k[3]+2], verts[k[4]+2]);
+}
+
+// Returns the bits of the edges crossed by the ray from the point toward -x, as in dtPointInPolygon.
+static inline int crossingBits(const dtSimdFloat ptx, const dtSimdFloat ptz,
+							   const dtSimdFloat vjx, const dtSimdFloat vjz,
+							   const dtSimdFloat vix, const dtSimdFloat viz)
+{
+	const dtSimdMask straddle = simdXor(simdGreater(viz, ptz), simdGreater(vjz, ptz));
+	const dtSimdFloat x = simdAdd(simdDiv(simdMul(simdSub(vjx, vix), simdSub(ptz, viz)), simdSub(vjz, viz)), vix);
+	return simdBits(simdAnd(straddle, simdLess(ptx, x)));
+}
+
+static bool pointInPolygonSimd(const float* pt, const float* verts, const int nverts)
+{
+	const dtSimdFloat ptx = simdSet(pt[0]);
+	const dtSimdFloat ptz = simdSet(pt[2]);
+	int bits = 0;
+	for (int j = 0; j < nverts; j += 4)
+	{
+		// The edge from vj to vi crosses the ray the same way as in the scalar loop.
+		dtSimdPolyEdges e;
+		loadPolyEdges(verts, nverts, j, e);
+		bits |= crossingBits(ptx, ptz, e.px, e.pz, e.qx, e.qz) << j;
+	}
+	return bitParity(bits & ((1 << nverts) - 1)) != 0;
+}
+
+static bool distancePtPolyEdgesSqrSimd(const float* pt, const float* verts, const int nverts,
+									   float* ed, float* et)
+{
+	const dtSimdFloat ptx = simdSet(pt[0]);
+	const dtSimdFloat ptz = simdSet(pt[2]);
+	const dtSimdFloat zero = simdSet(0.0f);
+	const dtSimdFloat one = simdSet(1.0f);
+	float dist[SIMD_MAX_VERTS], param[SIMD_MAX_VERTS];
+	int bits = 0;
+	for (int j = 0; j < nverts; j += 4)
+	{
+		dtSimdPolyEdges e;
+		loadPolyEdges(verts, nverts, j, e);
+		const dtSimdFloat px = e.px, pz = e.pz, qx = e.qx, qz = e.qz;
+		bits |= crossingBits(ptx, ptz, px, pz, qx, qz) << j;
+
+		// dtDistancePtSegSqr2D of the edges.
+		const dtSimdFloat pqx = simdSub(qx, px);
+		const dtSimdFloat pqz = simdSub(qz, pz);
+		dtSimdFloat dx = simdSub(ptx, px);
+		dtSimdFloat dz = simdSub(ptz, pz);
+		const dtSimdFloat d = simdAdd(simdMul(pqx, pqx), simdMul(pqz, pqz));
+		dtSimdFloat t = simdAdd(simdMul(pqx, dx), simdMul(pqz, dz));
+		t = simdSelect(simdGreater(d, zero), simdDiv(t, d), t);
+		t = simdSelect(simdLess(t, zero), zero, simdSelect(simdGreater(t, one), one, t));
+		dx = simdSub(simdAdd(px, simdMul(t, pqx)), ptx);
+		dz = simdSub(simdAdd(pz, simdMul(t, pqz)), ptz);
+		simdStore(&dist[j], simdAdd(simdMul(dx, dx), simdMul(dz, dz)));
+		simdStore(&param[j], t);
+	}
+	for (int j = 0; j < nverts; ++j)
+	{
+		ed[j] = dist[j];
+		et[j] = param[j];
+	}
+	return bitParity(bits & ((1 << nverts) - 1)) != 0;
+}
+
+static bool intersectSegmentPoly2DSimd(const float* p0, const float* p1,
+									   const float* verts, int nverts,
+									   float& tmin, float& tmax,
+									   int& segMin, int& segMax)
+{
+	static const float EPS = 0.000001f;
+
+	// The scalar loop visits the edge from vertex j = i-1 to vertex i, starting with i = 0.
+	const dtSimdFloat dirx = simdSet(p1[0] - p0[0]);
+	const dtSimdFloat dirz = simdSet(p1[2] - p0[2]);
+	const dtSimdFloat p0x = simdSet(p0[0]);
+	const dtSimdFloat p0z = simdSet(p0[2]);
+	float num[SIMD_MAX_VERTS], den[SIMD_MAX_VERTS], param[SIMD_MAX_VERTS];
+	for (int j = 0; j < nverts; j += 4)
+	{
+		dtSimdPolyEdges e;
+		loadPolyEdges(verts, nverts, j, e);
+		const dtSimdFloat px = e.px, pz = e.pz;
+		const dtSimdFloat edgex = simdSub(e.qx, px);
+		const dtSimdFloat edgez = simdSub(e.qz, pz);
+		const dtSimdFloat diffx = simdSub(p0x, px);
+		const dtSimdFloat diffz = simdSub(p0z, pz);
+		const dtSimdFloat n = simdSub(simdMul(edgez, diffx), simdMul(edgex, diffz));
+		const dtSimdFloat d = simdSub(simdMul(dirz, edgex), simdMul(dirx, edgez));
+		simdStore(&num[j], n);
+		simdStore(&den[j], d);
+		simdStore(&param[j], simdDiv(n, d));
+	}
+
+	tmin = 0;
+	tmax = 1;
+	segMin = -1;
+	segMax = -1;
+	for (int i = 0; i < nverts; ++i)
+	{
+		const int j = i > 0 ? i-1 : nverts-1;
+		const float n = num[j];
+		const float d = den[j];
+		if (fabsf(d) < EPS)
+		{
+			// S is nearly parallel to this edge
+			if (n < 0)
+				return false;
+			else
+				continue;
+		}
+		const float t = param[j];
+		if (d < 0)
+		{
+			// segment S is entering across this edge
+			if (t > tmin)
+			{
+				tmin = t;
+				segMin = j;
+				if (tmin > tmax)
+					return false;
+			}
+		}
+		else
+		{
+			// segment S is leaving across this edge
+			if (t < tmax)
+			{
+				tmax = t;
+				segMax = j;
+				if (tmax < tmin)
+					return false;
+			}
+		}
+	}
+	return true;
+}
+
+#endif // DT_COMMON_SIMD
+
+bool dtSetSimdGeometry(const bool enabled)
+{
+#if defined(DT_COMMON_SIMD)
+	s_simdGeometry = enabled;
+	return true;
+#else
+	dtIgnoreUnused(enabled);
+	return false;
+#endif
+}
+
+bool dtGetSimdGeometry()
+{
+#if defined(DT_COMMON_SIMD)
+	return s_simdGeometry;
+#else
+	return false;
+#endif
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
 
 void dtClosestPtPointTriangle(float* closest, const float* p,
@@ -112,6 +369,11 @@ bool dtIntersectSegmentPoly2D(const float* p0, const float* p1,
 							  float& tmin, float& tmax,
 							  int& segMin, int& segMax)
 {
+#if defined(DT_COMMON_SIMD)
+	if (s_simdGeometry && nverts <= SIMD_MAX_VERTS)
+		return intersectSegmentPoly2DSimd(p0, p1, verts, nverts, tmin, tmax, segMin, segMax);
+#endif
+
 	static const float EPS = 0.000001f;
 	
 	tmin = 0;
@@ -237,6 +499,11 @@ bool dtClosestHeightPointTriangle(const float* p, const float* a, const float* b
 /// All points are projected onto the xz-plane, so the y-values are ignored.
 bool dtPointInPolygon(const float* pt, const float* verts, const int nverts)
 {
+#if defined(DT_COMMON_SIMD)
+	if (s_simdGeometry && nverts <= SIMD_MAX_VERTS)
+		return pointInPolygonSimd(pt, verts, nverts);
+#endif
+
 	// TODO: Replace pnpoly with triArea2D tests?
 	int i, j;
 	bool c = false;
@@ -254,6 +521,11 @@ bool dtPointInPolygon(const float* pt, const float* verts, const int nverts)
 bool dtDistancePtPolyEdgesSqr(const float* pt, const float* verts, const int nverts,
 							  float* ed, float* et)
 {
+#if defined(DT_COMMON_SIMD)
+	if (s_simdGeometry && nverts <= SIMD_MAX_VERTS)
+		return distancePtPolyEdgesSqrSimd(pt, verts, nverts, ed, et);
+#endif
+
 	// TODO: Replace pnpoly with triArea2D tests?
 	int i, j;
 	bool c = false;
@@ -25,6 +25,7 @@
 #include "DetourMath.h"
 #include "DetourAlloc.h"
 #include "DetourAssert.h"
+#include "DetourAtomic.h"
 #include <new>
 
 
@@ -119,19 +120,61 @@ inline int computeTileHash(int x, int y, const int mask)
 	return (int)(n & mask);
 }
 
-inline unsigned int allocLink(dtMeshTile* tile)
+/// A slot of the open addressing tile lookup used with sparse tiles.
+struct dtTileSlot
 {
-	if (tile->linksFreeList == DT_NULL_LINK)
-		return DT_NULL_LINK;
-	unsigned int link = tile->linksFreeList;
-	tile->linksFreeList = tile->links[link].next;
-	return link;
+	int x, y;				///< The tile location.
+	dtMeshTile* tile;		///< The tile, or null if the slot is empty.
+};
+
+/// The number of tile index bits addressing a tile within a page of sparse tiles.
+static const unsigned int DT_SPARSE_TILE_PAGE_BITS = 6;
+
+/// A tile, link or link array which has been removed, but may still be accessed by concurrent readers.
+struct dtRetiredItem
+{
+	unsigned int epoch;		///< The epoch of the update which retired the item.
+	int tile;				///< The index of the tile owning the item.
+	unsigned int link;		///< The retired link, or DT_NULL_LINK if the whole tile is retired.
+	void* memory;			///< The replaced link memory to free, or null if a tile or link is retired.
+};
+
+/// Caches the portal of a polygon edge link, clamped to the link limits the same way as
+/// dtNavMeshQuery::getPortalPoints.
+static void storeLinkPortal(dtMeshTile* tile, const dtPoly* poly, const unsigned int idx)
+{
+	if (!tile->linkPortals)
+		return;
+	const dtLink& link = tile->links[idx];
+	float v0[3], v1[3];
+	dtGetTileVertex(tile, poly->verts[link.edge], v0);
+	dtGetTileVertex(tile, poly->verts[(link.edge+1) % (int)poly->vertCount], v1);
+	float* left = &tile->linkPortals[idx*6];
+	float* right = left+3;
+	if (link.side != 0xff && (link.bmin != 0 || link.bmax != 255))
+	{
+		const float s = 1.0f/255.0f;
+		dtVlerp(left, v0, v1, link.bmin*s);
+		dtVlerp(right, v0, v1, link.bmax*s);
+	}
+	else
+	{
+		dtVcopy(left, v0);
+		dtVcopy(right, v1);
+	}
 }
 
 inline void freeLink(dtMeshTile* tile, unsigned int link)
 {
 	tile->links[link].next = tile->linksFreeList;
 	tile->linksFreeList = link;
+	tile->linkCount--;
+}
+
+/// Returns true if the links of the tile have outgrown the tile data and are owned by the navigation mesh.
+inline bool ownsLinks(const dtMeshTile* tile)
+{
+	return tile->linkCapacity > tile->header->maxLinkCount;
 }
 
 
@@ -182,18 +225,85 @@ Notes:
 - This class does not implement any asynchronous methods. So the ::dtStatus result of all methods will 
   always contain either a success or failure flag.
 
+<b>Concurrent Readers</b>
+
+Any number of threads may query the navigation mesh at the same time, each through its 
+own dtNavMeshQuery object. Adding and removing tiles must be serialized by the application.
+
+By default, removing a tile releases its memory immediately, so tiles must not be added 
+or removed while queries are running. If deferred tile release is enabled, queries may 
+keep running while tiles are added and removed on another thread:
+
+- #addTile fully initializes a tile and its links before making them reachable.
+- #removeTile unlinks the tile, but retires the tile memory and the unlinked links of 
+  its neighbours instead of releasing them. Queries that started before the removal can 
+  keep dereferencing them safely; references to a retired tile are no longer valid.
+- Each update advances #getEpoch. A reader records the epoch when it starts a query; 
+  once all readers have moved past an epoch, #releaseRetiredTiles frees the items retired 
+  up to it.
+
+The tile lookup, the tile chains, the link list heads and the grown link arrays are 
+published with release stores and the tile lookup is read with acquire loads, using the 
+atomics of DetourAtomic.h. The links themselves are read with plain loads, which are 
+ordered by their dependency on the published link index. The epoch is published last, 
+so readers need no synchronization of their own. A query running concurrently with an 
+update may observe the connectivity from either before or after the update. Compilers 
+without atomic builtins fall back to volatile accesses, in which case the application 
+must still synchronize its readers, e.g. at a frame boundary.
+
+<b>Sparse Tiles</b>
+
+Large or streamed worlds may only ever load a small part of their tiles at once. With 
+#DT_NAVMESH_SPARSE_TILES the tiles are allocated in pages as they are needed, and the 
+tile lookup is an open addressing hash table that grows with the number of loaded tiles. 
+Tile pointers stay valid while the navigation mesh grows, and tile references are 
+encoded the same way as for the default dense storage.
+
+The sparse tile lookup is reorganized when tiles are added and removed, so with sparse 
+tiles, tiles must not be added or removed while queries are running, even if deferred 
+tile release is enabled.
+
 @see dtNavMeshQuery, dtCreateNavMeshData, dtNavMeshCreateParams, #dtAllocNavMesh, #dtFreeNavMesh
 */
 
 dtNavMesh::dtNavMesh() :
+	m_allocator(dtGetDefaultAllocator()),
 	m_tileWidth(0),
 	m_tileHeight(0),
+	m_flags(0),
 	m_maxTiles(0),
+	m_tileLimit(0),
 	m_tileLutSize(0),
 	m_tileLutMask(0),
 	m_posLookup(0),
+	m_tileSlots(0),
+	m_tileSlotCount(0),
+	m_tileGrid(0),
+	m_tileGridCounts(0),
+	m_tileGridMinX(0),
+	m_tileGridMinY(0),
+	m_tileGridWidth(0),
+	m_tileGridHeight(0),
+	m_tileGridLayers(0),
+	m_tileGridOverflow(0),
 	m_nextFree(0),
-	m_tiles(0)
+	m_tilePages(0),
+	m_tilePageCount(0),
+	m_tilePageCapacity(0),
+	m_tilePageBits(0),
+	m_tilePageMask(0),
+	m_epoch(0),
+	m_generation(0),
+	m_changeListener(0),
+	m_deferRelease(false),
+	m_retired(0),
+	m_retiredCount(0),
+	m_retiredCapacity(0),
+	m_linkOverflowCount(0),
+	m_lostLinkCount(0),
+	m_pendingTiles(0),
+	m_pendingTileCount(0),
+	m_pendingTileCapacity(0)
 {
 #ifndef DT_POLYREF64
 	m_saltBits = 0;
@@ -210,61 +320,351 @@ dtNavMesh::~dtNavMesh()
 {
 	for (int i = 0; i < m_maxTiles; ++i)
 	{
-		if (m_tiles[i].flags & DT_TILE_FREE_DATA)
+		dtMeshTile* tile = getTileByIndex((unsigned int)i);
+		if (tile->header && ownsLinks(tile))
+			m_allocator->free(tile->links);
+		if (tile->flags & DT_TILE_FREE_DATA)
 		{
-			dtFree(m_tiles[i].data);
-			m_tiles[i].data = 0;
-			m_tiles[i].dataSize = 0;
+			m_allocator->free(tile->data);
+			tile->data = 0;
+			tile->dataSize = 0;
 		}
+		m_allocator->free(tile->linkPortals);
+		tile->linkPortals = 0;
 	}
-	dtFree(m_posLookup);
-	dtFree(m_tiles);
+	m_allocator->free(m_posLookup);
+	m_allocator->free(m_tileSlots);
+	m_allocator->free(m_tileGrid);
+	m_allocator->free(m_tileGridCounts);
+	for (int i = 0; i < m_tilePageCount; ++i)
+		m_allocator->free(m_tilePages[i]);
+	m_allocator->free(m_tilePages);
+	for (int i = 0; i < m_retiredCount; ++i)
+		m_allocator->free(m_retired[i].memory);
+	m_allocator->free(m_retired);
+	m_allocator->free(m_pendingTiles);
 }
 		
-dtStatus dtNavMesh::init(const dtNavMeshParams* params)
+/// @par
+///
+/// By default the navigation mesh allocates all @p params->maxTiles tiles up front.
+/// With #DT_NAVMESH_SPARSE_TILES the tiles and the tile lookup are allocated on demand 
+/// as tiles are added, so the navigation mesh only uses memory for the tiles that are
+/// loaded. @p params->maxTiles then only limits the number of tiles, and zero uses
+/// as many tile bits as the polygon references have room for.
+///
+/// #DT_NAVMESH_PORTAL_CACHE trades 24 bytes per link for not having to recompute the
+/// portal of each polygon edge crossed by dtNavMeshQuery::findStraightPath.
+///
+/// @see #addTile
+dtStatus dtNavMesh::init(const dtNavMeshParams* params, const int flags, dtAllocator* allocator)
 {
+	const bool sparse = (flags & DT_NAVMESH_SPARSE_TILES) != 0;
+	if (params->maxTiles < 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	m_allocator = allocator ? allocator : dtGetDefaultAllocator();
+
 	memcpy(&m_params, params, sizeof(dtNavMeshParams));
 	dtVcopy(m_orig, params->orig);
 	m_tileWidth = params->tileWidth;
 	m_tileHeight = params->tileHeight;
+	m_flags = flags;
 	
+	// Init ID generator values.
+#ifndef DT_POLYREF64
+	m_polyBits = dtIlog2(dtNextPow2((unsigned int)params->maxPolys));
+	if (params->maxTiles > 0)
+		m_tileBits = dtIlog2(dtNextPow2((unsigned int)params->maxTiles));
+	else
+		m_tileBits = m_polyBits < 22 ? 22 - m_polyBits : 0;
+	// Only allow 31 salt bits, since the salt mask is calculated using 32bit uint and it will overflow.
+	m_saltBits = dtMin((unsigned int)31, 32 - m_tileBits - m_polyBits);
+
+	if (m_saltBits < 10 || m_tileBits + m_polyBits > 32)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	const unsigned int tileBits = m_tileBits;
+#else
+	const unsigned int tileBits = DT_TILE_BITS;
+#endif
+	m_tileLimit = params->maxTiles > 0 ? params->maxTiles : (1 << tileBits);
+
+	if (sparse)
+	{
+		// Tiles are allocated in pages and the lookup grows as tiles are added.
+		m_maxTiles = 0;
+		m_tilePageBits = DT_SPARSE_TILE_PAGE_BITS;
+		m_tilePageMask = (1u << DT_SPARSE_TILE_PAGE_BITS) - 1;
+		m_nextFree = 0;
+		return DT_SUCCESS;
+	}
+
 	// Init tiles
 	m_maxTiles = params->maxTiles;
 	m_tileLutSize = dtNextPow2(params->maxTiles/4);
 	if (!m_tileLutSize) m_tileLutSize = 1;
 	m_tileLutMask = m_tileLutSize-1;
 	
-	m_tiles = (dtMeshTile*)dtAlloc(sizeof(dtMeshTile)*m_maxTiles, DT_ALLOC_PERM);
-	if (!m_tiles)
+	m_tilePages = (dtMeshTile**)m_allocator->alloc(sizeof(dtMeshTile*), DT_ALLOC_PERM);
+	if (!m_tilePages)
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
-	m_posLookup = (dtMeshTile**)dtAlloc(sizeof(dtMeshTile*)*m_tileLutSize, DT_ALLOC_PERM);
+	m_tilePageCapacity = 1;
+	dtMeshTile* tiles = (dtMeshTile*)m_allocator->alloc(sizeof(dtMeshTile)*m_maxTiles, DT_ALLOC_PERM);
+	if (!tiles)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	m_tilePages[m_tilePageCount++] = tiles;
+	m_tilePageBits = 31;
+	m_tilePageMask = 0x7fffffff;
+	m_posLookup = (dtMeshTile**)m_allocator->alloc(sizeof(dtMeshTile*)*m_tileLutSize, DT_ALLOC_PERM);
 	if (!m_posLookup)
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
-	memset(m_tiles, 0, sizeof(dtMeshTile)*m_maxTiles);
+	memset(tiles, 0, sizeof(dtMeshTile)*m_maxTiles);
 	memset(m_posLookup, 0, sizeof(dtMeshTile*)*m_tileLutSize);
 	m_nextFree = 0;
 	for (int i = m_maxTiles-1; i >= 0; --i)
 	{
-		m_tiles[i].salt = 1;
-		m_tiles[i].next = m_nextFree;
-		m_nextFree = &m_tiles[i];
+		tiles[i].salt = 1;
+		tiles[i].index = (unsigned int)i;
+		tiles[i].next = m_nextFree;
+		m_nextFree = &tiles[i];
 	}
 	
-	// Init ID generator values.
-#ifndef DT_POLYREF64
-	m_tileBits = dtIlog2(dtNextPow2((unsigned int)params->maxTiles));
-	m_polyBits = dtIlog2(dtNextPow2((unsigned int)params->maxPolys));
-	// Only allow 31 salt bits, since the salt mask is calculated using 32bit uint and it will overflow.
-	m_saltBits = dtMin((unsigned int)31, 32 - m_tileBits - m_polyBits);
+	return DT_SUCCESS;
+}
+
+bool dtNavMesh::allocTilePage()
+{
+	if (m_maxTiles >= m_tileLimit)
+		return false;
+
+	if (m_tilePageCount >= m_tilePageCapacity)
+	{
+		const int capacity = m_tilePageCapacity ? m_tilePageCapacity*2 : 8;
+		dtMeshTile** pages = (dtMeshTile**)m_allocator->alloc(sizeof(dtMeshTile*)*capacity, DT_ALLOC_PERM);
+		if (!pages)
+			return false;
+		if (m_tilePageCount)
+			memcpy(pages, m_tilePages, sizeof(dtMeshTile*)*m_tilePageCount);
+		m_allocator->free(m_tilePages);
+		m_tilePages = pages;
+		m_tilePageCapacity = capacity;
+	}
+
+	const int pageSize = 1 << m_tilePageBits;
+	dtMeshTile* tiles = (dtMeshTile*)m_allocator->alloc(sizeof(dtMeshTile)*pageSize, DT_ALLOC_PERM);
+	if (!tiles)
+		return false;
+	memset(tiles, 0, sizeof(dtMeshTile)*pageSize);
+	m_tilePages[m_tilePageCount++] = tiles;
 
-	if (m_saltBits < 10)
+	// The last page may be partially used if the tile limit is not a multiple of the page size.
+	const int base = m_maxTiles;
+	const int count = dtMin(pageSize, m_tileLimit - base);
+	for (int i = count-1; i >= 0; --i)
+	{
+		tiles[i].salt = 1;
+		tiles[i].index = (unsigned int)(base + i);
+		tiles[i].next = m_nextFree;
+		m_nextFree = &tiles[i];
+	}
+	m_maxTiles = base + count;
+
+	return true;
+}
+
+bool dtNavMesh::resizeTileSlots(int size)
+{
+	dtTileSlot* slots = (dtTileSlot*)m_allocator->alloc(sizeof(dtTileSlot)*size, DT_ALLOC_PERM);
+	if (!slots)
+		return false;
+	memset(slots, 0, sizeof(dtTileSlot)*size);
+
+	// Rehash the old slots.
+	const int mask = size-1;
+	for (int i = 0; i < m_tileLutSize; ++i)
+	{
+		const dtTileSlot& slot = m_tileSlots[i];
+		if (!slot.tile)
+			continue;
+		int h = computeTileHash(slot.x, slot.y, mask);
+		while (slots[h].tile)
+			h = (h+1) & mask;
+		slots[h] = slot;
+	}
+
+	m_allocator->free(m_tileSlots);
+	m_tileSlots = slots;
+	m_tileLutSize = size;
+	m_tileLutMask = mask;
+	return true;
+}
+
+/// @par
+///
+/// The tile lookup hashes the tile location and compares the tiles with the same hash.
+/// With many layers per location, e.g. for a tile cache of a multi-storey world, each
+/// lookup compares many tiles. The tile grid finds the tiles within its rectangle
+/// directly, and all the layers of a location are stored next to each other.
+///
+/// The grid uses <tt>width * height * maxLayers</tt> tile pointers. Tiles outside of the
+/// rectangle, or with a layer of @p maxLayers or more, are still found with the hash lookup.
+/// The tiles already in the navigation mesh are added to the new grid.
+dtStatus dtNavMesh::setTileGrid(const int minX, const int minY, const int width, const int height, const int maxLayers)
+{
+	if (width < 0 || height < 0 || ((width > 0 && height > 0) && (maxLayers <= 0 || maxLayers > 0xffff)))
 		return DT_FAILURE | DT_INVALID_PARAM;
-#endif
-	
+
+	m_allocator->free(m_tileGrid);
+	m_allocator->free(m_tileGridCounts);
+	m_tileGrid = 0;
+	m_tileGridCounts = 0;
+	m_tileGridWidth = 0;
+	m_tileGridHeight = 0;
+	m_tileGridLayers = 0;
+	m_tileGridOverflow = 0;
+	if (width == 0 || height == 0)
+		return DT_SUCCESS;
+
+	const int cellCount = width * height;
+	m_tileGrid = (dtMeshTile**)m_allocator->alloc(sizeof(dtMeshTile*)*cellCount*maxLayers, DT_ALLOC_PERM);
+	m_tileGridCounts = (unsigned short*)m_allocator->alloc(sizeof(unsigned short)*cellCount, DT_ALLOC_PERM);
+	if (!m_tileGrid || !m_tileGridCounts)
+	{
+		m_allocator->free(m_tileGrid);
+		m_allocator->free(m_tileGridCounts);
+		m_tileGrid = 0;
+		m_tileGridCounts = 0;
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+	memset(m_tileGrid, 0, sizeof(dtMeshTile*)*cellCount*maxLayers);
+	memset(m_tileGridCounts, 0, sizeof(unsigned short)*cellCount);
+	m_tileGridMinX = minX;
+	m_tileGridMinY = minY;
+	m_tileGridWidth = width;
+	m_tileGridHeight = height;
+	m_tileGridLayers = maxLayers;
+
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		dtMeshTile* tile = getTileByIndex((unsigned int)i);
+		if (!tile->header)
+			continue;
+		const int slot = getTileGridSlot(tile->header->x, tile->header->y, tile->header->layer);
+		if (slot >= 0)
+		{
+			m_tileGrid[slot] = tile;
+			m_tileGridCounts[slot / maxLayers]++;
+		}
+		else
+			m_tileGridOverflow++;
+	}
+
 	return DT_SUCCESS;
 }
 
-dtStatus dtNavMesh::init(unsigned char* data, const int dataSize, const int flags)
+int dtNavMesh::getTileGridSlot(const int x, const int y, const int layer) const
+{
+	const int gx = x - m_tileGridMinX;
+	const int gy = y - m_tileGridMinY;
+	if (gx < 0 || gy < 0 || gx >= m_tileGridWidth || gy >= m_tileGridHeight || layer < 0 || layer >= m_tileGridLayers)
+		return -1;
+	return (gx + gy*m_tileGridWidth)*m_tileGridLayers + layer;
+}
+
+void dtNavMesh::insertTileLookup(dtMeshTile* tile)
+{
+	const dtMeshHeader* header = tile->header;
+	if (m_tileGrid)
+	{
+		const int slot = getTileGridSlot(header->x, header->y, header->layer);
+		if (slot >= 0)
+		{
+			dtAtomicStore(&m_tileGrid[slot], tile);
+			m_tileGridCounts[slot / m_tileGridLayers]++;
+		}
+		else
+			m_tileGridOverflow++;
+	}
+	if (!(m_flags & DT_NAVMESH_SPARSE_TILES))
+	{
+		int h = computeTileHash(header->x, header->y, m_tileLutMask);
+		tile->next = m_posLookup[h];
+		dtAtomicStore(&m_posLookup[h], tile);
+		return;
+	}
+
+	// The lookup was grown by addTile, so there is always an empty slot.
+	int h = computeTileHash(header->x, header->y, m_tileLutMask);
+	while (m_tileSlots[h].tile)
+		h = (h+1) & m_tileLutMask;
+	m_tileSlots[h].x = header->x;
+	m_tileSlots[h].y = header->y;
+	m_tileSlots[h].tile = tile;
+	m_tileSlotCount++;
+}
+
+void dtNavMesh::removeTileLookup(dtMeshTile* tile)
+{
+	const dtMeshHeader* header = tile->header;
+	if (m_tileGrid)
+	{
+		const int slot = getTileGridSlot(header->x, header->y, header->layer);
+		if (slot >= 0)
+		{
+			dtAtomicStore(&m_tileGrid[slot], (dtMeshTile*)0);
+			m_tileGridCounts[slot / m_tileGridLayers]--;
+		}
+		else
+			m_tileGridOverflow--;
+	}
+	int h = computeTileHash(header->x, header->y, m_tileLutMask);
+	if (!(m_flags & DT_NAVMESH_SPARSE_TILES))
+	{
+		dtMeshTile* prev = 0;
+		dtMeshTile* cur = m_posLookup[h];
+		while (cur)
+		{
+			if (cur == tile)
+			{
+				if (prev)
+					dtAtomicStore(&prev->next, cur->next);
+				else
+					dtAtomicStore(&m_posLookup[h], cur->next);
+				break;
+			}
+			prev = cur;
+			cur = cur->next;
+		}
+		return;
+	}
+
+	while (m_tileSlots[h].tile && m_tileSlots[h].tile != tile)
+		h = (h+1) & m_tileLutMask;
+	if (!m_tileSlots[h].tile)
+		return;
+
+	// Shift the following slots of the cluster back so that no probe sequence is broken.
+	int hole = h;
+	int i = h;
+	for (;;)
+	{
+		i = (i+1) & m_tileLutMask;
+		const dtTileSlot& slot = m_tileSlots[i];
+		if (!slot.tile)
+			break;
+		const int home = computeTileHash(slot.x, slot.y, m_tileLutMask);
+		// Move the slot if its home is not cyclically within (hole, i].
+		if (((i - home) & m_tileLutMask) >= ((i - hole) & m_tileLutMask))
+		{
+			m_tileSlots[hole] = slot;
+			hole = i;
+		}
+	}
+	m_tileSlots[hole].tile = 0;
+	m_tileSlotCount--;
+}
+
+dtStatus dtNavMesh::init(unsigned char* data, const int dataSize, const int flags, dtAllocator* allocator)
 {
 	// Make sure the data is in right format.
 	dtMeshHeader* header = (dtMeshHeader*)data;
@@ -280,7 +680,7 @@ dtStatus dtNavMesh::init(unsigned char* data, const int dataSize, const int flag
 	params.maxTiles = 1;
 	params.maxPolys = header->polyCount;
 	
-	dtStatus status = init(&params);
+	dtStatus status = init(&params, 0, allocator);
 	if (dtStatusFailed(status))
 		return status;
 
@@ -303,50 +703,94 @@ int dtNavMesh::findConnectingPolys(const float* va, const float* vb,
 {
 	if (!tile) return 0;
 	
+	static const int MAX_CONS = 8;
+	dtAssert(maxcon <= MAX_CONS);
+	maxcon = dtMin(maxcon, MAX_CONS);
+
 	float amin[2], amax[2];
 	calcSlabEndPoints(va, vb, amin, amax, side);
 	const float apos = getSlabCoord(va, side);
 
-	// Remove links pointing to 'side' and compact the links array. 
 	float bmin[2], bmax[2];
 	unsigned short m = DT_EXT_LINK | (unsigned short)side;
+	unsigned short conPoly[MAX_CONS];
+	unsigned char conEdge[MAX_CONS];
 	int n = 0;
 	
 	dtPolyRef base = getPolyRefBase(tile);
+
+	// The portal edges of the side are sorted by their minimum, and their bmax is the running
+	// maximum along the side. Skip the edges which all end before the segment starts.
+	const dtPortalEdge* edges = tile->portalEdges;
+	int first = tile->header->portalSideBase[side];
+	const int last = (side < 7) ? tile->header->portalSideBase[side+1] : tile->header->portalEdgeCount;
+	int count = last - first;
+	while (count > 0)
+	{
+		const int step = count / 2;
+		if (edges[first + step].bmax < amin[0])
+		{
+			first += step + 1;
+			count -= step + 1;
+		}
+		else
+		{
+			count = step;
+		}
+	}
 	
-	for (int i = 0; i < tile->header->polyCount; ++i)
+	for (int i = first; i < last && edges[i].bmin <= amax[0]; ++i)
 	{
-		dtPoly* poly = &tile->polys[i];
-		const int nv = poly->vertCount;
-		for (int j = 0; j < nv; ++j)
+		const dtPortalEdge& edge = edges[i];
+		const dtPoly* poly = &tile->polys[edge.poly];
+		const int j = edge.edge;
+		if (poly->neis[j] != m) continue;
+		
+		float vc[3], vd[3];
+		dtGetTileVertex(tile, poly->verts[j], vc);
+		dtGetTileVertex(tile, poly->verts[(j+1) % poly->vertCount], vd);
+		const float bpos = getSlabCoord(vc, side);
+		
+		// Segments are not close enough.
+		if (dtAbs(apos-bpos) > 0.01f)
+			continue;
+		
+		// Check if the segments touch.
+		calcSlabEndPoints(vc,vd, bmin,bmax, side);
+		
+		if (!overlapSlabs(amin,amax, bmin,bmax, 0.01f, tile->header->walkableClimb)) continue;
+
+		// Keep the polygons in index order, using the first touching edge of each polygon.
+		int k = 0;
+		while (k < n && conPoly[k] < edge.poly)
+			k++;
+		if (k < n && conPoly[k] == edge.poly)
 		{
-			// Skip edges which do not point to the right side.
-			if (poly->neis[j] != m) continue;
-			
-			const float* vc = &tile->verts[poly->verts[j]*3];
-			const float* vd = &tile->verts[poly->verts[(j+1) % nv]*3];
-			const float bpos = getSlabCoord(vc, side);
-			
-			// Segments are not close enough.
-			if (dtAbs(apos-bpos) > 0.01f)
+			if (edge.edge > conEdge[k])
+				continue;
+		}
+		else
+		{
+			if (k >= maxcon)
 				continue;
-			
-			// Check if the segments touch.
-			calcSlabEndPoints(vc,vd, bmin,bmax, side);
-			
-			if (!overlapSlabs(amin,amax, bmin,bmax, 0.01f, tile->header->walkableClimb)) continue;
-			
-			// Add return value.
 			if (n < maxcon)
-			{
-				conarea[n*2+0] = dtMax(amin[0], bmin[0]);
-				conarea[n*2+1] = dtMin(amax[0], bmax[0]);
-				con[n] = base | (dtPolyRef)i;
 				n++;
+			for (int l = n-1; l > k; --l)
+			{
+				conPoly[l] = conPoly[l-1];
+				conEdge[l] = conEdge[l-1];
+				conarea[l*2+0] = conarea[(l-1)*2+0];
+				conarea[l*2+1] = conarea[(l-1)*2+1];
 			}
-			break;
 		}
+		conPoly[k] = edge.poly;
+		conEdge[k] = edge.edge;
+		conarea[k*2+0] = dtMax(amin[0], bmin[0]);
+		conarea[k*2+1] = dtMin(amax[0], bmax[0]);
 	}
+
+	for (int i = 0; i < n; ++i)
+		con[i] = base | (dtPolyRef)conPoly[i];
 	return n;
 }
 
@@ -368,10 +812,15 @@ void dtNavMesh::unconnectLinks(dtMeshTile* tile, dtMeshTile* target)
 				// Remove link.
 				unsigned int nj = tile->links[j].next;
 				if (pj == DT_NULL_LINK)
-					poly->firstLink = nj;
+					dtAtomicStore(&poly->firstLink, nj);
+				else
+					dtAtomicStore(&tile->links[pj].next, nj);
+				// Concurrent readers may still be traversing the link, defer reusing it.
+				// If the link cannot be retired, it stays unused until the tile is removed.
+				if (!m_deferRelease)
+					freeLink(tile, j);
 				else
-					tile->links[pj].next = nj;
-				freeLink(tile, j);
+					retire(tile, j, 0);
 				j = nj;
 			}
 			else
@@ -384,6 +833,175 @@ void dtNavMesh::unconnectLinks(dtMeshTile* tile, dtMeshTile* target)
 	}
 }
 
+bool dtNavMesh::retire(const dtMeshTile* tile, unsigned int link, void* memory)
+{
+	if (m_retiredCount >= m_retiredCapacity)
+	{
+		const int capacity = m_retiredCapacity ? m_retiredCapacity*2 : 64;
+		dtRetiredItem* items = (dtRetiredItem*)m_allocator->alloc(sizeof(dtRetiredItem)*capacity, DT_ALLOC_PERM);
+		if (!items)
+			return false;
+		if (m_retiredCount)
+			memcpy(items, m_retired, sizeof(dtRetiredItem)*m_retiredCount);
+		m_allocator->free(m_retired);
+		m_retired = items;
+		m_retiredCapacity = capacity;
+	}
+
+	// Readers which started before the current update may still access the item.
+	dtRetiredItem& item = m_retired[m_retiredCount++];
+	item.epoch = m_epoch+1;
+	item.tile = (int)tile->index;
+	item.link = link;
+	item.memory = memory;
+	return true;
+}
+
+unsigned int dtNavMesh::allocLink(dtMeshTile* tile)
+{
+	if (tile->linksFreeList == DT_NULL_LINK && !growLinks(tile))
+	{
+		m_lostLinkCount++;
+		return DT_NULL_LINK;
+	}
+	unsigned int link = tile->linksFreeList;
+	tile->linksFreeList = tile->links[link].next;
+	tile->linkCount++;
+	return link;
+}
+
+bool dtNavMesh::growLinks(dtMeshTile* tile)
+{
+	const int oldCapacity = tile->linkCapacity;
+	const int capacity = oldCapacity + dtMax(oldCapacity/2, 16);
+
+	dtLink* links = (dtLink*)m_allocator->alloc(sizeof(dtLink)*capacity, DT_ALLOC_PERM);
+	if (!links)
+		return false;
+	float* portals = 0;
+	if (tile->linkPortals)
+	{
+		portals = (float*)m_allocator->alloc(sizeof(float)*6*capacity, DT_ALLOC_PERM);
+		if (!portals)
+		{
+			m_allocator->free(links);
+			return false;
+		}
+		memcpy(portals, tile->linkPortals, sizeof(float)*6*oldCapacity);
+	}
+	if (oldCapacity)
+		memcpy(links, tile->links, sizeof(dtLink)*oldCapacity);
+
+	// The new links are only reachable once they are allocated, so concurrent
+	// readers can keep using the old arrays until they are released.
+	links[capacity-1].next = DT_NULL_LINK;
+	for (int i = oldCapacity; i < capacity-1; ++i)
+		links[i].next = (unsigned int)(i+1);
+
+	dtLink* oldLinks = ownsLinks(tile) ? tile->links : 0;
+	float* oldPortals = tile->linkPortals;
+	dtAtomicStore(&tile->links, links);
+	dtAtomicStore(&tile->linkPortals, portals);
+	tile->linkCapacity = capacity;
+	tile->linksFreeList = (unsigned int)oldCapacity;
+	if (m_deferRelease)
+	{
+		// Concurrent readers may still traverse the old arrays. If they cannot be
+		// retired, they are leaked rather than freed under the readers.
+		if (oldLinks)
+			retire(tile, DT_NULL_LINK, oldLinks);
+		if (oldPortals)
+			retire(tile, DT_NULL_LINK, oldPortals);
+	}
+	else
+	{
+		m_allocator->free(oldLinks);
+		m_allocator->free(oldPortals);
+	}
+	m_linkOverflowCount++;
+	return true;
+}
+
+void dtNavMesh::releaseTile(dtMeshTile* tile)
+{
+	if (ownsLinks(tile))
+		m_allocator->free(tile->links);
+	if (tile->flags & DT_TILE_FREE_DATA)
+		m_allocator->free(tile->data);
+
+	tile->data = 0;
+	tile->dataSize = 0;
+	tile->header = 0;
+	tile->flags = 0;
+	tile->sharedData = 0;
+	tile->linksFreeList = 0;
+	tile->polys = 0;
+	tile->verts = 0;
+	tile->links = 0;
+	tile->detailMeshes = 0;
+	tile->detailVerts = 0;
+	tile->detailTris = 0;
+	tile->bvTree = 0;
+	tile->offMeshCons = 0;
+	tile->bvWideTree = 0;
+	tile->quantVerts = 0;
+	tile->quantDetailVerts = 0;
+	tile->detailGrids = 0;
+	tile->detailGridCells = 0;
+	tile->detailGridTris = 0;
+	tile->portalEdges = 0;
+	tile->edgeClearance = 0;
+	tile->wallDistGrids = 0;
+	tile->wallDistSamples = 0;
+	m_allocator->free(tile->linkPortals);
+	tile->linkPortals = 0;
+	tile->linkCount = 0;
+	tile->linkCapacity = 0;
+
+	// Add to free list.
+	tile->next = m_nextFree;
+	m_nextFree = tile;
+}
+
+/// @par
+///
+/// Call this once all readers which may have started a query before 
+/// @p oldestReaderEpoch have completed, e.g. pass the smallest epoch recorded 
+/// by any reader that is currently running a query.
+///
+/// @see #setDeferredTileRelease, #getEpoch
+int dtNavMesh::releaseRetiredTiles(unsigned int oldestReaderEpoch)
+{
+	int released = 0;
+	int n = 0;
+	for (int i = 0; i < m_retiredCount; ++i)
+	{
+		const dtRetiredItem& item = m_retired[i];
+		// Compare using the difference so that epoch wrap-around is handled.
+		if ((int)(oldestReaderEpoch - item.epoch) < 0)
+		{
+			m_retired[n++] = item;
+			continue;
+		}
+		dtMeshTile* tile = getTileByIndex((unsigned int)item.tile);
+		if (item.memory)
+		{
+			m_allocator->free(item.memory);
+		}
+		else if (item.link == DT_NULL_LINK)
+		{
+			releaseTile(tile);
+			released++;
+		}
+		else
+		{
+			freeLink(tile, item.link);
+		}
+	}
+	m_retiredCount = n;
+	return released;
+}
+
 void dtNavMesh::connectExtLinks(dtMeshTile* tile, dtMeshTile* target, int side)
 {
 	if (!tile) return;
@@ -408,8 +1026,9 @@ void dtNavMesh::connectExtLinks(dtMeshTile* tile, dtMeshTile* target, int side)
 				continue;
 			
 			// Create new links
-			const float* va = &tile->verts[poly->verts[j]*3];
-			const float* vb = &tile->verts[poly->verts[(j+1) % nv]*3];
+			float va[3], vb[3];
+			dtGetTileVertex(tile, poly->verts[j], va);
+			dtGetTileVertex(tile, poly->verts[(j+1) % nv], vb);
 			dtPolyRef nei[4];
 			float neia[4*2];
 			int nnei = findConnectingPolys(va,vb, target, dtOppositeTile(dir), nei,neia,4);
@@ -422,9 +1041,6 @@ void dtNavMesh::connectExtLinks(dtMeshTile* tile, dtMeshTile* target, int side)
 					link->ref = nei[k];
 					link->edge = (unsigned char)j;
 					link->side = (unsigned char)dir;
-					
-					link->next = poly->firstLink;
-					poly->firstLink = idx;
 
 					// Compress portal limits to a byte value.
 					if (dir == 0 || dir == 4)
@@ -445,6 +1061,12 @@ void dtNavMesh::connectExtLinks(dtMeshTile* tile, dtMeshTile* target, int side)
 						link->bmin = (unsigned char)roundf(dtClamp(tmin, 0.0f, 1.0f)*255.0f);
 						link->bmax = (unsigned char)roundf(dtClamp(tmax, 0.0f, 1.0f)*255.0f);
 					}
+
+					storeLinkPortal(tile, poly, idx);
+
+					// Add to linked list once the link is fully initialized.
+					link->next = poly->firstLink;
+					dtAtomicStore(&poly->firstLink, idx);
 				}
 			}
 		}
@@ -458,8 +1080,13 @@ void dtNavMesh::connectExtOffMeshLinks(dtMeshTile* tile, dtMeshTile* target, int
 	// Connect off-mesh links.
 	// We are interested on links which land from target tile to this tile.
 	const unsigned char oppositeSide = (side == -1) ? 0xff : (unsigned char)dtOppositeTile(side);
+
+	// The connections are sorted by side, only visit the ones leading to this tile.
+	const int group = (side == -1) ? DT_OFFMESH_SIDE_GROUPS-1 : (int)oppositeSide;
+	const int first = target->header->offMeshSideBase[group];
+	const int last = (group+1 < DT_OFFMESH_SIDE_GROUPS) ? target->header->offMeshSideBase[group+1] : target->header->offMeshConCount;
 	
-	for (int i = 0; i < target->header->offMeshConCount; ++i)
+	for (int i = first; i < last; ++i)
 	{
 		dtOffMeshConnection* targetCon = &target->offMeshCons[i];
 		if (targetCon->side != oppositeSide)
@@ -469,21 +1096,32 @@ void dtNavMesh::connectExtOffMeshLinks(dtMeshTile* tile, dtMeshTile* target, int
 		// Skip off-mesh connections which start location could not be connected at all.
 		if (targetPoly->firstLink == DT_NULL_LINK)
 			continue;
-		
-		const float halfExtents[3] = { targetCon->rad, target->header->walkableClimb, targetCon->rad };
-		
-		// Find polygon to connect to.
-		const float* p = &targetCon->pos[3];
-		float nearestPt[3];
-		dtPolyRef ref = findNearestPolyInTile(tile, p, halfExtents, nearestPt);
-		if (!ref)
-			continue;
-		// findNearestPoly may return too optimistic results, further check to make sure. 
-		if (dtSqr(nearestPt[0]-p[0])+dtSqr(nearestPt[2]-p[2]) > dtSqr(targetCon->rad))
-			continue;
-		// Make sure the location is on current mesh.
-		float* v = &target->verts[targetPoly->verts[1]*3];
-		dtVcopy(v, nearestPt);
+
+		dtPolyRef ref = 0;
+		if (target == tile && (targetCon->flags & DT_OFFMESH_CON_RESOLVED))
+		{
+			// The landing polygon was found and the vertex snapped when the tile was built.
+			if (targetCon->endPoly == DT_OFFMESH_CON_NO_POLY)
+				continue;
+			ref = getPolyRefBase(tile) | (dtPolyRef)targetCon->endPoly;
+		}
+		else
+		{
+			const float halfExtents[3] = { targetCon->rad, target->header->walkableClimb, targetCon->rad };
+			
+			// Find polygon to connect to.
+			const float* p = &targetCon->pos[3];
+			float nearestPt[3];
+			ref = findNearestPolyInTile(tile, p, halfExtents, nearestPt);
+			if (!ref)
+				continue;
+			// findNearestPoly may return too optimistic results, further check to make sure. 
+			if (dtSqr(nearestPt[0]-p[0])+dtSqr(nearestPt[2]-p[2]) > dtSqr(targetCon->rad))
+				continue;
+			// Make sure the location is on current mesh.
+			float* v = &target->verts[(targetPoly->verts[1] - target->header->quantVertCount)*3];
+			dtVcopy(v, nearestPt);
+		}
 				
 		// Link off-mesh connection to target poly.
 		unsigned int idx = allocLink(target);
@@ -496,7 +1134,7 @@ void dtNavMesh::connectExtOffMeshLinks(dtMeshTile* tile, dtMeshTile* target, int
 			link->bmin = link->bmax = 0;
 			// Add to linked list.
 			link->next = targetPoly->firstLink;
-			targetPoly->firstLink = idx;
+			dtAtomicStore(&targetPoly->firstLink, idx);
 		}
 		
 		// Link target poly to off-mesh connection.
@@ -514,7 +1152,7 @@ void dtNavMesh::connectExtOffMeshLinks(dtMeshTile* tile, dtMeshTile* target, int
 				link->bmin = link->bmax = 0;
 				// Add to linked list.
 				link->next = landPoly->firstLink;
-				landPoly->firstLink = tidx;
+				dtAtomicStore(&landPoly->firstLink, tidx);
 			}
 		}
 	}
@@ -550,6 +1188,7 @@ void dtNavMesh::connectIntLinks(dtMeshTile* tile)
 				link->edge = (unsigned char)j;
 				link->side = 0xff;
 				link->bmin = link->bmax = 0;
+				storeLinkPortal(tile, poly, idx);
 				// Add to linked list.
 				link->next = poly->firstLink;
 				poly->firstLink = idx;
@@ -569,20 +1208,32 @@ void dtNavMesh::baseOffMeshLinks(dtMeshTile* tile)
 	{
 		dtOffMeshConnection* con = &tile->offMeshCons[i];
 		dtPoly* poly = &tile->polys[con->poly];
-	
-		const float halfExtents[3] = { con->rad, tile->header->walkableClimb, con->rad };
-		
-		// Find polygon to connect to.
-		const float* p = &con->pos[0]; // First vertex
-		float nearestPt[3];
-		dtPolyRef ref = findNearestPolyInTile(tile, p, halfExtents, nearestPt);
-		if (!ref) continue;
-		// findNearestPoly may return too optimistic results, further check to make sure. 
-		if (dtSqr(nearestPt[0]-p[0])+dtSqr(nearestPt[2]-p[2]) > dtSqr(con->rad))
-			continue;
-		// Make sure the location is on current mesh.
-		float* v = &tile->verts[poly->verts[0]*3];
-		dtVcopy(v, nearestPt);
+
+		dtPolyRef ref = 0;
+		if (con->flags & DT_OFFMESH_CON_RESOLVED)
+		{
+			// The start polygon was found and the vertex snapped when the tile was built.
+			if (con->startPoly == DT_OFFMESH_CON_NO_POLY)
+				continue;
+			ref = base | (dtPolyRef)con->startPoly;
+		}
+		else
+		{
+			const float halfExtents[3] = { con->rad, tile->header->walkableClimb, con->rad };
+			
+			// Find polygon to connect to.
+			const float* p = &con->pos[0]; // First vertex
+			float nearestPt[3];
+			ref = findNearestPolyInTile(tile, p, halfExtents, nearestPt);
+			if (!ref) continue;
+			// findNearestPoly may return too optimistic results, further check to make sure. 
+			if (dtSqr(nearestPt[0]-p[0])+dtSqr(nearestPt[2]-p[2]) > dtSqr(con->rad))
+				continue;
+			// Make sure the location is on current mesh.
+			// Off-mesh connection vertices are never quantized.
+			float* v = &tile->verts[(poly->verts[0] - tile->header->quantVertCount)*3];
+			dtVcopy(v, nearestPt);
+		}
 
 		// Link off-mesh connection to target poly.
 		unsigned int idx = allocLink(tile);
@@ -626,8 +1277,8 @@ namespace
 
 		float dmin = FLT_MAX;
 		float tmin = 0;
-		const float* pmin = 0;
-		const float* pmax = 0;
+		float pmin[3] = { 0, 0, 0 };
+		float pmax[3] = { 0, 0, 0 };
 
 		for (int i = 0; i < pd->triCount; i++)
 		{
@@ -639,14 +1290,9 @@ namespace
 			if (onlyBoundary && (tris[3] & ANY_BOUNDARY_EDGE) == 0)
 				continue;
 
-			const float* v[3];
+			float v[3][3];
 			for (int j = 0; j < 3; ++j)
-			{
-				if (tris[j] < poly->vertCount)
-					v[j] = &tile->verts[poly->verts[tris[j]] * 3];
-				else
-					v[j] = &tile->detailVerts[(pd->vertBase + (tris[j] - poly->vertCount)) * 3];
-			}
+				dtGetDetailTriVertex(tile, poly, pd, tris[j], v[j]);
 
 			for (int k = 0, j = 2; k < 3; j = k++)
 			{
@@ -664,8 +1310,8 @@ namespace
 				{
 					dmin = d;
 					tmin = t;
-					pmin = v[j];
-					pmax = v[k];
+					dtVcopy(pmin, v[j]);
+					dtVcopy(pmax, v[k]);
 				}
 			}
 		}
@@ -687,7 +1333,7 @@ bool dtNavMesh::getPolyHeight(const dtMeshTile* tile, const dtPoly* poly, const
 	float verts[DT_VERTS_PER_POLYGON*3];	
 	const int nv = poly->vertCount;
 	for (int i = 0; i < nv; ++i)
-		dtVcopy(&verts[i*3], &tile->verts[poly->verts[i]*3]);
+		dtGetTileVertex(tile, poly->verts[i], &verts[i*3]);
 	
 	if (!dtPointInPolygon(pos, verts, nv))
 		return false;
@@ -695,17 +1341,33 @@ bool dtNavMesh::getPolyHeight(const dtMeshTile* tile, const dtPoly* poly, const
 	if (!height)
 		return true;
 	
-	// Find height at the location.
-	for (int j = 0; j < pd->triCount; ++j)
+	// Find height at the location. If the polygon has a detail grid, only the
+	// triangles overlapping the grid cell at the location need to be checked.
+	int first = 0;
+	int last = pd->triCount;
+	const unsigned char* gridTris = 0;
+	if (tile->detailGrids && tile->detailGrids[ip].size)
 	{
+		const dtDetailGrid& grid = tile->detailGrids[ip];
+		const int size = (int)grid.size;
+		const int x = dtClamp((int)dtMathFloorf((pos[0] - grid.bmin[0]) * grid.invCellSize[0]), 0, size-1);
+		const int z = dtClamp((int)dtMathFloorf((pos[2] - grid.bmin[1]) * grid.invCellSize[1]), 0, size-1);
+		const unsigned int* cell = &tile->detailGridCells[grid.cellBase + x + z*size];
+		first = (int)cell[0];
+		last = (int)cell[1];
+		gridTris = tile->detailGridTris;
+	}
+	for (int n = first; n < last; ++n)
+	{
+		const int j = gridTris ? (int)gridTris[n] : n;
 		const unsigned char* t = &tile->detailTris[(pd->triBase+j)*4];
-		const float* v[3];
+		float v[3][3];
 		for (int k = 0; k < 3; ++k)
 		{
 			if (t[k] < poly->vertCount)
-				v[k] = &tile->verts[poly->verts[t[k]]*3];
+				dtVcopy(v[k], &verts[t[k]*3]);
 			else
-				v[k] = &tile->detailVerts[(pd->vertBase+(t[k]-poly->vertCount))*3];
+				dtGetDetailVertex(tile, (int)(pd->vertBase+(t[k]-poly->vertCount)), v[k]);
 		}
 		float h;
 		if (dtClosestHeightPointTriangle(pos, v[0], v[1], v[2], h))
@@ -745,8 +1407,9 @@ void dtNavMesh::closestPointOnPoly(dtPolyRef ref, const float* pos, float* close
 	// Off-mesh connections don't have detail polygons.
 	if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
 	{
-		const float* v0 = &tile->verts[poly->verts[0]*3];
-		const float* v1 = &tile->verts[poly->verts[1]*3];
+		float v0[3], v1[3];
+		dtGetTileVertex(tile, poly->verts[0], v0);
+		dtGetTileVertex(tile, poly->verts[1], v1);
 		float t;
 		dtDistancePtSegSqr2D(pos, v0, v1, t);
 		dtVlerp(closest, v0, v1, t);
@@ -855,38 +1518,204 @@ int dtNavMesh::queryPolygonsInTile(const dtMeshTile* tile, const float* qmin, co
 				node += escapeIndex;
 			}
 		}
-		
-		return n;
+		
+		return n;
+	}
+	else
+	{
+		float bmin[3], bmax[3];
+		int n = 0;
+		dtPolyRef base = getPolyRefBase(tile);
+		for (int i = 0; i < tile->header->polyCount; ++i)
+		{
+			dtPoly* p = &tile->polys[i];
+			// Do not return off-mesh connection polygons.
+			if (p->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+				continue;
+			// Calc polygon bounds.
+			float v[3];
+			dtGetTileVertex(tile, p->verts[0], v);
+			dtVcopy(bmin, v);
+			dtVcopy(bmax, v);
+			for (int j = 1; j < p->vertCount; ++j)
+			{
+				dtGetTileVertex(tile, p->verts[j], v);
+				dtVmin(bmin, v);
+				dtVmax(bmax, v);
+			}
+			if (dtOverlapBounds(qmin,qmax, bmin,bmax))
+			{
+				if (n < maxPolys)
+					polys[n++] = base | (dtPolyRef)i;
+			}
+		}
+		return n;
+	}
+}
+
+/// Points the tile at the sections of tile data laid out by dtCreateNavMeshData.
+static void setTilePointers(dtMeshTile* tile, const dtMeshHeader* header, unsigned char* data)
+{
+	const int headerSize = dtAlign4(sizeof(dtMeshHeader));
+	const int vertsSize = dtAlign4(sizeof(float)*3*(header->vertCount-header->quantVertCount));
+	const int polysSize = dtAlign4(sizeof(dtPoly)*header->polyCount);
+	const int linksSize = dtAlign4(sizeof(dtLink)*(header->maxLinkCount));
+	const int detailMeshesSize = dtAlign4(sizeof(dtPolyDetail)*header->detailMeshCount);
+	const int detailVertsSize = dtAlign4(sizeof(float)*3*(header->detailVertCount-header->quantDetailVertCount));
+	const int detailTrisSize = dtAlign4(sizeof(unsigned char)*4*header->detailTriCount);
+	const int bvtreeSize = dtAlign4(sizeof(dtBVNode)*header->bvNodeCount);
+	const int offMeshLinksSize = dtAlign4(sizeof(dtOffMeshConnection)*header->offMeshConCount);
+	const int bvWideTreeSize = dtAlign4(sizeof(dtBVWideNode)*header->bvWideNodeCount);
+	const int quantVertsSize = dtAlign4(sizeof(unsigned short)*3*header->quantVertCount);
+	const int quantDetailVertsSize = dtAlign4(sizeof(unsigned short)*3*header->quantDetailVertCount);
+	const int detailGridsSize = dtAlign4(sizeof(dtDetailGrid)*header->detailGridCount);
+	const int detailGridCellsSize = dtAlign4(sizeof(unsigned int)*header->detailGridCellCount);
+	const int detailGridTrisSize = dtAlign4(sizeof(unsigned char)*header->detailGridTriCount);
+	const int portalEdgesSize = dtAlign4(sizeof(dtPortalEdge)*header->portalEdgeCount);
+	const int edgeClearanceSize = dtAlign4(sizeof(unsigned char)*header->edgeClearanceCount);
+	const int wallDistGridsSize = dtAlign4(sizeof(dtWallDistGrid)*header->wallDistGridCount);
+	const int wallDistSamplesSize = dtAlign4(sizeof(unsigned char)*header->wallDistSampleCount);
+	
+	unsigned char* d = data + headerSize;
+	tile->verts = dtGetThenAdvanceBufferPointer<float>(d, vertsSize);
+	tile->polys = dtGetThenAdvanceBufferPointer<dtPoly>(d, polysSize);
+	tile->links = dtGetThenAdvanceBufferPointer<dtLink>(d, linksSize);
+	tile->detailMeshes = dtGetThenAdvanceBufferPointer<dtPolyDetail>(d, detailMeshesSize);
+	tile->detailVerts = dtGetThenAdvanceBufferPointer<float>(d, detailVertsSize);
+	tile->detailTris = dtGetThenAdvanceBufferPointer<unsigned char>(d, detailTrisSize);
+	tile->bvTree = dtGetThenAdvanceBufferPointer<dtBVNode>(d, bvtreeSize);
+	tile->offMeshCons = dtGetThenAdvanceBufferPointer<dtOffMeshConnection>(d, offMeshLinksSize);
+	tile->bvWideTree = dtGetThenAdvanceBufferPointer<dtBVWideNode>(d, bvWideTreeSize);
+	tile->quantVerts = dtGetThenAdvanceBufferPointer<unsigned short>(d, quantVertsSize);
+	tile->quantDetailVerts = dtGetThenAdvanceBufferPointer<unsigned short>(d, quantDetailVertsSize);
+	tile->detailGrids = dtGetThenAdvanceBufferPointer<dtDetailGrid>(d, detailGridsSize);
+	tile->detailGridCells = dtGetThenAdvanceBufferPointer<unsigned int>(d, detailGridCellsSize);
+	tile->detailGridTris = dtGetThenAdvanceBufferPointer<unsigned char>(d, detailGridTrisSize);
+	tile->portalEdges = dtGetThenAdvanceBufferPointer<dtPortalEdge>(d, portalEdgesSize);
+	tile->edgeClearance = dtGetThenAdvanceBufferPointer<unsigned char>(d, edgeClearanceSize);
+	tile->wallDistGrids = dtGetThenAdvanceBufferPointer<dtWallDistGrid>(d, wallDistGridsSize);
+	tile->wallDistSamples = dtGetThenAdvanceBufferPointer<unsigned char>(d, wallDistSamplesSize);
+
+	// If there are no items in the bvtree, reset the tree pointer.
+	if (!bvtreeSize)
+		tile->bvTree = 0;
+	if (!bvWideTreeSize)
+		tile->bvWideTree = 0;
+	if (!quantVertsSize)
+		tile->quantVerts = 0;
+	if (!quantDetailVertsSize)
+		tile->quantDetailVerts = 0;
+	if (!detailGridsSize)
+		tile->detailGrids = 0;
+	if (!edgeClearanceSize)
+		tile->edgeClearance = 0;
+	if (!wallDistGridsSize)
+	{
+		tile->wallDistGrids = 0;
+		tile->wallDistSamples = 0;
+	}
+}
+
+/// The sections of the tile data which are not shared by the instances of the tile, in the
+/// order they are stored in the instance data. (See: dtNavMesh::addTileInstance)
+struct dtTileInstanceLayout
+{
+	int headerSize;
+	int vertsSize;
+	int polysSize;
+	int linksSize;
+	int offMeshConsSize;
+	int detailVertsSize;
+	int detailGridsSize;
+	int portalEdgesSize;
+	int wallDistGridsSize;
+	int dataSize;
+};
+
+static void calcTileInstanceLayout(const dtMeshHeader* header, dtTileInstanceLayout& layout)
+{
+	layout.headerSize = dtAlign4(sizeof(dtMeshHeader));
+	layout.vertsSize = dtAlign4(sizeof(float)*3*(header->vertCount-header->quantVertCount));
+	layout.polysSize = dtAlign4(sizeof(dtPoly)*header->polyCount);
+	layout.linksSize = dtAlign4(sizeof(dtLink)*header->maxLinkCount);
+	layout.offMeshConsSize = dtAlign4(sizeof(dtOffMeshConnection)*header->offMeshConCount);
+	layout.detailVertsSize = dtAlign4(sizeof(float)*3*(header->detailVertCount-header->quantDetailVertCount));
+	layout.detailGridsSize = dtAlign4(sizeof(dtDetailGrid)*header->detailGridCount);
+	layout.portalEdgesSize = dtAlign4(sizeof(dtPortalEdge)*header->portalEdgeCount);
+	layout.wallDistGridsSize = dtAlign4(sizeof(dtWallDistGrid)*header->wallDistGridCount);
+	layout.dataSize = layout.headerSize + layout.vertsSize + layout.polysSize + layout.linksSize +
+		layout.offMeshConsSize + layout.detailVertsSize + layout.detailGridsSize + layout.portalEdgesSize +
+		layout.wallDistGridsSize;
+}
+
+/// Copies the sections of the shared data which are not shared to the instance data, moving the ones
+/// in world space by the offset, and points the tile at them. The tile points at the shared data.
+static void copyInstanceSections(dtMeshTile* tile, const dtMeshHeader* header, unsigned char* data, const float* offset)
+{
+	dtTileInstanceLayout layout;
+	calcTileInstanceLayout(header, layout);
+
+	unsigned char* d = data + layout.headerSize;
+	float* verts = dtGetThenAdvanceBufferPointer<float>(d, layout.vertsSize);
+	dtPoly* polys = dtGetThenAdvanceBufferPointer<dtPoly>(d, layout.polysSize);
+	dtLink* links = dtGetThenAdvanceBufferPointer<dtLink>(d, layout.linksSize);
+	dtOffMeshConnection* offMeshCons = dtGetThenAdvanceBufferPointer<dtOffMeshConnection>(d, layout.offMeshConsSize);
+	float* detailVerts = dtGetThenAdvanceBufferPointer<float>(d, layout.detailVertsSize);
+	dtDetailGrid* detailGrids = dtGetThenAdvanceBufferPointer<dtDetailGrid>(d, layout.detailGridsSize);
+	dtPortalEdge* portalEdges = dtGetThenAdvanceBufferPointer<dtPortalEdge>(d, layout.portalEdgesSize);
+	dtWallDistGrid* wallDistGrids = dtGetThenAdvanceBufferPointer<dtWallDistGrid>(d, layout.wallDistGridsSize);
+
+	const int vertCount = header->vertCount - header->quantVertCount;
+	memcpy(verts, tile->verts, sizeof(float)*3*vertCount);
+	for (int i = 0; i < vertCount; ++i)
+		dtVadd(&verts[i*3], &verts[i*3], offset);
+	memcpy(polys, tile->polys, sizeof(dtPoly)*header->polyCount);
+	memcpy(offMeshCons, tile->offMeshCons, sizeof(dtOffMeshConnection)*header->offMeshConCount);
+	for (int i = 0; i < header->offMeshConCount; ++i)
+	{
+		dtVadd(&offMeshCons[i].pos[0], &offMeshCons[i].pos[0], offset);
+		dtVadd(&offMeshCons[i].pos[3], &offMeshCons[i].pos[3], offset);
+	}
+	const int detailVertCount = header->detailVertCount - header->quantDetailVertCount;
+	memcpy(detailVerts, tile->detailVerts, sizeof(float)*3*detailVertCount);
+	for (int i = 0; i < detailVertCount; ++i)
+		dtVadd(&detailVerts[i*3], &detailVerts[i*3], offset);
+	if (tile->detailGrids)
+	{
+		memcpy(detailGrids, tile->detailGrids, sizeof(dtDetailGrid)*header->detailGridCount);
+		for (int i = 0; i < header->detailGridCount; ++i)
+		{
+			detailGrids[i].bmin[0] += offset[0];
+			detailGrids[i].bmin[1] += offset[2];
+		}
+		tile->detailGrids = detailGrids;
 	}
-	else
+	// The portal edges of the x-sides are along z, the others along x.
+	memcpy(portalEdges, tile->portalEdges, sizeof(dtPortalEdge)*header->portalEdgeCount);
+	for (int i = 0; i < header->portalEdgeCount; ++i)
 	{
-		float bmin[3], bmax[3];
-		int n = 0;
-		dtPolyRef base = getPolyRefBase(tile);
-		for (int i = 0; i < tile->header->polyCount; ++i)
+		dtPortalEdge& edge = portalEdges[i];
+		const float move = (edge.side == 0 || edge.side == 4) ? offset[2] : offset[0];
+		edge.bmin += move;
+		edge.bmax += move;
+	}
+	if (tile->wallDistGrids)
+	{
+		memcpy(wallDistGrids, tile->wallDistGrids, sizeof(dtWallDistGrid)*header->wallDistGridCount);
+		for (int i = 0; i < header->wallDistGridCount; ++i)
 		{
-			dtPoly* p = &tile->polys[i];
-			// Do not return off-mesh connection polygons.
-			if (p->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
-				continue;
-			// Calc polygon bounds.
-			const float* v = &tile->verts[p->verts[0]*3];
-			dtVcopy(bmin, v);
-			dtVcopy(bmax, v);
-			for (int j = 1; j < p->vertCount; ++j)
-			{
-				v = &tile->verts[p->verts[j]*3];
-				dtVmin(bmin, v);
-				dtVmax(bmax, v);
-			}
-			if (dtOverlapBounds(qmin,qmax, bmin,bmax))
-			{
-				if (n < maxPolys)
-					polys[n++] = base | (dtPolyRef)i;
-			}
+			wallDistGrids[i].bmin[0] += offset[0];
+			wallDistGrids[i].bmin[1] += offset[2];
 		}
-		return n;
+		tile->wallDistGrids = wallDistGrids;
 	}
+
+	tile->verts = verts;
+	tile->polys = polys;
+	tile->links = links;
+	tile->offMeshCons = offMeshCons;
+	tile->detailVerts = detailVerts;
+	tile->portalEdges = portalEdges;
 }
 
 /// @par
@@ -904,9 +1733,75 @@ int dtNavMesh::queryPolygonsInTile(const dtMeshTile* tile, const float* qmin, co
 /// should not be reused in other nav meshes until the tile has been successfully
 /// removed from this nav mesh.
 ///
-/// @see dtCreateNavMeshData, #removeTile
+/// @see dtCreateNavMeshData, #removeTile, #addTileInstance
 dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 							dtTileRef lastRef, dtTileRef* result)
+{
+	return addTileData(data, dataSize, flags & ~DT_TILE_INSTANCE, 0, 0, lastRef, result);
+}
+
+/// @par
+///
+/// The instance copies the header, the polygons and the sections of the tile data which are in
+/// world space: the vertices which are not quantized, the off-mesh connections, the detail vertices
+/// which are not quantized, and the bounds of the detail grids, portal edges and wall distance grids.
+/// The links, the polygon flags and areas are per instance. The detail meshes and triangles, the
+/// bounding volume trees, the quantized vertices, the edge clearances and the wall distance samples
+/// are relative to the tile bounds and are shared, so tiles built with quantized vertices
+/// (See: dtNavMeshCreateParams::quantizeVerts) share most of their data.
+///
+/// The shared data is not modified, and must stay valid until all of its instances are removed.
+/// It may be instanced any number of times, in one or in several navigation meshes.
+/// The instance data is owned by the navigation mesh, #removeTile does not return it.
+///
+/// The instance is placed at the tile location of the shared tile moved by the offset, so the
+/// xz-offset must be a whole number of tiles for the portal edges to line up with the neighbour
+/// tiles. Instanced tiles are not stored by #dtCreateNavMeshFile.
+///
+/// @see #addTile, #removeTile
+dtStatus dtNavMesh::addTileInstance(const unsigned char* data, int dataSize, const float* offset,
+									dtTileRef lastRef, dtTileRef* result)
+{
+	if (!data || dataSize < (int)sizeof(dtMeshHeader) || !offset)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	const dtMeshHeader* sharedHeader = (const dtMeshHeader*)data;
+	if (sharedHeader->magic != DT_NAVMESH_MAGIC)
+		return DT_FAILURE | DT_WRONG_MAGIC;
+	if (sharedHeader->version != DT_NAVMESH_VERSION)
+		return DT_FAILURE | DT_WRONG_VERSION;
+
+	// The offset must move the tile from one tile location to another.
+	const float fx = offset[0] / m_tileWidth;
+	const float fy = offset[2] / m_tileHeight;
+	const int dx = (int)floorf(fx + 0.5f);
+	const int dy = (int)floorf(fy + 0.5f);
+	if (dtAbs(fx - (float)dx) > 1e-3f || dtAbs(fy - (float)dy) > 1e-3f)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	dtTileInstanceLayout layout;
+	calcTileInstanceLayout(sharedHeader, layout);
+	unsigned char* instData = (unsigned char*)m_allocator->alloc(layout.dataSize, DT_ALLOC_PERM);
+	if (!instData)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(instData, 0, layout.dataSize);
+
+	dtMeshHeader* header = (dtMeshHeader*)instData;
+	memcpy(header, sharedHeader, sizeof(dtMeshHeader));
+	header->x += dx;
+	header->y += dy;
+	dtVadd(header->bmin, header->bmin, offset);
+	dtVadd(header->bmax, header->bmax, offset);
+	dtVadd(header->quantDetailBmin, header->quantDetailBmin, offset);
+
+	dtStatus status = addTileData(instData, layout.dataSize, DT_TILE_FREE_DATA | DT_TILE_INSTANCE, data, offset,
+								  lastRef, result);
+	if (dtStatusFailed(status))
+		m_allocator->free(instData);
+	return status;
+}
+
+dtStatus dtNavMesh::addTileData(unsigned char* data, int dataSize, int flags, const unsigned char* sharedData,
+								const float* offset, dtTileRef lastRef, dtTileRef* result)
 {
 	// Make sure the data is in right format.
 	dtMeshHeader* header = (dtMeshHeader*)data;
@@ -925,11 +1820,22 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 	// Make sure the location is free.
 	if (getTileAt(header->x, header->y, header->layer))
 		return DT_FAILURE | DT_ALREADY_OCCUPIED;
+
+	// Connect the tile right away if it cannot be queued.
+	if ((flags & DT_TILE_PENDING_LINKS) && !reservePendingTile())
+		flags &= ~DT_TILE_PENDING_LINKS;
+
+	// Keep the load factor of the open addressing lookup at most one half.
+	if ((m_flags & DT_NAVMESH_SPARSE_TILES) && (m_tileSlotCount+1)*2 > m_tileLutSize &&
+		!resizeTileSlots(m_tileLutSize ? m_tileLutSize*2 : 64))
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
 		
 	// Allocate a tile.
 	dtMeshTile* tile = 0;
 	if (!lastRef)
 	{
+		if (!m_nextFree && (m_flags & DT_NAVMESH_SPARSE_TILES))
+			allocTilePage();
 		if (m_nextFree)
 		{
 			tile = m_nextFree;
@@ -941,10 +1847,15 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 	{
 		// Try to relocate the tile to specific index with same salt.
 		int tileIndex = (int)decodePolyIdTile((dtPolyRef)lastRef);
+		while (tileIndex >= m_maxTiles && (m_flags & DT_NAVMESH_SPARSE_TILES))
+		{
+			if (!allocTilePage())
+				break;
+		}
 		if (tileIndex >= m_maxTiles)
 			return DT_FAILURE | DT_OUT_OF_MEMORY;
 		// Try to find the specific tile id from the free list.
-		dtMeshTile* target = &m_tiles[tileIndex];
+		dtMeshTile* target = getTileByIndex((unsigned int)tileIndex);
 		dtMeshTile* prev = 0;
 		tile = m_nextFree;
 		while (tile && tile != target)
@@ -968,48 +1879,42 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 	// Make sure we could allocate a tile.
 	if (!tile)
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
-	
-	// Insert tile into the position lut.
-	int h = computeTileHash(header->x, header->y, m_tileLutMask);
-	tile->next = m_posLookup[h];
-	m_posLookup[h] = tile;
+
+	if (m_flags & DT_NAVMESH_PORTAL_CACHE)
+	{
+		tile->linkPortals = (float*)m_allocator->alloc(sizeof(float)*6*dtMax(header->maxLinkCount, 1), DT_ALLOC_PERM);
+		if (!tile->linkPortals)
+		{
+			tile->next = m_nextFree;
+			m_nextFree = tile;
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		}
+	}
 	
 	// Patch header pointers.
-	const int headerSize = dtAlign4(sizeof(dtMeshHeader));
-	const int vertsSize = dtAlign4(sizeof(float)*3*header->vertCount);
-	const int polysSize = dtAlign4(sizeof(dtPoly)*header->polyCount);
-	const int linksSize = dtAlign4(sizeof(dtLink)*(header->maxLinkCount));
-	const int detailMeshesSize = dtAlign4(sizeof(dtPolyDetail)*header->detailMeshCount);
-	const int detailVertsSize = dtAlign4(sizeof(float)*3*header->detailVertCount);
-	const int detailTrisSize = dtAlign4(sizeof(unsigned char)*4*header->detailTriCount);
-	const int bvtreeSize = dtAlign4(sizeof(dtBVNode)*header->bvNodeCount);
-	const int offMeshLinksSize = dtAlign4(sizeof(dtOffMeshConnection)*header->offMeshConCount);
-	
-	unsigned char* d = data + headerSize;
-	tile->verts = dtGetThenAdvanceBufferPointer<float>(d, vertsSize);
-	tile->polys = dtGetThenAdvanceBufferPointer<dtPoly>(d, polysSize);
-	tile->links = dtGetThenAdvanceBufferPointer<dtLink>(d, linksSize);
-	tile->detailMeshes = dtGetThenAdvanceBufferPointer<dtPolyDetail>(d, detailMeshesSize);
-	tile->detailVerts = dtGetThenAdvanceBufferPointer<float>(d, detailVertsSize);
-	tile->detailTris = dtGetThenAdvanceBufferPointer<unsigned char>(d, detailTrisSize);
-	tile->bvTree = dtGetThenAdvanceBufferPointer<dtBVNode>(d, bvtreeSize);
-	tile->offMeshCons = dtGetThenAdvanceBufferPointer<dtOffMeshConnection>(d, offMeshLinksSize);
-
-	// If there are no items in the bvtree, reset the tree pointer.
-	if (!bvtreeSize)
-		tile->bvTree = 0;
+	if (sharedData)
+	{
+		setTilePointers(tile, header, (unsigned char*)sharedData);
+		copyInstanceSections(tile, header, data, offset);
+	}
+	else
+	{
+		setTilePointers(tile, header, data);
+	}
 
 	// Build links freelist
-	tile->linksFreeList = 0;
-	tile->links[header->maxLinkCount-1].next = DT_NULL_LINK;
-	for (int i = 0; i < header->maxLinkCount-1; ++i)
-		tile->links[i].next = i+1;
+	tile->linksFreeList = header->maxLinkCount > 0 ? 0 : DT_NULL_LINK;
+	for (int i = 0; i < header->maxLinkCount; ++i)
+		tile->links[i].next = i+1 < header->maxLinkCount ? (unsigned int)(i+1) : DT_NULL_LINK;
+	tile->linkCount = 0;
+	tile->linkCapacity = header->maxLinkCount;
 
 	// Init tile.
 	tile->header = header;
 	tile->data = data;
 	tile->dataSize = dataSize;
 	tile->flags = flags;
+	tile->sharedData = sharedData;
 
 	connectIntLinks(tile);
 
@@ -1017,7 +1922,33 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 	baseOffMeshLinks(tile);
 	connectExtOffMeshLinks(tile, tile, -1);
 
-	// Create connections with neighbour tiles.
+	// Pending tiles are connected to their neighbours later.
+	if (flags & DT_TILE_PENDING_LINKS)
+		m_pendingTiles[m_pendingTileCount++] = getTileRef(tile);
+	else
+		connectNeighbourTiles(tile);
+
+	// Insert tile into the position lut.
+	// This is done last, so that the tile is only found once it is fully initialized.
+	insertTileLookup(tile);
+
+	dtAtomicStore(&m_epoch, m_epoch+1);
+	tile->generation = ++m_generation;
+	notifyChange(DT_CHANGE_TILE_ADDED, getTileRef(tile), 0, tile->header, tile->generation);
+	
+	if (result)
+		*result = getTileRef(tile);
+	
+	return DT_SUCCESS;
+}
+
+/// @par
+///
+/// A connection between two tiles is made by whichever of them is connected last, so pending
+/// neighbours are skipped here and connect to this tile once they are processed.
+void dtNavMesh::connectNeighbourTiles(dtMeshTile* tile)
+{
+	const dtMeshHeader* header = tile->header;
 	static const int MAX_NEIS = 32;
 	dtMeshTile* neis[MAX_NEIS];
 	int nneis;
@@ -1026,7 +1957,7 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 	nneis = getTilesAt(header->x, header->y, neis, MAX_NEIS);
 	for (int j = 0; j < nneis; ++j)
 	{
-		if (neis[j] == tile)
+		if (neis[j] == tile || (neis[j]->flags & DT_TILE_PENDING_LINKS))
 			continue;
 	
 		connectExtLinks(tile, neis[j], -1);
@@ -1041,24 +1972,94 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 		nneis = getNeighbourTilesAt(header->x, header->y, i, neis, MAX_NEIS);
 		for (int j = 0; j < nneis; ++j)
 		{
+			if (neis[j]->flags & DT_TILE_PENDING_LINKS)
+				continue;
 			connectExtLinks(tile, neis[j], i);
 			connectExtLinks(neis[j], tile, dtOppositeTile(i));
 			connectExtOffMeshLinks(tile, neis[j], i);
 			connectExtOffMeshLinks(neis[j], tile, dtOppositeTile(i));
 		}
 	}
+}
+
+bool dtNavMesh::reservePendingTile()
+{
+	if (m_pendingTileCount < m_pendingTileCapacity)
+		return true;
+	const int capacity = m_pendingTileCapacity ? m_pendingTileCapacity*2 : 16;
+	dtTileRef* tiles = (dtTileRef*)m_allocator->alloc(sizeof(dtTileRef)*capacity, DT_ALLOC_PERM);
+	if (!tiles)
+		return false;
+	if (m_pendingTileCount)
+		memcpy(tiles, m_pendingTiles, sizeof(dtTileRef)*m_pendingTileCount);
+	m_allocator->free(m_pendingTiles);
+	m_pendingTiles = tiles;
+	m_pendingTileCapacity = capacity;
+	return true;
+}
+
+/// @par
+///
+/// Adding a tile with #DT_TILE_PENDING_LINKS only builds its internal links and its own
+/// off-mesh connections, which bounds the cost of a burst of streamed tiles. The neighbour
+/// links are then built by this method, a few tiles per frame. Until a tile is connected,
+/// its polygons are valid but paths do not cross its borders.
+///
+/// Removing a pending tile also removes it from the queue.
+dtStatus dtNavMesh::connectPendingTiles(int maxTiles, int* connectedTiles)
+{
+	if (connectedTiles)
+		*connectedTiles = 0;
+	if (maxTiles <= 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
 	
-	if (result)
-		*result = getTileRef(tile);
+	const int n = dtMin(maxTiles, m_pendingTileCount);
+	for (int i = 0; i < n; ++i)
+	{
+		dtMeshTile* tile = getTileByIndex(decodePolyIdTile((dtPolyRef)m_pendingTiles[i]));
+		tile->flags &= ~DT_TILE_PENDING_LINKS;
+		connectNeighbourTiles(tile);
+		
+		dtAtomicStore(&m_epoch, m_epoch+1);
+		tile->generation = ++m_generation;
+		notifyChange(DT_CHANGE_TILE_LINKED, m_pendingTiles[i], 0, tile->header, tile->generation);
+	}
+	m_pendingTileCount -= n;
+	if (m_pendingTileCount)
+		memmove(m_pendingTiles, m_pendingTiles + n, sizeof(dtTileRef)*m_pendingTileCount);
 	
-	return DT_SUCCESS;
+	if (connectedTiles)
+		*connectedTiles = n;
+	return m_pendingTileCount ? DT_SUCCESS | DT_IN_PROGRESS : DT_SUCCESS;
 }
 
 const dtMeshTile* dtNavMesh::getTileAt(const int x, const int y, const int layer) const
 {
+	if (m_tileGrid)
+	{
+		const int slot = getTileGridSlot(x, y, layer);
+		if (slot >= 0)
+			return dtAtomicLoad(&m_tileGrid[slot]);
+		if (!m_tileGridOverflow)
+			return 0;
+	}
+
+	if (m_flags & DT_NAVMESH_SPARSE_TILES)
+	{
+		if (!m_tileSlots)
+			return 0;
+		for (int h = computeTileHash(x,y,m_tileLutMask); m_tileSlots[h].tile; h = (h+1) & m_tileLutMask)
+		{
+			const dtTileSlot& slot = m_tileSlots[h];
+			if (slot.x == x && slot.y == y && slot.tile->header->layer == layer)
+				return slot.tile;
+		}
+		return 0;
+	}
+
 	// Find tile based on hash.
 	int h = computeTileHash(x,y,m_tileLutMask);
-	dtMeshTile* tile = m_posLookup[h];
+	dtMeshTile* tile = dtAtomicLoad(&m_posLookup[h]);
 	while (tile)
 	{
 		if (tile->header &&
@@ -1068,7 +2069,7 @@ const dtMeshTile* dtNavMesh::getTileAt(const int x, const int y, const int layer
 		{
 			return tile;
 		}
-		tile = tile->next;
+		tile = dtAtomicLoad(&tile->next);
 	}
 	return 0;
 }
@@ -1093,24 +2094,8 @@ int dtNavMesh::getNeighbourTilesAt(const int x, const int y, const int side, dtM
 
 int dtNavMesh::getTilesAt(const int x, const int y, dtMeshTile** tiles, const int maxTiles) const
 {
-	int n = 0;
-	
-	// Find tile based on hash.
-	int h = computeTileHash(x,y,m_tileLutMask);
-	dtMeshTile* tile = m_posLookup[h];
-	while (tile)
-	{
-		if (tile->header &&
-			tile->header->x == x &&
-			tile->header->y == y)
-		{
-			if (n < maxTiles)
-				tiles[n++] = tile;
-		}
-		tile = tile->next;
-	}
-	
-	return n;
+	// The tiles are owned by the navigation mesh, so handing out mutable tiles is safe here.
+	return getTilesAt(x, y, (const dtMeshTile**)tiles, maxTiles);
 }
 
 /// @par
@@ -1120,20 +2105,58 @@ int dtNavMesh::getTilesAt(const int x, const int y, dtMeshTile** tiles, const in
 int dtNavMesh::getTilesAt(const int x, const int y, dtMeshTile const** tiles, const int maxTiles) const
 {
 	int n = 0;
+
+	// The layers of the grid cell come first, in layer order. The hash lookup then only adds the other layers.
+	int gridLayers = 0;
+	if (m_tileGrid)
+	{
+		const int first = getTileGridSlot(x, y, 0);
+		if (first >= 0)
+		{
+			int remaining = m_tileGridCounts[first / m_tileGridLayers];
+			for (int i = 0; remaining > 0 && i < m_tileGridLayers; ++i)
+			{
+				const dtMeshTile* tile = dtAtomicLoad(&m_tileGrid[first + i]);
+				if (!tile)
+					continue;
+				if (n < maxTiles)
+					tiles[n++] = tile;
+				remaining--;
+			}
+			gridLayers = m_tileGridLayers;
+		}
+		if (!m_tileGridOverflow)
+			return n;
+	}
+
+	if (m_flags & DT_NAVMESH_SPARSE_TILES)
+	{
+		if (!m_tileSlots)
+			return n;
+		for (int h = computeTileHash(x,y,m_tileLutMask); m_tileSlots[h].tile; h = (h+1) & m_tileLutMask)
+		{
+			const dtTileSlot& slot = m_tileSlots[h];
+			const int layer = slot.tile->header->layer;
+			if (slot.x == x && slot.y == y && (layer < 0 || layer >= gridLayers) && n < maxTiles)
+				tiles[n++] = slot.tile;
+		}
+		return n;
+	}
 	
 	// Find tile based on hash.
 	int h = computeTileHash(x,y,m_tileLutMask);
-	dtMeshTile* tile = m_posLookup[h];
+	dtMeshTile* tile = dtAtomicLoad(&m_posLookup[h]);
 	while (tile)
 	{
 		if (tile->header &&
 			tile->header->x == x &&
-			tile->header->y == y)
+			tile->header->y == y &&
+			(tile->header->layer < 0 || tile->header->layer >= gridLayers))
 		{
 			if (n < maxTiles)
 				tiles[n++] = tile;
 		}
-		tile = tile->next;
+		tile = dtAtomicLoad(&tile->next);
 	}
 	
 	return n;
@@ -1142,21 +2165,7 @@ int dtNavMesh::getTilesAt(const int x, const int y, dtMeshTile const** tiles, co
 
 dtTileRef dtNavMesh::getTileRefAt(const int x, const int y, const int layer) const
 {
-	// Find tile based on hash.
-	int h = computeTileHash(x,y,m_tileLutMask);
-	dtMeshTile* tile = m_posLookup[h];
-	while (tile)
-	{
-		if (tile->header &&
-			tile->header->x == x &&
-			tile->header->y == y &&
-			tile->header->layer == layer)
-		{
-			return getTileRef(tile);
-		}
-		tile = tile->next;
-	}
-	return 0;
+	return getTileRef(getTileAt(x, y, layer));
 }
 
 const dtMeshTile* dtNavMesh::getTileByRef(dtTileRef ref) const
@@ -1167,8 +2176,8 @@ const dtMeshTile* dtNavMesh::getTileByRef(dtTileRef ref) const
 	unsigned int tileSalt = decodePolyIdSalt((dtPolyRef)ref);
 	if ((int)tileIndex >= m_maxTiles)
 		return 0;
-	const dtMeshTile* tile = &m_tiles[tileIndex];
-	if (tile->salt != tileSalt)
+	const dtMeshTile* tile = getTileByIndex(tileIndex);
+	if (tile->salt != tileSalt || (tile->flags & DT_TILE_RETIRED))
 		return 0;
 	return tile;
 }
@@ -1180,12 +2189,179 @@ int dtNavMesh::getMaxTiles() const
 
 dtMeshTile* dtNavMesh::getTile(int i)
 {
-	return &m_tiles[i];
+	return getTileByIndex((unsigned int)i);
 }
 
 const dtMeshTile* dtNavMesh::getTile(int i) const
 {
-	return &m_tiles[i];
+	return getTileByIndex((unsigned int)i);
+}
+
+unsigned int dtNavMesh::getTileGeneration(dtPolyRef ref) const
+{
+	const unsigned int it = decodePolyIdTile(ref);
+	if (it >= (unsigned int)m_maxTiles)
+		return 0;
+	return getTileByIndex(it)->generation;
+}
+
+dtNavMeshChangeListener::~dtNavMeshChangeListener()
+{
+	// Defined out of line to fix the weak v-tables warning
+}
+
+void dtNavMesh::notifyChange(int type, dtTileRef tileRef, dtPolyRef polyRef, const dtMeshHeader* header,
+							 unsigned int generation) const
+{
+	if (!m_changeListener)
+		return;
+	dtNavMeshChange change;
+	change.type = type;
+	change.tileRef = tileRef;
+	change.polyRef = polyRef;
+	change.tileX = header->x;
+	change.tileY = header->y;
+	change.tileLayer = header->layer;
+	change.generation = generation;
+	m_changeListener->navMeshChanged(this, change);
+}
+
+void dtNavMesh::getLinkStats(dtNavMeshLinkStats* stats) const
+{
+	memset(stats, 0, sizeof(dtNavMeshLinkStats));
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtMeshTile* tile = getTileByIndex((unsigned int)i);
+		if (!tile->header)
+			continue;
+		stats->linkCount += tile->linkCount;
+		stats->linkCapacity += tile->linkCapacity;
+		stats->builtLinkCapacity += tile->header->maxLinkCount;
+		if (ownsLinks(tile))
+			stats->overflowTileCount++;
+	}
+	stats->overflowCount = m_linkOverflowCount;
+	stats->lostLinkCount = m_lostLinkCount;
+}
+
+/// Adds the sections of the instance data and the links and portals allocated for the tile.
+static void addTileInstanceMemStats(const dtMeshTile* tile, dtNavMeshMemStats* stats)
+{
+	dtTileInstanceLayout layout;
+	calcTileInstanceLayout(tile->header, layout);
+	stats->tileCount++;
+	stats->headers += layout.headerSize;
+	stats->verts += layout.vertsSize;
+	stats->polys += layout.polysSize;
+	stats->links += layout.linksSize;
+	stats->offMeshCons += layout.offMeshConsSize;
+	stats->detail += layout.detailVertsSize + layout.detailGridsSize;
+	stats->portalEdges += layout.portalEdgesSize;
+	stats->wallDistance += layout.wallDistGridsSize;
+	if (tile->dataSize > layout.dataSize)
+		stats->other += (size_t)(tile->dataSize - layout.dataSize);
+}
+
+/// Adds the sections of the tile data and the links and portals allocated for the tile.
+static void addTileMemStats(const dtMeshTile* tile, dtNavMeshMemStats* stats)
+{
+	const dtMeshHeader* header = tile->header;
+	const size_t linksSize = dtAlign4(sizeof(dtLink)*header->maxLinkCount);
+	if (tile->flags & DT_TILE_INSTANCE)
+	{
+		addTileInstanceMemStats(tile, stats);
+	}
+	else
+	{
+		const size_t headerSize = dtAlign4(sizeof(dtMeshHeader));
+		const size_t vertsSize = dtAlign4(sizeof(float)*3*(header->vertCount-header->quantVertCount)) +
+			dtAlign4(sizeof(unsigned short)*3*header->quantVertCount);
+		const size_t polysSize = dtAlign4(sizeof(dtPoly)*header->polyCount);
+		const size_t detailSize = dtAlign4(sizeof(dtPolyDetail)*header->detailMeshCount) +
+			dtAlign4(sizeof(float)*3*(header->detailVertCount-header->quantDetailVertCount)) +
+			dtAlign4(sizeof(unsigned char)*4*header->detailTriCount) +
+			dtAlign4(sizeof(unsigned short)*3*header->quantDetailVertCount) +
+			dtAlign4(sizeof(dtDetailGrid)*header->detailGridCount) +
+			dtAlign4(sizeof(unsigned int)*header->detailGridCellCount) +
+			dtAlign4(sizeof(unsigned char)*header->detailGridTriCount);
+		const size_t bvTreeSize = dtAlign4(sizeof(dtBVNode)*header->bvNodeCount) +
+			dtAlign4(sizeof(dtBVWideNode)*header->bvWideNodeCount);
+		const size_t offMeshConsSize = dtAlign4(sizeof(dtOffMeshConnection)*header->offMeshConCount);
+		const size_t portalEdgesSize = dtAlign4(sizeof(dtPortalEdge)*header->portalEdgeCount);
+		const size_t edgeClearanceSize = dtAlign4(sizeof(unsigned char)*header->edgeClearanceCount);
+		const size_t wallDistanceSize = dtAlign4(sizeof(dtWallDistGrid)*header->wallDistGridCount) +
+			dtAlign4(sizeof(unsigned char)*header->wallDistSampleCount);
+		const size_t sectionsSize = headerSize + vertsSize + polysSize + linksSize + detailSize + bvTreeSize +
+			offMeshConsSize + portalEdgesSize + edgeClearanceSize + wallDistanceSize;
+
+		stats->tileCount++;
+		stats->headers += headerSize;
+		stats->verts += vertsSize;
+		stats->polys += polysSize;
+		stats->links += linksSize;
+		stats->detail += detailSize;
+		stats->bvTree += bvTreeSize;
+		stats->offMeshCons += offMeshConsSize;
+		stats->portalEdges += portalEdgesSize;
+		stats->edgeClearance += edgeClearanceSize;
+		stats->wallDistance += wallDistanceSize;
+		if ((size_t)tile->dataSize > sectionsSize)
+			stats->other += (size_t)tile->dataSize - sectionsSize;
+	}
+
+	// Once the links outgrow the tile data, the links in the tile data are no longer used.
+	const size_t unusedLinks = sizeof(dtLink)*(tile->linkCapacity - tile->linkCount);
+	if (ownsLinks(tile))
+	{
+		stats->links += sizeof(dtLink)*tile->linkCapacity;
+		stats->unusedLinks += linksSize + unusedLinks;
+	}
+	else
+	{
+		stats->unusedLinks += unusedLinks;
+	}
+	if (tile->linkPortals)
+		stats->linkPortals += sizeof(float)*6*dtMax(tile->linkCapacity, 1);
+}
+
+static void sumMemStats(dtNavMeshMemStats* stats)
+{
+	stats->total = stats->tiles + stats->headers + stats->polys + stats->verts + stats->links +
+		stats->linkPortals + stats->detail + stats->bvTree + stats->offMeshCons + stats->portalEdges +
+		stats->edgeClearance + stats->wallDistance + stats->other;
+}
+
+void dtNavMesh::getMemStats(dtNavMeshMemStats* stats) const
+{
+	memset(stats, 0, sizeof(dtNavMeshMemStats));
+	stats->tiles = sizeof(dtNavMesh) + sizeof(dtRetiredItem)*m_retiredCapacity +
+		sizeof(dtMeshTile*)*m_tilePageCapacity + sizeof(dtTileRef)*m_pendingTileCapacity;
+	if (m_flags & DT_NAVMESH_SPARSE_TILES)
+		stats->tiles += sizeof(dtMeshTile)*m_tilePageCount*((size_t)1 << m_tilePageBits) +
+			sizeof(dtTileSlot)*m_tileLutSize;
+	else
+		stats->tiles += sizeof(dtMeshTile)*m_maxTiles + sizeof(dtMeshTile*)*m_tileLutSize;
+	if (m_tileGrid)
+	{
+		const size_t cellCount = (size_t)m_tileGridWidth*m_tileGridHeight;
+		stats->tiles += sizeof(dtMeshTile*)*cellCount*m_tileGridLayers + sizeof(unsigned short)*cellCount;
+	}
+
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtMeshTile* tile = getTileByIndex((unsigned int)i);
+		if (tile->header)
+			addTileMemStats(tile, stats);
+	}
+	sumMemStats(stats);
+}
+
+void dtNavMesh::getTileMemStats(const dtMeshTile* tile, dtNavMeshMemStats* stats) const
+{
+	memset(stats, 0, sizeof(dtNavMeshMemStats));
+	if (tile && tile->header)
+		addTileMemStats(tile, stats);
+	sumMemStats(stats);
 }
 
 void dtNavMesh::calcTileLoc(const float* pos, int* tx, int* ty) const
@@ -1200,10 +2376,11 @@ dtStatus dtNavMesh::getTileAndPolyByRef(const dtPolyRef ref, const dtMeshTile**
 	unsigned int salt, it, ip;
 	decodePolyId(ref, salt, it, ip);
 	if (it >= (unsigned int)m_maxTiles) return DT_FAILURE | DT_INVALID_PARAM;
-	if (m_tiles[it].salt != salt || m_tiles[it].header == 0) return DT_FAILURE | DT_INVALID_PARAM;
-	if (ip >= (unsigned int)m_tiles[it].header->polyCount) return DT_FAILURE | DT_INVALID_PARAM;
-	*tile = &m_tiles[it];
-	*poly = &m_tiles[it].polys[ip];
+	const dtMeshTile* t = getTileByIndex(it);
+	if (t->salt != salt || t->header == 0 || (t->flags & DT_TILE_RETIRED)) return DT_FAILURE | DT_INVALID_PARAM;
+	if (ip >= (unsigned int)t->header->polyCount) return DT_FAILURE | DT_INVALID_PARAM;
+	*tile = t;
+	*poly = &t->polys[ip];
 	return DT_SUCCESS;
 }
 
@@ -1216,8 +2393,9 @@ void dtNavMesh::getTileAndPolyByRefUnsafe(const dtPolyRef ref, const dtMeshTile*
 {
 	unsigned int salt, it, ip;
 	decodePolyId(ref, salt, it, ip);
-	*tile = &m_tiles[it];
-	*poly = &m_tiles[it].polys[ip];
+	const dtMeshTile* t = getTileByIndex(it);
+	*tile = t;
+	*poly = &t->polys[ip];
 }
 
 bool dtNavMesh::isValidPolyRef(dtPolyRef ref) const
@@ -1226,8 +2404,9 @@ bool dtNavMesh::isValidPolyRef(dtPolyRef ref) const
 	unsigned int salt, it, ip;
 	decodePolyId(ref, salt, it, ip);
 	if (it >= (unsigned int)m_maxTiles) return false;
-	if (m_tiles[it].salt != salt || m_tiles[it].header == 0) return false;
-	if (ip >= (unsigned int)m_tiles[it].header->polyCount) return false;
+	const dtMeshTile* tile = getTileByIndex(it);
+	if (tile->salt != salt || tile->header == 0 || (tile->flags & DT_TILE_RETIRED)) return false;
+	if (ip >= (unsigned int)tile->header->polyCount) return false;
 	return true;
 }
 
@@ -1236,7 +2415,11 @@ bool dtNavMesh::isValidPolyRef(dtPolyRef ref) const
 /// This function returns the data for the tile so that, if desired,
 /// it can be added back to the navigation mesh at a later point.
 ///
-/// @see #addTile
+/// If deferred tile release is enabled, the tile is retired instead of released.
+/// Any data returned must then be kept alive until the tile has been released
+/// using #releaseRetiredTiles.
+///
+/// @see #addTile, #setDeferredTileRelease
 dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSize)
 {
 	if (!ref)
@@ -1245,26 +2428,40 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 	unsigned int tileSalt = decodePolyIdSalt((dtPolyRef)ref);
 	if ((int)tileIndex >= m_maxTiles)
 		return DT_FAILURE | DT_INVALID_PARAM;
-	dtMeshTile* tile = &m_tiles[tileIndex];
-	if (tile->salt != tileSalt)
+	dtMeshTile* tile = getTileByIndex(tileIndex);
+	if (tile->salt != tileSalt || !tile->header || (tile->flags & DT_TILE_RETIRED))
 		return DT_FAILURE | DT_INVALID_PARAM;
+	// The header is released with the tile.
+	const dtMeshHeader header = *tile->header;
+
+	// Links retired from this tile are released together with it. The replaced link
+	// arrays are not part of the tile and are freed once their epoch has passed.
+	int n = 0;
+	for (int i = 0; i < m_retiredCount; ++i)
+	{
+		if (m_retired[i].tile != (int)tileIndex || m_retired[i].memory)
+			m_retired[n++] = m_retired[i];
+	}
+	m_retiredCount = n;
+
+	if (m_deferRelease && !retire(tile, DT_NULL_LINK, 0))
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
 	
 	// Remove tile from hash lookup.
-	int h = computeTileHash(tile->header->x,tile->header->y,m_tileLutMask);
-	dtMeshTile* prev = 0;
-	dtMeshTile* cur = m_posLookup[h];
-	while (cur)
+	removeTileLookup(tile);
+
+	// Remove tile from the pending tiles.
+	if (tile->flags & DT_TILE_PENDING_LINKS)
 	{
-		if (cur == tile)
+		for (int i = 0; i < m_pendingTileCount; ++i)
 		{
-			if (prev)
-				prev->next = cur->next;
-			else
-				m_posLookup[h] = cur->next;
+			if (m_pendingTiles[i] != ref)
+				continue;
+			m_pendingTileCount--;
+			memmove(m_pendingTiles + i, m_pendingTiles + i + 1, sizeof(dtTileRef)*(m_pendingTileCount - i));
 			break;
 		}
-		prev = cur;
-		cur = cur->next;
+		tile->flags &= ~DT_TILE_PENDING_LINKS;
 	}
 	
 	// Remove connections to neighbour tiles.
@@ -1288,13 +2485,9 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 			unconnectLinks(neis[j], tile);
 	}
 		
-	// Reset tile.
+	// Return the data if the caller owns it.
 	if (tile->flags & DT_TILE_FREE_DATA)
 	{
-		// Owns data
-		dtFree(tile->data);
-		tile->data = 0;
-		tile->dataSize = 0;
 		if (data) *data = 0;
 		if (dataSize) *dataSize = 0;
 	}
@@ -1304,18 +2497,6 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 		if (dataSize) *dataSize = tile->dataSize;
 	}
 
-	tile->header = 0;
-	tile->flags = 0;
-	tile->linksFreeList = 0;
-	tile->polys = 0;
-	tile->verts = 0;
-	tile->links = 0;
-	tile->detailMeshes = 0;
-	tile->detailVerts = 0;
-	tile->detailTris = 0;
-	tile->bvTree = 0;
-	tile->offMeshCons = 0;
-
 	// Update salt, salt should never be zero.
 #ifdef DT_POLYREF64
 	tile->salt = (tile->salt+1) & ((1<<DT_SALT_BITS)-1);
@@ -1325,9 +2506,15 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 	if (tile->salt == 0)
 		tile->salt++;
 
-	// Add to free list.
-	tile->next = m_nextFree;
-	m_nextFree = tile;
+	// Retired tiles keep their memory until released.
+	if (m_deferRelease)
+		tile->flags |= DT_TILE_RETIRED;
+	else
+		releaseTile(tile);
+
+	dtAtomicStore(&m_epoch, m_epoch+1);
+	tile->generation = ++m_generation;
+	notifyChange(DT_CHANGE_TILE_REMOVED, ref, 0, &header, tile->generation);
 
 	return DT_SUCCESS;
 }
@@ -1335,7 +2522,7 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 dtTileRef dtNavMesh::getTileRef(const dtMeshTile* tile) const
 {
 	if (!tile) return 0;
-	const unsigned int it = (unsigned int)(tile - m_tiles);
+	const unsigned int it = tile->index;
 	return (dtTileRef)encodePolyId(tile->salt, it, 0);
 }
 
@@ -1356,7 +2543,7 @@ dtTileRef dtNavMesh::getTileRef(const dtMeshTile* tile) const
 dtPolyRef dtNavMesh::getPolyRefBase(const dtMeshTile* tile) const
 {
 	if (!tile) return 0;
-	const unsigned int it = (unsigned int)(tile - m_tiles);
+	const unsigned int it = tile->index;
 	return encodePolyId(tile->salt, it, 0);
 }
 
@@ -1445,6 +2632,8 @@ dtStatus dtNavMesh::restoreTileState(dtMeshTile* tile, const unsigned char* data
 		p->flags = s->flags;
 		p->setArea(s->area);
 	}
+	tile->generation = ++m_generation;
+	notifyChange(DT_CHANGE_TILE_STATE, tileState->ref, 0, tile->header, tile->generation);
 	
 	return DT_SUCCESS;
 }
@@ -1466,8 +2655,8 @@ dtStatus dtNavMesh::getOffMeshConnectionPolyEndPoints(dtPolyRef prevRef, dtPolyR
 	// Get current polygon
 	decodePolyId(polyRef, salt, it, ip);
 	if (it >= (unsigned int)m_maxTiles) return DT_FAILURE | DT_INVALID_PARAM;
-	if (m_tiles[it].salt != salt || m_tiles[it].header == 0) return DT_FAILURE | DT_INVALID_PARAM;
-	const dtMeshTile* tile = &m_tiles[it];
+	const dtMeshTile* tile = getTileByIndex(it);
+	if (tile->salt != salt || tile->header == 0 || (tile->flags & DT_TILE_RETIRED)) return DT_FAILURE | DT_INVALID_PARAM;
 	if (ip >= (unsigned int)tile->header->polyCount) return DT_FAILURE | DT_INVALID_PARAM;
 	const dtPoly* poly = &tile->polys[ip];
 
@@ -1492,8 +2681,8 @@ dtStatus dtNavMesh::getOffMeshConnectionPolyEndPoints(dtPolyRef prevRef, dtPolyR
 		}
 	}
 	
-	dtVcopy(startPos, &tile->verts[poly->verts[idx0]*3]);
-	dtVcopy(endPos, &tile->verts[poly->verts[idx1]*3]);
+	dtGetTileVertex(tile, poly->verts[idx0], startPos);
+	dtGetTileVertex(tile, poly->verts[idx1], endPos);
 
 	return DT_SUCCESS;
 }
@@ -1509,8 +2698,8 @@ const dtOffMeshConnection* dtNavMesh::getOffMeshConnectionByRef(dtPolyRef ref) c
 	// Get current polygon
 	decodePolyId(ref, salt, it, ip);
 	if (it >= (unsigned int)m_maxTiles) return 0;
-	if (m_tiles[it].salt != salt || m_tiles[it].header == 0) return 0;
-	const dtMeshTile* tile = &m_tiles[it];
+	const dtMeshTile* tile = getTileByIndex(it);
+	if (tile->salt != salt || tile->header == 0) return 0;
 	if (ip >= (unsigned int)tile->header->polyCount) return 0;
 	const dtPoly* poly = &tile->polys[ip];
 	
@@ -1530,13 +2719,18 @@ dtStatus dtNavMesh::setPolyFlags(dtPolyRef ref, unsigned short flags)
 	unsigned int salt, it, ip;
 	decodePolyId(ref, salt, it, ip);
 	if (it >= (unsigned int)m_maxTiles) return DT_FAILURE | DT_INVALID_PARAM;
-	if (m_tiles[it].salt != salt || m_tiles[it].header == 0) return DT_FAILURE | DT_INVALID_PARAM;
-	dtMeshTile* tile = &m_tiles[it];
+	dtMeshTile* tile = getTileByIndex(it);
+	if (tile->salt != salt || tile->header == 0 || (tile->flags & DT_TILE_RETIRED)) return DT_FAILURE | DT_INVALID_PARAM;
 	if (ip >= (unsigned int)tile->header->polyCount) return DT_FAILURE | DT_INVALID_PARAM;
 	dtPoly* poly = &tile->polys[ip];
 	
 	// Change flags.
-	poly->flags = flags;
+	if (poly->flags != flags)
+	{
+		poly->flags = flags;
+		tile->generation = ++m_generation;
+		notifyChange(DT_CHANGE_POLY_FLAGS, getTileRef(tile), ref, tile->header, tile->generation);
+	}
 	
 	return DT_SUCCESS;
 }
@@ -1547,8 +2741,8 @@ dtStatus dtNavMesh::getPolyFlags(dtPolyRef ref, unsigned short* resultFlags) con
 	unsigned int salt, it, ip;
 	decodePolyId(ref, salt, it, ip);
 	if (it >= (unsigned int)m_maxTiles) return DT_FAILURE | DT_INVALID_PARAM;
-	if (m_tiles[it].salt != salt || m_tiles[it].header == 0) return DT_FAILURE | DT_INVALID_PARAM;
-	const dtMeshTile* tile = &m_tiles[it];
+	const dtMeshTile* tile = getTileByIndex(it);
+	if (tile->salt != salt || tile->header == 0 || (tile->flags & DT_TILE_RETIRED)) return DT_FAILURE | DT_INVALID_PARAM;
 	if (ip >= (unsigned int)tile->header->polyCount) return DT_FAILURE | DT_INVALID_PARAM;
 	const dtPoly* poly = &tile->polys[ip];
 
@@ -1563,12 +2757,17 @@ dtStatus dtNavMesh::setPolyArea(dtPolyRef ref, unsigned char area)
 	unsigned int salt, it, ip;
 	decodePolyId(ref, salt, it, ip);
 	if (it >= (unsigned int)m_maxTiles) return DT_FAILURE | DT_INVALID_PARAM;
-	if (m_tiles[it].salt != salt || m_tiles[it].header == 0) return DT_FAILURE | DT_INVALID_PARAM;
-	dtMeshTile* tile = &m_tiles[it];
+	dtMeshTile* tile = getTileByIndex(it);
+	if (tile->salt != salt || tile->header == 0 || (tile->flags & DT_TILE_RETIRED)) return DT_FAILURE | DT_INVALID_PARAM;
 	if (ip >= (unsigned int)tile->header->polyCount) return DT_FAILURE | DT_INVALID_PARAM;
 	dtPoly* poly = &tile->polys[ip];
 	
-	poly->setArea(area);
+	if (poly->getArea() != (area & 0x3f))
+	{
+		poly->setArea(area);
+		tile->generation = ++m_generation;
+		notifyChange(DT_CHANGE_POLY_AREA, getTileRef(tile), ref, tile->header, tile->generation);
+	}
 	
 	return DT_SUCCESS;
 }
@@ -1579,8 +2778,8 @@ dtStatus dtNavMesh::getPolyArea(dtPolyRef ref, unsigned char* resultArea) const
 	unsigned int salt, it, ip;
 	decodePolyId(ref, salt, it, ip);
 	if (it >= (unsigned int)m_maxTiles) return DT_FAILURE | DT_INVALID_PARAM;
-	if (m_tiles[it].salt != salt || m_tiles[it].header == 0) return DT_FAILURE | DT_INVALID_PARAM;
-	const dtMeshTile* tile = &m_tiles[it];
+	const dtMeshTile* tile = getTileByIndex(it);
+	if (tile->salt != salt || tile->header == 0 || (tile->flags & DT_TILE_RETIRED)) return DT_FAILURE | DT_INVALID_PARAM;
 	if (ip >= (unsigned int)tile->header->polyCount) return DT_FAILURE | DT_INVALID_PARAM;
 	const dtPoly* poly = &tile->polys[ip];
 	
@@ -29,6 +29,17 @@
 
 static unsigned short MESH_NULL_IDX = 0xffff;
 
+// Polygons with fewer detail triangles than this are searched linearly.
+static const int DETAIL_GRID_MIN_TRIS = 8;
+static const int DETAIL_GRID_MAX_SIZE = 16;
+
+// The wall distances are sampled every few cells, with at most this many samples along each axis of a polygon.
+static const int WALL_DIST_SPACING = 2;
+static const int WALL_DIST_MAX_SIZE = 32;
+
+// The number of bins the surface area heuristic evaluates the bounding volume splits at.
+static const int BV_SAH_BINS = 16;
+
 
 struct BVItem
 {
@@ -37,39 +48,6 @@ struct BVItem
 	int i;
 };
 
-static int compareItemX(const void* va, const void* vb)
-{
-	const BVItem* a = (const BVItem*)va;
-	const BVItem* b = (const BVItem*)vb;
-	if (a->bmin[0] < b->bmin[0])
-		return -1;
-	if (a->bmin[0] > b->bmin[0])
-		return 1;
-	return 0;
-}
-
-static int compareItemY(const void* va, const void* vb)
-{
-	const BVItem* a = (const BVItem*)va;
-	const BVItem* b = (const BVItem*)vb;
-	if (a->bmin[1] < b->bmin[1])
-		return -1;
-	if (a->bmin[1] > b->bmin[1])
-		return 1;
-	return 0;
-}
-
-static int compareItemZ(const void* va, const void* vb)
-{
-	const BVItem* a = (const BVItem*)va;
-	const BVItem* b = (const BVItem*)vb;
-	if (a->bmin[2] < b->bmin[2])
-		return -1;
-	if (a->bmin[2] > b->bmin[2])
-		return 1;
-	return 0;
-}
-
 static void calcExtends(BVItem* items, const int /*nitems*/, const int imin, const int imax,
 						unsigned short* bmin, unsigned short* bmax)
 {
@@ -110,7 +88,178 @@ inline int longestAxis(unsigned short x, unsigned short y, unsigned short z)
 	return axis;
 }
 
-static void subdivide(BVItem* items, int nitems, int imin, int imax, int& curNode, dtBVNode* nodes)
+// Moves the item with the k-th smallest minimum bound along the axis to index k,
+// with the items before it not larger and the items after it not smaller.
+static void selectItem(BVItem* items, int imin, int imax, const int k, const int axis)
+{
+	while (imax - imin > 1)
+	{
+		// Median of three pivot, and a three-way partition for the many equal bounds of grid-like tiles.
+		const unsigned short a = items[imin].bmin[axis];
+		const unsigned short b = items[imin + (imax-imin)/2].bmin[axis];
+		const unsigned short c = items[imax-1].bmin[axis];
+		const unsigned short pivot = dtMax(dtMin(a, b), dtMin(dtMax(a, b), c));
+		int lt = imin, i = imin, gt = imax;
+		while (i < gt)
+		{
+			const unsigned short v = items[i].bmin[axis];
+			if (v < pivot)
+				dtSwap(items[lt++], items[i++]);
+			else if (v > pivot)
+				dtSwap(items[i], items[--gt]);
+			else
+				i++;
+		}
+		if (k < lt)
+			imax = lt;
+		else if (k >= gt)
+			imin = gt;
+		else
+			return;
+	}
+}
+
+// Splits the items in half along the longest axis of their bounds.
+static int splitMedian(BVItem* items, const int imin, const int imax,
+					   const unsigned short* bmin, const unsigned short* bmax)
+{
+	const int axis = longestAxis(bmax[0] - bmin[0],
+								 bmax[1] - bmin[1],
+								 bmax[2] - bmin[2]);
+	const int isplit = imin + (imax - imin)/2;
+	selectItem(items, imin, imax, isplit, axis);
+	return isplit;
+}
+
+// Half of the surface area of the bounds.
+inline float halfArea(const int* bmin, const int* bmax)
+{
+	const float dx = (float)(bmax[0] - bmin[0]);
+	const float dy = (float)(bmax[1] - bmin[1]);
+	const float dz = (float)(bmax[2] - bmin[2]);
+	return dx*dy + dy*dz + dz*dx;
+}
+
+inline void resetBounds(int* bmin, int* bmax)
+{
+	bmin[0] = bmin[1] = bmin[2] = 0xffff;
+	bmax[0] = bmax[1] = bmax[2] = 0;
+}
+
+inline void addBounds(int* bmin, int* bmax, const unsigned short* imin, const unsigned short* imax)
+{
+	for (int j = 0; j < 3; ++j)
+	{
+		bmin[j] = dtMin(bmin[j], (int)imin[j]);
+		bmax[j] = dtMax(bmax[j], (int)imax[j]);
+	}
+}
+
+// Splits the items at the bin boundary along the longest axis of their centers which
+// minimizes the surface area heuristic, the sum of the areas of the two sides weighted
+// by their item counts.
+static int splitSAH(BVItem* items, const int imin, const int imax,
+					const unsigned short* bmin, const unsigned short* bmax)
+{
+	// The centers are doubled to stay in integers.
+	int cmin[3] = { 0x3ffff, 0x3ffff, 0x3ffff };
+	int cmax[3] = { 0, 0, 0 };
+	for (int i = imin; i < imax; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			const int c = items[i].bmin[j] + items[i].bmax[j];
+			cmin[j] = dtMin(cmin[j], c);
+			cmax[j] = dtMax(cmax[j], c);
+		}
+	}
+	int axis = 0;
+	for (int j = 1; j < 3; ++j)
+	{
+		if (cmax[j] - cmin[j] > cmax[axis] - cmin[axis])
+			axis = j;
+	}
+	const int ext = cmax[axis] - cmin[axis] + 1;
+	if (ext == 1)
+		return splitMedian(items, imin, imax, bmin, bmax);
+
+	int counts[BV_SAH_BINS];
+	int binMin[BV_SAH_BINS][3], binMax[BV_SAH_BINS][3];
+	for (int b = 0; b < BV_SAH_BINS; ++b)
+	{
+		counts[b] = 0;
+		resetBounds(binMin[b], binMax[b]);
+	}
+	for (int i = imin; i < imax; ++i)
+	{
+		const int c = items[i].bmin[axis] + items[i].bmax[axis];
+		const int b = (c - cmin[axis]) * BV_SAH_BINS / ext;
+		counts[b]++;
+		addBounds(binMin[b], binMax[b], items[i].bmin, items[i].bmax);
+	}
+
+	// Sweep from the right for the cost of the right sides, then from the left for the best split.
+	float rightCost[BV_SAH_BINS];
+	int sumMin[3], sumMax[3];
+	int n = 0;
+	resetBounds(sumMin, sumMax);
+	for (int b = BV_SAH_BINS-1; b > 0; --b)
+	{
+		n += counts[b];
+		for (int j = 0; j < 3; ++j)
+		{
+			sumMin[j] = dtMin(sumMin[j], binMin[b][j]);
+			sumMax[j] = dtMax(sumMax[j], binMax[b][j]);
+		}
+		rightCost[b] = n ? halfArea(sumMin, sumMax) * n : 0.0f;
+	}
+	int best = -1;
+	float bestCost = FLT_MAX;
+	n = 0;
+	resetBounds(sumMin, sumMax);
+	for (int b = 0; b < BV_SAH_BINS-1; ++b)
+	{
+		n += counts[b];
+		for (int j = 0; j < 3; ++j)
+		{
+			sumMin[j] = dtMin(sumMin[j], binMin[b][j]);
+			sumMax[j] = dtMax(sumMax[j], binMax[b][j]);
+		}
+		if (n == 0 || n == imax - imin)
+			continue;
+		const float cost = halfArea(sumMin, sumMax) * n + rightCost[b+1];
+		if (cost < bestCost)
+		{
+			bestCost = cost;
+			best = b;
+		}
+	}
+	if (best < 0)
+		return splitMedian(items, imin, imax, bmin, bmax);
+
+	// Move the items of the left bins first.
+	int i = imin, j = imax;
+	while (i < j)
+	{
+		const int c = items[i].bmin[axis] + items[i].bmax[axis];
+		if ((c - cmin[axis]) * BV_SAH_BINS / ext <= best)
+			i++;
+		else
+			dtSwap(items[i], items[--j]);
+	}
+	return i;
+}
+
+// Splits the items into two non-empty ranges and returns the start of the second one.
+static int splitItems(BVItem* items, const int imin, const int imax,
+					  const unsigned short* bmin, const unsigned short* bmax, const int split)
+{
+	if (split == DT_BVTREE_SPLIT_SAH)
+		return splitSAH(items, imin, imax, bmin, bmax);
+	return splitMedian(items, imin, imax, bmin, bmax);
+}
+
+static void subdivide(BVItem* items, int nitems, int imin, int imax, int& curNode, dtBVNode* nodes, const int split)
 {
 	int inum = imax - imin;
 	int icur = curNode;
@@ -135,44 +284,124 @@ static void subdivide(BVItem* items, int nitems, int imin, int imax, int& curNod
 		// Split
 		calcExtends(items, nitems, imin, imax, node.bmin, node.bmax);
 		
-		int	axis = longestAxis(node.bmax[0] - node.bmin[0],
-							   node.bmax[1] - node.bmin[1],
-							   node.bmax[2] - node.bmin[2]);
+		const int isplit = splitItems(items, imin, imax, node.bmin, node.bmax, split);
+		
+		// Left
+		subdivide(items, nitems, imin, isplit, curNode, nodes, split);
+		// Right
+		subdivide(items, nitems, isplit, imax, curNode, nodes, split);
 		
-		if (axis == 0)
+		int iescape = curNode - icur;
+		// Negative index means escape.
+		node.i = -iescape;
+	}
+}
+
+// Splits the items into up to DT_BVWIDE_WIDTH ranges. The splits are the same as
+// the ones subdivide() makes on the levels collapsed into a single wide node, so that
+// both trees store the polygons in the same order. If items is null, only the
+// range bounds of median splits are calculated.
+static int splitWide(BVItem* items, int nitems, const int imin, const int imax, int* bounds, const int split)
+{
+	int nranges = 1;
+	bounds[0] = imin;
+	bounds[1] = imax;
+	for (int width = 1; width < DT_BVWIDE_WIDTH; width *= 2)
+	{
+		int next[DT_BVWIDE_WIDTH+1];
+		int nnext = 0;
+		next[0] = imin;
+		for (int i = 0; i < nranges; ++i)
 		{
-			// Sort along x-axis
-			qsort(items+imin, inum, sizeof(BVItem), compareItemX);
+			const int rmin = bounds[i];
+			const int rmax = bounds[i+1];
+			if (rmax - rmin > 1)
+			{
+				if (items)
+				{
+					unsigned short bmin[3], bmax[3];
+					calcExtends(items, nitems, rmin, rmax, bmin, bmax);
+					next[++nnext] = splitItems(items, rmin, rmax, bmin, bmax, split);
+				}
+				else
+				{
+					next[++nnext] = rmin + (rmax - rmin)/2;
+				}
+			}
+			next[++nnext] = rmax;
 		}
-		else if (axis == 1)
+		memcpy(bounds, next, sizeof(int)*(nnext+1));
+		nranges = nnext;
+	}
+	return nranges;
+}
+
+// Counts the wide nodes. The items are only needed to find the splits other than the median ones.
+static int countWideNodes(BVItem* items, int nitems, const int imin, const int imax, const int split)
+{
+	int bounds[DT_BVWIDE_WIDTH+1];
+	const int nranges = splitWide(items, nitems, imin, imax, bounds, split);
+	int count = 1;
+	for (int i = 0; i < nranges; ++i)
+	{
+		if (bounds[i+1] - bounds[i] > 1)
+			count += countWideNodes(items, nitems, bounds[i], bounds[i+1], split);
+	}
+	return count;
+}
+
+static int subdivideWide(BVItem* items, int nitems, int imin, int imax, int& curNode, dtBVWideNode* nodes,
+						 const int split)
+{
+	const int icur = curNode;
+	dtBVWideNode& node = nodes[curNode++];
+	
+	int bounds[DT_BVWIDE_WIDTH+1];
+	const int nranges = splitWide(items, nitems, imin, imax, bounds, split);
+	
+	for (int i = 0; i < DT_BVWIDE_WIDTH; ++i)
+	{
+		// Unused children get empty bounds.
+		for (int j = 0; j < 3; ++j)
 		{
-			// Sort along y-axis
-			qsort(items+imin, inum, sizeof(BVItem), compareItemY);
+			node.bmin[j][i] = 0xffff;
+			node.bmax[j][i] = 0;
+		}
+		node.child[i] = 0;
+	}
+	node.childCount = nranges;
+	
+	for (int i = 0; i < nranges; ++i)
+	{
+		const int rmin = bounds[i];
+		const int rmax = bounds[i+1];
+		unsigned short bmin[3], bmax[3];
+		calcExtends(items, nitems, rmin, rmax, bmin, bmax);
+		for (int j = 0; j < 3; ++j)
+		{
+			node.bmin[j][i] = bmin[j];
+			node.bmax[j][i] = bmax[j];
+		}
+		if (rmax - rmin == 1)
+		{
+			// Leaf
+			node.child[i] = -items[rmin].i - 1;
 		}
 		else
 		{
-			// Sort along z-axis
-			qsort(items+imin, inum, sizeof(BVItem), compareItemZ);
+			node.child[i] = subdivideWide(items, nitems, rmin, rmax, curNode, nodes, split);
 		}
-		
-		int isplit = imin+inum/2;
-		
-		// Left
-		subdivide(items, nitems, imin, isplit, curNode, nodes);
-		// Right
-		subdivide(items, nitems, isplit, imax, curNode, nodes);
-		
-		int iescape = curNode - icur;
-		// Negative index means escape.
-		node.i = -iescape;
 	}
+	
+	return icur;
 }
 
-static int createBVTree(dtNavMeshCreateParams* params, dtBVNode* nodes, int /*nnodes*/)
+static BVItem* createBVItems(dtNavMeshCreateParams* params)
 {
-	// Build tree
 	float quantFactor = 1 / params->cs;
 	BVItem* items = (BVItem*)dtAlloc(sizeof(BVItem)*params->polyCount, DT_ALLOC_TEMP);
+	if (!items)
+		return 0;
 	for (int i = 0; i < params->polyCount; i++)
 	{
 		BVItem& it = items[i];
@@ -232,14 +461,53 @@ static int createBVTree(dtNavMeshCreateParams* params, dtBVNode* nodes, int /*nn
 		}
 	}
 	
+	return items;
+}
+
+static int createBVTree(dtNavMeshCreateParams* params, dtBVNode* nodes, int /*nnodes*/)
+{
+	// Build tree
+	BVItem* items = createBVItems(params);
+	if (!items)
+		return 0;
+	
+	int curNode = 0;
+	subdivide(items, params->polyCount, 0, params->polyCount, curNode, nodes, params->bvTreeSplit);
+	
+	dtFree(items);
+	
+	return curNode;
+}
+
+static int createBVWideTree(dtNavMeshCreateParams* params, dtBVWideNode* nodes, int /*nnodes*/)
+{
+	// Build tree
+	BVItem* items = createBVItems(params);
+	if (!items)
+		return 0;
+	
 	int curNode = 0;
-	subdivide(items, params->polyCount, 0, params->polyCount, curNode, nodes);
+	subdivideWide(items, params->polyCount, 0, params->polyCount, curNode, nodes, params->bvTreeSplit);
 	
 	dtFree(items);
 	
 	return curNode;
 }
 
+// Returns the number of nodes of the wide tree, or -1 if out of memory. The median
+// splits only depend on the item counts, the other ones need the items.
+static int calcWideNodeCount(dtNavMeshCreateParams* params)
+{
+	if (params->bvTreeSplit == DT_BVTREE_SPLIT_MEDIAN)
+		return countWideNodes(0, 0, 0, params->polyCount, DT_BVTREE_SPLIT_MEDIAN);
+	BVItem* items = createBVItems(params);
+	if (!items)
+		return -1;
+	const int count = countWideNodes(items, params->polyCount, 0, params->polyCount, params->bvTreeSplit);
+	dtFree(items);
+	return count;
+}
+
 static unsigned char classifyOffMeshPoint(const float* pt, const float* bmin, const float* bmax)
 {
 	static const unsigned char XP = 1<<0;
@@ -268,6 +536,340 @@ static unsigned char classifyOffMeshPoint(const float* pt, const float* bmin, co
 	return 0xff;	
 }
 
+static int comparePortalEdge(const void* va, const void* vb)
+{
+	const dtPortalEdge* a = (const dtPortalEdge*)va;
+	const dtPortalEdge* b = (const dtPortalEdge*)vb;
+	if (a->side != b->side)
+		return a->side < b->side ? -1 : 1;
+	if (a->bmin < b->bmin)
+		return -1;
+	if (a->bmin > b->bmin)
+		return 1;
+	return 0;
+}
+
+// Collects the polygon edges linking to the neighbour tiles, sorted by side and position along the side.
+static void buildPortalEdges(const dtNavMeshCreateParams* params, dtMeshHeader* header,
+							 const dtPoly* polys, dtPortalEdge* edges, const int nedges)
+{
+	int n = 0;
+	for (int i = 0; i < params->polyCount; ++i)
+	{
+		const dtPoly* p = &polys[i];
+		for (int j = 0; j < (int)p->vertCount; ++j)
+		{
+			if ((p->neis[j] & DT_EXT_LINK) == 0)
+				continue;
+			// The vertices are dequantized the same way as dtGetTileVertex does.
+			const unsigned short* va = &params->verts[p->verts[j]*3];
+			const unsigned short* vb = &params->verts[p->verts[(j+1) % p->vertCount]*3];
+			const unsigned char side = (unsigned char)(p->neis[j] & 0xff);
+			const int axis = (side == 0 || side == 4) ? 2 : 0;
+			const float a = header->bmin[axis] + va[axis] * params->cs;
+			const float b = header->bmin[axis] + vb[axis] * params->cs;
+			dtPortalEdge& e = edges[n++];
+			e.bmin = dtMin(a, b);
+			e.bmax = dtMax(a, b);
+			e.poly = (unsigned short)i;
+			e.edge = (unsigned char)j;
+			e.side = side;
+		}
+	}
+	dtAssert(n == nedges);
+	qsort(edges, nedges, sizeof(dtPortalEdge), comparePortalEdge);
+
+	// Store the running maximum, so that the edges ending before a position
+	// can be skipped with a binary search.
+	for (int side = 0, i = 0; side < 8; ++side)
+	{
+		header->portalSideBase[side] = i;
+		float bmax = -FLT_MAX;
+		for (; i < nedges && edges[i].side == side; ++i)
+		{
+			bmax = dtMax(bmax, edges[i].bmax);
+			edges[i].bmax = bmax;
+		}
+	}
+}
+
+static int offMeshSideGroup(const unsigned char side)
+{
+	return side == 0xff ? DT_OFFMESH_SIDE_GROUPS-1 : (int)side;
+}
+
+// Resolves the polygons the off-mesh connections land on inside the tile.
+// The tile is connected the same way as when it is added to a navigation mesh, which
+// also snaps the connection vertices onto the mesh. The connections are left
+// unresolved if the temporary navigation mesh cannot be created.
+static void resolveOffMeshConnections(unsigned char* data, const int dataSize)
+{
+	dtNavMesh* nav = dtAllocNavMesh();
+	if (!nav)
+		return;
+	if (dtStatusFailed(nav->init(data, dataSize, 0)))
+	{
+		dtFreeNavMesh(nav);
+		return;
+	}
+
+	const dtMeshTile* tile = ((const dtNavMesh*)nav)->getTile(0);
+	for (int i = 0; i < tile->header->offMeshConCount; ++i)
+	{
+		dtOffMeshConnection* con = &tile->offMeshCons[i];
+		const dtPoly* poly = &tile->polys[con->poly];
+		for (unsigned int j = poly->firstLink; j != DT_NULL_LINK; j = tile->links[j].next)
+		{
+			const dtLink* link = &tile->links[j];
+			const unsigned short landPoly = (unsigned short)nav->decodePolyIdPoly(link->ref);
+			if (link->edge == 0)
+				con->startPoly = landPoly;
+			else if (link->edge == 1)
+				con->endPoly = landPoly;
+		}
+		con->flags |= DT_OFFMESH_CON_RESOLVED;
+	}
+
+	// The links are rebuilt when the tile is added, and the tile does not own the data.
+	dtFreeNavMesh(nav);
+}
+
+static void quantizeDetailVerts(const dtMeshHeader* header, const float* verts, const int nverts, unsigned short* out)
+{
+	for (int i = 0; i < nverts; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			const float scale = header->quantDetailScale[j];
+			const float q = scale > 0.0f ? (verts[i*3+j] - header->quantDetailBmin[j]) / scale : 0.0f;
+			out[i*3+j] = (unsigned short)dtClamp((int)dtMathFloorf(q + 0.5f), 0, 0xffff);
+		}
+	}
+}
+
+// Returns the number of cells along each axis of the detail grid of a polygon,
+// or zero if the polygon has too few detail triangles to need one.
+static int calcDetailGridSize(const dtNavMeshCreateParams* params, const int i)
+{
+	const int ntris = (int)params->detailMeshes[i*4+3];
+	if (ntris < DETAIL_GRID_MIN_TRIS)
+		return 0;
+	return dtClamp((int)dtMathCeilf(dtMathSqrtf((float)ntris)), 1, DETAIL_GRID_MAX_SIZE);
+}
+
+// Bins the detail triangles of a polygon into a grid of size x size cells and
+// returns the number of triangle indices. If grid is null, only counts them.
+static int buildDetailGrid(const dtNavMeshCreateParams* params, const int i, const int size,
+						   dtDetailGrid* grid, unsigned int* cells, unsigned char* tris, const int triBase)
+{
+	const int vb = (int)params->detailMeshes[i*4+0];
+	const int tb = (int)params->detailMeshes[i*4+2];
+	const int ntris = (int)params->detailMeshes[i*4+3];
+
+	float bmin[2] = { FLT_MAX, FLT_MAX };
+	float bmax[2] = { -FLT_MAX, -FLT_MAX };
+	for (int j = 0; j < ntris; ++j)
+	{
+		const unsigned char* t = &params->detailTris[(tb+j)*4];
+		for (int k = 0; k < 3; ++k)
+		{
+			const float* v = &params->detailVerts[(vb+t[k])*3];
+			bmin[0] = dtMin(bmin[0], v[0]);
+			bmin[1] = dtMin(bmin[1], v[2]);
+			bmax[0] = dtMax(bmax[0], v[0]);
+			bmax[1] = dtMax(bmax[1], v[2]);
+		}
+	}
+	float cs[2], ics[2];
+	for (int k = 0; k < 2; ++k)
+	{
+		cs[k] = (bmax[k] - bmin[k]) / size;
+		ics[k] = cs[k] > 0.0f ? 1.0f / cs[k] : 0.0f;
+	}
+
+	// The triangles are padded slightly so that points on cell borders find
+	// them even if the vertices are stored quantized.
+	int counts[DETAIL_GRID_MAX_SIZE*DETAIL_GRID_MAX_SIZE];
+	int ranges[4];
+	memset(counts, 0, sizeof(counts));
+	int total = 0;
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		for (int j = 0; j < ntris; ++j)
+		{
+			const unsigned char* t = &params->detailTris[(tb+j)*4];
+			float tmin[2] = { FLT_MAX, FLT_MAX };
+			float tmax[2] = { -FLT_MAX, -FLT_MAX };
+			for (int k = 0; k < 3; ++k)
+			{
+				const float* v = &params->detailVerts[(vb+t[k])*3];
+				tmin[0] = dtMin(tmin[0], v[0]);
+				tmin[1] = dtMin(tmin[1], v[2]);
+				tmax[0] = dtMax(tmax[0], v[0]);
+				tmax[1] = dtMax(tmax[1], v[2]);
+			}
+			for (int k = 0; k < 2; ++k)
+			{
+				const float pad = cs[k] * 0.01f;
+				ranges[k*2+0] = dtClamp((int)dtMathFloorf((tmin[k] - pad - bmin[k]) * ics[k]), 0, size-1);
+				ranges[k*2+1] = dtClamp((int)dtMathFloorf((tmax[k] + pad - bmin[k]) * ics[k]), 0, size-1);
+			}
+			for (int z = ranges[2]; z <= ranges[3]; ++z)
+			{
+				for (int x = ranges[0]; x <= ranges[1]; ++x)
+				{
+					const int c = x + z*size;
+					if (pass == 0)
+					{
+						counts[c]++;
+						total++;
+					}
+					else
+					{
+						tris[cells[c] - triBase + counts[c]] = (unsigned char)j;
+						counts[c]++;
+					}
+				}
+			}
+		}
+
+		if (pass == 0)
+		{
+			if (!grid)
+				return total;
+
+			grid->bmin[0] = bmin[0];
+			grid->bmin[1] = bmin[1];
+			grid->invCellSize[0] = ics[0];
+			grid->invCellSize[1] = ics[1];
+			grid->size = (unsigned char)size;
+
+			// Turn the counts into cell offsets and fill the cells in triangle order.
+			cells[0] = (unsigned int)triBase;
+			for (int c = 0; c < size*size; ++c)
+			{
+				cells[c+1] = cells[c] + (unsigned int)counts[c];
+				counts[c] = 0;
+			}
+		}
+	}
+
+	return total;
+}
+
+// Computes the bounds of a polygon in cells and the number of wall distance samples
+// along each axis, and returns the number of samples of the polygon.
+static int calcWallDistGridSize(const dtNavMeshCreateParams* params, const int i, int* bmin, int* bmax, int* size)
+{
+	const unsigned short* p = &params->polys[i*params->nvp*2];
+	bmin[0] = bmin[1] = 0xffff;
+	bmax[0] = bmax[1] = 0;
+	for (int j = 0; j < params->nvp; ++j)
+	{
+		if (p[j] == MESH_NULL_IDX) break;
+		const unsigned short* v = &params->verts[p[j]*3];
+		bmin[0] = dtMin(bmin[0], (int)v[0]);
+		bmin[1] = dtMin(bmin[1], (int)v[2]);
+		bmax[0] = dtMax(bmax[0], (int)v[0]);
+		bmax[1] = dtMax(bmax[1], (int)v[2]);
+	}
+	for (int k = 0; k < 2; ++k)
+	{
+		const int ext = dtMax(bmax[k] - bmin[k], 0);
+		size[k] = dtClamp((ext + WALL_DIST_SPACING-1) / WALL_DIST_SPACING + 1, 2, WALL_DIST_MAX_SIZE);
+	}
+	return size[0]*size[1];
+}
+
+// Samples the distance to the nearest border or portal edge of the tile over each polygon.
+// Portals are treated as walls, so the distances are a lower bound near the tile borders.
+static bool buildWallDistGrids(const dtNavMeshCreateParams* params, const dtMeshHeader* header,
+							   dtWallDistGrid* grids, unsigned char* samples)
+{
+	const int nvp = params->nvp;
+	const float cs = params->cs;
+
+	// Gather the wall segments in world units, at y = 0 for the 2D distance.
+	int nsegs = 0;
+	for (int i = 0; i < params->polyCount; ++i)
+	{
+		const unsigned short* p = &params->polys[i*nvp*2];
+		for (int j = 0; j < nvp; ++j)
+		{
+			if (p[j] == MESH_NULL_IDX) break;
+			if (p[nvp+j] & 0x8000)
+				nsegs++;
+		}
+	}
+	float* segs = nsegs ? (float*)dtAlloc(sizeof(float)*6*nsegs, DT_ALLOC_TEMP) : 0;
+	if (nsegs && !segs)
+		return false;
+	int n = 0;
+	for (int i = 0; i < params->polyCount; ++i)
+	{
+		const unsigned short* p = &params->polys[i*nvp*2];
+		for (int j = 0; j < nvp; ++j)
+		{
+			if (p[j] == MESH_NULL_IDX) break;
+			if (!(p[nvp+j] & 0x8000))
+				continue;
+			const int k = (j+1 >= nvp || p[j+1] == MESH_NULL_IDX) ? 0 : j+1;
+			const unsigned short* va = &params->verts[p[j]*3];
+			const unsigned short* vb = &params->verts[p[k]*3];
+			float* s = &segs[n*6];
+			s[0] = params->bmin[0] + va[0]*cs;
+			s[1] = 0.0f;
+			s[2] = params->bmin[2] + va[2]*cs;
+			s[3] = params->bmin[0] + vb[0]*cs;
+			s[4] = 0.0f;
+			s[5] = params->bmin[2] + vb[2]*cs;
+			n++;
+		}
+	}
+
+	const float maxDist = 255.0f * header->wallDistScale;
+	int sampleBase = 0;
+	for (int i = 0; i < params->polyCount; ++i)
+	{
+		int bmin[2], bmax[2], size[2];
+		const int nsamples = calcWallDistGridSize(params, i, bmin, bmax, size);
+
+		// Spread the samples evenly over the polygon bounds.
+		dtWallDistGrid& grid = grids[i];
+		float spacing[2];
+		for (int k = 0; k < 2; ++k)
+		{
+			spacing[k] = (bmax[k] - bmin[k])*cs / (size[k]-1);
+			grid.bmin[k] = params->bmin[k*2] + bmin[k]*cs;
+			grid.invSpacing[k] = spacing[k] > 0.0f ? 1.0f / spacing[k] : 0.0f;
+			grid.size[k] = (unsigned char)size[k];
+		}
+		grid.sampleBase = (unsigned int)sampleBase;
+
+		for (int z = 0; z < size[1]; ++z)
+		{
+			for (int x = 0; x < size[0]; ++x)
+			{
+				const float pt[3] = { grid.bmin[0] + x*spacing[0], 0.0f, grid.bmin[1] + z*spacing[1] };
+				float minDistSqr = maxDist*maxDist;
+				for (int j = 0; j < nsegs; ++j)
+				{
+					float t;
+					const float* s = &segs[j*6];
+					minDistSqr = dtMin(minDistSqr, dtDistancePtSegSqr2D(pt, &s[0], &s[3], t));
+				}
+				// Round down, so that the stored distance never exceeds the sampled one.
+				const int q = (int)(dtMathSqrtf(minDistSqr) / header->wallDistScale);
+				samples[sampleBase + x + z*size[0]] = (unsigned char)dtClamp(q, 0, 0xff);
+			}
+		}
+		sampleBase += nsamples;
+	}
+
+	dtFree(segs);
+	return true;
+}
+
 // TODO: Better error handling.
 
 /// @par
@@ -277,7 +879,10 @@ static unsigned char classifyOffMeshPoint(const float* pt, const float* bmin, co
 /// mesh.
 ///
 /// @see dtNavMesh, dtNavMesh::addTile()
-bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData, int* outDataSize)
+// Builds the tile data into the buffer, or into a new allocation if buffer is null. If both
+// buffer and outData are null, only the size of the tile data is calculated.
+static bool createNavMeshData(dtNavMeshCreateParams* params, unsigned char* buffer, const int bufferSize,
+							  unsigned char** outData, int* outDataSize)
 {
 	if (params->nvp > DT_VERTS_PER_POLYGON)
 		return false;
@@ -347,10 +952,12 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 					offMeshConClass[i*2+0] = 0;
 			}
 
-			// Cound how many links should be allocated for off-mesh connections.
+			// Count how many links should be allocated for off-mesh connections.
+			// A connection starting in the tile links to its start and end polygons, and its
+			// start polygon links back to it. The end polygon links back to bidirectional connections.
 			if (offMeshConClass[i*2+0] == 0xff)
-				offMeshConLinkCount++;
-			if (offMeshConClass[i*2+1] == 0xff)
+				offMeshConLinkCount += 3;
+			if (offMeshConClass[i*2+1] == 0xff && params->offMeshConDir[i])
 				offMeshConLinkCount++;
 
 			if (offMeshConClass[i*2+0] == 0xff)
@@ -358,12 +965,42 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 		}
 	}
 	
+	// Sort the stored connections by the side of their end point, so that connecting
+	// a neighbour tile only needs to visit the connections leading to it.
+	int* offMeshConOrder = 0;
+	int offMeshSideBase[DT_OFFMESH_SIDE_GROUPS];
+	memset(offMeshSideBase, 0, sizeof(offMeshSideBase));
+	if (storedOffMeshConCount > 0)
+	{
+		offMeshConOrder = (int*)dtAlloc(sizeof(int)*storedOffMeshConCount, DT_ALLOC_TEMP);
+		if (!offMeshConOrder)
+		{
+			dtFree(offMeshConClass);
+			return false;
+		}
+		int sideCount[DT_OFFMESH_SIDE_GROUPS];
+		memset(sideCount, 0, sizeof(sideCount));
+		for (int i = 0; i < params->offMeshConCount; ++i)
+		{
+			if (offMeshConClass[i*2+0] == 0xff)
+				sideCount[offMeshSideGroup(offMeshConClass[i*2+1])]++;
+		}
+		for (int i = 1; i < DT_OFFMESH_SIDE_GROUPS; ++i)
+			offMeshSideBase[i] = offMeshSideBase[i-1] + sideCount[i-1];
+		memcpy(sideCount, offMeshSideBase, sizeof(sideCount));
+		for (int i = 0; i < params->offMeshConCount; ++i)
+		{
+			if (offMeshConClass[i*2+0] == 0xff)
+				offMeshConOrder[sideCount[offMeshSideGroup(offMeshConClass[i*2+1])]++] = i;
+		}
+	}
+
 	// Off-mesh connections are stored as polygons, adjust values.
 	const int totPolyCount = params->polyCount + storedOffMeshConCount;
 	const int totVertCount = params->vertCount + storedOffMeshConCount*2;
 	
-	// Find portal edges which are at tile borders.
-	int edgeCount = 0;
+	// Find internal edges and portal edges which are at tile borders.
+	int internalEdgeCount = 0;
 	int portalCount = 0;
 	for (int i = 0; i < params->polyCount; ++i)
 	{
@@ -371,7 +1008,6 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 		for (int j = 0; j < nvp; ++j)
 		{
 			if (p[j] == MESH_NULL_IDX) break;
-			edgeCount++;
 			
 			if (p[nvp+j] & 0x8000)
 			{
@@ -379,10 +1015,17 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 				if (dir != 0xf)
 					portalCount++;
 			}
+			else
+			{
+				internalEdgeCount++;
+			}
 		}
 	}
 
-	const int maxLinkCount = edgeCount + portalCount*2 + offMeshConLinkCount*2;
+	// Internal edges and off-mesh connections need exactly one link each. A portal edge 
+	// links to every polygon it touches in the neighbour tile, which is not known yet. Two
+	// links per portal covers the common case, the tile links grow when adding the tile if needed.
+	const int maxLinkCount = internalEdgeCount + portalCount*2 + offMeshConLinkCount;
 	
 	// Find unique detail vertices.
 	int uniqueDetailVertCount = 0;
@@ -423,24 +1066,85 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 		}
 	}
 	
+	// Count the detail grid cells and triangle indices.
+	const int detailGridCount = (params->buildDetailGrids && params->detailMeshes) ? params->polyCount : 0;
+	int detailGridCellCount = 0;
+	int detailGridTriCount = 0;
+	for (int i = 0; i < detailGridCount; ++i)
+	{
+		const int size = calcDetailGridSize(params, i);
+		if (!size)
+			continue;
+		detailGridCellCount += size*size+1;
+		detailGridTriCount += buildDetailGrid(params, i, size, 0, 0, 0, 0);
+	}
+
+	// Count the wall distance samples of the ground polygons.
+	const int wallDistGridCount = params->buildWallDistances ? params->polyCount : 0;
+	int wallDistSampleCount = 0;
+	for (int i = 0; i < wallDistGridCount; ++i)
+	{
+		int bmin[2], bmax[2], size[2];
+		wallDistSampleCount += calcWallDistGridSize(params, i, bmin, bmax, size);
+	}
+	
 	// Calculate data size
+	const int quantVertCount = params->quantizeVerts ? params->vertCount : 0;
+	const int quantDetailVertCount = (params->quantizeDetailVerts && params->detailMeshes) ? uniqueDetailVertCount : 0;
 	const int headerSize = dtAlign4(sizeof(dtMeshHeader));
-	const int vertsSize = dtAlign4(sizeof(float)*3*totVertCount);
+	const int vertsSize = dtAlign4(sizeof(float)*3*(totVertCount-quantVertCount));
 	const int polysSize = dtAlign4(sizeof(dtPoly)*totPolyCount);
 	const int linksSize = dtAlign4(sizeof(dtLink)*maxLinkCount);
 	const int detailMeshesSize = dtAlign4(sizeof(dtPolyDetail)*params->polyCount);
-	const int detailVertsSize = dtAlign4(sizeof(float)*3*uniqueDetailVertCount);
+	const int detailVertsSize = dtAlign4(sizeof(float)*3*(uniqueDetailVertCount-quantDetailVertCount));
 	const int detailTrisSize = dtAlign4(sizeof(unsigned char)*4*detailTriCount);
-	const int bvTreeSize = params->buildBvTree ? dtAlign4(sizeof(dtBVNode)*params->polyCount*2) : 0;
+	// A binary tree with one polygon per leaf has polyCount*2-1 nodes.
+	const int bvTreeSize = params->buildBvTree ? dtAlign4(sizeof(dtBVNode)*(params->polyCount*2-1)) : 0;
 	const int offMeshConsSize = dtAlign4(sizeof(dtOffMeshConnection)*storedOffMeshConCount);
+	const int bvWideNodeCount = (params->buildBvTree && params->buildWideBvTree) ? calcWideNodeCount(params) : 0;
+	if (bvWideNodeCount < 0)
+	{
+		dtFree(offMeshConOrder);
+		dtFree(offMeshConClass);
+		return false;
+	}
+	const int bvWideTreeSize = dtAlign4(sizeof(dtBVWideNode)*bvWideNodeCount);
+	const int quantVertsSize = dtAlign4(sizeof(unsigned short)*3*quantVertCount);
+	const int quantDetailVertsSize = dtAlign4(sizeof(unsigned short)*3*quantDetailVertCount);
+	const int detailGridsSize = dtAlign4(sizeof(dtDetailGrid)*detailGridCount);
+	const int detailGridCellsSize = dtAlign4(sizeof(unsigned int)*detailGridCellCount);
+	const int detailGridTrisSize = dtAlign4(sizeof(unsigned char)*detailGridTriCount);
+	const int portalEdgesSize = dtAlign4(sizeof(dtPortalEdge)*portalCount);
+	const int edgeClearanceCount = params->polyEdgeClearance ? totPolyCount*DT_VERTS_PER_POLYGON : 0;
+	const int edgeClearanceSize = dtAlign4(sizeof(unsigned char)*edgeClearanceCount);
+	const int wallDistGridsSize = dtAlign4(sizeof(dtWallDistGrid)*wallDistGridCount);
+	const int wallDistSamplesSize = dtAlign4(sizeof(unsigned char)*wallDistSampleCount);
 	
 	const int dataSize = headerSize + vertsSize + polysSize + linksSize +
 						 detailMeshesSize + detailVertsSize + detailTrisSize +
-						 bvTreeSize + offMeshConsSize;
+						 bvTreeSize + offMeshConsSize + bvWideTreeSize + quantVertsSize +
+						 quantDetailVertsSize + detailGridsSize + detailGridCellsSize +
+						 detailGridTrisSize + portalEdgesSize + edgeClearanceSize +
+						 wallDistGridsSize + wallDistSamplesSize;
+
+	if (!buffer && !outData)
+	{
+		dtFree(offMeshConOrder);
+		dtFree(offMeshConClass);
+		*outDataSize = dataSize;
+		return true;
+	}
+	if (buffer && bufferSize < dataSize)
+	{
+		dtFree(offMeshConOrder);
+		dtFree(offMeshConClass);
+		return false;
+	}
 						 
-	unsigned char* data = (unsigned char*)dtAlloc(sizeof(unsigned char)*dataSize, DT_ALLOC_PERM);
+	unsigned char* data = buffer ? buffer : (unsigned char*)dtAlloc(sizeof(unsigned char)*dataSize, DT_ALLOC_PERM);
 	if (!data)
 	{
+		dtFree(offMeshConOrder);
 		dtFree(offMeshConClass);
 		return false;
 	}
@@ -457,6 +1161,16 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 	unsigned char* navDTris = dtGetThenAdvanceBufferPointer<unsigned char>(d, detailTrisSize);
 	dtBVNode* navBvtree = dtGetThenAdvanceBufferPointer<dtBVNode>(d, bvTreeSize);
 	dtOffMeshConnection* offMeshCons = dtGetThenAdvanceBufferPointer<dtOffMeshConnection>(d, offMeshConsSize);
+	dtBVWideNode* navBvWideTree = dtGetThenAdvanceBufferPointer<dtBVWideNode>(d, bvWideTreeSize);
+	unsigned short* navQuantVerts = dtGetThenAdvanceBufferPointer<unsigned short>(d, quantVertsSize);
+	unsigned short* navQuantDVerts = dtGetThenAdvanceBufferPointer<unsigned short>(d, quantDetailVertsSize);
+	dtDetailGrid* navDGrids = dtGetThenAdvanceBufferPointer<dtDetailGrid>(d, detailGridsSize);
+	unsigned int* navDGridCells = dtGetThenAdvanceBufferPointer<unsigned int>(d, detailGridCellsSize);
+	unsigned char* navDGridTris = dtGetThenAdvanceBufferPointer<unsigned char>(d, detailGridTrisSize);
+	dtPortalEdge* navPortalEdges = dtGetThenAdvanceBufferPointer<dtPortalEdge>(d, portalEdgesSize);
+	unsigned char* navEdgeClearance = dtGetThenAdvanceBufferPointer<unsigned char>(d, edgeClearanceSize);
+	dtWallDistGrid* navWallDistGrids = dtGetThenAdvanceBufferPointer<dtWallDistGrid>(d, wallDistGridsSize);
+	unsigned char* navWallDistSamples = dtGetThenAdvanceBufferPointer<unsigned char>(d, wallDistSamplesSize);
 	
 	
 	// Store header
@@ -480,35 +1194,68 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 	header->walkableRadius = params->walkableRadius;
 	header->walkableClimb = params->walkableClimb;
 	header->offMeshConCount = storedOffMeshConCount;
-	header->bvNodeCount = params->buildBvTree ? params->polyCount*2 : 0;
+	header->bvNodeCount = params->buildBvTree ? params->polyCount*2-1 : 0;
+	header->bvWideNodeCount = bvWideNodeCount;
+	header->quantVertCount = quantVertCount;
+	header->quantCellSize = params->cs;
+	header->quantCellHeight = params->ch;
+	header->quantDetailVertCount = quantDetailVertCount;
+	header->detailGridCount = detailGridCount;
+	header->detailGridCellCount = detailGridCellCount;
+	header->detailGridTriCount = detailGridTriCount;
+	memcpy(header->offMeshSideBase, offMeshSideBase, sizeof(offMeshSideBase));
+	header->portalEdgeCount = portalCount;
+	header->edgeClearanceCount = edgeClearanceCount;
+	// The distance field counts two steps per cell.
+	header->edgeClearanceScale = params->cs * 0.5f;
+	header->wallDistGridCount = wallDistGridCount;
+	header->wallDistSampleCount = wallDistSampleCount;
+	header->wallDistScale = params->cs * 0.25f;
+	if (quantDetailVertCount)
+	{
+		// Quantize the detail vertices within the bounds of all the detail vertices.
+		float dmin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float dmax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (int i = 0; i < params->detailVertsCount; ++i)
+		{
+			dtVmin(dmin, &params->detailVerts[i*3]);
+			dtVmax(dmax, &params->detailVerts[i*3]);
+		}
+		dtVcopy(header->quantDetailBmin, dmin);
+		for (int j = 0; j < 3; ++j)
+			header->quantDetailScale[j] = (dmax[j] - dmin[j]) / 65535.0f;
+	}
 	
 	const int offMeshVertsBase = params->vertCount;
 	const int offMeshPolyBase = params->polyCount;
 	
 	// Store vertices
 	// Mesh vertices
-	for (int i = 0; i < params->vertCount; ++i)
+	if (quantVertCount)
 	{
-		const unsigned short* iv = &params->verts[i*3];
-		float* v = &navVerts[i*3];
-		v[0] = params->bmin[0] + iv[0] * params->cs;
-		v[1] = params->bmin[1] + iv[1] * params->ch;
-		v[2] = params->bmin[2] + iv[2] * params->cs;
+		memcpy(navQuantVerts, params->verts, sizeof(unsigned short)*3*quantVertCount);
 	}
-	// Off-mesh link vertices.
-	int n = 0;
-	for (int i = 0; i < params->offMeshConCount; ++i)
+	else
 	{
-		// Only store connections which start from this tile.
-		if (offMeshConClass[i*2+0] == 0xff)
+		for (int i = 0; i < params->vertCount; ++i)
 		{
-			const float* linkv = &params->offMeshConVerts[i*2*3];
-			float* v = &navVerts[(offMeshVertsBase + n*2)*3];
-			dtVcopy(&v[0], &linkv[0]);
-			dtVcopy(&v[3], &linkv[3]);
-			n++;
+			const unsigned short* iv = &params->verts[i*3];
+			float* v = &navVerts[i*3];
+			v[0] = params->bmin[0] + iv[0] * params->cs;
+			v[1] = params->bmin[1] + iv[1] * params->ch;
+			v[2] = params->bmin[2] + iv[2] * params->cs;
 		}
 	}
+	// Off-mesh link vertices, never quantized.
+	// Only connections which start from this tile are stored.
+	for (int n = 0; n < storedOffMeshConCount; ++n)
+	{
+		const int i = offMeshConOrder[n];
+		const float* linkv = &params->offMeshConVerts[i*2*3];
+		float* v = &navVerts[(offMeshVertsBase - quantVertCount + n*2)*3];
+		dtVcopy(&v[0], &linkv[0]);
+		dtVcopy(&v[3], &linkv[3]);
+	}
 	
 	// Store polygons
 	// Mesh polys
@@ -549,24 +1296,45 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 		}
 		src += nvp*2;
 	}
-	// Off-mesh connection vertices.
-	n = 0;
-	for (int i = 0; i < params->offMeshConCount; ++i)
-	{
-		// Only store connections which start from this tile.
-		if (offMeshConClass[i*2+0] == 0xff)
-		{
-			dtPoly* p = &navPolys[offMeshPolyBase+n];
-			p->vertCount = 2;
-			p->verts[0] = (unsigned short)(offMeshVertsBase + n*2+0);
-			p->verts[1] = (unsigned short)(offMeshVertsBase + n*2+1);
-			p->flags = params->offMeshConFlags[i];
-			p->setArea(params->offMeshConAreas[i]);
-			p->setType(DT_POLYTYPE_OFFMESH_CONNECTION);
-			n++;
+	// Portal edges, sorted for stitching the neighbour tiles.
+	buildPortalEdges(params, header, navPolys, navPortalEdges, portalCount);
+
+	// Edge clearances, clamped below the unlimited value which is used for the off-mesh connections.
+	if (edgeClearanceCount)
+	{
+		memset(navEdgeClearance, 0xff, edgeClearanceCount);
+		for (int i = 0; i < params->polyCount; ++i)
+		{
+			const unsigned short* src = &params->polyEdgeClearance[i*nvp];
+			unsigned char* dst = &navEdgeClearance[i*DT_VERTS_PER_POLYGON];
+			for (int j = 0; j < (int)navPolys[i].vertCount; ++j)
+				dst[j] = (unsigned char)dtMin((int)src[j], 0xfe);
 		}
 	}
 
+	// Wall distances.
+	if (wallDistGridCount && !buildWallDistGrids(params, header, navWallDistGrids, navWallDistSamples))
+	{
+		if (data != buffer)
+			dtFree(data);
+		dtFree(offMeshConOrder);
+		dtFree(offMeshConClass);
+		return false;
+	}
+
+	// Off-mesh connection vertices.
+	for (int n = 0; n < storedOffMeshConCount; ++n)
+	{
+		const int i = offMeshConOrder[n];
+		dtPoly* p = &navPolys[offMeshPolyBase+n];
+		p->vertCount = 2;
+		p->verts[0] = (unsigned short)(offMeshVertsBase + n*2+0);
+		p->verts[1] = (unsigned short)(offMeshVertsBase + n*2+1);
+		p->flags = params->offMeshConFlags[i];
+		p->setArea(params->offMeshConAreas[i]);
+		p->setType(DT_POLYTYPE_OFFMESH_CONNECTION);
+	}
+
 	// Store detail meshes and vertices.
 	// The nav polygon vertices are stored as the first vertices on each mesh.
 	// We compress the mesh data by skipping them and using the navmesh coordinates.
@@ -586,12 +1354,29 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 			// Copy vertices except the first 'nv' verts which are equal to nav poly verts.
 			if (ndv-nv)
 			{
-				memcpy(&navDVerts[vbase*3], &params->detailVerts[(vb+nv)*3], sizeof(float)*3*(ndv-nv));
+				if (quantDetailVertCount)
+					quantizeDetailVerts(header, &params->detailVerts[(vb+nv)*3], ndv-nv, &navQuantDVerts[vbase*3]);
+				else
+					memcpy(&navDVerts[vbase*3], &params->detailVerts[(vb+nv)*3], sizeof(float)*3*(ndv-nv));
 				vbase += (unsigned short)(ndv-nv);
 			}
 		}
 		// Store triangles.
 		memcpy(navDTris, params->detailTris, sizeof(unsigned char)*4*params->detailTriCount);
+
+		// Store detail grids.
+		int cellBase = 0;
+		int triBase = 0;
+		for (int i = 0; i < detailGridCount; ++i)
+		{
+			const int size = calcDetailGridSize(params, i);
+			if (!size)
+				continue;
+			dtDetailGrid& grid = navDGrids[i];
+			grid.cellBase = (unsigned int)cellBase;
+			triBase += buildDetailGrid(params, i, size, &grid, &navDGridCells[cellBase], &navDGridTris[triBase], triBase);
+			cellBase += size*size+1;
+		}
 	}
 	else
 	{
@@ -624,39 +1409,62 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 	// Store and create BVtree.
 	if (params->buildBvTree)
 	{
-		createBVTree(params, navBvtree, 2*params->polyCount);
+		createBVTree(params, navBvtree, 2*params->polyCount-1);
+	}
+	if (bvWideNodeCount)
+	{
+		createBVWideTree(params, navBvWideTree, bvWideNodeCount);
 	}
 	
 	// Store Off-Mesh connections.
-	n = 0;
-	for (int i = 0; i < params->offMeshConCount; ++i)
-	{
-		// Only store connections which start from this tile.
-		if (offMeshConClass[i*2+0] == 0xff)
-		{
-			dtOffMeshConnection* con = &offMeshCons[n];
-			con->poly = (unsigned short)(offMeshPolyBase + n);
-			// Copy connection end-points.
-			const float* endPts = &params->offMeshConVerts[i*2*3];
-			dtVcopy(&con->pos[0], &endPts[0]);
-			dtVcopy(&con->pos[3], &endPts[3]);
-			con->rad = params->offMeshConRad[i];
-			con->flags = params->offMeshConDir[i] ? DT_OFFMESH_CON_BIDIR : 0;
-			con->side = offMeshConClass[i*2+1];
-			if (params->offMeshConUserID)
-				con->userId = params->offMeshConUserID[i];
-			n++;
-		}
+	for (int n = 0; n < storedOffMeshConCount; ++n)
+	{
+		const int i = offMeshConOrder[n];
+		dtOffMeshConnection* con = &offMeshCons[n];
+		con->poly = (unsigned short)(offMeshPolyBase + n);
+		// Copy connection end-points.
+		const float* endPts = &params->offMeshConVerts[i*2*3];
+		dtVcopy(&con->pos[0], &endPts[0]);
+		dtVcopy(&con->pos[3], &endPts[3]);
+		con->rad = params->offMeshConRad[i];
+		con->flags = params->offMeshConDir[i] ? DT_OFFMESH_CON_BIDIR : 0;
+		con->side = offMeshConClass[i*2+1];
+		if (params->offMeshConUserID)
+			con->userId = params->offMeshConUserID[i];
+		con->startPoly = DT_OFFMESH_CON_NO_POLY;
+		con->endPoly = DT_OFFMESH_CON_NO_POLY;
 	}
 		
+	dtFree(offMeshConOrder);
 	dtFree(offMeshConClass);
+
+	if (storedOffMeshConCount > 0)
+		resolveOffMeshConnections(data, dataSize);
 	
-	*outData = data;
+	if (outData)
+		*outData = data;
 	*outDataSize = dataSize;
 	
 	return true;
 }
 
+bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData, int* outDataSize)
+{
+	return createNavMeshData(params, 0, 0, outData, outDataSize);
+}
+
+bool dtCalcNavMeshDataSize(dtNavMeshCreateParams* params, int* outDataSize)
+{
+	return createNavMeshData(params, 0, 0, 0, outDataSize);
+}
+
+bool dtWriteNavMeshData(dtNavMeshCreateParams* params, unsigned char* data, const int dataSize, int* outDataSize)
+{
+	if (!data || ((size_t)data & 3))
+		return false;
+	return createNavMeshData(params, data, dataSize, 0, outDataSize);
+}
+
 bool dtNavMeshHeaderSwapEndian(unsigned char* data, const int /*dataSize*/)
 {
 	dtMeshHeader* header = (dtMeshHeader*)data;
@@ -697,6 +1505,29 @@ bool dtNavMeshHeaderSwapEndian(unsigned char* data, const int /*dataSize*/)
 	dtSwapEndian(&header->bmax[1]);
 	dtSwapEndian(&header->bmax[2]);
 	dtSwapEndian(&header->bvQuantFactor);
+	dtSwapEndian(&header->bvWideNodeCount);
+	dtSwapEndian(&header->quantVertCount);
+	dtSwapEndian(&header->quantCellSize);
+	dtSwapEndian(&header->quantCellHeight);
+	dtSwapEndian(&header->quantDetailVertCount);
+	dtSwapEndian(&header->detailGridCount);
+	dtSwapEndian(&header->detailGridCellCount);
+	dtSwapEndian(&header->detailGridTriCount);
+	for (int i = 0; i < 3; ++i)
+	{
+		dtSwapEndian(&header->quantDetailBmin[i]);
+		dtSwapEndian(&header->quantDetailScale[i]);
+	}
+	for (int i = 0; i < DT_OFFMESH_SIDE_GROUPS; ++i)
+		dtSwapEndian(&header->offMeshSideBase[i]);
+	dtSwapEndian(&header->portalEdgeCount);
+	for (int i = 0; i < 8; ++i)
+		dtSwapEndian(&header->portalSideBase[i]);
+	dtSwapEndian(&header->edgeClearanceCount);
+	dtSwapEndian(&header->edgeClearanceScale);
+	dtSwapEndian(&header->wallDistGridCount);
+	dtSwapEndian(&header->wallDistSampleCount);
+	dtSwapEndian(&header->wallDistScale);
 
 	// Freelist index and pointers are updated when tile is added, no need to swap.
 
@@ -720,14 +1551,25 @@ bool dtNavMeshDataSwapEndian(unsigned char* data, const int /*dataSize*/)
 	
 	// Patch header pointers.
 	const int headerSize = dtAlign4(sizeof(dtMeshHeader));
-	const int vertsSize = dtAlign4(sizeof(float)*3*header->vertCount);
+	const int floatVertCount = header->vertCount - header->quantVertCount;
+	const int vertsSize = dtAlign4(sizeof(float)*3*floatVertCount);
 	const int polysSize = dtAlign4(sizeof(dtPoly)*header->polyCount);
 	const int linksSize = dtAlign4(sizeof(dtLink)*(header->maxLinkCount));
 	const int detailMeshesSize = dtAlign4(sizeof(dtPolyDetail)*header->detailMeshCount);
-	const int detailVertsSize = dtAlign4(sizeof(float)*3*header->detailVertCount);
+	const int floatDetailVertCount = header->detailVertCount - header->quantDetailVertCount;
+	const int detailVertsSize = dtAlign4(sizeof(float)*3*floatDetailVertCount);
 	const int detailTrisSize = dtAlign4(sizeof(unsigned char)*4*header->detailTriCount);
 	const int bvtreeSize = dtAlign4(sizeof(dtBVNode)*header->bvNodeCount);
 	const int offMeshLinksSize = dtAlign4(sizeof(dtOffMeshConnection)*header->offMeshConCount);
+	const int bvWideTreeSize = dtAlign4(sizeof(dtBVWideNode)*header->bvWideNodeCount);
+	const int quantVertsSize = dtAlign4(sizeof(unsigned short)*3*header->quantVertCount);
+	const int quantDetailVertsSize = dtAlign4(sizeof(unsigned short)*3*header->quantDetailVertCount);
+	const int detailGridsSize = dtAlign4(sizeof(dtDetailGrid)*header->detailGridCount);
+	const int detailGridCellsSize = dtAlign4(sizeof(unsigned int)*header->detailGridCellCount);
+	const int detailGridTrisSize = dtAlign4(sizeof(unsigned char)*header->detailGridTriCount);
+	const int portalEdgesSize = dtAlign4(sizeof(dtPortalEdge)*header->portalEdgeCount);
+	const int edgeClearanceSize = dtAlign4(sizeof(unsigned char)*header->edgeClearanceCount);
+	const int wallDistGridsSize = dtAlign4(sizeof(dtWallDistGrid)*header->wallDistGridCount);
 	
 	unsigned char* d = data + headerSize;
 	float* verts = dtGetThenAdvanceBufferPointer<float>(d, vertsSize);
@@ -740,12 +1582,25 @@ bool dtNavMeshDataSwapEndian(unsigned char* data, const int /*dataSize*/)
 	//unsigned char* detailTris = dtGetThenAdvanceBufferPointer<unsigned char>(d, detailTrisSize);
 	dtBVNode* bvTree = dtGetThenAdvanceBufferPointer<dtBVNode>(d, bvtreeSize);
 	dtOffMeshConnection* offMeshCons = dtGetThenAdvanceBufferPointer<dtOffMeshConnection>(d, offMeshLinksSize);
+	dtBVWideNode* bvWideTree = dtGetThenAdvanceBufferPointer<dtBVWideNode>(d, bvWideTreeSize);
+	unsigned short* quantVerts = dtGetThenAdvanceBufferPointer<unsigned short>(d, quantVertsSize);
+	unsigned short* quantDetailVerts = dtGetThenAdvanceBufferPointer<unsigned short>(d, quantDetailVertsSize);
+	dtDetailGrid* detailGrids = dtGetThenAdvanceBufferPointer<dtDetailGrid>(d, detailGridsSize);
+	unsigned int* detailGridCells = dtGetThenAdvanceBufferPointer<unsigned int>(d, detailGridCellsSize);
+	d += detailGridTrisSize; // Detail grid triangle indices are single bytes and can't be endian-swapped.
+	dtPortalEdge* portalEdges = dtGetThenAdvanceBufferPointer<dtPortalEdge>(d, portalEdgesSize);
+	d += edgeClearanceSize; // Edge clearances are single bytes and can't be endian-swapped.
+	dtWallDistGrid* wallDistGrids = dtGetThenAdvanceBufferPointer<dtWallDistGrid>(d, wallDistGridsSize);
 	
 	// Vertices
-	for (int i = 0; i < header->vertCount*3; ++i)
+	for (int i = 0; i < floatVertCount*3; ++i)
 	{
 		dtSwapEndian(&verts[i]);
 	}
+	for (int i = 0; i < header->quantVertCount*3; ++i)
+	{
+		dtSwapEndian(&quantVerts[i]);
+	}
 
 	// Polys
 	for (int i = 0; i < header->polyCount; ++i)
@@ -771,10 +1626,14 @@ bool dtNavMeshDataSwapEndian(unsigned char* data, const int /*dataSize*/)
 	}
 	
 	// Detail verts
-	for (int i = 0; i < header->detailVertCount*3; ++i)
+	for (int i = 0; i < floatDetailVertCount*3; ++i)
 	{
 		dtSwapEndian(&detailVerts[i]);
 	}
+	for (int i = 0; i < header->quantDetailVertCount*3; ++i)
+	{
+		dtSwapEndian(&quantDetailVerts[i]);
+	}
 
 	// BV-tree
 	for (int i = 0; i < header->bvNodeCount; ++i)
@@ -796,6 +1655,62 @@ bool dtNavMeshDataSwapEndian(unsigned char* data, const int /*dataSize*/)
 			dtSwapEndian(&con->pos[j]);
 		dtSwapEndian(&con->rad);
 		dtSwapEndian(&con->poly);
+		dtSwapEndian(&con->startPoly);
+		dtSwapEndian(&con->endPoly);
+	}
+
+	// Wide BV-tree
+	for (int i = 0; i < header->bvWideNodeCount; ++i)
+	{
+		dtBVWideNode* node = &bvWideTree[i];
+		for (int j = 0; j < 3; ++j)
+		{
+			for (int k = 0; k < DT_BVWIDE_WIDTH; ++k)
+			{
+				dtSwapEndian(&node->bmin[j][k]);
+				dtSwapEndian(&node->bmax[j][k]);
+			}
+		}
+		for (int k = 0; k < DT_BVWIDE_WIDTH; ++k)
+			dtSwapEndian(&node->child[k]);
+		dtSwapEndian(&node->childCount);
+	}
+
+	// Detail grids
+	for (int i = 0; i < header->detailGridCount; ++i)
+	{
+		dtDetailGrid* grid = &detailGrids[i];
+		for (int j = 0; j < 2; ++j)
+		{
+			dtSwapEndian(&grid->bmin[j]);
+			dtSwapEndian(&grid->invCellSize[j]);
+		}
+		dtSwapEndian(&grid->cellBase);
+	}
+	for (int i = 0; i < header->detailGridCellCount; ++i)
+	{
+		dtSwapEndian(&detailGridCells[i]);
+	}
+
+	// Portal edges
+	for (int i = 0; i < header->portalEdgeCount; ++i)
+	{
+		dtPortalEdge* edge = &portalEdges[i];
+		dtSwapEndian(&edge->bmin);
+		dtSwapEndian(&edge->bmax);
+		dtSwapEndian(&edge->poly);
+	}
+
+	// Wall distance grids
+	for (int i = 0; i < header->wallDistGridCount; ++i)
+	{
+		dtWallDistGrid* grid = &wallDistGrids[i];
+		for (int j = 0; j < 2; ++j)
+		{
+			dtSwapEndian(&grid->bmin[j]);
+			dtSwapEndian(&grid->invSpacing[j]);
+		}
+		dtSwapEndian(&grid->sampleBase);
 	}
 	
 	return true;
@@ -0,0 +1,166 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "DetourNavMeshFile.h"
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+#include <string.h>
+
+static size_t alignToPage(const size_t size, const int pageSize)
+{
+	return (size + (size_t)pageSize - 1) & ~((size_t)pageSize - 1);
+}
+
+// Instanced tiles do not have tile data of their own to store.
+static bool isStoredTile(const dtMeshTile* tile)
+{
+	return tile && tile->header && tile->dataSize && !(tile->flags & DT_TILE_INSTANCE);
+}
+
+dtStatus dtCreateNavMeshFile(const dtNavMesh* nav, unsigned char** outData, size_t* outDataSize, const int pageSize)
+{
+	if (!nav || !outData || !outDataSize)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (pageSize < 64 || (pageSize & (pageSize - 1)) != 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	
+	// Calculate the file layout.
+	int tileCount = 0;
+	for (int i = 0; i < nav->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = nav->getTile(i);
+		if (isStoredTile(tile))
+			tileCount++;
+	}
+	
+	const size_t directorySize = sizeof(dtNavMeshFileHeader) + sizeof(dtNavMeshFileTile) * tileCount;
+	size_t dataSize = alignToPage(directorySize, pageSize);
+	for (int i = 0; i < nav->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = nav->getTile(i);
+		if (isStoredTile(tile))
+			dataSize += alignToPage(tile->dataSize, pageSize);
+	}
+	if (dataSize / pageSize > 0xffffffffu)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	
+	unsigned char* data = (unsigned char*)dtAlloc(dataSize, DT_ALLOC_PERM);
+	if (!data)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(data, 0, dataSize);
+	
+	dtNavMeshFileHeader* header = (dtNavMeshFileHeader*)data;
+	header->magic = DT_NAVMESH_FILE_MAGIC;
+	header->version = DT_NAVMESH_FILE_VERSION;
+	header->pageSize = pageSize;
+	header->tileCount = tileCount;
+	header->navMeshFlags = nav->getFlags();
+	memcpy(&header->params, nav->getParams(), sizeof(dtNavMeshParams));
+	
+	dtNavMeshFileTile* entries = (dtNavMeshFileTile*)(data + sizeof(dtNavMeshFileHeader));
+	size_t offset = alignToPage(directorySize, pageSize);
+	int n = 0;
+	for (int i = 0; i < nav->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = nav->getTile(i);
+		if (!isStoredTile(tile))
+			continue;
+		
+		const dtTileRef ref = nav->getTileRef(tile);
+		dtNavMeshFileTile& entry = entries[n++];
+		entry.refLow = (unsigned int)ref;
+#ifdef DT_POLYREF64
+		entry.refHigh = (unsigned int)(ref >> 32);
+#else
+		entry.refHigh = 0;
+#endif
+		entry.page = (unsigned int)(offset / pageSize);
+		entry.dataSize = tile->dataSize;
+		memcpy(data + offset, tile->data, tile->dataSize);
+		offset += alignToPage(tile->dataSize, pageSize);
+	}
+	
+	*outData = data;
+	*outDataSize = dataSize;
+	
+	return DT_SUCCESS;
+}
+
+dtStatus dtGetNavMeshFileTiles(const unsigned char* data, const size_t dataSize,
+							   const dtNavMeshFileHeader** header, const dtNavMeshFileTile** tiles)
+{
+	if (!data || dataSize < sizeof(dtNavMeshFileHeader))
+		return DT_FAILURE | DT_INVALID_PARAM;
+	
+	const dtNavMeshFileHeader* fileHeader = (const dtNavMeshFileHeader*)data;
+	if (fileHeader->magic != DT_NAVMESH_FILE_MAGIC)
+		return DT_FAILURE | DT_WRONG_MAGIC;
+	if (fileHeader->version != DT_NAVMESH_FILE_VERSION)
+		return DT_FAILURE | DT_WRONG_VERSION;
+	const int pageSize = fileHeader->pageSize;
+	if (fileHeader->tileCount < 0 || pageSize < 64 || (pageSize & (pageSize - 1)) != 0 ||
+		(dataSize - sizeof(dtNavMeshFileHeader)) / sizeof(dtNavMeshFileTile) < (size_t)fileHeader->tileCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	
+	// Make sure all tiles are inside the file.
+	const dtNavMeshFileTile* entries = (const dtNavMeshFileTile*)(data + sizeof(dtNavMeshFileHeader));
+	for (int i = 0; i < fileHeader->tileCount; ++i)
+	{
+		const size_t offset = (size_t)entries[i].page * (size_t)pageSize;
+		if (entries[i].dataSize <= 0 || offset > dataSize || dataSize - offset < (size_t)entries[i].dataSize)
+			return DT_FAILURE | DT_INVALID_PARAM;
+#ifndef DT_POLYREF64
+		if (entries[i].refHigh)
+			return DT_FAILURE | DT_INVALID_PARAM;
+#endif
+	}
+	
+	if (header)
+		*header = fileHeader;
+	if (tiles)
+		*tiles = entries;
+	
+	return DT_SUCCESS;
+}
+
+dtStatus dtInitNavMeshFromFile(dtNavMesh* nav, unsigned char* data, const size_t dataSize)
+{
+	if (!nav)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	
+	const dtNavMeshFileHeader* header = 0;
+	const dtNavMeshFileTile* tiles = 0;
+	dtStatus status = dtGetNavMeshFileTiles(data, dataSize, &header, &tiles);
+	if (dtStatusFailed(status))
+		return status;
+	
+	status = nav->init(&header->params, header->navMeshFlags);
+	if (dtStatusFailed(status))
+		return status;
+	
+	for (int i = 0; i < header->tileCount; ++i)
+	{
+		// The file owns the tile data.
+		unsigned char* tileData = data + (size_t)tiles[i].page * (size_t)header->pageSize;
+		status = nav->addTile(tileData, tiles[i].dataSize, 0, dtGetNavMeshFileTileRef(tiles[i]), 0);
+		if (dtStatusFailed(status))
+			return status;
+	}
+	
+	return DT_SUCCESS;
+}
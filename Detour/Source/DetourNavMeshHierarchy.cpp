@@ -0,0 +1,783 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+#include "DetourNavMeshHierarchy.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNode.h"
+#include "DetourCommon.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+#include <new>
+
+static const float H_SCALE = 0.999f; // Search heuristic scale.
+
+dtNavMeshHierarchy* dtAllocNavMeshHierarchy()
+{
+	void* mem = dtAlloc(sizeof(dtNavMeshHierarchy), DT_ALLOC_PERM);
+	if (!mem) return 0;
+	return new(mem) dtNavMeshHierarchy;
+}
+
+void dtFreeNavMeshHierarchy(dtNavMeshHierarchy* hierarchy)
+{
+	if (!hierarchy) return;
+	hierarchy->~dtNavMeshHierarchy();
+	dtFree(hierarchy);
+}
+
+namespace
+{
+/// A portal edge of a tile polygon.
+struct dtTilePortal
+{
+	float smin, smax;	// Extents along the tile side.
+	float ymin, ymax;	// Vertical extents.
+	float mid[3];		// Midpoint of the edge.
+	unsigned short poly;
+	unsigned char side;
+};
+
+int comparePortals(const void* va, const void* vb)
+{
+	const dtTilePortal* a = (const dtTilePortal*)va;
+	const dtTilePortal* b = (const dtTilePortal*)vb;
+	if (a->side != b->side) return a->side < b->side ? -1 : 1;
+	if (a->smin != b->smin) return a->smin < b->smin ? -1 : 1;
+	return (int)a->poly - (int)b->poly;
+}
+
+/// Calculates the point where a search inside a tile enters the neighbour polygon.
+void getLinkPoint(const dtMeshTile* tile, dtPolyRef fromRef, const dtPoly* fromPoly, const dtLink* link,
+				  const dtPoly* toPoly, float* pt)
+{
+	if (fromPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		dtGetTileVertex(tile, fromPoly->verts[link->edge], pt);
+		return;
+	}
+	if (toPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		for (unsigned int i = toPoly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+		{
+			if (tile->links[i].ref == fromRef)
+			{
+				dtGetTileVertex(tile, toPoly->verts[tile->links[i].edge], pt);
+				return;
+			}
+		}
+	}
+	float va[3], vb[3];
+	dtGetTileVertex(tile, fromPoly->verts[link->edge], va);
+	dtGetTileVertex(tile, fromPoly->verts[(link->edge+1) % fromPoly->vertCount], vb);
+	dtVlerp(pt, va, vb, 0.5f);
+}
+} // anonymous namespace
+
+dtNavMeshHierarchy::dtNavMeshHierarchy() :
+	m_nav(0),
+	m_filter(0),
+	m_tiles(0),
+	m_maxTiles(0),
+	m_tileNodePool(0),
+	m_tileOpenList(0),
+	m_nodePool(0),
+	m_openList(0),
+	m_startCosts(0),
+	m_endCosts(0),
+	m_maxEntrances(0)
+{
+}
+
+dtNavMeshHierarchy::~dtNavMeshHierarchy()
+{
+	for (int i = 0; i < m_maxTiles; ++i)
+		freeTile(m_tiles[i]);
+	dtFree(m_tiles);
+	if (m_tileNodePool)
+		m_tileNodePool->~dtNodePool();
+	if (m_tileOpenList)
+		m_tileOpenList->~dtNodeQueue();
+	if (m_nodePool)
+		m_nodePool->~dtNodePool();
+	if (m_openList)
+		m_openList->~dtNodeQueue();
+	dtFree(m_tileNodePool);
+	dtFree(m_tileOpenList);
+	dtFree(m_nodePool);
+	dtFree(m_openList);
+	dtFree(m_startCosts);
+	dtFree(m_endCosts);
+}
+
+/// @par
+///
+/// Must be the first function called after construction, before other
+/// functions are used. The abstract graph is built by the first call to #update.
+dtStatus dtNavMeshHierarchy::init(const dtNavMesh* nav, const dtQueryFilter* filter, const int maxNodes)
+{
+	if (!nav || !filter || maxNodes <= 0 || maxNodes > DT_NULL_IDX || maxNodes > (1 << DT_NODE_PARENT_BITS) - 1)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	// Only single init.
+	if (m_nav)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	m_nav = nav;
+	m_filter = filter;
+	m_tracker.init(nav, false);
+
+	m_maxTiles = nav->getMaxTiles();
+	m_tiles = (dtHierarchyTile*)dtAlloc(sizeof(dtHierarchyTile)*dtMax(m_maxTiles, 1), DT_ALLOC_PERM);
+	if (!m_tiles)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(m_tiles, 0, sizeof(dtHierarchyTile)*m_maxTiles);
+
+	// The searches inside a tile can visit every polygon of the tile.
+	const int maxTileNodes = dtMin(nav->getParams()->maxPolys, (int)DT_NULL_IDX);
+	m_tileNodePool = new (dtAlloc(sizeof(dtNodePool), DT_ALLOC_PERM)) dtNodePool(maxTileNodes, dtNextPow2(maxTileNodes/4));
+	if (!m_tileNodePool)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	m_tileOpenList = new (dtAlloc(sizeof(dtNodeQueue), DT_ALLOC_PERM)) dtNodeQueue(maxTileNodes);
+	if (!m_tileOpenList)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+
+	m_nodePool = new (dtAlloc(sizeof(dtNodePool), DT_ALLOC_PERM)) dtNodePool(maxNodes, dtNextPow2(maxNodes/4));
+	if (!m_nodePool)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	m_openList = new (dtAlloc(sizeof(dtNodeQueue), DT_ALLOC_PERM)) dtNodeQueue(maxNodes);
+	if (!m_openList)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+
+	return DT_SUCCESS;
+}
+
+const dtHierarchyTile* dtNavMeshHierarchy::getTile(int i) const
+{
+	if (i < 0 || i >= m_maxTiles)
+		return 0;
+	return &m_tiles[i];
+}
+
+void dtNavMeshHierarchy::freeTile(dtHierarchyTile& htile)
+{
+	dtFree(htile.entrances);
+	dtFree(htile.costs);
+	dtFree(htile.polys);
+	memset(&htile, 0, sizeof(dtHierarchyTile));
+}
+
+/// @par
+///
+/// Only the tiles which were added, removed or replaced are rebuilt.
+/// (See: dtTileRefTracker)
+dtStatus dtNavMeshHierarchy::update(int* updatedTileCount)
+{
+	dtAssert(m_nav);
+
+	if (updatedTileCount)
+		*updatedTileCount = 0;
+
+	if (m_tracker.isUpToDate())
+		return DT_SUCCESS;
+
+	dtStatus status = m_tracker.update();
+	if (dtStatusFailed(status))
+		return status;
+	if (!dtGrowTileTable(m_tiles, m_maxTiles, m_tracker.getMaxTiles()))
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	m_maxTiles = dtMax(m_maxTiles, m_tracker.getMaxTiles());
+
+	int updated = 0;
+	for (int i = 0; i < m_tracker.getChangedTileCount(); ++i)
+	{
+		const int tileIndex = m_tracker.getChangedTile(i);
+		const dtTileRef ref = m_tracker.getTileRef(tileIndex);
+		dtHierarchyTile& htile = m_tiles[tileIndex];
+
+		freeTile(htile);
+		updated++;
+		if (!ref)
+			continue;
+		if (!buildTile(m_nav->getTile(tileIndex), htile))
+		{
+			freeTile(htile);
+			status = DT_FAILURE | DT_OUT_OF_MEMORY;
+			continue;
+		}
+		htile.ref = ref;
+	}
+
+	// Make sure the scratch costs can hold the entrances of any tile.
+	int maxEntrances = 0;
+	for (int i = 0; i < m_maxTiles; ++i)
+		maxEntrances = dtMax(maxEntrances, m_tiles[i].entranceCount);
+	if (maxEntrances > m_maxEntrances)
+	{
+		dtFree(m_startCosts);
+		dtFree(m_endCosts);
+		m_startCosts = (float*)dtAlloc(sizeof(float)*maxEntrances, DT_ALLOC_PERM);
+		m_endCosts = (float*)dtAlloc(sizeof(float)*maxEntrances, DT_ALLOC_PERM);
+		m_maxEntrances = maxEntrances;
+		if (!m_startCosts || !m_endCosts)
+		{
+			m_maxEntrances = 0;
+			status = DT_FAILURE | DT_OUT_OF_MEMORY;
+		}
+	}
+
+	if (dtStatusSucceed(status))
+		m_tracker.commit();
+
+	if (updatedTileCount)
+		*updatedTileCount = updated;
+
+	return status;
+}
+
+bool dtNavMeshHierarchy::buildTile(const dtMeshTile* tile, dtHierarchyTile& htile)
+{
+	const dtMeshHeader* header = tile->header;
+	const dtPolyRef base = m_nav->getPolyRefBase(tile);
+
+	// Collect the portal edges of the tile.
+	int nportals = 0;
+	for (int i = 0; i < header->polyCount; ++i)
+	{
+		const dtPoly* poly = &tile->polys[i];
+		if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+			continue;
+		for (int j = 0; j < (int)poly->vertCount; ++j)
+		{
+			if (poly->neis[j] & DT_EXT_LINK)
+				nportals++;
+		}
+	}
+
+	if (!nportals)
+		return true;
+
+	dtTilePortal* portals = (dtTilePortal*)dtAlloc(sizeof(dtTilePortal)*nportals, DT_ALLOC_TEMP);
+	if (!portals)
+		return false;
+
+	int n = 0;
+	for (int i = 0; i < header->polyCount; ++i)
+	{
+		const dtPoly* poly = &tile->polys[i];
+		if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+			continue;
+		if (!m_filter->passFilter(base | (dtPolyRef)i, tile, poly))
+			continue;
+		for (int j = 0; j < (int)poly->vertCount; ++j)
+		{
+			if (!(poly->neis[j] & DT_EXT_LINK))
+				continue;
+			float va[3], vb[3];
+			dtGetTileVertex(tile, poly->verts[j], va);
+			dtGetTileVertex(tile, poly->verts[(j+1) % poly->vertCount], vb);
+			dtTilePortal& portal = portals[n++];
+			portal.side = (unsigned char)(poly->neis[j] & 0xff);
+			portal.poly = (unsigned short)i;
+			// Portals on the x-sides run along z, and on the z-sides along x.
+			const int axis = (portal.side == 0 || portal.side == 4) ? 2 : 0;
+			portal.smin = dtMin(va[axis], vb[axis]);
+			portal.smax = dtMax(va[axis], vb[axis]);
+			portal.ymin = dtMin(va[1], vb[1]);
+			portal.ymax = dtMax(va[1], vb[1]);
+			dtVlerp(portal.mid, va, vb, 0.5f);
+		}
+	}
+	nportals = n;
+
+	qsort(portals, (size_t)nportals, sizeof(dtTilePortal), comparePortals);
+
+	// Count the runs of touching portals.
+	const float eps = 0.01f / header->bvQuantFactor;
+	int nentrances = 0;
+	for (int i = 0; i < nportals; ++i)
+	{
+		if (i == 0 || portals[i].side != portals[i-1].side ||
+			portals[i].smin > portals[i-1].smax + eps ||
+			portals[i].ymin > portals[i-1].ymax + header->walkableClimb ||
+			portals[i].ymax < portals[i-1].ymin - header->walkableClimb)
+		{
+			nentrances++;
+		}
+	}
+
+	htile.entrances = (dtHierarchyEntrance*)dtAlloc(sizeof(dtHierarchyEntrance)*dtMax(nentrances, 1), DT_ALLOC_PERM);
+	htile.polys = (unsigned short*)dtAlloc(sizeof(unsigned short)*dtMax(nportals, 1), DT_ALLOC_PERM);
+	htile.costs = (float*)dtAlloc(sizeof(float)*dtMax(nentrances*nentrances, 1), DT_ALLOC_PERM);
+	if (!htile.entrances || !htile.polys || !htile.costs)
+	{
+		dtFree(portals);
+		return false;
+	}
+
+	// Build the entrances, each represented by the portal closest to the middle of the run.
+	htile.entranceCount = 0;
+	htile.polyCount = 0;
+	for (int i = 0; i < nportals; )
+	{
+		int j = i+1;
+		while (j < nportals && portals[j].side == portals[i].side &&
+			   portals[j].smin <= portals[j-1].smax + eps &&
+			   portals[j].ymin <= portals[j-1].ymax + header->walkableClimb &&
+			   portals[j].ymax >= portals[j-1].ymin - header->walkableClimb)
+		{
+			j++;
+		}
+
+		const float runMid = (portals[i].smin + portals[j-1].smax) * 0.5f;
+		int best = i;
+		float bestDist = FLT_MAX;
+		for (int k = i; k < j; ++k)
+		{
+			const float d = dtAbs((portals[k].smin + portals[k].smax) * 0.5f - runMid);
+			if (d < bestDist)
+			{
+				bestDist = d;
+				best = k;
+			}
+		}
+
+		dtHierarchyEntrance& entrance = htile.entrances[htile.entranceCount++];
+		dtVcopy(entrance.pos, portals[best].mid);
+		entrance.ref = base | (dtPolyRef)portals[best].poly;
+		entrance.side = portals[i].side;
+		entrance.firstPoly = (unsigned short)htile.polyCount;
+		for (int k = i; k < j; ++k)
+			htile.polys[htile.polyCount++] = portals[k].poly;
+		entrance.polyCount = (unsigned short)(htile.polyCount - entrance.firstPoly);
+
+		i = j;
+	}
+
+	dtFree(portals);
+
+	// Cost between each pair of entrances.
+	for (int i = 0; i < htile.entranceCount; ++i)
+	{
+		const dtHierarchyEntrance& entrance = htile.entrances[i];
+		calcEntranceCosts(tile, htile, entrance.ref, entrance.pos, &htile.costs[i*htile.entranceCount]);
+	}
+
+	return true;
+}
+
+void dtNavMeshHierarchy::calcEntranceCosts(const dtMeshTile* tile, const dtHierarchyTile& htile,
+										   dtPolyRef startRef, const float* startPos, float* costs)
+{
+	m_tileNodePool->clear();
+	m_tileOpenList->clear();
+
+	dtNode* startNode = m_tileNodePool->getNode(startRef);
+	dtVcopy(startNode->pos, startPos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = 0;
+	startNode->id = startRef;
+	startNode->flags = DT_NODE_OPEN;
+	m_tileOpenList->push(startNode);
+
+	// Dijkstra search over the polygons of the tile.
+	while (!m_tileOpenList->empty())
+	{
+		dtNode* bestNode = m_tileOpenList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+
+		const dtPolyRef bestRef = bestNode->id;
+		const dtMeshTile* bestTile = 0;
+		const dtPoly* bestPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
+
+		dtPolyRef parentRef = 0;
+		const dtMeshTile* parentTile = 0;
+		const dtPoly* parentPoly = 0;
+		if (bestNode->pidx)
+			parentRef = m_tileNodePool->getNodeAtIdx(bestNode->pidx)->id;
+		if (parentRef)
+			m_nav->getTileAndPolyByRefUnsafe(parentRef, &parentTile, &parentPoly);
+
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+		{
+			const dtLink* link = &tile->links[i];
+			const dtPolyRef neighbourRef = link->ref;
+
+			// Stay inside the tile.
+			if (!neighbourRef || neighbourRef == parentRef || link->side != 0xff)
+				continue;
+
+			const dtMeshTile* neighbourTile = 0;
+			const dtPoly* neighbourPoly = 0;
+			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
+			if (neighbourTile != tile)
+				continue;
+
+			if (!m_filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+				continue;
+
+			dtNode* neighbourNode = m_tileNodePool->getNode(neighbourRef);
+			if (!neighbourNode)
+				continue;
+
+			if (neighbourNode->flags == 0)
+				getLinkPoint(tile, bestRef, bestPoly, link, neighbourPoly, neighbourNode->pos);
+
+			const float cost = bestNode->cost + m_filter->getCost(bestNode->pos, neighbourNode->pos,
+																  parentRef, parentTile, parentPoly,
+																  bestRef, bestTile, bestPoly,
+																  neighbourRef, neighbourTile, neighbourPoly);
+
+			if ((neighbourNode->flags & (DT_NODE_OPEN | DT_NODE_CLOSED)) && cost >= neighbourNode->cost)
+				continue;
+
+			neighbourNode->pidx = m_tileNodePool->getNodeIdx(bestNode);
+			neighbourNode->id = neighbourRef;
+			neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
+			neighbourNode->cost = cost;
+			neighbourNode->total = cost;
+
+			if (neighbourNode->flags & DT_NODE_OPEN)
+			{
+				m_tileOpenList->modify(neighbourNode);
+			}
+			else
+			{
+				neighbourNode->flags |= DT_NODE_OPEN;
+				m_tileOpenList->push(neighbourNode);
+			}
+		}
+	}
+
+	for (int i = 0; i < htile.entranceCount; ++i)
+	{
+		const dtHierarchyEntrance& entrance = htile.entrances[i];
+		const dtNode* node = m_tileNodePool->findNode(entrance.ref, 0);
+		if (!node || !(node->flags & DT_NODE_CLOSED))
+		{
+			costs[i] = FLT_MAX;
+			continue;
+		}
+		const dtMeshTile* entranceTile = 0;
+		const dtPoly* entrancePoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(entrance.ref, &entranceTile, &entrancePoly);
+		costs[i] = node->cost + m_filter->getCost(node->pos, entrance.pos,
+												  0, 0, 0,
+												  entrance.ref, entranceTile, entrancePoly,
+												  0, 0, 0);
+	}
+}
+
+int dtNavMeshHierarchy::findEntrance(const dtHierarchyTile& htile, const unsigned int polyIndex,
+									 const unsigned char side) const
+{
+	for (int i = 0; i < htile.entranceCount; ++i)
+	{
+		const dtHierarchyEntrance& entrance = htile.entrances[i];
+		if (entrance.side != side)
+			continue;
+		for (int j = 0; j < (int)entrance.polyCount; ++j)
+		{
+			if (htile.polys[entrance.firstPoly + j] == polyIndex)
+				return i;
+		}
+	}
+	return -1;
+}
+
+/// @par
+///
+/// The hierarchy must have been updated after the last change to the navigation
+/// mesh, see #update. If the start and end polygons are in the same or in
+/// neighbouring tiles, the path is searched directly using @p query.
+///
+/// The abstract search nodes are keyed by the representative polygon of the
+/// entrance and the tile side, so entrances are visited at most once per side.
+///
+/// If the end cannot be reached through the abstract graph, the result of a
+/// direct search with @p query is returned.
+dtStatus dtNavMeshHierarchy::findPath(dtNavMeshQuery* query, dtPolyRef startRef, dtPolyRef endRef,
+									  const float* startPos, const float* endPos,
+									  dtPolyRef* path, int* pathCount, const int maxPath)
+{
+	dtAssert(m_nav);
+	dtAssert(m_nodePool);
+	dtAssert(m_openList);
+
+	if (!pathCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*pathCount = 0;
+
+	const dtMeshTile* startTile = 0;
+	const dtMeshTile* endTile = 0;
+	const dtPoly* startPoly = 0;
+	const dtPoly* endPoly = 0;
+	if (!query || !startPos || !dtVisfinite(startPos) || !endPos || !dtVisfinite(endPos) ||
+		!path || maxPath <= 0 ||
+		dtStatusFailed(m_nav->getTileAndPolyByRef(startRef, &startTile, &startPoly)) ||
+		dtStatusFailed(m_nav->getTileAndPolyByRef(endRef, &endTile, &endPoly)))
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	// Nearby tiles are searched directly.
+	if (dtAbs(startTile->header->x - endTile->header->x) <= 1 &&
+		dtAbs(startTile->header->y - endTile->header->y) <= 1)
+	{
+		return query->findPath(startRef, endRef, startPos, endPos, m_filter, path, pathCount, maxPath);
+	}
+
+	const int startTileIndex = (int)m_nav->decodePolyIdTile(startRef);
+	const int endTileIndex = (int)m_nav->decodePolyIdTile(endRef);
+	if (startTileIndex >= m_maxTiles || endTileIndex >= m_maxTiles)
+		return query->findPath(startRef, endRef, startPos, endPos, m_filter, path, pathCount, maxPath);
+	const dtHierarchyTile& startHTile = m_tiles[startTileIndex];
+	const dtHierarchyTile& endHTile = m_tiles[endTileIndex];
+	if (startHTile.ref != m_nav->getTileRef(startTile) || endHTile.ref != m_nav->getTileRef(endTile))
+		return query->findPath(startRef, endRef, startPos, endPos, m_filter, path, pathCount, maxPath);
+
+	calcEntranceCosts(startTile, startHTile, startRef, startPos, m_startCosts);
+	// Assumes symmetric costs.
+	calcEntranceCosts(endTile, endHTile, endRef, endPos, m_endCosts);
+
+	m_nodePool->clear();
+	m_openList->clear();
+
+	bool outOfNodes = false;
+
+	for (int i = 0; i < startHTile.entranceCount; ++i)
+	{
+		if (m_startCosts[i] == FLT_MAX)
+			continue;
+		const dtHierarchyEntrance& entrance = startHTile.entrances[i];
+		dtNode* node = m_nodePool->getNode(entrance.ref, (unsigned char)(entrance.side >> 1));
+		if (!node)
+		{
+			outOfNodes = true;
+			break;
+		}
+		if ((node->flags & DT_NODE_OPEN) && m_startCosts[i] >= node->cost)
+			continue;
+		dtVcopy(node->pos, entrance.pos);
+		node->pidx = 0;
+		node->cost = m_startCosts[i];
+		node->total = node->cost + dtVdist(entrance.pos, endPos)*H_SCALE;
+		node->id = entrance.ref;
+		if (node->flags & DT_NODE_OPEN)
+		{
+			m_openList->modify(node);
+		}
+		else
+		{
+			node->flags = DT_NODE_OPEN;
+			m_openList->push(node);
+		}
+	}
+
+	dtNode* goalNode = 0;
+	float goalCost = FLT_MAX;
+
+	while (!m_openList->empty())
+	{
+		dtNode* bestNode = m_openList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+
+		// No remaining node can lead to a cheaper path.
+		if (bestNode->total >= goalCost)
+			break;
+
+		const int tileIndex = (int)m_nav->decodePolyIdTile(bestNode->id);
+		const dtHierarchyTile& htile = m_tiles[tileIndex];
+		const unsigned int polyIndex = m_nav->decodePolyIdPoly(bestNode->id);
+		const int e = findEntrance(htile, polyIndex, (unsigned char)(bestNode->state << 1));
+		if (e < 0)
+			continue;
+		const dtHierarchyEntrance& entrance = htile.entrances[e];
+
+		// Reached the end tile.
+		if (tileIndex == endTileIndex && m_endCosts[e] != FLT_MAX)
+		{
+			const float cost = bestNode->cost + m_endCosts[e];
+			if (cost < goalCost)
+			{
+				goalCost = cost;
+				goalNode = bestNode;
+			}
+		}
+
+		// Entrances of the same tile.
+		for (int i = 0; i < htile.entranceCount; ++i)
+		{
+			const float edgeCost = htile.costs[e*htile.entranceCount + i];
+			if (i == e || edgeCost == FLT_MAX)
+				continue;
+			const dtHierarchyEntrance& next = htile.entrances[i];
+			dtNode* neighbourNode = m_nodePool->getNode(next.ref, (unsigned char)(next.side >> 1));
+			if (!neighbourNode)
+			{
+				outOfNodes = true;
+				continue;
+			}
+			const float cost = bestNode->cost + edgeCost;
+			const float total = cost + dtVdist(next.pos, endPos)*H_SCALE;
+			if ((neighbourNode->flags & (DT_NODE_OPEN | DT_NODE_CLOSED)) && total >= neighbourNode->total)
+				continue;
+			dtVcopy(neighbourNode->pos, next.pos);
+			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+			neighbourNode->id = next.ref;
+			neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
+			neighbourNode->cost = cost;
+			neighbourNode->total = total;
+			if (neighbourNode->flags & DT_NODE_OPEN)
+			{
+				m_openList->modify(neighbourNode);
+			}
+			else
+			{
+				neighbourNode->flags |= DT_NODE_OPEN;
+				m_openList->push(neighbourNode);
+			}
+		}
+
+		// Entrances of the neighbour tiles, connected through the tile links.
+		const dtMeshTile* tile = m_nav->getTile(tileIndex);
+		for (int j = 0; j < (int)entrance.polyCount; ++j)
+		{
+			const dtPoly* poly = &tile->polys[htile.polys[entrance.firstPoly + j]];
+			for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+			{
+				const dtLink* link = &tile->links[k];
+				if (link->side != entrance.side)
+					continue;
+
+				const int neighbourTileIndex = (int)m_nav->decodePolyIdTile(link->ref);
+				if (neighbourTileIndex >= m_maxTiles)
+					continue;
+				const dtHierarchyTile& neighbourHTile = m_tiles[neighbourTileIndex];
+				const dtMeshTile* neighbourTile = m_nav->getTile(neighbourTileIndex);
+				if (!neighbourHTile.ref || neighbourHTile.ref != m_nav->getTileRef(neighbourTile))
+					continue;
+				const int f = findEntrance(neighbourHTile, m_nav->decodePolyIdPoly(link->ref), (unsigned char)dtOppositeTile(entrance.side));
+				if (f < 0)
+					continue;
+
+				const dtHierarchyEntrance& next = neighbourHTile.entrances[f];
+				dtNode* neighbourNode = m_nodePool->getNode(next.ref, (unsigned char)(next.side >> 1));
+				if (!neighbourNode)
+				{
+					outOfNodes = true;
+					continue;
+				}
+				const float cost = bestNode->cost + dtVdist(entrance.pos, next.pos);
+				const float total = cost + dtVdist(next.pos, endPos)*H_SCALE;
+				if ((neighbourNode->flags & (DT_NODE_OPEN | DT_NODE_CLOSED)) && total >= neighbourNode->total)
+					continue;
+				dtVcopy(neighbourNode->pos, next.pos);
+				neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+				neighbourNode->id = next.ref;
+				neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
+				neighbourNode->cost = cost;
+				neighbourNode->total = total;
+				if (neighbourNode->flags & DT_NODE_OPEN)
+				{
+					m_openList->modify(neighbourNode);
+				}
+				else
+				{
+					neighbourNode->flags |= DT_NODE_OPEN;
+					m_openList->push(neighbourNode);
+				}
+			}
+		}
+	}
+
+	if (!goalNode)
+	{
+		dtStatus status = query->findPath(startRef, endRef, startPos, endPos, m_filter, path, pathCount, maxPath);
+		if (outOfNodes)
+			status |= DT_OUT_OF_NODES;
+		return status;
+	}
+
+	// Collect the entrances on the abstract path.
+	int nwaypoints = 0;
+	for (const dtNode* node = goalNode; node; node = m_nodePool->getNodeAtIdx(node->pidx))
+		nwaypoints++;
+	dtNode** waypoints = (dtNode**)dtAlloc(sizeof(dtNode*)*nwaypoints, DT_ALLOC_TEMP);
+	if (!waypoints)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	{
+		int i = nwaypoints;
+		for (dtNode* node = goalNode; node; node = m_nodePool->getNodeAtIdx(node->pidx))
+			waypoints[--i] = node;
+	}
+
+	// Refine the path between consecutive waypoints.
+	dtStatus status = DT_SUCCESS;
+	int n = 0;
+	dtPolyRef prevRef = startRef;
+	const float* prevPos = startPos;
+	for (int i = 0; i <= nwaypoints; ++i)
+	{
+		const dtPolyRef nextRef = i < nwaypoints ? waypoints[i]->id : endRef;
+		const float* nextPos = i < nwaypoints ? waypoints[i]->pos : endPos;
+
+		// The segments share their first and last polygons.
+		dtPolyRef* segment = n > 0 ? &path[n-1] : path;
+		const int offset = (int)(segment - path);
+		int segmentCount = 0;
+		const dtStatus segmentStatus = query->findPath(prevRef, nextRef, prevPos, nextPos, m_filter,
+													   segment, &segmentCount, maxPath - offset);
+		if (dtStatusFailed(segmentStatus))
+		{
+			status = segmentStatus;
+			break;
+		}
+		n = offset + segmentCount;
+		if (segment[segmentCount-1] != nextRef)
+		{
+			status |= DT_PARTIAL_RESULT | (segmentStatus & DT_STATUS_DETAIL_MASK);
+			break;
+		}
+		if (dtStatusDetail(segmentStatus, DT_BUFFER_TOO_SMALL) && i < nwaypoints)
+		{
+			status |= DT_PARTIAL_RESULT | DT_BUFFER_TOO_SMALL;
+			break;
+		}
+		prevRef = nextRef;
+		prevPos = nextPos;
+	}
+
+	dtFree(waypoints);
+
+	if (dtStatusFailed(status))
+		return status;
+
+	*pathCount = n;
+	if (outOfNodes)
+		status |= DT_OUT_OF_NODES;
+
+	return status;
+}
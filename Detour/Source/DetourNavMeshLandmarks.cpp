@@ -0,0 +1,670 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#include <float.h>
+#include <string.h>
+#include "DetourNavMeshLandmarks.h"
+#include "DetourCommon.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+#include <new>
+
+dtNavMeshLandmarks* dtAllocNavMeshLandmarks()
+{
+	void* mem = dtAlloc(sizeof(dtNavMeshLandmarks), DT_ALLOC_PERM);
+	if (!mem) return 0;
+	return new(mem) dtNavMeshLandmarks;
+}
+
+void dtFreeNavMeshLandmarks(dtNavMeshLandmarks* landmarks)
+{
+	if (!landmarks) return;
+	landmarks->~dtNavMeshLandmarks();
+	dtFree(landmarks);
+}
+
+namespace
+{
+// Gets the portal of a link the same way as dtNavMeshQuery::getPortalPoints.
+void getLinkPortal(const dtNavMesh* nav, const dtPolyRef ref, const dtMeshTile* tile, const dtPoly* poly,
+				   const unsigned int linkIdx, float* left, float* right)
+{
+	const dtLink& link = tile->links[linkIdx];
+	if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		dtGetTileVertex(tile, poly->verts[link.edge], left);
+		dtVcopy(right, left);
+		return;
+	}
+
+	const dtMeshTile* toTile = 0;
+	const dtPoly* toPoly = 0;
+	nav->getTileAndPolyByRefUnsafe(link.ref, &toTile, &toPoly);
+	if (toPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		int v = 0;
+		for (unsigned int i = toPoly->firstLink; i != DT_NULL_LINK; i = toTile->links[i].next)
+		{
+			if (toTile->links[i].ref == ref)
+			{
+				v = toTile->links[i].edge;
+				break;
+			}
+		}
+		dtGetTileVertex(toTile, toPoly->verts[v], left);
+		dtVcopy(right, left);
+		return;
+	}
+
+	if (tile->linkPortals)
+	{
+		const float* portal = &tile->linkPortals[linkIdx*6];
+		dtVcopy(left, portal);
+		dtVcopy(right, portal+3);
+		return;
+	}
+
+	float v0[3], v1[3];
+	dtGetTileVertex(tile, poly->verts[link.edge], v0);
+	dtGetTileVertex(tile, poly->verts[(link.edge+1) % (int)poly->vertCount], v1);
+	if (link.side != 0xff && (link.bmin != 0 || link.bmax != 255))
+	{
+		const float s = 1.0f/255.0f;
+		dtVlerp(left, v0, v1, link.bmin*s);
+		dtVlerp(right, v0, v1, link.bmax*s);
+	}
+	else
+	{
+		dtVcopy(left, v0);
+		dtVcopy(right, v1);
+	}
+}
+
+// A binary min-heap of portals keyed by their distance.
+struct PortalHeap
+{
+	int* items;
+	int* pos;			// The heap position of each portal, -1 if not in the heap.
+	const float* dists;
+	int count;
+
+	void push(const int v)
+	{
+		pos[v] = count;
+		items[count++] = v;
+		up(pos[v]);
+	}
+
+	int pop()
+	{
+		const int top = items[0];
+		pos[top] = -1;
+		count--;
+		if (count > 0)
+		{
+			items[0] = items[count];
+			pos[items[0]] = 0;
+			down(0);
+		}
+		return top;
+	}
+
+	void up(int i)
+	{
+		const int v = items[i];
+		while (i > 0)
+		{
+			const int parent = (i-1) / 2;
+			if (dists[items[parent]] <= dists[v])
+				break;
+			items[i] = items[parent];
+			pos[items[i]] = i;
+			i = parent;
+		}
+		items[i] = v;
+		pos[v] = i;
+	}
+
+	void down(int i)
+	{
+		const int v = items[i];
+		for (;;)
+		{
+			int child = i*2 + 1;
+			if (child >= count)
+				break;
+			if (child+1 < count && dists[items[child+1]] < dists[items[child]])
+				child++;
+			if (dists[v] <= dists[items[child]])
+				break;
+			items[i] = items[child];
+			pos[items[i]] = i;
+			i = child;
+		}
+		items[i] = v;
+		pos[v] = i;
+	}
+};
+
+// The portal graph of the whole navigation mesh. The nodes are the links, and every
+// two links touching the same polygon are connected by the distance of their portal midpoints.
+struct PortalGraph
+{
+	int* polyBase;			// The index of the first polygon of each tile, -1 if the tile is not used. [Size: maxTiles]
+	int* linkBase;			// The index of the first link of each tile. [Size: maxTiles]
+	float* mids;			// The portal midpoint of each link. [(x, y, z) * linkCount]
+	int* linkPolys;			// The two polygons each link touches, -1 if the link is not used. [2 * linkCount]
+	int* polyLinks;			// The links touching each polygon, starting at polyLinkStart.
+	int* polyLinkStart;		// [Size: polyCount + 1]
+	int polyCount;
+	int linkCount;
+
+	float* dists;			// The distance of each link in the current search. [Size: linkCount]
+	PortalHeap heap;
+	float* polyMin;			// The shortest distance to each polygon. [Size: polyCount]
+	float* polyMax;			// The longest distance to each polygon. [Size: polyCount]
+};
+
+void freeGraph(PortalGraph& graph)
+{
+	dtFree(graph.polyBase);
+	dtFree(graph.linkBase);
+	dtFree(graph.mids);
+	dtFree(graph.linkPolys);
+	dtFree(graph.polyLinks);
+	dtFree(graph.polyLinkStart);
+	dtFree(graph.dists);
+	dtFree(graph.heap.items);
+	dtFree(graph.heap.pos);
+	dtFree(graph.polyMin);
+	dtFree(graph.polyMax);
+	memset(&graph, 0, sizeof(PortalGraph));
+}
+
+bool isTileUsed(const dtMeshTile* tile)
+{
+	return tile->header && !(tile->flags & DT_TILE_RETIRED);
+}
+
+bool buildGraph(const dtNavMesh* nav, const int maxTiles, PortalGraph& graph)
+{
+	memset(&graph, 0, sizeof(PortalGraph));
+	graph.polyBase = (int*)dtAlloc(sizeof(int)*dtMax(maxTiles, 1), DT_ALLOC_TEMP);
+	graph.linkBase = (int*)dtAlloc(sizeof(int)*dtMax(maxTiles, 1), DT_ALLOC_TEMP);
+	if (!graph.polyBase || !graph.linkBase)
+		return false;
+	for (int i = 0; i < maxTiles; ++i)
+	{
+		const dtMeshTile* tile = nav->getTile(i);
+		graph.polyBase[i] = -1;
+		graph.linkBase[i] = graph.linkCount;
+		if (!isTileUsed(tile))
+			continue;
+		graph.polyBase[i] = graph.polyCount;
+		graph.polyCount += tile->header->polyCount;
+		graph.linkCount += tile->linkCapacity;
+	}
+
+	const int linkCount = dtMax(graph.linkCount, 1);
+	const int polyCount = dtMax(graph.polyCount, 1);
+	graph.mids = (float*)dtAlloc(sizeof(float)*3*linkCount, DT_ALLOC_TEMP);
+	graph.linkPolys = (int*)dtAlloc(sizeof(int)*2*linkCount, DT_ALLOC_TEMP);
+	graph.polyLinks = (int*)dtAlloc(sizeof(int)*2*linkCount, DT_ALLOC_TEMP);
+	graph.polyLinkStart = (int*)dtAlloc(sizeof(int)*(polyCount+1), DT_ALLOC_TEMP);
+	graph.dists = (float*)dtAlloc(sizeof(float)*linkCount, DT_ALLOC_TEMP);
+	graph.heap.items = (int*)dtAlloc(sizeof(int)*linkCount, DT_ALLOC_TEMP);
+	graph.heap.pos = (int*)dtAlloc(sizeof(int)*linkCount, DT_ALLOC_TEMP);
+	graph.polyMin = (float*)dtAlloc(sizeof(float)*polyCount, DT_ALLOC_TEMP);
+	graph.polyMax = (float*)dtAlloc(sizeof(float)*polyCount, DT_ALLOC_TEMP);
+	if (!graph.mids || !graph.linkPolys || !graph.polyLinks || !graph.polyLinkStart || !graph.dists ||
+		!graph.heap.items || !graph.heap.pos || !graph.polyMin || !graph.polyMax)
+		return false;
+	graph.heap.dists = graph.dists;
+
+	for (int i = 0; i < graph.linkCount*2; ++i)
+		graph.linkPolys[i] = -1;
+	memset(graph.polyLinkStart, 0, sizeof(int)*(graph.polyCount+1));
+
+	for (int i = 0; i < maxTiles; ++i)
+	{
+		if (graph.polyBase[i] < 0)
+			continue;
+		const dtMeshTile* tile = nav->getTile(i);
+		const dtPolyRef base = nav->getPolyRefBase(tile);
+		for (int j = 0; j < tile->header->polyCount; ++j)
+		{
+			const dtPoly* poly = &tile->polys[j];
+			const int p = graph.polyBase[i] + j;
+			for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+			{
+				const dtPolyRef ref = tile->links[k].ref;
+				if (!ref)
+					continue;
+				const unsigned int it = nav->decodePolyIdTile(ref);
+				if ((int)it >= maxTiles || graph.polyBase[it] < 0)
+					continue;
+				const int q = graph.polyBase[it] + (int)nav->decodePolyIdPoly(ref);
+				const int g = graph.linkBase[i] + (int)k;
+				graph.linkPolys[g*2+0] = p;
+				graph.linkPolys[g*2+1] = q;
+				float left[3], right[3];
+				getLinkPortal(nav, base | (dtPolyRef)j, tile, poly, k, left, right);
+				dtVlerp(&graph.mids[g*3], left, right, 0.5f);
+				graph.polyLinkStart[p+1]++;
+				graph.polyLinkStart[q+1]++;
+			}
+		}
+	}
+
+	for (int i = 0; i < graph.polyCount; ++i)
+		graph.polyLinkStart[i+1] += graph.polyLinkStart[i];
+	// The start of each polygon is advanced while filling, and moved back after.
+	for (int g = 0; g < graph.linkCount; ++g)
+	{
+		if (graph.linkPolys[g*2] < 0)
+			continue;
+		graph.polyLinks[graph.polyLinkStart[graph.linkPolys[g*2+0]]++] = g;
+		graph.polyLinks[graph.polyLinkStart[graph.linkPolys[g*2+1]]++] = g;
+	}
+	for (int i = graph.polyCount; i > 0; --i)
+		graph.polyLinkStart[i] = graph.polyLinkStart[i-1];
+	graph.polyLinkStart[0] = 0;
+
+	return true;
+}
+
+// Finds the distances of all portals to the portals of a polygon, and the range of
+// the distances of every polygon.
+void findDistances(PortalGraph& graph, const int source)
+{
+	for (int i = 0; i < graph.linkCount; ++i)
+	{
+		graph.dists[i] = FLT_MAX;
+		graph.heap.pos[i] = -1;
+	}
+	graph.heap.count = 0;
+	for (int i = graph.polyLinkStart[source]; i < graph.polyLinkStart[source+1]; ++i)
+	{
+		const int g = graph.polyLinks[i];
+		if (graph.dists[g] == FLT_MAX)
+		{
+			graph.dists[g] = 0.0f;
+			graph.heap.push(g);
+		}
+	}
+
+	while (graph.heap.count > 0)
+	{
+		const int g = graph.heap.pop();
+		const float* mid = &graph.mids[g*3];
+		for (int side = 0; side < 2; ++side)
+		{
+			const int p = graph.linkPolys[g*2+side];
+			for (int i = graph.polyLinkStart[p]; i < graph.polyLinkStart[p+1]; ++i)
+			{
+				const int h = graph.polyLinks[i];
+				const float dist = graph.dists[g] + dtVdist(mid, &graph.mids[h*3]);
+				if (dist >= graph.dists[h])
+					continue;
+				const bool open = graph.dists[h] != FLT_MAX;
+				graph.dists[h] = dist;
+				if (open)
+					graph.heap.up(graph.heap.pos[h]);
+				else
+					graph.heap.push(h);
+			}
+		}
+	}
+
+	for (int i = 0; i < graph.polyCount; ++i)
+	{
+		graph.polyMin[i] = FLT_MAX;
+		graph.polyMax[i] = -FLT_MAX;
+	}
+	for (int g = 0; g < graph.linkCount; ++g)
+	{
+		const float dist = graph.dists[g];
+		if (graph.linkPolys[g*2] < 0 || dist == FLT_MAX)
+			continue;
+		for (int side = 0; side < 2; ++side)
+		{
+			const int p = graph.linkPolys[g*2+side];
+			graph.polyMin[p] = dtMin(graph.polyMin[p], dist);
+			graph.polyMax[p] = dtMax(graph.polyMax[p], dist);
+		}
+	}
+	for (int i = 0; i < graph.polyCount; ++i)
+	{
+		if (graph.polyMin[i] == FLT_MAX)
+			graph.polyMax[i] = FLT_MAX;
+	}
+}
+
+// Finds a polygon of the largest connected part of the graph, or -1 if there are no links.
+int findLargestPart(const PortalGraph& graph)
+{
+	int* parts = (int*)dtAlloc(sizeof(int)*dtMax(graph.polyCount, 1)*2, DT_ALLOC_TEMP);
+	if (!parts)
+		return -1;
+	int* stack = parts + graph.polyCount;
+	for (int i = 0; i < graph.polyCount; ++i)
+		parts[i] = -1;
+
+	int best = -1;
+	int bestSize = 0;
+	for (int i = 0; i < graph.polyCount; ++i)
+	{
+		if (parts[i] >= 0 || graph.polyLinkStart[i] == graph.polyLinkStart[i+1])
+			continue;
+		int size = 0;
+		int n = 0;
+		stack[n++] = i;
+		parts[i] = i;
+		while (n > 0)
+		{
+			const int p = stack[--n];
+			size++;
+			for (int j = graph.polyLinkStart[p]; j < graph.polyLinkStart[p+1]; ++j)
+			{
+				const int g = graph.polyLinks[j];
+				for (int side = 0; side < 2; ++side)
+				{
+					const int q = graph.linkPolys[g*2+side];
+					if (parts[q] >= 0)
+						continue;
+					parts[q] = i;
+					stack[n++] = q;
+				}
+			}
+		}
+		if (size > bestSize)
+		{
+			best = i;
+			bestSize = size;
+		}
+	}
+
+	dtFree(parts);
+	return best;
+}
+} // anonymous namespace
+
+dtNavMeshLandmarks::dtNavMeshLandmarks() :
+	m_nav(0),
+	m_tiles(0),
+	m_maxTiles(0),
+	m_landmarkCount(0)
+{
+	memset(m_landmarks, 0, sizeof(m_landmarks));
+}
+
+dtNavMeshLandmarks::~dtNavMeshLandmarks()
+{
+	for (int i = 0; i < m_maxTiles; ++i)
+		freeTile(m_tiles[i]);
+	dtFree(m_tiles);
+}
+
+/// @par
+///
+/// Must be the first function called after construction, before other
+/// functions are used. The landmarks are placed by the first call to #update.
+dtStatus dtNavMeshLandmarks::init(const dtNavMesh* nav, const int landmarkCount)
+{
+	if (!nav || landmarkCount <= 0 || landmarkCount > DT_MAX_LANDMARKS)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	// Only single init.
+	if (m_nav)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	m_nav = nav;
+	m_landmarkCount = landmarkCount;
+	m_tracker.init(nav, false);
+
+	m_maxTiles = nav->getMaxTiles();
+	m_tiles = (dtLandmarkTile*)dtAlloc(sizeof(dtLandmarkTile)*dtMax(m_maxTiles, 1), DT_ALLOC_PERM);
+	if (!m_tiles)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(m_tiles, 0, sizeof(dtLandmarkTile)*m_maxTiles);
+
+	return DT_SUCCESS;
+}
+
+const dtLandmarkTile* dtNavMeshLandmarks::getTile(int i) const
+{
+	if (i < 0 || i >= m_maxTiles)
+		return 0;
+	return &m_tiles[i];
+}
+
+const float* dtNavMeshLandmarks::getPolyDistances(dtPolyRef ref) const
+{
+	unsigned int salt, it, ip;
+	m_nav->decodePolyId(ref, salt, it, ip);
+	if ((int)it >= m_maxTiles)
+		return 0;
+	const dtLandmarkTile& ltile = m_tiles[it];
+	if (!ltile.dists || ltile.salt != salt || (int)ip >= ltile.polyCount)
+		return 0;
+	return &ltile.dists[ip*m_landmarkCount*2];
+}
+
+void dtNavMeshLandmarks::freeTile(dtLandmarkTile& ltile)
+{
+	dtFree(ltile.dists);
+	memset(&ltile, 0, sizeof(dtLandmarkTile));
+}
+
+/// @par
+///
+/// The distances are computed again for all tiles when tiles were added or
+/// replaced. (See: dtTileRefTracker)
+dtStatus dtNavMeshLandmarks::update(int* updatedTileCount)
+{
+	dtAssert(m_nav);
+
+	if (updatedTileCount)
+		*updatedTileCount = 0;
+
+	if (m_tracker.isUpToDate())
+		return DT_SUCCESS;
+
+	dtStatus status = m_tracker.update();
+	if (dtStatusFailed(status))
+		return status;
+	if (!dtGrowTileTable(m_tiles, m_maxTiles, m_tracker.getMaxTiles()))
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	m_maxTiles = dtMax(m_maxTiles, m_tracker.getMaxTiles());
+
+	// Removing tiles only makes paths longer, the distances of the remaining tiles
+	// stay lower bounds. Any added tile can make them shorter.
+	bool added = false;
+	for (int i = 0; i < m_tracker.getChangedTileCount(); ++i)
+	{
+		const int tileIndex = m_tracker.getChangedTile(i);
+		if (m_tracker.getTileRef(tileIndex))
+			added = true;
+		else
+			freeTile(m_tiles[tileIndex]);
+	}
+
+	if (added)
+	{
+		status = computeDistances(updatedTileCount);
+		if (dtStatusFailed(status))
+			return status;
+	}
+
+	m_tracker.commit();
+
+	return DT_SUCCESS;
+}
+
+dtStatus dtNavMeshLandmarks::computeDistances(int* updatedTileCount)
+{
+	// The old distances may be too long once tiles were added, and are dropped on failure.
+	PortalGraph graph;
+	float* farthest = 0;
+	if (buildGraph(m_nav, m_maxTiles, graph))
+		farthest = (float*)dtAlloc(sizeof(float)*dtMax(graph.polyCount, 1), DT_ALLOC_TEMP);
+	if (!farthest)
+	{
+		freeGraph(graph);
+		for (int i = 0; i < m_maxTiles; ++i)
+			freeTile(m_tiles[i]);
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+
+	// The distances are written to the tiles as they are computed.
+	int updated = 0;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		dtLandmarkTile& ltile = m_tiles[i];
+		if (graph.polyBase[i] < 0)
+		{
+			freeTile(ltile);
+			continue;
+		}
+		const dtMeshTile* tile = m_nav->getTile(i);
+		const dtTileRef ref = m_nav->getTileRef(tile);
+		const int polyCount = tile->header->polyCount;
+		if (ltile.ref != ref || ltile.polyCount != polyCount)
+		{
+			freeTile(ltile);
+			ltile.dists = (float*)dtAlloc(sizeof(float)*2*m_landmarkCount*dtMax(polyCount, 1), DT_ALLOC_PERM);
+			if (!ltile.dists)
+			{
+				dtFree(farthest);
+				freeGraph(graph);
+				for (int j = 0; j < m_maxTiles; ++j)
+					freeTile(m_tiles[j]);
+				return DT_FAILURE | DT_OUT_OF_MEMORY;
+			}
+			ltile.polyCount = polyCount;
+		}
+		updated++;
+		ltile.ref = ref;
+		ltile.salt = m_nav->decodePolyIdSalt((dtPolyRef)ref);
+		for (int j = 0; j < polyCount*m_landmarkCount*2; ++j)
+			ltile.dists[j] = FLT_MAX;
+	}
+
+	// Landmarks whose polygons were removed are placed again.
+	int sources[DT_MAX_LANDMARKS];
+	for (int k = 0; k < m_landmarkCount; ++k)
+	{
+		sources[k] = -1;
+		const dtPolyRef ref = m_landmarks[k];
+		if (!ref || !m_nav->isValidPolyRef(ref))
+			continue;
+		const unsigned int it = m_nav->decodePolyIdTile(ref);
+		if (graph.polyBase[it] < 0)
+			continue;
+		const int p = graph.polyBase[it] + (int)m_nav->decodePolyIdPoly(ref);
+		if (graph.polyLinkStart[p] != graph.polyLinkStart[p+1])
+			sources[k] = p;
+	}
+	for (int i = 0; i < graph.polyCount; ++i)
+		farthest[i] = FLT_MAX;
+	bool seeded = false;
+
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		for (int k = 0; k < m_landmarkCount; ++k)
+		{
+			// The kept landmarks first, then the placed ones.
+			if ((pass == 0) != (sources[k] >= 0))
+				continue;
+			if (pass == 1)
+			{
+				// The first landmark is placed as far as possible from a polygon of the
+				// largest part, the others as far as possible from the previous ones.
+				bool any = false;
+				for (int i = 0; i < m_landmarkCount; ++i)
+					any |= sources[i] >= 0;
+				if (!any)
+				{
+					const int seed = findLargestPart(graph);
+					if (seed < 0)
+						break;
+					findDistances(graph, seed);
+					for (int i = 0; i < graph.polyCount; ++i)
+						farthest[i] = graph.polyMin[i];
+					seeded = true;
+				}
+				int best = -1;
+				float bestDist = 0.0f;
+				for (int i = 0; i < graph.polyCount; ++i)
+				{
+					if (farthest[i] != FLT_MAX && farthest[i] > bestDist)
+					{
+						best = i;
+						bestDist = farthest[i];
+					}
+				}
+				if (best < 0)
+					break;
+				sources[k] = best;
+			}
+
+			// The distances from the seed are not a landmark and are replaced.
+			findDistances(graph, sources[k]);
+			for (int i = 0; i < graph.polyCount; ++i)
+				farthest[i] = seeded ? graph.polyMin[i] : dtMin(farthest[i], graph.polyMin[i]);
+			seeded = false;
+
+			for (int i = 0; i < m_maxTiles; ++i)
+			{
+				if (graph.polyBase[i] < 0)
+					continue;
+				dtLandmarkTile& ltile = m_tiles[i];
+				for (int j = 0; j < ltile.polyCount; ++j)
+				{
+					const int p = graph.polyBase[i] + j;
+					ltile.dists[(j*m_landmarkCount + k)*2+0] = graph.polyMin[p];
+					ltile.dists[(j*m_landmarkCount + k)*2+1] = graph.polyMax[p];
+				}
+			}
+		}
+	}
+
+	// Maps the landmark polygons back to their references.
+	for (int k = 0; k < m_landmarkCount; ++k)
+	{
+		m_landmarks[k] = 0;
+		if (sources[k] < 0)
+			continue;
+		for (int i = 0; i < m_maxTiles; ++i)
+		{
+			if (graph.polyBase[i] < 0 || sources[k] < graph.polyBase[i] || sources[k] >= graph.polyBase[i] + m_tiles[i].polyCount)
+				continue;
+			m_landmarks[k] = m_nav->getPolyRefBase(m_nav->getTile(i)) | (dtPolyRef)(sources[k] - graph.polyBase[i]);
+			break;
+		}
+	}
+
+	dtFree(farthest);
+	freeGraph(graph);
+
+	if (updatedTileCount)
+		*updatedTileCount = updated;
+
+	return DT_SUCCESS;
+}
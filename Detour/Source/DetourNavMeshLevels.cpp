@@ -0,0 +1,383 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#include <string.h>
+#include "DetourNavMeshLevels.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourCommon.h"
+#include "DetourMath.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+#include <new>
+
+dtNavMeshLevels* dtAllocNavMeshLevels()
+{
+	void* mem = dtAlloc(sizeof(dtNavMeshLevels), DT_ALLOC_PERM);
+	if (!mem) return 0;
+	return new(mem) dtNavMeshLevels;
+}
+
+void dtFreeNavMeshLevels(dtNavMeshLevels* levels)
+{
+	if (!levels) return;
+	levels->~dtNavMeshLevels();
+	dtFree(levels);
+}
+
+namespace
+{
+const int MAX_LAYERS = 32;
+
+// Adds the bounds to a list of boxes. [(bmin, bmax) * count]
+void addBox(float* boxes, int& count, const float* bmin, const float* bmax)
+{
+	dtVcopy(&boxes[count*6+0], bmin);
+	dtVcopy(&boxes[count*6+3], bmax);
+	count++;
+}
+} // anonymous namespace
+
+dtNavMeshLevels::dtNavMeshLevels() :
+	m_filter(0)
+{
+	for (int i = 0; i < 2; ++i)
+	{
+		m_levels[i].nav = 0;
+		m_levels[i].query = 0;
+		m_levels[i].tiles = 0;
+		m_levels[i].maxTiles = 0;
+	}
+	dtVset(m_halfExtents, 0, 0, 0);
+}
+
+dtNavMeshLevels::~dtNavMeshLevels()
+{
+	for (int i = 0; i < 2; ++i)
+	{
+		Level& level = m_levels[i];
+		for (int j = 0; j < level.maxTiles; ++j)
+			freeTile(level.tiles[j]);
+		dtFree(level.tiles);
+		dtFreeNavMeshQuery(level.query);
+	}
+}
+
+/// @par
+///
+/// Must be the first function called after construction, before other
+/// functions are used. The mappings are built by the first call to #update.
+///
+/// The half extents should cover the largest horizontal and vertical
+/// difference between the surfaces of the two levels, usually a few coarse
+/// cells horizontally and the climb height vertically.
+dtStatus dtNavMeshLevels::init(const dtNavMesh* fine, const dtNavMesh* coarse, const float* halfExtents,
+							   const dtQueryFilter* filter)
+{
+	if (!fine || !coarse || fine == coarse || !halfExtents || !filter)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	// Only single init.
+	if (m_levels[FINE].nav)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	m_levels[FINE].nav = fine;
+	m_levels[COARSE].nav = coarse;
+	dtVcopy(m_halfExtents, halfExtents);
+	m_filter = filter;
+
+	for (int i = 0; i < 2; ++i)
+	{
+		Level& level = m_levels[i];
+		// The queries only look up polygons, they do not need search nodes.
+		level.query = dtAllocNavMeshQuery();
+		if (!level.query)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		const dtStatus status = level.query->init(level.nav, 1);
+		if (dtStatusFailed(status))
+			return status;
+		level.tracker.init(level.nav, false);
+	}
+
+	return DT_SUCCESS;
+}
+
+const dtNavMeshLevelTile* dtNavMeshLevels::getTile(const int level, int i) const
+{
+	if (i < 0 || i >= m_levels[level].maxTiles)
+		return 0;
+	return &m_levels[level].tiles[i];
+}
+
+void dtNavMeshLevels::freeTile(dtNavMeshLevelTile& ltile)
+{
+	dtFree(ltile.refs);
+	memset(&ltile, 0, sizeof(dtNavMeshLevelTile));
+}
+
+bool dtNavMeshLevels::buildTile(const dtMeshTile* tile, const Level& other, dtNavMeshLevelTile& ltile)
+{
+	dtVcopy(ltile.bmin, tile->header->bmin);
+	dtVcopy(ltile.bmax, tile->header->bmax);
+
+	const int polyCount = tile->header->polyCount;
+	if (!polyCount)
+		return true;
+
+	ltile.refs = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*polyCount, DT_ALLOC_PERM);
+	if (!ltile.refs)
+		return false;
+	ltile.polyCount = polyCount;
+
+	for (int i = 0; i < polyCount; ++i)
+	{
+		const dtPoly* p = &tile->polys[i];
+		ltile.refs[i] = 0;
+		if (p->getType() != DT_POLYTYPE_GROUND)
+			continue;
+
+		float center[3] = { 0, 0, 0 };
+		for (int j = 0; j < p->vertCount; ++j)
+		{
+			float v[3];
+			dtGetTileVertex(tile, p->verts[j], v);
+			dtVadd(center, center, v);
+		}
+		dtVscale(center, center, 1.0f / (float)p->vertCount);
+
+		other.query->findNearestPoly(center, m_halfExtents, m_filter, &ltile.refs[i], 0);
+	}
+
+	return true;
+}
+
+/// @par
+///
+/// The tiles which were added, removed or replaced on either level are mapped
+/// again, along with the tiles of the other level they overlap.
+/// (See: dtTileRefTracker)
+dtStatus dtNavMeshLevels::update(int* updatedTileCount)
+{
+	dtAssert(m_levels[FINE].nav);
+
+	if (updatedTileCount)
+		*updatedTileCount = 0;
+
+	if (m_levels[FINE].tracker.isUpToDate() && m_levels[COARSE].tracker.isUpToDate())
+		return DT_SUCCESS;
+
+	for (int i = 0; i < 2; ++i)
+	{
+		Level& level = m_levels[i];
+		const dtStatus status = level.tracker.update();
+		if (dtStatusFailed(status))
+			return status;
+		if (!dtGrowTileTable(level.tiles, level.maxTiles, level.tracker.getMaxTiles()))
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		level.maxTiles = dtMax(level.maxTiles, level.tracker.getMaxTiles());
+	}
+
+	unsigned char* dirty[2] = { 0, 0 };
+	float* boxes[2] = { 0, 0 };
+	int boxCount[2] = { 0, 0 };
+	for (int i = 0; i < 2; ++i)
+	{
+		const int maxTiles = dtMax(m_levels[i].maxTiles, 1);
+		dirty[i] = (unsigned char*)dtAlloc(sizeof(unsigned char)*maxTiles, DT_ALLOC_TEMP);
+		boxes[i] = (float*)dtAlloc(sizeof(float)*maxTiles*2*6, DT_ALLOC_TEMP);
+	}
+	if (!dirty[0] || !dirty[1] || !boxes[0] || !boxes[1])
+	{
+		for (int i = 0; i < 2; ++i)
+		{
+			dtFree(dirty[i]);
+			dtFree(boxes[i]);
+		}
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+
+	// Find the areas the changed tiles covered before and after the change.
+	for (int i = 0; i < 2; ++i)
+	{
+		const Level& level = m_levels[i];
+		memset(dirty[i], 0, sizeof(unsigned char)*level.maxTiles);
+		for (int j = 0; j < level.tracker.getChangedTileCount(); ++j)
+		{
+			const int tileIndex = level.tracker.getChangedTile(j);
+			const dtTileRef ref = level.tracker.getTileRef(tileIndex);
+			const dtNavMeshLevelTile& ltile = level.tiles[tileIndex];
+			dirty[i][tileIndex] = 1;
+			if (ltile.ref)
+				addBox(boxes[i], boxCount[i], ltile.bmin, ltile.bmax);
+			if (ref)
+			{
+				const dtMeshTile* tile = level.nav->getTile(tileIndex);
+				addBox(boxes[i], boxCount[i], tile->header->bmin, tile->header->bmax);
+			}
+		}
+	}
+
+	// The polygons of the tiles overlapping a changed area of the other level may map to different polygons now.
+	for (int i = 0; i < 2; ++i)
+	{
+		const Level& level = m_levels[i];
+		const int other = 1 - i;
+		for (int j = 0; j < boxCount[other]; ++j)
+		{
+			float bmin[3], bmax[3];
+			dtVsub(bmin, &boxes[other][j*6+0], m_halfExtents);
+			dtVadd(bmax, &boxes[other][j*6+3], m_halfExtents);
+			int minx, miny, maxx, maxy;
+			level.nav->calcTileLoc(bmin, &minx, &miny);
+			level.nav->calcTileLoc(bmax, &maxx, &maxy);
+			const dtMeshTile* neis[MAX_LAYERS];
+			for (int y = miny; y <= maxy; ++y)
+			{
+				for (int x = minx; x <= maxx; ++x)
+				{
+					const int nneis = level.nav->getTilesAt(x, y, neis, MAX_LAYERS);
+					for (int k = 0; k < nneis; ++k)
+					{
+						if (dtOverlapBounds(bmin, bmax, neis[k]->header->bmin, neis[k]->header->bmax))
+							dirty[i][level.nav->decodePolyIdTile(level.nav->getTileRef(neis[k]))] = 1;
+					}
+				}
+			}
+		}
+	}
+
+	dtStatus status = DT_SUCCESS;
+	int updated = 0;
+	for (int i = 0; i < 2; ++i)
+	{
+		Level& level = m_levels[i];
+		for (int j = 0; j < level.maxTiles; ++j)
+		{
+			if (!dirty[i][j])
+				continue;
+			const dtMeshTile* tile = level.nav->getTile(j);
+			const dtTileRef ref = level.tracker.getTileRef(j);
+			dtNavMeshLevelTile& ltile = level.tiles[j];
+
+			freeTile(ltile);
+			updated++;
+			if (!ref)
+				continue;
+			if (!buildTile(tile, m_levels[1 - i], ltile))
+			{
+				freeTile(ltile);
+				status = DT_FAILURE | DT_OUT_OF_MEMORY;
+				continue;
+			}
+			ltile.ref = ref;
+		}
+	}
+
+	for (int i = 0; i < 2; ++i)
+	{
+		dtFree(dirty[i]);
+		dtFree(boxes[i]);
+	}
+
+	if (dtStatusSucceed(status))
+	{
+		m_levels[FINE].tracker.commit();
+		m_levels[COARSE].tracker.commit();
+	}
+
+	if (updatedTileCount)
+		*updatedTileCount = updated;
+
+	return status;
+}
+
+dtPolyRef dtNavMeshLevels::getMappedPoly(const int level, dtPolyRef ref) const
+{
+	const dtNavMesh* nav = m_levels[level].nav;
+	if (!nav || !nav->isValidPolyRef(ref))
+		return 0;
+	const unsigned int tileIndex = nav->decodePolyIdTile(ref);
+	const unsigned int polyIndex = nav->decodePolyIdPoly(ref);
+	if ((int)tileIndex >= m_levels[level].maxTiles)
+		return 0;
+	const dtNavMeshLevelTile& ltile = m_levels[level].tiles[tileIndex];
+	// The mapping of the tile has not been built yet.
+	if (ltile.ref != nav->getTileRef(nav->getTile((int)tileIndex)) || (int)polyIndex >= ltile.polyCount)
+		return 0;
+	return ltile.refs[polyIndex];
+}
+
+/// @par
+///
+/// The location is first looked up on the mapped polygon and on its
+/// neighbours, and only if it is over none of them with a nearest polygon
+/// search on the other level.
+dtStatus dtNavMeshLevels::findLocation(const int level, dtPolyRef ref, const float* pos,
+									   dtPolyRef* outRef, float* outPos) const
+{
+	dtAssert(m_levels[FINE].nav);
+
+	if (!pos || !dtVisfinite(pos) || !outRef || !outPos)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*outRef = 0;
+
+	const Level& other = m_levels[1 - level];
+	const dtPolyRef mapped = getMappedPoly(level, ref);
+	if (mapped)
+	{
+		const dtMeshTile* tile = 0;
+		const dtPoly* poly = 0;
+		other.nav->getTileAndPolyByRefUnsafe(mapped, &tile, &poly);
+
+		bool over = false;
+		float pt[3];
+		if (dtStatusSucceed(other.query->closestPointOnPoly(mapped, pos, pt, &over)) && over &&
+			dtMathFabsf(pt[1] - pos[1]) <= m_halfExtents[1])
+		{
+			*outRef = mapped;
+			dtVcopy(outPos, pt);
+			return DT_SUCCESS;
+		}
+
+		for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+		{
+			const dtPolyRef neiRef = tile->links[i].ref;
+			const dtMeshTile* neiTile = 0;
+			const dtPoly* neiPoly = 0;
+			other.nav->getTileAndPolyByRefUnsafe(neiRef, &neiTile, &neiPoly);
+			if (neiPoly->getType() != DT_POLYTYPE_GROUND || !m_filter->passFilter(neiRef, neiTile, neiPoly))
+				continue;
+			if (dtStatusSucceed(other.query->closestPointOnPoly(neiRef, pos, pt, &over)) && over &&
+				dtMathFabsf(pt[1] - pos[1]) <= m_halfExtents[1])
+			{
+				*outRef = neiRef;
+				dtVcopy(outPos, pt);
+				return DT_SUCCESS;
+			}
+		}
+	}
+
+	const dtStatus status = other.query->findNearestPoly(pos, m_halfExtents, m_filter, outRef, outPos);
+	if (dtStatusFailed(status))
+		return status;
+	if (!*outRef)
+		return DT_FAILURE;
+
+	return DT_SUCCESS;
+}
@@ -0,0 +1,208 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <string.h>
+#include "DetourNavMeshNeighbourhood.h"
+#include "DetourCommon.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+#include <new>
+
+dtNavMeshNeighbourhood* dtAllocNavMeshNeighbourhood()
+{
+	void* mem = dtAlloc(sizeof(dtNavMeshNeighbourhood), DT_ALLOC_PERM);
+	if (!mem) return 0;
+	return new(mem) dtNavMeshNeighbourhood;
+}
+
+void dtFreeNavMeshNeighbourhood(dtNavMeshNeighbourhood* neighbourhood)
+{
+	if (!neighbourhood) return;
+	neighbourhood->~dtNavMeshNeighbourhood();
+	dtFree(neighbourhood);
+}
+
+namespace
+{
+// Links per polygon the edge arrays are sized for, polygons on tile borders can link to several neighbours per edge.
+const int EDGES_PER_POLY = DT_VERTS_PER_POLYGON * 2;
+
+inline unsigned int hashNeighbourhoodRef(dtPolyRef a)
+{
+	// Fibonacci hashing of the low and high halves.
+	const unsigned int lo = (unsigned int)a;
+	const unsigned int hi = (unsigned int)((a >> 16) >> 16);
+	return (lo ^ (hi * 0x85ebca6bu)) * 0x9e3779b1u;
+}
+} // anonymous namespace
+
+dtNavMeshNeighbourhood::dtNavMeshNeighbourhood() :
+	m_current(0),
+	m_maxPolys(0),
+	m_maxEdges(0),
+	m_hashSize(0),
+	m_marks(0),
+	m_stamp(0),
+	m_results(0),
+	m_margin(0),
+	m_radius(-1.0f),
+	m_nav(0),
+	m_filter(0),
+	m_epoch(0),
+	m_generation(0),
+	m_searchCount(0),
+	m_reuseCount(0),
+	m_readCount(0)
+{
+	for (int i = 0; i < 2; ++i)
+	{
+		m_polys[i] = 0;
+		m_edges[i] = 0;
+		m_hash[i] = 0;
+		m_polyCount[i] = 0;
+		m_edgeCount[i] = 0;
+	}
+	dtVset(m_center, 0, 0, 0);
+}
+
+dtNavMeshNeighbourhood::~dtNavMeshNeighbourhood()
+{
+	for (int i = 0; i < 2; ++i)
+	{
+		dtFree(m_polys[i]);
+		dtFree(m_edges[i]);
+		dtFree(m_hash[i]);
+	}
+	dtFree(m_marks);
+	dtFree(m_results);
+}
+
+dtStatus dtNavMeshNeighbourhood::init(const int maxPolys, const float margin)
+{
+	if (maxPolys <= 0 || !(margin >= 0.0f))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	// Only single init.
+	if (m_maxPolys)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	m_maxPolys = maxPolys;
+	m_maxEdges = maxPolys * EDGES_PER_POLY;
+	m_hashSize = (int)dtNextPow2((unsigned int)maxPolys * 2);
+	for (int i = 0; i < 2; ++i)
+	{
+		m_polys[i] = (dtNeighbourhoodPoly*)dtAlloc(sizeof(dtNeighbourhoodPoly)*m_maxPolys, DT_ALLOC_PERM);
+		m_edges[i] = (dtNeighbourhoodEdge*)dtAlloc(sizeof(dtNeighbourhoodEdge)*m_maxEdges, DT_ALLOC_PERM);
+		m_hash[i] = (int*)dtAlloc(sizeof(int)*m_hashSize, DT_ALLOC_PERM);
+		if (!m_polys[i] || !m_edges[i] || !m_hash[i])
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		memset(m_hash[i], 0xff, sizeof(int)*m_hashSize);
+	}
+	m_marks = (unsigned int*)dtAlloc(sizeof(unsigned int)*m_maxPolys, DT_ALLOC_PERM);
+	m_results = (int*)dtAlloc(sizeof(int)*m_maxPolys, DT_ALLOC_PERM);
+	if (!m_marks || !m_results)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(m_marks, 0, sizeof(unsigned int)*m_maxPolys);
+	m_margin = margin;
+
+	return DT_SUCCESS;
+}
+
+void dtNavMeshNeighbourhood::reset()
+{
+	m_radius = -1.0f;
+	m_nav = 0;
+	m_filter = 0;
+	if (m_polyCount[m_current])
+	{
+		memset(m_hash[m_current], 0xff, sizeof(int)*m_hashSize);
+		m_polyCount[m_current] = 0;
+		m_edgeCount[m_current] = 0;
+	}
+}
+
+int dtNavMeshNeighbourhood::findPoly(const int set, const dtPolyRef ref) const
+{
+	if (!m_hashSize)
+		return -1;
+	const unsigned int mask = (unsigned int)m_hashSize - 1;
+	const int* hash = m_hash[set];
+	for (unsigned int h = hashNeighbourhoodRef(ref) & mask; hash[h] != -1; h = (h + 1) & mask)
+	{
+		if (m_polys[set][hash[h]].ref == ref)
+			return hash[h];
+	}
+	return -1;
+}
+
+void dtNavMeshNeighbourhood::beginSearch()
+{
+	const int next = 1 - m_current;
+	if (m_polyCount[next])
+		memset(m_hash[next], 0xff, sizeof(int)*m_hashSize);
+	m_polyCount[next] = 0;
+	m_edgeCount[next] = 0;
+}
+
+dtNeighbourhoodPoly* dtNavMeshNeighbourhood::addPoly(const dtPolyRef ref, const int edgeCount)
+{
+	const int next = 1 - m_current;
+	if (m_polyCount[next] >= m_maxPolys || m_edgeCount[next] + edgeCount > m_maxEdges)
+		return 0;
+
+	const int idx = m_polyCount[next]++;
+	dtNeighbourhoodPoly* poly = &m_polys[next][idx];
+	poly->ref = ref;
+	poly->generation = 0;
+	poly->firstEdge = m_edgeCount[next];
+	poly->edgeCount = edgeCount;
+	m_edgeCount[next] += edgeCount;
+
+	// The set is at most half full, so there is always an empty slot.
+	const unsigned int mask = (unsigned int)m_hashSize - 1;
+	unsigned int h = hashNeighbourhoodRef(ref) & mask;
+	while (m_hash[next][h] != -1)
+		h = (h + 1) & mask;
+	m_hash[next][h] = idx;
+
+	return poly;
+}
+
+void dtNavMeshNeighbourhood::endSearch(const float* center, const float radius, const bool complete)
+{
+	// The links are resolved to the polygons of the set, so that the searches do not look them up.
+	const int next = 1 - m_current;
+	for (int i = 0; i < m_edgeCount[next]; ++i)
+		m_edges[next][i].index = findPoly(next, m_edges[next][i].ref);
+
+	m_current = next;
+	dtVcopy(m_center, center);
+	// An incomplete set does not hold every polygon in range, and cannot answer queries.
+	m_radius = complete ? radius : -1.0f;
+	m_searchCount++;
+}
+
+void dtNavMeshNeighbourhood::beginMarks()
+{
+	// The stamps are cleared when they wrap around.
+	if (++m_stamp == 0)
+	{
+		memset(m_marks, 0, sizeof(unsigned int)*m_maxPolys);
+		m_stamp = 1;
+	}
+}
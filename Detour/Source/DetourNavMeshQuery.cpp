@@ -18,8 +18,11 @@
 
 #include <float.h>
 #include <string.h>
+#include <stdlib.h>
 #include "DetourNavMeshQuery.h"
+#include "DetourFindPath.h"
 #include "DetourNavMesh.h"
+#include "DetourNavMeshNeighbourhood.h"
 #include "DetourNode.h"
 #include "DetourCommon.h"
 #include "DetourMath.h"
@@ -27,6 +30,17 @@
 #include "DetourAssert.h"
 #include <new>
 
+// Define DT_NO_SIMD to use the scalar wide BV node test and raycast packets on all platforms.
+#if defined(DT_NO_SIMD)
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DT_BVWIDE_SSE2
+#define DT_RAYCAST_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DT_BVWIDE_NEON
+#endif
+
 /// @class dtQueryFilter
 ///
 /// <b>The Default Implementation</b>
@@ -62,7 +76,8 @@
 
 dtQueryFilter::dtQueryFilter() :
 	m_includeFlags(0xffff),
-	m_excludeFlags(0)
+	m_excludeFlags(0),
+	m_agentRadius(0.0f)
 {
 	for (int i = 0; i < DT_MAX_AREAS; ++i)
 		m_areaCost[i] = 1.0f;
@@ -84,24 +99,37 @@ float dtQueryFilter::getCost(const float* pa, const float* pb,
 	return dtVdist(pa, pb) * m_areaCost[curPoly->getArea()];
 }
 #else
-inline bool dtQueryFilter::passFilter(const dtPolyRef /*ref*/,
-									  const dtMeshTile* /*tile*/,
-									  const dtPoly* poly) const
+// Not declared inline, other Detour modules such as dtNavMeshHierarchy call these too.
+// The calls in this file are still inlined.
+bool dtQueryFilter::passFilter(const dtPolyRef /*ref*/,
+							   const dtMeshTile* /*tile*/,
+							   const dtPoly* poly) const
 {
 	return (poly->flags & m_includeFlags) != 0 && (poly->flags & m_excludeFlags) == 0;
 }
 
-inline float dtQueryFilter::getCost(const float* pa, const float* pb,
-									const dtPolyRef /*prevRef*/, const dtMeshTile* /*prevTile*/, const dtPoly* /*prevPoly*/,
-									const dtPolyRef /*curRef*/, const dtMeshTile* /*curTile*/, const dtPoly* curPoly,
-									const dtPolyRef /*nextRef*/, const dtMeshTile* /*nextTile*/, const dtPoly* /*nextPoly*/) const
+float dtQueryFilter::getCost(const float* pa, const float* pb,
+							 const dtPolyRef /*prevRef*/, const dtMeshTile* /*prevTile*/, const dtPoly* /*prevPoly*/,
+							 const dtPolyRef /*curRef*/, const dtMeshTile* /*curTile*/, const dtPoly* curPoly,
+							 const dtPolyRef /*nextRef*/, const dtMeshTile* /*nextTile*/, const dtPoly* /*nextPoly*/) const
 {
 	return dtVdist(pa, pb) * m_areaCost[curPoly->getArea()];
 }
 #endif	
 	
-static const float H_SCALE = 0.999f; // Search heuristic scale.
+static const float H_SCALE = DT_HEURISTIC_SCALE; // Search heuristic scale.
+static const int DT_MAX_SEARCH_ITERATIONS = 0x10000; // Nodes expanded between the status checks of a search.
 
+void dtAddQueryStats(dtQueryStats* stats, const dtQueryStats* other)
+{
+	stats->queryCount += other->queryCount;
+	stats->nodesExpanded += other->nodesExpanded;
+	stats->maxNodesUsed = dtMax(stats->maxNodesUsed, other->maxNodesUsed);
+	stats->tilesTouched += other->tilesTouched;
+	stats->filterCalls += other->filterCalls;
+	stats->costCalls += other->costCalls;
+	stats->outOfNodesCount += other->outOfNodesCount;
+}
 
 dtNavMeshQuery* dtAllocNavMeshQuery()
 {
@@ -132,7 +160,8 @@ dtPolyQuery::~dtPolyQuery()
 ///
 /// Constant member functions can be used by multiple clients without side
 /// effects. (E.g. No change to the closed list. No impact on an in-progress
-/// sliced path query. Etc.)
+/// sliced path query. Etc.) When compiled with DT_QUERY_STATS defined, they
+/// do update the query statistics, which are not synchronized.
 /// 
 /// Walls and portals: A @e wall is a polygon segment that is 
 /// considered impassable. A @e portal is a passable segment between polygons.
@@ -141,25 +170,36 @@ dtPolyQuery::~dtPolyQuery()
 /// @see dtNavMesh, dtQueryFilter, #dtAllocNavMeshQuery(), #dtAllocNavMeshQuery()
 
 dtNavMeshQuery::dtNavMeshQuery() :
+	m_allocator(dtGetDefaultAllocator()),
 	m_nav(0),
+	m_landmarks(0),
 	m_tinyNodePool(0),
 	m_nodePool(0),
-	m_openList(0)
+	m_openList(0),
+	m_backNodePool(0),
+	m_backOpenList(0)
 {
 	memset(&m_query, 0, sizeof(dtQueryData));
+	memset(&m_stats, 0, sizeof(dtQueryStats));
 }
 
 dtNavMeshQuery::~dtNavMeshQuery()
 {
-	if (m_tinyNodePool)
-		m_tinyNodePool->~dtNodePool();
-	if (m_nodePool)
-		m_nodePool->~dtNodePool();
-	if (m_openList)
-		m_openList->~dtNodeQueue();
-	dtFree(m_tinyNodePool);
-	dtFree(m_nodePool);
-	dtFree(m_openList);
+	freeNodePools();
+}
+
+void dtNavMeshQuery::freeNodePools()
+{
+	dtFreeObject(m_allocator, m_tinyNodePool);
+	dtFreeObject(m_allocator, m_nodePool);
+	dtFreeObject(m_allocator, m_openList);
+	dtFreeObject(m_allocator, m_backNodePool);
+	dtFreeObject(m_allocator, m_backOpenList);
+	m_tinyNodePool = 0;
+	m_nodePool = 0;
+	m_openList = 0;
+	m_backNodePool = 0;
+	m_backOpenList = 0;
 }
 
 /// @par 
@@ -168,22 +208,41 @@ dtNavMeshQuery::~dtNavMeshQuery()
 /// functions are used.
 ///
 /// This function can be used multiple times.
-dtStatus dtNavMeshQuery::init(const dtNavMesh* nav, const int maxNodes)
+///
+/// The backward node pool is only needed for #DT_FINDPATH_BIDIRECTIONAL searches.
+/// Each direction of a bidirectional search typically visits far fewer nodes
+/// than a unidirectional search, so both pools can be smaller than the pool
+/// needed for the same paths without it.
+///
+/// The node pools are reused between calls that keep the same allocator.
+dtStatus dtNavMeshQuery::init(const dtNavMesh* nav, const int maxNodes, const int maxBackNodes,
+							  dtAllocator* allocator)
 {
 	if (maxNodes > DT_NULL_IDX || maxNodes > (1 << DT_NODE_PARENT_BITS) - 1)
 		return DT_FAILURE | DT_INVALID_PARAM;
+	if (maxBackNodes < 0 || maxBackNodes > DT_NULL_IDX || maxBackNodes > (1 << DT_NODE_PARENT_BITS) - 1)
+		return DT_FAILURE | DT_INVALID_PARAM;
 
+	if (nav != m_nav)
+		m_landmarks = 0;
 	m_nav = nav;
+
+	if (!allocator)
+		allocator = dtGetDefaultAllocator();
+	if (allocator != m_allocator)
+	{
+		freeNodePools();
+		m_allocator = allocator;
+	}
 	
 	if (!m_nodePool || m_nodePool->getMaxNodes() < maxNodes)
 	{
 		if (m_nodePool)
 		{
-			m_nodePool->~dtNodePool();
-			dtFree(m_nodePool);
+			dtFreeObject(m_allocator, m_nodePool);
 			m_nodePool = 0;
 		}
-		m_nodePool = new (dtAlloc(sizeof(dtNodePool), DT_ALLOC_PERM)) dtNodePool(maxNodes, dtNextPow2(maxNodes/4));
+		m_nodePool = new (m_allocator->alloc(sizeof(dtNodePool), DT_ALLOC_PERM)) dtNodePool(maxNodes, dtNextPow2(maxNodes/4), m_allocator);
 		if (!m_nodePool)
 			return DT_FAILURE | DT_OUT_OF_MEMORY;
 	}
@@ -194,7 +253,7 @@ dtStatus dtNavMeshQuery::init(const dtNavMesh* nav, const int maxNodes)
 	
 	if (!m_tinyNodePool)
 	{
-		m_tinyNodePool = new (dtAlloc(sizeof(dtNodePool), DT_ALLOC_PERM)) dtNodePool(64, 32);
+		m_tinyNodePool = new (m_allocator->alloc(sizeof(dtNodePool), DT_ALLOC_PERM)) dtNodePool(64, 32, m_allocator);
 		if (!m_tinyNodePool)
 			return DT_FAILURE | DT_OUT_OF_MEMORY;
 	}
@@ -207,11 +266,10 @@ dtStatus dtNavMeshQuery::init(const dtNavMesh* nav, const int maxNodes)
 	{
 		if (m_openList)
 		{
-			m_openList->~dtNodeQueue();
-			dtFree(m_openList);
+			dtFreeObject(m_allocator, m_openList);
 			m_openList = 0;
 		}
-		m_openList = new (dtAlloc(sizeof(dtNodeQueue), DT_ALLOC_PERM)) dtNodeQueue(maxNodes);
+		m_openList = new (m_allocator->alloc(sizeof(dtNodeQueue), DT_ALLOC_PERM)) dtNodeQueue(maxNodes, m_allocator);
 		if (!m_openList)
 			return DT_FAILURE | DT_OUT_OF_MEMORY;
 	}
@@ -219,10 +277,100 @@ dtStatus dtNavMeshQuery::init(const dtNavMesh* nav, const int maxNodes)
 	{
 		m_openList->clear();
 	}
+
+	if (m_backNodePool && m_backNodePool->getMaxNodes() < maxBackNodes)
+	{
+		dtFreeObject(m_allocator, m_backNodePool);
+		m_backNodePool = 0;
+		dtFreeObject(m_allocator, m_backOpenList);
+		m_backOpenList = 0;
+	}
+	if (!m_backNodePool && maxBackNodes > 0)
+	{
+		m_backNodePool = new (m_allocator->alloc(sizeof(dtNodePool), DT_ALLOC_PERM)) dtNodePool(maxBackNodes, dtNextPow2(maxBackNodes/4), m_allocator);
+		if (!m_backNodePool)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		m_backOpenList = new (m_allocator->alloc(sizeof(dtNodeQueue), DT_ALLOC_PERM)) dtNodeQueue(maxBackNodes, m_allocator);
+		if (!m_backOpenList)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+	else if (m_backNodePool)
+	{
+		m_backNodePool->clear();
+		m_backOpenList->clear();
+	}
 	
 	return DT_SUCCESS;
 }
 
+void dtNavMeshQuery::resetStats()
+{
+	memset(&m_stats, 0, sizeof(dtQueryStats));
+}
+
+void dtNavMeshQuery::getMemStats(dtNavMeshQueryMemStats* stats) const
+{
+	memset(stats, 0, sizeof(dtNavMeshQueryMemStats));
+	stats->query = sizeof(dtNavMeshQuery);
+	if (m_nodePool)
+		stats->nodePool = (size_t)m_nodePool->getMemUsed();
+	if (m_tinyNodePool)
+		stats->tinyNodePool = (size_t)m_tinyNodePool->getMemUsed();
+	if (m_openList)
+		stats->openList = (size_t)m_openList->getMemUsed();
+	if (m_backNodePool)
+		stats->backSearch += (size_t)m_backNodePool->getMemUsed();
+	if (m_backOpenList)
+		stats->backSearch += (size_t)m_backOpenList->getMemUsed();
+	stats->total = stats->query + stats->nodePool + stats->tinyNodePool + stats->openList + stats->backSearch;
+}
+
+size_t dtNavMeshQuery::getMemUsed() const
+{
+	dtNavMeshQueryMemStats stats;
+	getMemStats(&stats);
+	return stats.total;
+}
+
+/// @par
+///
+/// The landmarks are used by all path searches, including the sliced and the
+/// templated ones. They must be updated after tiles were added, since the
+/// distances may be too long for the bound to be valid until then. They are
+/// unset when the query is initialized with another navigation mesh.
+dtStatus dtNavMeshQuery::setLandmarks(const dtNavMeshLandmarks* landmarks)
+{
+	if (landmarks && landmarks->getAttachedNavMesh() != m_nav)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	m_landmarks = landmarks;
+	return DT_SUCCESS;
+}
+
+bool dtNavMeshQuery::getLandmarkDistances(dtPolyRef ref, float* dists) const
+{
+	if (!m_landmarks)
+		return false;
+	const float* src = m_landmarks->getPolyDistances(ref);
+	if (!src)
+		return false;
+	memcpy(dists, src, sizeof(float)*m_landmarks->getLandmarkCount()*2);
+	return true;
+}
+
+float dtNavMeshQuery::getLandmarkBound(const float* goalDists, dtPolyRef ref) const
+{
+	const float* dists = m_landmarks->getPolyDistances(ref);
+	return dists ? m_landmarks->getLowerBound(dists, goalDists) : 0.0f;
+}
+
+void dtNavMeshQuery::countQuery(const dtStatus status, const int nodeCount) const
+{
+	m_stats.queryCount++;
+	m_stats.maxNodesUsed = dtMax(m_stats.maxNodesUsed, nodeCount);
+	if (status & DT_OUT_OF_NODES)
+		m_stats.outOfNodesCount++;
+}
+
 dtStatus dtNavMeshQuery::findRandomPoint(const dtQueryFilter* filter, float (*frand)(),
 										 dtPolyRef* randomRef, float* randomPt) const
 {
@@ -237,7 +385,7 @@ dtStatus dtNavMeshQuery::findRandomPoint(const dtQueryFilter* filter, float (*fr
 	for (int i = 0; i < m_nav->getMaxTiles(); i++)
 	{
 		const dtMeshTile* t = m_nav->getTile(i);
-		if (!t || !t->header) continue;
+		if (!t || !t->header || (t->flags & DT_TILE_RETIRED)) continue;
 		
 		// Choose random tile using reservoir sampling.
 		const float area = 1.0f; // Could be tile area too.
@@ -270,9 +418,10 @@ dtStatus dtNavMeshQuery::findRandomPoint(const dtQueryFilter* filter, float (*fr
 		float polyArea = 0.0f;
 		for (int j = 2; j < p->vertCount; ++j)
 		{
-			const float* va = &tile->verts[p->verts[0]*3];
-			const float* vb = &tile->verts[p->verts[j-1]*3];
-			const float* vc = &tile->verts[p->verts[j]*3];
+			float va[3], vb[3], vc[3];
+			dtGetTileVertex(tile, p->verts[0], va);
+			dtGetTileVertex(tile, p->verts[j-1], vb);
+			dtGetTileVertex(tile, p->verts[j], vc);
 			polyArea += dtTriArea2D(va,vb,vc);
 		}
 
@@ -290,13 +439,14 @@ dtStatus dtNavMeshQuery::findRandomPoint(const dtQueryFilter* filter, float (*fr
 		return DT_FAILURE;
 
 	// Randomly pick point on polygon.
-	const float* v = &tile->verts[poly->verts[0]*3];
+	float v[3];
+	dtGetTileVertex(tile, poly->verts[0], v);
 	float verts[3*DT_VERTS_PER_POLYGON];
 	float areas[DT_VERTS_PER_POLYGON];
 	dtVcopy(&verts[0*3],v);
 	for (int j = 1; j < poly->vertCount; ++j)
 	{
-		v = &tile->verts[poly->verts[j]*3];
+		dtGetTileVertex(tile, poly->verts[j], v);
 		dtVcopy(&verts[j*3],v);
 	}
 	
@@ -378,9 +528,10 @@ dtStatus dtNavMeshQuery::findRandomPointAroundCircle(dtPolyRef startRef, const f
 			float polyArea = 0.0f;
 			for (int j = 2; j < bestPoly->vertCount; ++j)
 			{
-				const float* va = &bestTile->verts[bestPoly->verts[0]*3];
-				const float* vb = &bestTile->verts[bestPoly->verts[j-1]*3];
-				const float* vc = &bestTile->verts[bestPoly->verts[j]*3];
+				float va[3], vb[3], vc[3];
+				dtGetTileVertex(bestTile, bestPoly->verts[0], va);
+				dtGetTileVertex(bestTile, bestPoly->verts[j-1], vb);
+				dtGetTileVertex(bestTile, bestPoly->verts[j], vc);
 				polyArea += dtTriArea2D(va,vb,vc);
 			}
 			// Choose random polygon weighted by area, using reservoir sampling.
@@ -411,6 +562,9 @@ dtStatus dtNavMeshQuery::findRandomPointAroundCircle(dtPolyRef startRef, const f
 			// Skip invalid neighbours and do not follow back to parent.
 			if (!neighbourRef || neighbourRef == parentRef)
 				continue;
+			// Skip edges narrower than the agent.
+			if (!dtPassEdgeClearance(bestTile, bestPoly, link->edge, filter->getAgentRadius()))
+				continue;
 			
 			// Expand to neighbour
 			const dtMeshTile* neighbourTile = 0;
@@ -423,7 +577,7 @@ dtStatus dtNavMeshQuery::findRandomPointAroundCircle(dtPolyRef startRef, const f
 			
 			// Find edge and calc distance to the edge.
 			float va[3], vb[3];
-			if (!getPortalPoints(bestRef, bestPoly, bestTile, neighbourRef, neighbourPoly, neighbourTile, va, vb))
+			if (dtStatusFailed(getLinkPortalPoints(bestRef, bestPoly, bestTile, i, neighbourPoly, neighbourTile, va, vb)))
 				continue;
 			
 			// If the circle is not touching the next polygon, skip it.
@@ -473,13 +627,14 @@ dtStatus dtNavMeshQuery::findRandomPointAroundCircle(dtPolyRef startRef, const f
 		return DT_FAILURE;
 	
 	// Randomly pick point on polygon.
-	const float* v = &randomTile->verts[randomPoly->verts[0]*3];
+	float v[3];
+	dtGetTileVertex(randomTile, randomPoly->verts[0], v);
 	float verts[3*DT_VERTS_PER_POLYGON];
 	float areas[DT_VERTS_PER_POLYGON];
 	dtVcopy(&verts[0*3],v);
 	for (int j = 1; j < randomPoly->vertCount; ++j)
 	{
-		v = &randomTile->verts[randomPoly->verts[j]*3];
+		dtGetTileVertex(randomTile, randomPoly->verts[j], v);
 		dtVcopy(&verts[j*3],v);
 	}
 	
@@ -552,7 +707,7 @@ dtStatus dtNavMeshQuery::closestPointOnPolyBoundary(dtPolyRef ref, const float*
 	int nv = 0;
 	for (int i = 0; i < (int)poly->vertCount; ++i)
 	{
-		dtVcopy(&verts[nv*3], &tile->verts[poly->verts[i]*3]);
+		dtGetTileVertex(tile, poly->verts[i], &verts[nv*3]);
 		nv++;
 	}		
 	
@@ -600,24 +755,30 @@ dtStatus dtNavMeshQuery::getPolyHeight(dtPolyRef ref, const float* pos, float* h
 	if (!pos || !dtVisfinite2D(pos))
 		return DT_FAILURE | DT_INVALID_PARAM;
 
+	return getPolyHeight(tile, poly, pos, height)
+		? DT_SUCCESS
+		: DT_FAILURE | DT_INVALID_PARAM;
+}
+
+bool dtNavMeshQuery::getPolyHeight(const dtMeshTile* tile, const dtPoly* poly, const float* pos, float* height) const
+{
 	// We used to return success for offmesh connections, but the
 	// getPolyHeight in DetourNavMesh does not do this, so special
 	// case it here.
 	if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
 	{
-		const float* v0 = &tile->verts[poly->verts[0]*3];
-		const float* v1 = &tile->verts[poly->verts[1]*3];
+		float v0[3], v1[3];
+		dtGetTileVertex(tile, poly->verts[0], v0);
+		dtGetTileVertex(tile, poly->verts[1], v1);
 		float t;
 		dtDistancePtSegSqr2D(pos, v0, v1, t);
 		if (height)
 			*height = v0[1] + (v1[1] - v0[1])*t;
 
-		return DT_SUCCESS;
+		return true;
 	}
 
-	return m_nav->getPolyHeight(tile, poly, pos, height)
-		? DT_SUCCESS
-		: DT_FAILURE | DT_INVALID_PARAM;
+	return m_nav->getPolyHeight(tile, poly, pos, height);
 }
 
 class dtFindNearestPolyQuery : public dtPolyQuery
@@ -729,6 +890,353 @@ dtStatus dtNavMeshQuery::findNearestPoly(const float* center, const float* halfE
 	return DT_SUCCESS;
 }
 
+namespace
+{
+/// A point of a batched nearest polygon query, bucketed by a tile location it touches.
+struct dtNearestPolyEntry
+{
+	int x, y;
+	int point;
+	float cx, cz;
+};
+
+int compareNearestPolyEntries(const void* va, const void* vb)
+{
+	const dtNearestPolyEntry* a = (const dtNearestPolyEntry*)va;
+	const dtNearestPolyEntry* b = (const dtNearestPolyEntry*)vb;
+	// Group by tile in the same order as queryPolygons visits them,
+	// and sort the points within a tile for coherent traversal.
+	if (a->y != b->y) return a->y < b->y ? -1 : 1;
+	if (a->x != b->x) return a->x < b->x ? -1 : 1;
+	if (a->cz != b->cz) return a->cz < b->cz ? -1 : 1;
+	if (a->cx != b->cx) return a->cx < b->cx ? -1 : 1;
+	return a->point - b->point;
+}
+
+/// Quantizes the query box into the bounding volume space of the tile.
+inline void quantizeQueryBounds(const dtMeshTile* tile, const float* qmin, const float* qmax,
+								unsigned short* bmin, unsigned short* bmax)
+{
+	const float* tbmin = tile->header->bmin;
+	const float* tbmax = tile->header->bmax;
+	const float qfac = tile->header->bvQuantFactor;
+	const float minx = dtClamp(qmin[0], tbmin[0], tbmax[0]) - tbmin[0];
+	const float miny = dtClamp(qmin[1], tbmin[1], tbmax[1]) - tbmin[1];
+	const float minz = dtClamp(qmin[2], tbmin[2], tbmax[2]) - tbmin[2];
+	const float maxx = dtClamp(qmax[0], tbmin[0], tbmax[0]) - tbmin[0];
+	const float maxy = dtClamp(qmax[1], tbmin[1], tbmax[1]) - tbmin[1];
+	const float maxz = dtClamp(qmax[2], tbmin[2], tbmax[2]) - tbmin[2];
+	bmin[0] = (unsigned short)(qfac * minx) & 0xfffe;
+	bmin[1] = (unsigned short)(qfac * miny) & 0xfffe;
+	bmin[2] = (unsigned short)(qfac * minz) & 0xfffe;
+	bmax[0] = (unsigned short)(qfac * maxx + 1) | 1;
+	bmax[1] = (unsigned short)(qfac * maxy + 1) | 1;
+	bmax[2] = (unsigned short)(qfac * maxz + 1) | 1;
+}
+
+/// Tests the quantized query box against the children of a wide node.
+/// Returns a bit mask of the overlapping children.
+inline unsigned int overlapQuantBoundsWide(const unsigned short* bmin, const unsigned short* bmax,
+										   const dtBVWideNode* node)
+{
+#if defined(DT_BVWIDE_SSE2)
+	// There are no unsigned 16-bit compares in SSE2, so bias the values to signed range.
+	const __m128i bias = _mm_set1_epi16((short)0x8000);
+	__m128i out = _mm_setzero_si128();
+	for (int j = 0; j < 3; ++j)
+	{
+		const __m128i qmin = _mm_set1_epi16((short)(bmin[j] ^ 0x8000));
+		const __m128i qmax = _mm_set1_epi16((short)(bmax[j] ^ 0x8000));
+		const __m128i nmin = _mm_xor_si128(_mm_loadl_epi64((const __m128i*)node->bmin[j]), bias);
+		const __m128i nmax = _mm_xor_si128(_mm_loadl_epi64((const __m128i*)node->bmax[j]), bias);
+		out = _mm_or_si128(out, _mm_or_si128(_mm_cmpgt_epi16(qmin, nmax), _mm_cmpgt_epi16(nmin, qmax)));
+	}
+	const unsigned int mask = ~(unsigned int)_mm_movemask_epi8(_mm_packs_epi16(out, out)) & 0xf;
+#elif defined(DT_BVWIDE_NEON)
+	uint16x4_t out = vdup_n_u16(0);
+	for (int j = 0; j < 3; ++j)
+	{
+		const uint16x4_t qmin = vdup_n_u16(bmin[j]);
+		const uint16x4_t qmax = vdup_n_u16(bmax[j]);
+		const uint16x4_t nmin = vld1_u16(node->bmin[j]);
+		const uint16x4_t nmax = vld1_u16(node->bmax[j]);
+		out = vorr_u16(out, vorr_u16(vcgt_u16(qmin, nmax), vcgt_u16(nmin, qmax)));
+	}
+	static const unsigned short laneBits[4] = { 1, 2, 4, 8 };
+	uint16x4_t bits = vand_u16(vmvn_u16(out), vld1_u16(laneBits));
+	bits = vpadd_u16(bits, bits);
+	bits = vpadd_u16(bits, bits);
+	const unsigned int mask = vget_lane_u16(bits, 0);
+#else
+	unsigned int mask = 0;
+	for (int i = 0; i < DT_BVWIDE_WIDTH; ++i)
+	{
+		const bool overlap = bmin[0] <= node->bmax[0][i] && bmax[0] >= node->bmin[0][i] &&
+							 bmin[1] <= node->bmax[1][i] && bmax[1] >= node->bmin[1][i] &&
+							 bmin[2] <= node->bmax[2][i] && bmax[2] >= node->bmin[2][i];
+		mask |= overlap ? (1u << i) : 0;
+	}
+#endif
+	return mask & ((1u << node->childCount) - 1);
+}
+} // anonymous namespace
+
+void dtNavMeshQuery::updateNearestPoly(const dtMeshTile* tile, const dtPolyRef ref, const float* center,
+									   float& nearestDistSqr, dtPolyRef& nearestRef, float* nearestPt,
+									   bool& overPoly) const
+{
+	float closestPtPoly[3];
+	float diff[3];
+	bool posOverPoly = false;
+	float d;
+	closestPointOnPoly(ref, center, closestPtPoly, &posOverPoly);
+
+	// Same metric as dtFindNearestPolyQuery.
+	dtVsub(diff, center, closestPtPoly);
+	if (posOverPoly)
+	{
+		d = dtAbs(diff[1]) - tile->header->walkableClimb;
+		d = d > 0 ? d*d : 0;
+	}
+	else
+	{
+		d = dtVlenSqr(diff);
+	}
+
+	if (d < nearestDistSqr)
+	{
+		dtVcopy(nearestPt, closestPtPoly);
+		nearestDistSqr = d;
+		nearestRef = ref;
+		overPoly = posOverPoly;
+	}
+}
+
+/// @par
+///
+/// The result for each point is the same as calling #findNearestPoly for it.
+///
+/// The points are grouped by the tiles they touch, so that each tile is looked up
+/// once per batch, and nearby points within a tile share the bounding volume 
+/// tree traversal. This is considerably faster than calling #findNearestPoly 
+/// for each point when there are many points.
+///
+/// The result arrays must be able to hold @p count items.
+///
+dtStatus dtNavMeshQuery::findNearestPolys(const float* centers, const float* halfExtents, const int count,
+										  const dtQueryFilter* filter,
+										  dtPolyRef* nearestRefs, float* nearestPts, bool* isOverPoly) const
+{
+	dtAssert(m_nav);
+
+	if (!centers || !halfExtents || count < 0 || !filter || !nearestRefs)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	for (int i = 0; i < count; ++i)
+	{
+		if (!dtVisfinite(&centers[i*3]) || !dtVisfinite(&halfExtents[i*3]))
+			return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	// Count the tile locations touched by the points.
+	int nentries = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		float bmin[3], bmax[3];
+		dtVsub(bmin, &centers[i*3], &halfExtents[i*3]);
+		dtVadd(bmax, &centers[i*3], &halfExtents[i*3]);
+		int minx, miny, maxx, maxy;
+		m_nav->calcTileLoc(bmin, &minx, &miny);
+		m_nav->calcTileLoc(bmax, &maxx, &maxy);
+		nentries += (maxx - minx + 1) * (maxy - miny + 1);
+	}
+
+	dtNearestPolyEntry* entries = (dtNearestPolyEntry*)m_allocator->alloc(sizeof(dtNearestPolyEntry)*dtMax(nentries, 1), DT_ALLOC_TEMP);
+	float* bestDist = (float*)m_allocator->alloc(sizeof(float)*dtMax(count, 1), DT_ALLOC_TEMP);
+	float* bestPts = (float*)m_allocator->alloc(sizeof(float)*3*dtMax(count, 1), DT_ALLOC_TEMP);
+	bool* bestOver = (bool*)m_allocator->alloc(sizeof(bool)*dtMax(count, 1), DT_ALLOC_TEMP);
+	if (!entries || !bestDist || !bestPts || !bestOver)
+	{
+		m_allocator->free(entries);
+		m_allocator->free(bestDist);
+		m_allocator->free(bestPts);
+		m_allocator->free(bestOver);
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+
+	int n = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		nearestRefs[i] = 0;
+		bestDist[i] = FLT_MAX;
+		bestOver[i] = false;
+
+		float bmin[3], bmax[3];
+		dtVsub(bmin, &centers[i*3], &halfExtents[i*3]);
+		dtVadd(bmax, &centers[i*3], &halfExtents[i*3]);
+		int minx, miny, maxx, maxy;
+		m_nav->calcTileLoc(bmin, &minx, &miny);
+		m_nav->calcTileLoc(bmax, &maxx, &maxy);
+		for (int y = miny; y <= maxy; ++y)
+		{
+			for (int x = minx; x <= maxx; ++x)
+			{
+				dtNearestPolyEntry& e = entries[n++];
+				e.x = x;
+				e.y = y;
+				e.point = i;
+				e.cx = centers[i*3+0];
+				e.cz = centers[i*3+2];
+			}
+		}
+	}
+
+	qsort(entries, (size_t)nentries, sizeof(dtNearestPolyEntry), compareNearestPolyEntries);
+
+	static const int MAX_NEIS = 32;
+	const dtMeshTile* neis[MAX_NEIS];
+
+	// Points sharing a traversal of the bounding volume tree.
+	static const int MAX_GROUP = 8;
+	unsigned short gminx[MAX_GROUP], gminy[MAX_GROUP], gminz[MAX_GROUP];
+	unsigned short gmaxx[MAX_GROUP], gmaxy[MAX_GROUP], gmaxz[MAX_GROUP];
+
+	for (int first = 0; first < nentries; )
+	{
+		int last = first+1;
+		while (last < nentries && entries[last].x == entries[first].x && entries[last].y == entries[first].y)
+			last++;
+
+		const int nneis = m_nav->getTilesAt(entries[first].x, entries[first].y, neis, MAX_NEIS);
+		for (int j = 0; j < nneis; ++j)
+		{
+			const dtMeshTile* tile = neis[j];
+			const dtPolyRef base = m_nav->getPolyRefBase(tile);
+
+			for (int g = first; g < last; g += MAX_GROUP)
+			{
+				const int ng = dtMin(MAX_GROUP, last - g);
+
+				if (tile->bvTree)
+				{
+					// Quantize the query boxes and find the box enclosing them.
+					unsigned short umin[3] = { 0xffff, 0xffff, 0xffff };
+					unsigned short umax[3] = { 0, 0, 0 };
+					for (int k = 0; k < ng; ++k)
+					{
+						const int pi = entries[g+k].point;
+						float qmin[3], qmax[3];
+						dtVsub(qmin, &centers[pi*3], &halfExtents[pi*3]);
+						dtVadd(qmax, &centers[pi*3], &halfExtents[pi*3]);
+						unsigned short bmin[3], bmax[3];
+						quantizeQueryBounds(tile, qmin, qmax, bmin, bmax);
+						gminx[k] = bmin[0]; gminy[k] = bmin[1]; gminz[k] = bmin[2];
+						gmaxx[k] = bmax[0]; gmaxy[k] = bmax[1]; gmaxz[k] = bmax[2];
+						umin[0] = dtMin(umin[0], bmin[0]); umin[1] = dtMin(umin[1], bmin[1]); umin[2] = dtMin(umin[2], bmin[2]);
+						umax[0] = dtMax(umax[0], bmax[0]); umax[1] = dtMax(umax[1], bmax[1]); umax[2] = dtMax(umax[2], bmax[2]);
+					}
+
+					const dtBVNode* node = &tile->bvTree[0];
+					const dtBVNode* end = &tile->bvTree[tile->header->bvNodeCount];
+					while (node < end)
+					{
+						const bool overlap = dtOverlapQuantBounds(umin, umax, node->bmin, node->bmax);
+						const bool isLeafNode = node->i >= 0;
+
+						if (isLeafNode && overlap)
+						{
+							// Test the leaf against all boxes of the group in one go.
+							unsigned char hits[MAX_GROUP];
+							int nhits = 0;
+							for (int k = 0; k < ng; ++k)
+							{
+								hits[k] = (unsigned char)(gminx[k] <= node->bmax[0] && gmaxx[k] >= node->bmin[0] &&
+														  gminy[k] <= node->bmax[1] && gmaxy[k] >= node->bmin[1] &&
+														  gminz[k] <= node->bmax[2] && gmaxz[k] >= node->bmin[2]);
+								nhits += hits[k];
+							}
+
+							const dtPolyRef ref = base | (dtPolyRef)node->i;
+							if (nhits && filter->passFilter(ref, tile, &tile->polys[node->i]))
+							{
+								for (int k = 0; k < ng; ++k)
+								{
+									if (!hits[k])
+										continue;
+									const int pi = entries[g+k].point;
+									updateNearestPoly(tile, ref, &centers[pi*3], bestDist[pi], nearestRefs[pi], &bestPts[pi*3], bestOver[pi]);
+								}
+							}
+						}
+
+						if (overlap || isLeafNode)
+							node++;
+						else
+						{
+							const int escapeIndex = -node->i;
+							node += escapeIndex;
+						}
+					}
+				}
+				else
+				{
+					for (int i = 0; i < tile->header->polyCount; ++i)
+					{
+						const dtPoly* p = &tile->polys[i];
+						// Do not return off-mesh connection polygons.
+						if (p->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+							continue;
+						const dtPolyRef ref = base | (dtPolyRef)i;
+						if (!filter->passFilter(ref, tile, p))
+							continue;
+						// Calc polygon bounds.
+						float bmin[3], bmax[3];
+						float v[3];
+						dtGetTileVertex(tile, p->verts[0], v);
+						dtVcopy(bmin, v);
+						dtVcopy(bmax, v);
+						for (int k = 1; k < p->vertCount; ++k)
+						{
+							dtGetTileVertex(tile, p->verts[k], v);
+							dtVmin(bmin, v);
+							dtVmax(bmax, v);
+						}
+						for (int k = 0; k < ng; ++k)
+						{
+							const int pi = entries[g+k].point;
+							float qmin[3], qmax[3];
+							dtVsub(qmin, &centers[pi*3], &halfExtents[pi*3]);
+							dtVadd(qmax, &centers[pi*3], &halfExtents[pi*3]);
+							if (dtOverlapBounds(qmin, qmax, bmin, bmax))
+								updateNearestPoly(tile, ref, &centers[pi*3], bestDist[pi], nearestRefs[pi], &bestPts[pi*3], bestOver[pi]);
+						}
+					}
+				}
+			}
+		}
+
+		first = last;
+	}
+
+	// Only override the nearest point if a poly was found, like findNearestPoly.
+	for (int i = 0; i < count; ++i)
+	{
+		if (!nearestRefs[i])
+			continue;
+		if (nearestPts)
+			dtVcopy(&nearestPts[i*3], &bestPts[i*3]);
+		if (isOverPoly)
+			isOverPoly[i] = bestOver[i];
+	}
+
+	m_allocator->free(entries);
+	m_allocator->free(bestDist);
+	m_allocator->free(bestPts);
+	m_allocator->free(bestOver);
+
+	return DT_SUCCESS;
+}
+
 void dtNavMeshQuery::queryPolygonsInTile(const dtMeshTile* tile, const float* qmin, const float* qmax,
 										 const dtQueryFilter* filter, dtPolyQuery* query) const
 {
@@ -738,7 +1246,56 @@ void dtNavMeshQuery::queryPolygonsInTile(const dtMeshTile* tile, const float* qm
 	dtPoly* polys[batchSize];
 	int n = 0;
 
-	if (tile->bvTree)
+	if (tile->bvWideTree)
+	{
+		unsigned short bmin[3], bmax[3];
+		quantizeQueryBounds(tile, qmin, qmax, bmin, bmax);
+
+		// Traverse tree depth first. The stack holds the children still to visit,
+		// so that the polygons are visited in the same order as with the binary tree.
+		static const int MAX_STACK = 64;
+		int stack[MAX_STACK];
+		int nstack = 0;
+		stack[nstack++] = 0;
+		const dtPolyRef base = m_nav->getPolyRefBase(tile);
+		while (nstack > 0)
+		{
+			const int child = stack[--nstack];
+			if (child < 0)
+			{
+				const int i = -child - 1;
+				dtPolyRef ref = base | (dtPolyRef)i;
+				if (filter->passFilter(ref, tile, &tile->polys[i]))
+				{
+					polyRefs[n] = ref;
+					polys[n] = &tile->polys[i];
+
+					if (n == batchSize - 1)
+					{
+						query->process(tile, polys, polyRefs, batchSize);
+						n = 0;
+					}
+					else
+					{
+						n++;
+					}
+				}
+				continue;
+			}
+
+			const dtBVWideNode* node = &tile->bvWideTree[child];
+			const unsigned int mask = overlapQuantBoundsWide(bmin, bmax, node);
+			for (int i = DT_BVWIDE_WIDTH-1; i >= 0; --i)
+			{
+				if (mask & (1u << i))
+				{
+					dtAssert(nstack < MAX_STACK);
+					stack[nstack++] = node->child[i];
+				}
+			}
+		}
+	}
+	else if (tile->bvTree)
 	{
 		const dtBVNode* node = &tile->bvTree[0];
 		const dtBVNode* end = &tile->bvTree[tile->header->bvNodeCount];
@@ -814,12 +1371,13 @@ void dtNavMeshQuery::queryPolygonsInTile(const dtMeshTile* tile, const float* qm
 			if (!filter->passFilter(ref, tile, p))
 				continue;
 			// Calc polygon bounds.
-			const float* v = &tile->verts[p->verts[0]*3];
+			float v[3];
+			dtGetTileVertex(tile, p->verts[0], v);
 			dtVcopy(bmin, v);
 			dtVcopy(bmax, v);
 			for (int j = 1; j < p->vertCount; ++j)
 			{
-				v = &tile->verts[p->verts[j]*3];
+				dtGetTileVertex(tile, p->verts[j], v);
 				dtVmin(bmin, v);
 				dtVmax(bmax, v);
 			}
@@ -973,7 +1531,8 @@ dtStatus dtNavMeshQuery::queryPolygons(const float* center, const float* halfExt
 dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 								  const float* startPos, const float* endPos,
 								  const dtQueryFilter* filter,
-								  dtPolyRef* path, int* pathCount, const int maxPath) const
+								  dtPolyRef* path, int* pathCount, const int maxPath,
+								  const unsigned int options) const
 {
 	dtAssert(m_nav);
 	dtAssert(m_nodePool);
@@ -988,7 +1547,9 @@ dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 	if (!m_nav->isValidPolyRef(startRef) || !m_nav->isValidPolyRef(endRef) ||
 		!startPos || !dtVisfinite(startPos) ||
 		!endPos || !dtVisfinite(endPos) ||
-		!filter || !path || maxPath <= 0)
+		!filter || !path || maxPath <= 0 ||
+		(options & ~(DT_FINDPATH_ANY_ANGLE | DT_FINDPATH_BIDIRECTIONAL)) ||
+		((options & DT_FINDPATH_BIDIRECTIONAL) && ((options & DT_FINDPATH_ANY_ANGLE) || !m_backNodePool)))
 	{
 		return DT_FAILURE | DT_INVALID_PARAM;
 	}
@@ -999,169 +1560,64 @@ dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 		*pathCount = 1;
 		return DT_SUCCESS;
 	}
-	
-	m_nodePool->clear();
-	m_openList->clear();
-	
-	dtNode* startNode = m_nodePool->getNode(startRef);
-	dtVcopy(startNode->pos, startPos);
-	startNode->pidx = 0;
-	startNode->cost = 0;
-	startNode->total = dtVdist(startPos, endPos) * H_SCALE;
-	startNode->id = startRef;
-	startNode->flags = DT_NODE_OPEN;
-	m_openList->push(startNode);
-	
-	dtNode* lastBestNode = startNode;
-	float lastBestNodeCost = startNode->total;
-	
-	bool outOfNodes = false;
-	
-	while (!m_openList->empty())
+
+	if (options & DT_FINDPATH_ANY_ANGLE)
 	{
-		// Remove node from open list and put it in closed list.
-		dtNode* bestNode = m_openList->pop();
-		bestNode->flags &= ~DT_NODE_OPEN;
-		bestNode->flags |= DT_NODE_CLOSED;
-		
-		// Reached the goal, stop searching.
-		if (bestNode->id == endRef)
+		dtQueryData query;
+		memset(&query, 0, sizeof(dtQueryData));
+		query.startRef = startRef;
+		query.endRef = endRef;
+		dtVcopy(query.startPos, startPos);
+		dtVcopy(query.endPos, endPos);
+		query.filter = filter;
+		query.options = options;
+		query.raycastLimitSqr = FLT_MAX;
+		initSearch(query);
+
+		while (dtStatusInProgress(query.status))
+			expandSearch(query, DT_MAX_SEARCH_ITERATIONS, 0);
+		if (dtStatusFailed(query.status))
+			return query.status;
+
+		getShortcutPath(query, path, pathCount, maxPath);
+		const dtStatus details = query.status & DT_STATUS_DETAIL_MASK;
+		DT_QUERY_STAT(countQuery(details, m_nodePool->getNodeCount()));
+		return DT_SUCCESS | details;
+	}
+
+	if (options & DT_FINDPATH_BIDIRECTIONAL)
+	{
+		dtQueryData query;
+		memset(&query, 0, sizeof(dtQueryData));
+		query.startRef = startRef;
+		query.endRef = endRef;
+		dtVcopy(query.startPos, startPos);
+		dtVcopy(query.endPos, endPos);
+		query.filter = filter;
+		query.options = options;
+		initBidirectionalSearch(query);
+
+		while (!isBidirectionalSearchDone(query))
 		{
-			lastBestNode = bestNode;
-			break;
+			expandBidirectionalSearch(query, query.direction);
+			query.direction ^= 1;
 		}
-		
-		// Get current poly and tile.
-		// The API input has been checked already, skip checking internal data.
-		const dtPolyRef bestRef = bestNode->id;
-		const dtMeshTile* bestTile = 0;
-		const dtPoly* bestPoly = 0;
-		m_nav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
-		
-		// Get parent poly and tile.
-		dtPolyRef parentRef = 0;
-		const dtMeshTile* parentTile = 0;
-		const dtPoly* parentPoly = 0;
-		if (bestNode->pidx)
-			parentRef = m_nodePool->getNodeAtIdx(bestNode->pidx)->id;
-		if (parentRef)
-			m_nav->getTileAndPolyByRefUnsafe(parentRef, &parentTile, &parentPoly);
-		
-		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
-		{
-			dtPolyRef neighbourRef = bestTile->links[i].ref;
-			
-			// Skip invalid ids and do not expand back to where we came from.
-			if (!neighbourRef || neighbourRef == parentRef)
-				continue;
-			
-			// Get neighbour poly and tile.
-			// The API input has been checked already, skip checking internal data.
-			const dtMeshTile* neighbourTile = 0;
-			const dtPoly* neighbourPoly = 0;
-			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);			
-			
-			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
-				continue;
-
-			// deal explicitly with crossing tile boundaries
-			unsigned char crossSide = 0;
-			if (bestTile->links[i].side != 0xff)
-				crossSide = bestTile->links[i].side >> 1;
-
-			// get the node
-			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef, crossSide);
-			if (!neighbourNode)
-			{
-				outOfNodes = true;
-				continue;
-			}
-			
-			// If the node is visited the first time, calculate node position.
-			if (neighbourNode->flags == 0)
-			{
-				getEdgeMidPoint(bestRef, bestPoly, bestTile,
-								neighbourRef, neighbourPoly, neighbourTile,
-								neighbourNode->pos);
-			}
-
-			// Calculate cost and heuristic.
-			float cost = 0;
-			float heuristic = 0;
-			
-			// Special case for last node.
-			if (neighbourRef == endRef)
-			{
-				// Cost
-				const float curCost = filter->getCost(bestNode->pos, neighbourNode->pos,
-													  parentRef, parentTile, parentPoly,
-													  bestRef, bestTile, bestPoly,
-													  neighbourRef, neighbourTile, neighbourPoly);
-				const float endCost = filter->getCost(neighbourNode->pos, endPos,
-													  bestRef, bestTile, bestPoly,
-													  neighbourRef, neighbourTile, neighbourPoly,
-													  0, 0, 0);
-				
-				cost = bestNode->cost + curCost + endCost;
-				heuristic = 0;
-			}
-			else
-			{
-				// Cost
-				const float curCost = filter->getCost(bestNode->pos, neighbourNode->pos,
-													  parentRef, parentTile, parentPoly,
-													  bestRef, bestTile, bestPoly,
-													  neighbourRef, neighbourTile, neighbourPoly);
-				cost = bestNode->cost + curCost;
-				heuristic = dtVdist(neighbourNode->pos, endPos)*H_SCALE;
-			}
 
-			const float total = cost + heuristic;
-			
-			// The node is already in open list and the new result is worse, skip.
-			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
-				continue;
-			// The node is already visited and process, and the new result is worse, skip.
-			if ((neighbourNode->flags & DT_NODE_CLOSED) && total >= neighbourNode->total)
-				continue;
-			
-			// Add or update the node.
-			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
-			neighbourNode->id = neighbourRef;
-			neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
-			neighbourNode->cost = cost;
-			neighbourNode->total = total;
-			
-			if (neighbourNode->flags & DT_NODE_OPEN)
-			{
-				// Already in open, update node location.
-				m_openList->modify(neighbourNode);
-			}
-			else
-			{
-				// Put the node in open list.
-				neighbourNode->flags |= DT_NODE_OPEN;
-				m_openList->push(neighbourNode);
-			}
-			
-			// Update nearest node to target so far.
-			if (heuristic < lastBestNodeCost)
-			{
-				lastBestNodeCost = heuristic;
-				lastBestNode = neighbourNode;
-			}
+		dtStatus status;
+		if (query.meetNodes[0])
+		{
+			status = getPathToMeeting(query, path, pathCount, maxPath);
+		}
+		else
+		{
+			status = getPathToNode(query.lastBestNode, path, pathCount, maxPath) | DT_PARTIAL_RESULT;
 		}
+		status |= query.status & DT_OUT_OF_NODES;
+		DT_QUERY_STAT(countQuery(status, m_nodePool->getNodeCount() + m_backNodePool->getNodeCount()));
+		return status;
 	}
-
-	dtStatus status = getPathToNode(lastBestNode, path, pathCount, maxPath);
-
-	if (lastBestNode->id != endRef)
-		status |= DT_PARTIAL_RESULT;
-
-	if (outOfNodes)
-		status |= DT_OUT_OF_NODES;
 	
-	return status;
+	return findPath<dtQueryFilter>(startRef, endRef, startPos, endPos, filter, path, pathCount, maxPath);
 }
 
 dtStatus dtNavMeshQuery::getPathToNode(dtNode* endNode, dtPolyRef* path, int* pathCount, int maxPath) const
@@ -1204,6 +1660,257 @@ dtStatus dtNavMeshQuery::getPathToNode(dtNode* endNode, dtPolyRef* path, int* pa
 	return DT_SUCCESS;
 }
 
+/// Returns true if the polygon has a link to the specified polygon.
+static bool dtHasLinkTo(const dtMeshTile* tile, const dtPoly* poly, const dtPolyRef ref)
+{
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+	{
+		if (tile->links[i].ref == ref)
+			return true;
+	}
+	return false;
+}
+
+void dtNavMeshQuery::initBidirectionalSearch(dtQueryData& query) const
+{
+	m_nodePool->clear();
+	m_openList->clear();
+	m_backNodePool->clear();
+	m_backOpenList->clear();
+
+	// The forward search node costs are measured from the start position, and the
+	// backward search node costs to the end position.
+	dtNode* startNode = m_nodePool->getNode(query.startRef);
+	dtVcopy(startNode->pos, query.startPos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = dtVdist(query.startPos, query.endPos) * H_SCALE;
+	startNode->id = query.startRef;
+	startNode->flags = DT_NODE_OPEN;
+	m_openList->push(startNode);
+
+	dtNode* endNode = m_backNodePool->getNode(query.endRef);
+	dtVcopy(endNode->pos, query.endPos);
+	endNode->pidx = 0;
+	endNode->cost = 0;
+	endNode->total = dtVdist(query.startPos, query.endPos) * H_SCALE;
+	endNode->id = query.endRef;
+	endNode->flags = DT_NODE_OPEN;
+	m_backOpenList->push(endNode);
+
+	query.lastBestNode = startNode;
+	query.lastBestNodeCost = startNode->total;
+	query.meetNodes[0] = 0;
+	query.meetNodes[1] = 0;
+	query.meetCost = FLT_MAX;
+	query.direction = 0;
+	query.hasGoalDists[0] = getLandmarkDistances(query.endRef, query.goalDists[0]);
+	query.hasGoalDists[1] = getLandmarkDistances(query.startRef, query.goalDists[1]);
+}
+
+/// @par
+///
+/// The search stops when the best path through a meeting point costs no more than
+/// the lowest estimate left in either open list. Since any path still to be found
+/// has to pass through an open node of both searches, no cheaper path can exist.
+bool dtNavMeshQuery::isBidirectionalSearchDone(const dtQueryData& query) const
+{
+	if (m_openList->empty() || m_backOpenList->empty())
+		return true;
+	if (!query.meetNodes[0])
+		return false;
+	const float bound = dtMax(m_openList->top()->total, m_backOpenList->top()->total);
+	return query.meetCost <= bound;
+}
+
+/// @par
+///
+/// Both directions expand polygon links only when the neighbour links back,
+/// so that the backward search traverses the same graph as the forward search.
+/// As a result unidirectional off-mesh connections are not used.
+dtStatus dtNavMeshQuery::expandBidirectionalSearch(dtQueryData& query, const int direction) const
+{
+	dtNodePool* nodePool = direction ? m_backNodePool : m_nodePool;
+	dtNodeQueue* openList = direction ? m_backOpenList : m_openList;
+	dtNodePool* otherPool = direction ? m_nodePool : m_backNodePool;
+	const float* target = direction ? query.startPos : query.endPos;
+	const dtQueryFilter* filter = query.filter;
+
+	// Remove node from open list and put it in closed list.
+	dtNode* bestNode = openList->pop();
+	bestNode->flags &= ~DT_NODE_OPEN;
+	bestNode->flags |= DT_NODE_CLOSED;
+
+	const dtPolyRef bestRef = bestNode->id;
+	const dtMeshTile* bestTile = 0;
+	const dtPoly* bestPoly = 0;
+	if (dtStatusFailed(m_nav->getTileAndPolyByRef(bestRef, &bestTile, &bestPoly)))
+		return DT_FAILURE;
+
+	dtPolyRef parentRef = 0;
+	const dtMeshTile* parentTile = 0;
+	const dtPoly* parentPoly = 0;
+	if (bestNode->pidx)
+		parentRef = nodePool->getNodeAtIdx(bestNode->pidx)->id;
+	if (parentRef && dtStatusFailed(m_nav->getTileAndPolyByRef(parentRef, &parentTile, &parentPoly)))
+		return DT_FAILURE;
+
+	DT_QUERY_STAT(m_stats.nodesExpanded++);
+
+	for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+	{
+		const dtPolyRef neighbourRef = bestTile->links[i].ref;
+
+		// Skip invalid ids and do not expand back to where we came from.
+		if (!neighbourRef || neighbourRef == parentRef)
+			continue;
+		// Skip edges narrower than the agent.
+		if (!dtPassEdgeClearance(bestTile, bestPoly, bestTile->links[i].edge, filter->getAgentRadius()))
+			continue;
+
+		const dtMeshTile* neighbourTile = 0;
+		const dtPoly* neighbourPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
+
+		DT_QUERY_STAT(m_stats.filterCalls++);
+		if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+			continue;
+		if (!dtHasLinkTo(neighbourTile, neighbourPoly, bestRef))
+			continue;
+		DT_QUERY_STAT(m_stats.tilesTouched += neighbourTile != bestTile);
+
+		// Edge crossing point. The node position is only set on the first visit,
+		// the meeting cost below uses the actual crossing.
+		float mid[3];
+		if (dtStatusFailed(getLinkMidPoint(bestRef, bestPoly, bestTile, i, neighbourPoly, neighbourTile, mid)))
+			continue;
+
+		// Found a path through the neighbour if the other search has visited it.
+		dtNode* other = otherPool->findNode(neighbourRef, 0);
+		if (other)
+		{
+			// Cost of crossing from the best polygon to the neighbour, in the direction of travel.
+			float meetCost;
+			if (direction == 0)
+			{
+				meetCost = bestNode->cost + other->cost +
+					filter->getCost(bestNode->pos, mid, parentRef, parentTile, parentPoly,
+									bestRef, bestTile, bestPoly, neighbourRef, neighbourTile, neighbourPoly) +
+					filter->getCost(mid, other->pos, bestRef, bestTile, bestPoly,
+									neighbourRef, neighbourTile, neighbourPoly, 0, 0, 0);
+			}
+			else
+			{
+				meetCost = bestNode->cost + other->cost +
+					filter->getCost(other->pos, mid, 0, 0, 0,
+									neighbourRef, neighbourTile, neighbourPoly, bestRef, bestTile, bestPoly) +
+					filter->getCost(mid, bestNode->pos, neighbourRef, neighbourTile, neighbourPoly,
+									bestRef, bestTile, bestPoly, parentRef, parentTile, parentPoly);
+			}
+			DT_QUERY_STAT(m_stats.costCalls += 2);
+			if (meetCost < query.meetCost)
+			{
+				query.meetCost = meetCost;
+				query.meetNodes[direction] = bestNode;
+				query.meetNodes[direction ^ 1] = other;
+			}
+		}
+
+		dtNode* neighbourNode = nodePool->getNode(neighbourRef, 0);
+		if (!neighbourNode)
+		{
+			query.status |= DT_OUT_OF_NODES;
+			continue;
+		}
+
+		// If the node is visited the first time, calculate node position.
+		if (neighbourNode->flags == 0)
+			dtVcopy(neighbourNode->pos, mid);
+
+		// The backward search travels the polygons in reverse.
+		float curCost;
+		if (direction == 0)
+		{
+			curCost = filter->getCost(bestNode->pos, neighbourNode->pos,
+									  parentRef, parentTile, parentPoly,
+									  bestRef, bestTile, bestPoly,
+									  neighbourRef, neighbourTile, neighbourPoly);
+		}
+		else
+		{
+			curCost = filter->getCost(neighbourNode->pos, bestNode->pos,
+									  neighbourRef, neighbourTile, neighbourPoly,
+									  bestRef, bestTile, bestPoly,
+									  parentRef, parentTile, parentPoly);
+		}
+		DT_QUERY_STAT(m_stats.costCalls++);
+		const float cost = bestNode->cost + curCost;
+		const float dist = dtVdist(neighbourNode->pos, target)*H_SCALE;
+		float heuristic = dist;
+		if (query.hasGoalDists[direction])
+			heuristic = dtMax(heuristic, getLandmarkBound(query.goalDists[direction], neighbourRef)*H_SCALE);
+		const float total = cost + heuristic;
+
+		// The node is already in open list and the new result is worse, skip.
+		if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+			continue;
+		// The node is already visited and process, and the new result is worse, skip.
+		if ((neighbourNode->flags & DT_NODE_CLOSED) && total >= neighbourNode->total)
+			continue;
+
+		// Add or update the node.
+		neighbourNode->pidx = nodePool->getNodeIdx(bestNode);
+		neighbourNode->id = neighbourRef;
+		neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
+		neighbourNode->cost = cost;
+		neighbourNode->total = total;
+
+		if (neighbourNode->flags & DT_NODE_OPEN)
+		{
+			// Already in open, update node location.
+			openList->modify(neighbourNode);
+		}
+		else
+		{
+			// Put the node in open list.
+			neighbourNode->flags |= DT_NODE_OPEN;
+			openList->push(neighbourNode);
+		}
+
+		// Update nearest node to target so far.
+		if (direction == 0 && dist < query.lastBestNodeCost)
+		{
+			query.lastBestNodeCost = dist;
+			query.lastBestNode = neighbourNode;
+		}
+	}
+
+	return DT_SUCCESS;
+}
+
+dtStatus dtNavMeshQuery::getPathToMeeting(const dtQueryData& query, dtPolyRef* path, int* pathCount, int maxPath) const
+{
+	// The forward half, from the start to the meeting polygon.
+	dtStatus status = getPathToNode(query.meetNodes[0], path, pathCount, maxPath);
+	if (dtStatusDetail(status, DT_BUFFER_TOO_SMALL))
+		return status;
+
+	// The backward half, from the meeting polygon to the end.
+	int n = *pathCount;
+	for (const dtNode* node = query.meetNodes[1]; node; node = m_backNodePool->getNodeAtIdx(node->pidx))
+	{
+		if (n >= maxPath)
+		{
+			status |= DT_BUFFER_TOO_SMALL;
+			break;
+		}
+		path[n++] = node->id;
+	}
+	*pathCount = n;
+
+	return status;
+}
+
 
 /// @par
 ///
@@ -1242,14 +1949,11 @@ dtStatus dtNavMeshQuery::initSlicedFindPath(dtPolyRef startRef, dtPolyRef endRef
 		return DT_FAILURE | DT_INVALID_PARAM;
 	}
 
-	// trade quality with performance?
-	if (options & DT_FINDPATH_ANY_ANGLE)
+	// The bidirectional search does not support shortcuts.
+	if ((options & DT_FINDPATH_BIDIRECTIONAL) &&
+		((options & DT_FINDPATH_ANY_ANGLE) || !m_backNodePool))
 	{
-		// limiting to several times the character radius yields nice results. It is not sensitive 
-		// so it is enough to compute it from the first tile.
-		const dtMeshTile* tile = m_nav->getTileByRef(startRef);
-		float agentRadius = tile->header->walkableRadius;
-		m_query.raycastLimitSqr = dtSqr(agentRadius * DT_RAY_CAST_LIMIT_PROPORTIONS);
+		return DT_FAILURE | DT_INVALID_PARAM;
 	}
 
 	if (startRef == endRef)
@@ -1257,24 +1961,87 @@ dtStatus dtNavMeshQuery::initSlicedFindPath(dtPolyRef startRef, dtPolyRef endRef
 		m_query.status = DT_SUCCESS;
 		return DT_SUCCESS;
 	}
+
+	if (options & DT_FINDPATH_BIDIRECTIONAL)
+	{
+		initBidirectionalSearch(m_query);
+		m_query.status = DT_IN_PROGRESS;
+		return m_query.status;
+	}
 	
+	initSearch(m_query);
+	
+	return m_query.status;
+}
+
+/// @par
+///
+/// The goal arrays and the @p filter pointer are stored and used for the duration of the
+/// sliced path query. The query is updated with updateSlicedFindPath() and finalized with
+/// finalizeSlicedFindPathToNearest(), finalizeSlicedFindPath() or finalizeSlicedFindPathPartial().
+///
+dtStatus dtNavMeshQuery::initSlicedFindPathToNearest(dtPolyRef startRef, const float* startPos,
+													 const dtPolyRef* goalRefs, const float* goalPositions,
+													 const int goalCount, const dtQueryFilter* filter)
+{
+	dtAssert(m_nav);
+	dtAssert(m_nodePool);
+	dtAssert(m_openList);
+
+	// Init path state.
+	memset(&m_query, 0, sizeof(dtQueryData));
+	m_query.status = DT_FAILURE;
+	m_query.startRef = startRef;
+	if (startPos)
+		dtVcopy(m_query.startPos, startPos);
+	m_query.filter = filter;
+
+	// Validate input
+	if (!m_nav->isValidPolyRef(startRef) || !startPos || !dtVisfinite(startPos) ||
+		!validGoals(goalRefs, goalPositions, goalCount) || !filter)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	m_query.goalRefs = goalRefs;
+	m_query.goalPositions = goalPositions;
+	m_query.goalCount = goalCount;
+	m_query.resultGoals = &m_query.goalIndex;
+	m_query.resultCosts = &m_query.goalCost;
+	m_query.maxResult = 1;
+	initGoalSearch(m_query);
+
+	return m_query.status;
+}
+
+void dtNavMeshQuery::initSearch(dtQueryData& query) const
+{
+	// trade quality with performance?
+	if (query.options & DT_FINDPATH_ANY_ANGLE)
+	{
+		// limiting to several times the character radius yields nice results. It is not sensitive 
+		// so it is enough to compute it from the first tile.
+		const dtMeshTile* tile = m_nav->getTileByRef(query.startRef);
+		float agentRadius = tile->header->walkableRadius;
+		query.raycastLimitSqr = dtSqr(agentRadius * DT_RAY_CAST_LIMIT_PROPORTIONS);
+	}
+
 	m_nodePool->clear();
 	m_openList->clear();
 	
-	dtNode* startNode = m_nodePool->getNode(startRef);
-	dtVcopy(startNode->pos, startPos);
+	dtNode* startNode = m_nodePool->getNode(query.startRef);
+	dtVcopy(startNode->pos, query.startPos);
 	startNode->pidx = 0;
 	startNode->cost = 0;
-	startNode->total = dtVdist(startPos, endPos) * H_SCALE;
-	startNode->id = startRef;
+	startNode->total = dtVdist(query.startPos, query.endPos) * H_SCALE;
+	startNode->id = query.startRef;
 	startNode->flags = DT_NODE_OPEN;
 	m_openList->push(startNode);
 	
-	m_query.status = DT_IN_PROGRESS;
-	m_query.lastBestNode = startNode;
-	m_query.lastBestNodeCost = startNode->total;
-	
-	return m_query.status;
+	query.status = DT_IN_PROGRESS;
+	query.lastBestNode = startNode;
+	query.lastBestNodeCost = startNode->total;
+	query.hasGoalDists[0] = getLandmarkDistances(query.endRef, query.goalDists[0]);
 }
 	
 dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
@@ -1282,6 +2049,17 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 	if (!dtStatusInProgress(m_query.status))
 		return m_query.status;
 
+	if (m_query.goalRefs)
+	{
+		// Goals which have disappeared are never reached.
+		if (!m_nav->isValidPolyRef(m_query.startRef))
+		{
+			m_query.status = DT_FAILURE;
+			return DT_FAILURE;
+		}
+		return expandGoalSearch(m_query, maxIter, doneIters);
+	}
+
 	// Make sure the request is still valid.
 	if (!m_nav->isValidPolyRef(m_query.startRef) || !m_nav->isValidPolyRef(m_query.endRef))
 	{
@@ -1289,6 +2067,35 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 		return DT_FAILURE;
 	}
 
+	if (m_query.options & DT_FINDPATH_BIDIRECTIONAL)
+	{
+		int iter = 0;
+		while (iter < maxIter && !isBidirectionalSearchDone(m_query))
+		{
+			iter++;
+			if (dtStatusFailed(expandBidirectionalSearch(m_query, m_query.direction)))
+			{
+				// The polygon has disappeared during the sliced query, fail.
+				m_query.status = DT_FAILURE;
+				break;
+			}
+			m_query.direction ^= 1;
+		}
+		if (dtStatusInProgress(m_query.status) && isBidirectionalSearchDone(m_query))
+		{
+			const dtStatus details = m_query.status & DT_STATUS_DETAIL_MASK;
+			m_query.status = DT_SUCCESS | details;
+		}
+		if (doneIters)
+			*doneIters = iter;
+		return m_query.status;
+	}
+
+	return expandSearch(m_query, maxIter, doneIters);
+}
+
+dtStatus dtNavMeshQuery::expandSearch(dtQueryData& query, const int maxIter, int* doneIters) const
+{
 	dtRaycastHit rayHit;
 	rayHit.maxPath = 0;
 		
@@ -1303,14 +2110,14 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 		bestNode->flags |= DT_NODE_CLOSED;
 		
 		// Reached the goal, stop searching.
-		if (bestNode->id == m_query.endRef)
+		if (bestNode->id == query.endRef)
 		{
-			m_query.lastBestNode = bestNode;
-			const dtStatus details = m_query.status & DT_STATUS_DETAIL_MASK;
-			m_query.status = DT_SUCCESS | details;
+			query.lastBestNode = bestNode;
+			const dtStatus details = query.status & DT_STATUS_DETAIL_MASK;
+			query.status = DT_SUCCESS | details;
 			if (doneIters)
 				*doneIters = iter;
-			return m_query.status;
+			return query.status;
 		}
 		
 		// Get current poly and tile.
@@ -1321,10 +2128,10 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 		if (dtStatusFailed(m_nav->getTileAndPolyByRef(bestRef, &bestTile, &bestPoly)))
 		{
 			// The polygon has disappeared during the sliced query, fail.
-			m_query.status = DT_FAILURE;
+			query.status = DT_FAILURE;
 			if (doneIters)
 				*doneIters = iter;
-			return m_query.status;
+			return query.status;
 		}
 		
 		// Get parent and grand parent poly and tile.
@@ -1345,18 +2152,19 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 			if (invalidParent || (grandpaRef && !m_nav->isValidPolyRef(grandpaRef)) )
 			{
 				// The polygon has disappeared during the sliced query, fail.
-				m_query.status = DT_FAILURE;
+				query.status = DT_FAILURE;
 				if (doneIters)
 					*doneIters = iter;
-				return m_query.status;
+				return query.status;
 			}
 		}
+		DT_QUERY_STAT(m_stats.nodesExpanded++);
 
 		// decide whether to test raycast to previous nodes
 		bool tryLOS = false;
-		if (m_query.options & DT_FINDPATH_ANY_ANGLE)
+		if (query.options & DT_FINDPATH_ANY_ANGLE)
 		{
-			if ((parentRef != 0) && (dtVdistSqr(parentNode->pos, bestNode->pos) < m_query.raycastLimitSqr))
+			if ((parentRef != 0) && (dtVdistSqr(parentNode->pos, bestNode->pos) < query.raycastLimitSqr))
 				tryLOS = true;
 		}
 		
@@ -1367,6 +2175,10 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 			// Skip invalid ids and do not expand back to where we came from.
 			if (!neighbourRef || neighbourRef == parentRef)
 				continue;
+
+			// Skip edges narrower than the agent.
+			if (!dtPassEdgeClearance(bestTile, bestPoly, bestTile->links[i].edge, query.filter->getAgentRadius()))
+				continue;
 			
 			// Get neighbour poly and tile.
 			// The API input has been checked already, skip checking internal data.
@@ -1374,14 +2186,16 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 			const dtPoly* neighbourPoly = 0;
 			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);			
 			
-			if (!m_query.filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+			DT_QUERY_STAT(m_stats.filterCalls++);
+			if (!query.filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
 				continue;
+			DT_QUERY_STAT(m_stats.tilesTouched += neighbourTile != bestTile);
 			
 			// get the neighbor node
 			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef, 0);
 			if (!neighbourNode)
 			{
-				m_query.status |= DT_OUT_OF_NODES;
+				query.status |= DT_OUT_OF_NODES;
 				continue;
 			}
 			
@@ -1392,21 +2206,22 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 			// If the node is visited the first time, calculate node position.
 			if (neighbourNode->flags == 0)
 			{
-				getEdgeMidPoint(bestRef, bestPoly, bestTile,
-								neighbourRef, neighbourPoly, neighbourTile,
+				getLinkMidPoint(bestRef, bestPoly, bestTile, i,
+								neighbourPoly, neighbourTile,
 								neighbourNode->pos);
 			}
 			
 			// Calculate cost and heuristic.
 			float cost = 0;
 			float heuristic = 0;
+			float dist = 0;
 			
 			// raycast parent
 			bool foundShortCut = false;
 			rayHit.pathCost = rayHit.t = 0;
 			if (tryLOS)
 			{
-				raycast(parentRef, parentNode->pos, neighbourNode->pos, m_query.filter, DT_RAYCAST_USE_COSTS, &rayHit, grandpaRef);
+				raycast(parentRef, parentNode->pos, neighbourNode->pos, query.filter, DT_RAYCAST_USE_COSTS, &rayHit, grandpaRef);
 				foundShortCut = rayHit.t >= 1.0f;
 			}
 
@@ -1419,27 +2234,32 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 			else
 			{
 				// No shortcut found.
-				const float curCost = m_query.filter->getCost(bestNode->pos, neighbourNode->pos,
+				const float curCost = query.filter->getCost(bestNode->pos, neighbourNode->pos,
 															  parentRef, parentTile, parentPoly,
 															bestRef, bestTile, bestPoly,
 															neighbourRef, neighbourTile, neighbourPoly);
 				cost = bestNode->cost + curCost;
+				DT_QUERY_STAT(m_stats.costCalls++);
 			}
 
 			// Special case for last node.
-			if (neighbourRef == m_query.endRef)
+			if (neighbourRef == query.endRef)
 			{
-				const float endCost = m_query.filter->getCost(neighbourNode->pos, m_query.endPos,
+				const float endCost = query.filter->getCost(neighbourNode->pos, query.endPos,
 															  bestRef, bestTile, bestPoly,
 															  neighbourRef, neighbourTile, neighbourPoly,
 															  0, 0, 0);
 				
 				cost = cost + endCost;
 				heuristic = 0;
+				DT_QUERY_STAT(m_stats.costCalls++);
 			}
 			else
 			{
-				heuristic = dtVdist(neighbourNode->pos, m_query.endPos)*H_SCALE;
+				dist = dtVdist(neighbourNode->pos, query.endPos)*H_SCALE;
+				heuristic = dist;
+				if (query.hasGoalDists[0])
+					heuristic = dtMax(heuristic, getLandmarkBound(query.goalDists[0], neighbourRef)*H_SCALE);
 			}
 			
 			const float total = cost + heuristic;
@@ -1473,10 +2293,10 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 			}
 			
 			// Update nearest node to target so far.
-			if (heuristic < m_query.lastBestNodeCost)
+			if (dist < query.lastBestNodeCost)
 			{
-				m_query.lastBestNodeCost = heuristic;
-				m_query.lastBestNode = neighbourNode;
+				query.lastBestNodeCost = dist;
+				query.lastBestNode = neighbourNode;
 			}
 		}
 	}
@@ -1484,14 +2304,100 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 	// Exhausted all nodes, but could not find path.
 	if (m_openList->empty())
 	{
-		const dtStatus details = m_query.status & DT_STATUS_DETAIL_MASK;
-		m_query.status = DT_SUCCESS | details;
+		const dtStatus details = query.status & DT_STATUS_DETAIL_MASK;
+		query.status = DT_SUCCESS | details;
 	}
 
 	if (doneIters)
 		*doneIters = iter;
 
-	return m_query.status;
+	return query.status;
+}
+
+dtStatus dtNavMeshQuery::updateSlicedFindPath(const dtTimeBudget& budget, int* doneIters, double* usedTime)
+{
+	const double startTime = budget.getTime();
+	double time = startTime;
+	int iters = 0;
+	dtStatus status = m_query.status;
+
+	// The deadline is checked after each slice, so at least one slice is run
+	// to guarantee progress even with an exhausted budget.
+	do
+	{
+		int n = 0;
+		status = updateSlicedFindPath(budget.checkIterations, &n);
+		iters += n;
+		time = budget.getTime();
+	}
+	while (dtStatusInProgress(status) && time < budget.deadline);
+
+	if (doneIters)
+		*doneIters = iters;
+	if (usedTime)
+		*usedTime = time - startTime;
+
+	return status;
+}
+
+void dtNavMeshQuery::getShortcutPath(dtQueryData& query, dtPolyRef* path, int* pathCount, const int maxPath) const
+{
+	int n = 0;
+
+	// Reverse the path.
+	dtAssert(query.lastBestNode);
+	
+	if (query.lastBestNode->id != query.endRef)
+		query.status |= DT_PARTIAL_RESULT;
+	
+	dtNode* prev = 0;
+	dtNode* node = query.lastBestNode;
+	int prevRay = 0;
+	do
+	{
+		dtNode* next = m_nodePool->getNodeAtIdx(node->pidx);
+		node->pidx = m_nodePool->getNodeIdx(prev);
+		prev = node;
+		int nextRay = node->flags & DT_NODE_PARENT_DETACHED; // keep track of whether parent is not adjacent (i.e. due to raycast shortcut)
+		node->flags = (node->flags & ~DT_NODE_PARENT_DETACHED) | prevRay; // and store it in the reversed path's node
+		prevRay = nextRay;
+		node = next;
+	}
+	while (node);
+	
+	// Store path
+	node = prev;
+	do
+	{
+		dtNode* next = m_nodePool->getNodeAtIdx(node->pidx);
+		dtStatus status = 0;
+		if (node->flags & DT_NODE_PARENT_DETACHED)
+		{
+			float t, normal[3];
+			int m;
+			status = raycast(node->id, node->pos, next->pos, query.filter, &t, normal, path+n, &m, maxPath-n);
+			n += m;
+			// raycast ends on poly boundary and the path might include the next poly boundary.
+			if (path[n-1] == next->id)
+				n--; // remove to avoid duplicates
+		}
+		else
+		{
+			path[n++] = node->id;
+			if (n >= maxPath)
+				status = DT_BUFFER_TOO_SMALL;
+		}
+
+		if (status & DT_STATUS_DETAIL_MASK)
+		{
+			query.status |= status & DT_STATUS_DETAIL_MASK;
+			break;
+		}
+		node = next;
+	}
+	while (node);
+
+	*pathCount = n;
 }
 
 dtStatus dtNavMeshQuery::finalizeSlicedFindPath(dtPolyRef* path, int* pathCount, const int maxPath)
@@ -1504,8 +2410,12 @@ dtStatus dtNavMeshQuery::finalizeSlicedFindPath(dtPolyRef* path, int* pathCount,
 	if (!path || maxPath <= 0)
 		return DT_FAILURE | DT_INVALID_PARAM;
 	
+	DT_QUERY_STAT(const int nodeCount = m_nodePool->getNodeCount() +
+		((m_query.options & DT_FINDPATH_BIDIRECTIONAL) ? m_backNodePool->getNodeCount() : 0));
+
 	if (dtStatusFailed(m_query.status))
 	{
+		DT_QUERY_STAT(countQuery(m_query.status, nodeCount));
 		// Reset query.
 		memset(&m_query, 0, sizeof(dtQueryData));
 		return DT_FAILURE;
@@ -1518,63 +2428,17 @@ dtStatus dtNavMeshQuery::finalizeSlicedFindPath(dtPolyRef* path, int* pathCount,
 		// Special case: the search starts and ends at same poly.
 		path[n++] = m_query.startRef;
 	}
+	else if ((m_query.options & DT_FINDPATH_BIDIRECTIONAL) && m_query.meetNodes[0])
+	{
+		m_query.status |= getPathToMeeting(m_query, path, &n, maxPath) & DT_STATUS_DETAIL_MASK;
+	}
 	else
 	{
-		// Reverse the path.
-		dtAssert(m_query.lastBestNode);
-		
-		if (m_query.lastBestNode->id != m_query.endRef)
-			m_query.status |= DT_PARTIAL_RESULT;
-		
-		dtNode* prev = 0;
-		dtNode* node = m_query.lastBestNode;
-		int prevRay = 0;
-		do
-		{
-			dtNode* next = m_nodePool->getNodeAtIdx(node->pidx);
-			node->pidx = m_nodePool->getNodeIdx(prev);
-			prev = node;
-			int nextRay = node->flags & DT_NODE_PARENT_DETACHED; // keep track of whether parent is not adjacent (i.e. due to raycast shortcut)
-			node->flags = (node->flags & ~DT_NODE_PARENT_DETACHED) | prevRay; // and store it in the reversed path's node
-			prevRay = nextRay;
-			node = next;
-		}
-		while (node);
-		
-		// Store path
-		node = prev;
-		do
-		{
-			dtNode* next = m_nodePool->getNodeAtIdx(node->pidx);
-			dtStatus status = 0;
-			if (node->flags & DT_NODE_PARENT_DETACHED)
-			{
-				float t, normal[3];
-				int m;
-				status = raycast(node->id, node->pos, next->pos, m_query.filter, &t, normal, path+n, &m, maxPath-n);
-				n += m;
-				// raycast ends on poly boundary and the path might include the next poly boundary.
-				if (path[n-1] == next->id)
-					n--; // remove to avoid duplicates
-			}
-			else
-			{
-				path[n++] = node->id;
-				if (n >= maxPath)
-					status = DT_BUFFER_TOO_SMALL;
-			}
-
-			if (status & DT_STATUS_DETAIL_MASK)
-			{
-				m_query.status |= status & DT_STATUS_DETAIL_MASK;
-				break;
-			}
-			node = next;
-		}
-		while (node);
+		getShortcutPath(m_query, path, &n, maxPath);
 	}
 	
 	const dtStatus details = m_query.status & DT_STATUS_DETAIL_MASK;
+	DT_QUERY_STAT(countQuery(details, nodeCount));
 
 	// Reset query.
 	memset(&m_query, 0, sizeof(dtQueryData));
@@ -1584,6 +2448,17 @@ dtStatus dtNavMeshQuery::finalizeSlicedFindPath(dtPolyRef* path, int* pathCount,
 	return DT_SUCCESS | details;
 }
 
+dtStatus dtNavMeshQuery::finalizeSlicedFindPathToNearest(dtPolyRef* path, int* pathCount, const int maxPath,
+														 int* goalIndex)
+{
+	if (goalIndex)
+	{
+		const bool reached = m_query.goalRefs && m_query.resultCount && dtStatusSucceed(m_query.status);
+		*goalIndex = reached ? m_query.goalIndex : -1;
+	}
+	return finalizeSlicedFindPath(path, pathCount, maxPath);
+}
+
 dtStatus dtNavMeshQuery::finalizeSlicedFindPathPartial(const dtPolyRef* existing, const int existingSize,
 													   dtPolyRef* path, int* pathCount, const int maxPath)
 {
@@ -1595,8 +2470,12 @@ dtStatus dtNavMeshQuery::finalizeSlicedFindPathPartial(const dtPolyRef* existing
 	if (!existing || existingSize <= 0 || !path || !pathCount || maxPath <= 0)
 		return DT_FAILURE | DT_INVALID_PARAM;
 	
+	DT_QUERY_STAT(const int nodeCount = m_nodePool->getNodeCount() +
+		((m_query.options & DT_FINDPATH_BIDIRECTIONAL) ? m_backNodePool->getNodeCount() : 0));
+
 	if (dtStatusFailed(m_query.status))
 	{
+		DT_QUERY_STAT(countQuery(m_query.status, nodeCount));
 		// Reset query.
 		memset(&m_query, 0, sizeof(dtQueryData));
 		return DT_FAILURE;
@@ -1676,6 +2555,7 @@ dtStatus dtNavMeshQuery::finalizeSlicedFindPathPartial(const dtPolyRef* existing
 	}
 	
 	const dtStatus details = m_query.status & DT_STATUS_DETAIL_MASK;
+	DT_QUERY_STAT(countQuery(details, nodeCount));
 
 	// Reset query.
 	memset(&m_query, 0, sizeof(dtQueryData));
@@ -1686,1041 +2566,2319 @@ dtStatus dtNavMeshQuery::finalizeSlicedFindPathPartial(const dtPolyRef* existing
 }
 
 
-dtStatus dtNavMeshQuery::appendVertex(const float* pos, const unsigned char flags, const dtPolyRef ref,
-									  float* straightPath, unsigned char* straightPathFlags, dtPolyRef* straightPathRefs,
-									  int* straightPathCount, const int maxStraightPath) const
+/// Returns the distance from the position to the nearest goal position.
+static float dtMinGoalDist(const float* pos, const float* goalPositions, const int goalCount)
 {
-	if ((*straightPathCount) > 0 && dtVequal(&straightPath[((*straightPathCount)-1)*3], pos))
-	{
-		// The vertices are equal, update flags and poly.
-		if (straightPathFlags)
-			straightPathFlags[(*straightPathCount)-1] = flags;
-		if (straightPathRefs)
-			straightPathRefs[(*straightPathCount)-1] = ref;
-	}
-	else
-	{
-		// Append new vertex.
-		dtVcopy(&straightPath[(*straightPathCount)*3], pos);
-		if (straightPathFlags)
-			straightPathFlags[(*straightPathCount)] = flags;
-		if (straightPathRefs)
-			straightPathRefs[(*straightPathCount)] = ref;
-		(*straightPathCount)++;
-
-		// If there is no space to append more vertices, return.
-		if ((*straightPathCount) >= maxStraightPath)
-		{
-			return DT_SUCCESS | DT_BUFFER_TOO_SMALL;
-		}
+	float best = FLT_MAX;
+	for (int i = 0; i < goalCount; ++i)
+		best = dtMin(best, dtVdistSqr(pos, &goalPositions[i*3]));
+	return dtMathSqrtf(best);
+}
 
-		// If reached end of path, return.
-		if (flags == DT_STRAIGHTPATH_END)
-		{
-			return DT_SUCCESS;
-		}
+/// Inserts a goal into the results sorted by cost. If the results are full, the most expensive goal is dropped.
+static void dtInsertGoalResult(int* goals, float* costs, int& count, const int maxResult,
+							   const int goal, const float cost)
+{
+	if (count == maxResult && cost >= costs[count-1])
+		return;
+	int i = count < maxResult ? count++ : count-1;
+	for (; i > 0 && costs[i-1] > cost; --i)
+	{
+		goals[i] = goals[i-1];
+		costs[i] = costs[i-1];
 	}
-	return DT_IN_PROGRESS;
+	goals[i] = goal;
+	costs[i] = cost;
 }
 
-dtStatus dtNavMeshQuery::appendPortals(const int startIdx, const int endIdx, const float* endPos, const dtPolyRef* path,
-									  float* straightPath, unsigned char* straightPathFlags, dtPolyRef* straightPathRefs,
-									  int* straightPathCount, const int maxStraightPath, const int options) const
+bool dtNavMeshQuery::validGoals(const dtPolyRef* goalRefs, const float* goalPositions, const int goalCount) const
 {
-	const float* startPos = &straightPath[(*straightPathCount-1)*3];
-	// Append or update last vertex
-	dtStatus stat = 0;
-	for (int i = startIdx; i < endIdx; i++)
+	if (!goalRefs || !goalPositions || goalCount <= 0)
+		return false;
+	for (int i = 0; i < goalCount; ++i)
 	{
-		// Calculate portal
-		const dtPolyRef from = path[i];
-		const dtMeshTile* fromTile = 0;
-		const dtPoly* fromPoly = 0;
-		if (dtStatusFailed(m_nav->getTileAndPolyByRef(from, &fromTile, &fromPoly)))
-			return DT_FAILURE | DT_INVALID_PARAM;
-		
-		const dtPolyRef to = path[i+1];
-		const dtMeshTile* toTile = 0;
-		const dtPoly* toPoly = 0;
-		if (dtStatusFailed(m_nav->getTileAndPolyByRef(to, &toTile, &toPoly)))
-			return DT_FAILURE | DT_INVALID_PARAM;
-		
-		float left[3], right[3];
-		if (dtStatusFailed(getPortalPoints(from, fromPoly, fromTile, to, toPoly, toTile, left, right)))
-			break;
-	
-		if (options & DT_STRAIGHTPATH_AREA_CROSSINGS)
-		{
-			// Skip intersection if only area crossings are requested.
-			if (fromPoly->getArea() == toPoly->getArea())
-				continue;
-		}
-		
-		// Append intersection
-		float s,t;
-		if (dtIntersectSegSeg2D(startPos, endPos, left, right, s, t))
-		{
-			float pt[3];
-			dtVlerp(pt, left,right, t);
-
-			stat = appendVertex(pt, 0, path[i+1],
-								straightPath, straightPathFlags, straightPathRefs,
-								straightPathCount, maxStraightPath);
-			if (stat != DT_IN_PROGRESS)
-				return stat;
-		}
+		if (!m_nav->isValidPolyRef(goalRefs[i]) || !dtVisfinite(&goalPositions[i*3]))
+			return false;
 	}
-	return DT_IN_PROGRESS;
+	return true;
 }
 
 /// @par
-/// 
-/// This method peforms what is often called 'string pulling'.
 ///
-/// The start position is clamped to the first polygon in the path, and the 
-/// end position is clamped to the last. So the start and end positions should 
-/// normally be within or very near the first and last polygons respectively.
+/// The search is an A* search whose heuristic is the distance to the nearest goal position,
+/// which stays consistent when the costs are at least the travelled distance. A goal is reached
+/// when no open path can be cheaper, so the result is the goal with the cheapest path, not the
+/// first goal polygon visited.
 ///
-/// The returned polygon references represent the reference id of the polygon 
-/// that is entered at the associated path position. The reference id associated 
-/// with the end point will always be zero.  This allows, for example, matching 
-/// off-mesh link points to their representative polygons.
+/// If no goal can be reached, the last polygon in the path will be the polygon nearest to
+/// any of the goals, and the status has #DT_PARTIAL_RESULT set.
 ///
-/// If the provided result buffers are too small for the entire result set, 
-/// they will be filled as far as possible from the start toward the end 
-/// position.
+/// The landmark heuristic is not used by this search. (See: #setLandmarks)
 ///
-dtStatus dtNavMeshQuery::findStraightPath(const float* startPos, const float* endPos,
-										  const dtPolyRef* path, const int pathSize,
-										  float* straightPath, unsigned char* straightPathFlags, dtPolyRef* straightPathRefs,
-										  int* straightPathCount, const int maxStraightPath, const int options) const
+dtStatus dtNavMeshQuery::findPathToNearest(dtPolyRef startRef, const float* startPos,
+										   const dtPolyRef* goalRefs, const float* goalPositions, const int goalCount,
+										   const dtQueryFilter* filter,
+										   dtPolyRef* path, int* pathCount, const int maxPath, int* goalIndex) const
 {
 	dtAssert(m_nav);
+	dtAssert(m_nodePool);
+	dtAssert(m_openList);
 
-	if (!straightPathCount)
+	if (goalIndex)
+		*goalIndex = -1;
+	if (!pathCount)
 		return DT_FAILURE | DT_INVALID_PARAM;
 
-	*straightPathCount = 0;
+	*pathCount = 0;
 
-	if (!startPos || !dtVisfinite(startPos) ||
-		!endPos || !dtVisfinite(endPos) ||
-		!path || pathSize <= 0 || !path[0] ||
-		maxStraightPath <= 0)
+	// Validate input
+	if (!m_nav->isValidPolyRef(startRef) || !startPos || !dtVisfinite(startPos) ||
+		!validGoals(goalRefs, goalPositions, goalCount) ||
+		!filter || !path || maxPath <= 0)
 	{
 		return DT_FAILURE | DT_INVALID_PARAM;
 	}
-	
-	dtStatus stat = 0;
-	
-	// TODO: Should this be callers responsibility?
-	float closestStartPos[3];
-	if (dtStatusFailed(closestPointOnPolyBoundary(path[0], startPos, closestStartPos)))
-		return DT_FAILURE | DT_INVALID_PARAM;
 
-	float closestEndPos[3];
-	if (dtStatusFailed(closestPointOnPolyBoundary(path[pathSize-1], endPos, closestEndPos)))
-		return DT_FAILURE | DT_INVALID_PARAM;
-	
-	// Add start point.
-	stat = appendVertex(closestStartPos, DT_STRAIGHTPATH_START, path[0],
-						straightPath, straightPathFlags, straightPathRefs,
-						straightPathCount, maxStraightPath);
-	if (stat != DT_IN_PROGRESS)
-		return stat;
-	
-	if (pathSize > 1)
+	dtQueryData query;
+	memset(&query, 0, sizeof(dtQueryData));
+	query.startRef = startRef;
+	dtVcopy(query.startPos, startPos);
+	query.filter = filter;
+	query.goalRefs = goalRefs;
+	query.goalPositions = goalPositions;
+	query.goalCount = goalCount;
+	query.resultGoals = &query.goalIndex;
+	query.resultCosts = &query.goalCost;
+	query.maxResult = 1;
+	initGoalSearch(query);
+
+	while (dtStatusInProgress(query.status))
+		expandGoalSearch(query, DT_MAX_SEARCH_ITERATIONS, 0);
+	if (dtStatusFailed(query.status))
+		return query.status;
+
+	dtStatus status = getPathToNode(query.lastBestNode, path, pathCount, maxPath);
+	status |= query.status & DT_STATUS_DETAIL_MASK;
+	if (query.resultCount)
 	{
-		float portalApex[3], portalLeft[3], portalRight[3];
-		dtVcopy(portalApex, closestStartPos);
-		dtVcopy(portalLeft, portalApex);
-		dtVcopy(portalRight, portalApex);
-		int apexIndex = 0;
-		int leftIndex = 0;
-		int rightIndex = 0;
-		
-		unsigned char leftPolyType = 0;
-		unsigned char rightPolyType = 0;
-		
-		dtPolyRef leftPolyRef = path[0];
-		dtPolyRef rightPolyRef = path[0];
-		
-		for (int i = 0; i < pathSize; ++i)
-		{
-			float left[3], right[3];
-			unsigned char toType;
-			
-			if (i+1 < pathSize)
-			{
-				unsigned char fromType; // fromType is ignored.
+		if (goalIndex)
+			*goalIndex = query.goalIndex;
+	}
+	else
+	{
+		status |= DT_PARTIAL_RESULT;
+	}
+	DT_QUERY_STAT(countQuery(status, m_nodePool->getNodeCount()));
+	return status;
+}
 
-				// Next portal.
-				if (dtStatusFailed(getPortalPoints(path[i], path[i+1], left, right, fromType, toType)))
-				{
-					// Failed to get portal points, in practice this means that path[i+1] is invalid polygon.
-					// Clamp the end point to path[i], and return the path so far.
-					
-					if (dtStatusFailed(closestPointOnPolyBoundary(path[i], endPos, closestEndPos)))
-					{
-						// This should only happen when the first polygon is invalid.
-						return DT_FAILURE | DT_INVALID_PARAM;
-					}
+/// @par
+///
+/// The search continues until the @p maxResult cheapest goals are known, or until all the
+/// polygons reachable from the start polygon have been visited. Goals which cannot be
+/// reached are not returned.
+///
+/// The paths to the goals found can be retrieved with #getPathFromDijkstraSearch, using
+/// the goal polygon references.
+///
+dtStatus dtNavMeshQuery::findNearestGoals(dtPolyRef startRef, const float* startPos,
+										  const dtPolyRef* goalRefs, const float* goalPositions, const int goalCount,
+										  const dtQueryFilter* filter,
+										  int* resultGoals, float* resultCosts, int* resultCount, const int maxResult) const
+{
+	dtAssert(m_nav);
+	dtAssert(m_nodePool);
+	dtAssert(m_openList);
 
-					// Apeend portals along the current straight path segment.
-					if (options & (DT_STRAIGHTPATH_AREA_CROSSINGS | DT_STRAIGHTPATH_ALL_CROSSINGS))
-					{
-						// Ignore status return value as we're just about to return anyway.
-						appendPortals(apexIndex, i, closestEndPos, path,
-											 straightPath, straightPathFlags, straightPathRefs,
-											 straightPathCount, maxStraightPath, options);
-					}
+	if (!resultCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
 
-					// Ignore status return value as we're just about to return anyway.
-					appendVertex(closestEndPos, 0, path[i],
-										straightPath, straightPathFlags, straightPathRefs,
-										straightPathCount, maxStraightPath);
-					
-					return DT_SUCCESS | DT_PARTIAL_RESULT | ((*straightPathCount >= maxStraightPath) ? DT_BUFFER_TOO_SMALL : 0);
-				}
-				
-				// If starting really close the portal, advance.
-				if (i == 0)
-				{
-					float t;
-					if (dtDistancePtSegSqr2D(portalApex, left, right, t) < dtSqr(0.001f))
-						continue;
-				}
+	*resultCount = 0;
+
+	// Validate input
+	if (!m_nav->isValidPolyRef(startRef) || !startPos || !dtVisfinite(startPos) ||
+		!validGoals(goalRefs, goalPositions, goalCount) ||
+		!filter || !resultGoals || !resultCosts || maxResult <= 0)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	dtQueryData query;
+	memset(&query, 0, sizeof(dtQueryData));
+	query.startRef = startRef;
+	dtVcopy(query.startPos, startPos);
+	query.filter = filter;
+	query.goalRefs = goalRefs;
+	query.goalPositions = goalPositions;
+	query.goalCount = goalCount;
+	query.resultGoals = resultGoals;
+	query.resultCosts = resultCosts;
+	query.maxResult = maxResult;
+	initGoalSearch(query);
+
+	while (dtStatusInProgress(query.status))
+		expandGoalSearch(query, DT_MAX_SEARCH_ITERATIONS, 0);
+	if (dtStatusFailed(query.status))
+		return query.status;
+
+	*resultCount = query.resultCount;
+	DT_QUERY_STAT(countQuery(query.status, m_nodePool->getNodeCount()));
+	return query.status;
+}
+
+void dtNavMeshQuery::initGoalSearch(dtQueryData& query) const
+{
+	m_nodePool->clear();
+	m_openList->clear();
+
+	dtNode* startNode = m_nodePool->getNode(query.startRef);
+	dtVcopy(startNode->pos, query.startPos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = dtMinGoalDist(query.startPos, query.goalPositions, query.goalCount) * H_SCALE;
+	startNode->id = query.startRef;
+	startNode->flags = DT_NODE_OPEN;
+	m_openList->push(startNode);
+
+	query.status = DT_IN_PROGRESS;
+	query.lastBestNode = startNode;
+	query.lastBestNodeCost = startNode->total;
+	query.resultCount = 0;
+}
+
+dtStatus dtNavMeshQuery::expandGoalSearch(dtQueryData& query, const int maxIter, int* doneIters) const
+{
+	int iter = 0;
+	bool done = false;
+	while (!m_openList->empty())
+	{
+		// The results are final once no open path is cheaper than the most expensive goal found.
+		if (query.resultCount == query.maxResult &&
+			query.resultCosts[query.resultCount-1] <= m_openList->top()->total)
+		{
+			done = true;
+			break;
+		}
+		if (iter >= maxIter)
+			break;
+		iter++;
+
+		// Remove node from open list and put it in closed list.
+		dtNode* bestNode = m_openList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+
+		// Get current poly and tile.
+		const dtPolyRef bestRef = bestNode->id;
+		const dtMeshTile* bestTile = 0;
+		const dtPoly* bestPoly = 0;
+		if (dtStatusFailed(m_nav->getTileAndPolyByRef(bestRef, &bestTile, &bestPoly)))
+		{
+			// The polygon has disappeared during the sliced query, fail.
+			query.status = DT_FAILURE;
+			if (doneIters)
+				*doneIters = iter;
+			return query.status;
+		}
+
+		// Get parent poly and tile.
+		dtPolyRef parentRef = 0;
+		const dtMeshTile* parentTile = 0;
+		const dtPoly* parentPoly = 0;
+		if (bestNode->pidx)
+			parentRef = m_nodePool->getNodeAtIdx(bestNode->pidx)->id;
+		if (parentRef && dtStatusFailed(m_nav->getTileAndPolyByRef(parentRef, &parentTile, &parentPoly)))
+		{
+			// The polygon has disappeared during the sliced query, fail.
+			query.status = DT_FAILURE;
+			if (doneIters)
+				*doneIters = iter;
+			return query.status;
+		}
+		DT_QUERY_STAT(m_stats.nodesExpanded++);
+
+		// Complete the paths to the goals within the polygon.
+		for (int i = 0; i < query.goalCount; ++i)
+		{
+			if (query.goalRefs[i] != bestRef)
+				continue;
+			const float endCost = query.filter->getCost(bestNode->pos, &query.goalPositions[i*3],
+														parentRef, parentTile, parentPoly,
+														bestRef, bestTile, bestPoly,
+														0, 0, 0);
+			DT_QUERY_STAT(m_stats.costCalls++);
+			dtInsertGoalResult(query.resultGoals, query.resultCosts, query.resultCount, query.maxResult,
+							   i, bestNode->cost + endCost);
+		}
+
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+		{
+			dtPolyRef neighbourRef = bestTile->links[i].ref;
+
+			// Skip invalid ids and do not expand back to where we came from.
+			if (!neighbourRef || neighbourRef == parentRef)
+				continue;
+
+			// Skip edges narrower than the agent.
+			if (!dtPassEdgeClearance(bestTile, bestPoly, bestTile->links[i].edge, query.filter->getAgentRadius()))
+				continue;
+
+			// Get neighbour poly and tile.
+			// The API input has been checked already, skip checking internal data.
+			const dtMeshTile* neighbourTile = 0;
+			const dtPoly* neighbourPoly = 0;
+			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
+
+			DT_QUERY_STAT(m_stats.filterCalls++);
+			if (!query.filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+				continue;
+			DT_QUERY_STAT(m_stats.tilesTouched += neighbourTile != bestTile);
+
+			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef, 0);
+			if (!neighbourNode)
+			{
+				query.status |= DT_OUT_OF_NODES;
+				continue;
+			}
+
+			// If the node is visited the first time, calculate node position.
+			if (neighbourNode->flags == 0)
+			{
+				getLinkMidPoint(bestRef, bestPoly, bestTile, i,
+								neighbourPoly, neighbourTile,
+								neighbourNode->pos);
+			}
+
+			// Calculate cost and heuristic.
+			const float cost = bestNode->cost + query.filter->getCost(bestNode->pos, neighbourNode->pos,
+																	   parentRef, parentTile, parentPoly,
+																	   bestRef, bestTile, bestPoly,
+																	   neighbourRef, neighbourTile, neighbourPoly);
+			DT_QUERY_STAT(m_stats.costCalls++);
+			const float heuristic = dtMinGoalDist(neighbourNode->pos, query.goalPositions, query.goalCount) * H_SCALE;
+			const float total = cost + heuristic;
+
+			// The node is already in open list and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+				continue;
+			// The node is already visited and process, and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_CLOSED) && total >= neighbourNode->total)
+				continue;
+
+			// Add or update the node.
+			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+			neighbourNode->id = neighbourRef;
+			neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
+			neighbourNode->cost = cost;
+			neighbourNode->total = total;
+
+			if (neighbourNode->flags & DT_NODE_OPEN)
+			{
+				// Already in open, update node location.
+				m_openList->modify(neighbourNode);
 			}
 			else
 			{
-				// End of the path.
-				dtVcopy(left, closestEndPos);
-				dtVcopy(right, closestEndPos);
-				
-				toType = DT_POLYTYPE_GROUND;
+				// Put the node in open list.
+				neighbourNode->flags |= DT_NODE_OPEN;
+				m_openList->push(neighbourNode);
+			}
+
+			// Update nearest node to the goals so far.
+			if (heuristic < query.lastBestNodeCost)
+			{
+				query.lastBestNodeCost = heuristic;
+				query.lastBestNode = neighbourNode;
+			}
+		}
+	}
+
+	// Exhausted all nodes, the goals found are final.
+	if (m_openList->empty())
+		done = true;
+
+	if (done)
+	{
+		// The path ends at the cheapest goal.
+		if (query.resultCount)
+		{
+			query.endRef = query.goalRefs[query.resultGoals[0]];
+			m_nodePool->findNodes(query.endRef, &query.lastBestNode, 1);
+		}
+		const dtStatus details = query.status & DT_STATUS_DETAIL_MASK;
+		query.status = DT_SUCCESS | details;
+	}
+
+	if (doneIters)
+		*doneIters = iter;
+
+	return query.status;
+}
+
+dtStatus dtNavMeshQuery::appendVertex(const float* pos, const unsigned char flags, const dtPolyRef ref,
+									  float* straightPath, unsigned char* straightPathFlags, dtPolyRef* straightPathRefs,
+									  int* straightPathCount, const int maxStraightPath) const
+{
+	if ((*straightPathCount) > 0 && dtVequal(&straightPath[((*straightPathCount)-1)*3], pos))
+	{
+		// The vertices are equal, update flags and poly.
+		if (straightPathFlags)
+			straightPathFlags[(*straightPathCount)-1] = flags;
+		if (straightPathRefs)
+			straightPathRefs[(*straightPathCount)-1] = ref;
+	}
+	else
+	{
+		// Append new vertex.
+		dtVcopy(&straightPath[(*straightPathCount)*3], pos);
+		if (straightPathFlags)
+			straightPathFlags[(*straightPathCount)] = flags;
+		if (straightPathRefs)
+			straightPathRefs[(*straightPathCount)] = ref;
+		(*straightPathCount)++;
+
+		// If there is no space to append more vertices, return.
+		if ((*straightPathCount) >= maxStraightPath)
+		{
+			return DT_SUCCESS | DT_BUFFER_TOO_SMALL;
+		}
+
+		// If reached end of path, return.
+		if (flags == DT_STRAIGHTPATH_END)
+		{
+			return DT_SUCCESS;
+		}
+	}
+	return DT_IN_PROGRESS;
+}
+
+dtStatus dtNavMeshQuery::appendPortals(const int startIdx, const int endIdx, const float* endPos, const dtPolyRef* path,
+									  float* straightPath, unsigned char* straightPathFlags, dtPolyRef* straightPathRefs,
+									  int* straightPathCount, const int maxStraightPath, const int options) const
+{
+	const float* startPos = &straightPath[(*straightPathCount-1)*3];
+	// Append or update last vertex
+	dtStatus stat = 0;
+	for (int i = startIdx; i < endIdx; i++)
+	{
+		// Calculate portal
+		const dtPolyRef from = path[i];
+		const dtMeshTile* fromTile = 0;
+		const dtPoly* fromPoly = 0;
+		if (dtStatusFailed(m_nav->getTileAndPolyByRef(from, &fromTile, &fromPoly)))
+			return DT_FAILURE | DT_INVALID_PARAM;
+		
+		const dtPolyRef to = path[i+1];
+		const dtMeshTile* toTile = 0;
+		const dtPoly* toPoly = 0;
+		if (dtStatusFailed(m_nav->getTileAndPolyByRef(to, &toTile, &toPoly)))
+			return DT_FAILURE | DT_INVALID_PARAM;
+		
+		float left[3], right[3];
+		if (dtStatusFailed(getPortalPoints(from, fromPoly, fromTile, to, toPoly, toTile, left, right)))
+			break;
+	
+		if (options & DT_STRAIGHTPATH_AREA_CROSSINGS)
+		{
+			// Skip intersection if only area crossings are requested.
+			if (fromPoly->getArea() == toPoly->getArea())
+				continue;
+		}
+		
+		// Append intersection
+		float s,t;
+		if (dtIntersectSegSeg2D(startPos, endPos, left, right, s, t))
+		{
+			float pt[3];
+			dtVlerp(pt, left,right, t);
+
+			stat = appendVertex(pt, 0, path[i+1],
+								straightPath, straightPathFlags, straightPathRefs,
+								straightPathCount, maxStraightPath);
+			if (stat != DT_IN_PROGRESS)
+				return stat;
+		}
+	}
+	return DT_IN_PROGRESS;
+}
+
+/// @par
+/// 
+/// This method peforms what is often called 'string pulling'.
+///
+/// The start position is clamped to the first polygon in the path, and the 
+/// end position is clamped to the last. So the start and end positions should 
+/// normally be within or very near the first and last polygons respectively.
+///
+/// The returned polygon references represent the reference id of the polygon 
+/// that is entered at the associated path position. The reference id associated 
+/// with the end point will always be zero.  This allows, for example, matching 
+/// off-mesh link points to their representative polygons.
+///
+/// If the provided result buffers are too small for the entire result set, 
+/// they will be filled as far as possible from the start toward the end 
+/// position.
+///
+/// The first dtPortalCache::count portals of @p portalCache are used in place of
+/// the portals between the leading polygons of @p path, so they must have been
+/// computed for the same polygons. The portals computed past them are appended
+/// while there is room. Portals which cannot be computed are never cached.
+///
+dtStatus dtNavMeshQuery::findStraightPath(const float* startPos, const float* endPos,
+										  const dtPolyRef* path, const int pathSize,
+										  float* straightPath, unsigned char* straightPathFlags, dtPolyRef* straightPathRefs,
+										  int* straightPathCount, const int maxStraightPath, const int options,
+										  dtPortalCache* portalCache) const
+{
+	dtAssert(m_nav);
+
+	if (!straightPathCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*straightPathCount = 0;
+
+	if (!startPos || !dtVisfinite(startPos) ||
+		!endPos || !dtVisfinite(endPos) ||
+		!path || pathSize <= 0 || !path[0] ||
+		maxStraightPath <= 0)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+	
+	dtStatus stat = 0;
+	
+	// TODO: Should this be callers responsibility?
+	float closestStartPos[3];
+	if (dtStatusFailed(closestPointOnPolyBoundary(path[0], startPos, closestStartPos)))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	float closestEndPos[3];
+	if (dtStatusFailed(closestPointOnPolyBoundary(path[pathSize-1], endPos, closestEndPos)))
+		return DT_FAILURE | DT_INVALID_PARAM;
+	
+	// Add start point.
+	stat = appendVertex(closestStartPos, DT_STRAIGHTPATH_START, path[0],
+						straightPath, straightPathFlags, straightPathRefs,
+						straightPathCount, maxStraightPath);
+	if (stat != DT_IN_PROGRESS)
+		return stat;
+	
+	if (pathSize > 1)
+	{
+		float portalApex[3], portalLeft[3], portalRight[3];
+		dtVcopy(portalApex, closestStartPos);
+		dtVcopy(portalLeft, portalApex);
+		dtVcopy(portalRight, portalApex);
+		int apexIndex = 0;
+		int leftIndex = 0;
+		int rightIndex = 0;
+		
+		unsigned char leftPolyType = 0;
+		unsigned char rightPolyType = 0;
+		
+		dtPolyRef leftPolyRef = path[0];
+		dtPolyRef rightPolyRef = path[0];
+		
+		for (int i = 0; i < pathSize; ++i)
+		{
+			float left[3], right[3];
+			unsigned char toType;
+			
+			if (i+1 < pathSize)
+			{
+				unsigned char fromType; // fromType is ignored.
+
+				// Next portal, from the cache if it is there.
+				dtStatus portalStatus = DT_SUCCESS;
+				if (portalCache && i < portalCache->count)
+				{
+					dtVcopy(left, &portalCache->portals[i*6]);
+					dtVcopy(right, &portalCache->portals[i*6+3]);
+					toType = portalCache->types[i];
+				}
+				else
+				{
+					portalStatus = getPortalPoints(path[i], path[i+1], left, right, fromType, toType);
+					if (dtStatusSucceed(portalStatus) && portalCache &&
+						i == portalCache->count && i < portalCache->capacity)
+					{
+						dtVcopy(&portalCache->portals[i*6], left);
+						dtVcopy(&portalCache->portals[i*6+3], right);
+						portalCache->types[i] = toType;
+						portalCache->count++;
+					}
+				}
+				if (dtStatusFailed(portalStatus))
+				{
+					// Failed to get portal points, in practice this means that path[i+1] is invalid polygon.
+					// Clamp the end point to path[i], and return the path so far.
+					
+					if (dtStatusFailed(closestPointOnPolyBoundary(path[i], endPos, closestEndPos)))
+					{
+						// This should only happen when the first polygon is invalid.
+						return DT_FAILURE | DT_INVALID_PARAM;
+					}
+
+					// Apeend portals along the current straight path segment.
+					if (options & (DT_STRAIGHTPATH_AREA_CROSSINGS | DT_STRAIGHTPATH_ALL_CROSSINGS))
+					{
+						// Ignore status return value as we're just about to return anyway.
+						appendPortals(apexIndex, i, closestEndPos, path,
+											 straightPath, straightPathFlags, straightPathRefs,
+											 straightPathCount, maxStraightPath, options);
+					}
+
+					// Ignore status return value as we're just about to return anyway.
+					appendVertex(closestEndPos, 0, path[i],
+										straightPath, straightPathFlags, straightPathRefs,
+										straightPathCount, maxStraightPath);
+					
+					return DT_SUCCESS | DT_PARTIAL_RESULT | ((*straightPathCount >= maxStraightPath) ? DT_BUFFER_TOO_SMALL : 0);
+				}
+				
+				// If starting really close the portal, advance.
+				if (i == 0)
+				{
+					float t;
+					if (dtDistancePtSegSqr2D(portalApex, left, right, t) < dtSqr(0.001f))
+						continue;
+				}
+			}
+			else
+			{
+				// End of the path.
+				dtVcopy(left, closestEndPos);
+				dtVcopy(right, closestEndPos);
+				
+				toType = DT_POLYTYPE_GROUND;
+			}
+			
+			// Right vertex.
+			if (dtTriArea2D(portalApex, portalRight, right) <= 0.0f)
+			{
+				if (dtVequal(portalApex, portalRight) || dtTriArea2D(portalApex, portalLeft, right) > 0.0f)
+				{
+					dtVcopy(portalRight, right);
+					rightPolyRef = (i+1 < pathSize) ? path[i+1] : 0;
+					rightPolyType = toType;
+					rightIndex = i;
+				}
+				else
+				{
+					// Append portals along the current straight path segment.
+					if (options & (DT_STRAIGHTPATH_AREA_CROSSINGS | DT_STRAIGHTPATH_ALL_CROSSINGS))
+					{
+						stat = appendPortals(apexIndex, leftIndex, portalLeft, path,
+											 straightPath, straightPathFlags, straightPathRefs,
+											 straightPathCount, maxStraightPath, options);
+						if (stat != DT_IN_PROGRESS)
+							return stat;					
+					}
+				
+					dtVcopy(portalApex, portalLeft);
+					apexIndex = leftIndex;
+					
+					unsigned char flags = 0;
+					if (!leftPolyRef)
+						flags = DT_STRAIGHTPATH_END;
+					else if (leftPolyType == DT_POLYTYPE_OFFMESH_CONNECTION)
+						flags = DT_STRAIGHTPATH_OFFMESH_CONNECTION;
+					dtPolyRef ref = leftPolyRef;
+					
+					// Append or update vertex
+					stat = appendVertex(portalApex, flags, ref,
+										straightPath, straightPathFlags, straightPathRefs,
+										straightPathCount, maxStraightPath);
+					if (stat != DT_IN_PROGRESS)
+						return stat;
+					
+					dtVcopy(portalLeft, portalApex);
+					dtVcopy(portalRight, portalApex);
+					leftIndex = apexIndex;
+					rightIndex = apexIndex;
+					
+					// Restart
+					i = apexIndex;
+					
+					continue;
+				}
+			}
+			
+			// Left vertex.
+			if (dtTriArea2D(portalApex, portalLeft, left) >= 0.0f)
+			{
+				if (dtVequal(portalApex, portalLeft) || dtTriArea2D(portalApex, portalRight, left) < 0.0f)
+				{
+					dtVcopy(portalLeft, left);
+					leftPolyRef = (i+1 < pathSize) ? path[i+1] : 0;
+					leftPolyType = toType;
+					leftIndex = i;
+				}
+				else
+				{
+					// Append portals along the current straight path segment.
+					if (options & (DT_STRAIGHTPATH_AREA_CROSSINGS | DT_STRAIGHTPATH_ALL_CROSSINGS))
+					{
+						stat = appendPortals(apexIndex, rightIndex, portalRight, path,
+											 straightPath, straightPathFlags, straightPathRefs,
+											 straightPathCount, maxStraightPath, options);
+						if (stat != DT_IN_PROGRESS)
+							return stat;
+					}
+
+					dtVcopy(portalApex, portalRight);
+					apexIndex = rightIndex;
+					
+					unsigned char flags = 0;
+					if (!rightPolyRef)
+						flags = DT_STRAIGHTPATH_END;
+					else if (rightPolyType == DT_POLYTYPE_OFFMESH_CONNECTION)
+						flags = DT_STRAIGHTPATH_OFFMESH_CONNECTION;
+					dtPolyRef ref = rightPolyRef;
+
+					// Append or update vertex
+					stat = appendVertex(portalApex, flags, ref,
+										straightPath, straightPathFlags, straightPathRefs,
+										straightPathCount, maxStraightPath);
+					if (stat != DT_IN_PROGRESS)
+						return stat;
+					
+					dtVcopy(portalLeft, portalApex);
+					dtVcopy(portalRight, portalApex);
+					leftIndex = apexIndex;
+					rightIndex = apexIndex;
+					
+					// Restart
+					i = apexIndex;
+					
+					continue;
+				}
+			}
+		}
+
+		// Append portals along the current straight path segment.
+		if (options & (DT_STRAIGHTPATH_AREA_CROSSINGS | DT_STRAIGHTPATH_ALL_CROSSINGS))
+		{
+			stat = appendPortals(apexIndex, pathSize-1, closestEndPos, path,
+								 straightPath, straightPathFlags, straightPathRefs,
+								 straightPathCount, maxStraightPath, options);
+			if (stat != DT_IN_PROGRESS)
+				return stat;
+		}
+	}
+
+	// Ignore status return value as we're just about to return anyway.
+	appendVertex(closestEndPos, DT_STRAIGHTPATH_END, 0,
+						straightPath, straightPathFlags, straightPathRefs,
+						straightPathCount, maxStraightPath);
+	
+	return DT_SUCCESS | ((*straightPathCount >= maxStraightPath) ? DT_BUFFER_TOO_SMALL : 0);
+}
+
+/// @par
+///
+/// This method is optimized for small delta movement and a small number of 
+/// polygons. If used for too great a distance, the result set will form an 
+/// incomplete path.
+///
+/// @p resultPos will equal the @p endPos if the end is reached. 
+/// Otherwise the closest reachable position will be returned.
+/// 
+/// @p resultPos is not projected onto the surface of the navigation 
+/// mesh. Use #getPolyHeight if this is needed.
+///
+/// This method treats the end position in the same manner as 
+/// the #raycast method. (As a 2D point.) See that method's documentation 
+/// for details.
+/// 
+/// If the @p visited array is too small to hold the entire result set, it will 
+/// be filled as far as possible from the start position toward the end 
+/// position.
+///
+dtStatus dtNavMeshQuery::moveAlongSurface(dtPolyRef startRef, const float* startPos, const float* endPos,
+										  const dtQueryFilter* filter,
+										  float* resultPos, dtPolyRef* visited, int* visitedCount, const int maxVisitedSize) const
+{
+	dtAssert(m_nav);
+	dtAssert(m_tinyNodePool);
+
+	if (!visitedCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*visitedCount = 0;
+
+	if (!m_nav->isValidPolyRef(startRef) ||
+		!startPos || !dtVisfinite(startPos) ||
+		!endPos || !dtVisfinite(endPos) ||
+		!filter || !resultPos || !visited ||
+		maxVisitedSize <= 0)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	return moveAlongSurfaceUnchecked(startRef, startPos, endPos, filter, resultPos, visited, visitedCount, maxVisitedSize);
+}
+
+/// @par
+///
+/// The moves are processed in groups sharing their start tile, so each tile is
+/// touched once per group, reusing the small search state of the query. The
+/// result positions are projected onto the height of the last visited polygon,
+/// which is how #dtPathCorridor::movePosition uses #moveAlongSurface and #getPolyHeight. 
+/// If the result is outside the polygon, the height of the start position is kept.
+///
+/// Invalid moves fail individually with #DT_INVALID_PARAM in their status.
+/// A query is not thread safe, concurrent batches need a query object each.
+dtStatus dtNavMeshQuery::moveAlongSurfaceBatch(dtSurfaceMove* moves, const int count) const
+{
+	dtAssert(m_nav);
+	dtAssert(m_tinyNodePool);
+
+	if (count < 0 || (count > 0 && !moves))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	// Order the moves by start tile, a group at a time.
+	static const int GROUP_SIZE = 64;
+	int order[GROUP_SIZE];
+	for (int first = 0; first < count; first += GROUP_SIZE)
+	{
+		const int n = dtMin(count - first, GROUP_SIZE);
+		for (int i = 0; i < n; ++i)
+		{
+			const unsigned int tile = m_nav->decodePolyIdTile(moves[first + i].startRef);
+			int j = i;
+			while (j > 0 && m_nav->decodePolyIdTile(moves[first + order[j-1]].startRef) > tile)
+			{
+				order[j] = order[j-1];
+				j--;
+			}
+			order[j] = i;
+		}
+
+		for (int i = 0; i < n; ++i)
+		{
+			dtSurfaceMove& move = moves[first + order[i]];
+			move.visitedCount = 0;
+			if (!m_nav->isValidPolyRef(move.startRef) ||
+				!dtVisfinite(move.startPos) || !dtVisfinite(move.endPos) ||
+				!move.filter || !move.visited || move.maxVisited <= 0)
+			{
+				move.status = DT_FAILURE | DT_INVALID_PARAM;
+				continue;
+			}
+
+			move.status = moveAlongSurfaceUnchecked(move.startRef, move.startPos, move.endPos, move.filter,
+													move.resultPos, move.visited, &move.visitedCount, move.maxVisited);
+			if (dtStatusFailed(move.status))
+				continue;
+
+			// Place the result on the surface of the polygon the move ended in.
+			const dtPolyRef endRef = move.visitedCount ? move.visited[move.visitedCount-1] : move.startRef;
+			const dtMeshTile* tile = 0;
+			const dtPoly* poly = 0;
+			m_nav->getTileAndPolyByRefUnsafe(endRef, &tile, &poly);
+			float h = move.startPos[1];
+			getPolyHeight(tile, poly, move.resultPos, &h);
+			move.resultPos[1] = h;
+		}
+	}
+
+	return DT_SUCCESS;
+}
+
+dtStatus dtNavMeshQuery::moveAlongSurfaceUnchecked(dtPolyRef startRef, const float* startPos, const float* endPos,
+												   const dtQueryFilter* filter, float* resultPos,
+												   dtPolyRef* visited, int* visitedCount, const int maxVisitedSize) const
+{
+	dtStatus status = DT_SUCCESS;
+
+	*visitedCount = 0;
+
+	// Most moves stay within the start polygon, skip the search for them.
+	{
+		const dtMeshTile* startTile = 0;
+		const dtPoly* startPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(startRef, &startTile, &startPoly);
+		float startVerts[DT_VERTS_PER_POLYGON*3];
+		const int nverts = startPoly->vertCount;
+		for (int i = 0; i < nverts; ++i)
+			dtGetTileVertex(startTile, startPoly->verts[i], &startVerts[i*3]);
+		if (dtPointInPolygon(endPos, startVerts, nverts))
+		{
+			DT_QUERY_STAT(m_stats.nodesExpanded++);
+			visited[0] = startRef;
+			*visitedCount = 1;
+			if (maxVisitedSize <= 1)
+				status |= DT_BUFFER_TOO_SMALL;
+			dtVcopy(resultPos, endPos);
+			DT_QUERY_STAT(countQuery(status, 1));
+			return status;
+		}
+	}
+	
+	static const int MAX_STACK = 48;
+	dtNode* stack[MAX_STACK];
+	int nstack = 0;
+	
+	m_tinyNodePool->clear();
+	
+	dtNode* startNode = m_tinyNodePool->getNode(startRef);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = 0;
+	startNode->id = startRef;
+	startNode->flags = DT_NODE_CLOSED;
+	stack[nstack++] = startNode;
+	
+	float bestPos[3];
+	float bestDist = FLT_MAX;
+	dtNode* bestNode = 0;
+	dtVcopy(bestPos, startPos);
+	
+	// Search constraints
+	float searchPos[3], searchRadSqr;
+	dtVlerp(searchPos, startPos, endPos, 0.5f);
+	searchRadSqr = dtSqr(dtVdist(startPos, endPos)/2.0f + 0.001f);
+	
+	float verts[DT_VERTS_PER_POLYGON*3];
+	
+	while (nstack)
+	{
+		// Pop front.
+		dtNode* curNode = stack[0];
+		for (int i = 0; i < nstack-1; ++i)
+			stack[i] = stack[i+1];
+		nstack--;
+		
+		// Get poly and tile.
+		// The API input has been checked already, skip checking internal data.
+		const dtPolyRef curRef = curNode->id;
+		const dtMeshTile* curTile = 0;
+		const dtPoly* curPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(curRef, &curTile, &curPoly);			
+		DT_QUERY_STAT(m_stats.nodesExpanded++);
+		
+		// Collect vertices.
+		const int nverts = curPoly->vertCount;
+		for (int i = 0; i < nverts; ++i)
+			dtGetTileVertex(curTile, curPoly->verts[i], &verts[i*3]);
+		
+		// If target is inside the poly, stop search.
+		if (dtPointInPolygon(endPos, verts, nverts))
+		{
+			bestNode = curNode;
+			dtVcopy(bestPos, endPos);
+			break;
+		}
+		
+		// Find wall edges and find nearest point inside the walls.
+		for (int i = 0, j = (int)curPoly->vertCount-1; i < (int)curPoly->vertCount; j = i++)
+		{
+			// Find links to neighbours.
+			static const int MAX_NEIS = 8;
+			int nneis = 0;
+			dtPolyRef neis[MAX_NEIS];
+			
+			// Edges narrower than the agent are walls.
+			const bool passable = dtPassEdgeClearance(curTile, curPoly, j, filter->getAgentRadius());
+			if (passable && (curPoly->neis[j] & DT_EXT_LINK))
+			{
+				// Tile border.
+				for (unsigned int k = curPoly->firstLink; k != DT_NULL_LINK; k = curTile->links[k].next)
+				{
+					const dtLink* link = &curTile->links[k];
+					if (link->edge == j)
+					{
+						if (link->ref != 0)
+						{
+							const dtMeshTile* neiTile = 0;
+							const dtPoly* neiPoly = 0;
+							m_nav->getTileAndPolyByRefUnsafe(link->ref, &neiTile, &neiPoly);
+							DT_QUERY_STAT(m_stats.filterCalls++);
+							if (filter->passFilter(link->ref, neiTile, neiPoly))
+							{
+								DT_QUERY_STAT(m_stats.tilesTouched += neiTile != curTile);
+								if (nneis < MAX_NEIS)
+									neis[nneis++] = link->ref;
+							}
+						}
+					}
+				}
+			}
+			else if (passable && curPoly->neis[j])
+			{
+				const unsigned int idx = (unsigned int)(curPoly->neis[j]-1);
+				const dtPolyRef ref = m_nav->getPolyRefBase(curTile) | idx;
+				DT_QUERY_STAT(m_stats.filterCalls++);
+				if (filter->passFilter(ref, curTile, &curTile->polys[idx]))
+				{
+					// Internal edge, encode id.
+					neis[nneis++] = ref;
+				}
+			}
+			
+			if (!nneis)
+			{
+				// Wall edge, calc distance.
+				const float* vj = &verts[j*3];
+				const float* vi = &verts[i*3];
+				float tseg;
+				const float distSqr = dtDistancePtSegSqr2D(endPos, vj, vi, tseg);
+				if (distSqr < bestDist)
+				{
+                    // Update nearest distance.
+					dtVlerp(bestPos, vj,vi, tseg);
+					bestDist = distSqr;
+					bestNode = curNode;
+				}
+			}
+			else
+			{
+				for (int k = 0; k < nneis; ++k)
+				{
+					// Skip if no node can be allocated.
+					dtNode* neighbourNode = m_tinyNodePool->getNode(neis[k]);
+					if (!neighbourNode)
+						continue;
+					// Skip if already visited.
+					if (neighbourNode->flags & DT_NODE_CLOSED)
+						continue;
+					
+					// Skip the link if it is too far from search constraint.
+					// TODO: Maybe should use getPortalPoints(), but this one is way faster.
+					const float* vj = &verts[j*3];
+					const float* vi = &verts[i*3];
+					float tseg;
+					float distSqr = dtDistancePtSegSqr2D(searchPos, vj, vi, tseg);
+					if (distSqr > searchRadSqr)
+						continue;
+					
+					// Mark as the node as visited and push to queue.
+					if (nstack < MAX_STACK)
+					{
+						neighbourNode->pidx = m_tinyNodePool->getNodeIdx(curNode);
+						neighbourNode->flags |= DT_NODE_CLOSED;
+						stack[nstack++] = neighbourNode;
+					}
+				}
+			}
+		}
+	}
+	
+	int n = 0;
+	if (bestNode)
+	{
+		// Reverse the path.
+		dtNode* prev = 0;
+		dtNode* node = bestNode;
+		do
+		{
+			dtNode* next = m_tinyNodePool->getNodeAtIdx(node->pidx);
+			node->pidx = m_tinyNodePool->getNodeIdx(prev);
+			prev = node;
+			node = next;
+		}
+		while (node);
+		
+		// Store result
+		node = prev;
+		do
+		{
+			visited[n++] = node->id;
+			if (n >= maxVisitedSize)
+			{
+				status |= DT_BUFFER_TOO_SMALL;
+				break;
+			}
+			node = m_tinyNodePool->getNodeAtIdx(node->pidx);
+		}
+		while (node);
+	}
+	
+	dtVcopy(resultPos, bestPos);
+	
+	*visitedCount = n;
+
+	DT_QUERY_STAT(countQuery(status, m_tinyNodePool->getNodeCount()));
+	
+	return status;
+}
+
+
+dtStatus dtNavMeshQuery::getPortalPoints(dtPolyRef from, dtPolyRef to, float* left, float* right,
+										 unsigned char& fromType, unsigned char& toType) const
+{
+	dtAssert(m_nav);
+	
+	const dtMeshTile* fromTile = 0;
+	const dtPoly* fromPoly = 0;
+	if (dtStatusFailed(m_nav->getTileAndPolyByRef(from, &fromTile, &fromPoly)))
+		return DT_FAILURE | DT_INVALID_PARAM;
+	fromType = fromPoly->getType();
+
+	const dtMeshTile* toTile = 0;
+	const dtPoly* toPoly = 0;
+	if (dtStatusFailed(m_nav->getTileAndPolyByRef(to, &toTile, &toPoly)))
+		return DT_FAILURE | DT_INVALID_PARAM;
+	toType = toPoly->getType();
+		
+	return getPortalPoints(from, fromPoly, fromTile, to, toPoly, toTile, left, right);
+}
+
+// Returns portal points between two polygons.
+dtStatus dtNavMeshQuery::getPortalPoints(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile,
+										 dtPolyRef to, const dtPoly* toPoly, const dtMeshTile* toTile,
+										 float* left, float* right) const
+{
+	// Find the link that points to the 'to' polygon.
+	for (unsigned int i = fromPoly->firstLink; i != DT_NULL_LINK; i = fromTile->links[i].next)
+	{
+		if (fromTile->links[i].ref == to)
+			return getLinkPortalPoints(from, fromPoly, fromTile, i, toPoly, toTile, left, right);
+	}
+	return DT_FAILURE | DT_INVALID_PARAM;
+}
+
+/// @par
+///
+/// The searches which already iterate the links of a polygon use this to
+/// avoid walking the link list again to find the link of the neighbour.
+/// With #DT_NAVMESH_PORTAL_CACHE the portal of a polygon edge link is read
+/// from dtMeshTile::linkPortals.
+dtStatus dtNavMeshQuery::getLinkPortalPoints(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile,
+											 const unsigned int linkIdx, const dtPoly* toPoly, const dtMeshTile* toTile,
+											 float* left, float* right) const
+{
+	const dtLink* link = &fromTile->links[linkIdx];
+
+	// Handle off-mesh connections.
+	if (fromPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		dtGetTileVertex(fromTile, fromPoly->verts[link->edge], left);
+		dtVcopy(right, left);
+		return DT_SUCCESS;
+	}
+	
+	if (toPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		for (unsigned int i = toPoly->firstLink; i != DT_NULL_LINK; i = toTile->links[i].next)
+		{
+			if (toTile->links[i].ref == from)
+			{
+				const int v = toTile->links[i].edge;
+				dtGetTileVertex(toTile, toPoly->verts[v], left);
+				dtGetTileVertex(toTile, toPoly->verts[v], right);
+				return DT_SUCCESS;
+			}
+		}
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+	
+	// Use the cached portal if there is one.
+	if (fromTile->linkPortals)
+	{
+		const float* portal = &fromTile->linkPortals[linkIdx*6];
+		dtVcopy(left, portal);
+		dtVcopy(right, portal+3);
+		return DT_SUCCESS;
+	}
+
+	// Find portal vertices.
+	float v0[3], v1[3];
+	dtGetTileVertex(fromTile, fromPoly->verts[link->edge], v0);
+	dtGetTileVertex(fromTile, fromPoly->verts[(link->edge+1) % (int)fromPoly->vertCount], v1);
+	dtVcopy(left, v0);
+	dtVcopy(right, v1);
+	
+	// If the link is at tile boundary, dtClamp the vertices to
+	// the link width.
+	if (link->side != 0xff)
+	{
+		// Unpack portal limits.
+		if (link->bmin != 0 || link->bmax != 255)
+		{
+			const float s = 1.0f/255.0f;
+			const float tmin = link->bmin*s;
+			const float tmax = link->bmax*s;
+			dtVlerp(left, v0, v1, tmin);
+			dtVlerp(right, v0, v1, tmax);
+		}
+	}
+	
+	return DT_SUCCESS;
+}
+
+dtStatus dtNavMeshQuery::getLinkMidPoint(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile,
+										 const unsigned int linkIdx, const dtPoly* toPoly, const dtMeshTile* toTile,
+										 float* mid) const
+{
+	float left[3], right[3];
+	if (dtStatusFailed(getLinkPortalPoints(from, fromPoly, fromTile, linkIdx, toPoly, toTile, left, right)))
+		return DT_FAILURE | DT_INVALID_PARAM;
+	mid[0] = (left[0]+right[0])*0.5f;
+	mid[1] = (left[1]+right[1])*0.5f;
+	mid[2] = (left[2]+right[2])*0.5f;
+	return DT_SUCCESS;
+}
+
+// Returns edge mid point between two polygons.
+dtStatus dtNavMeshQuery::getEdgeMidPoint(dtPolyRef from, dtPolyRef to, float* mid) const
+{
+	float left[3], right[3];
+	unsigned char fromType, toType;
+	if (dtStatusFailed(getPortalPoints(from, to, left,right, fromType, toType)))
+		return DT_FAILURE | DT_INVALID_PARAM;
+	mid[0] = (left[0]+right[0])*0.5f;
+	mid[1] = (left[1]+right[1])*0.5f;
+	mid[2] = (left[2]+right[2])*0.5f;
+	return DT_SUCCESS;
+}
+
+dtStatus dtNavMeshQuery::getEdgeMidPoint(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile,
+										 dtPolyRef to, const dtPoly* toPoly, const dtMeshTile* toTile,
+										 float* mid) const
+{
+	float left[3], right[3];
+	if (dtStatusFailed(getPortalPoints(from, fromPoly, fromTile, to, toPoly, toTile, left, right)))
+		return DT_FAILURE | DT_INVALID_PARAM;
+	mid[0] = (left[0]+right[0])*0.5f;
+	mid[1] = (left[1]+right[1])*0.5f;
+	mid[2] = (left[2]+right[2])*0.5f;
+	return DT_SUCCESS;
+}
+
+
+
+/// @par
+///
+/// This method is meant to be used for quick, short distance checks.
+///
+/// If the path array is too small to hold the result, it will be filled as 
+/// far as possible from the start postion toward the end position.
+///
+/// <b>Using the Hit Parameter (t)</b>
+/// 
+/// If the hit parameter is a very high value (FLT_MAX), then the ray has hit 
+/// the end position. In this case the path represents a valid corridor to the 
+/// end position and the value of @p hitNormal is undefined.
+///
+/// If the hit parameter is zero, then the start position is on the wall that 
+/// was hit and the value of @p hitNormal is undefined.
+///
+/// If 0 < t < 1.0 then the following applies:
+///
+/// @code
+/// distanceToHitBorder = distanceToEndPosition * t
+/// hitPoint = startPos + (endPos - startPos) * t
+/// @endcode
+///
+/// <b>Use Case Restriction</b>
+///
+/// The raycast ignores the y-value of the end position. (2D check.) This 
+/// places significant limits on how it can be used. For example:
+///
+/// Consider a scene where there is a main floor with a second floor balcony 
+/// that hangs over the main floor. So the first floor mesh extends below the 
+/// balcony mesh. The start position is somewhere on the first floor. The end 
+/// position is on the balcony.
+///
+/// The raycast will search toward the end position along the first floor mesh. 
+/// If it reaches the end position's xz-coordinates it will indicate FLT_MAX
+/// (no wall hit), meaning it reached the end position. This is one example of why
+/// this method is meant for short distance checks.
+///
+dtStatus dtNavMeshQuery::raycast(dtPolyRef startRef, const float* startPos, const float* endPos,
+								 const dtQueryFilter* filter,
+								 float* t, float* hitNormal, dtPolyRef* path, int* pathCount, const int maxPath) const
+{
+	dtRaycastHit hit;
+	hit.path = path;
+	hit.maxPath = maxPath;
+
+	dtStatus status = raycast(startRef, startPos, endPos, filter, 0, &hit);
+	
+	*t = hit.t;
+	if (hitNormal)
+		dtVcopy(hitNormal, hit.hitNormal);
+	if (pathCount)
+		*pathCount = hit.pathCount;
+
+	return status;
+}
+
+
+/// @par
+///
+/// This method is meant to be used for quick, short distance checks.
+///
+/// If the path array is too small to hold the result, it will be filled as 
+/// far as possible from the start postion toward the end position.
+///
+/// <b>Using the Hit Parameter t of RaycastHit</b>
+/// 
+/// If the hit parameter is a very high value (FLT_MAX), then the ray has hit 
+/// the end position. In this case the path represents a valid corridor to the 
+/// end position and the value of @p hitNormal is undefined.
+///
+/// If the hit parameter is zero, then the start position is on the wall that 
+/// was hit and the value of @p hitNormal is undefined.
+///
+/// If 0 < t < 1.0 then the following applies:
+///
+/// @code
+/// distanceToHitBorder = distanceToEndPosition * t
+/// hitPoint = startPos + (endPos - startPos) * t
+/// @endcode
+///
+/// <b>Use Case Restriction</b>
+///
+/// The raycast ignores the y-value of the end position. (2D check.) This 
+/// places significant limits on how it can be used. For example:
+///
+/// Consider a scene where there is a main floor with a second floor balcony 
+/// that hangs over the main floor. So the first floor mesh extends below the 
+/// balcony mesh. The start position is somewhere on the first floor. The end 
+/// position is on the balcony.
+///
+/// The raycast will search toward the end position along the first floor mesh. 
+/// If it reaches the end position's xz-coordinates it will indicate FLT_MAX
+/// (no wall hit), meaning it reached the end position. This is one example of why
+/// this method is meant for short distance checks.
+///
+dtStatus dtNavMeshQuery::raycast(dtPolyRef startRef, const float* startPos, const float* endPos,
+								 const dtQueryFilter* filter, const unsigned int options,
+								 dtRaycastHit* hit, dtPolyRef prevRef) const
+{
+	dtAssert(m_nav);
+
+	if (!hit)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	hit->t = 0;
+	hit->pathCount = 0;
+	hit->pathCost = 0;
+
+	// Validate input
+	if (!m_nav->isValidPolyRef(startRef) ||
+		!startPos || !dtVisfinite(startPos) ||
+		!endPos || !dtVisfinite(endPos) ||
+		!filter ||
+		(prevRef && !m_nav->isValidPolyRef(prevRef)))
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+	
+	dtRaycastState state;
+	initRaycast(state, startRef, startPos, prevRef, hit);
+
+	float verts[DT_VERTS_PER_POLYGON*3+3];	
+	dtStatus status = DT_SUCCESS;
+
+	while (state.curRef)
+	{
+		// Cast ray against current polygon.
+		
+		// Collect vertices.
+		int nv = 0;
+		for (int i = 0; i < (int)state.poly->vertCount; ++i)
+		{
+			dtGetTileVertex(state.tile, state.poly->verts[i], &verts[nv*3]);
+			nv++;
+		}
+		
+		float tmin, tmax;
+		int segMin, segMax;
+		if (!dtIntersectSegmentPoly2D(startPos, endPos, verts, nv, tmin, tmax, segMin, segMax))
+		{
+			// Could not hit the polygon, keep the old t and report hit.
+			break;
+		}
+
+		if (!advanceRaycast(state, startPos, endPos, filter, options, hit, verts, nv, tmax, segMax, status))
+			break;
+	}
+	
+	hit->pathCount = state.n;
+
+	DT_QUERY_STAT(countQuery(status, 0));
+	
+	return status;
+}
+
+void dtNavMeshQuery::initRaycast(dtRaycastState& state, dtPolyRef startRef, const float* startPos,
+								 dtPolyRef prevRef, dtRaycastHit* hit) const
+{
+	dtVcopy(state.curPos, startPos);
+	dtVset(hit->hitNormal, 0, 0, 0);
+	state.n = 0;
+
+	// The API input has been checked already, skip checking internal data.
+	state.curRef = startRef;
+	state.prevRef = prevRef;
+	state.tile = 0;
+	state.poly = 0;
+	m_nav->getTileAndPolyByRefUnsafe(state.curRef, &state.tile, &state.poly);
+	state.prevTile = state.tile;
+	state.prevPoly = state.poly;
+	if (prevRef)
+		m_nav->getTileAndPolyByRefUnsafe(prevRef, &state.prevTile, &state.prevPoly);
+}
+
+bool dtNavMeshQuery::advanceRaycast(dtRaycastState& state, const float* startPos, const float* endPos,
+									const dtQueryFilter* filter, const unsigned int options, dtRaycastHit* hit,
+									const float* verts, const int nv, const float tmax, const int segMax,
+									dtStatus& status) const
+{
+	const dtMeshTile* tile = state.tile;
+	const dtPoly* poly = state.poly;
+	const dtPolyRef curRef = state.curRef;
+	const dtMeshTile* nextTile = tile;
+	const dtPoly* nextPoly = poly;
+
+	hit->hitEdgeIndex = segMax;
+	DT_QUERY_STAT(m_stats.nodesExpanded++);
+
+	// Keep track of furthest t so far.
+	if (tmax > hit->t)
+		hit->t = tmax;
+	
+	// Store visited polygons.
+	if (state.n < hit->maxPath)
+		hit->path[state.n++] = curRef;
+	else
+		status |= DT_BUFFER_TOO_SMALL;
+
+	// Ray end is completely inside the polygon.
+	if (segMax == -1)
+	{
+		hit->t = FLT_MAX;
+		hit->pathCount = state.n;
+		
+		// add the cost
+		if (options & DT_RAYCAST_USE_COSTS)
+		{
+			hit->pathCost += filter->getCost(state.curPos, endPos, state.prevRef, state.prevTile, state.prevPoly, curRef, tile, poly, curRef, tile, poly);
+			DT_QUERY_STAT(m_stats.costCalls++);
+		}
+		return false;
+	}
+
+	// Follow neighbours.
+	dtPolyRef nextRef = 0;
+	
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+	{
+		const dtLink* link = &tile->links[i];
+		
+		// Find link which contains this edge.
+		if ((int)link->edge != segMax)
+			continue;
+
+		// Edges narrower than the agent are walls.
+		if (!dtPassEdgeClearance(tile, poly, segMax, filter->getAgentRadius()))
+			continue;
+		
+		// Get pointer to the next polygon.
+		nextTile = 0;
+		nextPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(link->ref, &nextTile, &nextPoly);
+		
+		// Skip off-mesh connections.
+		if (nextPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+			continue;
+		
+		// Skip links based on filter.
+		DT_QUERY_STAT(m_stats.filterCalls++);
+		if (!filter->passFilter(link->ref, nextTile, nextPoly))
+			continue;
+		
+		// If the link is internal, just return the ref.
+		if (link->side == 0xff)
+		{
+			nextRef = link->ref;
+			break;
+		}
+		
+		// If the link is at tile boundary,
+		
+		// Check if the link spans the whole edge, and accept.
+		if (link->bmin == 0 && link->bmax == 255)
+		{
+			nextRef = link->ref;
+			break;
+		}
+		
+		// Check for partial edge links.
+		const int v0 = poly->verts[link->edge];
+		const int v1 = poly->verts[(link->edge+1) % poly->vertCount];
+		float left[3], right[3];
+		dtGetTileVertex(tile, v0, left);
+		dtGetTileVertex(tile, v1, right);
+		
+		// Check that the intersection lies inside the link portal.
+		if (link->side == 0 || link->side == 4)
+		{
+			// Calculate link size.
+			const float s = 1.0f/255.0f;
+			float lmin = left[2] + (right[2] - left[2])*(link->bmin*s);
+			float lmax = left[2] + (right[2] - left[2])*(link->bmax*s);
+			if (lmin > lmax) dtSwap(lmin, lmax);
+			
+			// Find Z intersection.
+			float z = startPos[2] + (endPos[2]-startPos[2])*tmax;
+			if (z >= lmin && z <= lmax)
+			{
+				nextRef = link->ref;
+				break;
 			}
+		}
+		else if (link->side == 2 || link->side == 6)
+		{
+			// Calculate link size.
+			const float s = 1.0f/255.0f;
+			float lmin = left[0] + (right[0] - left[0])*(link->bmin*s);
+			float lmax = left[0] + (right[0] - left[0])*(link->bmax*s);
+			if (lmin > lmax) dtSwap(lmin, lmax);
 			
-			// Right vertex.
-			if (dtTriArea2D(portalApex, portalRight, right) <= 0.0f)
+			// Find X intersection.
+			float x = startPos[0] + (endPos[0]-startPos[0])*tmax;
+			if (x >= lmin && x <= lmax)
 			{
-				if (dtVequal(portalApex, portalRight) || dtTriArea2D(portalApex, portalLeft, right) > 0.0f)
-				{
-					dtVcopy(portalRight, right);
-					rightPolyRef = (i+1 < pathSize) ? path[i+1] : 0;
-					rightPolyType = toType;
-					rightIndex = i;
-				}
-				else
-				{
-					// Append portals along the current straight path segment.
-					if (options & (DT_STRAIGHTPATH_AREA_CROSSINGS | DT_STRAIGHTPATH_ALL_CROSSINGS))
-					{
-						stat = appendPortals(apexIndex, leftIndex, portalLeft, path,
-											 straightPath, straightPathFlags, straightPathRefs,
-											 straightPathCount, maxStraightPath, options);
-						if (stat != DT_IN_PROGRESS)
-							return stat;					
-					}
-				
-					dtVcopy(portalApex, portalLeft);
-					apexIndex = leftIndex;
-					
-					unsigned char flags = 0;
-					if (!leftPolyRef)
-						flags = DT_STRAIGHTPATH_END;
-					else if (leftPolyType == DT_POLYTYPE_OFFMESH_CONNECTION)
-						flags = DT_STRAIGHTPATH_OFFMESH_CONNECTION;
-					dtPolyRef ref = leftPolyRef;
-					
-					// Append or update vertex
-					stat = appendVertex(portalApex, flags, ref,
-										straightPath, straightPathFlags, straightPathRefs,
-										straightPathCount, maxStraightPath);
-					if (stat != DT_IN_PROGRESS)
-						return stat;
-					
-					dtVcopy(portalLeft, portalApex);
-					dtVcopy(portalRight, portalApex);
-					leftIndex = apexIndex;
-					rightIndex = apexIndex;
-					
-					// Restart
-					i = apexIndex;
-					
-					continue;
-				}
+				nextRef = link->ref;
+				break;
 			}
-			
-			// Left vertex.
-			if (dtTriArea2D(portalApex, portalLeft, left) >= 0.0f)
+		}
+	}
+	
+	// add the cost
+	if (options & DT_RAYCAST_USE_COSTS)
+	{
+		// compute the intersection point at the furthest end of the polygon
+		// and correct the height (since the raycast moves in 2d)
+		float dir[3], lastPos[3];
+		dtVsub(dir, endPos, startPos);
+		dtVcopy(lastPos, state.curPos);
+		dtVmad(state.curPos, startPos, dir, hit->t);
+		const float* e1 = &verts[segMax*3];
+		const float* e2 = &verts[((segMax+1)%nv)*3];
+		float eDir[3], diff[3];
+		dtVsub(eDir, e2, e1);
+		dtVsub(diff, state.curPos, e1);
+		float s = dtSqr(eDir[0]) > dtSqr(eDir[2]) ? diff[0] / eDir[0] : diff[2] / eDir[2];
+		state.curPos[1] = e1[1] + eDir[1] * s;
+
+		hit->pathCost += filter->getCost(lastPos, state.curPos, state.prevRef, state.prevTile, state.prevPoly, curRef, tile, poly, nextRef, nextTile, nextPoly);
+		DT_QUERY_STAT(m_stats.costCalls++);
+	}
+
+	if (!nextRef)
+	{
+		// No neighbour, we hit a wall.
+		
+		// Calculate hit normal.
+		const int a = segMax;
+		const int b = segMax+1 < nv ? segMax+1 : 0;
+		const float* va = &verts[a*3];
+		const float* vb = &verts[b*3];
+		const float dx = vb[0] - va[0];
+		const float dz = vb[2] - va[2];
+		hit->hitNormal[0] = dz;
+		hit->hitNormal[1] = 0;
+		hit->hitNormal[2] = -dx;
+		dtVnormalize(hit->hitNormal);
+		
+		hit->pathCount = state.n;
+		return false;
+	}
+
+	// No hit, advance to neighbour polygon.
+	DT_QUERY_STAT(m_stats.tilesTouched += nextTile != tile);
+	state.prevRef = curRef;
+	state.curRef = nextRef;
+	state.prevTile = tile;
+	state.tile = nextTile;
+	state.prevPoly = poly;
+	state.poly = nextPoly;
+	return true;
+}
+
+namespace
+{
+/// A ray of a batched raycast, keyed by the polygon it is currently crossing.
+struct dtRaycastEntry
+{
+	dtPolyRef ref;
+	int ray;
+};
+
+int compareRaycastEntries(const void* va, const void* vb)
+{
+	const dtRaycastEntry* a = (const dtRaycastEntry*)va;
+	const dtRaycastEntry* b = (const dtRaycastEntry*)vb;
+	if (a->ref != b->ref) return a->ref < b->ref ? -1 : 1;
+	return a->ray - b->ray;
+}
+
+static const int DT_RAYCAST_PACKET_SIZE = 4;
+
+/// Intersects a packet of segments with the same polygon. The result of each
+/// segment is the same as the result of dtIntersectSegmentPoly2D for it.
+void intersectSegmentPacketPoly2D(const float* const* p0, const float* const* p1, const int count,
+								  const float* verts, const int nverts,
+								  float* tmax, int* segMax, bool* hit)
+{
+#if defined(DT_RAYCAST_SSE2)
+	static const float EPS = 0.000001f;
+
+	// Pad the unused lanes with the first segment.
+	float x0[DT_RAYCAST_PACKET_SIZE], z0[DT_RAYCAST_PACKET_SIZE];
+	float x1[DT_RAYCAST_PACKET_SIZE], z1[DT_RAYCAST_PACKET_SIZE];
+	for (int i = 0; i < DT_RAYCAST_PACKET_SIZE; ++i)
+	{
+		const int k = i < count ? i : 0;
+		x0[i] = p0[k][0];
+		z0[i] = p0[k][2];
+		x1[i] = p1[k][0];
+		z1[i] = p1[k][2];
+	}
+	const __m128 px = _mm_loadu_ps(x0);
+	const __m128 pz = _mm_loadu_ps(z0);
+	const __m128 dirx = _mm_sub_ps(_mm_loadu_ps(x1), px);
+	const __m128 dirz = _mm_sub_ps(_mm_loadu_ps(z1), pz);
+	const __m128 eps = _mm_set1_ps(EPS);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+	__m128 vtmin = zero;
+	__m128 vtmax = _mm_set1_ps(1.0f);
+	__m128i vsegMax = _mm_set1_epi32(-1);
+	__m128 alive = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+	for (int i = 0, j = nverts-1; i < nverts; j=i++)
+	{
+		const float* vi = &verts[i*3];
+		const float* vj = &verts[j*3];
+		const __m128 ex = _mm_set1_ps(vi[0] - vj[0]);
+		const __m128 ez = _mm_set1_ps(vi[2] - vj[2]);
+		const __m128 diffx = _mm_sub_ps(px, _mm_set1_ps(vj[0]));
+		const __m128 diffz = _mm_sub_ps(pz, _mm_set1_ps(vj[2]));
+		const __m128 n = _mm_sub_ps(_mm_mul_ps(ez, diffx), _mm_mul_ps(ex, diffz));
+		const __m128 d = _mm_sub_ps(_mm_mul_ps(dirz, ex), _mm_mul_ps(dirx, ez));
+
+		// S is nearly parallel to this edge, and outside of it.
+		const __m128 parallel = _mm_cmplt_ps(_mm_and_ps(d, absMask), eps);
+		alive = _mm_andnot_ps(_mm_and_ps(parallel, _mm_cmplt_ps(n, zero)), alive);
+
+		const __m128 t = _mm_div_ps(n, d);
+		const __m128 active = _mm_andnot_ps(parallel, alive);
+		const __m128 entering = _mm_cmplt_ps(d, zero);
+
+		// Segment S is entering across this edge.
+		const __m128 updMin = _mm_and_ps(_mm_and_ps(active, entering), _mm_cmpgt_ps(t, vtmin));
+		vtmin = _mm_or_ps(_mm_and_ps(updMin, t), _mm_andnot_ps(updMin, vtmin));
+		alive = _mm_andnot_ps(_mm_and_ps(updMin, _mm_cmpgt_ps(vtmin, vtmax)), alive);
+
+		// Segment S is leaving across this edge.
+		const __m128 updMax = _mm_and_ps(_mm_andnot_ps(entering, active), _mm_cmplt_ps(t, vtmax));
+		const __m128i updMaxi = _mm_castps_si128(updMax);
+		vtmax = _mm_or_ps(_mm_and_ps(updMax, t), _mm_andnot_ps(updMax, vtmax));
+		vsegMax = _mm_or_si128(_mm_and_si128(updMaxi, _mm_set1_epi32(j)), _mm_andnot_si128(updMaxi, vsegMax));
+		alive = _mm_andnot_ps(_mm_and_ps(updMax, _mm_cmplt_ps(vtmax, vtmin)), alive);
+	}
+
+	float rtmax[DT_RAYCAST_PACKET_SIZE];
+	int rsegMax[DT_RAYCAST_PACKET_SIZE];
+	_mm_storeu_ps(rtmax, vtmax);
+	_mm_storeu_si128((__m128i*)rsegMax, vsegMax);
+	const int mask = _mm_movemask_ps(alive);
+	for (int i = 0; i < count; ++i)
+	{
+		tmax[i] = rtmax[i];
+		segMax[i] = rsegMax[i];
+		hit[i] = (mask & (1 << i)) != 0;
+	}
+#else
+	for (int i = 0; i < count; ++i)
+	{
+		float tmin;
+		int segMin;
+		hit[i] = dtIntersectSegmentPoly2D(p0[i], p1[i], verts, nverts, tmin, tmax[i], segMin, segMax[i]);
+	}
+#endif
+}
+} // anonymous namespace
+
+/// @par
+///
+/// The result for each ray is the same as calling #raycast for it without a
+/// previous polygon.
+///
+/// The rays are processed one polygon at a time. Rays crossing the same polygon
+/// share the vertex fetch, and are tested against its edges in packets of four
+/// using SIMD where available. This is considerably faster than calling #raycast
+/// for each ray when many rays start from the same area, for example line of
+/// sight checks from a group of agents.
+///
+/// The result array must be able to hold @p count items. The path array and
+/// its size are read from each hit structure like in #raycast. If a path array
+/// is too small, #DT_BUFFER_TOO_SMALL is returned.
+///
+dtStatus dtNavMeshQuery::raycasts(const dtPolyRef* startRefs, const float* startPos, const float* endPos, const int count,
+								  const dtQueryFilter* filter, const unsigned int options, dtRaycastHit* hits) const
+{
+	dtAssert(m_nav);
+
+	if (!startRefs || !startPos || !endPos || count < 0 || !filter || !hits)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	for (int i = 0; i < count; ++i)
+	{
+		hits[i].t = 0;
+		hits[i].pathCount = 0;
+		hits[i].pathCost = 0;
+	}
+
+	for (int i = 0; i < count; ++i)
+	{
+		if (!m_nav->isValidPolyRef(startRefs[i]) || !dtVisfinite(&startPos[i*3]) || !dtVisfinite(&endPos[i*3]))
+			return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	dtRaycastState* states = (dtRaycastState*)m_allocator->alloc(sizeof(dtRaycastState)*dtMax(count, 1), DT_ALLOC_TEMP);
+	dtRaycastEntry* entries = (dtRaycastEntry*)m_allocator->alloc(sizeof(dtRaycastEntry)*dtMax(count, 1), DT_ALLOC_TEMP);
+	if (!states || !entries)
+	{
+		m_allocator->free(states);
+		m_allocator->free(entries);
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+
+	for (int i = 0; i < count; ++i)
+	{
+		initRaycast(states[i], startRefs[i], &startPos[i*3], 0, &hits[i]);
+		entries[i].ray = i;
+	}
+
+	dtStatus status = DT_SUCCESS;
+	float verts[DT_VERTS_PER_POLYGON*3+3];
+	int nentries = count;
+	while (nentries > 0)
+	{
+		// Group the rays by the polygon they are crossing.
+		for (int i = 0; i < nentries; ++i)
+			entries[i].ref = states[entries[i].ray].curRef;
+		qsort(entries, (size_t)nentries, sizeof(dtRaycastEntry), compareRaycastEntries);
+
+		int nactive = 0;
+		for (int first = 0; first < nentries; )
+		{
+			int last = first+1;
+			while (last < nentries && entries[last].ref == entries[first].ref)
+				last++;
+
+			// Collect vertices once for all the rays crossing the polygon.
+			const dtRaycastState& head = states[entries[first].ray];
+			const int nv = (int)head.poly->vertCount;
+			for (int i = 0; i < nv; ++i)
+				dtGetTileVertex(head.tile, head.poly->verts[i], &verts[i*3]);
+
+			for (int k = first; k < last; k += DT_RAYCAST_PACKET_SIZE)
 			{
-				if (dtVequal(portalApex, portalLeft) || dtTriArea2D(portalApex, portalRight, left) < 0.0f)
+				const int npacket = dtMin(DT_RAYCAST_PACKET_SIZE, last - k);
+				const float* p0[DT_RAYCAST_PACKET_SIZE];
+				const float* p1[DT_RAYCAST_PACKET_SIZE];
+				for (int i = 0; i < npacket; ++i)
 				{
-					dtVcopy(portalLeft, left);
-					leftPolyRef = (i+1 < pathSize) ? path[i+1] : 0;
-					leftPolyType = toType;
-					leftIndex = i;
+					p0[i] = &startPos[entries[k+i].ray*3];
+					p1[i] = &endPos[entries[k+i].ray*3];
 				}
-				else
+				float tmax[DT_RAYCAST_PACKET_SIZE];
+				int segMax[DT_RAYCAST_PACKET_SIZE];
+				bool hit[DT_RAYCAST_PACKET_SIZE];
+				intersectSegmentPacketPoly2D(p0, p1, npacket, verts, nv, tmax, segMax, hit);
+
+				for (int i = 0; i < npacket; ++i)
 				{
-					// Append portals along the current straight path segment.
-					if (options & (DT_STRAIGHTPATH_AREA_CROSSINGS | DT_STRAIGHTPATH_ALL_CROSSINGS))
+					const int ray = entries[k+i].ray;
+					dtRaycastState& state = states[ray];
+					if (!hit[i])
 					{
-						stat = appendPortals(apexIndex, rightIndex, portalRight, path,
-											 straightPath, straightPathFlags, straightPathRefs,
-											 straightPathCount, maxStraightPath, options);
-						if (stat != DT_IN_PROGRESS)
-							return stat;
+						// Could not hit the polygon, keep the old t and report hit.
+						hits[ray].pathCount = state.n;
+						continue;
 					}
-
-					dtVcopy(portalApex, portalRight);
-					apexIndex = rightIndex;
-					
-					unsigned char flags = 0;
-					if (!rightPolyRef)
-						flags = DT_STRAIGHTPATH_END;
-					else if (rightPolyType == DT_POLYTYPE_OFFMESH_CONNECTION)
-						flags = DT_STRAIGHTPATH_OFFMESH_CONNECTION;
-					dtPolyRef ref = rightPolyRef;
-
-					// Append or update vertex
-					stat = appendVertex(portalApex, flags, ref,
-										straightPath, straightPathFlags, straightPathRefs,
-										straightPathCount, maxStraightPath);
-					if (stat != DT_IN_PROGRESS)
-						return stat;
-					
-					dtVcopy(portalLeft, portalApex);
-					dtVcopy(portalRight, portalApex);
-					leftIndex = apexIndex;
-					rightIndex = apexIndex;
-					
-					// Restart
-					i = apexIndex;
-					
-					continue;
+					if (advanceRaycast(state, p0[i], p1[i], filter, options, &hits[ray], verts, nv, tmax[i], segMax[i], status))
+						entries[nactive++].ray = ray;
 				}
 			}
+			first = last;
 		}
-
-		// Append portals along the current straight path segment.
-		if (options & (DT_STRAIGHTPATH_AREA_CROSSINGS | DT_STRAIGHTPATH_ALL_CROSSINGS))
-		{
-			stat = appendPortals(apexIndex, pathSize-1, closestEndPos, path,
-								 straightPath, straightPathFlags, straightPathRefs,
-								 straightPathCount, maxStraightPath, options);
-			if (stat != DT_IN_PROGRESS)
-				return stat;
-		}
+		nentries = nactive;
 	}
 
-	// Ignore status return value as we're just about to return anyway.
-	appendVertex(closestEndPos, DT_STRAIGHTPATH_END, 0,
-						straightPath, straightPathFlags, straightPathRefs,
-						straightPathCount, maxStraightPath);
-	
-	return DT_SUCCESS | ((*straightPathCount >= maxStraightPath) ? DT_BUFFER_TOO_SMALL : 0);
+	m_allocator->free(states);
+	m_allocator->free(entries);
+
+	return status;
 }
 
 /// @par
 ///
-/// This method is optimized for small delta movement and a small number of 
-/// polygons. If used for too great a distance, the result set will form an 
-/// incomplete path.
+/// At least one result array must be provided.
 ///
-/// @p resultPos will equal the @p endPos if the end is reached. 
-/// Otherwise the closest reachable position will be returned.
-/// 
-/// @p resultPos is not projected onto the surface of the navigation 
-/// mesh. Use #getPolyHeight if this is needed.
+/// The order of the result set is from least to highest cost to reach the polygon.
 ///
-/// This method treats the end position in the same manner as 
-/// the #raycast method. (As a 2D point.) See that method's documentation 
-/// for details.
+/// A common use case for this method is to perform Dijkstra searches. 
+/// Candidate polygons are found by searching the graph beginning at the start polygon.
+///
+/// If a polygon is not found via the graph search, even if it intersects the 
+/// search circle, it will not be included in the result set. For example:
+///
+/// polyA is the start polygon.
+/// polyB shares an edge with polyA. (Is adjacent.)
+/// polyC shares an edge with polyB, but not with polyA
+/// Even if the search circle overlaps polyC, it will not be included in the 
+/// result set unless polyB is also in the set.
 /// 
-/// If the @p visited array is too small to hold the entire result set, it will 
-/// be filled as far as possible from the start position toward the end 
-/// position.
+/// The value of the center point is used as the start position for cost 
+/// calculations. It is not projected onto the surface of the mesh, so its 
+/// y-value will effect the costs.
+///
+/// Intersection tests occur in 2D. All polygons and the search circle are 
+/// projected onto the xz-plane. So the y-value of the center point does not 
+/// effect intersection tests.
 ///
-dtStatus dtNavMeshQuery::moveAlongSurface(dtPolyRef startRef, const float* startPos, const float* endPos,
-										  const dtQueryFilter* filter,
-										  float* resultPos, dtPolyRef* visited, int* visitedCount, const int maxVisitedSize) const
+/// If the result arrays are to small to hold the entire result set, they will be 
+/// filled to capacity.
+/// 
+dtStatus dtNavMeshQuery::findPolysAroundCircle(dtPolyRef startRef, const float* centerPos, const float radius,
+											   const dtQueryFilter* filter,
+											   dtPolyRef* resultRef, dtPolyRef* resultParent, float* resultCost,
+											   int* resultCount, const int maxResult) const
 {
 	dtAssert(m_nav);
-	dtAssert(m_tinyNodePool);
+	dtAssert(m_nodePool);
+	dtAssert(m_openList);
 
-	if (!visitedCount)
+	if (!resultCount)
 		return DT_FAILURE | DT_INVALID_PARAM;
 
-	*visitedCount = 0;
+	*resultCount = 0;
 
 	if (!m_nav->isValidPolyRef(startRef) ||
-		!startPos || !dtVisfinite(startPos) ||
-		!endPos || !dtVisfinite(endPos) ||
-		!filter || !resultPos || !visited ||
-		maxVisitedSize <= 0)
+		!centerPos || !dtVisfinite(centerPos) ||
+		radius < 0 || !dtMathIsfinite(radius) ||
+		!filter || maxResult < 0)
 	{
 		return DT_FAILURE | DT_INVALID_PARAM;
 	}
 	
-	dtStatus status = DT_SUCCESS;
-	
-	static const int MAX_STACK = 48;
-	dtNode* stack[MAX_STACK];
-	int nstack = 0;
-	
-	m_tinyNodePool->clear();
+	m_nodePool->clear();
+	m_openList->clear();
 	
-	dtNode* startNode = m_tinyNodePool->getNode(startRef);
+	dtNode* startNode = m_nodePool->getNode(startRef);
+	dtVcopy(startNode->pos, centerPos);
 	startNode->pidx = 0;
 	startNode->cost = 0;
 	startNode->total = 0;
 	startNode->id = startRef;
-	startNode->flags = DT_NODE_CLOSED;
-	stack[nstack++] = startNode;
+	startNode->flags = DT_NODE_OPEN;
+	m_openList->push(startNode);
 	
-	float bestPos[3];
-	float bestDist = FLT_MAX;
-	dtNode* bestNode = 0;
-	dtVcopy(bestPos, startPos);
+	dtStatus status = DT_SUCCESS;
 	
-	// Search constraints
-	float searchPos[3], searchRadSqr;
-	dtVlerp(searchPos, startPos, endPos, 0.5f);
-	searchRadSqr = dtSqr(dtVdist(startPos, endPos)/2.0f + 0.001f);
+	int n = 0;
 	
-	float verts[DT_VERTS_PER_POLYGON*3];
+	const float radiusSqr = dtSqr(radius);
 	
-	while (nstack)
+	while (!m_openList->empty())
 	{
-		// Pop front.
-		dtNode* curNode = stack[0];
-		for (int i = 0; i < nstack-1; ++i)
-			stack[i] = stack[i+1];
-		nstack--;
+		dtNode* bestNode = m_openList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
 		
 		// Get poly and tile.
 		// The API input has been checked already, skip checking internal data.
-		const dtPolyRef curRef = curNode->id;
-		const dtMeshTile* curTile = 0;
-		const dtPoly* curPoly = 0;
-		m_nav->getTileAndPolyByRefUnsafe(curRef, &curTile, &curPoly);			
-		
-		// Collect vertices.
-		const int nverts = curPoly->vertCount;
-		for (int i = 0; i < nverts; ++i)
-			dtVcopy(&verts[i*3], &curTile->verts[curPoly->verts[i]*3]);
+		const dtPolyRef bestRef = bestNode->id;
+		const dtMeshTile* bestTile = 0;
+		const dtPoly* bestPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
 		
-		// If target is inside the poly, stop search.
-		if (dtPointInPolygon(endPos, verts, nverts))
+		// Get parent poly and tile.
+		dtPolyRef parentRef = 0;
+		const dtMeshTile* parentTile = 0;
+		const dtPoly* parentPoly = 0;
+		if (bestNode->pidx)
+			parentRef = m_nodePool->getNodeAtIdx(bestNode->pidx)->id;
+		if (parentRef)
+			m_nav->getTileAndPolyByRefUnsafe(parentRef, &parentTile, &parentPoly);
+		DT_QUERY_STAT(m_stats.nodesExpanded++);
+
+		if (n < maxResult)
 		{
-			bestNode = curNode;
-			dtVcopy(bestPos, endPos);
-			break;
+			if (resultRef)
+				resultRef[n] = bestRef;
+			if (resultParent)
+				resultParent[n] = parentRef;
+			if (resultCost)
+				resultCost[n] = bestNode->total;
+			++n;
+		}
+		else
+		{
+			status |= DT_BUFFER_TOO_SMALL;
 		}
 		
-		// Find wall edges and find nearest point inside the walls.
-		for (int i = 0, j = (int)curPoly->vertCount-1; i < (int)curPoly->vertCount; j = i++)
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
 		{
-			// Find links to neighbours.
-			static const int MAX_NEIS = 8;
-			int nneis = 0;
-			dtPolyRef neis[MAX_NEIS];
+			const dtLink* link = &bestTile->links[i];
+			dtPolyRef neighbourRef = link->ref;
+			// Skip invalid neighbours and do not follow back to parent.
+			if (!neighbourRef || neighbourRef == parentRef)
+				continue;
+			// Skip edges narrower than the agent.
+			if (!dtPassEdgeClearance(bestTile, bestPoly, link->edge, filter->getAgentRadius()))
+				continue;
 			
-			if (curPoly->neis[j] & DT_EXT_LINK)
-			{
-				// Tile border.
-				for (unsigned int k = curPoly->firstLink; k != DT_NULL_LINK; k = curTile->links[k].next)
-				{
-					const dtLink* link = &curTile->links[k];
-					if (link->edge == j)
-					{
-						if (link->ref != 0)
-						{
-							const dtMeshTile* neiTile = 0;
-							const dtPoly* neiPoly = 0;
-							m_nav->getTileAndPolyByRefUnsafe(link->ref, &neiTile, &neiPoly);
-							if (filter->passFilter(link->ref, neiTile, neiPoly))
-							{
-								if (nneis < MAX_NEIS)
-									neis[nneis++] = link->ref;
-							}
-						}
-					}
-				}
-			}
-			else if (curPoly->neis[j])
-			{
-				const unsigned int idx = (unsigned int)(curPoly->neis[j]-1);
-				const dtPolyRef ref = m_nav->getPolyRefBase(curTile) | idx;
-				if (filter->passFilter(ref, curTile, &curTile->polys[idx]))
-				{
-					// Internal edge, encode id.
-					neis[nneis++] = ref;
-				}
-			}
+			// Expand to neighbour
+			const dtMeshTile* neighbourTile = 0;
+			const dtPoly* neighbourPoly = 0;
+			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
+		
+			// Do not advance if the polygon is excluded by the filter.
+			DT_QUERY_STAT(m_stats.filterCalls++);
+			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+				continue;
+			DT_QUERY_STAT(m_stats.tilesTouched += neighbourTile != bestTile);
 			
-			if (!nneis)
-			{
-				// Wall edge, calc distance.
-				const float* vj = &verts[j*3];
-				const float* vi = &verts[i*3];
-				float tseg;
-				const float distSqr = dtDistancePtSegSqr2D(endPos, vj, vi, tseg);
-				if (distSqr < bestDist)
-				{
-                    // Update nearest distance.
-					dtVlerp(bestPos, vj,vi, tseg);
-					bestDist = distSqr;
-					bestNode = curNode;
-				}
-			}
-			else
+			// Find edge and calc distance to the edge.
+			float va[3], vb[3];
+			if (dtStatusFailed(getLinkPortalPoints(bestRef, bestPoly, bestTile, i, neighbourPoly, neighbourTile, va, vb)))
+				continue;
+			
+			// If the circle is not touching the next polygon, skip it.
+			float tseg;
+			float distSqr = dtDistancePtSegSqr2D(centerPos, va, vb, tseg);
+			if (distSqr > radiusSqr)
+				continue;
+			
+			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef);
+			if (!neighbourNode)
 			{
-				for (int k = 0; k < nneis; ++k)
-				{
-					// Skip if no node can be allocated.
-					dtNode* neighbourNode = m_tinyNodePool->getNode(neis[k]);
-					if (!neighbourNode)
-						continue;
-					// Skip if already visited.
-					if (neighbourNode->flags & DT_NODE_CLOSED)
-						continue;
-					
-					// Skip the link if it is too far from search constraint.
-					// TODO: Maybe should use getPortalPoints(), but this one is way faster.
-					const float* vj = &verts[j*3];
-					const float* vi = &verts[i*3];
-					float tseg;
-					float distSqr = dtDistancePtSegSqr2D(searchPos, vj, vi, tseg);
-					if (distSqr > searchRadSqr)
-						continue;
-					
-					// Mark as the node as visited and push to queue.
-					if (nstack < MAX_STACK)
-					{
-						neighbourNode->pidx = m_tinyNodePool->getNodeIdx(curNode);
-						neighbourNode->flags |= DT_NODE_CLOSED;
-						stack[nstack++] = neighbourNode;
-					}
-				}
+				status |= DT_OUT_OF_NODES;
+				continue;
 			}
-		}
-	}
-	
-	int n = 0;
-	if (bestNode)
-	{
-		// Reverse the path.
-		dtNode* prev = 0;
-		dtNode* node = bestNode;
-		do
-		{
-			dtNode* next = m_tinyNodePool->getNodeAtIdx(node->pidx);
-			node->pidx = m_tinyNodePool->getNodeIdx(prev);
-			prev = node;
-			node = next;
-		}
-		while (node);
-		
-		// Store result
-		node = prev;
-		do
-		{
-			visited[n++] = node->id;
-			if (n >= maxVisitedSize)
+				
+			if (neighbourNode->flags & DT_NODE_CLOSED)
+				continue;
+			
+			// Cost
+			if (neighbourNode->flags == 0)
+				dtVlerp(neighbourNode->pos, va, vb, 0.5f);
+			
+			float cost = filter->getCost(
+				bestNode->pos, neighbourNode->pos,
+				parentRef, parentTile, parentPoly,
+				bestRef, bestTile, bestPoly,
+				neighbourRef, neighbourTile, neighbourPoly);
+			DT_QUERY_STAT(m_stats.costCalls++);
+
+			const float total = bestNode->total + cost;
+			
+			// The node is already in open list and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+				continue;
+			
+			neighbourNode->id = neighbourRef;
+			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+			neighbourNode->total = total;
+			
+			if (neighbourNode->flags & DT_NODE_OPEN)
 			{
-				status |= DT_BUFFER_TOO_SMALL;
-				break;
+				m_openList->modify(neighbourNode);
+			}
+			else
+			{
+				neighbourNode->flags = DT_NODE_OPEN;
+				m_openList->push(neighbourNode);
 			}
-			node = m_tinyNodePool->getNodeAtIdx(node->pidx);
 		}
-		while (node);
 	}
 	
-	dtVcopy(resultPos, bestPos);
-	
-	*visitedCount = n;
+	*resultCount = n;
+
+	DT_QUERY_STAT(countQuery(status, m_nodePool->getNodeCount()));
 	
 	return status;
 }
 
-
-dtStatus dtNavMeshQuery::getPortalPoints(dtPolyRef from, dtPolyRef to, float* left, float* right,
-										 unsigned char& fromType, unsigned char& toType) const
+static bool dtIsNeighbourhoodPolyStale(const dtNavMesh* nav, const dtNeighbourhoodPoly& poly,
+									   const dtNeighbourhoodEdge* edges)
 {
-	dtAssert(m_nav);
-	
-	const dtMeshTile* fromTile = 0;
-	const dtPoly* fromPoly = 0;
-	if (dtStatusFailed(m_nav->getTileAndPolyByRef(from, &fromTile, &fromPoly)))
-		return DT_FAILURE | DT_INVALID_PARAM;
-	fromType = fromPoly->getType();
-
-	const dtMeshTile* toTile = 0;
-	const dtPoly* toPoly = 0;
-	if (dtStatusFailed(m_nav->getTileAndPolyByRef(to, &toTile, &toPoly)))
-		return DT_FAILURE | DT_INVALID_PARAM;
-	toType = toPoly->getType();
-		
-	return getPortalPoints(from, fromPoly, fromTile, to, toPoly, toTile, left, right);
+	// The filter results of the links depend on the neighbours, which may be in other tiles.
+	if (nav->getTileGeneration(poly.ref) > poly.generation)
+		return true;
+	for (int i = 0; i < poly.edgeCount; ++i)
+	{
+		if (nav->getTileGeneration(edges[i].ref) > poly.generation)
+			return true;
+	}
+	return false;
 }
 
-// Returns portal points between two polygons.
-dtStatus dtNavMeshQuery::getPortalPoints(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile,
-										 dtPolyRef to, const dtPoly* toPoly, const dtMeshTile* toTile,
-										 float* left, float* right) const
+bool dtNavMeshQuery::addNeighbourhoodPoly(dtNavMeshNeighbourhood* nbh, dtPolyRef ref, const dtQueryFilter* filter,
+										  const bool validate) const
 {
-	// Find the link that points to the 'to' polygon.
-	const dtLink* link = 0;
-	for (unsigned int i = fromPoly->firstLink; i != DT_NULL_LINK; i = fromTile->links[i].next)
+	const int kept = nbh->m_current;
+
+	// Reuse the links of the kept polygon if the tiles they depend on did not change.
+	const int idx = nbh->findPoly(kept, ref);
+	if (idx != -1)
 	{
-		if (fromTile->links[i].ref == to)
+		const dtNeighbourhoodPoly& src = nbh->m_polys[kept][idx];
+		const dtNeighbourhoodEdge* srcEdges = nbh->getEdges(kept, src);
+		if (!validate || !dtIsNeighbourhoodPolyStale(m_nav, src, srcEdges))
 		{
-			link = &fromTile->links[i];
-			break;
+			dtNeighbourhoodPoly* poly = nbh->addPoly(ref, src.edgeCount);
+			if (!poly)
+				return false;
+			poly->generation = src.generation;
+			memcpy(poly->bounds, src.bounds, sizeof(poly->bounds));
+			memcpy(nbh->getEdges(1 - kept, *poly), srcEdges, sizeof(dtNeighbourhoodEdge)*src.edgeCount);
+			return true;
 		}
 	}
-	if (!link)
-		return DT_FAILURE | DT_INVALID_PARAM;
-	
-	// Handle off-mesh connections.
-	if (fromPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	if (dtStatusFailed(m_nav->getTileAndPolyByRef(ref, &tile, &poly)))
+		return false;
+
+	int edgeCount = 0;
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
 	{
-		// Find link that points to first vertex.
-		for (unsigned int i = fromPoly->firstLink; i != DT_NULL_LINK; i = fromTile->links[i].next)
-		{
-			if (fromTile->links[i].ref == to)
-			{
-				const int v = fromTile->links[i].edge;
-				dtVcopy(left, &fromTile->verts[fromPoly->verts[v]*3]);
-				dtVcopy(right, &fromTile->verts[fromPoly->verts[v]*3]);
-				return DT_SUCCESS;
-			}
-		}
-		return DT_FAILURE | DT_INVALID_PARAM;
+		if (tile->links[i].ref)
+			edgeCount++;
 	}
-	
-	if (toPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	dtNeighbourhoodPoly* npoly = nbh->addPoly(ref, edgeCount);
+	if (!npoly)
+		return false;
+	npoly->generation = m_nav->getGeneration();
+	nbh->m_readCount++;
+
+	npoly->bounds[0] = npoly->bounds[1] = FLT_MAX;
+	npoly->bounds[2] = npoly->bounds[3] = -FLT_MAX;
+	for (int i = 0; i < poly->vertCount; ++i)
 	{
-		for (unsigned int i = toPoly->firstLink; i != DT_NULL_LINK; i = toTile->links[i].next)
-		{
-			if (toTile->links[i].ref == from)
-			{
-				const int v = toTile->links[i].edge;
-				dtVcopy(left, &toTile->verts[toPoly->verts[v]*3]);
-				dtVcopy(right, &toTile->verts[toPoly->verts[v]*3]);
-				return DT_SUCCESS;
-			}
-		}
-		return DT_FAILURE | DT_INVALID_PARAM;
+		float v[3];
+		dtGetTileVertex(tile, poly->verts[i], v);
+		npoly->bounds[0] = dtMin(npoly->bounds[0], v[0]);
+		npoly->bounds[1] = dtMin(npoly->bounds[1], v[2]);
+		npoly->bounds[2] = dtMax(npoly->bounds[2], v[0]);
+		npoly->bounds[3] = dtMax(npoly->bounds[3], v[2]);
 	}
-	
-	// Find portal vertices.
-	const int v0 = fromPoly->verts[link->edge];
-	const int v1 = fromPoly->verts[(link->edge+1) % (int)fromPoly->vertCount];
-	dtVcopy(left, &fromTile->verts[v0*3]);
-	dtVcopy(right, &fromTile->verts[v1*3]);
-	
-	// If the link is at tile boundary, dtClamp the vertices to
-	// the link width.
-	if (link->side != 0xff)
+
+	// The links are stored in the order of the link list, with the tests of the searches done once.
+	dtNeighbourhoodEdge* edges = nbh->getEdges(1 - kept, *npoly);
+	int n = 0;
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
 	{
-		// Unpack portal limits.
-		if (link->bmin != 0 || link->bmax != 255)
-		{
-			const float s = 1.0f/255.0f;
-			const float tmin = link->bmin*s;
-			const float tmax = link->bmax*s;
-			dtVlerp(left, &fromTile->verts[v0*3], &fromTile->verts[v1*3], tmin);
-			dtVlerp(right, &fromTile->verts[v0*3], &fromTile->verts[v1*3], tmax);
-		}
+		const dtLink* link = &tile->links[i];
+		if (!link->ref)
+			continue;
+		dtNeighbourhoodEdge& edge = edges[n++];
+		edge.ref = link->ref;
+		edge.flags = 0;
+		const dtMeshTile* neighbourTile = 0;
+		const dtPoly* neighbourPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(link->ref, &neighbourTile, &neighbourPoly);
+		if (neighbourPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+			edge.flags |= DT_NEIGHBOURHOOD_EDGE_OFFMESH;
+		if (!dtPassEdgeClearance(tile, poly, link->edge, filter->getAgentRadius()) ||
+			!filter->passFilter(link->ref, neighbourTile, neighbourPoly))
+			continue;
+		if (dtStatusFailed(getLinkPortalPoints(ref, poly, tile, i, neighbourPoly, neighbourTile, &edge.portal[0], &edge.portal[3])))
+			continue;
+		edge.flags |= DT_NEIGHBOURHOOD_EDGE_PASSABLE;
 	}
-	
-	return DT_SUCCESS;
-}
-
-// Returns edge mid point between two polygons.
-dtStatus dtNavMeshQuery::getEdgeMidPoint(dtPolyRef from, dtPolyRef to, float* mid) const
-{
-	float left[3], right[3];
-	unsigned char fromType, toType;
-	if (dtStatusFailed(getPortalPoints(from, to, left,right, fromType, toType)))
-		return DT_FAILURE | DT_INVALID_PARAM;
-	mid[0] = (left[0]+right[0])*0.5f;
-	mid[1] = (left[1]+right[1])*0.5f;
-	mid[2] = (left[2]+right[2])*0.5f;
-	return DT_SUCCESS;
-}
 
-dtStatus dtNavMeshQuery::getEdgeMidPoint(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile,
-										 dtPolyRef to, const dtPoly* toPoly, const dtMeshTile* toTile,
-										 float* mid) const
-{
-	float left[3], right[3];
-	if (dtStatusFailed(getPortalPoints(from, fromPoly, fromTile, to, toPoly, toTile, left, right)))
-		return DT_FAILURE | DT_INVALID_PARAM;
-	mid[0] = (left[0]+right[0])*0.5f;
-	mid[1] = (left[1]+right[1])*0.5f;
-	mid[2] = (left[2]+right[2])*0.5f;
-	return DT_SUCCESS;
+	return true;
 }
 
-
-
 /// @par
 ///
-/// This method is meant to be used for quick, short distance checks.
-///
-/// If the path array is too small to hold the result, it will be filled as 
-/// far as possible from the start postion toward the end position.
-///
-/// <b>Using the Hit Parameter (t)</b>
-/// 
-/// If the hit parameter is a very high value (FLT_MAX), then the ray has hit 
-/// the end position. In this case the path represents a valid corridor to the 
-/// end position and the value of @p hitNormal is undefined.
-///
-/// If the hit parameter is zero, then the start position is on the wall that 
-/// was hit and the value of @p hitNormal is undefined.
-///
-/// If 0 < t < 1.0 then the following applies:
-///
-/// @code
-/// distanceToHitBorder = distanceToEndPosition * t
-/// hitPoint = startPos + (endPos - startPos) * t
-/// @endcode
-///
-/// <b>Use Case Restriction</b>
-///
-/// The raycast ignores the y-value of the end position. (2D check.) This 
-/// places significant limits on how it can be used. For example:
-///
-/// Consider a scene where there is a main floor with a second floor balcony 
-/// that hangs over the main floor. So the first floor mesh extends below the 
-/// balcony mesh. The start position is somewhere on the first floor. The end 
-/// position is on the balcony.
-///
-/// The raycast will search toward the end position along the first floor mesh. 
-/// If it reaches the end position's xz-coordinates it will indicate FLT_MAX
-/// (no wall hit), meaning it reached the end position. This is one example of why
-/// this method is meant for short distance checks.
-///
-dtStatus dtNavMeshQuery::raycast(dtPolyRef startRef, const float* startPos, const float* endPos,
-								 const dtQueryFilter* filter,
-								 float* t, float* hitNormal, dtPolyRef* path, int* pathCount, const int maxPath) const
+/// The kept polygons can answer a search if the circle is inside the circle they
+/// were searched for and they contain the start polygon. Every polygon the search
+/// reaches is then kept, since it is reached through portals inside the larger
+/// circle.
+bool dtNavMeshQuery::updateNeighbourhood(dtNavMeshNeighbourhood* nbh, dtPolyRef startRef, const float* centerPos,
+										 const float radius, const dtQueryFilter* filter) const
 {
-	dtRaycastHit hit;
-	hit.path = path;
-	hit.maxPath = maxPath;
+	if (!nbh->m_maxPolys)
+		return false;
 
-	dtStatus status = raycast(startRef, startPos, endPos, filter, 0, &hit);
-	
-	*t = hit.t;
-	if (hitNormal)
-		dtVcopy(hitNormal, hit.hitNormal);
-	if (pathCount)
-		*pathCount = hit.pathCount;
+	// Tile adds and removes change the links, and the links depend on the filter.
+	if (nbh->m_nav != m_nav || nbh->m_filter != filter || nbh->m_epoch != m_nav->getEpoch())
+	{
+		nbh->reset();
+		nbh->m_nav = m_nav;
+		nbh->m_filter = filter;
+		nbh->m_epoch = m_nav->getEpoch();
+		nbh->m_generation = m_nav->getGeneration();
+	}
 
-	return status;
-}
+	const int kept = nbh->m_current;
+	const bool changed = nbh->m_generation != m_nav->getGeneration();
+	const float dx = centerPos[0] - nbh->m_center[0];
+	const float dz = centerPos[2] - nbh->m_center[2];
+	if (nbh->m_radius >= 0.0f && dtMathSqrtf(dx*dx + dz*dz) + radius <= nbh->m_radius &&
+		nbh->findPoly(kept, startRef) != -1)
+	{
+		bool stale = false;
+		if (changed)
+		{
+			for (int i = 0; i < nbh->m_polyCount[kept] && !stale; ++i)
+			{
+				const dtNeighbourhoodPoly& poly = nbh->m_polys[kept][i];
+				stale = dtIsNeighbourhoodPolyStale(m_nav, poly, nbh->getEdges(kept, poly));
+			}
+		}
+		if (!stale)
+		{
+			nbh->m_generation = m_nav->getGeneration();
+			nbh->m_reuseCount++;
+			return true;
+		}
+	}
+
+	// Search the polygons around the new center, keeping the ones that are still in range.
+	const float searchRadius = radius + nbh->m_margin;
+	const float searchRadiusSqr = dtSqr(searchRadius);
+	const int next = 1 - kept;
+	nbh->beginSearch();
+	bool complete = addNeighbourhoodPoly(nbh, startRef, filter, changed);
+	for (int i = 0; complete && i < nbh->m_polyCount[next]; ++i)
+	{
+		const dtNeighbourhoodPoly& poly = nbh->m_polys[next][i];
+		const dtNeighbourhoodEdge* edges = nbh->getEdges(next, poly);
+		for (int j = 0; j < poly.edgeCount; ++j)
+		{
+			const dtNeighbourhoodEdge& edge = edges[j];
+			if (!(edge.flags & DT_NEIGHBOURHOOD_EDGE_PASSABLE))
+				continue;
+			float tseg;
+			if (dtDistancePtSegSqr2D(centerPos, &edge.portal[0], &edge.portal[3], tseg) > searchRadiusSqr)
+				continue;
+			if (nbh->findPoly(next, edge.ref) != -1)
+				continue;
+			if (!addNeighbourhoodPoly(nbh, edge.ref, filter, changed))
+			{
+				complete = false;
+				break;
+			}
+		}
+	}
+	nbh->endSearch(centerPos, searchRadius, complete);
+	nbh->m_generation = m_nav->getGeneration();
 
+	return complete;
+}
 
 /// @par
 ///
-/// This method is meant to be used for quick, short distance checks.
-///
-/// If the path array is too small to hold the result, it will be filled as 
-/// far as possible from the start postion toward the end position.
-///
-/// <b>Using the Hit Parameter t of RaycastHit</b>
-/// 
-/// If the hit parameter is a very high value (FLT_MAX), then the ray has hit 
-/// the end position. In this case the path represents a valid corridor to the 
-/// end position and the value of @p hitNormal is undefined.
-///
-/// If the hit parameter is zero, then the start position is on the wall that 
-/// was hit and the value of @p hitNormal is undefined.
-///
-/// If 0 < t < 1.0 then the following applies:
-///
-/// @code
-/// distanceToHitBorder = distanceToEndPosition * t
-/// hitPoint = startPos + (endPos - startPos) * t
-/// @endcode
-///
-/// <b>Use Case Restriction</b>
-///
-/// The raycast ignores the y-value of the end position. (2D check.) This 
-/// places significant limits on how it can be used. For example:
-///
-/// Consider a scene where there is a main floor with a second floor balcony 
-/// that hangs over the main floor. So the first floor mesh extends below the 
-/// balcony mesh. The start position is somewhere on the first floor. The end 
-/// position is on the balcony.
-///
-/// The raycast will search toward the end position along the first floor mesh. 
-/// If it reaches the end position's xz-coordinates it will indicate FLT_MAX
-/// (no wall hit), meaning it reached the end position. This is one example of why
-/// this method is meant for short distance checks.
+/// The results are the same as the search without the neighbourhood. Only the
+/// polygons kept by the neighbourhood are visited, their links are not read,
+/// and the filter is not called for them. The neighbourhood is searched again
+/// when the circle is no longer inside the circle of the kept polygons.
 ///
-dtStatus dtNavMeshQuery::raycast(dtPolyRef startRef, const float* startPos, const float* endPos,
-								 const dtQueryFilter* filter, const unsigned int options,
-								 dtRaycastHit* hit, dtPolyRef prevRef) const
+/// The search runs without the neighbourhood if it is too small for the
+/// polygons in range.
+dtStatus dtNavMeshQuery::findPolysAroundCircle(dtPolyRef startRef, const float* centerPos, const float radius,
+											   const dtQueryFilter* filter, dtNavMeshNeighbourhood* neighbourhood,
+											   dtPolyRef* resultRef, dtPolyRef* resultParent, float* resultCost,
+											   int* resultCount, const int maxResult) const
 {
 	dtAssert(m_nav);
+	dtAssert(m_nodePool);
+	dtAssert(m_openList);
 
-	if (!hit)
+	if (!resultCount)
 		return DT_FAILURE | DT_INVALID_PARAM;
 
-	hit->t = 0;
-	hit->pathCount = 0;
-	hit->pathCost = 0;
+	*resultCount = 0;
 
-	// Validate input
 	if (!m_nav->isValidPolyRef(startRef) ||
-		!startPos || !dtVisfinite(startPos) ||
-		!endPos || !dtVisfinite(endPos) ||
-		!filter ||
-		(prevRef && !m_nav->isValidPolyRef(prevRef)))
+		!centerPos || !dtVisfinite(centerPos) ||
+		radius < 0 || !dtMathIsfinite(radius) ||
+		!filter || maxResult < 0)
 	{
 		return DT_FAILURE | DT_INVALID_PARAM;
 	}
-	
-	float dir[3], curPos[3], lastPos[3];
-	float verts[DT_VERTS_PER_POLYGON*3+3];	
-	int n = 0;
-
-	dtVcopy(curPos, startPos);
-	dtVsub(dir, endPos, startPos);
-	dtVset(hit->hitNormal, 0, 0, 0);
 
-	dtStatus status = DT_SUCCESS;
-
-	const dtMeshTile* prevTile, *tile, *nextTile;
-	const dtPoly* prevPoly, *poly, *nextPoly;
-	dtPolyRef curRef;
+	if (!neighbourhood || !updateNeighbourhood(neighbourhood, startRef, centerPos, radius, filter))
+		return findPolysAroundCircle(startRef, centerPos, radius, filter, resultRef, resultParent, resultCost,
+									 resultCount, maxResult);
 
-	// The API input has been checked already, skip checking internal data.
-	curRef = startRef;
-	tile = 0;
-	poly = 0;
-	m_nav->getTileAndPolyByRefUnsafe(curRef, &tile, &poly);
-	nextTile = prevTile = tile;
-	nextPoly = prevPoly = poly;
-	if (prevRef)
-		m_nav->getTileAndPolyByRefUnsafe(prevRef, &prevTile, &prevPoly);
+	const int kept = neighbourhood->m_current;
 
-	while (curRef)
+	m_nodePool->clear();
+	m_openList->clear();
+	
+	dtNode* startNode = m_nodePool->getNode(startRef);
+	dtVcopy(startNode->pos, centerPos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = 0;
+	startNode->id = startRef;
+	startNode->flags = DT_NODE_OPEN;
+	m_openList->push(startNode);
+	
+	dtStatus status = DT_SUCCESS;
+	
+	int n = 0;
+	
+	const float radiusSqr = dtSqr(radius);
+	
+	while (!m_openList->empty())
 	{
-		// Cast ray against current polygon.
+		dtNode* bestNode = m_openList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
 		
-		// Collect vertices.
-		int nv = 0;
-		for (int i = 0; i < (int)poly->vertCount; ++i)
-		{
-			dtVcopy(&verts[nv*3], &tile->verts[poly->verts[i]*3]);
-			nv++;
-		}
+		const dtPolyRef bestRef = bestNode->id;
+		const dtMeshTile* bestTile = 0;
+		const dtPoly* bestPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
 		
-		float tmin, tmax;
-		int segMin, segMax;
-		if (!dtIntersectSegmentPoly2D(startPos, endPos, verts, nv, tmin, tmax, segMin, segMax))
+		// Get parent poly and tile.
+		dtPolyRef parentRef = 0;
+		const dtMeshTile* parentTile = 0;
+		const dtPoly* parentPoly = 0;
+		if (bestNode->pidx)
+			parentRef = m_nodePool->getNodeAtIdx(bestNode->pidx)->id;
+		if (parentRef)
+			m_nav->getTileAndPolyByRefUnsafe(parentRef, &parentTile, &parentPoly);
+		DT_QUERY_STAT(m_stats.nodesExpanded++);
+
+		if (n < maxResult)
 		{
-			// Could not hit the polygon, keep the old t and report hit.
-			hit->pathCount = n;
-			return status;
+			if (resultRef)
+				resultRef[n] = bestRef;
+			if (resultParent)
+				resultParent[n] = parentRef;
+			if (resultCost)
+				resultCost[n] = bestNode->total;
+			++n;
 		}
-
-		hit->hitEdgeIndex = segMax;
-
-		// Keep track of furthest t so far.
-		if (tmax > hit->t)
-			hit->t = tmax;
-		
-		// Store visited polygons.
-		if (n < hit->maxPath)
-			hit->path[n++] = curRef;
 		else
-			status |= DT_BUFFER_TOO_SMALL;
-
-		// Ray end is completely inside the polygon.
-		if (segMax == -1)
 		{
-			hit->t = FLT_MAX;
-			hit->pathCount = n;
-			
-			// add the cost
-			if (options & DT_RAYCAST_USE_COSTS)
-				hit->pathCost += filter->getCost(curPos, endPos, prevRef, prevTile, prevPoly, curRef, tile, poly, curRef, tile, poly);
-			return status;
+			status |= DT_BUFFER_TOO_SMALL;
 		}
 
-		// Follow neighbours.
-		dtPolyRef nextRef = 0;
+		// Every polygon reached is kept, see updateNeighbourhood.
+		const int bestIdx = neighbourhood->findPoly(kept, bestRef);
+		dtAssert(bestIdx != -1);
+		if (bestIdx == -1)
+			continue;
+		const dtNeighbourhoodPoly& best = neighbourhood->m_polys[kept][bestIdx];
+		const dtNeighbourhoodEdge* edges = neighbourhood->getEdges(kept, best);
 		
-		for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+		for (int i = 0; i < best.edgeCount; ++i)
 		{
-			const dtLink* link = &tile->links[i];
-			
-			// Find link which contains this edge.
-			if ((int)link->edge != segMax)
-				continue;
-			
-			// Get pointer to the next polygon.
-			nextTile = 0;
-			nextPoly = 0;
-			m_nav->getTileAndPolyByRefUnsafe(link->ref, &nextTile, &nextPoly);
-			
-			// Skip off-mesh connections.
-			if (nextPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+			const dtNeighbourhoodEdge& edge = edges[i];
+			const dtPolyRef neighbourRef = edge.ref;
+			// Skip the edges the filter or the clearance excludes, and do not follow back to parent.
+			if (!(edge.flags & DT_NEIGHBOURHOOD_EDGE_PASSABLE) || neighbourRef == parentRef)
 				continue;
 			
-			// Skip links based on filter.
-			if (!filter->passFilter(link->ref, nextTile, nextPoly))
+			// If the circle is not touching the next polygon, skip it.
+			const float* va = &edge.portal[0];
+			const float* vb = &edge.portal[3];
+			float tseg;
+			float distSqr = dtDistancePtSegSqr2D(centerPos, va, vb, tseg);
+			if (distSqr > radiusSqr)
 				continue;
 			
-			// If the link is internal, just return the ref.
-			if (link->side == 0xff)
+			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef);
+			if (!neighbourNode)
 			{
-				nextRef = link->ref;
-				break;
+				status |= DT_OUT_OF_NODES;
+				continue;
 			}
+				
+			if (neighbourNode->flags & DT_NODE_CLOSED)
+				continue;
+
+			const dtMeshTile* neighbourTile = 0;
+			const dtPoly* neighbourPoly = 0;
+			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
 			
-			// If the link is at tile boundary,
+			// Cost
+			if (neighbourNode->flags == 0)
+				dtVlerp(neighbourNode->pos, va, vb, 0.5f);
 			
-			// Check if the link spans the whole edge, and accept.
-			if (link->bmin == 0 && link->bmax == 255)
-			{
-				nextRef = link->ref;
-				break;
-			}
+			float cost = filter->getCost(
+				bestNode->pos, neighbourNode->pos,
+				parentRef, parentTile, parentPoly,
+				bestRef, bestTile, bestPoly,
+				neighbourRef, neighbourTile, neighbourPoly);
+			DT_QUERY_STAT(m_stats.costCalls++);
+
+			const float total = bestNode->total + cost;
+			
+			// The node is already in open list and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+				continue;
 			
-			// Check for partial edge links.
-			const int v0 = poly->verts[link->edge];
-			const int v1 = poly->verts[(link->edge+1) % poly->vertCount];
-			const float* left = &tile->verts[v0*3];
-			const float* right = &tile->verts[v1*3];
+			neighbourNode->id = neighbourRef;
+			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+			neighbourNode->total = total;
 			
-			// Check that the intersection lies inside the link portal.
-			if (link->side == 0 || link->side == 4)
+			if (neighbourNode->flags & DT_NODE_OPEN)
 			{
-				// Calculate link size.
-				const float s = 1.0f/255.0f;
-				float lmin = left[2] + (right[2] - left[2])*(link->bmin*s);
-				float lmax = left[2] + (right[2] - left[2])*(link->bmax*s);
-				if (lmin > lmax) dtSwap(lmin, lmax);
-				
-				// Find Z intersection.
-				float z = startPos[2] + (endPos[2]-startPos[2])*tmax;
-				if (z >= lmin && z <= lmax)
-				{
-					nextRef = link->ref;
-					break;
-				}
+				m_openList->modify(neighbourNode);
 			}
-			else if (link->side == 2 || link->side == 6)
+			else
 			{
-				// Calculate link size.
-				const float s = 1.0f/255.0f;
-				float lmin = left[0] + (right[0] - left[0])*(link->bmin*s);
-				float lmax = left[0] + (right[0] - left[0])*(link->bmax*s);
-				if (lmin > lmax) dtSwap(lmin, lmax);
-				
-				// Find X intersection.
-				float x = startPos[0] + (endPos[0]-startPos[0])*tmax;
-				if (x >= lmin && x <= lmax)
-				{
-					nextRef = link->ref;
-					break;
-				}
+				neighbourNode->flags = DT_NODE_OPEN;
+				m_openList->push(neighbourNode);
 			}
 		}
-		
-		// add the cost
-		if (options & DT_RAYCAST_USE_COSTS)
-		{
-			// compute the intersection point at the furthest end of the polygon
-			// and correct the height (since the raycast moves in 2d)
-			dtVcopy(lastPos, curPos);
-			dtVmad(curPos, startPos, dir, hit->t);
-			float* e1 = &verts[segMax*3];
-			float* e2 = &verts[((segMax+1)%nv)*3];
-			float eDir[3], diff[3];
-			dtVsub(eDir, e2, e1);
-			dtVsub(diff, curPos, e1);
-			float s = dtSqr(eDir[0]) > dtSqr(eDir[2]) ? diff[0] / eDir[0] : diff[2] / eDir[2];
-			curPos[1] = e1[1] + eDir[1] * s;
-
-			hit->pathCost += filter->getCost(lastPos, curPos, prevRef, prevTile, prevPoly, curRef, tile, poly, nextRef, nextTile, nextPoly);
-		}
-
-		if (!nextRef)
-		{
-			// No neighbour, we hit a wall.
-			
-			// Calculate hit normal.
-			const int a = segMax;
-			const int b = segMax+1 < nv ? segMax+1 : 0;
-			const float* va = &verts[a*3];
-			const float* vb = &verts[b*3];
-			const float dx = vb[0] - va[0];
-			const float dz = vb[2] - va[2];
-			hit->hitNormal[0] = dz;
-			hit->hitNormal[1] = 0;
-			hit->hitNormal[2] = -dx;
-			dtVnormalize(hit->hitNormal);
-			
-			hit->pathCount = n;
-			return status;
-		}
-
-		// No hit, advance to neighbour polygon.
-		prevRef = curRef;
-		curRef = nextRef;
-		prevTile = tile;
-		tile = nextTile;
-		prevPoly = poly;
-		poly = nextPoly;
 	}
 	
-	hit->pathCount = n;
+	*resultCount = n;
+
+	DT_QUERY_STAT(countQuery(status, m_nodePool->getNodeCount()));
 	
 	return status;
 }
 
 /// @par
 ///
+/// The order of the result set is from least to highest cost.
+/// 
 /// At least one result array must be provided.
 ///
-/// The order of the result set is from least to highest cost to reach the polygon.
-///
 /// A common use case for this method is to perform Dijkstra searches. 
-/// Candidate polygons are found by searching the graph beginning at the start polygon.
-///
-/// If a polygon is not found via the graph search, even if it intersects the 
-/// search circle, it will not be included in the result set. For example:
-///
-/// polyA is the start polygon.
-/// polyB shares an edge with polyA. (Is adjacent.)
-/// polyC shares an edge with polyB, but not with polyA
-/// Even if the search circle overlaps polyC, it will not be included in the 
-/// result set unless polyB is also in the set.
+/// Candidate polygons are found by searching the graph beginning at the start 
+/// polygon.
 /// 
-/// The value of the center point is used as the start position for cost 
-/// calculations. It is not projected onto the surface of the mesh, so its 
-/// y-value will effect the costs.
-///
-/// Intersection tests occur in 2D. All polygons and the search circle are 
-/// projected onto the xz-plane. So the y-value of the center point does not 
-/// effect intersection tests.
-///
-/// If the result arrays are to small to hold the entire result set, they will be 
-/// filled to capacity.
+/// The same intersection test restrictions that apply to findPolysAroundCircle()
+/// method apply to this method.
 /// 
-dtStatus dtNavMeshQuery::findPolysAroundCircle(dtPolyRef startRef, const float* centerPos, const float radius,
-											   const dtQueryFilter* filter,
-											   dtPolyRef* resultRef, dtPolyRef* resultParent, float* resultCost,
-											   int* resultCount, const int maxResult) const
+/// The 3D centroid of the search polygon is used as the start position for cost 
+/// calculations.
+/// 
+/// Intersection tests occur in 2D. All polygons are projected onto the 
+/// xz-plane. So the y-values of the vertices do not effect intersection tests.
+/// 
+/// If the result arrays are is too small to hold the entire result set, they will 
+/// be filled to capacity.
+///
+dtStatus dtNavMeshQuery::findPolysAroundShape(dtPolyRef startRef, const float* verts, const int nverts,
+											  const dtQueryFilter* filter,
+											  dtPolyRef* resultRef, dtPolyRef* resultParent, float* resultCost,
+											  int* resultCount, const int maxResult) const
 {
 	dtAssert(m_nav);
 	dtAssert(m_nodePool);
@@ -2732,16 +4890,24 @@ dtStatus dtNavMeshQuery::findPolysAroundCircle(dtPolyRef startRef, const float*
 	*resultCount = 0;
 
 	if (!m_nav->isValidPolyRef(startRef) ||
-		!centerPos || !dtVisfinite(centerPos) ||
-		radius < 0 || !dtMathIsfinite(radius) ||
+		!verts || nverts < 3 ||
 		!filter || maxResult < 0)
 	{
 		return DT_FAILURE | DT_INVALID_PARAM;
 	}
 	
+	// Validate input
+	if (!startRef || !m_nav->isValidPolyRef(startRef))
+		return DT_FAILURE | DT_INVALID_PARAM;
+	
 	m_nodePool->clear();
 	m_openList->clear();
 	
+	float centerPos[3] = {0,0,0};
+	for (int i = 0; i < nverts; ++i)
+		dtVadd(centerPos,centerPos,&verts[i*3]);
+	dtVscale(centerPos,centerPos,1.0f/nverts);
+
 	dtNode* startNode = m_nodePool->getNode(startRef);
 	dtVcopy(startNode->pos, centerPos);
 	startNode->pidx = 0;
@@ -2752,11 +4918,9 @@ dtStatus dtNavMeshQuery::findPolysAroundCircle(dtPolyRef startRef, const float*
 	m_openList->push(startNode);
 	
 	dtStatus status = DT_SUCCESS;
-	
+
 	int n = 0;
 	
-	const float radiusSqr = dtSqr(radius);
-	
 	while (!m_openList->empty())
 	{
 		dtNode* bestNode = m_openList->pop();
@@ -2787,6 +4951,7 @@ dtStatus dtNavMeshQuery::findPolysAroundCircle(dtPolyRef startRef, const float*
 				resultParent[n] = parentRef;
 			if (resultCost)
 				resultCost[n] = bestNode->total;
+
 			++n;
 		}
 		else
@@ -2801,25 +4966,30 @@ dtStatus dtNavMeshQuery::findPolysAroundCircle(dtPolyRef startRef, const float*
 			// Skip invalid neighbours and do not follow back to parent.
 			if (!neighbourRef || neighbourRef == parentRef)
 				continue;
+			// Skip edges narrower than the agent.
+			if (!dtPassEdgeClearance(bestTile, bestPoly, link->edge, filter->getAgentRadius()))
+				continue;
 			
 			// Expand to neighbour
 			const dtMeshTile* neighbourTile = 0;
 			const dtPoly* neighbourPoly = 0;
 			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
-		
+			
 			// Do not advance if the polygon is excluded by the filter.
 			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
 				continue;
 			
 			// Find edge and calc distance to the edge.
 			float va[3], vb[3];
-			if (!getPortalPoints(bestRef, bestPoly, bestTile, neighbourRef, neighbourPoly, neighbourTile, va, vb))
+			if (dtStatusFailed(getLinkPortalPoints(bestRef, bestPoly, bestTile, i, neighbourPoly, neighbourTile, va, vb)))
 				continue;
 			
-			// If the circle is not touching the next polygon, skip it.
-			float tseg;
-			float distSqr = dtDistancePtSegSqr2D(centerPos, va, vb, tseg);
-			if (distSqr > radiusSqr)
+			// If the poly is not touching the edge to the next polygon, skip the connection it.
+			float tmin, tmax;
+			int segMin, segMax;
+			if (!dtIntersectSegmentPoly2D(va, vb, verts, nverts, tmin, tmax, segMin, segMax))
+				continue;
+			if (tmin > 1.0f || tmax < 0.0f)
 				continue;
 			
 			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef);
@@ -2828,7 +4998,7 @@ dtStatus dtNavMeshQuery::findPolysAroundCircle(dtPolyRef startRef, const float*
 				status |= DT_OUT_OF_NODES;
 				continue;
 			}
-				
+			
 			if (neighbourNode->flags & DT_NODE_CLOSED)
 				continue;
 			
@@ -2869,87 +5039,110 @@ dtStatus dtNavMeshQuery::findPolysAroundCircle(dtPolyRef startRef, const float*
 	return status;
 }
 
+namespace
+{
+/// A target of a distance query, sorted by its polygon so that the settled polygons find their targets quickly.
+struct dtDistanceTarget
+{
+	dtPolyRef ref;
+	int index;
+};
+
+int compareDistanceTargets(const void* va, const void* vb)
+{
+	const dtDistanceTarget* a = (const dtDistanceTarget*)va;
+	const dtDistanceTarget* b = (const dtDistanceTarget*)vb;
+	if (a->ref != b->ref) return a->ref < b->ref ? -1 : 1;
+	return a->index - b->index;
+}
+} // anonymous namespace
+
 /// @par
 ///
-/// The order of the result set is from least to highest cost.
-/// 
-/// At least one result array must be provided.
+/// The search is a Dijkstra search which stops once every target is settled, or once the
+/// cheapest open polygon costs more than @p maxCost. It replaces a findPath per target when the
+/// costs to many candidate positions are needed.
 ///
-/// A common use case for this method is to perform Dijkstra searches. 
-/// Candidate polygons are found by searching the graph beginning at the start 
-/// polygon.
-/// 
-/// The same intersection test restrictions that apply to findPolysAroundCircle()
-/// method apply to this method.
-/// 
-/// The 3D centroid of the search polygon is used as the start position for cost 
-/// calculations.
-/// 
-/// Intersection tests occur in 2D. All polygons are projected onto the 
-/// xz-plane. So the y-values of the vertices do not effect intersection tests.
-/// 
-/// If the result arrays are is too small to hold the entire result set, they will 
-/// be filled to capacity.
+/// Targets whose polygons are not valid are not reached, they do not fail the query.
 ///
-dtStatus dtNavMeshQuery::findPolysAroundShape(dtPolyRef startRef, const float* verts, const int nverts,
-											  const dtQueryFilter* filter,
-											  dtPolyRef* resultRef, dtPolyRef* resultParent, float* resultCost,
-											  int* resultCount, const int maxResult) const
+/// The paths to the targets reached can be retrieved with #getPathFromDijkstraSearch.
+///
+dtStatus dtNavMeshQuery::findDistances(dtPolyRef startRef, const float* startPos,
+									   const dtPolyRef* targetRefs, const float* targetPositions, const int targetCount,
+									   const dtQueryFilter* filter, const float maxCost,
+									   float* resultCosts, int* reachedCount) const
 {
 	dtAssert(m_nav);
 	dtAssert(m_nodePool);
 	dtAssert(m_openList);
 
-	if (!resultCount)
+	if (reachedCount)
+		*reachedCount = 0;
+
+	if (!m_nav->isValidPolyRef(startRef) ||
+		!startPos || !dtVisfinite(startPos) ||
+		targetCount < 0 || (targetCount > 0 && (!targetRefs || !resultCosts)) ||
+		!filter || !(maxCost >= 0.0f))
+	{
 		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+	if (targetPositions)
+	{
+		for (int i = 0; i < targetCount; ++i)
+		{
+			if (!dtVisfinite(&targetPositions[i*3]))
+				return DT_FAILURE | DT_INVALID_PARAM;
+		}
+	}
 
-	*resultCount = 0;
+	for (int i = 0; i < targetCount; ++i)
+		resultCosts[i] = FLT_MAX;
+	if (targetCount == 0)
+		return DT_SUCCESS;
 
-	if (!m_nav->isValidPolyRef(startRef) ||
-		!verts || nverts < 3 ||
-		!filter || maxResult < 0)
+	dtDistanceTarget* targets = (dtDistanceTarget*)m_allocator->alloc(sizeof(dtDistanceTarget)*targetCount, DT_ALLOC_TEMP);
+	if (!targets)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	int remaining = 0;
+	for (int i = 0; i < targetCount; ++i)
 	{
-		return DT_FAILURE | DT_INVALID_PARAM;
+		if (!m_nav->isValidPolyRef(targetRefs[i]))
+			continue;
+		targets[remaining].ref = targetRefs[i];
+		targets[remaining].index = i;
+		remaining++;
 	}
-	
-	// Validate input
-	if (!startRef || !m_nav->isValidPolyRef(startRef))
-		return DT_FAILURE | DT_INVALID_PARAM;
-	
+	const int ntargets = remaining;
+	qsort(targets, (size_t)ntargets, sizeof(dtDistanceTarget), compareDistanceTargets);
+
 	m_nodePool->clear();
 	m_openList->clear();
-	
-	float centerPos[3] = {0,0,0};
-	for (int i = 0; i < nverts; ++i)
-		dtVadd(centerPos,centerPos,&verts[i*3]);
-	dtVscale(centerPos,centerPos,1.0f/nverts);
 
 	dtNode* startNode = m_nodePool->getNode(startRef);
-	dtVcopy(startNode->pos, centerPos);
+	dtVcopy(startNode->pos, startPos);
 	startNode->pidx = 0;
 	startNode->cost = 0;
 	startNode->total = 0;
 	startNode->id = startRef;
 	startNode->flags = DT_NODE_OPEN;
 	m_openList->push(startNode);
-	
+
 	dtStatus status = DT_SUCCESS;
+	int reached = 0;
 
-	int n = 0;
-	
-	while (!m_openList->empty())
+	while (remaining > 0 && !m_openList->empty() && m_openList->top()->total <= maxCost)
 	{
 		dtNode* bestNode = m_openList->pop();
 		bestNode->flags &= ~DT_NODE_OPEN;
 		bestNode->flags |= DT_NODE_CLOSED;
-		
+
 		// Get poly and tile.
 		// The API input has been checked already, skip checking internal data.
 		const dtPolyRef bestRef = bestNode->id;
 		const dtMeshTile* bestTile = 0;
 		const dtPoly* bestPoly = 0;
 		m_nav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
-		
+
 		// Get parent poly and tile.
 		dtPolyRef parentRef = 0;
 		const dtMeshTile* parentTile = 0;
@@ -2958,23 +5151,38 @@ dtStatus dtNavMeshQuery::findPolysAroundShape(dtPolyRef startRef, const float* v
 			parentRef = m_nodePool->getNodeAtIdx(bestNode->pidx)->id;
 		if (parentRef)
 			m_nav->getTileAndPolyByRefUnsafe(parentRef, &parentTile, &parentPoly);
+		DT_QUERY_STAT(m_stats.nodesExpanded++);
 
-		if (n < maxResult)
+		// Settle the targets within the polygon.
+		int lo = 0, hi = ntargets;
+		while (lo < hi)
 		{
-			if (resultRef)
-				resultRef[n] = bestRef;
-			if (resultParent)
-				resultParent[n] = parentRef;
-			if (resultCost)
-				resultCost[n] = bestNode->total;
-
-			++n;
+			const int mid = (lo + hi) / 2;
+			if (targets[mid].ref < bestRef)
+				lo = mid + 1;
+			else
+				hi = mid;
 		}
-		else
+		for (int i = lo; i < ntargets && targets[i].ref == bestRef; ++i)
 		{
-			status |= DT_BUFFER_TOO_SMALL;
+			const int index = targets[i].index;
+			float cost = bestNode->total;
+			if (targetPositions)
+			{
+				cost += filter->getCost(bestNode->pos, &targetPositions[index*3],
+										parentRef, parentTile, parentPoly,
+										bestRef, bestTile, bestPoly,
+										0, 0, 0);
+				DT_QUERY_STAT(m_stats.costCalls++);
+			}
+			if (cost <= maxCost)
+			{
+				resultCosts[index] = cost;
+				reached++;
+			}
+			remaining--;
 		}
-		
+
 		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
 		{
 			const dtLink* link = &bestTile->links[i];
@@ -2982,59 +5190,56 @@ dtStatus dtNavMeshQuery::findPolysAroundShape(dtPolyRef startRef, const float* v
 			// Skip invalid neighbours and do not follow back to parent.
 			if (!neighbourRef || neighbourRef == parentRef)
 				continue;
-			
+			// Skip edges narrower than the agent.
+			if (!dtPassEdgeClearance(bestTile, bestPoly, link->edge, filter->getAgentRadius()))
+				continue;
+
 			// Expand to neighbour
 			const dtMeshTile* neighbourTile = 0;
 			const dtPoly* neighbourPoly = 0;
 			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
-			
+
 			// Do not advance if the polygon is excluded by the filter.
+			DT_QUERY_STAT(m_stats.filterCalls++);
 			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
 				continue;
-			
-			// Find edge and calc distance to the edge.
-			float va[3], vb[3];
-			if (!getPortalPoints(bestRef, bestPoly, bestTile, neighbourRef, neighbourPoly, neighbourTile, va, vb))
-				continue;
-			
-			// If the poly is not touching the edge to the next polygon, skip the connection it.
-			float tmin, tmax;
-			int segMin, segMax;
-			if (!dtIntersectSegmentPoly2D(va, vb, verts, nverts, tmin, tmax, segMin, segMax))
-				continue;
-			if (tmin > 1.0f || tmax < 0.0f)
-				continue;
-			
+			DT_QUERY_STAT(m_stats.tilesTouched += neighbourTile != bestTile);
+
 			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef);
 			if (!neighbourNode)
 			{
 				status |= DT_OUT_OF_NODES;
 				continue;
 			}
-			
+
 			if (neighbourNode->flags & DT_NODE_CLOSED)
 				continue;
-			
+
 			// Cost
 			if (neighbourNode->flags == 0)
-				dtVlerp(neighbourNode->pos, va, vb, 0.5f);
-			
-			float cost = filter->getCost(
+			{
+				getLinkMidPoint(bestRef, bestPoly, bestTile, i,
+								neighbourPoly, neighbourTile,
+								neighbourNode->pos);
+			}
+
+			const float total = bestNode->total + filter->getCost(
 				bestNode->pos, neighbourNode->pos,
 				parentRef, parentTile, parentPoly,
 				bestRef, bestTile, bestPoly,
 				neighbourRef, neighbourTile, neighbourPoly);
+			DT_QUERY_STAT(m_stats.costCalls++);
 
-			const float total = bestNode->total + cost;
-			
-			// The node is already in open list and the new result is worse, skip.
-			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+			// Polygons beyond the cost limit are not needed, and the node is already in open
+			// list with a better result, skip.
+			if (total > maxCost || ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total))
 				continue;
-			
+
 			neighbourNode->id = neighbourRef;
 			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+			neighbourNode->cost = total;
 			neighbourNode->total = total;
-			
+
 			if (neighbourNode->flags & DT_NODE_OPEN)
 			{
 				m_openList->modify(neighbourNode);
@@ -3046,9 +5251,13 @@ dtStatus dtNavMeshQuery::findPolysAroundShape(dtPolyRef startRef, const float* v
 			}
 		}
 	}
-	
-	*resultCount = n;
-	
+
+	m_allocator->free(targets);
+
+	if (reachedCount)
+		*reachedCount = reached;
+	DT_QUERY_STAT(countQuery(status, m_nodePool->getNodeCount()));
+
 	return status;
 }
 
@@ -3164,6 +5373,9 @@ dtStatus dtNavMeshQuery::findLocalNeighbourhood(dtPolyRef startRef, const float*
 			// Skip invalid neighbours.
 			if (!neighbourRef)
 				continue;
+			// Skip edges narrower than the agent.
+			if (!dtPassEdgeClearance(curTile, curPoly, link->edge, filter->getAgentRadius()))
+				continue;
 			
 			// Skip if cannot alloca more nodes.
 			dtNode* neighbourNode = m_tinyNodePool->getNode(neighbourRef);
@@ -3188,7 +5400,7 @@ dtStatus dtNavMeshQuery::findLocalNeighbourhood(dtPolyRef startRef, const float*
 			
 			// Find edge and calc distance to the edge.
 			float va[3], vb[3];
-			if (!getPortalPoints(curRef, curPoly, curTile, neighbourRef, neighbourPoly, neighbourTile, va, vb))
+			if (dtStatusFailed(getLinkPortalPoints(curRef, curPoly, curTile, i, neighbourPoly, neighbourTile, va, vb)))
 				continue;
 			
 			// If the circle is not touching the next polygon, skip it.
@@ -3207,7 +5419,7 @@ dtStatus dtNavMeshQuery::findLocalNeighbourhood(dtPolyRef startRef, const float*
 			// Collect vertices of the neighbour poly.
 			const int npa = neighbourPoly->vertCount;
 			for (int k = 0; k < npa; ++k)
-				dtVcopy(&pa[k*3], &neighbourTile->verts[neighbourPoly->verts[k]*3]);
+				dtGetTileVertex(neighbourTile, neighbourPoly->verts[k], &pa[k*3]);
 			
 			bool overlap = false;
 			for (int j = 0; j < n; ++j)
@@ -3235,7 +5447,7 @@ dtStatus dtNavMeshQuery::findLocalNeighbourhood(dtPolyRef startRef, const float*
 				// Get vertices and test overlap
 				const int npb = pastPoly->vertCount;
 				for (int k = 0; k < npb; ++k)
-					dtVcopy(&pb[k*3], &pastTile->verts[pastPoly->verts[k]*3]);
+					dtGetTileVertex(pastTile, pastPoly->verts[k], &pb[k*3]);
 				
 				if (dtOverlapPolyPoly2D(pa,npa, pb,npb))
 				{
@@ -3272,6 +5484,187 @@ dtStatus dtNavMeshQuery::findLocalNeighbourhood(dtPolyRef startRef, const float*
 }
 
 
+/// @par
+///
+/// The results are the same as the search without the neighbourhood, see
+/// findPolysAroundCircle, except that the search is not limited by the size of
+/// the small node pool of the query.
+dtStatus dtNavMeshQuery::findLocalNeighbourhood(dtPolyRef startRef, const float* centerPos, const float radius,
+												const dtQueryFilter* filter, dtNavMeshNeighbourhood* neighbourhood,
+												dtPolyRef* resultRef, dtPolyRef* resultParent,
+												int* resultCount, const int maxResult) const
+{
+	dtAssert(m_nav);
+
+	if (!resultCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*resultCount = 0;
+
+	if (!m_nav->isValidPolyRef(startRef) ||
+		!centerPos || !dtVisfinite(centerPos) ||
+		radius < 0 || !dtMathIsfinite(radius) ||
+		!filter || maxResult < 0)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	if (!neighbourhood || !updateNeighbourhood(neighbourhood, startRef, centerPos, radius, filter))
+		return findLocalNeighbourhood(startRef, centerPos, radius, filter, resultRef, resultParent, resultCount, maxResult);
+
+	const int kept = neighbourhood->m_current;
+	const dtNeighbourhoodPoly* polys = neighbourhood->m_polys[kept];
+	unsigned int* marks = neighbourhood->m_marks;
+	int* results = neighbourhood->m_results;
+	neighbourhood->beginMarks();
+	const unsigned int stamp = neighbourhood->m_stamp;
+
+	static const int MAX_STACK = 48;
+	int stack[MAX_STACK];
+	int nstack = 0;
+
+	const int startIdx = neighbourhood->findPoly(kept, startRef);
+	marks[startIdx] = stamp;
+	stack[nstack++] = startIdx;
+	
+	const float radiusSqr = dtSqr(radius);
+	
+	float pa[DT_VERTS_PER_POLYGON*3];
+	float pb[DT_VERTS_PER_POLYGON*3];
+	
+	dtStatus status = DT_SUCCESS;
+	
+	int n = 0;
+	if (n < maxResult)
+	{
+		resultRef[n] = startRef;
+		results[n] = startIdx;
+		if (resultParent)
+			resultParent[n] = 0;
+		++n;
+	}
+	else
+	{
+		status |= DT_BUFFER_TOO_SMALL;
+	}
+	
+	while (nstack)
+	{
+		// Pop front.
+		const dtNeighbourhoodPoly& cur = polys[stack[0]];
+		for (int i = 0; i < nstack-1; ++i)
+			stack[i] = stack[i+1];
+		nstack--;
+		
+		const dtPolyRef curRef = cur.ref;
+		const dtNeighbourhoodEdge* edges = neighbourhood->getEdges(kept, cur);
+		
+		for (int i = 0; i < cur.edgeCount; ++i)
+		{
+			const dtNeighbourhoodEdge& edge = edges[i];
+			// Skip the edges the filter or the clearance excludes, and off-mesh connections.
+			if ((edge.flags & (DT_NEIGHBOURHOOD_EDGE_PASSABLE | DT_NEIGHBOURHOOD_EDGE_OFFMESH)) != DT_NEIGHBOURHOOD_EDGE_PASSABLE)
+				continue;
+			
+			// If the circle is not touching the next polygon, skip it.
+			float tseg;
+			float distSqr = dtDistancePtSegSqr2D(centerPos, &edge.portal[0], &edge.portal[3], tseg);
+			if (distSqr > radiusSqr)
+				continue;
+
+			// Every polygon in range is kept, see updateNeighbourhood.
+			const dtPolyRef neighbourRef = edge.ref;
+			const int neighbourIdx = edge.index;
+			dtAssert(neighbourIdx != -1);
+			// Skip visited.
+			if (neighbourIdx == -1 || marks[neighbourIdx] == stamp)
+				continue;
+			
+			// Mark node visited, this is done before the overlap test so that
+			// we will not visit the poly again if the test fails.
+			marks[neighbourIdx] = stamp;
+			
+			// Check that the polygon does not collide with existing polygons.
+			const dtMeshTile* neighbourTile = 0;
+			const dtPoly* neighbourPoly = 0;
+			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
+			const float* bounds = polys[neighbourIdx].bounds;
+			
+			// Collect vertices of the neighbour poly.
+			const int npa = neighbourPoly->vertCount;
+			for (int k = 0; k < npa; ++k)
+				dtGetTileVertex(neighbourTile, neighbourPoly->verts[k], &pa[k*3]);
+			
+			bool overlap = false;
+			for (int j = 0; j < n; ++j)
+			{
+				dtPolyRef pastRef = resultRef[j];
+
+				// Polygons with separate bounds do not overlap, every result is kept.
+				const float* pastBounds = polys[results[j]].bounds;
+				if (pastBounds[0] > bounds[2] || pastBounds[2] < bounds[0] ||
+					pastBounds[1] > bounds[3] || pastBounds[3] < bounds[1])
+					continue;
+				
+				// Connected polys do not overlap.
+				bool connected = false;
+				for (int k = 0; k < cur.edgeCount; ++k)
+				{
+					if (edges[k].ref == pastRef)
+					{
+						connected = true;
+						break;
+					}
+				}
+				if (connected)
+					continue;
+				
+				// Potentially overlapping.
+				const dtMeshTile* pastTile = 0;
+				const dtPoly* pastPoly = 0;
+				m_nav->getTileAndPolyByRefUnsafe(pastRef, &pastTile, &pastPoly);
+				
+				// Get vertices and test overlap
+				const int npb = pastPoly->vertCount;
+				for (int k = 0; k < npb; ++k)
+					dtGetTileVertex(pastTile, pastPoly->verts[k], &pb[k*3]);
+				
+				if (dtOverlapPolyPoly2D(pa,npa, pb,npb))
+				{
+					overlap = true;
+					break;
+				}
+			}
+			if (overlap)
+				continue;
+			
+			// This poly is fine, store and advance to the poly.
+			if (n < maxResult)
+			{
+				resultRef[n] = neighbourRef;
+				results[n] = neighbourIdx;
+				if (resultParent)
+					resultParent[n] = curRef;
+				++n;
+			}
+			else
+			{
+				status |= DT_BUFFER_TOO_SMALL;
+			}
+			
+			if (nstack < MAX_STACK)
+			{
+				stack[nstack++] = neighbourIdx;
+			}
+		}
+	}
+	
+	*resultCount = n;
+	
+	return status;
+}
+
+
 struct dtSegInterval
 {
 	dtPolyRef ref;
@@ -3306,7 +5699,8 @@ static void insertInterval(dtSegInterval* ints, int& nints, const int maxInts,
 /// Otherwise only the wall segments are returned.
 /// 
 /// A segment that is normally a portal will be included in the result set as a 
-/// wall if the @p filter results in the neighbor polygon becoomming impassable.
+/// wall if the @p filter results in the neighbor polygon becoomming impassable,
+/// or if the portal is narrower than the agent radius of the @p filter.
 /// 
 /// The @p segmentVerts and @p segmentRefs buffers should normally be sized for the 
 /// maximum segments per polygon of the source navigation mesh.
@@ -3341,9 +5735,10 @@ dtStatus dtNavMeshQuery::getPolyWallSegments(dtPolyRef ref, const dtQueryFilter*
 	
 	for (int i = 0, j = (int)poly->vertCount-1; i < (int)poly->vertCount; j = i++)
 	{
-		// Skip non-solid edges.
+		// Skip non-solid edges. Edges narrower than the agent are walls.
 		nints = 0;
-		if (poly->neis[j] & DT_EXT_LINK)
+		const bool passable = dtPassEdgeClearance(tile, poly, j, filter->getAgentRadius());
+		if (passable && (poly->neis[j] & DT_EXT_LINK))
 		{
 			// Tile border.
 			for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
@@ -3368,7 +5763,7 @@ dtStatus dtNavMeshQuery::getPolyWallSegments(dtPolyRef ref, const dtQueryFilter*
 		{
 			// Internal edge
 			dtPolyRef neiRef = 0;
-			if (poly->neis[j])
+			if (passable && poly->neis[j])
 			{
 				const unsigned int idx = (unsigned int)(poly->neis[j]-1);
 				neiRef = m_nav->getPolyRefBase(tile) | idx;
@@ -3382,8 +5777,9 @@ dtStatus dtNavMeshQuery::getPolyWallSegments(dtPolyRef ref, const dtQueryFilter*
 			
 			if (n < maxSegments)
 			{
-				const float* vj = &tile->verts[poly->verts[j]*3];
-				const float* vi = &tile->verts[poly->verts[i]*3];
+				float vj[3], vi[3];
+				dtGetTileVertex(tile, poly->verts[j], vj);
+				dtGetTileVertex(tile, poly->verts[i], vi);
 				float* seg = &segmentVerts[n*6];
 				dtVcopy(seg+0, vj);
 				dtVcopy(seg+3, vi);
@@ -3404,8 +5800,9 @@ dtStatus dtNavMeshQuery::getPolyWallSegments(dtPolyRef ref, const dtQueryFilter*
 		insertInterval(ints, nints, MAX_INTERVAL, 255, 256, 0);
 		
 		// Store segments.
-		const float* vj = &tile->verts[poly->verts[j]*3];
-		const float* vi = &tile->verts[poly->verts[i]*3];
+		float vj[3], vi[3];
+		dtGetTileVertex(tile, poly->verts[j], vj);
+		dtGetTileVertex(tile, poly->verts[i], vi);
 		for (int k = 1; k < nints; ++k)
 		{
 			// Portal segment.
@@ -3467,6 +5864,9 @@ dtStatus dtNavMeshQuery::getPolyWallSegments(dtPolyRef ref, const dtQueryFilter*
 ///
 /// The normal will become unpredicable if @p hitDist is a very small number.
 ///
+/// #getWallDistance looks up an approximate distance in constant time if the
+/// tiles are built with wall distances.
+///
 dtStatus dtNavMeshQuery::findDistanceToWall(dtPolyRef startRef, const float* centerPos, const float maxRadius,
 											const dtQueryFilter* filter,
 											float* hitDist, float* hitPos, float* hitNormal) const
@@ -3525,8 +5925,9 @@ dtStatus dtNavMeshQuery::findDistanceToWall(dtPolyRef startRef, const float* cen
 		// Hit test walls.
 		for (int i = 0, j = (int)bestPoly->vertCount-1; i < (int)bestPoly->vertCount; j = i++)
 		{
-			// Skip non-solid edges.
-			if (bestPoly->neis[j] & DT_EXT_LINK)
+			// Skip non-solid edges. Edges narrower than the agent are walls.
+			const bool passable = dtPassEdgeClearance(bestTile, bestPoly, j, filter->getAgentRadius());
+			if (passable && (bestPoly->neis[j] & DT_EXT_LINK))
 			{
 				// Tile border.
 				bool solid = true;
@@ -3548,7 +5949,7 @@ dtStatus dtNavMeshQuery::findDistanceToWall(dtPolyRef startRef, const float* cen
 				}
 				if (!solid) continue;
 			}
-			else if (bestPoly->neis[j])
+			else if (passable && bestPoly->neis[j])
 			{
 				// Internal edge
 				const unsigned int idx = (unsigned int)(bestPoly->neis[j]-1);
@@ -3558,8 +5959,9 @@ dtStatus dtNavMeshQuery::findDistanceToWall(dtPolyRef startRef, const float* cen
 			}
 			
 			// Calc distance to the edge.
-			const float* vj = &bestTile->verts[bestPoly->verts[j]*3];
-			const float* vi = &bestTile->verts[bestPoly->verts[i]*3];
+			float vj[3], vi[3];
+			dtGetTileVertex(bestTile, bestPoly->verts[j], vj);
+			dtGetTileVertex(bestTile, bestPoly->verts[i], vi);
 			float tseg;
 			float distSqr = dtDistancePtSegSqr2D(centerPos, vj, vi, tseg);
 			
@@ -3582,6 +5984,9 @@ dtStatus dtNavMeshQuery::findDistanceToWall(dtPolyRef startRef, const float* cen
 			// Skip invalid neighbours and do not follow back to parent.
 			if (!neighbourRef || neighbourRef == parentRef)
 				continue;
+			// Skip edges narrower than the agent.
+			if (!dtPassEdgeClearance(bestTile, bestPoly, link->edge, filter->getAgentRadius()))
+				continue;
 			
 			// Expand to neighbour.
 			const dtMeshTile* neighbourTile = 0;
@@ -3593,8 +5998,9 @@ dtStatus dtNavMeshQuery::findDistanceToWall(dtPolyRef startRef, const float* cen
 				continue;
 			
 			// Calc distance to the edge.
-			const float* va = &bestTile->verts[bestPoly->verts[link->edge]*3];
-			const float* vb = &bestTile->verts[bestPoly->verts[(link->edge+1) % bestPoly->vertCount]*3];
+			float va[3], vb[3];
+			dtGetTileVertex(bestTile, bestPoly->verts[link->edge], va);
+			dtGetTileVertex(bestTile, bestPoly->verts[(link->edge+1) % bestPoly->vertCount], vb);
 			float tseg;
 			float distSqr = dtDistancePtSegSqr2D(centerPos, va, vb, tseg);
 			
@@ -3618,8 +6024,8 @@ dtStatus dtNavMeshQuery::findDistanceToWall(dtPolyRef startRef, const float* cen
 			// Cost
 			if (neighbourNode->flags == 0)
 			{
-				getEdgeMidPoint(bestRef, bestPoly, bestTile,
-								neighbourRef, neighbourPoly, neighbourTile, neighbourNode->pos);
+				getLinkMidPoint(bestRef, bestPoly, bestTile, i,
+								neighbourPoly, neighbourTile, neighbourNode->pos);
 			}
 			
 			const float total = bestNode->total + dtVdist(bestNode->pos, neighbourNode->pos);
@@ -3654,6 +6060,51 @@ dtStatus dtNavMeshQuery::findDistanceToWall(dtPolyRef startRef, const float* cen
 	return status;
 }
 
+/// @par
+///
+/// The distances are sampled over each polygon when the tile is built with
+/// dtNavMeshCreateParams::buildWallDistances, and interpolated between the samples.
+/// They are measured without a filter, to the border edges of the tile and to its
+/// portals, so the distance is a lower bound near the tile borders. The samples are
+/// rounded down to a quarter of a cell and are about two cells apart, which bounds the
+/// error elsewhere. Use #findDistanceToWall for the exact distance.
+///
+dtStatus dtNavMeshQuery::getWallDistance(dtPolyRef ref, const float* pos, float* dist) const
+{
+	dtAssert(m_nav);
+
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	if (dtStatusFailed(m_nav->getTileAndPolyByRef(ref, &tile, &poly)))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	if (!pos || !dtVisfinite2D(pos) || !dist)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	const int ip = (int)(poly - tile->polys);
+	if (!tile->wallDistGrids || ip >= tile->header->wallDistGridCount)
+		return DT_FAILURE;
+
+	// Bilinear interpolation between the four samples around the position.
+	const dtWallDistGrid& grid = tile->wallDistGrids[ip];
+	const unsigned char* samples = &tile->wallDistSamples[grid.sampleBase];
+	int ix[2];
+	float t[2];
+	for (int k = 0; k < 2; ++k)
+	{
+		const float f = dtClamp((pos[k*2] - grid.bmin[k]) * grid.invSpacing[k], 0.0f, (float)(grid.size[k]-1));
+		ix[k] = dtMin((int)f, grid.size[k]-2);
+		t[k] = f - ix[k];
+	}
+	const int i0 = ix[0] + ix[1]*grid.size[0];
+	const int i1 = i0 + grid.size[0];
+	const float d0 = samples[i0] + (samples[i0+1] - samples[i0]) * t[0];
+	const float d1 = samples[i1] + (samples[i1+1] - samples[i1]) * t[0];
+	*dist = (d0 + (d1 - d0) * t[1]) * tile->header->wallDistScale;
+
+	return DT_SUCCESS;
+}
+
 bool dtNavMeshQuery::isValidPolyRef(dtPolyRef ref, const dtQueryFilter* filter) const
 {
 	const dtMeshTile* tile = 0;
@@ -47,59 +47,67 @@ inline unsigned int dtHashRef(dtPolyRef a)
 }
 #endif
 
+// The hash table is kept at most two thirds full to keep the probe sequences short.
+static int dtCalcNodePoolHashSize(int maxNodes, int hashSize)
+{
+	return (int)dtMax(dtNextPow2((unsigned int)hashSize), dtNextPow2((unsigned int)(maxNodes + maxNodes/2 + 1)));
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
-dtNodePool::dtNodePool(int maxNodes, int hashSize) :
+dtNodePool::dtNodePool(int maxNodes, int hashSize, dtAllocator* allocator) :
+	m_allocator(allocator ? allocator : dtGetDefaultAllocator()),
 	m_nodes(0),
-	m_first(0),
-	m_next(0),
+	m_slots(0),
 	m_maxNodes(maxNodes),
-	m_hashSize(hashSize),
-	m_nodeCount(0)
+	m_hashSize(dtCalcNodePoolHashSize(maxNodes, hashSize)),
+	m_nodeCount(0),
+	m_gen(1)
 {
-	dtAssert(dtNextPow2(m_hashSize) == (unsigned int)m_hashSize);
+	dtAssert(dtNextPow2(hashSize) == (unsigned int)hashSize);
 	// pidx is special as 0 means "none" and 1 is the first node. For that reason
 	// we have 1 fewer nodes available than the number of values it can contain.
 	dtAssert(m_maxNodes > 0 && m_maxNodes <= DT_NULL_IDX && m_maxNodes <= (1 << DT_NODE_PARENT_BITS) - 1);
 
-	m_nodes = (dtNode*)dtAlloc(sizeof(dtNode)*m_maxNodes, DT_ALLOC_PERM);
-	m_next = (dtNodeIndex*)dtAlloc(sizeof(dtNodeIndex)*m_maxNodes, DT_ALLOC_PERM);
-	m_first = (dtNodeIndex*)dtAlloc(sizeof(dtNodeIndex)*hashSize, DT_ALLOC_PERM);
+	m_nodes = (dtNode*)m_allocator->alloc(sizeof(dtNode)*m_maxNodes, DT_ALLOC_PERM);
+	m_slots = (dtNodePoolSlot*)m_allocator->alloc(sizeof(dtNodePoolSlot)*m_hashSize, DT_ALLOC_PERM);
 
 	dtAssert(m_nodes);
-	dtAssert(m_next);
-	dtAssert(m_first);
+	dtAssert(m_slots);
 
-	memset(m_first, 0xff, sizeof(dtNodeIndex)*m_hashSize);
-	memset(m_next, 0xff, sizeof(dtNodeIndex)*m_maxNodes);
+	memset(m_slots, 0, sizeof(dtNodePoolSlot)*m_hashSize);
 }
 
 dtNodePool::~dtNodePool()
 {
-	dtFree(m_nodes);
-	dtFree(m_next);
-	dtFree(m_first);
+	m_allocator->free(m_nodes);
+	m_allocator->free(m_slots);
 }
 
 void dtNodePool::clear()
 {
-	memset(m_first, 0xff, sizeof(dtNodeIndex)*m_hashSize);
+	// Slots filled before the generation changes read as empty, so the table only
+	// needs to be reset once every 255 clears when the generation wraps around.
+	m_gen++;
+	if (m_gen == 0)
+	{
+		memset(m_slots, 0, sizeof(dtNodePoolSlot)*m_hashSize);
+		m_gen = 1;
+	}
 	m_nodeCount = 0;
 }
 
 unsigned int dtNodePool::findNodes(dtPolyRef id, dtNode** nodes, const int maxNodes)
 {
 	int n = 0;
-	unsigned int bucket = dtHashRef(id) & (m_hashSize-1);
-	dtNodeIndex i = m_first[bucket];
-	while (i != DT_NULL_IDX)
+	const unsigned int mask = (unsigned int)(m_hashSize-1);
+	for (unsigned int slot = dtHashRef(id) & mask; m_slots[slot].gen == m_gen; slot = (slot+1) & mask)
 	{
-		if (m_nodes[i].id == id)
+		if (m_slots[slot].id == id)
 		{
 			if (n >= maxNodes)
 				return n;
-			nodes[n++] = &m_nodes[i];
+			nodes[n++] = &m_nodes[m_slots[slot].idx];
 		}
-		i = m_next[i];
 	}
 
 	return n;
@@ -107,37 +115,33 @@ unsigned int dtNodePool::findNodes(dtPolyRef id, dtNode** nodes, const int maxNo
 
 dtNode* dtNodePool::findNode(dtPolyRef id, unsigned char state)
 {
-	unsigned int bucket = dtHashRef(id) & (m_hashSize-1);
-	dtNodeIndex i = m_first[bucket];
-	while (i != DT_NULL_IDX)
+	const unsigned int mask = (unsigned int)(m_hashSize-1);
+	for (unsigned int slot = dtHashRef(id) & mask; m_slots[slot].gen == m_gen; slot = (slot+1) & mask)
 	{
-		if (m_nodes[i].id == id && m_nodes[i].state == state)
-			return &m_nodes[i];
-		i = m_next[i];
+		if (m_slots[slot].id == id && m_slots[slot].state == state)
+			return &m_nodes[m_slots[slot].idx];
 	}
 	return 0;
 }
 
 dtNode* dtNodePool::getNode(dtPolyRef id, unsigned char state)
 {
-	unsigned int bucket = dtHashRef(id) & (m_hashSize-1);
-	dtNodeIndex i = m_first[bucket];
-	dtNode* node = 0;
-	while (i != DT_NULL_IDX)
+	const unsigned int mask = (unsigned int)(m_hashSize-1);
+	unsigned int slot = dtHashRef(id) & mask;
+	for (; m_slots[slot].gen == m_gen; slot = (slot+1) & mask)
 	{
-		if (m_nodes[i].id == id && m_nodes[i].state == state)
-			return &m_nodes[i];
-		i = m_next[i];
+		if (m_slots[slot].id == id && m_slots[slot].state == state)
+			return &m_nodes[m_slots[slot].idx];
 	}
 	
 	if (m_nodeCount >= m_maxNodes)
 		return 0;
 	
-	i = (dtNodeIndex)m_nodeCount;
+	const dtNodeIndex i = (dtNodeIndex)m_nodeCount;
 	m_nodeCount++;
 	
 	// Init node
-	node = &m_nodes[i];
+	dtNode* node = &m_nodes[i];
 	node->pidx = 0;
 	node->cost = 0;
 	node->total = 0;
@@ -145,56 +149,64 @@ dtNode* dtNodePool::getNode(dtPolyRef id, unsigned char state)
 	node->state = state;
 	node->flags = 0;
 	
-	m_next[i] = m_first[bucket];
-	m_first[bucket] = i;
+	m_slots[slot].id = id;
+	m_slots[slot].idx = i;
+	m_slots[slot].state = state;
+	m_slots[slot].gen = m_gen;
 	
 	return node;
 }
 
 
 //////////////////////////////////////////////////////////////////////////////////////////
-dtNodeQueue::dtNodeQueue(int n) :
+dtNodeQueue::dtNodeQueue(int n, dtAllocator* allocator) :
+	m_allocator(allocator ? allocator : dtGetDefaultAllocator()),
 	m_heap(0),
 	m_capacity(n),
 	m_size(0)
 {
 	dtAssert(m_capacity > 0);
 	
-	m_heap = (dtNode**)dtAlloc(sizeof(dtNode*)*(m_capacity+1), DT_ALLOC_PERM);
+	m_heap = (dtNodeQueueEntry*)m_allocator->alloc(sizeof(dtNodeQueueEntry)*(m_capacity+1), DT_ALLOC_PERM);
 	dtAssert(m_heap);
 }
 
 dtNodeQueue::~dtNodeQueue()
 {
-	dtFree(m_heap);
+	m_allocator->free(m_heap);
 }
 
-void dtNodeQueue::bubbleUp(int i, dtNode* node)
+void dtNodeQueue::bubbleUp(int i, const dtNodeQueueEntry& entry)
 {
-	int parent = (i-1)/2;
+	int parent = (i-1)/DT_NODE_QUEUE_ARITY;
 	// note: (index > 0) means there is a parent
-	while ((i > 0) && (m_heap[parent]->total > node->total))
+	while ((i > 0) && (m_heap[parent].total > entry.total))
 	{
 		m_heap[i] = m_heap[parent];
 		i = parent;
-		parent = (i-1)/2;
+		parent = (i-1)/DT_NODE_QUEUE_ARITY;
 	}
-	m_heap[i] = node;
+	m_heap[i] = entry;
 }
 
-void dtNodeQueue::trickleDown(int i, dtNode* node)
+void dtNodeQueue::trickleDown(int i, const dtNodeQueueEntry& entry)
 {
-	int child = (i*2)+1;
+	// Move the hole down to a leaf along the smallest children, and put the
+	// entry back in place from there. The entry usually comes from the bottom
+	// of the heap, so it rarely needs to move up again.
+	int child = (i*DT_NODE_QUEUE_ARITY)+1;
 	while (child < m_size)
 	{
-		if (((child+1) < m_size) && 
-			(m_heap[child]->total > m_heap[child+1]->total))
+		const int last = dtMin(child + DT_NODE_QUEUE_ARITY, m_size);
+		int best = child;
+		for (int j = child+1; j < last; ++j)
 		{
-			child++;
+			if (m_heap[j].total < m_heap[best].total)
+				best = j;
 		}
-		m_heap[i] = m_heap[child];
-		i = child;
-		child = (i*2)+1;
+		m_heap[i] = m_heap[best];
+		i = best;
+		child = (i*DT_NODE_QUEUE_ARITY)+1;
 	}
-	bubbleUp(i, node);
+	bubbleUp(i, entry);
 }
@@ -0,0 +1,305 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <string.h>
+#include "DetourOffMeshTable.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourCommon.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+#include <new>
+
+dtOffMeshConnectionTable* dtAllocOffMeshConnectionTable()
+{
+	void* mem = dtAlloc(sizeof(dtOffMeshConnectionTable), DT_ALLOC_PERM);
+	if (!mem) return 0;
+	return new(mem) dtOffMeshConnectionTable;
+}
+
+void dtFreeOffMeshConnectionTable(dtOffMeshConnectionTable* table)
+{
+	if (!table) return;
+	table->~dtOffMeshConnectionTable();
+	dtFree(table);
+}
+
+dtOffMeshConnectionTable::dtOffMeshConnectionTable() :
+	m_nav(0),
+	m_filter(0),
+	m_tiles(0),
+	m_maxTiles(0),
+	m_conCount(0)
+{
+}
+
+dtOffMeshConnectionTable::~dtOffMeshConnectionTable()
+{
+	for (int i = 0; i < m_maxTiles; ++i)
+		freeTile(m_tiles[i]);
+	dtFree(m_tiles);
+}
+
+/// @par
+///
+/// Must be the first function called after construction, before other
+/// functions are used. The entries are built by the first call to #update.
+dtStatus dtOffMeshConnectionTable::init(const dtNavMesh* nav, const dtQueryFilter* filter)
+{
+	if (!nav)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	// Only single init.
+	if (m_nav)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	m_nav = nav;
+	m_tracker.init(nav, true);
+	m_filter = filter;
+
+	m_maxTiles = nav->getMaxTiles();
+	m_tiles = (dtOffMeshConnectionTile*)dtAlloc(sizeof(dtOffMeshConnectionTile)*dtMax(m_maxTiles, 1), DT_ALLOC_PERM);
+	if (!m_tiles)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(m_tiles, 0, sizeof(dtOffMeshConnectionTile)*m_maxTiles);
+
+	return DT_SUCCESS;
+}
+
+const dtOffMeshConnectionTile* dtOffMeshConnectionTable::getTile(int i) const
+{
+	if (i < 0 || i >= m_maxTiles)
+		return 0;
+	return &m_tiles[i];
+}
+
+void dtOffMeshConnectionTable::freeTile(dtOffMeshConnectionTile& ctile)
+{
+	dtFree(ctile.cons);
+	memset(&ctile, 0, sizeof(dtOffMeshConnectionTile));
+}
+
+void dtOffMeshConnectionTable::buildEntries(const dtMeshTile* tile, dtOffMeshConnectionTile& ctile) const
+{
+	const dtPolyRef base = m_nav->getPolyRefBase(tile);
+	for (int i = 0; i < ctile.conCount; ++i)
+	{
+		const int polyIndex = ctile.polyBase + i;
+		const dtPoly* poly = &tile->polys[polyIndex];
+		const dtOffMeshConnection* con = &tile->offMeshCons[i];
+		dtOffMeshConnectionEntry& entry = ctile.cons[i];
+
+		entry.ref = base | (dtPolyRef)polyIndex;
+		entry.startRef = 0;
+		entry.endRef = 0;
+		for (unsigned int j = poly->firstLink; j != DT_NULL_LINK; j = tile->links[j].next)
+		{
+			if (tile->links[j].edge == 0 && !entry.startRef)
+				entry.startRef = tile->links[j].ref;
+			else if (tile->links[j].edge == 1 && !entry.endRef)
+				entry.endRef = tile->links[j].ref;
+		}
+
+		dtGetTileVertex(tile, poly->verts[0], entry.startPos);
+		dtGetTileVertex(tile, poly->verts[1], entry.endPos);
+		entry.length = dtVdist(entry.startPos, entry.endPos);
+		entry.userId = con->userId;
+		entry.flags = poly->flags;
+		entry.area = poly->getArea();
+		entry.bidir = (con->flags & DT_OFFMESH_CON_BIDIR) ? 1 : 0;
+
+		if (!m_filter)
+		{
+			entry.cost[0] = entry.length;
+			entry.cost[1] = entry.length;
+			continue;
+		}
+
+		// The costs are evaluated like the searches do, with the polygons the endpoints are linked to.
+		const dtMeshTile* startTile = 0;
+		const dtPoly* startPoly = 0;
+		const dtMeshTile* endTile = 0;
+		const dtPoly* endPoly = 0;
+		if (entry.startRef)
+			m_nav->getTileAndPolyByRefUnsafe(entry.startRef, &startTile, &startPoly);
+		if (entry.endRef)
+			m_nav->getTileAndPolyByRefUnsafe(entry.endRef, &endTile, &endPoly);
+		entry.cost[0] = m_filter->getCost(entry.startPos, entry.endPos,
+										  entry.startRef, startTile, startPoly,
+										  entry.ref, tile, poly,
+										  entry.endRef, endTile, endPoly);
+		entry.cost[1] = m_filter->getCost(entry.endPos, entry.startPos,
+										  entry.endRef, endTile, endPoly,
+										  entry.ref, tile, poly,
+										  entry.startRef, startTile, startPoly);
+	}
+}
+
+void dtOffMeshConnectionTable::invalidate()
+{
+	for (int i = 0; i < m_maxTiles; ++i)
+		freeTile(m_tiles[i]);
+	m_conCount = 0;
+	m_tracker.invalidate();
+}
+
+/// @par
+///
+/// The tiles which were added, removed or replaced, or whose polygon flags or
+/// areas changed, are rebuilt. (See: dtTileRefTracker) The links of all
+/// connections are read again when tiles were added or removed.
+dtStatus dtOffMeshConnectionTable::update(int* updatedTileCount)
+{
+	dtAssert(m_nav);
+
+	if (updatedTileCount)
+		*updatedTileCount = 0;
+
+	if (m_tracker.isUpToDate())
+		return DT_SUCCESS;
+
+	dtStatus status = m_tracker.update();
+	if (dtStatusFailed(status))
+		return status;
+	if (!dtGrowTileTable(m_tiles, m_maxTiles, m_tracker.getMaxTiles()))
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	m_maxTiles = dtMax(m_maxTiles, m_tracker.getMaxTiles());
+
+	// The neighbours of the tiles may have changed, which changes the links of the connections.
+	if (m_tracker.hasEpochChanged())
+	{
+		for (int i = 0; i < m_maxTiles; ++i)
+		{
+			dtOffMeshConnectionTile& ctile = m_tiles[i];
+			if (ctile.ref && ctile.ref == m_tracker.getTileRef(i))
+				buildEntries(m_nav->getTile(i), ctile);
+		}
+	}
+
+	int updated = 0;
+	for (int i = 0; i < m_tracker.getChangedTileCount(); ++i)
+	{
+		const int tileIndex = m_tracker.getChangedTile(i);
+		const dtTileRef ref = m_tracker.getTileRef(tileIndex);
+		const dtMeshTile* tile = m_nav->getTile(tileIndex);
+		dtOffMeshConnectionTile& ctile = m_tiles[tileIndex];
+		if (ref && ctile.ref == ref)
+		{
+			// Only the polygon flags or areas of the tile changed.
+			buildEntries(tile, ctile);
+			ctile.generation = tile->generation;
+			updated++;
+			continue;
+		}
+
+		freeTile(ctile);
+		updated++;
+		if (!ref)
+			continue;
+
+		const int conCount = tile->header->offMeshConCount;
+		if (conCount)
+		{
+			ctile.cons = (dtOffMeshConnectionEntry*)dtAlloc(sizeof(dtOffMeshConnectionEntry)*conCount, DT_ALLOC_PERM);
+			if (!ctile.cons)
+			{
+				status = DT_FAILURE | DT_OUT_OF_MEMORY;
+				continue;
+			}
+		}
+		ctile.conCount = conCount;
+		ctile.polyBase = tile->header->offMeshBase;
+		ctile.salt = tile->salt;
+		buildEntries(tile, ctile);
+		ctile.generation = tile->generation;
+		ctile.ref = ref;
+	}
+
+	m_conCount = 0;
+	for (int i = 0; i < m_maxTiles; ++i)
+		m_conCount += m_tiles[i].conCount;
+
+	if (dtStatusSucceed(status))
+		m_tracker.commit();
+
+	if (updatedTileCount)
+		*updatedTileCount = updated;
+
+	return status;
+}
+
+/// @par
+///
+/// Fails if tiles were added or removed since the previous #update, or if the
+/// flags or areas of the tile of the connection changed.
+const dtOffMeshConnectionEntry* dtOffMeshConnectionTable::getConnection(dtPolyRef ref) const
+{
+	dtAssert(m_nav);
+
+	if (!ref || !m_tracker.isEpochUpToDate())
+		return 0;
+
+	unsigned int salt, it, ip;
+	m_nav->decodePolyId(ref, salt, it, ip);
+	if (it >= (unsigned int)m_maxTiles)
+		return 0;
+	const dtOffMeshConnectionTile& ctile = m_tiles[it];
+	if (!ctile.ref || ctile.salt != salt)
+		return 0;
+	const unsigned int i = ip - (unsigned int)ctile.polyBase;
+	if (ip < (unsigned int)ctile.polyBase || i >= (unsigned int)ctile.conCount)
+		return 0;
+	if (m_nav->getTile((int)it)->generation != ctile.generation)
+		return 0;
+	return &ctile.cons[i];
+}
+
+dtStatus dtOffMeshConnectionTable::getEndPoints(dtPolyRef prevRef, dtPolyRef ref, float* startPos, float* endPos) const
+{
+	if (!startPos || !endPos)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	const dtOffMeshConnectionEntry* entry = getConnection(ref);
+	if (!entry)
+		return DT_FAILURE;
+
+	// Entered from the end when the start is linked to another polygon, like the navigation mesh does.
+	if (entry->startRef && entry->startRef != prevRef)
+	{
+		dtVcopy(startPos, entry->endPos);
+		dtVcopy(endPos, entry->startPos);
+	}
+	else
+	{
+		dtVcopy(startPos, entry->startPos);
+		dtVcopy(endPos, entry->endPos);
+	}
+	return DT_SUCCESS;
+}
+
+dtStatus dtOffMeshConnectionTable::getCost(dtPolyRef prevRef, dtPolyRef ref, float* cost) const
+{
+	if (!cost)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	const dtOffMeshConnectionEntry* entry = getConnection(ref);
+	if (!entry)
+		return DT_FAILURE;
+
+	*cost = (entry->startRef && entry->startRef != prevRef) ? entry->cost[1] : entry->cost[0];
+	return DT_SUCCESS;
+}
@@ -0,0 +1,226 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#include <string.h>
+#include "DetourQueryService.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourCommon.h"
+#include "DetourAssert.h"
+#include <new>
+
+// Each worker gets several jobs, so that a dispatcher can balance uneven requests.
+static const int JOBS_PER_WORKER = 4;
+
+dtQueryService* dtAllocQueryService()
+{
+	void* mem = dtAlloc(sizeof(dtQueryService), DT_ALLOC_PERM);
+	if (!mem) return 0;
+	return new(mem) dtQueryService;
+}
+
+void dtFreeQueryService(dtQueryService* service)
+{
+	if (!service) return;
+	service->~dtQueryService();
+	dtFree(service);
+}
+
+dtQueryService::dtQueryService() :
+	m_allocator(dtGetDefaultAllocator()),
+	m_dispatcher(0),
+	m_workerCount(0),
+	m_localQueries(0),
+	m_pathQueries(0),
+	m_localPathDist(0.0f),
+	m_requests(0),
+	m_requestCount(0),
+	m_jobCount(0)
+{
+}
+
+dtQueryService::~dtQueryService()
+{
+	purge();
+}
+
+void dtQueryService::purge()
+{
+	for (int i = 0; i < m_workerCount; ++i)
+	{
+		if (m_localQueries)
+			dtFreeObject(m_allocator, m_localQueries[i]);
+		if (m_pathQueries)
+			dtFreeObject(m_allocator, m_pathQueries[i]);
+	}
+	m_allocator->free(m_localQueries);
+	m_localQueries = 0;
+	m_allocator->free(m_pathQueries);
+	m_pathQueries = 0;
+	m_workerCount = 0;
+}
+
+dtStatus dtQueryService::init(const dtNavMesh* nav, const int workerCount, const int localMaxNodes,
+							  const int pathMaxNodes, dtAllocator* allocator)
+{
+	purge();
+	m_allocator = allocator ? allocator : dtGetDefaultAllocator();
+	if (!nav || workerCount < 1)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (m_dispatcher && m_dispatcher->getWorkerCount() > workerCount)
+		m_dispatcher = 0;
+
+	m_localQueries = (dtNavMeshQuery**)m_allocator->alloc(sizeof(dtNavMeshQuery*)*workerCount, DT_ALLOC_PERM);
+	m_pathQueries = (dtNavMeshQuery**)m_allocator->alloc(sizeof(dtNavMeshQuery*)*workerCount, DT_ALLOC_PERM);
+	if (!m_localQueries || !m_pathQueries)
+	{
+		purge();
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+	memset(m_localQueries, 0, sizeof(dtNavMeshQuery*)*workerCount);
+	memset(m_pathQueries, 0, sizeof(dtNavMeshQuery*)*workerCount);
+	m_workerCount = workerCount;
+
+	for (int i = 0; i < workerCount; ++i)
+	{
+		m_localQueries[i] = dtAllocObject<dtNavMeshQuery>(m_allocator);
+		m_pathQueries[i] = dtAllocObject<dtNavMeshQuery>(m_allocator);
+		if (!m_localQueries[i] || !m_pathQueries[i])
+		{
+			purge();
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		}
+		dtStatus status = m_localQueries[i]->init(nav, localMaxNodes, 0, m_allocator);
+		if (dtStatusSucceed(status))
+			status = m_pathQueries[i]->init(nav, pathMaxNodes, 0, m_allocator);
+		if (dtStatusFailed(status))
+		{
+			purge();
+			return status;
+		}
+	}
+
+	return DT_SUCCESS;
+}
+
+dtStatus dtQueryService::setJobDispatcher(dtJobDispatcher* dispatcher)
+{
+	if (dispatcher && dispatcher->getWorkerCount() > m_workerCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	m_dispatcher = dispatcher;
+	return DT_SUCCESS;
+}
+
+dtStatus dtQueryService::run(dtQueryRequest* requests, const int count)
+{
+	if (!m_workerCount)
+		return DT_FAILURE;
+	if (count <= 0)
+		return DT_SUCCESS;
+	if (!requests)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	m_requests = requests;
+	m_requestCount = count;
+	if (m_dispatcher)
+	{
+		m_jobCount = dtMin(count, m_dispatcher->getWorkerCount() * JOBS_PER_WORKER);
+		m_dispatcher->dispatch(runJob, this, m_jobCount);
+	}
+	else
+	{
+		m_jobCount = 1;
+		runJob(this, 0, 0);
+	}
+	m_requests = 0;
+	m_requestCount = 0;
+
+	return DT_SUCCESS;
+}
+
+void dtQueryService::runJob(void* userData, const int jobIndex, const int workerIndex)
+{
+	dtQueryService* service = (dtQueryService*)userData;
+	dtAssert(workerIndex >= 0 && workerIndex < service->m_workerCount);
+	for (int i = jobIndex; i < service->m_requestCount; i += service->m_jobCount)
+		service->runRequest(service->m_requests[i], workerIndex);
+}
+
+void dtQueryService::runRequest(dtQueryRequest& request, const int worker) const
+{
+	const dtNavMeshQuery* localQuery = m_localQueries[worker];
+	request.pathCount = 0;
+	request.nearestRef = 0;
+	request.reachedCount = 0;
+
+	if (request.type == DT_QUERY_FIND_PATH)
+	{
+		if (!request.path || request.maxPath <= 0)
+		{
+			request.status = DT_FAILURE | DT_INVALID_PARAM;
+		}
+		else
+		{
+			// Short paths try the small node pool first.
+			request.status = DT_FAILURE | DT_OUT_OF_NODES;
+			if (dtVdistSqr(request.startPos, request.endPos) < dtSqr(m_localPathDist))
+			{
+				request.status = localQuery->findPath(request.startRef, request.endRef, request.startPos, request.endPos,
+													  request.filter, request.path, &request.pathCount, request.maxPath,
+													  request.options);
+			}
+			if (request.status & DT_OUT_OF_NODES)
+			{
+				request.status = m_pathQueries[worker]->findPath(request.startRef, request.endRef, request.startPos,
+																 request.endPos, request.filter, request.path,
+																 &request.pathCount, request.maxPath, request.options);
+			}
+		}
+	}
+	else if (request.type == DT_QUERY_RAYCAST)
+	{
+		dtRaycastHit hit;
+		memset(&hit, 0, sizeof(hit));
+		hit.path = request.path;
+		hit.maxPath = request.path ? request.maxPath : 0;
+		request.status = localQuery->raycast(request.startRef, request.startPos, request.endPos, request.filter,
+											 request.options, &hit);
+		request.t = hit.t;
+		dtVcopy(request.hitNormal, hit.hitNormal);
+		request.pathCount = hit.pathCount;
+	}
+	else if (request.type == DT_QUERY_FIND_NEAREST_POLY)
+	{
+		request.status = localQuery->findNearestPoly(request.startPos, request.halfExtents, request.filter,
+													 &request.nearestRef, request.nearestPt);
+	}
+	else if (request.type == DT_QUERY_FIND_DISTANCES)
+	{
+		request.status = m_pathQueries[worker]->findDistances(request.startRef, request.startPos, request.targetRefs,
+															  request.targetPositions, request.targetCount,
+															  request.filter, request.maxCost, request.costs,
+															  &request.reachedCount);
+	}
+	else
+	{
+		request.status = DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	if (request.callback)
+		request.callback(&request, request.userData);
+}
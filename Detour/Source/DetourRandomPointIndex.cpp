@@ -0,0 +1,287 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <string.h>
+#include "DetourRandomPointIndex.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourCommon.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+#include <new>
+
+dtRandomPointIndex* dtAllocRandomPointIndex()
+{
+	void* mem = dtAlloc(sizeof(dtRandomPointIndex), DT_ALLOC_PERM);
+	if (!mem) return 0;
+	return new(mem) dtRandomPointIndex;
+}
+
+void dtFreeRandomPointIndex(dtRandomPointIndex* index)
+{
+	if (!index) return;
+	index->~dtRandomPointIndex();
+	dtFree(index);
+}
+
+namespace
+{
+// Returns the index of the first running sum greater than the value, or the last index if there is none.
+int findSum(const float* sums, const int count, const float value)
+{
+	int lo = 0;
+	int hi = count - 1;
+	while (lo < hi)
+	{
+		const int mid = (lo + hi) / 2;
+		if (sums[mid] > value)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return lo;
+}
+} // anonymous namespace
+
+dtRandomPointIndex::dtRandomPointIndex() :
+	m_nav(0),
+	m_filter(0),
+	m_tiles(0),
+	m_maxTiles(0),
+	m_tileIndices(0),
+	m_tileAreas(0),
+	m_tileCount(0)
+{
+}
+
+dtRandomPointIndex::~dtRandomPointIndex()
+{
+	for (int i = 0; i < m_maxTiles; ++i)
+		freeTile(m_tiles[i]);
+	dtFree(m_tiles);
+	dtFree(m_tileIndices);
+	dtFree(m_tileAreas);
+}
+
+/// @par
+///
+/// Must be the first function called after construction, before other
+/// functions are used. The distributions are built by the first call to #update.
+dtStatus dtRandomPointIndex::init(const dtNavMesh* nav, const dtQueryFilter* filter)
+{
+	if (!nav || !filter)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	// Only single init.
+	if (m_nav)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	m_nav = nav;
+	m_filter = filter;
+	m_tracker.init(nav, true);
+
+	m_maxTiles = nav->getMaxTiles();
+	m_tiles = (dtRandomPointTile*)dtAlloc(sizeof(dtRandomPointTile)*dtMax(m_maxTiles, 1), DT_ALLOC_PERM);
+	m_tileIndices = (int*)dtAlloc(sizeof(int)*dtMax(m_maxTiles, 1), DT_ALLOC_PERM);
+	m_tileAreas = (float*)dtAlloc(sizeof(float)*dtMax(m_maxTiles, 1), DT_ALLOC_PERM);
+	if (!m_tiles || !m_tileIndices || !m_tileAreas)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(m_tiles, 0, sizeof(dtRandomPointTile)*m_maxTiles);
+
+	return DT_SUCCESS;
+}
+
+const dtRandomPointTile* dtRandomPointIndex::getTile(int i) const
+{
+	if (i < 0 || i >= m_maxTiles)
+		return 0;
+	return &m_tiles[i];
+}
+
+void dtRandomPointIndex::freeTile(dtRandomPointTile& rtile)
+{
+	dtFree(rtile.polys);
+	dtFree(rtile.areas);
+	memset(&rtile, 0, sizeof(dtRandomPointTile));
+}
+
+bool dtRandomPointIndex::buildTile(const dtMeshTile* tile, dtRandomPointTile& rtile)
+{
+	const int polyCount = tile->header->polyCount;
+	if (!polyCount)
+		return true;
+
+	rtile.polys = (unsigned short*)dtAlloc(sizeof(unsigned short)*polyCount, DT_ALLOC_PERM);
+	rtile.areas = (float*)dtAlloc(sizeof(float)*polyCount, DT_ALLOC_PERM);
+	if (!rtile.polys || !rtile.areas)
+		return false;
+
+	const dtPolyRef base = m_nav->getPolyRefBase(tile);
+	float areaSum = 0.0f;
+	for (int i = 0; i < polyCount; ++i)
+	{
+		const dtPoly* p = &tile->polys[i];
+		// Do not return off-mesh connection polygons.
+		if (p->getType() != DT_POLYTYPE_GROUND)
+			continue;
+		// Must pass filter
+		if (!m_filter->passFilter(base | (dtPolyRef)i, tile, p))
+			continue;
+
+		// Calc area of the polygon.
+		float polyArea = 0.0f;
+		for (int j = 2; j < p->vertCount; ++j)
+		{
+			float va[3], vb[3], vc[3];
+			dtGetTileVertex(tile, p->verts[0], va);
+			dtGetTileVertex(tile, p->verts[j-1], vb);
+			dtGetTileVertex(tile, p->verts[j], vc);
+			polyArea += dtTriArea2D(va,vb,vc);
+		}
+		polyArea *= 0.5f;
+		// Polygons without area can never be picked.
+		if (polyArea <= 0.0f)
+			continue;
+
+		areaSum += polyArea;
+		rtile.polys[rtile.polyCount] = (unsigned short)i;
+		rtile.areas[rtile.polyCount] = areaSum;
+		rtile.polyCount++;
+	}
+
+	return true;
+}
+
+void dtRandomPointIndex::invalidate()
+{
+	for (int i = 0; i < m_maxTiles; ++i)
+		freeTile(m_tiles[i]);
+	m_tileCount = 0;
+	m_tracker.invalidate();
+}
+
+/// @par
+///
+/// The tiles which were added, removed or replaced, or whose polygon flags or
+/// areas changed, are rebuilt. (See: dtTileRefTracker)
+dtStatus dtRandomPointIndex::update(int* updatedTileCount)
+{
+	dtAssert(m_nav);
+
+	if (updatedTileCount)
+		*updatedTileCount = 0;
+
+	if (m_tracker.isUpToDate())
+		return DT_SUCCESS;
+
+	dtStatus status = m_tracker.update();
+	if (dtStatusFailed(status))
+		return status;
+	const int maxTiles = m_tracker.getMaxTiles();
+	if (!dtGrowTileTable(m_tiles, m_maxTiles, maxTiles) ||
+		!dtGrowTileTable(m_tileIndices, m_maxTiles, maxTiles) ||
+		!dtGrowTileTable(m_tileAreas, m_maxTiles, maxTiles))
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	m_maxTiles = dtMax(m_maxTiles, maxTiles);
+
+	int updated = 0;
+	for (int i = 0; i < m_tracker.getChangedTileCount(); ++i)
+	{
+		const int tileIndex = m_tracker.getChangedTile(i);
+		const dtTileRef ref = m_tracker.getTileRef(tileIndex);
+		dtRandomPointTile& rtile = m_tiles[tileIndex];
+
+		freeTile(rtile);
+		updated++;
+		if (!ref)
+			continue;
+		if (!buildTile(m_nav->getTile(tileIndex), rtile))
+		{
+			freeTile(rtile);
+			status = DT_FAILURE | DT_OUT_OF_MEMORY;
+			continue;
+		}
+		rtile.ref = ref;
+	}
+
+	// The tile areas are summed again, which is cheap compared to building a tile.
+	float areaSum = 0.0f;
+	m_tileCount = 0;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtRandomPointTile& rtile = m_tiles[i];
+		if (!rtile.polyCount)
+			continue;
+		areaSum += rtile.areas[rtile.polyCount-1];
+		m_tileIndices[m_tileCount] = i;
+		m_tileAreas[m_tileCount] = areaSum;
+		m_tileCount++;
+	}
+
+	if (dtStatusSucceed(status))
+		m_tracker.commit();
+
+	if (updatedTileCount)
+		*updatedTileCount = updated;
+
+	return status;
+}
+
+/// @par
+///
+/// Fails if tiles were added or removed, or polygon flags or areas changed,
+/// since the previous #update.
+dtStatus dtRandomPointIndex::findRandomPoint(const dtNavMeshQuery* query, float (*frand)(),
+											 dtPolyRef* randomRef, float* randomPt) const
+{
+	dtAssert(m_nav);
+
+	if (!query || query->getAttachedNavMesh() != m_nav || !frand || !randomRef || !randomPt)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	if (!m_tracker.isUpToDate() || !m_tileCount)
+		return DT_FAILURE;
+
+	// Randomly pick one tile weighted by tile area.
+	const int tileIndex = m_tileIndices[findSum(m_tileAreas, m_tileCount, frand()*m_tileAreas[m_tileCount-1])];
+	const dtRandomPointTile& rtile = m_tiles[tileIndex];
+	const dtMeshTile* tile = m_nav->getTile(tileIndex);
+
+	// Randomly pick one polygon weighted by polygon area.
+	const int polyIndex = rtile.polys[findSum(rtile.areas, rtile.polyCount, frand()*rtile.areas[rtile.polyCount-1])];
+	const dtPoly* poly = &tile->polys[polyIndex];
+	const dtPolyRef polyRef = m_nav->getPolyRefBase(tile) | (dtPolyRef)polyIndex;
+
+	// Randomly pick point on polygon.
+	float verts[3*DT_VERTS_PER_POLYGON];
+	float areas[DT_VERTS_PER_POLYGON];
+	for (int j = 0; j < poly->vertCount; ++j)
+		dtGetTileVertex(tile, poly->verts[j], &verts[j*3]);
+
+	const float s = frand();
+	const float t = frand();
+
+	float pt[3];
+	dtRandomPointInConvexPoly(verts, poly->vertCount, areas, s, t, pt);
+
+	query->closestPointOnPoly(polyRef, pt, pt, NULL);
+
+	dtVcopy(randomPt, pt);
+	*randomRef = polyRef;
+
+	return DT_SUCCESS;
+}
@@ -0,0 +1,125 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "DetourTileRefTracker.h"
+#include "DetourAssert.h"
+
+dtTileRefTracker::dtTileRefTracker() :
+	m_nav(0),
+	m_trackGenerations(false),
+	m_refs(0),
+	m_generations(0),
+	m_changed(0),
+	m_changedCount(0),
+	m_maxTiles(0),
+	m_epoch(0),
+	m_generation(0),
+	m_scanEpoch(0),
+	m_scanGeneration(0),
+	m_committed(false)
+{
+}
+
+dtTileRefTracker::~dtTileRefTracker()
+{
+	dtFree(m_refs);
+	dtFree(m_generations);
+	dtFree(m_changed);
+}
+
+void dtTileRefTracker::init(const dtNavMesh* nav, const bool trackGenerations)
+{
+	m_nav = nav;
+	m_trackGenerations = trackGenerations;
+	invalidate();
+}
+
+bool dtTileRefTracker::isUpToDate() const
+{
+	return isEpochUpToDate() && (!m_trackGenerations || m_nav->getGeneration() == m_generation);
+}
+
+bool dtTileRefTracker::isEpochUpToDate() const
+{
+	dtAssert(m_nav);
+	return m_committed && m_nav->getEpoch() == m_epoch;
+}
+
+dtTileRef dtTileRefTracker::getTileRef(const int i) const
+{
+	const dtMeshTile* tile = m_nav->getTile(i);
+	return (tile->header && !(tile->flags & DT_TILE_RETIRED)) ? m_nav->getTileRef(tile) : 0;
+}
+
+dtStatus dtTileRefTracker::update()
+{
+	dtAssert(m_nav);
+
+	m_changedCount = 0;
+
+	const int maxTiles = m_nav->getMaxTiles();
+	if (maxTiles > m_maxTiles)
+	{
+		int* changed = (int*)dtAlloc(sizeof(int)*maxTiles, DT_ALLOC_PERM);
+		if (!changed)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		if (!dtGrowTileTable(m_refs, m_maxTiles, maxTiles) || !dtGrowTileTable(m_generations, m_maxTiles, maxTiles))
+		{
+			dtFree(changed);
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		}
+		dtFree(m_changed);
+		m_changed = changed;
+		m_maxTiles = maxTiles;
+	}
+
+	m_scanEpoch = m_nav->getEpoch();
+	m_scanGeneration = m_nav->getGeneration();
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtTileRef ref = getTileRef(i);
+		if (m_refs[i] != ref || (m_trackGenerations && ref && m_generations[i] != m_nav->getTile(i)->generation))
+			m_changed[m_changedCount++] = i;
+	}
+
+	return DT_SUCCESS;
+}
+
+void dtTileRefTracker::commit()
+{
+	for (int i = 0; i < m_changedCount; ++i)
+	{
+		const int tileIndex = m_changed[i];
+		m_refs[tileIndex] = getTileRef(tileIndex);
+		m_generations[tileIndex] = m_nav->getTile(tileIndex)->generation;
+	}
+	m_epoch = m_scanEpoch;
+	m_generation = m_scanGeneration;
+	m_committed = true;
+}
+
+void dtTileRefTracker::invalidate()
+{
+	if (m_maxTiles)
+	{
+		memset(m_refs, 0, sizeof(dtTileRef)*m_maxTiles);
+		memset(m_generations, 0, sizeof(unsigned int)*m_maxTiles);
+	}
+	m_changedCount = 0;
+	m_committed = false;
+}
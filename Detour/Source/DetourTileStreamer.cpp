@@ -0,0 +1,407 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "DetourTileStreamer.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+#include "DetourCommon.h"
+#include "DetourMath.h"
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+dtTileStreamer* dtAllocTileStreamer()
+{
+	void* mem = dtAlloc(sizeof(dtTileStreamer), DT_ALLOC_PERM);
+	if (!mem) return 0;
+	return new(mem) dtTileStreamer;
+}
+
+void dtFreeTileStreamer(dtTileStreamer* streamer)
+{
+	if (!streamer) return;
+	streamer->~dtTileStreamer();
+	dtFree(streamer);
+}
+
+inline int computeTileHash(int x, int y, const int mask)
+{
+	const unsigned int h1 = 0x8da6b343; // Large multiplicative constants;
+	const unsigned int h2 = 0xd8163841; // here arbitrarily chosen primes
+	unsigned int n = h1 * x + h2 * y;
+	return (int)(n & mask);
+}
+
+int dtTileStreamer::compareCandidates(const void* va, const void* vb)
+{
+	const Candidate* a = (const Candidate*)va;
+	const Candidate* b = (const Candidate*)vb;
+	if (a->distSqr < b->distSqr) return -1;
+	if (a->distSqr > b->distSqr) return 1;
+	return a->entry - b->entry;
+}
+
+dtTileStreamer::dtTileStreamer() :
+	m_nav(0),
+	m_source(0),
+	m_entries(0),
+	m_buckets(0),
+	m_bucketMask(0),
+	m_nextFree(-1),
+	m_candidates(0),
+	m_residentBytes(0),
+	m_residentCount(0),
+	m_pendingCount(0)
+{
+	memset(&m_params, 0, sizeof(m_params));
+}
+
+dtTileStreamer::~dtTileStreamer()
+{
+	unloadAll();
+	dtFree(m_entries);
+	m_entries = 0;
+	dtFree(m_buckets);
+	m_buckets = 0;
+	dtFree(m_candidates);
+	m_candidates = 0;
+}
+
+dtStatus dtTileStreamer::init(dtNavMesh* nav, dtTileSource* source, const dtTileStreamerParams* params)
+{
+	if (!nav || !source || !params)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (nav->getDeferredTileRelease())
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (params->loadRadius <= 0.0f || params->unloadRadius < params->loadRadius ||
+		params->maxPendingLoads <= 0 || params->maxEntries < nav->getMaxTiles() ||
+		params->maxLinkedTilesPerUpdate < 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	
+	unloadAll();
+	dtFree(m_entries);
+	dtFree(m_buckets);
+	dtFree(m_candidates);
+	
+	m_nav = nav;
+	m_source = source;
+	memcpy(&m_params, params, sizeof(m_params));
+	
+	const int bucketCount = (int)dtNextPow2((unsigned int)m_params.maxEntries);
+	m_bucketMask = bucketCount - 1;
+	m_entries = (Entry*)dtAlloc(sizeof(Entry)*m_params.maxEntries, DT_ALLOC_PERM);
+	m_buckets = (int*)dtAlloc(sizeof(int)*bucketCount, DT_ALLOC_PERM);
+	m_candidates = (Candidate*)dtAlloc(sizeof(Candidate)*m_params.maxEntries, DT_ALLOC_PERM);
+	if (!m_entries || !m_buckets || !m_candidates)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	
+	memset(m_entries, 0, sizeof(Entry)*m_params.maxEntries);
+	for (int i = 0; i < bucketCount; ++i)
+		m_buckets[i] = -1;
+	m_nextFree = -1;
+	for (int i = m_params.maxEntries-1; i >= 0; --i)
+	{
+		m_entries[i].state = ENTRY_FREE;
+		m_entries[i].next = m_nextFree;
+		m_nextFree = i;
+	}
+	
+	m_residentBytes = 0;
+	m_residentCount = 0;
+	m_pendingCount = 0;
+	
+	return DT_SUCCESS;
+}
+
+dtTileStreamer::Entry* dtTileStreamer::findEntry(const int tx, const int ty)
+{
+	for (int i = m_buckets[computeTileHash(tx, ty, m_bucketMask)]; i != -1; i = m_entries[i].next)
+	{
+		if (m_entries[i].tx == tx && m_entries[i].ty == ty)
+			return &m_entries[i];
+	}
+	return 0;
+}
+
+dtTileStreamer::Entry* dtTileStreamer::allocEntry(const int tx, const int ty)
+{
+	if (m_nextFree == -1)
+		return 0;
+	const int idx = m_nextFree;
+	Entry* entry = &m_entries[idx];
+	m_nextFree = entry->next;
+	
+	memset(entry, 0, sizeof(Entry));
+	entry->tx = tx;
+	entry->ty = ty;
+	entry->state = ENTRY_UNLOADED;
+	
+	const int h = computeTileHash(tx, ty, m_bucketMask);
+	entry->next = m_buckets[h];
+	m_buckets[h] = idx;
+	return entry;
+}
+
+void dtTileStreamer::freeEntry(Entry* entry)
+{
+	const int idx = (int)(entry - m_entries);
+	const int h = computeTileHash(entry->tx, entry->ty, m_bucketMask);
+	int* prev = &m_buckets[h];
+	while (*prev != idx)
+		prev = &m_entries[*prev].next;
+	*prev = entry->next;
+	
+	entry->state = ENTRY_FREE;
+	entry->next = m_nextFree;
+	m_nextFree = idx;
+}
+
+void dtTileStreamer::unloadEntry(Entry* entry, const unsigned char state)
+{
+	dtAssert(entry->state == ENTRY_RESIDENT);
+	
+	// The tile data is owned by the source.
+	m_nav->removeTile(entry->ref, 0, 0);
+	m_source->freeTile(entry->data, entry->dataSize);
+	m_residentBytes -= (size_t)entry->dataSize;
+	m_residentCount--;
+	
+	// Keep the reference and the size for the next time the tile is loaded.
+	entry->data = 0;
+	entry->state = state;
+}
+
+float dtTileStreamer::getTileDistSqr(const int tx, const int ty, const float* focusPoints, const int focusCount) const
+{
+	const dtNavMeshParams* params = m_nav->getParams();
+	const float bminx = params->orig[0] + tx * params->tileWidth;
+	const float bminz = params->orig[2] + ty * params->tileHeight;
+	const float bmaxx = bminx + params->tileWidth;
+	const float bmaxz = bminz + params->tileHeight;
+	
+	float best = FLT_MAX;
+	for (int i = 0; i < focusCount; ++i)
+	{
+		const float* p = &focusPoints[i*3];
+		const float dx = dtMax(dtMax(bminx - p[0], p[0] - bmaxx), 0.0f);
+		const float dz = dtMax(dtMax(bminz - p[2], p[2] - bmaxz), 0.0f);
+		best = dtMin(best, dx*dx + dz*dz);
+	}
+	return best;
+}
+
+dtStatus dtTileStreamer::update(const float* focusPoints, const int focusCount, int* loadedTiles, int* unloadedTiles)
+{
+	if (!m_nav)
+		return DT_FAILURE;
+	if (focusCount < 0 || (focusCount > 0 && !focusPoints))
+		return DT_FAILURE | DT_INVALID_PARAM;
+	
+	int nloaded = 0;
+	int nunloaded = 0;
+	const int tileFlags = m_params.maxLinkedTilesPerUpdate > 0 ? DT_TILE_PENDING_LINKS : 0;
+	
+	// Complete pending loads.
+	for (int i = 0; i < m_params.maxEntries; ++i)
+	{
+		Entry* entry = &m_entries[i];
+		if (entry->state != ENTRY_PENDING)
+			continue;
+		
+		unsigned char* data = 0;
+		int dataSize = 0;
+		bool changed = false;
+		const dtTileSourceState state = m_source->pollTile(entry->tx, entry->ty, &data, &dataSize, &changed);
+		if (state == DT_TILE_SOURCE_PENDING)
+			continue;
+		m_pendingCount--;
+		
+		if (state == DT_TILE_SOURCE_MISSING)
+		{
+			entry->state = ENTRY_MISSING;
+			continue;
+		}
+		if (state == DT_TILE_SOURCE_FAILED)
+		{
+			// Try again on the next update.
+			entry->state = ENTRY_UNLOADED;
+			continue;
+		}
+		
+		// Restore the previous reference of unchanged tiles, so that references
+		// to their polygons become valid again.
+		const dtTileRef lastRef = changed ? 0 : entry->ref;
+		dtTileRef ref = 0;
+		dtStatus status = m_nav->addTile(data, dataSize, tileFlags, lastRef, &ref);
+		if (dtStatusFailed(status) && lastRef)
+			status = m_nav->addTile(data, dataSize, tileFlags, 0, &ref);
+		if (dtStatusFailed(status))
+		{
+			// No room for the tile, try again once other tiles are unloaded.
+			m_source->freeTile(data, dataSize);
+			entry->dataSize = dataSize;
+			entry->state = ENTRY_EVICTED;
+			continue;
+		}
+		
+		entry->ref = ref;
+		entry->data = data;
+		entry->dataSize = dataSize;
+		entry->state = ENTRY_RESIDENT;
+		m_residentBytes += (size_t)dataSize;
+		m_residentCount++;
+		nloaded++;
+	}
+	
+	// Spread the neighbour links of a burst of loaded tiles over several updates.
+	if (m_nav->getPendingTileCount() > 0 && m_params.maxLinkedTilesPerUpdate > 0)
+		m_nav->connectPendingTiles(m_params.maxLinkedTilesPerUpdate);
+	
+	// Unload tiles and cancel loads outside of the working set.
+	const float unloadRadiusSqr = dtSqr(m_params.unloadRadius);
+	int ncandidates = 0;
+	for (int i = 0; i < m_params.maxEntries; ++i)
+	{
+		Entry* entry = &m_entries[i];
+		if (entry->state == ENTRY_FREE)
+			continue;
+		
+		const float distSqr = getTileDistSqr(entry->tx, entry->ty, focusPoints, focusCount);
+		if (distSqr <= unloadRadiusSqr)
+		{
+			if (entry->state == ENTRY_RESIDENT)
+			{
+				m_candidates[ncandidates].distSqr = -distSqr;
+				m_candidates[ncandidates].entry = i;
+				ncandidates++;
+			}
+			continue;
+		}
+		
+		if (entry->state == ENTRY_RESIDENT)
+		{
+			unloadEntry(entry, ENTRY_UNLOADED);
+			nunloaded++;
+		}
+		else if (entry->state == ENTRY_PENDING)
+		{
+			m_source->cancelTile(entry->tx, entry->ty);
+			m_pendingCount--;
+			entry->state = ENTRY_UNLOADED;
+		}
+		
+		// Only remember the locations that have a reference to restore.
+		if (entry->ref)
+			entry->state = ENTRY_UNLOADED;
+		else
+			freeEntry(entry);
+	}
+	
+	// Evict the farthest tiles to stay within the memory budget.
+	if (m_params.maxResidentBytes && m_residentBytes > m_params.maxResidentBytes)
+	{
+		qsort(m_candidates, (size_t)ncandidates, sizeof(Candidate), compareCandidates);
+		for (int i = 0; i < ncandidates && m_residentBytes > m_params.maxResidentBytes; ++i)
+		{
+			unloadEntry(&m_entries[m_candidates[i].entry], ENTRY_EVICTED);
+			nunloaded++;
+		}
+	}
+	
+	// Collect the locations to load.
+	const dtNavMeshParams* navParams = m_nav->getParams();
+	const float loadRadius = m_params.loadRadius;
+	const float loadRadiusSqr = dtSqr(loadRadius);
+	ncandidates = 0;
+	for (int i = 0; i < focusCount; ++i)
+	{
+		const float* p = &focusPoints[i*3];
+		const int tx0 = (int)dtMathFloorf((p[0] - loadRadius - navParams->orig[0]) / navParams->tileWidth);
+		const int tx1 = (int)dtMathFloorf((p[0] + loadRadius - navParams->orig[0]) / navParams->tileWidth);
+		const int ty0 = (int)dtMathFloorf((p[2] - loadRadius - navParams->orig[2]) / navParams->tileHeight);
+		const int ty1 = (int)dtMathFloorf((p[2] + loadRadius - navParams->orig[2]) / navParams->tileHeight);
+		for (int ty = ty0; ty <= ty1; ++ty)
+		{
+			for (int tx = tx0; tx <= tx1; ++tx)
+			{
+				const float distSqr = getTileDistSqr(tx, ty, p, 1);
+				if (distSqr > loadRadiusSqr)
+					continue;
+				Entry* entry = findEntry(tx, ty);
+				if (!entry)
+					entry = allocEntry(tx, ty);
+				if (!entry || (entry->state != ENTRY_UNLOADED && entry->state != ENTRY_EVICTED))
+					continue;
+				// Skip the locations already collected for another focus point.
+				entry->state = (unsigned char)(entry->state | 0x80);
+				m_candidates[ncandidates].distSqr = getTileDistSqr(tx, ty, focusPoints, focusCount);
+				m_candidates[ncandidates].entry = (int)(entry - m_entries);
+				ncandidates++;
+			}
+		}
+	}
+	for (int i = 0; i < ncandidates; ++i)
+		m_entries[m_candidates[i].entry].state &= 0x7f;
+	
+	// Request the nearest tiles first.
+	qsort(m_candidates, (size_t)ncandidates, sizeof(Candidate), compareCandidates);
+	for (int i = 0; i < ncandidates && m_pendingCount < m_params.maxPendingLoads; ++i)
+	{
+		Entry* entry = &m_entries[m_candidates[i].entry];
+		if (m_params.maxResidentBytes)
+		{
+			// Evicted tiles are loaded again once they fit in the budget.
+			if (m_residentBytes >= m_params.maxResidentBytes)
+				break;
+			if (entry->state == ENTRY_EVICTED && m_residentBytes + (size_t)entry->dataSize > m_params.maxResidentBytes)
+				continue;
+		}
+		if (!m_source->requestTile(entry->tx, entry->ty))
+			continue;
+		entry->state = ENTRY_PENDING;
+		m_pendingCount++;
+	}
+	
+	if (loadedTiles)
+		*loadedTiles = nloaded;
+	if (unloadedTiles)
+		*unloadedTiles = nunloaded;
+	
+	return DT_SUCCESS;
+}
+
+void dtTileStreamer::unloadAll()
+{
+	if (!m_entries)
+		return;
+	for (int i = 0; i < m_params.maxEntries; ++i)
+	{
+		Entry* entry = &m_entries[i];
+		if (entry->state == ENTRY_RESIDENT)
+		{
+			unloadEntry(entry, ENTRY_UNLOADED);
+		}
+		else if (entry->state == ENTRY_PENDING)
+		{
+			m_source->cancelTile(entry->tx, entry->ty);
+			m_pendingCount--;
+			entry->state = ENTRY_UNLOADED;
+		}
+	}
+}
@@ -25,10 +25,14 @@
 #include "DetourPathCorridor.h"
 #include "DetourProximityGrid.h"
 #include "DetourPathQueue.h"
+#include "DetourFlowField.h"
+#include "DetourJobDispatcher.h"
+#include "DetourCrowdSnapshot.h"
 
-/// The maximum number of neighbors that a crowd agent can take into account
+/// The default maximum number of neighbors that a crowd agent can take into account
 /// for steering decisions.
 /// @ingroup crowd
+/// @see dtCrowd::init(), dtCrowdAgentParams::maxNeighbours
 static const int DT_CROWDAGENT_MAX_NEIGHBOURS = 6;
 
 /// The maximum number of corners a crowd agent will look ahead in the path.
@@ -66,7 +70,19 @@ enum CrowdAgentState
 {
 	DT_CROWDAGENT_STATE_INVALID,		///< The agent is not in a valid state.
 	DT_CROWDAGENT_STATE_WALKING,		///< The agent is traversing a normal navigation mesh polygon.
-	DT_CROWDAGENT_STATE_OFFMESH 		///< The agent is traversing an off-mesh connection.
+	DT_CROWDAGENT_STATE_OFFMESH,		///< The agent is traversing an off-mesh connection.
+	DT_CROWDAGENT_STATE_SLEEPING		///< The agent is idle on a normal polygon and is not updated. (See: #DT_CROWD_SLEEP)
+};
+
+/// How much of the steering of a crowd agent is updated.
+/// @ingroup crowd
+/// @see dtCrowdAgentParams::lod, dtCrowd::setLODUpdateInterval()
+enum CrowdAgentLOD
+{
+	DT_CROWDAGENT_LOD_FULL = 0,		///< All of the steering is updated every frame.
+	DT_CROWDAGENT_LOD_REDUCED,		///< The neighbours, the boundary and the avoidance are updated at the reduced rate.
+	DT_CROWDAGENT_LOD_CORRIDOR,		///< The agent only follows its corridor, ignoring the other agents.
+	DT_CROWDAGENT_LOD_FROZEN		///< The agent is not moved.
 };
 
 /// Configuration parameters for a crowd agent.
@@ -83,6 +99,10 @@ struct dtCrowdAgentParams
 
 	float pathOptimizationRange;		///< The path visibility optimization range. [Limit: > 0]
 
+	/// The distance the agent or its next corner must move before the visibility optimization
+	/// is repeated along an unchanged corridor. Zero to optimize every update. [Limit: >= 0]
+	float pathOptimizationReuseDist;
+
 	/// How aggresive the agent manager should be at avoiding collisions with this agent. [Limit: >= 0]
 	float separationWeight;
 
@@ -96,6 +116,16 @@ struct dtCrowdAgentParams
 	/// The index of the query filter used by this agent.
 	unsigned char queryFilterType;
 
+	/// The priority class of the agent's path requests. Requests with a lower value are served first.
+	unsigned char pathPriority;
+
+	/// The maximum number of neighbors the agent takes into account. Zero to use the crowd maximum.
+	/// [Limits: 0 <= value <= dtCrowd::getMaxNeighbours()]
+	unsigned char maxNeighbours;
+
+	/// The update level of detail of the agent. (See: #CrowdAgentLOD)
+	unsigned char lod;
+
 	/// User defined data attached to the agent.
 	void* userData;
 };
@@ -133,8 +163,8 @@ struct dtCrowdAgent
 	/// Time since the agent's path corridor was optimized.
 	float topologyOptTime;
 	
-	/// The known neighbors of the agent.
-	dtCrowdNeighbour neis[DT_CROWDAGENT_MAX_NEIGHBOURS];
+	/// The known neighbors of the agent, closest first. [Size: dtCrowd::getMaxNeighbours()]
+	dtCrowdNeighbour* neis;
 
 	/// The number of neighbors.
 	int nneis;
@@ -169,6 +199,11 @@ struct dtCrowdAgent
 	dtPathQueueRef targetPathqRef;		///< Path finder ref.
 	bool targetReplan;					///< Flag indicating that the current path is being replanned.
 	float targetReplanTime;				/// <Time since the agent's target was replanned.
+
+	unsigned int pathGeneration;		///< The navigation mesh generation the path and the target were last validated at.
+	bool pathChanged;					///< True if the path or the target has changed since it was last validated.
+
+	float idleTime;						///< The time the agent has been idle. (See: #DT_CROWD_SLEEP) [Units: s]
 };
 
 struct dtCrowdAgentAnimation
@@ -188,7 +223,8 @@ enum UpdateFlags
 	DT_CROWD_OBSTACLE_AVOIDANCE = 2,
 	DT_CROWD_SEPARATION = 4,
 	DT_CROWD_OPTIMIZE_VIS = 8,			///< Use #dtPathCorridor::optimizePathVisibility() to optimize the agent path.
-	DT_CROWD_OPTIMIZE_TOPO = 16 		///< Use dtPathCorridor::optimizePathTopology() to optimize the agent path.
+	DT_CROWD_OPTIMIZE_TOPO = 16,		///< Use dtPathCorridor::optimizePathTopology() to optimize the agent path.
+	DT_CROWD_SLEEP = 32					///< Put the agent to sleep when it has been idle for dtCrowd::getSleepDelay() seconds.
 };
 
 struct dtCrowdAgentDebugInfo
@@ -198,44 +234,176 @@ struct dtCrowdAgentDebugInfo
 	dtObstacleAvoidanceDebugData* vod;
 };
 
+/// The memory used by a crowd, broken down by category. [Units: bytes]
+/// @see dtCrowd::getMemStats
+struct dtCrowdMemStats
+{
+	size_t agents;				///< The crowd object, the agents and the per-agent state such as neighbours and kinematics.
+	size_t corridors;			///< The paths of the agent corridors.
+	size_t boundaries;			///< The local boundaries of the agents and the shared wall segment cache.
+	size_t proximityGrid;		///< The proximity grid.
+	size_t pathQueue;			///< The path request queue, including its search queries and path cache.
+	size_t navQueries;			///< The navigation mesh queries of the crowd and its workers.
+	size_t obstacleAvoidance;	///< The obstacle avoidance queries of the crowd and its workers.
+	size_t flowField;			///< The flow field of the group move requests, including its query.
+	size_t snapshots;			///< The agent snapshot buffers.
+	size_t total;				///< The sum of all categories.
+};
+
+/// The time spent in the stages of the last crowd update. [Units: us]
+/// Only measured when a clock is set with dtCrowd::setUpdateClock, otherwise the times stay zero.
+/// @see dtCrowd::getUpdateTimes
+struct dtCrowdUpdateTimes
+{
+	double pathValidity;			///< Checking that the agent paths are still valid.
+	double moveRequests;			///< Processing the move requests and the path queue.
+	double topologyOptimization;	///< Optimizing the path topology.
+	double proximityGrid;			///< Building the proximity grid.
+	double boundary;				///< Updating the local boundaries, including the wall segment cache.
+	double neighbours;				///< Collecting the wall segments and the neighbour agents.
+	double corners;					///< Finding the corners to steer to and triggering off-mesh connections.
+	double steering;				///< Calculating the steering.
+	double planning;				///< Planning the velocities, including obstacle avoidance.
+	double integrate;				///< Integrating the velocities.
+	double collisions;				///< Resolving the collisions between the agents.
+	double moveAlongSurface;		///< Moving the agents along the navigation mesh.
+	double other;					///< Sleeping, off-mesh connection animations and publishing the snapshots.
+	double total;					///< The whole update.
+};
+
+struct dtCrowdUpdateJob;
+
+/// The kinematic state of the active agents during the integration and
+/// collision stages of the crowd update, one array per component.
+/// The arrays are indexed by the position of the agent in the active agent list.
+/// @note This structure is rarely if ever used by the end user.
+struct dtCrowdKinematics
+{
+	float* px;			///< The agent positions.
+	float* py;
+	float* pz;
+	float* vx;			///< The actual velocities.
+	float* vy;
+	float* vz;
+	float* nvx;			///< The planned velocities.
+	float* nvy;
+	float* nvz;
+	float* dvx;			///< The desired velocities, used to separate agents on top of each other.
+	float* dvz;
+	float* dispx;		///< The accumulated collision displacements.
+	float* dispz;
+	float* radius;		///< The agent radii.
+	float* maxAcceleration;	///< The maximum accelerations.
+	unsigned char* flags;	///< What the collision stages do with the agent.
+
+	float* mem;			///< The memory of the float arrays.
+};
+
 /// Provides local steering behaviors for a group of agents. 
 /// @ingroup crowd
 class dtCrowd
 {
+	dtAllocator* m_allocator;
 	int m_maxAgents;
 	dtCrowdAgent* m_agents;
 	dtCrowdAgent** m_activeAgents;
+	int* m_activeList;					///< The indices of the active agents. [Size: #m_maxAgents]
+	int m_activeCount;					///< The number of active agents.
+	int* m_activeIndices;				///< The position of each active agent in #m_activeList. [Size: #m_maxAgents]
+	int* m_freeList;					///< The indices of the free agents, the next one to use last. [Size: #m_maxAgents]
+	int m_freeCount;					///< The number of free agents.
+	dtCrowdKinematics m_kinematics;		///< The kinematic state of the active agents.
 	dtCrowdAgentAnimation* m_agentAnims;
+
+	dtCrowdNeighbour* m_neighbours;		///< The neighbours of all the agents. [Size: #m_maxAgents * #m_maxNeighbours]
+	int m_maxNeighbours;
+
+	dtWallSegmentCache m_wallSegmentCache;	///< The wall segments queried for the boundaries this frame.
+	unsigned char* m_boundaryUpdates;		///< Non-zero if the boundary of the active agent is updated this frame. [Size: #m_maxAgents]
+	int m_maxBoundarySegments;
 	
 	dtPathQueue m_pathq;
+	dtFlowField m_flowField;
 
 	dtObstacleAvoidanceParams m_obstacleQueryParams[DT_CROWD_MAX_OBSTAVOIDANCE_PARAMS];
 	dtObstacleAvoidanceQuery* m_obstacleQuery;
 	
 	dtProximityGrid* m_grid;
+
+	float m_clusterSize;				///< The size of the agent clusters, zero if the agents are not clustered. [Units: wu]
+	int* m_clusterAgents;				///< The active agents sorted by cluster. [Size: #m_maxAgents]
+	int* m_clusterStarts;				///< The first agent of each cluster in #m_clusterAgents. [Size: #m_maxAgents + 1]
+	int m_clusterCount;					///< The number of clusters in the last update.
+	unsigned int* m_clusterCandidates;	///< The neighbour candidates of a cluster, per worker. [Size: #m_maxAgents * max(1, #m_workerCount)]
+
+	const dtOffMeshConnectionTable* m_offMeshTable;	///< The endpoints of the off-mesh connections, or null.
 	
 	dtPolyRef* m_pathResult;
 	int m_maxPathResult;
+
+	dtCrowdAgent** m_pathQueueAgents;
 	
 	float m_agentPlacementHalfExtents[3];
 
 	dtQueryFilter m_filters[DT_CROWD_MAX_QUERY_FILTER_TYPE];
+	/// The include and exclude flags of the filters when the paths were last validated.
+	unsigned short m_validatedFilterFlags[DT_CROWD_MAX_QUERY_FILTER_TYPE][2];
 
 	float m_maxAgentRadius;
 
 	int m_velocitySampleCount;
 
+	unsigned int m_updateFrame;		///< The number of updates so far, used to stagger the reduced rate updates.
+	int m_lodUpdateInterval;		///< The number of frames between the updates of the reduced agents.
+	float m_sleepDelay;				///< The time an agent is idle before it is put to sleep. [Units: s]
+
+	dtCrowdAgent** m_topologyOptQueue;	///< The agents due for topology optimization. [Size: #m_maxAgents]
+	int m_topologyOptMaxAgents;			///< The maximum number of topology optimizations per update.
+	float m_topologyOptInterval;		///< The time between the topology optimizations of an agent. [Units: s]
+
 	dtNavMeshQuery* m_navquery;
 
-	void updateTopologyOptimization(dtCrowdAgent** agents, const int nagents, const float dt);
-	void updateMoveRequest(const float dt);
+	dtJobDispatcher* m_dispatcher;
+	int m_workerCount;
+	dtNavMeshQuery** m_workerNavQueries;					///< Per-worker queries, the first one is #m_navquery. [Size: #m_workerCount]
+	dtObstacleAvoidanceQuery** m_workerObstacleQueries;		///< Per-worker queries, the first one is #m_obstacleQuery. [Size: #m_workerCount]
+	int* m_workerSampleCounts;								///< Per-worker velocity sample counts. [Size: #m_workerCount]
+
+	dtQueryStats m_queryStats;		///< The work done by the navigation mesh queries during the last update.
+	dtTimeFunc m_updateClock;			///< The clock measuring the update stages, or null.
+	dtCrowdUpdateTimes m_updateTimes;	///< The time spent in the stages of the last update.
+
+	dtCrowdSnapshotBuffer m_snapshots;	///< The agent states published at the end of each update.
+
+	void updateTopologyOptimization(dtCrowdAgent** agents, const int nagents, const float dt,
+									const dtTimeBudget* pathBudget);
+	void updateMoveRequest(const float dt, const dtTimeBudget* pathBudget);
+	void updateCrowd(const float dt, dtCrowdAgentDebugInfo* debug, const dtTimeBudget* pathBudget);
 	void checkPathValidity(dtCrowdAgent** agents, const int nagents, const float dt);
+	void updateSleep(dtCrowdAgent** agents, const int nagents, const float dt);
+	void wakeAgent(dtCrowdAgent* agent);
+	void buildClusters();
+	bool needsBoundaryUpdate(const dtCrowdAgent* agent, dtNavMeshQuery* navquery) const;
+	void updateNeighbours(dtCrowdAgent** agents, const int nagents, const int idx, dtNavMeshQuery* navquery,
+						  const unsigned int* candidates, const int ncandidates);
 
 	inline int getAgentIndex(const dtCrowdAgent* agent) const  { return (int)(agent - m_agents); }
 
+	/// True if the reduced rate parts of the agent update are due this frame.
+	inline bool isLODUpdateFrame(const dtCrowdAgent* agent) const
+	{
+		return agent->params.lod != DT_CROWDAGENT_LOD_REDUCED ||
+			(m_updateFrame + (unsigned int)getAgentIndex(agent)) % (unsigned int)m_lodUpdateInterval == 0;
+	}
+
 	bool requestMoveTargetReplan(const int idx, dtPolyRef ref, const float* pos);
 
 	void purge();
+	void purgeWorkers();
+
+	void runUpdatePhase(dtCrowdUpdateJob& job, const int phase);
+	void updateAgents(const dtCrowdUpdateJob& job, const int first, const int last, const int workerIndex);
+	static void runUpdateJob(void* userData, const int jobIndex, const int workerIndex);
 	
 public:
 	dtCrowd();
@@ -245,8 +413,21 @@ public:
 	///  @param[in]		maxAgents		The maximum number of agents the crowd can manage. [Limit: >= 1]
 	///  @param[in]		maxAgentRadius	The maximum radius of any agent that will be added to the crowd. [Limit: > 0]
 	///  @param[in]		nav				The navigation mesh to use for planning.
+	///  @param[in]		maxPathRequests	The maximum number of path requests in the path queue. [Limit: >= 1]
+	///  @param[in]		maxPathSearches	The number of path requests searched at the same time, each with
+	///  								its own iteration budget. [Limit: >= 1]
+	///  @param[in]		maxNeighbours	The maximum number of neighbours of an agent. [Limits: 1 <= value <= 255]
+	///  @param[in]		maxBoundarySegments	The maximum number of wall segments an agent avoids. [Limit: >= 1]
+	///  @param[in]		maxBoundaryPolys	The maximum number of polygons searched for the wall segments. [Limit: >= 1]
+	///  @param[in]		allocator		The allocator of the crowd memory, including its queries and agents.
+	///  								Must outlive the crowd. [opt]
 	/// @return True if the initialization succeeded.
-	bool init(const int maxAgents, const float maxAgentRadius, dtNavMesh* nav);
+	bool init(const int maxAgents, const float maxAgentRadius, dtNavMesh* nav,
+			  const int maxPathRequests = 8, const int maxPathSearches = 1,
+			  const int maxNeighbours = DT_CROWDAGENT_MAX_NEIGHBOURS,
+			  const int maxBoundarySegments = DT_LOCAL_BOUNDARY_MAX_SEGS,
+			  const int maxBoundaryPolys = DT_LOCAL_BOUNDARY_MAX_POLYS,
+			  dtAllocator* allocator = 0);
 	
 	/// Sets the shared avoidance configuration for the specified index.
 	///  @param[in]		idx		The index. [Limits: 0 <= value < #DT_CROWD_MAX_OBSTAVOIDANCE_PARAMS]
@@ -272,6 +453,10 @@ public:
 	/// The maximum number of agents that can be managed by the object.
 	/// @return The maximum number of agents.
 	int getAgentCount() const;
+
+	/// The maximum number of neighbours of an agent.
+	/// @return The maximum number of neighbours.
+	int getMaxNeighbours() const { return m_maxNeighbours; }
 	
 	/// Adds a new agent to the crowd.
 	///  @param[in]		pos		The requested position of the agent. [(x, y, z)]
@@ -295,6 +480,14 @@ public:
 	/// @return True if the request was successfully submitted.
 	bool requestMoveTarget(const int idx, dtPolyRef ref, const float* pos);
 
+	/// Submits the same move request for a group of agents.
+	///  @param[in]		idx		The agent indices. [(index) * @p count]
+	///  @param[in]		count	The number of agents in the group.
+	///  @param[in]		ref		The position's polygon reference.
+	///  @param[in]		pos		The position within the polygon. [(x, y, z)]
+	/// @return The number of agents whose path was found from the shared search, or -1 if the request failed.
+	int requestMoveTargetGroup(const int* idx, const int count, dtPolyRef ref, const float* pos);
+
 	/// Submits a new move request for the specified agent.
 	///  @param[in]		idx		The agent index. [Limits: 0 <= value < #getAgentCount()]
 	///  @param[in]		vel		The movement velocity. [(x, y, z)]
@@ -312,11 +505,43 @@ public:
 	/// @return The number of agents returned in @p agents.
 	int getActiveAgents(dtCrowdAgent** agents, const int maxAgents);
 
+	/// Gets the number of active agents in the agent pool.
+	/// @return The number of active agents.
+	int getActiveAgentCount() const { return m_activeCount; }
+
 	/// Updates the steering and positions of all agents.
 	///  @param[in]		dt		The time, in seconds, to update the simulation. [Limit: > 0]
 	///  @param[out]	debug	A debug object to load with debug information. [Opt]
 	void update(const float dt, dtCrowdAgentDebugInfo* debug);
+
+	/// Updates the steering and positions of all agents, limiting the time spent on path searches.
+	///  @param[in]		dt			The time, in seconds, to update the simulation. [Limit: > 0]
+	///  @param[out]	debug		A debug object to load with debug information. [Opt]
+	///  @param[in]		pathBudget	The time budget for updating the path queue.
+	void update(const float dt, dtCrowdAgentDebugInfo* debug, const dtTimeBudget& pathBudget);
 	
+	/// Sets the dispatcher used to run the per-agent stages of #update concurrently.
+	///  @param[in]		dispatcher	The dispatcher, or null to update the agents serially. Must stay valid while set.
+	/// @return True if the per-worker queries could be allocated.
+	bool setJobDispatcher(dtJobDispatcher* dispatcher);
+
+	/// Enables caching of the paths found by the path queue, so that repeated move
+	/// requests between the same polygons skip the search. Must be called again after #init.
+	///  @param[in]		maxPaths	The maximum number of cached paths. Zero to disable the cache.
+	/// @return True if the cache was allocated.
+	bool initPathCache(const int maxPaths) { return m_pathq.initPathCache(maxPaths); }
+
+	/// Enables publishing the state of the active agents at the end of each update,
+	/// so that other threads can read them while the crowd is updated. Must be called again after #init.
+	///  @param[in]		enable	True to publish the agent states.
+	/// @return True if the snapshot buffers were allocated.
+	bool initSnapshots(const bool enable) { return m_snapshots.init(enable ? m_maxAgents : 0, m_allocator); }
+
+	/// Gets the agent states published by the last update.
+	/// The snapshots can be read from any thread, see #dtCrowdSnapshotBuffer::read.
+	/// @return The crowd's snapshot buffers.
+	const dtCrowdSnapshotBuffer* getSnapshots() const { return &m_snapshots; }
+
 	/// Gets the filter used by the crowd.
 	/// @return The filter used by the crowd.
 	inline const dtQueryFilter* getFilter(const int i) const { return (i >= 0 && i < DT_CROWD_MAX_QUERY_FILTER_TYPE) ? &m_filters[i] : 0; }
@@ -333,6 +558,63 @@ public:
 	/// @return The search halfExtents used by the crowd. [(x, y, z)]
 	const float* getQueryExtents() const { return m_agentPlacementHalfExtents; }
 	
+	/// Sets the number of frames between the updates of the #DT_CROWDAGENT_LOD_REDUCED agents.
+	/// The agents are spread evenly over the frames.
+	///  @param[in]		frames	The update interval. [Limit: >= 1]
+	void setLODUpdateInterval(const int frames);
+
+	/// Gets the number of frames between the updates of the #DT_CROWDAGENT_LOD_REDUCED agents.
+	/// @return The update interval.
+	int getLODUpdateInterval() const { return m_lodUpdateInterval; }
+
+	/// Sets how long an agent with the #DT_CROWD_SLEEP flag has to be idle before it is put to sleep.
+	///  @param[in]		delay	The idle time before sleeping. [Limit: >= 0] [Units: s]
+	void setSleepDelay(const float delay);
+
+	/// Gets how long an agent has to be idle before it is put to sleep.
+	/// @return The idle time before sleeping. [Units: s]
+	float getSleepDelay() const { return m_sleepDelay; }
+
+	/// Sets the size of the clusters the agents are grouped in for the boundary and neighbour updates.
+	/// The agents in a cluster gather their neighbour candidates from the proximity grid once, and the
+	/// agents whose boundary is due share the polygons searched around the first one of them.
+	/// The neighbours found are the same as without clusters, the wall segments are collected from the
+	/// shared polygons. Dense groups of agents should use a size of a few agent radii.
+	///  @param[in]		size	The size of the clusters, zero to update the agents on their own. [Limit: >= 0] [Units: wu]
+	void setClusterSize(const float size);
+
+	/// Gets the size of the agent clusters.
+	/// @return The size of the clusters, zero if the agents are not clustered. [Units: wu]
+	float getClusterSize() const { return m_clusterSize; }
+
+	/// Gets the number of agent clusters in the last update.
+	/// @return The number of clusters, zero if the agents are not clustered.
+	int getClusterCount() const { return m_clusterCount; }
+
+	/// Sets the table the agents look up the endpoints of the off-mesh connections they start to traverse in.
+	/// The table has to be updated by the user after the navigation mesh changes, the connections it
+	/// has no up to date entry for are looked up in the navigation mesh.
+	///  @param[in]		table	The table of the crowd's navigation mesh, or null to use the navigation mesh. [opt]
+	void setOffMeshConnectionTable(const dtOffMeshConnectionTable* table) { m_offMeshTable = table; }
+
+	/// Gets the table used for the endpoints of the off-mesh connections.
+	/// @return The table, or null if the navigation mesh is used.
+	const dtOffMeshConnectionTable* getOffMeshConnectionTable() const { return m_offMeshTable; }
+
+	/// Sets how many agents have their path topology optimized per update.
+	/// The agents that have waited the longest are optimized first, the rest wait for the next update.
+	///  @param[in]		maxAgents	The maximum number of optimizations per update. [Limits: 1 <= value <= #getAgentCount()]
+	///  @param[in]		interval	The time before the path of an agent is optimized again. [Limit: >= 0] [Units: s]
+	void setTopologyOptimizationBudget(const int maxAgents, const float interval);
+
+	/// Gets the maximum number of topology optimizations per update.
+	/// @return The maximum number of optimizations.
+	int getTopologyOptimizationMaxAgents() const { return m_topologyOptMaxAgents; }
+
+	/// Gets the time before the path of an agent is optimized again.
+	/// @return The optimization interval. [Units: s]
+	float getTopologyOptimizationInterval() const { return m_topologyOptInterval; }
+
 	/// Gets the velocity sample count.
 	/// @return The velocity sample count.
 	inline int getVelocitySampleCount() const { return m_velocitySampleCount; }
@@ -341,6 +623,14 @@ public:
 	/// @return The crowd's proximity grid.
 	const dtProximityGrid* getGrid() const { return m_grid; }
 
+	/// Gets the wall segments cached for the local boundaries during the last update.
+	/// @return The crowd's wall segment cache.
+	const dtWallSegmentCache* getWallSegmentCache() const { return &m_wallSegmentCache; }
+
+	/// Gets the flow field of the last group move request.
+	/// @return The crowd's flow field.
+	const dtFlowField* getFlowField() const { return &m_flowField; }
+
 	/// Gets the crowd's path request queue.
 	/// @return The crowd's path request queue.
 	const dtPathQueue* getPathQueue() const { return &m_pathq; }
@@ -348,6 +638,24 @@ public:
 	/// Gets the query object used by the crowd.
 	const dtNavMeshQuery* getNavMeshQuery() const { return m_navquery; }
 
+	/// Gets the work done by the navigation mesh queries during the last update,
+	/// summed over the queries of the crowd, its workers and its path queue.
+	/// Only counted when compiled with DT_QUERY_STATS defined.
+	/// @return The query statistics of the last update.
+	const dtQueryStats& getQueryStats() const { return m_queryStats; }
+
+	/// Sets the clock used to measure the time spent in the stages of #update.
+	///  @param[in]		getTime		The clock, or null to stop measuring.
+	void setUpdateClock(dtTimeFunc getTime);
+
+	/// Gets the time spent in the stages of the last update. (See: #setUpdateClock)
+	/// @return The stage times of the last update.
+	const dtCrowdUpdateTimes& getUpdateTimes() const { return m_updateTimes; }
+
+	/// Gets the memory used by the crowd.
+	///  @param[out]	stats	The memory usage.
+	void getMemStats(dtCrowdMemStats* stats) const;
+
 private:
 	// Explicitly disabled copy constructor and copy assignment operator.
 	dtCrowd(const dtCrowd&);
@@ -430,10 +738,38 @@ feature to find minor members.
 
 #dtCrowd permits agents to use different avoidance configurations.  This value 
 is the index of the #dtObstacleAvoidanceParams within the crowd.
+The configuration also selects the avoidance method, see
+dtObstacleAvoidanceParams::solver.
 
 @see dtObstacleAvoidanceParams, dtCrowd::setObstacleAvoidanceParams(), 
 	 dtCrowd::getObstacleAvoidanceParams()
 
+@var dtCrowdAgentParams::lod
+@par
+
+Lowering the level of detail of the agents far from the players saves
+most of their update cost.
+
+- #DT_CROWDAGENT_LOD_REDUCED agents query their neighbours and boundary,
+  and plan their velocity once every dtCrowd::getLODUpdateInterval() frames.
+  They keep the direction of the planned velocity in between, and still
+  resolve collisions with their neighbours every frame.
+- #DT_CROWDAGENT_LOD_CORRIDOR agents follow their corridor without
+  neighbours, avoidance or collisions. Other agents still avoid them.
+- #DT_CROWDAGENT_LOD_FROZEN agents stop where they are. Their path
+  requests are still served, and other agents still avoid them.
+
+@var dtCrowdAgentParams::updateFlags
+@par
+
+Agents with the #DT_CROWD_SLEEP flag are put to sleep when they have no
+move target, or have arrived at it, and have not moved for
+dtCrowd::getSleepDelay() seconds. Sleeping agents skip the whole agent update,
+but stay in the proximity grid, where the other agents avoid and collide with
+them as static obstacles. A sleeping agent wakes up when it is given a new
+request or parameters, when a moving agent touches it, or when the navigation
+mesh under its path changes.
+
 @var dtCrowdAgentParams::collisionQueryRange
 @par
 
@@ -450,6 +786,17 @@ This value is often based on the agent radius. E.g. radius * 30
 
 @see dtPathCorridor::optimizePathVisibility()
 
+@var dtCrowdAgentParams::pathOptimizationReuseDist
+@par
+
+Only applicable if #updateFlags includes the #DT_CROWD_OPTIMIZE_VIS flag.
+
+The visibility ray is cast again when the corridor changes regardless of this value, 
+so a small fraction of the agent radius saves most of the raycasts of agents walking 
+along a straight corridor. E.g. radius * 0.5
+
+@see dtPathCorridor::optimizePathVisibility()
+
 @var dtCrowdAgentParams::separationWeight
 @par
 
@@ -0,0 +1,110 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#ifndef DETOURCROWDSNAPSHOT_H
+#define DETOURCROWDSNAPSHOT_H
+
+#include "DetourAlloc.h"
+#include "DetourNavMesh.h"
+#include "DetourStatus.h"
+
+/// The number of state buffers of a #dtCrowdSnapshotBuffer.
+static const int DT_CROWD_SNAPSHOT_BUFFERS = 3;
+
+/// The compact state of an agent at the end of a crowd update.
+/// @ingroup crowd
+struct dtCrowdAgentSnapshot
+{
+	int idx;				///< The index of the agent in the crowd.
+	float pos[3];			///< The position of the agent. [(x, y, z)]
+	float vel[3];			///< The actual velocity of the agent. [(x, y, z)]
+	float targetPos[3];		///< The target of the movement request, or the velocity of a velocity request. [(x, y, z)]
+	dtPolyRef targetRef;	///< The target polygon of the movement request.
+	unsigned char state;	///< The type of mesh polygon the agent is traversing. (See: #CrowdAgentState)
+	unsigned char targetState;	///< The state of the movement request. (See: #MoveRequestState)
+};
+
+/// A set of agent states published by one thread and read by any number of other threads
+/// without locking.
+///
+/// The writer fills the oldest of the buffers between #beginPublish and #endPublish, and
+/// readers copy out the most recently published buffer with #read. Each buffer carries a 
+/// sequence number that is odd while the buffer is written, a reader that finds the number
+/// changed during its copy retries with the latest buffer. Since the writer only reuses a
+/// buffer two publishes after it was the latest one, readers rarely have to retry.
+/// @ingroup crowd
+class dtCrowdSnapshotBuffer
+{
+	struct Buffer
+	{
+		unsigned int seq;				///< Odd while the buffer is being written.
+		int count;						///< The number of states in the buffer.
+		unsigned int frame;				///< The frame number passed to #endPublish.
+		dtCrowdAgentSnapshot* states;	///< [Size: #m_maxStates]
+	};
+
+	dtAllocator* m_allocator;
+	Buffer m_buffers[DT_CROWD_SNAPSHOT_BUFFERS];
+	dtCrowdAgentSnapshot* m_states;
+	int m_maxStates;
+	unsigned int m_latest;		///< One plus the index of the latest published buffer, or zero if none.
+	int m_writing;				///< The index of the buffer being written, or -1.
+
+	void purge();
+
+public:
+	dtCrowdSnapshotBuffer();
+	~dtCrowdSnapshotBuffer();
+
+	/// Initializes the buffers. Must not be called while the buffers are read.
+	///  @param[in]		maxStates	The maximum number of states in a snapshot. Zero to disable the buffers.
+	///  @param[in]		allocator	The allocator of the buffer memory. [opt]
+	/// @return True if the initialization succeeded.
+	bool init(const int maxStates, dtAllocator* allocator = 0);
+
+	/// Starts writing a new snapshot. Only one thread may publish snapshots.
+	/// @return The states to fill, or null if the buffers are not initialized. [Size: #getMaxStates]
+	dtCrowdAgentSnapshot* beginPublish();
+
+	/// Makes the states written since #beginPublish the latest snapshot.
+	///  @param[in]		count	The number of states written. [Limits: 0 <= value <= #getMaxStates]
+	///  @param[in]		frame	A user defined frame number stored with the snapshot.
+	void endPublish(const int count, const unsigned int frame);
+
+	/// Copies out the latest published snapshot. Can be called from any thread.
+	///  @param[out]	states		The agent states. [(state) * @p stateCount]
+	///  @param[out]	stateCount	The number of states copied.
+	///  @param[in]		maxStates	The maximum number of states to copy.
+	///  @param[out]	frame		The frame number of the snapshot. [opt]
+	/// @returns The status flags for the read. Fails if no snapshot has been published yet.
+	dtStatus read(dtCrowdAgentSnapshot* states, int* stateCount, const int maxStates, unsigned int* frame = 0) const;
+
+	/// The maximum number of states in a snapshot.
+	inline int getMaxStates() const { return m_maxStates; }
+
+	/// Gets the memory allocated by the buffer, not including the object itself. [Units: bytes]
+	size_t getMemUsed() const;
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtCrowdSnapshotBuffer(const dtCrowdSnapshotBuffer&);
+	dtCrowdSnapshotBuffer& operator=(const dtCrowdSnapshotBuffer&);
+};
+
+#endif // DETOURCROWDSNAPSHOT_H
@@ -0,0 +1,93 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURFLOWFIELD_H
+#define DETOURFLOWFIELD_H
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+
+/// A table of the next polygon towards a shared target, for each polygon around the target.
+/// Used to find the paths of many agents heading to the same target with a single search.
+class dtFlowField
+{
+	dtAllocator* m_allocator;
+	dtNavMeshQuery* m_navquery;
+	dtPolyRef* m_refs;			///< The polygons of the field, in the order they were reached.
+	dtPolyRef* m_parents;		///< The next polygon towards the target, zero for the target polygon.
+	float* m_costs;				///< The cost from the polygon to the target.
+	int m_npolys;
+	int m_maxPolys;
+
+	int* m_slots;				///< Hash table from polygon reference to the index in #m_refs.
+	unsigned int m_slotMask;
+
+	dtPolyRef m_targetRef;
+	float m_targetPos[3];
+
+	void purge();
+	int findPoly(dtPolyRef ref) const;
+	bool hasLink(dtPolyRef from, dtPolyRef to) const;
+
+public:
+	dtFlowField();
+	~dtFlowField();
+
+	/// Initializes the flow field.
+	///  @param[in]		nav			The navigation mesh the field is built on.
+	///  @param[in]		maxPolys	The maximum number of polygons in the field. [Limits: 0 < value <= 65535]
+	///  @param[in]		allocator	The allocator of the field memory. [opt]
+	/// @return True if the initialization succeeded.
+	bool init(const dtNavMesh* nav, const int maxPolys, dtAllocator* allocator = 0);
+
+	/// Builds the field by searching outwards from the target.
+	///  @param[in]		targetRef	The reference of the target polygon.
+	///  @param[in]		targetPos	The target position. [(x, y, z)]
+	///  @param[in]		radius		The radius of the searched area around the target.
+	///  @param[in]		filter		The polygon filter applied to the search.
+	/// @returns The status flags of the search.
+	dtStatus build(dtPolyRef targetRef, const float* targetPos, const float radius, const dtQueryFilter* filter);
+
+	/// Gets the path from a polygon to the target by following the field.
+	///  @param[in]		startRef	The reference of the start polygon.
+	///  @param[out]	path		The path, ordered from start to the target. [(polyRef) * return value]
+	///  @param[in]		maxPath		The maximum number of polygons the path can hold. [Limit: >= 1]
+	/// @return The number of polygons in the path, or zero if the target cannot be reached within @p maxPath polygons.
+	int getPath(dtPolyRef startRef, dtPolyRef* path, const int maxPath) const;
+
+	/// Gets the cost from a polygon to the target.
+	///  @param[in]		ref			The reference of the polygon.
+	///  @param[out]	cost		The cost to the target.
+	/// @return True if the polygon is part of the field.
+	bool getCost(dtPolyRef ref, float* cost) const;
+
+	inline dtPolyRef getTargetRef() const { return m_targetRef; }
+	inline const float* getTargetPos() const { return m_targetPos; }
+	inline int getPolyCount() const { return m_npolys; }
+
+	/// Gets the memory allocated by the field, including its query, not including the
+	/// field object itself. [Units: bytes]
+	size_t getMemUsed() const;
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtFlowField(const dtFlowField&);
+	dtFlowField& operator=(const dtFlowField&);
+};
+
+#endif // DETOURFLOWFIELD_H
@@ -22,23 +22,100 @@
 #include "DetourNavMeshQuery.h"
 
 
+/// The default maximum number of wall segments in a local boundary.
+/// @see dtLocalBoundary::init(), dtCrowd::init()
+static const int DT_LOCAL_BOUNDARY_MAX_SEGS = 8;
+
+/// The default maximum number of polygons searched for wall segments around a local boundary.
+/// Crowds in cluttered areas can pass a larger limit to dtCrowd::init, so that fewer walls are missed.
+/// @see dtLocalBoundary::init(), dtCrowd::init()
+static const int DT_LOCAL_BOUNDARY_MAX_POLYS = 16;
+
+/// Stores the wall segments of polygons so that local boundaries sharing polygons
+/// only query them from the navigation mesh once.
+class dtWallSegmentCache
+{
+	struct Entry
+	{
+		dtPolyRef ref;
+		const dtQueryFilter* filter;
+		int firstSeg;
+		int nsegs;
+		unsigned int slot;
+	};
+
+	dtAllocator* m_allocator;
+	Entry* m_entries;
+	int m_nentries;
+	int m_maxEntries;
+
+	int* m_slots;
+	unsigned int m_slotMask;
+
+	float* m_segs;
+	int m_nsegs;
+	int m_maxSegs;
+
+	int findEntry(dtPolyRef ref, const dtQueryFilter* filter, unsigned int& slot) const;
+
+public:
+	dtWallSegmentCache();
+	~dtWallSegmentCache();
+
+	/// Initializes the cache.
+	///  @param[in]		maxPolys	The maximum number of polygons in the cache. [Limit: > 0]
+	///  @param[in]		maxSegs		The maximum number of wall segments in the cache. [Limit: > 0]
+	///  @param[in]		allocator	The allocator of the cache memory. [opt]
+	/// @return True if the initialization succeeded.
+	bool init(const int maxPolys, const int maxSegs, dtAllocator* allocator = 0);
+
+	/// Removes all polygons from the cache.
+	void clear();
+
+	/// Adds the wall segments of a polygon to the cache, if not already added.
+	///  @param[in]		ref			The reference of the polygon.
+	///  @param[in]		filter		The filter the segments are queried with.
+	///  @param[in]		navquery	The query used to get the segments.
+	/// @return True if the segments of the polygon are in the cache.
+	bool addPoly(dtPolyRef ref, const dtQueryFilter* filter, const dtNavMeshQuery* navquery);
+
+	/// Gets the cached wall segments of a polygon.
+	///  @param[in]		ref			The reference of the polygon.
+	///  @param[in]		filter		The filter the segments were queried with.
+	///  @param[out]	segs		The segments of the polygon. [(ax, ay, az, bx, by, bz) * @p nsegs]
+	///  @param[out]	nsegs		The number of segments.
+	/// @return True if the polygon was found in the cache.
+	bool getSegments(dtPolyRef ref, const dtQueryFilter* filter, const float** segs, int* nsegs) const;
+
+	inline int getPolyCount() const { return m_nentries; }
+	inline int getSegmentCount() const { return m_nsegs; }
+
+	/// Gets the memory allocated by the cache, not including the object itself. [Units: bytes]
+	size_t getMemUsed() const;
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtWallSegmentCache(const dtWallSegmentCache&);
+	dtWallSegmentCache& operator=(const dtWallSegmentCache&);
+};
+
 class dtLocalBoundary
 {
-	static const int MAX_LOCAL_SEGS = 8;
-	static const int MAX_LOCAL_POLYS = 16;
-	
 	struct Segment
 	{
 		float s[6];	///< Segment start/end
 		float d;	///< Distance for pruning.
 	};
 	
+	dtAllocator* m_allocator;
 	float m_center[3];
-	Segment m_segs[MAX_LOCAL_SEGS];
+	Segment* m_segs;
 	int m_nsegs;
+	int m_maxSegs;
 	
-	dtPolyRef m_polys[MAX_LOCAL_POLYS];
+	dtPolyRef* m_polys;
 	int m_npolys;
+	int m_maxPolys;
 
 	void addSegment(const float dist, const float* s);
 	
@@ -46,16 +123,54 @@ public:
 	dtLocalBoundary();
 	~dtLocalBoundary();
 	
+	/// Allocates the boundary buffers.
+	///  @param[in]		maxSegs		The maximum number of wall segments kept. [Limit: > 0]
+	///  @param[in]		maxPolys	The maximum number of polygons searched for segments. [Limit: > 0]
+	///  @param[in]		allocator	The allocator of the boundary buffers. [opt]
+	/// @return True if the initialization succeeded.
+	bool init(const int maxSegs = DT_LOCAL_BOUNDARY_MAX_SEGS, const int maxPolys = DT_LOCAL_BOUNDARY_MAX_POLYS,
+			  dtAllocator* allocator = 0);
+	
 	void reset();
 	
 	void update(dtPolyRef ref, const float* pos, const float collisionQueryRange,
-				dtNavMeshQuery* navquery, const dtQueryFilter* filter);
+				dtNavMeshQuery* navquery, const dtQueryFilter* filter,
+				dtNavMeshNeighbourhood* neighbourhood = 0);
 	
-	bool isValid(dtNavMeshQuery* navquery, const dtQueryFilter* filter);
+	/// Finds the polygons around the new center of the boundary, and clears the segments.
+	/// Call #updateSegments to collect the segments of the polygons.
+	///  @param[in,out]	neighbourhood	The polygons kept from the previous searches of the boundary, which
+	///  								the search reuses while the boundary moves within its margin. [opt]
+	void updatePolys(dtPolyRef ref, const float* pos, const float collisionQueryRange,
+					 dtNavMeshQuery* navquery, const dtQueryFilter* filter,
+					 dtNavMeshNeighbourhood* neighbourhood = 0);
+	
+	/// Collects the wall segments of the polygons found by #updatePolys. The segments
+	/// are read from @p cache when found, and queried from @p navquery otherwise.
+	void updateSegments(const float collisionQueryRange, dtNavMeshQuery* navquery,
+						const dtQueryFilter* filter, const dtWallSegmentCache* cache);
+
+	/// Uses the polygons found by another boundary around the new center, and clears the segments.
+	/// Call #updateSegments to collect the segments of the polygons.
+	///  @param[in]		src		The boundary whose polygons to use.
+	///  @param[in]		pos		The new center of the boundary. [(x, y, z)]
+	void copyPolys(const dtLocalBoundary& src, const float* pos);
+
+	/// Returns true if the polygon is one of the polygons of the boundary.
+	bool hasPoly(dtPolyRef ref) const;
+	
+	bool isValid(dtNavMeshQuery* navquery, const dtQueryFilter* filter) const;
 	
 	inline const float* getCenter() const { return m_center; }
 	inline int getSegmentCount() const { return m_nsegs; }
 	inline const float* getSegment(int i) const { return m_segs[i].s; }
+	inline int getPolyCount() const { return m_npolys; }
+	inline dtPolyRef getPoly(int i) const { return m_polys[i]; }
+	inline int getMaxSegments() const { return m_maxSegs; }
+	inline int getMaxPolys() const { return m_maxPolys; }
+
+	/// Gets the memory allocated by the boundary, not including the object itself. [Units: bytes]
+	size_t getMemUsed() const;
 
 private:
 	// Explicitly disabled copy constructor and copy assignment operator.
@@ -19,6 +19,8 @@
 #ifndef DETOUROBSTACLEAVOIDANCE_H
 #define DETOUROBSTACLEAVOIDANCE_H
 
+#include "DetourAlloc.h"
+
 struct dtObstacleCircle
 {
 	float p[3];				///< Position of the obstacle
@@ -34,6 +36,14 @@ struct dtObstacleSegment
 	bool touch;
 };
 
+/// A half-plane of permitted velocities, used by the ORCA solver.
+/// The permitted velocities are on the left side of the line.
+struct dtObstacleLine
+{
+	float p[3];				///< A point on the line
+	float dir[3];			///< Direction of the line, unit length
+};
+
 
 class dtObstacleAvoidanceDebugData
 {
@@ -80,6 +90,14 @@ void dtFreeObstacleAvoidanceDebugData(dtObstacleAvoidanceDebugData* ptr);
 static const int DT_MAX_PATTERN_DIVS = 32;	///< Max numver of adaptive divs.
 static const int DT_MAX_PATTERN_RINGS = 4;	///< Max number of adaptive rings.
 
+/// The methods used to find a collision free velocity.
+/// @see dtObstacleAvoidanceParams::solver
+enum dtObstacleAvoidanceSolver
+{
+	DT_OBSTACLE_AVOIDANCE_SAMPLED = 0,	///< Sample the velocity space, see dtObstacleAvoidanceQuery::sampleVelocityAdaptive.
+	DT_OBSTACLE_AVOIDANCE_ORCA = 1,		///< Solve the ORCA constraints, see dtObstacleAvoidanceQuery::solveVelocityORCA.
+};
+
 struct dtObstacleAvoidanceParams
 {
 	float velBias;
@@ -92,6 +110,7 @@ struct dtObstacleAvoidanceParams
 	unsigned char adaptiveDivs;	///< adaptive
 	unsigned char adaptiveRings;	///< adaptive
 	unsigned char adaptiveDepth;	///< adaptive
+	unsigned char solver;	///< The avoidance method. (See: #dtObstacleAvoidanceSolver)
 };
 
 class dtObstacleAvoidanceQuery
@@ -100,7 +119,7 @@ public:
 	dtObstacleAvoidanceQuery();
 	~dtObstacleAvoidanceQuery();
 	
-	bool init(const int maxCircles, const int maxSegments);
+	bool init(const int maxCircles, const int maxSegments, dtAllocator* allocator = 0);
 	
 	void reset();
 
@@ -118,6 +137,17 @@ public:
 							   const float* vel, const float* dvel, float* nvel,
 							   const dtObstacleAvoidanceParams* params, 
 							   dtObstacleAvoidanceDebugData* debug = 0);
+
+	/// Finds the velocity closest to the desired velocity which satisfies the
+	/// optimal reciprocal collision avoidance (ORCA) constraints of the obstacles.
+	/// The circles are expected to be other agents doing the same, and take half of
+	/// the responsibility of avoiding each other. Only the horizon time of the
+	/// parameters is used.
+	/// @returns The number of constraints used.
+	int solveVelocityORCA(const float* pos, const float rad, const float vmax,
+						  const float* vel, const float* dvel, float* nvel,
+						  const dtObstacleAvoidanceParams* params,
+						  dtObstacleAvoidanceDebugData* debug = 0);
 	
 	inline int getObstacleCircleCount() const { return m_ncircles; }
 	const dtObstacleCircle* getObstacleCircle(const int i) { return &m_circles[i]; }
@@ -125,6 +155,9 @@ public:
 	inline int getObstacleSegmentCount() const { return m_nsegments; }
 	const dtObstacleSegment* getObstacleSegment(const int i) { return &m_segments[i]; }
 
+	/// Gets the memory allocated by the query, not including the object itself. [Units: bytes]
+	size_t getMemUsed() const;
+
 private:
 	// Explicitly disabled copy constructor and copy assignment operator.
 	dtObstacleAvoidanceQuery(const dtObstacleAvoidanceQuery&);
@@ -138,6 +171,13 @@ private:
 						const float minPenalty,
 						dtObstacleAvoidanceDebugData* debug);
 
+	void processSamplePacket(const float* vcands, const int ncands, const float cs,
+							 const float* pos, const float rad,
+							 const float* vel, const float* dvel,
+							 float& minPenalty, float* bestVel,
+							 dtObstacleAvoidanceDebugData* debug);
+
+	dtAllocator* m_allocator;
 	dtObstacleAvoidanceParams m_params;
 	float m_invHorizTime;
 	float m_vmax;
@@ -150,6 +190,9 @@ private:
 	int m_maxSegments;
 	dtObstacleSegment* m_segments;
 	int m_nsegments;
+
+	dtObstacleLine* m_lines;		///< The ORCA constraints. [Size: m_maxCircles + m_maxSegments]
+	dtObstacleLine* m_projLines;	///< Scratch constraints of the ORCA solver. [Size: m_maxCircles + m_maxSegments]
 };
 
 dtObstacleAvoidanceQuery* dtAllocObstacleAvoidanceQuery();
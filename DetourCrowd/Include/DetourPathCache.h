@@ -0,0 +1,103 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURPATHCACHE_H
+#define DETOURPATHCACHE_H
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+
+/// A least recently used cache of complete polygon paths.
+/// The paths are keyed by their end polygon and query filter. A path is found for
+/// any start polygon along a cached path, returning the rest of the path.
+/// Paths running through tiles that have changed since they were stored are dropped.
+/// @see dtNavMesh::getGeneration, dtPathQueue::initPathCache
+class dtPathCache
+{
+	struct Entry
+	{
+		dtPolyRef* path;
+		int npath;
+		const dtQueryFilter* filter;
+		unsigned int filterKey;		///< Hash of the filter state when the path was stored.
+		unsigned int generation;	///< The navigation mesh generation the path is known to be valid at.
+		unsigned int lastUse;		///< Use stamp for the least recently used eviction.
+	};
+
+	dtAllocator* m_allocator;
+	Entry* m_entries;
+	dtPolyRef* m_paths;
+	int m_nentries;
+	int m_maxEntries;
+	int m_maxPathSize;
+	unsigned int m_useStamp;
+	int m_hitCount;
+	int m_missCount;
+
+	void purge();
+	bool isEntryValid(Entry& e, const dtNavMesh* nav) const;
+	void removeEntry(const int i);
+
+public:
+	dtPathCache();
+	~dtPathCache();
+
+	/// Initializes the cache. 
+	///  @param[in]		maxPaths		The maximum number of cached paths. Zero to disable the cache.
+	///  @param[in]		maxPathSize		The maximum number of polygons in a cached path.
+	///  @param[in]		allocator		The allocator of the cache memory. [opt]
+	/// @return True if the initialization succeeded.
+	bool init(const int maxPaths, const int maxPathSize, dtAllocator* allocator = 0);
+
+	/// Removes all paths from the cache.
+	void clear();
+
+	/// Finds the cached path from a polygon to the end polygon.
+	///  @param[in]		startRef	The reference of the start polygon.
+	///  @param[in]		endRef		The reference of the end polygon.
+	///  @param[in]		filter		The filter the path is searched with.
+	///  @param[in]		nav			The navigation mesh the path is on.
+	///  @param[out]	path		The path from the start to the end polygon. [(polyRef) * @p pathCount]
+	///  @param[out]	pathCount	The number of polygons in the path.
+	///  @param[in]		maxPath		The maximum number of polygons the path can hold.
+	/// @return True if a path was found.
+	bool find(dtPolyRef startRef, dtPolyRef endRef, const dtQueryFilter* filter, const dtNavMesh* nav,
+			  dtPolyRef* path, int* pathCount, const int maxPath);
+
+	/// Stores a complete path, replacing the least recently used path if the cache is full.
+	///  @param[in]		path		The path. [(polyRef) * @p pathCount]
+	///  @param[in]		pathCount	The number of polygons in the path.
+	///  @param[in]		filter		The filter the path was searched with.
+	///  @param[in]		generation	The navigation mesh generation when the search started.
+	void store(const dtPolyRef* path, const int pathCount, const dtQueryFilter* filter, const unsigned int generation);
+
+	inline int getPathCount() const { return m_nentries; }
+	inline int getMaxPaths() const { return m_maxEntries; }
+	inline int getHitCount() const { return m_hitCount; }
+	inline int getMissCount() const { return m_missCount; }
+
+	/// Gets the memory allocated by the cache, not including the object itself. [Units: bytes]
+	size_t getMemUsed() const;
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtPathCache(const dtPathCache&);
+	dtPathCache& operator=(const dtPathCache&);
+};
+
+#endif // DETOURPATHCACHE_H
@@ -21,6 +21,8 @@
 
 #include "DetourNavMeshQuery.h"
 
+class dtOffMeshConnectionTable;
+
 /// Represents a dynamic polygon corridor used to plan agent movement.
 /// @ingroup crowd, detour
 class dtPathCorridor
@@ -28,9 +30,41 @@ class dtPathCorridor
 	float m_pos[3];
 	float m_target[3];
 	
+	dtAllocator* m_allocator;
 	dtPolyRef* m_path;
 	int m_npath;
 	int m_maxPath;
+
+	/// The state of the corridor after the last visibility optimization, used to skip
+	/// the raycast while neither the corridor prefix nor the ray have changed.
+	struct VisibilityCache
+	{
+		float pos[3];				///< The position the ray was cast from.
+		float next[3];				///< The point the ray was cast toward.
+		unsigned int prefixHash;	///< Hash of the corridor prefix the ray can shortcut.
+		int npath;					///< The number of polygons in the corridor.
+		unsigned int generation;	///< The navigation mesh generation.
+		const dtQueryFilter* filter;
+		bool valid;
+	};
+	VisibilityCache m_visCache;
+
+	/// The portals of the start of the corridor from the last call to #findCorners.
+	/// Moving the position mostly trims polygons off the start of the corridor, so the
+	/// portals which are still in the corridor are shifted and reused by the next call.
+	struct PortalCache
+	{
+		enum { MAX_PORTALS = 16 };
+		float portals[MAX_PORTALS*6];			///< The left and right points of each portal.
+		unsigned char types[MAX_PORTALS];		///< The type of the polygon entered through each portal.
+		dtPolyRef refs[MAX_PORTALS+1];			///< The corridor polygons the portals were computed for.
+		int count;								///< The number of cached portals.
+		const dtNavMesh* nav;					///< The navigation mesh the portals were computed on.
+		unsigned int generation;				///< The navigation mesh generation.
+	};
+	PortalCache m_portalCache;
+
+	void updatePortalCache(const dtNavMesh* nav);
 	
 public:
 	dtPathCorridor();
@@ -38,8 +72,9 @@ public:
 	
 	/// Allocates the corridor's path buffer. 
 	///  @param[in]		maxPath		The maximum path size the corridor can handle.
+	///  @param[in]		allocator	The allocator of the path buffer. [opt]
 	/// @return True if the initialization succeeded.
-	bool init(const int maxPath);
+	bool init(const int maxPath, dtAllocator* allocator = 0);
 	
 	/// Resets the path corridor to the specified position.
 	///  @param[in]		ref		The polygon reference containing the position.
@@ -64,22 +99,43 @@ public:
 	///  @param[in]		pathOptimizationRange	The maximum range to search. [Limit: > 0]
 	///  @param[in]		navquery				The query object used to build the corridor.
 	///  @param[in]		filter					The filter to apply to the operation.			
+	///  @param[in]		reuseDist				The distance the position or @p next must move before the
+	///  										ray is cast again along an unchanged corridor. Zero to cast
+	///  										the ray on every call. [Limit: >= 0]
 	void optimizePathVisibility(const float* next, const float pathOptimizationRange,
-								dtNavMeshQuery* navquery, const dtQueryFilter* filter);
+								dtNavMeshQuery* navquery, const dtQueryFilter* filter,
+								const float reuseDist = 0.0f);
 	
 	/// Attempts to optimize the path using a local area search. (Partial replanning.) 
 	///  @param[in]		navquery	The query object used to build the corridor.
 	///  @param[in]		filter		The filter to apply to the operation.	
 	bool optimizePathTopology(dtNavMeshQuery* navquery, const dtQueryFilter* filter);
 	
+	/// Advances the path over an off-mesh connection.
+	///  @param[in]		offMeshConRef	The reference of the off-mesh connection to move over.
+	///  @param[out]	refs			The polygon before the connection and the connection. [(prevRef, polyRef)]
+	///  @param[out]	startPos		The start position of the traversal. [(x, y, z)]
+	///  @param[out]	endPos			The end position of the traversal. [(x, y, z)]
+	///  @param[in]		navquery		The query object used to build the corridor.
+	///  @param[in]		table			The table the endpoints are looked up in. The navigation mesh is used
+	///  								for the connections the table has no up to date entry for. [opt]
+	/// @returns True if the connection was found in the corridor.
 	bool moveOverOffmeshConnection(dtPolyRef offMeshConRef, dtPolyRef* refs,
 								   float* startPos, float* endPos,
-								   dtNavMeshQuery* navquery);
+								   dtNavMeshQuery* navquery,
+								   const dtOffMeshConnectionTable* table = 0);
 
 	bool fixPathStart(dtPolyRef safeRef, const float* safePos);
 
 	bool trimInvalidPath(dtPolyRef safeRef, const float* safePos,
 						 dtNavMeshQuery* navquery, const dtQueryFilter* filter);
+
+	/// Replaces the invalid parts of the corridor with local searches around them. (Partial replanning.)
+	///  @param[in]		maxIterations	The maximum number of search iterations per invalid part.
+	///  @param[in]		navquery		The query object used to build the corridor.
+	///  @param[in]		filter			The filter to apply to the operation.
+	/// @return Returns true if the whole corridor is valid, false if it needs to be replanned.
+	bool repairPath(const int maxIterations, dtNavMeshQuery* navquery, const dtQueryFilter* filter);
 	
 	/// Checks the current corridor path to see if its polygon references remain valid. 
 	///  @param[in]		maxLookAhead	The number of polygons from the beginning of the corridor to search.
@@ -95,6 +151,22 @@ public:
 	/// @return Returns true if move succeeded.
 	bool movePosition(const float* npos, dtNavMeshQuery* navquery, const dtQueryFilter* filter);
 
+	/// Prepares a move of the position for #dtNavMeshQuery::moveAlongSurfaceBatch.
+	/// The processed move is applied with #applyMovePosition.
+	///  @param[in]		npos		The desired new position. [(x, y, z)]
+	///  @param[in]		filter		The filter to apply to the operation.
+	///  @param[in]		visited		The buffer for the polygons visited by the move. [Size: >= @p maxVisited]
+	///  @param[in]		maxVisited	The size of the visited buffer. [Limit: > 0]
+	///  @param[out]	move		The move to process.
+	void initMovePosition(const float* npos, const dtQueryFilter* filter,
+						  dtPolyRef* visited, const int maxVisited, dtSurfaceMove* move) const;
+
+	/// Applies a move prepared with #initMovePosition, adjusting the corridor the same way as #movePosition.
+	///  @param[in]		move		The processed move.
+	///  @param[in]		navquery	The query object used to build the corridor.
+	/// @return Returns true if move succeeded.
+	bool applyMovePosition(const dtSurfaceMove* move, dtNavMeshQuery* navquery);
+
 	/// Moves the target from the curent location to the desired location, adjusting the corridor
 	/// as needed to reflect the change. 
 	///  @param[in]		npos		The desired new target position. [(x, y, z)]
@@ -133,6 +205,9 @@ public:
 	/// @return The number of polygons in the current corridor path.
 	inline int getPathCount() const { return m_npath; }
 
+	/// Gets the memory allocated by the corridor, not including the object itself. [Units: bytes]
+	size_t getMemUsed() const;
+
 private:
 	// Explicitly disabled copy constructor and copy assignment operator.
 	dtPathCorridor(const dtPathCorridor&);
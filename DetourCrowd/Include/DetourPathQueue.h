@@ -21,11 +21,21 @@
 
 #include "DetourNavMesh.h"
 #include "DetourNavMeshQuery.h"
+#include "DetourJobDispatcher.h"
+#include "DetourPathCache.h"
 
 static const unsigned int DT_PATHQ_INVALID = 0;
 
 typedef unsigned int dtPathQueueRef;
 
+/// The latency of a path request, measured in path queue updates.
+struct dtPathQueueRequestStats
+{
+	int waitUpdates;		///< The number of updates the request waited before its search started.
+	int searchUpdates;		///< The number of updates the search ran in.
+	int iterations;			///< The number of search iterations used.
+};
+
 class dtPathQueue
 {
 	struct PathQuery
@@ -41,35 +51,113 @@ class dtPathQueue
 		dtStatus status;
 		int keepAlive;
 		const dtQueryFilter* filter; ///< TODO: This is potentially dangerous!
+		/// Scheduling.
+		unsigned char priority;
+		unsigned int order;
+		int search;
+		/// Statistics.
+		dtPathQueueRequestStats stats;
+		/// The navigation mesh generation when the search started.
+		unsigned int generation;
+		/// True if the result should be stored to the path cache.
+		bool storeResult;
 	};
 	
-	static const int MAX_QUEUE = 8;
-	PathQuery m_queue[MAX_QUEUE];
+	PathQuery* m_queue;
+	int m_maxQueue;
 	dtPathQueueRef m_nextHandle;
+	unsigned int m_nextOrder;
 	int m_maxPathSize;
-	int m_queueHead;
+	dtAllocator* m_allocator;
 	dtNavMeshQuery* m_navquery;
+
+	dtJobDispatcher* m_dispatcher;
+	int m_searchCount;
+	dtNavMeshQuery** m_searchQueries;	///< The queries of the concurrent searches, the first one is #m_navquery. [Size: #m_searchCount]
+	int* m_searchJobs;					///< The requests to update, per search. [Size: #m_searchCount * #m_maxQueue]
+	int* m_searchJobCounts;				///< The number of requests to update, per search. [Size: #m_searchCount]
+	int* m_searchIters;					///< The number of iterations done in the last update, per search. [Size: #m_searchCount]
+	int* m_pending;						///< Scratch list of the requests waiting to start. [Size: #m_maxQueue]
+	int m_maxIters;
+	const dtTimeBudget* m_budget;
+	dtPathCache m_cache;
 	
 	void purge();
+	void purgeSearches();
+	void updateSearches();
+	void updateSearch(const int search);
+	static void runUpdateJob(void* userData, const int jobIndex, const int workerIndex);
 	
 public:
 	dtPathQueue();
 	~dtPathQueue();
 	
-	bool init(const int maxPathSize, const int maxSearchNodeCount, dtNavMesh* nav);
+	/// Initializes the queue.
+	///  @param[in]		maxPathSize			The maximum number of polygons in a path result.
+	///  @param[in]		maxSearchNodeCount	The maximum number of search nodes of a query.
+	///  @param[in]		nav					The navigation mesh to search.
+	///  @param[in]		maxRequests			The maximum number of requests the queue can hold. [Limit: > 0]
+	///  @param[in]		maxSearches			The number of requests that are searched at the same time,
+	///  									each with its own query and iteration budget. [Limit: > 0]
+	///  @param[in]		allocator			The allocator of the queue memory. [opt]
+	/// @return True if the initialization succeeded.
+	bool init(const int maxPathSize, const int maxSearchNodeCount, dtNavMesh* nav,
+			  const int maxRequests = 8, const int maxSearches = 1, dtAllocator* allocator = 0);
+
+	/// Sets the dispatcher used to run the searches on several workers.
+	///  @param[in]		dispatcher	The dispatcher, or null to run the searches serially. Must stay valid while set.
+	inline void setJobDispatcher(dtJobDispatcher* dispatcher) { m_dispatcher = dispatcher; }
 	
+	/// Enables caching of the complete paths found by the queue.
+	///  @param[in]		maxPaths	The maximum number of cached paths. Zero to disable the cache.
+	/// @return True if the cache was allocated.
+	bool initPathCache(const int maxPaths);
+
+	/// Gets the cache of the paths found by the queue.
+	inline const dtPathCache* getPathCache() const { return &m_cache; }
+
+	/// Updates the searches of the queued requests.
+	///  @param[in]		maxIters	The maximum number of search iterations, per search.
 	void update(const int maxIters);
+
+	/// Updates the searches of the queued requests until the time budget runs out.
+	///  @param[in]		budget		The time budget.
+	///  @param[out]	doneIters	The number of search iterations completed. [opt]
+	void update(const dtTimeBudget& budget, int* doneIters = 0);
 	
+	/// Queues a path request.
+	///  @param[in]		priority	The priority class of the request. Requests with a lower value are started first.
+	/// @return The request reference, or #DT_PATHQ_INVALID if the queue is full.
 	dtPathQueueRef request(dtPolyRef startRef, dtPolyRef endRef,
 						   const float* startPos, const float* endPos, 
-						   const dtQueryFilter* filter);
+						   const dtQueryFilter* filter, const unsigned char priority = 0);
 	
 	dtStatus getRequestStatus(dtPathQueueRef ref) const;
+
+	/// Gets the latency of a request. Must be called before the result is read with #getPathResult.
+	///  @param[in]		ref			The request reference.
+	///  @param[out]	stats		The request statistics.
+	/// @return The status flags for the operation.
+	dtStatus getRequestStats(dtPathQueueRef ref, dtPathQueueRequestStats* stats) const;
 	
 	dtStatus getPathResult(dtPathQueueRef ref, dtPolyRef* path, int* pathSize, const int maxPath);
 	
 	inline const dtNavMeshQuery* getNavQuery() const { return m_navquery; }
 
+	/// Gets the work done by the searches of the queue, summed over all search queries.
+	///  @param[out]	stats		The query statistics. (See: #DT_QUERY_STATS)
+	void getQueryStats(dtQueryStats* stats) const;
+
+	/// Resets the query statistics of all search queries.
+	void resetQueryStats();
+
+	/// The maximum number of requests the queue can hold.
+	inline int getMaxRequests() const { return m_maxQueue; }
+
+	/// Gets the memory allocated by the queue, including its queries and path cache,
+	/// not including the queue object itself. [Units: bytes]
+	size_t getMemUsed() const;
+
 private:
 	// Explicitly disabled copy constructor and copy assignment operator.
 	dtPathQueue(const dtPathQueue&);
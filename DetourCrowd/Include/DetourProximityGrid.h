@@ -19,23 +19,33 @@
 #ifndef DETOURPROXIMITYGRID_H
 #define DETOURPROXIMITYGRID_H
 
+#include "DetourAlloc.h"
+
+/// A uniform grid for finding items close to each other.
+///
+/// The items are added between #clear and #build. #build sorts them by cell
+/// with a counting sort, after which the items of consecutive cells on a row
+/// are stored next to each other.
 class dtProximityGrid
 {
+	dtAllocator* m_allocator;
 	float m_cellSize;
 	float m_invCellSize;
 	
 	struct Item
 	{
-		unsigned short id;
-		short x,y;
-		unsigned short next;
+		unsigned int id;
+		int x,y;
 	};
 	Item* m_pool;
 	int m_poolHead;
 	int m_poolSize;
-	
-	unsigned short* m_buckets;
-	int m_bucketsSize;
+
+	unsigned int* m_ids;		///< The item ids sorted by cell. [Size: m_poolSize]
+	int* m_cellStarts;			///< The first item of each cell, row by row. [Size: m_maxCells + 1]
+	int m_maxCells;
+	int m_width;				///< The number of cells in a row.
+	int m_shift;				///< Cells are coarsened by 2^shift when the items do not fit the grid.
 	
 	int m_bounds[4];
 	
@@ -43,22 +53,55 @@ public:
 	dtProximityGrid();
 	~dtProximityGrid();
 	
-	bool init(const int poolSize, const float cellSize);
+	/// Initializes the grid.
+	///  @param[in]		poolSize	The maximum number of item cells. An item is stored in each cell it overlaps.
+	///  @param[in]		cellSize	The size of the grid cells.
+	///  @param[in]		allocator	The allocator of the grid memory. [opt]
+	/// @return True if the initialization succeeded.
+	bool init(const int poolSize, const float cellSize, dtAllocator* allocator = 0);
 	
+	/// Removes all the items.
 	void clear();
 	
-	void addItem(const unsigned short id,
+	/// Adds an item covering the cells overlapped by the bounds.
+	/// The item is not found by the queries before #build is called.
+	void addItem(const unsigned int id,
 				 const float minx, const float miny,
 				 const float maxx, const float maxy);
+
+	/// Sorts the added items by cell.
+	void build();
 	
+	/// Finds the unique items in the cells overlapped by the bounds.
+	/// @return The number of items found.
 	int queryItems(const float minx, const float miny,
 				   const float maxx, const float maxy,
-				   unsigned short* ids, const int maxIds) const;
+				   unsigned int* ids, const int maxIds) const;
+
+	/// Gets the cells overlapped by the bounds, clamped to the grid.
+	///  @param[out]	cells	The overlapped cells. [(minx, miny, maxx, maxy)]
+	/// @return False if no cell is overlapped.
+	bool getCellRange(const float minx, const float miny,
+					  const float maxx, const float maxy, int* cells) const;
+
+	/// Gets the items of a run of cells on a row. An item overlapping more than
+	/// one of the cells is returned once for each cell.
+	///  @param[in]		minx	The first cell of the run, see #getCellRange.
+	///  @param[in]		maxx	The last cell of the run.
+	///  @param[in]		y		The row of the cells.
+	///  @param[out]	count	The number of items returned.
+	/// @return The item ids. [Size: @p count]
+	const unsigned int* getRowItems(const int minx, const int maxx, const int y, int& count) const;
 	
 	int getItemCountAt(const int x, const int y) const;
 	
+	/// The bounds of the grid in cells, valid after #build.
 	inline const int* getBounds() const { return m_bounds; }
-	inline float getCellSize() const { return m_cellSize; }
+	/// The size of the grid cells, larger than the initial size if the cells were coarsened.
+	inline float getCellSize() const { return m_cellSize * (float)(1 << m_shift); }
+
+	/// Gets the memory allocated by the grid, not including the object itself. [Units: bytes]
+	size_t getMemUsed() const;
 
 private:
 	// Explicitly disabled copy constructor and copy assignment operator.
@@ -71,4 +114,3 @@ void dtFreeProximityGrid(dtProximityGrid* ptr);
 
 
 #endif // DETOURPROXIMITYGRID_H
-
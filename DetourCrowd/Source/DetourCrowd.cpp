@@ -49,28 +49,162 @@ static const int MAX_ITERS_PER_UPDATE = 100;
 
 static const int MAX_PATHQUEUE_NODES = 4096;
 static const int MAX_COMMON_NODES = 512;
+static const int MAX_FLOW_FIELD_POLYS = 4096;
+
+// Adds the time since the start of the stage to its total, and starts the next stage.
+static void lapTime(dtTimeFunc getTime, double& total, double& start)
+{
+	if (!getTime)
+		return;
+	const double now = getTime();
+	total += now - start;
+	start = now;
+}
 
 inline float tween(const float t, const float t0, const float t1)
 {
 	return dtClamp((t-t0) / (t1-t0), 0.0f, 1.0f);
 }
 
-static void integrate(dtCrowdAgent* ag, const float dt)
+// What the collision stages do with an agent, see dtCrowdKinematics::flags.
+enum dtCrowdKinematicsFlags
 {
-	// Fake dynamic constraint.
-	const float maxDelta = ag->params.maxAcceleration * dt;
-	float dv[3];
-	dtVsub(dv, ag->nvel, ag->vel);
-	float ds = dtVlen(dv);
-	if (ds > maxDelta)
-		dtVscale(dv, dv, maxDelta/ds);
-	dtVadd(ag->vel, ag->vel, dv);
-	
-	// Integrate
-	if (dtVlen(ag->vel) > 0.0001f)
-		dtVmad(ag->npos, ag->npos, ag->vel, dt);
-	else
-		dtVset(ag->vel,0,0,0);
+	DT_KINEMATICS_WALKING = 1,		///< The agent is displaced and moved along the navmesh.
+	DT_KINEMATICS_INTEGRATE = 2,	///< The velocity is integrated, else it is zeroed.
+	DT_KINEMATICS_COLLIDE = 4,		///< The agent is separated from its neighbours.
+};
+
+/// The number of float arrays of the kinematic state.
+static const int NUM_KINEMATICS_ARRAYS = 15;
+
+static bool allocKinematics(dtCrowdKinematics& kin, const int maxAgents, dtAllocator* allocator)
+{
+	kin.mem = (float*)allocator->alloc(sizeof(float)*NUM_KINEMATICS_ARRAYS*maxAgents, DT_ALLOC_PERM);
+	kin.flags = (unsigned char*)allocator->alloc(sizeof(unsigned char)*maxAgents, DT_ALLOC_PERM);
+	if (!kin.mem || !kin.flags)
+		return false;
+	float* arrays[NUM_KINEMATICS_ARRAYS];
+	for (int i = 0; i < NUM_KINEMATICS_ARRAYS; ++i)
+		arrays[i] = kin.mem + i*maxAgents;
+	kin.px = arrays[0];
+	kin.py = arrays[1];
+	kin.pz = arrays[2];
+	kin.vx = arrays[3];
+	kin.vy = arrays[4];
+	kin.vz = arrays[5];
+	kin.nvx = arrays[6];
+	kin.nvy = arrays[7];
+	kin.nvz = arrays[8];
+	kin.dvx = arrays[9];
+	kin.dvz = arrays[10];
+	kin.dispx = arrays[11];
+	kin.dispz = arrays[12];
+	kin.radius = arrays[13];
+	kin.maxAcceleration = arrays[14];
+	return true;
+}
+
+static void freeKinematics(dtCrowdKinematics& kin, dtAllocator* allocator)
+{
+	allocator->free(kin.mem);
+	allocator->free(kin.flags);
+	memset(&kin, 0, sizeof(kin));
+}
+
+// Copies the kinematic state of the agents to the arrays.
+static void gatherKinematics(dtCrowdKinematics& kin, dtCrowdAgent** agents, const int first, const int last)
+{
+	for (int i = first; i < last; ++i)
+	{
+		const dtCrowdAgent* ag = agents[i];
+		kin.px[i] = ag->npos[0];
+		kin.py[i] = ag->npos[1];
+		kin.pz[i] = ag->npos[2];
+		kin.vx[i] = ag->vel[0];
+		kin.vy[i] = ag->vel[1];
+		kin.vz[i] = ag->vel[2];
+		kin.nvx[i] = ag->nvel[0];
+		kin.nvy[i] = ag->nvel[1];
+		kin.nvz[i] = ag->nvel[2];
+		kin.dvx[i] = ag->dvel[0];
+		kin.dvz[i] = ag->dvel[2];
+		kin.dispx[i] = 0;
+		kin.dispz[i] = 0;
+		kin.radius[i] = ag->params.radius;
+		kin.maxAcceleration[i] = ag->params.maxAcceleration;
+
+		unsigned char flags = 0;
+		if (ag->state == DT_CROWDAGENT_STATE_WALKING)
+		{
+			flags = DT_KINEMATICS_WALKING;
+			if (ag->params.lod != DT_CROWDAGENT_LOD_FROZEN)
+				flags |= DT_KINEMATICS_INTEGRATE;
+			if (ag->params.lod < DT_CROWDAGENT_LOD_CORRIDOR)
+				flags |= DT_KINEMATICS_COLLIDE;
+		}
+		kin.flags[i] = flags;
+	}
+}
+
+// Copies the position and the velocity of the walking agents back from the arrays.
+static void scatterKinematics(const dtCrowdKinematics& kin, dtCrowdAgent** agents, const int first, const int last)
+{
+	for (int i = first; i < last; ++i)
+	{
+		if (!(kin.flags[i] & DT_KINEMATICS_WALKING))
+			continue;
+		dtCrowdAgent* ag = agents[i];
+		dtVset(ag->npos, kin.px[i], kin.py[i], kin.pz[i]);
+		dtVset(ag->vel, kin.vx[i], kin.vy[i], kin.vz[i]);
+		dtVset(ag->disp, kin.dispx[i], 0, kin.dispz[i]);
+	}
+}
+
+static void integrate(dtCrowdKinematics& kin, const int first, const int last, const float dt)
+{
+	for (int i = first; i < last; ++i)
+	{
+		const unsigned char flags = kin.flags[i];
+		if (!(flags & DT_KINEMATICS_WALKING))
+			continue;
+		if (!(flags & DT_KINEMATICS_INTEGRATE))
+		{
+			kin.vx[i] = kin.vy[i] = kin.vz[i] = 0;
+			continue;
+		}
+
+		// Fake dynamic constraint.
+		const float maxDelta = kin.maxAcceleration[i] * dt;
+		float dvx = kin.nvx[i] - kin.vx[i];
+		float dvy = kin.nvy[i] - kin.vy[i];
+		float dvz = kin.nvz[i] - kin.vz[i];
+		const float ds = dtMathSqrtf(dvx*dvx + dvy*dvy + dvz*dvz);
+		if (ds > maxDelta)
+		{
+			const float s = maxDelta/ds;
+			dvx *= s;
+			dvy *= s;
+			dvz *= s;
+		}
+		const float vx = kin.vx[i] + dvx;
+		const float vy = kin.vy[i] + dvy;
+		const float vz = kin.vz[i] + dvz;
+
+		// Integrate
+		if (dtMathSqrtf(vx*vx + vy*vy + vz*vz) > 0.0001f)
+		{
+			kin.vx[i] = vx;
+			kin.vy[i] = vy;
+			kin.vz[i] = vz;
+			kin.px[i] += vx*dt;
+			kin.py[i] += vy*dt;
+			kin.pz[i] += vz*dt;
+		}
+		else
+		{
+			kin.vx[i] = kin.vy[i] = kin.vz[i] = 0;
+		}
+	}
 }
 
 static bool overOffmeshConnection(const dtCrowdAgent* ag, const float radius)
@@ -184,18 +318,11 @@ static int addNeighbour(const int idx, const float dist,
 	return dtMin(nneis+1, maxNeis);
 }
 
-static int getNeighbours(const float* pos, const float height, const float range,
-						 const dtCrowdAgent* skip, dtCrowdNeighbour* result, const int maxResult,
-						 dtCrowdAgent** agents, const int /*nagents*/, dtProximityGrid* grid)
+// Adds the candidate agents that are within range to the neighbours sorted by distance.
+static int filterNeighbours(const float* pos, const float height, const float range,
+							const dtCrowdAgent* skip, const unsigned int* ids, const int nids,
+							dtCrowdNeighbour* result, int n, const int maxResult, dtCrowdAgent** agents)
 {
-	int n = 0;
-	
-	static const int MAX_NEIS = 32;
-	unsigned short ids[MAX_NEIS];
-	int nids = grid->queryItems(pos[0]-range, pos[2]-range,
-								pos[0]+range, pos[2]+range,
-								ids, MAX_NEIS);
-	
 	for (int i = 0; i < nids; ++i)
 	{
 		const dtCrowdAgent* ag = agents[ids[i]];
@@ -212,7 +339,28 @@ static int getNeighbours(const float* pos, const float height, const float range
 		if (distSqr > dtSqr(range))
 			continue;
 		
-		n = addNeighbour(ids[i], distSqr, result, n, maxResult);
+		n = addNeighbour((int)ids[i], distSqr, result, n, maxResult);
+	}
+	return n;
+}
+
+static int getNeighbours(const float* pos, const float height, const float range,
+						 const dtCrowdAgent* skip, dtCrowdNeighbour* result, const int maxResult,
+						 dtCrowdAgent** agents, const int /*nagents*/, const dtProximityGrid* grid)
+{
+	int n = 0;
+
+	// The agents are added to the grid as points, so each agent is found once,
+	// and the items of each row of cells are next to each other.
+	int cells[4];
+	if (!grid->getCellRange(pos[0]-range, pos[2]-range, pos[0]+range, pos[2]+range, cells))
+		return 0;
+	
+	for (int y = cells[1]; y <= cells[3]; ++y)
+	{
+		int nids = 0;
+		const unsigned int* ids = grid->getRowItems(cells[0], cells[2], y, nids);
+		n = filterNeighbours(pos, height, range, skip, ids, nids, result, n, maxResult, agents);
 	}
 	return n;
 }
@@ -253,15 +401,23 @@ static int addToOptQueue(dtCrowdAgent* newag, dtCrowdAgent** agents, const int n
 	return dtMin(nagents+1, maxAgents);
 }
 
+// Agents with a higher path priority go first, then the ones that have waited the longest.
+static bool isPathRequestBefore(const dtCrowdAgent* a, const dtCrowdAgent* b)
+{
+	if (a->params.pathPriority != b->params.pathPriority)
+		return a->params.pathPriority < b->params.pathPriority;
+	return a->targetReplanTime > b->targetReplanTime;
+}
+
 static int addToPathQueue(dtCrowdAgent* newag, dtCrowdAgent** agents, const int nagents, const int maxAgents)
 {
-	// Insert neighbour based on greatest time.
+	// Insert neighbour based on priority and greatest time.
 	int slot = 0;
 	if (!nagents)
 	{
 		slot = nagents;
 	}
-	else if (newag->targetReplanTime <= agents[nagents-1]->targetReplanTime)
+	else if (!isPathRequestBefore(newag, agents[nagents-1]))
 	{
 		if (nagents >= maxAgents)
 			return nagents;
@@ -271,7 +427,7 @@ static int addToPathQueue(dtCrowdAgent* newag, dtCrowdAgent** agents, const int
 	{
 		int i;
 		for (i = 0; i < nagents; ++i)
-			if (newag->targetReplanTime >= agents[i]->targetReplanTime)
+			if (!isPathRequestBefore(agents[i], newag))
 				break;
 		
 		const int tgt = i+1;
@@ -329,18 +485,51 @@ Notes:
 */
 
 dtCrowd::dtCrowd() :
+	m_allocator(dtGetDefaultAllocator()),
 	m_maxAgents(0),
 	m_agents(0),
 	m_activeAgents(0),
+	m_activeList(0),
+	m_activeCount(0),
+	m_activeIndices(0),
+	m_freeList(0),
+	m_freeCount(0),
 	m_agentAnims(0),
+	m_neighbours(0),
+	m_maxNeighbours(0),
+	m_boundaryUpdates(0),
+	m_maxBoundarySegments(0),
 	m_obstacleQuery(0),
 	m_grid(0),
+	m_clusterSize(0),
+	m_clusterAgents(0),
+	m_clusterStarts(0),
+	m_clusterCount(0),
+	m_clusterCandidates(0),
+	m_offMeshTable(0),
 	m_pathResult(0),
 	m_maxPathResult(0),
+	m_pathQueueAgents(0),
 	m_maxAgentRadius(0),
 	m_velocitySampleCount(0),
-	m_navquery(0)
+	m_updateFrame(0),
+	m_lodUpdateInterval(4),
+	m_sleepDelay(1.0f),
+	m_topologyOptQueue(0),
+	m_topologyOptMaxAgents(1),
+	m_topologyOptInterval(0.5f),
+	m_navquery(0),
+	m_dispatcher(0),
+	m_workerCount(0),
+	m_workerNavQueries(0),
+	m_workerObstacleQueries(0),
+	m_workerSampleCounts(0),
+	m_updateClock(0)
 {
+	memset(&m_kinematics, 0, sizeof(m_kinematics));
+	memset(m_validatedFilterFlags, 0, sizeof(m_validatedFilterFlags));
+	memset(&m_queryStats, 0, sizeof(m_queryStats));
+	memset(&m_updateTimes, 0, sizeof(m_updateTimes));
 }
 
 dtCrowd::~dtCrowd()
@@ -350,54 +539,132 @@ dtCrowd::~dtCrowd()
 
 void dtCrowd::purge()
 {
+	purgeWorkers();
+
 	for (int i = 0; i < m_maxAgents; ++i)
 		m_agents[i].~dtCrowdAgent();
-	dtFree(m_agents);
+	m_allocator->free(m_agents);
 	m_agents = 0;
 	m_maxAgents = 0;
 	
-	dtFree(m_activeAgents);
+	m_allocator->free(m_activeAgents);
 	m_activeAgents = 0;
 
-	dtFree(m_agentAnims);
+	m_allocator->free(m_activeList);
+	m_activeList = 0;
+	m_activeCount = 0;
+
+	m_allocator->free(m_activeIndices);
+	m_activeIndices = 0;
+
+	m_allocator->free(m_freeList);
+	m_freeList = 0;
+	m_freeCount = 0;
+
+	m_allocator->free(m_topologyOptQueue);
+	m_topologyOptQueue = 0;
+
+	freeKinematics(m_kinematics, m_allocator);
+
+	m_allocator->free(m_agentAnims);
 	m_agentAnims = 0;
+
+	m_allocator->free(m_neighbours);
+	m_neighbours = 0;
+	m_maxNeighbours = 0;
+
+	m_allocator->free(m_boundaryUpdates);
+	m_boundaryUpdates = 0;
+	m_maxBoundarySegments = 0;
 	
-	dtFree(m_pathResult);
+	m_allocator->free(m_pathResult);
 	m_pathResult = 0;
+
+	m_allocator->free(m_pathQueueAgents);
+	m_pathQueueAgents = 0;
 	
-	dtFreeProximityGrid(m_grid);
+	dtFreeObject(m_allocator, m_grid);
 	m_grid = 0;
 
-	dtFreeObstacleAvoidanceQuery(m_obstacleQuery);
+	m_allocator->free(m_clusterAgents);
+	m_clusterAgents = 0;
+	m_allocator->free(m_clusterStarts);
+	m_clusterStarts = 0;
+	m_clusterCount = 0;
+	m_allocator->free(m_clusterCandidates);
+	m_clusterCandidates = 0;
+
+	dtFreeObject(m_allocator, m_obstacleQuery);
 	m_obstacleQuery = 0;
 	
-	dtFreeNavMeshQuery(m_navquery);
+	dtFreeObject(m_allocator, m_navquery);
 	m_navquery = 0;
 }
 
+void dtCrowd::purgeWorkers()
+{
+	// The first worker uses the crowd's own queries.
+	for (int i = 1; i < m_workerCount; ++i)
+	{
+		dtFreeObject(m_allocator, m_workerNavQueries[i]);
+		dtFreeObject(m_allocator, m_workerObstacleQueries[i]);
+	}
+	m_allocator->free(m_workerNavQueries);
+	m_workerNavQueries = 0;
+	m_allocator->free(m_workerObstacleQueries);
+	m_workerObstacleQueries = 0;
+	m_allocator->free(m_workerSampleCounts);
+	m_workerSampleCounts = 0;
+	m_workerCount = 0;
+	m_dispatcher = 0;
+
+	// Back to the candidates of a single worker.
+	if (m_clusterCandidates)
+	{
+		m_allocator->free(m_clusterCandidates);
+		m_clusterCandidates = (unsigned int*)m_allocator->alloc(sizeof(unsigned int)*m_maxAgents, DT_ALLOC_PERM);
+	}
+}
+
 /// @par
 ///
 /// May be called more than once to purge and re-initialize the crowd.
-bool dtCrowd::init(const int maxAgents, const float maxAgentRadius, dtNavMesh* nav)
+bool dtCrowd::init(const int maxAgents, const float maxAgentRadius, dtNavMesh* nav,
+				   const int maxPathRequests, const int maxPathSearches, const int maxNeighbours,
+				   const int maxBoundarySegments, const int maxBoundaryPolys, dtAllocator* allocator)
 {
 	purge();
+	m_allocator = allocator ? allocator : dtGetDefaultAllocator();
+
+	if (maxNeighbours < 1 || maxNeighbours > 255)
+		return false;
+	if (maxBoundarySegments < 1 || maxBoundaryPolys < 1)
+		return false;
 	
 	m_maxAgents = maxAgents;
 	m_maxAgentRadius = maxAgentRadius;
+	m_maxNeighbours = maxNeighbours;
+	m_maxBoundarySegments = maxBoundarySegments;
 
 	// Larger than agent radius because it is also used for agent recovery.
 	dtVset(m_agentPlacementHalfExtents, m_maxAgentRadius*2.0f, m_maxAgentRadius*1.5f, m_maxAgentRadius*2.0f);
 	
-	m_grid = dtAllocProximityGrid();
+	m_grid = dtAllocObject<dtProximityGrid>(m_allocator);
 	if (!m_grid)
 		return false;
-	if (!m_grid->init(m_maxAgents*4, maxAgentRadius*3))
+	if (!m_grid->init(m_maxAgents, maxAgentRadius*3, m_allocator))
+		return false;
+
+	m_clusterAgents = (int*)m_allocator->alloc(sizeof(int)*m_maxAgents, DT_ALLOC_PERM);
+	m_clusterStarts = (int*)m_allocator->alloc(sizeof(int)*(m_maxAgents+1), DT_ALLOC_PERM);
+	m_clusterCandidates = (unsigned int*)m_allocator->alloc(sizeof(unsigned int)*m_maxAgents, DT_ALLOC_PERM);
+	if (!m_clusterAgents || !m_clusterStarts || !m_clusterCandidates)
 		return false;
 	
-	m_obstacleQuery = dtAllocObstacleAvoidanceQuery();
+	m_obstacleQuery = dtAllocObject<dtObstacleAvoidanceQuery>(m_allocator);
 	if (!m_obstacleQuery)
 		return false;
-	if (!m_obstacleQuery->init(6, 8))
+	if (!m_obstacleQuery->init(m_maxNeighbours, m_maxBoundarySegments, m_allocator))
 		return false;
 
 	// Init obstacle query params.
@@ -419,22 +686,50 @@ bool dtCrowd::init(const int maxAgents, const float maxAgentRadius, dtNavMesh* n
 	
 	// Allocate temp buffer for merging paths.
 	m_maxPathResult = 256;
-	m_pathResult = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*m_maxPathResult, DT_ALLOC_PERM);
+	m_pathResult = (dtPolyRef*)m_allocator->alloc(sizeof(dtPolyRef)*m_maxPathResult, DT_ALLOC_PERM);
 	if (!m_pathResult)
 		return false;
 	
-	if (!m_pathq.init(m_maxPathResult, MAX_PATHQUEUE_NODES, nav))
+	if (!m_pathq.init(m_maxPathResult, MAX_PATHQUEUE_NODES, nav, maxPathRequests, maxPathSearches, m_allocator))
+		return false;
+	if (!m_flowField.init(nav, MAX_FLOW_FIELD_POLYS, m_allocator))
+		return false;
+	if (!m_snapshots.init(0, m_allocator))
+		return false;
+	m_pathQueueAgents = (dtCrowdAgent**)m_allocator->alloc(sizeof(dtCrowdAgent*)*maxPathRequests, DT_ALLOC_PERM);
+	if (!m_pathQueueAgents)
 		return false;
 	
-	m_agents = (dtCrowdAgent*)dtAlloc(sizeof(dtCrowdAgent)*m_maxAgents, DT_ALLOC_PERM);
+	m_agents = (dtCrowdAgent*)m_allocator->alloc(sizeof(dtCrowdAgent)*m_maxAgents, DT_ALLOC_PERM);
 	if (!m_agents)
 		return false;
 	
-	m_activeAgents = (dtCrowdAgent**)dtAlloc(sizeof(dtCrowdAgent*)*m_maxAgents, DT_ALLOC_PERM);
+	m_activeAgents = (dtCrowdAgent**)m_allocator->alloc(sizeof(dtCrowdAgent*)*m_maxAgents, DT_ALLOC_PERM);
 	if (!m_activeAgents)
 		return false;
 
-	m_agentAnims = (dtCrowdAgentAnimation*)dtAlloc(sizeof(dtCrowdAgentAnimation)*m_maxAgents, DT_ALLOC_PERM);
+	m_activeList = (int*)m_allocator->alloc(sizeof(int)*m_maxAgents, DT_ALLOC_PERM);
+	if (!m_activeList)
+		return false;
+	m_activeIndices = (int*)m_allocator->alloc(sizeof(int)*m_maxAgents, DT_ALLOC_PERM);
+	if (!m_activeIndices)
+		return false;
+	m_freeList = (int*)m_allocator->alloc(sizeof(int)*m_maxAgents, DT_ALLOC_PERM);
+	if (!m_freeList)
+		return false;
+	// The free agents are taken from the end of the list, lowest index first.
+	for (int i = 0; i < m_maxAgents; ++i)
+		m_freeList[i] = m_maxAgents-1 - i;
+	m_freeCount = m_maxAgents;
+	m_activeCount = 0;
+	m_topologyOptQueue = (dtCrowdAgent**)m_allocator->alloc(sizeof(dtCrowdAgent*)*m_maxAgents, DT_ALLOC_PERM);
+	if (!m_topologyOptQueue)
+		return false;
+	m_topologyOptMaxAgents = dtMin(m_topologyOptMaxAgents, m_maxAgents);
+	if (!allocKinematics(m_kinematics, m_maxAgents, m_allocator))
+		return false;
+
+	m_agentAnims = (dtCrowdAgentAnimation*)m_allocator->alloc(sizeof(dtCrowdAgentAnimation)*m_maxAgents, DT_ALLOC_PERM);
 	if (!m_agentAnims)
 		return false;
 	
@@ -442,31 +737,192 @@ bool dtCrowd::init(const int maxAgents, const float maxAgentRadius, dtNavMesh* n
 	{
 		new(&m_agents[i]) dtCrowdAgent();
 		m_agents[i].active = false;
-		if (!m_agents[i].corridor.init(m_maxPathResult))
+		m_agents[i].neis = 0;
+		m_agents[i].nneis = 0;
+		if (!m_agents[i].corridor.init(m_maxPathResult, m_allocator))
+			return false;
+		if (!m_agents[i].boundary.init(maxBoundarySegments, maxBoundaryPolys, m_allocator))
 			return false;
 	}
 
+	m_neighbours = (dtCrowdNeighbour*)m_allocator->alloc(sizeof(dtCrowdNeighbour)*m_maxAgents*m_maxNeighbours, DT_ALLOC_PERM);
+	if (!m_neighbours)
+		return false;
+	for (int i = 0; i < m_maxAgents; ++i)
+		m_agents[i].neis = &m_neighbours[i*m_maxNeighbours];
+
 	for (int i = 0; i < m_maxAgents; ++i)
 	{
 		m_agentAnims[i].active = false;
 	}
 
+	// Nearby agents share most of their boundary polygons, the cache is sized for
+	// a few unique polygons per agent and the rest are queried directly.
+	const int maxCachedPolys = dtMax(m_maxAgents*4, maxBoundaryPolys);
+	if (!m_wallSegmentCache.init(maxCachedPolys, maxCachedPolys*4, m_allocator))
+		return false;
+	m_boundaryUpdates = (unsigned char*)m_allocator->alloc(sizeof(unsigned char)*m_maxAgents, DT_ALLOC_PERM);
+	if (!m_boundaryUpdates)
+		return false;
+
 	// The navquery is mostly used for local searches, no need for large node pool.
-	m_navquery = dtAllocNavMeshQuery();
+	m_navquery = dtAllocObject<dtNavMeshQuery>(m_allocator);
 	if (!m_navquery)
 		return false;
-	if (dtStatusFailed(m_navquery->init(nav, MAX_COMMON_NODES)))
+	if (dtStatusFailed(m_navquery->init(nav, MAX_COMMON_NODES, 0, m_allocator)))
 		return false;
 	
 	return true;
 }
 
+/// @par
+///
+/// Each worker of the dispatcher gets its own navigation mesh query and
+/// obstacle avoidance query, which are allocated here. The path validity
+/// checks, move requests, topology optimization and the proximity grid
+/// are updated serially. The dispatcher is also used to run the path
+/// queue searches, see the @p maxPathSearches argument of #init.
+///
+/// The results are the same regardless of the number of workers.
+/// Within a stage each agent only modifies its own state, and it only reads
+/// state of the other agents that the stage does not modify.
+///
+/// Must be called again after #init.
+bool dtCrowd::setJobDispatcher(dtJobDispatcher* dispatcher)
+{
+	purgeWorkers();
+	if (!m_navquery)
+		return false;
+	m_pathq.setJobDispatcher(dispatcher);
+	if (!dispatcher)
+		return true;
+
+	const int workerCount = dtMax(1, dispatcher->getWorkerCount());
+	m_workerNavQueries = (dtNavMeshQuery**)m_allocator->alloc(sizeof(dtNavMeshQuery*)*workerCount, DT_ALLOC_PERM);
+	m_workerObstacleQueries = (dtObstacleAvoidanceQuery**)m_allocator->alloc(sizeof(dtObstacleAvoidanceQuery*)*workerCount, DT_ALLOC_PERM);
+	m_workerSampleCounts = (int*)m_allocator->alloc(sizeof(int)*workerCount, DT_ALLOC_PERM);
+	if (!m_workerNavQueries || !m_workerObstacleQueries || !m_workerSampleCounts)
+	{
+		purgeWorkers();
+		return false;
+	}
+	memset(m_workerNavQueries, 0, sizeof(dtNavMeshQuery*)*workerCount);
+	memset(m_workerObstacleQueries, 0, sizeof(dtObstacleAvoidanceQuery*)*workerCount);
+	m_workerCount = workerCount;
+
+	// Each worker gathers the neighbour candidates of its clusters in its own part of the buffer.
+	m_allocator->free(m_clusterCandidates);
+	m_clusterCandidates = (unsigned int*)m_allocator->alloc(sizeof(unsigned int)*m_maxAgents*workerCount, DT_ALLOC_PERM);
+	if (!m_clusterCandidates)
+	{
+		purgeWorkers();
+		return false;
+	}
+
+	m_workerNavQueries[0] = m_navquery;
+	m_workerObstacleQueries[0] = m_obstacleQuery;
+	for (int i = 1; i < m_workerCount; ++i)
+	{
+		m_workerNavQueries[i] = dtAllocObject<dtNavMeshQuery>(m_allocator);
+		m_workerObstacleQueries[i] = dtAllocObject<dtObstacleAvoidanceQuery>(m_allocator);
+		if (!m_workerNavQueries[i] || !m_workerObstacleQueries[i] ||
+			dtStatusFailed(m_workerNavQueries[i]->init(m_navquery->getAttachedNavMesh(), MAX_COMMON_NODES, 0, m_allocator)) ||
+			!m_workerObstacleQueries[i]->init(m_maxNeighbours, m_maxBoundarySegments, m_allocator))
+		{
+			purgeWorkers();
+			return false;
+		}
+	}
+
+	m_dispatcher = dispatcher;
+	return true;
+}
+
+/// @par
+///
+/// The sizes are computed from the capacities given to #init and
+/// #setJobDispatcher, the memory used by the crowd does not change
+/// while it is updated.
+void dtCrowd::getMemStats(dtCrowdMemStats* stats) const
+{
+	memset(stats, 0, sizeof(dtCrowdMemStats));
+
+	const size_t maxAgents = (size_t)m_maxAgents;
+	stats->agents = sizeof(dtCrowd);
+	if (m_agents)
+	{
+		stats->agents += sizeof(dtCrowdAgent)*maxAgents;
+		stats->agents += sizeof(dtCrowdAgent*)*maxAgents*2;	// Active agents and topology optimization queue.
+		stats->agents += sizeof(int)*maxAgents*3;				// Active list, active indices and free list.
+		stats->agents += sizeof(dtCrowdAgentAnimation)*maxAgents;
+		stats->agents += (sizeof(float)*NUM_KINEMATICS_ARRAYS + sizeof(unsigned char))*maxAgents;
+		stats->agents += sizeof(dtCrowdNeighbour)*maxAgents*(size_t)m_maxNeighbours;
+		stats->agents += sizeof(unsigned char)*maxAgents;		// Boundary updates.
+		stats->agents += sizeof(int)*(maxAgents*2+1);			// Cluster agents and starts.
+		stats->agents += sizeof(unsigned int)*maxAgents*(size_t)dtMax(m_workerCount, 1);	// Cluster candidates.
+		stats->agents += sizeof(dtPolyRef)*(size_t)m_maxPathResult;
+		stats->agents += sizeof(dtCrowdAgent*)*(size_t)m_pathq.getMaxRequests();
+		for (int i = 0; i < m_maxAgents; ++i)
+		{
+			stats->corridors += m_agents[i].corridor.getMemUsed();
+			stats->boundaries += m_agents[i].boundary.getMemUsed();
+		}
+	}
+	if (m_workerCount > 0)
+		stats->agents += (sizeof(dtNavMeshQuery*) + sizeof(dtObstacleAvoidanceQuery*) + sizeof(int))*(size_t)m_workerCount;
+
+	stats->boundaries += m_wallSegmentCache.getMemUsed();
+	if (m_grid)
+		stats->proximityGrid = sizeof(dtProximityGrid) + m_grid->getMemUsed();
+	stats->pathQueue = m_pathq.getMemUsed();
+
+	if (m_navquery)
+		stats->navQueries += m_navquery->getMemUsed();
+	if (m_obstacleQuery)
+		stats->obstacleAvoidance += sizeof(dtObstacleAvoidanceQuery) + m_obstacleQuery->getMemUsed();
+	for (int i = 1; i < m_workerCount; ++i)
+	{
+		if (m_workerNavQueries[i])
+			stats->navQueries += m_workerNavQueries[i]->getMemUsed();
+		if (m_workerObstacleQueries[i])
+			stats->obstacleAvoidance += sizeof(dtObstacleAvoidanceQuery) + m_workerObstacleQueries[i]->getMemUsed();
+	}
+
+	stats->flowField = m_flowField.getMemUsed();
+	stats->snapshots = m_snapshots.getMemUsed();
+
+	stats->total = stats->agents + stats->corridors + stats->boundaries + stats->proximityGrid +
+		stats->pathQueue + stats->navQueries + stats->obstacleAvoidance + stats->flowField + stats->snapshots;
+}
+
 void dtCrowd::setObstacleAvoidanceParams(const int idx, const dtObstacleAvoidanceParams* params)
 {
 	if (idx >= 0 && idx < DT_CROWD_MAX_OBSTAVOIDANCE_PARAMS)
 		memcpy(&m_obstacleQueryParams[idx], params, sizeof(dtObstacleAvoidanceParams));
 }
 
+void dtCrowd::setLODUpdateInterval(const int frames)
+{
+	m_lodUpdateInterval = dtMax(frames, 1);
+}
+
+void dtCrowd::setSleepDelay(const float delay)
+{
+	m_sleepDelay = dtMax(delay, 0.0f);
+}
+
+void dtCrowd::setClusterSize(const float size)
+{
+	m_clusterSize = dtMax(size, 0.0f);
+	m_clusterCount = 0;
+}
+
+void dtCrowd::setTopologyOptimizationBudget(const int maxAgents, const float interval)
+{
+	m_topologyOptMaxAgents = dtClamp(maxAgents, 1, dtMax(m_maxAgents, 1));
+	m_topologyOptInterval = dtMax(interval, 0.0f);
+}
+
 const dtObstacleAvoidanceParams* dtCrowd::getObstacleAvoidanceParams(const int idx) const
 {
 	if (idx >= 0 && idx < DT_CROWD_MAX_OBSTAVOIDANCE_PARAMS)
@@ -503,6 +959,7 @@ void dtCrowd::updateAgentParameters(const int idx, const dtCrowdAgentParams* par
 	if (idx < 0 || idx >= m_maxAgents)
 		return;
 	memcpy(&m_agents[idx].params, params, sizeof(dtCrowdAgentParams));
+	wakeAgent(&m_agents[idx]);
 }
 
 /// @par
@@ -510,18 +967,10 @@ void dtCrowd::updateAgentParameters(const int idx, const dtCrowdAgentParams* par
 /// The agent's position will be constrained to the surface of the navigation mesh.
 int dtCrowd::addAgent(const float* pos, const dtCrowdAgentParams* params)
 {
-	// Find empty slot.
-	int idx = -1;
-	for (int i = 0; i < m_maxAgents; ++i)
-	{
-		if (!m_agents[i].active)
-		{
-			idx = i;
-			break;
-		}
-	}
-	if (idx == -1)
+	// Take a free slot.
+	if (!m_freeCount)
 		return -1;
+	const int idx = m_freeList[--m_freeCount];
 	
 	dtCrowdAgent* ag = &m_agents[idx];		
 
@@ -541,9 +990,12 @@ int dtCrowd::addAgent(const float* pos, const dtCrowdAgentParams* params)
 	ag->corridor.reset(ref, nearest);
 	ag->boundary.reset();
 	ag->partial = false;
+	ag->pathGeneration = 0;
+	ag->pathChanged = true;
 
 	ag->topologyOptTime = 0;
 	ag->targetReplanTime = 0;
+	ag->idleTime = 0;
 	ag->nneis = 0;
 	
 	dtVset(ag->dvel, 0,0,0);
@@ -561,6 +1013,8 @@ int dtCrowd::addAgent(const float* pos, const dtCrowdAgentParams* params)
 	ag->targetState = DT_CROWDAGENT_TARGET_NONE;
 	
 	ag->active = true;
+	m_activeIndices[idx] = m_activeCount;
+	m_activeList[m_activeCount++] = idx;
 
 	return idx;
 }
@@ -571,9 +1025,16 @@ int dtCrowd::addAgent(const float* pos, const dtCrowdAgentParams* params)
 /// is not removed from the pool.  It is marked as inactive so that it is available for reuse.
 void dtCrowd::removeAgent(const int idx)
 {
-	if (idx >= 0 && idx < m_maxAgents)
+	if (idx >= 0 && idx < m_maxAgents && m_agents[idx].active)
 	{
 		m_agents[idx].active = false;
+
+		// Move the last active agent to the place of the removed one.
+		const int pos = m_activeIndices[idx];
+		const int last = m_activeList[--m_activeCount];
+		m_activeList[pos] = last;
+		m_activeIndices[last] = pos;
+		m_freeList[m_freeCount++] = idx;
 	}
 }
 
@@ -593,6 +1054,7 @@ bool dtCrowd::requestMoveTargetReplan(const int idx, dtPolyRef ref, const float*
 		ag->targetState = DT_CROWDAGENT_TARGET_REQUESTING;
 	else
 		ag->targetState = DT_CROWDAGENT_TARGET_FAILED;
+	ag->pathChanged = true;
 	
 	return true;
 }
@@ -622,10 +1084,72 @@ bool dtCrowd::requestMoveTarget(const int idx, dtPolyRef ref, const float* pos)
 		ag->targetState = DT_CROWDAGENT_TARGET_REQUESTING;
 	else
 		ag->targetState = DT_CROWDAGENT_TARGET_FAILED;
+	ag->pathChanged = true;
+	wakeAgent(ag);
 
 	return true;
 }
 
+/// @par
+///
+/// All of the agents share one search outwards from the target, and take their
+/// path by following it back to the target. The search covers a circle around
+/// the target reaching twice as far as the farthest agent. Agents outside of it,
+/// agents using a different query filter than the first agent, and agents
+/// whose path would not fit their corridor are given a regular move request.
+///
+/// The paths are set immediately, the other requests are processed during the next #update().
+int dtCrowd::requestMoveTargetGroup(const int* idx, const int count, dtPolyRef ref, const float* pos)
+{
+	if (!idx || count <= 0 || !ref)
+		return -1;
+	for (int i = 0; i < count; ++i)
+	{
+		if (idx[i] < 0 || idx[i] >= m_maxAgents)
+			return -1;
+	}
+
+	const unsigned char filterType = m_agents[idx[0]].params.queryFilterType;
+	float maxDistSqr = 0;
+	for (int i = 0; i < count; ++i)
+		maxDistSqr = dtMax(maxDistSqr, dtVdist2DSqr(m_agents[idx[i]].npos, pos));
+	const float radius = 2.0f*dtMathSqrtf(maxDistSqr);
+	if (dtStatusFailed(m_flowField.build(ref, pos, radius, &m_filters[filterType])))
+		return -1;
+
+	int nfound = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		dtCrowdAgent* ag = &m_agents[idx[i]];
+		wakeAgent(ag);
+		int npath = 0;
+		if (ag->active && ag->state == DT_CROWDAGENT_STATE_WALKING &&
+			ag->params.queryFilterType == filterType)
+		{
+			npath = m_flowField.getPath(ag->corridor.getFirstPoly(), m_pathResult, m_maxPathResult);
+		}
+		if (!npath)
+		{
+			requestMoveTarget(idx[i], ref, pos);
+			continue;
+		}
+
+		ag->targetRef = ref;
+		dtVcopy(ag->targetPos, pos);
+		ag->targetPathqRef = DT_PATHQ_INVALID;
+		ag->targetReplan = false;
+		ag->targetState = DT_CROWDAGENT_TARGET_VALID;
+		ag->targetReplanTime = 0.0;
+		ag->corridor.setCorridor(pos, m_pathResult, npath);
+		ag->pathChanged = true;
+		ag->boundary.reset();
+		ag->partial = false;
+		nfound++;
+	}
+
+	return nfound;
+}
+
 bool dtCrowd::requestMoveVelocity(const int idx, const float* vel)
 {
 	if (idx < 0 || idx >= m_maxAgents)
@@ -639,6 +1163,8 @@ bool dtCrowd::requestMoveVelocity(const int idx, const float* vel)
 	ag->targetPathqRef = DT_PATHQ_INVALID;
 	ag->targetReplan = false;
 	ag->targetState = DT_CROWDAGENT_TARGET_VELOCITY;
+	ag->pathChanged = true;
+	wakeAgent(ag);
 	
 	return true;
 }
@@ -657,35 +1183,31 @@ bool dtCrowd::resetMoveTarget(const int idx)
 	ag->targetPathqRef = DT_PATHQ_INVALID;
 	ag->targetReplan = false;
 	ag->targetState = DT_CROWDAGENT_TARGET_NONE;
+	ag->pathChanged = true;
+	wakeAgent(ag);
 	
 	return true;
 }
 
 int dtCrowd::getActiveAgents(dtCrowdAgent** agents, const int maxAgents)
 {
-	int n = 0;
-	for (int i = 0; i < m_maxAgents; ++i)
-	{
-		if (!m_agents[i].active) continue;
-		if (n < maxAgents)
-			agents[n++] = &m_agents[i];
-	}
+	const int n = dtMin(m_activeCount, maxAgents);
+	for (int i = 0; i < n; ++i)
+		agents[i] = &m_agents[m_activeList[i]];
 	return n;
 }
 
 
-void dtCrowd::updateMoveRequest(const float /*dt*/)
+void dtCrowd::updateMoveRequest(const float /*dt*/, const dtTimeBudget* pathBudget)
 {
-	const int PATH_MAX_AGENTS = 8;
-	dtCrowdAgent* queue[PATH_MAX_AGENTS];
+	const int PATH_MAX_AGENTS = m_pathq.getMaxRequests();
+	dtCrowdAgent** queue = m_pathQueueAgents;
 	int nqueue = 0;
 	
 	// Fire off new requests.
-	for (int i = 0; i < m_maxAgents; ++i)
+	for (int i = 0; i < m_activeCount; ++i)
 	{
-		dtCrowdAgent* ag = &m_agents[i];
-		if (!ag->active)
-			continue;
+		dtCrowdAgent* ag = &m_agents[m_activeList[i]];
 		if (ag->state == DT_CROWDAGENT_STATE_INVALID)
 			continue;
 		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
@@ -747,6 +1269,7 @@ void dtCrowd::updateMoveRequest(const float /*dt*/)
 			}
 
 			ag->corridor.setCorridor(reqPos, reqPath, reqPathCount);
+			ag->pathChanged = true;
 			ag->boundary.reset();
 			ag->partial = false;
 
@@ -772,23 +1295,25 @@ void dtCrowd::updateMoveRequest(const float /*dt*/)
 	{
 		dtCrowdAgent* ag = queue[i];
 		ag->targetPathqRef = m_pathq.request(ag->corridor.getLastPoly(), ag->targetRef,
-											 ag->corridor.getTarget(), ag->targetPos, &m_filters[ag->params.queryFilterType]);
+											 ag->corridor.getTarget(), ag->targetPos, &m_filters[ag->params.queryFilterType],
+											 ag->params.pathPriority);
 		if (ag->targetPathqRef != DT_PATHQ_INVALID)
 			ag->targetState = DT_CROWDAGENT_TARGET_WAITING_FOR_PATH;
 	}
 
 	
 	// Update requests.
-	m_pathq.update(MAX_ITERS_PER_UPDATE);
+	if (pathBudget)
+		m_pathq.update(*pathBudget);
+	else
+		m_pathq.update(MAX_ITERS_PER_UPDATE);
 
 	dtStatus status;
 
 	// Process path results.
-	for (int i = 0; i < m_maxAgents; ++i)
+	for (int i = 0; i < m_activeCount; ++i)
 	{
-		dtCrowdAgent* ag = &m_agents[i];
-		if (!ag->active)
-			continue;
+		dtCrowdAgent* ag = &m_agents[m_activeList[i]];
 		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
 			continue;
 		
@@ -886,6 +1411,7 @@ void dtCrowd::updateMoveRequest(const float /*dt*/)
 				{
 					// Set current corridor.
 					ag->corridor.setCorridor(targetPos, res, nres);
+					ag->pathChanged = true;
 					// Force to update boundary.
 					ag->boundary.reset();
 					ag->targetState = DT_CROWDAGENT_TARGET_VALID;
@@ -904,14 +1430,13 @@ void dtCrowd::updateMoveRequest(const float /*dt*/)
 }
 
 
-void dtCrowd::updateTopologyOptimization(dtCrowdAgent** agents, const int nagents, const float dt)
+void dtCrowd::updateTopologyOptimization(dtCrowdAgent** agents, const int nagents, const float dt,
+										 const dtTimeBudget* pathBudget)
 {
 	if (!nagents)
 		return;
 	
-	const float OPT_TIME_THR = 0.5f; // seconds
-	const int OPT_MAX_AGENTS = 1;
-	dtCrowdAgent* queue[OPT_MAX_AGENTS];
+	dtCrowdAgent** queue = m_topologyOptQueue;
 	int nqueue = 0;
 	
 	for (int i = 0; i < nagents; ++i)
@@ -924,41 +1449,109 @@ void dtCrowd::updateTopologyOptimization(dtCrowdAgent** agents, const int nagent
 		if ((ag->params.updateFlags & DT_CROWD_OPTIMIZE_TOPO) == 0)
 			continue;
 		ag->topologyOptTime += dt;
-		if (ag->topologyOptTime >= OPT_TIME_THR)
-			nqueue = addToOptQueue(ag, queue, nqueue, OPT_MAX_AGENTS);
+		if (ag->topologyOptTime >= m_topologyOptInterval)
+			nqueue = addToOptQueue(ag, queue, nqueue, m_topologyOptMaxAgents);
 	}
 
+	// The agents left over when the time budget runs out keep their wait time,
+	// so they are first in line in the next update.
 	for (int i = 0; i < nqueue; ++i)
 	{
+		if (pathBudget && i > 0 && dtTimeBudgetExpired(*pathBudget))
+			break;
 		dtCrowdAgent* ag = queue[i];
-		ag->corridor.optimizePathTopology(m_navquery, &m_filters[ag->params.queryFilterType]);
+		if (ag->corridor.optimizePathTopology(m_navquery, &m_filters[ag->params.queryFilterType]))
+			ag->pathChanged = true;
 		ag->topologyOptTime = 0;
 	}
 
 }
 
+// Returns true if a tile of the path or the target of the agent has changed since the path was validated.
+static bool isPathTileChanged(const dtNavMesh* nav, const dtCrowdAgent* ag)
+{
+	if ((int)(nav->getTileGeneration(ag->targetRef) - ag->pathGeneration) > 0)
+		return true;
+	const dtPolyRef* path = ag->corridor.getPath();
+	const int npath = ag->corridor.getPathCount();
+	for (int i = 0; i < npath; ++i)
+	{
+		if ((int)(nav->getTileGeneration(path[i]) - ag->pathGeneration) > 0)
+			return true;
+	}
+	return false;
+}
+
+/// @par
+///
+/// The path of an agent is only validated when the path or the target has changed,
+/// when its query filter flags have changed, or when a tile it passes through has
+/// changed. See dtNavMesh::getGeneration. Invalid polygons near the agent are first
+/// searched around locally, see dtPathCorridor::repairPath, and the path is only
+/// replanned when that fails.
 void dtCrowd::checkPathValidity(dtCrowdAgent** agents, const int nagents, const float dt)
 {
 	static const int CHECK_LOOKAHEAD = 10;
+	static const int MAX_REPAIR_ITER = 64;
 	static const float TARGET_REPLAN_DELAY = 1.0; // seconds
 	
+	const dtNavMesh* nav = m_navquery->getAttachedNavMesh();
+	const unsigned int generation = nav->getGeneration();
+
+	bool filterChanged[DT_CROWD_MAX_QUERY_FILTER_TYPE];
+	for (int i = 0; i < DT_CROWD_MAX_QUERY_FILTER_TYPE; ++i)
+	{
+#ifdef DT_VIRTUAL_QUERYFILTER
+		// A derived filter may reject polygons based on any state.
+		filterChanged[i] = true;
+#else
+		const unsigned short includeFlags = m_filters[i].getIncludeFlags();
+		const unsigned short excludeFlags = m_filters[i].getExcludeFlags();
+		filterChanged[i] = includeFlags != m_validatedFilterFlags[i][0] || excludeFlags != m_validatedFilterFlags[i][1];
+		m_validatedFilterFlags[i][0] = includeFlags;
+		m_validatedFilterFlags[i][1] = excludeFlags;
+#endif
+	}
+
 	for (int i = 0; i < nagents; ++i)
 	{
 		dtCrowdAgent* ag = agents[i];
 		
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+		if (ag->state != DT_CROWDAGENT_STATE_WALKING && ag->state != DT_CROWDAGENT_STATE_SLEEPING)
 			continue;
+
+		const dtQueryFilter* filter = &m_filters[ag->params.queryFilterType];
+		const bool tileChanged = ag->pathGeneration != generation && isPathTileChanged(nav, ag);
+		const bool validate = ag->pathChanged || filterChanged[ag->params.queryFilterType] || tileChanged;
+
+		// Sleeping agents are woken up to follow the changes of their path. A changed
+		// filter only wakes the agents whose path it no longer accepts.
+		if (ag->state == DT_CROWDAGENT_STATE_SLEEPING)
+		{
+			if (!ag->pathChanged && !tileChanged && (!filterChanged[ag->params.queryFilterType] ||
+				ag->corridor.isValid(ag->corridor.getPathCount(), m_navquery, filter)))
+				continue;
+			wakeAgent(ag);
+		}
 			
 		ag->targetReplanTime += dt;
 
 		bool replan = false;
 
+		if (validate)
+		{
+			ag->pathGeneration = generation;
+			// Polygons further along the path may have become invalid too, keep
+			// validating until the path has been replaced.
+			ag->pathChanged = !ag->corridor.isValid(ag->corridor.getPathCount(), m_navquery, filter);
+		}
+
 		// First check that the current location is valid.
 		const int idx = getAgentIndex(ag);
 		float agentPos[3];
 		dtPolyRef agentRef = ag->corridor.getFirstPoly();
 		dtVcopy(agentPos, ag->npos);
-		if (!m_navquery->isValidPolyRef(agentRef, &m_filters[ag->params.queryFilterType]))
+		if (validate && !m_navquery->isValidPolyRef(agentRef, &m_filters[ag->params.queryFilterType]))
 		{
 			// Current location is not valid, try to reposition.
 			// TODO: this can snap agents, how to handle that?
@@ -995,7 +1588,7 @@ void dtCrowd::checkPathValidity(dtCrowdAgent** agents, const int nagents, const
 		// Try to recover move request position.
 		if (ag->targetState != DT_CROWDAGENT_TARGET_NONE && ag->targetState != DT_CROWDAGENT_TARGET_FAILED)
 		{
-			if (!m_navquery->isValidPolyRef(ag->targetRef, &m_filters[ag->params.queryFilterType]))
+			if (validate && !m_navquery->isValidPolyRef(ag->targetRef, &m_filters[ag->params.queryFilterType]))
 			{
 				// Current target is not valid, try to reposition.
 				float nearest[3];
@@ -1014,13 +1607,19 @@ void dtCrowd::checkPathValidity(dtCrowdAgent** agents, const int nagents, const
 			}
 		}
 
-		// If nearby corridor is not valid, replan.
-		if (!ag->corridor.isValid(CHECK_LOOKAHEAD, m_navquery, &m_filters[ag->params.queryFilterType]))
+		// If nearby corridor is not valid, try to repair it locally, replan if that fails.
+		if (validate && !ag->corridor.isValid(CHECK_LOOKAHEAD, m_navquery, &m_filters[ag->params.queryFilterType]))
 		{
-			// Fix current path.
-//			ag->corridor.trimInvalidPath(agentRef, agentPos, m_navquery, &m_filter);
-//			ag->boundary.reset();
-			replan = true;
+			if (!replan && ag->targetState == DT_CROWDAGENT_TARGET_VALID &&
+				ag->corridor.repairPath(MAX_REPAIR_ITER, m_navquery, filter))
+			{
+				ag->boundary.reset();
+				ag->pathChanged = false;
+			}
+			else
+			{
+				replan = true;
+			}
 		}
 		
 		// If the end of the path is near and it is not the requested location, replan.
@@ -1043,369 +1642,838 @@ void dtCrowd::checkPathValidity(dtCrowdAgent** agents, const int nagents, const
 	}
 }
 	
-void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
+void dtCrowd::wakeAgent(dtCrowdAgent* ag)
 {
-	m_velocitySampleCount = 0;
-	
-	const int debugIdx = debug ? debug->idx : -1;
-	
-	dtCrowdAgent** agents = m_activeAgents;
-	int nagents = getActiveAgents(agents, m_maxAgents);
-
-	// Check that all agents still have valid paths.
-	checkPathValidity(agents, nagents, dt);
-	
-	// Update async move request and path finder.
-	updateMoveRequest(dt);
+	ag->idleTime = 0;
+	if (ag->state == DT_CROWDAGENT_STATE_SLEEPING)
+		ag->state = DT_CROWDAGENT_STATE_WALKING;
+}
 
-	// Optimize path topology.
-	updateTopologyOptimization(agents, nagents, dt);
+/// @par
+///
+/// An agent is idle while it has no move target, or is within its radius of the
+/// end of its path, and has stopped. Sleeping agents take no part in any phase of
+/// the agent update, the moving agents only see them through their neighbours,
+/// and wake up the sleeping agents they touch.
+void dtCrowd::updateSleep(dtCrowdAgent** agents, const int nagents, const float dt)
+{
+	static const float IDLE_SPEED = 0.01f;
 	
-	// Register agents to proximity grid.
-	m_grid->clear();
 	for (int i = 0; i < nagents; ++i)
 	{
 		dtCrowdAgent* ag = agents[i];
-		const float* p = ag->npos;
-		const float r = ag->params.radius;
-		m_grid->addItem((unsigned short)i, p[0]-r, p[2]-r, p[0]+r, p[2]+r);
+		if (ag->state != DT_CROWDAGENT_STATE_WALKING || !(ag->params.updateFlags & DT_CROWD_SLEEP))
+			continue;
+		const bool arrived = ag->targetState == DT_CROWDAGENT_TARGET_NONE ||
+			(ag->targetState == DT_CROWDAGENT_TARGET_VALID &&
+			 (!ag->ncorners || getDistanceToGoal(ag, ag->params.radius) < ag->params.radius));
+		if (!arrived || dtVlenSqr(ag->vel) > dtSqr(IDLE_SPEED) || dtVlenSqr(ag->disp) > dtSqr(IDLE_SPEED*dt))
+		{
+			ag->idleTime = 0;
+			continue;
+		}
+		ag->idleTime += dt;
+		if (ag->idleTime >= m_sleepDelay)
+		{
+			ag->state = DT_CROWDAGENT_STATE_SLEEPING;
+			ag->nneis = 0;
+			dtVset(ag->dvel, 0,0,0);
+			dtVset(ag->nvel, 0,0,0);
+			dtVset(ag->vel, 0,0,0);
+		}
 	}
-	
-	// Get nearby navmesh segments and agents to collide with.
+
+	// Wake up the sleeping agents the moving agents have run into.
 	for (int i = 0; i < nagents; ++i)
 	{
-		dtCrowdAgent* ag = agents[i];
+		const dtCrowdAgent* ag = agents[i];
 		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
 			continue;
-
-		// Update the collision boundary after certain distance has been passed or
-		// if it has become invalid.
-		const float updateThr = ag->params.collisionQueryRange*0.25f;
-		if (dtVdist2DSqr(ag->npos, ag->boundary.getCenter()) > dtSqr(updateThr) ||
-			!ag->boundary.isValid(m_navquery, &m_filters[ag->params.queryFilterType]))
+		for (int j = 0; j < ag->nneis; ++j)
 		{
-			ag->boundary.update(ag->corridor.getFirstPoly(), ag->npos, ag->params.collisionQueryRange,
-								m_navquery, &m_filters[ag->params.queryFilterType]);
+			dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
+			if (nei->state != DT_CROWDAGENT_STATE_SLEEPING)
+				continue;
+			if (dtVdist2DSqr(ag->npos, nei->npos) < dtSqr(ag->params.radius + nei->params.radius))
+				wakeAgent(nei);
 		}
-		// Query neighbour agents
+	}
+}
+	
+// The stages of the agent update that can run concurrently.
+// The cluster stages replace the boundary and neighbour stages when the agents are clustered,
+// their jobs update a range of clusters instead of a range of agents.
+enum dtCrowdUpdatePhase
+{
+	DT_CROWD_PHASE_BOUNDARY,
+	DT_CROWD_PHASE_NEIGHBOURS,
+	DT_CROWD_PHASE_CLUSTER_BOUNDARY,
+	DT_CROWD_PHASE_CLUSTER_NEIGHBOURS,
+	DT_CROWD_PHASE_CORNERS,
+	DT_CROWD_PHASE_STEERING,
+	DT_CROWD_PHASE_PLANNING,
+	DT_CROWD_PHASE_INTEGRATE,
+	DT_CROWD_PHASE_COLLISIONS,
+	DT_CROWD_PHASE_DISPLACE,
+	DT_CROWD_PHASE_MOVE
+};
+
+// The number of agents updated by a single job.
+static const int AGENTS_PER_JOB = 32;
+// The number of clusters updated by a single job.
+static const int CLUSTERS_PER_JOB = 4;
+
+struct dtCrowdUpdateJob
+{
+	dtCrowd* crowd;
+	dtCrowdAgent** agents;
+	int nagents;
+	int phase;
+	int itemCount;		// The number of agents or clusters updated in the phase.
+	int itemsPerJob;
+	float dt;
+	dtCrowdAgentDebugInfo* debug;
+};
+
+void dtCrowd::runUpdateJob(void* userData, const int jobIndex, const int workerIndex)
+{
+	const dtCrowdUpdateJob* job = (const dtCrowdUpdateJob*)userData;
+	const int first = jobIndex*job->itemsPerJob;
+	const int last = dtMin(first + job->itemsPerJob, job->itemCount);
+	job->crowd->updateAgents(*job, first, last, workerIndex);
+}
+
+void dtCrowd::runUpdatePhase(dtCrowdUpdateJob& job, const int phase)
+{
+	const bool clusters = phase == DT_CROWD_PHASE_CLUSTER_BOUNDARY || phase == DT_CROWD_PHASE_CLUSTER_NEIGHBOURS;
+	job.phase = phase;
+	job.itemCount = clusters ? m_clusterCount : job.nagents;
+	job.itemsPerJob = clusters ? CLUSTERS_PER_JOB : AGENTS_PER_JOB;
+	if (m_dispatcher)
+		m_dispatcher->dispatch(runUpdateJob, &job, (job.itemCount + job.itemsPerJob-1) / job.itemsPerJob);
+	else
+		updateAgents(job, 0, job.itemCount, 0);
+}
+
+/// Groups the active agents by blocks of proximity grid cells about the size of a cluster.
+/// The agents of each cluster are stored in grid order.
+void dtCrowd::buildClusters()
+{
+	m_clusterCount = 0;
+	m_clusterStarts[0] = 0;
+	// Empty if there are no agents.
+	const int* cells = m_grid->getBounds();
+
+	const int span = dtMax(1, (int)dtMathCeilf(m_clusterSize / m_grid->getCellSize()));
+	int n = 0;
+	for (int by = cells[1]; by <= cells[3]; by += span)
+	{
+		for (int bx = cells[0]; bx <= cells[2]; bx += span)
+		{
+			const int start = n;
+			for (int y = by; y <= dtMin(by+span-1, cells[3]); ++y)
+			{
+				int nids = 0;
+				const unsigned int* ids = m_grid->getRowItems(bx, dtMin(bx+span-1, cells[2]), y, nids);
+				for (int i = 0; i < nids; ++i)
+					m_clusterAgents[n++] = (int)ids[i];
+			}
+			if (n > start)
+				m_clusterStarts[m_clusterCount++] = start;
+		}
+	}
+	m_clusterStarts[m_clusterCount] = n;
+}
+
+/// True if the agent's collision boundary is due for an update, after moving a certain distance
+/// from its center or after it has become invalid.
+bool dtCrowd::needsBoundaryUpdate(const dtCrowdAgent* ag, dtNavMeshQuery* navquery) const
+{
+	if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+		return false;
+	if (ag->params.lod >= DT_CROWDAGENT_LOD_CORRIDOR)
+		return false;
+	if (!isLODUpdateFrame(ag))
+		return false;
+
+	const float updateThr = ag->params.collisionQueryRange*0.25f;
+	return dtVdist2DSqr(ag->npos, ag->boundary.getCenter()) > dtSqr(updateThr) ||
+		!ag->boundary.isValid(navquery, &m_filters[ag->params.queryFilterType]);
+}
+
+/// Collects the wall segments of the active agent and finds its neighbours, from the proximity grid
+/// or, if given, from the candidates gathered for its cluster.
+void dtCrowd::updateNeighbours(dtCrowdAgent** agents, const int nagents, const int idx, dtNavMeshQuery* navquery,
+							   const unsigned int* candidates, const int ncandidates)
+{
+	dtCrowdAgent* ag = agents[idx];
+	if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+		return;
+	if (ag->params.lod >= DT_CROWDAGENT_LOD_CORRIDOR)
+	{
+		ag->nneis = 0;
+		return;
+	}
+	if (!isLODUpdateFrame(ag))
+		return;
+
+	if (m_boundaryUpdates[idx])
+	{
+		ag->boundary.updateSegments(ag->params.collisionQueryRange, navquery,
+									&m_filters[ag->params.queryFilterType], &m_wallSegmentCache);
+	}
+	// Query neighbour agents
+	const int maxNeis = ag->params.maxNeighbours ? dtMin((int)ag->params.maxNeighbours, m_maxNeighbours) : m_maxNeighbours;
+	if (candidates)
+	{
+		ag->nneis = filterNeighbours(ag->npos, ag->params.height, ag->params.collisionQueryRange,
+									 ag, candidates, ncandidates, ag->neis, 0, maxNeis, agents);
+	}
+	else
+	{
 		ag->nneis = getNeighbours(ag->npos, ag->params.height, ag->params.collisionQueryRange,
-								  ag, ag->neis, DT_CROWDAGENT_MAX_NEIGHBOURS,
+								  ag, ag->neis, maxNeis,
 								  agents, nagents, m_grid);
-		for (int j = 0; j < ag->nneis; j++)
-			ag->neis[j].idx = getAgentIndex(agents[ag->neis[j].idx]);
 	}
-	
-	// Find next corner to steer to.
-	for (int i = 0; i < nagents; ++i)
+	for (int j = 0; j < ag->nneis; j++)
+		ag->neis[j].idx = getAgentIndex(agents[ag->neis[j].idx]);
+}
+
+void dtCrowd::updateAgents(const dtCrowdUpdateJob& job, const int first, const int last, const int workerIndex)
+{
+	dtCrowdAgent** agents = job.agents;
+	const int nagents = job.nagents;
+	const float dt = job.dt;
+	dtCrowdAgentDebugInfo* debug = job.debug;
+	const int debugIdx = debug ? debug->idx : -1;
+
+	dtNavMeshQuery* navquery = m_dispatcher ? m_workerNavQueries[workerIndex] : m_navquery;
+	dtObstacleAvoidanceQuery* obstacleQuery = m_dispatcher ? m_workerObstacleQueries[workerIndex] : m_obstacleQuery;
+	int* sampleCount = m_dispatcher ? &m_workerSampleCounts[workerIndex] : &m_velocitySampleCount;
+
+	switch (job.phase)
 	{
-		dtCrowdAgent* ag = agents[i];
-		
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
-			continue;
-		
-		// Find corners for steering
-		ag->ncorners = ag->corridor.findCorners(ag->cornerVerts, ag->cornerFlags, ag->cornerPolys,
-												DT_CROWDAGENT_MAX_CORNERS, m_navquery, &m_filters[ag->params.queryFilterType]);
-		
-		// Check to see if the corner after the next corner is directly visible,
-		// and short cut to there.
-		if ((ag->params.updateFlags & DT_CROWD_OPTIMIZE_VIS) && ag->ncorners > 0)
+	case DT_CROWD_PHASE_BOUNDARY:
+		// Find the polygons around the agents whose boundary needs updating.
+		for (int i = first; i < last; ++i)
 		{
-			const float* target = &ag->cornerVerts[dtMin(1,ag->ncorners-1)*3];
-			ag->corridor.optimizePathVisibility(target, ag->params.pathOptimizationRange, m_navquery, &m_filters[ag->params.queryFilterType]);
-			
-			// Copy data for debug purposes.
-			if (debugIdx == i)
+			dtCrowdAgent* ag = agents[i];
+			m_boundaryUpdates[i] = 0;
+			if (needsBoundaryUpdate(ag, navquery))
 			{
-				dtVcopy(debug->optStart, ag->corridor.getPos());
-				dtVcopy(debug->optEnd, target);
+				ag->boundary.updatePolys(ag->corridor.getFirstPoly(), ag->npos, ag->params.collisionQueryRange,
+										 navquery, &m_filters[ag->params.queryFilterType]);
+				m_boundaryUpdates[i] = 1;
 			}
 		}
-		else
+		break;
+
+	case DT_CROWD_PHASE_NEIGHBOURS:
+		// Get nearby navmesh segments and agents to collide with.
+		for (int i = first; i < last; ++i)
+			updateNeighbours(agents, nagents, i, navquery, 0, 0);
+		break;
+
+	case DT_CROWD_PHASE_CLUSTER_BOUNDARY:
+		// Search the polygons around the first agent of the cluster whose boundary needs updating,
+		// far enough to cover the ranges of the other agents that need updating too.
+		for (int c = first; c < last; ++c)
 		{
-			// Copy data for debug purposes.
-			if (debugIdx == i)
+			const int* members = &m_clusterAgents[m_clusterStarts[c]];
+			const int nmembers = m_clusterStarts[c+1] - m_clusterStarts[c];
+			int leader = -1;
+			float range = 0.0f;
+			for (int j = 0; j < nmembers; ++j)
+			{
+				const int i = members[j];
+				const dtCrowdAgent* ag = agents[i];
+				m_boundaryUpdates[i] = needsBoundaryUpdate(ag, navquery) ? 1 : 0;
+				if (!m_boundaryUpdates[i])
+					continue;
+				if (leader < 0)
+					leader = i;
+				const float dist = dtMathSqrtf(dtVdist2DSqr(agents[leader]->npos, ag->npos));
+				range = dtMax(range, dist + ag->params.collisionQueryRange);
+			}
+			if (leader < 0)
+				continue;
+
+			dtCrowdAgent* lead = agents[leader];
+			const dtQueryFilter* leadFilter = &m_filters[lead->params.queryFilterType];
+			lead->boundary.updatePolys(lead->corridor.getFirstPoly(), lead->npos, range, navquery, leadFilter);
+			// A full boundary may have stopped short of the other agents, they search on their own then.
+			const bool shared = lead->boundary.getPolyCount() < lead->boundary.getMaxPolys();
+			if (!shared && range > lead->params.collisionQueryRange)
 			{
-				dtVset(debug->optStart, 0,0,0);
-				dtVset(debug->optEnd, 0,0,0);
+				lead->boundary.updatePolys(lead->corridor.getFirstPoly(), lead->npos, lead->params.collisionQueryRange,
+										   navquery, leadFilter);
+			}
+
+			for (int j = 0; j < nmembers; ++j)
+			{
+				const int i = members[j];
+				if (i == leader || !m_boundaryUpdates[i])
+					continue;
+				dtCrowdAgent* ag = agents[i];
+				if (shared && ag->params.queryFilterType == lead->params.queryFilterType &&
+					lead->boundary.hasPoly(ag->corridor.getFirstPoly()))
+				{
+					ag->boundary.copyPolys(lead->boundary, ag->npos);
+				}
+				else
+				{
+					ag->boundary.updatePolys(ag->corridor.getFirstPoly(), ag->npos, ag->params.collisionQueryRange,
+											 navquery, &m_filters[ag->params.queryFilterType]);
+				}
 			}
 		}
-	}
-	
-	// Trigger off-mesh connections (depends on corners).
-	for (int i = 0; i < nagents; ++i)
-	{
-		dtCrowdAgent* ag = agents[i];
-		
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
-			continue;
-		
-		// Check 
-		const float triggerRadius = ag->params.radius*2.25f;
-		if (overOffmeshConnection(ag, triggerRadius))
+		break;
+
+	case DT_CROWD_PHASE_CLUSTER_NEIGHBOURS:
+		// Gather the agents around the cluster from the grid once, each agent picks its neighbours from them.
+		for (int c = first; c < last; ++c)
 		{
-			// Prepare to off-mesh connection.
-			const int idx = (int)(ag - m_agents);
-			dtCrowdAgentAnimation* anim = &m_agentAnims[idx];
+			const int* members = &m_clusterAgents[m_clusterStarts[c]];
+			const int nmembers = m_clusterStarts[c+1] - m_clusterStarts[c];
+			unsigned int* candidates = &m_clusterCandidates[(m_dispatcher ? workerIndex : 0)*m_maxAgents];
+			int ncandidates = 0;
+
+			float bmin[2] = { FLT_MAX, FLT_MAX };
+			float bmax[2] = { -FLT_MAX, -FLT_MAX };
+			for (int j = 0; j < nmembers; ++j)
+			{
+				const dtCrowdAgent* ag = agents[members[j]];
+				if (ag->state != DT_CROWDAGENT_STATE_WALKING || ag->params.lod >= DT_CROWDAGENT_LOD_CORRIDOR ||
+					!isLODUpdateFrame(ag))
+					continue;
+				const float range = ag->params.collisionQueryRange;
+				bmin[0] = dtMin(bmin[0], ag->npos[0] - range);
+				bmin[1] = dtMin(bmin[1], ag->npos[2] - range);
+				bmax[0] = dtMax(bmax[0], ag->npos[0] + range);
+				bmax[1] = dtMax(bmax[1], ag->npos[2] + range);
+			}
+			int cells[4];
+			if (bmin[0] <= bmax[0] && m_grid->getCellRange(bmin[0], bmin[1], bmax[0], bmax[1], cells))
+			{
+				for (int y = cells[1]; y <= cells[3]; ++y)
+				{
+					int nids = 0;
+					const unsigned int* ids = m_grid->getRowItems(cells[0], cells[2], y, nids);
+					memcpy(&candidates[ncandidates], ids, sizeof(unsigned int)*nids);
+					ncandidates += nids;
+				}
+			}
+
+			for (int j = 0; j < nmembers; ++j)
+				updateNeighbours(agents, nagents, members[j], navquery, candidates, ncandidates);
+		}
+		break;
+
+	case DT_CROWD_PHASE_CORNERS:
+		for (int i = first; i < last; ++i)
+		{
+			dtCrowdAgent* ag = agents[i];
 			
-			// Adjust the path over the off-mesh connection.
-			dtPolyRef refs[2];
-			if (ag->corridor.moveOverOffmeshConnection(ag->cornerPolys[ag->ncorners-1], refs,
-													   anim->startPos, anim->endPos, m_navquery))
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+			if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
+				continue;
+			if (ag->params.lod == DT_CROWDAGENT_LOD_FROZEN)
+				continue;
+			
+			// Find corners for steering
+			ag->ncorners = ag->corridor.findCorners(ag->cornerVerts, ag->cornerFlags, ag->cornerPolys,
+													DT_CROWDAGENT_MAX_CORNERS, navquery, &m_filters[ag->params.queryFilterType]);
+			
+			// Check to see if the corner after the next corner is directly visible,
+			// and short cut to there.
+			if ((ag->params.updateFlags & DT_CROWD_OPTIMIZE_VIS) && ag->ncorners > 0)
 			{
-				dtVcopy(anim->initPos, ag->npos);
-				anim->polyRef = refs[1];
-				anim->active = true;
-				anim->t = 0.0f;
-				anim->tmax = (dtVdist2D(anim->startPos, anim->endPos) / ag->params.maxSpeed) * 0.5f;
+				const float* target = &ag->cornerVerts[dtMin(1,ag->ncorners-1)*3];
+				ag->corridor.optimizePathVisibility(target, ag->params.pathOptimizationRange, navquery, &m_filters[ag->params.queryFilterType],
+													ag->params.pathOptimizationReuseDist);
 				
-				ag->state = DT_CROWDAGENT_STATE_OFFMESH;
-				ag->ncorners = 0;
-				ag->nneis = 0;
-				continue;
+				// Copy data for debug purposes.
+				if (debugIdx == i)
+				{
+					dtVcopy(debug->optStart, ag->corridor.getPos());
+					dtVcopy(debug->optEnd, target);
+				}
 			}
 			else
 			{
-				// Path validity check will ensure that bad/blocked connections will be replanned.
+				// Copy data for debug purposes.
+				if (debugIdx == i)
+				{
+					dtVset(debug->optStart, 0,0,0);
+					dtVset(debug->optEnd, 0,0,0);
+				}
+			}
+
+			// Trigger off-mesh connections (depends on corners).
+			const float triggerRadius = ag->params.radius*2.25f;
+			if (overOffmeshConnection(ag, triggerRadius))
+			{
+				// Prepare to off-mesh connection.
+				const int idx = (int)(ag - m_agents);
+				dtCrowdAgentAnimation* anim = &m_agentAnims[idx];
+				
+				// Adjust the path over the off-mesh connection.
+				dtPolyRef refs[2];
+				if (ag->corridor.moveOverOffmeshConnection(ag->cornerPolys[ag->ncorners-1], refs,
+														   anim->startPos, anim->endPos, navquery, m_offMeshTable))
+				{
+					dtVcopy(anim->initPos, ag->npos);
+					anim->polyRef = refs[1];
+					anim->active = true;
+					anim->t = 0.0f;
+					anim->tmax = (dtVdist2D(anim->startPos, anim->endPos) / ag->params.maxSpeed) * 0.5f;
+					
+					ag->state = DT_CROWDAGENT_STATE_OFFMESH;
+					ag->ncorners = 0;
+					ag->nneis = 0;
+					continue;
+				}
+				else
+				{
+					// Path validity check will ensure that bad/blocked connections will be replanned.
+				}
 			}
 		}
-	}
-		
-	// Calculate steering.
-	for (int i = 0; i < nagents; ++i)
-	{
-		dtCrowdAgent* ag = agents[i];
+		break;
 
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE)
-			continue;
+	case DT_CROWD_PHASE_STEERING:
+		// Calculate steering.
+		for (int i = first; i < last; ++i)
+		{
+			dtCrowdAgent* ag = agents[i];
+
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+			if (ag->targetState == DT_CROWDAGENT_TARGET_NONE)
+				continue;
+			if (ag->params.lod == DT_CROWDAGENT_LOD_FROZEN)
+				continue;
 		
-		float dvel[3] = {0,0,0};
+			float dvel[3] = {0,0,0};
 
-		if (ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
-		{
-			dtVcopy(dvel, ag->targetPos);
-			ag->desiredSpeed = dtVlen(ag->targetPos);
-		}
-		else
-		{
-			// Calculate steering direction.
-			if (ag->params.updateFlags & DT_CROWD_ANTICIPATE_TURNS)
-				calcSmoothSteerDirection(ag, dvel);
+			if (ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
+			{
+				dtVcopy(dvel, ag->targetPos);
+				ag->desiredSpeed = dtVlen(ag->targetPos);
+			}
 			else
-				calcStraightSteerDirection(ag, dvel);
+			{
+				// Calculate steering direction.
+				if (ag->params.updateFlags & DT_CROWD_ANTICIPATE_TURNS)
+					calcSmoothSteerDirection(ag, dvel);
+				else
+					calcStraightSteerDirection(ag, dvel);
 			
-			// Calculate speed scale, which tells the agent to slowdown at the end of the path.
-			const float slowDownRadius = ag->params.radius*2;	// TODO: make less hacky.
-			const float speedScale = getDistanceToGoal(ag, slowDownRadius) / slowDownRadius;
+				// Calculate speed scale, which tells the agent to slowdown at the end of the path.
+				const float slowDownRadius = ag->params.radius*2;	// TODO: make less hacky.
+				const float speedScale = getDistanceToGoal(ag, slowDownRadius) / slowDownRadius;
 				
-			ag->desiredSpeed = ag->params.maxSpeed;
-			dtVscale(dvel, dvel, ag->desiredSpeed * speedScale);
-		}
+				ag->desiredSpeed = ag->params.maxSpeed;
+				dtVscale(dvel, dvel, ag->desiredSpeed * speedScale);
+			}
 
-		// Separation
-		if (ag->params.updateFlags & DT_CROWD_SEPARATION)
-		{
-			const float separationDist = ag->params.collisionQueryRange; 
-			const float invSeparationDist = 1.0f / separationDist; 
-			const float separationWeight = ag->params.separationWeight;
+			// Separation
+			if (ag->params.updateFlags & DT_CROWD_SEPARATION)
+			{
+				const float separationDist = ag->params.collisionQueryRange; 
+				const float invSeparationDist = 1.0f / separationDist; 
+				const float separationWeight = ag->params.separationWeight;
 			
-			float w = 0;
-			float disp[3] = {0,0,0};
+				float w = 0;
+				float disp[3] = {0,0,0};
 			
-			for (int j = 0; j < ag->nneis; ++j)
-			{
-				const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
+				for (int j = 0; j < ag->nneis; ++j)
+				{
+					const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
+					// Reduced rate neighbours may have been removed since.
+					if (!nei->active)
+						continue;
 				
-				float diff[3];
-				dtVsub(diff, ag->npos, nei->npos);
-				diff[1] = 0;
+					float diff[3];
+					dtVsub(diff, ag->npos, nei->npos);
+					diff[1] = 0;
 				
-				const float distSqr = dtVlenSqr(diff);
-				if (distSqr < 0.00001f)
-					continue;
-				if (distSqr > dtSqr(separationDist))
-					continue;
-				const float dist = dtMathSqrtf(distSqr);
-				const float weight = separationWeight * (1.0f - dtSqr(dist*invSeparationDist));
+					const float distSqr = dtVlenSqr(diff);
+					if (distSqr < 0.00001f)
+						continue;
+					if (distSqr > dtSqr(separationDist))
+						continue;
+					const float dist = dtMathSqrtf(distSqr);
+					const float weight = separationWeight * (1.0f - dtSqr(dist*invSeparationDist));
 				
-				dtVmad(disp, disp, diff, weight/dist);
-				w += 1.0f;
-			}
+					dtVmad(disp, disp, diff, weight/dist);
+					w += 1.0f;
+				}
 			
-			if (w > 0.0001f)
-			{
-				// Adjust desired velocity.
-				dtVmad(dvel, dvel, disp, 1.0f/w);
-				// Clamp desired velocity to desired speed.
-				const float speedSqr = dtVlenSqr(dvel);
-				const float desiredSqr = dtSqr(ag->desiredSpeed);
-				if (speedSqr > desiredSqr)
-					dtVscale(dvel, dvel, desiredSqr/speedSqr);
+				if (w > 0.0001f)
+				{
+					// Adjust desired velocity.
+					dtVmad(dvel, dvel, disp, 1.0f/w);
+					// Clamp desired velocity to desired speed.
+					const float speedSqr = dtVlenSqr(dvel);
+					const float desiredSqr = dtSqr(ag->desiredSpeed);
+					if (speedSqr > desiredSqr)
+						dtVscale(dvel, dvel, desiredSqr/speedSqr);
+				}
 			}
-		}
-		
-		// Set the desired velocity.
-		dtVcopy(ag->dvel, dvel);
-	}
-	
-	// Velocity planning.	
-	for (int i = 0; i < nagents; ++i)
-	{
-		dtCrowdAgent* ag = agents[i];
-		
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
 		
-		if (ag->params.updateFlags & DT_CROWD_OBSTACLE_AVOIDANCE)
+			// Set the desired velocity.
+			dtVcopy(ag->dvel, dvel);
+		}
+		break;
+
+	case DT_CROWD_PHASE_PLANNING:
+		// Velocity planning.	
+		for (int i = first; i < last; ++i)
 		{
-			m_obstacleQuery->reset();
-			
-			// Add neighbours as obstacles.
-			for (int j = 0; j < ag->nneis; ++j)
-			{
-				const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
-				m_obstacleQuery->addCircle(nei->npos, nei->params.radius, nei->vel, nei->dvel);
-			}
+			dtCrowdAgent* ag = agents[i];
+		
+			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+				continue;
+			if (ag->params.lod == DT_CROWDAGENT_LOD_FROZEN)
+				continue;
 
-			// Append neighbour segments as obstacles.
-			for (int j = 0; j < ag->boundary.getSegmentCount(); ++j)
+			if (!isLODUpdateFrame(ag) && (ag->params.updateFlags & DT_CROWD_OBSTACLE_AVOIDANCE))
 			{
-				const float* s = ag->boundary.getSegment(j);
-				if (dtTriArea2D(ag->npos, s, s+3) < 0.0f)
-					continue;
-				m_obstacleQuery->addSegment(s, s+3);
+				// Keep the direction of the previously planned velocity at the current desired speed.
+				const float speed = dtVlen(ag->nvel);
+				if (speed > 0.0001f)
+					dtVscale(ag->nvel, ag->nvel, dtVlen(ag->dvel) / speed);
+				else
+					dtVcopy(ag->nvel, ag->dvel);
+				continue;
 			}
+		
+			if ((ag->params.updateFlags & DT_CROWD_OBSTACLE_AVOIDANCE) && ag->params.lod != DT_CROWDAGENT_LOD_CORRIDOR)
+			{
+				obstacleQuery->reset();
+			
+				// Add neighbours as obstacles.
+				for (int j = 0; j < ag->nneis; ++j)
+				{
+					const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
+					obstacleQuery->addCircle(nei->npos, nei->params.radius, nei->vel, nei->dvel);
+				}
+
+				// Append neighbour segments as obstacles.
+				for (int j = 0; j < ag->boundary.getSegmentCount(); ++j)
+				{
+					const float* s = ag->boundary.getSegment(j);
+					if (dtTriArea2D(ag->npos, s, s+3) < 0.0f)
+						continue;
+					obstacleQuery->addSegment(s, s+3);
+				}
 
-			dtObstacleAvoidanceDebugData* vod = 0;
-			if (debugIdx == i) 
-				vod = debug->vod;
+				dtObstacleAvoidanceDebugData* vod = 0;
+				if (debugIdx == i) 
+					vod = debug->vod;
 			
-			// Sample new safe velocity.
-			bool adaptive = true;
-			int ns = 0;
+				// Sample new safe velocity.
+				bool adaptive = true;
+				int ns = 0;
 
-			const dtObstacleAvoidanceParams* params = &m_obstacleQueryParams[ag->params.obstacleAvoidanceType];
+				const dtObstacleAvoidanceParams* params = &m_obstacleQueryParams[ag->params.obstacleAvoidanceType];
 				
-			if (adaptive)
-			{
-				ns = m_obstacleQuery->sampleVelocityAdaptive(ag->npos, ag->params.radius, ag->desiredSpeed,
+				if (params->solver == DT_OBSTACLE_AVOIDANCE_ORCA)
+				{
+					ns = obstacleQuery->solveVelocityORCA(ag->npos, ag->params.radius, ag->desiredSpeed,
+														  ag->vel, ag->dvel, ag->nvel, params, vod);
+				}
+				else if (adaptive)
+				{
+					ns = obstacleQuery->sampleVelocityAdaptive(ag->npos, ag->params.radius, ag->desiredSpeed,
+																 ag->vel, ag->dvel, ag->nvel, params, vod);
+				}
+				else
+				{
+					ns = obstacleQuery->sampleVelocityGrid(ag->npos, ag->params.radius, ag->desiredSpeed,
 															 ag->vel, ag->dvel, ag->nvel, params, vod);
+				}
+				*sampleCount += ns;
 			}
 			else
 			{
-				ns = m_obstacleQuery->sampleVelocityGrid(ag->npos, ag->params.radius, ag->desiredSpeed,
-														 ag->vel, ag->dvel, ag->nvel, params, vod);
+				// If not using velocity planning, new velocity is directly the desired velocity.
+				dtVcopy(ag->nvel, ag->dvel);
 			}
-			m_velocitySampleCount += ns;
 		}
-		else
-		{
-			// If not using velocity planning, new velocity is directly the desired velocity.
-			dtVcopy(ag->nvel, ag->dvel);
-		}
-	}
+		break;
 
-	// Integrate.
-	for (int i = 0; i < nagents; ++i)
-	{
-		dtCrowdAgent* ag = agents[i];
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		integrate(ag, dt);
-	}
-	
-	// Handle collisions.
-	static const float COLLISION_RESOLVE_FACTOR = 0.7f;
-	
-	for (int iter = 0; iter < 4; ++iter)
+	case DT_CROWD_PHASE_INTEGRATE:
+		// All agents are gathered, the walking agents collide with agents in any state.
+		gatherKinematics(m_kinematics, agents, first, last);
+		integrate(m_kinematics, first, last, dt);
+		break;
+
+	case DT_CROWD_PHASE_COLLISIONS:
 	{
-		for (int i = 0; i < nagents; ++i)
+		// Handle collisions.
+		static const float COLLISION_RESOLVE_FACTOR = 0.7f;
+		dtCrowdKinematics& kin = m_kinematics;
+		
+		for (int i = first; i < last; ++i)
 		{
-			dtCrowdAgent* ag = agents[i];
-			const int idx0 = getAgentIndex(ag);
-			
-			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+			kin.dispx[i] = 0;
+			kin.dispz[i] = 0;
+			if (!(kin.flags[i] & DT_KINEMATICS_COLLIDE))
 				continue;
 
-			dtVset(ag->disp, 0,0,0);
-			
+			const dtCrowdAgent* ag = agents[i];
+			const int idx0 = getAgentIndex(ag);
+			float dispx = 0, dispz = 0;
 			float w = 0;
 
 			for (int j = 0; j < ag->nneis; ++j)
 			{
-				const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
-				const int idx1 = getAgentIndex(nei);
+				const int idx1 = ag->neis[j].idx;
+				if (!m_agents[idx1].active)
+					continue;
+				const int k = m_activeIndices[idx1];
 
-				float diff[3];
-				dtVsub(diff, ag->npos, nei->npos);
-				diff[1] = 0;
-				
-				float dist = dtVlenSqr(diff);
-				if (dist > dtSqr(ag->params.radius + nei->params.radius))
+				float diffx = kin.px[i] - kin.px[k];
+				float diffz = kin.pz[i] - kin.pz[k];
+			
+				float dist = diffx*diffx + diffz*diffz;
+				const float r = kin.radius[i] + kin.radius[k];
+				if (dist > dtSqr(r))
 					continue;
 				dist = dtMathSqrtf(dist);
-				float pen = (ag->params.radius + nei->params.radius) - dist;
+				float pen = r - dist;
 				if (dist < 0.0001f)
 				{
 					// Agents on top of each other, try to choose diverging separation directions.
 					if (idx0 > idx1)
-						dtVset(diff, -ag->dvel[2],0,ag->dvel[0]);
+					{
+						diffx = -kin.dvz[i];
+						diffz = kin.dvx[i];
+					}
 					else
-						dtVset(diff, ag->dvel[2],0,-ag->dvel[0]);
+					{
+						diffx = kin.dvz[i];
+						diffz = -kin.dvx[i];
+					}
 					pen = 0.01f;
 				}
 				else
 				{
 					pen = (1.0f/dist) * (pen*0.5f) * COLLISION_RESOLVE_FACTOR;
 				}
-				
-				dtVmad(ag->disp, ag->disp, diff, pen);			
-				
+			
+				dispx += diffx*pen;
+				dispz += diffz*pen;
+			
 				w += 1.0f;
 			}
-			
+		
 			if (w > 0.0001f)
 			{
 				const float iw = 1.0f / w;
-				dtVscale(ag->disp, ag->disp, iw);
+				dispx *= iw;
+				dispz *= iw;
 			}
+			kin.dispx[i] = dispx;
+			kin.dispz[i] = dispz;
 		}
-		
-		for (int i = 0; i < nagents; ++i)
+		break;
+	}
+
+	case DT_CROWD_PHASE_DISPLACE:
+	{
+		dtCrowdKinematics& kin = m_kinematics;
+		for (int i = first; i < last; ++i)
 		{
-			dtCrowdAgent* ag = agents[i];
-			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+			if (!(kin.flags[i] & DT_KINEMATICS_COLLIDE))
 				continue;
-			
-			dtVadd(ag->npos, ag->npos, ag->disp);
+			kin.px[i] += kin.dispx[i];
+			kin.pz[i] += kin.dispz[i];
+		}
+		break;
+	}
+
+	case DT_CROWD_PHASE_MOVE:
+		scatterKinematics(m_kinematics, agents, first, last);
+		for (int batchFirst = first; batchFirst < last; )
+		{
+			// Move the agents along the navmesh in batches.
+			static const int MAX_MOVES = AGENTS_PER_JOB;
+			static const int MAX_VISITED = 16;
+			dtSurfaceMove moves[MAX_MOVES];
+			dtPolyRef visited[MAX_MOVES*MAX_VISITED];
+			dtCrowdAgent* moved[MAX_MOVES];
+			int nmoves = 0;
+			for (; batchFirst < last && nmoves < MAX_MOVES; ++batchFirst)
+			{
+				dtCrowdAgent* ag = agents[batchFirst];
+				if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+					continue;
+				if (ag->params.lod == DT_CROWDAGENT_LOD_FROZEN)
+					continue;
+				ag->corridor.initMovePosition(ag->npos, &m_filters[ag->params.queryFilterType],
+											  &visited[nmoves*MAX_VISITED], MAX_VISITED, &moves[nmoves]);
+				moved[nmoves++] = ag;
+			}
+			navquery->moveAlongSurfaceBatch(moves, nmoves);
+
+			for (int i = 0; i < nmoves; ++i)
+			{
+				dtCrowdAgent* ag = moved[i];
+				ag->corridor.applyMovePosition(&moves[i], navquery);
+				// Get valid constrained position back.
+				dtVcopy(ag->npos, ag->corridor.getPos());
+
+				// If not using path, truncate the corridor to just one poly.
+				if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
+				{
+					ag->corridor.reset(ag->corridor.getFirstPoly(), ag->npos);
+					ag->partial = false;
+				}
+			}
 		}
+		break;
 	}
+}
+
+void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
+{
+	updateCrowd(dt, debug, 0);
+}
+
+void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug, const dtTimeBudget& pathBudget)
+{
+	updateCrowd(dt, debug, &pathBudget);
+}
+
+void dtCrowd::setUpdateClock(dtTimeFunc getTime)
+{
+	m_updateClock = getTime;
+	memset(&m_updateTimes, 0, sizeof(m_updateTimes));
+}
+
+void dtCrowd::updateCrowd(const float dt, dtCrowdAgentDebugInfo* debug, const dtTimeBudget* pathBudget)
+{
+	m_velocitySampleCount = 0;
+
+	dtCrowdUpdateTimes& times = m_updateTimes;
+	memset(&times, 0, sizeof(times));
+	const double startTime = m_updateClock ? m_updateClock() : 0.0;
+	double stageStart = startTime;
+
+#ifdef DT_QUERY_STATS
+	// Count the work of this update only.
+	dtNavMeshQuery** queries = m_workerCount ? m_workerNavQueries : &m_navquery;
+	const int queryCount = m_workerCount ? m_workerCount : 1;
+	for (int i = 0; i < queryCount; ++i)
+		queries[i]->resetStats();
+	m_pathq.resetQueryStats();
+#endif
+	
+	dtCrowdAgent** agents = m_activeAgents;
+	int nagents = getActiveAgents(agents, m_maxAgents);
+
+	// Check that all agents still have valid paths.
+	checkPathValidity(agents, nagents, dt);
+	lapTime(m_updateClock, times.pathValidity, stageStart);
+	
+	// Update async move request and path finder.
+	updateMoveRequest(dt, pathBudget);
+	lapTime(m_updateClock, times.moveRequests, stageStart);
+
+	// Optimize path topology.
+	updateTopologyOptimization(agents, nagents, dt, pathBudget);
+	lapTime(m_updateClock, times.topologyOptimization, stageStart);
 	
+	// Register agents to proximity grid. The neighbour queries only test the
+	// agent positions, so the agents are added as points.
+	m_grid->clear();
 	for (int i = 0; i < nagents; ++i)
 	{
 		dtCrowdAgent* ag = agents[i];
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+		const float* p = ag->npos;
+		m_grid->addItem((unsigned int)i, p[0], p[2], p[0], p[2]);
+	}
+	m_grid->build();
+	const bool clustered = m_clusterSize > 0.0f && m_clusterCandidates;
+	if (clustered)
+		buildClusters();
+	else
+		m_clusterCount = 0;
+	lapTime(m_updateClock, times.proximityGrid, stageStart);
+
+	for (int i = 0; i < m_workerCount; ++i)
+		m_workerSampleCounts[i] = 0;
+
+	// Each phase only depends on the results of the previous phases, the agents
+	// within a phase are updated independently of each other.
+	dtCrowdUpdateJob job;
+	job.crowd = this;
+	job.agents = agents;
+	job.nagents = nagents;
+	job.phase = 0;
+	job.itemCount = 0;
+	job.itemsPerJob = 0;
+	job.dt = dt;
+	job.debug = debug;
+
+	// Find the boundary polygons, and query the wall segments of each polygon once.
+	// The cache is filled serially, the agents only read it when collecting their segments.
+	runUpdatePhase(job, clustered ? DT_CROWD_PHASE_CLUSTER_BOUNDARY : DT_CROWD_PHASE_BOUNDARY);
+	m_wallSegmentCache.clear();
+	for (int i = 0; i < nagents; ++i)
+	{
+		if (!m_boundaryUpdates[i])
 			continue;
-		
-		// Move along navmesh.
-		ag->corridor.movePosition(ag->npos, m_navquery, &m_filters[ag->params.queryFilterType]);
-		// Get valid constrained position back.
-		dtVcopy(ag->npos, ag->corridor.getPos());
+		const dtCrowdAgent* ag = agents[i];
+		const dtQueryFilter* filter = &m_filters[ag->params.queryFilterType];
+		for (int j = 0; j < ag->boundary.getPolyCount(); ++j)
+			m_wallSegmentCache.addPoly(ag->boundary.getPoly(j), filter, m_navquery);
+	}
+	lapTime(m_updateClock, times.boundary, stageStart);
 
-		// If not using path, truncate the corridor to just one poly.
-		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
-		{
-			ag->corridor.reset(ag->corridor.getFirstPoly(), ag->npos);
-			ag->partial = false;
-		}
+	// Get nearby navmesh segments and agents to collide with.
+	runUpdatePhase(job, clustered ? DT_CROWD_PHASE_CLUSTER_NEIGHBOURS : DT_CROWD_PHASE_NEIGHBOURS);
+	lapTime(m_updateClock, times.neighbours, stageStart);
 
+	// Find next corner to steer to, and trigger off-mesh connections.
+	runUpdatePhase(job, DT_CROWD_PHASE_CORNERS);
+	lapTime(m_updateClock, times.corners, stageStart);
+
+	// Calculate steering.
+	runUpdatePhase(job, DT_CROWD_PHASE_STEERING);
+	lapTime(m_updateClock, times.steering, stageStart);
+
+	// Velocity planning.
+	runUpdatePhase(job, DT_CROWD_PHASE_PLANNING);
+	lapTime(m_updateClock, times.planning, stageStart);
+
+	// Integrate.
+	runUpdatePhase(job, DT_CROWD_PHASE_INTEGRATE);
+	lapTime(m_updateClock, times.integrate, stageStart);
+
+	// Handle collisions.
+	for (int iter = 0; iter < 4; ++iter)
+	{
+		runUpdatePhase(job, DT_CROWD_PHASE_COLLISIONS);
+		runUpdatePhase(job, DT_CROWD_PHASE_DISPLACE);
 	}
+	lapTime(m_updateClock, times.collisions, stageStart);
+
+	// Move along navmesh.
+	runUpdatePhase(job, DT_CROWD_PHASE_MOVE);
+	lapTime(m_updateClock, times.moveAlongSurface, stageStart);
+
+	for (int i = 0; i < m_workerCount; ++i)
+		m_velocitySampleCount += m_workerSampleCounts[i];
+
+	// Put the idle agents to sleep, and wake up the ones touched by the moving agents.
+	updateSleep(agents, nagents, dt);
+
+	m_updateFrame++;
 	
 	// Update agents using off-mesh connection.
 	for (int i = 0; i < nagents; ++i)
@@ -1446,4 +2514,32 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 		dtVset(ag->dvel, 0,0,0);
 	}
 	
+	// Publish the agent states for the readers on other threads.
+	dtCrowdAgentSnapshot* states = m_snapshots.beginPublish();
+	if (states)
+	{
+		for (int i = 0; i < nagents; ++i)
+		{
+			const dtCrowdAgent* ag = agents[i];
+			dtCrowdAgentSnapshot* s = &states[i];
+			s->idx = getAgentIndex(ag);
+			dtVcopy(s->pos, ag->npos);
+			dtVcopy(s->vel, ag->vel);
+			dtVcopy(s->targetPos, ag->targetPos);
+			s->targetRef = ag->targetRef;
+			s->state = ag->state;
+			s->targetState = ag->targetState;
+		}
+		m_snapshots.endPublish(nagents, m_updateFrame);
+	}
+	
+#ifdef DT_QUERY_STATS
+	m_pathq.getQueryStats(&m_queryStats);
+	for (int i = 0; i < queryCount; ++i)
+		dtAddQueryStats(&m_queryStats, &queries[i]->getStats());
+#endif
+
+	lapTime(m_updateClock, times.other, stageStart);
+	if (m_updateClock)
+		times.total = stageStart - startTime;
 }
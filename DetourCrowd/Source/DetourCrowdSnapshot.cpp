@@ -0,0 +1,137 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#include <string.h>
+#include "DetourCrowdSnapshot.h"
+#include "DetourAtomic.h"
+#include "DetourCommon.h"
+
+dtCrowdSnapshotBuffer::dtCrowdSnapshotBuffer() :
+	m_allocator(dtGetDefaultAllocator()),
+	m_states(0),
+	m_maxStates(0),
+	m_latest(0),
+	m_writing(-1)
+{
+	memset(m_buffers, 0, sizeof(m_buffers));
+}
+
+dtCrowdSnapshotBuffer::~dtCrowdSnapshotBuffer()
+{
+	purge();
+}
+
+void dtCrowdSnapshotBuffer::purge()
+{
+	m_allocator->free(m_states);
+	m_states = 0;
+	m_maxStates = 0;
+	m_latest = 0;
+	m_writing = -1;
+	memset(m_buffers, 0, sizeof(m_buffers));
+}
+
+bool dtCrowdSnapshotBuffer::init(const int maxStates, dtAllocator* allocator)
+{
+	purge();
+	m_allocator = allocator ? allocator : dtGetDefaultAllocator();
+
+	if (maxStates <= 0)
+		return maxStates == 0;
+
+	m_states = (dtCrowdAgentSnapshot*)m_allocator->alloc(sizeof(dtCrowdAgentSnapshot)*maxStates*DT_CROWD_SNAPSHOT_BUFFERS, DT_ALLOC_PERM);
+	if (!m_states)
+		return false;
+	m_maxStates = maxStates;
+	for (int i = 0; i < DT_CROWD_SNAPSHOT_BUFFERS; ++i)
+		m_buffers[i].states = &m_states[i*maxStates];
+
+	return true;
+}
+
+size_t dtCrowdSnapshotBuffer::getMemUsed() const
+{
+	return m_states ? sizeof(dtCrowdAgentSnapshot)*m_maxStates*DT_CROWD_SNAPSHOT_BUFFERS : 0;
+}
+
+dtCrowdAgentSnapshot* dtCrowdSnapshotBuffer::beginPublish()
+{
+	if (!m_states)
+		return 0;
+
+	// Write over the buffer after the latest one, the oldest of them.
+	const int idx = (int)(m_latest % DT_CROWD_SNAPSHOT_BUFFERS);
+	Buffer& buf = m_buffers[idx];
+	dtAtomicStore(&buf.seq, buf.seq + 1);
+	dtAtomicFence();
+	m_writing = idx;
+	return buf.states;
+}
+
+void dtCrowdSnapshotBuffer::endPublish(const int count, const unsigned int frame)
+{
+	if (m_writing < 0)
+		return;
+
+	Buffer& buf = m_buffers[m_writing];
+	buf.count = dtClamp(count, 0, m_maxStates);
+	buf.frame = frame;
+	dtAtomicStore(&buf.seq, buf.seq + 1);
+	dtAtomicStore(&m_latest, (unsigned int)m_writing + 1);
+	m_writing = -1;
+}
+
+/// @par
+///
+/// A reader that is preempted for longer than two publishes may find the
+/// buffer it copied rewritten, in which case it copies the latest buffer again.
+dtStatus dtCrowdSnapshotBuffer::read(dtCrowdAgentSnapshot* states, int* stateCount, const int maxStates,
+									  unsigned int* frame) const
+{
+	if (!stateCount || (!states && maxStates > 0) || maxStates < 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	*stateCount = 0;
+
+	for (;;)
+	{
+		const unsigned int latest = dtAtomicLoad(&m_latest);
+		if (!latest)
+			return DT_FAILURE;
+
+		const Buffer& buf = m_buffers[latest - 1];
+		const unsigned int seq = dtAtomicLoad(&buf.seq);
+		if (seq & 1)
+			continue;
+
+		const int count = buf.count;
+		const unsigned int bufFrame = buf.frame;
+		const int n = dtMin(count, maxStates);
+		if (n > 0)
+			memcpy(states, buf.states, sizeof(dtCrowdAgentSnapshot)*n);
+
+		dtAtomicFence();
+		if (dtAtomicLoad(&buf.seq) != seq)
+			continue;
+
+		*stateCount = n;
+		if (frame)
+			*frame = bufFrame;
+		return n < count ? (DT_SUCCESS | DT_BUFFER_TOO_SMALL) : DT_SUCCESS;
+	}
+}
@@ -0,0 +1,222 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <string.h>
+#include "DetourFlowField.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+
+
+static unsigned int hashFlowRef(dtPolyRef ref)
+{
+	unsigned int h = (unsigned int)ref;
+#ifdef DT_POLYREF64
+	h ^= (unsigned int)(ref >> 32) * 0x9e3779b1u;
+#endif
+	h ^= h >> 16;
+	h *= 0x7feb352du;
+	h ^= h >> 15;
+	return h;
+}
+
+dtFlowField::dtFlowField() :
+	m_allocator(dtGetDefaultAllocator()),
+	m_navquery(0),
+	m_refs(0),
+	m_parents(0),
+	m_costs(0),
+	m_npolys(0),
+	m_maxPolys(0),
+	m_slots(0),
+	m_slotMask(0),
+	m_targetRef(0)
+{
+	dtVset(m_targetPos, 0,0,0);
+}
+
+dtFlowField::~dtFlowField()
+{
+	purge();
+}
+
+void dtFlowField::purge()
+{
+	dtFreeObject(m_allocator, m_navquery);
+	m_navquery = 0;
+	m_allocator->free(m_refs);
+	m_refs = 0;
+	m_allocator->free(m_parents);
+	m_parents = 0;
+	m_allocator->free(m_costs);
+	m_costs = 0;
+	m_allocator->free(m_slots);
+	m_slots = 0;
+	m_npolys = 0;
+	m_maxPolys = 0;
+	m_slotMask = 0;
+	m_targetRef = 0;
+}
+
+bool dtFlowField::init(const dtNavMesh* nav, const int maxPolys, dtAllocator* allocator)
+{
+	purge();
+	m_allocator = allocator ? allocator : dtGetDefaultAllocator();
+
+	if (!nav || maxPolys <= 0 || maxPolys > 65535)
+		return false;
+
+	m_navquery = dtAllocObject<dtNavMeshQuery>(m_allocator);
+	if (!m_navquery)
+		return false;
+	if (dtStatusFailed(m_navquery->init(nav, maxPolys, 0, m_allocator)))
+		return false;
+
+	// Keep the table at most half full.
+	unsigned int slotCount = 1;
+	while (slotCount < (unsigned int)maxPolys*2)
+		slotCount <<= 1;
+
+	m_refs = (dtPolyRef*)m_allocator->alloc(sizeof(dtPolyRef)*maxPolys, DT_ALLOC_PERM);
+	m_parents = (dtPolyRef*)m_allocator->alloc(sizeof(dtPolyRef)*maxPolys, DT_ALLOC_PERM);
+	m_costs = (float*)m_allocator->alloc(sizeof(float)*maxPolys, DT_ALLOC_PERM);
+	m_slots = (int*)m_allocator->alloc(sizeof(int)*slotCount, DT_ALLOC_PERM);
+	if (!m_refs || !m_parents || !m_costs || !m_slots)
+		return false;
+
+	m_maxPolys = maxPolys;
+	m_slotMask = slotCount-1;
+	memset(m_slots, 0xff, sizeof(int)*slotCount);
+
+	return true;
+}
+
+size_t dtFlowField::getMemUsed() const
+{
+	size_t size = m_navquery ? m_navquery->getMemUsed() : 0;
+	if (m_slots)
+		size += (sizeof(dtPolyRef)*2 + sizeof(float))*m_maxPolys + sizeof(int)*(m_slotMask+1);
+	return size;
+}
+
+dtStatus dtFlowField::build(dtPolyRef targetRef, const float* targetPos, const float radius, const dtQueryFilter* filter)
+{
+	if (!m_navquery)
+		return DT_FAILURE;
+
+	// Clear the previous field.
+	for (int i = 0; i < m_npolys; ++i)
+	{
+		unsigned int slot = hashFlowRef(m_refs[i]) & m_slotMask;
+		while (m_slots[slot] != i)
+			slot = (slot+1) & m_slotMask;
+		m_slots[slot] = -1;
+	}
+	m_npolys = 0;
+	m_targetRef = 0;
+
+	// The search tree rooted at the target gives the next polygon towards the
+	// target as the parent of each polygon.
+	int npolys = 0;
+	const dtStatus status = m_navquery->findPolysAroundCircle(targetRef, targetPos, radius, filter,
+															  m_refs, m_parents, m_costs, &npolys, m_maxPolys);
+	if (dtStatusFailed(status))
+		return status;
+
+	for (int i = 0; i < npolys; ++i)
+	{
+		unsigned int slot = hashFlowRef(m_refs[i]) & m_slotMask;
+		while (m_slots[slot] != -1)
+			slot = (slot+1) & m_slotMask;
+		m_slots[slot] = i;
+	}
+	m_npolys = npolys;
+	m_targetRef = targetRef;
+	dtVcopy(m_targetPos, targetPos);
+
+	return status;
+}
+
+int dtFlowField::findPoly(dtPolyRef ref) const
+{
+	if (!m_slots || !ref)
+		return -1;
+	unsigned int slot = hashFlowRef(ref) & m_slotMask;
+	while (m_slots[slot] != -1)
+	{
+		if (m_refs[m_slots[slot]] == ref)
+			return m_slots[slot];
+		slot = (slot+1) & m_slotMask;
+	}
+	return -1;
+}
+
+bool dtFlowField::hasLink(dtPolyRef from, dtPolyRef to) const
+{
+	// The search follows the links from the target outwards, the links the
+	// other way are missing at one-way off-mesh connections.
+	const dtNavMesh* nav = m_navquery->getAttachedNavMesh();
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	nav->getTileAndPolyByRefUnsafe(from, &tile, &poly);
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+	{
+		if (tile->links[i].ref == to)
+			return true;
+	}
+	return false;
+}
+
+int dtFlowField::getPath(dtPolyRef startRef, dtPolyRef* path, const int maxPath) const
+{
+	int idx = findPoly(startRef);
+	if (idx == -1)
+		return 0;
+
+	// The polygons may have been removed since the field was built.
+	const dtNavMesh* nav = m_navquery->getAttachedNavMesh();
+	int n = 0;
+	while (n < maxPath)
+	{
+		const dtPolyRef ref = m_refs[idx];
+		if (!nav->isValidPolyRef(ref))
+			return 0;
+		path[n++] = ref;
+		const dtPolyRef next = m_parents[idx];
+		if (!next)
+			return n;
+		if (!hasLink(ref, next))
+			return 0;
+		idx = findPoly(next);
+		if (idx == -1)
+			return 0;
+	}
+
+	// The target is further than the path can hold.
+	return 0;
+}
+
+bool dtFlowField::getCost(dtPolyRef ref, float* cost) const
+{
+	const int idx = findPoly(ref);
+	if (idx == -1)
+		return false;
+	*cost = m_costs[idx];
+	return true;
+}
@@ -22,17 +22,205 @@
 #include "DetourNavMeshQuery.h"
 #include "DetourCommon.h"
 #include "DetourAssert.h"
+#include "DetourAlloc.h"
+
+
+static const int MAX_SEGS_PER_POLY = DT_VERTS_PER_POLYGON*3;
+
+static inline unsigned int hashWallPoly(dtPolyRef ref, const dtQueryFilter* filter)
+{
+	// The filter is part of the key because the portals rejected by the filter are walls.
+	unsigned int h = (unsigned int)ref;
+#ifdef DT_POLYREF64
+	h ^= (unsigned int)(ref >> 32) * 0x9e3779b1u;
+#endif
+	h ^= (unsigned int)((size_t)filter >> 4) * 0x85ebca6bu;
+	h ^= h >> 16;
+	h *= 0x7feb352du;
+	h ^= h >> 15;
+	return h;
+}
+
+dtWallSegmentCache::dtWallSegmentCache() :
+	m_allocator(dtGetDefaultAllocator()),
+	m_entries(0),
+	m_nentries(0),
+	m_maxEntries(0),
+	m_slots(0),
+	m_slotMask(0),
+	m_segs(0),
+	m_nsegs(0),
+	m_maxSegs(0)
+{
+}
+
+dtWallSegmentCache::~dtWallSegmentCache()
+{
+	m_allocator->free(m_entries);
+	m_allocator->free(m_slots);
+	m_allocator->free(m_segs);
+}
+
+bool dtWallSegmentCache::init(const int maxPolys, const int maxSegs, dtAllocator* allocator)
+{
+	m_allocator->free(m_entries);
+	m_allocator->free(m_slots);
+	m_allocator->free(m_segs);
+	m_entries = 0;
+	m_slots = 0;
+	m_segs = 0;
+	m_allocator = allocator ? allocator : dtGetDefaultAllocator();
+	m_nentries = 0;
+	m_maxEntries = 0;
+	m_nsegs = 0;
+	m_maxSegs = 0;
+
+	if (maxPolys <= 0 || maxSegs <= 0)
+		return false;
+
+	// Keep the table at most half full.
+	unsigned int slotCount = 1;
+	while (slotCount < (unsigned int)maxPolys*2)
+		slotCount <<= 1;
+
+	m_entries = (Entry*)m_allocator->alloc(sizeof(Entry)*maxPolys, DT_ALLOC_PERM);
+	m_slots = (int*)m_allocator->alloc(sizeof(int)*slotCount, DT_ALLOC_PERM);
+	m_segs = (float*)m_allocator->alloc(sizeof(float)*6*maxSegs, DT_ALLOC_PERM);
+	if (!m_entries || !m_slots || !m_segs)
+		return false;
+
+	m_maxEntries = maxPolys;
+	m_maxSegs = maxSegs;
+	m_slotMask = slotCount-1;
+	memset(m_slots, 0xff, sizeof(int)*slotCount);
+
+	return true;
+}
+
+size_t dtWallSegmentCache::getMemUsed() const
+{
+	if (!m_entries)
+		return 0;
+	return sizeof(Entry)*m_maxEntries + sizeof(int)*(m_slotMask+1) + sizeof(float)*6*m_maxSegs;
+}
+
+void dtWallSegmentCache::clear()
+{
+	if (!m_slots)
+		return;
+	// Only the slots of the added entries need to be cleared.
+	for (int i = 0; i < m_nentries; ++i)
+		m_slots[m_entries[i].slot] = -1;
+	m_nentries = 0;
+	m_nsegs = 0;
+}
+
+int dtWallSegmentCache::findEntry(dtPolyRef ref, const dtQueryFilter* filter, unsigned int& slot) const
+{
+	slot = hashWallPoly(ref, filter) & m_slotMask;
+	while (m_slots[slot] != -1)
+	{
+		const Entry& e = m_entries[m_slots[slot]];
+		if (e.ref == ref && e.filter == filter)
+			return m_slots[slot];
+		slot = (slot+1) & m_slotMask;
+	}
+	return -1;
+}
+
+bool dtWallSegmentCache::addPoly(dtPolyRef ref, const dtQueryFilter* filter, const dtNavMeshQuery* navquery)
+{
+	if (!m_slots)
+		return false;
+
+	unsigned int slot;
+	if (findEntry(ref, filter, slot) != -1)
+		return true;
+	if (m_nentries >= m_maxEntries)
+		return false;
+
+	// A polygon is only cached if all of its segments fit.
+	int nsegs = 0;
+	const int maxSegs = dtMin(MAX_SEGS_PER_POLY, m_maxSegs - m_nsegs);
+	const dtStatus status = navquery->getPolyWallSegments(ref, filter, &m_segs[m_nsegs*6], 0, &nsegs, maxSegs);
+	if (dtStatusFailed(status) || dtStatusDetail(status, DT_BUFFER_TOO_SMALL))
+		return false;
+
+	Entry& e = m_entries[m_nentries];
+	e.ref = ref;
+	e.filter = filter;
+	e.firstSeg = m_nsegs;
+	e.nsegs = nsegs;
+	e.slot = slot;
+	m_slots[slot] = m_nentries;
+	m_nentries++;
+	m_nsegs += nsegs;
+
+	return true;
+}
+
+bool dtWallSegmentCache::getSegments(dtPolyRef ref, const dtQueryFilter* filter, const float** segs, int* nsegs) const
+{
+	if (!m_slots)
+		return false;
+
+	unsigned int slot;
+	const int idx = findEntry(ref, filter, slot);
+	if (idx == -1)
+		return false;
+
+	*segs = &m_segs[m_entries[idx].firstSeg*6];
+	*nsegs = m_entries[idx].nsegs;
+	return true;
+}
 
 
 dtLocalBoundary::dtLocalBoundary() :
+	m_allocator(dtGetDefaultAllocator()),
+	m_segs(0),
 	m_nsegs(0),
-	m_npolys(0)
+	m_maxSegs(0),
+	m_polys(0),
+	m_npolys(0),
+	m_maxPolys(0)
 {
 	dtVset(m_center, FLT_MAX,FLT_MAX,FLT_MAX);
 }
 
 dtLocalBoundary::~dtLocalBoundary()
 {
+	m_allocator->free(m_segs);
+	m_allocator->free(m_polys);
+}
+
+bool dtLocalBoundary::init(const int maxSegs, const int maxPolys, dtAllocator* allocator)
+{
+	m_allocator->free(m_segs);
+	m_allocator->free(m_polys);
+	m_segs = 0;
+	m_polys = 0;
+	m_allocator = allocator ? allocator : dtGetDefaultAllocator();
+	m_maxSegs = 0;
+	m_maxPolys = 0;
+	reset();
+
+	if (maxSegs <= 0 || maxPolys <= 0)
+		return false;
+
+	m_segs = (Segment*)m_allocator->alloc(sizeof(Segment)*maxSegs, DT_ALLOC_PERM);
+	m_polys = (dtPolyRef*)m_allocator->alloc(sizeof(dtPolyRef)*maxPolys, DT_ALLOC_PERM);
+	if (!m_segs || !m_polys)
+		return false;
+
+	m_maxSegs = maxSegs;
+	m_maxPolys = maxPolys;
+
+	return true;
+}
+
+size_t dtLocalBoundary::getMemUsed() const
+{
+	return sizeof(Segment)*m_maxSegs + sizeof(dtPolyRef)*m_maxPolys;
 }
 
 void dtLocalBoundary::reset()
@@ -54,7 +242,7 @@ void dtLocalBoundary::addSegment(const float dist, const float* s)
 	else if (dist >= m_segs[m_nsegs-1].d)
 	{
 		// Further than the last segment, skip.
-		if (m_nsegs >= MAX_LOCAL_SEGS)
+		if (m_nsegs >= m_maxSegs)
 			return;
 		// Last, trivial accept.
 		seg = &m_segs[m_nsegs];
@@ -67,8 +255,8 @@ void dtLocalBoundary::addSegment(const float dist, const float* s)
 			if (dist <= m_segs[i].d)
 				break;
 		const int tgt = i+1;
-		const int n = dtMin(m_nsegs-i, MAX_LOCAL_SEGS-tgt);
-		dtAssert(tgt+n <= MAX_LOCAL_SEGS);
+		const int n = dtMin(m_nsegs-i, m_maxSegs-tgt);
+		dtAssert(tgt+n <= m_maxSegs);
 		if (n > 0)
 			memmove(&m_segs[tgt], &m_segs[i], sizeof(Segment)*n);
 		seg = &m_segs[i];
@@ -77,42 +265,59 @@ void dtLocalBoundary::addSegment(const float dist, const float* s)
 	seg->d = dist;
 	memcpy(seg->s, s, sizeof(float)*6);
 	
-	if (m_nsegs < MAX_LOCAL_SEGS)
+	if (m_nsegs < m_maxSegs)
 		m_nsegs++;
 }
 
 void dtLocalBoundary::update(dtPolyRef ref, const float* pos, const float collisionQueryRange,
-							 dtNavMeshQuery* navquery, const dtQueryFilter* filter)
+							 dtNavMeshQuery* navquery, const dtQueryFilter* filter,
+							 dtNavMeshNeighbourhood* neighbourhood)
 {
-	static const int MAX_SEGS_PER_POLY = DT_VERTS_PER_POLYGON*3;
-	
-	if (!ref)
+	updatePolys(ref, pos, collisionQueryRange, navquery, filter, neighbourhood);
+	updateSegments(collisionQueryRange, navquery, filter, 0);
+}
+
+void dtLocalBoundary::updatePolys(dtPolyRef ref, const float* pos, const float collisionQueryRange,
+								  dtNavMeshQuery* navquery, const dtQueryFilter* filter,
+								  dtNavMeshNeighbourhood* neighbourhood)
+{
+	m_nsegs = 0;
+	m_npolys = 0;
+
+	if (!ref || !m_maxPolys)
 	{
 		dtVset(m_center, FLT_MAX,FLT_MAX,FLT_MAX);
-		m_nsegs = 0;
-		m_npolys = 0;
 		return;
 	}
 	
 	dtVcopy(m_center, pos);
 	
-	// First query non-overlapping polygons.
-	navquery->findLocalNeighbourhood(ref, pos, collisionQueryRange,
-									 filter, m_polys, 0, &m_npolys, MAX_LOCAL_POLYS);
-	
-	// Secondly, store all polygon edges.
+	// Query non-overlapping polygons.
+	navquery->findLocalNeighbourhood(ref, pos, collisionQueryRange, filter, neighbourhood,
+									 m_polys, 0, &m_npolys, m_maxPolys);
+}
+
+void dtLocalBoundary::updateSegments(const float collisionQueryRange, dtNavMeshQuery* navquery,
+									 const dtQueryFilter* filter, const dtWallSegmentCache* cache)
+{
+	// Store all polygon edges.
 	m_nsegs = 0;
 	float segs[MAX_SEGS_PER_POLY*6];
-	int nsegs = 0;
 	for (int j = 0; j < m_npolys; ++j)
 	{
-		navquery->getPolyWallSegments(m_polys[j], filter, segs, 0, &nsegs, MAX_SEGS_PER_POLY);
+		const float* polySegs = 0;
+		int nsegs = 0;
+		if (!cache || !cache->getSegments(m_polys[j], filter, &polySegs, &nsegs))
+		{
+			navquery->getPolyWallSegments(m_polys[j], filter, segs, 0, &nsegs, MAX_SEGS_PER_POLY);
+			polySegs = segs;
+		}
 		for (int k = 0; k < nsegs; ++k)
 		{
-			const float* s = &segs[k*6];
+			const float* s = &polySegs[k*6];
 			// Skip too distant segments.
 			float tseg;
-			const float distSqr = dtDistancePtSegSqr2D(pos, s, s+3, tseg);
+			const float distSqr = dtDistancePtSegSqr2D(m_center, s, s+3, tseg);
 			if (distSqr > dtSqr(collisionQueryRange))
 				continue;
 			addSegment(distSqr, s);
@@ -120,7 +325,31 @@ void dtLocalBoundary::update(dtPolyRef ref, const float* pos, const float collis
 	}
 }
 
-bool dtLocalBoundary::isValid(dtNavMeshQuery* navquery, const dtQueryFilter* filter)
+void dtLocalBoundary::copyPolys(const dtLocalBoundary& src, const float* pos)
+{
+	m_nsegs = 0;
+	m_npolys = dtMin(src.m_npolys, m_maxPolys);
+	if (!m_npolys)
+	{
+		dtVset(m_center, FLT_MAX,FLT_MAX,FLT_MAX);
+		return;
+	}
+
+	dtVcopy(m_center, pos);
+	memcpy(m_polys, src.m_polys, sizeof(dtPolyRef)*m_npolys);
+}
+
+bool dtLocalBoundary::hasPoly(dtPolyRef ref) const
+{
+	for (int i = 0; i < m_npolys; ++i)
+	{
+		if (m_polys[i] == ref)
+			return true;
+	}
+	return false;
+}
+
+bool dtLocalBoundary::isValid(dtNavMeshQuery* navquery, const dtQueryFilter* filter) const
 {
 	if (!m_npolys)
 		return false;
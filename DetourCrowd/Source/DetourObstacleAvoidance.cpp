@@ -25,8 +25,18 @@
 #include <float.h>
 #include <new>
 
+// Define DT_NO_SIMD to evaluate the candidate velocities one at a time on all platforms.
+#if defined(DT_NO_SIMD)
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DT_AVOIDANCE_SSE2
+#endif
+
 static const float DT_PI = 3.14159265f;
 
+/// The number of candidate velocities evaluated together.
+static const int DT_SAMPLE_PACKET_SIZE = 4;
+
 static int sweepCircleCircle(const float* c0, const float r0, const float* v,
 							 const float* c1, const float r1,
 							 float& tmin, float& tmax)
@@ -67,6 +77,188 @@ static int isectRaySeg(const float* ap, const float* u,
 	return 1;
 }
 
+// The ORCA solver below follows the linear programs of RVO2,
+// see "Reciprocal n-body Collision Avoidance" by van den Berg et al.
+// The 2D vectors are the xz-components of the 3D vectors.
+
+static const float DT_ORCA_EPS = 0.00001f;
+
+/// Time in which overlapping obstacles are resolved, in seconds.
+static const float DT_ORCA_COLLISION_TIME = 0.1f;
+
+inline float orcaDet(const float* a, const float* b)
+{
+	return a[0]*b[2] - a[2]*b[0];
+}
+
+inline void orcaSet(float* dest, const float x, const float z)
+{
+	dest[0] = x;
+	dest[1] = 0;
+	dest[2] = z;
+}
+
+// Returns true if the velocity is outside the half-plane of the line.
+inline bool orcaViolates(const dtObstacleLine& line, const float* v)
+{
+	float d[3];
+	dtVsub(d, line.p, v);
+	return orcaDet(line.dir, d) > 0.0f;
+}
+
+// Finds the point on the line closest to the optimal velocity, within the speed
+// circle and the half-planes of the previous lines.
+static bool orcaLinearProgram1(const dtObstacleLine* lines, const int lineNo, const float radius,
+							   const float* optVel, const bool directionOpt, float* result)
+{
+	const dtObstacleLine& line = lines[lineNo];
+	const float dot = dtVdot2D(line.p, line.dir);
+	const float discriminant = dtSqr(dot) + dtSqr(radius) - dtVdot2D(line.p, line.p);
+	if (discriminant < 0.0f)
+		return false; // The speed circle invalidates the line.
+
+	const float sqrtDiscriminant = dtMathSqrtf(discriminant);
+	float tLeft = -dot - sqrtDiscriminant;
+	float tRight = -dot + sqrtDiscriminant;
+
+	for (int i = 0; i < lineNo; ++i)
+	{
+		float d[3];
+		dtVsub(d, line.p, lines[i].p);
+		const float denominator = orcaDet(line.dir, lines[i].dir);
+		const float numerator = orcaDet(lines[i].dir, d);
+
+		if (dtMathFabsf(denominator) <= DT_ORCA_EPS)
+		{
+			// The lines are almost parallel.
+			if (numerator < 0.0f)
+				return false;
+			continue;
+		}
+
+		const float t = numerator / denominator;
+		if (denominator >= 0.0f)
+			tRight = dtMin(tRight, t);
+		else
+			tLeft = dtMax(tLeft, t);
+
+		if (tLeft > tRight)
+			return false;
+	}
+
+	float t;
+	if (directionOpt)
+	{
+		t = dtVdot2D(optVel, line.dir) > 0.0f ? tRight : tLeft;
+	}
+	else
+	{
+		float d[3];
+		dtVsub(d, optVel, line.p);
+		t = dtClamp(dtVdot2D(line.dir, d), tLeft, tRight);
+	}
+	dtVmad(result, line.p, line.dir, t);
+	result[1] = 0;
+	return true;
+}
+
+// Finds the velocity closest to the optimal velocity permitted by all the lines.
+// Returns the index of the line which failed, or nlines on success.
+static int orcaLinearProgram2(const dtObstacleLine* lines, const int nlines, const float radius,
+							  const float* optVel, const bool directionOpt, float* result)
+{
+	if (directionOpt)
+	{
+		// The optimal velocity is a unit direction.
+		orcaSet(result, optVel[0]*radius, optVel[2]*radius);
+	}
+	else if (dtVdot2D(optVel, optVel) > dtSqr(radius))
+	{
+		const float s = radius / dtMathSqrtf(dtVdot2D(optVel, optVel));
+		orcaSet(result, optVel[0]*s, optVel[2]*s);
+	}
+	else
+	{
+		orcaSet(result, optVel[0], optVel[2]);
+	}
+
+	for (int i = 0; i < nlines; ++i)
+	{
+		if (orcaViolates(lines[i], result))
+		{
+			float prev[3];
+			dtVcopy(prev, result);
+			if (!orcaLinearProgram1(lines, i, radius, optVel, directionOpt, result))
+			{
+				dtVcopy(result, prev);
+				return i;
+			}
+		}
+	}
+	return nlines;
+}
+
+// Finds the velocity which minimizes the maximum violation of the agent lines,
+// while keeping the first nfixed lines satisfied.
+static void orcaLinearProgram3(const dtObstacleLine* lines, const int nlines, const int nfixed, const int first,
+							   const float radius, dtObstacleLine* projLines, float* result)
+{
+	float distance = 0.0f;
+
+	for (int i = first; i < nlines; ++i)
+	{
+		const dtObstacleLine& line = lines[i];
+		float d[3];
+		dtVsub(d, line.p, result);
+		if (orcaDet(line.dir, d) <= distance)
+			continue;
+
+		// The result does not satisfy the constraint of the line.
+		memcpy(projLines, lines, sizeof(dtObstacleLine)*nfixed);
+		int nproj = nfixed;
+
+		for (int j = nfixed; j < i; ++j)
+		{
+			const dtObstacleLine& other = lines[j];
+			dtObstacleLine& proj = projLines[nproj];
+
+			const float determinant = orcaDet(line.dir, other.dir);
+			if (dtMathFabsf(determinant) <= DT_ORCA_EPS)
+			{
+				// The lines are parallel.
+				if (dtVdot2D(line.dir, other.dir) > 0.0f)
+					continue; // Same direction.
+				orcaSet(proj.p, 0.5f*(line.p[0] + other.p[0]), 0.5f*(line.p[2] + other.p[2]));
+			}
+			else
+			{
+				dtVsub(d, line.p, other.p);
+				dtVmad(proj.p, line.p, line.dir, orcaDet(other.dir, d) / determinant);
+				proj.p[1] = 0;
+			}
+
+			orcaSet(proj.dir, other.dir[0] - line.dir[0], other.dir[2] - line.dir[2]);
+			dtVnormalize(proj.dir);
+			nproj++;
+		}
+
+		float prev[3];
+		dtVcopy(prev, result);
+		float optDir[3];
+		orcaSet(optDir, -line.dir[2], line.dir[0]);
+		if (orcaLinearProgram2(projLines, nproj, radius, optDir, true, result) < nproj)
+		{
+			// This should in principle not happen, the result is by definition
+			// already in the feasible region of this linear program. If it fails,
+			// it is due to small floating point error, and the current result is kept.
+			dtVcopy(result, prev);
+		}
+
+		dtVsub(d, line.p, result);
+		distance = orcaDet(line.dir, d);
+	}
+}
+
 
 
 dtObstacleAvoidanceDebugData* dtAllocObstacleAvoidanceDebugData()
@@ -207,6 +399,7 @@ void dtFreeObstacleAvoidanceQuery(dtObstacleAvoidanceQuery* ptr)
 
 
 dtObstacleAvoidanceQuery::dtObstacleAvoidanceQuery() :
+	m_allocator(dtGetDefaultAllocator()),
 	m_invHorizTime(0),
 	m_vmax(0),
 	m_invVmax(0),
@@ -215,35 +408,66 @@ dtObstacleAvoidanceQuery::dtObstacleAvoidanceQuery() :
 	m_ncircles(0),
 	m_maxSegments(0),
 	m_segments(0),
-	m_nsegments(0)
+	m_nsegments(0),
+	m_lines(0),
+	m_projLines(0)
 {
 }
 
 dtObstacleAvoidanceQuery::~dtObstacleAvoidanceQuery()
 {
-	dtFree(m_circles);
-	dtFree(m_segments);
+	m_allocator->free(m_circles);
+	m_allocator->free(m_segments);
+	m_allocator->free(m_lines);
+	m_allocator->free(m_projLines);
 }
 
-bool dtObstacleAvoidanceQuery::init(const int maxCircles, const int maxSegments)
+bool dtObstacleAvoidanceQuery::init(const int maxCircles, const int maxSegments, dtAllocator* allocator)
 {
+	m_allocator->free(m_circles);
+	m_allocator->free(m_segments);
+	m_allocator->free(m_lines);
+	m_allocator->free(m_projLines);
+	m_circles = 0;
+	m_segments = 0;
+	m_lines = 0;
+	m_projLines = 0;
+	m_allocator = allocator ? allocator : dtGetDefaultAllocator();
+
 	m_maxCircles = maxCircles;
 	m_ncircles = 0;
-	m_circles = (dtObstacleCircle*)dtAlloc(sizeof(dtObstacleCircle)*m_maxCircles, DT_ALLOC_PERM);
+	m_circles = (dtObstacleCircle*)m_allocator->alloc(sizeof(dtObstacleCircle)*m_maxCircles, DT_ALLOC_PERM);
 	if (!m_circles)
 		return false;
 	memset(m_circles, 0, sizeof(dtObstacleCircle)*m_maxCircles);
 
 	m_maxSegments = maxSegments;
 	m_nsegments = 0;
-	m_segments = (dtObstacleSegment*)dtAlloc(sizeof(dtObstacleSegment)*m_maxSegments, DT_ALLOC_PERM);
+	m_segments = (dtObstacleSegment*)m_allocator->alloc(sizeof(dtObstacleSegment)*m_maxSegments, DT_ALLOC_PERM);
 	if (!m_segments)
 		return false;
 	memset(m_segments, 0, sizeof(dtObstacleSegment)*m_maxSegments);
+
+	const int maxLines = dtMax(m_maxCircles + m_maxSegments, 1);
+	m_lines = (dtObstacleLine*)m_allocator->alloc(sizeof(dtObstacleLine)*maxLines, DT_ALLOC_PERM);
+	if (!m_lines)
+		return false;
+	m_projLines = (dtObstacleLine*)m_allocator->alloc(sizeof(dtObstacleLine)*maxLines, DT_ALLOC_PERM);
+	if (!m_projLines)
+		return false;
 	
 	return true;
 }
 
+size_t dtObstacleAvoidanceQuery::getMemUsed() const
+{
+	if (!m_projLines)
+		return 0;
+	const int maxLines = dtMax(m_maxCircles + m_maxSegments, 1);
+	return sizeof(dtObstacleCircle)*m_maxCircles + sizeof(dtObstacleSegment)*m_maxSegments +
+		sizeof(dtObstacleLine)*maxLines*2;
+}
+
 void dtObstacleAvoidanceQuery::reset()
 {
 	m_ncircles = 0;
@@ -432,6 +656,204 @@ float dtObstacleAvoidanceQuery::processSample(const float* vcand, const float cs
 	return penalty;
 }
 
+#if defined(DT_AVOIDANCE_SSE2)
+namespace
+{
+/// Selects a where the mask is set and b elsewhere.
+inline __m128 dtSelect(const __m128 mask, const __m128 a, const __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+}
+#endif
+
+/* Calculate the collision penalties for a packet of velocity vectors and
+ * keep track of the best one.
+ *
+ * The result is the same as calling processSample for each of the candidates
+ * in order. The obstacles are tested against all of the candidates together,
+ * and the early out of processSample is applied afterwards: since the time
+ * of impact only decreases while the obstacles are visited, processSample
+ * bails out exactly when the final time of impact is below the threshold.
+ *
+ * @param vcands sampled velocities
+ * @param minPenalty best penalty so far, updated
+ * @param bestVel velocity of the best penalty so far, updated
+ */
+void dtObstacleAvoidanceQuery::processSamplePacket(const float* vcands, const int ncands, const float cs,
+												   const float* pos, const float rad,
+												   const float* vel, const float* dvel,
+												   float& minPenalty, float* bestVel,
+												   dtObstacleAvoidanceDebugData* debug)
+{
+#if defined(DT_AVOIDANCE_SSE2)
+	// Pad the unused lanes with the first candidate.
+	float cx[DT_SAMPLE_PACKET_SIZE], cz[DT_SAMPLE_PACKET_SIZE];
+	for (int i = 0; i < DT_SAMPLE_PACKET_SIZE; ++i)
+	{
+		const int k = i < ncands ? i : 0;
+		cx[i] = vcands[k*3+0];
+		cz[i] = vcands[k*3+2];
+	}
+	const __m128 vcx = _mm_loadu_ps(cx);
+	const __m128 vcz = _mm_loadu_ps(cz);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 two = _mm_set1_ps(2.0f);
+
+	// penalty for straying away from the desired and current velocities
+	const __m128 invVmax = _mm_set1_ps(m_invVmax);
+	__m128 dx = _mm_sub_ps(_mm_set1_ps(dvel[0]), vcx);
+	__m128 dz = _mm_sub_ps(_mm_set1_ps(dvel[2]), vcz);
+	const __m128 vvpen = _mm_mul_ps(_mm_set1_ps(m_params.weightDesVel),
+									_mm_mul_ps(_mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dz, dz))), invVmax));
+	dx = _mm_sub_ps(_mm_set1_ps(vel[0]), vcx);
+	dz = _mm_sub_ps(_mm_set1_ps(vel[2]), vcz);
+	const __m128 vvcpen = _mm_mul_ps(_mm_set1_ps(m_params.weightCurVel),
+									 _mm_mul_ps(_mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dz, dz))), invVmax));
+
+	// Find min time of impact and exit amongst all obstacles.
+	__m128 vtmin = _mm_set1_ps(m_params.horizTime);
+	__m128 vside = zero;
+
+	const __m128 vcx2 = _mm_mul_ps(vcx, two);
+	const __m128 vcz2 = _mm_mul_ps(vcz, two);
+	for (int i = 0; i < m_ncircles; ++i)
+	{
+		const dtObstacleCircle* cir = &m_circles[i];
+
+		// RVO
+		const __m128 vabx = _mm_sub_ps(_mm_sub_ps(vcx2, _mm_set1_ps(vel[0])), _mm_set1_ps(cir->vel[0]));
+		const __m128 vabz = _mm_sub_ps(_mm_sub_ps(vcz2, _mm_set1_ps(vel[2])), _mm_set1_ps(cir->vel[2]));
+
+		// Side
+		const __m128 dpv = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(cir->dp[0]), vabx), _mm_mul_ps(_mm_set1_ps(cir->dp[2]), vabz));
+		const __m128 npv = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(cir->np[0]), vabx), _mm_mul_ps(_mm_set1_ps(cir->np[2]), vabz));
+		__m128 sv = _mm_min_ps(_mm_add_ps(_mm_mul_ps(dpv, half), half), _mm_mul_ps(npv, two));
+		sv = dtSelect(_mm_cmplt_ps(sv, zero), zero, sv);
+		sv = dtSelect(_mm_cmpgt_ps(sv, one), one, sv);
+		vside = _mm_add_ps(vside, sv);
+
+		// Sweep the circles, see sweepCircleCircle.
+		const float sx = cir->p[0] - pos[0];
+		const float sz = cir->p[2] - pos[2];
+		const float r = rad + cir->rad;
+		const float c = (sx*sx + sz*sz) - r*r;
+		__m128 a = _mm_add_ps(_mm_mul_ps(vabx, vabx), _mm_mul_ps(vabz, vabz));
+		const __m128 b = _mm_add_ps(_mm_mul_ps(vabx, _mm_set1_ps(sx)), _mm_mul_ps(vabz, _mm_set1_ps(sz)));
+		const __m128 d = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(a, _mm_set1_ps(c)));
+		const __m128 isect = _mm_andnot_ps(_mm_or_ps(_mm_cmplt_ps(a, _mm_set1_ps(0.0001f)), _mm_cmplt_ps(d, zero)),
+										  _mm_castsi128_ps(_mm_set1_epi32(-1)));
+		a = _mm_div_ps(one, a);
+		const __m128 rd = _mm_sqrt_ps(d);
+		__m128 htmin = _mm_mul_ps(_mm_sub_ps(b, rd), a);
+		const __m128 htmax = _mm_mul_ps(_mm_add_ps(b, rd), a);
+
+		// Handle overlapping obstacles.
+		const __m128 overlap = _mm_and_ps(_mm_cmplt_ps(htmin, zero), _mm_cmpgt_ps(htmax, zero));
+		htmin = dtSelect(overlap, _mm_mul_ps(_mm_sub_ps(zero, htmin), half), htmin);
+
+		// The closest obstacle is somewhere ahead of us, keep track of nearest obstacle.
+		const __m128 closer = _mm_and_ps(isect, _mm_and_ps(_mm_cmpge_ps(htmin, zero), _mm_cmplt_ps(htmin, vtmin)));
+		vtmin = dtSelect(closer, htmin, vtmin);
+	}
+
+	for (int i = 0; i < m_nsegments; ++i)
+	{
+		const dtObstacleSegment* seg = &m_segments[i];
+		__m128 htmin, hit;
+
+		if (seg->touch)
+		{
+			// Special case when the agent is very close to the segment.
+			// If the velocity is pointing towards the segment, no collision.
+			const float sdx = seg->q[0] - seg->p[0];
+			const float sdz = seg->q[2] - seg->p[2];
+			const __m128 dn = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-sdz), vcx), _mm_mul_ps(_mm_set1_ps(sdx), vcz));
+			hit = _mm_andnot_ps(_mm_cmplt_ps(dn, zero), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+			htmin = zero;
+		}
+		else
+		{
+			// Intersect the velocity ray with the segment, see isectRaySeg.
+			const float vx = seg->q[0] - seg->p[0];
+			const float vz = seg->q[2] - seg->p[2];
+			const float wx = pos[0] - seg->p[0];
+			const float wz = pos[2] - seg->p[2];
+			__m128 d = _mm_sub_ps(_mm_mul_ps(vcz, _mm_set1_ps(vx)), _mm_mul_ps(vcx, _mm_set1_ps(vz)));
+			const __m128 parallel = _mm_cmplt_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), d), _mm_set1_ps(1e-6f));
+			d = _mm_div_ps(one, d);
+			const __m128 t = _mm_mul_ps(_mm_set1_ps(vz*wx - vx*wz), d);
+			const __m128 s = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(vcz, _mm_set1_ps(wx)), _mm_mul_ps(vcx, _mm_set1_ps(wz))), d);
+			const __m128 miss = _mm_or_ps(_mm_or_ps(parallel, _mm_or_ps(_mm_cmplt_ps(t, zero), _mm_cmpgt_ps(t, one))),
+										  _mm_or_ps(_mm_cmplt_ps(s, zero), _mm_cmpgt_ps(s, one)));
+			hit = _mm_andnot_ps(miss, _mm_castsi128_ps(_mm_set1_epi32(-1)));
+			htmin = t;
+		}
+
+		// Avoid less when facing walls.
+		htmin = _mm_mul_ps(htmin, two);
+
+		// The closest obstacle is somewhere ahead of us, keep track of nearest obstacle.
+		vtmin = dtSelect(_mm_and_ps(hit, _mm_cmplt_ps(htmin, vtmin)), htmin, vtmin);
+	}
+
+	float vpens[DT_SAMPLE_PACKET_SIZE], vcpens[DT_SAMPLE_PACKET_SIZE];
+	float tmins[DT_SAMPLE_PACKET_SIZE], sides[DT_SAMPLE_PACKET_SIZE];
+	_mm_storeu_ps(vpens, vvpen);
+	_mm_storeu_ps(vcpens, vvcpen);
+	_mm_storeu_ps(tmins, vtmin);
+	_mm_storeu_ps(sides, vside);
+
+	for (int i = 0; i < ncands; ++i)
+	{
+		const float* vcand = &vcands[i*3];
+		const float vpen = vpens[i];
+		const float vcpen = vcpens[i];
+
+		// find the threshold hit time to bail out based on the early out penalty
+		float minPen = minPenalty - vpen - vcpen;
+		float tThresold = (m_params.weightToi / minPen - 0.1f) * m_params.horizTime;
+		if (tThresold - m_params.horizTime > -FLT_EPSILON)
+			continue; // already too much
+		const float tmin = tmins[i];
+		if (tmin < tThresold)
+			continue;
+
+		// Normalize side bias, to prevent it dominating too much.
+		float side = sides[i];
+		if (m_ncircles)
+			side /= m_ncircles;
+
+		const float spen = m_params.weightSide * side;
+		const float tpen = m_params.weightToi * (1.0f/(0.1f+tmin*m_invHorizTime));
+
+		const float penalty = vpen + vcpen + spen + tpen;
+
+		// Store different penalties for debug viewing
+		if (debug)
+			debug->addSample(vcand, cs, penalty, vpen, vcpen, spen, tpen);
+
+		if (penalty < minPenalty)
+		{
+			minPenalty = penalty;
+			dtVcopy(bestVel, vcand);
+		}
+	}
+#else
+	for (int i = 0; i < ncands; ++i)
+	{
+		const float penalty = processSample(&vcands[i*3], cs, pos, rad, vel, dvel, minPenalty, debug);
+		if (penalty < minPenalty)
+		{
+			minPenalty = penalty;
+			dtVcopy(bestVel, &vcands[i*3]);
+		}
+	}
+#endif
+}
+
 int dtObstacleAvoidanceQuery::sampleVelocityGrid(const float* pos, const float rad, const float vmax,
 												 const float* vel, const float* dvel, float* nvel,
 												 const dtObstacleAvoidanceParams* params,
@@ -456,27 +878,30 @@ int dtObstacleAvoidanceQuery::sampleVelocityGrid(const float* pos, const float r
 		
 	float minPenalty = FLT_MAX;
 	int ns = 0;
+	float vcands[DT_SAMPLE_PACKET_SIZE*3];
+	int ncands = 0;
 		
 	for (int y = 0; y < m_params.gridSize; ++y)
 	{
 		for (int x = 0; x < m_params.gridSize; ++x)
 		{
-			float vcand[3];
+			float* vcand = &vcands[ncands*3];
 			vcand[0] = cvx + x*cs - half;
 			vcand[1] = 0;
 			vcand[2] = cvz + y*cs - half;
 			
 			if (dtSqr(vcand[0])+dtSqr(vcand[2]) > dtSqr(vmax+cs/2)) continue;
 			
-			const float penalty = processSample(vcand, cs, pos,rad,vel,dvel, minPenalty, debug);
 			ns++;
-			if (penalty < minPenalty)
+			if (++ncands == DT_SAMPLE_PACKET_SIZE)
 			{
-				minPenalty = penalty;
-				dtVcopy(nvel, vcand);
+				processSamplePacket(vcands, ncands, cs, pos,rad,vel,dvel, minPenalty, nvel, debug);
+				ncands = 0;
 			}
 		}
 	}
+	if (ncands)
+		processSamplePacket(vcands, ncands, cs, pos,rad,vel,dvel, minPenalty, nvel, debug);
 	
 	return ns;
 }
@@ -589,24 +1014,27 @@ int dtObstacleAvoidanceQuery::sampleVelocityAdaptive(const float* pos, const flo
 		float minPenalty = FLT_MAX;
 		float bvel[3];
 		dtVset(bvel, 0,0,0);
+		float vcands[DT_SAMPLE_PACKET_SIZE*3];
+		int ncands = 0;
 		
 		for (int i = 0; i < npat; ++i)
 		{
-			float vcand[3];
+			float* vcand = &vcands[ncands*3];
 			vcand[0] = res[0] + pat[i*2+0]*cr;
 			vcand[1] = 0;
 			vcand[2] = res[2] + pat[i*2+1]*cr;
 			
 			if (dtSqr(vcand[0])+dtSqr(vcand[2]) > dtSqr(vmax+0.001f)) continue;
 			
-			const float penalty = processSample(vcand,cr/10, pos,rad,vel,dvel, minPenalty, debug);
 			ns++;
-			if (penalty < minPenalty)
+			if (++ncands == DT_SAMPLE_PACKET_SIZE)
 			{
-				minPenalty = penalty;
-				dtVcopy(bvel, vcand);
+				processSamplePacket(vcands, ncands, cr/10, pos,rad,vel,dvel, minPenalty, bvel, debug);
+				ncands = 0;
 			}
 		}
+		if (ncands)
+			processSamplePacket(vcands, ncands, cr/10, pos,rad,vel,dvel, minPenalty, bvel, debug);
 
 		dtVcopy(res, bvel);
 
@@ -617,3 +1045,278 @@ int dtObstacleAvoidanceQuery::sampleVelocityAdaptive(const float* pos, const flo
 	
 	return ns;
 }
+
+int dtObstacleAvoidanceQuery::solveVelocityORCA(const float* pos, const float rad, const float vmax,
+												const float* vel, const float* dvel, float* nvel,
+												const dtObstacleAvoidanceParams* params,
+												dtObstacleAvoidanceDebugData* debug)
+{
+	memcpy(&m_params, params, sizeof(dtObstacleAvoidanceParams));
+	m_invHorizTime = 1.0f / m_params.horizTime;
+	m_vmax = vmax;
+	m_invVmax = vmax > 0 ? 1.0f / vmax : FLT_MAX;
+
+	dtVset(nvel, 0,0,0);
+
+	if (debug)
+		debug->reset();
+
+	const float invTau = m_invHorizTime;
+	int nlines = 0;
+
+	// Segments are static, and the agent takes the full responsibility of avoiding them.
+	for (int i = 0; i < m_nsegments; ++i)
+	{
+		const dtObstacleSegment* seg = &m_segments[i];
+
+		// Orient the segment so that the agent is on its right side.
+		float rp1[3], rp2[3];
+		dtVsub(rp1, seg->p, pos);
+		dtVsub(rp2, seg->q, pos);
+		float sdir[3];
+		dtVsub(sdir, rp2, rp1);
+		if (orcaDet(sdir, rp1) < 0.0f)
+		{
+			float tmp[3];
+			dtVcopy(tmp, rp1);
+			dtVcopy(rp1, rp2);
+			dtVcopy(rp2, tmp);
+			dtVsub(sdir, rp2, rp1);
+		}
+		const float segLenSq = dtVdot2D(sdir, sdir);
+		if (segLenSq < dtSqr(DT_ORCA_EPS))
+			continue;
+		float unitDir[3];
+		orcaSet(unitDir, sdir[0], sdir[2]);
+		dtVnormalize(unitDir);
+
+		// Skip the segment if it is already behind the previous segment lines.
+		bool covered = false;
+		for (int j = 0; j < nlines; ++j)
+		{
+			const dtObstacleLine& line = m_lines[j];
+			float d1[3], d2[3];
+			orcaSet(d1, invTau*rp1[0] - line.p[0], invTau*rp1[2] - line.p[2]);
+			orcaSet(d2, invTau*rp2[0] - line.p[0], invTau*rp2[2] - line.p[2]);
+			if (orcaDet(d1, line.dir) - invTau*rad >= -DT_ORCA_EPS &&
+				orcaDet(d2, line.dir) - invTau*rad >= -DT_ORCA_EPS)
+			{
+				covered = true;
+				break;
+			}
+		}
+		if (covered)
+			continue;
+
+		const float distSq1 = dtVdot2D(rp1, rp1);
+		const float distSq2 = dtVdot2D(rp2, rp2);
+		const float radSq = dtSqr(rad);
+		const float s = -dtVdot2D(rp1, sdir) / segLenSq;
+		float closest[3];
+		orcaSet(closest, -rp1[0] - s*sdir[0], -rp1[2] - s*sdir[2]);
+		const float distSqLine = dtVdot2D(closest, closest);
+
+		dtObstacleLine& line = m_lines[nlines];
+
+		if (s < 0.0f && distSq1 <= radSq)
+		{
+			// Collision with the first end point.
+			orcaSet(line.p, 0, 0);
+			orcaSet(line.dir, -rp1[2], rp1[0]);
+			dtVnormalize(line.dir);
+			nlines++;
+			continue;
+		}
+		if (s > 1.0f && distSq2 <= radSq)
+		{
+			// Collision with the second end point.
+			orcaSet(line.p, 0, 0);
+			orcaSet(line.dir, -rp2[2], rp2[0]);
+			dtVnormalize(line.dir);
+			nlines++;
+			continue;
+		}
+		if (s >= 0.0f && s <= 1.0f && distSqLine <= radSq)
+		{
+			// Collision with the segment.
+			orcaSet(line.p, 0, 0);
+			orcaSet(line.dir, -unitDir[0], -unitDir[2]);
+			nlines++;
+			continue;
+		}
+
+		// Find the legs of the velocity obstacle.
+		float leftLeg[3], rightLeg[3];
+		bool singlePoint = false;
+		if ((s < 0.0f || s > 1.0f) && distSqLine <= radSq)
+		{
+			// The segment is seen end on, one end point defines the velocity obstacle.
+			singlePoint = true;
+			if (s > 1.0f)
+				dtVcopy(rp1, rp2);
+			else
+				dtVcopy(rp2, rp1);
+			const float distSq = dtVdot2D(rp1, rp1);
+			const float leg = dtMathSqrtf(dtMax(distSq - radSq, 0.0f));
+			orcaSet(leftLeg, (rp1[0]*leg - rp1[2]*rad) / distSq, (rp1[0]*rad + rp1[2]*leg) / distSq);
+			orcaSet(rightLeg, (rp1[0]*leg + rp1[2]*rad) / distSq, (-rp1[0]*rad + rp1[2]*leg) / distSq);
+		}
+		else
+		{
+			const float leg1 = dtMathSqrtf(dtMax(distSq1 - radSq, 0.0f));
+			orcaSet(leftLeg, (rp1[0]*leg1 - rp1[2]*rad) / distSq1, (rp1[0]*rad + rp1[2]*leg1) / distSq1);
+			const float leg2 = dtMathSqrtf(dtMax(distSq2 - radSq, 0.0f));
+			orcaSet(rightLeg, (rp2[0]*leg2 + rp2[2]*rad) / distSq2, (-rp2[0]*rad + rp2[2]*leg2) / distSq2);
+		}
+
+		// Project the current velocity on the velocity obstacle, truncated by the horizon time.
+		float leftCutoff[3], rightCutoff[3], cutoffVec[3];
+		orcaSet(leftCutoff, invTau*rp1[0], invTau*rp1[2]);
+		orcaSet(rightCutoff, invTau*rp2[0], invTau*rp2[2]);
+		dtVsub(cutoffVec, rightCutoff, leftCutoff);
+
+		float vl[3], vr[3];
+		dtVsub(vl, vel, leftCutoff);
+		dtVsub(vr, vel, rightCutoff);
+		const float t = singlePoint ? 0.5f : dtVdot2D(vl, cutoffVec) / dtVdot2D(cutoffVec, cutoffVec);
+		const float tLeft = dtVdot2D(vl, leftLeg);
+		const float tRight = dtVdot2D(vr, rightLeg);
+
+		if ((t < 0.0f && tLeft < 0.0f) || (singlePoint && tLeft < 0.0f && tRight < 0.0f))
+		{
+			// Project on the left cutoff circle.
+			float w[3];
+			orcaSet(w, vl[0], vl[2]);
+			dtVnormalize(w);
+			orcaSet(line.dir, w[2], -w[0]);
+			orcaSet(line.p, leftCutoff[0] + rad*invTau*w[0], leftCutoff[2] + rad*invTau*w[2]);
+			nlines++;
+			continue;
+		}
+		if (t > 1.0f && tRight < 0.0f)
+		{
+			// Project on the right cutoff circle.
+			float w[3];
+			orcaSet(w, vr[0], vr[2]);
+			dtVnormalize(w);
+			orcaSet(line.dir, w[2], -w[0]);
+			orcaSet(line.p, rightCutoff[0] + rad*invTau*w[0], rightCutoff[2] + rad*invTau*w[2]);
+			nlines++;
+			continue;
+		}
+
+		// Project on the left leg, the right leg or the cutoff line, whichever is closest.
+		float d[3];
+		float distSqCutoff = FLT_MAX, distSqLeft = FLT_MAX, distSqRight = FLT_MAX;
+		if (!singlePoint && t >= 0.0f && t <= 1.0f)
+		{
+			dtVmad(d, leftCutoff, cutoffVec, t);
+			distSqCutoff = dtVdist2DSqr(vel, d);
+		}
+		if (tLeft >= 0.0f)
+		{
+			dtVmad(d, leftCutoff, leftLeg, tLeft);
+			distSqLeft = dtVdist2DSqr(vel, d);
+		}
+		if (tRight >= 0.0f)
+		{
+			dtVmad(d, rightCutoff, rightLeg, tRight);
+			distSqRight = dtVdist2DSqr(vel, d);
+		}
+
+		const float* base;
+		if (distSqCutoff <= distSqLeft && distSqCutoff <= distSqRight)
+		{
+			orcaSet(line.dir, -unitDir[0], -unitDir[2]);
+			base = leftCutoff;
+		}
+		else if (distSqLeft <= distSqRight)
+		{
+			orcaSet(line.dir, leftLeg[0], leftLeg[2]);
+			base = leftCutoff;
+		}
+		else
+		{
+			orcaSet(line.dir, -rightLeg[0], -rightLeg[2]);
+			base = rightCutoff;
+		}
+		orcaSet(line.p, base[0] - rad*invTau*line.dir[2], base[2] + rad*invTau*line.dir[0]);
+		nlines++;
+	}
+
+	const int nfixed = nlines;
+
+	// The other agents take half of the responsibility of avoiding a collision.
+	for (int i = 0; i < m_ncircles; ++i)
+	{
+		const dtObstacleCircle* cir = &m_circles[i];
+
+		float relPos[3], relVel[3];
+		orcaSet(relPos, cir->p[0] - pos[0], cir->p[2] - pos[2]);
+		orcaSet(relVel, vel[0] - cir->vel[0], vel[2] - cir->vel[2]);
+		const float distSq = dtVdot2D(relPos, relPos);
+		const float r = rad + cir->rad;
+		const float rSq = dtSqr(r);
+
+		dtObstacleLine& line = m_lines[nlines];
+		float u[3];
+
+		if (distSq > rSq)
+		{
+			// No collision, w is the vector from the cutoff center to the relative velocity.
+			float w[3];
+			orcaSet(w, relVel[0] - invTau*relPos[0], relVel[2] - invTau*relPos[2]);
+			const float wLenSq = dtVdot2D(w, w);
+			const float dot1 = dtVdot2D(w, relPos);
+
+			if (dot1 < 0.0f && dtSqr(dot1) > rSq*wLenSq)
+			{
+				// Project on the cutoff circle.
+				const float wLen = dtMathSqrtf(wLenSq);
+				orcaSet(w, w[0]/wLen, w[2]/wLen);
+				orcaSet(line.dir, w[2], -w[0]);
+				orcaSet(u, (r*invTau - wLen)*w[0], (r*invTau - wLen)*w[2]);
+			}
+			else
+			{
+				// Project on the legs.
+				const float leg = dtMathSqrtf(distSq - rSq);
+				if (orcaDet(relPos, w) > 0.0f)
+					orcaSet(line.dir, (relPos[0]*leg - relPos[2]*r) / distSq, (relPos[0]*r + relPos[2]*leg) / distSq);
+				else
+					orcaSet(line.dir, -(relPos[0]*leg + relPos[2]*r) / distSq, -(-relPos[0]*r + relPos[2]*leg) / distSq);
+				const float dot2 = dtVdot2D(relVel, line.dir);
+				orcaSet(u, dot2*line.dir[0] - relVel[0], dot2*line.dir[2] - relVel[2]);
+			}
+		}
+		else
+		{
+			// Collision, project on the cutoff circle of the collision time.
+			const float invTimeStep = 1.0f / DT_ORCA_COLLISION_TIME;
+			float w[3];
+			orcaSet(w, relVel[0] - invTimeStep*relPos[0], relVel[2] - invTimeStep*relPos[2]);
+			const float wLen = dtMathSqrtf(dtVdot2D(w, w));
+			if (wLen < DT_ORCA_EPS)
+				continue;
+			orcaSet(w, w[0]/wLen, w[2]/wLen);
+			orcaSet(line.dir, w[2], -w[0]);
+			orcaSet(u, (r*invTimeStep - wLen)*w[0], (r*invTimeStep - wLen)*w[2]);
+		}
+
+		orcaSet(line.p, vel[0] + 0.5f*u[0], vel[2] + 0.5f*u[2]);
+		nlines++;
+	}
+
+	const int failed = orcaLinearProgram2(m_lines, nlines, vmax, dvel, false, nvel);
+	if (failed < nlines)
+		orcaLinearProgram3(m_lines, nlines, nfixed, failed, vmax, m_projLines, nvel);
+
+	if (debug)
+	{
+		const float vpen = m_params.weightDesVel * (dtVdist2D(nvel, dvel) * m_invVmax);
+		const float vcpen = m_params.weightCurVel * (dtVdist2D(nvel, vel) * m_invVmax);
+		debug->addSample(nvel, vmax*0.1f, vpen + vcpen, vpen, vcpen, 0, 0);
+	}
+
+	return nlines;
+}
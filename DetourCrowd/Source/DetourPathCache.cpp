@@ -0,0 +1,229 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <string.h>
+#include "DetourPathCache.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+
+
+// Hashes the filter state the polygon selection and the costs depend on.
+static unsigned int hashFilter(const dtQueryFilter* filter)
+{
+	unsigned int h = 2166136261u;
+	h = (h ^ filter->getIncludeFlags()) * 16777619u;
+	h = (h ^ filter->getExcludeFlags()) * 16777619u;
+	for (int i = 0; i < DT_MAX_AREAS; ++i)
+	{
+		unsigned int bits;
+		const float cost = filter->getAreaCost(i);
+		memcpy(&bits, &cost, sizeof(bits));
+		h = (h ^ bits) * 16777619u;
+	}
+	return h;
+}
+
+dtPathCache::dtPathCache() :
+	m_allocator(dtGetDefaultAllocator()),
+	m_entries(0),
+	m_paths(0),
+	m_nentries(0),
+	m_maxEntries(0),
+	m_maxPathSize(0),
+	m_useStamp(0),
+	m_hitCount(0),
+	m_missCount(0)
+{
+}
+
+dtPathCache::~dtPathCache()
+{
+	purge();
+}
+
+void dtPathCache::purge()
+{
+	m_allocator->free(m_entries);
+	m_entries = 0;
+	m_allocator->free(m_paths);
+	m_paths = 0;
+	m_nentries = 0;
+	m_maxEntries = 0;
+	m_maxPathSize = 0;
+}
+
+bool dtPathCache::init(const int maxPaths, const int maxPathSize, dtAllocator* allocator)
+{
+	purge();
+	m_allocator = allocator ? allocator : dtGetDefaultAllocator();
+	m_hitCount = 0;
+	m_missCount = 0;
+
+	if (maxPaths <= 0)
+		return maxPaths == 0;
+	if (maxPathSize <= 0)
+		return false;
+
+	m_entries = (Entry*)m_allocator->alloc(sizeof(Entry)*maxPaths, DT_ALLOC_PERM);
+	m_paths = (dtPolyRef*)m_allocator->alloc(sizeof(dtPolyRef)*maxPaths*maxPathSize, DT_ALLOC_PERM);
+	if (!m_entries || !m_paths)
+	{
+		purge();
+		return false;
+	}
+	for (int i = 0; i < maxPaths; ++i)
+		m_entries[i].path = &m_paths[i*maxPathSize];
+
+	m_maxEntries = maxPaths;
+	m_maxPathSize = maxPathSize;
+
+	return true;
+}
+
+size_t dtPathCache::getMemUsed() const
+{
+	return sizeof(Entry)*m_maxEntries + sizeof(dtPolyRef)*m_maxEntries*m_maxPathSize;
+}
+
+void dtPathCache::clear()
+{
+	m_nentries = 0;
+}
+
+bool dtPathCache::isEntryValid(Entry& e, const dtNavMesh* nav) const
+{
+	const unsigned int generation = nav->getGeneration();
+	if (e.generation == generation)
+		return true;
+	for (int i = 0; i < e.npath; ++i)
+	{
+		if ((int)(nav->getTileGeneration(e.path[i]) - e.generation) > 0)
+			return false;
+	}
+	// None of the tiles changed, skip the check until the next change.
+	e.generation = generation;
+	return true;
+}
+
+void dtPathCache::removeEntry(const int i)
+{
+	// Swap the entry to the end, keeping the path buffers owned by the entries.
+	m_nentries--;
+	if (i != m_nentries)
+	{
+		Entry tmp = m_entries[i];
+		m_entries[i] = m_entries[m_nentries];
+		m_entries[m_nentries] = tmp;
+	}
+}
+
+bool dtPathCache::find(dtPolyRef startRef, dtPolyRef endRef, const dtQueryFilter* filter, const dtNavMesh* nav,
+					   dtPolyRef* path, int* pathCount, const int maxPath)
+{
+	if (!m_nentries)
+	{
+		if (m_maxEntries)
+			m_missCount++;
+		return false;
+	}
+
+	const unsigned int filterKey = hashFilter(filter);
+	for (int i = 0; i < m_nentries; ++i)
+	{
+		Entry& e = m_entries[i];
+		if (e.path[e.npath-1] != endRef || e.filter != filter || e.filterKey != filterKey)
+			continue;
+
+		// The start may be anywhere along the path, use the rest of the path.
+		int start = -1;
+		for (int j = 0; j < e.npath; ++j)
+		{
+			if (e.path[j] == startRef)
+			{
+				start = j;
+				break;
+			}
+		}
+		if (start == -1 || e.npath - start > maxPath)
+			continue;
+
+		if (!isEntryValid(e, nav))
+		{
+			removeEntry(i);
+			i--;
+			continue;
+		}
+
+		const int n = e.npath - start;
+		memcpy(path, &e.path[start], sizeof(dtPolyRef)*n);
+		*pathCount = n;
+		e.lastUse = ++m_useStamp;
+		m_hitCount++;
+		return true;
+	}
+
+	m_missCount++;
+	return false;
+}
+
+void dtPathCache::store(const dtPolyRef* path, const int pathCount, const dtQueryFilter* filter, const unsigned int generation)
+{
+	if (!m_maxEntries || pathCount <= 0 || pathCount > m_maxPathSize)
+		return;
+
+	const unsigned int filterKey = hashFilter(filter);
+
+	// Replace the path between the same polygons, or the least recently used path.
+	int idx = -1;
+	for (int i = 0; i < m_nentries; ++i)
+	{
+		const Entry& e = m_entries[i];
+		if (e.path[0] == path[0] && e.path[e.npath-1] == path[pathCount-1] &&
+			e.filter == filter && e.filterKey == filterKey)
+		{
+			idx = i;
+			break;
+		}
+	}
+	if (idx == -1)
+	{
+		if (m_nentries < m_maxEntries)
+		{
+			idx = m_nentries++;
+		}
+		else
+		{
+			idx = 0;
+			for (int i = 1; i < m_nentries; ++i)
+			{
+				if ((int)(m_entries[i].lastUse - m_entries[idx].lastUse) < 0)
+					idx = i;
+			}
+		}
+	}
+
+	Entry& e = m_entries[idx];
+	memcpy(e.path, path, sizeof(dtPolyRef)*pathCount);
+	e.npath = pathCount;
+	e.filter = filter;
+	e.filterKey = filterKey;
+	e.generation = generation;
+	e.lastUse = ++m_useStamp;
+}
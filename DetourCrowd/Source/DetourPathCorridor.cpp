@@ -19,6 +19,7 @@
 #include <string.h>
 #include "DetourPathCorridor.h"
 #include "DetourNavMeshQuery.h"
+#include "DetourOffMeshTable.h"
 #include "DetourCommon.h"
 #include "DetourAssert.h"
 #include "DetourAlloc.h"
@@ -155,6 +156,19 @@ int dtMergeCorridorStartShortcut(dtPolyRef* path, const int npath, const int max
 	return req+size;
 }
 
+// Hashes the polygons at the beginning of a path.
+static unsigned int hashPathPrefix(const dtPolyRef* path, const int npath)
+{
+	unsigned int h = 2166136261u;
+	for (int i = 0; i < npath; ++i)
+	{
+		// The upper half is shifted in two steps, since the references may be 32 bits.
+		h = (h ^ (unsigned int)path[i]) * 16777619u;
+		h = (h ^ (unsigned int)((path[i] >> 16) >> 16)) * 16777619u;
+	}
+	return h;
+}
+
 /**
 @class dtPathCorridor
 @par
@@ -198,24 +212,28 @@ may be needed.  E.g. If you move the target, check #getLastPoly() to see if it i
 */
 
 dtPathCorridor::dtPathCorridor() :
+	m_allocator(dtGetDefaultAllocator()),
 	m_path(0),
 	m_npath(0),
 	m_maxPath(0)
 {
+	memset(&m_visCache, 0, sizeof(m_visCache));
+	memset(&m_portalCache, 0, sizeof(m_portalCache));
 }
 
 dtPathCorridor::~dtPathCorridor()
 {
-	dtFree(m_path);
+	m_allocator->free(m_path);
 }
 
 /// @par
 ///
 /// @warning Cannot be called more than once.
-bool dtPathCorridor::init(const int maxPath)
+bool dtPathCorridor::init(const int maxPath, dtAllocator* allocator)
 {
 	dtAssert(!m_path);
-	m_path = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*maxPath, DT_ALLOC_PERM);
+	m_allocator = allocator ? allocator : dtGetDefaultAllocator();
+	m_path = (dtPolyRef*)m_allocator->alloc(sizeof(dtPolyRef)*maxPath, DT_ALLOC_PERM);
 	if (!m_path)
 		return false;
 	m_npath = 0;
@@ -223,6 +241,11 @@ bool dtPathCorridor::init(const int maxPath)
 	return true;
 }
 
+size_t dtPathCorridor::getMemUsed() const
+{
+	return m_path ? sizeof(dtPolyRef)*m_maxPath : 0;
+}
+
 /// @par
 ///
 /// Essentially, the corridor is set of one polygon in size with the target
@@ -234,6 +257,7 @@ void dtPathCorridor::reset(dtPolyRef ref, const float* pos)
 	dtVcopy(m_target, pos);
 	m_path[0] = ref;
 	m_npath = 1;
+	m_visCache.valid = false;
 }
 
 /**
@@ -257,9 +281,23 @@ int dtPathCorridor::findCorners(float* cornerVerts, unsigned char* cornerFlags,
 	
 	static const float MIN_TARGET_DIST = 0.01f;
 	
+	// Reuse the portals of the part of the corridor which has not changed since the last call.
+	updatePortalCache(navquery->getAttachedNavMesh());
+	PortalCache& pc = m_portalCache;
+	dtPortalCache cache;
+	cache.portals = pc.portals;
+	cache.types = pc.types;
+	cache.count = pc.count;
+	cache.capacity = PortalCache::MAX_PORTALS;
+	
 	int ncorners = 0;
 	navquery->findStraightPath(m_pos, m_target, m_path, m_npath,
-							   cornerVerts, cornerFlags, cornerPolys, &ncorners, maxCorners);
+							   cornerVerts, cornerFlags, cornerPolys, &ncorners, maxCorners, 0, &cache);
+	
+	for (int i = pc.count; i < cache.count; ++i)
+		pc.refs[i+1] = m_path[i+1];
+	pc.refs[0] = m_path[0];
+	pc.count = cache.count;
 	
 	// Prune points in the beginning of the path which are too close.
 	while (ncorners)
@@ -289,6 +327,52 @@ int dtPathCorridor::findCorners(float* cornerVerts, unsigned char* cornerFlags,
 	return ncorners;
 }
 
+/// Drops the cached portals which no longer belong to the corridor. The portals of
+/// the polygons trimmed off the start of the corridor are dropped by shifting the rest.
+void dtPathCorridor::updatePortalCache(const dtNavMesh* nav)
+{
+	PortalCache& pc = m_portalCache;
+	const unsigned int generation = nav->getGeneration();
+	if (pc.nav != nav || pc.generation != generation)
+	{
+		pc.nav = nav;
+		pc.generation = generation;
+		pc.count = 0;
+		return;
+	}
+	if (!pc.count)
+		return;
+	
+	// Find where the corridor starts now.
+	int shift = -1;
+	for (int i = 0; i <= pc.count; ++i)
+	{
+		if (pc.refs[i] == m_path[0])
+		{
+			shift = i;
+			break;
+		}
+	}
+	if (shift < 0)
+	{
+		pc.count = 0;
+		return;
+	}
+	if (shift > 0)
+	{
+		pc.count -= shift;
+		memmove(pc.portals, pc.portals + shift*6, sizeof(float)*6*pc.count);
+		memmove(pc.types, pc.types + shift, sizeof(unsigned char)*pc.count);
+		memmove(pc.refs, pc.refs + shift, sizeof(dtPolyRef)*(pc.count+1));
+	}
+	
+	// Keep the portals up to the first polygon which changed.
+	int n = 0;
+	while (n < pc.count && n+1 < m_npath && pc.refs[n+1] == m_path[n+1])
+		n++;
+	pc.count = n;
+}
+
 /** 
 @par
 
@@ -306,12 +390,21 @@ The more inaccurate the agent movement, the more beneficial this function become
 of the call to match the needs to the agent.
 
 This function is not suitable for long distance searches.
+
+With a non-zero @p reuseDist the result of the last call is reused while the polygons 
+the ray can shortcut, the navigation mesh and the filter are unchanged, and neither the 
+position nor @p next have moved further than @p reuseDist since the ray was cast. 
+A ray that was blocked then usually is still blocked, and after a shortcut the corridor 
+is already straight toward @p next.
 */
 void dtPathCorridor::optimizePathVisibility(const float* next, const float pathOptimizationRange,
-										  dtNavMeshQuery* navquery, const dtQueryFilter* filter)
+										  dtNavMeshQuery* navquery, const dtQueryFilter* filter,
+										  const float reuseDist)
 {
 	dtAssert(m_path);
 	
+	static const int MAX_RES = 32;
+
 	// Clamp the ray to max distance.
 	float goal[3];
 	dtVcopy(goal, next);
@@ -320,6 +413,16 @@ void dtPathCorridor::optimizePathVisibility(const float* next, const float pathO
 	// If too close to the goal, do not try to optimize.
 	if (dist < 0.01f)
 		return;
+
+	const unsigned int generation = navquery->getAttachedNavMesh()->getGeneration();
+	if (reuseDist > 0.0f)
+	{
+		const VisibilityCache& c = m_visCache;
+		if (c.valid && c.npath == m_npath && c.generation == generation && c.filter == filter &&
+			c.prefixHash == hashPathPrefix(m_path, dtMin(m_npath, MAX_RES)) &&
+			dtVdist2DSqr(c.pos, m_pos) < dtSqr(reuseDist) && dtVdist2DSqr(c.next, next) < dtSqr(reuseDist))
+			return;
+	}
 	
 	// Overshoot a little. This helps to optimize open fields in tiled meshes.
 	dist = dtMin(dist+0.01f, pathOptimizationRange);
@@ -329,7 +432,6 @@ void dtPathCorridor::optimizePathVisibility(const float* next, const float pathO
 	dtVsub(delta, goal, m_pos);
 	dtVmad(goal, m_pos, delta, pathOptimizationRange/dist);
 	
-	static const int MAX_RES = 32;
 	dtPolyRef res[MAX_RES];
 	float t, norm[3];
 	int nres = 0;
@@ -338,6 +440,16 @@ void dtPathCorridor::optimizePathVisibility(const float* next, const float pathO
 	{
 		m_npath = dtMergeCorridorStartShortcut(m_path, m_npath, m_maxPath, res, nres);
 	}
+
+	// Remember the corridor after the optimization.
+	VisibilityCache& c = m_visCache;
+	dtVcopy(c.pos, m_pos);
+	dtVcopy(c.next, next);
+	c.prefixHash = hashPathPrefix(m_path, dtMin(m_npath, MAX_RES));
+	c.npath = m_npath;
+	c.generation = generation;
+	c.filter = filter;
+	c.valid = true;
 }
 
 /**
@@ -379,7 +491,8 @@ bool dtPathCorridor::optimizePathTopology(dtNavMeshQuery* navquery, const dtQuer
 
 bool dtPathCorridor::moveOverOffmeshConnection(dtPolyRef offMeshConRef, dtPolyRef* refs,
 											   float* startPos, float* endPos,
-											   dtNavMeshQuery* navquery)
+											   dtNavMeshQuery* navquery,
+											   const dtOffMeshConnectionTable* table)
 {
 	dtAssert(navquery);
 	dtAssert(m_path);
@@ -411,7 +524,11 @@ bool dtPathCorridor::moveOverOffmeshConnection(dtPolyRef offMeshConRef, dtPolyRe
 	const dtNavMesh* nav = navquery->getAttachedNavMesh();
 	dtAssert(nav);
 
-	dtStatus status = nav->getOffMeshConnectionPolyEndPoints(refs[0], refs[1], startPos, endPos);
+	dtStatus status = DT_FAILURE;
+	if (table && table->getAttachedNavMesh() == nav)
+		status = table->getEndPoints(refs[0], refs[1], startPos, endPos);
+	if (dtStatusFailed(status))
+		status = nav->getOffMeshConnectionPolyEndPoints(refs[0], refs[1], startPos, endPos);
 	if (dtStatusSucceed(status))
 	{
 		dtVcopy(m_pos, endPos);
@@ -461,6 +578,49 @@ bool dtPathCorridor::movePosition(const float* npos, dtNavMeshQuery* navquery, c
 	return false;
 }
 
+void dtPathCorridor::initMovePosition(const float* npos, const dtQueryFilter* filter,
+									  dtPolyRef* visited, const int maxVisited, dtSurfaceMove* move) const
+{
+	dtAssert(m_path);
+	dtAssert(m_npath);
+
+	move->startRef = m_path[0];
+	dtVcopy(move->startPos, m_pos);
+	dtVcopy(move->endPos, npos);
+	move->filter = filter;
+	move->visited = visited;
+	move->maxVisited = maxVisited;
+	move->visitedCount = 0;
+	move->status = 0;
+}
+
+/// @par
+///
+/// The batch places the result on the last visited polygon, which is the first polygon 
+/// of the adjusted corridor unless the move left the corridor. Only then is the height queried again.
+bool dtPathCorridor::applyMovePosition(const dtSurfaceMove* move, dtNavMeshQuery* navquery)
+{
+	dtAssert(m_path);
+	dtAssert(m_npath);
+
+	if (dtStatusFailed(move->status))
+		return false;
+
+	m_npath = dtMergeCorridorStartMoved(m_path, m_npath, m_maxPath, move->visited, move->visitedCount);
+
+	float result[3];
+	dtVcopy(result, move->resultPos);
+	const dtPolyRef endRef = move->visitedCount ? move->visited[move->visitedCount-1] : move->startRef;
+	if (m_path[0] != endRef)
+	{
+		float h = m_pos[1];
+		navquery->getPolyHeight(m_path[0], result, &h);
+		result[1] = h;
+	}
+	dtVcopy(m_pos, result);
+	return true;
+}
+
 /**
 @par
 
@@ -517,6 +677,7 @@ void dtPathCorridor::setCorridor(const float* target, const dtPolyRef* path, con
 	dtVcopy(m_target, target);
 	memcpy(m_path, path, sizeof(dtPolyRef)*npath);
 	m_npath = npath;
+	m_visCache.valid = false;
 }
 
 bool dtPathCorridor::fixPathStart(dtPolyRef safeRef, const float* safePos)
@@ -579,6 +740,119 @@ bool dtPathCorridor::trimInvalidPath(dtPolyRef safeRef, const float* safePos,
 	return true;
 }
 
+static void getPolyCenter(const dtNavMesh* nav, dtPolyRef ref, float* center)
+{
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	nav->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+	dtCalcPolyCenter(center, poly->verts, (int)poly->vertCount, tile->verts);
+}
+
+/// @par
+///
+/// Each run of invalid polygons is searched around, from the valid polygon before
+/// it to the valid polygon after it, and the result is spliced into the corridor.
+/// Where the local path crosses the rest of the corridor, the corridor is shortcut
+/// at the furthest common polygon, like in the dtMergeCorridor functions.
+///
+/// The repair fails when the first or the last polygon of the corridor is invalid,
+/// when a local search does not reach its end within @p maxIterations, or when the
+/// repaired corridor would not fit. The parts repaired before the failure are kept,
+/// the corridor should then be replanned.
+///
+/// The sliced path query of @p navquery is used, any query in progress is lost.
+bool dtPathCorridor::repairPath(const int maxIterations, dtNavMeshQuery* navquery, const dtQueryFilter* filter)
+{
+	dtAssert(navquery);
+	dtAssert(filter);
+	dtAssert(m_path);
+
+	static const int MAX_RES = 64;
+
+	if (!m_npath || !navquery->isValidPolyRef(m_path[0], filter))
+		return false;
+
+	dtPolyRef res[MAX_RES];
+	int first = 1;
+	while (first < m_npath)
+	{
+		// Find the next run of invalid polygons.
+		while (first < m_npath && navquery->isValidPolyRef(m_path[first], filter))
+			first++;
+		if (first == m_npath)
+			break;
+		int last = first;
+		while (last < m_npath && !navquery->isValidPolyRef(m_path[last], filter))
+			last++;
+		if (last == m_npath)
+			return false;
+
+		// Search around the run.
+		const dtPolyRef startRef = m_path[first-1];
+		const dtPolyRef endRef = m_path[last];
+		float startPos[3], endPos[3];
+		if (first-1 == 0)
+			dtVcopy(startPos, m_pos);
+		else
+			getPolyCenter(navquery->getAttachedNavMesh(), startRef, startPos);
+		if (last == m_npath-1)
+			dtVcopy(endPos, m_target);
+		else
+			getPolyCenter(navquery->getAttachedNavMesh(), endRef, endPos);
+
+		int nres = 0;
+		navquery->initSlicedFindPath(startRef, endRef, startPos, endPos, filter);
+		navquery->updateSlicedFindPath(maxIterations, 0);
+		const dtStatus status = navquery->finalizeSlicedFindPath(res, &nres, MAX_RES);
+		if (dtStatusFailed(status) || dtStatusDetail(status, DT_BUFFER_TOO_SMALL) || !nres || res[nres-1] != endRef)
+			return false;
+
+		// Shortcut at the first local polygon that is on the rest of the path, the end polygon at the latest.
+		int nkeep = nres;
+		int suffix = last;
+		for (int i = 0; i < nres && suffix == last; ++i)
+		{
+			for (int j = m_npath-1; j >= last; --j)
+			{
+				if (res[i] == m_path[j])
+				{
+					nkeep = i+1;
+					suffix = j+1;
+					break;
+				}
+			}
+		}
+
+		// Shortcut at the first polygon of the path that is on the local path, the start polygon at the latest.
+		int prefix = first;
+		int from = 1;
+		for (int i = 0; i < first && prefix == first; ++i)
+		{
+			for (int j = nkeep-1; j >= 0; --j)
+			{
+				if (m_path[i] == res[j])
+				{
+					prefix = i+1;
+					from = j+1;
+					break;
+				}
+			}
+		}
+
+		const int nmid = nkeep - from;
+		const int nsuffix = m_npath - suffix;
+		if (prefix + nmid + nsuffix > m_maxPath)
+			return false;
+
+		memmove(m_path+prefix+nmid, m_path+suffix, nsuffix*sizeof(dtPolyRef));
+		memcpy(m_path+prefix, res+from, nmid*sizeof(dtPolyRef));
+		m_npath = prefix + nmid + nsuffix;
+		first = prefix + nmid;
+	}
+
+	return true;
+}
+
 /// @par
 ///
 /// The path can be invalidated if there are structural changes to the underlying navigation mesh, or the state of 
@@ -25,13 +25,23 @@
 
 
 dtPathQueue::dtPathQueue() :
+	m_queue(0),
+	m_maxQueue(0),
 	m_nextHandle(1),
+	m_nextOrder(0),
 	m_maxPathSize(0),
-	m_queueHead(0),
-	m_navquery(0)
+	m_allocator(dtGetDefaultAllocator()),
+	m_navquery(0),
+	m_dispatcher(0),
+	m_searchCount(0),
+	m_searchQueries(0),
+	m_searchJobs(0),
+	m_searchJobCounts(0),
+	m_searchIters(0),
+	m_pending(0),
+	m_maxIters(0),
+	m_budget(0)
 {
-	for (int i = 0; i < MAX_QUEUE; ++i)
-		m_queue[i].path = 0;
 }
 
 dtPathQueue::~dtPathQueue()
@@ -41,57 +51,237 @@ dtPathQueue::~dtPathQueue()
 
 void dtPathQueue::purge()
 {
-	dtFreeNavMeshQuery(m_navquery);
+	m_dispatcher = 0;
+	purgeSearches();
+	dtFreeObject(m_allocator, m_navquery);
 	m_navquery = 0;
-	for (int i = 0; i < MAX_QUEUE; ++i)
-	{
-		dtFree(m_queue[i].path);
-		m_queue[i].path = 0;
-	}
+	for (int i = 0; i < m_maxQueue; ++i)
+		m_allocator->free(m_queue[i].path);
+	m_allocator->free(m_queue);
+	m_queue = 0;
+	m_maxQueue = 0;
+	m_allocator->free(m_pending);
+	m_pending = 0;
+	m_cache.init(0, 0);
 }
 
-bool dtPathQueue::init(const int maxPathSize, const int maxSearchNodeCount, dtNavMesh* nav)
+void dtPathQueue::purgeSearches()
+{
+	// The first search uses the queue's own query.
+	for (int i = 1; i < m_searchCount; ++i)
+		dtFreeObject(m_allocator, m_searchQueries[i]);
+	m_allocator->free(m_searchQueries);
+	m_searchQueries = 0;
+	m_allocator->free(m_searchJobs);
+	m_searchJobs = 0;
+	m_allocator->free(m_searchJobCounts);
+	m_searchJobCounts = 0;
+	m_allocator->free(m_searchIters);
+	m_searchIters = 0;
+	m_searchCount = 0;
+}
+
+bool dtPathQueue::init(const int maxPathSize, const int maxSearchNodeCount, dtNavMesh* nav,
+					   const int maxRequests, const int maxSearches, dtAllocator* allocator)
 {
 	purge();
+	m_allocator = allocator ? allocator : dtGetDefaultAllocator();
+
+	if (maxRequests <= 0 || maxSearches <= 0)
+		return false;
 
-	m_navquery = dtAllocNavMeshQuery();
+	m_navquery = dtAllocObject<dtNavMeshQuery>(m_allocator);
 	if (!m_navquery)
 		return false;
-	if (dtStatusFailed(m_navquery->init(nav, maxSearchNodeCount)))
+	if (dtStatusFailed(m_navquery->init(nav, maxSearchNodeCount, 0, m_allocator)))
 		return false;
 	
+	m_queue = (PathQuery*)m_allocator->alloc(sizeof(PathQuery)*maxRequests, DT_ALLOC_PERM);
+	if (!m_queue)
+		return false;
+	m_maxQueue = maxRequests;
+	for (int i = 0; i < m_maxQueue; ++i)
+		m_queue[i].path = 0;
+	m_pending = (int*)m_allocator->alloc(sizeof(int)*m_maxQueue, DT_ALLOC_PERM);
+	if (!m_pending)
+		return false;
+
 	m_maxPathSize = maxPathSize;
-	for (int i = 0; i < MAX_QUEUE; ++i)
+	for (int i = 0; i < m_maxQueue; ++i)
 	{
 		m_queue[i].ref = DT_PATHQ_INVALID;
-		m_queue[i].path = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*m_maxPathSize, DT_ALLOC_PERM);
+		m_queue[i].search = -1;
+		m_queue[i].storeResult = false;
+		m_queue[i].path = (dtPolyRef*)m_allocator->alloc(sizeof(dtPolyRef)*m_maxPathSize, DT_ALLOC_PERM);
 		if (!m_queue[i].path)
 			return false;
 	}
-	
-	m_queueHead = 0;
+
+	m_searchQueries = (dtNavMeshQuery**)m_allocator->alloc(sizeof(dtNavMeshQuery*)*maxSearches, DT_ALLOC_PERM);
+	m_searchJobs = (int*)m_allocator->alloc(sizeof(int)*maxSearches*m_maxQueue, DT_ALLOC_PERM);
+	m_searchJobCounts = (int*)m_allocator->alloc(sizeof(int)*maxSearches, DT_ALLOC_PERM);
+	m_searchIters = (int*)m_allocator->alloc(sizeof(int)*maxSearches, DT_ALLOC_PERM);
+	if (!m_searchQueries || !m_searchJobs || !m_searchJobCounts || !m_searchIters)
+		return false;
+	memset(m_searchQueries, 0, sizeof(dtNavMeshQuery*)*maxSearches);
+	m_searchCount = maxSearches;
+
+	m_searchQueries[0] = m_navquery;
+	for (int i = 1; i < m_searchCount; ++i)
+	{
+		m_searchQueries[i] = dtAllocObject<dtNavMeshQuery>(m_allocator);
+		if (!m_searchQueries[i])
+			return false;
+		if (dtStatusFailed(m_searchQueries[i]->init(nav, maxSearchNodeCount, 0, m_allocator)))
+			return false;
+	}
 	
 	return true;
 }
 
+size_t dtPathQueue::getMemUsed() const
+{
+	size_t size = m_cache.getMemUsed();
+	if (m_queue)
+	{
+		size += sizeof(PathQuery)*m_maxQueue;
+		for (int i = 0; i < m_maxQueue; ++i)
+		{
+			if (m_queue[i].path)
+				size += sizeof(dtPolyRef)*m_maxPathSize;
+		}
+	}
+	if (m_pending)
+		size += sizeof(int)*m_maxQueue;
+	if (m_searchQueries)
+	{
+		size += sizeof(dtNavMeshQuery*)*m_searchCount + sizeof(int)*m_searchCount*(m_maxQueue + 2);
+		for (int i = 0; i < m_searchCount; ++i)
+		{
+			if (m_searchQueries[i])
+				size += m_searchQueries[i]->getMemUsed();
+		}
+	}
+	else if (m_navquery)
+	{
+		size += m_navquery->getMemUsed();
+	}
+	return size;
+}
+
+/// @par
+///
+/// A request between polygons of a cached path is completed without a search,
+/// its result is the cached path from the start polygon onwards. The cached paths
+/// are not refined to the start and end positions of the request.
+bool dtPathQueue::initPathCache(const int maxPaths)
+{
+	return m_cache.init(maxPaths, m_maxPathSize, m_allocator);
+}
+
+void dtPathQueue::runUpdateJob(void* userData, const int jobIndex, const int /*workerIndex*/)
+{
+	// There is one job per search, so that a search query is never used by two workers at once.
+	dtPathQueue* pathq = (dtPathQueue*)userData;
+	pathq->updateSearch(jobIndex);
+}
+
+void dtPathQueue::updateSearch(const int search)
+{
+	dtNavMeshQuery* navquery = m_searchQueries[search];
+	const int* jobs = &m_searchJobs[search*m_maxQueue];
+
+	// Update path requests until there is nothing to update
+	// or upto maxIters pathfinder iterations has been consumed.
+	int iterCount = m_maxIters;
+	
+	for (int i = 0; i < m_searchJobCounts[search]; ++i)
+	{
+		PathQuery& q = m_queue[jobs[i]];
+		q.stats.searchUpdates++;
+		
+		// Handle query start.
+		if (q.status == 0)
+		{
+			q.search = search;
+			q.generation = navquery->getAttachedNavMesh()->getGeneration();
+			q.status = navquery->initSlicedFindPath(q.startRef, q.endRef, q.startPos, q.endPos, q.filter);
+		}		
+		// Handle query in progress.
+		if (dtStatusInProgress(q.status))
+		{
+			int iters = 0;
+			if (m_budget)
+			{
+				q.status = navquery->updateSlicedFindPath(*m_budget, &iters);
+			}
+			else
+			{
+				q.status = navquery->updateSlicedFindPath(iterCount, &iters);
+				iterCount -= iters;
+			}
+			q.stats.iterations += iters;
+			m_searchIters[search] += iters;
+		}
+		if (dtStatusSucceed(q.status))
+		{
+			q.status = navquery->finalizeSlicedFindPath(q.path, &q.npath, m_maxPathSize);
+			q.storeResult = dtStatusSucceed(q.status) && !dtStatusDetail(q.status, DT_PARTIAL_RESULT) &&
+				q.npath > 0 && q.path[q.npath-1] == q.endRef;
+		}
+
+		if (m_budget ? dtTimeBudgetExpired(*m_budget) : iterCount <= 0)
+			break;
+	}
+}
+
 void dtPathQueue::update(const int maxIters)
+{
+	m_maxIters = maxIters;
+	m_budget = 0;
+	updateSearches();
+}
+
+/// @par
+///
+/// With several searches each of them runs until the deadline, so the
+/// searches of an update use the budget on each of the workers.
+void dtPathQueue::update(const dtTimeBudget& budget, int* doneIters)
+{
+	m_maxIters = 0;
+	m_budget = &budget;
+	updateSearches();
+	m_budget = 0;
+
+	if (doneIters)
+	{
+		*doneIters = 0;
+		for (int i = 0; i < m_searchCount; ++i)
+			*doneIters += m_searchIters[i];
+	}
+}
+
+void dtPathQueue::updateSearches()
 {
 	static const int MAX_KEEP_ALIVE = 2; // in update ticks.
 
-	// Update path request until there is nothing to update
-	// or upto maxIters pathfinder iterations has been consumed.
-	int iterCount = maxIters;
+	for (int i = 0; i < m_searchCount; ++i)
+	{
+		m_searchJobCounts[i] = 0;
+		m_searchIters[i] = 0;
+	}
+
+	// Pending requests, ordered by priority and then by age.
+	int* pending = m_pending;
+	int npending = 0;
 	
-	for (int i = 0; i < MAX_QUEUE; ++i)
+	for (int i = 0; i < m_maxQueue; ++i)
 	{
-		PathQuery& q = m_queue[m_queueHead % MAX_QUEUE];
+		PathQuery& q = m_queue[i];
 		
 		// Skip inactive requests.
 		if (q.ref == DT_PATHQ_INVALID)
-		{
-			m_queueHead++;
 			continue;
-		}
 		
 		// Handle completed request.
 		if (dtStatusSucceed(q.status) || dtStatusFailed(q.status))
@@ -103,42 +293,63 @@ void dtPathQueue::update(const int maxIters)
 				q.ref = DT_PATHQ_INVALID;
 				q.status = 0;
 			}
-			
-			m_queueHead++;
 			continue;
 		}
-		
-		// Handle query start.
-		if (q.status == 0)
-		{
-			q.status = m_navquery->initSlicedFindPath(q.startRef, q.endRef, q.startPos, q.endPos, q.filter);
-		}		
-		// Handle query in progress.
-		if (dtStatusInProgress(q.status))
+
+		// Requests in progress continue first on the search that started them.
+		if (q.status != 0)
 		{
-			int iters = 0;
-			q.status = m_navquery->updateSlicedFindPath(iterCount, &iters);
-			iterCount -= iters;
+			m_searchJobs[q.search*m_maxQueue + m_searchJobCounts[q.search]++] = i;
+			continue;
 		}
-		if (dtStatusSucceed(q.status))
+
+		int j = npending;
+		while (j > 0 && (m_queue[pending[j-1]].priority > q.priority ||
+						 (m_queue[pending[j-1]].priority == q.priority && m_queue[pending[j-1]].order > q.order)))
 		{
-			q.status = m_navquery->finalizeSlicedFindPath(q.path, &q.npath, m_maxPathSize);
+			pending[j] = pending[j-1];
+			j--;
 		}
+		pending[j] = i;
+		npending++;
+	}
 
-		if (iterCount <= 0)
-			break;
+	// Hand out the pending requests round robin.
+	for (int i = 0; i < npending; ++i)
+	{
+		const int search = i % m_searchCount;
+		m_searchJobs[search*m_maxQueue + m_searchJobCounts[search]++] = pending[i];
+	}
 
-		m_queueHead++;
+	if (m_dispatcher)
+		m_dispatcher->dispatch(runUpdateJob, this, m_searchCount);
+	else
+	{
+		for (int i = 0; i < m_searchCount; ++i)
+			updateSearch(i);
+	}
+
+	for (int i = 0; i < m_maxQueue; ++i)
+	{
+		PathQuery& q = m_queue[i];
+		if (q.ref != DT_PATHQ_INVALID && q.status == 0)
+			q.stats.waitUpdates++;
+		// The cache is only modified here, the searches may run on several workers.
+		if (q.storeResult)
+		{
+			m_cache.store(q.path, q.npath, q.filter, q.generation);
+			q.storeResult = false;
+		}
 	}
 }
 
 dtPathQueueRef dtPathQueue::request(dtPolyRef startRef, dtPolyRef endRef,
 									const float* startPos, const float* endPos,
-									const dtQueryFilter* filter)
+									const dtQueryFilter* filter, const unsigned char priority)
 {
 	// Find empty slot
 	int slot = -1;
-	for (int i = 0; i < MAX_QUEUE; ++i)
+	for (int i = 0; i < m_maxQueue; ++i)
 	{
 		if (m_queue[i].ref == DT_PATHQ_INVALID)
 		{
@@ -164,13 +375,26 @@ dtPathQueueRef dtPathQueue::request(dtPolyRef startRef, dtPolyRef endRef,
 	q.npath = 0;
 	q.filter = filter;
 	q.keepAlive = 0;
+	q.priority = priority;
+	q.order = m_nextOrder++;
+	q.search = -1;
+	q.generation = 0;
+	q.storeResult = false;
+	memset(&q.stats, 0, sizeof(q.stats));
+
+	// Repeated requests are served from the cache without a search.
+	if (m_cache.getMaxPaths() > 0 &&
+		m_cache.find(startRef, endRef, filter, m_navquery->getAttachedNavMesh(), q.path, &q.npath, m_maxPathSize))
+	{
+		q.status = DT_SUCCESS;
+	}
 	
 	return ref;
 }
 
 dtStatus dtPathQueue::getRequestStatus(dtPathQueueRef ref) const
 {
-	for (int i = 0; i < MAX_QUEUE; ++i)
+	for (int i = 0; i < m_maxQueue; ++i)
 	{
 		if (m_queue[i].ref == ref)
 			return m_queue[i].status;
@@ -178,9 +402,35 @@ dtStatus dtPathQueue::getRequestStatus(dtPathQueueRef ref) const
 	return DT_FAILURE;
 }
 
+dtStatus dtPathQueue::getRequestStats(dtPathQueueRef ref, dtPathQueueRequestStats* stats) const
+{
+	for (int i = 0; i < m_maxQueue; ++i)
+	{
+		if (m_queue[i].ref == ref)
+		{
+			*stats = m_queue[i].stats;
+			return DT_SUCCESS;
+		}
+	}
+	return DT_FAILURE;
+}
+
+void dtPathQueue::getQueryStats(dtQueryStats* stats) const
+{
+	memset(stats, 0, sizeof(dtQueryStats));
+	for (int i = 0; i < m_searchCount; ++i)
+		dtAddQueryStats(stats, &m_searchQueries[i]->getStats());
+}
+
+void dtPathQueue::resetQueryStats()
+{
+	for (int i = 0; i < m_searchCount; ++i)
+		m_searchQueries[i]->resetStats();
+}
+
 dtStatus dtPathQueue::getPathResult(dtPathQueueRef ref, dtPolyRef* path, int* pathSize, const int maxPath)
 {
-	for (int i = 0; i < MAX_QUEUE; ++i)
+	for (int i = 0; i < m_maxQueue; ++i)
 	{
 		if (m_queue[i].ref == ref)
 		{
@@ -40,66 +40,85 @@ void dtFreeProximityGrid(dtProximityGrid* ptr)
 }
 
 
-inline int hashPos2(int x, int y, int n)
-{
-	return ((x*73856093) ^ (y*19349663)) & (n-1);
-}
-
-
 dtProximityGrid::dtProximityGrid() :
+	m_allocator(dtGetDefaultAllocator()),
 	m_cellSize(0),
 	m_invCellSize(0),
 	m_pool(0),
 	m_poolHead(0),
 	m_poolSize(0),
-	m_buckets(0),
-	m_bucketsSize(0)
+	m_ids(0),
+	m_cellStarts(0),
+	m_maxCells(0),
+	m_width(0),
+	m_shift(0)
 {
 }
 
 dtProximityGrid::~dtProximityGrid()
 {
-	dtFree(m_buckets);
-	dtFree(m_pool);
+	m_allocator->free(m_cellStarts);
+	m_allocator->free(m_ids);
+	m_allocator->free(m_pool);
 }
 
-bool dtProximityGrid::init(const int poolSize, const float cellSize)
+bool dtProximityGrid::init(const int poolSize, const float cellSize, dtAllocator* allocator)
 {
 	dtAssert(poolSize > 0);
 	dtAssert(cellSize > 0.0f);
+
+	m_allocator->free(m_cellStarts);
+	m_allocator->free(m_ids);
+	m_allocator->free(m_pool);
+	m_cellStarts = 0;
+	m_ids = 0;
+	m_pool = 0;
+	m_allocator = allocator ? allocator : dtGetDefaultAllocator();
 	
 	m_cellSize = cellSize;
 	m_invCellSize = 1.0f / m_cellSize;
 	
-	// Allocate hashs buckets
-	m_bucketsSize = dtNextPow2(poolSize);
-	m_buckets = (unsigned short*)dtAlloc(sizeof(unsigned short)*m_bucketsSize, DT_ALLOC_PERM);
-	if (!m_buckets)
-		return false;
-	
 	// Allocate pool of items.
 	m_poolSize = poolSize;
 	m_poolHead = 0;
-	m_pool = (Item*)dtAlloc(sizeof(Item)*m_poolSize, DT_ALLOC_PERM);
+	m_pool = (Item*)m_allocator->alloc(sizeof(Item)*m_poolSize, DT_ALLOC_PERM);
 	if (!m_pool)
 		return false;
+	m_ids = (unsigned int*)m_allocator->alloc(sizeof(unsigned int)*m_poolSize, DT_ALLOC_PERM);
+	if (!m_ids)
+		return false;
+
+	// Allocate the cells, a few per item so that sparse items rarely need coarser cells.
+	m_maxCells = dtMax(poolSize*4, 256);
+	m_cellStarts = (int*)m_allocator->alloc(sizeof(int)*(m_maxCells+1), DT_ALLOC_PERM);
+	if (!m_cellStarts)
+		return false;
 	
 	clear();
 	
 	return true;
 }
 
+size_t dtProximityGrid::getMemUsed() const
+{
+	if (!m_cellStarts)
+		return 0;
+	return sizeof(Item)*m_poolSize + sizeof(unsigned int)*m_poolSize + sizeof(int)*(m_maxCells+1);
+}
+
 void dtProximityGrid::clear()
 {
-	memset(m_buckets, 0xff, sizeof(unsigned short)*m_bucketsSize);
 	m_poolHead = 0;
+	m_width = 0;
+	m_shift = 0;
+	m_cellStarts[0] = 0;
 	m_bounds[0] = 0xffff;
 	m_bounds[1] = 0xffff;
 	m_bounds[2] = -0xffff;
 	m_bounds[3] = -0xffff;
 }
 
-void dtProximityGrid::addItem(const unsigned short id,
+void dtProximityGrid::addItem(const unsigned int id,
 							  const float minx, const float miny,
 							  const float maxx, const float maxy)
 {
@@ -119,56 +138,115 @@ void dtProximityGrid::addItem(const unsigned short id,
 		{
 			if (m_poolHead < m_poolSize)
 			{
-				const int h = hashPos2(x, y, m_bucketsSize);
-				const unsigned short idx = (unsigned short)m_poolHead;
-				m_poolHead++;
-				Item& item = m_pool[idx];
-				item.x = (short)x;
-				item.y = (short)y;
+				Item& item = m_pool[m_poolHead++];
+				item.x = x;
+				item.y = y;
 				item.id = id;
-				item.next = m_buckets[h];
-				m_buckets[h] = idx;
 			}
 		}
 	}
 }
 
+void dtProximityGrid::build()
+{
+	m_width = 0;
+	m_shift = 0;
+	m_cellStarts[0] = 0;
+	if (!m_poolHead)
+		return;
+
+	// Coarsen the cells until the bounds fit the grid.
+	// The shifts round towards negative infinity, like the floor of the cell coordinates.
+	int width = m_bounds[2] - m_bounds[0] + 1;
+	int height = m_bounds[3] - m_bounds[1] + 1;
+	while (height > m_maxCells / width)
+	{
+		m_shift++;
+		width = (m_bounds[2] >> m_shift) - (m_bounds[0] >> m_shift) + 1;
+		height = (m_bounds[3] >> m_shift) - (m_bounds[1] >> m_shift) + 1;
+	}
+	for (int i = 0; i < 4; ++i)
+		m_bounds[i] >>= m_shift;
+	m_width = width;
+	const int ncells = width * height;
+
+	// Count the items per cell.
+	int* starts = m_cellStarts;
+	memset(starts, 0, sizeof(int)*(ncells+1));
+	for (int i = 0; i < m_poolHead; ++i)
+	{
+		const Item& item = m_pool[i];
+		const int cell = ((item.x >> m_shift) - m_bounds[0]) + ((item.y >> m_shift) - m_bounds[1]) * width;
+		starts[cell+1]++;
+	}
+	for (int i = 0; i < ncells; ++i)
+		starts[i+1] += starts[i];
+
+	// Scatter the items in order, using the start of each cell as its write cursor.
+	for (int i = 0; i < m_poolHead; ++i)
+	{
+		const Item& item = m_pool[i];
+		const int cell = ((item.x >> m_shift) - m_bounds[0]) + ((item.y >> m_shift) - m_bounds[1]) * width;
+		m_ids[starts[cell]++] = item.id;
+	}
+	// Each cursor ended at the start of the following cell, shift them back.
+	for (int i = ncells; i > 0; --i)
+		starts[i] = starts[i-1];
+	starts[0] = 0;
+}
+
+bool dtProximityGrid::getCellRange(const float minx, const float miny,
+								   const float maxx, const float maxy, int* cells) const
+{
+	if (!m_width)
+		return false;
+
+	cells[0] = dtMax(((int)dtMathFloorf(minx * m_invCellSize)) >> m_shift, m_bounds[0]);
+	cells[1] = dtMax(((int)dtMathFloorf(miny * m_invCellSize)) >> m_shift, m_bounds[1]);
+	cells[2] = dtMin(((int)dtMathFloorf(maxx * m_invCellSize)) >> m_shift, m_bounds[2]);
+	cells[3] = dtMin(((int)dtMathFloorf(maxy * m_invCellSize)) >> m_shift, m_bounds[3]);
+
+	return cells[0] <= cells[2] && cells[1] <= cells[3];
+}
+
+const unsigned int* dtProximityGrid::getRowItems(const int minx, const int maxx, const int y, int& count) const
+{
+	dtAssert(minx >= m_bounds[0] && maxx <= m_bounds[2] && minx <= maxx);
+	dtAssert(y >= m_bounds[1] && y <= m_bounds[3]);
+
+	const int row = (y - m_bounds[1]) * m_width - m_bounds[0];
+	const int first = m_cellStarts[row + minx];
+	count = m_cellStarts[row + maxx + 1] - first;
+	return &m_ids[first];
+}
+
 int dtProximityGrid::queryItems(const float minx, const float miny,
 								const float maxx, const float maxy,
-								unsigned short* ids, const int maxIds) const
+								unsigned int* ids, const int maxIds) const
 {
-	const int iminx = (int)dtMathFloorf(minx * m_invCellSize);
-	const int iminy = (int)dtMathFloorf(miny * m_invCellSize);
-	const int imaxx = (int)dtMathFloorf(maxx * m_invCellSize);
-	const int imaxy = (int)dtMathFloorf(maxy * m_invCellSize);
+	int cells[4];
+	if (!getCellRange(minx, miny, maxx, maxy, cells))
+		return 0;
 	
 	int n = 0;
 	
-	for (int y = iminy; y <= imaxy; ++y)
+	for (int y = cells[1]; y <= cells[3]; ++y)
 	{
-		for (int x = iminx; x <= imaxx; ++x)
+		int count = 0;
+		const unsigned int* items = getRowItems(cells[0], cells[2], y, count);
+		for (int j = 0; j < count; ++j)
 		{
-			const int h = hashPos2(x, y, m_bucketsSize);
-			unsigned short idx = m_buckets[h];
-			while (idx != 0xffff)
+			// Check if the id exists already.
+			const unsigned int* end = ids + n;
+			unsigned int* i = ids;
+			while (i != end && *i != items[j])
+				++i;
+			// Item not found, add it.
+			if (i == end)
 			{
-				Item& item = m_pool[idx];
-				if ((int)item.x == x && (int)item.y == y)
-				{
-					// Check if the id exists already.
-					const unsigned short* end = ids + n;
-					unsigned short* i = ids;
-					while (i != end && *i != item.id)
-						++i;
-					// Item not found, add it.
-					if (i == end)
-					{
-						if (n >= maxIds)
-							return n;
-						ids[n++] = item.id;
-					}
-				}
-				idx = item.next;
+				if (n >= maxIds)
+					return n;
+				ids[n++] = items[j];
 			}
 		}
 	}
@@ -178,17 +256,9 @@ int dtProximityGrid::queryItems(const float minx, const float miny,
 
 int dtProximityGrid::getItemCountAt(const int x, const int y) const
 {
-	int n = 0;
-	
-	const int h = hashPos2(x, y, m_bucketsSize);
-	unsigned short idx = m_buckets[h];
-	while (idx != 0xffff)
-	{
-		Item& item = m_pool[idx];
-		if ((int)item.x == x && (int)item.y == y)
-			n++;
-		idx = item.next;
-	}
-	
-	return n;
+	if (!m_width || x < m_bounds[0] || x > m_bounds[2] || y < m_bounds[1] || y > m_bounds[3])
+		return 0;
+	int count = 0;
+	getRowItems(x, x, y, count);
+	return count;
 }
@@ -1,7 +1,10 @@
 #ifndef DETOURTILECACHE_H
 #define DETOURTILECACHE_H
 
+#include "DetourAlloc.h"
+#include "DetourJobDispatcher.h"
 #include "DetourStatus.h"
+#include "DetourTimeBudget.h"
 
 typedef unsigned int dtObstacleRef;
 typedef unsigned int dtCompressedTileRef;
@@ -36,7 +39,8 @@ enum ObstacleType
 {
 	DT_OBSTACLE_CYLINDER,
 	DT_OBSTACLE_BOX, // AABB
-	DT_OBSTACLE_ORIENTED_BOX // OBB
+	DT_OBSTACLE_ORIENTED_BOX, // OBB
+	DT_OBSTACLE_CONVEX_POLYGON // Extruded convex polygon
 };
 
 struct dtObstacleCylinder
@@ -59,7 +63,23 @@ struct dtObstacleOrientedBox
 	float rotAux[ 2 ]; //{ cos(0.5f*angle)*sin(-0.5f*angle); cos(0.5f*angle)*cos(0.5f*angle) - 0.5 }
 };
 
+/// The maximum number of vertices of a convex polygon obstacle.
+static const int DT_MAX_OBSTACLE_POLYGON_VERTS = 12;
+
+struct dtObstacleConvexPolygon
+{
+	float verts[ DT_MAX_OBSTACLE_POLYGON_VERTS*2 ]; // (x, z) of each vertex
+	float hmin;
+	float hmax;
+	int nverts;
+};
+
+/// The default maximum number of tiles an obstacle can touch. (See: dtTileCacheParams::maxTouchedTiles)
 static const int DT_MAX_TOUCHED_TILES = 8;
+
+/// The default initial capacity of the obstacle request queue. (See: dtTileCacheParams::maxObstacleRequests)
+static const int DT_MAX_OBSTACLE_REQUESTS = 64;
+
 struct dtTileCacheObstacle
 {
 	union
@@ -67,18 +87,65 @@ struct dtTileCacheObstacle
 		dtObstacleCylinder cylinder;
 		dtObstacleBox box;
 		dtObstacleOrientedBox orientedBox;
+		dtObstacleConvexPolygon convexPolygon;
 	};
 
-	dtCompressedTileRef touched[DT_MAX_TOUCHED_TILES];
-	dtCompressedTileRef pending[DT_MAX_TOUCHED_TILES];
+	dtCompressedTileRef* touched;			///< The tiles the obstacle touches. [Size: dtTileCacheParams::maxTouchedTiles]
+	dtCompressedTileRef* pending;			///< The touched tiles still to be rebuilt. [Size: dtTileCacheParams::maxTouchedTiles]
 	unsigned short salt;
 	unsigned char type;
 	unsigned char state;
-	unsigned char ntouched;
-	unsigned char npending;
+	unsigned short ntouched;
+	unsigned short npending;
 	dtTileCacheObstacle* next;
 };
 
+/// Describes an obstacle added with dtTileCache::addObstacles.
+/// Only the fields of the obstacle type are used.
+struct dtTileCacheObstacleDesc
+{
+	unsigned char type;				///< The obstacle type. (See: #ObstacleType)
+	float pos[3];					///< The cylinder bottom center, or the oriented box center. [(x, y, z)]
+	float radius;					///< The cylinder radius.
+	float height;					///< The cylinder height.
+	float bmin[3];					///< The axis aligned box minimum bounds. [(x, y, z)]
+	float bmax[3];					///< The axis aligned box maximum bounds. [(x, y, z)]
+	float halfExtents[3];			///< The oriented box half extents. [(x, y, z)]
+	float yRadians;					///< The oriented box rotation around the y-axis.
+	float verts[DT_MAX_OBSTACLE_POLYGON_VERTS*3];	///< The convex polygon vertices. [(x, y, z) * #nverts]
+	int nverts;						///< The number of convex polygon vertices. [Limit: 3 <= value <= #DT_MAX_OBSTACLE_POLYGON_VERTS]
+	float hmin;						///< The height of the convex polygon base.
+	float hmax;						///< The height of the convex polygon top.
+};
+
+/// The reference and the shape of an obstacle, as saved in a snapshot and restored
+/// with dtTileCache::restoreObstacles.
+struct dtTileCacheObstacleState
+{
+	dtObstacleRef ref;				///< The reference of the obstacle.
+	int type;						///< The obstacle type. (See: #ObstacleType)
+	union
+	{
+		dtObstacleCylinder cylinder;
+		dtObstacleBox box;
+		dtObstacleOrientedBox orientedBox;
+		dtObstacleConvexPolygon convexPolygon;
+	};
+};
+
+/// How dtTileCache rebuilds the tiles touched by obstacles. (See: dtTileCacheParams::rebuildMode)
+enum dtTileCacheRebuildMode
+{
+	/// Decompresses the layer and builds its regions and contours from scratch.
+	DT_TILECACHE_REBUILD_FULL = 0,
+	
+	/// Keeps the obstacle free layer of each tile with its regions and contours once it has been built,
+	/// and only partitions and traces again the regions the obstacles change. Uses more memory per tile,
+	/// and the polygons can differ from a full rebuild around the obstacles.
+	/// The layers are kept in the layer cache. (See: dtTileCacheParams::layerCacheSize)
+	DT_TILECACHE_REBUILD_DIRTY_REGIONS = 1
+};
+
 struct dtTileCacheParams
 {
 	float orig[3];
@@ -90,6 +157,13 @@ struct dtTileCacheParams
 	float maxSimplificationError;
 	int maxTiles;
 	int maxObstacles;
+	int maxObstacleRequests;	///< The initial capacity of the obstacle request queue, it grows as needed. (Zero for #DT_MAX_OBSTACLE_REQUESTS.)
+	int maxTouchedTiles;		///< The maximum number of tiles an obstacle can touch. (Zero for #DT_MAX_TOUCHED_TILES.) [Limit: <= 65535]
+	int rebuildMode;			///< How tiles are rebuilt. (See: #dtTileCacheRebuildMode)
+	
+	/// The memory budget of the cache of decompressed layers, the least recently built layers are evicted
+	/// first. Zero disables the cache, or keeps every layer with #DT_TILECACHE_REBUILD_DIRTY_REGIONS. [Units: bytes]
+	int layerCacheSize;
 };
 
 struct dtTileCacheMeshProcess
@@ -98,6 +172,40 @@ struct dtTileCacheMeshProcess
 	virtual void process(struct dtNavMeshCreateParams* params, unsigned char* polyAreas, unsigned short* polyFlags) = 0;
 };
 
+/// Counts the use of the cache of decompressed layers. (See: dtTileCacheParams::layerCacheSize)
+/// @see dtTileCache::getLayerCacheStats
+struct dtTileCacheLayerCacheStats
+{
+	int hits;			///< The number of tile builds which used a cached layer.
+	int misses;			///< The number of tile builds which decompressed the layer.
+	int evictions;		///< The number of layers evicted to stay within the budget.
+	int layerCount;		///< The number of cached layers.
+	int memory;			///< The memory used by the cached layers. [Units: bytes]
+};
+
+/// Counts the work done by a dtTileCache::update call.
+/// Only updated when Detour is compiled with DT_QUERY_STATS defined, otherwise it stays zero.
+/// @see dtTileCache::getUpdateStats
+struct dtTileCacheUpdateStats
+{
+	int obstacleRequests;	///< The number of obstacle requests processed.
+	int tilesRebuilt;		///< The number of tiles rebuilt, including failed builds.
+	int failedTiles;		///< The number of tile builds which failed.
+	int pendingTiles;		///< The number of tiles still waiting to be rebuilt after the update.
+};
+
+/// The memory used by a tile cache, broken down by category. [Units: bytes]
+/// @see dtTileCache::getMemStats
+struct dtTileCacheMemStats
+{
+	size_t tiles;			///< The tile cache object, the tiles and the tile lookup.
+	size_t compressed;		///< The data of the tiles, including the layer headers.
+	size_t obstacles;		///< The obstacles, their touched tiles and links, and the obstacle requests.
+	size_t updates;			///< The tiles to rebuild and the concurrent tile builds.
+	size_t layerCache;		///< The decompressed layer cache.
+	size_t total;			///< The sum of all categories.
+};
+
 class dtTileCache
 {
 public:
@@ -141,8 +249,45 @@ public:
 
 	// Box obstacle: can be rotated in Y.
 	dtStatus addBoxObstacle(const float* center, const float* halfExtents, const float yRadians, dtObstacleRef* result);
+
+	/// Adds an obstacle extruded from a convex polygon, e.g. the footprint of a building.
+	///  @param[in]		verts		The polygon vertices, in either winding. [(x, y, z) * @p nverts]
+	///  @param[in]		nverts		The number of vertices. [Limit: 3 <= value <= #DT_MAX_OBSTACLE_POLYGON_VERTS]
+	///  @param[in]		hmin		The height of the polygon base.
+	///  @param[in]		hmax		The height of the polygon top.
+	///  @param[out]	result		The reference of the added obstacle. [opt]
+	/// @returns The status flags for the operation.
+	dtStatus addConvexObstacle(const float* verts, const int nverts, const float hmin, const float hmax,
+							   dtObstacleRef* result);
 	
 	dtStatus removeObstacle(const dtObstacleRef ref);
+
+	/// Adds a batch of obstacles. Either all of the obstacles are added, or none.
+	/// The tiles touched by several obstacles of the batch are rebuilt once.
+	///  @param[in]		obstacles	The obstacles to add. [Size: @p count]
+	///  @param[in]		count		The number of obstacles.
+	///  @param[out]	results		The references of the added obstacles. [Size: @p count] [opt]
+	/// @returns The status flags for the operation.
+	dtStatus addObstacles(const dtTileCacheObstacleDesc* obstacles, const int count, dtObstacleRef* results);
+
+	/// Removes a batch of obstacles.
+	/// The tiles touched by several obstacles of the batch are rebuilt once.
+	///  @param[in]		refs		The references of the obstacles to remove. [Size: @p count]
+	///  @param[in]		count		The number of obstacles.
+	/// @returns The status flags for the operation.
+	dtStatus removeObstacles(const dtObstacleRef* refs, const int count);
+
+	/// Restores obstacles with their references, as if they had been added and their tiles rebuilt.
+	/// No tiles are rebuilt, the navigation mesh must already contain the tiles built with the obstacles.
+	/// Either all of the obstacles are restored, or none.
+	///  @param[in]		obstacles	The obstacles to restore. [Size: @p count]
+	///  @param[in]		count		The number of obstacles.
+	/// @returns The status flags for the operation.
+	dtStatus restoreObstacles(const dtTileCacheObstacleState* obstacles, const int count);
+
+	/// Whether all obstacle requests have been processed and all touched tiles rebuilt.
+	/// @return True if another call to #update would have no effect.
+	bool isUpToDate() const { return m_nreqs == 0 && m_nupdate == 0; }
 	
 	dtStatus queryTiles(const float* bmin, const float* bmax,
 						dtCompressedTileRef* results, int* resultCount, const int maxResults) const;
@@ -154,7 +299,48 @@ public:
 	///  							If the tile cache is up to date another (immediate) call to update will have no effect;
 	///  							otherwise another call will continue processing obstacle requests and tile rebuilds.
 	dtStatus update(const float dt, class dtNavMesh* navmesh, bool* upToDate = 0);
-	
+
+	/// Updates the tile cache, rebuilding tiles until the tile cache is up to date or the budget expires.
+	/// At least one tile is rebuilt per call, the deadline is checked after each tile.
+	///  @param[in]		dt			The time step size. Currently not used.
+	///  @param[in]		navmesh		The mesh to affect when rebuilding tiles.
+	///  @param[in]		budget		The time budget for the update.
+	///  @param[out]	upToDate	Whether the tile cache is fully up to date with obstacle requests and tile rebuilds.
+	///  @param[out]	builtTiles	The number of tiles rebuilt. [opt]
+	dtStatus update(const float dt, class dtNavMesh* navmesh, const dtTimeBudget& budget,
+					bool* upToDate = 0, int* builtTiles = 0);
+	
+	/// Sets the dispatcher used to rebuild tiles concurrently.
+	/// When a dispatcher is set, #update rebuilds all tiles touched by the pending obstacle
+	/// requests at once. The tile meshes are built by the dispatcher jobs, and only the
+	/// navigation mesh tiles are replaced on the calling thread.
+	/// The compressor, the mesh process and the Detour allocator must be thread safe when
+	/// the dispatcher runs jobs concurrently.
+	///  @param[in]		dispatcher		The dispatcher, or null to rebuild one tile per update on the calling thread.
+	///  								Must stay valid while set.
+	///  @param[in]		workerAllocs	The allocators used by each worker. Must stay valid while set.
+	///  								[Size: dtJobDispatcher::getWorkerCount()]
+	/// @returns The status flags for the operation.
+	dtStatus setJobDispatcher(dtJobDispatcher* dispatcher, struct dtTileCacheAlloc** workerAllocs);
+
+	/// Gets the work done by the last call to #update. The budgeted update sums the
+	/// work of all tiles rebuilt within the budget. (See: #DT_QUERY_STATS)
+	/// @return The statistics of the last update.
+	const dtTileCacheUpdateStats& getUpdateStats() const { return m_updateStats; }
+
+	/// Gets the use of the decompressed layer cache since the tile cache was initialized,
+	/// or since the last call to #resetLayerCacheStats.
+	/// @return The layer cache statistics.
+	const dtTileCacheLayerCacheStats& getLayerCacheStats() const { return m_layerCacheStats; }
+
+	/// Resets the hit, miss and eviction counts of the layer cache statistics.
+	void resetLayerCacheStats();
+
+	/// Gets the memory used by the tile cache. The memory of the worker allocators and
+	/// of the nav mesh tiles built from the cache is not included.
+	///  @param[out]	stats	The memory usage.
+	void getMemStats(dtTileCacheMemStats* stats) const;
+
 	dtStatus buildNavMeshTilesAt(const int tx, const int ty, class dtNavMesh* navmesh);
 	
 	dtStatus buildNavMeshTile(const dtCompressedTileRef ref, class dtNavMesh* navmesh);
@@ -221,6 +407,74 @@ private:
 		int action;
 		dtObstacleRef ref;
 	};
+
+	/// Links an obstacle to the list of obstacles of one of the tiles it touches.
+	struct ObstacleLink
+	{
+		int next;
+		int prev;
+	};
+
+	/// The decompressed layer of a tile, with its regions and contours when rebuilding dirty regions.
+	/// The jobs of a dispatcher only create cached layers, they are linked and evicted on the calling thread.
+	struct CachedLayer
+	{
+		struct dtTileCacheLayer* layer;
+		struct dtTileCacheContourSet* lcset;
+		int size;						///< The memory used by the layer. [Units: bytes]
+		int prev;						///< The previous more recently used layer, or -1.
+		int next;						///< The next less recently used layer, or -1.
+		bool linked;					///< True if the layer is in the recently used list.
+	};
+
+	struct TileBuildJob
+	{
+		dtCompressedTileRef ref;
+		unsigned char* navData;
+		int navDataSize;
+		dtStatus status;
+	};
+
+	/// Builds the navigation mesh data of a tile. Sets @p navData to null if the tile is empty.
+	dtStatus buildNavMeshTileData(const dtCompressedTileRef ref, dtTileCacheAlloc* talloc,
+								  unsigned char** navData, int* navDataSize) const;
+
+	/// Decompresses the layer of a tile to the cache, and builds its regions and contours when rebuilding dirty regions.
+	dtStatus buildCachedLayer(const dtCompressedTile* tile, CachedLayer& cached) const;
+
+	/// Counts the build of the tile as a cache hit or miss, makes its layer the most recently used,
+	/// and evicts layers until the cache is within the budget.
+	void useCachedLayer(const dtCompressedTileRef ref);
+
+	/// Removes the layer from the recently used list and frees it.
+	void freeCachedLayer(const int tileIndex);
+
+	/// Replaces the navigation mesh tile at the location of the tile, the mesh takes ownership of @p navData.
+	dtStatus replaceNavMeshTile(const dtCompressedTileRef ref, unsigned char* navData, const int navDataSize,
+								class dtNavMesh* navmesh);
+
+	/// Takes an obstacle from the free list and resets it.
+	dtTileCacheObstacle* allocObstacle();
+
+	/// Initializes an obstacle from the description.
+	void setObstacle(dtTileCacheObstacle* ob, const dtTileCacheObstacleDesc& desc);
+
+	/// Makes room for @p count more obstacle requests.
+	bool reserveRequests(const int count);
+
+	/// Adds the obstacle tiles to the update list and to the pending list of the obstacle.
+	void addPendingTiles(dtTileCacheObstacle* ob);
+
+	/// Adds the obstacle to the obstacle lists of the tiles it touches.
+	void linkObstacle(const dtTileCacheObstacle* ob);
+
+	/// Removes the obstacle from the obstacle lists of the tiles it touches.
+	void unlinkObstacle(const dtTileCacheObstacle* ob);
+
+	/// Removes the rebuilt tile from the pending lists of the obstacles.
+	void updateObstacleStates(const dtCompressedTileRef ref);
+
+	static void runBuildJob(void* userData, const int jobIndex, const int workerIndex);
 	
 	int m_tileLutSize;						///< Tile hash lookup size (must be pot).
 	int m_tileLutMask;						///< Tile hash lookup mask.
@@ -241,13 +495,29 @@ private:
 	dtTileCacheObstacle* m_obstacles;
 	dtTileCacheObstacle* m_nextFreeObstacle;
 	
-	static const int MAX_REQUESTS = 64;
-	ObstacleRequest m_reqs[MAX_REQUESTS];
+	dtCompressedTileRef* m_touchedTiles;	///< The touched and pending tiles of all obstacles. [Size: maxObstacles * maxTouchedTiles * 2]
+	
+	/// The obstacle list links, one per touched tile of each obstacle. [Size: maxObstacles * maxTouchedTiles]
+	/// Link i belongs to obstacle i / maxTouchedTiles, and to its touched tile i % maxTouchedTiles.
+	ObstacleLink* m_obstacleLinks;
+	int* m_tileObstacles;					///< The first obstacle link of each tile, or -1. [Size: maxTiles]
+	
+	ObstacleRequest* m_reqs;				///< The obstacle requests. [Size: #m_maxReqs]
 	int m_nreqs;
+	int m_maxReqs;
 	
-	static const int MAX_UPDATE = 64;
-	dtCompressedTileRef m_update[MAX_UPDATE];
+	dtCompressedTileRef* m_update;			///< The tiles to rebuild. [Size: maxTiles]
 	int m_nupdate;
+
+	dtJobDispatcher* m_dispatcher;
+	dtTileCacheAlloc** m_workerAllocs;		///< Per-worker allocators. [Size: dtJobDispatcher::getWorkerCount()]
+	TileBuildJob* m_buildJobs;				///< The concurrent tile builds. [Size: maxTiles]
+	CachedLayer* m_layerCache;				///< The cached layers, null if the cache is disabled. [Size: maxTiles]
+	int m_layerCacheHead;					///< The most recently used cached layer, or -1.
+	int m_layerCacheTail;					///< The least recently used cached layer, or -1.
+	dtTileCacheLayerCacheStats m_layerCacheStats;
+
+	dtTileCacheUpdateStats m_updateStats;	///< The work done by the last update.
 };
 
 dtTileCache* dtAllocTileCache();
@@ -0,0 +1,193 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#ifndef DETOURTILECACHEARCHIVE_H
+#define DETOURTILECACHEARCHIVE_H
+
+#include "DetourNavMesh.h"
+#include "DetourStatus.h"
+#include "DetourTileCache.h"
+
+/// A magic number used to detect compatibility of tile cache archives.
+static const int DT_TILECACHE_ARCHIVE_MAGIC = 'D'<<24 | 'T'<<16 | 'C'<<8 | 'A'; ///< 'DTCA'
+
+/// A version number used to detect compatibility of tile cache archives.
+static const int DT_TILECACHE_ARCHIVE_VERSION = 1;
+
+/// A magic number used to detect compatibility of tile cache snapshots.
+static const int DT_TILECACHE_SNAPSHOT_MAGIC = 'D'<<24 | 'T'<<16 | 'C'<<8 | 'S'; ///< 'DTCS'
+
+/// A version number used to detect compatibility of tile cache snapshots.
+static const int DT_TILECACHE_SNAPSHOT_VERSION = 1;
+
+/// The header of a tile cache archive.
+/// @note This structure is rarely if ever used by the end user.
+struct dtTileCacheArchiveHeader
+{
+	int magic;						///< Archive magic number. (See: #DT_TILECACHE_ARCHIVE_MAGIC)
+	int version;					///< Archive format version number. (See: #DT_TILECACHE_ARCHIVE_VERSION)
+	dtTileCacheParams cacheParams;	///< The tile cache initialization params.
+	dtNavMeshParams meshParams;		///< The navigation mesh initialization params.
+};
+
+/// The header of a tile cache snapshot.
+/// @note This structure is rarely if ever used by the end user.
+struct dtTileCacheSnapshotHeader
+{
+	int magic;						///< Snapshot magic number. (See: #DT_TILECACHE_SNAPSHOT_MAGIC)
+	int version;					///< Snapshot format version number. (See: #DT_TILECACHE_SNAPSHOT_VERSION)
+	int obstacleCount;				///< The number of obstacles.
+	int tileCount;					///< The number of navigation mesh tile records.
+};
+
+/// Receives the bytes of a tile cache archive as it is written, e.g. to a file.
+class dtTileCacheArchiveOutput
+{
+public:
+	virtual ~dtTileCacheArchiveOutput() {}
+
+	/// Writes a block of bytes to the end of the archive.
+	///  @param[in]		data		The bytes to write.
+	///  @param[in]		size		The number of bytes to write.
+	/// @return True if all bytes were written.
+	virtual bool write(const void* data, const int size) = 0;
+};
+
+/// Provides the bytes of a tile cache archive as it is read, e.g. from a file.
+class dtTileCacheArchiveInput
+{
+public:
+	virtual ~dtTileCacheArchiveInput() {}
+
+	/// Reads the next block of bytes of the archive.
+	///  @param[out]	data		The buffer to read into.
+	///  @param[in]		size		The number of bytes to read.
+	/// @return True if all bytes were read.
+	virtual bool read(void* data, const int size) = 0;
+};
+
+/// Writes the header of a tile cache archive. Must be written before the layers.
+///  @param[in]		out				The archive output.
+///  @param[in]		cacheParams		The tile cache initialization params.
+///  @param[in]		meshParams		The navigation mesh initialization params.
+/// @returns The status flags for the operation.
+dtStatus dtWriteTileCacheArchiveHeader(dtTileCacheArchiveOutput* out, const dtTileCacheParams* cacheParams,
+									   const dtNavMeshParams* meshParams);
+
+/// Appends a compressed layer to a tile cache archive.
+///  @param[in]		out				The archive output.
+///  @param[in]		data			The compressed layer data, as built by #dtBuildTileCacheLayer.
+///  @param[in]		dataSize		The size of the layer data.
+/// @returns The status flags for the operation.
+dtStatus dtWriteTileCacheArchiveLayer(dtTileCacheArchiveOutput* out, const unsigned char* data, const int dataSize);
+
+/// Ends a tile cache archive. Must be written after the last layer.
+///  @param[in]		out				The archive output.
+/// @returns The status flags for the operation.
+dtStatus dtWriteTileCacheArchiveEnd(dtTileCacheArchiveOutput* out);
+
+/// Reads and validates the header of a tile cache archive.
+///  @param[in]		in				The archive input.
+///  @param[out]	header			The archive header.
+/// @returns The status flags for the operation.
+dtStatus dtReadTileCacheArchiveHeader(dtTileCacheArchiveInput* in, dtTileCacheArchiveHeader* header);
+
+/// Reads the next compressed layer of a tile cache archive.
+///  @param[in]		in				The archive input.
+///  @param[out]	data			The layer data, or null at the end of the archive. Free with #dtFree
+///  								unless added to a tile cache with #DT_COMPRESSEDTILE_FREE_DATA.
+///  @param[out]	dataSize		The size of the layer data.
+/// @returns The status flags for the operation.
+dtStatus dtReadTileCacheArchiveLayer(dtTileCacheArchiveInput* in, unsigned char** data, int* dataSize);
+
+/// Reads the remaining layers of a tile cache archive and adds them to a tile cache,
+/// which owns the layer data once added.
+///  @param[in]		in				The archive input, positioned after the header.
+///  @param[in]		tileCache		The tile cache, initialized with the params of the archive header.
+///  @param[out]	layerCount		The number of layers added. [opt]
+/// @returns The status flags for the operation.
+dtStatus dtAddTileCacheArchiveLayers(dtTileCacheArchiveInput* in, dtTileCache* tileCache, int* layerCount = 0);
+
+/// Writes the obstacles of a tile cache and the navigation mesh tiles built from its layers.
+///  @param[in]		out				The snapshot output.
+///  @param[in]		tileCache		The tile cache, which must be up to date. (See: dtTileCache::isUpToDate)
+///  @param[in]		navmesh			The navigation mesh the tile cache builds its tiles into.
+/// @returns The status flags for the operation.
+dtStatus dtWriteTileCacheSnapshot(dtTileCacheArchiveOutput* out, const dtTileCache* tileCache, const dtNavMesh* navmesh);
+
+/// Restores the obstacles and the navigation mesh tiles of a tile cache snapshot, without rebuilding any tile.
+///  @param[in]		in				The snapshot input.
+///  @param[in]		tileCache		The tile cache, which must hold the same layers as the one the snapshot was written from.
+///  @param[in]		navmesh			The navigation mesh the tile cache builds its tiles into.
+/// @returns The status flags for the operation.
+dtStatus dtRestoreTileCacheSnapshot(dtTileCacheArchiveInput* in, dtTileCache* tileCache, dtNavMesh* navmesh);
+
+#endif // DETOURTILECACHEARCHIVE_H
+
+///////////////////////////////////////////////////////////////////////////
+
+// This section contains detailed documentation for members that don't have
+// a source file. It reduces clutter in the main section of the header.
+
+/**
+
+@fn dtStatus dtWriteTileCacheArchiveHeader(dtTileCacheArchiveOutput* out, const dtTileCacheParams* cacheParams, const dtNavMeshParams* meshParams)
+@par
+
+A tile cache archive holds the params of the tile cache and its navigation
+mesh, followed by the compressed layers and an end marker. Each layer is
+stored as its size followed by its data, padded to four bytes. The archive
+is written and read front to back and never needs the number of layers up
+front, so a bake can stream the layers to the archive as they are built,
+e.g. from rcTileLayerBuildCallbacks::addLayer, and a game can add them to
+the tile cache as they are read.
+
+The archive uses the native endianness, like the layer data.
+
+@see dtReadTileCacheArchiveHeader, dtAddTileCacheArchiveLayers
+
+@fn dtStatus dtWriteTileCacheSnapshot(dtTileCacheArchiveOutput* out, const dtTileCache* tileCache, const dtNavMesh* navmesh)
+@par
+
+A snapshot holds the state a running tile cache builds up on top of its
+archive: the obstacles with their references, and the navigation mesh tile
+at the location of every layer. Restoring it installs the tiles as they
+were written instead of rebuilding every tile touched by an obstacle, which
+makes it cheap to bring back a level with many obstacles.
+
+The snapshot does not hold the layers. They are restored from the tile cache
+archive first, and then the snapshot is restored on top:
+
+@code
+dtAddTileCacheArchiveLayers(archive, tileCache);
+dtRestoreTileCacheSnapshot(snapshot, tileCache, navmesh);
+@endcode
+
+The obstacles keep their references, so the obstacle references held by the
+game stay valid. The obstacle slots must be free, and the tile cache must
+not have pending obstacle requests. The navigation mesh tiles keep their
+references when their slots are free, e.g. in a new navigation mesh. A tile
+already in the navigation mesh at the location of a layer is replaced, or
+removed when the layer had no tile.
+
+Like the archive, the snapshot uses the native endianness.
+
+@see dtRestoreTileCacheSnapshot, dtTileCache::restoreObstacles
+
+*/
@@ -28,6 +28,7 @@ static const int DT_TILECACHE_VERSION = 1;
 static const unsigned char DT_TILECACHE_NULL_AREA = 0;
 static const unsigned char DT_TILECACHE_WALKABLE_AREA = 63;
 static const unsigned short DT_TILECACHE_NULL_IDX = 0xffff;
+static const unsigned short DT_TILECACHE_NULL_REG = 0xffff;	///< The region id of cells which are not in a region.
 
 struct dtTileCacheLayerHeader
 {
@@ -43,18 +44,18 @@ struct dtTileCacheLayerHeader
 struct dtTileCacheLayer
 {
 	dtTileCacheLayerHeader* header;
-	unsigned char regCount;					///< Region count.
+	unsigned short regCount;				///< Region count.
 	unsigned char* heights;
 	unsigned char* areas;
 	unsigned char* cons;
-	unsigned char* regs;
+	unsigned short* regs;					///< The region of each cell, or #DT_TILECACHE_NULL_REG.
 };
 
 struct dtTileCacheContour
 {
 	int nverts;
 	unsigned char* verts;
-	unsigned char reg;
+	unsigned short reg;
 	unsigned char area;
 };
 
@@ -118,6 +119,13 @@ dtStatus dtDecompressTileCacheLayer(dtTileCacheAlloc* alloc, dtTileCacheCompress
 									unsigned char* compressed, const int compressedSize,
 									dtTileCacheLayer** layerOut);
 
+/// Copies a layer to one block of memory, laid out like a decompressed layer. Free it with #dtFreeTileCacheLayer.
+///  @param[in]		alloc		The allocator for the copy.
+///  @param[in]		src			The layer to copy.
+///  @param[out]	layerOut	The copy.
+/// @returns The status flags for the operation.
+dtStatus dtCopyTileCacheLayer(dtTileCacheAlloc* alloc, const dtTileCacheLayer& src, dtTileCacheLayer** layerOut);
+
 dtTileCacheContourSet* dtAllocTileCacheContourSet(dtTileCacheAlloc* alloc);
 void dtFreeTileCacheContourSet(dtTileCacheAlloc* alloc, dtTileCacheContourSet* cset);
 
@@ -133,6 +141,35 @@ dtStatus dtMarkBoxArea(dtTileCacheLayer& layer, const float* orig, const float c
 dtStatus dtMarkBoxArea(dtTileCacheLayer& layer, const float* orig, const float cs, const float ch,
 					   const float* center, const float* halfExtents, const float* rotAux, const unsigned char areaId);
 
+/// Marks the cells whose centers are inside a convex polygon, extruded from @p hmin to @p hmax.
+///  @param[in,out]	layer		The layer to mark.
+///  @param[in]		orig		The origin of the layer. [(x, y, z)]
+///  @param[in]		cs			The cell size.
+///  @param[in]		ch			The cell height.
+///  @param[in]		verts		The vertices of the polygon, in either winding. [(x, y, z) * @p nverts]
+///  @param[in]		nverts		The number of vertices. [Limit: >= 3]
+///  @param[in]		hmin		The height of the base of the polygon.
+///  @param[in]		hmax		The height of the top of the polygon.
+///  @param[in]		areaId		The area id of the marked cells.
+/// @returns The status flags for the operation.
+dtStatus dtMarkConvexPolygonArea(dtTileCacheLayer& layer, const float* orig, const float cs, const float ch,
+								 const float* verts, const int nverts, const float hmin, const float hmax,
+								 const unsigned char areaId);
+
+/// Marks the cells of all obstacles touching a layer, walking the rows of the layer once
+/// for every batch of obstacles instead of once per obstacle.
+///  @param[in,out]	layer		The layer to mark.
+///  @param[in]		orig		The origin of the layer. [(x, y, z)]
+///  @param[in]		cs			The cell size.
+///  @param[in]		ch			The cell height.
+///  @param[in]		obstacles	The obstacles to mark. [Size: @p count]
+///  @param[in]		count		The number of obstacles.
+///  @param[in]		areaId		The area id of the marked cells.
+/// @returns The status flags for the operation.
+dtStatus dtMarkObstacleAreas(dtTileCacheLayer& layer, const float* orig, const float cs, const float ch,
+							 const struct dtTileCacheObstacle* const* obstacles, const int count,
+							 const unsigned char areaId);
+
 dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 								 dtTileCacheLayer& layer,
 								 const int walkableClimb);
@@ -142,6 +179,41 @@ dtStatus dtBuildTileCacheContours(dtTileCacheAlloc* alloc,
 								  const int walkableClimb, 	const float maxError,
 								  dtTileCacheContourSet& lcset);
 
+/// Builds the regions of a layer whose areas were changed, e.g. by obstacles, from the regions of the
+/// same layer before the change.
+///
+/// Only the regions with changed cells are partitioned again, the other regions keep their cells and ids.
+/// The result is a valid monotone partition, but not necessarily the one #dtBuildTileCacheRegions builds.
+///  @param[in]		alloc			The allocator for the temporary memory.
+///  @param[in,out]	layer			The layer with the changed areas.
+///  @param[in]		base			The layer before the change, with its regions. Must have the same size and heights.
+///  @param[in]		walkableClimb	The walkable climb. [Units: vx]
+///  @param[out]	dirtyRegs		Set to 1 for the regions whose contours changed, and 0 for the others. [Size: @p maxDirtyRegs]
+///  @param[in]		maxDirtyRegs	The size of @p dirtyRegs, the region ids of the layer stay below it.
+/// @returns The status flags for the operation. Fails with #DT_BUFFER_TOO_SMALL if the region ids run out.
+dtStatus dtUpdateTileCacheRegions(dtTileCacheAlloc* alloc,
+								  dtTileCacheLayer& layer,
+								  const dtTileCacheLayer& base,
+								  const int walkableClimb,
+								  unsigned char* dirtyRegs, const int maxDirtyRegs);
+
+/// Builds the contours of a layer updated by #dtUpdateTileCacheRegions. The contours of the regions
+/// which did not change are copied from the contours of the layer before the change.
+///  @param[in]		alloc			The allocator for the contours and the temporary memory.
+///  @param[in,out]	layer			The updated layer.
+///  @param[in]		walkableClimb	The walkable climb. [Units: vx]
+///  @param[in]		maxError		The maximum distance of a simplified contour from the region edge. [Units: vx]
+///  @param[in]		base			The contours of the layer before the change.
+///  @param[in]		dirtyRegs		The dirty regions from dtUpdateTileCacheRegions. [Size: >= layer.regCount]
+///  @param[out]	lcset			The contours.
+/// @returns The status flags for the operation.
+dtStatus dtUpdateTileCacheContours(dtTileCacheAlloc* alloc,
+								   dtTileCacheLayer& layer,
+								   const int walkableClimb, const float maxError,
+								   const dtTileCacheContourSet& base,
+								   const unsigned char* dirtyRegs,
+								   dtTileCacheContourSet& lcset);
+
 dtStatus dtBuildTileCachePolyMesh(dtTileCacheAlloc* alloc,
 								  dtTileCacheContourSet& lcset,
 								  dtTileCachePolyMesh& mesh);
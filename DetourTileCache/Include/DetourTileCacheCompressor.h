@@ -0,0 +1,66 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURTILECACHECOMPRESSOR_H
+#define DETOURTILECACHECOMPRESSOR_H
+
+#include "DetourTileCacheBuilder.h"
+
+/// A dependency free compressor tuned to the tile cache layer data.
+///
+/// The buffers written by #dtBuildTileCacheLayer hold the heights, areas and
+/// connections planes one after another. The heights are delta coded, which
+/// turns flat and sloped ground into runs of equal bytes, and all planes are
+/// then run-length coded. Large flat areas and uniform area types compress
+/// very well, and decompression is a single pass without lookups.
+///
+/// The compressor keeps no state, so it can be used from several threads.
+/// @see dtTileCacheDeltaCompressor
+struct dtTileCacheRLECompressor : public dtTileCacheCompressor
+{
+	virtual ~dtTileCacheRLECompressor();
+
+	virtual int maxCompressedSize(const int bufferSize);
+	virtual dtStatus compress(const unsigned char* buffer, const int bufferSize,
+							  unsigned char* compressed, const int maxCompressedSize, int* compressedSize);
+	virtual dtStatus decompress(const unsigned char* compressed, const int compressedSize,
+								unsigned char* buffer, const int maxBufferSize, int* bufferSize);
+};
+
+/// Delta codes the heights plane of the layer data before passing it to
+/// another compressor, e.g. an LZ4 or zstd adaptor of the host application.
+///
+/// The compressor is as thread safe as the compressor it wraps.
+/// @see dtTileCacheRLECompressor
+struct dtTileCacheDeltaCompressor : public dtTileCacheCompressor
+{
+	/// @param[in]	comp	The compressor used after the delta coding. Must stay valid while in use.
+	explicit dtTileCacheDeltaCompressor(dtTileCacheCompressor* comp) : m_comp(comp) {}
+	virtual ~dtTileCacheDeltaCompressor();
+
+	virtual int maxCompressedSize(const int bufferSize);
+	virtual dtStatus compress(const unsigned char* buffer, const int bufferSize,
+							  unsigned char* compressed, const int maxCompressedSize, int* compressedSize);
+	virtual dtStatus decompress(const unsigned char* compressed, const int compressedSize,
+								unsigned char* buffer, const int maxBufferSize, int* bufferSize);
+
+private:
+	dtTileCacheCompressor* m_comp;
+};
+
+#endif // DETOURTILECACHECOMPRESSOR_H
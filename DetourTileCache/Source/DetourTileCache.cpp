@@ -39,6 +39,17 @@ inline int computeTileHash(int x, int y, const int mask)
 	return (int)(n & mask);
 }
 
+/// Allocates the cached layers, which live until they are evicted or their tile is removed.
+struct dtTileCachePermAlloc : public dtTileCacheAlloc
+{
+	virtual void* alloc(const size_t size)
+	{
+		return dtAlloc(size, DT_ALLOC_PERM);
+	}
+};
+
+static dtTileCachePermAlloc s_cacheAlloc;
+
 
 struct NavMeshTileBuildContext
 {
@@ -73,11 +84,24 @@ dtTileCache::dtTileCache() :
 	m_tmproc(0),
 	m_obstacles(0),
 	m_nextFreeObstacle(0),
+	m_touchedTiles(0),
+	m_obstacleLinks(0),
+	m_tileObstacles(0),
+	m_reqs(0),
 	m_nreqs(0),
-	m_nupdate(0)
+	m_maxReqs(0),
+	m_update(0),
+	m_nupdate(0),
+	m_dispatcher(0),
+	m_workerAllocs(0),
+	m_buildJobs(0),
+	m_layerCache(0),
+	m_layerCacheHead(-1),
+	m_layerCacheTail(-1)
 {
 	memset(&m_params, 0, sizeof(m_params));
-	memset(m_reqs, 0, sizeof(ObstacleRequest) * MAX_REQUESTS);
+	memset(&m_updateStats, 0, sizeof(m_updateStats));
+	memset(&m_layerCacheStats, 0, sizeof(m_layerCacheStats));
 }
 	
 dtTileCache::~dtTileCache()
@@ -92,6 +116,25 @@ dtTileCache::~dtTileCache()
 	}
 	dtFree(m_obstacles);
 	m_obstacles = 0;
+	dtFree(m_touchedTiles);
+	m_touchedTiles = 0;
+	dtFree(m_obstacleLinks);
+	m_obstacleLinks = 0;
+	dtFree(m_tileObstacles);
+	m_tileObstacles = 0;
+	dtFree(m_reqs);
+	m_reqs = 0;
+	dtFree(m_update);
+	m_update = 0;
+	dtFree(m_buildJobs);
+	m_buildJobs = 0;
+	if (m_layerCache)
+	{
+		for (int i = 0; i < m_params.maxTiles; ++i)
+			freeCachedLayer(i);
+		dtFree(m_layerCache);
+		m_layerCache = 0;
+	}
 	dtFree(m_posLookup);
 	m_posLookup = 0;
 	dtFree(m_tiles);
@@ -125,20 +168,67 @@ dtStatus dtTileCache::init(const dtTileCacheParams* params,
 	m_tmproc = tmproc;
 	m_nreqs = 0;
 	memcpy(&m_params, params, sizeof(m_params));
+	if (m_params.maxObstacleRequests <= 0)
+		m_params.maxObstacleRequests = DT_MAX_OBSTACLE_REQUESTS;
+	if (m_params.maxTouchedTiles <= 0)
+		m_params.maxTouchedTiles = DT_MAX_TOUCHED_TILES;
+	if (m_params.maxTouchedTiles > 0xffff)
+		return DT_FAILURE | DT_INVALID_PARAM;
 	
 	// Alloc space for obstacles.
+	const int maxTouched = m_params.maxTouchedTiles;
 	m_obstacles = (dtTileCacheObstacle*)dtAlloc(sizeof(dtTileCacheObstacle)*m_params.maxObstacles, DT_ALLOC_PERM);
 	if (!m_obstacles)
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	m_touchedTiles = (dtCompressedTileRef*)dtAlloc(sizeof(dtCompressedTileRef)*m_params.maxObstacles*maxTouched*2, DT_ALLOC_PERM);
+	if (!m_touchedTiles)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	m_obstacleLinks = (ObstacleLink*)dtAlloc(sizeof(ObstacleLink)*m_params.maxObstacles*maxTouched, DT_ALLOC_PERM);
+	if (!m_obstacleLinks)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	m_tileObstacles = (int*)dtAlloc(sizeof(int)*dtMax(m_params.maxTiles, 1), DT_ALLOC_PERM);
+	if (!m_tileObstacles)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	for (int i = 0; i < m_params.maxTiles; ++i)
+		m_tileObstacles[i] = -1;
 	memset(m_obstacles, 0, sizeof(dtTileCacheObstacle)*m_params.maxObstacles);
 	m_nextFreeObstacle = 0;
 	for (int i = m_params.maxObstacles-1; i >= 0; --i)
 	{
 		m_obstacles[i].salt = 1;
+		m_obstacles[i].touched = &m_touchedTiles[i*maxTouched*2];
+		m_obstacles[i].pending = &m_touchedTiles[i*maxTouched*2 + maxTouched];
 		m_obstacles[i].next = m_nextFreeObstacle;
 		m_nextFreeObstacle = &m_obstacles[i];
 	}
 	
+	// Alloc space for requests and updates.
+	m_maxReqs = m_params.maxObstacleRequests;
+	m_reqs = (ObstacleRequest*)dtAlloc(sizeof(ObstacleRequest)*m_maxReqs, DT_ALLOC_PERM);
+	if (!m_reqs)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	m_nupdate = 0;
+	m_update = (dtCompressedTileRef*)dtAlloc(sizeof(dtCompressedTileRef)*dtMax(m_params.maxTiles, 1), DT_ALLOC_PERM);
+	if (!m_update)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	m_buildJobs = (TileBuildJob*)dtAlloc(sizeof(TileBuildJob)*dtMax(m_params.maxTiles, 1), DT_ALLOC_PERM);
+	if (!m_buildJobs)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	if (m_params.rebuildMode != DT_TILECACHE_REBUILD_FULL && m_params.rebuildMode != DT_TILECACHE_REBUILD_DIRTY_REGIONS)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (m_params.layerCacheSize < 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (m_params.layerCacheSize > 0 || m_params.rebuildMode == DT_TILECACHE_REBUILD_DIRTY_REGIONS)
+	{
+		m_layerCache = (CachedLayer*)dtAlloc(sizeof(CachedLayer)*dtMax(m_params.maxTiles, 1), DT_ALLOC_PERM);
+		if (!m_layerCache)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		memset(m_layerCache, 0, sizeof(CachedLayer)*dtMax(m_params.maxTiles, 1));
+	}
+	m_layerCacheHead = -1;
+	m_layerCacheTail = -1;
+	memset(&m_layerCacheStats, 0, sizeof(m_layerCacheStats));
+	
 	// Init tiles
 	m_tileLutSize = dtNextPow2(m_params.maxTiles/4);
 	if (!m_tileLutSize) m_tileLutSize = 1;
@@ -342,6 +432,8 @@ dtStatus dtTileCache::removeTile(dtCompressedTileRef ref, unsigned char** data,
 	tile->compressed = 0;
 	tile->compressedSize = 0;
 	tile->flags = 0;
+	if (m_layerCache)
+		freeCachedLayer((int)tileIndex);
 	
 	// Update salt, salt should never be zero.
 	tile->salt = (tile->salt+1) & ((1<<m_saltBits)-1);
@@ -356,125 +448,257 @@ dtStatus dtTileCache::removeTile(dtCompressedTileRef ref, unsigned char** data,
 }
 
 
-dtStatus dtTileCache::addObstacle(const float* pos, const float radius, const float height, dtObstacleRef* result)
+dtTileCacheObstacle* dtTileCache::allocObstacle()
 {
-	if (m_nreqs >= MAX_REQUESTS)
-		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
-	
-	dtTileCacheObstacle* ob = 0;
-	if (m_nextFreeObstacle)
-	{
-		ob = m_nextFreeObstacle;
-		m_nextFreeObstacle = ob->next;
-		ob->next = 0;
-	}
+	dtTileCacheObstacle* ob = m_nextFreeObstacle;
 	if (!ob)
-		return DT_FAILURE | DT_OUT_OF_MEMORY;
+		return 0;
+	m_nextFreeObstacle = ob->next;
 	
 	unsigned short salt = ob->salt;
+	dtCompressedTileRef* touched = ob->touched;
+	dtCompressedTileRef* pending = ob->pending;
 	memset(ob, 0, sizeof(dtTileCacheObstacle));
 	ob->salt = salt;
+	ob->touched = touched;
+	ob->pending = pending;
 	ob->state = DT_OBSTACLE_PROCESSING;
-	ob->type = DT_OBSTACLE_CYLINDER;
-	dtVcopy(ob->cylinder.pos, pos);
-	ob->cylinder.radius = radius;
-	ob->cylinder.height = height;
-	
-	ObstacleRequest* req = &m_reqs[m_nreqs++];
-	memset(req, 0, sizeof(ObstacleRequest));
-	req->action = REQUEST_ADD;
-	req->ref = getObstacleRef(ob);
-	
-	if (result)
-		*result = req->ref;
+	return ob;
+}
+
+void dtTileCache::setObstacle(dtTileCacheObstacle* ob, const dtTileCacheObstacleDesc& desc)
+{
+	ob->type = desc.type;
+	if (desc.type == DT_OBSTACLE_CYLINDER)
+	{
+		dtVcopy(ob->cylinder.pos, desc.pos);
+		ob->cylinder.radius = desc.radius;
+		ob->cylinder.height = desc.height;
+	}
+	else if (desc.type == DT_OBSTACLE_BOX)
+	{
+		dtVcopy(ob->box.bmin, desc.bmin);
+		dtVcopy(ob->box.bmax, desc.bmax);
+	}
+	else if (desc.type == DT_OBSTACLE_ORIENTED_BOX)
+	{
+		dtVcopy(ob->orientedBox.center, desc.pos);
+		dtVcopy(ob->orientedBox.halfExtents, desc.halfExtents);
+
+		float coshalf= cosf(0.5f*desc.yRadians);
+		float sinhalf = sinf(-0.5f*desc.yRadians);
+		ob->orientedBox.rotAux[0] = coshalf*sinhalf;
+		ob->orientedBox.rotAux[1] = coshalf*coshalf - 0.5f;
+	}
+	else if (desc.type == DT_OBSTACLE_CONVEX_POLYGON)
+	{
+		for (int i = 0; i < desc.nverts; ++i)
+		{
+			ob->convexPolygon.verts[i*2+0] = desc.verts[i*3+0];
+			ob->convexPolygon.verts[i*2+1] = desc.verts[i*3+2];
+		}
+		ob->convexPolygon.nverts = desc.nverts;
+		ob->convexPolygon.hmin = desc.hmin;
+		ob->convexPolygon.hmax = desc.hmax;
+	}
+}
+
+bool dtTileCache::reserveRequests(const int count)
+{
+	if (m_nreqs + count <= m_maxReqs)
+		return true;
 	
-	return DT_SUCCESS;
+	int maxReqs = dtMax(m_maxReqs*2, 1);
+	while (maxReqs < m_nreqs + count)
+		maxReqs *= 2;
+	ObstacleRequest* reqs = (ObstacleRequest*)dtAlloc(sizeof(ObstacleRequest)*maxReqs, DT_ALLOC_PERM);
+	if (!reqs)
+		return false;
+	if (m_nreqs)
+		memcpy(reqs, m_reqs, sizeof(ObstacleRequest)*m_nreqs);
+	dtFree(m_reqs);
+	m_reqs = reqs;
+	m_maxReqs = maxReqs;
+	return true;
+}
+
+dtStatus dtTileCache::addObstacle(const float* pos, const float radius, const float height, dtObstacleRef* result)
+{
+	dtTileCacheObstacleDesc desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.type = DT_OBSTACLE_CYLINDER;
+	dtVcopy(desc.pos, pos);
+	desc.radius = radius;
+	desc.height = height;
+	return addObstacles(&desc, 1, result);
 }
 
 dtStatus dtTileCache::addBoxObstacle(const float* bmin, const float* bmax, dtObstacleRef* result)
 {
-	if (m_nreqs >= MAX_REQUESTS)
-		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
-	
-	dtTileCacheObstacle* ob = 0;
-	if (m_nextFreeObstacle)
+	dtTileCacheObstacleDesc desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.type = DT_OBSTACLE_BOX;
+	dtVcopy(desc.bmin, bmin);
+	dtVcopy(desc.bmax, bmax);
+	return addObstacles(&desc, 1, result);
+}
+
+dtStatus dtTileCache::addBoxObstacle(const float* center, const float* halfExtents, const float yRadians, dtObstacleRef* result)
+{
+	dtTileCacheObstacleDesc desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.type = DT_OBSTACLE_ORIENTED_BOX;
+	dtVcopy(desc.pos, center);
+	dtVcopy(desc.halfExtents, halfExtents);
+	desc.yRadians = yRadians;
+	return addObstacles(&desc, 1, result);
+}
+
+dtStatus dtTileCache::addConvexObstacle(const float* verts, const int nverts, const float hmin, const float hmax,
+										dtObstacleRef* result)
+{
+	if (!verts || nverts < 3 || nverts > DT_MAX_OBSTACLE_POLYGON_VERTS)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	dtTileCacheObstacleDesc desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.type = DT_OBSTACLE_CONVEX_POLYGON;
+	memcpy(desc.verts, verts, sizeof(float)*3*nverts);
+	desc.nverts = nverts;
+	desc.hmin = hmin;
+	desc.hmax = hmax;
+	return addObstacles(&desc, 1, result);
+}
+
+dtStatus dtTileCache::addObstacles(const dtTileCacheObstacleDesc* obstacles, const int count, dtObstacleRef* results)
+{
+	if (count < 0 || (count > 0 && !obstacles))
+		return DT_FAILURE | DT_INVALID_PARAM;
+	for (int i = 0; i < count; ++i)
 	{
-		ob = m_nextFreeObstacle;
-		m_nextFreeObstacle = ob->next;
-		ob->next = 0;
+		if (obstacles[i].type > DT_OBSTACLE_CONVEX_POLYGON)
+			return DT_FAILURE | DT_INVALID_PARAM;
+		if (obstacles[i].type == DT_OBSTACLE_CONVEX_POLYGON &&
+			(obstacles[i].nverts < 3 || obstacles[i].nverts > DT_MAX_OBSTACLE_POLYGON_VERTS))
+			return DT_FAILURE | DT_INVALID_PARAM;
 	}
-	if (!ob)
-		return DT_FAILURE | DT_OUT_OF_MEMORY;
 	
-	unsigned short salt = ob->salt;
-	memset(ob, 0, sizeof(dtTileCacheObstacle));
-	ob->salt = salt;
-	ob->state = DT_OBSTACLE_PROCESSING;
-	ob->type = DT_OBSTACLE_BOX;
-	dtVcopy(ob->box.bmin, bmin);
-	dtVcopy(ob->box.bmax, bmax);
-	
-	ObstacleRequest* req = &m_reqs[m_nreqs++];
-	memset(req, 0, sizeof(ObstacleRequest));
-	req->action = REQUEST_ADD;
-	req->ref = getObstacleRef(ob);
+	// Make sure the whole batch fits before adding anything.
+	int nfree = 0;
+	for (dtTileCacheObstacle* ob = m_nextFreeObstacle; ob && nfree < count; ob = ob->next)
+		nfree++;
+	if (nfree < count)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	if (!reserveRequests(count))
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
 	
-	if (result)
-		*result = req->ref;
+	for (int i = 0; i < count; ++i)
+	{
+		dtTileCacheObstacle* ob = allocObstacle();
+		setObstacle(ob, obstacles[i]);
+		
+		ObstacleRequest* req = &m_reqs[m_nreqs++];
+		memset(req, 0, sizeof(ObstacleRequest));
+		req->action = REQUEST_ADD;
+		req->ref = getObstacleRef(ob);
+		
+		if (results)
+			results[i] = req->ref;
+	}
 	
 	return DT_SUCCESS;
 }
 
-dtStatus dtTileCache::addBoxObstacle(const float* center, const float* halfExtents, const float yRadians, dtObstacleRef* result)
+dtStatus dtTileCache::removeObstacle(const dtObstacleRef ref)
 {
-	if (m_nreqs >= MAX_REQUESTS)
-		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+	return removeObstacles(&ref, 1);
+}
 
-	dtTileCacheObstacle* ob = 0;
-	if (m_nextFreeObstacle)
+dtStatus dtTileCache::removeObstacles(const dtObstacleRef* refs, const int count)
+{
+	if (count < 0 || (count > 0 && !refs))
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (!reserveRequests(count))
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	
+	for (int i = 0; i < count; ++i)
 	{
-		ob = m_nextFreeObstacle;
-		m_nextFreeObstacle = ob->next;
-		ob->next = 0;
+		if (!refs[i])
+			continue;
+		ObstacleRequest* req = &m_reqs[m_nreqs++];
+		memset(req, 0, sizeof(ObstacleRequest));
+		req->action = REQUEST_REMOVE;
+		req->ref = refs[i];
 	}
-	if (!ob)
-		return DT_FAILURE | DT_OUT_OF_MEMORY;
-
-	unsigned short salt = ob->salt;
-	memset(ob, 0, sizeof(dtTileCacheObstacle));
-	ob->salt = salt;
-	ob->state = DT_OBSTACLE_PROCESSING;
-	ob->type = DT_OBSTACLE_ORIENTED_BOX;
-	dtVcopy(ob->orientedBox.center, center);
-	dtVcopy(ob->orientedBox.halfExtents, halfExtents);
-
-	float coshalf= cosf(0.5f*yRadians);
-	float sinhalf = sinf(-0.5f*yRadians);
-	ob->orientedBox.rotAux[0] = coshalf*sinhalf;
-	ob->orientedBox.rotAux[1] = coshalf*coshalf - 0.5f;
-
-	ObstacleRequest* req = &m_reqs[m_nreqs++];
-	memset(req, 0, sizeof(ObstacleRequest));
-	req->action = REQUEST_ADD;
-	req->ref = getObstacleRef(ob);
-
-	if (result)
-		*result = req->ref;
-
+	
 	return DT_SUCCESS;
 }
 
-dtStatus dtTileCache::removeObstacle(const dtObstacleRef ref)
+dtStatus dtTileCache::restoreObstacles(const dtTileCacheObstacleState* obstacles, const int count)
 {
-	if (!ref)
-		return DT_SUCCESS;
-	if (m_nreqs >= MAX_REQUESTS)
-		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+	if (count < 0 || (count > 0 && !obstacles))
+		return DT_FAILURE | DT_INVALID_PARAM;
+	// A queued request could refer to the restored slots.
+	if (m_nreqs)
+		return DT_FAILURE | DT_INVALID_PARAM;
 	
-	ObstacleRequest* req = &m_reqs[m_nreqs++];
-	memset(req, 0, sizeof(ObstacleRequest));
-	req->action = REQUEST_REMOVE;
-	req->ref = ref;
+	// Claim the slots of all obstacles before restoring anything, a slot claimed twice fails the batch.
+	for (int i = 0; i < count; ++i)
+	{
+		const dtTileCacheObstacleState& state = obstacles[i];
+		const unsigned int idx = decodeObstacleIdObstacle(state.ref);
+		const unsigned int salt = decodeObstacleIdSalt(state.ref);
+		if (idx >= (unsigned int)m_params.maxObstacles || salt == 0 ||
+			state.type < DT_OBSTACLE_CYLINDER || state.type > DT_OBSTACLE_CONVEX_POLYGON ||
+			(state.type == DT_OBSTACLE_CONVEX_POLYGON &&
+			 (state.convexPolygon.nverts < 3 || state.convexPolygon.nverts > DT_MAX_OBSTACLE_POLYGON_VERTS)) ||
+			m_obstacles[idx].state != DT_OBSTACLE_EMPTY)
+		{
+			for (int j = 0; j < i; ++j)
+				m_obstacles[decodeObstacleIdObstacle(obstacles[j].ref)].state = DT_OBSTACLE_EMPTY;
+			return DT_FAILURE | DT_INVALID_PARAM;
+		}
+		m_obstacles[idx].state = DT_OBSTACLE_PROCESSED;
+	}
+	
+	for (int i = 0; i < count; ++i)
+	{
+		const dtTileCacheObstacleState& state = obstacles[i];
+		dtTileCacheObstacle* ob = &m_obstacles[decodeObstacleIdObstacle(state.ref)];
+		
+		dtCompressedTileRef* touched = ob->touched;
+		dtCompressedTileRef* pending = ob->pending;
+		memset(ob, 0, sizeof(dtTileCacheObstacle));
+		ob->salt = (unsigned short)decodeObstacleIdSalt(state.ref);
+		ob->touched = touched;
+		ob->pending = pending;
+		ob->state = DT_OBSTACLE_PROCESSED;
+		ob->type = (unsigned char)state.type;
+		if (state.type == DT_OBSTACLE_CYLINDER)
+			ob->cylinder = state.cylinder;
+		else if (state.type == DT_OBSTACLE_BOX)
+			ob->box = state.box;
+		else if (state.type == DT_OBSTACLE_ORIENTED_BOX)
+			ob->orientedBox = state.orientedBox;
+		else
+			ob->convexPolygon = state.convexPolygon;
+		
+		float bmin[3], bmax[3];
+		getObstacleBounds(ob, bmin, bmax);
+		int ntouched = 0;
+		queryTiles(bmin, bmax, ob->touched, &ntouched, m_params.maxTouchedTiles);
+		ob->ntouched = (unsigned short)ntouched;
+		linkObstacle(ob);
+	}
+	
+	// Rebuild the free list without the restored slots, in the order of init.
+	m_nextFreeObstacle = 0;
+	for (int i = m_params.maxObstacles-1; i >= 0; --i)
+	{
+		if (m_obstacles[i].state != DT_OBSTACLE_EMPTY)
+			continue;
+		m_obstacles[i].next = m_nextFreeObstacle;
+		m_nextFreeObstacle = &m_obstacles[i];
+	}
 	
 	return DT_SUCCESS;
 }
@@ -523,9 +747,16 @@ dtStatus dtTileCache::queryTiles(const float* bmin, const float* bmax,
 dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh,
 							 bool* upToDate)
 {
+#ifdef DT_QUERY_STATS
+	memset(&m_updateStats, 0, sizeof(m_updateStats));
+#endif
+
 	if (m_nupdate == 0)
 	{
 		// Process requests.
+#ifdef DT_QUERY_STATS
+		m_updateStats.obstacleRequests = m_nreqs;
+#endif
 		for (int i = 0; i < m_nreqs; ++i)
 		{
 			ObstacleRequest* req = &m_reqs[i];
@@ -545,35 +776,16 @@ dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh,
 				getObstacleBounds(ob, bmin, bmax);
 
 				int ntouched = 0;
-				queryTiles(bmin, bmax, ob->touched, &ntouched, DT_MAX_TOUCHED_TILES);
-				ob->ntouched = (unsigned char)ntouched;
-				// Add tiles to update list.
-				ob->npending = 0;
-				for (int j = 0; j < ob->ntouched; ++j)
-				{
-					if (m_nupdate < MAX_UPDATE)
-					{
-						if (!contains(m_update, m_nupdate, ob->touched[j]))
-							m_update[m_nupdate++] = ob->touched[j];
-						ob->pending[ob->npending++] = ob->touched[j];
-					}
-				}
+				queryTiles(bmin, bmax, ob->touched, &ntouched, m_params.maxTouchedTiles);
+				ob->ntouched = (unsigned short)ntouched;
+				linkObstacle(ob);
+				addPendingTiles(ob);
 			}
 			else if (req->action == REQUEST_REMOVE)
 			{
 				// Prepare to remove obstacle.
 				ob->state = DT_OBSTACLE_REMOVING;
-				// Add tiles to update list.
-				ob->npending = 0;
-				for (int j = 0; j < ob->ntouched; ++j)
-				{
-					if (m_nupdate < MAX_UPDATE)
-					{
-						if (!contains(m_update, m_nupdate, ob->touched[j]))
-							m_update[m_nupdate++] = ob->touched[j];
-						ob->pending[ob->npending++] = ob->touched[j];
-					}
-				}
+				addPendingTiles(ob);
 			}
 		}
 		
@@ -582,7 +794,39 @@ dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh,
 	
 	dtStatus status = DT_SUCCESS;
 	// Process updates
-	if (m_nupdate)
+	if (m_nupdate && m_dispatcher)
+	{
+		// Build all tile meshes concurrently, and replace the tiles in order.
+		const int njobs = m_nupdate;
+		for (int i = 0; i < njobs; ++i)
+		{
+			TileBuildJob& job = m_buildJobs[i];
+			job.ref = m_update[i];
+			job.navData = 0;
+			job.navDataSize = 0;
+			job.status = DT_SUCCESS;
+		}
+		m_dispatcher->dispatch(runBuildJob, this, njobs);
+		m_nupdate = 0;
+
+		for (int i = 0; i < njobs; ++i)
+		{
+			TileBuildJob& job = m_buildJobs[i];
+			dtStatus jobStatus = job.status;
+			if (m_layerCache)
+				useCachedLayer(job.ref);
+			if (dtStatusSucceed(jobStatus))
+				jobStatus = replaceNavMeshTile(job.ref, job.navData, job.navDataSize, navmesh);
+			if (dtStatusFailed(jobStatus))
+				status = jobStatus;
+			updateObstacleStates(job.ref);
+#ifdef DT_QUERY_STATS
+			m_updateStats.tilesRebuilt++;
+			m_updateStats.failedTiles += dtStatusFailed(jobStatus) ? 1 : 0;
+#endif
+		}
+	}
+	else if (m_nupdate)
 	{
 		// Build mesh
 		const dtCompressedTileRef ref = m_update[0];
@@ -591,48 +835,171 @@ dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh,
 		if (m_nupdate > 0)
 			memmove(m_update, m_update+1, m_nupdate*sizeof(dtCompressedTileRef));
 
-		// Update obstacle states.
-		for (int i = 0; i < m_params.maxObstacles; ++i)
+		updateObstacleStates(ref);
+#ifdef DT_QUERY_STATS
+		m_updateStats.tilesRebuilt++;
+		m_updateStats.failedTiles += dtStatusFailed(status) ? 1 : 0;
+#endif
+	}
+
+#ifdef DT_QUERY_STATS
+	m_updateStats.pendingTiles = m_nupdate;
+#endif
+	
+	if (upToDate)
+		*upToDate = m_nupdate == 0 && m_nreqs == 0;
+
+	return status;
+}
+
+void dtTileCache::addPendingTiles(dtTileCacheObstacle* ob)
+{
+	// Add tiles to update list. The update list can hold every tile once.
+	ob->npending = 0;
+	for (int j = 0; j < (int)ob->ntouched; ++j)
+	{
+		if (!contains(m_update, m_nupdate, ob->touched[j]))
+			m_update[m_nupdate++] = ob->touched[j];
+		ob->pending[ob->npending++] = ob->touched[j];
+	}
+}
+
+void dtTileCache::linkObstacle(const dtTileCacheObstacle* ob)
+{
+	const int maxTouched = m_params.maxTouchedTiles;
+	const int first = (int)(ob - m_obstacles) * maxTouched;
+	for (int j = 0; j < (int)ob->ntouched; ++j)
+	{
+		const unsigned int tileIndex = decodeTileIdTile(ob->touched[j]);
+		ObstacleLink& link = m_obstacleLinks[first + j];
+		link.prev = -1;
+		link.next = m_tileObstacles[tileIndex];
+		if (link.next != -1)
+			m_obstacleLinks[link.next].prev = first + j;
+		m_tileObstacles[tileIndex] = first + j;
+	}
+}
+
+void dtTileCache::unlinkObstacle(const dtTileCacheObstacle* ob)
+{
+	const int maxTouched = m_params.maxTouchedTiles;
+	const int first = (int)(ob - m_obstacles) * maxTouched;
+	for (int j = 0; j < (int)ob->ntouched; ++j)
+	{
+		const ObstacleLink& link = m_obstacleLinks[first + j];
+		if (link.prev != -1)
+			m_obstacleLinks[link.prev].next = link.next;
+		else
+			m_tileObstacles[decodeTileIdTile(ob->touched[j])] = link.next;
+		if (link.next != -1)
+			m_obstacleLinks[link.next].prev = link.prev;
+	}
+}
+
+void dtTileCache::updateObstacleStates(const dtCompressedTileRef ref)
+{
+	// Only the obstacles touching the tile can have it pending.
+	const int maxTouched = m_params.maxTouchedTiles;
+	int next = -1;
+	for (int i = m_tileObstacles[decodeTileIdTile(ref)]; i != -1; i = next)
+	{
+		// The obstacle may be unlinked below.
+		next = m_obstacleLinks[i].next;
+		dtTileCacheObstacle* ob = &m_obstacles[i / maxTouched];
+		if (ob->state == DT_OBSTACLE_PROCESSING || ob->state == DT_OBSTACLE_REMOVING)
 		{
-			dtTileCacheObstacle* ob = &m_obstacles[i];
-			if (ob->state == DT_OBSTACLE_PROCESSING || ob->state == DT_OBSTACLE_REMOVING)
+			// Remove handled tile from pending list.
+			for (int j = 0; j < (int)ob->npending; j++)
 			{
-				// Remove handled tile from pending list.
-				for (int j = 0; j < (int)ob->npending; j++)
+				if (ob->pending[j] == ref)
 				{
-					if (ob->pending[j] == ref)
-					{
-						ob->pending[j] = ob->pending[(int)ob->npending-1];
-						ob->npending--;
-						break;
-					}
+					ob->pending[j] = ob->pending[(int)ob->npending-1];
+					ob->npending--;
+					break;
 				}
-				
-				// If all pending tiles processed, change state.
-				if (ob->npending == 0)
+			}
+			
+			// If all pending tiles processed, change state.
+			if (ob->npending == 0)
+			{
+				if (ob->state == DT_OBSTACLE_PROCESSING)
 				{
-					if (ob->state == DT_OBSTACLE_PROCESSING)
-					{
-						ob->state = DT_OBSTACLE_PROCESSED;
-					}
-					else if (ob->state == DT_OBSTACLE_REMOVING)
-					{
-						ob->state = DT_OBSTACLE_EMPTY;
-						// Update salt, salt should never be zero.
-						ob->salt = (ob->salt+1) & ((1<<16)-1);
-						if (ob->salt == 0)
-							ob->salt++;
-						// Return obstacle to free list.
-						ob->next = m_nextFreeObstacle;
-						m_nextFreeObstacle = ob;
-					}
+					ob->state = DT_OBSTACLE_PROCESSED;
+				}
+				else if (ob->state == DT_OBSTACLE_REMOVING)
+				{
+					unlinkObstacle(ob);
+					ob->state = DT_OBSTACLE_EMPTY;
+					// Update salt, salt should never be zero.
+					ob->salt = (ob->salt+1) & ((1<<16)-1);
+					if (ob->salt == 0)
+						ob->salt++;
+					// Return obstacle to free list.
+					ob->next = m_nextFreeObstacle;
+					m_nextFreeObstacle = ob;
 				}
 			}
 		}
 	}
-	
+}
+
+void dtTileCache::runBuildJob(void* userData, const int jobIndex, const int workerIndex)
+{
+	dtTileCache* tc = (dtTileCache*)userData;
+	TileBuildJob& job = tc->m_buildJobs[jobIndex];
+	job.status = tc->buildNavMeshTileData(job.ref, tc->m_workerAllocs[workerIndex], &job.navData, &job.navDataSize);
+}
+
+dtStatus dtTileCache::setJobDispatcher(dtJobDispatcher* dispatcher, dtTileCacheAlloc** workerAllocs)
+{
+	if (dispatcher && !workerAllocs)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (dispatcher)
+	{
+		for (int i = 0; i < dispatcher->getWorkerCount(); ++i)
+		{
+			if (!workerAllocs[i])
+				return DT_FAILURE | DT_INVALID_PARAM;
+		}
+	}
+	m_dispatcher = dispatcher;
+	m_workerAllocs = dispatcher ? workerAllocs : 0;
+	return DT_SUCCESS;
+}
+
+dtStatus dtTileCache::update(const float dt, dtNavMesh* navmesh, const dtTimeBudget& budget,
+							 bool* upToDate, int* builtTiles)
+{
+	dtStatus status = DT_SUCCESS;
+	bool done = false;
+	int n = 0;
+#ifdef DT_QUERY_STATS
+	dtTileCacheUpdateStats stats;
+	memset(&stats, 0, sizeof(stats));
+#endif
+	do
+	{
+		const bool pending = m_nupdate > 0 || m_nreqs > 0;
+		status = update(dt, navmesh, &done);
+		if (pending)
+			n++;
+#ifdef DT_QUERY_STATS
+		stats.obstacleRequests += m_updateStats.obstacleRequests;
+		stats.tilesRebuilt += m_updateStats.tilesRebuilt;
+		stats.failedTiles += m_updateStats.failedTiles;
+		stats.pendingTiles = m_updateStats.pendingTiles;
+#endif
+	}
+	while (!done && dtStatusSucceed(status) && !dtTimeBudgetExpired(budget));
+
+#ifdef DT_QUERY_STATS
+	m_updateStats = stats;
+#endif
+
 	if (upToDate)
-		*upToDate = m_nupdate == 0 && m_nreqs == 0;
+		*upToDate = done;
+	if (builtTiles)
+		*builtTiles = n;
 
 	return status;
 }
@@ -657,80 +1024,127 @@ dtStatus dtTileCache::buildNavMeshTilesAt(const int tx, const int ty, dtNavMesh*
 dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh* navmesh)
 {	
 	dtAssert(m_talloc);
+	
+	unsigned char* navData = 0;
+	int navDataSize = 0;
+	dtStatus status = buildNavMeshTileData(ref, m_talloc, &navData, &navDataSize);
+	if (m_layerCache)
+		useCachedLayer(ref);
+	if (dtStatusFailed(status))
+		return status;
+	
+	return replaceNavMeshTile(ref, navData, navDataSize, navmesh);
+}
+
+dtStatus dtTileCache::buildNavMeshTileData(const dtCompressedTileRef ref, dtTileCacheAlloc* talloc,
+										   unsigned char** navData, int* navDataSize) const
+{
+	dtAssert(talloc);
 	dtAssert(m_tcomp);
 	
-	unsigned int idx = decodeTileIdTile(ref);
-	if (idx > (unsigned int)m_params.maxTiles)
-		return DT_FAILURE | DT_INVALID_PARAM;
-	const dtCompressedTile* tile = &m_tiles[idx];
-	unsigned int salt = decodeTileIdSalt(ref);
-	if (tile->salt != salt)
+	*navData = 0;
+	*navDataSize = 0;
+	
+	const dtCompressedTile* tile = getTileByRef(ref);
+	if (!tile)
 		return DT_FAILURE | DT_INVALID_PARAM;
 	
-	m_talloc->reset();
+	talloc->reset();
 	
-	NavMeshTileBuildContext bc(m_talloc);
+	NavMeshTileBuildContext bc(talloc);
 	const int walkableClimbVx = (int)(m_params.walkableClimb / m_params.ch);
 	dtStatus status;
 	
-	// Decompress tile layer data. 
-	status = dtDecompressTileCacheLayer(m_talloc, m_tcomp, tile->data, tile->dataSize, &bc.layer);
+	// The layer is cached on the first build of the tile, a tile whose layer could not be cached is
+	// decompressed. Each job of a dispatcher builds a different tile, so the layers can be cached concurrently.
+	CachedLayer* cached = m_layerCache ? &m_layerCache[decodeTileIdTile(ref)] : 0;
+	if (cached && !cached->layer && dtStatusFailed(buildCachedLayer(tile, *cached)))
+		cached = 0;
+	const CachedLayer* base = cached && cached->lcset ? cached : 0;
+	
+	// Decompress tile layer data, or copy the cached layer.
+	if (cached)
+		status = dtCopyTileCacheLayer(talloc, *cached->layer, &bc.layer);
+	else
+		status = dtDecompressTileCacheLayer(talloc, m_tcomp, tile->data, tile->dataSize, &bc.layer);
 	if (dtStatusFailed(status))
 		return status;
 	
-	// Rasterize obstacles.
-	for (int i = 0; i < m_params.maxObstacles; ++i)
+	// Rasterize obstacles, a batch at a time.
+	static const int MAX_MARK_BATCH = 32;
+	const dtTileCacheObstacle* batch[MAX_MARK_BATCH];
+	int nbatch = 0;
+	const int maxTouched = m_params.maxTouchedTiles;
+	for (int i = m_tileObstacles[decodeTileIdTile(ref)]; i != -1; i = m_obstacleLinks[i].next)
 	{
-		const dtTileCacheObstacle* ob = &m_obstacles[i];
+		const dtTileCacheObstacle* ob = &m_obstacles[i / maxTouched];
 		if (ob->state == DT_OBSTACLE_EMPTY || ob->state == DT_OBSTACLE_REMOVING)
 			continue;
-		if (contains(ob->touched, ob->ntouched, ref))
+		// The link may be left from a tile that was removed from this location.
+		if (ob->touched[i % maxTouched] != ref)
+			continue;
+		batch[nbatch++] = ob;
+		if (nbatch == MAX_MARK_BATCH)
 		{
-			if (ob->type == DT_OBSTACLE_CYLINDER)
-			{
-				dtMarkCylinderArea(*bc.layer, tile->header->bmin, m_params.cs, m_params.ch,
-							    ob->cylinder.pos, ob->cylinder.radius, ob->cylinder.height, 0);
-			}
-			else if (ob->type == DT_OBSTACLE_BOX)
-			{
-				dtMarkBoxArea(*bc.layer, tile->header->bmin, m_params.cs, m_params.ch,
-					ob->box.bmin, ob->box.bmax, 0);
-			}
-			else if (ob->type == DT_OBSTACLE_ORIENTED_BOX)
-			{
-				dtMarkBoxArea(*bc.layer, tile->header->bmin, m_params.cs, m_params.ch,
-					ob->orientedBox.center, ob->orientedBox.halfExtents, ob->orientedBox.rotAux, 0);
-			}
+			dtMarkObstacleAreas(*bc.layer, tile->header->bmin, m_params.cs, m_params.ch, batch, nbatch, 0);
+			nbatch = 0;
 		}
 	}
+	if (nbatch)
+		dtMarkObstacleAreas(*bc.layer, tile->header->bmin, m_params.cs, m_params.ch, batch, nbatch, 0);
 	
 	// Build navmesh
-	status = dtBuildTileCacheRegions(m_talloc, *bc.layer, walkableClimbVx);
-	if (dtStatusFailed(status))
-		return status;
-	
-	bc.lcset = dtAllocTileCacheContourSet(m_talloc);
+	bc.lcset = dtAllocTileCacheContourSet(talloc);
 	if (!bc.lcset)
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
-	status = dtBuildTileCacheContours(m_talloc, *bc.layer, walkableClimbVx,
-									  m_params.maxSimplificationError, *bc.lcset);
-	if (dtStatusFailed(status))
-		return status;
+	if (base)
+	{
+		// Only the regions changed by the obstacles are built again. The new regions fit
+		// after the cached ones, as there are at most as many regions as cells.
+		const int maxDirtyRegs = (int)base->layer->regCount + (int)bc.layer->header->width * (int)bc.layer->header->height;
+		unsigned char* dirtyRegs = (unsigned char*)talloc->alloc(maxDirtyRegs);
+		if (!dirtyRegs)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		status = dtUpdateTileCacheRegions(talloc, *bc.layer, *base->layer, walkableClimbVx, dirtyRegs, maxDirtyRegs);
+		if (dtStatusSucceed(status))
+		{
+			status = dtUpdateTileCacheContours(talloc, *bc.layer, walkableClimbVx, m_params.maxSimplificationError,
+											   *base->lcset, dirtyRegs, *bc.lcset);
+			talloc->free(dirtyRegs);
+			if (dtStatusFailed(status))
+				return status;
+		}
+		else
+		{
+			talloc->free(dirtyRegs);
+			if (!dtStatusDetail(status, DT_BUFFER_TOO_SMALL))
+				return status;
+			// Out of region ids, rebuild the layer in full.
+			base = 0;
+		}
+	}
+	if (!base)
+	{
+		status = dtBuildTileCacheRegions(talloc, *bc.layer, walkableClimbVx);
+		if (dtStatusFailed(status))
+			return status;
+		
+		status = dtBuildTileCacheContours(talloc, *bc.layer, walkableClimbVx,
+										  m_params.maxSimplificationError, *bc.lcset);
+		if (dtStatusFailed(status))
+			return status;
+	}
 	
-	bc.lmesh = dtAllocTileCachePolyMesh(m_talloc);
+	bc.lmesh = dtAllocTileCachePolyMesh(talloc);
 	if (!bc.lmesh)
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
-	status = dtBuildTileCachePolyMesh(m_talloc, *bc.lcset, *bc.lmesh);
+	status = dtBuildTileCachePolyMesh(talloc, *bc.lcset, *bc.lmesh);
 	if (dtStatusFailed(status))
 		return status;
 	
 	// Early out if the mesh tile is empty.
 	if (!bc.lmesh->npolys)
-	{
-		// Remove existing tile.
-		navmesh->removeTile(navmesh->getTileRefAt(tile->header->tx,tile->header->ty,tile->header->tlayer),0,0);
 		return DT_SUCCESS;
-	}
 	
 	dtNavMeshCreateParams params;
 	memset(&params, 0, sizeof(params));
@@ -758,11 +1172,185 @@ dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh*
 		m_tmproc->process(&params, bc.lmesh->areas, bc.lmesh->flags);
 	}
 	
-	unsigned char* navData = 0;
-	int navDataSize = 0;
-	if (!dtCreateNavMeshData(&params, &navData, &navDataSize))
+	if (!dtCreateNavMeshData(&params, navData, navDataSize))
 		return DT_FAILURE;
+	
+	return DT_SUCCESS;
+}
+
+dtStatus dtTileCache::buildCachedLayer(const dtCompressedTile* tile, CachedLayer& cached) const
+{
+	const int walkableClimbVx = (int)(m_params.walkableClimb / m_params.ch);
+	
+	dtStatus status = dtDecompressTileCacheLayer(&s_cacheAlloc, m_tcomp, tile->data, tile->dataSize, &cached.layer);
+	if (dtStatusFailed(status))
+		return status;
+	const dtTileCacheLayerHeader* header = cached.layer->header;
+	const int gridSize = (int)header->width * (int)header->height;
+	cached.size = dtAlign4(sizeof(dtTileCacheLayer)) + dtAlign4(sizeof(dtTileCacheLayerHeader)) +
+		dtAlign4(gridSize*3) + gridSize*(int)sizeof(unsigned short);
+	
+	if (m_params.rebuildMode == DT_TILECACHE_REBUILD_DIRTY_REGIONS)
+	{
+		status = dtBuildTileCacheRegions(&s_cacheAlloc, *cached.layer, walkableClimbVx);
+		if (dtStatusSucceed(status))
+		{
+			cached.lcset = dtAllocTileCacheContourSet(&s_cacheAlloc);
+			if (!cached.lcset)
+				status = DT_FAILURE | DT_OUT_OF_MEMORY;
+		}
+		if (dtStatusSucceed(status))
+			status = dtBuildTileCacheContours(&s_cacheAlloc, *cached.layer, walkableClimbVx,
+											  m_params.maxSimplificationError, *cached.lcset);
+		if (dtStatusFailed(status))
+		{
+			dtFreeTileCacheLayer(&s_cacheAlloc, cached.layer);
+			cached.layer = 0;
+			dtFreeTileCacheContourSet(&s_cacheAlloc, cached.lcset);
+			cached.lcset = 0;
+			return status;
+		}
+		
+		cached.size += (int)sizeof(dtTileCacheContourSet) + cached.lcset->nconts*(int)sizeof(dtTileCacheContour);
+		for (int i = 0; i < cached.lcset->nconts; ++i)
+			cached.size += cached.lcset->conts[i].nverts*4;
+	}
+	
+	return DT_SUCCESS;
+}
+
+void dtTileCache::useCachedLayer(const dtCompressedTileRef ref)
+{
+	if (!getTileByRef(ref))
+		return;
+	const int tileIndex = (int)decodeTileIdTile(ref);
+	CachedLayer& cached = m_layerCache[tileIndex];
+	if (!cached.layer)
+	{
+		// The layer could not be cached.
+		m_layerCacheStats.misses++;
+		return;
+	}
+	
+	if (cached.linked)
+	{
+		m_layerCacheStats.hits++;
+		if (m_layerCacheHead == tileIndex)
+			return;
+		
+		// Unlink, it is not the head so it has a previous layer.
+		m_layerCache[cached.prev].next = cached.next;
+		if (cached.next != -1)
+			m_layerCache[cached.next].prev = cached.prev;
+		else
+			m_layerCacheTail = cached.prev;
+	}
+	else
+	{
+		// Built by this rebuild.
+		m_layerCacheStats.misses++;
+		m_layerCacheStats.layerCount++;
+		m_layerCacheStats.memory += cached.size;
+		cached.linked = true;
+	}
+	
+	// Make it the most recently used.
+	cached.prev = -1;
+	cached.next = m_layerCacheHead;
+	if (m_layerCacheHead != -1)
+		m_layerCache[m_layerCacheHead].prev = tileIndex;
+	m_layerCacheHead = tileIndex;
+	if (m_layerCacheTail == -1)
+		m_layerCacheTail = tileIndex;
+	
+	// Evict the least recently used layers, but keep the layer just built.
+	if (m_params.layerCacheSize > 0)
+	{
+		while (m_layerCacheStats.memory > m_params.layerCacheSize && m_layerCacheTail != tileIndex)
+		{
+			freeCachedLayer(m_layerCacheTail);
+			m_layerCacheStats.evictions++;
+		}
+	}
+}
+
+void dtTileCache::freeCachedLayer(const int tileIndex)
+{
+	CachedLayer& cached = m_layerCache[tileIndex];
+	if (cached.linked)
+	{
+		if (cached.prev != -1)
+			m_layerCache[cached.prev].next = cached.next;
+		else
+			m_layerCacheHead = cached.next;
+		if (cached.next != -1)
+			m_layerCache[cached.next].prev = cached.prev;
+		else
+			m_layerCacheTail = cached.prev;
+		m_layerCacheStats.layerCount--;
+		m_layerCacheStats.memory -= cached.size;
+	}
+	dtFreeTileCacheLayer(&s_cacheAlloc, cached.layer);
+	dtFreeTileCacheContourSet(&s_cacheAlloc, cached.lcset);
+	memset(&cached, 0, sizeof(cached));
+}
+
+void dtTileCache::resetLayerCacheStats()
+{
+	m_layerCacheStats.hits = 0;
+	m_layerCacheStats.misses = 0;
+	m_layerCacheStats.evictions = 0;
+}
+
+void dtTileCache::getMemStats(dtTileCacheMemStats* stats) const
+{
+	memset(stats, 0, sizeof(dtTileCacheMemStats));
+
+	const size_t maxTiles = (size_t)dtMax(m_params.maxTiles, 1);
+	stats->tiles = sizeof(dtTileCache);
+	if (m_tiles)
+	{
+		stats->tiles += sizeof(dtCompressedTile)*(size_t)m_params.maxTiles + sizeof(dtCompressedTile*)*(size_t)m_tileLutSize;
+		for (int i = 0; i < m_params.maxTiles; ++i)
+		{
+			if (m_tiles[i].data)
+				stats->compressed += (size_t)m_tiles[i].dataSize;
+		}
+	}
+
+	if (m_obstacles)
+	{
+		const size_t maxObstacles = (size_t)m_params.maxObstacles;
+		const size_t maxTouched = (size_t)m_params.maxTouchedTiles;
+		stats->obstacles += sizeof(dtTileCacheObstacle)*maxObstacles;
+		stats->obstacles += sizeof(dtCompressedTileRef)*maxObstacles*maxTouched*2;
+		stats->obstacles += sizeof(ObstacleLink)*maxObstacles*maxTouched;
+		stats->obstacles += sizeof(int)*maxTiles;
+	}
+	if (m_reqs)
+		stats->obstacles += sizeof(ObstacleRequest)*(size_t)m_maxReqs;
+
+	if (m_update)
+		stats->updates += sizeof(dtCompressedTileRef)*maxTiles;
+	if (m_buildJobs)
+		stats->updates += sizeof(TileBuildJob)*maxTiles;
 
+	if (m_layerCache)
+		stats->layerCache = sizeof(CachedLayer)*maxTiles + (size_t)m_layerCacheStats.memory;
+
+	stats->total = stats->tiles + stats->compressed + stats->obstacles + stats->updates + stats->layerCache;
+}
+
+dtStatus dtTileCache::replaceNavMeshTile(const dtCompressedTileRef ref, unsigned char* navData, const int navDataSize,
+										 dtNavMesh* navmesh)
+{
+	const dtCompressedTile* tile = getTileByRef(ref);
+	if (!tile)
+	{
+		dtFree(navData);
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+	
 	// Remove existing tile.
 	navmesh->removeTile(navmesh->getTileRefAt(tile->header->tx,tile->header->ty,tile->header->tlayer),0,0);
 
@@ -770,7 +1358,7 @@ dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh*
 	if (navData)
 	{
 		// Let the navmesh own the data.
-		status = navmesh->addTile(navData,navDataSize,DT_TILE_FREE_DATA,0,0);
+		dtStatus status = navmesh->addTile(navData,navDataSize,DT_TILE_FREE_DATA,0,0);
 		if (dtStatusFailed(status))
 		{
 			dtFree(navData);
@@ -822,4 +1410,20 @@ void dtTileCache::getObstacleBounds(const struct dtTileCacheObstacle* ob, float*
 		bmin[2] = orientedBox.center[2] - maxr;
 		bmax[2] = orientedBox.center[2] + maxr;
 	}
+	else if (ob->type == DT_OBSTACLE_CONVEX_POLYGON)
+	{
+		const dtObstacleConvexPolygon &poly = ob->convexPolygon;
+
+		bmin[0] = bmax[0] = poly.verts[0];
+		bmin[2] = bmax[2] = poly.verts[1];
+		for (int i = 1; i < poly.nverts; ++i)
+		{
+			bmin[0] = dtMin(bmin[0], poly.verts[i*2+0]);
+			bmax[0] = dtMax(bmax[0], poly.verts[i*2+0]);
+			bmin[2] = dtMin(bmin[2], poly.verts[i*2+1]);
+			bmax[2] = dtMax(bmax[2], poly.verts[i*2+1]);
+		}
+		bmin[1] = poly.hmin;
+		bmax[1] = poly.hmax;
+	}
 }
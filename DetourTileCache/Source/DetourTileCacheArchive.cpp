@@ -0,0 +1,315 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#include "DetourTileCacheArchive.h"
+#include "DetourTileCacheBuilder.h"
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+#include <string.h>
+
+/// The record stored before the data of every layer. A zero size ends the archive.
+struct dtTileCacheArchiveLayer
+{
+	int dataSize;
+};
+
+/// The record stored before the data of every navigation mesh tile of a snapshot.
+/// A zero size removes the tile at the location.
+struct dtTileCacheSnapshotTile
+{
+	dtTileRef tileRef;
+	int tx, ty, tlayer;
+	int dataSize;
+};
+
+static bool writePadding(dtTileCacheArchiveOutput* out, const int dataSize)
+{
+	static const unsigned char zeros[4] = { 0, 0, 0, 0 };
+	const int padding = dtAlign4(dataSize) - dataSize;
+	return padding == 0 || out->write(zeros, padding);
+}
+
+static bool isLayerData(const unsigned char* data, const int dataSize)
+{
+	if (dataSize < (int)sizeof(dtTileCacheLayerHeader))
+		return false;
+	const dtTileCacheLayerHeader* header = (const dtTileCacheLayerHeader*)data;
+	return header->magic == DT_TILECACHE_MAGIC && header->version == DT_TILECACHE_VERSION;
+}
+
+dtStatus dtWriteTileCacheArchiveHeader(dtTileCacheArchiveOutput* out, const dtTileCacheParams* cacheParams,
+									   const dtNavMeshParams* meshParams)
+{
+	if (!out || !cacheParams || !meshParams)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	dtTileCacheArchiveHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = DT_TILECACHE_ARCHIVE_MAGIC;
+	header.version = DT_TILECACHE_ARCHIVE_VERSION;
+	memcpy(&header.cacheParams, cacheParams, sizeof(dtTileCacheParams));
+	memcpy(&header.meshParams, meshParams, sizeof(dtNavMeshParams));
+	if (!out->write(&header, sizeof(header)))
+		return DT_FAILURE;
+	return DT_SUCCESS;
+}
+
+dtStatus dtWriteTileCacheArchiveLayer(dtTileCacheArchiveOutput* out, const unsigned char* data, const int dataSize)
+{
+	if (!out || !data || !isLayerData(data, dataSize))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	dtTileCacheArchiveLayer layer;
+	layer.dataSize = dataSize;
+	if (!out->write(&layer, sizeof(layer)) || !out->write(data, dataSize) || !writePadding(out, dataSize))
+		return DT_FAILURE;
+	return DT_SUCCESS;
+}
+
+dtStatus dtWriteTileCacheArchiveEnd(dtTileCacheArchiveOutput* out)
+{
+	if (!out)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	dtTileCacheArchiveLayer end;
+	end.dataSize = 0;
+	if (!out->write(&end, sizeof(end)))
+		return DT_FAILURE;
+	return DT_SUCCESS;
+}
+
+dtStatus dtReadTileCacheArchiveHeader(dtTileCacheArchiveInput* in, dtTileCacheArchiveHeader* header)
+{
+	if (!in || !header)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	if (!in->read(header, sizeof(dtTileCacheArchiveHeader)))
+		return DT_FAILURE;
+	if (header->magic != DT_TILECACHE_ARCHIVE_MAGIC)
+		return DT_FAILURE | DT_WRONG_MAGIC;
+	if (header->version != DT_TILECACHE_ARCHIVE_VERSION)
+		return DT_FAILURE | DT_WRONG_VERSION;
+	return DT_SUCCESS;
+}
+
+dtStatus dtReadTileCacheArchiveLayer(dtTileCacheArchiveInput* in, unsigned char** data, int* dataSize)
+{
+	if (!in || !data || !dataSize)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*data = 0;
+	*dataSize = 0;
+
+	dtTileCacheArchiveLayer layer;
+	if (!in->read(&layer, sizeof(layer)))
+		return DT_FAILURE;
+	if (layer.dataSize == 0)
+		return DT_SUCCESS;
+	if (layer.dataSize < (int)sizeof(dtTileCacheLayerHeader))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	// The padding is read with the data.
+	const int paddedSize = dtAlign4(layer.dataSize);
+	unsigned char* buffer = (unsigned char*)dtAlloc(paddedSize, DT_ALLOC_PERM);
+	if (!buffer)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	if (!in->read(buffer, paddedSize))
+	{
+		dtFree(buffer);
+		return DT_FAILURE;
+	}
+	if (!isLayerData(buffer, layer.dataSize))
+	{
+		dtFree(buffer);
+		return DT_FAILURE | DT_WRONG_MAGIC;
+	}
+
+	*data = buffer;
+	*dataSize = layer.dataSize;
+	return DT_SUCCESS;
+}
+
+dtStatus dtAddTileCacheArchiveLayers(dtTileCacheArchiveInput* in, dtTileCache* tileCache, int* layerCount)
+{
+	if (layerCount)
+		*layerCount = 0;
+	if (!in || !tileCache)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	for (;;)
+	{
+		unsigned char* data = 0;
+		int dataSize = 0;
+		dtStatus status = dtReadTileCacheArchiveLayer(in, &data, &dataSize);
+		if (dtStatusFailed(status))
+			return status;
+		if (!data)
+			return DT_SUCCESS;
+
+		status = tileCache->addTile(data, dataSize, DT_COMPRESSEDTILE_FREE_DATA, 0);
+		if (dtStatusFailed(status))
+		{
+			dtFree(data);
+			return status;
+		}
+		if (layerCount)
+			(*layerCount)++;
+	}
+}
+
+dtStatus dtWriteTileCacheSnapshot(dtTileCacheArchiveOutput* out, const dtTileCache* tileCache, const dtNavMesh* navmesh)
+{
+	if (!out || !tileCache || !navmesh)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (!tileCache->isUpToDate())
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	dtTileCacheSnapshotHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = DT_TILECACHE_SNAPSHOT_MAGIC;
+	header.version = DT_TILECACHE_SNAPSHOT_VERSION;
+	for (int i = 0; i < tileCache->getObstacleCount(); ++i)
+	{
+		if (tileCache->getObstacle(i)->state == DT_OBSTACLE_PROCESSED)
+			header.obstacleCount++;
+	}
+	for (int i = 0; i < tileCache->getTileCount(); ++i)
+	{
+		if (tileCache->getTile(i)->header)
+			header.tileCount++;
+	}
+	if (!out->write(&header, sizeof(header)))
+		return DT_FAILURE;
+
+	for (int i = 0; i < tileCache->getObstacleCount(); ++i)
+	{
+		const dtTileCacheObstacle* ob = tileCache->getObstacle(i);
+		if (ob->state != DT_OBSTACLE_PROCESSED)
+			continue;
+		dtTileCacheObstacleState state;
+		memset(&state, 0, sizeof(state));
+		state.ref = tileCache->getObstacleRef(ob);
+		state.type = ob->type;
+		if (ob->type == DT_OBSTACLE_CYLINDER)
+			state.cylinder = ob->cylinder;
+		else if (ob->type == DT_OBSTACLE_BOX)
+			state.box = ob->box;
+		else if (ob->type == DT_OBSTACLE_ORIENTED_BOX)
+			state.orientedBox = ob->orientedBox;
+		else
+			state.convexPolygon = ob->convexPolygon;
+		if (!out->write(&state, sizeof(state)))
+			return DT_FAILURE;
+	}
+
+	for (int i = 0; i < tileCache->getTileCount(); ++i)
+	{
+		const dtTileCacheLayerHeader* layer = tileCache->getTile(i)->header;
+		if (!layer)
+			continue;
+		const dtMeshTile* tile = navmesh->getTileAt(layer->tx, layer->ty, layer->tlayer);
+
+		dtTileCacheSnapshotTile record;
+		memset(&record, 0, sizeof(record));
+		record.tx = layer->tx;
+		record.ty = layer->ty;
+		record.tlayer = layer->tlayer;
+		if (tile)
+		{
+			record.tileRef = navmesh->getTileRef(tile);
+			record.dataSize = tile->dataSize;
+		}
+		if (!out->write(&record, sizeof(record)))
+			return DT_FAILURE;
+		if (tile && (!out->write(tile->data, tile->dataSize) || !writePadding(out, tile->dataSize)))
+			return DT_FAILURE;
+	}
+	return DT_SUCCESS;
+}
+
+dtStatus dtRestoreTileCacheSnapshot(dtTileCacheArchiveInput* in, dtTileCache* tileCache, dtNavMesh* navmesh)
+{
+	if (!in || !tileCache || !navmesh)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	dtTileCacheSnapshotHeader header;
+	if (!in->read(&header, sizeof(header)))
+		return DT_FAILURE;
+	if (header.magic != DT_TILECACHE_SNAPSHOT_MAGIC)
+		return DT_FAILURE | DT_WRONG_MAGIC;
+	if (header.version != DT_TILECACHE_SNAPSHOT_VERSION)
+		return DT_FAILURE | DT_WRONG_VERSION;
+	if (header.obstacleCount < 0 || header.obstacleCount > tileCache->getObstacleCount() || header.tileCount < 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	if (header.obstacleCount > 0)
+	{
+		dtTileCacheObstacleState* obstacles =
+			(dtTileCacheObstacleState*)dtAlloc(sizeof(dtTileCacheObstacleState)*header.obstacleCount, DT_ALLOC_TEMP);
+		if (!obstacles)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		dtStatus status = DT_FAILURE;
+		if (in->read(obstacles, (int)sizeof(dtTileCacheObstacleState)*header.obstacleCount))
+			status = tileCache->restoreObstacles(obstacles, header.obstacleCount);
+		dtFree(obstacles);
+		if (dtStatusFailed(status))
+			return status;
+	}
+
+	for (int i = 0; i < header.tileCount; ++i)
+	{
+		dtTileCacheSnapshotTile record;
+		if (!in->read(&record, sizeof(record)))
+			return DT_FAILURE;
+		if (record.dataSize < 0 || (record.dataSize > 0 && record.dataSize < (int)sizeof(dtMeshHeader)))
+			return DT_FAILURE | DT_INVALID_PARAM;
+
+		// The padding is read with the data.
+		unsigned char* data = 0;
+		if (record.dataSize > 0)
+		{
+			const int paddedSize = dtAlign4(record.dataSize);
+			data = (unsigned char*)dtAlloc(paddedSize, DT_ALLOC_PERM);
+			if (!data)
+				return DT_FAILURE | DT_OUT_OF_MEMORY;
+			if (!in->read(data, paddedSize))
+			{
+				dtFree(data);
+				return DT_FAILURE;
+			}
+		}
+
+		const dtTileRef oldRef = navmesh->getTileRefAt(record.tx, record.ty, record.tlayer);
+		if (oldRef)
+			navmesh->removeTile(oldRef, 0, 0);
+		if (!data)
+			continue;
+
+		// Keep the reference of the tile when its slot is free.
+		dtStatus status = navmesh->addTile(data, record.dataSize, DT_TILE_FREE_DATA, record.tileRef, 0);
+		if (dtStatusFailed(status) && record.tileRef)
+			status = navmesh->addTile(data, record.dataSize, DT_TILE_FREE_DATA, 0, 0);
+		if (dtStatusFailed(status))
+		{
+			dtFree(data);
+			return status;
+		}
+	}
+	return DT_SUCCESS;
+}
@@ -21,6 +21,8 @@
 #include "DetourStatus.h"
 #include "DetourAssert.h"
 #include "DetourTileCacheBuilder.h"
+#include "DetourTileCache.h"
+#include "DetourNavMesh.h"
 #include <string.h>
 
 dtTileCacheAlloc::~dtTileCacheAlloc()
@@ -58,8 +60,7 @@ inline int getDirOffsetY(int dir)
 	return offset[dir&0x03];
 }
 
-static const int MAX_VERTS_PER_POLY = 6;	// TODO: use the DT_VERTS_PER_POLYGON
-static const int MAX_REM_EDGES = 48;		// TODO: make this an expression.
+static const int MAX_VERTS_PER_POLY = DT_VERTS_PER_POLYGON;
 
 
 
@@ -109,30 +110,36 @@ void dtFreeTileCachePolyMesh(dtTileCacheAlloc* alloc, dtTileCachePolyMesh* lmesh
 struct dtLayerSweepSpan
 {
 	unsigned short ns;	// number samples
-	unsigned char id;	// region id
-	unsigned char nei;	// neighbour id
+	unsigned short id;	// region id
+	unsigned short nei;	// neighbour id
 };
 
 static const int DT_LAYER_MAX_NEIS = 16;
 
+// The neighbour region of a contour segment on a portal is DT_LAYER_PORTAL_REG + the portal direction.
+// The region ids stay below it.
+static const unsigned short DT_LAYER_PORTAL_REG = 0xfff8;
+
 struct dtLayerMonotoneRegion
 {
 	int area;
-	unsigned char neis[DT_LAYER_MAX_NEIS];
+	int firstMember;	// The first monotone region merged into this region id, or -1.
+	int nextMember;		// The next monotone region with the same region id, or -1.
+	unsigned short neis[DT_LAYER_MAX_NEIS];
 	unsigned char nneis;
-	unsigned char regId;
 	unsigned char areaId;
+	unsigned short regId;
 };
 
 struct dtTempContour
 {
-	inline dtTempContour(unsigned char* vbuf, const int nvbuf,
+	inline dtTempContour(unsigned short* vbuf, const int nvbuf,
 						 unsigned short* pbuf, const int npbuf) :
 		verts(vbuf), nverts(0), cverts(nvbuf),
 		poly(pbuf), npoly(0), cpoly(npbuf) 
 	{
 	}
-	unsigned char* verts;
+	unsigned short* verts;	// x, y, z and the neighbour region of each vertex.
 	int nverts;
 	int cverts;
 	unsigned short* poly;
@@ -149,10 +156,11 @@ inline bool overlapRangeExl(const unsigned short amin, const unsigned short amax
 	return (amin >= bmax || amax <= bmin) ? false : true;
 }
 
-static void addUniqueLast(unsigned char* a, unsigned char& an, unsigned char v)
+static void addUniqueLast(unsigned short* a, unsigned char& an, unsigned short v)
 {
 	const int n = (int)an;
 	if (n > 0 && a[n-1] == v) return;
+	if (n >= DT_LAYER_MAX_NEIS) return;
 	a[an] = v;
 	an++;
 }
@@ -165,13 +173,12 @@ inline bool isConnected(const dtTileCacheLayer& layer,
 	return true;
 }
 
-static bool canMerge(unsigned char oldRegId, unsigned char newRegId, const dtLayerMonotoneRegion* regs, const int nregs)
+static bool canMerge(unsigned short oldRegId, unsigned short newRegId, const dtLayerMonotoneRegion* regs)
 {
 	int count = 0;
-	for (int i = 0; i < nregs; ++i)
+	for (int i = regs[oldRegId].firstMember; i != -1; i = regs[i].nextMember)
 	{
 		const dtLayerMonotoneRegion& reg = regs[i];
-		if (reg.regId != oldRegId) continue;
 		const int nnei = (int)reg.nneis;
 		for (int j = 0; j < nnei; ++j)
 		{
@@ -192,7 +199,8 @@ dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 	const int w = (int)layer.header->width;
 	const int h = (int)layer.header->height;
 	
-	memset(layer.regs,0xff,sizeof(unsigned char)*w*h);
+	for (int i = 0; i < w*h; ++i)
+		layer.regs[i] = DT_TILECACHE_NULL_REG;
 	
 	const int nsweeps = w;
 	dtFixedArray<dtLayerSweepSpan> sweeps(alloc, nsweeps);
@@ -200,35 +208,39 @@ dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
 	memset(sweeps,0,sizeof(dtLayerSweepSpan)*nsweeps);
 	
+	// The sweeps of a row are at most every other cell, so the cell count bounds the region count.
+	dtFixedArray<unsigned short> prevCount(alloc, dtMax(w*h, 1));
+	if (!prevCount)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	
 	// Partition walkable area into monotone regions.
-	unsigned char prevCount[256];
-	unsigned char regId = 0;
+	int regId = 0;
 	
 	for (int y = 0; y < h; ++y)
 	{
 		if (regId > 0)
-			memset(prevCount,0,sizeof(unsigned char)*regId);
-		unsigned char sweepId = 0;
+			memset(prevCount,0,sizeof(unsigned short)*regId);
+		unsigned short sweepId = 0;
 		
 		for (int x = 0; x < w; ++x)
 		{
 			const int idx = x + y*w;
 			if (layer.areas[idx] == DT_TILECACHE_NULL_AREA) continue;
 			
-			unsigned char sid = 0xff;
+			unsigned short sid = DT_TILECACHE_NULL_REG;
 			
 			// -x
 			const int xidx = (x-1)+y*w;
 			if (x > 0 && isConnected(layer, idx, xidx, walkableClimb))
 			{
-				if (layer.regs[xidx] != 0xff)
+				if (layer.regs[xidx] != DT_TILECACHE_NULL_REG)
 					sid = layer.regs[xidx];
 			}
 			
-			if (sid == 0xff)
+			if (sid == DT_TILECACHE_NULL_REG)
 			{
 				sid = sweepId++;
-				sweeps[sid].nei = 0xff;
+				sweeps[sid].nei = DT_TILECACHE_NULL_REG;
 				sweeps[sid].ns = 0;
 			}
 			
@@ -236,8 +248,8 @@ dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 			const int yidx = x+(y-1)*w;
 			if (y > 0 && isConnected(layer, idx, yidx, walkableClimb))
 			{
-				const unsigned char nr = layer.regs[yidx];
-				if (nr != 0xff)
+				const unsigned short nr = layer.regs[yidx];
+				if (nr != DT_TILECACHE_NULL_REG)
 				{
 					// Set neighbour when first valid neighbour is encoutered.
 					if (sweeps[sid].ns == 0)
@@ -253,7 +265,7 @@ dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 					{
 						// This is hit if there is nore than one neighbour.
 						// Invalidate the neighbour.
-						sweeps[sid].nei = 0xff;
+						sweeps[sid].nei = DT_TILECACHE_NULL_REG;
 					}
 				}
 			}
@@ -266,18 +278,18 @@ dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 		{
 			// If the neighbour is set and there is only one continuous connection to it,
 			// the sweep will be merged with the previous one, else new region is created.
-			if (sweeps[i].nei != 0xff && (unsigned short)prevCount[sweeps[i].nei] == sweeps[i].ns)
+			if (sweeps[i].nei != DT_TILECACHE_NULL_REG && prevCount[sweeps[i].nei] == sweeps[i].ns)
 			{
 				sweeps[i].id = sweeps[i].nei;
 			}
 			else
 			{
-				if (regId == 255)
+				if (regId >= (int)DT_LAYER_PORTAL_REG)
 				{
 					// Region ID's overflow.
 					return DT_FAILURE | DT_BUFFER_TOO_SMALL;
 				}
-				sweeps[i].id = regId++;
+				sweeps[i].id = (unsigned short)regId++;
 			}
 		}
 		
@@ -285,20 +297,18 @@ dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 		for (int x = 0; x < w; ++x)
 		{
 			const int idx = x+y*w;
-			if (layer.regs[idx] != 0xff)
+			if (layer.regs[idx] != DT_TILECACHE_NULL_REG)
 				layer.regs[idx] = sweeps[layer.regs[idx]].id;
 		}
 	}
 	
 	// Allocate and init layer regions.
-	const int nregs = (int)regId;
-	dtFixedArray<dtLayerMonotoneRegion> regs(alloc, nregs);
+	const int nregs = regId;
+	dtFixedArray<dtLayerMonotoneRegion> regs(alloc, dtMax(nregs, 1));
 	if (!regs)
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
 
 	memset(regs, 0, sizeof(dtLayerMonotoneRegion)*nregs);
-	for (int i = 0; i < nregs; ++i)
-		regs[i].regId = 0xff;
 	
 	// Find region neighbours.
 	for (int y = 0; y < h; ++y)
@@ -306,8 +316,8 @@ dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 		for (int x = 0; x < w; ++x)
 		{
 			const int idx = x+y*w;
-			const unsigned char ri = layer.regs[idx];
-			if (ri == 0xff)
+			const unsigned short ri = layer.regs[idx];
+			if (ri == DT_TILECACHE_NULL_REG)
 				continue;
 			
 			// Update area.
@@ -318,8 +328,8 @@ dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 			const int ymi = x+(y-1)*w;
 			if (y > 0 && isConnected(layer, idx, ymi, walkableClimb))
 			{
-				const unsigned char rai = layer.regs[ymi];
-				if (rai != 0xff && rai != ri)
+				const unsigned short rai = layer.regs[ymi];
+				if (rai != DT_TILECACHE_NULL_REG && rai != ri)
 				{
 					addUniqueLast(regs[ri].neis, regs[ri].nneis, rai);
 					addUniqueLast(regs[rai].neis, regs[rai].nneis, ri);
@@ -328,8 +338,13 @@ dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 		}
 	}
 	
+	// Every merged region starts as a list of one monotone region.
 	for (int i = 0; i < nregs; ++i)
-		regs[i].regId = (unsigned char)i;
+	{
+		regs[i].regId = (unsigned short)i;
+		regs[i].firstMember = i;
+		regs[i].nextMember = -1;
+	}
 	
 	for (int i = 0; i < nregs; ++i)
 	{
@@ -339,7 +354,7 @@ dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 		int mergea = 0;
 		for (int j = 0; j < (int)reg.nneis; ++j)
 		{
-			const unsigned char nei = reg.neis[j];
+			const unsigned short nei = reg.neis[j];
 			dtLayerMonotoneRegion& regn = regs[nei];
 			if (reg.regId == regn.regId)
 				continue;
@@ -347,7 +362,7 @@ dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 				continue;
 			if (regn.area > mergea)
 			{
-				if (canMerge(reg.regId, regn.regId, regs, nregs))
+				if (canMerge(reg.regId, regn.regId, regs))
 				{
 					mergea = regn.area;
 					merge = (int)nei;
@@ -356,33 +371,42 @@ dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 		}
 		if (merge != -1)
 		{
-			const unsigned char oldId = reg.regId;
-			const unsigned char newId = regs[merge].regId;
-			for (int j = 0; j < nregs; ++j)
-				if (regs[j].regId == oldId)
-					regs[j].regId = newId;
+			// Move the members of the old region to the new one.
+			const unsigned short oldId = reg.regId;
+			const unsigned short newId = regs[merge].regId;
+			int last = -1;
+			for (int j = regs[oldId].firstMember; j != -1; j = regs[j].nextMember)
+			{
+				regs[j].regId = newId;
+				last = j;
+			}
+			regs[last].nextMember = regs[newId].firstMember;
+			regs[newId].firstMember = regs[oldId].firstMember;
+			regs[oldId].firstMember = -1;
 		}
 	}
 	
 	// Compact ids.
-	unsigned char remap[256];
-	memset(remap, 0, 256);
+	dtFixedArray<unsigned short> remap(alloc, dtMax(nregs, 1));
+	if (!remap)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(remap, 0, sizeof(unsigned short)*nregs);
 	// Find number of unique regions.
 	regId = 0;
 	for (int i = 0; i < nregs; ++i)
 		remap[regs[i].regId] = 1;
-	for (int i = 0; i < 256; ++i)
+	for (int i = 0; i < nregs; ++i)
 		if (remap[i])
-			remap[i] = regId++;
+			remap[i] = (unsigned short)regId++;
 	// Remap ids.
 	for (int i = 0; i < nregs; ++i)
 		regs[i].regId = remap[regs[i].regId];
 	
-	layer.regCount = regId;
+	layer.regCount = (unsigned short)regId;
 	
 	for (int i = 0; i < w*h; ++i)
 	{
-		if (layer.regs[i] != 0xff)
+		if (layer.regs[i] != DT_TILECACHE_NULL_REG)
 			layer.regs[i] = regs[layer.regs[i]].regId;
 	}
 	
@@ -396,22 +420,22 @@ static bool appendVertex(dtTempContour& cont, const int x, const int y, const in
 	// Try to merge with existing segments.
 	if (cont.nverts > 1)
 	{
-		unsigned char* pa = &cont.verts[(cont.nverts-2)*4];
-		unsigned char* pb = &cont.verts[(cont.nverts-1)*4];
+		unsigned short* pa = &cont.verts[(cont.nverts-2)*4];
+		unsigned short* pb = &cont.verts[(cont.nverts-1)*4];
 		if ((int)pb[3] == r)
 		{
 			if (pa[0] == pb[0] && (int)pb[0] == x)
 			{
 				// The verts are aligned aling x-axis, update z.
-				pb[1] = (unsigned char)y;
-				pb[2] = (unsigned char)z;
+				pb[1] = (unsigned short)y;
+				pb[2] = (unsigned short)z;
 				return true;
 			}
 			else if (pa[2] == pb[2] && (int)pb[2] == z)
 			{
 				// The verts are aligned aling z-axis, update x.
-				pb[0] = (unsigned char)x;
-				pb[1] = (unsigned char)y;
+				pb[0] = (unsigned short)x;
+				pb[1] = (unsigned short)y;
 				return true;
 			}
 		}
@@ -421,19 +445,19 @@ static bool appendVertex(dtTempContour& cont, const int x, const int y, const in
 	if (cont.nverts+1 > cont.cverts)
 		return false;
 	
-	unsigned char* v = &cont.verts[cont.nverts*4];
-	v[0] = (unsigned char)x;
-	v[1] = (unsigned char)y;
-	v[2] = (unsigned char)z;
-	v[3] = (unsigned char)r;
+	unsigned short* v = &cont.verts[cont.nverts*4];
+	v[0] = (unsigned short)x;
+	v[1] = (unsigned short)y;
+	v[2] = (unsigned short)z;
+	v[3] = (unsigned short)r;
 	cont.nverts++;
 	
 	return true;
 }
 
 
-static unsigned char getNeighbourReg(dtTileCacheLayer& layer,
-									 const int ax, const int ay, const int dir)
+static unsigned short getNeighbourReg(dtTileCacheLayer& layer,
+									  const int ax, const int ay, const int dir)
 {
 	const int w = (int)layer.header->width;
 	const int ia = ax + ay*w;
@@ -446,8 +470,8 @@ static unsigned char getNeighbourReg(dtTileCacheLayer& layer,
 	{
 		// No connection, return portal or hard edge.
 		if (portal & mask)
-			return 0xf8 + (unsigned char)dir;
-		return 0xff;
+			return (unsigned short)(DT_LAYER_PORTAL_REG + dir);
+		return DT_TILECACHE_NULL_REG;
 	}
 	
 	const int bx = ax + getDirOffsetX(dir);
@@ -471,7 +495,7 @@ static bool walkContour(dtTileCacheLayer& layer, int x, int y, dtTempContour& co
 	for (int i = 0; i < 4; ++i)
 	{
 		const int dir = (i+3)&3;
-		unsigned char rn = getNeighbourReg(layer, x, y, dir);
+		unsigned short rn = getNeighbourReg(layer, x, y, dir);
 		if (rn != layer.regs[x+y*w])
 		{
 			startDir = dir;
@@ -487,7 +511,7 @@ static bool walkContour(dtTileCacheLayer& layer, int x, int y, dtTempContour& co
 	int iter = 0;
 	while (iter < maxIter)
 	{
-		unsigned char rn = getNeighbourReg(layer, x, y, dir);
+		unsigned short rn = getNeighbourReg(layer, x, y, dir);
 		
 		int nx = x;
 		int ny = y;
@@ -530,8 +554,8 @@ static bool walkContour(dtTileCacheLayer& layer, int x, int y, dtTempContour& co
 	}
 	
 	// Remove last vertex if it is duplicate of the first one.
-	unsigned char* pa = &cont.verts[(cont.nverts-1)*4];
-	unsigned char* pb = &cont.verts[0];
+	unsigned short* pa = &cont.verts[(cont.nverts-1)*4];
+	unsigned short* pb = &cont.verts[0];
 	if (pa[0] == pb[0] && pa[2] == pb[2])
 		cont.nverts--;
 	
@@ -562,20 +586,91 @@ static float distancePtSeg(const int x, const int z,
 	return dx*dx + dz*dz;
 }
 
-static void simplifyContour(dtTempContour& cont, const float maxError)
+// Returns the vertex between a and b that deviates the most from the segment if it
+// deviates more than the error tolerance, or -1.
+static int findMaxDeviation(const dtTempContour& cont, const int ai, const int bi, const float maxError)
 {
-	cont.npoly = 0;
+	const int ax = (int)cont.verts[ai*4+0];
+	const int az = (int)cont.verts[ai*4+2];
+	const int bx = (int)cont.verts[bi*4+0];
+	const int bz = (int)cont.verts[bi*4+2];
+	
+	// Find maximum deviation from the segment.
+	float maxd = 0;
+	int maxi = -1;
+	int ci, endi;
+	bool forward;
+	
+	// Traverse the segment in lexilogical order so that the
+	// max deviation is calculated similarly when traversing
+	// opposite segments.
+	if (bx > ax || (bx == ax && bz > az))
+	{
+		forward = true;
+		ci = ai+1 < cont.nverts ? ai+1 : 0;
+		endi = bi;
+	}
+	else
+	{
+		forward = false;
+		ci = bi > 0 ? bi-1 : cont.nverts-1;
+		endi = ai;
+	}
+	
+	// Tessellate only outer edges or edges between areas.
+	while (ci != endi)
+	{
+		float d = distancePtSeg(cont.verts[ci*4+0], cont.verts[ci*4+2], ax, az, bx, bz);
+		if (d > maxd)
+		{
+			maxd = d;
+			maxi = ci;
+		}
+		if (forward)
+			ci = ci+1 < cont.nverts ? ci+1 : 0;
+		else
+			ci = ci > 0 ? ci-1 : cont.nverts-1;
+	}
 	
+	// If the max deviation is larger than accepted error, add new point.
+	if (maxi != -1 && maxd > (maxError*maxError))
+		return maxi;
+	return -1;
+}
+
+static void simplifyContour(dtTempContour& cont, const float maxError)
+{
+	// The segments are split independently of each other, so the points are added in
+	// order with a stack of the segment ends. The stack grows down from the end of the
+	// poly buffer, it and the added points never hold more than all the vertices.
+	unsigned short* ends = &cont.poly[cont.cpoly-1];
+	int nends = 0;
+	int first = -1;
 	for (int i = 0; i < cont.nverts; ++i)
 	{
 		int j = (i+1) % cont.nverts;
 		// Check for start of a wall segment.
-		unsigned char ra = cont.verts[j*4+3];
-		unsigned char rb = cont.verts[i*4+3];
+		unsigned short ra = cont.verts[j*4+3];
+		unsigned short rb = cont.verts[i*4+3];
 		if (ra != rb)
-			cont.poly[cont.npoly++] = (unsigned short)i;
+		{
+			first = i;
+			break;
+		}
 	}
-	if (cont.npoly < 2)
+	if (first != -1)
+	{
+		ends[-nends++] = (unsigned short)first;
+		for (int i = cont.nverts-1; i > first; --i)
+		{
+			int j = (i+1) % cont.nverts;
+			unsigned short ra = cont.verts[j*4+3];
+			unsigned short rb = cont.verts[i*4+3];
+			if (ra != rb)
+				ends[-nends++] = (unsigned short)i;
+		}
+	}
+	if (nends < 2)
 	{
 		// If there is no transitions at all,
 		// create some initial points for the simplification process. 
@@ -603,72 +698,27 @@ static void simplifyContour(dtTempContour& cont, const float maxError)
 				uri = i;
 			}
 		}
-		cont.npoly = 0;
-		cont.poly[cont.npoly++] = (unsigned short)lli;
-		cont.poly[cont.npoly++] = (unsigned short)uri;
+		nends = 0;
+		ends[-nends++] = (unsigned short)lli;
+		ends[-nends++] = (unsigned short)uri;
 	}
 	
 	// Add points until all raw points are within
 	// error tolerance to the simplified shape.
-	for (int i = 0; i < cont.npoly; )
+	cont.npoly = 0;
+	int ai = (int)ends[0];
+	while (nends > 0)
 	{
-		int ii = (i+1) % cont.npoly;
-		
-		const int ai = (int)cont.poly[i];
-		const int ax = (int)cont.verts[ai*4+0];
-		const int az = (int)cont.verts[ai*4+2];
-		
-		const int bi = (int)cont.poly[ii];
-		const int bx = (int)cont.verts[bi*4+0];
-		const int bz = (int)cont.verts[bi*4+2];
-		
-		// Find maximum deviation from the segment.
-		float maxd = 0;
-		int maxi = -1;
-		int ci, cinc, endi;
-		
-		// Traverse the segment in lexilogical order so that the
-		// max deviation is calculated similarly when traversing
-		// opposite segments.
-		if (bx > ax || (bx == ax && bz > az))
-		{
-			cinc = 1;
-			ci = (ai+cinc) % cont.nverts;
-			endi = bi;
-		}
-		else
-		{
-			cinc = cont.nverts-1;
-			ci = (bi+cinc) % cont.nverts;
-			endi = ai;
-		}
-		
-		// Tessellate only outer edges or edges between areas.
-		while (ci != endi)
-		{
-			float d = distancePtSeg(cont.verts[ci*4+0], cont.verts[ci*4+2], ax, az, bx, bz);
-			if (d > maxd)
-			{
-				maxd = d;
-				maxi = ci;
-			}
-			ci = (ci+cinc) % cont.nverts;
-		}
-		
-		
-		// If the max deviation is larger than accepted error,
-		// add new point, else continue to next segment.
-		if (maxi != -1 && maxd > (maxError*maxError))
+		const int bi = (int)ends[-(nends-1)];
+		const int maxi = findMaxDeviation(cont, ai, bi, maxError);
+		if (maxi != -1)
 		{
-			cont.npoly++;
-			for (int j = cont.npoly-1; j > i; --j)
-				cont.poly[j] = cont.poly[j-1];
-			cont.poly[i+1] = (unsigned short)maxi;
-		}
-		else
-		{
-			++i;
+			ends[-nends++] = (unsigned short)maxi;
+			continue;
 		}
+		nends--;
+		cont.poly[cont.npoly++] = (unsigned short)ai;
+		ai = bi;
 	}
 	
 	// Remap vertices
@@ -681,8 +731,8 @@ static void simplifyContour(dtTempContour& cont, const float maxError)
 	for (int i = 0; i < cont.npoly; ++i)
 	{
 		const int j = (start+i) % cont.npoly;
-		unsigned char* src = &cont.verts[cont.poly[j]*4];
-		unsigned char* dst = &cont.verts[cont.nverts*4];
+		unsigned short* src = &cont.verts[cont.poly[j]*4];
+		unsigned short* dst = &cont.verts[cont.nverts*4];
 		dst[0] = src[0];
 		dst[1] = src[1];
 		dst[2] = src[2];
@@ -703,7 +753,7 @@ static unsigned char getCornerHeight(dtTileCacheLayer& layer,
 	
 	unsigned char portal = 0xf;
 	unsigned char height = 0;
-	unsigned char preg = 0xff;
+	unsigned short preg = DT_TILECACHE_NULL_REG;
 	bool allSameReg = true;
 	
 	for (int dz = -1; dz <= 0; ++dz)
@@ -720,7 +770,7 @@ static unsigned char getCornerHeight(dtTileCacheLayer& layer,
 				{
 					height = dtMax(height, (unsigned char)lh);
 					portal &= (layer.cons[idx] >> 4);
-					if (preg != 0xff && preg != layer.regs[idx])
+					if (preg != DT_TILECACHE_NULL_REG && preg != layer.regs[idx])
 						allSameReg = false;
 					preg = layer.regs[idx]; 
 					n++;
@@ -744,6 +794,58 @@ static unsigned char getCornerHeight(dtTileCacheLayer& layer,
 }
 
 
+/// Traces and simplifies the contour of the region of the cell at (x, y), its first cell in scan order.
+static dtStatus buildContour(dtTileCacheAlloc* alloc, dtTileCacheLayer& layer, const int x, const int y,
+							 const int walkableClimb, const float maxError, dtTempContour& temp,
+							 dtTileCacheContour& cont)
+{
+	const int w = (int)layer.header->width;
+	const int idx = x+y*w;
+	cont.reg = layer.regs[idx];
+	cont.area = layer.areas[idx];
+	
+	if (!walkContour(layer, x, y, temp))
+	{
+		// Too complex contour.
+		// Note: If you hit here ofte, try increasing 'maxTempVerts'.
+		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+	}
+	
+	simplifyContour(temp, maxError);
+	
+	// Store contour.
+	cont.nverts = temp.nverts;
+	if (cont.nverts > 0)
+	{
+		cont.verts = (unsigned char*)alloc->alloc(sizeof(unsigned char)*4*temp.nverts);
+		if (!cont.verts)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		
+		for (int i = 0, j = temp.nverts-1; i < temp.nverts; j=i++)
+		{
+			unsigned char* dst = &cont.verts[j*4];
+			unsigned short* v = &temp.verts[j*4];
+			unsigned short* vn = &temp.verts[i*4];
+			unsigned short nei = vn[3]; // The neighbour reg is stored at segment vertex of a segment. 
+			bool shouldRemove = false;
+			unsigned char lh = getCornerHeight(layer, (int)v[0], (int)v[1], (int)v[2],
+											   walkableClimb, shouldRemove);
+			
+			dst[0] = (unsigned char)v[0];
+			dst[1] = lh;
+			dst[2] = (unsigned char)v[2];
+			
+			// Store portal direction and remove status to the fourth component.
+			dst[3] = 0x0f;
+			if (nei != DT_TILECACHE_NULL_REG && nei >= DT_LAYER_PORTAL_REG)
+				dst[3] = (unsigned char)(nei - DT_LAYER_PORTAL_REG);
+			if (shouldRemove)
+				dst[3] |= 0x80;
+		}
+	}
+	return DT_SUCCESS;
+}
+
 // TODO: move this somewhere else, once the layer meshing is done.
 dtStatus dtBuildTileCacheContours(dtTileCacheAlloc* alloc,
 								  dtTileCacheLayer& layer,
@@ -764,7 +866,7 @@ dtStatus dtBuildTileCacheContours(dtTileCacheAlloc* alloc,
 	// Allocate temp buffer for contour tracing.
 	const int maxTempVerts = (w+h)*2 * 2; // Twice around the layer.
 	
-	dtFixedArray<unsigned char> tempVerts(alloc, maxTempVerts*4);
+	dtFixedArray<unsigned short> tempVerts(alloc, maxTempVerts*4);
 	if (!tempVerts)
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
 	
@@ -780,8 +882,8 @@ dtStatus dtBuildTileCacheContours(dtTileCacheAlloc* alloc,
 		for (int x = 0; x < w; ++x)
 		{
 			const int idx = x+y*w;
-			const unsigned char ri = layer.regs[idx];
-			if (ri == 0xff)
+			const unsigned short ri = layer.regs[idx];
+			if (ri == DT_TILECACHE_NULL_REG)
 				continue;
 			
 			dtTileCacheContour& cont = lcset.conts[ri];
@@ -789,53 +891,245 @@ dtStatus dtBuildTileCacheContours(dtTileCacheAlloc* alloc,
 			if (cont.nverts > 0)
 				continue;
 			
-			cont.reg = ri;
-			cont.area = layer.areas[idx];
-			
-			if (!walkContour(layer, x, y, temp))
+			dtStatus status = buildContour(alloc, layer, x, y, walkableClimb, maxError, temp, cont);
+			if (dtStatusFailed(status))
+				return status;
+		}
+	}
+	
+	return DT_SUCCESS;
+}	
+
+dtStatus dtUpdateTileCacheRegions(dtTileCacheAlloc* alloc,
+								  dtTileCacheLayer& layer,
+								  const dtTileCacheLayer& base,
+								  const int walkableClimb,
+								  unsigned char* dirtyRegs, const int maxDirtyRegs)
+{
+	dtAssert(alloc);
+	dtAssert(dirtyRegs);
+	
+	const int w = (int)layer.header->width;
+	const int h = (int)layer.header->height;
+	if ((int)base.header->width != w || (int)base.header->height != h)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	const int maxRegs = dtMin(maxDirtyRegs, (int)DT_LAYER_PORTAL_REG);
+	if ((int)base.regCount > maxRegs)
+		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+	
+	memset(dirtyRegs, 0, maxDirtyRegs);
+	memcpy(layer.regs, base.regs, sizeof(unsigned short)*w*h);
+	layer.regCount = base.regCount;
+	
+	// Find the base regions with changed cells.
+	dtFixedArray<unsigned char> affected(alloc, dtMax((int)base.regCount, 1));
+	if (!affected)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(affected, 0, base.regCount);
+	bool changed = false;
+	for (int i = 0; i < w*h; ++i)
+	{
+		if (layer.areas[i] == base.areas[i])
+			continue;
+		changed = true;
+		if (base.regs[i] != DT_TILECACHE_NULL_REG)
+			affected[base.regs[i]] = 1;
+	}
+	if (!changed)
+		return DT_SUCCESS;
+	
+	// The walkable cells of the affected regions, and the cells which became walkable,
+	// are partitioned again.
+	int minx = w, miny = h, maxx = -1, maxy = -1;
+	for (int y = 0; y < h; ++y)
+	{
+		for (int x = 0; x < w; ++x)
+		{
+			const int idx = x+y*w;
+			const unsigned short br = base.regs[idx];
+			if (br != DT_TILECACHE_NULL_REG && !affected[br])
+				continue;
+			layer.regs[idx] = DT_TILECACHE_NULL_REG;
+			if (layer.areas[idx] == DT_TILECACHE_NULL_AREA)
+				continue;
+			minx = dtMin(minx, x);
+			miny = dtMin(miny, y);
+			maxx = dtMax(maxx, x);
+			maxy = dtMax(maxy, y);
+		}
+	}
+	
+	for (int i = 0; i < (int)base.regCount; ++i)
+		dirtyRegs[i] = affected[i];
+	
+	if (maxx >= minx)
+	{
+		// Partition the cells in a layer covering their bounds.
+		const int sw = maxx-minx+1;
+		const int sh = maxy-miny+1;
+		dtFixedArray<unsigned char> grids(alloc, sw*sh*3);
+		if (!grids)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		dtFixedArray<unsigned short> subRegs(alloc, sw*sh);
+		if (!subRegs)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		dtTileCacheLayerHeader header = *layer.header;
+		header.width = (unsigned char)sw;
+		header.height = (unsigned char)sh;
+		dtTileCacheLayer sub;
+		memset(&sub, 0, sizeof(sub));
+		sub.header = &header;
+		sub.heights = grids;
+		sub.areas = grids + sw*sh;
+		sub.cons = grids + sw*sh*2;
+		sub.regs = subRegs;
+		memset(sub.cons, 0, sw*sh);
+		for (int y = 0; y < sh; ++y)
+		{
+			for (int x = 0; x < sw; ++x)
 			{
-				// Too complex contour.
-				// Note: If you hit here ofte, try increasing 'maxTempVerts'.
-				return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+				const int idx = (minx+x) + (miny+y)*w;
+				sub.heights[x+y*sw] = layer.heights[idx];
+				sub.areas[x+y*sw] = layer.regs[idx] == DT_TILECACHE_NULL_REG ? layer.areas[idx] : DT_TILECACHE_NULL_AREA;
 			}
-			
-			simplifyContour(temp, maxError);
-			
-			// Store contour.
-			cont.nverts = temp.nverts;
-			if (cont.nverts > 0)
+		}
+		
+		dtStatus status = dtBuildTileCacheRegions(alloc, sub, walkableClimb);
+		if (dtStatusFailed(status))
+			return status;
+		
+		// The new regions take the ids of the affected regions first, then the ids after the base regions.
+		dtFixedArray<unsigned short> ids(alloc, dtMax((int)sub.regCount, 1));
+		if (!ids)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		int nids = 0;
+		for (int i = 0; i < (int)base.regCount && nids < (int)sub.regCount; ++i)
+			if (affected[i])
+				ids[nids++] = (unsigned short)i;
+		for (int i = (int)base.regCount; i < maxRegs && nids < (int)sub.regCount; ++i)
+			ids[nids++] = (unsigned short)i;
+		if ((int)sub.regCount > nids)
+			return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+		
+		int regCount = (int)base.regCount;
+		for (int y = 0; y < sh; ++y)
+		{
+			for (int x = 0; x < sw; ++x)
 			{
-				cont.verts = (unsigned char*)alloc->alloc(sizeof(unsigned char)*4*temp.nverts);
-				if (!cont.verts)
-					return DT_FAILURE | DT_OUT_OF_MEMORY;
-				
-				for (int i = 0, j = temp.nverts-1; i < temp.nverts; j=i++)
+				const unsigned short sr = sub.regs[x+y*sw];
+				if (sr == DT_TILECACHE_NULL_REG)
+					continue;
+				layer.regs[(minx+x) + (miny+y)*w] = ids[sr];
+				regCount = dtMax(regCount, (int)ids[sr]+1);
+			}
+		}
+		layer.regCount = (unsigned short)regCount;
+	}
+	
+	// A contour depends on the cells of its region and on their neighbours, so the regions next
+	// to the changed cells are traced again too.
+	for (int y = 0; y < h; ++y)
+	{
+		for (int x = 0; x < w; ++x)
+		{
+			const int idx = x+y*w;
+			const unsigned short br = base.regs[idx];
+			if (layer.areas[idx] == base.areas[idx] && (br == DT_TILECACHE_NULL_REG || !affected[br]))
+				continue;
+			for (int dy = dtMax(y-1, 0); dy <= dtMin(y+1, h-1); ++dy)
+			{
+				for (int dx = dtMax(x-1, 0); dx <= dtMin(x+1, w-1); ++dx)
 				{
-					unsigned char* dst = &cont.verts[j*4];
-					unsigned char* v = &temp.verts[j*4];
-					unsigned char* vn = &temp.verts[i*4];
-					unsigned char nei = vn[3]; // The neighbour reg is stored at segment vertex of a segment. 
-					bool shouldRemove = false;
-					unsigned char lh = getCornerHeight(layer, (int)v[0], (int)v[1], (int)v[2],
-													   walkableClimb, shouldRemove);
-					
-					dst[0] = v[0];
-					dst[1] = lh;
-					dst[2] = v[2];
-					
-					// Store portal direction and remove status to the fourth component.
-					dst[3] = 0x0f;
-					if (nei != 0xff && nei >= 0xf8)
-						dst[3] = nei - 0xf8;
-					if (shouldRemove)
-						dst[3] |= 0x80;
+					const unsigned short r = layer.regs[dx+dy*w];
+					if (r != DT_TILECACHE_NULL_REG)
+						dirtyRegs[r] = 1;
 				}
 			}
 		}
 	}
 	
 	return DT_SUCCESS;
-}	
+}
+
+dtStatus dtUpdateTileCacheContours(dtTileCacheAlloc* alloc,
+								   dtTileCacheLayer& layer,
+								   const int walkableClimb, const float maxError,
+								   const dtTileCacheContourSet& base,
+								   const unsigned char* dirtyRegs,
+								   dtTileCacheContourSet& lcset)
+{
+	dtAssert(alloc);
+	dtAssert(dirtyRegs);
+
+	const int w = (int)layer.header->width;
+	const int h = (int)layer.header->height;
+	
+	lcset.nconts = layer.regCount;
+	lcset.conts = (dtTileCacheContour*)alloc->alloc(sizeof(dtTileCacheContour)*lcset.nconts);
+	if (!lcset.conts)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(lcset.conts, 0, sizeof(dtTileCacheContour)*lcset.nconts);
+	
+	// Copy the contours of the regions which did not change.
+	bool anyDirty = false;
+	for (int i = 0; i < lcset.nconts; ++i)
+	{
+		if (dirtyRegs[i] || i >= base.nconts)
+		{
+			anyDirty = true;
+			continue;
+		}
+		const dtTileCacheContour& src = base.conts[i];
+		dtTileCacheContour& cont = lcset.conts[i];
+		cont.reg = src.reg;
+		cont.area = src.area;
+		cont.nverts = src.nverts;
+		if (src.nverts > 0)
+		{
+			cont.verts = (unsigned char*)alloc->alloc(sizeof(unsigned char)*4*src.nverts);
+			if (!cont.verts)
+				return DT_FAILURE | DT_OUT_OF_MEMORY;
+			memcpy(cont.verts, src.verts, 4*src.nverts);
+		}
+	}
+	if (!anyDirty)
+		return DT_SUCCESS;
+	
+	const int maxTempVerts = (w+h)*2 * 2; // Twice around the layer.
+	
+	dtFixedArray<unsigned short> tempVerts(alloc, maxTempVerts*4);
+	if (!tempVerts)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	
+	dtFixedArray<unsigned short> tempPoly(alloc, maxTempVerts);
+	if (!tempPoly)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+
+	dtTempContour temp(tempVerts, maxTempVerts, tempPoly, maxTempVerts);
+	
+	dtFixedArray<unsigned char> traced(alloc, dtMax(lcset.nconts, 1));
+	if (!traced)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(traced, 0, lcset.nconts);
+	
+	// Trace the dirty regions from their first cell, the same way as dtBuildTileCacheContours.
+	for (int y = 0; y < h; ++y)
+	{
+		for (int x = 0; x < w; ++x)
+		{
+			const unsigned short ri = layer.regs[x+y*w];
+			if (ri == DT_TILECACHE_NULL_REG || traced[ri] || (!dirtyRegs[ri] && (int)ri < base.nconts))
+				continue;
+			traced[ri] = 1;
+			
+			dtStatus status = buildContour(alloc, layer, x, y, walkableClimb, maxError, temp, lcset.conts[ri]);
+			if (dtStatusFailed(status))
+				return status;
+		}
+	}
+	
+	return DT_SUCCESS;
+}
 
 
 
@@ -1405,7 +1699,74 @@ static void pushBack(unsigned short v, unsigned short* arr, int& an)
 	an++;
 }
 
-static bool canRemoveVertex(dtTileCachePolyMesh& mesh, const unsigned short rem)
+/// The temporary memory for removing a vertex, grown as needed.
+struct dtRemoveVertexBuffers
+{
+	inline dtRemoveVertexBuffers(dtTileCacheAlloc* a) :
+		alloc(a), buffer(0), capacity(0),
+		edges(0), hole(0), harea(0), tris(0), tpoly(0), polys(0), tverts(0), pareas(0) {}
+	inline ~dtRemoveVertexBuffers() { alloc->free(buffer); }
+	
+	/// Makes room for @p n edges, the hole and its triangulation around the removed vertex.
+	bool reserve(const int n)
+	{
+		if (n <= capacity)
+			return true;
+		alloc->free(buffer);
+		capacity = dtMax(n, capacity*2);
+		buffer = (unsigned char*)alloc->alloc(sizeof(unsigned short)*capacity*(3+1+1+3+1+MAX_VERTS_PER_POLY) +
+											  sizeof(unsigned char)*capacity*(4+1));
+		if (!buffer)
+		{
+			capacity = 0;
+			return false;
+		}
+		unsigned short* p = (unsigned short*)buffer;
+		edges = p; p += capacity*3;
+		hole = p; p += capacity;
+		harea = p; p += capacity;
+		tris = p; p += capacity*3;
+		tpoly = p; p += capacity;
+		polys = p; p += capacity*MAX_VERTS_PER_POLY;
+		tverts = (unsigned char*)p;
+		pareas = tverts + capacity*4;
+		return true;
+	}
+	
+	dtTileCacheAlloc* alloc;
+	unsigned char* buffer;
+	int capacity;
+	unsigned short* edges;		///< [Size: capacity * 3]
+	unsigned short* hole;		///< [Size: capacity]
+	unsigned short* harea;		///< [Size: capacity]
+	unsigned short* tris;		///< [Size: capacity * 3]
+	unsigned short* tpoly;		///< [Size: capacity]
+	unsigned short* polys;		///< [Size: capacity * MAX_VERTS_PER_POLY]
+	unsigned char* tverts;		///< [Size: capacity * 4]
+	unsigned char* pareas;		///< [Size: capacity]
+};
+
+/// Counts the vertices of the polygons which use the vertex, which bounds the edges around it.
+static int countRemoveEdges(const dtTileCachePolyMesh& mesh, const unsigned short rem)
+{
+	int n = 0;
+	for (int i = 0; i < mesh.npolys; ++i)
+	{
+		const unsigned short* p = &mesh.polys[i*MAX_VERTS_PER_POLY*2];
+		const int nv = countPolyVerts(p);
+		for (int j = 0; j < nv; ++j)
+		{
+			if (p[j] == rem)
+			{
+				n += nv;
+				break;
+			}
+		}
+	}
+	return n;
+}
+
+static bool canRemoveVertex(dtTileCachePolyMesh& mesh, const unsigned short rem, dtRemoveVertexBuffers& buffers)
 {
 	// Count number of polygons to remove.
 	int numTouchedVerts = 0;
@@ -1440,11 +1801,11 @@ static bool canRemoveVertex(dtTileCachePolyMesh& mesh, const unsigned short rem)
 	
 	// Check that there is enough memory for the test.
 	const int maxEdges = numTouchedVerts*2;
-	if (maxEdges > MAX_REM_EDGES)
+	if (maxEdges > buffers.capacity)
 		return false;
 	
 	// Find edges which share the removed vertex.
-	unsigned short edges[MAX_REM_EDGES];
+	unsigned short* edges = buffers.edges;
 	int nedges = 0;
 	
 	for (int i = 0; i < mesh.npolys; ++i)
@@ -1502,14 +1863,16 @@ static bool canRemoveVertex(dtTileCachePolyMesh& mesh, const unsigned short rem)
 	return true;
 }
 
-static dtStatus removeVertex(dtTileCachePolyMesh& mesh, const unsigned short rem, const int maxTris)
+static dtStatus removeVertex(dtTileCachePolyMesh& mesh, const unsigned short rem, const int maxTris,
+							 dtRemoveVertexBuffers& buffers)
 {
+	const int maxEdges = buffers.capacity;
 	int nedges = 0;
-	unsigned short edges[MAX_REM_EDGES*3];
+	unsigned short* edges = buffers.edges;
 	int nhole = 0;
-	unsigned short hole[MAX_REM_EDGES];
+	unsigned short* hole = buffers.hole;
 	int nharea = 0;
-	unsigned short harea[MAX_REM_EDGES];
+	unsigned short* harea = buffers.harea;
 	
 	for (int i = 0; i < mesh.npolys; ++i)
 	{
@@ -1525,7 +1888,7 @@ static dtStatus removeVertex(dtTileCachePolyMesh& mesh, const unsigned short rem
 			{
 				if (p[j] != rem && p[k] != rem)
 				{
-					if (nedges >= MAX_REM_EDGES)
+					if (nedges >= maxEdges)
 						return DT_FAILURE | DT_BUFFER_TOO_SMALL;
 					unsigned short* e = &edges[nedges*3];
 					e[0] = p[k];
@@ -1588,7 +1951,7 @@ static dtStatus removeVertex(dtTileCachePolyMesh& mesh, const unsigned short rem
 			if (hole[0] == eb)
 			{
 				// The segment matches the beginning of the hole boundary.
-				if (nhole >= MAX_REM_EDGES)
+				if (nhole >= maxEdges)
 					return DT_FAILURE | DT_BUFFER_TOO_SMALL;
 				pushFront(ea, hole, nhole);
 				pushFront(a, harea, nharea);
@@ -1597,7 +1960,7 @@ static dtStatus removeVertex(dtTileCachePolyMesh& mesh, const unsigned short rem
 			else if (hole[nhole-1] == ea)
 			{
 				// The segment matches the end of the hole boundary.
-				if (nhole >= MAX_REM_EDGES)
+				if (nhole >= maxEdges)
 					return DT_FAILURE | DT_BUFFER_TOO_SMALL;
 				pushBack(eb, hole, nhole);
 				pushBack(a, harea, nharea);
@@ -1620,9 +1983,9 @@ static dtStatus removeVertex(dtTileCachePolyMesh& mesh, const unsigned short rem
 	}
 	
 	
-	unsigned short tris[MAX_REM_EDGES*3];
-	unsigned char tverts[MAX_REM_EDGES*3];
-	unsigned short tpoly[MAX_REM_EDGES*3];
+	unsigned short* tris = buffers.tris;
+	unsigned char* tverts = buffers.tverts;
+	unsigned short* tpoly = buffers.tpoly;
 	
 	// Generate temp vertex array for triangulation.
 	for (int i = 0; i < nhole; ++i)
@@ -1643,11 +2006,11 @@ static dtStatus removeVertex(dtTileCachePolyMesh& mesh, const unsigned short rem
 		ntris = -ntris;
 	}
 	
-	if (ntris > MAX_REM_EDGES)
+	if (ntris > maxEdges)
 		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
 	
-	unsigned short polys[MAX_REM_EDGES*MAX_VERTS_PER_POLY];
-	unsigned char pareas[MAX_REM_EDGES];
+	unsigned short* polys = buffers.polys;
+	unsigned char* pareas = buffers.pareas;
 	
 	// Build initial polygons.
 	int npolys = 0;
@@ -1917,13 +2280,17 @@ dtStatus dtBuildTileCachePolyMesh(dtTileCacheAlloc* alloc,
 	
 	
 	// Remove edge vertices.
+	dtRemoveVertexBuffers removeBuffers(alloc);
 	for (int i = 0; i < mesh.nverts; ++i)
 	{
 		if (vflags[i])
 		{
-			if (!canRemoveVertex(mesh, (unsigned short)i))
+			// The hole has at most one vertex more than it has edges.
+			if (!removeBuffers.reserve(countRemoveEdges(mesh, (unsigned short)i) + 1))
+				return DT_FAILURE | DT_OUT_OF_MEMORY;
+			if (!canRemoveVertex(mesh, (unsigned short)i, removeBuffers))
 				continue;
-			dtStatus status = removeVertex(mesh, (unsigned short)i, maxTris);
+			dtStatus status = removeVertex(mesh, (unsigned short)i, maxTris, removeBuffers);
 			if (dtStatusFailed(status))
 				return status;
 			// Remove vertex
@@ -1941,151 +2308,302 @@ dtStatus dtBuildTileCachePolyMesh(dtTileCacheAlloc* alloc,
 	return DT_SUCCESS;
 }
 
-dtStatus dtMarkCylinderArea(dtTileCacheLayer& layer, const float* orig, const float cs, const float ch,
-							const float* pos, const float radius, const float height, const unsigned char areaId)
+// An obstacle shape prepared for marking the cells of a layer row by row.
+struct dtObstacleMarker
 {
-	float bmin[3], bmax[3];
-	bmin[0] = pos[0] - radius;
-	bmin[1] = pos[1];
-	bmin[2] = pos[2] - radius;
-	bmax[0] = pos[0] + radius;
-	bmax[1] = pos[1] + height;
-	bmax[2] = pos[2] + radius;
-	const float r2 = dtSqr(radius/cs + 0.5f);
+	int type;
+	int minx, maxx, minz, maxz;		///< The cells the shape can cover, clamped to the layer.
+	int miny, maxy;					///< The height range of the marked cells.
+	float cx, cz;					///< The cylinder position, or the oriented box center. [Units: cells]
+	float r2;						///< The squared cylinder radius. [Units: cells]
+	float xhalf, zhalf;				///< The oriented box half extents. [Units: cells]
+	const float* rotAux;			///< The oriented box rotation.
+	const float* verts;				///< The polygon vertices. [Units: wu]
+	int nverts;
+	int vertStride;					///< The number of floats between two polygon vertices.
+	float ox, oz, ics;				///< The layer origin and the inverse cell size.
+};
 
+// Clamps the cell bounds of the marker to the layer, returns false if the shape is outside of the layer.
+static bool clampMarker(const dtTileCacheLayer& layer, dtObstacleMarker& m)
+{
 	const int w = (int)layer.header->width;
 	const int h = (int)layer.header->height;
+	if (m.maxx < 0 || m.minx >= w || m.maxz < 0 || m.minz >= h)
+		return false;
+	if (m.minx < 0) m.minx = 0;
+	if (m.maxx >= w) m.maxx = w-1;
+	if (m.minz < 0) m.minz = 0;
+	if (m.maxz >= h) m.maxz = h-1;
+	return true;
+}
+
+static bool prepareCylinder(const dtTileCacheLayer& layer, const float* orig, const float cs, const float ch,
+							 const float* pos, const float radius, const float height, dtObstacleMarker& m)
+{
 	const float ics = 1.0f/cs;
 	const float ich = 1.0f/ch;
-	
-	const float px = (pos[0]-orig[0])*ics;
-	const float pz = (pos[2]-orig[2])*ics;
-	
-	int minx = (int)dtMathFloorf((bmin[0]-orig[0])*ics);
-	int miny = (int)dtMathFloorf((bmin[1]-orig[1])*ich);
-	int minz = (int)dtMathFloorf((bmin[2]-orig[2])*ics);
-	int maxx = (int)dtMathFloorf((bmax[0]-orig[0])*ics);
-	int maxy = (int)dtMathFloorf((bmax[1]-orig[1])*ich);
-	int maxz = (int)dtMathFloorf((bmax[2]-orig[2])*ics);
+	m.type = DT_OBSTACLE_CYLINDER;
+	m.cx = (pos[0]-orig[0])*ics;
+	m.cz = (pos[2]-orig[2])*ics;
+	m.r2 = dtSqr(radius/cs + 0.5f);
+	m.minx = (int)dtMathFloorf((pos[0]-radius-orig[0])*ics);
+	m.miny = (int)dtMathFloorf((pos[1]-orig[1])*ich);
+	m.minz = (int)dtMathFloorf((pos[2]-radius-orig[2])*ics);
+	m.maxx = (int)dtMathFloorf((pos[0]+radius-orig[0])*ics);
+	m.maxy = (int)dtMathFloorf((pos[1]+height-orig[1])*ich);
+	m.maxz = (int)dtMathFloorf((pos[2]+radius-orig[2])*ics);
+	return clampMarker(layer, m);
+}
 
-	if (maxx < 0) return DT_SUCCESS;
-	if (minx >= w) return DT_SUCCESS;
-	if (maxz < 0) return DT_SUCCESS;
-	if (minz >= h) return DT_SUCCESS;
-	
-	if (minx < 0) minx = 0;
-	if (maxx >= w) maxx = w-1;
-	if (minz < 0) minz = 0;
-	if (maxz >= h) maxz = h-1;
-	
-	for (int z = minz; z <= maxz; ++z)
-	{
-		for (int x = minx; x <= maxx; ++x)
-		{
-			const float dx = (float)(x+0.5f) - px;
-			const float dz = (float)(z+0.5f) - pz;
-			if (dx*dx + dz*dz > r2)
-				continue;
-			const int y = layer.heights[x+z*w];
-			if (y < miny || y > maxy)
-				continue;
-			layer.areas[x+z*w] = areaId;
-		}
-	}
+static bool prepareBox(const dtTileCacheLayer& layer, const float* orig, const float cs, const float ch,
+						const float* bmin, const float* bmax, dtObstacleMarker& m)
+{
+	const float ics = 1.0f/cs;
+	const float ich = 1.0f/ch;
+	m.type = DT_OBSTACLE_BOX;
+	m.minx = (int)dtMathFloorf((bmin[0]-orig[0])*ics);
+	m.miny = (int)dtMathFloorf((bmin[1]-orig[1])*ich);
+	m.minz = (int)dtMathFloorf((bmin[2]-orig[2])*ics);
+	m.maxx = (int)dtMathFloorf((bmax[0]-orig[0])*ics);
+	m.maxy = (int)dtMathFloorf((bmax[1]-orig[1])*ich);
+	m.maxz = (int)dtMathFloorf((bmax[2]-orig[2])*ics);
+	return clampMarker(layer, m);
+}
 
-	return DT_SUCCESS;
+static bool prepareOrientedBox(const dtTileCacheLayer& layer, const float* orig, const float cs, const float ch,
+								const float* center, const float* halfExtents, const float* rotAux, dtObstacleMarker& m)
+{
+	const float ics = 1.0f/cs;
+	const float ich = 1.0f/ch;
+	m.type = DT_OBSTACLE_ORIENTED_BOX;
+	m.cx = (center[0]-orig[0])*ics;
+	m.cz = (center[2]-orig[2])*ics;
+	m.xhalf = halfExtents[0]*ics + 0.5f;
+	m.zhalf = halfExtents[2]*ics + 0.5f;
+	m.rotAux = rotAux;
+	const float maxr = 1.41f*dtMax(halfExtents[0], halfExtents[2]);
+	m.minx = (int)dtMathFloorf(m.cx - maxr*ics);
+	m.maxx = (int)dtMathFloorf(m.cx + maxr*ics);
+	m.minz = (int)dtMathFloorf(m.cz - maxr*ics);
+	m.maxz = (int)dtMathFloorf(m.cz + maxr*ics);
+	m.miny = (int)dtMathFloorf((center[1]-halfExtents[1]-orig[1])*ich);
+	m.maxy = (int)dtMathFloorf((center[1]+halfExtents[1]-orig[1])*ich);
+	return clampMarker(layer, m);
 }
 
-dtStatus dtMarkBoxArea(dtTileCacheLayer& layer, const float* orig, const float cs, const float ch,
-					   const float* bmin, const float* bmax, const unsigned char areaId)
+static bool prepareConvexPolygon(const dtTileCacheLayer& layer, const float* orig, const float cs, const float ch,
+								  const float* verts, const int nverts, const int vertStride,
+								  const float hmin, const float hmax, dtObstacleMarker& m)
 {
-	const int w = (int)layer.header->width;
-	const int h = (int)layer.header->height;
+	if (nverts < 3)
+		return false;
 	const float ics = 1.0f/cs;
 	const float ich = 1.0f/ch;
+	float xmin = verts[0], xmax = verts[0];
+	float zmin = verts[vertStride-1], zmax = verts[vertStride-1];
+	for (int i = 1; i < nverts; ++i)
+	{
+		const float* v = &verts[i*vertStride];
+		xmin = dtMin(xmin, v[0]);
+		xmax = dtMax(xmax, v[0]);
+		zmin = dtMin(zmin, v[vertStride-1]);
+		zmax = dtMax(zmax, v[vertStride-1]);
+	}
+	m.type = DT_OBSTACLE_CONVEX_POLYGON;
+	m.verts = verts;
+	m.nverts = nverts;
+	m.vertStride = vertStride;
+	m.ox = orig[0];
+	m.oz = orig[2];
+	m.ics = ics;
+	m.minx = (int)dtMathFloorf((xmin-orig[0])*ics);
+	m.maxx = (int)dtMathFloorf((xmax-orig[0])*ics);
+	m.minz = (int)dtMathFloorf((zmin-orig[2])*ics);
+	m.maxz = (int)dtMathFloorf((zmax-orig[2])*ics);
+	m.miny = (int)dtMathFloorf((hmin-orig[1])*ich);
+	m.maxy = (int)dtMathFloorf((hmax-orig[1])*ich);
+	return clampMarker(layer, m);
+}
 
-	int minx = (int)floorf((bmin[0]-orig[0])*ics);
-	int miny = (int)floorf((bmin[1]-orig[1])*ich);
-	int minz = (int)floorf((bmin[2]-orig[2])*ics);
-	int maxx = (int)floorf((bmax[0]-orig[0])*ics);
-	int maxy = (int)floorf((bmax[1]-orig[1])*ich);
-	int maxz = (int)floorf((bmax[2]-orig[2])*ics);
-	
-	if (maxx < 0) return DT_SUCCESS;
-	if (minx >= w) return DT_SUCCESS;
-	if (maxz < 0) return DT_SUCCESS;
-	if (minz >= h) return DT_SUCCESS;
+static bool prepareObstacle(const dtTileCacheLayer& layer, const float* orig, const float cs, const float ch,
+							 const dtTileCacheObstacle& ob, dtObstacleMarker& m)
+{
+	if (ob.type == DT_OBSTACLE_CYLINDER)
+		return prepareCylinder(layer, orig, cs, ch, ob.cylinder.pos, ob.cylinder.radius, ob.cylinder.height, m);
+	if (ob.type == DT_OBSTACLE_BOX)
+		return prepareBox(layer, orig, cs, ch, ob.box.bmin, ob.box.bmax, m);
+	if (ob.type == DT_OBSTACLE_ORIENTED_BOX)
+		return prepareOrientedBox(layer, orig, cs, ch, ob.orientedBox.center, ob.orientedBox.halfExtents,
+								  ob.orientedBox.rotAux, m);
+	if (ob.type == DT_OBSTACLE_CONVEX_POLYGON)
+		return prepareConvexPolygon(layer, orig, cs, ch, ob.convexPolygon.verts, ob.convexPolygon.nverts, 2,
+									ob.convexPolygon.hmin, ob.convexPolygon.hmax, m);
+	return false;
+}
 
-	if (minx < 0) minx = 0;
-	if (maxx >= w) maxx = w-1;
-	if (minz < 0) minz = 0;
-	if (maxz >= h) maxz = h-1;
-	
-	for (int z = minz; z <= maxz; ++z)
+// Narrows [lo, hi] to the x where |a*x + b| <= c.
+static bool clipSlab(const float a, const float b, const float c, float& lo, float& hi)
+{
+	if (dtMathFabsf(a) < 1e-6f)
+		return dtMathFabsf(b) <= c;
+	float t0 = (-c - b)/a;
+	float t1 = (c - b)/a;
+	if (t0 > t1)
+		dtSwap(t0, t1);
+	lo = dtMax(lo, t0);
+	hi = dtMin(hi, t1);
+	return lo <= hi;
+}
+
+// Finds the cells of row z covered by the shape, returns false if there are none.
+static bool getMarkerSpan(const dtObstacleMarker& m, const int z, int& x0, int& x1)
+{
+	float lo = (float)m.minx;
+	float hi = (float)m.maxx;
+	if (m.type == DT_OBSTACLE_CYLINDER)
 	{
-		for (int x = minx; x <= maxx; ++x)
+		// The cell centers inside the circle.
+		const float dz = (float)z + 0.5f - m.cz;
+		const float d = m.r2 - dz*dz;
+		if (d < 0.0f)
+			return false;
+		const float s = dtMathSqrtf(d);
+		lo = dtMax(lo, m.cx - 0.5f - s);
+		hi = dtMin(hi, m.cx - 0.5f + s);
+	}
+	else if (m.type == DT_OBSTACLE_ORIENTED_BOX)
+	{
+		// The cell corners inside both slabs of the rotated box.
+		const float z2 = 2.0f*((float)z - m.cz);
+		const float r0 = m.rotAux[0], r1 = m.rotAux[1];
+		if (!clipSlab(2.0f*r1, r0*z2 - 2.0f*r1*m.cx, m.xhalf, lo, hi) ||
+			!clipSlab(-2.0f*r0, r1*z2 + 2.0f*r0*m.cx, m.zhalf, lo, hi))
+			return false;
+	}
+	else if (m.type == DT_OBSTACLE_CONVEX_POLYGON)
+	{
+		// The cell centers between the edges crossing the row.
+		const float zc = ((float)z + 0.5f)/m.ics + m.oz;
+		float xmin = 0.0f, xmax = 0.0f;
+		bool crossed = false;
+		for (int i = 0, j = m.nverts-1; i < m.nverts; j = i++)
 		{
-			const int y = layer.heights[x+z*w];
-			if (y < miny || y > maxy)
+			const float* a = &m.verts[j*m.vertStride];
+			const float* b = &m.verts[i*m.vertStride];
+			const float az = a[m.vertStride-1], bz = b[m.vertStride-1];
+			if ((az > zc) == (bz > zc))
 				continue;
-			layer.areas[x+z*w] = areaId;
+			const float x = a[0] + (zc - az)*(b[0] - a[0])/(bz - az);
+			xmin = crossed ? dtMin(xmin, x) : x;
+			xmax = crossed ? dtMax(xmax, x) : x;
+			crossed = true;
 		}
+		if (!crossed)
+			return false;
+		lo = dtMax(lo, (xmin - m.ox)*m.ics - 0.5f);
+		hi = dtMin(hi, (xmax - m.ox)*m.ics - 0.5f);
+	}
+	if (lo > hi)
+		return false;
+	x0 = dtMax(m.minx, (int)dtMathCeilf(lo));
+	x1 = dtMin(m.maxx, (int)dtMathFloorf(hi));
+	return x0 <= x1;
+}
+
+static void markRow(dtTileCacheLayer& layer, const dtObstacleMarker& m, const int z, const unsigned char areaId)
+{
+	int x0 = 0, x1 = 0;
+	if (!getMarkerSpan(m, z, x0, x1))
+		return;
+	const int row = z*(int)layer.header->width;
+	const unsigned char* heights = &layer.heights[row];
+	unsigned char* areas = &layer.areas[row];
+	for (int x = x0; x <= x1; ++x)
+	{
+		const int y = heights[x];
+		if (y >= m.miny && y <= m.maxy)
+			areas[x] = areaId;
 	}
+}
 
+static void markShape(dtTileCacheLayer& layer, const dtObstacleMarker& m, const unsigned char areaId)
+{
+	for (int z = m.minz; z <= m.maxz; ++z)
+		markRow(layer, m, z, areaId);
+}
+
+dtStatus dtMarkCylinderArea(dtTileCacheLayer& layer, const float* orig, const float cs, const float ch,
+							const float* pos, const float radius, const float height, const unsigned char areaId)
+{
+	dtObstacleMarker m;
+	if (prepareCylinder(layer, orig, cs, ch, pos, radius, height, m))
+		markShape(layer, m, areaId);
+	return DT_SUCCESS;
+}
+
+dtStatus dtMarkBoxArea(dtTileCacheLayer& layer, const float* orig, const float cs, const float ch,
+					   const float* bmin, const float* bmax, const unsigned char areaId)
+{
+	dtObstacleMarker m;
+	if (prepareBox(layer, orig, cs, ch, bmin, bmax, m))
+		markShape(layer, m, areaId);
 	return DT_SUCCESS;
 }
 
 dtStatus dtMarkBoxArea(dtTileCacheLayer& layer, const float* orig, const float cs, const float ch,
 					   const float* center, const float* halfExtents, const float* rotAux, const unsigned char areaId)
 {
-	const int w = (int)layer.header->width;
-	const int h = (int)layer.header->height;
-	const float ics = 1.0f/cs;
-	const float ich = 1.0f/ch;
+	dtObstacleMarker m;
+	if (prepareOrientedBox(layer, orig, cs, ch, center, halfExtents, rotAux, m))
+		markShape(layer, m, areaId);
+	return DT_SUCCESS;
+}
 
-	float cx = (center[0] - orig[0])*ics;
-	float cz = (center[2] - orig[2])*ics;
-	
-	float maxr = 1.41f*dtMax(halfExtents[0], halfExtents[2]);
-	int minx = (int)floorf(cx - maxr*ics);
-	int maxx = (int)floorf(cx + maxr*ics);
-	int minz = (int)floorf(cz - maxr*ics);
-	int maxz = (int)floorf(cz + maxr*ics);
-	int miny = (int)floorf((center[1]-halfExtents[1]-orig[1])*ich);
-	int maxy = (int)floorf((center[1]+halfExtents[1]-orig[1])*ich);
-
-	if (maxx < 0) return DT_SUCCESS;
-	if (minx >= w) return DT_SUCCESS;
-	if (maxz < 0) return DT_SUCCESS;
-	if (minz >= h) return DT_SUCCESS;
-
-	if (minx < 0) minx = 0;
-	if (maxx >= w) maxx = w-1;
-	if (minz < 0) minz = 0;
-	if (maxz >= h) maxz = h-1;
-	
-	float xhalf = halfExtents[0]*ics + 0.5f;
-	float zhalf = halfExtents[2]*ics + 0.5f;
-
-	for (int z = minz; z <= maxz; ++z)
-	{
-		for (int x = minx; x <= maxx; ++x)
-		{			
-			float x2 = 2.0f*(float(x) - cx);
-			float z2 = 2.0f*(float(z) - cz);
-			float xrot = rotAux[1]*x2 + rotAux[0]*z2;
-			if (xrot > xhalf || xrot < -xhalf)
-				continue;
-			float zrot = rotAux[1]*z2 - rotAux[0]*x2;
-			if (zrot > zhalf || zrot < -zhalf)
-				continue;
-			const int y = layer.heights[x+z*w];
-			if (y < miny || y > maxy)
+dtStatus dtMarkConvexPolygonArea(dtTileCacheLayer& layer, const float* orig, const float cs, const float ch,
+								 const float* verts, const int nverts, const float hmin, const float hmax,
+								 const unsigned char areaId)
+{
+	if (!verts || nverts < 3)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	dtObstacleMarker m;
+	if (prepareConvexPolygon(layer, orig, cs, ch, verts, nverts, 3, hmin, hmax, m))
+		markShape(layer, m, areaId);
+	return DT_SUCCESS;
+}
+
+dtStatus dtMarkObstacleAreas(dtTileCacheLayer& layer, const float* orig, const float cs, const float ch,
+							 const dtTileCacheObstacle* const* obstacles, const int count, const unsigned char areaId)
+{
+	if (count < 0 || (count > 0 && !obstacles))
+		return DT_FAILURE | DT_INVALID_PARAM;
+	
+	// The obstacles are marked in batches, each batch walks the rows of the layer once.
+	static const int MAX_MARKERS = 32;
+	dtObstacleMarker markers[MAX_MARKERS];
+	for (int first = 0; first < count; first += MAX_MARKERS)
+	{
+		const int last = dtMin(first + MAX_MARKERS, count);
+		int nmarkers = 0;
+		int minz = (int)layer.header->height, maxz = -1;
+		for (int i = first; i < last; ++i)
+		{
+			dtObstacleMarker& m = markers[nmarkers];
+			if (!prepareObstacle(layer, orig, cs, ch, *obstacles[i], m))
 				continue;
-			layer.areas[x+z*w] = areaId;
+			minz = dtMin(minz, m.minz);
+			maxz = dtMax(maxz, m.maxz);
+			nmarkers++;
+		}
+		for (int z = minz; z <= maxz; ++z)
+		{
+			for (int i = 0; i < nmarkers; ++i)
+			{
+				if (z >= markers[i].minz && z <= markers[i].maxz)
+					markRow(layer, markers[i], z, areaId);
+			}
 		}
 	}
-
 	return DT_SUCCESS;
 }
 
@@ -2170,7 +2688,8 @@ dtStatus dtDecompressTileCacheLayer(dtTileCacheAlloc* alloc, dtTileCacheCompress
 	const int layerSize = dtAlign4(sizeof(dtTileCacheLayer));
 	const int headerSize = dtAlign4(sizeof(dtTileCacheLayerHeader));
 	const int gridSize = (int)compressedHeader->width * (int)compressedHeader->height;
-	const int bufferSize = layerSize + headerSize + gridSize*4;
+	const int regsOffset = dtAlign4(gridSize*3);
+	const int bufferSize = layerSize + headerSize + regsOffset + gridSize*(int)sizeof(unsigned short);
 	
 	unsigned char* buffer = (unsigned char*)alloc->alloc(bufferSize);
 	if (!buffer)
@@ -2198,7 +2717,46 @@ dtStatus dtDecompressTileCacheLayer(dtTileCacheAlloc* alloc, dtTileCacheCompress
 	layer->heights = grids;
 	layer->areas = grids + gridSize;
 	layer->cons = grids + gridSize*2;
-	layer->regs = grids + gridSize*3;
+	layer->regs = (unsigned short*)(grids + regsOffset);
+	
+	*layerOut = layer;
+	
+	return DT_SUCCESS;
+}
+
+dtStatus dtCopyTileCacheLayer(dtTileCacheAlloc* alloc, const dtTileCacheLayer& src, dtTileCacheLayer** layerOut)
+{
+	dtAssert(alloc);
+	
+	if (!layerOut)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	*layerOut = 0;
+	
+	// Same layout as dtDecompressTileCacheLayer.
+	const int layerSize = dtAlign4(sizeof(dtTileCacheLayer));
+	const int headerSize = dtAlign4(sizeof(dtTileCacheLayerHeader));
+	const int gridSize = (int)src.header->width * (int)src.header->height;
+	const int regsOffset = dtAlign4(gridSize*3);
+	const int bufferSize = layerSize + headerSize + regsOffset + gridSize*(int)sizeof(unsigned short);
+	
+	unsigned char* buffer = (unsigned char*)alloc->alloc(bufferSize);
+	if (!buffer)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	
+	dtTileCacheLayer* layer = (dtTileCacheLayer*)buffer;
+	dtTileCacheLayerHeader* header = (dtTileCacheLayerHeader*)(buffer + layerSize);
+	unsigned char* grids = buffer + layerSize + headerSize;
+	memcpy(header, src.header, sizeof(dtTileCacheLayerHeader));
+	layer->header = header;
+	layer->regCount = src.regCount;
+	layer->heights = grids;
+	layer->areas = grids + gridSize;
+	layer->cons = grids + gridSize*2;
+	layer->regs = (unsigned short*)(grids + regsOffset);
+	memcpy(layer->heights, src.heights, gridSize);
+	memcpy(layer->areas, src.areas, gridSize);
+	memcpy(layer->cons, src.cons, gridSize);
+	memcpy(layer->regs, src.regs, gridSize*sizeof(unsigned short));
 	
 	*layerOut = layer;
 	
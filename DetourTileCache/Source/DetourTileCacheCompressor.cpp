@@ -0,0 +1,188 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "DetourTileCacheCompressor.h"
+#include "DetourAlloc.h"
+#include <string.h>
+
+// Run-length coding in the PackBits style. A control byte c < 128 is followed
+// by c+1 literal bytes, a control byte c >= 128 by one byte repeated c-125 times.
+static const int RLE_MIN_RUN = 3;
+static const int RLE_MAX_RUN = 130;
+static const int RLE_MAX_LITERALS = 128;
+
+// The layer buffer is made of three planes, the first one is the heights.
+static int getHeightsPlaneSize(const int bufferSize)
+{
+	return (bufferSize % 3) == 0 ? bufferSize / 3 : 0;
+}
+
+static void encodeDelta(unsigned char* data, const int n)
+{
+	for (int i = n-1; i > 0; --i)
+		data[i] = (unsigned char)(data[i] - data[i-1]);
+}
+
+static void decodeDelta(unsigned char* data, const int n)
+{
+	for (int i = 1; i < n; ++i)
+		data[i] = (unsigned char)(data[i] + data[i-1]);
+}
+
+static unsigned char getDeltaByte(const unsigned char* buffer, const int i, const int heightsSize)
+{
+	if (i > 0 && i < heightsSize)
+		return (unsigned char)(buffer[i] - buffer[i-1]);
+	return buffer[i];
+}
+
+dtTileCacheRLECompressor::~dtTileCacheRLECompressor()
+{
+	// Defined out of line to fix the weak v-tables warning
+}
+
+int dtTileCacheRLECompressor::maxCompressedSize(const int bufferSize)
+{
+	// Worst case is one control byte per literal run.
+	return bufferSize + (bufferSize + RLE_MAX_LITERALS-1) / RLE_MAX_LITERALS;
+}
+
+dtStatus dtTileCacheRLECompressor::compress(const unsigned char* buffer, const int bufferSize,
+											unsigned char* compressed, const int maxCompressedSize, int* compressedSize)
+{
+	const int heightsSize = getHeightsPlaneSize(bufferSize);
+	int n = 0;
+	int i = 0;
+	int literalStart = 0;
+	
+	while (i < bufferSize)
+	{
+		// Find the run starting at i.
+		const unsigned char v = getDeltaByte(buffer, i, heightsSize);
+		int run = 1;
+		while (i + run < bufferSize && run < RLE_MAX_RUN && getDeltaByte(buffer, i + run, heightsSize) == v)
+			run++;
+		
+		// Flush pending literals before a run, or when the literal run is full.
+		const bool isRun = run >= RLE_MIN_RUN;
+		if ((isRun && literalStart < i) || i - literalStart == RLE_MAX_LITERALS)
+		{
+			const int count = i - literalStart;
+			if (n + 1 + count > maxCompressedSize)
+				return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+			compressed[n++] = (unsigned char)(count - 1);
+			for (int j = literalStart; j < i; ++j)
+				compressed[n++] = getDeltaByte(buffer, j, heightsSize);
+			literalStart = i;
+		}
+		
+		if (isRun)
+		{
+			if (n + 2 > maxCompressedSize)
+				return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+			compressed[n++] = (unsigned char)(run + 125);
+			compressed[n++] = v;
+			i += run;
+			literalStart = i;
+		}
+		else
+		{
+			i++;
+		}
+	}
+	
+	if (literalStart < bufferSize)
+	{
+		const int count = bufferSize - literalStart;
+		if (n + 1 + count > maxCompressedSize)
+			return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+		compressed[n++] = (unsigned char)(count - 1);
+		for (int j = literalStart; j < bufferSize; ++j)
+			compressed[n++] = getDeltaByte(buffer, j, heightsSize);
+	}
+	
+	*compressedSize = n;
+	return DT_SUCCESS;
+}
+
+dtStatus dtTileCacheRLECompressor::decompress(const unsigned char* compressed, const int compressedSize,
+											  unsigned char* buffer, const int maxBufferSize, int* bufferSize)
+{
+	int n = 0;
+	int i = 0;
+	while (i < compressedSize)
+	{
+		const int c = compressed[i++];
+		if (c < RLE_MAX_LITERALS)
+		{
+			const int count = c + 1;
+			if (i + count > compressedSize || n + count > maxBufferSize)
+				return DT_FAILURE;
+			memcpy(buffer + n, compressed + i, count);
+			i += count;
+			n += count;
+		}
+		else
+		{
+			const int count = c - 125;
+			if (i >= compressedSize || n + count > maxBufferSize)
+				return DT_FAILURE;
+			memset(buffer + n, compressed[i++], count);
+			n += count;
+		}
+	}
+	
+	decodeDelta(buffer, getHeightsPlaneSize(n));
+	
+	*bufferSize = n;
+	return DT_SUCCESS;
+}
+
+dtTileCacheDeltaCompressor::~dtTileCacheDeltaCompressor()
+{
+	// Defined out of line to fix the weak v-tables warning
+}
+
+int dtTileCacheDeltaCompressor::maxCompressedSize(const int bufferSize)
+{
+	return m_comp->maxCompressedSize(bufferSize);
+}
+
+dtStatus dtTileCacheDeltaCompressor::compress(const unsigned char* buffer, const int bufferSize,
+											  unsigned char* compressed, const int maxCompressedSize, int* compressedSize)
+{
+	unsigned char* filtered = (unsigned char*)dtAlloc(bufferSize, DT_ALLOC_TEMP);
+	if (!filtered)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memcpy(filtered, buffer, bufferSize);
+	encodeDelta(filtered, getHeightsPlaneSize(bufferSize));
+	
+	dtStatus status = m_comp->compress(filtered, bufferSize, compressed, maxCompressedSize, compressedSize);
+	dtFree(filtered);
+	return status;
+}
+
+dtStatus dtTileCacheDeltaCompressor::decompress(const unsigned char* compressed, const int compressedSize,
+												unsigned char* buffer, const int maxBufferSize, int* bufferSize)
+{
+	dtStatus status = m_comp->decompress(compressed, compressedSize, buffer, maxBufferSize, bufferSize);
+	if (dtStatusFailed(status))
+		return status;
+	decodeDelta(buffer, getHeightsPlaneSize(*bufferSize));
+	return status;
+}
@@ -94,6 +94,10 @@ enum rcTimerLabel
 	RC_TIMER_BUILD_POLYMESHDETAIL,
 	/// The time to merge polygon mesh details. (See: #rcMergePolyMeshDetails)
 	RC_TIMER_MERGE_POLYMESHDETAIL,
+	/// The time to apply the fused span filters. (See: #rcBuildFilteredCompactHeightfield)
+	RC_TIMER_FILTER_SPANS,
+	/// The time to build the polygon edge clearances. (See: #rcBuildPolyMeshEdgeClearance)
+	RC_TIMER_BUILD_POLYMESH_CLEARANCE,
 	/// The maximum number of timers.  (Used for iterating timers.)
 	RC_MAX_TIMERS
 };
@@ -211,6 +215,50 @@ private:
 	const rcTimerLabel m_label;
 };
 
+/// A function executed once per job index by an #rcJobDispatcher.
+///  @param[in]		userData	The user data passed to rcJobDispatcher::dispatch.
+///  @param[in]		jobIndex	The index of the job to execute. [Limits: 0 <= value < jobCount]
+///  @param[in]		workerIndex	The index of the worker executing the job. [Limits: 0 <= value < rcJobDispatcher::getWorkerCount()]
+typedef void (*rcJobFunc)(void* userData, const int jobIndex, const int workerIndex);
+
+/// Provides an interface for running independent Recast build jobs,
+/// e.g. on the job system or thread pool of the host application.
+///
+/// The default implementation runs all jobs serially on the calling thread.
+/// Implementations that run jobs concurrently must ensure that no two jobs
+/// with the same worker index run at the same time, so that per-worker
+/// resources (such as a #rcContext) can be used without locking.
+///
+/// @ingroup recast
+class rcJobDispatcher
+{
+public:
+	virtual ~rcJobDispatcher() {}
+
+	/// Returns the number of workers that can run jobs concurrently.
+	/// @return The number of workers. [Limit: >= 1]
+	virtual int getWorkerCount() const { return 1; }
+
+	/// Runs the job function for every job index and returns once all jobs have completed.
+	///  @param[in]		func		The job function.
+	///  @param[in]		userData	The user data passed to each job.
+	///  @param[in]		jobCount	The number of jobs to run.
+	virtual void dispatch(rcJobFunc func, void* userData, const int jobCount)
+	{
+		for (int i = 0; i < jobCount; ++i)
+			func(userData, i, 0);
+	}
+};
+
+/// Runs jobs with a dispatcher, with the allocator bound to the calling thread also
+/// bound to the workers while they run the jobs. (See: #rcAllocatorScope)
+///  @param[in]		dispatcher	The dispatcher.
+///  @param[in]		func		The job function.
+///  @param[in]		userData	The user data passed to each job.
+///  @param[in]		jobCount	The number of jobs to run.
+/// @ingroup recast
+void rcDispatchJobs(rcJobDispatcher* dispatcher, rcJobFunc func, void* userData, const int jobCount);
+
 /// Specifies a configuration to use when performing Recast builds.
 /// @ingroup recast
 struct rcConfig
@@ -285,8 +333,8 @@ static const int RC_SPAN_HEIGHT_BITS = 13;
 /// Defines the maximum value for rcSpan::smin and rcSpan::smax.
 static const int RC_SPAN_MAX_HEIGHT = (1 << RC_SPAN_HEIGHT_BITS) - 1;
 
-/// The number of spans allocated per span spool.
-/// @see rcSpanPool
+/// The default number of spans allocated per span spool.
+/// @see rcSpanPool, rcHeightfield::spansPerPool
 static const int RC_SPANS_PER_POOL = 2048;
 
 /// Represents a span in a heightfield.
@@ -303,8 +351,9 @@ struct rcSpan
 /// @see rcHeightfield
 struct rcSpanPool
 {
-	rcSpanPool* next;					///< The next span pool.
-	rcSpan items[RC_SPANS_PER_POOL];	///< Array of spans in the pool.
+	rcSpanPool* next;	///< The next span pool.
+	rcSpan* items;		///< Array of spans in the pool, allocated with the pool. [Size: #spanCount]
+	int spanCount;		///< The number of spans in the pool.
 };
 
 /// A dynamic heightfield representing obstructed space.
@@ -325,6 +374,7 @@ struct rcHeightfield
 	// memory pool for rcSpan instances.
 	rcSpanPool* pools;	///< Linked list of span pools.
 	rcSpan* freelist;	///< The next free span.
+	int spansPerPool;	///< The number of spans allocated when the free list runs out. (Zero for #RC_SPANS_PER_POOL.)
 
 private:
 	// Explicitly-disabled copy constructor and copy assignment operator.
@@ -332,6 +382,63 @@ private:
 	rcHeightfield& operator=(const rcHeightfield&);
 };
 
+/// Represents a span in a column heightfield.
+/// @see rcColumnHeightfield
+struct rcColumnSpan
+{
+	unsigned int smin : RC_SPAN_HEIGHT_BITS; ///< The lower limit of the span. [Limit: < #smax]
+	unsigned int smax : RC_SPAN_HEIGHT_BITS; ///< The upper limit of the span. [Limit: <= #RC_SPAN_MAX_HEIGHT]
+	unsigned int area : 6;                   ///< The area id assigned to the span.
+};
+
+/// A span rasterized into a column heightfield which is not merged into its column yet.
+/// @see rcColumnHeightfield
+struct rcColumnFragment
+{
+	int column;						///< The index of the column. (x + z * width)
+	unsigned short smin;			///< The lower limit of the span.
+	unsigned short smax;			///< The upper limit of the span.
+	unsigned short mergeThreshold;	///< The flag merge threshold the span was rasterized with.
+	unsigned char area;				///< The area id of the span.
+};
+
+/// A heightfield storing the spans of each column next to each other.
+///
+/// Rasterizing into the heightfield only appends fragments. #rcSortColumnHeightfield then
+/// sorts them by column and merges them into the spans, the same way #rcRasterizeTriangles
+/// merges the spans of an #rcHeightfield. The spans are the same as those of an #rcHeightfield
+/// rasterized with the same triangles in the same order.
+///
+/// The spans of column (x, z) are <tt>spans[columns[x + z * width]]</tt> up to
+/// <tt>spans[columns[x + z * width + 1]]</tt>, from bottom to top. The filters and
+/// #rcBuildCompactHeightfield read them as arrays, which avoids following the span lists of
+/// an #rcHeightfield across its pools in tall worlds with many floors.
+/// @ingroup recast
+struct rcColumnHeightfield
+{
+	rcColumnHeightfield();
+	~rcColumnHeightfield();
+
+	int width;			///< The width of the heightfield. (Along the x-axis in cell units.)
+	int height;			///< The height of the heightfield. (Along the z-axis in cell units.)
+	float bmin[3];  	///< The minimum bounds in world space. [(x, y, z)]
+	float bmax[3];		///< The maximum bounds in world space. [(x, y, z)]
+	float cs;			///< The size of each cell. (On the xz-plane.)
+	float ch;			///< The height of each cell. (The minimum increment along the y-axis.)
+	int* columns;		///< The index of the first span of each column. [Size: width*height + 1]
+	rcColumnSpan* spans;	///< The spans sorted by column. [Size: #spanCapacity]
+	int spanCount;		///< The number of spans.
+	int spanCapacity;	///< The number of spans #spans has room for.
+	rcColumnFragment* fragments;	///< The fragments rasterized since the last sort. [Size: #fragmentCapacity]
+	int fragmentCount;	///< The number of fragments.
+	int fragmentCapacity;	///< The number of fragments #fragments has room for.
+
+private:
+	// Explicitly-disabled copy constructor and copy assignment operator.
+	rcColumnHeightfield(const rcColumnHeightfield&);
+	rcColumnHeightfield& operator=(const rcColumnHeightfield&);
+};
+
 /// Provides information on the content of a cell column in a compact heightfield. 
 struct rcCompactCell
 {
@@ -358,6 +465,7 @@ struct rcCompactHeightfield
 	int width;					///< The width of the heightfield. (Along the x-axis in cell units.)
 	int height;					///< The height of the heightfield. (Along the z-axis in cell units.)
 	int spanCount;				///< The number of spans in the heightfield.
+	int spanCapacity;			///< The number of spans #spans and #areas have room for.
 	int walkableHeight;			///< The walkable height used during the build of the field.  (See: rcConfig::walkableHeight)
 	int walkableClimb;			///< The walkable climb used during the build of the field. (See: rcConfig::walkableClimb)
 	int borderSize;				///< The AABB border size used during the build of the field. (See: rcConfig::borderSize)
@@ -368,9 +476,9 @@ struct rcCompactHeightfield
 	float cs;					///< The size of each cell. (On the xz-plane.)
 	float ch;					///< The height of each cell. (The minimum increment along the y-axis.)
 	rcCompactCell* cells;		///< Array of cells. [Size: #width*#height]
-	rcCompactSpan* spans;		///< Array of spans. [Size: #spanCount]
+	rcCompactSpan* spans;		///< Array of spans. [Size: #spanCapacity]
 	unsigned short* dist;		///< Array containing border distance data. [Size: #spanCount]
-	unsigned char* areas;		///< Array containing area id data. [Size: #spanCount]
+	unsigned char* areas;		///< Array containing area id data. [Size: #spanCapacity]
 	
 private:
 	// Explicitly-disabled copy constructor and copy assignment operator.
@@ -434,8 +542,9 @@ struct rcContourSet
 	rcContourSet();
 	~rcContourSet();
 	
-	rcContour* conts;	///< An array of the contours in the set. [Size: #nconts]
+	rcContour* conts;	///< An array of the contours in the set. [Size: #maxconts]
 	int nconts;			///< The number of contours in the set.
+	int maxconts;		///< The number of allocated contours.
 	float bmin[3];  	///< The minimum bounds in world space. [(x, y, z)]
 	float bmax[3];		///< The maximum bounds in world space. [(x, y, z)]
 	float cs;			///< The size of each cell. (On the xz-plane.)
@@ -458,14 +567,18 @@ struct rcPolyMesh
 	rcPolyMesh();
 	~rcPolyMesh();
 	
-	unsigned short* verts;	///< The mesh vertices. [Form: (x, y, z) * #nverts]
+	unsigned short* verts;	///< The mesh vertices. [Form: (x, y, z) * #maxverts]
 	unsigned short* polys;	///< Polygon and neighbor data. [Length: #maxpolys * 2 * #nvp]
 	unsigned short* regs;	///< The region id assigned to each polygon. [Length: #maxpolys]
 	unsigned short* flags;	///< The user defined flags for each polygon. [Length: #maxpolys]
 	unsigned char* areas;	///< The area id assigned to each polygon. [Length: #maxpolys]
+	/// The clearance of each polygon edge, in the units of the distance field, or null if not built.
+	/// (See: #rcBuildPolyMeshEdgeClearance) [Length: #maxpolys * #nvp]
+	unsigned short* edgeClearance;
 	int nverts;				///< The number of vertices.
 	int npolys;				///< The number of polygons.
 	int maxpolys;			///< The number of allocated polygons.
+	int maxverts;			///< The number of allocated vertices.
 	int nvp;				///< The maximum number of vertices per polygon.
 	float bmin[3];			///< The minimum bounds in world space. [(x, y, z)]
 	float bmax[3];			///< The maximum bounds in world space. [(x, y, z)]
@@ -487,12 +600,15 @@ struct rcPolyMeshDetail
 {
 	rcPolyMeshDetail();
 	
-	unsigned int* meshes;	///< The sub-mesh data. [Size: 4*#nmeshes] 
-	float* verts;			///< The mesh vertices. [Size: 3*#nverts] 
-	unsigned char* tris;	///< The mesh triangles. [Size: 4*#ntris] 
+	unsigned int* meshes;	///< The sub-mesh data. [Size: 4*#maxmeshes] 
+	float* verts;			///< The mesh vertices. [Size: 3*#maxverts] 
+	unsigned char* tris;	///< The mesh triangles. [Size: 4*#maxtris] 
 	int nmeshes;			///< The number of sub-meshes defined by #meshes.
 	int nverts;				///< The number of vertices in #verts.
 	int ntris;				///< The number of triangles in #tris.
+	int maxmeshes;			///< The number of allocated sub-meshes.
+	int maxverts;			///< The number of allocated vertices.
+	int maxtris;			///< The number of allocated triangles.
 	
 private:
 	// Explicitly-disabled copy constructor and copy assignment operator.
@@ -517,6 +633,18 @@ rcHeightfield* rcAllocHeightfield();
 /// @see rcAllocHeightfield
 void rcFreeHeightField(rcHeightfield* heightfield);
 
+/// Allocates a column heightfield object using the Recast allocator.
+/// @return A column heightfield that is ready for initialization, or null on failure.
+/// @ingroup recast
+/// @see rcCreateColumnHeightfield, rcFreeColumnHeightfield
+rcColumnHeightfield* rcAllocColumnHeightfield();
+
+/// Frees the specified column heightfield object using the Recast allocator.
+/// @param[in]		heightfield	A column heightfield allocated using #rcAllocColumnHeightfield
+/// @ingroup recast
+/// @see rcAllocColumnHeightfield
+void rcFreeColumnHeightfield(rcColumnHeightfield* heightfield);
+
 /// Allocates a compact heightfield object using the Recast allocator.
 /// @return A compact heightfield that is ready for initialization, or null on failure.
 /// @ingroup recast
@@ -851,6 +979,89 @@ bool rcCreateHeightfield(rcContext* context, rcHeightfield& heightfield, int siz
 						 const float* minBounds, const float* maxBounds,
 						 float cellSize, float cellHeight);
 
+/// Clears a heightfield for a new build, keeping its memory.
+///
+/// All spans go back to the free list of the span pools, and the column array is kept
+/// when the number of columns does not change. Rasterizing a tile of the same size as
+/// the previous one then does not allocate until it needs more spans than before.
+/// On a heightfield that was never created this is the same as #rcCreateHeightfield.
+///
+/// @see rcCreateHeightfield, rcReserveHeightfieldSpans
+/// @ingroup recast
+/// 
+/// @param[in,out]	context		The build context to use during the operation.
+/// @param[in,out]	heightfield	The heightfield to reset.
+/// @param[in]		sizeX		The width of the field along the x-axis. [Limit: >= 0] [Units: vx]
+/// @param[in]		sizeZ		The height of the field along the z-axis. [Limit: >= 0] [Units: vx]
+/// @param[in]		minBounds	The minimum bounds of the field's AABB. [(x, y, z)] [Units: wu]
+/// @param[in]		maxBounds	The maximum bounds of the field's AABB. [(x, y, z)] [Units: wu]
+/// @param[in]		cellSize	The xz-plane cell size to use for the field. [Limit: > 0] [Units: wu]
+/// @param[in]		cellHeight	The y-axis cell size to use for field. [Limit: > 0] [Units: wu]
+/// @returns True if the operation completed successfully.
+bool rcResetHeightfield(rcContext* context, rcHeightfield& heightfield, int sizeX, int sizeZ,
+						const float* minBounds, const float* maxBounds,
+						float cellSize, float cellHeight);
+
+/// Makes sure the heightfield can hold the specified number of spans without further allocations.
+///
+/// The missing spans are allocated as one contiguous pool. Call it before rasterizing
+/// with an estimate of the span count, e.g. the span count of a previous build.
+/// Rasterization needs one spare span while a new span is merged into a column.
+///
+/// @see rcHeightfield, rcDefragmentHeightfield
+/// @ingroup recast
+/// @param[in,out]	context		The build context to use during the operation.
+/// @param[in,out]	heightfield	The heightfield to reserve the spans for.
+/// @param[in]		spanCount	The number of free spans needed. [Limit: >= 0]
+/// @returns True if the operation completed successfully.
+bool rcReserveHeightfieldSpans(rcContext* context, rcHeightfield& heightfield, int spanCount);
+
+/// Moves the spans of the heightfield into one contiguous pool, column by column.
+///
+/// The spans of each column are stored next to each other and the columns are
+/// stored in the order the filters and #rcBuildCompactHeightfield visit them.
+/// The previous pools and the free list are released.
+///
+/// @see rcHeightfield, rcReserveHeightfieldSpans
+/// @ingroup recast
+/// @param[in,out]	context		The build context to use during the operation.
+/// @param[in,out]	heightfield	The heightfield to defragment.
+/// @returns True if the operation completed successfully. The heightfield is unchanged on failure.
+bool rcDefragmentHeightfield(rcContext* context, rcHeightfield& heightfield);
+
+/// Initializes a column heightfield, or clears it for a new build.
+///
+/// The arrays of a previous build are kept, so that rasterizing a tile of the same size
+/// as the previous one does not allocate until it needs more spans than before.
+///
+/// @see rcAllocColumnHeightfield, rcColumnHeightfield
+/// @ingroup recast
+/// @param[in,out]	context		The build context to use during the operation.
+/// @param[in,out]	heightfield	The allocated heightfield to initialize.
+/// @param[in]		sizeX		The width of the field along the x-axis. [Limit: >= 0] [Units: vx]
+/// @param[in]		sizeZ		The height of the field along the z-axis. [Limit: >= 0] [Units: vx]
+/// @param[in]		minBounds	The minimum bounds of the field's AABB. [(x, y, z)] [Units: wu]
+/// @param[in]		maxBounds	The maximum bounds of the field's AABB. [(x, y, z)] [Units: wu]
+/// @param[in]		cellSize	The xz-plane cell size to use for the field. [Limit: > 0] [Units: wu]
+/// @param[in]		cellHeight	The y-axis cell size to use for field. [Limit: > 0] [Units: wu]
+/// @returns True if the operation completed successfully.
+bool rcCreateColumnHeightfield(rcContext* context, rcColumnHeightfield& heightfield, int sizeX, int sizeZ,
+							   const float* minBounds, const float* maxBounds,
+							   float cellSize, float cellHeight);
+
+/// Merges the fragments rasterized into a column heightfield into its spans.
+///
+/// The fragments are sorted by column, keeping the order they were rasterized in, and each
+/// column is merged on its own. Call it after the last rasterization call, before the filters.
+/// More triangles can be rasterized afterwards, they are merged by the next call.
+///
+/// @see rcColumnHeightfield
+/// @ingroup recast
+/// @param[in,out]	context		The build context to use during the operation.
+/// @param[in,out]	heightfield	The heightfield to sort.
+/// @returns True if the operation completed successfully.
+bool rcSortColumnHeightfield(rcContext* context, rcColumnHeightfield& heightfield);
+
 /// Sets the area id of all triangles with a slope below the specified value
 /// to #RC_WALKABLE_AREA.
 ///
@@ -859,6 +1070,14 @@ bool rcCreateHeightfield(rcContext* context, rcHeightfield& heightfield, int siz
 /// 
 /// See the #rcConfig documentation for more information on the configuration parameters.
 /// 
+/// Uses SSE2 or NEON to classify four triangles at a time when available, unless RC_NO_SIMD
+/// is defined, with the same results. If a dispatcher is given, large meshes are classified
+/// concurrently in ranges of triangles.
+///
+/// Tiled builds can classify all triangles of the input once, in the order of
+/// rcTriMeshIndex::tris, and rasterize each chunk with its range of the area ids
+/// instead of classifying the chunks again for every tile that overlaps them.
+/// 
 /// @see rcHeightfield, rcClearUnwalkableTriangles, rcRasterizeTriangles
 /// 
 /// @ingroup recast
@@ -870,8 +1089,10 @@ bool rcCreateHeightfield(rcContext* context, rcHeightfield& heightfield, int siz
 /// @param[in]		tris				The triangle vertex indices. [(vertA, vertB, vertC) * @p nt]
 /// @param[in]		numTris				The number of triangles.
 /// @param[out]		triAreaIDs			The triangle area ids. [Length: >= @p nt]
+/// @param[in]		dispatcher			The job dispatcher. If null, the triangles are classified serially.
 void rcMarkWalkableTriangles(rcContext* context, float walkableSlopeAngle, const float* verts, int numVerts,
-							 const int* tris, int numTris, unsigned char* triAreaIDs); 
+							 const int* tris, int numTris, unsigned char* triAreaIDs,
+							 rcJobDispatcher* dispatcher = 0); 
 
 /// Sets the area id of all triangles with a slope greater than or equal to the specified value to #RC_NULL_AREA.
 /// 
@@ -879,6 +1100,7 @@ void rcMarkWalkableTriangles(rcContext* context, float walkableSlopeAngle, const
 /// area id's for walkable triangles.
 /// 
 /// See the #rcConfig documentation for more information on the configuration parameters.
+/// Classifies the triangles the same way as #rcMarkWalkableTriangles.
 /// 
 /// @see rcHeightfield, rcClearUnwalkableTriangles, rcRasterizeTriangles
 /// 
@@ -891,8 +1113,30 @@ void rcMarkWalkableTriangles(rcContext* context, float walkableSlopeAngle, const
 /// @param[in]		tris				The triangle vertex indices. [(vertA, vertB, vertC) * @p nt]
 /// @param[in]		numTris				The number of triangles.
 /// @param[out]		triAreaIDs			The triangle area ids. [Length: >= @p nt]
+/// @param[in]		dispatcher			The job dispatcher. If null, the triangles are classified serially.
 void rcClearUnwalkableTriangles(rcContext* context, float walkableSlopeAngle, const float* verts, int numVerts,
-								const int* tris, int numTris, unsigned char* triAreaIDs); 
+								const int* tris, int numTris, unsigned char* triAreaIDs,
+								rcJobDispatcher* dispatcher = 0); 
+
+/// Sets the area id of all heightmap cells with a slope below the specified value to #RC_WALKABLE_AREA.
+///
+/// A cell is walkable if both of its triangles are, split along the diagonal from sample (x, z)
+/// to sample (x + 1, z + 1). Does not alter the area id's of the other cells.
+///
+/// @see rcRasterizeHeightmap, rcMarkWalkableTriangles
+///
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		walkableSlopeAngle	The maximum slope that is considered walkable.
+/// 									[Limits: 0 <= value < 90] [Units: Degrees]
+/// @param[in]		heights				The heights of the samples. [Size: @p sampleWidth * @p sampleHeight] [Units: wu]
+/// @param[in]		sampleWidth			The number of samples along the x-axis. [Limit: >= 2]
+/// @param[in]		sampleHeight		The number of samples along the z-axis. [Limit: >= 2]
+/// @param[in]		cellSize			The distance between the samples. [Units: wu]
+/// @param[out]		cellAreaIDs			The area id's of the cells. [Size: (@p sampleWidth - 1) * (@p sampleHeight - 1)]
+void rcMarkWalkableHeightmapCells(rcContext* context, float walkableSlopeAngle,
+                                  const float* heights, int sampleWidth, int sampleHeight,
+                                  float cellSize, unsigned char* cellAreaIDs);
 
 /// Adds a span to the specified heightfield.
 /// 
@@ -917,6 +1161,23 @@ bool rcAddSpan(rcContext* context, rcHeightfield& heightfield,
                unsigned short spanMin, unsigned short spanMax,
                unsigned char areaID, int flagMergeThreshold);
 
+/// Enables or disables the SIMD triangle rasterizer.
+///
+/// The SIMD rasterizer is used by default when Recast is compiled for SSE2 or AArch64,
+/// unless RC_NO_SIMD is defined. It produces the same spans as the scalar rasterizer,
+/// provided the compiler does not contract multiplies and adds into fused operations.
+///
+/// @see rcRasterizeTriangles
+/// @ingroup recast
+/// @param[in]		enabled		True to use the SIMD rasterizer.
+/// @returns False if the SIMD rasterizer is not available.
+bool rcSetSimdRasterization(bool enabled);
+
+/// Returns true if the SIMD triangle rasterizer is used.
+/// @see rcSetSimdRasterization
+/// @ingroup recast
+bool rcGetSimdRasterization();
+
 /// Rasterizes a single triangle into the specified heightfield.
 ///
 /// Calling this for each triangle in a mesh is less efficient than calling rcRasterizeTriangles
@@ -1000,6 +1261,192 @@ bool rcRasterizeTriangles(rcContext* context,
                           const float* verts, const unsigned char* triAreaIDs, int numTris,
                           rcHeightfield& heightfield, int flagMergeThreshold = 1);
 
+/// Rasterizes an indexed triangle mesh into the fragments of a column heightfield.
+///
+/// Same as #rcRasterizeTriangles for an #rcHeightfield. The spans are merged by #rcSortColumnHeightfield.
+///
+/// @see rcColumnHeightfield
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		verts				The vertices. [(x, y, z) * @p nv]
+/// @param[in]		numVerts			The number of vertices. (unused)
+/// @param[in]		tris				The triangle indices. [(vertA, vertB, vertC) * @p nt]
+/// @param[in]		triAreaIDs			The area id's of the triangles. [Limit: <= #RC_WALKABLE_AREA] [Size: @p nt]
+/// @param[in]		numTris				The number of triangles.
+/// @param[in,out]	heightfield			An initialized column heightfield.
+/// @param[in]		flagMergeThreshold	The distance where the walkable flag is favored over the non-walkable flag. 
+///										[Limit: >= 0] [Units: vx]
+/// @returns True if the operation completed successfully.
+bool rcRasterizeTriangles(rcContext* context,
+                          const float* verts, int numVerts,
+                          const int* tris, const unsigned char* triAreaIDs, int numTris,
+                          rcColumnHeightfield& heightfield, int flagMergeThreshold = 1);
+
+/// Rasterizes an indexed triangle mesh into the fragments of a column heightfield.
+///
+/// Same as #rcRasterizeTriangles for an #rcHeightfield. The spans are merged by #rcSortColumnHeightfield.
+///
+/// @see rcColumnHeightfield
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		verts				The vertices. [(x, y, z) * @p nv]
+/// @param[in]		numVerts			The number of vertices. (unused)
+/// @param[in]		tris				The triangle indices. [(vertA, vertB, vertC) * @p nt]
+/// @param[in]		triAreaIDs			The area id's of the triangles. [Limit: <= #RC_WALKABLE_AREA] [Size: @p nt]
+/// @param[in]		numTris				The number of triangles.
+/// @param[in,out]	heightfield			An initialized column heightfield.
+/// @param[in]		flagMergeThreshold	The distance where the walkable flag is favored over the non-walkable flag. 
+///										[Limit: >= 0] [Units: vx]
+/// @returns True if the operation completed successfully.
+bool rcRasterizeTriangles(rcContext* context,
+                          const float* verts, int numVerts,
+                          const unsigned short* tris, const unsigned char* triAreaIDs, int numTris,
+                          rcColumnHeightfield& heightfield, int flagMergeThreshold = 1);
+
+/// Rasterizes a triangle list into the fragments of a column heightfield.
+///
+/// Same as #rcRasterizeTriangles for an #rcHeightfield. The spans are merged by #rcSortColumnHeightfield.
+///
+/// @see rcColumnHeightfield
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		verts				The triangle vertices. [(ax, ay, az, bx, by, bz, cx, by, cx) * @p nt]
+/// @param[in]		triAreaIDs			The area id's of the triangles. [Limit: <= #RC_WALKABLE_AREA] [Size: @p nt]
+/// @param[in]		numTris				The number of triangles.
+/// @param[in,out]	heightfield			An initialized column heightfield.
+/// @param[in]		flagMergeThreshold	The distance where the walkable flag is favored over the non-walkable flag. 
+/// 									[Limit: >= 0] [Units: vx]
+/// @returns True if the operation completed successfully.
+bool rcRasterizeTriangles(rcContext* context,
+                          const float* verts, const unsigned char* triAreaIDs, int numTris,
+                          rcColumnHeightfield& heightfield, int flagMergeThreshold = 1);
+
+/// Rasterizes a heightmap terrain into the specified heightfield, without splitting it into triangles.
+///
+/// The heightmap samples lie on the cell corners of the heightfield grid. Sample (i, j) is at the corner
+/// (@p sampleX + i, @p sampleZ + j), so that a heightmap of the whole world can be rasterized into the
+/// heightfield of each tile. Each cell between four samples adds the same span as rasterizing the
+/// two triangles of the cell would. Meshes can be rasterized on top of the terrain as usual.
+///
+/// Spans will only be added for the cells that overlap the heightfield grid.
+///
+/// @see rcHeightfield, rcMarkWalkableHeightmapCells
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		heights				The heights of the samples. [Size: @p sampleWidth * @p sampleHeight] [Units: wu]
+/// @param[in]		cellAreaIDs			The area id's of the cells between the samples, or null if all cells are
+/// 									#RC_WALKABLE_AREA. [Limit: <= #RC_WALKABLE_AREA] [Size: (@p sampleWidth - 1) * (@p sampleHeight - 1)]
+/// @param[in]		holes				Non-zero for the cells without terrain, or null if there are no holes.
+/// 									[Size: (@p sampleWidth - 1) * (@p sampleHeight - 1)]
+/// @param[in]		sampleWidth			The number of samples along the x-axis. [Limit: >= 2]
+/// @param[in]		sampleHeight		The number of samples along the z-axis. [Limit: >= 2]
+/// @param[in]		sampleX				The corner of the heightfield grid of the first sample along the x-axis.
+/// @param[in]		sampleZ				The corner of the heightfield grid of the first sample along the z-axis.
+/// @param[in,out]	heightfield			An initialized heightfield.
+/// @param[in]		flagMergeThreshold	The distance where the walkable flag is favored over the non-walkable flag.
+/// 									[Limit: >= 0] [Units: vx]
+/// @returns True if the operation completed successfully.
+bool rcRasterizeHeightmap(rcContext* context,
+                          const float* heights, const unsigned char* cellAreaIDs, const unsigned char* holes,
+                          int sampleWidth, int sampleHeight, int sampleX, int sampleZ,
+                          rcHeightfield& heightfield, int flagMergeThreshold = 1);
+
+/// The triangles rasterized by an #rcRasterizationBackend.
+/// @see rcRasterizationBackend
+struct rcTriangleBuffers
+{
+	const float* verts;					///< The vertices. [(x, y, z) * #numVerts]
+	int numVerts;						///< The number of vertices.
+	const int* tris;					///< The triangle indices, or null if #verts is a triangle list. [(vertA, vertB, vertC) * #numTris]
+	const unsigned char* triAreaIDs;	///< The area id's of the triangles. [Limit: <= #RC_WALKABLE_AREA] [Size: #numTris]
+	int numTris;						///< The number of triangles.
+};
+
+/// Provides an interface for rasterizing triangles into a heightfield,
+/// e.g. with a compute API on the GPU.
+///
+/// A backend must produce the same spans as #rcRasterizeTriangles, using the grid of the
+/// heightfield and #rcConfig::walkableClimb as the flag merge threshold. The spans are added
+/// to the spans already in the heightfield.
+///
+/// The default implementation is the CPU rasterizer, which is the reference for
+/// other backends. (See: #rcValidatingRasterizationBackend)
+///
+/// @ingroup recast
+class rcRasterizationBackend
+{
+public:
+	virtual ~rcRasterizationBackend() {}
+
+	/// Rasterizes the triangles into the heightfield.
+	///  @param[in,out]	context		The build context to use during the operation.
+	///  @param[in]		config		The build configuration.
+	///  @param[in]		triangles	The triangles to rasterize.
+	///  @param[in,out]	heightfield	An initialized heightfield.
+	///  @returns True if the operation completed successfully.
+	virtual bool rasterize(rcContext* context, const rcConfig& config, const rcTriangleBuffers& triangles,
+						   rcHeightfield& heightfield);
+};
+
+/// Runs a rasterization backend, and compares its heightfield with the one of the
+/// CPU rasterizer.
+///
+/// The heightfield keeps the spans of the validated backend. The columns that differ
+/// are logged as warnings, and counted. Validation rasterizes every triangle twice, and
+/// is meant for testing a backend, not for production builds.
+///
+/// The mismatch count is not synchronized, use one instance per worker when rasterizing
+/// concurrently.
+///
+/// @ingroup recast
+class rcValidatingRasterizationBackend : public rcRasterizationBackend
+{
+public:
+	/// Constructs an instance validating the backend.
+	///  @param[in]		backend		The backend to validate.
+	explicit rcValidatingRasterizationBackend(rcRasterizationBackend* backend) : m_backend(backend), m_mismatchCount(0) {}
+
+	virtual bool rasterize(rcContext* context, const rcConfig& config, const rcTriangleBuffers& triangles,
+						   rcHeightfield& heightfield);
+
+	/// Returns the number of columns that differed from the CPU rasterizer, over all calls.
+	inline int getMismatchCount() const { return m_mismatchCount; }
+
+	/// Sets the mismatch count back to zero.
+	inline void resetMismatchCount() { m_mismatchCount = 0; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcValidatingRasterizationBackend(const rcValidatingRasterizationBackend&);
+	rcValidatingRasterizationBackend& operator=(const rcValidatingRasterizationBackend&);
+
+	rcRasterizationBackend* m_backend;
+	int m_mismatchCount;
+};
+
+/// Copies the spans and the grid of a heightfield.
+///
+/// The spans of the destination are replaced, its span pools are reused.
+///
+/// @see rcHeightfield, rcCompareHeightfields
+/// @ingroup recast
+/// @param[in,out]	context		The build context to use during the operation.
+/// @param[in]		src			The heightfield to copy.
+/// @param[in,out]	dst			The heightfield receiving the copy.
+/// @returns True if the operation completed successfully.
+bool rcCopyHeightfield(rcContext* context, const rcHeightfield& src, rcHeightfield& dst);
+
+/// Compares the spans of two heightfields of the same size column by column.
+///
+/// @see rcHeightfield, rcValidatingRasterizationBackend
+/// @ingroup recast
+/// @param[in,out]	context			The build context to use during the operation.
+/// @param[in]		a				The first heightfield.
+/// @param[in]		b				The second heightfield.
+/// @param[in]		maxLoggedColumns	The number of differing columns logged as warnings. [Limit: >= 0]
+/// @returns The number of columns whose spans differ, or -1 if the sizes of the heightfields differ.
+int rcCompareHeightfields(rcContext* context, const rcHeightfield& a, const rcHeightfield& b, int maxLoggedColumns);
+
 /// Marks non-walkable spans as walkable if their maximum is within @p walkableClimb of the span below them.
 ///
 /// This removes small obstacles and rasterization artifacts that the agent would be able to walk over
@@ -1054,6 +1501,35 @@ void rcFilterLedgeSpans(rcContext* context, int walkableHeight, int walkableClim
 /// @param[in,out]	heightfield		A fully built heightfield.  (All spans have been added.)
 void rcFilterWalkableLowHeightSpans(rcContext* context, int walkableHeight, rcHeightfield& heightfield);
 
+/// Same as #rcFilterLowHangingWalkableObstacles for a column heightfield.
+/// @see rcColumnHeightfield, rcSortColumnHeightfield
+/// @ingroup recast
+/// @param[in,out]	context			The build context to use during the operation.
+/// @param[in]		walkableClimb	Maximum ledge height that is considered to still be traversable. 
+/// 								[Limit: >=0] [Units: vx]
+/// @param[in,out]	heightfield		A sorted column heightfield. (See: #rcSortColumnHeightfield)
+void rcFilterLowHangingWalkableObstacles(rcContext* context, int walkableClimb, rcColumnHeightfield& heightfield);
+
+/// Same as #rcFilterLedgeSpans for a column heightfield.
+/// @see rcColumnHeightfield, rcSortColumnHeightfield
+/// @ingroup recast
+/// @param[in,out]	context			The build context to use during the operation.
+/// @param[in]		walkableHeight	Minimum floor to 'ceiling' height that will still allow the floor area to 
+/// 								be considered walkable. [Limit: >= 3] [Units: vx]
+/// @param[in]		walkableClimb	Maximum ledge height that is considered to still be traversable. 
+/// 								[Limit: >=0] [Units: vx]
+/// @param[in,out]	heightfield		A sorted column heightfield. (See: #rcSortColumnHeightfield)
+void rcFilterLedgeSpans(rcContext* context, int walkableHeight, int walkableClimb, rcColumnHeightfield& heightfield);
+
+/// Same as #rcFilterWalkableLowHeightSpans for a column heightfield.
+/// @see rcColumnHeightfield, rcSortColumnHeightfield
+/// @ingroup recast
+/// @param[in,out]	context			The build context to use during the operation.
+/// @param[in]		walkableHeight	Minimum floor to 'ceiling' height that will still allow the floor area to 
+/// 								be considered walkable. [Limit: >= 3] [Units: vx]
+/// @param[in,out]	heightfield		A sorted column heightfield. (See: #rcSortColumnHeightfield)
+void rcFilterWalkableLowHeightSpans(rcContext* context, int walkableHeight, rcColumnHeightfield& heightfield);
+
 /// Returns the number of spans contained in the specified heightfield.
 ///  @ingroup recast
 ///  @param[in,out]	context		The build context to use during the operation.
@@ -1066,6 +1542,14 @@ int rcGetHeightFieldSpanCount(rcContext* context, const rcHeightfield& heightfie
 /// @see rcCompactHeightfield
 /// @{
 
+/// The span filters applied by #rcBuildFilteredCompactHeightfield.
+enum rcSpanFilterFlags
+{
+	RC_FILTER_LOW_HANGING_OBSTACLES = 0x01,	///< Same as #rcFilterLowHangingWalkableObstacles
+	RC_FILTER_LEDGE_SPANS = 0x02,			///< Same as #rcFilterLedgeSpans
+	RC_FILTER_WALKABLE_LOW_HEIGHT = 0x04	///< Same as #rcFilterWalkableLowHeightSpans
+};
+
 /// Builds a compact heightfield representing open space, from a heightfield representing solid space.
 ///
 /// This is just the beginning of the process of fully building a compact heightfield.
@@ -1084,10 +1568,75 @@ int rcGetHeightFieldSpanCount(rcContext* context, const rcHeightfield& heightfie
 /// 									[Limit: >=0] [Units: vx]
 /// @param[in]		heightfield			The heightfield to be compacted.
 /// @param[out]		compactHeightfield	The resulting compact heightfield. (Must be pre-allocated.)
+/// 									The arrays of a previous build are reused when they are large enough.
 /// @returns True if the operation completed successfully.
 bool rcBuildCompactHeightfield(rcContext* context, int walkableHeight, int walkableClimb,
 							   const rcHeightfield& heightfield, rcCompactHeightfield& compactHeightfield);
 
+/// Applies span filters to a heightfield and builds a compact heightfield from it.
+///
+/// The result is the same as calling #rcFilterLowHangingWalkableObstacles, #rcFilterLedgeSpans and
+/// #rcFilterWalkableLowHeightSpans in that order, followed by #rcBuildCompactHeightfield. The filters
+/// are applied column by column in a single sweep over the heightfield, instead of one sweep each.
+///
+/// @see rcBuildCompactHeightfield, rcSpanFilterFlags
+/// @ingroup recast
+///
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		filterFlags			The filters to apply. (See: #rcSpanFilterFlags)
+/// @param[in]		walkableHeight		Minimum floor to 'ceiling' height that will still allow the floor area 
+/// 									to be considered walkable. [Limit: >= 3] [Units: vx]
+/// @param[in]		walkableClimb		Maximum ledge height that is considered to still be traversable. 
+/// 									[Limit: >=0] [Units: vx]
+/// @param[in,out]	heightfield			The heightfield to be filtered and compacted.
+/// @param[out]		compactHeightfield	The resulting compact heightfield. (Must be pre-allocated.)
+/// 									The arrays of a previous build are reused when they are large enough.
+/// @returns True if the operation completed successfully.
+bool rcBuildFilteredCompactHeightfield(rcContext* context, int filterFlags, int walkableHeight, int walkableClimb,
+									   rcHeightfield& heightfield, rcCompactHeightfield& compactHeightfield);
+
+/// Same as #rcBuildCompactHeightfield for a column heightfield.
+///
+/// @see rcColumnHeightfield, rcSortColumnHeightfield
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		walkableHeight		Minimum floor to 'ceiling' height that will still allow the floor area 
+/// 									to be considered walkable. [Limit: >= 3] [Units: vx]
+/// @param[in]		walkableClimb		Maximum ledge height that is considered to still be traversable. 
+/// 									[Limit: >=0] [Units: vx]
+/// @param[in]		heightfield			The sorted column heightfield to be compacted. (See: #rcSortColumnHeightfield)
+/// @param[out]		compactHeightfield	The resulting compact heightfield. (Must be pre-allocated.)
+/// 									The arrays of a previous build are reused when they are large enough.
+/// @returns True if the operation completed successfully.
+bool rcBuildCompactHeightfield(rcContext* context, int walkableHeight, int walkableClimb,
+							   const rcColumnHeightfield& heightfield, rcCompactHeightfield& compactHeightfield);
+
+/// Same as #rcBuildFilteredCompactHeightfield for a column heightfield.
+///
+/// @see rcColumnHeightfield, rcSortColumnHeightfield, rcSpanFilterFlags
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		filterFlags			The filters to apply. (See: #rcSpanFilterFlags)
+/// @param[in]		walkableHeight		Minimum floor to 'ceiling' height that will still allow the floor area 
+/// 									to be considered walkable. [Limit: >= 3] [Units: vx]
+/// @param[in]		walkableClimb		Maximum ledge height that is considered to still be traversable. 
+/// 									[Limit: >=0] [Units: vx]
+/// @param[in,out]	heightfield			The sorted column heightfield to be filtered and compacted.
+/// @param[out]		compactHeightfield	The resulting compact heightfield. (Must be pre-allocated.)
+/// 									The arrays of a previous build are reused when they are large enough.
+/// @returns True if the operation completed successfully.
+bool rcBuildFilteredCompactHeightfield(rcContext* context, int filterFlags, int walkableHeight, int walkableClimb,
+									   rcColumnHeightfield& heightfield, rcCompactHeightfield& compactHeightfield);
+
+/// Copies the compact heightfield data from src to dst.
+/// @ingroup recast
+/// @param[in,out]	context		The build context to use during the operation.
+/// @param[in]		src			The source heightfield to copy from.
+/// @param[out]		dst			The resulting compact heightfield. (Must be pre-allocated.)
+/// 							The arrays of a previous build are reused when they are large enough.
+/// @returns True if the operation completed successfully.
+bool rcCopyCompactHeightfield(rcContext* context, const rcCompactHeightfield& src, rcCompactHeightfield& dst);
+
 /// Erodes the walkable area within the heightfield by the specified radius.
 /// 
 /// Basically, any spans that are closer to a boundary or obstruction than the specified radius 
@@ -1104,6 +1653,23 @@ bool rcBuildCompactHeightfield(rcContext* context, int walkableHeight, int walka
 /// @returns True if the operation completed successfully.
 bool rcErodeWalkableArea(rcContext* context, int erosionRadius, rcCompactHeightfield& compactHeightfield);
 
+/// Enables or disables the SIMD versions of #rcErodeWalkableArea and #rcMedianFilterWalkableArea.
+///
+/// They are used by default when Recast is compiled for SSE2 or NEON, unless RC_NO_SIMD is
+/// defined, and produce the same areas as the scalar versions. They process 16 cells at a time
+/// where the cells and their neighbours have at most one span, and each span on its own elsewhere.
+///
+/// @see rcErodeWalkableArea, rcMedianFilterWalkableArea
+/// @ingroup recast
+/// @param[in]		enabled		True to use the SIMD area filters.
+/// @returns False if the SIMD area filters are not available.
+bool rcSetSimdAreaFilters(bool enabled);
+
+/// Returns true if the SIMD area filters are used.
+/// @see rcSetSimdAreaFilters
+/// @ingroup recast
+bool rcGetSimdAreaFilters();
+
 /// Applies a median filter to walkable area types (based on area id), removing noise.
 /// 
 /// This filter is usually applied after applying area id's using functions
@@ -1151,6 +1717,33 @@ void rcMarkConvexPolyArea(rcContext* context, const float* verts, int numVerts,
 						  float minY, float maxY, unsigned char areaId,
 						  rcCompactHeightfield& compactHeightfield);
 
+/// A convex polygon area to apply with #rcMarkConvexPolyAreas.
+/// @ingroup recast
+struct rcConvexVolume
+{
+	const float* verts;		///< The vertices of the polygon [For: (x, y, z) * #numVerts]
+	int numVerts;			///< The number of vertices in the polygon.
+	float minY;				///< The height of the base of the polygon. [Units: wu]
+	float maxY;				///< The height of the top of the polygon. [Units: wu]
+	unsigned char areaId;	///< The area id to apply. [Limit: <= #RC_WALKABLE_AREA]
+};
+
+/// Applies the area ids of many convex polygons in one sweep over the rows of the heightfield.
+///
+/// The result is the same as calling #rcMarkConvexPolyArea for each volume in order,
+/// so where volumes overlap, the later volume wins.
+///
+/// @see rcCompactHeightfield, rcMarkConvexPolyArea, rcMedianFilterWalkableArea
+/// @ingroup recast
+///
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		volumes				The volumes to apply. [Size: @p numVolumes]
+/// @param[in]		numVolumes			The number of volumes.
+/// @param[in,out]	compactHeightfield	A populated compact heightfield.
+/// @returns True if the operation completed successfully.
+bool rcMarkConvexPolyAreas(rcContext* context, const rcConvexVolume* volumes, int numVolumes,
+						   rcCompactHeightfield& compactHeightfield);
+
 /// Expands a convex polygon along its vertex normals by the given offset amount.
 /// Inserts extra vertices to bevel sharp corners.
 ///
@@ -1188,6 +1781,18 @@ void rcMarkCylinderArea(rcContext* context, const float* position, float radius,
 /// @returns True if the operation completed successfully.
 bool rcBuildDistanceField(rcContext* ctx, rcCompactHeightfield& chf);
 
+/// Builds the distance field for the specified compact heightfield, splitting the
+/// independent passes over the rows into jobs.
+///
+/// The result is identical to the serial version.
+///
+/// @ingroup recast
+/// @param[in,out]	ctx			The build context to use during the operation.
+/// @param[in,out]	chf			A populated compact heightfield.
+/// @param[in]		dispatcher	The job dispatcher. If null, the distance field is built serially.
+/// @returns True if the operation completed successfully.
+bool rcBuildDistanceField(rcContext* ctx, rcCompactHeightfield& chf, rcJobDispatcher* dispatcher);
+
 /// Builds region data for the heightfield using watershed partitioning.
 /// @ingroup recast
 /// @param[in,out]	ctx				The build context to use during the operation.
@@ -1201,6 +1806,28 @@ bool rcBuildDistanceField(rcContext* ctx, rcCompactHeightfield& chf);
 /// @returns True if the operation completed successfully.
 bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf, int borderSize, int minRegionArea, int mergeRegionArea);
 
+/// Builds region data for the heightfield using watershed partitioning, splitting the
+/// watershed into jobs.
+///
+/// Heightfields of up to 127 rows are flooded as a whole, splitting the sorting of the cells
+/// by level and the region expansion passes into jobs, with the same result as the serial
+/// version. Larger heightfields are flooded in bands of 64 or more rows by separate jobs, and
+/// the regions split by the band borders are merged again before the small regions are
+/// filtered. Their regions may differ from the serial version, but only depend on the size
+/// of the heightfield, not on the dispatcher or the number of workers.
+///
+/// @ingroup recast
+/// @param[in,out]	ctx				The build context to use during the operation.
+/// @param[in,out]	chf				A populated compact heightfield.
+/// @param[in]		borderSize		The size of the non-navigable border around the heightfield. [Limit: >=0] [Units: vx]
+/// @param[in]		minRegionArea	The minimum number of cells allowed to form isolated island areas. [Limit: >=0] [Units: vx]
+/// @param[in]		mergeRegionArea	Any regions with a span count smaller than this value will, if possible,
+/// 								be merged with larger regions. [Limit: >=0] [Units: vx]
+/// @param[in]		dispatcher		The job dispatcher. If null, the regions are built serially.
+/// @returns True if the operation completed successfully.
+bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf, int borderSize, int minRegionArea, int mergeRegionArea,
+					rcJobDispatcher* dispatcher);
+
 /// Builds region data for the heightfield by partitioning the heightfield in non-overlapping layers.
 /// @ingroup recast
 /// @param[in,out]	ctx				The build context to use during the operation.
@@ -1212,6 +1839,22 @@ bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf, int borderSize, i
 /// @returns True if the operation completed successfully.
 bool rcBuildLayerRegions(rcContext* ctx, rcCompactHeightfield& chf, int borderSize, int minRegionArea);
 
+/// Builds region data for the heightfield by partitioning the heightfield in non-overlapping layers,
+/// sweeping bands of rows in separate jobs.
+///
+/// The result is identical to the serial version, the ids of the bands are merged in row order and
+/// the merging of the regions to layers stays serial.
+///
+/// @ingroup recast
+/// @param[in,out]	ctx				The build context to use during the operation.
+/// @param[in,out]	chf				A populated compact heightfield.
+/// @param[in]		borderSize		The size of the non-navigable border around the heightfield. [Limit: >=0] [Units: vx]
+/// @param[in]		minRegionArea	The minimum number of cells allowed to form isolated island areas. [Limit: >=0] [Units: vx]
+/// @param[in]		dispatcher		The job dispatcher. If null, the regions are built serially.
+/// @returns True if the operation completed successfully.
+bool rcBuildLayerRegions(rcContext* ctx, rcCompactHeightfield& chf, int borderSize, int minRegionArea,
+						 rcJobDispatcher* dispatcher);
+
 /// Builds region data for the heightfield using simple monotone partitioning.
 /// @ingroup recast 
 /// @param[in,out]	ctx				The build context to use during the operation.
@@ -1226,6 +1869,24 @@ bool rcBuildLayerRegions(rcContext* ctx, rcCompactHeightfield& chf, int borderSi
 bool rcBuildRegionsMonotone(rcContext* ctx, rcCompactHeightfield& chf,
 							int borderSize, int minRegionArea, int mergeRegionArea);
 
+/// Builds region data for the heightfield using simple monotone partitioning, sweeping bands of
+/// rows in separate jobs.
+///
+/// The result is identical to the serial version, the ids of the bands are merged in row order and
+/// the merging of the regions stays serial.
+///
+/// @ingroup recast
+/// @param[in,out]	ctx				The build context to use during the operation.
+/// @param[in,out]	chf				A populated compact heightfield.
+/// @param[in]		borderSize		The size of the non-navigable border around the heightfield. [Limit: >=0] [Units: vx]
+/// @param[in]		minRegionArea	The minimum number of cells allowed to form isolated island areas. [Limit: >=0] [Units: vx]
+/// @param[in]		mergeRegionArea	Any regions with a span count smaller than this value will, if possible,
+/// 								be merged with larger regions. [Limit: >=0] [Units: vx]
+/// @param[in]		dispatcher		The job dispatcher. If null, the regions are built serially.
+/// @returns True if the operation completed successfully.
+bool rcBuildRegionsMonotone(rcContext* ctx, rcCompactHeightfield& chf,
+							int borderSize, int minRegionArea, int mergeRegionArea, rcJobDispatcher* dispatcher);
+
 /// Sets the neighbor connection data for the specified direction.
 /// @param[in]		span			The span to update.
 /// @param[in]		direction		The direction to set. [Limits: 0 <= value < 4]
@@ -1304,22 +1965,66 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 /// @param[in]		maxEdgeLen	The maximum allowed length for contour edges along the border of the mesh. 
 /// 							[Limit: >=0] [Units: vx]
 /// @param[out]		cset		The resulting contour set. (Must be pre-allocated.)
+/// 							The contour array of a previous build is reused when it is large enough.
 /// @param[in]		buildFlags	The build flags. (See: #rcBuildContoursFlags)
 /// @returns True if the operation completed successfully.
 bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 					 float maxError, int maxEdgeLen,
 					 rcContourSet& cset, int buildFlags = RC_CONTOUR_TESS_WALL_EDGES);
 
+/// Builds a contour set from the region outlines in the provided compact heightfield,
+/// tracing and simplifying the contours of the regions in jobs.
+///
+/// The result is identical to the serial version. Each job uses the context of the
+/// worker it runs on for logging.
+///
+/// @ingroup recast
+/// @param[in,out]	ctx				The build context to use during the operation.
+/// @param[in]		chf				A fully built compact heightfield.
+/// @param[in]		maxError		The maximum distance a simplified contour's border edges should deviate 
+/// 								the original raw contour. [Limit: >=0] [Units: wu]
+/// @param[in]		maxEdgeLen		The maximum allowed length for contour edges along the border of the mesh. 
+/// 								[Limit: >=0] [Units: vx]
+/// @param[out]		cset			The resulting contour set. (Must be pre-allocated.)
+/// 								The contour array of a previous build is reused when it is large enough.
+/// @param[in]		buildFlags		The build flags. (See: #rcBuildContoursFlags)
+/// @param[in]		dispatcher		The job dispatcher. If null, the contours are built serially.
+/// @param[in]		workerContexts	The build contexts of the workers, one per rcJobDispatcher::getWorkerCount().
+/// 								If null, the workers use contexts with logging and timers disabled.
+/// @returns True if the operation completed successfully.
+bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
+					 float maxError, int maxEdgeLen,
+					 rcContourSet& cset, int buildFlags,
+					 rcJobDispatcher* dispatcher, rcContext** workerContexts);
+
 /// Builds a polygon mesh from the provided contours.
 /// @ingroup recast
 /// @param[in,out]	ctx		The build context to use during the operation.
 /// @param[in]		cset	A fully built contour set.
 /// @param[in]		nvp		The maximum number of vertices allowed for polygons generated during the 
 /// 						contour to polygon conversion process. [Limit: >= 3] 
-/// @param[out]		mesh	The resulting polygon mesh. (Must be re-allocated.)
+/// @param[out]		mesh	The resulting polygon mesh. (Must be pre-allocated.)
+/// 						The arrays of a previous build are reused when they are large enough.
 /// @returns True if the operation completed successfully.
 bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rcPolyMesh& mesh);
 
+/// Computes the clearance of the polygon edges from the distance field.
+///
+/// The clearance of an edge is the largest distance field value along the edge, so an agent
+/// wider than the eroded agent can cross the edge if its extra radius is at most the
+/// clearance times half the cell size. See #rcPolyMesh::edgeClearance.
+///
+/// The distance field is built if the compact heightfield does not have one yet. Area borders
+/// count as walls in the distance field, and the clearance of the edges near a tile border is
+/// at most the border size.
+///
+/// @ingroup recast
+/// @param[in,out]	ctx		The build context to use during the operation.
+/// @param[in,out]	chf		The compact heightfield used to build the polygon mesh.
+/// @param[in,out]	mesh	A fully built polygon mesh.
+/// @returns True if the operation completed successfully.
+bool rcBuildPolyMeshEdgeClearance(rcContext* ctx, rcCompactHeightfield& chf, rcPolyMesh& mesh);
+
 /// Merges multiple polygon meshes into a single mesh.
 ///  @ingroup recast
 ///  @param[in,out]	ctx		The build context to use during the operation.
@@ -1329,6 +2034,33 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 ///  @returns True if the operation completed successfully.
 bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, rcPolyMesh& mesh);
 
+/// Merges multiple polygon meshes into a single mesh, welding the vertices inside the
+/// meshes and copying the polygons in jobs.
+///
+/// The result is identical to the serial version.
+///
+///  @ingroup recast
+///  @param[in,out]	ctx			The build context to use during the operation.
+///  @param[in]		meshes		An array of polygon meshes to merge. [Size: @p nmeshes]
+///  @param[in]		nmeshes		The number of polygon meshes in the meshes array.
+///  @param[in]		mesh		The resulting polygon mesh. (Must be pre-allocated.)
+///  @param[in]		dispatcher	The job dispatcher. If null, the meshes are merged serially.
+///  @returns True if the operation completed successfully.
+bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, rcPolyMesh& mesh,
+					   rcJobDispatcher* dispatcher);
+
+/// Makes two polygon meshes which meet along the z-axis share the vertices on their common border.
+/// The border is the maximum z of @p lower and the minimum z of @p upper. The adjacency of both meshes
+/// is rebuilt and their edge clearances are dropped, build them after stitching.
+///  @ingroup recast
+///  @param[in,out]	ctx				The build context to use during the operation.
+///  @param[in,out]	lower			The polygon mesh below the border.
+///  @param[in,out]	upper			The polygon mesh above the border.
+///  @param[in]		maxHeightDiff	The maximum height difference of a vertex from the edge it is inserted into.
+///  								[Limit: >= 0] [Units: vx]
+///  @returns True if the operation completed successfully.
+bool rcStitchPolyMeshes(rcContext* ctx, rcPolyMesh& lower, rcPolyMesh& upper, int maxHeightDiff);
+
 /// Builds a detail mesh from the provided polygon mesh.
 /// @ingroup recast
 /// @param[in,out]	ctx				The build context to use during the operation.
@@ -1338,11 +2070,35 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 /// @param[in]		sampleMaxError	The maximum distance the detail mesh surface should deviate from 
 /// 								heightfield data. [Limit: >=0] [Units: wu]
 /// @param[out]		dmesh			The resulting detail mesh.  (Must be pre-allocated.)
+/// 								The arrays of a previous build are reused when they are large enough.
 /// @returns True if the operation completed successfully.
 bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompactHeightfield& chf,
 						   float sampleDist, float sampleMaxError,
 						   rcPolyMeshDetail& dmesh);
 
+/// Builds a detail mesh from the provided polygon mesh, building the detail meshes
+/// of the polygons in jobs.
+///
+/// The result is identical to the serial version. Each job uses the context of the
+/// worker it runs on for logging.
+///
+/// @ingroup recast
+/// @param[in,out]	ctx				The build context to use during the operation.
+/// @param[in]		mesh			A fully built polygon mesh.
+/// @param[in]		chf				The compact heightfield used to build the polygon mesh.
+/// @param[in]		sampleDist		Sets the distance to use when sampling the heightfield. [Limit: >=0] [Units: wu]
+/// @param[in]		sampleMaxError	The maximum distance the detail mesh surface should deviate from 
+/// 								heightfield data. [Limit: >=0] [Units: wu]
+/// @param[out]		dmesh			The resulting detail mesh.  (Must be pre-allocated.)
+/// 								The arrays of a previous build are reused when they are large enough.
+/// @param[in]		dispatcher		The job dispatcher. If null, the detail mesh is built serially.
+/// @param[in]		workerContexts	The build contexts of the workers, one per rcJobDispatcher::getWorkerCount().
+/// 								If null, the workers use contexts with logging and timers disabled.
+/// @returns True if the operation completed successfully.
+bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompactHeightfield& chf,
+						   float sampleDist, float sampleMaxError,
+						   rcPolyMeshDetail& dmesh, rcJobDispatcher* dispatcher, rcContext** workerContexts);
+
 /// Copies the poly mesh data from src to dst.
 /// @ingroup recast
 /// @param[in,out]	ctx		The build context to use during the operation.
@@ -1360,6 +2116,20 @@ bool rcCopyPolyMesh(rcContext* ctx, const rcPolyMesh& src, rcPolyMesh& dst);
 /// @returns True if the operation completed successfully.
 bool rcMergePolyMeshDetails(rcContext* ctx, rcPolyMeshDetail** meshes, const int nmeshes, rcPolyMeshDetail& mesh);
 
+/// Merges multiple detail meshes into a single detail mesh, copying the meshes in jobs.
+///
+/// The result is identical to the serial version.
+///
+/// @ingroup recast
+/// @param[in,out]	ctx			The build context to use during the operation.
+/// @param[in]		meshes		An array of detail meshes to merge. [Size: @p nmeshes]
+/// @param[in]		nmeshes		The number of detail meshes in the meshes array.
+/// @param[out]		mesh		The resulting detail mesh. (Must be pre-allocated.)
+/// @param[in]		dispatcher	The job dispatcher. If null, the meshes are merged serially.
+/// @returns True if the operation completed successfully.
+bool rcMergePolyMeshDetails(rcContext* ctx, rcPolyMeshDetail** meshes, const int nmeshes, rcPolyMeshDetail& mesh,
+							rcJobDispatcher* dispatcher);
+
 /// @}
 
 #endif // RECAST_H
@@ -64,6 +64,138 @@ void* rcAlloc(size_t size, rcAllocHint hint);
 /// @see rcAlloc, rcAllocSetCustom
 void rcFree(void* ptr);
 
+/// An allocator object, used to route the memory of the builds of a thread to its own heap,
+/// e.g. to keep a budget per world. The default implementation forwards to the functions
+/// set by #rcAllocSetCustom.
+/// @see rcAllocatorScope
+class rcAllocator
+{
+public:
+	virtual ~rcAllocator();
+
+	/// Allocates a memory block.
+	///  @param[in]		size	The size, in bytes of memory, to allocate.
+	///  @param[in]		hint	A hint to the allocator on how long the memory is expected to be in use.
+	///  @return A pointer to the beginning of the allocated memory block, or null if the allocation failed.
+	virtual void* alloc(size_t size, rcAllocHint hint);
+
+	/// Deallocates a memory block. @p ptr is never null.
+	///  @param[in]		ptr		A pointer to a memory block previously allocated using #alloc.
+	virtual void free(void* ptr);
+};
+
+/// Binds an allocator to the calling thread for the lifetime of the scope, and restores the
+/// previously bound allocator when it ends. Scopes can be nested.
+///
+/// While an allocator is bound, #rcAlloc and #rcFree of the thread use it instead of the
+/// functions set by #rcAllocSetCustom, so memory must be freed under the same binding it was
+/// allocated with. The build functions that take a dispatcher bind the allocator of the calling
+/// thread to the workers, in that case the allocator must be thread safe.
+class rcAllocatorScope
+{
+public:
+	/// Binds the allocator to the calling thread.
+	///  @param[in]		allocator	The allocator to bind, or null to use the functions set by #rcAllocSetCustom.
+	explicit rcAllocatorScope(rcAllocator* allocator);
+	~rcAllocatorScope();
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcAllocatorScope(const rcAllocatorScope&);
+	rcAllocatorScope& operator=(const rcAllocatorScope&);
+
+	rcAllocator* m_previous;
+};
+
+/// Returns the allocator bound to the calling thread, or null.
+/// @see rcAllocatorScope
+rcAllocator* rcGetAllocator();
+
+/// A linear allocator for the #RC_ALLOC_TEMP memory of a build.
+///
+/// While an arena is bound to a thread with #rcTempArenaScope, #rcAlloc serves the
+/// #RC_ALLOC_TEMP requests of that thread by bumping a pointer in the arena, and #rcFree
+/// ignores the memory owned by the arena. The memory is released all at once by #reset,
+/// e.g. after every tile of a tiled build. The blocks of the arena are allocated with the
+/// allocator passed to #init, or the functions set by #rcAllocSetCustom.
+///
+/// Memory allocated from an arena must be freed on a thread the arena is bound to, before
+/// the arena is reset.
+/// @see rcTileBuildConfig::tempArenaSize
+class rcTempArena
+{
+public:
+	rcTempArena();
+	~rcTempArena();
+
+	/// Allocates the first block of the arena.
+	///  @param[in]		blockSize	The size of the first block. Further blocks of at least this size
+	///  							are added when the arena is full. [Limit: > 0] [Units: bytes]
+	///  @param[in]		allocator	The allocator of the blocks. Must outlive the arena. [opt]
+	/// @returns True if the arena was initialized successfully.
+	bool init(size_t blockSize, rcAllocator* allocator = 0);
+
+	/// Allocates memory from the arena, adding a block if the arena is full.
+	///  @param[in]		size	The size, in bytes of memory, to allocate.
+	/// @returns A pointer aligned to 16 bytes, or null if a block could not be added.
+	void* alloc(size_t size);
+
+	/// Returns true if the pointer was allocated from the arena.
+	bool owns(const void* ptr) const;
+
+	/// Releases all memory allocated from the arena. If blocks were added since the
+	/// previous reset, they are replaced by a single block as large as all of them.
+	void reset();
+
+	/// The number of bytes allocated since the last reset.
+	size_t getUsedSize() const { return m_used; }
+
+	/// The largest number of bytes allocated between two resets.
+	size_t getPeakSize() const { return m_peak; }
+
+	/// The total size of the blocks of the arena.
+	size_t getCapacity() const { return m_capacity; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcTempArena(const rcTempArena&);
+	rcTempArena& operator=(const rcTempArena&);
+
+	struct Block;
+	bool addBlock(size_t size);
+	void purge();
+
+	rcAllocator* m_allocator;	///< The allocator of the blocks, or null.
+	Block* m_blocks;	///< The blocks of the arena, the current one first.
+	size_t m_blockSize;
+	size_t m_used;
+	size_t m_peak;
+	size_t m_capacity;
+};
+
+/// Binds a temporary memory arena to the calling thread for the lifetime of the scope,
+/// and restores the previously bound arena when it ends. Scopes can be nested.
+/// @see rcTempArena
+class rcTempArenaScope
+{
+public:
+	/// Binds the arena to the calling thread.
+	///  @param[in]		arena	The arena to bind, or null to use the functions set by #rcAllocSetCustom.
+	explicit rcTempArenaScope(rcTempArena* arena);
+	~rcTempArenaScope();
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcTempArenaScope(const rcTempArenaScope&);
+	rcTempArenaScope& operator=(const rcTempArenaScope&);
+
+	rcTempArena* m_previous;
+};
+
+/// Returns the temporary memory arena bound to the calling thread, or null.
+/// @see rcTempArenaScope
+rcTempArena* rcGetTempArena();
+
 /// An implementation of operator new usable for placement new. The default one is part of STL (which we don't use).
 /// rcNewTag is a dummy type used to differentiate our operator from the STL one, in case users import both Recast
 /// and STL.
@@ -86,6 +218,13 @@ typedef intptr_t rcSizeType;
 #define rcUnlikely(x) (x)
 #endif
 
+/// Declares a variable with one instance per thread. (C++98 has no thread_local.)
+#if defined(_MSC_VER)
+#	define RC_THREAD_LOCAL __declspec(thread)
+#else
+#	define RC_THREAD_LOCAL __thread
+#endif
+
 /// Variable-sized storage type. Mimics the interface of std::vector<T> with some notable differences:
 ///  * Uses rcAlloc()/rcFree() to handle storage.
 ///  * No support for a custom allocator.
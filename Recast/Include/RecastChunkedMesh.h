@@ -0,0 +1,232 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#ifndef RECASTCHUNKEDMESH_H
+#define RECASTCHUNKEDMESH_H
+
+#include "Recast.h"
+#include "RecastAlloc.h"
+
+/// A magic number used to detect compatibility of chunked meshes.
+static const int RC_CHUNKEDMESH_MAGIC = 'R'<<24 | 'C'<<16 | 'C'<<8 | 'M'; ///< 'RCCM'
+
+/// A version number used to detect compatibility of chunked meshes.
+static const int RC_CHUNKEDMESH_VERSION = 1;
+
+/// The maximum number of triangles in a block of a chunked mesh.
+static const int RC_CHUNKEDMESH_BLOCK_TRIS = 256;
+
+/// The trailer of a chunked mesh, stored in the last bytes of the data.
+/// @note This structure is rarely if ever used by the end user.
+struct rcChunkedMeshHeader
+{
+	int magic;				///< Chunked mesh magic number. (See: #RC_CHUNKEDMESH_MAGIC)
+	int version;			///< Chunked mesh format version number. (See: #RC_CHUNKEDMESH_VERSION)
+	uint64_t tableOffset;	///< The offset of the cell table. [Units: bytes]
+	uint64_t triCount;		///< The number of stored triangles, counting a triangle once per cell it overlaps.
+	float orig[3];			///< The minimum bounds of the cell grid. [(x, y, z)]
+	float cellSize;			///< The size of the cells on the xz-plane. [Units: wu]
+	float bmin[3];			///< The minimum bounds of the triangles. [(x, y, z)]
+	float bmax[3];			///< The maximum bounds of the triangles. [(x, y, z)]
+	int width;				///< The number of cells along the x-axis.
+	int height;				///< The number of cells along the z-axis.
+};
+
+/// A cell of a chunked mesh. The triangles of a cell are stored in a list of blocks.
+/// @note This structure is rarely if ever used by the end user.
+struct rcChunkedMeshCell
+{
+	uint64_t lastBlock;			///< The offset of the last block written, which links to the previous one. [Units: bytes]
+	unsigned int triCount;		///< The number of triangles in the cell.
+	unsigned int lastBlockTris;	///< The number of triangles in the last block.
+	float bmin[3];			///< The minimum bounds of the triangles of the cell. [(x, y, z)]
+	float bmax[3];			///< The maximum bounds of the triangles of the cell. [(x, y, z)]
+};
+
+struct rcChunkedMeshTri;
+
+/// Receives the bytes of a chunked mesh as it is written, e.g. to a file.
+class rcChunkedMeshOutput
+{
+public:
+	virtual ~rcChunkedMeshOutput() {}
+
+	/// Writes a block of bytes to the end of the chunked mesh.
+	///  @param[in]		data		The bytes to write.
+	///  @param[in]		size		The number of bytes to write.
+	/// @return True if all bytes were written.
+	virtual bool write(const void* data, const int size) = 0;
+};
+
+/// Provides random access to the bytes of a chunked mesh, e.g. in a file.
+///
+/// The read method is called from the workers of the job dispatcher when the
+/// tiles are built in parallel, and must be thread safe in that case.
+class rcChunkedMeshInput
+{
+public:
+	virtual ~rcChunkedMeshInput() {}
+
+	/// Reads a block of bytes of the chunked mesh.
+	///  @param[out]	data		The buffer to read into.
+	///  @param[in]		offset		The offset of the first byte to read. [Units: bytes]
+	///  @param[in]		size		The number of bytes to read.
+	/// @return True if all bytes were read.
+	virtual bool read(void* data, const uint64_t offset, const int size) = 0;
+
+	/// Returns the size of the chunked mesh. [Units: bytes]
+	virtual uint64_t getSize() = 0;
+};
+
+/// Writes the triangles of an input geometry into a chunked mesh, without
+/// keeping the whole geometry in memory.
+///
+/// The triangles are sorted into the cells of a grid on the xz-plane, a triangle is
+/// stored in every cell its bounds overlap. The triangles of a cell are buffered
+/// and written in blocks of #RC_CHUNKEDMESH_BLOCK_TRIS triangles, which only
+/// requires sequential output. Once the buffered triangles of all cells exceed the
+/// buffer limit, the partial blocks are written too.
+///
+/// @see rcChunkedMesh
+/// @ingroup recast
+class rcChunkedMeshWriter
+{
+public:
+	rcChunkedMeshWriter();
+	~rcChunkedMeshWriter();
+
+	/// Starts a chunked mesh.
+	///  @param[in,out]	context			The build context to use during the operation.
+	///  @param[in]		bmin			The minimum bounds of the cell grid. Triangles outside the grid
+	///  								are stored in the cells at its border. [(x, y, z)]
+	///  @param[in]		bmax			The maximum bounds of the cell grid. [(x, y, z)]
+	///  @param[in]		cellSize		The size of the cells on the xz-plane, e.g. the size of a tile. [Limit: > 0] [Units: wu]
+	///  @param[in]		maxBufferedTris	The maximum number of triangles buffered before the partial
+	///  								blocks are written. [Limit: > 0]
+	///  @param[in]		out				The output of the chunked mesh. Must stay valid until #finish.
+	///  @returns True if the operation completed successfully.
+	bool init(rcContext* context, const float* bmin, const float* bmax, const float cellSize,
+			  const int maxBufferedTris, rcChunkedMeshOutput* out);
+
+	/// Adds a batch of triangles, e.g. one object of the input geometry.
+	///  @param[in,out]	context		The build context to use during the operation.
+	///  @param[in]		verts		The vertices of the batch. [(x, y, z) * @p nverts]
+	///  @param[in]		nverts		The number of vertices.
+	///  @param[in]		tris		The triangle vertex indices. [(vertA, vertB, vertC) * @p ntris]
+	///  @param[in]		areas		The area id of each triangle, or null to use #RC_WALKABLE_AREA
+	///  							for all. [Size: @p ntris]
+	///  @param[in]		ntris		The number of triangles.
+	///  @returns True if the operation completed successfully.
+	bool addTriangles(rcContext* context, const float* verts, const int nverts, const int* tris,
+					  const unsigned char* areas, const int ntris);
+
+	/// Writes the remaining blocks, the cell table and the header.
+	///  @param[in,out]	context		The build context to use during the operation.
+	///  @returns True if the operation completed successfully.
+	bool finish(rcContext* context);
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcChunkedMeshWriter(const rcChunkedMeshWriter&);
+	rcChunkedMeshWriter& operator=(const rcChunkedMeshWriter&);
+
+	void purge();
+	bool writeBlock(const int cell);
+	bool flushAll();
+
+	rcChunkedMeshOutput* m_out;
+	rcChunkedMeshHeader m_header;
+	rcChunkedMeshCell* m_cells;
+	rcChunkedMeshTri** m_buffers;
+	int* m_bufferCounts;
+	int* m_bufferCaps;
+	uint64_t m_offset;
+	int m_buffered;
+	int m_maxBuffered;
+	unsigned int m_nextId;
+	bool m_failed;
+};
+
+/// Reads the triangles of a chunked mesh that overlap a region, e.g. the tiles of a
+/// tiled build. Only the header and the cell table are kept in memory.
+///
+/// The queries may be called concurrently if the input is thread safe.
+///
+/// @see rcChunkedMeshWriter, rcRasterizeChunkedMeshTile
+/// @ingroup recast
+class rcChunkedMesh
+{
+public:
+	rcChunkedMesh();
+	~rcChunkedMesh();
+
+	/// Reads the header and the cell table of a chunked mesh.
+	///  @param[in,out]	context		The build context to use during the operation.
+	///  @param[in]		in			The input of the chunked mesh. Must stay valid while the mesh is used.
+	///  @returns True if the operation completed successfully.
+	bool init(rcContext* context, rcChunkedMeshInput* in);
+
+	/// The header of the chunked mesh.
+	const rcChunkedMeshHeader& getHeader() const { return m_header; }
+
+	/// Returns an upper bound of the number of triangles overlapping a rectangle on the xz-plane.
+	///  @param[in]		bmin		The minimum bounds of the rectangle. [(x, y, z)]
+	///  @param[in]		bmax		The maximum bounds of the rectangle. [(x, y, z)]
+	///  @returns The number of triangles stored in the cells overlapping the rectangle.
+	int getMaxTriangleCount(const float* bmin, const float* bmax) const;
+
+	/// Reads the triangles whose bounds overlap a rectangle on the xz-plane.
+	/// Every triangle is returned once, even if it is stored in several cells, and the
+	/// triangles are returned in the order they were added to the writer. The spans of
+	/// a rasterized tile are therefore the same as when rasterizing the whole input in order.
+	///  @param[in,out]	context		The build context to use during the operation.
+	///  @param[in]		bmin		The minimum bounds of the rectangle. [(x, y, z)]
+	///  @param[in]		bmax		The maximum bounds of the rectangle. [(x, y, z)]
+	///  @param[out]	verts		The vertices of the triangles. [(x, y, z) * 3 * @p maxTris]
+	///  @param[out]	areas		The area ids of the triangles. [Size: @p maxTris]
+	///  @param[in]		maxTris		The maximum number of triangles to return, see #getMaxTriangleCount.
+	///  @param[out]	ntris		The number of triangles returned.
+	///  @returns True if the operation completed successfully. False if the input could not be
+	///  read or has more than @p maxTris triangles in the rectangle.
+	bool readTriangles(rcContext* context, const float* bmin, const float* bmax, float* verts,
+					   unsigned char* areas, const int maxTris, int* ntris) const;
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcChunkedMesh(const rcChunkedMesh&);
+	rcChunkedMesh& operator=(const rcChunkedMesh&);
+
+	rcChunkedMeshInput* m_in;
+	rcChunkedMeshHeader m_header;
+	rcChunkedMeshCell* m_cells;
+};
+
+/// Reads the triangles of a chunked mesh overlapping a heightfield and rasterizes them,
+/// e.g. to implement rcTileInputCallbacks::rasterizeTile. Triangles steeper than
+/// @p tileCfg.walkableSlopeAngle are rasterized as unwalkable.
+///  @ingroup recast
+///  @param[in,out]	context		The build context to use during the operation.
+///  @param[in]		mesh		The chunked mesh.
+///  @param[in]		tileCfg		The configuration of the tile. (Uses walkableSlopeAngle and walkableClimb.)
+///  @param[in,out]	heightfield	An initialized heightfield, the triangles overlapping its bounds are rasterized.
+///  @returns True if the operation completed successfully.
+bool rcRasterizeChunkedMeshTile(rcContext* context, const rcChunkedMesh& mesh, const rcConfig& tileCfg,
+								rcHeightfield& heightfield);
+
+#endif // RECASTCHUNKEDMESH_H
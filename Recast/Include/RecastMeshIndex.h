@@ -0,0 +1,155 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#ifndef RECASTMESHINDEX_H
+#define RECASTMESHINDEX_H
+
+#include "Recast.h"
+
+/// A node of a #rcTriMeshIndex.
+/// @ingroup recast
+struct rcTriMeshIndexNode
+{
+	float bmin[3];	///< The minimum bounds of the triangles below the node. [(x, y, z)]
+	float bmax[3];	///< The maximum bounds of the triangles below the node. [(x, y, z)]
+
+	/// For leaf nodes, the index of the first triangle of the chunk in #rcTriMeshIndex::tris.
+	/// For internal nodes, the negated number of nodes in the subtree, which is the offset
+	/// to the node following the subtree.
+	int i;
+
+	/// The number of triangles in the chunk. Zero for internal nodes.
+	int n;
+};
+
+/// A bounding volume hierarchy over the triangles of an input mesh.
+///
+/// The triangles are grouped into chunks of at most rcTriMeshIndex::maxTrisPerChunk
+/// triangles, which are the leaves of the tree. The nodes are stored in depth-first
+/// order, so that a subtree can be skipped by adding its size to the node index.
+///
+/// The index lets tiled builds gather the triangles overlapping a tile without
+/// testing the whole mesh, and speeds up segment queries against the mesh.
+///
+/// @see rcAllocTriMeshIndex, rcBuildTriMeshIndex, rcFreeTriMeshIndex
+/// @ingroup recast
+struct rcTriMeshIndex
+{
+	rcTriMeshIndex();
+	~rcTriMeshIndex();
+
+	rcTriMeshIndexNode* nodes;	///< The nodes of the tree. [Size: #nnodes]
+	int nnodes;					///< The number of nodes.
+	int* tris;					///< The vertex indices of the triangles in chunk order. [(vertA, vertB, vertC) * #ntris]
+	int* triIds;				///< The index of each triangle in the input mesh. [Size: #ntris]
+	int ntris;					///< The number of triangles.
+	int nchunks;				///< The number of chunks, the leaves of the tree.
+	int maxTrisPerChunk;		///< The number of triangles in the largest chunk.
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcTriMeshIndex(const rcTriMeshIndex&);
+	rcTriMeshIndex& operator=(const rcTriMeshIndex&);
+};
+
+/// Allocates a triangle mesh index object using the Recast allocator.
+/// @return A triangle mesh index that is ready for initialization, or null on failure.
+/// @ingroup recast
+/// @see rcBuildTriMeshIndex, rcFreeTriMeshIndex
+rcTriMeshIndex* rcAllocTriMeshIndex();
+
+/// Frees the specified triangle mesh index using the Recast allocator.
+/// @param[in]		index	A triangle mesh index allocated using #rcAllocTriMeshIndex
+/// @ingroup recast
+/// @see rcAllocTriMeshIndex
+void rcFreeTriMeshIndex(rcTriMeshIndex* index);
+
+/// Builds a bounding volume hierarchy over the triangles of a mesh.
+///
+/// The chunks are split at the median of the triangle centers along the longest
+/// axis of their bounds, until no chunk has more than @p trisPerChunk triangles.
+/// If a dispatcher is given, the subtrees below the top levels are built concurrently.
+/// The resulting index is the same with and without a dispatcher.
+///
+/// The mesh vertices are not copied, queries that test triangles take them as a parameter.
+///
+///  @ingroup recast
+///  @param[in,out]	context			The build context to use during the operation.
+///  @param[in]		verts			The vertices of the mesh. [(x, y, z) * @p nverts]
+///  @param[in]		nverts			The number of vertices.
+///  @param[in]		tris			The triangle vertex indices. [(vertA, vertB, vertC) * @p ntris]
+///  @param[in]		ntris			The number of triangles.
+///  @param[in]		trisPerChunk	The maximum number of triangles in a chunk. [Limit: > 0]
+///  @param[out]	index			The index to build. Any previous content is freed.
+///  @param[in]		dispatcher		The job dispatcher. If null, the index is built serially.
+///  @returns True if the operation completed successfully.
+bool rcBuildTriMeshIndex(rcContext* context, const float* verts, const int nverts, const int* tris, const int ntris,
+						 const int trisPerChunk, rcTriMeshIndex& index, rcJobDispatcher* dispatcher = 0);
+
+/// Finds the chunks whose bounds overlap a rectangle on the xz-plane.
+/// Passing a buffer of rcTriMeshIndex::nchunks ids always returns all chunks.
+///  @ingroup recast
+///  @param[in]		index	The triangle mesh index.
+///  @param[in]		bmin	The minimum bounds of the rectangle. [(x, z)]
+///  @param[in]		bmax	The maximum bounds of the rectangle. [(x, z)]
+///  @param[out]	ids		The node indices of the overlapping chunks, in tree order. [Size: @p maxIds]
+///  @param[in]		maxIds	The maximum number of ids to return.
+///  @returns The number of ids returned.
+int rcGetTriMeshChunksOverlappingRect(const rcTriMeshIndex& index, const float* bmin, const float* bmax,
+									  int* ids, const int maxIds);
+
+/// Finds the chunks whose bounds overlap an axis aligned box.
+///  @ingroup recast
+///  @param[in]		index	The triangle mesh index.
+///  @param[in]		bmin	The minimum bounds of the box. [(x, y, z)]
+///  @param[in]		bmax	The maximum bounds of the box. [(x, y, z)]
+///  @param[out]	ids		The node indices of the overlapping chunks, in tree order. [Size: @p maxIds]
+///  @param[in]		maxIds	The maximum number of ids to return.
+///  @returns The number of ids returned.
+int rcGetTriMeshChunksOverlappingBox(const rcTriMeshIndex& index, const float* bmin, const float* bmax,
+									 int* ids, const int maxIds);
+
+/// Finds the chunks whose bounds are crossed by a segment.
+///  @ingroup recast
+///  @param[in]		index	The triangle mesh index.
+///  @param[in]		p		The start of the segment. [(x, y, z)]
+///  @param[in]		q		The end of the segment. [(x, y, z)]
+///  @param[out]	ids		The node indices of the crossed chunks, in tree order. [Size: @p maxIds]
+///  @param[in]		maxIds	The maximum number of ids to return.
+///  @returns The number of ids returned.
+int rcGetTriMeshChunksOverlappingSegment(const rcTriMeshIndex& index, const float* p, const float* q,
+										 int* ids, const int maxIds);
+
+/// Finds the closest triangle hit by a segment.
+///
+/// Only triangles facing the start of the segment are hit, the winding is the
+/// same as for #rcMarkWalkableTriangles. Uses SSE2 or NEON to test four triangles
+/// at a time when available, unless RC_NO_SIMD is defined, with the same results.
+///
+///  @ingroup recast
+///  @param[in]		index	The triangle mesh index.
+///  @param[in]		verts	The vertices of the mesh the index was built from. [(x, y, z) * nverts]
+///  @param[in]		sp		The start of the segment. [(x, y, z)]
+///  @param[in]		sq		The end of the segment. [(x, y, z)]
+///  @param[out]	tmin	The parametric distance of the hit along the segment. [Limits: 0 <= value <= 1]
+///  @returns True if the segment hits a triangle.
+bool rcRaycastTriMeshIndex(const rcTriMeshIndex& index, const float* verts, const float* sp, const float* sq,
+						   float& tmin);
+
+#endif // RECASTMESHINDEX_H
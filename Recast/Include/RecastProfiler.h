@@ -0,0 +1,154 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#ifndef RECASTPROFILER_H
+#define RECASTPROFILER_H
+
+#include "Recast.h"
+#include "RecastAlloc.h"
+
+/// A timed scope recorded by a #rcProfilingContext.
+/// @see rcProfilingContext::getEvent
+struct rcProfileEvent
+{
+	int64_t start;			///< The start time of the scope. [Units: us]
+	int64_t duration;		///< The duration of the scope. [Units: us]
+	size_t allocatedBytes;	///< The bytes allocated inside the scope, including nested scopes.
+	int label;				///< The timer label of the scope. (See: #rcTimerLabel)
+	int depth;				///< The nesting depth of the scope. (Zero for outermost scopes.)
+};
+
+/// The accumulated cost of one build stage.
+/// @see rcProfilingContext::getStageStats
+struct rcProfileStageStats
+{
+	int calls;				///< The number of times the stage was timed.
+	int64_t time;			///< The accumulated time of the stage. [Units: us]
+	size_t allocatedBytes;	///< The bytes allocated by the stage, including nested stages.
+	int allocationCount;	///< The number of allocations made by the stage, including nested stages.
+};
+
+/// A build context which records the timers of a build as nested scopes.
+///
+/// Every timed scope is stored as an event, and the calls, time and allocated
+/// bytes of each #rcTimerLabel are accumulated. A context is meant to be used by
+/// one thread at a time, e.g. one context per worker of a #rcJobDispatcher. The
+/// events of several contexts can be exported together as a Chrome trace.
+///
+/// Allocated bytes are only counted after #enableAllocTracking has been called.
+///
+/// @ingroup recast
+class rcProfilingContext : public rcContext
+{
+public:
+	/// Constructor.
+	///  @param[in]		state	TRUE if the logging and performance timers should be enabled.  [Default: true]
+	rcProfilingContext(bool state = true);
+	virtual ~rcProfilingContext();
+
+	/// Allocates the event storage.
+	///  @param[in]		maxEvents	The maximum number of events to record. Scopes beyond that
+	///  							are still accumulated in the stage stats. [Limit: >= 0]
+	///  @param[in]		threadId	The id of the thread or worker using the context, used in the trace.
+	///  @returns True if the context was initialized successfully.
+	bool init(const int maxEvents, const int threadId);
+
+	/// The id of the thread or worker using the context.
+	int getThreadId() const { return m_threadId; }
+
+	/// The number of recorded events.
+	int getEventCount() const { return m_eventCount; }
+
+	/// Gets a recorded event. Events are stored in the order their scopes started.
+	///  @param[in]		i		The index of the event. [Limits: 0 <= value < #getEventCount]
+	const rcProfileEvent& getEvent(const int i) const { return m_events[i]; }
+
+	/// The number of scopes which did not fit in the event storage.
+	int getDroppedEventCount() const { return m_droppedEventCount; }
+
+	/// Gets the accumulated cost of a build stage.
+	///  @param[in]		label	The timer label of the stage.
+	const rcProfileStageStats& getStageStats(const rcTimerLabel label) const { return m_stages[label]; }
+
+	/// Gets the name of a timer label, e.g. "Build Regions" for #RC_TIMER_BUILD_REGIONS.
+	///  @param[in]		label	The timer label.
+	static const char* getLabelName(const rcTimerLabel label);
+
+	/// Installs an allocator which counts the bytes allocated in the open scopes
+	/// of the profiling context used by the allocating thread. Must not be called
+	/// while a build is running.
+	///  @param[in]		allocFunc	The allocator to forward to, or null for the default allocator.
+	///  @param[in]		freeFunc	The deallocator to forward to, or null for the default deallocator.
+	/// @see rcAllocSetCustom
+	static void enableAllocTracking(rcAllocFunc* allocFunc = 0, rcFreeFunc* freeFunc = 0);
+
+	/// Restores the allocator which was forwarded to by #enableAllocTracking.
+	static void disableAllocTracking();
+
+	/// Writes the events of the contexts as Chrome trace JSON. (chrome://tracing, Perfetto)
+	/// The output is truncated if it does not fit into the buffer, but is always null terminated.
+	///  @param[in]		contexts	The contexts to export. [Size: @p count]
+	///  @param[in]		count		The number of contexts.
+	///  @param[out]	buffer		The buffer to write to. [opt]
+	///  @param[in]		bufferSize	The size of the buffer in bytes.
+	///  @returns The length of the full output, excluding the null terminator.
+	static int exportChromeTrace(const rcProfilingContext* const* contexts, const int count,
+								 char* buffer, const int bufferSize);
+
+protected:
+	virtual void doResetTimers();
+	virtual void doStartTimer(const rcTimerLabel label);
+	virtual void doStopTimer(const rcTimerLabel label);
+	virtual int doGetAccumulatedTime(const rcTimerLabel label) const;
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcProfilingContext(const rcProfilingContext&);
+	rcProfilingContext& operator=(const rcProfilingContext&);
+
+	static void* trackedAlloc(size_t size, rcAllocHint hint);
+
+	/// The maximum nesting depth of the scopes.
+	static const int MAX_DEPTH = 32;
+
+	/// A scope which has been started but not stopped.
+	struct OpenScope
+	{
+		int64_t start;
+		size_t allocatedBytes;
+		int allocationCount;
+		int label;
+		int event;			///< The index of the event, or -1 if the event was dropped.
+	};
+
+	rcProfileEvent* m_events;
+	int m_maxEvents;
+	int m_eventCount;
+	int m_droppedEventCount;
+	int m_threadId;
+
+	OpenScope m_stack[MAX_DEPTH];
+	int m_depth;
+	/// The context the thread was using before this context opened its first scope.
+	rcProfilingContext* m_prevCurrent;
+
+	rcProfileStageStats m_stages[RC_MAX_TIMERS];
+};
+
+#endif // RECASTPROFILER_H
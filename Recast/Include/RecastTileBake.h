@@ -0,0 +1,173 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef RECASTTILEBAKE_H
+#define RECASTTILEBAKE_H
+
+#include "RecastAlloc.h"
+#include "RecastTileBuild.h"
+
+/// A magic number used to detect compatibility of serialized bake jobs.
+static const int RC_TILEBAKE_JOB_MAGIC = 'R'<<24 | 'C'<<16 | 'B'<<8 | 'J'; ///< 'RCBJ'
+
+/// A magic number used to detect compatibility of baked tile blobs.
+static const int RC_TILEBAKE_BLOB_MAGIC = 'R'<<24 | 'C'<<16 | 'B'<<8 | 'T'; ///< 'RCBT'
+
+/// A version number used to detect compatibility of serialized bake jobs and baked tile blobs.
+/// Changes whenever the serialized layout or the output of the build pipeline changes.
+static const int RC_TILEBAKE_VERSION = 1;
+
+/// The maximum number of input chunks of a bake job.
+static const int RC_TILEBAKE_MAX_CHUNKS = 64;
+
+/// The size of a serialized bake job without its chunk hashes. [Units: bytes]
+static const int RC_TILEBAKE_JOB_BASE_SIZE = 124;
+
+/// The size of the header of a baked tile blob. [Units: bytes]
+static const int RC_TILEBAKE_BLOB_HEADER_SIZE = 40;
+
+/// Describes the build of a single tile, so that it can be farmed out to another process or machine.
+///
+/// A job is serialized by #rcWriteTileBakeJob into a little-endian layout which does not depend on
+/// the platform, and identified by the content key of #rcCalcTileBakeKey. Jobs with equal keys
+/// produce equal tiles, so the key can address a shared cache of baked tiles.
+///
+/// @see rcBakeTile
+/// @ingroup recast
+struct rcTileBakeJob
+{
+	/// The tiled build configuration. #rcConfig::width, #rcConfig::height,
+	/// #rcTileBuildConfig::maxTilesInFlight and #rcTileBuildConfig::tempArenaSize do not
+	/// affect the tile and are not serialized.
+	rcTileBuildConfig buildCfg;
+
+	int tx;		///< The x-coordinate of the tile.
+	int ty;		///< The y-coordinate of the tile.
+
+	/// A hash of everything else the callbacks depend on, e.g. the agent settings and poly flags
+	/// used by rcTileBuildCallbacks::createTileData, or a version of the baking tool.
+	uint64_t settingsHash;
+
+	/// The number of input chunks overlapping the tile. [Limit: 0 <= value <= #RC_TILEBAKE_MAX_CHUNKS]
+	int chunkCount;
+
+	/// The content hashes of the input chunks overlapping the tile, in the order they are rasterized.
+	/// [Size: #chunkCount]
+	uint64_t chunkHashes[RC_TILEBAKE_MAX_CHUNKS];
+};
+
+/// The header of a baked tile blob, followed by the tile data.
+/// @see rcBakeTile, rcWriteTileBakeBlobHeader, rcReadTileBakeBlob
+struct rcTileBakeBlobHeader
+{
+	int magic;			///< Blob magic number. (See: #RC_TILEBAKE_BLOB_MAGIC)
+	int version;		///< Blob format version number. (See: #RC_TILEBAKE_VERSION)
+	uint64_t key;		///< The content key of the job that baked the tile. (See: #rcCalcTileBakeKey)
+	int tx;				///< The x-coordinate of the tile.
+	int ty;				///< The y-coordinate of the tile.
+	int dataSize;		///< The size of the tile data, zero if the tile is empty. [Units: bytes]
+	uint64_t dataHash;	///< The hash of the tile data. (See: #rcHashData64)
+};
+
+/// Updates a 64-bit FNV-1a hash with a block of data, e.g. to compute the content
+/// hashes of the input chunks of a #rcTileBakeJob.
+///  @param[in]		data		The data to hash.
+///  @param[in]		size		The size of the data in bytes.
+///  @param[in]		hash		The hash to update. Use #rcHashData64Init to start a new hash.
+/// @returns The updated hash.
+/// @ingroup recast
+uint64_t rcHashData64(const void* data, const int size, uint64_t hash);
+
+/// The initial value of a 64-bit FNV-1a hash.
+/// @see rcHashData64
+/// @ingroup recast
+uint64_t rcHashData64Init();
+
+/// Gets the size of a serialized bake job.
+///  @param[in]		job			The bake job.
+/// @returns The size of the serialized job. [Units: bytes]
+/// @ingroup recast
+int rcGetTileBakeJobSize(const rcTileBakeJob& job);
+
+/// Serializes a bake job.
+///  @param[in]		job			The bake job.
+///  @param[out]	data		The buffer to write the job to.
+///  @param[in]		dataSize	The size of the buffer. [Limit: >= #rcGetTileBakeJobSize]
+///  @param[out]	outDataSize	The number of bytes written. [opt]
+/// @returns True if the job was written, false if it is invalid or the buffer is too small.
+/// @ingroup recast
+bool rcWriteTileBakeJob(const rcTileBakeJob& job, unsigned char* data, const int dataSize, int* outDataSize = 0);
+
+/// Deserializes a bake job written by #rcWriteTileBakeJob.
+/// The fields which are not serialized are set to zero.
+///  @param[in]		data		The serialized job.
+///  @param[in]		dataSize	The size of the serialized job.
+///  @param[out]	job			The bake job.
+/// @returns True if the job was read, false if the data is not a valid job of this version.
+/// @ingroup recast
+bool rcReadTileBakeJob(const unsigned char* data, const int dataSize, rcTileBakeJob& job);
+
+/// Calculates the content key of a bake job, which is the hash of the serialized job.
+/// Equal jobs have equal keys on every platform.
+///  @param[in]		job			The bake job.
+/// @returns The content key, or zero if the job is invalid.
+/// @ingroup recast
+uint64_t rcCalcTileBakeKey(const rcTileBakeJob& job);
+
+/// Bakes the tile of a job.
+///
+/// The tile is built by #rcBuildTile, so a baked tile is identical to the tile built by
+/// #rcBuildTiles from the same input. The callbacks must rasterize exactly the input chunks
+/// listed by the job, and rcTileBuildCallbacks::createTileData must not write uninitialized
+/// bytes. The header describes the result, including empty tiles, which can be cached too.
+///
+/// Bit-exact results across machines also require the libraries and the callbacks to be built
+/// with the same floating point semantics, e.g. with RECASTNAVIGATION_STRICT_FP, which disables
+/// the contraction of floating point expressions into fused multiply-adds.
+///
+///  @param[in,out]	context		The build context to use during the operation.
+///  @param[in]		job			The bake job.
+///  @param[in]		callbacks	The callbacks providing the tile input and converting the meshes
+///  							into tile data. rcTileBuildCallbacks::addTile is not called.
+///  @param[out]	header		The header of the baked tile blob.
+///  @param[out]	outData		The tile data returned by rcTileBuildCallbacks::createTileData, null if the tile is empty.
+///  @param[out]	outDataSize	The size of the tile data.
+/// @returns True if the operation completed successfully. An empty tile is not an error.
+/// @ingroup recast
+bool rcBakeTile(rcContext* context, const rcTileBakeJob& job, rcTileBuildCallbacks& callbacks,
+				rcTileBakeBlobHeader& header, unsigned char** outData, int* outDataSize);
+
+/// Serializes the header of a baked tile blob. The tile data follows the header in the blob.
+///  @param[in]		header		The header of the blob.
+///  @param[out]	data		The buffer to write the header to.
+///  @param[in]		dataSize	The size of the buffer. [Limit: >= #RC_TILEBAKE_BLOB_HEADER_SIZE]
+/// @returns True if the header was written.
+/// @ingroup recast
+bool rcWriteTileBakeBlobHeader(const rcTileBakeBlobHeader& header, unsigned char* data, const int dataSize);
+
+/// Reads and validates a baked tile blob, e.g. when it is fetched from a shared cache.
+///  @param[in]		blob		The blob, the serialized header followed by the tile data.
+///  @param[in]		blobSize	The size of the blob.
+///  @param[out]	header		The header of the blob.
+///  @param[out]	data		Points to the tile data in the blob, null if the tile is empty.
+/// @returns True if the blob is valid, false if it is not a blob of this version or its data is corrupt.
+/// @ingroup recast
+bool rcReadTileBakeBlob(const unsigned char* blob, const int blobSize, rcTileBakeBlobHeader& header,
+						const unsigned char** data);
+
+#endif // RECASTTILEBAKE_H
@@ -0,0 +1,410 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef RECASTTILEBUILD_H
+#define RECASTTILEBUILD_H
+
+#include "Recast.h"
+
+/// The region partitioning method used when building tiles.
+/// @see rcTileBuildConfig
+enum rcPartitionType
+{
+	RC_PARTITION_WATERSHED,	///< Watershed partitioning. (See: #rcBuildRegions)
+	RC_PARTITION_MONOTONE,	///< Monotone partitioning. (See: #rcBuildRegionsMonotone)
+	RC_PARTITION_LAYERS		///< Layer partitioning. (See: #rcBuildLayerRegions)
+};
+
+/// Specifies the configuration of a tiled build.
+/// @ingroup recast
+struct rcTileBuildConfig
+{
+	/// The per tile build configuration. #rcConfig::bmin and #rcConfig::bmax
+	/// specify the bounds of the whole tile grid, #rcConfig::tileSize and #rcConfig::borderSize
+	/// must be set. #rcConfig::width and #rcConfig::height are ignored.
+	rcConfig cfg;
+
+	/// The region partitioning method. (See: #rcPartitionType)
+	int partitionType;
+
+	/// The span filters to apply. (See: #rcSpanFilterFlags)
+	int filterFlags;
+
+	/// The maximum number of tiles built before their results are handed to
+	/// rcTileBuildCallbacks::addTile. Bounds the memory held by finished tiles.
+	/// [Limit: >= 0] [Default: 0 = all tiles]
+	int maxTilesInFlight;
+
+	/// The initial size of the temporary memory arena of each worker. If set, the
+	/// #RC_ALLOC_TEMP memory of a tile build is allocated from the arena of its worker,
+	/// which is reset after every tile. (See: #rcTempArena)
+	/// [Limit: >= 0] [Units: bytes] [Default: 0 = no arenas]
+	int tempArenaSize;
+
+	/// True if the edge clearances of the polygon meshes should be built, so that the
+	/// tile data can serve agents wider than #rcConfig::walkableRadius.
+	/// (See: #rcBuildPolyMeshEdgeClearance)
+	bool buildEdgeClearance;
+};
+
+/// Provides the per tile input of #rcBuildTiles and #rcBuildTileLayers.
+///
+/// The methods are called from the workers of the job dispatcher, possibly
+/// concurrently for different tiles, and must be thread safe.
+///
+/// @ingroup recast
+class rcTileInputCallbacks
+{
+public:
+	virtual ~rcTileInputCallbacks() {}
+
+	/// Rasterizes the input geometry overlapping the tile into the heightfield.
+	/// The heightfield covers @p tileCfg.bmin to @p tileCfg.bmax, which includes the tile border.
+	///  @param[in,out]	context		The build context of the worker.
+	///  @param[in]		tileCfg		The configuration of the tile.
+	///  @param[in]		tx			The x-coordinate of the tile.
+	///  @param[in]		ty			The y-coordinate of the tile.
+	///  @param[in,out]	heightfield	An initialized empty heightfield.
+	///  @returns True if the operation completed successfully.
+	virtual bool rasterizeTile(rcContext* context, const rcConfig& tileCfg, const int tx, const int ty,
+							   rcHeightfield& heightfield) = 0;
+
+	/// Marks custom areas after the walkable area has been eroded.
+	///  @param[in,out]	context				The build context of the worker.
+	///  @param[in]		tileCfg				The configuration of the tile.
+	///  @param[in]		tx					The x-coordinate of the tile.
+	///  @param[in]		ty					The y-coordinate of the tile.
+	///  @param[in,out]	compactHeightfield	The compact heightfield of the tile.
+	///  @returns True if the operation completed successfully.
+	virtual bool markAreas(rcContext* context, const rcConfig& tileCfg, const int tx, const int ty,
+						   rcCompactHeightfield& compactHeightfield)
+	{
+		rcIgnoreUnused(context); rcIgnoreUnused(tileCfg); rcIgnoreUnused(tx); rcIgnoreUnused(ty);
+		rcIgnoreUnused(compactHeightfield);
+		return true;
+	}
+};
+
+/// Provides the per tile inputs and receives the outputs of #rcBuildTiles.
+///
+/// The rasterizeTile, markAreas and createTileData methods are called from the
+/// workers of the job dispatcher, possibly concurrently for different tiles, and
+/// must be thread safe. The addTile method is only called on the thread that
+/// called #rcBuildTiles, one tile at a time and in a deterministic order.
+///
+/// @ingroup recast
+class rcTileBuildCallbacks : public rcTileInputCallbacks
+{
+public:
+	virtual ~rcTileBuildCallbacks() {}
+
+	/// Converts the meshes of a tile into runtime tile data, e.g. using dtCreateNavMeshData.
+	/// The meshes may be modified, but are freed once the method returns.
+	///  @param[in,out]	context		The build context of the worker.
+	///  @param[in]		tileCfg		The configuration of the tile.
+	///  @param[in]		tx			The x-coordinate of the tile.
+	///  @param[in]		ty			The y-coordinate of the tile.
+	///  @param[in,out]	polyMesh	The polygon mesh of the tile.
+	///  @param[in,out]	detailMesh	The detail mesh of the tile.
+	///  @param[out]	outData		The tile data. Set to null if the tile has no data.
+	///  @param[out]	outDataSize	The size of the tile data.
+	///  @returns True if the operation completed successfully.
+	virtual bool createTileData(rcContext* context, const rcConfig& tileCfg, const int tx, const int ty,
+								rcPolyMesh& polyMesh, rcPolyMeshDetail& detailMesh,
+								unsigned char** outData, int* outDataSize) = 0;
+
+	/// Receives a finished tile. Tiles are delivered in row-major order, regardless
+	/// of the order in which they were built. Tiles without data are skipped.
+	/// Ownership of the data is transferred to the callee.
+	///  @param[in]		tx			The x-coordinate of the tile.
+	///  @param[in]		ty			The y-coordinate of the tile.
+	///  @param[in]		data		The tile data returned by createTileData.
+	///  @param[in]		dataSize	The size of the tile data.
+	virtual void addTile(const int tx, const int ty, unsigned char* data, const int dataSize) = 0;
+
+	/// Computes a hash of the input of a tile, used by #rcTileBuildCache to find the
+	/// tiles that changed since the previous build. The hash must cover everything
+	/// rasterizeTile and markAreas read for the tile, e.g. the content hashes of the
+	/// input chunks overlapping @p tileCfg.bmin to @p tileCfg.bmax. Called on the
+	/// thread that called #rcBuildTiles.
+	///  @param[in]		tileCfg		The configuration of the tile.
+	///  @param[in]		tx			The x-coordinate of the tile.
+	///  @param[in]		ty			The y-coordinate of the tile.
+	///  @param[out]	hash		The hash of the tile input.
+	///  @returns True if the hash was computed. Tiles without a hash are always rebuilt.
+	virtual bool getTileInputHash(const rcConfig& tileCfg, const int tx, const int ty, unsigned int* hash)
+	{
+		rcIgnoreUnused(tileCfg); rcIgnoreUnused(tx); rcIgnoreUnused(ty); rcIgnoreUnused(hash);
+		return false;
+	}
+
+	/// Receives a rebuilt tile which has no data, so that the tile added by a previous
+	/// build can be removed. Only called by builds using a #rcTileBuildCache.
+	///  @param[in]		tx			The x-coordinate of the tile.
+	///  @param[in]		ty			The y-coordinate of the tile.
+	virtual void removeTile(const int tx, const int ty)
+	{
+		rcIgnoreUnused(tx); rcIgnoreUnused(ty);
+	}
+};
+
+/// Provides the per tile inputs and receives the heightfield layers of #rcBuildTileLayers,
+/// e.g. to bake the compressed layers of a tile cache.
+///
+/// The rasterizeTile, markAreas and createLayerData methods are called from the
+/// workers of the job dispatcher, possibly concurrently for different tiles, and
+/// must be thread safe. The addLayer method is only called on the thread that
+/// called #rcBuildTileLayers, one layer at a time and in a deterministic order.
+///
+/// @ingroup recast
+class rcTileLayerBuildCallbacks : public rcTileInputCallbacks
+{
+public:
+	virtual ~rcTileLayerBuildCallbacks() {}
+
+	/// Converts a heightfield layer of a tile into layer data, e.g. using dtBuildTileCacheLayer.
+	/// No two calls with the same worker index run at the same time, so per-worker
+	/// resources such as a compressor can be indexed by @p workerIndex without locking.
+	///  @param[in,out]	context		The build context of the worker.
+	///  @param[in]		workerIndex	The index of the worker. [Limits: 0 <= value < rcJobDispatcher::getWorkerCount()]
+	///  @param[in]		tileCfg		The configuration of the tile.
+	///  @param[in]		tx			The x-coordinate of the tile.
+	///  @param[in]		ty			The y-coordinate of the tile.
+	///  @param[in]		layerIndex	The index of the layer in the tile.
+	///  @param[in]		layer		The heightfield layer.
+	///  @param[out]	outData		The layer data. Set to null to skip the layer.
+	///  @param[out]	outDataSize	The size of the layer data.
+	///  @returns True if the operation completed successfully.
+	virtual bool createLayerData(rcContext* context, const int workerIndex, const rcConfig& tileCfg,
+								 const int tx, const int ty, const int layerIndex, const rcHeightfieldLayer& layer,
+								 unsigned char** outData, int* outDataSize) = 0;
+
+	/// Receives the data of a finished layer. Tiles are delivered in row-major order,
+	/// and the layers of a tile in order, regardless of the order in which they were
+	/// built. The layers a failed tile built before failing are delivered too.
+	/// Ownership of the data is transferred to the callee.
+	///  @param[in]		tx			The x-coordinate of the tile.
+	///  @param[in]		ty			The y-coordinate of the tile.
+	///  @param[in]		layerIndex	The index of the layer in the tile.
+	///  @param[in]		data		The layer data returned by createLayerData.
+	///  @param[in]		dataSize	The size of the layer data.
+	virtual void addLayer(const int tx, const int ty, const int layerIndex, unsigned char* data, const int dataSize) = 0;
+};
+
+/// The cached state of a single tile.
+/// @note This structure is rarely if ever used by the end user.
+/// @see rcTileBuildCache
+struct rcTileBuildCacheEntry
+{
+	unsigned int inputHash;		///< The tile input hash of the last successful build.
+	unsigned int rasterHash;	///< The hash of the settings used to build @p chf.
+	unsigned int buildHash;		///< The hash of all build settings of the last successful build.
+	bool valid;					///< True if the hashes describe the current tile.
+
+	/// The compact heightfield of the tile before erosion, or null.
+	rcCompactHeightfield* chf;
+};
+
+/// Keeps the state of a tiled build between calls to #rcBuildTiles, so that a
+/// rebuild skips the tiles whose input and build settings did not change.
+///
+/// The input of a tile is identified by rcTileBuildCallbacks::getTileInputHash.
+/// Optionally the cache also keeps the compact heightfield of every tile. Tiles
+/// whose input did not change then skip rasterization and filtering when only the
+/// settings used after that, such as the region or detail mesh settings, change.
+///
+/// @ingroup recast
+class rcTileBuildCache
+{
+public:
+	rcTileBuildCache();
+	~rcTileBuildCache();
+
+	/// Initializes the cache for a tile grid. Drops all cached state.
+	///  @param[in]		tilesX					The number of tiles along the x-axis.
+	///  @param[in]		tilesY					The number of tiles along the z-axis.
+	///  @param[in]		keepCompactHeightfields	True to keep the compact heightfield of every
+	///  										tile, at the cost of the memory they use.
+	///  @returns True if the cache was initialized successfully.
+	bool init(const int tilesX, const int tilesY, const bool keepCompactHeightfields);
+
+	/// Forgets the state of a tile, so that the next build rebuilds it from its input.
+	///  @param[in]		tx			The x-coordinate of the tile.
+	///  @param[in]		ty			The y-coordinate of the tile.
+	void invalidateTile(const int tx, const int ty);
+
+	/// Forgets the state of all tiles.
+	void invalidateAll();
+
+	/// The number of tiles along the x-axis.
+	int getTilesX() const { return m_tilesX; }
+
+	/// The number of tiles along the z-axis.
+	int getTilesY() const { return m_tilesY; }
+
+	/// True if the cache keeps the compact heightfields of the tiles.
+	bool getKeepCompactHeightfields() const { return m_keepCompactHeightfields; }
+
+	/// Gets the cached state of a tile.
+	///  @param[in]		tx			The x-coordinate of the tile.
+	///  @param[in]		ty			The y-coordinate of the tile.
+	/// @returns The cached state of the tile, or null if the tile is outside the grid.
+	rcTileBuildCacheEntry* getEntry(const int tx, const int ty);
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcTileBuildCache(const rcTileBuildCache&);
+	rcTileBuildCache& operator=(const rcTileBuildCache&);
+
+	void purge();
+
+	rcTileBuildCacheEntry* m_entries;
+	int m_tilesX;
+	int m_tilesY;
+	bool m_keepCompactHeightfields;
+};
+
+/// Updates a 32-bit FNV-1a hash with a block of data, e.g. to compute
+/// rcTileBuildCallbacks::getTileInputHash from the input triangles.
+///  @param[in]		data		The data to hash.
+///  @param[in]		size		The size of the data in bytes.
+///  @param[in]		hash		The hash to update. Use the default to start a new hash.
+/// @returns The updated hash.
+/// @ingroup recast
+unsigned int rcHashData(const void* data, const int size, unsigned int hash = 2166136261u);
+
+/// Calculates the size of the tile grid covering the bounds of the configuration.
+///  @param[in]		cfg			The build configuration. (Uses bmin, bmax, cs and tileSize.)
+///  @param[out]	tilesX		The number of tiles along the x-axis.
+///  @param[out]	tilesY		The number of tiles along the z-axis.
+/// @ingroup recast
+void rcCalcTileGridSize(const rcConfig& cfg, int* tilesX, int* tilesY);
+
+/// Calculates the build configuration of a single tile in the grid.
+/// The bounds are expanded by the border size on the xz-plane.
+///  @param[in]		cfg			The build configuration of the whole grid.
+///  @param[in]		tx			The x-coordinate of the tile.
+///  @param[in]		ty			The y-coordinate of the tile.
+///  @param[out]	tileCfg		The configuration of the tile.
+/// @ingroup recast
+void rcCalcTileConfig(const rcConfig& cfg, const int tx, const int ty, rcConfig& tileCfg);
+
+/// Builds the polygon mesh and detail mesh of a single tile.
+///  @param[in,out]	context		The build context to use during the operation.
+///  @param[in]		buildCfg	The tiled build configuration.
+///  @param[in]		tx			The x-coordinate of the tile.
+///  @param[in]		ty			The y-coordinate of the tile.
+///  @param[in]		callbacks	The callbacks providing the tile input and output.
+///  @param[out]	outData		The tile data returned by rcTileBuildCallbacks::createTileData.
+///  @param[out]	outDataSize	The size of the tile data.
+///  @returns True if the operation completed successfully. An empty tile is not an error.
+/// @ingroup recast
+bool rcBuildTile(rcContext* context, const rcTileBuildConfig& buildCfg, const int tx, const int ty,
+				 rcTileBuildCallbacks& callbacks, unsigned char** outData, int* outDataSize);
+
+/// Builds all tiles of the grid, running the per tile builds on the job dispatcher.
+///
+/// Each job uses the context of the worker it runs on, so contexts are never shared
+/// between concurrently running jobs. The finished tiles are delivered through
+/// rcTileBuildCallbacks::addTile on the calling thread in row-major order, so the
+/// result does not depend on the number of workers or scheduling.
+///
+///  @param[in,out]	context			The build context used for logging and timing the whole build.
+///  @param[in]		buildCfg		The tiled build configuration.
+///  @param[in]		callbacks		The callbacks providing the tile input and output.
+///  @param[in]		dispatcher		The job dispatcher. If null, the tiles are built serially.
+///  @param[in]		workerContexts	The build contexts of the workers, one per rcJobDispatcher::getWorkerCount().
+///  								If null, the workers use contexts with logging and timers disabled.
+///  @returns True if all tiles were built successfully.
+/// @ingroup recast
+bool rcBuildTiles(rcContext* context, const rcTileBuildConfig& buildCfg, rcTileBuildCallbacks& callbacks,
+				  rcJobDispatcher* dispatcher, rcContext** workerContexts);
+
+/// Rebuilds the tiles of the grid whose input or build settings changed since the
+/// previous build with the same cache.
+///
+/// Unchanged tiles are skipped, and neither rcTileBuildCallbacks::addTile nor
+/// rcTileBuildCallbacks::removeTile is called for them. Rebuilt tiles without data
+/// are delivered through rcTileBuildCallbacks::removeTile. A tile that fails to
+/// build is rebuilt by the next build. The cache is re-initialized if the size
+/// of the grid changed.
+///
+///  @param[in,out]	context			The build context used for logging and timing the whole build.
+///  @param[in]		buildCfg		The tiled build configuration.
+///  @param[in]		callbacks		The callbacks providing the tile input and output.
+///  @param[in]		dispatcher		The job dispatcher. If null, the tiles are built serially.
+///  @param[in]		workerContexts	The build contexts of the workers, one per rcJobDispatcher::getWorkerCount().
+///  								If null, the workers use contexts with logging and timers disabled.
+///  @param[in,out]	cache			The state of the previous build. If null, all tiles are built.
+///  @param[out]	builtTileCount	The number of tiles that were rebuilt. [opt]
+///  @returns True if all tiles were built successfully.
+/// @ingroup recast
+bool rcBuildTiles(rcContext* context, const rcTileBuildConfig& buildCfg, rcTileBuildCallbacks& callbacks,
+				  rcJobDispatcher* dispatcher, rcContext** workerContexts,
+				  rcTileBuildCache* cache, int* builtTileCount = 0);
+
+/// Builds the heightfield layers of a range of tiles, running the per tile builds on the job dispatcher.
+///
+/// Each tile is rasterized, filtered, eroded and split into layers by #rcBuildHeightfieldLayers,
+/// and every layer is converted by rcTileLayerBuildCallbacks::createLayerData on the worker
+/// that built the tile. The layer data is delivered through rcTileLayerBuildCallbacks::addLayer
+/// on the calling thread in row-major tile order, so the result does not depend on the number
+/// of workers or scheduling. #rcTileBuildConfig::partitionType is not used.
+///
+///  @param[in,out]	context			The build context used for logging and timing the whole build.
+///  @param[in]		buildCfg		The tiled build configuration.
+///  @param[in]		callbacks		The callbacks providing the tile input and receiving the layers.
+///  @param[in]		dispatcher		The job dispatcher. If null, the tiles are built serially.
+///  @param[in]		workerContexts	The build contexts of the workers, one per rcJobDispatcher::getWorkerCount().
+///  								If null, the workers use contexts with logging and timers disabled.
+///  @param[in]		minTx			The minimum x-coordinate of the tile range.
+///  @param[in]		minTy			The minimum y-coordinate of the tile range.
+///  @param[in]		maxTx			The maximum x-coordinate of the tile range. (Inclusive, clamped to the grid.)
+///  @param[in]		maxTy			The maximum y-coordinate of the tile range. (Inclusive, clamped to the grid.)
+///  @param[out]	layerCount		The number of layers delivered. [opt]
+///  @returns True if all tiles were built successfully.
+/// @ingroup recast
+bool rcBuildTileLayers(rcContext* context, const rcTileBuildConfig& buildCfg, rcTileLayerBuildCallbacks& callbacks,
+					   rcJobDispatcher* dispatcher, rcContext** workerContexts,
+					   const int minTx, const int minTy, const int maxTx, const int maxTy, int* layerCount = 0);
+
+/// Builds a single polygon mesh and detail mesh over the whole grid in horizontal bands, so that only
+/// the working bands are resident instead of the heightfields of the whole grid.
+///
+/// Each band spans the width of the grid and #rcConfig::tileSize rows, plus #rcConfig::borderSize
+/// rows of overlap on either side, and is built like a tile whose y-coordinate is the band index.
+/// The polygon meshes of neighbouring bands are stitched by #rcStitchPolyMeshes and merged by
+/// #rcMergePolyMeshes, so that the result can be used like the mesh of a single tile build. The peak
+/// memory use is bounded by two bands and the finished meshes, regardless of the length of the grid.
+///
+/// The result is not identical to a single tile build, since the regions of each band are
+/// partitioned separately. The merged mesh has the usual limit of 0xffff vertices.
+///
+///  @param[in,out]	context		The build context to use during the operation.
+///  @param[in]		buildCfg	The build configuration. #rcConfig::tileSize is the height of the bands and
+///  							#rcConfig::borderSize must be set. #rcTileBuildConfig::maxTilesInFlight and
+///  							#rcTileBuildConfig::tempArenaSize are not used.
+///  @param[in]		callbacks	The callbacks providing the input of the bands, called with a tile x-coordinate of 0.
+///  @param[out]	mesh		The resulting polygon mesh. (Must be pre-allocated, must be empty mesh.)
+///  @param[out]	dmesh		The resulting detail mesh. (Must be pre-allocated, must be empty mesh.)
+///  @returns True if the operation completed successfully.
+/// @ingroup recast
+bool rcBuildBandedPolyMesh(rcContext* context, const rcTileBuildConfig& buildCfg, rcTileInputCallbacks& callbacks,
+						   rcPolyMesh& mesh, rcPolyMeshDetail& dmesh);
+
+#endif // RECASTTILEBUILD_H
@@ -25,6 +25,16 @@
 #include <stdio.h>
 #include <stdarg.h>
 
+// Define RC_NO_SIMD to classify the input triangles one at a time on all platforms.
+#if defined(RC_NO_SIMD)
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RC_TRIAREA_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define RC_TRIAREA_NEON
+#endif
+
 namespace
 {
 /// Allocates and constructs an object of the given type, returning a pointer.
@@ -103,6 +113,7 @@ rcHeightfield::rcHeightfield()
 , spans()
 , pools()
 , freelist()
+, spansPerPool()
 {
 }
 
@@ -119,6 +130,40 @@ rcHeightfield::~rcHeightfield()
 	}
 }
 
+rcColumnHeightfield* rcAllocColumnHeightfield()
+{
+	return rcNew<rcColumnHeightfield>(RC_ALLOC_PERM);
+}
+
+void rcFreeColumnHeightfield(rcColumnHeightfield* heightfield)
+{
+	rcDelete(heightfield);
+}
+
+rcColumnHeightfield::rcColumnHeightfield()
+: width()
+, height()
+, bmin()
+, bmax()
+, cs()
+, ch()
+, columns()
+, spans()
+, spanCount()
+, spanCapacity()
+, fragments()
+, fragmentCount()
+, fragmentCapacity()
+{
+}
+
+rcColumnHeightfield::~rcColumnHeightfield()
+{
+	rcFree(columns);
+	rcFree(spans);
+	rcFree(fragments);
+}
+
 rcCompactHeightfield* rcAllocCompactHeightfield()
 {
 	return rcNew<rcCompactHeightfield>(RC_ALLOC_PERM);
@@ -133,6 +178,7 @@ rcCompactHeightfield::rcCompactHeightfield()
 : width()
 , height()
 , spanCount()
+, spanCapacity()
 , walkableHeight()
 , walkableClimb()
 , borderSize()
@@ -198,6 +244,7 @@ void rcFreeContourSet(rcContourSet* contourSet)
 rcContourSet::rcContourSet()
 : conts()
 , nconts()
+, maxconts()
 , bmin()
 , bmax()
 , cs()
@@ -235,9 +282,11 @@ rcPolyMesh::rcPolyMesh()
 , regs()
 , flags()
 , areas()
+, edgeClearance()
 , nverts()
 , npolys()
 , maxpolys()
+, maxverts()
 , nvp()
 , bmin()
 , bmax()
@@ -255,6 +304,7 @@ rcPolyMesh::~rcPolyMesh()
 	rcFree(regs);
 	rcFree(flags);
 	rcFree(areas);
+	rcFree(edgeClearance);
 }
 
 rcPolyMeshDetail* rcAllocPolyMeshDetail()
@@ -281,9 +331,45 @@ rcPolyMeshDetail::rcPolyMeshDetail()
 , nmeshes()
 , nverts()
 , ntris()
+, maxmeshes()
+, maxverts()
+, maxtris()
 {
 }
 
+namespace
+{
+struct rcScopedJobs
+{
+	rcJobFunc func;
+	void* userData;
+	rcAllocator* allocator;
+};
+
+void runScopedJob(void* userData, const int jobIndex, const int workerIndex)
+{
+	const rcScopedJobs* jobs = (const rcScopedJobs*)userData;
+	rcAllocatorScope allocatorScope(jobs->allocator);
+	jobs->func(jobs->userData, jobIndex, workerIndex);
+}
+} // anonymous namespace
+
+void rcDispatchJobs(rcJobDispatcher* dispatcher, rcJobFunc func, void* userData, const int jobCount)
+{
+	rcAssert(dispatcher);
+	rcAllocator* allocator = rcGetAllocator();
+	if (!allocator)
+	{
+		dispatcher->dispatch(func, userData, jobCount);
+		return;
+	}
+	rcScopedJobs jobs;
+	jobs.func = func;
+	jobs.userData = userData;
+	jobs.allocator = allocator;
+	dispatcher->dispatch(runScopedJob, &jobs, jobCount);
+}
+
 void rcCalcBounds(const float* verts, int numVerts, float* minBounds, float* maxBounds)
 {
 	// Calculate bounding box.
@@ -324,6 +410,80 @@ bool rcCreateHeightfield(rcContext* context, rcHeightfield& heightfield, int siz
 	return true;
 }
 
+bool rcResetHeightfield(rcContext* context, rcHeightfield& heightfield, int sizeX, int sizeZ,
+                        const float* minBounds, const float* maxBounds,
+                        float cellSize, float cellHeight)
+{
+	rcAssert(context);
+
+	// Put every span of the pools back on the free list.
+	rcSpan* freeList = NULL;
+	for (rcSpanPool* pool = heightfield.pools; pool != NULL; pool = pool->next)
+	{
+		for (int i = pool->spanCount - 1; i >= 0; --i)
+		{
+			pool->items[i].next = freeList;
+			freeList = &pool->items[i];
+		}
+	}
+	heightfield.freelist = freeList;
+
+	const int numColumns = sizeX * sizeZ;
+	if (heightfield.spans == NULL || heightfield.width * heightfield.height != numColumns)
+	{
+		rcFree(heightfield.spans);
+		heightfield.spans = (rcSpan**)rcAlloc(sizeof(rcSpan*) * numColumns, RC_ALLOC_PERM);
+		if (!heightfield.spans)
+		{
+			heightfield.width = 0;
+			heightfield.height = 0;
+			context->log(RC_LOG_ERROR, "rcResetHeightfield: Out of memory 'spans' (%d).", numColumns);
+			return false;
+		}
+	}
+	memset(heightfield.spans, 0, sizeof(rcSpan*) * numColumns);
+
+	heightfield.width = sizeX;
+	heightfield.height = sizeZ;
+	rcVcopy(heightfield.bmin, minBounds);
+	rcVcopy(heightfield.bmax, maxBounds);
+	heightfield.cs = cellSize;
+	heightfield.ch = cellHeight;
+	return true;
+}
+
+bool rcCreateColumnHeightfield(rcContext* context, rcColumnHeightfield& heightfield, int sizeX, int sizeZ,
+                               const float* minBounds, const float* maxBounds,
+                               float cellSize, float cellHeight)
+{
+	rcAssert(context);
+
+	const int numColumns = sizeX * sizeZ;
+	if (heightfield.columns == NULL || heightfield.width * heightfield.height != numColumns)
+	{
+		rcFree(heightfield.columns);
+		heightfield.columns = (int*)rcAlloc(sizeof(int) * (numColumns + 1), RC_ALLOC_PERM);
+		if (!heightfield.columns)
+		{
+			heightfield.width = 0;
+			heightfield.height = 0;
+			context->log(RC_LOG_ERROR, "rcCreateColumnHeightfield: Out of memory 'columns' (%d).", numColumns + 1);
+			return false;
+		}
+	}
+	memset(heightfield.columns, 0, sizeof(int) * (numColumns + 1));
+	heightfield.spanCount = 0;
+	heightfield.fragmentCount = 0;
+
+	heightfield.width = sizeX;
+	heightfield.height = sizeZ;
+	rcVcopy(heightfield.bmin, minBounds);
+	rcVcopy(heightfield.bmax, maxBounds);
+	heightfield.cs = cellSize;
+	heightfield.ch = cellHeight;
+	return true;
+}
+
 static void calcTriNormal(const float* v0, const float* v1, const float* v2, float* faceNormal)
 {
 	float e0[3], e1[3];
@@ -333,50 +493,189 @@ static void calcTriNormal(const float* v0, const float* v1, const float* v2, flo
 	rcVnormalize(faceNormal);
 }
 
+#if defined(RC_TRIAREA_SSE2) || defined(RC_TRIAREA_NEON)
+/// Returns a bit mask of the four triangles whose face normal has a y component above @p limitY.
+/// The normals are computed with the same operations in the same order as calcTriNormal, so that
+/// the triangles are classified the same way, including the degenerate ones.
+///  @param[in]		tv		The vertices of the triangles by component. [(ax, ay, az, bx, by, bz, cx, cy, cz) * 4]
+static int calcWalkableTriangles4(const float* tv, const float limitY, const bool walkable)
+{
+#if defined(RC_TRIAREA_SSE2)
+	const __m128 ax = _mm_loadu_ps(&tv[0 * 4]);
+	const __m128 ay = _mm_loadu_ps(&tv[1 * 4]);
+	const __m128 az = _mm_loadu_ps(&tv[2 * 4]);
+	const __m128 e0x = _mm_sub_ps(_mm_loadu_ps(&tv[3 * 4]), ax);
+	const __m128 e0y = _mm_sub_ps(_mm_loadu_ps(&tv[4 * 4]), ay);
+	const __m128 e0z = _mm_sub_ps(_mm_loadu_ps(&tv[5 * 4]), az);
+	const __m128 e1x = _mm_sub_ps(_mm_loadu_ps(&tv[6 * 4]), ax);
+	const __m128 e1y = _mm_sub_ps(_mm_loadu_ps(&tv[7 * 4]), ay);
+	const __m128 e1z = _mm_sub_ps(_mm_loadu_ps(&tv[8 * 4]), az);
+	const __m128 nx = _mm_sub_ps(_mm_mul_ps(e0y, e1z), _mm_mul_ps(e0z, e1y));
+	const __m128 ny = _mm_sub_ps(_mm_mul_ps(e0z, e1x), _mm_mul_ps(e0x, e1z));
+	const __m128 nz = _mm_sub_ps(_mm_mul_ps(e0x, e1y), _mm_mul_ps(e0y, e1x));
+	const __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)));
+	const __m128 y = _mm_mul_ps(ny, _mm_div_ps(_mm_set1_ps(1.0f), len));
+	const __m128 limit = _mm_set1_ps(limitY);
+	return _mm_movemask_ps(walkable ? _mm_cmpgt_ps(y, limit) : _mm_cmple_ps(y, limit));
+#else
+	const float32x4_t ax = vld1q_f32(&tv[0 * 4]);
+	const float32x4_t ay = vld1q_f32(&tv[1 * 4]);
+	const float32x4_t az = vld1q_f32(&tv[2 * 4]);
+	const float32x4_t e0x = vsubq_f32(vld1q_f32(&tv[3 * 4]), ax);
+	const float32x4_t e0y = vsubq_f32(vld1q_f32(&tv[4 * 4]), ay);
+	const float32x4_t e0z = vsubq_f32(vld1q_f32(&tv[5 * 4]), az);
+	const float32x4_t e1x = vsubq_f32(vld1q_f32(&tv[6 * 4]), ax);
+	const float32x4_t e1y = vsubq_f32(vld1q_f32(&tv[7 * 4]), ay);
+	const float32x4_t e1z = vsubq_f32(vld1q_f32(&tv[8 * 4]), az);
+	const float32x4_t nx = vsubq_f32(vmulq_f32(e0y, e1z), vmulq_f32(e0z, e1y));
+	const float32x4_t ny = vsubq_f32(vmulq_f32(e0z, e1x), vmulq_f32(e0x, e1z));
+	const float32x4_t nz = vsubq_f32(vmulq_f32(e0x, e1y), vmulq_f32(e0y, e1x));
+	const float32x4_t len = vsqrtq_f32(vaddq_f32(vaddq_f32(vmulq_f32(nx, nx), vmulq_f32(ny, ny)), vmulq_f32(nz, nz)));
+	const float32x4_t y = vmulq_f32(ny, vdivq_f32(vdupq_n_f32(1.0f), len));
+	const float32x4_t limit = vdupq_n_f32(limitY);
+	const uint32x4_t mask = walkable ? vcgtq_f32(y, limit) : vcleq_f32(y, limit);
+	return (int)((vgetq_lane_u32(mask, 0) & 1) | (vgetq_lane_u32(mask, 1) & 2) |
+				 (vgetq_lane_u32(mask, 2) & 4) | (vgetq_lane_u32(mask, 3) & 8));
+#endif
+}
+#endif
+
+/// Sets the area id of the triangles in [first, last) which are walkable to @p area, or of the
+/// triangles which are not walkable if @p walkable is false.
+static void classifyTriangles(const float* verts, const int* tris, const int first, const int last,
+							  const float limitY, const bool walkable, const unsigned char area,
+							  unsigned char* triAreaIDs)
+{
+	int i = first;
+#if defined(RC_TRIAREA_SSE2) || defined(RC_TRIAREA_NEON)
+	for (; i + 4 <= last; i += 4)
+	{
+		float tv[9 * 4];
+		for (int k = 0; k < 4; ++k)
+		{
+			const int* tri = &tris[(i + k) * 3];
+			for (int c = 0; c < 3; ++c)
+			{
+				const float* v = &verts[tri[c] * 3];
+				tv[(c * 3 + 0) * 4 + k] = v[0];
+				tv[(c * 3 + 1) * 4 + k] = v[1];
+				tv[(c * 3 + 2) * 4 + k] = v[2];
+			}
+		}
+		const int mask = calcWalkableTriangles4(tv, limitY, walkable);
+		for (int k = 0; k < 4; ++k)
+		{
+			if (mask & (1 << k))
+				triAreaIDs[i + k] = area;
+		}
+	}
+#endif
+	float faceNormal[3];
+	for (; i < last; ++i)
+	{
+		const int* tri = &tris[i * 3];
+		calcTriNormal(&verts[tri[0] * 3], &verts[tri[1] * 3], &verts[tri[2] * 3], faceNormal);
+		// Check if the face is walkable.
+		if (walkable ? faceNormal[1] > limitY : faceNormal[1] <= limitY)
+			triAreaIDs[i] = area;
+	}
+}
+
+struct rcTriAreaJob
+{
+	const float* verts;
+	const int* tris;
+	int numTris;
+	int trisPerJob;
+	float limitY;
+	bool walkable;
+	unsigned char area;
+	unsigned char* triAreaIDs;
+};
+
+static void classifyTrianglesJob(void* userData, const int jobIndex, const int /*workerIndex*/)
+{
+	const rcTriAreaJob* job = (const rcTriAreaJob*)userData;
+	const int first = jobIndex * job->trisPerJob;
+	const int last = rcMin(first + job->trisPerJob, job->numTris);
+	classifyTriangles(job->verts, job->tris, first, last, job->limitY, job->walkable, job->area, job->triAreaIDs);
+}
+
+// The triangles are independent, large meshes are split into a few ranges per worker.
+static void classifyAllTriangles(const float* verts, const int* tris, const int numTris, const float limitY,
+								 const bool walkable, const unsigned char area, unsigned char* triAreaIDs,
+								 rcJobDispatcher* dispatcher)
+{
+	const int jobCount = dispatcher ? rcMax(1, rcMin(numTris / 4096, dispatcher->getWorkerCount() * 4)) : 1;
+	if (jobCount == 1)
+	{
+		classifyTriangles(verts, tris, 0, numTris, limitY, walkable, area, triAreaIDs);
+		return;
+	}
+
+	rcTriAreaJob job;
+	job.verts = verts;
+	job.tris = tris;
+	job.numTris = numTris;
+	job.trisPerJob = (numTris + jobCount - 1) / jobCount;
+	job.limitY = limitY;
+	job.walkable = walkable;
+	job.area = area;
+	job.triAreaIDs = triAreaIDs;
+	rcDispatchJobs(dispatcher, classifyTrianglesJob, &job, jobCount);
+}
+
 void rcMarkWalkableTriangles(rcContext* context, const float walkableSlopeAngle,
                              const float* verts, const int numVerts,
                              const int* tris, const int numTris,
-                             unsigned char* triAreaIDs)
+                             unsigned char* triAreaIDs, rcJobDispatcher* dispatcher)
 {
 	rcIgnoreUnused(context);
 	rcIgnoreUnused(numVerts);
 
 	const float walkableThr = cosf(walkableSlopeAngle / 180.0f * RC_PI);
-
-	float norm[3];
-
-	for (int i = 0; i < numTris; ++i)
-	{
-		const int* tri = &tris[i * 3];
-		calcTriNormal(&verts[tri[0] * 3], &verts[tri[1] * 3], &verts[tri[2] * 3], norm);
-		// Check if the face is walkable.
-		if (norm[1] > walkableThr)
-		{
-			triAreaIDs[i] = RC_WALKABLE_AREA;
-		}
-	}
+	classifyAllTriangles(verts, tris, numTris, walkableThr, true, RC_WALKABLE_AREA, triAreaIDs, dispatcher);
 }
 
 void rcClearUnwalkableTriangles(rcContext* context, const float walkableSlopeAngle,
                                 const float* verts, int numVerts,
                                 const int* tris, int numTris,
-                                unsigned char* triAreaIDs)
+                                unsigned char* triAreaIDs, rcJobDispatcher* dispatcher)
 {
 	rcIgnoreUnused(context);
 	rcIgnoreUnused(numVerts);
 
 	// The minimum Y value for a face normal of a triangle with a walkable slope.
 	const float walkableLimitY = cosf(walkableSlopeAngle / 180.0f * RC_PI);
+	classifyAllTriangles(verts, tris, numTris, walkableLimitY, false, RC_NULL_AREA, triAreaIDs, dispatcher);
+}
 
-	float faceNormal[3];
-	for (int i = 0; i < numTris; ++i)
+void rcMarkWalkableHeightmapCells(rcContext* context, const float walkableSlopeAngle,
+                                  const float* heights, const int sampleWidth, const int sampleHeight,
+                                  const float cellSize, unsigned char* cellAreaIDs)
+{
+	rcIgnoreUnused(context);
+
+	const float walkableThr = cosf(walkableSlopeAngle / 180.0f * RC_PI);
+	// The normal of a triangle with the height gradient (gx, gz) has the y component 1 / sqrt(1 + gx^2 + gz^2).
+	const float maxGradientSqr = 1.0f / rcSqr(walkableThr) - 1.0f;
+	const float inverseCellSize = 1.0f / cellSize;
+	const int cellWidth = sampleWidth - 1;
+
+	for (int z = 0; z < sampleHeight - 1; ++z)
 	{
-		const int* tri = &tris[i * 3];
-		calcTriNormal(&verts[tri[0] * 3], &verts[tri[1] * 3], &verts[tri[2] * 3], faceNormal);
-		// Check if the face is walkable.
-		if (faceNormal[1] <= walkableLimitY)
+		for (int x = 0; x < cellWidth; ++x)
 		{
-			triAreaIDs[i] = RC_NULL_AREA;
+			// The triangles (x,z)-(x,z+1)-(x+1,z+1) and (x,z)-(x+1,z+1)-(x+1,z).
+			const float* h = &heights[x + z * sampleWidth];
+			const float gx0 = (h[sampleWidth + 1] - h[sampleWidth]) * inverseCellSize;
+			const float gz0 = (h[sampleWidth] - h[0]) * inverseCellSize;
+			const float gx1 = (h[1] - h[0]) * inverseCellSize;
+			const float gz1 = (h[sampleWidth + 1] - h[1]) * inverseCellSize;
+			if (rcSqr(gx0) + rcSqr(gz0) < maxGradientSqr && rcSqr(gx1) + rcSqr(gz1) < maxGradientSqr)
+			{
+				cellAreaIDs[x + z * cellWidth] = RC_WALKABLE_AREA;
+			}
 		}
 	}
 }
@@ -400,16 +699,51 @@ int rcGetHeightFieldSpanCount(rcContext* context, const rcHeightfield& heightfie
 	return spanCount;
 }
 
-bool rcBuildCompactHeightfield(rcContext* context, const int walkableHeight, const int walkableClimb,
-                               const rcHeightfield& heightfield, rcCompactHeightfield& compactHeightfield)
+/// Allocates the arrays of a compact heightfield and fills in its header, before its cells and spans are added.
+template<class Heightfield>
+static bool initCompactHeightfield(rcContext* context, const int walkableHeight, const int walkableClimb,
+								   const Heightfield& heightfield, const int spanCount,
+								   rcCompactHeightfield& compactHeightfield)
 {
-	rcAssert(context);
-
-	rcScopedTimer timer(context, RC_TIMER_BUILD_COMPACTHEIGHTFIELD);
-
 	const int xSize = heightfield.width;
 	const int zSize = heightfield.height;
-	const int spanCount = rcGetHeightFieldSpanCount(context, heightfield);
+
+	// Keep the arrays of a previous build when they are large enough.
+	if (!compactHeightfield.cells || compactHeightfield.width * compactHeightfield.height != xSize * zSize)
+	{
+		rcFree(compactHeightfield.cells);
+		compactHeightfield.cells = (rcCompactCell*)rcAlloc(sizeof(rcCompactCell) * xSize * zSize, RC_ALLOC_PERM);
+		if (!compactHeightfield.cells)
+		{
+			compactHeightfield.width = 0;
+			compactHeightfield.height = 0;
+			context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.cells' (%d)", xSize * zSize);
+			return false;
+		}
+	}
+	if (!compactHeightfield.spans || !compactHeightfield.areas || compactHeightfield.spanCapacity < spanCount)
+	{
+		rcFree(compactHeightfield.spans);
+		rcFree(compactHeightfield.areas);
+		compactHeightfield.areas = NULL;
+		compactHeightfield.spanCapacity = 0;
+		compactHeightfield.spans = (rcCompactSpan*)rcAlloc(sizeof(rcCompactSpan) * spanCount, RC_ALLOC_PERM);
+		if (!compactHeightfield.spans)
+		{
+			context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.spans' (%d)", spanCount);
+			return false;
+		}
+		compactHeightfield.areas = (unsigned char*)rcAlloc(sizeof(unsigned char) * spanCount, RC_ALLOC_PERM);
+		if (!compactHeightfield.areas)
+		{
+			context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.areas' (%d)", spanCount);
+			return false;
+		}
+		compactHeightfield.spanCapacity = spanCount;
+	}
+	// The distance field of a previous build does not match the new spans.
+	rcFree(compactHeightfield.dist);
+	compactHeightfield.dist = NULL;
 
 	// Fill in header.
 	compactHeightfield.width = xSize;
@@ -423,62 +757,20 @@ bool rcBuildCompactHeightfield(rcContext* context, const int walkableHeight, con
 	compactHeightfield.bmax[1] += walkableHeight * heightfield.ch;
 	compactHeightfield.cs = heightfield.cs;
 	compactHeightfield.ch = heightfield.ch;
-	compactHeightfield.cells = (rcCompactCell*)rcAlloc(sizeof(rcCompactCell) * xSize * zSize, RC_ALLOC_PERM);
-	if (!compactHeightfield.cells)
-	{
-		context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.cells' (%d)", xSize * zSize);
-		return false;
-	}
 	memset(compactHeightfield.cells, 0, sizeof(rcCompactCell) * xSize * zSize);
-	compactHeightfield.spans = (rcCompactSpan*)rcAlloc(sizeof(rcCompactSpan) * spanCount, RC_ALLOC_PERM);
-	if (!compactHeightfield.spans)
-	{
-		context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.spans' (%d)", spanCount);
-		return false;
-	}
 	memset(compactHeightfield.spans, 0, sizeof(rcCompactSpan) * spanCount);
-	compactHeightfield.areas = (unsigned char*)rcAlloc(sizeof(unsigned char) * spanCount, RC_ALLOC_PERM);
-	if (!compactHeightfield.areas)
-	{
-		context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.areas' (%d)", spanCount);
-		return false;
-	}
 	memset(compactHeightfield.areas, RC_NULL_AREA, sizeof(unsigned char) * spanCount);
 
-	const int MAX_HEIGHT = 0xffff;
+	return true;
+}
 
-	// Fill in cells and spans.
-	int currentCellIndex = 0;
-	const int numColumns = xSize * zSize;
-	for (int columnIndex = 0; columnIndex < numColumns; ++columnIndex)
-	{
-		const rcSpan* span = heightfield.spans[columnIndex];
-			
-		// If there are no spans at this cell, just leave the data to index=0, count=0.
-		if (span == NULL)
-		{
-			continue;
-		}
-			
-		rcCompactCell& cell = compactHeightfield.cells[columnIndex];
-		cell.index = currentCellIndex;
-		cell.count = 0;
+/// Finds the neighbour connections of the spans of a compact heightfield.
+static void connectCompactSpans(rcContext* context, const int walkableHeight, const int walkableClimb,
+								rcCompactHeightfield& compactHeightfield)
+{
+	const int xSize = compactHeightfield.width;
+	const int zSize = compactHeightfield.height;
 
-		for (; span != NULL; span = span->next)
-		{
-			if (span->area != RC_NULL_AREA)
-			{
-				const int bot = (int)span->smax;
-				const int top = span->next ? (int)span->next->smin : MAX_HEIGHT;
-				compactHeightfield.spans[currentCellIndex].y = (unsigned short)rcClamp(bot, 0, 0xffff);
-				compactHeightfield.spans[currentCellIndex].h = (unsigned char)rcClamp(top - bot, 0, 0xff);
-				compactHeightfield.areas[currentCellIndex] = span->area;
-				currentCellIndex++;
-				cell.count++;
-			}
-		}
-	}
-	
 	// Find neighbour connections.
 	const int MAX_LAYERS = RC_NOT_CONNECTED - 1;
 	int maxLayerIndex = 0;
@@ -537,6 +829,191 @@ bool rcBuildCompactHeightfield(rcContext* context, const int walkableHeight, con
 		context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Heightfield has too many layers %d (max: %d)",
 		         maxLayerIndex, MAX_LAYERS);
 	}
+}
+
+bool rcBuildCompactHeightfield(rcContext* context, const int walkableHeight, const int walkableClimb,
+                               const rcHeightfield& heightfield, rcCompactHeightfield& compactHeightfield)
+{
+	rcAssert(context);
+
+	rcScopedTimer timer(context, RC_TIMER_BUILD_COMPACTHEIGHTFIELD);
+
+	const int xSize = heightfield.width;
+	const int zSize = heightfield.height;
+	const int spanCount = rcGetHeightFieldSpanCount(context, heightfield);
+	if (!initCompactHeightfield(context, walkableHeight, walkableClimb, heightfield, spanCount, compactHeightfield))
+	{
+		return false;
+	}
+
+	const int MAX_HEIGHT = 0xffff;
+
+	// Fill in cells and spans.
+	int currentCellIndex = 0;
+	const int numColumns = xSize * zSize;
+	for (int columnIndex = 0; columnIndex < numColumns; ++columnIndex)
+	{
+		const rcSpan* span = heightfield.spans[columnIndex];
+			
+		// If there are no spans at this cell, just leave the data to index=0, count=0.
+		if (span == NULL)
+		{
+			continue;
+		}
+			
+		rcCompactCell& cell = compactHeightfield.cells[columnIndex];
+		cell.index = currentCellIndex;
+		cell.count = 0;
+
+		for (; span != NULL; span = span->next)
+		{
+			if (span->area != RC_NULL_AREA)
+			{
+				const int bot = (int)span->smax;
+				const int top = span->next ? (int)span->next->smin : MAX_HEIGHT;
+				compactHeightfield.spans[currentCellIndex].y = (unsigned short)rcClamp(bot, 0, 0xffff);
+				compactHeightfield.spans[currentCellIndex].h = (unsigned char)rcClamp(top - bot, 0, 0xff);
+				compactHeightfield.areas[currentCellIndex] = span->area;
+				currentCellIndex++;
+				cell.count++;
+			}
+		}
+	}
+
+	connectCompactSpans(context, walkableHeight, walkableClimb, compactHeightfield);
+
+	return true;
+}
+
+bool rcBuildCompactHeightfield(rcContext* context, const int walkableHeight, const int walkableClimb,
+                               const rcColumnHeightfield& heightfield, rcCompactHeightfield& compactHeightfield)
+{
+	rcAssert(context);
+	rcAssert(heightfield.fragmentCount == 0);
+
+	rcScopedTimer timer(context, RC_TIMER_BUILD_COMPACTHEIGHTFIELD);
+
+	const int numColumns = heightfield.width * heightfield.height;
+	int spanCount = 0;
+	for (int i = 0; i < heightfield.spanCount; ++i)
+	{
+		if (heightfield.spans[i].area != RC_NULL_AREA)
+		{
+			spanCount++;
+		}
+	}
+	if (!initCompactHeightfield(context, walkableHeight, walkableClimb, heightfield, spanCount, compactHeightfield))
+	{
+		return false;
+	}
+
+	const int MAX_HEIGHT = 0xffff;
+
+	// Fill in cells and spans, the columns are read in the order they are stored.
+	int currentCellIndex = 0;
+	for (int columnIndex = 0; columnIndex < numColumns; ++columnIndex)
+	{
+		const int first = heightfield.columns[columnIndex];
+		const int last = heightfield.columns[columnIndex + 1];
+		if (first == last)
+		{
+			continue;
+		}
+
+		rcCompactCell& cell = compactHeightfield.cells[columnIndex];
+		cell.index = currentCellIndex;
+		cell.count = 0;
+
+		for (int i = first; i < last; ++i)
+		{
+			const rcColumnSpan& span = heightfield.spans[i];
+			if (span.area != RC_NULL_AREA)
+			{
+				const int bot = (int)span.smax;
+				const int top = i + 1 < last ? (int)heightfield.spans[i + 1].smin : MAX_HEIGHT;
+				compactHeightfield.spans[currentCellIndex].y = (unsigned short)rcClamp(bot, 0, 0xffff);
+				compactHeightfield.spans[currentCellIndex].h = (unsigned char)rcClamp(top - bot, 0, 0xff);
+				compactHeightfield.areas[currentCellIndex] = span.area;
+				currentCellIndex++;
+				cell.count++;
+			}
+		}
+	}
+
+	connectCompactSpans(context, walkableHeight, walkableClimb, compactHeightfield);
+
+	return true;
+}
+
+bool rcCopyCompactHeightfield(rcContext* context, const rcCompactHeightfield& src, rcCompactHeightfield& dst)
+{
+	rcAssert(context);
+
+	const int cellCount = src.width * src.height;
+
+	// Keep the arrays of a previous build when they are large enough.
+	if (!dst.cells || dst.width * dst.height != cellCount)
+	{
+		rcFree(dst.cells);
+		dst.cells = (rcCompactCell*)rcAlloc(sizeof(rcCompactCell) * cellCount, RC_ALLOC_PERM);
+		if (!dst.cells)
+		{
+			dst.width = 0;
+			dst.height = 0;
+			context->log(RC_LOG_ERROR, "rcCopyCompactHeightfield: Out of memory 'dst.cells' (%d)", cellCount);
+			return false;
+		}
+	}
+	if (!dst.spans || !dst.areas || dst.spanCapacity < src.spanCount)
+	{
+		rcFree(dst.spans);
+		rcFree(dst.areas);
+		dst.areas = NULL;
+		dst.spanCapacity = 0;
+		dst.spans = (rcCompactSpan*)rcAlloc(sizeof(rcCompactSpan) * src.spanCount, RC_ALLOC_PERM);
+		if (!dst.spans)
+		{
+			context->log(RC_LOG_ERROR, "rcCopyCompactHeightfield: Out of memory 'dst.spans' (%d)", src.spanCount);
+			return false;
+		}
+		dst.areas = (unsigned char*)rcAlloc(sizeof(unsigned char) * src.spanCount, RC_ALLOC_PERM);
+		if (!dst.areas)
+		{
+			context->log(RC_LOG_ERROR, "rcCopyCompactHeightfield: Out of memory 'dst.areas' (%d)", src.spanCount);
+			return false;
+		}
+		dst.spanCapacity = src.spanCount;
+	}
+	rcFree(dst.dist);
+	dst.dist = NULL;
+
+	dst.width = src.width;
+	dst.height = src.height;
+	dst.spanCount = src.spanCount;
+	dst.walkableHeight = src.walkableHeight;
+	dst.walkableClimb = src.walkableClimb;
+	dst.borderSize = src.borderSize;
+	dst.maxDistance = src.maxDistance;
+	dst.maxRegions = src.maxRegions;
+	rcVcopy(dst.bmin, src.bmin);
+	rcVcopy(dst.bmax, src.bmax);
+	dst.cs = src.cs;
+	dst.ch = src.ch;
+
+	memcpy(dst.cells, src.cells, sizeof(rcCompactCell) * cellCount);
+	memcpy(dst.spans, src.spans, sizeof(rcCompactSpan) * src.spanCount);
+	memcpy(dst.areas, src.areas, sizeof(unsigned char) * src.spanCount);
+
+	if (src.dist)
+	{
+		dst.dist = (unsigned short*)rcAlloc(sizeof(unsigned short) * src.spanCount, RC_ALLOC_PERM);
+		if (!dst.dist)
+		{
+			context->log(RC_LOG_ERROR, "rcCopyCompactHeightfield: Out of memory 'dst.dist' (%d)", src.spanCount);
+			return false;
+		}
+		memcpy(dst.dist, src.dist, sizeof(unsigned short) * src.spanCount);
+	}
 
 	return true;
 }
@@ -31,6 +31,12 @@ static void rcFreeDefault(void *ptr)
 static rcAllocFunc* sRecastAllocFunc = rcAllocDefault;
 static rcFreeFunc* sRecastFreeFunc = rcFreeDefault;
 
+/// The temporary memory arena bound to the calling thread.
+static RC_THREAD_LOCAL rcTempArena* sTempArena = 0;
+
+/// The allocator bound to the calling thread.
+static RC_THREAD_LOCAL rcAllocator* sAllocator = 0;
+
 void rcAllocSetCustom(rcAllocFunc* allocFunc, rcFreeFunc* freeFunc)
 {
 	sRecastAllocFunc = allocFunc ? allocFunc : rcAllocDefault;
@@ -39,6 +45,14 @@ void rcAllocSetCustom(rcAllocFunc* allocFunc, rcFreeFunc* freeFunc)
 
 void* rcAlloc(size_t size, rcAllocHint hint)
 {
+	if (hint == RC_ALLOC_TEMP && sTempArena)
+	{
+		return sTempArena->alloc(size);
+	}
+	if (sAllocator)
+	{
+		return sAllocator->alloc(size, hint);
+	}
 	return sRecastAllocFunc(size, hint);
 }
 
@@ -46,6 +60,192 @@ void rcFree(void* ptr)
 {
 	if (ptr != NULL)
 	{
+		// Arena memory is released by rcTempArena::reset.
+		if (sTempArena && sTempArena->owns(ptr))
+		{
+			return;
+		}
+		if (sAllocator)
+		{
+			sAllocator->free(ptr);
+			return;
+		}
 		sRecastFreeFunc(ptr);
 	}
 }
+
+rcAllocator::~rcAllocator()
+{
+	// Defined out of line to fix the weak v-tables warning
+}
+
+void* rcAllocator::alloc(size_t size, rcAllocHint hint)
+{
+	return sRecastAllocFunc(size, hint);
+}
+
+void rcAllocator::free(void* ptr)
+{
+	sRecastFreeFunc(ptr);
+}
+
+rcAllocatorScope::rcAllocatorScope(rcAllocator* allocator) :
+	m_previous(sAllocator)
+{
+	sAllocator = allocator;
+}
+
+rcAllocatorScope::~rcAllocatorScope()
+{
+	sAllocator = m_previous;
+}
+
+rcAllocator* rcGetAllocator()
+{
+	return sAllocator;
+}
+
+static const size_t RC_ARENA_ALIGN = 16;
+
+static size_t rcAlignArenaSize(size_t size)
+{
+	return (size + RC_ARENA_ALIGN - 1) & ~(RC_ARENA_ALIGN - 1);
+}
+
+/// The header of an arena block, followed by the memory of the block.
+struct rcTempArena::Block
+{
+	Block* next;
+	unsigned char* mem;	///< The aligned start of the memory of the block.
+	size_t size;		///< The size of the memory of the block.
+	size_t top;			///< The offset of the first free byte.
+};
+
+rcTempArena::rcTempArena() :
+	m_allocator(0),
+	m_blocks(0),
+	m_blockSize(0),
+	m_used(0),
+	m_peak(0),
+	m_capacity(0)
+{
+}
+
+rcTempArena::~rcTempArena()
+{
+	purge();
+}
+
+void rcTempArena::purge()
+{
+	while (m_blocks)
+	{
+		Block* next = m_blocks->next;
+		if (m_allocator)
+		{
+			m_allocator->free(m_blocks);
+		}
+		else
+		{
+			sRecastFreeFunc(m_blocks);
+		}
+		m_blocks = next;
+	}
+	m_used = 0;
+	m_capacity = 0;
+}
+
+bool rcTempArena::init(size_t blockSize, rcAllocator* allocator)
+{
+	rcAssert(blockSize > 0);
+	purge();
+	m_allocator = allocator;
+	m_peak = 0;
+	m_blockSize = rcAlignArenaSize(blockSize);
+	return addBlock(m_blockSize);
+}
+
+bool rcTempArena::addBlock(size_t size)
+{
+	// The allocator may only align to pointer size, leave room to align the memory after the header.
+	const size_t blockSize = sizeof(Block) + RC_ARENA_ALIGN + size;
+	Block* block = (Block*)(m_allocator ? m_allocator->alloc(blockSize, RC_ALLOC_TEMP) : sRecastAllocFunc(blockSize, RC_ALLOC_TEMP));
+	if (!block)
+	{
+		return false;
+	}
+	const uintptr_t mem = (uintptr_t)(block + 1);
+	block->mem = (unsigned char*)((mem + RC_ARENA_ALIGN - 1) & ~(uintptr_t)(RC_ARENA_ALIGN - 1));
+	block->next = m_blocks;
+	block->size = size;
+	block->top = 0;
+	m_blocks = block;
+	m_capacity += size;
+	return true;
+}
+
+void* rcTempArena::alloc(size_t size)
+{
+	size = rcAlignArenaSize(size > 0 ? size : 1);
+	if (!m_blocks || m_blocks->size - m_blocks->top < size)
+	{
+		if (!addBlock(size > m_blockSize ? size : m_blockSize))
+		{
+			return NULL;
+		}
+	}
+	unsigned char* ptr = m_blocks->mem + m_blocks->top;
+	m_blocks->top += size;
+	m_used += size;
+	if (m_used > m_peak)
+	{
+		m_peak = m_used;
+	}
+	return ptr;
+}
+
+bool rcTempArena::owns(const void* ptr) const
+{
+	const unsigned char* p = (const unsigned char*)ptr;
+	for (const Block* block = m_blocks; block; block = block->next)
+	{
+		if (p >= block->mem && p < block->mem + block->size)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void rcTempArena::reset()
+{
+	if (m_blocks && m_blocks->next)
+	{
+		// Replace the blocks by one, so that the next build of the same size does not need to add blocks.
+		const size_t capacity = m_capacity;
+		purge();
+		m_blockSize = capacity;
+		addBlock(capacity);
+	}
+	else if (m_blocks)
+	{
+		m_blocks->top = 0;
+	}
+	m_used = 0;
+}
+
+rcTempArenaScope::rcTempArenaScope(rcTempArena* arena) :
+	m_previous(sTempArena)
+{
+	sTempArena = arena;
+}
+
+rcTempArenaScope::~rcTempArenaScope()
+{
+	sTempArena = m_previous;
+}
+
+rcTempArena* rcGetTempArena()
+{
+	return sTempArena;
+}
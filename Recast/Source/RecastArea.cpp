@@ -22,6 +22,18 @@
 
 #include <string.h> // for memcpy and memset
 
+// Define RC_NO_SIMD to use the scalar median filter and erosion on all platforms.
+#if defined(RC_NO_SIMD)
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RC_AREA_SIMD
+#define RC_AREA_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RC_AREA_SIMD
+#define RC_AREA_NEON
+#endif
+
 /// Sorts the given data in-place using insertion sort.
 ///
 /// @param	data		The data to sort
@@ -72,204 +84,616 @@ static bool pointInPoly(int numVerts, const float* verts, const float* point)
 	return inPoly;
 }
 
-bool rcErodeWalkableArea(rcContext* context, const int erosionRadius, rcCompactHeightfield& compactHeightfield)
+/// Sets the distance of a span to zero when it is on the boundary of the walkable area, for
+/// #rcErodeWalkableArea.
+static void markBoundarySpan(const rcCompactHeightfield& compactHeightfield, unsigned char* distanceToBoundary,
+							 const int x, const int z, const int spanIndex)
 {
-	rcAssert(context != NULL);
+	if (compactHeightfield.areas[spanIndex] == RC_NULL_AREA)
+	{
+		distanceToBoundary[spanIndex] = 0;
+		return;
+	}
+	const rcCompactSpan& span = compactHeightfield.spans[spanIndex];
+
+	// Check that there is a non-null adjacent span in each of the 4 cardinal directions.
+	int neighborCount = 0;
+	for (int direction = 0; direction < 4; ++direction)
+	{
+		const int neighborConnection = rcGetCon(span, direction);
+		if (neighborConnection == RC_NOT_CONNECTED)
+		{
+			break;
+		}
+
+		const int neighborX = x + rcGetDirOffsetX(direction);
+		const int neighborZ = z + rcGetDirOffsetY(direction);
+		const int neighborSpanIndex = (int)compactHeightfield.cells[neighborX + neighborZ * compactHeightfield.width].index + neighborConnection;
+
+		if (compactHeightfield.areas[neighborSpanIndex] == RC_NULL_AREA)
+		{
+			break;
+		}
+		neighborCount++;
+	}
 
+	// At least one missing neighbour, so this is a boundary cell.
+	if (neighborCount != 4)
+	{
+		distanceToBoundary[spanIndex] = 0;
+	}
+}
+
+/// Lowers the distance of a span to the distances of its neighbours before it in scan order,
+/// the first pass of the chamfer distance transform of #rcErodeWalkableArea.
+static void erodePass1Span(const rcCompactHeightfield& compactHeightfield, unsigned char* distanceToBoundary,
+						   const int x, const int z, const int spanIndex)
+{
 	const int xSize = compactHeightfield.width;
-	const int zSize = compactHeightfield.height;
-	const int& zStride = xSize; // For readability
+	const rcCompactSpan& span = compactHeightfield.spans[spanIndex];
+	unsigned char newDistance;
 
-	rcScopedTimer timer(context, RC_TIMER_ERODE_AREA);
+	if (rcGetCon(span, 0) != RC_NOT_CONNECTED)
+	{
+		// (-1,0)
+		const int aX = x + rcGetDirOffsetX(0);
+		const int aY = z + rcGetDirOffsetY(0);
+		const int aIndex = (int)compactHeightfield.cells[aX + aY * xSize].index + rcGetCon(span, 0);
+		const rcCompactSpan& aSpan = compactHeightfield.spans[aIndex];
+		newDistance = (unsigned char)rcMin((int)distanceToBoundary[aIndex] + 2, 255);
+		if (newDistance < distanceToBoundary[spanIndex])
+		{
+			distanceToBoundary[spanIndex] = newDistance;
+		}
 
-	unsigned char* distanceToBoundary = (unsigned char*)rcAlloc(sizeof(unsigned char) * compactHeightfield.spanCount,
-	                                                            RC_ALLOC_TEMP);
-	if (!distanceToBoundary)
+		// (-1,-1)
+		if (rcGetCon(aSpan, 3) != RC_NOT_CONNECTED)
+		{
+			const int bX = aX + rcGetDirOffsetX(3);
+			const int bY = aY + rcGetDirOffsetY(3);
+			const int bIndex = (int)compactHeightfield.cells[bX + bY * xSize].index + rcGetCon(aSpan, 3);
+			newDistance = (unsigned char)rcMin((int)distanceToBoundary[bIndex] + 3, 255);
+			if (newDistance < distanceToBoundary[spanIndex])
+			{
+				distanceToBoundary[spanIndex] = newDistance;
+			}
+		}
+	}
+	if (rcGetCon(span, 3) != RC_NOT_CONNECTED)
 	{
-		context->log(RC_LOG_ERROR, "erodeWalkableArea: Out of memory 'dist' (%d).", compactHeightfield.spanCount);
-		return false;
+		// (0,-1)
+		const int aX = x + rcGetDirOffsetX(3);
+		const int aY = z + rcGetDirOffsetY(3);
+		const int aIndex = (int)compactHeightfield.cells[aX + aY * xSize].index + rcGetCon(span, 3);
+		const rcCompactSpan& aSpan = compactHeightfield.spans[aIndex];
+		newDistance = (unsigned char)rcMin((int)distanceToBoundary[aIndex] + 2, 255);
+		if (newDistance < distanceToBoundary[spanIndex])
+		{
+			distanceToBoundary[spanIndex] = newDistance;
+		}
+
+		// (1,-1)
+		if (rcGetCon(aSpan, 2) != RC_NOT_CONNECTED)
+		{
+			const int bX = aX + rcGetDirOffsetX(2);
+			const int bY = aY + rcGetDirOffsetY(2);
+			const int bIndex = (int)compactHeightfield.cells[bX + bY * xSize].index + rcGetCon(aSpan, 2);
+			newDistance = (unsigned char)rcMin((int)distanceToBoundary[bIndex] + 3, 255);
+			if (newDistance < distanceToBoundary[spanIndex])
+			{
+				distanceToBoundary[spanIndex] = newDistance;
+			}
+		}
 	}
-	memset(distanceToBoundary, 0xff, sizeof(unsigned char) * compactHeightfield.spanCount);
-	
-	// Mark boundary cells.
-	for (int z = 0; z < zSize; ++z)
+}
+
+/// Lowers the distance of a span to the distances of its neighbours after it in scan order,
+/// the second pass of the chamfer distance transform of #rcErodeWalkableArea.
+static void erodePass2Span(const rcCompactHeightfield& compactHeightfield, unsigned char* distanceToBoundary,
+						   const int x, const int z, const int spanIndex)
+{
+	const int xSize = compactHeightfield.width;
+	const rcCompactSpan& span = compactHeightfield.spans[spanIndex];
+	unsigned char newDistance;
+
+	if (rcGetCon(span, 2) != RC_NOT_CONNECTED)
 	{
-		for (int x = 0; x < xSize; ++x)
+		// (1,0)
+		const int aX = x + rcGetDirOffsetX(2);
+		const int aY = z + rcGetDirOffsetY(2);
+		const int aIndex = (int)compactHeightfield.cells[aX + aY * xSize].index + rcGetCon(span, 2);
+		const rcCompactSpan& aSpan = compactHeightfield.spans[aIndex];
+		newDistance = (unsigned char)rcMin((int)distanceToBoundary[aIndex] + 2, 255);
+		if (newDistance < distanceToBoundary[spanIndex])
 		{
-			const rcCompactCell& cell = compactHeightfield.cells[x + z * zStride];
-			for (int spanIndex = (int)cell.index, maxSpanIndex = (int)(cell.index + cell.count); spanIndex < maxSpanIndex; ++spanIndex)
+			distanceToBoundary[spanIndex] = newDistance;
+		}
+
+		// (1,1)
+		if (rcGetCon(aSpan, 1) != RC_NOT_CONNECTED)
+		{
+			const int bX = aX + rcGetDirOffsetX(1);
+			const int bY = aY + rcGetDirOffsetY(1);
+			const int bIndex = (int)compactHeightfield.cells[bX + bY * xSize].index + rcGetCon(aSpan, 1);
+			newDistance = (unsigned char)rcMin((int)distanceToBoundary[bIndex] + 3, 255);
+			if (newDistance < distanceToBoundary[spanIndex])
 			{
-				if (compactHeightfield.areas[spanIndex] == RC_NULL_AREA)
+				distanceToBoundary[spanIndex] = newDistance;
+			}
+		}
+	}
+	if (rcGetCon(span, 1) != RC_NOT_CONNECTED)
+	{
+		// (0,1)
+		const int aX = x + rcGetDirOffsetX(1);
+		const int aY = z + rcGetDirOffsetY(1);
+		const int aIndex = (int)compactHeightfield.cells[aX + aY * xSize].index + rcGetCon(span, 1);
+		const rcCompactSpan& aSpan = compactHeightfield.spans[aIndex];
+		newDistance = (unsigned char)rcMin((int)distanceToBoundary[aIndex] + 2, 255);
+		if (newDistance < distanceToBoundary[spanIndex])
+		{
+			distanceToBoundary[spanIndex] = newDistance;
+		}
+
+		// (-1,1)
+		if (rcGetCon(aSpan, 0) != RC_NOT_CONNECTED)
+		{
+			const int bX = aX + rcGetDirOffsetX(0);
+			const int bY = aY + rcGetDirOffsetY(0);
+			const int bIndex = (int)compactHeightfield.cells[bX + bY * xSize].index + rcGetCon(aSpan, 0);
+			newDistance = (unsigned char)rcMin((int)distanceToBoundary[bIndex] + 3, 255);
+			if (newDistance < distanceToBoundary[spanIndex])
+			{
+				distanceToBoundary[spanIndex] = newDistance;
+			}
+		}
+	}
+}
+
+/// Runs a pass of the distance transform serially over all spans of a row.
+static void erodeRow(const rcCompactHeightfield& compactHeightfield, unsigned char* distanceToBoundary,
+					 const int z, const bool secondPass)
+{
+	const int xSize = compactHeightfield.width;
+	for (int i = 0; i < xSize; ++i)
+	{
+		const int x = secondPass ? xSize - 1 - i : i;
+		const rcCompactCell& cell = compactHeightfield.cells[x + z * xSize];
+		const int maxSpanIndex = (int)(cell.index + cell.count);
+		for (int spanIndex = (int)cell.index; spanIndex < maxSpanIndex; ++spanIndex)
+		{
+			if (secondPass)
+			{
+				erodePass2Span(compactHeightfield, distanceToBoundary, x, z, spanIndex);
+			}
+			else
+			{
+				erodePass1Span(compactHeightfield, distanceToBoundary, x, z, spanIndex);
+			}
+		}
+	}
+}
+
+#if defined(RC_AREA_SIMD)
+
+static bool s_simdAreaFilters = true;
+
+// 16 unsigned bytes, only using lane-wise minimums, maximums, saturating adds, compares and
+// selects, which give the same results as the scalar code.
+#if defined(RC_AREA_SSE2)
+typedef __m128i rcU8x16;
+static inline rcU8x16 rcU8x16Load(const unsigned char* v) { return _mm_loadu_si128((const __m128i*)v); }
+static inline void rcU8x16Store(unsigned char* dst, const rcU8x16 v) { _mm_storeu_si128((__m128i*)dst, v); }
+static inline rcU8x16 rcU8x16Set(const unsigned char v) { return _mm_set1_epi8((char)v); }
+static inline rcU8x16 rcU8x16Min(const rcU8x16 a, const rcU8x16 b) { return _mm_min_epu8(a, b); }
+static inline rcU8x16 rcU8x16Max(const rcU8x16 a, const rcU8x16 b) { return _mm_max_epu8(a, b); }
+static inline rcU8x16 rcU8x16AddSat(const rcU8x16 a, const rcU8x16 b) { return _mm_adds_epu8(a, b); }
+static inline rcU8x16 rcU8x16And(const rcU8x16 a, const rcU8x16 b) { return _mm_and_si128(a, b); }
+static inline rcU8x16 rcU8x16Or(const rcU8x16 a, const rcU8x16 b) { return _mm_or_si128(a, b); }
+static inline rcU8x16 rcU8x16Equal(const rcU8x16 a, const rcU8x16 b) { return _mm_cmpeq_epi8(a, b); }
+static inline rcU8x16 rcU8x16IsZero(const rcU8x16 a) { return _mm_cmpeq_epi8(a, _mm_setzero_si128()); }
+static inline rcU8x16 rcU8x16Test(const rcU8x16 a, const rcU8x16 bits) { return _mm_xor_si128(rcU8x16IsZero(_mm_and_si128(a, bits)), _mm_set1_epi8(-1)); }
+static inline rcU8x16 rcU8x16Select(const rcU8x16 mask, const rcU8x16 a, const rcU8x16 b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+#elif defined(RC_AREA_NEON)
+typedef uint8x16_t rcU8x16;
+static inline rcU8x16 rcU8x16Load(const unsigned char* v) { return vld1q_u8(v); }
+static inline void rcU8x16Store(unsigned char* dst, const rcU8x16 v) { vst1q_u8(dst, v); }
+static inline rcU8x16 rcU8x16Set(const unsigned char v) { return vdupq_n_u8(v); }
+static inline rcU8x16 rcU8x16Min(const rcU8x16 a, const rcU8x16 b) { return vminq_u8(a, b); }
+static inline rcU8x16 rcU8x16Max(const rcU8x16 a, const rcU8x16 b) { return vmaxq_u8(a, b); }
+static inline rcU8x16 rcU8x16AddSat(const rcU8x16 a, const rcU8x16 b) { return vqaddq_u8(a, b); }
+static inline rcU8x16 rcU8x16And(const rcU8x16 a, const rcU8x16 b) { return vandq_u8(a, b); }
+static inline rcU8x16 rcU8x16Or(const rcU8x16 a, const rcU8x16 b) { return vorrq_u8(a, b); }
+static inline rcU8x16 rcU8x16Equal(const rcU8x16 a, const rcU8x16 b) { return vceqq_u8(a, b); }
+static inline rcU8x16 rcU8x16IsZero(const rcU8x16 a) { return vceqq_u8(a, vdupq_n_u8(0)); }
+static inline rcU8x16 rcU8x16Test(const rcU8x16 a, const rcU8x16 bits) { return vtstq_u8(a, bits); }
+static inline rcU8x16 rcU8x16Select(const rcU8x16 mask, const rcU8x16 a, const rcU8x16 b) { return vbslq_u8(mask, a, b); }
+#endif
+
+/// The cells of a compact heightfield as images of one byte per cell, for the SIMD area filters.
+///
+/// A cell is simple when it has one span, and its 8 neighbour cells have at most one span.
+/// The neighbours of a simple cell are then found in the images without looking at the spans.
+/// The images have a padding of empty cells around the heightfield, so that the neighbours
+/// of 16 consecutive cells can be loaded with unaligned loads.
+struct rcAreaImages
+{
+	static const int PADDING = 16;
+	static const unsigned char SINGLE_SPAN = 0x10;
+	static const unsigned char SIMPLE = 0x20;
+
+	inline rcAreaImages() : buffer(0), stride(0), dirs(0), values(0) { rows[0] = rows[1] = 0; }
+	inline ~rcAreaImages() { rcFree(buffer); }
+
+	bool init(const rcCompactHeightfield& compactHeightfield)
+	{
+		const int xSize = compactHeightfield.width;
+		const int zSize = compactHeightfield.height;
+		stride = xSize + PADDING * 2;
+		const int imageSize = stride * (zSize + 2);
+		buffer = (unsigned char*)rcAlloc(imageSize * 2 + stride * 2, RC_ALLOC_TEMP);
+		if (!buffer)
+		{
+			return false;
+		}
+		memset(buffer, 0, imageSize * 2 + stride * 2);
+		dirs = buffer + stride + PADDING;
+		values = dirs + imageSize;
+		rows[0] = buffer + imageSize * 2 + PADDING;
+		rows[1] = rows[0] + stride;
+
+		// Store the connected directions of the cells with one span as bit 1 << dir,
+		// and mark the cells with more than one span in the values.
+		for (int z = 0; z < zSize; ++z)
+		{
+			for (int x = 0; x < xSize; ++x)
+			{
+				const rcCompactCell& cell = compactHeightfield.cells[x + z * xSize];
+				if (cell.count > 1)
 				{
-					distanceToBoundary[spanIndex] = 0;
+					values[x + z * stride] = 0xff;
 					continue;
 				}
-				const rcCompactSpan& span = compactHeightfield.spans[spanIndex];
-
-				// Check that there is a non-null adjacent span in each of the 4 cardinal directions.
-				int neighborCount = 0;
-				for (int direction = 0; direction < 4; ++direction)
+				if (cell.count == 0)
 				{
-					const int neighborConnection = rcGetCon(span, direction);
-					if (neighborConnection == RC_NOT_CONNECTED)
-					{
-						break;
-					}
-					
-					const int neighborX = x + rcGetDirOffsetX(direction);
-					const int neighborZ = z + rcGetDirOffsetY(direction);
-					const int neighborSpanIndex = (int)compactHeightfield.cells[neighborX + neighborZ * zStride].index + neighborConnection;
-					
-					if (compactHeightfield.areas[neighborSpanIndex] == RC_NULL_AREA)
+					continue;
+				}
+				const rcCompactSpan& span = compactHeightfield.spans[cell.index];
+				unsigned char mask = SINGLE_SPAN;
+				for (int dir = 0; dir < 4; ++dir)
+				{
+					if (rcGetCon(span, dir) != RC_NOT_CONNECTED)
 					{
-						break;
+						mask |= (unsigned char)(1 << dir);
 					}
-					neighborCount++;
 				}
-				
-				// At least one missing neighbour, so this is a boundary cell.
-				if (neighborCount != 4)
+				dirs[x + z * stride] = mask;
+			}
+		}
+
+		const rcU8x16 singleSpan = rcU8x16Set(SINGLE_SPAN);
+		const rcU8x16 simpleBit = rcU8x16Set(SIMPLE);
+		for (int z = 0; z < zSize; ++z)
+		{
+			for (int x = 0; x < xSize; x += 16)
+			{
+				const unsigned char* v = values + x + z * stride;
+				rcU8x16 multi = rcU8x16Load(v);
+				for (int dz = -1; dz <= 1; ++dz)
 				{
-					distanceToBoundary[spanIndex] = 0;
+					multi = rcU8x16Or(multi, rcU8x16Or(rcU8x16Load(v + dz * stride - 1), rcU8x16Load(v + dz * stride + 1)));
+					multi = rcU8x16Or(multi, rcU8x16Load(v + dz * stride));
 				}
+				const rcU8x16 d = rcU8x16Load(dirs + x + z * stride);
+				const rcU8x16 simple = rcU8x16And(rcU8x16Test(d, singleSpan), rcU8x16IsZero(multi));
+				rcU8x16Store(dirs + x + z * stride, rcU8x16Or(d, rcU8x16And(simple, simpleBit)));
 			}
 		}
+		return true;
 	}
-	
-	unsigned char newDistance;
-	
-	// Pass 1
+
+	/// Stores the values of the spans of the cells with one span in the values image.
+	void gather(const rcCompactHeightfield& compactHeightfield, const unsigned char* spanValues)
+	{
+		const int xSize = compactHeightfield.width;
+		const int zSize = compactHeightfield.height;
+		for (int z = 0; z < zSize; ++z)
+		{
+			const rcCompactCell* cells = &compactHeightfield.cells[z * xSize];
+			unsigned char* v = values + z * stride;
+			for (int x = 0; x < xSize; ++x)
+			{
+				v[x] = cells[x].count == 1 ? spanValues[cells[x].index] : 0;
+			}
+		}
+	}
+
+	unsigned char* buffer;
+	int stride;
+	unsigned char* dirs;	///< The connected directions of the cells with one span, #SINGLE_SPAN and #SIMPLE.
+	unsigned char* values;	///< The value of the span of the cells with one span.
+	unsigned char* rows[2];	///< Two rows of scratch values.
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcAreaImages(const rcAreaImages&);
+	rcAreaImages& operator=(const rcAreaImages&);
+};
+
+/// Marks the boundary spans, and runs both passes of the distance transform of #rcErodeWalkableArea.
+///
+/// The boundaries of the simple cells are found in the images: the span is on the boundary when
+/// its area or one of the areas of its 4 neighbours is null, or when a neighbour is missing.
+/// For each row the terms from the neighbour row are applied to 16 cells at a time, then the
+/// distances are propagated along the row. The distance of the span of a simple cell is lowered
+/// by the same terms as in #erodePass1Span and #erodePass2Span, the other spans use those.
+static void erodeSimd(const rcCompactHeightfield& compactHeightfield, unsigned char* distanceToBoundary,
+					  rcAreaImages& images)
+{
+	const int xSize = compactHeightfield.width;
+	const int zSize = compactHeightfield.height;
+	const int stride = images.stride;
+	const rcU8x16 two = rcU8x16Set(2);
+	const rcU8x16 three = rcU8x16Set(3);
+
+	// The distances replace the areas in the values image one row behind, once the areas of the row
+	// are no longer needed by the row after it.
+	images.gather(compactHeightfield, compactHeightfield.areas);
+	const rcU8x16 allDirs = rcU8x16Set(0x0f);
+	const rcU8x16 zero = rcU8x16Set(0);
+	const rcU8x16 farAway = rcU8x16Set(0xff);
+	for (int z = 0; z <= zSize; ++z)
+	{
+		if (z < zSize)
+		{
+			const unsigned char* a = images.values + z * stride;
+			const unsigned char* m = images.dirs + z * stride;
+			unsigned char* out = images.rows[z & 1];
+			for (int x = 0; x < xSize; x += 16)
+			{
+				rcU8x16 boundary = rcU8x16IsZero(rcU8x16Equal(rcU8x16And(rcU8x16Load(m + x), allDirs), allDirs));
+				boundary = rcU8x16Or(boundary, rcU8x16IsZero(rcU8x16Load(a + x)));
+				boundary = rcU8x16Or(boundary, rcU8x16IsZero(rcU8x16Load(a + x - 1)));
+				boundary = rcU8x16Or(boundary, rcU8x16IsZero(rcU8x16Load(a + x + 1)));
+				boundary = rcU8x16Or(boundary, rcU8x16IsZero(rcU8x16Load(a + x - stride)));
+				boundary = rcU8x16Or(boundary, rcU8x16IsZero(rcU8x16Load(a + x + stride)));
+				rcU8x16Store(out + x, rcU8x16Select(boundary, zero, farAway));
+			}
+		}
+		if (z > 0)
+		{
+			memcpy(images.values + (z - 1) * stride, images.rows[(z - 1) & 1], xSize);
+		}
+	}
+
+	// The other spans are marked one by one, and their distances copied to the image.
 	for (int z = 0; z < zSize; ++z)
 	{
+		const rcCompactCell* cells = &compactHeightfield.cells[z * xSize];
+		const unsigned char* m = images.dirs + z * stride;
+		unsigned char* d = images.values + z * stride;
 		for (int x = 0; x < xSize; ++x)
 		{
-			const rcCompactCell& cell = compactHeightfield.cells[x + z * zStride];
+			if (m[x] & rcAreaImages::SIMPLE)
+			{
+				continue;
+			}
+			const rcCompactCell& cell = cells[x];
 			const int maxSpanIndex = (int)(cell.index + cell.count);
 			for (int spanIndex = (int)cell.index; spanIndex < maxSpanIndex; ++spanIndex)
 			{
-				const rcCompactSpan& span = compactHeightfield.spans[spanIndex];
+				markBoundarySpan(compactHeightfield, distanceToBoundary, x, z, spanIndex);
+			}
+			if (cell.count == 1)
+			{
+				d[x] = distanceToBoundary[cell.index];
+			}
+		}
+	}
 
-				if (rcGetCon(span, 0) != RC_NOT_CONNECTED)
-				{
-					// (-1,0)
-					const int aX = x + rcGetDirOffsetX(0);
-					const int aY = z + rcGetDirOffsetY(0);
-					const int aIndex = (int)compactHeightfield.cells[aX + aY * xSize].index + rcGetCon(span, 0);
-					const rcCompactSpan& aSpan = compactHeightfield.spans[aIndex];
-					newDistance = (unsigned char)rcMin((int)distanceToBoundary[aIndex] + 2, 255);
-					if (newDistance < distanceToBoundary[spanIndex])
-					{
-						distanceToBoundary[spanIndex] = newDistance;
-					}
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		const bool secondPass = pass == 1;
+		// The direction to the neighbour row, and the directions along the row, to the cell
+		// before in the order of the pass and to the cell after.
+		const unsigned char toNext = secondPass ? 2 : 8;
+		const unsigned char toBefore = secondPass ? 4 : 1;
+		const unsigned char toAfter = secondPass ? 1 : 4;
+		const int nextOffset = secondPass ? stride : -stride;
+		const int beforeOffset = secondPass ? 1 : -1;
+		const rcU8x16 toNextBits = rcU8x16Set(toNext);
+		const rcU8x16 toBeforeBits = rcU8x16Set(toBefore);
+		const rcU8x16 toAfterBits = rcU8x16Set(toAfter);
+
+		for (int i = 0; i < zSize; ++i)
+		{
+			const int z = secondPass ? zSize - 1 - i : i;
+			unsigned char* d = images.values + z * stride;
+			const unsigned char* m = images.dirs + z * stride;
+			const unsigned char* next = d + nextOffset;
+			const unsigned char* nextDirs = m + nextOffset;
+
+			for (int x = 0; x < xSize; x += 16)
+			{
+				const rcU8x16 dirs = rcU8x16Load(m + x);
+				const rcU8x16 connected = rcU8x16Test(dirs, toNextBits);
+				rcU8x16 dist = rcU8x16Load(d + x);
+
+				// Straight to the neighbour row, to the diagonal after through the neighbour row,
+				// and to the diagonal before through the cell before.
+				const rcU8x16 viaNext = rcU8x16And(connected, rcU8x16Test(rcU8x16Load(nextDirs + x), toAfterBits));
+				const rcU8x16 viaBefore = rcU8x16And(rcU8x16Test(dirs, toBeforeBits),
+													 rcU8x16Test(rcU8x16Load(m + x + beforeOffset), toNextBits));
+				const rcU8x16 straight = rcU8x16AddSat(rcU8x16Load(next + x), two);
+				const rcU8x16 diagonalAfter = rcU8x16AddSat(rcU8x16Load(next + x - beforeOffset), three);
+				const rcU8x16 diagonalBefore = rcU8x16AddSat(rcU8x16Load(next + x + beforeOffset), three);
+				dist = rcU8x16Select(connected, rcU8x16Min(dist, straight), dist);
+				dist = rcU8x16Select(viaNext, rcU8x16Min(dist, diagonalAfter), dist);
+				dist = rcU8x16Select(viaBefore, rcU8x16Min(dist, diagonalBefore), dist);
+				rcU8x16Store(d + x, dist);
+			}
 
-					// (-1,-1)
-					if (rcGetCon(aSpan, 3) != RC_NOT_CONNECTED)
+			// Along the row, in the order of the pass.
+			const rcCompactCell* cells = &compactHeightfield.cells[z * xSize];
+			for (int j = 0; j < xSize; ++j)
+			{
+				const int x = secondPass ? xSize - 1 - j : j;
+				const rcCompactCell& cell = cells[x];
+				if (m[x] & rcAreaImages::SIMPLE)
+				{
+					if (m[x] & toBefore)
 					{
-						const int bX = aX + rcGetDirOffsetX(3);
-						const int bY = aY + rcGetDirOffsetY(3);
-						const int bIndex = (int)compactHeightfield.cells[bX + bY * xSize].index + rcGetCon(aSpan, 3);
-						newDistance = (unsigned char)rcMin((int)distanceToBoundary[bIndex] + 3, 255);
-						if (newDistance < distanceToBoundary[spanIndex])
-						{
-							distanceToBoundary[spanIndex] = newDistance;
-						}
+						d[x] = (unsigned char)rcMin((int)d[x], rcMin((int)d[x + beforeOffset] + 2, 255));
 					}
+					distanceToBoundary[cell.index] = d[x];
+					continue;
 				}
-				if (rcGetCon(span, 3) != RC_NOT_CONNECTED)
+				const int maxSpanIndex = (int)(cell.index + cell.count);
+				for (int spanIndex = (int)cell.index; spanIndex < maxSpanIndex; ++spanIndex)
 				{
-					// (0,-1)
-					const int aX = x + rcGetDirOffsetX(3);
-					const int aY = z + rcGetDirOffsetY(3);
-					const int aIndex = (int)compactHeightfield.cells[aX + aY * xSize].index + rcGetCon(span, 3);
-					const rcCompactSpan& aSpan = compactHeightfield.spans[aIndex];
-					newDistance = (unsigned char)rcMin((int)distanceToBoundary[aIndex] + 2, 255);
-					if (newDistance < distanceToBoundary[spanIndex])
+					if (secondPass)
 					{
-						distanceToBoundary[spanIndex] = newDistance;
+						erodePass2Span(compactHeightfield, distanceToBoundary, x, z, spanIndex);
 					}
-
-					// (1,-1)
-					if (rcGetCon(aSpan, 2) != RC_NOT_CONNECTED)
+					else
 					{
-						const int bX = aX + rcGetDirOffsetX(2);
-						const int bY = aY + rcGetDirOffsetY(2);
-						const int bIndex = (int)compactHeightfield.cells[bX + bY * xSize].index + rcGetCon(aSpan, 2);
-						newDistance = (unsigned char)rcMin((int)distanceToBoundary[bIndex] + 3, 255);
-						if (newDistance < distanceToBoundary[spanIndex])
-						{
-							distanceToBoundary[spanIndex] = newDistance;
-						}
+						erodePass1Span(compactHeightfield, distanceToBoundary, x, z, spanIndex);
 					}
 				}
+				if (cell.count == 1)
+				{
+					d[x] = distanceToBoundary[cell.index];
+				}
 			}
 		}
 	}
+}
 
-	// Pass 2
-	for (int z = zSize - 1; z >= 0; --z)
+/// Sorts two lanes of neighbour areas.
+static inline void medianSort(rcU8x16* v, const int a, const int b)
+{
+	const rcU8x16 lo = rcU8x16Min(v[a], v[b]);
+	v[b] = rcU8x16Max(v[a], v[b]);
+	v[a] = lo;
+}
+
+/// Returns @p n where @p connected is set and @p n is not a null area, and @p a elsewhere.
+static inline rcU8x16 medianNeighbor(const rcU8x16 connected, const rcU8x16 n, const rcU8x16 a)
+{
+	return rcU8x16Select(connected, rcU8x16Select(rcU8x16IsZero(n), a, n), a);
+}
+
+/// Finds the median areas of the cells of row @p z for #rcMedianFilterWalkableArea.
+///
+/// The neighbour areas are collected the same way as in #collectNeighborAreas, which gives
+/// the same result for the simple cells. The median of 9 sorting network finds the same
+/// element as sorting all 9 areas.
+static void medianRowSimd(const rcAreaImages& images, const int xSize, const int z, unsigned char* medians)
+{
+	const int s = images.stride;
+	const unsigned char* areas = images.values + z * s;
+	const unsigned char* dirs = images.dirs + z * s;
+	const rcU8x16 bit0 = rcU8x16Set(1);
+	const rcU8x16 bit1 = rcU8x16Set(2);
+	const rcU8x16 bit2 = rcU8x16Set(4);
+	const rcU8x16 bit3 = rcU8x16Set(8);
+	for (int x = 0; x < xSize; x += 16)
 	{
-		for (int x = xSize - 1; x >= 0; --x)
-		{
-			const rcCompactCell& cell = compactHeightfield.cells[x + z * zStride];
-			const int maxSpanIndex = (int)(cell.index + cell.count);
-			for (int spanIndex = (int)cell.index; spanIndex < maxSpanIndex; ++spanIndex)
-			{
-				const rcCompactSpan& span = compactHeightfield.spans[spanIndex];
+		const unsigned char* a = areas + x;
+		const unsigned char* m = dirs + x;
+		const rcU8x16 own = rcU8x16Load(a);
+		const rcU8x16 d = rcU8x16Load(m);
+		rcU8x16 v[9];
+
+		// (-1,0), and (-1,1) through it.
+		rcU8x16 c = rcU8x16Test(d, bit0);
+		v[0] = medianNeighbor(c, rcU8x16Load(a - 1), own);
+		v[1] = medianNeighbor(rcU8x16And(c, rcU8x16Test(rcU8x16Load(m - 1), bit1)), rcU8x16Load(a - 1 + s), own);
+		// (0,1), and (1,1) through it.
+		c = rcU8x16Test(d, bit1);
+		v[2] = medianNeighbor(c, rcU8x16Load(a + s), own);
+		v[3] = medianNeighbor(rcU8x16And(c, rcU8x16Test(rcU8x16Load(m + s), bit2)), rcU8x16Load(a + 1 + s), own);
+		// (1,0), and (1,-1) through it.
+		c = rcU8x16Test(d, bit2);
+		v[4] = medianNeighbor(c, rcU8x16Load(a + 1), own);
+		v[5] = medianNeighbor(rcU8x16And(c, rcU8x16Test(rcU8x16Load(m + 1), bit3)), rcU8x16Load(a + 1 - s), own);
+		// (0,-1), and (-1,-1) through it.
+		c = rcU8x16Test(d, bit3);
+		v[6] = medianNeighbor(c, rcU8x16Load(a - s), own);
+		v[7] = medianNeighbor(rcU8x16And(c, rcU8x16Test(rcU8x16Load(m - s), bit0)), rcU8x16Load(a - 1 - s), own);
+		v[8] = own;
+
+		medianSort(v, 1, 2); medianSort(v, 4, 5); medianSort(v, 7, 8);
+		medianSort(v, 0, 1); medianSort(v, 3, 4); medianSort(v, 6, 7);
+		medianSort(v, 1, 2); medianSort(v, 4, 5); medianSort(v, 7, 8);
+		medianSort(v, 0, 3); medianSort(v, 5, 8); medianSort(v, 4, 7);
+		medianSort(v, 3, 6); medianSort(v, 1, 4); medianSort(v, 2, 5);
+		medianSort(v, 4, 7); medianSort(v, 4, 2); medianSort(v, 6, 4);
+		medianSort(v, 4, 2);
+		rcU8x16Store(medians + x, v[4]);
+	}
+}
 
-				if (rcGetCon(span, 2) != RC_NOT_CONNECTED)
-				{
-					// (1,0)
-					const int aX = x + rcGetDirOffsetX(2);
-					const int aY = z + rcGetDirOffsetY(2);
-					const int aIndex = (int)compactHeightfield.cells[aX + aY * xSize].index + rcGetCon(span, 2);
-					const rcCompactSpan& aSpan = compactHeightfield.spans[aIndex];
-					newDistance = (unsigned char)rcMin((int)distanceToBoundary[aIndex] + 2, 255);
-					if (newDistance < distanceToBoundary[spanIndex])
-					{
-						distanceToBoundary[spanIndex] = newDistance;
-					}
+#endif // RC_AREA_SIMD
 
-					// (1,1)
-					if (rcGetCon(aSpan, 1) != RC_NOT_CONNECTED)
-					{
-						const int bX = aX + rcGetDirOffsetX(1);
-						const int bY = aY + rcGetDirOffsetY(1);
-						const int bIndex = (int)compactHeightfield.cells[bX + bY * xSize].index + rcGetCon(aSpan, 1);
-						newDistance = (unsigned char)rcMin((int)distanceToBoundary[bIndex] + 3, 255);
-						if (newDistance < distanceToBoundary[spanIndex])
-						{
-							distanceToBoundary[spanIndex] = newDistance;
-						}
-					}
-				}
-				if (rcGetCon(span, 1) != RC_NOT_CONNECTED)
-				{
-					// (0,1)
-					const int aX = x + rcGetDirOffsetX(1);
-					const int aY = z + rcGetDirOffsetY(1);
-					const int aIndex = (int)compactHeightfield.cells[aX + aY * xSize].index + rcGetCon(span, 1);
-					const rcCompactSpan& aSpan = compactHeightfield.spans[aIndex];
-					newDistance = (unsigned char)rcMin((int)distanceToBoundary[aIndex] + 2, 255);
-					if (newDistance < distanceToBoundary[spanIndex])
-					{
-						distanceToBoundary[spanIndex] = newDistance;
-					}
+bool rcErodeWalkableArea(rcContext* context, const int erosionRadius, rcCompactHeightfield& compactHeightfield)
+{
+	rcAssert(context != NULL);
 
-					// (-1,1)
-					if (rcGetCon(aSpan, 0) != RC_NOT_CONNECTED)
-					{
-						const int bX = aX + rcGetDirOffsetX(0);
-						const int bY = aY + rcGetDirOffsetY(0);
-						const int bIndex = (int)compactHeightfield.cells[bX + bY * xSize].index + rcGetCon(aSpan, 0);
-						newDistance = (unsigned char)rcMin((int)distanceToBoundary[bIndex] + 3, 255);
-						if (newDistance < distanceToBoundary[spanIndex])
-						{
-							distanceToBoundary[spanIndex] = newDistance;
-						}
-					}
+	const int xSize = compactHeightfield.width;
+	const int zSize = compactHeightfield.height;
+	const int& zStride = xSize; // For readability
+
+	rcScopedTimer timer(context, RC_TIMER_ERODE_AREA);
+
+	unsigned char* distanceToBoundary = (unsigned char*)rcAlloc(sizeof(unsigned char) * compactHeightfield.spanCount,
+	                                                            RC_ALLOC_TEMP);
+	if (!distanceToBoundary)
+	{
+		context->log(RC_LOG_ERROR, "erodeWalkableArea: Out of memory 'dist' (%d).", compactHeightfield.spanCount);
+		return false;
+	}
+	memset(distanceToBoundary, 0xff, sizeof(unsigned char) * compactHeightfield.spanCount);
+	
+#if defined(RC_AREA_SIMD)
+	if (s_simdAreaFilters)
+	{
+		rcAreaImages images;
+		if (!images.init(compactHeightfield))
+		{
+			context->log(RC_LOG_ERROR, "erodeWalkableArea: Out of memory 'images' (%d).", xSize * zSize);
+			rcFree(distanceToBoundary);
+			return false;
+		}
+		erodeSimd(compactHeightfield, distanceToBoundary, images);
+	}
+	else
+#endif
+	{
+		// Mark boundary cells.
+		for (int z = 0; z < zSize; ++z)
+		{
+			for (int x = 0; x < xSize; ++x)
+			{
+				const rcCompactCell& cell = compactHeightfield.cells[x + z * zStride];
+				for (int spanIndex = (int)cell.index, maxSpanIndex = (int)(cell.index + cell.count); spanIndex < maxSpanIndex; ++spanIndex)
+				{
+					markBoundarySpan(compactHeightfield, distanceToBoundary, x, z, spanIndex);
 				}
 			}
 		}
+
+		// Pass 1
+		for (int z = 0; z < zSize; ++z)
+		{
+			erodeRow(compactHeightfield, distanceToBoundary, z, false);
+		}
+
+		// Pass 2
+		for (int z = zSize - 1; z >= 0; --z)
+		{
+			erodeRow(compactHeightfield, distanceToBoundary, z, true);
+		}
 	}
 
 	const unsigned char minBoundaryDistance = (unsigned char)(erosionRadius * 2);
@@ -286,6 +710,52 @@ bool rcErodeWalkableArea(rcContext* context, const int erosionRadius, rcCompactH
 	return true;
 }
 
+/// Collects the areas of the span and its 8 neighbours for the median filter, with the area of
+/// the span in place of missing and null neighbours.
+///
+/// @param[out]	neighborAreas	The areas, @p stride elements apart. [Size: 9 * @p stride]
+static void collectNeighborAreas(const rcCompactHeightfield& compactHeightfield, const int x, const int z,
+								 const int spanIndex, unsigned char* neighborAreas, const int stride)
+{
+	const int zStride = compactHeightfield.width; // For readability
+	const rcCompactSpan& span = compactHeightfield.spans[spanIndex];
+
+	for (int neighborIndex = 0; neighborIndex < 9; ++neighborIndex)
+	{
+		neighborAreas[neighborIndex * stride] = compactHeightfield.areas[spanIndex];
+	}
+
+	for (int dir = 0; dir < 4; ++dir)
+	{
+		if (rcGetCon(span, dir) == RC_NOT_CONNECTED)
+		{
+			continue;
+		}
+		
+		const int aX = x + rcGetDirOffsetX(dir);
+		const int aZ = z + rcGetDirOffsetY(dir);
+		const int aIndex = (int)compactHeightfield.cells[aX + aZ * zStride].index + rcGetCon(span, dir);
+		if (compactHeightfield.areas[aIndex] != RC_NULL_AREA)
+		{
+			neighborAreas[(dir * 2 + 0) * stride] = compactHeightfield.areas[aIndex];
+		}
+
+		const rcCompactSpan& aSpan = compactHeightfield.spans[aIndex];
+		const int dir2 = (dir + 1) & 0x3;
+		const int neighborConnection2 = rcGetCon(aSpan, dir2);
+		if (neighborConnection2 != RC_NOT_CONNECTED)
+		{
+			const int bX = aX + rcGetDirOffsetX(dir2);
+			const int bZ = aZ + rcGetDirOffsetY(dir2);
+			const int bIndex = (int)compactHeightfield.cells[bX + bZ * zStride].index + neighborConnection2;
+			if (compactHeightfield.areas[bIndex] != RC_NULL_AREA)
+			{
+				neighborAreas[(dir * 2 + 1) * stride] = compactHeightfield.areas[bIndex];
+			}
+		}
+	}
+}
+
 bool rcMedianFilterWalkableArea(rcContext* context, rcCompactHeightfield& compactHeightfield)
 {
 	rcAssert(context);
@@ -305,15 +775,43 @@ bool rcMedianFilterWalkableArea(rcContext* context, rcCompactHeightfield& compac
 	}
 	memset(areas, 0xff, sizeof(unsigned char) * compactHeightfield.spanCount);
 
+#if defined(RC_AREA_SIMD)
+	rcAreaImages images;
+	const bool simd = s_simdAreaFilters;
+	if (simd)
+	{
+		if (!images.init(compactHeightfield))
+		{
+			context->log(RC_LOG_ERROR, "medianFilterWalkableArea: Out of memory 'images' (%d).", xSize * zSize);
+			rcFree(areas);
+			return false;
+		}
+		images.gather(compactHeightfield, compactHeightfield.areas);
+	}
+#endif
+
 	for (int z = 0; z < zSize; ++z)
 	{
+#if defined(RC_AREA_SIMD)
+		if (simd)
+		{
+			medianRowSimd(images, xSize, z, images.rows[0]);
+		}
+#endif
 		for (int x = 0; x < xSize; ++x)
 		{
 			const rcCompactCell& cell = compactHeightfield.cells[x + z * zStride];
+#if defined(RC_AREA_SIMD)
+			if (simd && (images.dirs[x + z * images.stride] & rcAreaImages::SIMPLE))
+			{
+				const int spanIndex = (int)cell.index;
+				areas[spanIndex] = compactHeightfield.areas[spanIndex] == RC_NULL_AREA ? RC_NULL_AREA : images.rows[0][x];
+				continue;
+			}
+#endif
 			const int maxSpanIndex = (int)(cell.index + cell.count);
 			for (int spanIndex = (int)cell.index; spanIndex < maxSpanIndex; ++spanIndex)
 			{
-				const rcCompactSpan& span = compactHeightfield.spans[spanIndex];
 				if (compactHeightfield.areas[spanIndex] == RC_NULL_AREA)
 				{
 					areas[spanIndex] = compactHeightfield.areas[spanIndex];
@@ -321,40 +819,7 @@ bool rcMedianFilterWalkableArea(rcContext* context, rcCompactHeightfield& compac
 				}
 
 				unsigned char neighborAreas[9];
-				for (int neighborIndex = 0; neighborIndex < 9; ++neighborIndex)
-				{
-					neighborAreas[neighborIndex] = compactHeightfield.areas[spanIndex];
-				}
-
-				for (int dir = 0; dir < 4; ++dir)
-				{
-					if (rcGetCon(span, dir) == RC_NOT_CONNECTED)
-					{
-						continue;
-					}
-					
-					const int aX = x + rcGetDirOffsetX(dir);
-					const int aZ = z + rcGetDirOffsetY(dir);
-					const int aIndex = (int)compactHeightfield.cells[aX + aZ * zStride].index + rcGetCon(span, dir);
-					if (compactHeightfield.areas[aIndex] != RC_NULL_AREA)
-					{
-						neighborAreas[dir * 2 + 0] = compactHeightfield.areas[aIndex];
-					}
-
-					const rcCompactSpan& aSpan = compactHeightfield.spans[aIndex];
-					const int dir2 = (dir + 1) & 0x3;
-					const int neighborConnection2 = rcGetCon(aSpan, dir2);
-					if (neighborConnection2 != RC_NOT_CONNECTED)
-					{
-						const int bX = aX + rcGetDirOffsetX(dir2);
-						const int bZ = aZ + rcGetDirOffsetY(dir2);
-						const int bIndex = (int)compactHeightfield.cells[bX + bZ * zStride].index + neighborConnection2;
-						if (compactHeightfield.areas[bIndex] != RC_NULL_AREA)
-						{
-							neighborAreas[dir * 2 + 1] = compactHeightfield.areas[bIndex];
-						}
-					}
-				}
+				collectNeighborAreas(compactHeightfield, x, z, spanIndex, neighborAreas, 1);
 				insertSort(neighborAreas, 9);
 				areas[spanIndex] = neighborAreas[4];
 			}
@@ -368,63 +833,178 @@ bool rcMedianFilterWalkableArea(rcContext* context, rcCompactHeightfield& compac
 	return true;
 }
 
-void rcMarkBoxArea(rcContext* context, const float* boxMinBounds, const float* boxMaxBounds, unsigned char areaId,
-                   rcCompactHeightfield& compactHeightfield)
+bool rcSetSimdAreaFilters(const bool enabled)
 {
-	rcAssert(context);
+#if defined(RC_AREA_SIMD)
+	s_simdAreaFilters = enabled;
+	return true;
+#else
+	rcIgnoreUnused(enabled);
+	return false;
+#endif
+}
 
-	rcScopedTimer timer(context, RC_TIMER_MARK_BOX_AREA);
+bool rcGetSimdAreaFilters()
+{
+#if defined(RC_AREA_SIMD)
+	return s_simdAreaFilters;
+#else
+	return false;
+#endif
+}
 
+/// The footprint of a convex polygon area in the grid cells of a compact heightfield.
+struct rcPolyFootprint
+{
+	int minx, miny, minz;
+	int maxx, maxy, maxz;
+};
+
+/// Computes the grid footprint of a polygon extruded from @p minY to @p maxY, clamped to the grid.
+///
+/// @returns false if the polygon lies entirely outside the grid.
+static bool calcPolyFootprint(const float* verts, const int numVerts, const float minY, const float maxY,
+							  const rcCompactHeightfield& compactHeightfield, rcPolyFootprint& footprint)
+{
 	const int xSize = compactHeightfield.width;
 	const int zSize = compactHeightfield.height;
-	const int zStride = xSize; // For readability
 
-	// Find the footprint of the box area in grid cell coordinates. 
-	int minX = (int)((boxMinBounds[0] - compactHeightfield.bmin[0]) / compactHeightfield.cs);
-	int minY = (int)((boxMinBounds[1] - compactHeightfield.bmin[1]) / compactHeightfield.ch);
-	int minZ = (int)((boxMinBounds[2] - compactHeightfield.bmin[2]) / compactHeightfield.cs);
-	int maxX = (int)((boxMaxBounds[0] - compactHeightfield.bmin[0]) / compactHeightfield.cs);
-	int maxY = (int)((boxMaxBounds[1] - compactHeightfield.bmin[1]) / compactHeightfield.ch);
-	int maxZ = (int)((boxMaxBounds[2] - compactHeightfield.bmin[2]) / compactHeightfield.cs);
+	// Compute the bounding box of the polygon
+	float bmin[3];
+	float bmax[3];
+	rcVcopy(bmin, verts);
+	rcVcopy(bmax, verts);
+	for (int i = 1; i < numVerts; ++i)
+	{
+		rcVmin(bmin, &verts[i * 3]);
+		rcVmax(bmax, &verts[i * 3]);
+	}
+	bmin[1] = minY;
+	bmax[1] = maxY;
+
+	// Compute the grid footprint of the polygon 
+	footprint.minx = (int)((bmin[0] - compactHeightfield.bmin[0]) / compactHeightfield.cs);
+	footprint.miny = (int)((bmin[1] - compactHeightfield.bmin[1]) / compactHeightfield.ch);
+	footprint.minz = (int)((bmin[2] - compactHeightfield.bmin[2]) / compactHeightfield.cs);
+	footprint.maxx = (int)((bmax[0] - compactHeightfield.bmin[0]) / compactHeightfield.cs);
+	footprint.maxy = (int)((bmax[1] - compactHeightfield.bmin[1]) / compactHeightfield.ch);
+	footprint.maxz = (int)((bmax[2] - compactHeightfield.bmin[2]) / compactHeightfield.cs);
 
-	// Early-out if the box is outside the bounds of the grid.
-	if (maxX < 0) { return; }
-	if (minX >= xSize) { return; }
-	if (maxZ < 0) { return; }
-	if (minZ >= zSize) { return; }
+	// Early-out if the polygon lies entirely outside the grid.
+	if (footprint.maxx < 0) { return false; }
+	if (footprint.minx >= xSize) { return false; }
+	if (footprint.maxz < 0) { return false; }
+	if (footprint.minz >= zSize) { return false; }
 
-	// Clamp relevant bound coordinates to the grid.
-	if (minX < 0) { minX = 0; }
-	if (maxX >= xSize) { maxX = xSize - 1; }
-	if (minZ < 0) { minZ = 0; }
-	if (maxZ >= zSize) { maxZ = zSize - 1; }
+	// Clamp the polygon footprint to the grid
+	if (footprint.minx < 0) { footprint.minx = 0; }
+	if (footprint.maxx >= xSize) { footprint.maxx = xSize - 1; }
+	if (footprint.minz < 0) { footprint.minz = 0; }
+	if (footprint.maxz >= zSize) { footprint.maxz = zSize - 1; }
 
-	// Mark relevant cells.
-	for (int z = minZ; z <= maxZ; ++z)
+	return true;
+}
+
+/// Returns the x-coordinate of the center of the cells in column @p x.
+static inline float cellCenterX(const rcCompactHeightfield& compactHeightfield, const int x)
+{
+	return compactHeightfield.bmin[0] + ((float)x + 0.5f) * compactHeightfield.cs;
+}
+
+/// Returns the first column in [@p minx, @p maxx + 1] whose cell center is at or after @p edgeX.
+static int firstColumnAfter(const rcCompactHeightfield& compactHeightfield, const float edgeX, const int minx, const int maxx)
+{
+	const float fx = (edgeX - compactHeightfield.bmin[0]) / compactHeightfield.cs - 0.5f;
+	int x;
+	if (!(fx > (float)minx)) { x = minx; }
+	else if (fx > (float)(maxx + 1)) { x = maxx + 1; }
+	else { x = (int)fx; }
+
+	// The estimate can be off by one because of rounding, settle it with the same test as pointInPoly.
+	while (x <= maxx && cellCenterX(compactHeightfield, x) < edgeX) { x++; }
+	while (x > minx && cellCenterX(compactHeightfield, x - 1) >= edgeX) { x--; }
+	return x;
+}
+
+/// Marks the spans of the cells in row @p z whose centers are inside the polygon.
+///
+/// The row is filled between the crossings of its center line with the polygon edges.
+/// The crossings are computed the same way as in #pointInPoly, so the same cells are marked
+/// as when testing each cell center.
+static void markPolyRow(const float* verts, const int numVerts, const rcPolyFootprint& footprint, const int z,
+						const unsigned char areaId, rcCompactHeightfield& compactHeightfield)
+{
+	const int zStride = compactHeightfield.width; // For readability
+	const float pz = compactHeightfield.bmin[2] + ((float)z + 0.5f) * compactHeightfield.cs;
+
+	// Find the crossings of the row with the polygon edges.
+	float crossings[2];
+	int numCrossings = 0;
+	for (int i = 0, j = numVerts - 1; i < numVerts; j = i++)
 	{
-		for (int x = minX; x <= maxX; ++x)
+		const float* vi = &verts[i * 3];
+		const float* vj = &verts[j * 3];
+
+		if ((vi[2] > pz) == (vj[2] > pz))
 		{
-			const rcCompactCell& cell = compactHeightfield.cells[x + z * zStride];
-			const int maxSpanIndex = (int)(cell.index + cell.count);
-			for (int spanIndex = (int)cell.index; spanIndex < maxSpanIndex; ++spanIndex)
+			continue;
+		}
+
+		if (numCrossings == 2)
+		{
+			numCrossings++;
+			break;
+		}
+		crossings[numCrossings++] = (vj[0] - vi[0]) * (pz - vi[2]) / (vj[2] - vi[2]) + vi[0];
+	}
+	if (numCrossings == 0)
+	{
+		return;
+	}
+
+	// A convex polygon crosses the row twice, fall back to testing each cell otherwise.
+	const bool testCells = numCrossings != 2;
+	int x0 = footprint.minx;
+	int x1 = footprint.maxx + 1;
+	if (!testCells)
+	{
+		// The cells with centers in [left, right) are inside the polygon.
+		const float left = rcMin(crossings[0], crossings[1]);
+		const float right = rcMax(crossings[0], crossings[1]);
+		x0 = firstColumnAfter(compactHeightfield, left, footprint.minx, footprint.maxx);
+		x1 = firstColumnAfter(compactHeightfield, right, x0, footprint.maxx);
+	}
+
+	for (int x = x0; x < x1; ++x)
+	{
+		if (testCells)
+		{
+			const float point[] = { cellCenterX(compactHeightfield, x), 0, pz };
+			if (!pointInPoly(numVerts, verts, point))
 			{
-				rcCompactSpan& span = compactHeightfield.spans[spanIndex];
+				continue;
+			}
+		}
 
-				// Skip if the span is outside the box extents.
-				if ((int)span.y < minY || (int)span.y > maxY)
-				{
-					continue;
-				}
+		const rcCompactCell& cell = compactHeightfield.cells[x + z * zStride];
+		const int maxSpanIndex = (int)(cell.index + cell.count);
+		for (int spanIndex = (int)cell.index; spanIndex < maxSpanIndex; ++spanIndex)
+		{
+			rcCompactSpan& span = compactHeightfield.spans[spanIndex];
 
-				// Skip if the span has been removed.
-				if (compactHeightfield.areas[spanIndex] == RC_NULL_AREA)
-				{
-					continue;
-				}
+			// Skip if span is removed.
+			if (compactHeightfield.areas[spanIndex] == RC_NULL_AREA)
+			{
+				continue;
+			}
 
-				// Mark the span.
-				compactHeightfield.areas[spanIndex] = areaId;
+			// Skip if y extents don't overlap.
+			if ((int)span.y < footprint.miny || (int)span.y > footprint.maxy)
+			{
+				continue;
 			}
+
+			compactHeightfield.areas[spanIndex] = areaId;
 		}
 	}
 }
@@ -437,79 +1017,108 @@ void rcMarkConvexPolyArea(rcContext* context, const float* verts, const int numV
 
 	rcScopedTimer timer(context, RC_TIMER_MARK_CONVEXPOLY_AREA);
 
-	const int xSize = compactHeightfield.width;
-	const int zSize = compactHeightfield.height;
-	const int zStride = xSize; // For readability
+	rcPolyFootprint footprint;
+	if (!calcPolyFootprint(verts, numVerts, minY, maxY, compactHeightfield, footprint))
+	{
+		return;
+	}
 
-	// Compute the bounding box of the polygon
-	float bmin[3];
-	float bmax[3];
-	rcVcopy(bmin, verts);
-	rcVcopy(bmax, verts);
-	for (int i = 1; i < numVerts; ++i)
+	for (int z = footprint.minz; z <= footprint.maxz; ++z)
 	{
-		rcVmin(bmin, &verts[i * 3]);
-		rcVmax(bmax, &verts[i * 3]);
+		markPolyRow(verts, numVerts, footprint, z, areaId, compactHeightfield);
 	}
-	bmin[1] = minY;
-	bmax[1] = maxY;
+}
 
-	// Compute the grid footprint of the polygon 
-	int minx = (int)((bmin[0] - compactHeightfield.bmin[0]) / compactHeightfield.cs);
-	int miny = (int)((bmin[1] - compactHeightfield.bmin[1]) / compactHeightfield.ch);
-	int minz = (int)((bmin[2] - compactHeightfield.bmin[2]) / compactHeightfield.cs);
-	int maxx = (int)((bmax[0] - compactHeightfield.bmin[0]) / compactHeightfield.cs);
-	int maxy = (int)((bmax[1] - compactHeightfield.bmin[1]) / compactHeightfield.ch);
-	int maxz = (int)((bmax[2] - compactHeightfield.bmin[2]) / compactHeightfield.cs);
+bool rcMarkConvexPolyAreas(rcContext* context, const rcConvexVolume* volumes, const int numVolumes,
+						   rcCompactHeightfield& compactHeightfield)
+{
+	rcAssert(context);
 
-	// Early-out if the polygon lies entirely outside the grid.
-	if (maxx < 0) { return; }
-    if (minx >= xSize) { return; }
-    if (maxz < 0) { return; }
-    if (minz >= zSize) { return; }
+	rcScopedTimer timer(context, RC_TIMER_MARK_CONVEXPOLY_AREA);
 
-	// Clamp the polygon footprint to the grid
-    if (minx < 0) { minx = 0; }
-    if (maxx >= xSize) { maxx = xSize - 1; }
-    if (minz < 0) { minz = 0; }
-    if (maxz >= zSize) { maxz = zSize - 1; }
+	if (numVolumes <= 0)
+	{
+		return true;
+	}
 
-	// TODO: Optimize.
-	for (int z = minz; z <= maxz; ++z)
+	const int zSize = compactHeightfield.height;
+
+	rcScopedDelete<rcPolyFootprint> footprints((rcPolyFootprint*)rcAlloc(sizeof(rcPolyFootprint) * numVolumes, RC_ALLOC_TEMP));
+	rcScopedDelete<int> sorted((int*)rcAlloc(sizeof(int) * numVolumes, RC_ALLOC_TEMP));
+	rcScopedDelete<int> active((int*)rcAlloc(sizeof(int) * numVolumes, RC_ALLOC_TEMP));
+	rcScopedDelete<int> rowStarts((int*)rcAlloc(sizeof(int) * (zSize + 1), RC_ALLOC_TEMP));
+	if (!footprints || !sorted || !active || !rowStarts)
 	{
-		for (int x = minx; x <= maxx; ++x)
-		{
-			const rcCompactCell& cell = compactHeightfield.cells[x + z * zStride];
-			const int maxSpanIndex = (int)(cell.index + cell.count);
-			for (int spanIndex = (int)cell.index; spanIndex < maxSpanIndex; ++spanIndex)
-			{
-				rcCompactSpan& span = compactHeightfield.spans[spanIndex];
+		context->log(RC_LOG_ERROR, "rcMarkConvexPolyAreas: Out of memory 'footprints' (%d).", numVolumes);
+		return false;
+	}
 
-				// Skip if span is removed.
-				if (compactHeightfield.areas[spanIndex] == RC_NULL_AREA)
-				{
-					continue;
-				}
+	// Sort the volumes inside the grid by their first row, keeping the input order within a row.
+	memset(rowStarts, 0, sizeof(int) * (zSize + 1));
+	for (int i = 0; i < numVolumes; ++i)
+	{
+		const rcConvexVolume& volume = volumes[i];
+		if (!calcPolyFootprint(volume.verts, volume.numVerts, volume.minY, volume.maxY, compactHeightfield, footprints[i]))
+		{
+			footprints[i].minz = -1;
+			continue;
+		}
+		rowStarts[footprints[i].minz + 1]++;
+	}
+	for (int z = 0; z < zSize; ++z)
+	{
+		rowStarts[z + 1] += rowStarts[z];
+	}
+	for (int i = 0; i < numVolumes; ++i)
+	{
+		if (footprints[i].minz >= 0)
+		{
+			sorted[rowStarts[footprints[i].minz]++] = i;
+		}
+	}
+	for (int z = zSize; z > 0; --z)
+	{
+		rowStarts[z] = rowStarts[z - 1];
+	}
+	rowStarts[0] = 0;
 
-				// Skip if y extents don't overlap.
-				if ((int)span.y < miny || (int)span.y > maxy)
-				{
-					continue;
-				}
+	// Sweep the rows, marking the volumes overlapping each row in input order so that later
+	// volumes overwrite earlier ones, like a call to rcMarkConvexPolyArea per volume.
+	int numActive = 0;
+	for (int z = 0; z < zSize; ++z)
+	{
+		// Drop the volumes that ended on the previous row.
+		int n = 0;
+		for (int i = 0; i < numActive; ++i)
+		{
+			if (footprints[active[i]].maxz >= z)
+			{
+				active[n++] = active[i];
+			}
+		}
+		numActive = n;
 
-				const float point[] = {
-					compactHeightfield.bmin[0] + ((float)x + 0.5f) * compactHeightfield.cs,
-					0,
-					compactHeightfield.bmin[2] + ((float)z + 0.5f) * compactHeightfield.cs
-				};
-				
-				if (pointInPoly(numVerts, verts, point))
-				{
-					compactHeightfield.areas[spanIndex] = areaId;
-				}
+		// Insert the volumes starting on this row.
+		for (int k = rowStarts[z]; k < rowStarts[z + 1]; ++k)
+		{
+			const int v = sorted[k];
+			int i = numActive++;
+			while (i > 0 && active[i - 1] > v)
+			{
+				active[i] = active[i - 1];
+				i--;
 			}
+			active[i] = v;
+		}
+
+		for (int i = 0; i < numActive; ++i)
+		{
+			const rcConvexVolume& volume = volumes[active[i]];
+			markPolyRow(volume.verts, volume.numVerts, footprints[active[i]], z, volume.areaId, compactHeightfield);
 		}
 	}
+
+	return true;
 }
 
 static const float EPSILON = 1e-6f;
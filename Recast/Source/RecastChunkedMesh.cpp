@@ -0,0 +1,532 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "RecastChunkedMesh.h"
+#include "RecastAssert.h"
+
+/// A stored triangle.
+struct rcChunkedMeshTri
+{
+	float verts[9];
+	unsigned int area;
+	unsigned int id;	///< The index of the triangle in the order it was added.
+};
+
+/// The header of a block of triangles, followed by the triangles.
+struct rcChunkedMeshBlockHeader
+{
+	uint64_t prevBlock;			///< The offset of the previous block of the cell. (RC_CHUNKEDMESH_NO_BLOCK if none.)
+	unsigned int prevBlockTris;	///< The number of triangles in the previous block.
+	unsigned int count;			///< The number of triangles in the block.
+};
+
+static const uint64_t RC_CHUNKEDMESH_NO_BLOCK = ~(uint64_t)0;
+
+/// The initial capacity of the buffer of a cell, which grows up to a full block.
+static const int RC_CHUNKEDMESH_MIN_BUFFER = 16;
+
+static void clearBounds(float* bmin, float* bmax)
+{
+	bmin[0] = bmin[1] = bmin[2] = FLT_MAX;
+	bmax[0] = bmax[1] = bmax[2] = -FLT_MAX;
+}
+
+static void calcTriBounds(const float* v, float* bmin, float* bmax)
+{
+	rcVcopy(bmin, &v[0]);
+	rcVcopy(bmax, &v[0]);
+	rcVmin(bmin, &v[3]);
+	rcVmax(bmax, &v[3]);
+	rcVmin(bmin, &v[6]);
+	rcVmax(bmax, &v[6]);
+}
+
+/// Returns the cells overlapping the xz-bounds, clamped to the grid.
+/// Used by both the writer and the reader, so that the cells of a triangle are the same.
+static void calcCellRange(const rcChunkedMeshHeader& header, const float* bmin, const float* bmax,
+						  int& x0, int& z0, int& x1, int& z1)
+{
+	const float ics = 1.0f / header.cellSize;
+	x0 = rcClamp((int)floorf((bmin[0] - header.orig[0]) * ics), 0, header.width - 1);
+	z0 = rcClamp((int)floorf((bmin[2] - header.orig[2]) * ics), 0, header.height - 1);
+	x1 = rcClamp((int)floorf((bmax[0] - header.orig[0]) * ics), 0, header.width - 1);
+	z1 = rcClamp((int)floorf((bmax[2] - header.orig[2]) * ics), 0, header.height - 1);
+}
+
+static int compareTriIds(const void* va, const void* vb)
+{
+	const rcChunkedMeshTri* a = (const rcChunkedMeshTri*)va;
+	const rcChunkedMeshTri* b = (const rcChunkedMeshTri*)vb;
+	if (a->id < b->id)
+		return -1;
+	if (a->id > b->id)
+		return 1;
+	return 0;
+}
+
+static inline bool overlapRect(const float* amin, const float* amax, const float* bmin, const float* bmax)
+{
+	return amin[0] <= bmax[0] && amax[0] >= bmin[0] && amin[2] <= bmax[2] && amax[2] >= bmin[2];
+}
+
+rcChunkedMeshWriter::rcChunkedMeshWriter()
+: m_out(0)
+, m_cells(0)
+, m_buffers(0)
+, m_bufferCounts(0)
+, m_bufferCaps(0)
+, m_offset(0)
+, m_buffered(0)
+, m_maxBuffered(0)
+, m_nextId(0)
+, m_failed(false)
+{
+	memset(&m_header, 0, sizeof(m_header));
+}
+
+rcChunkedMeshWriter::~rcChunkedMeshWriter()
+{
+	purge();
+}
+
+void rcChunkedMeshWriter::purge()
+{
+	if (m_buffers)
+	{
+		for (int i = 0; i < m_header.width * m_header.height; ++i)
+			rcFree(m_buffers[i]);
+	}
+	rcFree(m_buffers);
+	rcFree(m_bufferCounts);
+	rcFree(m_bufferCaps);
+	rcFree(m_cells);
+	m_buffers = 0;
+	m_bufferCounts = 0;
+	m_bufferCaps = 0;
+	m_cells = 0;
+	m_out = 0;
+	m_offset = 0;
+	m_buffered = 0;
+	m_nextId = 0;
+	m_failed = false;
+	memset(&m_header, 0, sizeof(m_header));
+}
+
+bool rcChunkedMeshWriter::init(rcContext* context, const float* bmin, const float* bmax, const float cellSize,
+							   const int maxBufferedTris, rcChunkedMeshOutput* out)
+{
+	rcAssert(context);
+
+	purge();
+
+	if (!out || !(cellSize > 0.0f) || maxBufferedTris <= 0)
+	{
+		context->log(RC_LOG_ERROR, "rcChunkedMeshWriter::init: Invalid output, cell size or buffer size.");
+		return false;
+	}
+
+	m_header.magic = RC_CHUNKEDMESH_MAGIC;
+	m_header.version = RC_CHUNKEDMESH_VERSION;
+	rcVcopy(m_header.orig, bmin);
+	m_header.cellSize = cellSize;
+	m_header.width = rcMax(1, (int)ceilf((bmax[0] - bmin[0]) / cellSize));
+	m_header.height = rcMax(1, (int)ceilf((bmax[2] - bmin[2]) / cellSize));
+	clearBounds(m_header.bmin, m_header.bmax);
+
+	const int ncells = m_header.width * m_header.height;
+	m_cells = (rcChunkedMeshCell*)rcAlloc(sizeof(rcChunkedMeshCell) * ncells, RC_ALLOC_PERM);
+	m_buffers = (rcChunkedMeshTri**)rcAlloc(sizeof(rcChunkedMeshTri*) * ncells, RC_ALLOC_PERM);
+	m_bufferCounts = (int*)rcAlloc(sizeof(int) * ncells, RC_ALLOC_PERM);
+	m_bufferCaps = (int*)rcAlloc(sizeof(int) * ncells, RC_ALLOC_PERM);
+	if (!m_cells || !m_buffers || !m_bufferCounts || !m_bufferCaps)
+	{
+		context->log(RC_LOG_ERROR, "rcChunkedMeshWriter::init: Out of memory for %d cells.", ncells);
+		// The buffer pointers may not be initialized.
+		rcFree(m_buffers);
+		m_buffers = 0;
+		purge();
+		return false;
+	}
+	for (int i = 0; i < ncells; ++i)
+	{
+		rcChunkedMeshCell& cell = m_cells[i];
+		cell.lastBlock = RC_CHUNKEDMESH_NO_BLOCK;
+		cell.triCount = 0;
+		cell.lastBlockTris = 0;
+		clearBounds(cell.bmin, cell.bmax);
+		m_buffers[i] = 0;
+		m_bufferCounts[i] = 0;
+		m_bufferCaps[i] = 0;
+	}
+
+	m_out = out;
+	m_maxBuffered = maxBufferedTris;
+	return true;
+}
+
+bool rcChunkedMeshWriter::writeBlock(const int cellIndex)
+{
+	rcChunkedMeshCell& cell = m_cells[cellIndex];
+	const int count = m_bufferCounts[cellIndex];
+	if (!count)
+		return true;
+
+	rcChunkedMeshBlockHeader block;
+	block.prevBlock = cell.lastBlock;
+	block.prevBlockTris = cell.lastBlockTris;
+	block.count = (unsigned int)count;
+	const int size = (int)sizeof(rcChunkedMeshTri) * count;
+	if (!m_out->write(&block, (int)sizeof(block)) || !m_out->write(m_buffers[cellIndex], size))
+		return false;
+
+	cell.lastBlock = m_offset;
+	cell.lastBlockTris = (unsigned int)count;
+	m_offset += sizeof(block) + size;
+
+	// The buffer is released, so that the memory held by the cells is bounded by the buffered triangles.
+	rcFree(m_buffers[cellIndex]);
+	m_buffers[cellIndex] = 0;
+	m_bufferCounts[cellIndex] = 0;
+	m_bufferCaps[cellIndex] = 0;
+	m_buffered -= count;
+	return true;
+}
+
+bool rcChunkedMeshWriter::flushAll()
+{
+	const int ncells = m_header.width * m_header.height;
+	for (int i = 0; i < ncells; ++i)
+	{
+		if (!writeBlock(i))
+			return false;
+	}
+	return true;
+}
+
+bool rcChunkedMeshWriter::addTriangles(rcContext* context, const float* verts, const int nverts, const int* tris,
+									   const unsigned char* areas, const int ntris)
+{
+	rcAssert(context);
+
+	if (!m_out || m_failed)
+	{
+		context->log(RC_LOG_ERROR, "rcChunkedMeshWriter::addTriangles: The writer is not initialized.");
+		return false;
+	}
+
+	for (int i = 0; i < ntris; ++i)
+	{
+		const int* t = &tris[i * 3];
+		if (t[0] < 0 || t[0] >= nverts || t[1] < 0 || t[1] >= nverts || t[2] < 0 || t[2] >= nverts)
+		{
+			context->log(RC_LOG_ERROR, "rcChunkedMeshWriter::addTriangles: Vertex index out of range (%d vertices).", nverts);
+			return false;
+		}
+
+		rcChunkedMeshTri tri;
+		rcVcopy(&tri.verts[0], &verts[t[0] * 3]);
+		rcVcopy(&tri.verts[3], &verts[t[1] * 3]);
+		rcVcopy(&tri.verts[6], &verts[t[2] * 3]);
+		tri.area = areas ? areas[i] : RC_WALKABLE_AREA;
+		tri.id = m_nextId++;
+
+		float bmin[3], bmax[3];
+		calcTriBounds(tri.verts, bmin, bmax);
+		rcVmin(m_header.bmin, bmin);
+		rcVmax(m_header.bmax, bmax);
+
+		int x0, z0, x1, z1;
+		calcCellRange(m_header, bmin, bmax, x0, z0, x1, z1);
+		for (int z = z0; z <= z1; ++z)
+		{
+			for (int x = x0; x <= x1; ++x)
+			{
+				const int c = x + z * m_header.width;
+				rcChunkedMeshCell& cell = m_cells[c];
+				rcVmin(cell.bmin, bmin);
+				rcVmax(cell.bmax, bmax);
+				cell.triCount++;
+				m_header.triCount++;
+
+				if (m_bufferCounts[c] == m_bufferCaps[c])
+				{
+					const int cap = rcMin(RC_CHUNKEDMESH_BLOCK_TRIS, rcMax(RC_CHUNKEDMESH_MIN_BUFFER, m_bufferCaps[c] * 2));
+					rcChunkedMeshTri* buffer = (rcChunkedMeshTri*)rcAlloc(sizeof(rcChunkedMeshTri) * cap, RC_ALLOC_PERM);
+					if (!buffer)
+					{
+						context->log(RC_LOG_ERROR, "rcChunkedMeshWriter::addTriangles: Out of memory 'buffer' (%d).", cap);
+						m_failed = true;
+						return false;
+					}
+					if (m_bufferCounts[c])
+						memcpy(buffer, m_buffers[c], sizeof(rcChunkedMeshTri) * m_bufferCounts[c]);
+					rcFree(m_buffers[c]);
+					m_buffers[c] = buffer;
+					m_bufferCaps[c] = cap;
+				}
+				m_buffers[c][m_bufferCounts[c]++] = tri;
+				m_buffered++;
+
+				const bool written = m_bufferCounts[c] == RC_CHUNKEDMESH_BLOCK_TRIS ? writeBlock(c) :
+					(m_buffered > m_maxBuffered ? flushAll() : true);
+				if (!written)
+				{
+					context->log(RC_LOG_ERROR, "rcChunkedMeshWriter::addTriangles: Could not write a block.");
+					m_failed = true;
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+bool rcChunkedMeshWriter::finish(rcContext* context)
+{
+	rcAssert(context);
+
+	if (!m_out || m_failed)
+	{
+		context->log(RC_LOG_ERROR, "rcChunkedMeshWriter::finish: The writer is not initialized.");
+		return false;
+	}
+	if (!flushAll())
+	{
+		context->log(RC_LOG_ERROR, "rcChunkedMeshWriter::finish: Could not write a block.");
+		purge();
+		return false;
+	}
+
+	if (!m_header.triCount)
+	{
+		rcVcopy(m_header.bmin, m_header.orig);
+		rcVcopy(m_header.bmax, m_header.orig);
+	}
+
+	m_header.tableOffset = m_offset;
+	const int ncells = m_header.width * m_header.height;
+	const bool written = m_out->write(m_cells, (int)sizeof(rcChunkedMeshCell) * ncells) &&
+		m_out->write(&m_header, (int)sizeof(m_header));
+	if (!written)
+		context->log(RC_LOG_ERROR, "rcChunkedMeshWriter::finish: Could not write the cell table.");
+	purge();
+	return written;
+}
+
+rcChunkedMesh::rcChunkedMesh()
+: m_in(0)
+, m_cells(0)
+{
+	memset(&m_header, 0, sizeof(m_header));
+}
+
+rcChunkedMesh::~rcChunkedMesh()
+{
+	rcFree(m_cells);
+}
+
+bool rcChunkedMesh::init(rcContext* context, rcChunkedMeshInput* in)
+{
+	rcAssert(context);
+
+	rcFree(m_cells);
+	m_cells = 0;
+	m_in = 0;
+	memset(&m_header, 0, sizeof(m_header));
+
+	const uint64_t size = in ? in->getSize() : 0;
+	rcChunkedMeshHeader header;
+	if (!in || size < sizeof(header) || !in->read(&header, size - sizeof(header), (int)sizeof(header)))
+	{
+		context->log(RC_LOG_ERROR, "rcChunkedMesh::init: Could not read the header.");
+		return false;
+	}
+	if (header.magic != RC_CHUNKEDMESH_MAGIC || header.version != RC_CHUNKEDMESH_VERSION)
+	{
+		context->log(RC_LOG_ERROR, "rcChunkedMesh::init: Wrong magic number or version.");
+		return false;
+	}
+	const uint64_t tableSize = (uint64_t)sizeof(rcChunkedMeshCell) * (uint64_t)header.width * (uint64_t)header.height;
+	if (header.width <= 0 || header.height <= 0 || !(header.cellSize > 0.0f) ||
+		tableSize > 0x7fffffff || header.tableOffset + tableSize + sizeof(header) != size)
+	{
+		context->log(RC_LOG_ERROR, "rcChunkedMesh::init: Invalid cell grid.");
+		return false;
+	}
+
+	m_cells = (rcChunkedMeshCell*)rcAlloc((size_t)tableSize, RC_ALLOC_PERM);
+	if (!m_cells)
+	{
+		context->log(RC_LOG_ERROR, "rcChunkedMesh::init: Out of memory for %d cells.", header.width * header.height);
+		return false;
+	}
+	if (!in->read(m_cells, header.tableOffset, (int)tableSize))
+	{
+		context->log(RC_LOG_ERROR, "rcChunkedMesh::init: Could not read the cell table.");
+		rcFree(m_cells);
+		m_cells = 0;
+		return false;
+	}
+
+	m_header = header;
+	m_in = in;
+	return true;
+}
+
+int rcChunkedMesh::getMaxTriangleCount(const float* bmin, const float* bmax) const
+{
+	if (!m_cells)
+		return 0;
+	int x0, z0, x1, z1;
+	calcCellRange(m_header, bmin, bmax, x0, z0, x1, z1);
+	int count = 0;
+	for (int z = z0; z <= z1; ++z)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			const rcChunkedMeshCell& cell = m_cells[x + z * m_header.width];
+			if (cell.triCount && overlapRect(bmin, bmax, cell.bmin, cell.bmax))
+				count += (int)cell.triCount;
+		}
+	}
+	return count;
+}
+
+bool rcChunkedMesh::readTriangles(rcContext* context, const float* bmin, const float* bmax, float* verts,
+								  unsigned char* areas, const int maxTris, int* ntris) const
+{
+	rcAssert(context);
+
+	*ntris = 0;
+	if (!m_cells)
+	{
+		context->log(RC_LOG_ERROR, "rcChunkedMesh::readTriangles: The mesh is not initialized.");
+		return false;
+	}
+
+	const int bufferSize = (int)sizeof(rcChunkedMeshBlockHeader) + (int)sizeof(rcChunkedMeshTri) * RC_CHUNKEDMESH_BLOCK_TRIS;
+	rcScopedDelete<unsigned char> buffer((unsigned char*)rcAlloc(bufferSize, RC_ALLOC_TEMP));
+	rcScopedDelete<rcChunkedMeshTri> found((rcChunkedMeshTri*)rcAlloc(sizeof(rcChunkedMeshTri) * rcMax(maxTris, 1), RC_ALLOC_TEMP));
+	if (!buffer || !found)
+	{
+		context->log(RC_LOG_ERROR, "rcChunkedMesh::readTriangles: Out of memory for %d triangles.", maxTris);
+		return false;
+	}
+
+	int qx0, qz0, qx1, qz1;
+	calcCellRange(m_header, bmin, bmax, qx0, qz0, qx1, qz1);
+	int n = 0;
+	for (int z = qz0; z <= qz1; ++z)
+	{
+		for (int x = qx0; x <= qx1; ++x)
+		{
+			const rcChunkedMeshCell& cell = m_cells[x + z * m_header.width];
+			if (!cell.triCount || !overlapRect(bmin, bmax, cell.bmin, cell.bmax))
+				continue;
+
+			uint64_t offset = cell.lastBlock;
+			unsigned int count = cell.lastBlockTris;
+			while (offset != RC_CHUNKEDMESH_NO_BLOCK)
+			{
+				const int size = (int)sizeof(rcChunkedMeshBlockHeader) + (int)sizeof(rcChunkedMeshTri) * (int)count;
+				if (count > (unsigned int)RC_CHUNKEDMESH_BLOCK_TRIS || !m_in->read(buffer, offset, size))
+				{
+					context->log(RC_LOG_ERROR, "rcChunkedMesh::readTriangles: Could not read a block.");
+					return false;
+				}
+				rcChunkedMeshBlockHeader block;
+				memcpy(&block, buffer, sizeof(block));
+				if (block.count != count)
+				{
+					context->log(RC_LOG_ERROR, "rcChunkedMesh::readTriangles: Corrupt block.");
+					return false;
+				}
+
+				const rcChunkedMeshTri* tris = (const rcChunkedMeshTri*)(buffer + sizeof(block));
+				for (unsigned int i = 0; i < count; ++i)
+				{
+					const rcChunkedMeshTri& tri = tris[i];
+					float tmin[3], tmax[3];
+					calcTriBounds(tri.verts, tmin, tmax);
+					if (!overlapRect(bmin, bmax, tmin, tmax))
+						continue;
+
+					// A triangle stored in several cells is only taken from the first cell of the query it is in.
+					int tx0, tz0, tx1, tz1;
+					calcCellRange(m_header, tmin, tmax, tx0, tz0, tx1, tz1);
+					if (x != rcMax(tx0, qx0) || z != rcMax(tz0, qz0))
+						continue;
+
+					if (n >= maxTris)
+					{
+						context->log(RC_LOG_ERROR, "rcChunkedMesh::readTriangles: Too many triangles (%d).", maxTris);
+						return false;
+					}
+					found[n++] = tri;
+				}
+
+				offset = block.prevBlock;
+				count = block.prevBlockTris;
+			}
+		}
+	}
+
+	// The triangles are returned in the order they were added, which the rasterization depends on.
+	qsort(found, (size_t)n, sizeof(rcChunkedMeshTri), compareTriIds);
+	for (int i = 0; i < n; ++i)
+	{
+		memcpy(&verts[i * 9], found[i].verts, sizeof(found[i].verts));
+		areas[i] = (unsigned char)found[i].area;
+	}
+
+	*ntris = n;
+	return true;
+}
+
+bool rcRasterizeChunkedMeshTile(rcContext* context, const rcChunkedMesh& mesh, const rcConfig& tileCfg,
+								rcHeightfield& heightfield)
+{
+	rcAssert(context);
+
+	const int maxTris = mesh.getMaxTriangleCount(heightfield.bmin, heightfield.bmax);
+	if (!maxTris)
+		return true;
+
+	rcScopedDelete<float> verts((float*)rcAlloc(sizeof(float) * maxTris * 9, RC_ALLOC_TEMP));
+	rcScopedDelete<int> tris((int*)rcAlloc(sizeof(int) * maxTris * 3, RC_ALLOC_TEMP));
+	rcScopedDelete<unsigned char> areas((unsigned char*)rcAlloc(sizeof(unsigned char) * maxTris, RC_ALLOC_TEMP));
+	if (!verts || !tris || !areas)
+	{
+		context->log(RC_LOG_ERROR, "rcRasterizeChunkedMeshTile: Out of memory for %d triangles.", maxTris);
+		return false;
+	}
+
+	int ntris = 0;
+	if (!mesh.readTriangles(context, heightfield.bmin, heightfield.bmax, verts, areas, maxTris, &ntris))
+		return false;
+	for (int i = 0; i < ntris * 3; ++i)
+		tris[i] = i;
+
+	rcClearUnwalkableTriangles(context, tileCfg.walkableSlopeAngle, verts, ntris * 3, tris, ntris, areas);
+	return rcRasterizeTriangles(context, verts, ntris * 3, tris, areas, ntris, heightfield, tileCfg.walkableClimb);
+}
@@ -206,7 +206,111 @@ static float distancePtSeg(const int x, const int z,
 	return dx*dx + dz*dz;
 }
 
-static void simplifyContour(rcIntArray& points, rcIntArray& simplified,
+// Returns the raw point between a and b that deviates the most from the segment if it
+// deviates more than the error tolerance, or -1.
+static int findMaxDeviation(const rcIntArray& points, const int ai, const int bi, const float maxError)
+{
+	const int pn = points.size()/4;
+	int ax = points[ai*4+0];
+	int az = points[ai*4+2];
+	int bx = points[bi*4+0];
+	int bz = points[bi*4+2];
+	
+	// Find maximum deviation from the segment.
+	float maxd = 0;
+	int maxi = -1;
+	int ci, endi;
+	bool forward;
+	
+	// Traverse the segment in lexilogical order so that the
+	// max deviation is calculated similarly when traversing
+	// opposite segments.
+	if (bx > ax || (bx == ax && bz > az))
+	{
+		forward = true;
+		ci = ai+1 < pn ? ai+1 : 0;
+		endi = bi;
+	}
+	else
+	{
+		forward = false;
+		ci = bi > 0 ? bi-1 : pn-1;
+		endi = ai;
+		rcSwap(ax, bx);
+		rcSwap(az, bz);
+	}
+	
+	// Tessellate only outer edges or edges between areas.
+	if ((points[ci*4+3] & RC_CONTOUR_REG_MASK) == 0 ||
+		(points[ci*4+3] & RC_AREA_BORDER))
+	{
+		while (ci != endi)
+		{
+			float d = distancePtSeg(points[ci*4+0], points[ci*4+2], ax, az, bx, bz);
+			if (d > maxd)
+			{
+				maxd = d;
+				maxi = ci;
+			}
+			if (forward)
+				ci = ci+1 < pn ? ci+1 : 0;
+			else
+				ci = ci > 0 ? ci-1 : pn-1;
+		}
+	}
+	
+	// If the max deviation is larger than accepted error, add new point.
+	if (maxi != -1 && maxd > (maxError*maxError))
+		return maxi;
+	return -1;
+}
+
+// Returns the raw point where the segment from a to b is split if it is too long, or -1.
+static int findEdgeSplit(const rcIntArray& points, const int ai, const int bi,
+						 const int maxEdgeLen, const int buildFlags)
+{
+	const int pn = points.size()/4;
+	const int ax = points[ai*4+0];
+	const int az = points[ai*4+2];
+	const int bx = points[bi*4+0];
+	const int bz = points[bi*4+2];
+	
+	int maxi = -1;
+	int ci = (ai+1) % pn;
+	
+	// Tessellate only outer edges or edges between areas.
+	bool tess = false;
+	// Wall edges.
+	if ((buildFlags & RC_CONTOUR_TESS_WALL_EDGES) && (points[ci*4+3] & RC_CONTOUR_REG_MASK) == 0)
+		tess = true;
+	// Edges between areas.
+	if ((buildFlags & RC_CONTOUR_TESS_AREA_EDGES) && (points[ci*4+3] & RC_AREA_BORDER))
+		tess = true;
+	
+	if (tess)
+	{
+		int dx = bx - ax;
+		int dz = bz - az;
+		if (dx*dx + dz*dz > maxEdgeLen*maxEdgeLen)
+		{
+			// Round based on the segments in lexilogical order so that the
+			// max tesselation is consistent regardless in which direction
+			// segments are traversed.
+			const int n = bi < ai ? (bi+pn - ai) : (bi - ai);
+			if (n > 1)
+			{
+				if (bx > ax || (bx == ax && bz > az))
+					maxi = (ai + n/2) % pn;
+				else
+					maxi = (ai + (n+1)/2) % pn;
+			}
+		}
+	}
+	return maxi;
+}
+
+// The ends are a scratch array for the segment ends still to be simplified.
+static void simplifyContour(rcIntArray& points, rcIntArray& simplified, rcIntArray& ends,
 							const float maxError, const int maxEdgeLen, const int buildFlags)
 {
 	// Add initial points.
@@ -283,160 +387,51 @@ static void simplifyContour(rcIntArray& points, rcIntArray& simplified,
 		simplified.push(uri);
 	}
 	
-	// Add points until all raw points are within
-	// error tolerance to the simplified shape.
+	// Add points until all raw points are within error tolerance to the simplified
+	// shape, then split too long edges. The segments are split independently of each
+	// other, so the points are added in order with a stack of the segment ends.
 	const int pn = points.size()/4;
-	for (int i = 0; i < simplified.size()/4; )
+	const bool splitEdges = maxEdgeLen > 0 && (buildFlags & (RC_CONTOUR_TESS_WALL_EDGES|RC_CONTOUR_TESS_AREA_EDGES)) != 0;
+	const int ninit = simplified.size()/4;
+	ends.clear();
+	ends.push(simplified[3]*2);
+	for (int i = ninit-1; i > 0; --i)
+		ends.push(simplified[i*4+3]*2);
+	int ai = simplified[3];
+	simplified.clear();
+	while (ends.size() > 0)
 	{
-		int ii = (i+1) % (simplified.size()/4);
-		
-		int ax = simplified[i*4+0];
-		int az = simplified[i*4+2];
-		int ai = simplified[i*4+3];
-
-		int bx = simplified[ii*4+0];
-		int bz = simplified[ii*4+2];
-		int bi = simplified[ii*4+3];
-
-		// Find maximum deviation from the segment.
-		float maxd = 0;
+		// The low bit is set once the segment is within the error tolerance.
+		const int end = ends[ends.size()-1];
+		const int bi = end >> 1;
 		int maxi = -1;
-		int ci, cinc, endi;
-
-		// Traverse the segment in lexilogical order so that the
-		// max deviation is calculated similarly when traversing
-		// opposite segments.
-		if (bx > ax || (bx == ax && bz > az))
-		{
-			cinc = 1;
-			ci = (ai+cinc) % pn;
-			endi = bi;
-		}
-		else
-		{
-			cinc = pn-1;
-			ci = (bi+cinc) % pn;
-			endi = ai;
-			rcSwap(ax, bx);
-			rcSwap(az, bz);
-		}
-		
-		// Tessellate only outer edges or edges between areas.
-		if ((points[ci*4+3] & RC_CONTOUR_REG_MASK) == 0 ||
-			(points[ci*4+3] & RC_AREA_BORDER))
-		{
-			while (ci != endi)
-			{
-				float d = distancePtSeg(points[ci*4+0], points[ci*4+2], ax, az, bx, bz);
-				if (d > maxd)
-				{
-					maxd = d;
-					maxi = ci;
-				}
-				ci = (ci+cinc) % pn;
-			}
-		}
-		
-		
-		// If the max deviation is larger than accepted error,
-		// add new point, else continue to next segment.
-		if (maxi != -1 && maxd > (maxError*maxError))
+		if ((end & 1) == 0)
 		{
-			// Add space for the new point.
-			simplified.resize(simplified.size()+4);
-			const int n = simplified.size()/4;
-			for (int j = n-1; j > i; --j)
+			maxi = findMaxDeviation(points, ai, bi, maxError);
+			if (maxi == -1)
 			{
-				simplified[j*4+0] = simplified[(j-1)*4+0];
-				simplified[j*4+1] = simplified[(j-1)*4+1];
-				simplified[j*4+2] = simplified[(j-1)*4+2];
-				simplified[j*4+3] = simplified[(j-1)*4+3];
+				ends[ends.size()-1] = end | 1;
+				if (splitEdges)
+					continue;
 			}
-			// Add the point.
-			simplified[(i+1)*4+0] = points[maxi*4+0];
-			simplified[(i+1)*4+1] = points[maxi*4+1];
-			simplified[(i+1)*4+2] = points[maxi*4+2];
-			simplified[(i+1)*4+3] = maxi;
 		}
 		else
 		{
-			++i;
+			maxi = findEdgeSplit(points, ai, bi, maxEdgeLen, buildFlags);
 		}
-	}
-	
-	// Split too long edges.
-	if (maxEdgeLen > 0 && (buildFlags & (RC_CONTOUR_TESS_WALL_EDGES|RC_CONTOUR_TESS_AREA_EDGES)) != 0)
-	{
-		for (int i = 0; i < simplified.size()/4; )
+		
+		if (maxi != -1)
 		{
-			const int ii = (i+1) % (simplified.size()/4);
-			
-			const int ax = simplified[i*4+0];
-			const int az = simplified[i*4+2];
-			const int ai = simplified[i*4+3];
-			
-			const int bx = simplified[ii*4+0];
-			const int bz = simplified[ii*4+2];
-			const int bi = simplified[ii*4+3];
-			
-			// Find maximum deviation from the segment.
-			int maxi = -1;
-			int ci = (ai+1) % pn;
-			
-			// Tessellate only outer edges or edges between areas.
-			bool tess = false;
-			// Wall edges.
-			if ((buildFlags & RC_CONTOUR_TESS_WALL_EDGES) && (points[ci*4+3] & RC_CONTOUR_REG_MASK) == 0)
-				tess = true;
-			// Edges between areas.
-			if ((buildFlags & RC_CONTOUR_TESS_AREA_EDGES) && (points[ci*4+3] & RC_AREA_BORDER))
-				tess = true;
-			
-			if (tess)
-			{
-				int dx = bx - ax;
-				int dz = bz - az;
-				if (dx*dx + dz*dz > maxEdgeLen*maxEdgeLen)
-				{
-					// Round based on the segments in lexilogical order so that the
-					// max tesselation is consistent regardless in which direction
-					// segments are traversed.
-					const int n = bi < ai ? (bi+pn - ai) : (bi - ai);
-					if (n > 1)
-					{
-						if (bx > ax || (bx == ax && bz > az))
-							maxi = (ai + n/2) % pn;
-						else
-							maxi = (ai + (n+1)/2) % pn;
-					}
-				}
-			}
-			
-			// If the max deviation is larger than accepted error,
-			// add new point, else continue to next segment.
-			if (maxi != -1)
-			{
-				// Add space for the new point.
-				simplified.resize(simplified.size()+4);
-				const int n = simplified.size()/4;
-				for (int j = n-1; j > i; --j)
-				{
-					simplified[j*4+0] = simplified[(j-1)*4+0];
-					simplified[j*4+1] = simplified[(j-1)*4+1];
-					simplified[j*4+2] = simplified[(j-1)*4+2];
-					simplified[j*4+3] = simplified[(j-1)*4+3];
-				}
-				// Add the point.
-				simplified[(i+1)*4+0] = points[maxi*4+0];
-				simplified[(i+1)*4+1] = points[maxi*4+1];
-				simplified[(i+1)*4+2] = points[maxi*4+2];
-				simplified[(i+1)*4+3] = maxi;
-			}
-			else
-			{
-				++i;
-			}
+			ends.push(maxi*2 + (end & 1));
+			continue;
 		}
+		
+		ends.pop();
+		simplified.push(points[ai*4+0]);
+		simplified.push(points[ai*4+1]);
+		simplified.push(points[ai*4+2]);
+		simplified.push(ai);
+		ai = bi;
 	}
 	
 	for (int i = 0; i < simplified.size()/4; ++i)
@@ -807,6 +802,356 @@ static void mergeRegionHoles(rcContext* ctx, rcContourRegion& region)
 }
 
 
+// Adds a contour to the set, growing the contour array when a region has holes.
+// The vertices are moved out of the border of the heightfield.
+static bool addContour(rcContext* ctx, rcContourSet& cset,
+					   const int* verts, const int nverts, const int* rverts, const int nrverts,
+					   const unsigned short reg, const unsigned char area)
+{
+	const int borderSize = cset.borderSize;
+	
+	if (cset.nconts >= cset.maxconts)
+	{
+		// Allocate more contours.
+		// This happens when a region has holes.
+		const int oldMax = cset.maxconts;
+		const int maxContours = oldMax*2;
+		rcContour* newConts = (rcContour*)rcAlloc(sizeof(rcContour)*maxContours, RC_ALLOC_PERM);
+		if (!newConts)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'conts' (%d).", maxContours);
+			return false;
+		}
+		for (int j = 0; j < cset.nconts; ++j)
+		{
+			newConts[j] = cset.conts[j];
+			// Reset source pointers to prevent data deletion.
+			cset.conts[j].verts = 0;
+			cset.conts[j].rverts = 0;
+		}
+		rcFree(cset.conts);
+		cset.conts = newConts;
+		cset.maxconts = maxContours;
+		
+		ctx->log(RC_LOG_WARNING, "rcBuildContours: Expanding max contours from %d to %d.", oldMax, maxContours);
+	}
+	
+	rcContour* cont = &cset.conts[cset.nconts++];
+	
+	cont->nverts = nverts;
+	cont->verts = (int*)rcAlloc(sizeof(int)*cont->nverts*4, RC_ALLOC_PERM);
+	if (!cont->verts)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'verts' (%d).", cont->nverts);
+		return false;
+	}
+	memcpy(cont->verts, verts, sizeof(int)*cont->nverts*4);
+	if (borderSize > 0)
+	{
+		// If the heightfield was build with bordersize, remove the offset.
+		for (int j = 0; j < cont->nverts; ++j)
+		{
+			int* v = &cont->verts[j*4];
+			v[0] -= borderSize;
+			v[2] -= borderSize;
+		}
+	}
+	
+	cont->nrverts = nrverts;
+	cont->rverts = (int*)rcAlloc(sizeof(int)*cont->nrverts*4, RC_ALLOC_PERM);
+	if (!cont->rverts)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'rverts' (%d).", cont->nrverts);
+		return false;
+	}
+	memcpy(cont->rverts, rverts, sizeof(int)*cont->nrverts*4);
+	if (borderSize > 0)
+	{
+		// If the heightfield was build with bordersize, remove the offset.
+		for (int j = 0; j < cont->nrverts; ++j)
+		{
+			int* v = &cont->rverts[j*4];
+			v[0] -= borderSize;
+			v[2] -= borderSize;
+		}
+	}
+	
+	cont->reg = reg;
+	cont->area = area;
+	
+	return true;
+}
+
+/// The buffers of a worker of the parallel contour build. The traced and simplified
+/// vertices of all contours of the worker are collected in outVerts and outRverts.
+struct rcContourScratch
+{
+	inline rcContourScratch() : verts(256), simplified(64), ends(64) {}
+
+	rcIntArray verts;
+	rcIntArray simplified;
+	rcIntArray ends;
+	rcTempVector<int> outVerts;
+	rcTempVector<int> outRverts;
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcContourScratch(const rcContourScratch&);
+	rcContourScratch& operator=(const rcContourScratch&);
+};
+
+/// Owns an array of scratch buffers.
+struct rcContourScratchArray
+{
+	inline rcContourScratchArray() : items(0), count(0) {}
+	inline ~rcContourScratchArray()
+	{
+		for (int i = 0; i < count; ++i)
+			items[i].~rcContourScratch();
+		rcFree(items);
+	}
+
+	bool init(const int n)
+	{
+		items = (rcContourScratch*)rcAlloc(sizeof(rcContourScratch)*n, RC_ALLOC_TEMP);
+		if (!items)
+			return false;
+		for (; count < n; ++count)
+			::new(rcNewTag(), (void*)&items[count]) rcContourScratch();
+		return true;
+	}
+
+	rcContourScratch* items;
+	int count;
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcContourScratchArray(const rcContourScratchArray&);
+	rcContourScratchArray& operator=(const rcContourScratchArray&);
+};
+
+/// Where the parallel build stored the contour traced from a start span.
+struct rcContourResult
+{
+	int worker;			///< The worker whose scratch holds the contour.
+	int vertBase;		///< The index of the first simplified vertex in the scratch output.
+	int nverts;			///< The number of simplified vertices, zero when no contour was created.
+	int rvertBase;		///< The index of the first raw vertex in the scratch output.
+	int nrverts;		///< The number of raw vertices.
+};
+
+struct rcContourJob
+{
+	const rcCompactHeightfield* chf;
+	unsigned char* flags;
+	const int* starts;			///< The x, y and span index of each start span, in scan line order.
+	const int* order;			///< The start spans sorted by region.
+	const int* regionStarts;	///< The first entry of each region in order, maxRegions+2 entries.
+	const int* jobRegions;		///< The first region of each job, jobCount+1 entries.
+	float maxError;
+	int maxEdgeLen;
+	int buildFlags;
+	rcContext** contexts;
+	rcContourScratch* scratch;
+	rcContourResult* results;
+};
+
+static void buildContoursJob(void* userData, const int jobIndex, const int workerIndex)
+{
+	const rcContourJob* job = (const rcContourJob*)userData;
+	const rcCompactHeightfield& chf = *job->chf;
+	rcContourScratch& scratch = job->scratch[workerIndex];
+	rcContext* ctx = job->contexts[workerIndex];
+	
+	// The scratch buffers are grown here and freed by the calling thread.
+	rcTempArenaScope arenaScope(0);
+	
+	// The regions are traced independently, in the order of the serial build.
+	const int k0 = job->regionStarts[job->jobRegions[jobIndex]];
+	const int k1 = job->regionStarts[job->jobRegions[jobIndex+1]];
+	for (int k = k0; k < k1; ++k)
+	{
+		const int s = job->order[k];
+		const int x = job->starts[s*3+0];
+		const int y = job->starts[s*3+1];
+		const int i = job->starts[s*3+2];
+		rcContourResult& res = job->results[s];
+		res.nverts = 0;
+		if (job->flags[i] == 0)
+			continue;
+		
+		scratch.verts.clear();
+		scratch.simplified.clear();
+		
+		ctx->startTimer(RC_TIMER_BUILD_CONTOURS_TRACE);
+		walkContour(x, y, i, chf, job->flags, scratch.verts);
+		ctx->stopTimer(RC_TIMER_BUILD_CONTOURS_TRACE);
+		
+		ctx->startTimer(RC_TIMER_BUILD_CONTOURS_SIMPLIFY);
+		simplifyContour(scratch.verts, scratch.simplified, scratch.ends, job->maxError, job->maxEdgeLen, job->buildFlags);
+		removeDegenerateSegments(scratch.simplified);
+		ctx->stopTimer(RC_TIMER_BUILD_CONTOURS_SIMPLIFY);
+		
+		if (scratch.simplified.size()/4 < 3)
+			continue;
+		
+		res.worker = workerIndex;
+		res.vertBase = (int)scratch.outVerts.size()/4;
+		res.nverts = scratch.simplified.size()/4;
+		res.rvertBase = (int)scratch.outRverts.size()/4;
+		res.nrverts = scratch.verts.size()/4;
+		for (int j = 0; j < scratch.simplified.size(); ++j)
+			scratch.outVerts.push_back(scratch.simplified[j]);
+		for (int j = 0; j < scratch.verts.size(); ++j)
+			scratch.outRverts.push_back(scratch.verts[j]);
+	}
+}
+
+/// Traces and simplifies the contours of the regions in jobs, and adds them to the
+/// set in the order of the serial build.
+static bool buildContoursParallel(rcContext* ctx, const rcCompactHeightfield& chf, unsigned char* flags,
+								  const float maxError, const int maxEdgeLen, const int buildFlags,
+								  rcContourSet& cset, rcJobDispatcher* dispatcher, rcContext** workerContexts)
+{
+	const int w = chf.width;
+	const int h = chf.height;
+	const int workerCount = rcMax(1, dispatcher->getWorkerCount());
+	const int nregions = chf.maxRegions+1;
+	
+	// Collect the spans the serial build could start a contour from, and count them per region.
+	rcScopedDelete<int> regionStarts((int*)rcAlloc(sizeof(int)*(nregions+1), RC_ALLOC_TEMP));
+	if (!regionStarts)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'regionStarts' (%d).", nregions+1);
+		return false;
+	}
+	memset(regionStarts, 0, sizeof(int)*(nregions+1));
+	int nstarts = 0;
+	for (int i = 0; i < chf.spanCount; ++i)
+	{
+		if (flags[i] == 0 || flags[i] == 0xf)
+			flags[i] = 0;
+		else
+			nstarts++;
+	}
+	if (!nstarts)
+		return true;
+	
+	rcScopedDelete<int> starts((int*)rcAlloc(sizeof(int)*nstarts*3, RC_ALLOC_TEMP));
+	rcScopedDelete<int> order((int*)rcAlloc(sizeof(int)*nstarts, RC_ALLOC_TEMP));
+	rcScopedDelete<rcContourResult> results((rcContourResult*)rcAlloc(sizeof(rcContourResult)*nstarts, RC_ALLOC_TEMP));
+	if (!starts || !order || !results)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'starts' (%d).", nstarts);
+		return false;
+	}
+	int n = 0;
+	for (int y = 0; y < h; ++y)
+	{
+		for (int x = 0; x < w; ++x)
+		{
+			const rcCompactCell& c = chf.cells[x+y*w];
+			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
+			{
+				if (flags[i] == 0)
+					continue;
+				starts[n*3+0] = x;
+				starts[n*3+1] = y;
+				starts[n*3+2] = i;
+				regionStarts[chf.spans[i].reg+1]++;
+				n++;
+			}
+		}
+	}
+	for (int r = 0; r < nregions; ++r)
+		regionStarts[r+1] += regionStarts[r];
+	{
+		rcScopedDelete<int> next((int*)rcAlloc(sizeof(int)*nregions, RC_ALLOC_TEMP));
+		if (!next)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'next' (%d).", nregions);
+			return false;
+		}
+		memcpy(next, regionStarts, sizeof(int)*nregions);
+		for (int s = 0; s < nstarts; ++s)
+			order[next[chf.spans[starts[s*3+2]].reg]++] = s;
+	}
+	
+	// Split the regions into jobs of about the same number of start spans.
+	const int jobCount = rcMin(nstarts, workerCount*8);
+	rcScopedDelete<int> jobRegions((int*)rcAlloc(sizeof(int)*(jobCount+1), RC_ALLOC_TEMP));
+	if (!jobRegions)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'jobRegions' (%d).", jobCount+1);
+		return false;
+	}
+	int r = 0;
+	for (int j = 0; j < jobCount; ++j)
+	{
+		const int first = (int)((long long)nstarts * j / jobCount);
+		while (r < nregions && regionStarts[r+1] <= first)
+			r++;
+		jobRegions[j] = r;
+	}
+	jobRegions[jobCount] = nregions;
+	
+	// With a dispatcher the scratch buffers are shared between threads, so they
+	// must not use the temporary memory arena of any thread.
+	rcContourScratchArray scratch;
+	bool scratchReady;
+	{
+		rcTempArenaScope arenaScope(0);
+		scratchReady = scratch.init(workerCount);
+	}
+	if (!scratchReady)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'scratch' (%d).", workerCount);
+		return false;
+	}
+	
+	// Workers without a context share one with logging and timers disabled,
+	// which never touches its state and is safe to use concurrently.
+	rcContext disabledContext(false);
+	rcScopedDelete<rcContext*> contexts((rcContext**)rcAlloc(sizeof(rcContext*)*workerCount, RC_ALLOC_TEMP));
+	if (!contexts)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'contexts' (%d).", workerCount);
+		return false;
+	}
+	for (int i = 0; i < workerCount; ++i)
+		contexts[i] = workerContexts ? workerContexts[i] : &disabledContext;
+	
+	rcContourJob job;
+	job.chf = &chf;
+	job.flags = flags;
+	job.starts = starts;
+	job.order = order;
+	job.regionStarts = regionStarts;
+	job.jobRegions = jobRegions;
+	job.maxError = maxError;
+	job.maxEdgeLen = maxEdgeLen;
+	job.buildFlags = buildFlags;
+	job.contexts = contexts;
+	job.scratch = scratch.items;
+	job.results = results;
+	rcDispatchJobs(dispatcher, buildContoursJob, &job, jobCount);
+	
+	// Add the contours in the order of their start spans.
+	for (int s = 0; s < nstarts; ++s)
+	{
+		const rcContourResult& res = results[s];
+		if (!res.nverts)
+			continue;
+		const int i = starts[s*3+2];
+		const rcContourScratch& sc = scratch.items[res.worker];
+		if (!addContour(ctx, cset, &sc.outVerts[res.vertBase*4], res.nverts, &sc.outRverts[res.rvertBase*4], res.nrverts,
+						chf.spans[i].reg, chf.areas[i]))
+			return false;
+	}
+	
+	return true;
+}
+
 /// @par
 ///
 /// The raw contours will match the region outlines exactly. The @p maxError and @p maxEdgeLen
@@ -823,6 +1168,22 @@ static void mergeRegionHoles(rcContext* ctx, rcContourRegion& region)
 bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 					 const float maxError, const int maxEdgeLen,
 					 rcContourSet& cset, const int buildFlags)
+{
+	return rcBuildContours(ctx, chf, maxError, maxEdgeLen, cset, buildFlags, 0, 0);
+}
+
+/// @par
+///
+/// The boundaries are marked serially. Each job then traces and simplifies the contours of
+/// a range of regions into the scratch of its worker. A region only clears the flags of its
+/// own spans, so the regions are independent. The contours are added to @p cset in the order
+/// of the spans they were traced from, so the result is identical to the serial build.
+///
+/// @see rcAllocContourSet, rcCompactHeightfield, rcContourSet, rcConfig, rcJobDispatcher
+bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
+					 const float maxError, const int maxEdgeLen,
+					 rcContourSet& cset, const int buildFlags,
+					 rcJobDispatcher* dispatcher, rcContext** workerContexts)
 {
 	rcAssert(ctx);
 	
@@ -850,12 +1211,25 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 	cset.borderSize = chf.borderSize;
 	cset.maxError = maxError;
 	
-	int maxContours = rcMax((int)chf.maxRegions, 8);
-	cset.conts = (rcContour*)rcAlloc(sizeof(rcContour)*maxContours, RC_ALLOC_PERM);
-	if (!cset.conts)
-		return false;
+	// Release the contours of a previous build, but keep the contour array when it is large enough.
+	for (int i = 0; i < cset.nconts; ++i)
+	{
+		rcFree(cset.conts[i].verts);
+		rcFree(cset.conts[i].rverts);
+	}
 	cset.nconts = 0;
 	
+	int maxContours = rcMax((int)chf.maxRegions, 8);
+	if (!cset.conts || cset.maxconts < maxContours)
+	{
+		rcFree(cset.conts);
+		cset.maxconts = 0;
+		cset.conts = (rcContour*)rcAlloc(sizeof(rcContour)*maxContours, RC_ALLOC_PERM);
+		if (!cset.conts)
+			return false;
+		cset.maxconts = maxContours;
+	}
+	
 	rcScopedDelete<unsigned char> flags((unsigned char*)rcAlloc(sizeof(unsigned char)*chf.spanCount, RC_ALLOC_TEMP));
 	if (!flags)
 	{
@@ -900,105 +1274,54 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 	
 	ctx->stopTimer(RC_TIMER_BUILD_CONTOURS_TRACE);
 	
-	rcIntArray verts(256);
-	rcIntArray simplified(64);
-	
-	for (int y = 0; y < h; ++y)
+	if (dispatcher)
 	{
-		for (int x = 0; x < w; ++x)
+		if (!buildContoursParallel(ctx, chf, flags, maxError, maxEdgeLen, buildFlags, cset, dispatcher, workerContexts))
+			return false;
+	}
+	else
+	{
+		rcIntArray verts(256);
+		rcIntArray simplified(64);
+		rcIntArray ends(64);
+			
+		for (int y = 0; y < h; ++y)
 		{
-			const rcCompactCell& c = chf.cells[x+y*w];
-			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
+			for (int x = 0; x < w; ++x)
 			{
-				if (flags[i] == 0 || flags[i] == 0xf)
+				const rcCompactCell& c = chf.cells[x+y*w];
+				for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
 				{
-					flags[i] = 0;
-					continue;
-				}
-				const unsigned short reg = chf.spans[i].reg;
-				if (!reg || (reg & RC_BORDER_REG))
-					continue;
-				const unsigned char area = chf.areas[i];
-				
-				verts.clear();
-				simplified.clear();
-				
-				ctx->startTimer(RC_TIMER_BUILD_CONTOURS_TRACE);
-				walkContour(x, y, i, chf, flags, verts);
-				ctx->stopTimer(RC_TIMER_BUILD_CONTOURS_TRACE);
-				
-				ctx->startTimer(RC_TIMER_BUILD_CONTOURS_SIMPLIFY);
-				simplifyContour(verts, simplified, maxError, maxEdgeLen, buildFlags);
-				removeDegenerateSegments(simplified);
-				ctx->stopTimer(RC_TIMER_BUILD_CONTOURS_SIMPLIFY);
-				
-				
-				// Store region->contour remap info.
-				// Create contour.
-				if (simplified.size()/4 >= 3)
-				{
-					if (cset.nconts >= maxContours)
+					if (flags[i] == 0 || flags[i] == 0xf)
 					{
-						// Allocate more contours.
-						// This happens when a region has holes.
-						const int oldMax = maxContours;
-						maxContours *= 2;
-						rcContour* newConts = (rcContour*)rcAlloc(sizeof(rcContour)*maxContours, RC_ALLOC_PERM);
-						for (int j = 0; j < cset.nconts; ++j)
-						{
-							newConts[j] = cset.conts[j];
-							// Reset source pointers to prevent data deletion.
-							cset.conts[j].verts = 0;
-							cset.conts[j].rverts = 0;
-						}
-						rcFree(cset.conts);
-						cset.conts = newConts;
-						
-						ctx->log(RC_LOG_WARNING, "rcBuildContours: Expanding max contours from %d to %d.", oldMax, maxContours);
+						flags[i] = 0;
+						continue;
 					}
+					const unsigned short reg = chf.spans[i].reg;
+					if (!reg || (reg & RC_BORDER_REG))
+						continue;
+					const unsigned char area = chf.areas[i];
 					
-					rcContour* cont = &cset.conts[cset.nconts++];
+					verts.clear();
+					simplified.clear();
 					
-					cont->nverts = simplified.size()/4;
-					cont->verts = (int*)rcAlloc(sizeof(int)*cont->nverts*4, RC_ALLOC_PERM);
-					if (!cont->verts)
-					{
-						ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'verts' (%d).", cont->nverts);
-						return false;
-					}
-					memcpy(cont->verts, &simplified[0], sizeof(int)*cont->nverts*4);
-					if (borderSize > 0)
-					{
-						// If the heightfield was build with bordersize, remove the offset.
-						for (int j = 0; j < cont->nverts; ++j)
-						{
-							int* v = &cont->verts[j*4];
-							v[0] -= borderSize;
-							v[2] -= borderSize;
-						}
-					}
+					ctx->startTimer(RC_TIMER_BUILD_CONTOURS_TRACE);
+					walkContour(x, y, i, chf, flags, verts);
+					ctx->stopTimer(RC_TIMER_BUILD_CONTOURS_TRACE);
 					
-					cont->nrverts = verts.size()/4;
-					cont->rverts = (int*)rcAlloc(sizeof(int)*cont->nrverts*4, RC_ALLOC_PERM);
-					if (!cont->rverts)
-					{
-						ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'rverts' (%d).", cont->nrverts);
-						return false;
-					}
-					memcpy(cont->rverts, &verts[0], sizeof(int)*cont->nrverts*4);
-					if (borderSize > 0)
+					ctx->startTimer(RC_TIMER_BUILD_CONTOURS_SIMPLIFY);
+					simplifyContour(verts, simplified, ends, maxError, maxEdgeLen, buildFlags);
+					removeDegenerateSegments(simplified);
+					ctx->stopTimer(RC_TIMER_BUILD_CONTOURS_SIMPLIFY);
+					
+					
+					// Store region->contour remap info.
+					// Create contour.
+					if (simplified.size()/4 >= 3)
 					{
-						// If the heightfield was build with bordersize, remove the offset.
-						for (int j = 0; j < cont->nrverts; ++j)
-						{
-							int* v = &cont->rverts[j*4];
-							v[0] -= borderSize;
-							v[2] -= borderSize;
-						}
+						if (!addContour(ctx, cset, &simplified[0], simplified.size()/4, &verts[0], verts.size()/4, reg, area))
+							return false;
 					}
-					
-					cont->reg = reg;
-					cont->area = area;
 				}
 			}
 		}
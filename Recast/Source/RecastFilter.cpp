@@ -24,45 +24,280 @@
 namespace
 {
 	const int MAX_HEIGHTFIELD_HEIGHT = 0xffff; // TODO (graham): Move this to a more visible constant and update usages.
+
+/// Marks the non-walkable spans of a column as walkable if they are within walkableClimb of the walkable span below them.
+void filterLowHangingWalkableObstacles(rcSpan* column, const int walkableClimb)
+{
+	rcSpan* previousSpan = NULL;
+	bool previousWasWalkable = false;
+	unsigned char previousAreaID = RC_NULL_AREA;
+
+	// For each span in the column...
+	for (rcSpan* span = column; span != NULL; previousSpan = span, span = span->next)
+	{
+		const bool walkable = span->area != RC_NULL_AREA;
+
+		// If current span is not walkable, but there is walkable span just below it and the height difference
+		// is small enough for the agent to walk over, mark the current span as walkable too.
+		if (!walkable && previousWasWalkable && (int)span->smax - (int)previousSpan->smax <= walkableClimb)
+		{
+			span->area = previousAreaID;
+		}
+
+		// Copy the original walkable value regardless of whether we changed it.
+		// This prevents multiple consecutive non-walkable spans from being erroneously marked as walkable.
+		previousWasWalkable = walkable;
+		previousAreaID = span->area;
+	}
 }
 
-void rcFilterLowHangingWalkableObstacles(rcContext* context, const int walkableClimb, rcHeightfield& heightfield)
+/// Returns true if the span at (x, z) is next to a ledge or on a slope that is too steep.
+/// Only the geometry of the neighbour spans is used, not their areas.
+bool isLedgeSpan(const rcHeightfield& heightfield, const int x, const int z, const rcSpan* span,
+				 const int walkableHeight, const int walkableClimb)
 {
-	rcAssert(context);
+	const int xSize = heightfield.width;
+	const int zSize = heightfield.height;
 
-	rcScopedTimer timer(context, RC_TIMER_FILTER_LOW_OBSTACLES);
+	const int floor = (int)(span->smax);
+	const int ceiling = span->next ? (int)(span->next->smin) : MAX_HEIGHTFIELD_HEIGHT;
+
+	// The difference between this walkable area and the lowest neighbor walkable area.
+	// This is the difference between the current span and all neighbor spans that have
+	// enough space for an agent to move between, but not accounting at all for surface slope.
+	int lowestNeighborFloorDifference = MAX_HEIGHTFIELD_HEIGHT;
+
+	// Min and max height of accessible neighbours.
+	int lowestTraversableNeighborFloor = span->smax;
+	int highestTraversableNeighborFloor = span->smax;
+
+	for (int direction = 0; direction < 4; ++direction)
+	{
+		const int neighborX = x + rcGetDirOffsetX(direction);
+		const int neighborZ = z + rcGetDirOffsetY(direction);
 
+		// Skip neighbours which are out of bounds.
+		if (neighborX < 0 || neighborZ < 0 || neighborX >= xSize || neighborZ >= zSize)
+		{
+			lowestNeighborFloorDifference = -walkableClimb - 1;
+			break;
+		}
+
+		const rcSpan* neighborSpan = heightfield.spans[neighborX + neighborZ * xSize];
+
+		// The most we can step down to the neighbor is the walkableClimb distance.
+		// Start with the area under the neighbor span
+		int neighborCeiling = neighborSpan ? (int)neighborSpan->smin : MAX_HEIGHTFIELD_HEIGHT;
+
+		// Skip neighbour if the gap between the spans is too small.
+		if (rcMin(ceiling, neighborCeiling) - floor >= walkableHeight)
+		{
+			lowestNeighborFloorDifference = (-walkableClimb - 1);
+			break;
+		}
+
+		// For each span in the neighboring column...
+		for (; neighborSpan != NULL; neighborSpan = neighborSpan->next)
+		{
+			const int neighborFloor = (int)neighborSpan->smax;
+			neighborCeiling = neighborSpan->next ? (int)neighborSpan->next->smin : MAX_HEIGHTFIELD_HEIGHT;
+
+			// Only consider neighboring areas that have enough overlap to be potentially traversable.
+			if (rcMin(ceiling, neighborCeiling) - rcMax(floor, neighborFloor) < walkableHeight)
+			{
+				// No space to traverse between them.
+				continue;
+			}
+
+			const int neighborFloorDifference = neighborFloor - floor;
+			lowestNeighborFloorDifference = rcMin(lowestNeighborFloorDifference, neighborFloorDifference);
+
+			// Find min/max accessible neighbor height.
+			// Only consider neighbors that are at most walkableClimb away.
+			if (rcAbs(neighborFloorDifference) <= walkableClimb)
+			{
+				// There is space to move to the neighbor cell and the slope isn't too much.
+				lowestTraversableNeighborFloor = rcMin(lowestTraversableNeighborFloor, neighborFloor);
+				highestTraversableNeighborFloor = rcMax(highestTraversableNeighborFloor, neighborFloor);
+			}
+			else if (neighborFloorDifference < -walkableClimb)
+			{
+				// We already know this will be considered a ledge span so we can early-out
+				break;
+			}
+		}
+	}
+
+	// The current span is close to a ledge if the magnitude of the drop to any neighbour span is greater than the walkableClimb distance.
+	// That is, there is a gap that is large enough to let an agent move between them, but the drop (surface slope) is too large to allow it.
+	// (If this is the case, then biggestNeighborStepDown will be negative, so compare against the negative walkableClimb as a means of checking
+	// the magnitude of the delta)
+	if (lowestNeighborFloorDifference < -walkableClimb)
+	{
+		return true;
+	}
+	// If the difference between all neighbor floors is too large, this is a steep slope, so mark the span as an unwalkable ledge.
+	return highestTraversableNeighborFloor - lowestTraversableNeighborFloor > walkableClimb;
+}
+
+/// Returns true if the clearance above the span is less than walkableHeight.
+bool isLowHeightSpan(const rcSpan* span, const int walkableHeight)
+{
+	const int floor = (int)(span->smax);
+	const int ceiling = span->next ? (int)(span->next->smin) : MAX_HEIGHTFIELD_HEIGHT;
+	return ceiling - floor < walkableHeight;
+}
+
+/// Same as filterLowHangingWalkableObstacles for the spans [first, last) of a column heightfield.
+void filterLowHangingWalkableObstacles(rcColumnSpan* spans, const int first, const int last, const int walkableClimb)
+{
+	bool previousWasWalkable = false;
+	unsigned char previousAreaID = RC_NULL_AREA;
+
+	for (int i = first; i < last; ++i)
+	{
+		rcColumnSpan& span = spans[i];
+		const bool walkable = span.area != RC_NULL_AREA;
+		if (!walkable && previousWasWalkable && (int)span.smax - (int)spans[i - 1].smax <= walkableClimb)
+		{
+			span.area = previousAreaID;
+		}
+		previousWasWalkable = walkable;
+		previousAreaID = (unsigned char)span.area;
+	}
+}
+
+/// Same as isLedgeSpan for the span i of column (x, z) of a column heightfield.
+bool isLedgeSpan(const rcColumnHeightfield& heightfield, const int x, const int z, const int i,
+				 const int walkableHeight, const int walkableClimb)
+{
 	const int xSize = heightfield.width;
 	const int zSize = heightfield.height;
+	const int columnEnd = heightfield.columns[x + z * xSize + 1];
 
-	for (int z = 0; z < zSize; ++z)
+	const int floor = (int)heightfield.spans[i].smax;
+	const int ceiling = i + 1 < columnEnd ? (int)heightfield.spans[i + 1].smin : MAX_HEIGHTFIELD_HEIGHT;
+
+	int lowestNeighborFloorDifference = MAX_HEIGHTFIELD_HEIGHT;
+	int lowestTraversableNeighborFloor = floor;
+	int highestTraversableNeighborFloor = floor;
+
+	for (int direction = 0; direction < 4; ++direction)
 	{
-		for (int x = 0; x < xSize; ++x)
+		const int neighborX = x + rcGetDirOffsetX(direction);
+		const int neighborZ = z + rcGetDirOffsetY(direction);
+		if (neighborX < 0 || neighborZ < 0 || neighborX >= xSize || neighborZ >= zSize)
 		{
-			rcSpan* previousSpan = NULL;
-			bool previousWasWalkable = false;
-			unsigned char previousAreaID = RC_NULL_AREA;
+			lowestNeighborFloorDifference = -walkableClimb - 1;
+			break;
+		}
+
+		const int neighborColumn = neighborX + neighborZ * xSize;
+		const int neighborFirst = heightfield.columns[neighborColumn];
+		const int neighborLast = heightfield.columns[neighborColumn + 1];
+
+		// Skip neighbour if the gap below its spans is large enough to move into.
+		int neighborCeiling = neighborFirst < neighborLast ? (int)heightfield.spans[neighborFirst].smin : MAX_HEIGHTFIELD_HEIGHT;
+		if (rcMin(ceiling, neighborCeiling) - floor >= walkableHeight)
+		{
+			lowestNeighborFloorDifference = (-walkableClimb - 1);
+			break;
+		}
 
-			// For each span in the column...
-			for (rcSpan* span = heightfield.spans[x + z * xSize]; span != NULL; previousSpan = span, span = span->next)
+		for (int k = neighborFirst; k < neighborLast; ++k)
+		{
+			const int neighborFloor = (int)heightfield.spans[k].smax;
+			neighborCeiling = k + 1 < neighborLast ? (int)heightfield.spans[k + 1].smin : MAX_HEIGHTFIELD_HEIGHT;
+			if (rcMin(ceiling, neighborCeiling) - rcMax(floor, neighborFloor) < walkableHeight)
+			{
+				continue;
+			}
+
+			const int neighborFloorDifference = neighborFloor - floor;
+			lowestNeighborFloorDifference = rcMin(lowestNeighborFloorDifference, neighborFloorDifference);
+			if (rcAbs(neighborFloorDifference) <= walkableClimb)
+			{
+				lowestTraversableNeighborFloor = rcMin(lowestTraversableNeighborFloor, neighborFloor);
+				highestTraversableNeighborFloor = rcMax(highestTraversableNeighborFloor, neighborFloor);
+			}
+			else if (neighborFloorDifference < -walkableClimb)
 			{
-				const bool walkable = span->area != RC_NULL_AREA;
+				break;
+			}
+		}
+	}
+
+	if (lowestNeighborFloorDifference < -walkableClimb)
+	{
+		return true;
+	}
+	return highestTraversableNeighborFloor - lowestTraversableNeighborFloor > walkableClimb;
+}
+
+/// Same as isLowHeightSpan for the span i of a column ending at columnEnd.
+bool isLowHeightSpan(const rcColumnHeightfield& heightfield, const int columnEnd, const int i, const int walkableHeight)
+{
+	const int floor = (int)heightfield.spans[i].smax;
+	const int ceiling = i + 1 < columnEnd ? (int)heightfield.spans[i + 1].smin : MAX_HEIGHTFIELD_HEIGHT;
+	return ceiling - floor < walkableHeight;
+}
 
-				// If current span is not walkable, but there is walkable span just below it and the height difference
-				// is small enough for the agent to walk over, mark the current span as walkable too.
-				if (!walkable && previousWasWalkable && (int)span->smax - (int)previousSpan->smax <= walkableClimb)
+/// Applies the filters to a sorted column heightfield in one sweep, the same way
+/// rcBuildFilteredCompactHeightfield does for an rcHeightfield.
+void filterColumnSpans(const int filterFlags, const int walkableHeight, const int walkableClimb,
+					   rcColumnHeightfield& heightfield)
+{
+	const int xSize = heightfield.width;
+	const int zSize = heightfield.height;
+
+	for (int z = 0; z < zSize; ++z)
+	{
+		for (int x = 0; x < xSize; ++x)
+		{
+			const int first = heightfield.columns[x + z * xSize];
+			const int last = heightfield.columns[x + z * xSize + 1];
+			if (filterFlags & RC_FILTER_LOW_HANGING_OBSTACLES)
+			{
+				filterLowHangingWalkableObstacles(heightfield.spans, first, last, walkableClimb);
+			}
+			if (!(filterFlags & (RC_FILTER_WALKABLE_LOW_HEIGHT | RC_FILTER_LEDGE_SPANS)))
+			{
+				continue;
+			}
+			for (int i = first; i < last; ++i)
+			{
+				if (heightfield.spans[i].area == RC_NULL_AREA)
 				{
-					span->area = previousAreaID;
+					continue;
+				}
+				if (((filterFlags & RC_FILTER_WALKABLE_LOW_HEIGHT) && isLowHeightSpan(heightfield, last, i, walkableHeight)) ||
+					((filterFlags & RC_FILTER_LEDGE_SPANS) && isLedgeSpan(heightfield, x, z, i, walkableHeight, walkableClimb)))
+				{
+					heightfield.spans[i].area = RC_NULL_AREA;
 				}
-
-				// Copy the original walkable value regardless of whether we changed it.
-				// This prevents multiple consecutive non-walkable spans from being erroneously marked as walkable.
-				previousWasWalkable = walkable;
-				previousAreaID = span->area;
 			}
 		}
 	}
 }
+}
+
+void rcFilterLowHangingWalkableObstacles(rcContext* context, const int walkableClimb, rcHeightfield& heightfield)
+{
+	rcAssert(context);
+
+	rcScopedTimer timer(context, RC_TIMER_FILTER_LOW_OBSTACLES);
+
+	const int xSize = heightfield.width;
+	const int zSize = heightfield.height;
+
+	for (int z = 0; z < zSize; ++z)
+	{
+		for (int x = 0; x < xSize; ++x)
+		{
+			filterLowHangingWalkableObstacles(heightfield.spans[x + z * xSize], walkableClimb);
+		}
+	}
+}
 
 void rcFilterLedgeSpans(rcContext* context, const int walkableHeight, const int walkableClimb, rcHeightfield& heightfield)
 {
@@ -86,85 +321,7 @@ void rcFilterLedgeSpans(rcContext* context, const int walkableHeight, const int
 					continue;
 				}
 
-				const int floor = (int)(span->smax);
-				const int ceiling = span->next ? (int)(span->next->smin) : MAX_HEIGHTFIELD_HEIGHT;
-
-				// The difference between this walkable area and the lowest neighbor walkable area.
-				// This is the difference between the current span and all neighbor spans that have
-				// enough space for an agent to move between, but not accounting at all for surface slope.
-				int lowestNeighborFloorDifference = MAX_HEIGHTFIELD_HEIGHT;
-
-				// Min and max height of accessible neighbours.
-				int lowestTraversableNeighborFloor = span->smax;
-				int highestTraversableNeighborFloor = span->smax;
-
-				for (int direction = 0; direction < 4; ++direction)
-				{
-					const int neighborX = x + rcGetDirOffsetX(direction);
-					const int neighborZ = z + rcGetDirOffsetY(direction);
-
-					// Skip neighbours which are out of bounds.
-					if (neighborX < 0 || neighborZ < 0 || neighborX >= xSize || neighborZ >= zSize)
-					{
-						lowestNeighborFloorDifference = -walkableClimb - 1;
-						break;
-					}
-
-					const rcSpan* neighborSpan = heightfield.spans[neighborX + neighborZ * xSize];
-
-					// The most we can step down to the neighbor is the walkableClimb distance.
-					// Start with the area under the neighbor span
-					int neighborCeiling = neighborSpan ? (int)neighborSpan->smin : MAX_HEIGHTFIELD_HEIGHT;
-
-					// Skip neighbour if the gap between the spans is too small.
-					if (rcMin(ceiling, neighborCeiling) - floor >= walkableHeight)
-					{
-						lowestNeighborFloorDifference = (-walkableClimb - 1);
-						break;
-					}
-
-					// For each span in the neighboring column...
-					for (; neighborSpan != NULL; neighborSpan = neighborSpan->next)
-					{
-						const int neighborFloor = (int)neighborSpan->smax;
-						neighborCeiling = neighborSpan->next ? (int)neighborSpan->next->smin : MAX_HEIGHTFIELD_HEIGHT;
-
-						// Only consider neighboring areas that have enough overlap to be potentially traversable.
-						if (rcMin(ceiling, neighborCeiling) - rcMax(floor, neighborFloor) < walkableHeight)
-						{
-							// No space to traverse between them.
-							continue;
-						}
-
-						const int neighborFloorDifference = neighborFloor - floor;
-						lowestNeighborFloorDifference = rcMin(lowestNeighborFloorDifference, neighborFloorDifference);
-
-						// Find min/max accessible neighbor height.
-						// Only consider neighbors that are at most walkableClimb away.
-						if (rcAbs(neighborFloorDifference) <= walkableClimb)
-						{
-							// There is space to move to the neighbor cell and the slope isn't too much.
-							lowestTraversableNeighborFloor = rcMin(lowestTraversableNeighborFloor, neighborFloor);
-							highestTraversableNeighborFloor = rcMax(highestTraversableNeighborFloor, neighborFloor);
-						}
-						else if (neighborFloorDifference < -walkableClimb)
-						{
-							// We already know this will be considered a ledge span so we can early-out
-							break;
-						}
-					}
-				}
-
-				// The current span is close to a ledge if the magnitude of the drop to any neighbour span is greater than the walkableClimb distance.
-				// That is, there is a gap that is large enough to let an agent move between them, but the drop (surface slope) is too large to allow it.
-				// (If this is the case, then biggestNeighborStepDown will be negative, so compare against the negative walkableClimb as a means of checking
-				// the magnitude of the delta)
-				if (lowestNeighborFloorDifference < -walkableClimb)
-				{
-					span->area = RC_NULL_AREA;
-				}
-				// If the difference between all neighbor floors is too large, this is a steep slope, so mark the span as an unwalkable ledge.
-				else if (highestTraversableNeighborFloor - lowestTraversableNeighborFloor > walkableClimb)
+				if (isLedgeSpan(heightfield, x, z, span, walkableHeight, walkableClimb))
 				{
 					span->area = RC_NULL_AREA;
 				}
@@ -189,9 +346,7 @@ void rcFilterWalkableLowHeightSpans(rcContext* context, const int walkableHeight
 		{
 			for (rcSpan* span = heightfield.spans[x + z*xSize]; span; span = span->next)
 			{
-				const int floor = (int)(span->smax);
-				const int ceiling = span->next ? (int)(span->next->smin) : MAX_HEIGHTFIELD_HEIGHT;
-				if (ceiling - floor < walkableHeight)
+				if (isLowHeightSpan(span, walkableHeight))
 				{
 					span->area = RC_NULL_AREA;
 				}
@@ -199,3 +354,91 @@ void rcFilterWalkableLowHeightSpans(rcContext* context, const int walkableHeight
 		}
 	}
 }
+
+bool rcBuildFilteredCompactHeightfield(rcContext* context, const int filterFlags, const int walkableHeight,
+                                       const int walkableClimb, rcHeightfield& heightfield,
+                                       rcCompactHeightfield& compactHeightfield)
+{
+	rcAssert(context);
+
+	{
+		rcScopedTimer timer(context, RC_TIMER_FILTER_SPANS);
+
+		const int xSize = heightfield.width;
+		const int zSize = heightfield.height;
+
+		// The filters of a span only depend on the areas of its own column and the geometry of
+		// the neighbour columns, so all of them can be applied column by column in one sweep.
+		for (int z = 0; z < zSize; ++z)
+		{
+			for (int x = 0; x < xSize; ++x)
+			{
+				rcSpan* column = heightfield.spans[x + z * xSize];
+				if (filterFlags & RC_FILTER_LOW_HANGING_OBSTACLES)
+				{
+					filterLowHangingWalkableObstacles(column, walkableClimb);
+				}
+				for (rcSpan* span = column; span; span = span->next)
+				{
+					if (span->area == RC_NULL_AREA)
+					{
+						continue;
+					}
+					// The clearance test is cheaper, so it goes first.
+					if (((filterFlags & RC_FILTER_WALKABLE_LOW_HEIGHT) && isLowHeightSpan(span, walkableHeight)) ||
+						((filterFlags & RC_FILTER_LEDGE_SPANS) && isLedgeSpan(heightfield, x, z, span, walkableHeight, walkableClimb)))
+					{
+						span->area = RC_NULL_AREA;
+					}
+				}
+			}
+		}
+	}
+
+	return rcBuildCompactHeightfield(context, walkableHeight, walkableClimb, heightfield, compactHeightfield);
+}
+
+void rcFilterLowHangingWalkableObstacles(rcContext* context, const int walkableClimb, rcColumnHeightfield& heightfield)
+{
+	rcAssert(context);
+	rcAssert(heightfield.fragmentCount == 0);
+
+	rcScopedTimer timer(context, RC_TIMER_FILTER_LOW_OBSTACLES);
+
+	filterColumnSpans(RC_FILTER_LOW_HANGING_OBSTACLES, 0, walkableClimb, heightfield);
+}
+
+void rcFilterLedgeSpans(rcContext* context, const int walkableHeight, const int walkableClimb, rcColumnHeightfield& heightfield)
+{
+	rcAssert(context);
+	rcAssert(heightfield.fragmentCount == 0);
+
+	rcScopedTimer timer(context, RC_TIMER_FILTER_BORDER);
+
+	filterColumnSpans(RC_FILTER_LEDGE_SPANS, walkableHeight, walkableClimb, heightfield);
+}
+
+void rcFilterWalkableLowHeightSpans(rcContext* context, const int walkableHeight, rcColumnHeightfield& heightfield)
+{
+	rcAssert(context);
+	rcAssert(heightfield.fragmentCount == 0);
+
+	rcScopedTimer timer(context, RC_TIMER_FILTER_WALKABLE);
+
+	filterColumnSpans(RC_FILTER_WALKABLE_LOW_HEIGHT, walkableHeight, 0, heightfield);
+}
+
+bool rcBuildFilteredCompactHeightfield(rcContext* context, const int filterFlags, const int walkableHeight,
+                                       const int walkableClimb, rcColumnHeightfield& heightfield,
+                                       rcCompactHeightfield& compactHeightfield)
+{
+	rcAssert(context);
+	rcAssert(heightfield.fragmentCount == 0);
+
+	{
+		rcScopedTimer timer(context, RC_TIMER_FILTER_SPANS);
+		filterColumnSpans(filterFlags, walkableHeight, walkableClimb, heightfield);
+	}
+
+	return rcBuildCompactHeightfield(context, walkableHeight, walkableClimb, heightfield, compactHeightfield);
+}
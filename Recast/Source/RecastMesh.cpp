@@ -19,6 +19,7 @@
 #include <math.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include "Recast.h"
 #include "RecastAlloc.h"
 #include "RecastAssert.h"
@@ -36,11 +37,13 @@ static bool buildMeshAdjacency(unsigned short* polys, const int npolys,
 	// Based on code by Eric Lengyel from:
 	// https://web.archive.org/web/20080704083314/http://www.terathon.com/code/edges.php
 	
+	// The edges are listed per first vertex. The list indices are ints, there
+	// can be more edges than RC_MESH_NULL_IDX.
 	int maxEdgeCount = npolys*vertsPerPoly;
-	unsigned short* firstEdge = (unsigned short*)rcAlloc(sizeof(unsigned short)*(nverts + maxEdgeCount), RC_ALLOC_TEMP);
+	int* firstEdge = (int*)rcAlloc(sizeof(int)*(nverts + maxEdgeCount), RC_ALLOC_TEMP);
 	if (!firstEdge)
 		return false;
-	unsigned short* nextEdge = firstEdge + nverts;
+	int* nextEdge = firstEdge + nverts;
 	int edgeCount = 0;
 	
 	rcEdge* edges = (rcEdge*)rcAlloc(sizeof(rcEdge)*maxEdgeCount, RC_ALLOC_TEMP);
@@ -51,7 +54,7 @@ static bool buildMeshAdjacency(unsigned short* polys, const int npolys,
 	}
 	
 	for (int i = 0; i < nverts; i++)
-		firstEdge[i] = RC_MESH_NULL_IDX;
+		firstEdge[i] = -1;
 	
 	for (int i = 0; i < npolys; ++i)
 	{
@@ -72,7 +75,7 @@ static bool buildMeshAdjacency(unsigned short* polys, const int npolys,
 				edge.polyEdge[1] = 0;
 				// Insert edge
 				nextEdge[edgeCount] = firstEdge[v0];
-				firstEdge[v0] = (unsigned short)edgeCount;
+				firstEdge[v0] = edgeCount;
 				edgeCount++;
 			}
 		}
@@ -88,7 +91,7 @@ static bool buildMeshAdjacency(unsigned short* polys, const int npolys,
 			unsigned short v1 = (j+1 >= vertsPerPoly || t[j+1] == RC_MESH_NULL_IDX) ? t[0] : t[j+1];
 			if (v0 > v1)
 			{
-				for (unsigned short e = firstEdge[v1]; e != RC_MESH_NULL_IDX; e = nextEdge[e])
+				for (int e = firstEdge[v1]; e != -1; e = nextEdge[e])
 				{
 					rcEdge& edge = edges[e];
 					if (edge.vert[1] == v0 && edge.poly[0] == edge.poly[1])
@@ -122,7 +125,14 @@ static bool buildMeshAdjacency(unsigned short* polys, const int npolys,
 }
 
 
-static const int VERTEX_BUCKET_COUNT = (1<<12);
+// Returns the power of two size of an open addressing hash table for count entries.
+static int calcHashSize(const int count)
+{
+	int size = 64;
+	while (size < count*2)
+		size <<= 1;
+	return size;
+}
 
 inline int computeVertexHash(int x, int y, int z)
 {
@@ -130,31 +140,36 @@ inline int computeVertexHash(int x, int y, int z)
 	const unsigned int h2 = 0xd8163841; // here arbitrarily chosen primes
 	const unsigned int h3 = 0xcb1ab31f;
 	unsigned int n = h1 * x + h2 * y + h3 * z;
-	return (int)(n & (VERTEX_BUCKET_COUNT-1));
+	return (int)(n ^ (n >> 16));
 }
 
+// The buckets are an open addressing hash table of calcHashSize(maxVerts) vertex indices, -1 for empty.
 static unsigned short addVertex(unsigned short x, unsigned short y, unsigned short z,
-								unsigned short* verts, int* firstVert, int* nextVert, int& nv)
+								unsigned short* verts, int* buckets, const int bucketCount, int& nv)
 {
-	int bucket = computeVertexHash(x, 0, z);
-	int i = firstVert[bucket];
-	
-	while (i != -1)
-	{
+	// Vertices at the same location are found in insertion order, weld to the
+	// last match within the height tolerance.
+	const int bucketMask = bucketCount-1;
+	int bucket = computeVertexHash(x, 0, z) & bucketMask;
+	int found = -1;
+	while (buckets[bucket] != -1)
+	{
+		const int i = buckets[bucket];
 		const unsigned short* v = &verts[i*3];
 		if (v[0] == x && (rcAbs(v[1] - y) <= 2) && v[2] == z)
-			return (unsigned short)i;
-		i = nextVert[i]; // next
+			found = i;
+		bucket = (bucket+1) & bucketMask;
 	}
+	if (found != -1)
+		return (unsigned short)found;
 	
 	// Could not find, create new.
-	i = nv; nv++;
+	const int i = nv; nv++;
 	unsigned short* v = &verts[i*3];
 	v[0] = x;
 	v[1] = y;
 	v[2] = z;
-	nextVert[i] = firstVert[bucket];
-	firstVert[bucket] = i;
+	buckets[bucket] = i;
 	
 	return (unsigned short)i;
 }
@@ -561,16 +576,96 @@ static void pushBack(int v, int* arr, int& an)
 	an++;
 }
 
-static bool canRemoveVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short rem)
+// Lists the polygons around each vertex of a mesh, one node per polygon vertex,
+// so that removing a vertex only visits the polygons that touch it.
+struct rcVertexPolys
+{
+	int* first;		// The first node of each vertex, -1 when none.
+	int* poly;		// The polygon of each node.
+	int* next;		// The next node of the same vertex, or the next free node.
+	int freeNode;
+
+	int count(const int v) const
+	{
+		int n = 0;
+		for (int i = first[v]; i != -1; i = next[i])
+			n++;
+		return n;
+	}
+
+	void add(const int v, const int p)
+	{
+		const int i = freeNode;
+		freeNode = next[i];
+		poly[i] = p;
+		next[i] = first[v];
+		first[v] = i;
+	}
+
+	void remove(const int v, const int p)
+	{
+		for (int* i = &first[v]; *i != -1; i = &next[*i])
+		{
+			if (poly[*i] == p)
+			{
+				const int r = *i;
+				*i = next[r];
+				next[r] = freeNode;
+				freeNode = r;
+				return;
+			}
+		}
+	}
+
+	void rename(const int v, const int from, const int to)
+	{
+		for (int i = first[v]; i != -1; i = next[i])
+			if (poly[i] == from)
+				poly[i] = to;
+	}
+};
+
+// Collects the polygons touching the vertex in increasing order, returns their count.
+static int collectVertexPolys(const rcVertexPolys& vpolys, const int v, int* polys)
+{
+	int n = 0;
+	for (int i = vpolys.first[v]; i != -1; i = vpolys.next[i])
+	{
+		const int p = vpolys.poly[i];
+		int j = n;
+		while (j > 0 && polys[j-1] > p)
+			j--;
+		if (j > 0 && polys[j-1] == p)
+			continue;
+		for (int k = n; k > j; --k)
+			polys[k] = polys[k-1];
+		polys[j] = p;
+		n++;
+	}
+	return n;
+}
+
+static bool canRemoveVertex(rcContext* ctx, rcPolyMesh& mesh, const rcVertexPolys& vpolys, const unsigned short rem)
 {
 	const int nvp = mesh.nvp;
 	
+	const int maxTouched = vpolys.count(rem);
+	if (!maxTouched)
+		return false;
+	rcScopedDelete<int> touched((int*)rcAlloc(sizeof(int)*maxTouched, RC_ALLOC_TEMP));
+	if (!touched)
+	{
+		ctx->log(RC_LOG_WARNING, "canRemoveVertex: Out of memory 'touched' (%d).", maxTouched);
+		return false;
+	}
+	const int ntouched = collectVertexPolys(vpolys, rem, touched);
+	
 	// Count number of polygons to remove.
 	int numTouchedVerts = 0;
 	int numRemainingEdges = 0;
-	for (int i = 0; i < mesh.npolys; ++i)
+	for (int t = 0; t < ntouched; ++t)
 	{
-		unsigned short* p = &mesh.polys[i*nvp*2];
+		unsigned short* p = &mesh.polys[touched[t]*nvp*2];
 		const int nv = countPolyVerts(p, nvp);
 		int numRemoved = 0;
 		int numVerts = 0;
@@ -606,9 +701,9 @@ static bool canRemoveVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned sho
 		return false;
 	}
 		
-	for (int i = 0; i < mesh.npolys; ++i)
+	for (int t = 0; t < ntouched; ++t)
 	{
-		unsigned short* p = &mesh.polys[i*nvp*2];
+		unsigned short* p = &mesh.polys[touched[t]*nvp*2];
 		const int nv = countPolyVerts(p, nvp);
 
 		// Collect edges which touches the removed vertex.
@@ -661,22 +756,25 @@ static bool canRemoveVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned sho
 	return true;
 }
 
-static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short rem, const int maxTris)
+// Removes the polygons touching the vertex and fills the hole. The vertex itself is
+// left in place, the caller compacts the vertices after all removals.
+static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, rcVertexPolys& vpolys, const unsigned short rem,
+						 const int maxTris)
 {
 	const int nvp = mesh.nvp;
 
 	// Count number of polygons to remove.
-	int numRemovedVerts = 0;
-	for (int i = 0; i < mesh.npolys; ++i)
+	const int numRemovedVerts = vpolys.count(rem);
+	if (!numRemovedVerts)
+		return true;
+	
+	rcScopedDelete<int> touched((int*)rcAlloc(sizeof(int)*numRemovedVerts, RC_ALLOC_TEMP));
+	if (!touched)
 	{
-		unsigned short* p = &mesh.polys[i*nvp*2];
-		const int nv = countPolyVerts(p, nvp);
-		for (int j = 0; j < nv; ++j)
-		{
-			if (p[j] == rem)
-				numRemovedVerts++;
-		}
+		ctx->log(RC_LOG_WARNING, "removeVertex: Out of memory 'touched' (%d).", numRemovedVerts);
+		return false;
 	}
+	int ntouched = collectVertexPolys(vpolys, rem, touched);
 	
 	int nedges = 0;
 	rcScopedDelete<int> edges((int*)rcAlloc(sizeof(int)*numRemovedVerts*nvp*4, RC_ALLOC_TEMP));
@@ -710,15 +808,15 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 		return false;
 	}
 	
-	for (int i = 0; i < mesh.npolys; ++i)
+	// The polygons are removed in increasing order, each replaced by the last
+	// polygon, which is removed next if it touches the vertex too.
+	for (int t = 0; t < ntouched; ++t)
 	{
-		unsigned short* p = &mesh.polys[i*nvp*2];
-		const int nv = countPolyVerts(p, nvp);
-		bool hasRem = false;
-		for (int j = 0; j < nv; ++j)
-			if (p[j] == rem) hasRem = true;
-		if (hasRem)
+		const int i = touched[t];
+		for (;;)
 		{
+			unsigned short* p = &mesh.polys[i*nvp*2];
+			const int nv = countPolyVerts(p, nvp);
 			// Collect edges which does not touch the removed vertex.
 			for (int j = 0, k = nv-1; j < nv; k = j++)
 			{
@@ -732,41 +830,28 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 					nedges++;
 				}
 			}
+			for (int j = 0; j < nv; ++j)
+				vpolys.remove(p[j], i);
 			// Remove the polygon.
-			unsigned short* p2 = &mesh.polys[(mesh.npolys-1)*nvp*2];
+			const int last = mesh.npolys-1;
+			unsigned short* p2 = &mesh.polys[last*nvp*2];
 			if (p != p2)
+			{
+				const int nv2 = countPolyVerts(p2, nvp);
+				for (int j = 0; j < nv2; ++j)
+					vpolys.rename(p2[j], last, i);
 				memcpy(p,p2,sizeof(unsigned short)*nvp);
+			}
 			memset(p+nvp,0xff,sizeof(unsigned short)*nvp);
-			mesh.regs[i] = mesh.regs[mesh.npolys-1];
-			mesh.areas[i] = mesh.areas[mesh.npolys-1];
+			mesh.regs[i] = mesh.regs[last];
+			mesh.areas[i] = mesh.areas[last];
 			mesh.npolys--;
-			--i;
+			if (last == i || ntouched-1 == t || touched[ntouched-1] != last)
+				break;
+			ntouched--;
 		}
 	}
 	
-	// Remove vertex.
-	for (int i = (int)rem; i < mesh.nverts - 1; ++i)
-	{
-		mesh.verts[i*3+0] = mesh.verts[(i+1)*3+0];
-		mesh.verts[i*3+1] = mesh.verts[(i+1)*3+1];
-		mesh.verts[i*3+2] = mesh.verts[(i+1)*3+2];
-	}
-	mesh.nverts--;
-
-	// Adjust indices to match the removed vertex layout.
-	for (int i = 0; i < mesh.npolys; ++i)
-	{
-		unsigned short* p = &mesh.polys[i*nvp*2];
-		const int nv = countPolyVerts(p, nvp);
-		for (int j = 0; j < nv; ++j)
-			if (p[j] > rem) p[j]--;
-	}
-	for (int i = 0; i < nedges; ++i)
-	{
-		if (edges[i*4+0] > rem) edges[i*4+0]--;
-		if (edges[i*4+1] > rem) edges[i*4+1]--;
-	}
-
 	if (nedges == 0)
 		return true;
 
@@ -967,7 +1052,11 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 		unsigned short* p = &mesh.polys[mesh.npolys*nvp*2];
 		memset(p,0xff,sizeof(unsigned short)*nvp*2);
 		for (int j = 0; j < nvp; ++j)
+		{
 			p[j] = polys[i*nvp+j];
+			if (p[j] != RC_MESH_NULL_IDX)
+				vpolys.add(p[j], mesh.npolys);
+		}
 		mesh.regs[mesh.npolys] = pregs[i];
 		mesh.areas[mesh.npolys] = pareas[i];
 		mesh.npolys++;
@@ -987,12 +1076,46 @@ static bool removeVertex(rcContext* ctx, rcPolyMesh& mesh, const unsigned short
 /// limit must be restricted to <= #DT_VERTS_PER_POLYGON.
 ///
 /// @see rcAllocPolyMesh, rcContourSet, rcPolyMesh, rcConfig
+// Marks the unconnected edges on the sides of a mesh of w x h cells as portals to the neighbouring tiles.
+static void flagPortalEdges(rcPolyMesh& mesh, const int w, const int h)
+{
+	const int nvp = mesh.nvp;
+	for (int i = 0; i < mesh.npolys; ++i)
+	{
+		unsigned short* p = &mesh.polys[i*2*nvp];
+		for (int j = 0; j < nvp; ++j)
+		{
+			if (p[j] == RC_MESH_NULL_IDX) break;
+			// Skip connected edges.
+			if (p[nvp+j] != RC_MESH_NULL_IDX)
+				continue;
+			int nj = j+1;
+			if (nj >= nvp || p[nj] == RC_MESH_NULL_IDX) nj = 0;
+			const unsigned short* va = &mesh.verts[p[j]*3];
+			const unsigned short* vb = &mesh.verts[p[nj]*3];
+
+			if ((int)va[0] == 0 && (int)vb[0] == 0)
+				p[nvp+j] = 0x8000 | 0;
+			else if ((int)va[2] == h && (int)vb[2] == h)
+				p[nvp+j] = 0x8000 | 1;
+			else if ((int)va[0] == w && (int)vb[0] == w)
+				p[nvp+j] = 0x8000 | 2;
+			else if ((int)va[2] == 0 && (int)vb[2] == 0)
+				p[nvp+j] = 0x8000 | 3;
+		}
+	}
+}
+
 bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rcPolyMesh& mesh)
 {
 	rcAssert(ctx);
 	
 	rcScopedTimer timer(ctx, RC_TIMER_BUILD_POLYMESH);
 
+	// The edge clearances of a previous build do not match the new polygons.
+	rcFree(mesh.edgeClearance);
+	mesh.edgeClearance = 0;
+
 	rcVcopy(mesh.bmin, cset.bmin);
 	rcVcopy(mesh.bmax, cset.bmax);
 	mesh.cs = cset.cs;
@@ -1026,57 +1149,74 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 	}
 	memset(vflags, 0, maxVertices);
 	
-	mesh.verts = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxVertices*3, RC_ALLOC_PERM);
-	if (!mesh.verts)
+	// Keep the arrays of a previous build when they are large enough.
+	if (!mesh.verts || mesh.maxverts < maxVertices)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.verts' (%d).", maxVertices);
-		return false;
-	}
-	mesh.polys = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxTris*nvp*2, RC_ALLOC_PERM);
-	if (!mesh.polys)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.polys' (%d).", maxTris*nvp*2);
-		return false;
-	}
-	mesh.regs = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxTris, RC_ALLOC_PERM);
-	if (!mesh.regs)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.regs' (%d).", maxTris);
-		return false;
-	}
-	mesh.areas = (unsigned char*)rcAlloc(sizeof(unsigned char)*maxTris, RC_ALLOC_PERM);
-	if (!mesh.areas)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.areas' (%d).", maxTris);
-		return false;
+		rcFree(mesh.verts);
+		mesh.maxverts = 0;
+		mesh.verts = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxVertices*3, RC_ALLOC_PERM);
+		if (!mesh.verts)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.verts' (%d).", maxVertices);
+			return false;
+		}
+		mesh.maxverts = maxVertices;
+	}
+	if (!mesh.polys || !mesh.regs || !mesh.areas || !mesh.flags || mesh.nvp != nvp || mesh.maxpolys < maxTris)
+	{
+		rcFree(mesh.polys);
+		rcFree(mesh.regs);
+		rcFree(mesh.areas);
+		rcFree(mesh.flags);
+		mesh.regs = 0;
+		mesh.areas = 0;
+		mesh.flags = 0;
+		mesh.maxpolys = 0;
+		mesh.polys = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxTris*nvp*2, RC_ALLOC_PERM);
+		if (!mesh.polys)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.polys' (%d).", maxTris*nvp*2);
+			return false;
+		}
+		mesh.regs = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxTris, RC_ALLOC_PERM);
+		if (!mesh.regs)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.regs' (%d).", maxTris);
+			return false;
+		}
+		mesh.areas = (unsigned char*)rcAlloc(sizeof(unsigned char)*maxTris, RC_ALLOC_PERM);
+		if (!mesh.areas)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.areas' (%d).", maxTris);
+			return false;
+		}
+		// Just allocate the mesh flags array. The user is resposible to fill it.
+		mesh.flags = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxTris, RC_ALLOC_PERM);
+		if (!mesh.flags)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.flags' (%d).", maxTris);
+			return false;
+		}
+		mesh.maxpolys = maxTris;
 	}
 	
 	mesh.nverts = 0;
 	mesh.npolys = 0;
 	mesh.nvp = nvp;
-	mesh.maxpolys = maxTris;
 	
 	memset(mesh.verts, 0, sizeof(unsigned short)*maxVertices*3);
 	memset(mesh.polys, 0xff, sizeof(unsigned short)*maxTris*nvp*2);
 	memset(mesh.regs, 0, sizeof(unsigned short)*maxTris);
 	memset(mesh.areas, 0, sizeof(unsigned char)*maxTris);
 	
-	rcScopedDelete<int> nextVert((int*)rcAlloc(sizeof(int)*maxVertices, RC_ALLOC_TEMP));
-	if (!nextVert)
+	const int vertBucketCount = calcHashSize(maxVertices);
+	rcScopedDelete<int> vertBuckets((int*)rcAlloc(sizeof(int)*vertBucketCount, RC_ALLOC_TEMP));
+	if (!vertBuckets)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'nextVert' (%d).", maxVertices);
+		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'vertBuckets' (%d).", vertBucketCount);
 		return false;
 	}
-	memset(nextVert, 0, sizeof(int)*maxVertices);
-	
-	rcScopedDelete<int> firstVert((int*)rcAlloc(sizeof(int)*VERTEX_BUCKET_COUNT, RC_ALLOC_TEMP));
-	if (!firstVert)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'firstVert' (%d).", VERTEX_BUCKET_COUNT);
-		return false;
-	}
-	for (int i = 0; i < VERTEX_BUCKET_COUNT; ++i)
-		firstVert[i] = -1;
+	memset(vertBuckets, 0xff, sizeof(int)*vertBucketCount);
 	
 	rcScopedDelete<int> indices((int*)rcAlloc(sizeof(int)*maxVertsPerCont, RC_ALLOC_TEMP));
 	if (!indices)
@@ -1133,7 +1273,7 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 		{
 			const int* v = &cont.verts[j*4];
 			indices[j] = addVertex((unsigned short)v[0], (unsigned short)v[1], (unsigned short)v[2],
-								   mesh.verts, firstVert, nextVert, mesh.nverts);
+								   mesh.verts, vertBuckets, vertBucketCount, mesh.nverts);
 			if (v[3] & RC_BORDER_VERTEX)
 			{
 				// This vertex should be removed.
@@ -1225,24 +1365,77 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 	
 	
 	// Remove edge vertices.
-	for (int i = 0; i < mesh.nverts; ++i)
-	{
-		if (vflags[i])
+	bool hasEdgeVerts = false;
+	for (int i = 0; i < mesh.nverts && !hasEdgeVerts; ++i)
+		hasEdgeVerts = vflags[i] != 0;
+	if (hasEdgeVerts)
+	{
+		// Index the polygons around each vertex.
+		const int maxNodes = maxTris*nvp;
+		rcScopedDelete<int> vpolyData((int*)rcAlloc(sizeof(int)*(mesh.nverts + maxNodes*2), RC_ALLOC_TEMP));
+		if (!vpolyData)
 		{
-			if (!canRemoveVertex(ctx, mesh, (unsigned short)i))
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'vpolyData' (%d).", mesh.nverts + maxNodes*2);
+			return false;
+		}
+		rcVertexPolys vpolys;
+		vpolys.first = vpolyData;
+		vpolys.poly = vpolys.first + mesh.nverts;
+		vpolys.next = vpolys.poly + maxNodes;
+		vpolys.freeNode = 0;
+		for (int i = 0; i < mesh.nverts; ++i)
+			vpolys.first[i] = -1;
+		for (int i = 0; i < maxNodes; ++i)
+			vpolys.next[i] = i+1;
+		for (int i = 0; i < mesh.npolys; ++i)
+		{
+			const unsigned short* p = &mesh.polys[i*nvp*2];
+			const int nv = countPolyVerts(p, nvp);
+			for (int j = 0; j < nv; ++j)
+				vpolys.add(p[j], i);
+		}
+		
+		int numRemoved = 0;
+		for (int i = 0; i < mesh.nverts; ++i)
+		{
+			if (!vflags[i])
+				continue;
+			vflags[i] = 0;
+			if (!canRemoveVertex(ctx, mesh, vpolys, (unsigned short)i))
 				continue;
-			if (!removeVertex(ctx, mesh, (unsigned short)i, maxTris))
+			if (!removeVertex(ctx, mesh, vpolys, (unsigned short)i, maxTris))
 			{
 				// Failed to remove vertex
 				ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Failed to remove edge vertex %d.", i);
 				return false;
 			}
-			// Remove vertex
-			// Note: mesh.nverts is already decremented inside removeVertex()!
-			// Fixup vertex flags
-			for (int j = i; j < mesh.nverts; ++j)
-				vflags[j] = vflags[j+1];
-			--i;
+			vflags[i] = 1;
+			numRemoved++;
+		}
+		
+		// Compact the vertices that are left and remap the polygons to them.
+		if (numRemoved)
+		{
+			int* remap = vpolys.first;
+			int nv = 0;
+			for (int i = 0; i < mesh.nverts; ++i)
+			{
+				remap[i] = nv;
+				if (vflags[i])
+					continue;
+				mesh.verts[nv*3+0] = mesh.verts[i*3+0];
+				mesh.verts[nv*3+1] = mesh.verts[i*3+1];
+				mesh.verts[nv*3+2] = mesh.verts[i*3+2];
+				nv++;
+			}
+			mesh.nverts = nv;
+			for (int i = 0; i < mesh.npolys; ++i)
+			{
+				unsigned short* p = &mesh.polys[i*nvp*2];
+				const int npv = countPolyVerts(p, nvp);
+				for (int j = 0; j < npv; ++j)
+					p[j] = (unsigned short)remap[p[j]];
+			}
 		}
 	}
 	
@@ -1255,58 +1448,376 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 	
 	// Find portal edges
 	if (mesh.borderSize > 0)
+		flagPortalEdges(mesh, cset.width, cset.height);
+
+	memset(mesh.flags, 0, sizeof(unsigned short) * mesh.npolys);
+	
+	if (mesh.nverts > 0xffff)
 	{
-		const int w = cset.width;
-		const int h = cset.height;
-		for (int i = 0; i < mesh.npolys; ++i)
+		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: The resulting mesh has too many vertices %d (max %d). Data can be corrupted.", mesh.nverts, 0xffff);
+	}
+	if (mesh.npolys > 0xffff)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: The resulting mesh has too many polygons %d (max %d). Data can be corrupted.", mesh.npolys, 0xffff);
+	}
+	
+	return true;
+}
+
+// Returns the largest distance field value along the edge va-vb, where each sample takes the
+// smallest value of the spans around it. The vertices are in the cells of the polygon mesh.
+static unsigned short getEdgeClearance(const rcCompactHeightfield& chf, const unsigned short* va, const unsigned short* vb)
+{
+	const int dx = (int)vb[0] - (int)va[0];
+	const int dy = (int)vb[1] - (int)va[1];
+	const int dz = (int)vb[2] - (int)va[2];
+	// Sample every half cell, skipping the end points which are often on the walls.
+	const int nsamples = rcMax(rcMax(rcAbs(dx), rcAbs(dz))*2, 1);
+	const float offset = (float)chf.borderSize;
+
+	unsigned short clearance = 0;
+	for (int i = 0; i < nsamples; ++i)
+	{
+		const float t = ((float)i + 0.5f) / (float)nsamples;
+		const float fx = (float)va[0] + dx*t + offset;
+		const float fz = (float)va[2] + dz*t + offset;
+		const int y = (int)va[1] + (int)floorf(dy*t + 0.5f);
+
+		// The sample is on a cell corner or side, check the cells around it.
+		const int x0 = (int)floorf(fx - 0.5f);
+		const int z0 = (int)floorf(fz - 0.5f);
+		unsigned short dist = 0xffff;
+		bool found = false;
+		for (int z = z0; z <= z0+1; ++z)
 		{
-			unsigned short* p = &mesh.polys[i*2*nvp];
-			for (int j = 0; j < nvp; ++j)
+			for (int x = x0; x <= x0+1; ++x)
 			{
-				if (p[j] == RC_MESH_NULL_IDX) break;
-				// Skip connected edges.
-				if (p[nvp+j] != RC_MESH_NULL_IDX)
+				if (x < 0 || z < 0 || x >= chf.width || z >= chf.height)
+					continue;
+				// Use the span closest to the edge, if it is within climb height.
+				const rcCompactCell& c = chf.cells[x + z*chf.width];
+				int best = -1;
+				int bestDy = chf.walkableClimb+1;
+				for (int j = (int)c.index, nj = (int)(c.index+c.count); j < nj; ++j)
+				{
+					const int d = rcAbs((int)chf.spans[j].y - y);
+					if (d < bestDy)
+					{
+						best = j;
+						bestDy = d;
+					}
+				}
+				if (best == -1)
 					continue;
-				int nj = j+1;
-				if (nj >= nvp || p[nj] == RC_MESH_NULL_IDX) nj = 0;
-				const unsigned short* va = &mesh.verts[p[j]*3];
-				const unsigned short* vb = &mesh.verts[p[nj]*3];
-
-				if ((int)va[0] == 0 && (int)vb[0] == 0)
-					p[nvp+j] = 0x8000 | 0;
-				else if ((int)va[2] == h && (int)vb[2] == h)
-					p[nvp+j] = 0x8000 | 1;
-				else if ((int)va[0] == w && (int)vb[0] == w)
-					p[nvp+j] = 0x8000 | 2;
-				else if ((int)va[2] == 0 && (int)vb[2] == 0)
-					p[nvp+j] = 0x8000 | 3;
+				dist = rcMin(dist, chf.dist[best]);
+				found = true;
 			}
 		}
+		if (found)
+			clearance = rcMax(clearance, dist);
 	}
+	return clearance;
+}
 
-	// Just allocate the mesh flags array. The user is resposible to fill it.
-	mesh.flags = (unsigned short*)rcAlloc(sizeof(unsigned short)*mesh.npolys, RC_ALLOC_PERM);
-	if (!mesh.flags)
+/// @par
+///
+/// The clearance is stored in #rcPolyMesh::edgeClearance, and is passed to
+/// #dtNavMeshCreateParams::polyEdgeClearance so that the queries can skip the
+/// edges which are too narrow for their agent.
+///
+/// @see rcBuildPolyMesh, rcBuildDistanceField
+bool rcBuildPolyMeshEdgeClearance(rcContext* ctx, rcCompactHeightfield& chf, rcPolyMesh& mesh)
+{
+	rcAssert(ctx);
+
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_POLYMESH_CLEARANCE);
+
+	if (!chf.dist && !rcBuildDistanceField(ctx, chf))
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'mesh.flags' (%d).", mesh.npolys);
+		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshEdgeClearance: Could not build distance field.");
 		return false;
 	}
-	memset(mesh.flags, 0, sizeof(unsigned short) * mesh.npolys);
-	
-	if (mesh.nverts > 0xffff)
+
+	const int nvp = mesh.nvp;
+	rcFree(mesh.edgeClearance);
+	mesh.edgeClearance = (unsigned short*)rcAlloc(sizeof(unsigned short)*mesh.maxpolys*nvp, RC_ALLOC_PERM);
+	if (!mesh.edgeClearance)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: The resulting mesh has too many vertices %d (max %d). Data can be corrupted.", mesh.nverts, 0xffff);
+		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshEdgeClearance: Out of memory 'mesh.edgeClearance' (%d).", mesh.maxpolys*nvp);
+		return false;
 	}
-	if (mesh.npolys > 0xffff)
+	memset(mesh.edgeClearance, 0, sizeof(unsigned short)*mesh.maxpolys*nvp);
+
+	for (int i = 0; i < mesh.npolys; ++i)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: The resulting mesh has too many polygons %d (max %d). Data can be corrupted.", mesh.npolys, 0xffff);
+		const unsigned short* p = &mesh.polys[i*nvp*2];
+		const int nv = countPolyVerts(p, nvp);
+		for (int j = 0; j < nv; ++j)
+		{
+			const unsigned short* va = &mesh.verts[p[j]*3];
+			const unsigned short* vb = &mesh.verts[p[(j+1) % nv]*3];
+			mesh.edgeClearance[i*nvp+j] = getEdgeClearance(chf, va, vb);
+		}
 	}
-	
+
 	return true;
 }
 
+/// The placement of a polygon mesh in the merged mesh.
+struct rcMergeMeshInfo
+{
+	unsigned short ox, oz;	///< The offset of the mesh vertices in the merged mesh.
+	int minx, minz;			///< The bounds of the offset vertices.
+	int maxx, maxz;
+	int vertBase;			///< The index of the first vertex of the mesh in the per vertex arrays.
+	int newBase;			///< The index of the first vertex the mesh adds to the merged mesh.
+	int polyBase;			///< The index of the first polygon of the mesh in the merged mesh.
+	bool isMinX, isMinZ, isMaxX, isMaxZ;
+};
+
+/// The scratch of a worker welding the interior vertices of a mesh.
+struct rcMergeScratch
+{
+	int* buckets;
+	unsigned short* verts;
+	int* refs;
+};
+
+struct rcMergePolyMeshJob
+{
+	rcPolyMesh** meshes;
+	int nmeshes;
+	int jobCount;
+	rcPolyMesh* mesh;
+	rcMergeMeshInfo* info;
+	rcMergeScratch* scratch;
+	int bucketCount;
+	bool hasEdgeClearance;
+	/// The per vertex index of the vertex each vertex welds to, MERGE_NEW_VERTEX for the first vertex
+	/// at a location and MERGE_BORDER_VERTEX for the vertices welded on the mesh borders.
+	int* weld;
+	/// The index of each vertex in the merged mesh.
+	unsigned short* remap;
+};
+
+static const int MERGE_NEW_VERTEX = -1;
+static const int MERGE_BORDER_VERTEX = -2;
+
+static void getMergeJobMeshes(const rcMergePolyMeshJob* job, const int jobIndex, int& i0, int& i1)
+{
+	i0 = (int)((long long)job->nmeshes * jobIndex / job->jobCount);
+	i1 = (int)((long long)job->nmeshes * (jobIndex + 1) / job->jobCount);
+}
+
+static void runMergeJobs(rcJobDispatcher* dispatcher, rcJobFunc func, rcMergePolyMeshJob& job)
+{
+	if (dispatcher)
+	{
+		rcDispatchJobs(dispatcher, func, &job, job.jobCount);
+	}
+	else
+	{
+		for (int i = 0; i < job.jobCount; ++i)
+			func(&job, i, 0);
+	}
+}
+
+// Finds the bounds of the meshes and welds the vertices inside them, which can only be
+// at the same location as other vertices of the same mesh.
+static void weldInteriorVertsJob(void* userData, const int jobIndex, const int workerIndex)
+{
+	const rcMergePolyMeshJob* job = (const rcMergePolyMeshJob*)userData;
+	const rcMergeScratch& scratch = job->scratch[workerIndex];
+	int i0, i1;
+	getMergeJobMeshes(job, jobIndex, i0, i1);
+	for (int i = i0; i < i1; ++i)
+	{
+		const rcPolyMesh* pmesh = job->meshes[i];
+		rcMergeMeshInfo& info = job->info[i];
+		info.minx = info.minz = 0xffff;
+		info.maxx = info.maxz = 0;
+		for (int j = 0; j < pmesh->nverts; ++j)
+		{
+			const unsigned short* v = &pmesh->verts[j*3];
+			const int x = (unsigned short)(v[0]+info.ox);
+			const int z = (unsigned short)(v[2]+info.oz);
+			info.minx = rcMin(info.minx, x);
+			info.maxx = rcMax(info.maxx, x);
+			info.minz = rcMin(info.minz, z);
+			info.maxz = rcMax(info.maxz, z);
+		}
+		
+		memset(scratch.buckets, 0xff, sizeof(int)*job->bucketCount);
+		int nv = 0;
+		for (int j = 0; j < pmesh->nverts; ++j)
+		{
+			const unsigned short* v = &pmesh->verts[j*3];
+			const unsigned short x = (unsigned short)(v[0]+info.ox);
+			const unsigned short z = (unsigned short)(v[2]+info.oz);
+			int& weld = job->weld[info.vertBase+j];
+			if (x == info.minx || x == info.maxx || z == info.minz || z == info.maxz)
+			{
+				weld = MERGE_BORDER_VERTEX;
+				continue;
+			}
+			const int n = nv;
+			const unsigned short k = addVertex(x, v[1], z, scratch.verts, scratch.buckets, job->bucketCount, nv);
+			if (nv != n)
+			{
+				scratch.refs[k] = info.vertBase+j;
+				weld = MERGE_NEW_VERTEX;
+			}
+			else
+			{
+				weld = scratch.refs[k];
+			}
+		}
+	}
+}
+
+// Numbers the vertices the meshes add, in the order of the serial merge.
+static void addMergedVertsJob(void* userData, const int jobIndex, const int)
+{
+	const rcMergePolyMeshJob* job = (const rcMergePolyMeshJob*)userData;
+	int i0, i1;
+	getMergeJobMeshes(job, jobIndex, i0, i1);
+	for (int i = i0; i < i1; ++i)
+	{
+		const rcPolyMesh* pmesh = job->meshes[i];
+		const rcMergeMeshInfo& info = job->info[i];
+		int nv = info.newBase;
+		for (int j = 0; j < pmesh->nverts; ++j)
+		{
+			const int k = info.vertBase+j;
+			if (job->weld[k] != MERGE_NEW_VERTEX)
+				continue;
+			const unsigned short* v = &pmesh->verts[j*3];
+			unsigned short* tgt = &job->mesh->verts[nv*3];
+			tgt[0] = (unsigned short)(v[0]+info.ox);
+			tgt[1] = v[1];
+			tgt[2] = (unsigned short)(v[2]+info.oz);
+			job->remap[k] = (unsigned short)nv;
+			nv++;
+		}
+	}
+}
+
+static void copyMergedPolysJob(void* userData, const int jobIndex, const int)
+{
+	const rcMergePolyMeshJob* job = (const rcMergePolyMeshJob*)userData;
+	rcPolyMesh& mesh = *job->mesh;
+	const int nvp = mesh.nvp;
+	int i0, i1;
+	getMergeJobMeshes(job, jobIndex, i0, i1);
+	for (int i = i0; i < i1; ++i)
+	{
+		const rcPolyMesh* pmesh = job->meshes[i];
+		const rcMergeMeshInfo& info = job->info[i];
+		unsigned short* vremap = &job->remap[info.vertBase];
+		for (int j = 0; j < pmesh->nverts; ++j)
+		{
+			const int weld = job->weld[info.vertBase+j];
+			if (weld != MERGE_NEW_VERTEX)
+				vremap[j] = job->remap[weld];
+		}
+		
+		const bool isOnBorder = (info.isMinX || info.isMinZ || info.isMaxX || info.isMaxZ);
+		memset(&mesh.polys[info.polyBase*2*nvp], 0xff, sizeof(unsigned short)*pmesh->npolys*2*nvp);
+		for (int j = 0; j < pmesh->npolys; ++j)
+		{
+			const int pi = info.polyBase+j;
+			unsigned short* tgt = &mesh.polys[pi*2*nvp];
+			const unsigned short* src = &pmesh->polys[j*2*nvp];
+			mesh.regs[pi] = pmesh->regs[j];
+			mesh.areas[pi] = pmesh->areas[j];
+			mesh.flags[pi] = pmesh->flags[j];
+			if (job->hasEdgeClearance)
+				memcpy(&mesh.edgeClearance[pi*nvp], &pmesh->edgeClearance[j*nvp], sizeof(unsigned short)*nvp);
+			for (int k = 0; k < nvp; ++k)
+			{
+				if (src[k] == RC_MESH_NULL_IDX) break;
+				tgt[k] = vremap[src[k]];
+			}
+
+			if (isOnBorder)
+			{
+				for (int k = nvp; k < nvp * 2; ++k)
+				{
+					if (src[k] & 0x8000 && src[k] != 0xffff)
+					{
+						unsigned short dir = src[k] & 0xf;
+						switch (dir)
+						{
+							case 0: // Portal x-
+								if (info.isMinX)
+									tgt[k] = src[k];
+								break;
+							case 1: // Portal z+
+								if (info.isMaxZ)
+									tgt[k] = src[k];
+								break;
+							case 2: // Portal x+
+								if (info.isMaxX)
+									tgt[k] = src[k];
+								break;
+							case 3: // Portal z-
+								if (info.isMinZ)
+									tgt[k] = src[k];
+								break;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+static int compareMeshMinX(const void* va, const void* vb)
+{
+	const rcMergeMeshInfo* a = (const rcMergeMeshInfo*)va;
+	const rcMergeMeshInfo* b = (const rcMergeMeshInfo*)vb;
+	if (a->minx < b->minx) return -1;
+	if (a->minx > b->minx) return 1;
+	return 0;
+}
+
+// Returns true if the bounds of any two meshes overlap by more than their borders. The meshes
+// of a tiled build only share their borders.
+static bool overlapMeshBounds(const rcMergeMeshInfo* info, const int nmeshes, rcMergeMeshInfo* sorted)
+{
+	memcpy(sorted, info, sizeof(rcMergeMeshInfo)*nmeshes);
+	qsort(sorted, nmeshes, sizeof(rcMergeMeshInfo), compareMeshMinX);
+	for (int i = 0; i < nmeshes; ++i)
+	{
+		const rcMergeMeshInfo& a = sorted[i];
+		for (int j = i+1; j < nmeshes && sorted[j].minx < a.maxx; ++j)
+		{
+			const rcMergeMeshInfo& b = sorted[j];
+			if (a.minx < b.maxx && a.minz < b.maxz && b.minz < a.maxz)
+				return true;
+		}
+	}
+	return false;
+}
+
 /// @see rcAllocPolyMesh, rcPolyMesh
 bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, rcPolyMesh& mesh)
+{
+	return rcMergePolyMeshes(ctx, meshes, nmeshes, mesh, 0);
+}
+
+/// @par
+///
+/// The vertices inside the bounds of each mesh are welded by jobs, each with a hash table
+/// sized for one mesh. Only the vertices on the mesh borders, which are shared with the
+/// neighbouring meshes, are welded serially. The vertex and polygon offsets of the meshes
+/// are prefix sums, so the jobs then copy the vertices and polygons in place. The result
+/// is identical to the serial merge. Meshes whose bounds overlap, instead of meeting at
+/// their borders, have all their vertices welded serially.
+///
+/// @see rcAllocPolyMesh, rcPolyMesh, rcJobDispatcher
+bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, rcPolyMesh& mesh,
+					   rcJobDispatcher* dispatcher)
 {
 	rcAssert(ctx);
 	
@@ -1340,6 +1851,7 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'mesh.verts' (%d).", maxVerts*3);
 		return false;
 	}
+	mesh.maxverts = maxVerts;
 
 	mesh.npolys = 0;
 	mesh.polys = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxPolys*2*mesh.nvp, RC_ALLOC_PERM);
@@ -1348,7 +1860,6 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'mesh.polys' (%d).", maxPolys*2*mesh.nvp);
 		return false;
 	}
-	memset(mesh.polys, 0xff, sizeof(unsigned short)*maxPolys*2*mesh.nvp);
 
 	mesh.regs = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxPolys, RC_ALLOC_PERM);
 	if (!mesh.regs)
@@ -1356,7 +1867,6 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'mesh.regs' (%d).", maxPolys);
 		return false;
 	}
-	memset(mesh.regs, 0, sizeof(unsigned short)*maxPolys);
 
 	mesh.areas = (unsigned char*)rcAlloc(sizeof(unsigned char)*maxPolys, RC_ALLOC_PERM);
 	if (!mesh.areas)
@@ -1364,7 +1874,6 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'mesh.areas' (%d).", maxPolys);
 		return false;
 	}
-	memset(mesh.areas, 0, sizeof(unsigned char)*maxPolys);
 
 	mesh.flags = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxPolys, RC_ALLOC_PERM);
 	if (!mesh.flags)
@@ -1372,98 +1881,129 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'mesh.flags' (%d).", maxPolys);
 		return false;
 	}
-	memset(mesh.flags, 0, sizeof(unsigned short)*maxPolys);
-	
-	rcScopedDelete<int> nextVert((int*)rcAlloc(sizeof(int)*maxVerts, RC_ALLOC_TEMP));
-	if (!nextVert)
+
+	// Keep the edge clearances only if all the meshes have them.
+	bool hasEdgeClearance = true;
+	for (int i = 0; i < nmeshes; ++i)
+		hasEdgeClearance = hasEdgeClearance && meshes[i]->edgeClearance != 0;
+	if (hasEdgeClearance)
 	{
-		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'nextVert' (%d).", maxVerts);
-		return false;
+		mesh.edgeClearance = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxPolys*mesh.nvp, RC_ALLOC_PERM);
+		if (!mesh.edgeClearance)
+		{
+			ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'mesh.edgeClearance' (%d).", maxPolys*mesh.nvp);
+			return false;
+		}
 	}
-	memset(nextVert, 0, sizeof(int)*maxVerts);
+	mesh.maxpolys = maxPolys;
 	
-	rcScopedDelete<int> firstVert((int*)rcAlloc(sizeof(int)*VERTEX_BUCKET_COUNT, RC_ALLOC_TEMP));
-	if (!firstVert)
+	const int workerCount = dispatcher ? rcMax(1, dispatcher->getWorkerCount()) : 1;
+	const int bucketCount = calcHashSize(maxVertsPerMesh);
+	rcScopedDelete<rcMergeMeshInfo> info((rcMergeMeshInfo*)rcAlloc(sizeof(rcMergeMeshInfo)*nmeshes*2, RC_ALLOC_TEMP));
+	rcScopedDelete<int> weld((int*)rcAlloc(sizeof(int)*rcMax(1, maxVerts), RC_ALLOC_TEMP));
+	rcScopedDelete<unsigned short> remap((unsigned short*)rcAlloc(sizeof(unsigned short)*rcMax(1, maxVerts), RC_ALLOC_TEMP));
+	rcScopedDelete<rcMergeScratch> scratch((rcMergeScratch*)rcAlloc(sizeof(rcMergeScratch)*workerCount, RC_ALLOC_TEMP));
+	rcScopedDelete<int> scratchBuckets((int*)rcAlloc(sizeof(int)*bucketCount*workerCount, RC_ALLOC_TEMP));
+	rcScopedDelete<unsigned short> scratchVerts((unsigned short*)rcAlloc(sizeof(unsigned short)*rcMax(1, maxVertsPerMesh)*3*workerCount, RC_ALLOC_TEMP));
+	rcScopedDelete<int> scratchRefs((int*)rcAlloc(sizeof(int)*rcMax(1, maxVertsPerMesh)*workerCount, RC_ALLOC_TEMP));
+	if (!info || !weld || !remap || !scratch || !scratchBuckets || !scratchVerts || !scratchRefs)
 	{
-		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'firstVert' (%d).", VERTEX_BUCKET_COUNT);
+		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'weld' (%d).", maxVerts);
 		return false;
 	}
-	for (int i = 0; i < VERTEX_BUCKET_COUNT; ++i)
-		firstVert[i] = -1;
-
-	rcScopedDelete<unsigned short> vremap((unsigned short*)rcAlloc(sizeof(unsigned short)*maxVertsPerMesh, RC_ALLOC_PERM));
-	if (!vremap)
+	for (int i = 0; i < workerCount; ++i)
 	{
-		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'vremap' (%d).", maxVertsPerMesh);
-		return false;
+		scratch[i].buckets = &scratchBuckets[i*bucketCount];
+		scratch[i].verts = &scratchVerts[i*rcMax(1, maxVertsPerMesh)*3];
+		scratch[i].refs = &scratchRefs[i*rcMax(1, maxVertsPerMesh)];
 	}
-	memset(vremap, 0, sizeof(unsigned short)*maxVertsPerMesh);
 	
+	int vertBase = 0;
 	for (int i = 0; i < nmeshes; ++i)
 	{
 		const rcPolyMesh* pmesh = meshes[i];
+		rcMergeMeshInfo& mi = info[i];
 		
-		const unsigned short ox = (unsigned short)floorf((pmesh->bmin[0]-mesh.bmin[0])/mesh.cs+0.5f);
-		const unsigned short oz = (unsigned short)floorf((pmesh->bmin[2]-mesh.bmin[2])/mesh.cs+0.5f);
+		mi.ox = (unsigned short)floorf((pmesh->bmin[0]-mesh.bmin[0])/mesh.cs+0.5f);
+		mi.oz = (unsigned short)floorf((pmesh->bmin[2]-mesh.bmin[2])/mesh.cs+0.5f);
 		
-		bool isMinX = (ox == 0);
-		bool isMinZ = (oz == 0);
-		bool isMaxX = ((unsigned short)floorf((mesh.bmax[0] - pmesh->bmax[0]) / mesh.cs + 0.5f)) == 0;
-		bool isMaxZ = ((unsigned short)floorf((mesh.bmax[2] - pmesh->bmax[2]) / mesh.cs + 0.5f)) == 0;
-		bool isOnBorder = (isMinX || isMinZ || isMaxX || isMaxZ);
-
+		mi.isMinX = (mi.ox == 0);
+		mi.isMinZ = (mi.oz == 0);
+		mi.isMaxX = ((unsigned short)floorf((mesh.bmax[0] - pmesh->bmax[0]) / mesh.cs + 0.5f)) == 0;
+		mi.isMaxZ = ((unsigned short)floorf((mesh.bmax[2] - pmesh->bmax[2]) / mesh.cs + 0.5f)) == 0;
+		mi.vertBase = vertBase;
+		mi.polyBase = mesh.npolys;
+		vertBase += pmesh->nverts;
+		mesh.npolys += pmesh->npolys;
+	}
+	
+	rcMergePolyMeshJob job;
+	job.meshes = meshes;
+	job.nmeshes = nmeshes;
+	job.jobCount = rcMin(nmeshes, workerCount*8);
+	job.mesh = &mesh;
+	job.info = info;
+	job.scratch = scratch;
+	job.bucketCount = bucketCount;
+	job.hasEdgeClearance = hasEdgeClearance;
+	job.weld = weld;
+	job.remap = remap;
+	runMergeJobs(dispatcher, weldInteriorVertsJob, job);
+	
+	// Weld the vertices on the mesh borders, or all of them if the meshes overlap, in mesh order.
+	if (overlapMeshBounds(info, nmeshes, &info[nmeshes]))
+	{
+		for (int i = 0; i < maxVerts; ++i)
+			weld[i] = MERGE_BORDER_VERTEX;
+	}
+	int borderCount = 0;
+	for (int i = 0; i < maxVerts; ++i)
+	{
+		if (weld[i] == MERGE_BORDER_VERTEX)
+			borderCount++;
+	}
+	const int borderBucketCount = calcHashSize(borderCount);
+	rcScopedDelete<int> borderBuckets((int*)rcAlloc(sizeof(int)*borderBucketCount, RC_ALLOC_TEMP));
+	rcScopedDelete<unsigned short> borderVerts((unsigned short*)rcAlloc(sizeof(unsigned short)*rcMax(1, borderCount)*3, RC_ALLOC_TEMP));
+	rcScopedDelete<int> borderRefs((int*)rcAlloc(sizeof(int)*rcMax(1, borderCount), RC_ALLOC_TEMP));
+	if (!borderBuckets || !borderVerts || !borderRefs)
+	{
+		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'borderVerts' (%d).", borderCount);
+		return false;
+	}
+	memset(borderBuckets, 0xff, sizeof(int)*borderBucketCount);
+	int nborder = 0;
+	for (int i = 0; i < nmeshes; ++i)
+	{
+		const rcPolyMesh* pmesh = meshes[i];
+		rcMergeMeshInfo& mi = info[i];
+		mi.newBase = mesh.nverts;
 		for (int j = 0; j < pmesh->nverts; ++j)
 		{
-			unsigned short* v = &pmesh->verts[j*3];
-			vremap[j] = addVertex(v[0]+ox, v[1], v[2]+oz,
-								  mesh.verts, firstVert, nextVert, mesh.nverts);
-		}
-		
-		for (int j = 0; j < pmesh->npolys; ++j)
-		{
-			unsigned short* tgt = &mesh.polys[mesh.npolys*2*mesh.nvp];
-			unsigned short* src = &pmesh->polys[j*2*mesh.nvp];
-			mesh.regs[mesh.npolys] = pmesh->regs[j];
-			mesh.areas[mesh.npolys] = pmesh->areas[j];
-			mesh.flags[mesh.npolys] = pmesh->flags[j];
-			mesh.npolys++;
-			for (int k = 0; k < mesh.nvp; ++k)
-			{
-				if (src[k] == RC_MESH_NULL_IDX) break;
-				tgt[k] = vremap[src[k]];
-			}
-
-			if (isOnBorder)
+			int& w = weld[mi.vertBase+j];
+			if (w == MERGE_BORDER_VERTEX)
 			{
-				for (int k = mesh.nvp; k < mesh.nvp * 2; ++k)
+				const unsigned short* v = &pmesh->verts[j*3];
+				const int n = nborder;
+				const unsigned short k = addVertex((unsigned short)(v[0]+mi.ox), v[1], (unsigned short)(v[2]+mi.oz),
+												   borderVerts, borderBuckets, borderBucketCount, nborder);
+				if (nborder != n)
 				{
-					if (src[k] & 0x8000 && src[k] != 0xffff)
-					{
-						unsigned short dir = src[k] & 0xf;
-						switch (dir)
-						{
-							case 0: // Portal x-
-								if (isMinX)
-									tgt[k] = src[k];
-								break;
-							case 1: // Portal z+
-								if (isMaxZ)
-									tgt[k] = src[k];
-								break;
-							case 2: // Portal x+
-								if (isMaxX)
-									tgt[k] = src[k];
-								break;
-							case 3: // Portal z-
-								if (isMinZ)
-									tgt[k] = src[k];
-								break;
-						}
-					}
+					borderRefs[k] = mi.vertBase+j;
+					w = MERGE_NEW_VERTEX;
+				}
+				else
+				{
+					w = borderRefs[k];
 				}
 			}
+			if (w == MERGE_NEW_VERTEX)
+				mesh.nverts++;
 		}
 	}
+	
+	runMergeJobs(dispatcher, addMergedVertsJob, job);
+	runMergeJobs(dispatcher, copyMergedPolysJob, job);
 
 	// Calculate adjacency.
 	if (!buildMeshAdjacency(mesh.polys, mesh.npolys, mesh.nverts, mesh.nvp))
@@ -1484,6 +2024,260 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 	return true;
 }
 
+// Grows the vertex array of the mesh to hold at least maxVerts vertices.
+static bool reserveVerts(rcPolyMesh& mesh, const int maxVerts)
+{
+	if (maxVerts <= mesh.maxverts)
+		return true;
+	const int n = rcMax(maxVerts, mesh.maxverts*2);
+	unsigned short* verts = (unsigned short*)rcAlloc(sizeof(unsigned short)*n*3, RC_ALLOC_PERM);
+	if (!verts)
+		return false;
+	memcpy(verts, mesh.verts, sizeof(unsigned short)*mesh.nverts*3);
+	rcFree(mesh.verts);
+	mesh.verts = verts;
+	mesh.maxverts = n;
+	return true;
+}
+
+// Grows the polygon arrays of the mesh to hold at least maxPolys polygons.
+static bool reservePolys(rcPolyMesh& mesh, const int maxPolys)
+{
+	if (maxPolys <= mesh.maxpolys)
+		return true;
+	const int nvp = mesh.nvp;
+	const int n = rcMax(maxPolys, mesh.maxpolys*2);
+	unsigned short* polys = (unsigned short*)rcAlloc(sizeof(unsigned short)*n*nvp*2, RC_ALLOC_PERM);
+	unsigned short* regs = (unsigned short*)rcAlloc(sizeof(unsigned short)*n, RC_ALLOC_PERM);
+	unsigned char* areas = (unsigned char*)rcAlloc(sizeof(unsigned char)*n, RC_ALLOC_PERM);
+	unsigned short* flags = (unsigned short*)rcAlloc(sizeof(unsigned short)*n, RC_ALLOC_PERM);
+	if (!polys || !regs || !areas || !flags)
+	{
+		rcFree(polys);
+		rcFree(regs);
+		rcFree(areas);
+		rcFree(flags);
+		return false;
+	}
+	memset(polys, 0xff, sizeof(unsigned short)*n*nvp*2);
+	memcpy(polys, mesh.polys, sizeof(unsigned short)*mesh.npolys*nvp*2);
+	memcpy(regs, mesh.regs, sizeof(unsigned short)*mesh.npolys);
+	memcpy(areas, mesh.areas, sizeof(unsigned char)*mesh.npolys);
+	memcpy(flags, mesh.flags, sizeof(unsigned short)*mesh.npolys);
+	rcFree(mesh.polys);
+	rcFree(mesh.regs);
+	rcFree(mesh.areas);
+	rcFree(mesh.flags);
+	mesh.polys = polys;
+	mesh.regs = regs;
+	mesh.areas = areas;
+	mesh.flags = flags;
+	mesh.maxpolys = n;
+	return true;
+}
+
+// Inserts the vertices of the other mesh on the border z = otherZ into the edges of the mesh
+// on its border z = meshZ. dx and dy convert the coordinates of the other mesh into the mesh.
+static bool stitchBorder(rcPolyMesh& mesh, const int meshZ, const rcPolyMesh& other, const int otherZ,
+						 const int dx, const int dy, const int maxHeightDiff)
+{
+	const int nvp = mesh.nvp;
+
+	// The vertices of the other mesh on the border, and the ones the mesh has on it already.
+	rcTempVector<int> otherVerts;
+	for (int i = 0; i < other.nverts; ++i)
+	{
+		const unsigned short* v = &other.verts[i*3];
+		if ((int)v[2] != otherZ)
+			continue;
+		otherVerts.push_back((int)v[0] + dx);
+		otherVerts.push_back((int)v[1] + dy);
+	}
+	if (otherVerts.empty())
+		return true;
+	rcTempVector<int> borderVerts;
+	for (int i = 0; i < mesh.nverts; ++i)
+	{
+		if ((int)mesh.verts[i*3+2] == meshZ)
+			borderVerts.push_back(i);
+	}
+
+	rcTempVector<int> loop;
+	rcTempVector<int> edgeVerts;
+	const int npolys = mesh.npolys;
+	for (int i = 0; i < npolys; ++i)
+	{
+		const unsigned short* p = &mesh.polys[i*nvp*2];
+		const int nv = countPolyVerts(p, nvp);
+
+		// Walk around the polygon, adding the vertices of the other mesh inside its border edges.
+		loop.clear();
+		int apex = -1;
+		for (int j = 0; j < nv; ++j)
+		{
+			const unsigned short* va = &mesh.verts[p[j]*3];
+			const unsigned short* vb = &mesh.verts[p[(j+1) % nv]*3];
+			loop.push_back(p[j]);
+			if ((int)va[2] != meshZ)
+			{
+				if (apex < 0)
+					apex = (int)loop.size()-1;
+				continue;
+			}
+			if ((int)vb[2] != meshZ || va[0] == vb[0])
+				continue;
+
+			// The vertices strictly inside the edge and close to its height, ordered from a to b.
+			const int ax = va[0], bx = vb[0];
+			edgeVerts.clear();
+			for (int k = 0; k < (int)otherVerts.size(); k += 2)
+			{
+				const int x = otherVerts[k];
+				const int y = otherVerts[k+1];
+				if (x <= rcMin(ax, bx) || x >= rcMax(ax, bx))
+					continue;
+				const float t = (float)(x - ax) / (float)(bx - ax);
+				const float ey = (float)va[1] + ((float)vb[1] - (float)va[1]) * t;
+				if (rcAbs((float)y - ey) > (float)maxHeightDiff)
+					continue;
+				int pos = (int)edgeVerts.size();
+				edgeVerts.push_back(k);
+				while (pos > 0 && rcAbs(otherVerts[edgeVerts[pos-1]] - ax) > rcAbs(x - ax))
+				{
+					rcSwap(edgeVerts[pos], edgeVerts[pos-1]);
+					pos--;
+				}
+			}
+
+			for (int k = 0; k < (int)edgeVerts.size(); ++k)
+			{
+				const int x = otherVerts[edgeVerts[k]];
+				const int y = otherVerts[edgeVerts[k]+1];
+				if (k > 0 && otherVerts[edgeVerts[k-1]] == x)
+					continue;
+
+				// Reuse a vertex of the mesh at the same place, possibly one added for a previous polygon.
+				int vi = -1;
+				for (int n = 0; n < (int)borderVerts.size() && vi < 0; ++n)
+				{
+					const unsigned short* v = &mesh.verts[borderVerts[n]*3];
+					if ((int)v[0] == x && rcAbs((int)v[1] - y) <= maxHeightDiff)
+						vi = borderVerts[n];
+				}
+				if (vi < 0)
+				{
+					if (mesh.nverts >= RC_MESH_NULL_IDX || !reserveVerts(mesh, mesh.nverts+1))
+						return false;
+					vi = mesh.nverts++;
+					mesh.verts[vi*3+0] = (unsigned short)x;
+					mesh.verts[vi*3+1] = (unsigned short)rcMax(y, 0);
+					mesh.verts[vi*3+2] = (unsigned short)meshZ;
+					borderVerts.push_back(vi);
+				}
+				loop.push_back(vi);
+			}
+		}
+		if ((int)loop.size() == nv)
+			continue;
+
+		// Polygons with too many vertices are split into fans around a vertex off the border.
+		const int nloop = (int)loop.size();
+		const int pieces = nloop <= nvp ? 1 : (nloop - 2 + nvp - 3) / (nvp - 2);
+		if (pieces > 1 && (apex < 0 || !reservePolys(mesh, mesh.npolys + pieces - 1)))
+			return false;
+		int start = 0;
+		for (int piece = 0; piece < pieces; ++piece)
+		{
+			const int pi = piece == 0 ? i : mesh.npolys++;
+			unsigned short* dst = &mesh.polys[pi*nvp*2];
+			memset(dst, 0xff, sizeof(unsigned short)*nvp*2);
+			if (pieces == 1)
+			{
+				for (int j = 0; j < nloop; ++j)
+					dst[j] = (unsigned short)loop[j];
+				continue;
+			}
+			// The piece covers the vertices start..end after the apex.
+			const int end = rcMin(start + nvp - 2, nloop - 2);
+			dst[0] = (unsigned short)loop[apex];
+			for (int j = start; j <= end; ++j)
+				dst[1 + j - start] = (unsigned short)loop[(apex + 1 + j) % nloop];
+			start = end;
+			if (pi != i)
+			{
+				mesh.regs[pi] = mesh.regs[i];
+				mesh.areas[pi] = mesh.areas[i];
+				mesh.flags[pi] = mesh.flags[i];
+			}
+		}
+	}
+	return true;
+}
+
+// Rebuilds the adjacency of a stitched mesh and flags its portal edges again.
+static bool finishStitch(rcPolyMesh& mesh)
+{
+	const int nvp = mesh.nvp;
+	for (int i = 0; i < mesh.npolys; ++i)
+	{
+		unsigned short* p = &mesh.polys[i*nvp*2];
+		for (int j = 0; j < nvp; ++j)
+			p[nvp+j] = RC_MESH_NULL_IDX;
+	}
+	if (!buildMeshAdjacency(mesh.polys, mesh.npolys, mesh.nverts, nvp))
+		return false;
+	if (mesh.borderSize > 0)
+	{
+		const int w = (int)floorf((mesh.bmax[0] - mesh.bmin[0]) / mesh.cs + 0.5f);
+		const int h = (int)floorf((mesh.bmax[2] - mesh.bmin[2]) / mesh.cs + 0.5f);
+		flagPortalEdges(mesh, w, h);
+	}
+	// The clearances no longer match the edges.
+	rcFree(mesh.edgeClearance);
+	mesh.edgeClearance = 0;
+	return true;
+}
+
+/// @par
+///
+/// The meshes are typically the bands of a banded build, see #rcBuildBandedPolyMesh. The border vertices of
+/// the two meshes differ, since each mesh only has vertices where its own regions meet the border. After
+/// stitching, both meshes share all vertices on the border, so that #rcMergePolyMeshes connects the polygons
+/// across it. Polygons which would get more than #rcPolyMesh::nvp vertices are split.
+///
+/// @see rcMergePolyMeshes, rcBuildBandedPolyMesh
+bool rcStitchPolyMeshes(rcContext* ctx, rcPolyMesh& lower, rcPolyMesh& upper, const int maxHeightDiff)
+{
+	rcAssert(ctx);
+
+	rcScopedTimer timer(ctx, RC_TIMER_MERGE_POLYMESH);
+
+	if (lower.nvp != upper.nvp || lower.cs != upper.cs || lower.ch != upper.ch)
+	{
+		ctx->log(RC_LOG_ERROR, "rcStitchPolyMeshes: The meshes have different settings.");
+		return false;
+	}
+	if (!lower.npolys || !upper.npolys)
+		return true;
+
+	const int dx = (int)floorf((upper.bmin[0] - lower.bmin[0]) / lower.cs + 0.5f);
+	const int dy = (int)floorf((upper.bmin[1] - lower.bmin[1]) / lower.ch + 0.5f);
+	const int lowerZ = (int)floorf((upper.bmin[2] - lower.bmin[2]) / lower.cs + 0.5f);
+
+	if (!stitchBorder(lower, lowerZ, upper, 0, dx, dy, maxHeightDiff) ||
+		!stitchBorder(upper, 0, lower, lowerZ, -dx, -dy, maxHeightDiff))
+	{
+		ctx->log(RC_LOG_ERROR, "rcStitchPolyMeshes: Out of memory or too many vertices.");
+		return false;
+	}
+	if (!finishStitch(lower) || !finishStitch(upper))
+	{
+		ctx->log(RC_LOG_ERROR, "rcStitchPolyMeshes: Adjacency failed.");
+		return false;
+	}
+	return true;
+}
+
 bool rcCopyPolyMesh(rcContext* ctx, const rcPolyMesh& src, rcPolyMesh& dst)
 {
 	rcAssert(ctx);
@@ -1494,10 +2288,12 @@ bool rcCopyPolyMesh(rcContext* ctx, const rcPolyMesh& src, rcPolyMesh& dst)
 	rcAssert(dst.regs == 0);
 	rcAssert(dst.areas == 0);
 	rcAssert(dst.flags == 0);
+	rcAssert(dst.edgeClearance == 0);
 	
 	dst.nverts = src.nverts;
 	dst.npolys = src.npolys;
 	dst.maxpolys = src.npolys;
+	dst.maxverts = src.nverts;
 	dst.nvp = src.nvp;
 	rcVcopy(dst.bmin, src.bmin);
 	rcVcopy(dst.bmax, src.bmax);
@@ -1545,6 +2341,17 @@ bool rcCopyPolyMesh(rcContext* ctx, const rcPolyMesh& src, rcPolyMesh& dst)
 		return false;
 	}
 	memcpy(dst.flags, src.flags, sizeof(unsigned short)*src.npolys);
+
+	if (src.edgeClearance)
+	{
+		dst.edgeClearance = (unsigned short*)rcAlloc(sizeof(unsigned short)*src.npolys*src.nvp, RC_ALLOC_PERM);
+		if (!dst.edgeClearance)
+		{
+			ctx->log(RC_LOG_ERROR, "rcCopyPolyMesh: Out of memory 'dst.edgeClearance' (%d).", src.npolys*src.nvp);
+			return false;
+		}
+		memcpy(dst.edgeClearance, src.edgeClearance, sizeof(unsigned short)*src.npolys*src.nvp);
+	}
 	
 	return true;
 }
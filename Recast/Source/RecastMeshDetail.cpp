@@ -165,9 +165,11 @@ static float distancePtSeg2d(const float* pt, const float* p, const float* q)
 	return dx*dx + dz*dz;
 }
 
-static float distToTriMesh(const float* p, const float* verts, const int /*nverts*/, const int* tris, const int ntris)
+static float distToTriMesh(const float* p, const float* verts, const int /*nverts*/, const int* tris, const int ntris,
+						   int& closest)
 {
 	float dmin = FLT_MAX;
+	closest = -1;
 	for (int i = 0; i < ntris; ++i)
 	{
 		const float* va = &verts[tris[i*4+0]*3];
@@ -175,7 +177,10 @@ static float distToTriMesh(const float* p, const float* verts, const int /*nvert
 		const float* vc = &verts[tris[i*4+2]*3];
 		float d = distPtTri(p, va,vb,vc);
 		if (d < dmin)
+		{
 			dmin = d;
+			closest = i;
+		}
 	}
 	if (dmin == FLT_MAX) return -1;
 	return dmin;
@@ -531,6 +536,249 @@ static void delaunayHull(rcContext* ctx, const int npts, const float* pts,
 	}
 }
 
+/// Scratch for updating the detail triangulation incrementally as samples are added.
+struct rcDelaunayScratch
+{
+	rcIntArray adj;					///< The triangle across each triangle edge, or -1 on the hull. [Size: 3 * ntris]
+	rcIntArray stack;				///< The triangle edges that still need to be checked for flipping.
+	rcIntArray dirty;				///< The triangles that the latest insertion created or changed.
+	rcIntArray stamps;				///< The insertion which last changed each triangle. [Size: ntris]
+	rcIntArray sampleTris;			///< The triangle each sample was closest to, or -1 if unknown. [Size: nsamples]
+	rcTempVector<float> sampleDists;	///< The distance of each sample to the triangle mesh. [Size: nsamples]
+	int stamp;						///< The current insertion.
+
+	inline rcDelaunayScratch() : stamp(0) {}
+};
+
+// Returns true if p is inside the circumcircle of the triangle a,b,c on the xz-plane.
+static bool inCircumCircle(const float* a, const float* b, const float* c, const float* p)
+{
+	const float adx = a[0] - p[0], adz = a[2] - p[2];
+	const float bdx = b[0] - p[0], bdz = b[2] - p[2];
+	const float cdx = c[0] - p[0], cdz = c[2] - p[2];
+	const float det = (adx*adx + adz*adz) * (bdx*cdz - cdx*bdz)
+					+ (bdx*bdx + bdz*bdz) * (cdx*adz - adx*cdz)
+					+ (cdx*cdx + cdz*cdz) * (adx*bdz - bdx*adz);
+	return vcross2(a, b, c) > 0 ? det > 0 : det < 0;
+}
+
+// Finds the edges connecting the triangles. O(n^2), only used on freshly built triangulations.
+static void buildTriAdjacency(const rcIntArray& tris, rcIntArray& adj)
+{
+	const int ntris = tris.size()/4;
+	adj.resize(ntris*3);
+	for (int i = 0; i < ntris*3; ++i)
+		adj[i] = -1;
+	for (int i = 0; i < ntris; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			if (adj[i*3+j] != -1)
+				continue;
+			const int a = tris[i*4+j];
+			const int b = tris[i*4+(j+1)%3];
+			for (int k = i+1; k < ntris && adj[i*3+j] == -1; ++k)
+			{
+				for (int m = 0; m < 3; ++m)
+				{
+					if (tris[k*4+m] == b && tris[k*4+(m+1)%3] == a && adj[k*3+m] == -1)
+					{
+						adj[i*3+j] = k;
+						adj[k*3+m] = i;
+						break;
+					}
+				}
+			}
+		}
+	}
+}
+
+// Rotates the vertices and neighbours of a triangle so that edge e becomes the first edge.
+static void rotateTri(rcIntArray& tris, rcIntArray& adj, const int t, const int e)
+{
+	if (e == 0)
+		return;
+	int v[3], n[3];
+	for (int j = 0; j < 3; ++j)
+	{
+		v[j] = tris[t*4+(j+e)%3];
+		n[j] = adj[t*3+(j+e)%3];
+	}
+	for (int j = 0; j < 3; ++j)
+	{
+		tris[t*4+j] = v[j];
+		adj[t*3+j] = n[j];
+	}
+}
+
+// Replaces the neighbour 'from' of triangle t with 'to'.
+static void replaceNeighbour(rcIntArray& adj, const int t, const int from, const int to)
+{
+	if (t < 0)
+		return;
+	for (int j = 0; j < 3; ++j)
+	{
+		if (adj[t*3+j] == from)
+		{
+			adj[t*3+j] = to;
+			return;
+		}
+	}
+}
+
+static void setTri(rcIntArray& tris, rcIntArray& adj, const int t,
+				   const int a, const int b, const int c, const int na, const int nb, const int nc)
+{
+	tris[t*4+0] = a; tris[t*4+1] = b; tris[t*4+2] = c; tris[t*4+3] = 0;
+	adj[t*3+0] = na; adj[t*3+1] = nb; adj[t*3+2] = nc;
+}
+
+static int addTri(rcIntArray& tris, rcIntArray& adj, rcIntArray& stamps)
+{
+	const int t = tris.size()/4;
+	for (int j = 0; j < 4; ++j)
+		tris.push(0);
+	for (int j = 0; j < 3; ++j)
+		adj.push(-1);
+	stamps.push(-1);
+	return t;
+}
+
+static void markDirty(rcDelaunayScratch& ds, const int t)
+{
+	if (ds.stamps[t] != ds.stamp)
+	{
+		ds.stamps[t] = ds.stamp;
+		ds.dirty.push(t);
+	}
+}
+
+/// Inserts vertex p into a Delaunay triangulation of the hull by splitting the triangle
+/// containing it and flipping the edges that are no longer Delaunay (Lawson's algorithm).
+/// The hull edges are never flipped. Returns false if no triangle contains the vertex.
+static bool insertDelaunayVertex(const float* verts, const int p, rcIntArray& tris, rcDelaunayScratch& ds)
+{
+	static const float EDGE_EPS = 1e-5f;
+	rcIntArray& adj = ds.adj;
+	const float* pv = &verts[p*3];
+	const int ntris = tris.size()/4;
+	
+	// Find the triangle which contains the point, or is the closest to containing it.
+	int best = -1;
+	int bestEdge = 0;
+	float bestw = -EDGE_EPS;
+	for (int i = 0; i < ntris; ++i)
+	{
+		const float* va = &verts[tris[i*4+0]*3];
+		const float* vb = &verts[tris[i*4+1]*3];
+		const float* vc = &verts[tris[i*4+2]*3];
+		const float area = vcross2(va, vb, vc);
+		if (area == 0)
+			continue;
+		// Barycentric coordinates opposite to each edge.
+		const float w[3] = { vcross2(va, vb, pv) / area, vcross2(vb, vc, pv) / area, vcross2(vc, va, pv) / area };
+		int e = 0;
+		if (w[1] < w[e]) e = 1;
+		if (w[2] < w[e]) e = 2;
+		if (w[e] > bestw)
+		{
+			bestw = w[e];
+			best = i;
+			bestEdge = e;
+		}
+	}
+	if (best == -1)
+		return false;
+	
+	ds.stamp++;
+	ds.dirty.clear();
+	ds.stack.clear();
+	
+	int t = best;
+	rotateTri(tris, adj, t, bestEdge);
+	const int a = tris[t*4+0], b = tris[t*4+1], c = tris[t*4+2];
+	const int nab = adj[t*3+0], nbc = adj[t*3+1], nca = adj[t*3+2];
+	
+	if (bestw < EDGE_EPS && nab != -1)
+	{
+		// The point is on the edge a-b, split both triangles sharing it.
+		const int n = nab;
+		for (int j = 0; j < 3; ++j)
+			if (adj[n*3+j] == t) { rotateTri(tris, adj, n, j); break; }
+		const int d = tris[n*4+2];
+		const int nad = adj[n*3+1], ndb = adj[n*3+2];
+		const int t1 = addTri(tris, adj, ds.stamps);
+		const int t3 = addTri(tris, adj, ds.stamps);
+		setTri(tris, adj, t, p, b, c, t3, nbc, t1);
+		setTri(tris, adj, t1, c, a, p, nca, n, t);
+		setTri(tris, adj, n, p, a, d, t1, nad, t3);
+		setTri(tris, adj, t3, d, b, p, ndb, t, n);
+		replaceNeighbour(adj, nca, t, t1);
+		replaceNeighbour(adj, ndb, n, t3);
+		markDirty(ds, t); markDirty(ds, t1); markDirty(ds, n); markDirty(ds, t3);
+		ds.stack.push(t*3+1);
+		ds.stack.push(t1*3+0);
+		ds.stack.push(n*3+1);
+		ds.stack.push(t3*3+0);
+	}
+	else
+	{
+		// Split the triangle in three.
+		const int t1 = addTri(tris, adj, ds.stamps);
+		const int t2 = addTri(tris, adj, ds.stamps);
+		setTri(tris, adj, t, a, b, p, nab, t1, t2);
+		setTri(tris, adj, t1, b, c, p, nbc, t2, t);
+		setTri(tris, adj, t2, c, a, p, nca, t, t1);
+		replaceNeighbour(adj, nbc, t, t1);
+		replaceNeighbour(adj, nca, t, t2);
+		markDirty(ds, t); markDirty(ds, t1); markDirty(ds, t2);
+		ds.stack.push(t*3+0);
+		ds.stack.push(t1*3+0);
+		ds.stack.push(t2*3+0);
+	}
+	
+	// Flip the edges opposite to p until the triangulation is Delaunay again.
+	// The flip count is capped to guarantee termination with round-off.
+	int maxFlips = tris.size();
+	while (ds.stack.size() > 0 && maxFlips-- > 0)
+	{
+		const int item = ds.stack.pop();
+		t = item / 3;
+		rotateTri(tris, adj, t, item % 3);
+		const int n = adj[t*3+0];
+		if (n == -1)
+			continue;
+		const int u = tris[t*4+0], v = tris[t*4+1];
+		rcAssert(tris[t*4+2] == p);
+		int m = 0;
+		while (m < 3 && adj[n*3+m] != t) ++m;
+		if (m == 3)
+			continue;
+		rotateTri(tris, adj, n, m);
+		const int d = tris[n*4+2];
+		const float* uv = &verts[u*3];
+		const float* vv = &verts[v*3];
+		const float* dv = &verts[d*3];
+		if (!inCircumCircle(vv, uv, dv, pv))
+			continue;
+		// Only flip if the quad is convex, so that both new triangles keep the winding.
+		const float area = vcross2(uv, vv, pv);
+		if (vcross2(uv, dv, pv)*area <= 0 || vcross2(dv, vv, pv)*area <= 0)
+			continue;
+		const int tvp = adj[t*3+1], tpu = adj[t*3+2];
+		const int nud = adj[n*3+1], ndv = adj[n*3+2];
+		setTri(tris, adj, t, u, d, p, nud, n, tpu);
+		setTri(tris, adj, n, d, v, p, ndv, tvp, t);
+		replaceNeighbour(adj, nud, n, t);
+		replaceNeighbour(adj, tvp, t, n);
+		markDirty(ds, t); markDirty(ds, n);
+		ds.stack.push(t*3+0);
+		ds.stack.push(n*3+0);
+	}
+	
+	return true;
+}
+
 // Calculate minimum extend of the polygon.
 static float polyMinExtent(const float* verts, const int nverts)
 {
@@ -672,7 +920,8 @@ static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 							const float sampleDist, const float sampleMaxError,
 							const int heightSearchRadius, const rcCompactHeightfield& chf,
 							const rcHeightPatch& hp, float* verts, int& nverts,
-							rcIntArray& tris, rcIntArray& edges, rcIntArray& samples)
+							rcIntArray& tris, rcIntArray& edges, rcIntArray& samples,
+							rcDelaunayScratch& ds)
 {
 	static const int MAX_VERTS = 127;
 	static const int MAX_TRIS = 255;	// Max tris for delaunay is 2n-2-k (n=num verts, k=num hull verts).
@@ -858,7 +1107,13 @@ static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 		// Add the samples starting from the one that has the most
 		// error. The procedure stops when all samples are added
 		// or when the max error is within treshold.
+		// The distances of the samples to the mesh are cached, and after
+		// an incremental insertion only compared against the changed triangles.
 		const int nsamples = samples.size()/4;
+		ds.sampleTris.resize(nsamples);
+		ds.sampleDists.resize(nsamples);
+		bool triangulated = false;
+		bool allDirty = true;
 		for (int iter = 0; iter < nsamples; ++iter)
 		{
 			if (nverts >= MAX_VERTS)
@@ -878,7 +1133,26 @@ static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 				pt[0] = s[0]*sampleDist + getJitterX(i)*cs*0.1f;
 				pt[1] = s[1]*chf.ch;
 				pt[2] = s[2]*sampleDist + getJitterY(i)*cs*0.1f;
-				float d = distToTriMesh(pt, verts, nverts, &tris[0], tris.size()/4);
+				float& d = ds.sampleDists[i];
+				int& closest = ds.sampleTris[i];
+				if (allDirty || closest == -1 || ds.stamps[closest] == ds.stamp)
+				{
+					d = distToTriMesh(pt, verts, nverts, &tris[0], tris.size()/4, closest);
+				}
+				else
+				{
+					// The cached triangle is unchanged, only the changed ones can be closer.
+					for (int j = 0; j < ds.dirty.size(); ++j)
+					{
+						const int* t = &tris[ds.dirty[j]*4];
+						const float dt = distPtTri(pt, &verts[t[0]*3], &verts[t[1]*3], &verts[t[2]*3]);
+						if (dt < d)
+						{
+							d = dt;
+							closest = ds.dirty[j];
+						}
+					}
+				}
 				if (d < 0) continue; // did not hit the mesh.
 				if (d > bestd)
 				{
@@ -896,11 +1170,25 @@ static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 			rcVcopy(&verts[nverts*3],bestpt);
 			nverts++;
 			
-			// Create new triangulation.
-			// TODO: Incremental add instead of full rebuild.
+			// Insert the point into the triangulation. The first sample replaces the
+			// initial hull triangulation with a Delaunay one, which is also rebuilt
+			// if the point could not be inserted.
+			if (triangulated && insertDelaunayVertex(verts, nverts-1, tris, ds))
+			{
+				allDirty = false;
+				continue;
+			}
 			edges.clear();
 			tris.clear();
 			delaunayHull(ctx, nverts, verts, nhull, hull, tris, edges);
+			buildTriAdjacency(tris, ds.adj);
+			ds.stamps.resize(tris.size()/4);
+			for (int i = 0; i < ds.stamps.size(); ++i)
+				ds.stamps[i] = -1;
+			ds.stamp = 0;
+			ds.dirty.clear();
+			triangulated = true;
+			allDirty = true;
 		}
 	}
 	
@@ -1174,6 +1462,198 @@ static void getHeightData(rcContext* ctx, const rcCompactHeightfield& chf,
 	}
 }
 
+/// The scratch buffers used to build the detail mesh of a polygon. Parallel builds
+/// use one per worker, and also collect the output of the worker's polygons in it.
+struct rcDetailScratch
+{
+	inline rcDetailScratch() : edges(64), tris(512), arr(512), samples(512), poly(0) {}
+	inline ~rcDetailScratch() { rcFree(poly); }
+
+	rcIntArray edges;
+	rcIntArray tris;
+	rcIntArray arr;
+	rcIntArray samples;
+	float verts[256*3];
+	rcHeightPatch hp;
+	float* poly;
+	rcDelaunayScratch delaunay;
+
+	rcTempVector<float> outVerts;
+	rcTempVector<unsigned char> outTris;
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcDetailScratch(const rcDetailScratch&);
+	rcDetailScratch& operator=(const rcDetailScratch&);
+};
+
+/// Owns an array of scratch buffers.
+struct rcDetailScratchArray
+{
+	inline rcDetailScratchArray() : items(0), count(0) {}
+	inline ~rcDetailScratchArray()
+	{
+		for (int i = 0; i < count; ++i)
+			items[i].~rcDetailScratch();
+		rcFree(items);
+	}
+
+	bool init(const int n, const int nvp, const int maxhw, const int maxhh)
+	{
+		items = (rcDetailScratch*)rcAlloc(sizeof(rcDetailScratch)*n, RC_ALLOC_TEMP);
+		if (!items)
+			return false;
+		for (; count < n; ++count)
+		{
+			rcDetailScratch* s = ::new(rcNewTag(), (void*)&items[count]) rcDetailScratch();
+			s->poly = (float*)rcAlloc(sizeof(float)*nvp*3, RC_ALLOC_TEMP);
+			s->hp.data = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxhw*maxhh, RC_ALLOC_TEMP);
+			if (!s->poly || !s->hp.data)
+			{
+				++count;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	rcDetailScratch* items;
+	int count;
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcDetailScratchArray(const rcDetailScratchArray&);
+	rcDetailScratchArray& operator=(const rcDetailScratchArray&);
+};
+
+/// Builds the detail mesh of polygon @p i into the verts and tris of the scratch.
+/// The vertices are returned in world space.
+static bool buildPolyDetailMesh(rcContext* ctx, const rcPolyMesh& mesh, const rcCompactHeightfield& chf,
+								const int* bounds, const int i,
+								const float sampleDist, const float sampleMaxError, const int heightSearchRadius,
+								rcDetailScratch& scratch, int& nverts)
+{
+	const int nvp = mesh.nvp;
+	const float cs = mesh.cs;
+	const float ch = mesh.ch;
+	const float* orig = mesh.bmin;
+	const unsigned short* p = &mesh.polys[i*nvp*2];
+	float* poly = scratch.poly;
+	float* verts = scratch.verts;
+	rcHeightPatch& hp = scratch.hp;
+	
+	// Store polygon vertices for processing.
+	int npoly = 0;
+	for (int j = 0; j < nvp; ++j)
+	{
+		if(p[j] == RC_MESH_NULL_IDX) break;
+		const unsigned short* v = &mesh.verts[p[j]*3];
+		poly[j*3+0] = v[0]*cs;
+		poly[j*3+1] = v[1]*ch;
+		poly[j*3+2] = v[2]*cs;
+		npoly++;
+	}
+	
+	// Get the height data from the area of the polygon.
+	hp.xmin = bounds[i*4+0];
+	hp.ymin = bounds[i*4+2];
+	hp.width = bounds[i*4+1]-bounds[i*4+0];
+	hp.height = bounds[i*4+3]-bounds[i*4+2];
+	getHeightData(ctx, chf, p, npoly, mesh.verts, mesh.borderSize, hp, scratch.arr, mesh.regs[i]);
+	
+	// Build detail mesh.
+	nverts = 0;
+	if (!buildPolyDetail(ctx, poly, npoly,
+						 sampleDist, sampleMaxError,
+						 heightSearchRadius, chf, hp,
+						 verts, nverts, scratch.tris,
+						 scratch.edges, scratch.samples, scratch.delaunay))
+	{
+		return false;
+	}
+	
+	// Move detail verts to world space.
+	for (int j = 0; j < nverts; ++j)
+	{
+		verts[j*3+0] += orig[0];
+		verts[j*3+1] += orig[1] + chf.ch; // Is this offset necessary?
+		verts[j*3+2] += orig[2];
+	}
+	// Offset poly too, will be used to flag checking.
+	for (int j = 0; j < npoly; ++j)
+	{
+		poly[j*3+0] += orig[0];
+		poly[j*3+1] += orig[1];
+		poly[j*3+2] += orig[2];
+	}
+	
+	return true;
+}
+
+/// Where the parallel build stored the detail mesh of a polygon.
+struct rcPolyDetailResult
+{
+	int worker;			///< The worker whose scratch holds the output.
+	int vertBase;		///< The index of the first vertex in the scratch output.
+	int nverts;			///< The number of vertices.
+	int triBase;		///< The index of the first triangle in the scratch output.
+	int ntris;			///< The number of triangles.
+	bool success;		///< True if the detail mesh was built.
+};
+
+struct rcPolyMeshDetailJob
+{
+	const rcPolyMesh* mesh;
+	const rcCompactHeightfield* chf;
+	const int* bounds;
+	float sampleDist;
+	float sampleMaxError;
+	int heightSearchRadius;
+	int jobCount;
+	rcContext** contexts;
+	rcDetailScratch* scratch;
+	rcPolyDetailResult* results;
+};
+
+static void buildPolyMeshDetailJob(void* userData, const int jobIndex, const int workerIndex)
+{
+	const rcPolyMeshDetailJob* job = (const rcPolyMeshDetailJob*)userData;
+	const int npolys = job->mesh->npolys;
+	const int i0 = (int)((long long)npolys * jobIndex / job->jobCount);
+	const int i1 = (int)((long long)npolys * (jobIndex + 1) / job->jobCount);
+	rcDetailScratch& scratch = job->scratch[workerIndex];
+	rcContext* ctx = job->contexts[workerIndex];
+	
+	// The scratch buffers are grown here and freed by the calling thread.
+	rcTempArenaScope arenaScope(0);
+	
+	for (int i = i0; i < i1; ++i)
+	{
+		rcPolyDetailResult& res = job->results[i];
+		memset(&res, 0, sizeof(res));
+		int nverts = 0;
+		if (!buildPolyDetailMesh(ctx, *job->mesh, *job->chf, job->bounds, i,
+								 job->sampleDist, job->sampleMaxError, job->heightSearchRadius,
+								 scratch, nverts))
+		{
+			continue;
+		}
+		
+		const int ntris = scratch.tris.size()/4;
+		res.worker = workerIndex;
+		res.vertBase = (int)scratch.outVerts.size()/3;
+		res.nverts = nverts;
+		res.triBase = (int)scratch.outTris.size()/4;
+		res.ntris = ntris;
+		res.success = true;
+		
+		for (int j = 0; j < nverts*3; ++j)
+			scratch.outVerts.push_back(scratch.verts[j]);
+		for (int j = 0; j < ntris*4; ++j)
+			scratch.outTris.push_back((unsigned char)scratch.tris[j]);
+	}
+}
+
 /// @par
 ///
 /// See the #rcConfig documentation for more information on the configuration parameters.
@@ -1182,6 +1662,20 @@ static void getHeightData(rcContext* ctx, const rcCompactHeightfield& chf,
 bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompactHeightfield& chf,
 						   const float sampleDist, const float sampleMaxError,
 						   rcPolyMeshDetail& dmesh)
+{
+	return rcBuildPolyMeshDetail(ctx, mesh, chf, sampleDist, sampleMaxError, dmesh, 0, 0);
+}
+
+/// @par
+///
+/// Each job builds the detail meshes of a consecutive range of polygons into the scratch
+/// of its worker. The meshes are then copied to @p dmesh in polygon order, so the result
+/// is identical to the serial build.
+///
+/// @see rcAllocPolyMeshDetail, rcPolyMesh, rcCompactHeightfield, rcPolyMeshDetail, rcConfig, rcJobDispatcher
+bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompactHeightfield& chf,
+						   const float sampleDist, const float sampleMaxError,
+						   rcPolyMeshDetail& dmesh, rcJobDispatcher* dispatcher, rcContext** workerContexts)
 {
 	rcAssert(ctx);
 	
@@ -1191,18 +1685,9 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 		return true;
 	
 	const int nvp = mesh.nvp;
-	const float cs = mesh.cs;
-	const float ch = mesh.ch;
-	const float* orig = mesh.bmin;
-	const int borderSize = mesh.borderSize;
 	const int heightSearchRadius = rcMax(1, (int)ceilf(mesh.maxEdgeError));
+	const int workerCount = dispatcher ? rcMax(1, dispatcher->getWorkerCount()) : 1;
 	
-	rcIntArray edges(64);
-	rcIntArray tris(512);
-	rcIntArray arr(512);
-	rcIntArray samples(512);
-	float verts[256*3];
-	rcHeightPatch hp;
 	int nPolyVerts = 0;
 	int maxhw = 0, maxhh = 0;
 	
@@ -1212,12 +1697,6 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'bounds' (%d).", mesh.npolys*4);
 		return false;
 	}
-	rcScopedDelete<float> poly((float*)rcAlloc(sizeof(float)*nvp*3, RC_ALLOC_TEMP));
-	if (!poly)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'poly' (%d).", nvp*3);
-		return false;
-	}
 	
 	// Find max size for a polygon area.
 	for (int i = 0; i < mesh.npolys; ++i)
@@ -1250,88 +1729,171 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 		maxhh = rcMax(maxhh, ymax-ymin);
 	}
 	
-	hp.data = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxhw*maxhh, RC_ALLOC_TEMP);
-	if (!hp.data)
+	// With a dispatcher the scratch buffers are shared between threads, so they
+	// must not use the temporary memory arena of any thread.
+	rcDetailScratchArray scratch;
+	bool scratchReady;
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'hp.data' (%d).", maxhw*maxhh);
-		return false;
+		rcTempArenaScope arenaScope(dispatcher ? 0 : rcGetTempArena());
+		scratchReady = scratch.init(workerCount, nvp, maxhw, maxhh);
 	}
-	
-	dmesh.nmeshes = mesh.npolys;
-	dmesh.nverts = 0;
-	dmesh.ntris = 0;
-	dmesh.meshes = (unsigned int*)rcAlloc(sizeof(unsigned int)*dmesh.nmeshes*4, RC_ALLOC_PERM);
-	if (!dmesh.meshes)
+	if (!scratchReady)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.meshes' (%d).", dmesh.nmeshes*4);
+		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'scratch' (%d).", workerCount);
 		return false;
 	}
 	
-	int vcap = nPolyVerts+nPolyVerts/2;
-	int tcap = vcap*2;
-	
+	// Keep the arrays of a previous build when they are large enough.
+	dmesh.nmeshes = mesh.npolys;
 	dmesh.nverts = 0;
-	dmesh.verts = (float*)rcAlloc(sizeof(float)*vcap*3, RC_ALLOC_PERM);
-	if (!dmesh.verts)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.verts' (%d).", vcap*3);
-		return false;
-	}
 	dmesh.ntris = 0;
-	dmesh.tris = (unsigned char*)rcAlloc(sizeof(unsigned char)*tcap*4, RC_ALLOC_PERM);
-	if (!dmesh.tris)
+	if (!dmesh.meshes || dmesh.maxmeshes < dmesh.nmeshes)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.tris' (%d).", tcap*4);
-		return false;
+		rcFree(dmesh.meshes);
+		dmesh.maxmeshes = 0;
+		dmesh.meshes = (unsigned int*)rcAlloc(sizeof(unsigned int)*dmesh.nmeshes*4, RC_ALLOC_PERM);
+		if (!dmesh.meshes)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.meshes' (%d).", dmesh.nmeshes*4);
+			return false;
+		}
+		dmesh.maxmeshes = dmesh.nmeshes;
 	}
 	
-	for (int i = 0; i < mesh.npolys; ++i)
+	if (dispatcher)
 	{
-		const unsigned short* p = &mesh.polys[i*nvp*2];
+		rcScopedDelete<rcPolyDetailResult> results((rcPolyDetailResult*)rcAlloc(sizeof(rcPolyDetailResult)*mesh.npolys, RC_ALLOC_TEMP));
+		if (!results)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'results' (%d).", mesh.npolys);
+			return false;
+		}
 		
-		// Store polygon vertices for processing.
-		int npoly = 0;
-		for (int j = 0; j < nvp; ++j)
+		// Workers without a context share one with logging and timers disabled,
+		// which never touches its state and is safe to use concurrently.
+		rcContext disabledContext(false);
+		rcScopedDelete<rcContext*> contexts((rcContext**)rcAlloc(sizeof(rcContext*)*workerCount, RC_ALLOC_TEMP));
+		if (!contexts)
 		{
-			if(p[j] == RC_MESH_NULL_IDX) break;
-			const unsigned short* v = &mesh.verts[p[j]*3];
-			poly[j*3+0] = v[0]*cs;
-			poly[j*3+1] = v[1]*ch;
-			poly[j*3+2] = v[2]*cs;
-			npoly++;
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'contexts' (%d).", workerCount);
+			return false;
 		}
+		for (int i = 0; i < workerCount; ++i)
+			contexts[i] = workerContexts ? workerContexts[i] : &disabledContext;
 		
-		// Get the height data from the area of the polygon.
-		hp.xmin = bounds[i*4+0];
-		hp.ymin = bounds[i*4+2];
-		hp.width = bounds[i*4+1]-bounds[i*4+0];
-		hp.height = bounds[i*4+3]-bounds[i*4+2];
-		getHeightData(ctx, chf, p, npoly, mesh.verts, borderSize, hp, arr, mesh.regs[i]);
+		rcPolyMeshDetailJob job;
+		job.mesh = &mesh;
+		job.chf = &chf;
+		job.bounds = bounds;
+		job.sampleDist = sampleDist;
+		job.sampleMaxError = sampleMaxError;
+		job.heightSearchRadius = heightSearchRadius;
+		job.jobCount = rcMin(mesh.npolys, workerCount*8);
+		job.contexts = contexts;
+		job.scratch = scratch.items;
+		job.results = results;
+		rcDispatchJobs(dispatcher, buildPolyMeshDetailJob, &job, job.jobCount);
 		
-		// Build detail mesh.
-		int nverts = 0;
-		if (!buildPolyDetail(ctx, poly, npoly,
-							 sampleDist, sampleMaxError,
-							 heightSearchRadius, chf, hp,
-							 verts, nverts, tris,
-							 edges, samples))
+		// Prefix sum the sizes of the polygon meshes.
+		for (int i = 0; i < mesh.npolys; ++i)
 		{
-			return false;
+			const rcPolyDetailResult& res = results[i];
+			if (!res.success)
+			{
+				ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Could not build the detail mesh of polygon %d.", i);
+				return false;
+			}
+			dmesh.meshes[i*4+0] = (unsigned int)dmesh.nverts;
+			dmesh.meshes[i*4+1] = (unsigned int)res.nverts;
+			dmesh.meshes[i*4+2] = (unsigned int)dmesh.ntris;
+			dmesh.meshes[i*4+3] = (unsigned int)res.ntris;
+			dmesh.nverts += res.nverts;
+			dmesh.ntris += res.ntris;
 		}
 		
-		// Move detail verts to world space.
-		for (int j = 0; j < nverts; ++j)
+		const int vcap = rcMax(1, dmesh.nverts);
+		if (!dmesh.verts || dmesh.maxverts < vcap)
+		{
+			rcFree(dmesh.verts);
+			dmesh.maxverts = 0;
+			dmesh.verts = (float*)rcAlloc(sizeof(float)*vcap*3, RC_ALLOC_PERM);
+			if (!dmesh.verts)
+			{
+				ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.verts' (%d).", dmesh.nverts*3);
+				return false;
+			}
+			dmesh.maxverts = vcap;
+		}
+		const int tcap = rcMax(1, dmesh.ntris);
+		if (!dmesh.tris || dmesh.maxtris < tcap)
+		{
+			rcFree(dmesh.tris);
+			dmesh.maxtris = 0;
+			dmesh.tris = (unsigned char*)rcAlloc(sizeof(unsigned char)*tcap*4, RC_ALLOC_PERM);
+			if (!dmesh.tris)
+			{
+				ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.tris' (%d).", dmesh.ntris*4);
+				return false;
+			}
+			dmesh.maxtris = tcap;
+		}
+		
+		// Compact the polygon meshes in polygon order.
+		for (int i = 0; i < mesh.npolys; ++i)
+		{
+			const rcPolyDetailResult& res = results[i];
+			const rcDetailScratch& s = scratch.items[res.worker];
+			if (res.nverts)
+				memcpy(&dmesh.verts[dmesh.meshes[i*4+0]*3], &s.outVerts[res.vertBase*3], sizeof(float)*res.nverts*3);
+			if (res.ntris)
+				memcpy(&dmesh.tris[dmesh.meshes[i*4+2]*4], &s.outTris[res.triBase*4], sizeof(unsigned char)*res.ntris*4);
+		}
+		
+		return true;
+	}
+	
+	int vcap = nPolyVerts+nPolyVerts/2;
+	int tcap = vcap*2;
+	
+	if (!dmesh.verts || dmesh.maxverts < vcap)
+	{
+		rcFree(dmesh.verts);
+		dmesh.maxverts = 0;
+		dmesh.verts = (float*)rcAlloc(sizeof(float)*vcap*3, RC_ALLOC_PERM);
+		if (!dmesh.verts)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.verts' (%d).", vcap*3);
+			return false;
+		}
+		dmesh.maxverts = vcap;
+	}
+	vcap = dmesh.maxverts;
+	if (!dmesh.tris || dmesh.maxtris < tcap)
+	{
+		rcFree(dmesh.tris);
+		dmesh.maxtris = 0;
+		dmesh.tris = (unsigned char*)rcAlloc(sizeof(unsigned char)*tcap*4, RC_ALLOC_PERM);
+		if (!dmesh.tris)
 		{
-			verts[j*3+0] += orig[0];
-			verts[j*3+1] += orig[1] + chf.ch; // Is this offset necessary?
-			verts[j*3+2] += orig[2];
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.tris' (%d).", tcap*4);
+			return false;
 		}
-		// Offset poly too, will be used to flag checking.
-		for (int j = 0; j < npoly; ++j)
+		dmesh.maxtris = tcap;
+	}
+	tcap = dmesh.maxtris;
+	
+	rcDetailScratch& s = scratch.items[0];
+	const float* verts = s.verts;
+	rcIntArray& tris = s.tris;
+	
+	for (int i = 0; i < mesh.npolys; ++i)
+	{
+		int nverts = 0;
+		if (!buildPolyDetailMesh(ctx, mesh, chf, bounds, i,
+								 sampleDist, sampleMaxError, heightSearchRadius,
+								 s, nverts))
 		{
-			poly[j*3+0] += orig[0];
-			poly[j*3+1] += orig[1];
-			poly[j*3+2] += orig[2];
+			return false;
 		}
 		
 		// Store detail submesh.
@@ -1358,6 +1920,7 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 				memcpy(newv, dmesh.verts, sizeof(float)*3*dmesh.nverts);
 			rcFree(dmesh.verts);
 			dmesh.verts = newv;
+			dmesh.maxverts = vcap;
 		}
 		for (int j = 0; j < nverts; ++j)
 		{
@@ -1382,6 +1945,7 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 				memcpy(newt, dmesh.tris, sizeof(unsigned char)*4*dmesh.ntris);
 			rcFree(dmesh.tris);
 			dmesh.tris = newt;
+			dmesh.maxtris = tcap;
 		}
 		for (int j = 0; j < ntris; ++j)
 		{
@@ -1397,19 +1961,84 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 	return true;
 }
 
+/// The offsets of a detail mesh in the merged detail mesh.
+struct rcMergeDetailInfo
+{
+	int meshBase;
+	int vertBase;
+	int triBase;
+};
+
+struct rcMergePolyMeshDetailJob
+{
+	rcPolyMeshDetail** meshes;
+	int nmeshes;
+	int jobCount;
+	const rcMergeDetailInfo* info;
+	rcPolyMeshDetail* mesh;
+};
+
+static void copyMergedDetailsJob(void* userData, const int jobIndex, const int)
+{
+	const rcMergePolyMeshDetailJob* job = (const rcMergePolyMeshDetailJob*)userData;
+	rcPolyMeshDetail& mesh = *job->mesh;
+	const int i0 = (int)((long long)job->nmeshes * jobIndex / job->jobCount);
+	const int i1 = (int)((long long)job->nmeshes * (jobIndex + 1) / job->jobCount);
+	for (int i = i0; i < i1; ++i)
+	{
+		const rcPolyMeshDetail* dm = job->meshes[i];
+		if (!dm) continue;
+		const rcMergeDetailInfo& info = job->info[i];
+		for (int j = 0; j < dm->nmeshes; ++j)
+		{
+			unsigned int* dst = &mesh.meshes[(info.meshBase+j)*4];
+			const unsigned int* src = &dm->meshes[j*4];
+			dst[0] = (unsigned int)info.vertBase+src[0];
+			dst[1] = src[1];
+			dst[2] = (unsigned int)info.triBase+src[2];
+			dst[3] = src[3];
+		}
+		if (dm->nverts)
+			memcpy(&mesh.verts[info.vertBase*3], dm->verts, sizeof(float)*dm->nverts*3);
+		if (dm->ntris)
+			memcpy(&mesh.tris[info.triBase*4], dm->tris, sizeof(unsigned char)*dm->ntris*4);
+	}
+}
+
 /// @see rcAllocPolyMeshDetail, rcPolyMeshDetail
 bool rcMergePolyMeshDetails(rcContext* ctx, rcPolyMeshDetail** meshes, const int nmeshes, rcPolyMeshDetail& mesh)
+{
+	return rcMergePolyMeshDetails(ctx, meshes, nmeshes, mesh, 0);
+}
+
+/// @par
+///
+/// The offsets of the meshes are prefix sums of their sizes, so the jobs copy the meshes in place.
+///
+/// @see rcAllocPolyMeshDetail, rcPolyMeshDetail, rcJobDispatcher
+bool rcMergePolyMeshDetails(rcContext* ctx, rcPolyMeshDetail** meshes, const int nmeshes, rcPolyMeshDetail& mesh,
+							rcJobDispatcher* dispatcher)
 {
 	rcAssert(ctx);
 	
 	rcScopedTimer timer(ctx, RC_TIMER_MERGE_POLYMESHDETAIL);
 	
+	rcScopedDelete<rcMergeDetailInfo> info((rcMergeDetailInfo*)rcAlloc(sizeof(rcMergeDetailInfo)*rcMax(1, nmeshes), RC_ALLOC_TEMP));
+	if (!info)
+	{
+		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshDetails: Out of memory 'info' (%d).", nmeshes);
+		return false;
+	}
+	
 	int maxVerts = 0;
 	int maxTris = 0;
 	int maxMeshes = 0;
 	
 	for (int i = 0; i < nmeshes; ++i)
 	{
+		info[i].meshBase = maxMeshes;
+		info[i].vertBase = maxVerts;
+		info[i].triBase = maxTris;
 		if (!meshes[i]) continue;
 		maxVerts += meshes[i]->nverts;
 		maxTris += meshes[i]->ntris;
@@ -1440,36 +2069,24 @@ bool rcMergePolyMeshDetails(rcContext* ctx, rcPolyMeshDetail** meshes, const int
 		return false;
 	}
 	
-	// Merge datas.
-	for (int i = 0; i < nmeshes; ++i)
-	{
-		rcPolyMeshDetail* dm = meshes[i];
-		if (!dm) continue;
-		for (int j = 0; j < dm->nmeshes; ++j)
-		{
-			unsigned int* dst = &mesh.meshes[mesh.nmeshes*4];
-			unsigned int* src = &dm->meshes[j*4];
-			dst[0] = (unsigned int)mesh.nverts+src[0];
-			dst[1] = src[1];
-			dst[2] = (unsigned int)mesh.ntris+src[2];
-			dst[3] = src[3];
-			mesh.nmeshes++;
-		}
-		
-		for (int k = 0; k < dm->nverts; ++k)
-		{
-			rcVcopy(&mesh.verts[mesh.nverts*3], &dm->verts[k*3]);
-			mesh.nverts++;
-		}
-		for (int k = 0; k < dm->ntris; ++k)
-		{
-			mesh.tris[mesh.ntris*4+0] = dm->tris[k*4+0];
-			mesh.tris[mesh.ntris*4+1] = dm->tris[k*4+1];
-			mesh.tris[mesh.ntris*4+2] = dm->tris[k*4+2];
-			mesh.tris[mesh.ntris*4+3] = dm->tris[k*4+3];
-			mesh.ntris++;
-		}
-	}
+	mesh.maxmeshes = maxMeshes;
+	mesh.maxverts = maxVerts;
+	mesh.maxtris = maxTris;
+	
+	mesh.nmeshes = maxMeshes;
+	mesh.nverts = maxVerts;
+	mesh.ntris = maxTris;
+	
+	rcMergePolyMeshDetailJob job;
+	job.meshes = meshes;
+	job.nmeshes = nmeshes;
+	job.jobCount = dispatcher ? rcMax(1, rcMin(nmeshes, rcMax(1, dispatcher->getWorkerCount())*8)) : 1;
+	job.info = info;
+	job.mesh = &mesh;
+	if (dispatcher)
+		rcDispatchJobs(dispatcher, copyMergedDetailsJob, &job, job.jobCount);
+	else
+		copyMergedDetailsJob(&job, 0, 0);
 	
 	return true;
 }
@@ -0,0 +1,679 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#include <string.h>
+#include "RecastMeshIndex.h"
+#include "RecastAlloc.h"
+#include "RecastAssert.h"
+
+// Define RC_NO_SIMD to test the triangles of a chunk one at a time on all platforms.
+#if defined(RC_NO_SIMD)
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RC_MESHINDEX_SIMD
+#define RC_MESHINDEX_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define RC_MESHINDEX_SIMD
+#define RC_MESHINDEX_NEON
+#endif
+
+/// The bounds of an input triangle while the tree is built.
+struct rcTriMeshIndexItem
+{
+	float bmin[3];
+	float bmax[3];
+	int i;
+};
+
+/// A subtree built by a job.
+struct rcTriMeshIndexTask
+{
+	int imin;
+	int imax;
+	int node;
+};
+
+/// The shared state of a tree build.
+struct rcTriMeshIndexBuild
+{
+	const float* verts;
+	int nverts;
+	const int* inTris;
+	int ntris;
+	int trisPerChunk;
+	rcTriMeshIndexItem* items;
+	rcTriMeshIndex* index;
+
+	// Item bounds jobs.
+	int bandCount;
+	bool* bandValid;
+
+	// Subtree jobs.
+	rcTriMeshIndexTask* tasks;
+	int ntasks;
+	int maxTasks;
+};
+
+rcTriMeshIndex::rcTriMeshIndex()
+: nodes()
+, nnodes()
+, tris()
+, triIds()
+, ntris()
+, nchunks()
+, maxTrisPerChunk()
+{
+}
+
+rcTriMeshIndex::~rcTriMeshIndex()
+{
+	rcFree(nodes);
+	rcFree(tris);
+	rcFree(triIds);
+}
+
+rcTriMeshIndex* rcAllocTriMeshIndex()
+{
+	void* mem = rcAlloc(sizeof(rcTriMeshIndex), RC_ALLOC_PERM);
+	if (!mem)
+		return 0;
+	return ::new(rcNewTag(), mem) rcTriMeshIndex();
+}
+
+void rcFreeTriMeshIndex(rcTriMeshIndex* index)
+{
+	if (!index)
+		return;
+	index->~rcTriMeshIndex();
+	rcFree(index);
+}
+
+/// Returns the number of nodes of the subtree over @p n triangles.
+/// The split is always at the median, so the shape of the tree only depends on the triangle count.
+static int countNodes(const int n, const int trisPerChunk)
+{
+	if (n <= trisPerChunk)
+		return 1;
+	return 1 + countNodes(n / 2, trisPerChunk) + countNodes(n - n / 2, trisPerChunk);
+}
+
+/// Calculates the bounds of the triangles [@p first, @p last), returns false if a vertex index is out of range.
+static bool calcItemBounds(const rcTriMeshIndexBuild& build, const int first, const int last)
+{
+	for (int i = first; i < last; ++i)
+	{
+		const int* t = &build.inTris[i * 3];
+		rcTriMeshIndexItem& it = build.items[i];
+		it.i = i;
+		for (int j = 0; j < 3; ++j)
+		{
+			if (t[j] < 0 || t[j] >= build.nverts)
+				return false;
+		}
+		rcVcopy(it.bmin, &build.verts[t[0] * 3]);
+		rcVcopy(it.bmax, &build.verts[t[0] * 3]);
+		rcVmin(it.bmin, &build.verts[t[1] * 3]);
+		rcVmax(it.bmax, &build.verts[t[1] * 3]);
+		rcVmin(it.bmin, &build.verts[t[2] * 3]);
+		rcVmax(it.bmax, &build.verts[t[2] * 3]);
+	}
+	return true;
+}
+
+static void calcItemBoundsJob(void* userData, const int jobIndex, const int /*workerIndex*/)
+{
+	const rcTriMeshIndexBuild* build = (const rcTriMeshIndexBuild*)userData;
+	const int first = (int)((long long)build->ntris * jobIndex / build->bandCount);
+	const int last = (int)((long long)build->ntris * (jobIndex + 1) / build->bandCount);
+	build->bandValid[jobIndex] = calcItemBounds(*build, first, last);
+}
+
+static void calcExtents(const rcTriMeshIndexItem* items, const int imin, const int imax, float* bmin, float* bmax)
+{
+	rcVcopy(bmin, items[imin].bmin);
+	rcVcopy(bmax, items[imin].bmax);
+	for (int i = imin + 1; i < imax; ++i)
+	{
+		rcVmin(bmin, items[i].bmin);
+		rcVmax(bmax, items[i].bmax);
+	}
+}
+
+/// Returns twice the center of the item along the axis, which orders the items the same as the center.
+static inline float itemCenter(const rcTriMeshIndexItem& it, const int axis)
+{
+	return it.bmin[axis] + it.bmax[axis];
+}
+
+/// Partially sorts the items [@p imin, @p imax) by their centers along the axis, so that the
+/// items before @p k are not above the item at @p k, and the items after it are not below it.
+static void selectMedian(rcTriMeshIndexItem* items, int imin, int imax, const int k, const int axis)
+{
+	int lo = imin;
+	int hi = imax - 1;
+	while (lo < hi)
+	{
+		// Median of three pivot.
+		const int mid = lo + (hi - lo) / 2;
+		float a = itemCenter(items[lo], axis);
+		float b = itemCenter(items[mid], axis);
+		const float c = itemCenter(items[hi], axis);
+		if (a > b) { const float tmp = a; a = b; b = tmp; }
+		const float pivot = c < a ? a : (c > b ? b : c);
+
+		int i = lo;
+		int j = hi;
+		while (i <= j)
+		{
+			while (itemCenter(items[i], axis) < pivot)
+				i++;
+			while (itemCenter(items[j], axis) > pivot)
+				j--;
+			if (i <= j)
+			{
+				rcSwap(items[i], items[j]);
+				i++;
+				j--;
+			}
+		}
+		if (k <= j)
+			hi = j;
+		else if (k >= i)
+			lo = i;
+		else
+			break;
+	}
+}
+
+/// Builds the subtree over the items [@p imin, @p imax) at node @p inode. Subtrees at
+/// @p depth zero are recorded as tasks instead, a negative depth builds the whole subtree.
+static void subdivide(rcTriMeshIndexBuild& build, const int imin, const int imax, const int inode, const int depth)
+{
+	rcTriMeshIndex& index = *build.index;
+	const int inum = imax - imin;
+	rcTriMeshIndexNode& node = index.nodes[inode];
+	calcExtents(build.items, imin, imax, node.bmin, node.bmax);
+
+	if (inum <= build.trisPerChunk)
+	{
+		// Leaf, the triangles are stored in item order.
+		node.i = imin;
+		node.n = inum;
+		for (int i = imin; i < imax; ++i)
+		{
+			const int src = build.items[i].i;
+			index.tris[i * 3 + 0] = build.inTris[src * 3 + 0];
+			index.tris[i * 3 + 1] = build.inTris[src * 3 + 1];
+			index.tris[i * 3 + 2] = build.inTris[src * 3 + 2];
+			index.triIds[i] = src;
+		}
+		return;
+	}
+
+	node.i = -countNodes(inum, build.trisPerChunk);
+	node.n = 0;
+
+	if (depth == 0)
+	{
+		rcAssert(build.ntasks < build.maxTasks);
+		rcTriMeshIndexTask& task = build.tasks[build.ntasks++];
+		task.imin = imin;
+		task.imax = imax;
+		task.node = inode;
+		return;
+	}
+
+	// Split at the median along the longest axis.
+	const float dx = node.bmax[0] - node.bmin[0];
+	const float dy = node.bmax[1] - node.bmin[1];
+	const float dz = node.bmax[2] - node.bmin[2];
+	int axis = 0;
+	if (dy > dx)
+		axis = 1;
+	if (dz > (axis == 0 ? dx : dy))
+		axis = 2;
+
+	const int isplit = imin + inum / 2;
+	selectMedian(build.items, imin, imax, isplit, axis);
+
+	const int childDepth = depth > 0 ? depth - 1 : depth;
+	subdivide(build, imin, isplit, inode + 1, childDepth);
+	subdivide(build, isplit, imax, inode + 1 + countNodes(isplit - imin, build.trisPerChunk), childDepth);
+}
+
+static void subdivideJob(void* userData, const int jobIndex, const int /*workerIndex*/)
+{
+	rcTriMeshIndexBuild* build = (rcTriMeshIndexBuild*)userData;
+	const rcTriMeshIndexTask& task = build->tasks[jobIndex];
+
+	// Rebuilds the root of the subtree, which was only bounded when the task was recorded.
+	subdivide(*build, task.imin, task.imax, task.node, -1);
+}
+
+bool rcBuildTriMeshIndex(rcContext* context, const float* verts, const int nverts, const int* tris, const int ntris,
+						 const int trisPerChunk, rcTriMeshIndex& index, rcJobDispatcher* dispatcher)
+{
+	rcAssert(context);
+
+	rcFree(index.nodes);
+	rcFree(index.tris);
+	rcFree(index.triIds);
+	index.nodes = 0;
+	index.tris = 0;
+	index.triIds = 0;
+	index.nnodes = 0;
+	index.ntris = 0;
+	index.nchunks = 0;
+	index.maxTrisPerChunk = 0;
+
+	if (trisPerChunk <= 0 || ntris < 0)
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTriMeshIndex: Invalid chunk size %d or triangle count %d.", trisPerChunk, ntris);
+		return false;
+	}
+	if (ntris == 0)
+		return true;
+
+	const int nnodes = countNodes(ntris, trisPerChunk);
+	index.nodes = (rcTriMeshIndexNode*)rcAlloc(sizeof(rcTriMeshIndexNode) * nnodes, RC_ALLOC_PERM);
+	index.tris = (int*)rcAlloc(sizeof(int) * ntris * 3, RC_ALLOC_PERM);
+	index.triIds = (int*)rcAlloc(sizeof(int) * ntris, RC_ALLOC_PERM);
+	rcScopedDelete<rcTriMeshIndexItem> items((rcTriMeshIndexItem*)rcAlloc(sizeof(rcTriMeshIndexItem) * ntris, RC_ALLOC_TEMP));
+	if (!index.nodes || !index.tris || !index.triIds || !items)
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTriMeshIndex: Out of memory for %d triangles.", ntris);
+		return false;
+	}
+
+	rcTriMeshIndexBuild build;
+	memset(&build, 0, sizeof(build));
+	build.verts = verts;
+	build.nverts = nverts;
+	build.inTris = tris;
+	build.ntris = ntris;
+	build.trisPerChunk = trisPerChunk;
+	build.items = items;
+	build.index = &index;
+
+	// Subtrees of a few chunks per worker below the top levels, which are split serially.
+	int depth = -1;
+	if (dispatcher)
+	{
+		const int targetTasks = dispatcher->getWorkerCount() * 4;
+		depth = 0;
+		while (depth < 10 && (1 << depth) < targetTasks)
+			depth++;
+	}
+
+	bool valid = true;
+	if (dispatcher)
+	{
+		build.bandCount = rcMax(1, rcMin(ntris / 1024, dispatcher->getWorkerCount() * 4));
+		rcScopedDelete<bool> bandValid((bool*)rcAlloc(sizeof(bool) * build.bandCount, RC_ALLOC_TEMP));
+		if (!bandValid)
+		{
+			context->log(RC_LOG_ERROR, "rcBuildTriMeshIndex: Out of memory 'bandValid' (%d).", build.bandCount);
+			return false;
+		}
+		build.bandValid = bandValid;
+		rcDispatchJobs(dispatcher, calcItemBoundsJob, &build, build.bandCount);
+		for (int i = 0; i < build.bandCount; ++i)
+			valid &= build.bandValid[i];
+		build.bandValid = 0;
+	}
+	else
+	{
+		valid = calcItemBounds(build, 0, ntris);
+	}
+	if (!valid)
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTriMeshIndex: Vertex index out of range (%d vertices).", nverts);
+		return false;
+	}
+
+	if (depth > 0)
+	{
+		build.maxTasks = 1 << depth;
+		build.tasks = (rcTriMeshIndexTask*)rcAlloc(sizeof(rcTriMeshIndexTask) * build.maxTasks, RC_ALLOC_TEMP);
+		if (!build.tasks)
+		{
+			context->log(RC_LOG_ERROR, "rcBuildTriMeshIndex: Out of memory 'tasks' (%d).", build.maxTasks);
+			return false;
+		}
+	}
+	rcScopedDelete<rcTriMeshIndexTask> ownedTasks(build.tasks);
+
+	subdivide(build, 0, ntris, 0, depth > 0 ? depth : -1);
+	if (build.ntasks > 0)
+		rcDispatchJobs(dispatcher, subdivideJob, &build, build.ntasks);
+
+	index.nnodes = nnodes;
+	index.ntris = ntris;
+	for (int i = 0; i < nnodes; ++i)
+	{
+		const rcTriMeshIndexNode& node = index.nodes[i];
+		if (node.i < 0)
+			continue;
+		index.nchunks++;
+		index.maxTrisPerChunk = rcMax(index.maxTrisPerChunk, node.n);
+	}
+
+	return true;
+}
+
+static inline bool overlapRect(const float* amin, const float* amax, const float* bmin, const float* bmax)
+{
+	return amin[0] <= bmax[0] && amax[0] >= bmin[0] &&
+		amin[1] <= bmax[2] && amax[1] >= bmin[2];
+}
+
+static inline bool overlapBox(const float* amin, const float* amax, const float* bmin, const float* bmax)
+{
+	return amin[0] <= bmax[0] && amax[0] >= bmin[0] &&
+		amin[1] <= bmax[1] && amax[1] >= bmin[1] &&
+		amin[2] <= bmax[2] && amax[2] >= bmin[2];
+}
+
+/// Returns true if the segment from @p p along @p d crosses the box between the parametric distances 0 and @p tmax.
+static bool overlapSegment(const float* p, const float* d, const float* bmin, const float* bmax, const float tmax)
+{
+	static const float EPSILON = 1e-6f;
+
+	float t0 = 0.0f;
+	float t1 = tmax;
+	for (int i = 0; i < 3; i++)
+	{
+		if (rcAbs(d[i]) < EPSILON)
+		{
+			// Parallel to the slab, no hit if the origin is not within the slab.
+			if (p[i] < bmin[i] || p[i] > bmax[i])
+				return false;
+		}
+		else
+		{
+			const float ood = 1.0f / d[i];
+			float tnear = (bmin[i] - p[i]) * ood;
+			float tfar = (bmax[i] - p[i]) * ood;
+			if (tnear > tfar)
+				rcSwap(tnear, tfar);
+			if (tnear > t0)
+				t0 = tnear;
+			if (tfar < t1)
+				t1 = tfar;
+			if (t0 > t1)
+				return false;
+		}
+	}
+	return true;
+}
+
+int rcGetTriMeshChunksOverlappingRect(const rcTriMeshIndex& index, const float* bmin, const float* bmax,
+									  int* ids, const int maxIds)
+{
+	int i = 0;
+	int n = 0;
+	while (i < index.nnodes)
+	{
+		const rcTriMeshIndexNode& node = index.nodes[i];
+		const bool overlap = overlapRect(bmin, bmax, node.bmin, node.bmax);
+		const bool isLeaf = node.i >= 0;
+		if (isLeaf && overlap && n < maxIds)
+			ids[n++] = i;
+		i += (overlap || isLeaf) ? 1 : -node.i;
+	}
+	return n;
+}
+
+int rcGetTriMeshChunksOverlappingBox(const rcTriMeshIndex& index, const float* bmin, const float* bmax,
+									 int* ids, const int maxIds)
+{
+	int i = 0;
+	int n = 0;
+	while (i < index.nnodes)
+	{
+		const rcTriMeshIndexNode& node = index.nodes[i];
+		const bool overlap = overlapBox(bmin, bmax, node.bmin, node.bmax);
+		const bool isLeaf = node.i >= 0;
+		if (isLeaf && overlap && n < maxIds)
+			ids[n++] = i;
+		i += (overlap || isLeaf) ? 1 : -node.i;
+	}
+	return n;
+}
+
+int rcGetTriMeshChunksOverlappingSegment(const rcTriMeshIndex& index, const float* p, const float* q,
+										 int* ids, const int maxIds)
+{
+	float d[3];
+	rcVsub(d, q, p);
+
+	int i = 0;
+	int n = 0;
+	while (i < index.nnodes)
+	{
+		const rcTriMeshIndexNode& node = index.nodes[i];
+		const bool overlap = overlapSegment(p, d, node.bmin, node.bmax, 1.0f);
+		const bool isLeaf = node.i >= 0;
+		if (isLeaf && overlap && n < maxIds)
+			ids[n++] = i;
+		i += (overlap || isLeaf) ? 1 : -node.i;
+	}
+	return n;
+}
+
+/// Tests the segment against a triangle, hitting it only from the front.
+///  @param[in]		sp		The start of the segment.
+///  @param[in]		qp		The start of the segment minus its end.
+///  @param[out]	t		The parametric distance of the hit along the segment.
+static bool intersectSegmentTriangle(const float* sp, const float* qp,
+									 const float* a, const float* b, const float* c, float& t)
+{
+	float ab[3], ac[3], ap[3], norm[3], e[3];
+	rcVsub(ab, b, a);
+	rcVsub(ac, c, a);
+
+	// The segment is parallel to or points away from the triangle if d <= 0.
+	rcVcross(norm, ab, ac);
+	const float d = rcVdot(qp, norm);
+	if (d <= 0.0f) return false;
+
+	// The plane is crossed within the segment if 0 <= t <= d, the division is delayed until the triangle is hit.
+	rcVsub(ap, sp, a);
+	t = rcVdot(ap, norm);
+	if (t < 0.0f) return false;
+	if (t > d) return false;
+
+	// Barycentric coordinates.
+	rcVcross(e, qp, ap);
+	const float v = rcVdot(ac, e);
+	if (v < 0.0f || v > d) return false;
+	const float w = -rcVdot(ab, e);
+	if (w < 0.0f || v + w > d) return false;
+
+	t /= d;
+	return true;
+}
+
+#if defined(RC_MESHINDEX_SIMD)
+
+// Four triangles are tested at a time, one per lane, with the same operations in the
+// same order as intersectSegmentTriangle, so that the hits and distances are the same.
+#if defined(RC_MESHINDEX_SSE2)
+typedef __m128 rcVec4;
+typedef __m128 rcMask4;
+static inline rcVec4 rcVec4Load(const float* v) { return _mm_loadu_ps(v); }
+static inline rcVec4 rcVec4Set1(const float s) { return _mm_set1_ps(s); }
+static inline void rcVec4Store(float* dst, const rcVec4 v) { _mm_storeu_ps(dst, v); }
+static inline rcVec4 rcVec4Add(const rcVec4 a, const rcVec4 b) { return _mm_add_ps(a, b); }
+static inline rcVec4 rcVec4Sub(const rcVec4 a, const rcVec4 b) { return _mm_sub_ps(a, b); }
+static inline rcVec4 rcVec4Mul(const rcVec4 a, const rcVec4 b) { return _mm_mul_ps(a, b); }
+static inline rcVec4 rcVec4Div(const rcVec4 a, const rcVec4 b) { return _mm_div_ps(a, b); }
+static inline rcVec4 rcVec4Neg(const rcVec4 a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+static inline rcMask4 rcVec4Lt(const rcVec4 a, const rcVec4 b) { return _mm_cmplt_ps(a, b); }
+static inline rcMask4 rcVec4Gt(const rcVec4 a, const rcVec4 b) { return _mm_cmpgt_ps(a, b); }
+static inline rcMask4 rcVec4Le(const rcVec4 a, const rcVec4 b) { return _mm_cmple_ps(a, b); }
+static inline rcMask4 rcMask4Or(const rcMask4 a, const rcMask4 b) { return _mm_or_ps(a, b); }
+static inline int rcMask4Bits(const rcMask4 m) { return _mm_movemask_ps(m); }
+#elif defined(RC_MESHINDEX_NEON)
+typedef float32x4_t rcVec4;
+typedef uint32x4_t rcMask4;
+static inline rcVec4 rcVec4Load(const float* v) { return vld1q_f32(v); }
+static inline rcVec4 rcVec4Set1(const float s) { return vdupq_n_f32(s); }
+static inline void rcVec4Store(float* dst, const rcVec4 v) { vst1q_f32(dst, v); }
+static inline rcVec4 rcVec4Add(const rcVec4 a, const rcVec4 b) { return vaddq_f32(a, b); }
+static inline rcVec4 rcVec4Sub(const rcVec4 a, const rcVec4 b) { return vsubq_f32(a, b); }
+static inline rcVec4 rcVec4Mul(const rcVec4 a, const rcVec4 b) { return vmulq_f32(a, b); }
+static inline rcVec4 rcVec4Div(const rcVec4 a, const rcVec4 b) { return vdivq_f32(a, b); }
+static inline rcVec4 rcVec4Neg(const rcVec4 a) { return vnegq_f32(a); }
+static inline rcMask4 rcVec4Lt(const rcVec4 a, const rcVec4 b) { return vcltq_f32(a, b); }
+static inline rcMask4 rcVec4Gt(const rcVec4 a, const rcVec4 b) { return vcgtq_f32(a, b); }
+static inline rcMask4 rcVec4Le(const rcVec4 a, const rcVec4 b) { return vcleq_f32(a, b); }
+static inline rcMask4 rcMask4Or(const rcMask4 a, const rcMask4 b) { return vorrq_u32(a, b); }
+static inline int rcMask4Bits(const rcMask4 m)
+{
+	return (int)((vgetq_lane_u32(m, 0) & 1) | (vgetq_lane_u32(m, 1) & 2) |
+				 (vgetq_lane_u32(m, 2) & 4) | (vgetq_lane_u32(m, 3) & 8));
+}
+#endif
+
+static inline rcVec4 rcVec4Dot(const rcVec4 ax, const rcVec4 ay, const rcVec4 az,
+							   const rcVec4 bx, const rcVec4 by, const rcVec4 bz)
+{
+	return rcVec4Add(rcVec4Add(rcVec4Mul(ax, bx), rcVec4Mul(ay, by)), rcVec4Mul(az, bz));
+}
+
+/// Tests the segment against four triangles, see intersectSegmentTriangle.
+///  @param[in]		tv		The vertices of the triangles by component. [(ax, ay, az, bx, by, bz, cx, cy, cz) * 4]
+///  @param[out]	t		The parametric distances of the hits. [Size: 4]
+///  @returns A bit mask of the triangles that were hit.
+static int intersectSegmentTriangles4(const float* sp, const float* qp, const float* tv, float* t)
+{
+	const rcVec4 ax = rcVec4Load(&tv[0 * 4]);
+	const rcVec4 ay = rcVec4Load(&tv[1 * 4]);
+	const rcVec4 az = rcVec4Load(&tv[2 * 4]);
+	const rcVec4 abx = rcVec4Sub(rcVec4Load(&tv[3 * 4]), ax);
+	const rcVec4 aby = rcVec4Sub(rcVec4Load(&tv[4 * 4]), ay);
+	const rcVec4 abz = rcVec4Sub(rcVec4Load(&tv[5 * 4]), az);
+	const rcVec4 acx = rcVec4Sub(rcVec4Load(&tv[6 * 4]), ax);
+	const rcVec4 acy = rcVec4Sub(rcVec4Load(&tv[7 * 4]), ay);
+	const rcVec4 acz = rcVec4Sub(rcVec4Load(&tv[8 * 4]), az);
+
+	const rcVec4 nx = rcVec4Sub(rcVec4Mul(aby, acz), rcVec4Mul(abz, acy));
+	const rcVec4 ny = rcVec4Sub(rcVec4Mul(abz, acx), rcVec4Mul(abx, acz));
+	const rcVec4 nz = rcVec4Sub(rcVec4Mul(abx, acy), rcVec4Mul(aby, acx));
+
+	const rcVec4 qpx = rcVec4Set1(qp[0]);
+	const rcVec4 qpy = rcVec4Set1(qp[1]);
+	const rcVec4 qpz = rcVec4Set1(qp[2]);
+	const rcVec4 d = rcVec4Dot(qpx, qpy, qpz, nx, ny, nz);
+
+	const rcVec4 apx = rcVec4Sub(rcVec4Set1(sp[0]), ax);
+	const rcVec4 apy = rcVec4Sub(rcVec4Set1(sp[1]), ay);
+	const rcVec4 apz = rcVec4Sub(rcVec4Set1(sp[2]), az);
+	const rcVec4 tt = rcVec4Dot(apx, apy, apz, nx, ny, nz);
+
+	const rcVec4 ex = rcVec4Sub(rcVec4Mul(qpy, apz), rcVec4Mul(qpz, apy));
+	const rcVec4 ey = rcVec4Sub(rcVec4Mul(qpz, apx), rcVec4Mul(qpx, apz));
+	const rcVec4 ez = rcVec4Sub(rcVec4Mul(qpx, apy), rcVec4Mul(qpy, apx));
+	const rcVec4 v = rcVec4Dot(acx, acy, acz, ex, ey, ez);
+	const rcVec4 w = rcVec4Neg(rcVec4Dot(abx, aby, abz, ex, ey, ez));
+
+	// The rejections of intersectSegmentTriangle, which treat NaNs the same way.
+	const rcVec4 zero = rcVec4Set1(0.0f);
+	rcMask4 reject = rcVec4Le(d, zero);
+	reject = rcMask4Or(reject, rcVec4Lt(tt, zero));
+	reject = rcMask4Or(reject, rcVec4Gt(tt, d));
+	reject = rcMask4Or(reject, rcVec4Lt(v, zero));
+	reject = rcMask4Or(reject, rcVec4Gt(v, d));
+	reject = rcMask4Or(reject, rcVec4Lt(w, zero));
+	reject = rcMask4Or(reject, rcVec4Gt(rcVec4Add(v, w), d));
+
+	rcVec4Store(t, rcVec4Div(tt, d));
+	return ~rcMask4Bits(reject) & 0xf;
+}
+
+#endif // RC_MESHINDEX_SIMD
+
+bool rcRaycastTriMeshIndex(const rcTriMeshIndex& index, const float* verts, const float* sp, const float* sq,
+						   float& tmin)
+{
+	float d[3], qp[3];
+	rcVsub(d, sq, sp);
+	rcVsub(qp, sp, sq);
+
+	float best = 1.0f;
+	bool hit = false;
+	int i = 0;
+	while (i < index.nnodes)
+	{
+		const rcTriMeshIndexNode& node = index.nodes[i];
+		// Nodes beyond the closest hit so far are skipped.
+		const bool overlap = overlapSegment(sp, d, node.bmin, node.bmax, best);
+		const bool isLeaf = node.i >= 0;
+		if (isLeaf && overlap)
+		{
+			const int* tris = &index.tris[node.i * 3];
+			int j = 0;
+#if defined(RC_MESHINDEX_SIMD)
+			for (; j + 4 <= node.n; j += 4)
+			{
+				float tv[9 * 4];
+				for (int k = 0; k < 4; ++k)
+				{
+					const int* t = &tris[(j + k) * 3];
+					for (int c = 0; c < 3; ++c)
+					{
+						const float* v = &verts[t[c] * 3];
+						tv[(c * 3 + 0) * 4 + k] = v[0];
+						tv[(c * 3 + 1) * 4 + k] = v[1];
+						tv[(c * 3 + 2) * 4 + k] = v[2];
+					}
+				}
+				float t[4];
+				const int mask = intersectSegmentTriangles4(sp, qp, tv, t);
+				if (!mask)
+					continue;
+				for (int k = 0; k < 4; ++k)
+				{
+					if ((mask & (1 << k)) && t[k] < best)
+						best = t[k];
+				}
+				hit = true;
+			}
+#endif
+			for (; j < node.n; ++j)
+			{
+				const int* t = &tris[j * 3];
+				float th = 1.0f;
+				if (intersectSegmentTriangle(sp, qp, &verts[t[0] * 3], &verts[t[1] * 3], &verts[t[2] * 3], th))
+				{
+					if (th < best)
+						best = th;
+					hit = true;
+				}
+			}
+		}
+		i += (overlap || isLeaf) ? 1 : -node.i;
+	}
+
+	if (hit)
+		tmin = best;
+	return hit;
+}
@@ -0,0 +1,349 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#include "RecastProfiler.h"
+#include "Recast.h"
+#include "RecastAlloc.h"
+#include "RecastAssert.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#	define WIN32_LEAN_AND_MEAN
+#	include <windows.h>
+#else
+#	include <time.h>
+#	include <sys/time.h>
+#endif
+
+namespace
+{
+/// The profiling context with open scopes on the calling thread.
+RC_THREAD_LOCAL rcProfilingContext* s_currentContext = 0;
+
+/// The allocator wrapped by the tracking allocator.
+rcAllocFunc* s_trackedAllocFunc = 0;
+rcFreeFunc* s_trackedFreeFunc = 0;
+
+void* allocDefault(size_t size, rcAllocHint)
+{
+	return malloc(size);
+}
+
+void freeDefault(void* ptr)
+{
+	free(ptr);
+}
+
+void freeTracked(void* ptr)
+{
+	s_trackedFreeFunc(ptr);
+}
+
+/// Returns the current time in microseconds.
+int64_t getTimeUsec()
+{
+#ifdef _WIN32
+	static LARGE_INTEGER freq = { 0 };
+	if (freq.QuadPart == 0)
+		QueryPerformanceFrequency(&freq);
+	LARGE_INTEGER count;
+	QueryPerformanceCounter(&count);
+	return (int64_t)(count.QuadPart / freq.QuadPart) * 1000000 +
+		(int64_t)(count.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+#else
+	timeval now;
+	gettimeofday(&now, 0);
+	return (int64_t)now.tv_sec * 1000000 + now.tv_usec;
+#endif
+}
+
+/// Appends formatted text to a buffer, keeping track of the full length of the output.
+struct rcTraceWriter
+{
+	char* buffer;
+	int size;
+	int length;
+
+	void write(const char* format, ...)
+	{
+		const int avail = length < size ? size - length : 0;
+		va_list args;
+		va_start(args, format);
+		const int n = vsnprintf(avail > 0 ? buffer + length : 0, (size_t)avail, format, args);
+		va_end(args);
+		if (n > 0)
+			length += n;
+	}
+};
+}
+
+rcProfilingContext::rcProfilingContext(bool state) :
+	rcContext(state),
+	m_events(0),
+	m_maxEvents(0),
+	m_eventCount(0),
+	m_droppedEventCount(0),
+	m_threadId(0),
+	m_depth(0),
+	m_prevCurrent(0)
+{
+	memset(m_stages, 0, sizeof(m_stages));
+}
+
+rcProfilingContext::~rcProfilingContext()
+{
+	if (s_currentContext == this)
+		s_currentContext = m_prevCurrent;
+	rcFree(m_events);
+}
+
+bool rcProfilingContext::init(const int maxEvents, const int threadId)
+{
+	rcAssert(maxEvents >= 0);
+	rcFree(m_events);
+	m_events = 0;
+	m_maxEvents = 0;
+	if (maxEvents > 0)
+	{
+		m_events = (rcProfileEvent*)rcAlloc(sizeof(rcProfileEvent) * maxEvents, RC_ALLOC_PERM);
+		if (!m_events)
+			return false;
+		m_maxEvents = maxEvents;
+	}
+	m_threadId = threadId;
+	doResetTimers();
+	return true;
+}
+
+void rcProfilingContext::doResetTimers()
+{
+	if (m_depth > 0 && s_currentContext == this)
+		s_currentContext = m_prevCurrent;
+	m_depth = 0;
+	m_prevCurrent = 0;
+	m_eventCount = 0;
+	m_droppedEventCount = 0;
+	memset(m_stages, 0, sizeof(m_stages));
+}
+
+void rcProfilingContext::doStartTimer(const rcTimerLabel label)
+{
+	if (m_depth >= MAX_DEPTH)
+	{
+		// Too deeply nested, keep counting the calls but drop the timing.
+		m_stages[label].calls++;
+		m_droppedEventCount++;
+		return;
+	}
+
+	if (m_depth == 0)
+	{
+		m_prevCurrent = s_currentContext;
+		s_currentContext = this;
+	}
+
+	OpenScope& scope = m_stack[m_depth];
+	scope.label = label;
+	scope.allocatedBytes = 0;
+	scope.allocationCount = 0;
+	scope.event = -1;
+	if (m_eventCount < m_maxEvents)
+	{
+		scope.event = m_eventCount++;
+		rcProfileEvent& event = m_events[scope.event];
+		event.label = label;
+		event.depth = m_depth;
+		event.duration = 0;
+		event.allocatedBytes = 0;
+	}
+	else
+	{
+		m_droppedEventCount++;
+	}
+	m_depth++;
+
+	// Read the clock last so that the bookkeeping above is not part of the scope.
+	scope.start = getTimeUsec();
+	if (scope.event >= 0)
+		m_events[scope.event].start = scope.start;
+}
+
+void rcProfilingContext::doStopTimer(const rcTimerLabel label)
+{
+	const int64_t now = getTimeUsec();
+
+	// Find the innermost open scope of the label. Scopes opened inside it which
+	// were not stopped are closed along with it.
+	int i = m_depth - 1;
+	while (i >= 0 && m_stack[i].label != label)
+		i--;
+	if (i < 0)
+		return;
+
+	while (m_depth > i)
+	{
+		m_depth--;
+		const OpenScope& scope = m_stack[m_depth];
+		const int64_t duration = now - scope.start;
+
+		rcProfileStageStats& stage = m_stages[scope.label];
+		stage.calls++;
+		stage.time += duration;
+		stage.allocatedBytes += scope.allocatedBytes;
+		stage.allocationCount += scope.allocationCount;
+
+		if (scope.event >= 0)
+		{
+			m_events[scope.event].duration = duration;
+			m_events[scope.event].allocatedBytes = scope.allocatedBytes;
+		}
+
+		// The allocations of a nested scope are part of the enclosing scope.
+		if (m_depth > 0)
+		{
+			m_stack[m_depth - 1].allocatedBytes += scope.allocatedBytes;
+			m_stack[m_depth - 1].allocationCount += scope.allocationCount;
+		}
+	}
+
+	if (m_depth == 0 && s_currentContext == this)
+		s_currentContext = m_prevCurrent;
+}
+
+int rcProfilingContext::doGetAccumulatedTime(const rcTimerLabel label) const
+{
+	const rcProfileStageStats& stage = m_stages[label];
+	return stage.calls > 0 ? (int)stage.time : -1;
+}
+
+const char* rcProfilingContext::getLabelName(const rcTimerLabel label)
+{
+	static const char* names[RC_MAX_TIMERS] =
+	{
+		"Total",
+		"Temp",
+		"Rasterize",
+		"Build Compact",
+		"Build Contours",
+		"Build Contours Trace",
+		"Build Contours Simplify",
+		"Filter Border",
+		"Filter Walkable",
+		"Median Area",
+		"Filter Low Obstacles",
+		"Build Polymesh",
+		"Merge Polymeshes",
+		"Erode Area",
+		"Mark Box Area",
+		"Mark Cylinder Area",
+		"Mark Convex Area",
+		"Build Distance Field",
+		"Build Distance Field Dist",
+		"Build Distance Field Blur",
+		"Build Regions",
+		"Build Regions Watershed",
+		"Build Regions Expand",
+		"Build Regions Flood",
+		"Build Regions Filter",
+		"Build Layers",
+		"Build Polymesh Detail",
+		"Merge Polymesh Details",
+		"Filter Spans",
+	};
+	if (label < 0 || label >= RC_MAX_TIMERS)
+		return "";
+	return names[label];
+}
+
+void* rcProfilingContext::trackedAlloc(size_t size, rcAllocHint hint)
+{
+	void* ptr = s_trackedAllocFunc(size, hint);
+	rcProfilingContext* ctx = s_currentContext;
+	if (ptr && ctx && ctx->m_depth > 0)
+	{
+		OpenScope& scope = ctx->m_stack[ctx->m_depth - 1];
+		scope.allocatedBytes += size;
+		scope.allocationCount++;
+	}
+	return ptr;
+}
+
+void rcProfilingContext::enableAllocTracking(rcAllocFunc* allocFunc, rcFreeFunc* freeFunc)
+{
+	s_trackedAllocFunc = allocFunc ? allocFunc : allocDefault;
+	s_trackedFreeFunc = freeFunc ? freeFunc : freeDefault;
+	rcAllocSetCustom(trackedAlloc, freeTracked);
+}
+
+void rcProfilingContext::disableAllocTracking()
+{
+	rcAllocSetCustom(s_trackedAllocFunc, s_trackedFreeFunc);
+}
+
+int rcProfilingContext::exportChromeTrace(const rcProfilingContext* const* contexts, const int count,
+										  char* buffer, const int bufferSize)
+{
+	// Make the time stamps relative to the earliest event.
+	int64_t origin = 0;
+	bool hasOrigin = false;
+	for (int i = 0; i < count; ++i)
+	{
+		const rcProfilingContext* ctx = contexts[i];
+		if (ctx && ctx->m_eventCount > 0 && (!hasOrigin || ctx->m_events[0].start < origin))
+		{
+			origin = ctx->m_events[0].start;
+			hasOrigin = true;
+		}
+	}
+
+	rcTraceWriter out;
+	out.buffer = buffer;
+	out.size = buffer ? bufferSize : 0;
+	out.length = 0;
+
+	out.write("{\"traceEvents\":[");
+	bool first = true;
+	for (int i = 0; i < count; ++i)
+	{
+		const rcProfilingContext* ctx = contexts[i];
+		if (!ctx)
+			continue;
+		for (int j = 0; j < ctx->m_eventCount; ++j)
+		{
+			const rcProfileEvent& event = ctx->m_events[j];
+			out.write("%s\n{\"name\":\"%s\",\"cat\":\"recast\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,"
+					  "\"ts\":%.0f,\"dur\":%.0f,\"args\":{\"bytes\":%.0f}}",
+					  first ? "" : ",", getLabelName((rcTimerLabel)event.label), ctx->m_threadId,
+					  (double)(event.start - origin), (double)event.duration, (double)event.allocatedBytes);
+			first = false;
+		}
+	}
+	out.write("\n]}\n");
+
+	if (buffer && bufferSize > 0 && out.length >= bufferSize)
+		buffer[bufferSize - 1] = '\0';
+	return out.length;
+}
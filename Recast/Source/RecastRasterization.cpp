@@ -17,10 +17,24 @@
 //
 
 #include <math.h>
+#include <string.h>
 #include "Recast.h"
 #include "RecastAlloc.h"
 #include "RecastAssert.h"
 
+// Define RC_NO_SIMD to use the scalar triangle rasterizer on all platforms.
+// NEON is only used on AArch64, where it handles denormals like the scalar code.
+#if defined(RC_NO_SIMD)
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RC_RASTERIZE_SIMD
+#define RC_RASTERIZE_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define RC_RASTERIZE_SIMD
+#define RC_RASTERIZE_NEON
+#endif
+
 /// Check whether two bounding boxes overlap
 ///
 /// @param[in]	aMin	Min axis extents of bounding box A
@@ -36,6 +50,41 @@ static bool overlapBounds(const float* aMin, const float* aMax, const float* bMi
 		aMin[2] <= bMax[2] && aMax[2] >= bMin[2];
 }
 
+/// Allocates a pool of spans and adds them to the front of the free list.
+///
+/// @param[in]	heightfield		The heightfield
+/// @param[in]	spanCount		The number of spans in the pool
+/// @returns False if out of memory.
+static bool allocSpanPool(rcHeightfield& heightfield, const int spanCount)
+{
+	// The spans are allocated right after the pool header.
+	rcSpanPool* spanPool = (rcSpanPool*)rcAlloc(sizeof(rcSpanPool) + sizeof(rcSpan) * spanCount, RC_ALLOC_PERM);
+	if (spanPool == NULL)
+	{
+		return false;
+	}
+	spanPool->items = (rcSpan*)(spanPool + 1);
+	spanPool->spanCount = spanCount;
+
+	// Add the pool into the list of pools.
+	spanPool->next = heightfield.pools;
+	heightfield.pools = spanPool;
+
+	// Add new spans to the free list.
+	rcSpan* freeList = heightfield.freelist;
+	rcSpan* head = &spanPool->items[0];
+	rcSpan* it = &spanPool->items[spanCount];
+	do
+	{
+		--it;
+		it->next = freeList;
+		freeList = it;
+	}
+	while (it != head);
+	heightfield.freelist = it;
+	return true;
+}
+
 /// Allocates a new span in the heightfield.
 /// Use a memory pool and free list to minimize actual allocations.
 /// 
@@ -44,32 +93,13 @@ static bool overlapBounds(const float* aMin, const float* aMax, const float* bMi
 static rcSpan* allocSpan(rcHeightfield& heightfield)
 {
 	// If necessary, allocate new page and update the freelist.
-	if (heightfield.freelist == NULL || heightfield.freelist->next == NULL)
+	if (heightfield.freelist == NULL)
 	{
-		// Create new page.
-		// Allocate memory for the new pool.
-		rcSpanPool* spanPool = (rcSpanPool*)rcAlloc(sizeof(rcSpanPool), RC_ALLOC_PERM);
-		if (spanPool == NULL)
+		const int spanCount = heightfield.spansPerPool > 0 ? heightfield.spansPerPool : RC_SPANS_PER_POOL;
+		if (!allocSpanPool(heightfield, spanCount))
 		{
 			return NULL;
 		}
-
-		// Add the pool into the list of pools.
-		spanPool->next = heightfield.pools;
-		heightfield.pools = spanPool;
-		
-		// Add new spans to the free list.
-		rcSpan* freeList = heightfield.freelist;
-		rcSpan* head = &spanPool->items[0];
-		rcSpan* it = &spanPool->items[RC_SPANS_PER_POOL];
-		do
-		{
-			--it;
-			it->next = freeList;
-			freeList = it;
-		}
-		while (it != head);
-		heightfield.freelist = it;
 	}
 
 	// Pop item from the front of the free list.
@@ -188,6 +218,39 @@ static bool addSpan(rcHeightfield& heightfield,
 	return true;
 }
 
+/// Adds a span to the fragments of a column heightfield, the spans are merged by rcSortColumnHeightfield.
+static bool addSpan(rcColumnHeightfield& heightfield,
+                    const int x, const int z,
+                    const unsigned short min, const unsigned short max,
+                    const unsigned char areaID, const int flagMergeThreshold)
+{
+	if (heightfield.fragmentCount == heightfield.fragmentCapacity)
+	{
+		const int capacity = rcMax(heightfield.fragmentCapacity * 2, 1024);
+		rcColumnFragment* fragments = (rcColumnFragment*)rcAlloc(sizeof(rcColumnFragment) * capacity, RC_ALLOC_PERM);
+		if (fragments == NULL)
+		{
+			return false;
+		}
+		if (heightfield.fragmentCount > 0)
+		{
+			memcpy(fragments, heightfield.fragments, sizeof(rcColumnFragment) * heightfield.fragmentCount);
+		}
+		rcFree(heightfield.fragments);
+		heightfield.fragments = fragments;
+		heightfield.fragmentCapacity = capacity;
+	}
+
+	rcColumnFragment& fragment = heightfield.fragments[heightfield.fragmentCount++];
+	fragment.column = x + z * heightfield.width;
+	fragment.smin = min;
+	fragment.smax = max;
+	// Spans are never further apart than RC_SPAN_MAX_HEIGHT, so larger thresholds behave the same.
+	fragment.mergeThreshold = (unsigned short)rcClamp(flagMergeThreshold, 0, (int)RC_SPAN_MAX_HEIGHT);
+	fragment.area = areaID;
+	return true;
+}
+
 bool rcAddSpan(rcContext* context, rcHeightfield& heightfield,
                const int x, const int z,
                const unsigned short spanMin, const unsigned short spanMax,
@@ -287,6 +350,295 @@ static void dividePoly(const float* inVerts, int inVertsCount,
 	*outVerts2Count = poly2Vert;
 }
 
+#if defined(RC_RASTERIZE_SIMD)
+
+static bool s_simdRasterization = true;
+
+// The SIMD path stores the clipped polygon vertices as (x, y, z, 0) vectors.
+// It only uses lane-wise multiplies, adds, subtracts, minimums and maximums, in the
+// same order as the scalar path, so the results are bit-identical.
+#if defined(RC_RASTERIZE_SSE2)
+typedef __m128 rcVec4;
+static inline rcVec4 rcVec4Load3(const float* v) { return _mm_setr_ps(v[0], v[1], v[2], 0.0f); }
+static inline rcVec4 rcVec4Load(const float* v) { return _mm_load_ps(v); }
+static inline void rcVec4Store(float* dst, const rcVec4 v) { _mm_store_ps(dst, v); }
+static inline rcVec4 rcVec4Lerp(const rcVec4 a, const rcVec4 b, const float s) { return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), _mm_set1_ps(s))); }
+static inline rcVec4 rcVec4Min(const rcVec4 a, const rcVec4 b) { return _mm_min_ps(a, b); }
+static inline rcVec4 rcVec4Max(const rcVec4 a, const rcVec4 b) { return _mm_max_ps(a, b); }
+#elif defined(RC_RASTERIZE_NEON)
+typedef float32x4_t rcVec4;
+static inline rcVec4 rcVec4Load3(const float* v) { const float t[4] = { v[0], v[1], v[2], 0.0f }; return vld1q_f32(t); }
+static inline rcVec4 rcVec4Load(const float* v) { return vld1q_f32(v); }
+static inline void rcVec4Store(float* dst, const rcVec4 v) { vst1q_f32(dst, v); }
+static inline rcVec4 rcVec4Lerp(const rcVec4 a, const rcVec4 b, const float s) { return vaddq_f32(a, vmulq_f32(vsubq_f32(b, a), vdupq_n_f32(s))); }
+static inline rcVec4 rcVec4Min(const rcVec4 a, const rcVec4 b) { return vminq_f32(a, b); }
+static inline rcVec4 rcVec4Max(const rcVec4 a, const rcVec4 b) { return vmaxq_f32(a, b); }
+#endif
+
+/// Divides a convex polygon into two convex polygons across a separating axis.
+/// Same as dividePoly, with the vertices stored 4 floats apart.
+static void dividePolySimd(const float* inVerts, int inVertsCount,
+                           float* outVerts1, int* outVerts1Count,
+                           float* outVerts2, int* outVerts2Count,
+                           float axisOffset, rcAxis axis)
+{
+	rcAssert(inVertsCount <= 12);
+
+	float inVertAxisDelta[12];
+	for (int inVert = 0; inVert < inVertsCount; ++inVert)
+	{
+		inVertAxisDelta[inVert] = axisOffset - inVerts[inVert * 4 + axis];
+	}
+
+	int poly1Vert = 0;
+	int poly2Vert = 0;
+	for (int inVertA = 0, inVertB = inVertsCount - 1; inVertA < inVertsCount; inVertB = inVertA, ++inVertA)
+	{
+		const rcVec4 va = rcVec4Load(&inVerts[inVertA * 4]);
+		const bool sameSide = (inVertAxisDelta[inVertA] >= 0) == (inVertAxisDelta[inVertB] >= 0);
+
+		if (!sameSide)
+		{
+			const float s = inVertAxisDelta[inVertB] / (inVertAxisDelta[inVertB] - inVertAxisDelta[inVertA]);
+			const rcVec4 v = rcVec4Lerp(rcVec4Load(&inVerts[inVertB * 4]), va, s);
+			rcVec4Store(&outVerts1[poly1Vert * 4], v);
+			rcVec4Store(&outVerts2[poly2Vert * 4], v);
+			poly1Vert++;
+			poly2Vert++;
+
+			if (inVertAxisDelta[inVertA] > 0)
+			{
+				rcVec4Store(&outVerts1[poly1Vert * 4], va);
+				poly1Vert++;
+			}
+			else if (inVertAxisDelta[inVertA] < 0)
+			{
+				rcVec4Store(&outVerts2[poly2Vert * 4], va);
+				poly2Vert++;
+			}
+		}
+		else
+		{
+			if (inVertAxisDelta[inVertA] >= 0)
+			{
+				rcVec4Store(&outVerts1[poly1Vert * 4], va);
+				poly1Vert++;
+				if (inVertAxisDelta[inVertA] != 0)
+				{
+					continue;
+				}
+			}
+			rcVec4Store(&outVerts2[poly2Vert * 4], va);
+			poly2Vert++;
+		}
+	}
+
+	*outVerts1Count = poly1Vert;
+	*outVerts2Count = poly2Vert;
+}
+
+/// Returns true if all vertices of the polygon are on the negative side of the separating axis.
+/// dividePolySimd would then return the whole polygon as polygon 1 and an empty polygon 2.
+static bool polyBeforeAxis(const float* verts, const int vertsCount, const float axisOffset, const rcAxis axis)
+{
+	for (int vert = 0; vert < vertsCount; ++vert)
+	{
+		if (!(axisOffset - verts[vert * 4 + axis] > 0))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/// Rasterizes a single triangle to the heightfield. Same as rasterizeTri, using SIMD for the clipping.
+/// The parts of the triangle that lie fully inside a row or a cell are not clipped again.
+template<class Heightfield>
+static bool rasterizeTriSimd(const float* v0, const float* v1, const float* v2,
+                             const unsigned char areaID, Heightfield& heightfield,
+                             const float* heightfieldBBMin, const float* heightfieldBBMax,
+                             const float cellSize, const float inverseCellSize, const float inverseCellHeight,
+                             const int flagMergeThreshold)
+{
+	const rcVec4 a = rcVec4Load3(v0);
+	const rcVec4 b = rcVec4Load3(v1);
+	const rcVec4 c = rcVec4Load3(v2);
+
+	// Calculate the bounding box of the triangle.
+	float triBBMin[4];
+	float triBBMax[4];
+	rcVec4Store(triBBMin, rcVec4Min(rcVec4Min(a, b), c));
+	rcVec4Store(triBBMax, rcVec4Max(rcVec4Max(a, b), c));
+
+	// If the triangle does not touch the bounding box of the heightfield, skip the triangle.
+	if (!overlapBounds(triBBMin, triBBMax, heightfieldBBMin, heightfieldBBMax))
+	{
+		return true;
+	}
+
+	const int w = heightfield.width;
+	const int h = heightfield.height;
+	const float by = heightfieldBBMax[1] - heightfieldBBMin[1];
+
+	// Calculate the footprint of the triangle on the grid's z-axis
+	int z0 = (int)((triBBMin[2] - heightfieldBBMin[2]) * inverseCellSize);
+	int z1 = (int)((triBBMax[2] - heightfieldBBMin[2]) * inverseCellSize);
+
+	// use -1 rather than 0 to cut the polygon properly at the start of the tile
+	z0 = rcClamp(z0, -1, h - 1);
+	z1 = rcClamp(z1, 0, h - 1);
+
+	// Clip the triangle into all grid cells it touches.
+	rcVec4 buf[7 * 4];
+	float* in = (float*)&buf[0];
+	float* inRow = (float*)&buf[7];
+	float* p1 = (float*)&buf[7 * 2];
+	float* p2 = (float*)&buf[7 * 3];
+
+	rcVec4Store(&in[0], a);
+	rcVec4Store(&in[1 * 4], b);
+	rcVec4Store(&in[2 * 4], c);
+	int nvRow;
+	int nvIn = 3;
+
+	for (int z = z0; z <= z1; ++z)
+	{
+		// Nothing left to clip.
+		if (nvIn == 0)
+		{
+			break;
+		}
+
+		// Clip polygon to row. Store the remaining polygon as well
+		const float cellZ = heightfieldBBMin[2] + (float)z * cellSize;
+		if (polyBeforeAxis(in, nvIn, cellZ + cellSize, RC_AXIS_Z))
+		{
+			rcSwap(in, inRow);
+			nvRow = nvIn;
+			nvIn = 0;
+		}
+		else
+		{
+			dividePolySimd(in, nvIn, inRow, &nvRow, p1, &nvIn, cellZ + cellSize, RC_AXIS_Z);
+			rcSwap(in, p1);
+		}
+
+		if (nvRow < 3)
+		{
+			continue;
+		}
+		if (z < 0)
+		{
+			continue;
+		}
+
+		// find X-axis bounds of the row
+		rcVec4 rowMin = rcVec4Load(&inRow[0]);
+		rcVec4 rowMax = rowMin;
+		for (int vert = 1; vert < nvRow; ++vert)
+		{
+			const rcVec4 v = rcVec4Load(&inRow[vert * 4]);
+			rowMin = rcVec4Min(rowMin, v);
+			rowMax = rcVec4Max(rowMax, v);
+		}
+		float rowBounds[8];
+		rcVec4Store(&rowBounds[0], rowMin);
+		rcVec4Store(&rowBounds[4], rowMax);
+		int x0 = (int)((rowBounds[0] - heightfieldBBMin[0]) * inverseCellSize);
+		int x1 = (int)((rowBounds[4] - heightfieldBBMin[0]) * inverseCellSize);
+		if (x1 < 0 || x0 >= w)
+		{
+			continue;
+		}
+		x0 = rcClamp(x0, -1, w - 1);
+		x1 = rcClamp(x1, 0, w - 1);
+
+		int nv;
+		int nv2 = nvRow;
+
+		for (int x = x0; x <= x1; ++x)
+		{
+			// Nothing left to clip.
+			if (nv2 == 0)
+			{
+				break;
+			}
+
+			// Clip polygon to column. store the remaining polygon as well
+			const float cx = heightfieldBBMin[0] + (float)x * cellSize;
+			const float* cell = p1;
+			if (polyBeforeAxis(inRow, nv2, cx + cellSize, RC_AXIS_X))
+			{
+				cell = inRow;
+				nv = nv2;
+				nv2 = 0;
+			}
+			else
+			{
+				dividePolySimd(inRow, nv2, p1, &nv, p2, &nv2, cx + cellSize, RC_AXIS_X);
+				rcSwap(inRow, p2);
+			}
+
+			if (nv < 3)
+			{
+				continue;
+			}
+			if (x < 0)
+			{
+				continue;
+			}
+
+			// Calculate min and max of the span.
+			rcVec4 cellMin = rcVec4Load(&cell[0]);
+			rcVec4 cellMax = cellMin;
+			for (int vert = 1; vert < nv; ++vert)
+			{
+				const rcVec4 v = rcVec4Load(&cell[vert * 4]);
+				cellMin = rcVec4Min(cellMin, v);
+				cellMax = rcVec4Max(cellMax, v);
+			}
+			float cellBounds[8];
+			rcVec4Store(&cellBounds[0], cellMin);
+			rcVec4Store(&cellBounds[4], cellMax);
+			float spanMin = cellBounds[1] - heightfieldBBMin[1];
+			float spanMax = cellBounds[5] - heightfieldBBMin[1];
+
+			// Skip the span if it's completely outside the heightfield bounding box
+			if (spanMax < 0.0f)
+			{
+				continue;
+			}
+			if (spanMin > by)
+			{
+				continue;
+			}
+
+			// Clamp the span to the heightfield bounding box.
+			if (spanMin < 0.0f)
+			{
+				spanMin = 0;
+			}
+			if (spanMax > by)
+			{
+				spanMax = by;
+			}
+
+			// Snap the span to the heightfield height grid.
+			unsigned short spanMinCellIndex = (unsigned short)rcClamp((int)floorf(spanMin * inverseCellHeight), 0, RC_SPAN_MAX_HEIGHT);
+			unsigned short spanMaxCellIndex = (unsigned short)rcClamp((int)ceilf(spanMax * inverseCellHeight), (int)spanMinCellIndex + 1, RC_SPAN_MAX_HEIGHT);
+
+			if (!addSpan(heightfield, x, z, spanMinCellIndex, spanMaxCellIndex, areaID, flagMergeThreshold))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+#endif // RC_RASTERIZE_SIMD
+
 ///	Rasterize a single triangle to the heightfield.
 ///
 ///	This code is extremely hot, so much care should be given to maintaining maximum perf here.
@@ -295,7 +647,7 @@ static void dividePoly(const float* inVerts, int inVertsCount,
 /// @param[in] 	v1					Triangle vertex 1
 /// @param[in] 	v2					Triangle vertex 2
 /// @param[in] 	areaID				The area ID to assign to the rasterized spans
-/// @param[in] 	heightfield			Heightfield to rasterize into
+/// @param[in] 	heightfield			Heightfield to rasterize into, an rcHeightfield or an rcColumnHeightfield
 /// @param[in] 	heightfieldBBMin	The min extents of the heightfield bounding box
 /// @param[in] 	heightfieldBBMax	The max extents of the heightfield bounding box
 /// @param[in] 	cellSize			The x and z axis size of a voxel in the heightfield
@@ -303,12 +655,21 @@ static void dividePoly(const float* inVerts, int inVertsCount,
 /// @param[in] 	inverseCellHeight	1 / cellHeight
 /// @param[in] 	flagMergeThreshold	The threshold in which area flags will be merged 
 /// @returns true if the operation completes successfully.  false if there was an error adding spans to the heightfield.
+template<class Heightfield>
 static bool rasterizeTri(const float* v0, const float* v1, const float* v2,
-                         const unsigned char areaID, rcHeightfield& heightfield,
+                         const unsigned char areaID, Heightfield& heightfield,
                          const float* heightfieldBBMin, const float* heightfieldBBMax,
                          const float cellSize, const float inverseCellSize, const float inverseCellHeight,
                          const int flagMergeThreshold)
 {
+#if defined(RC_RASTERIZE_SIMD)
+	if (s_simdRasterization)
+	{
+		return rasterizeTriSimd(v0, v1, v2, areaID, heightfield, heightfieldBBMin, heightfieldBBMax,
+		                        cellSize, inverseCellSize, inverseCellHeight, flagMergeThreshold);
+	}
+#endif
+
 	// Calculate the bounding box of the triangle.
 	float triBBMin[3];
 	rcVcopy(triBBMin, v0);
@@ -454,6 +815,107 @@ static bool rasterizeTri(const float* v0, const float* v1, const float* v2,
 	return true;
 }
 
+bool rcReserveHeightfieldSpans(rcContext* context, rcHeightfield& heightfield, const int spanCount)
+{
+	rcAssert(context);
+
+	int freeCount = 0;
+	for (rcSpan* span = heightfield.freelist; span != NULL && freeCount < spanCount; span = span->next)
+	{
+		freeCount++;
+	}
+	if (freeCount >= spanCount)
+	{
+		return true;
+	}
+
+	if (!allocSpanPool(heightfield, spanCount - freeCount))
+	{
+		context->log(RC_LOG_ERROR, "rcReserveHeightfieldSpans: Out of memory 'spans' (%d).", spanCount - freeCount);
+		return false;
+	}
+	return true;
+}
+
+bool rcDefragmentHeightfield(rcContext* context, rcHeightfield& heightfield)
+{
+	rcAssert(context);
+
+	const int numColumns = heightfield.width * heightfield.height;
+	int spanCount = 0;
+	for (int columnIndex = 0; columnIndex < numColumns; ++columnIndex)
+	{
+		for (const rcSpan* span = heightfield.spans[columnIndex]; span != NULL; span = span->next)
+		{
+			spanCount++;
+		}
+	}
+	if (spanCount == 0)
+	{
+		return true;
+	}
+
+	rcSpanPool* spanPool = (rcSpanPool*)rcAlloc(sizeof(rcSpanPool) + sizeof(rcSpan) * spanCount, RC_ALLOC_PERM);
+	if (spanPool == NULL)
+	{
+		context->log(RC_LOG_ERROR, "rcDefragmentHeightfield: Out of memory 'spans' (%d).", spanCount);
+		return false;
+	}
+	spanPool->items = (rcSpan*)(spanPool + 1);
+	spanPool->spanCount = spanCount;
+	spanPool->next = NULL;
+
+	// Copy the spans column by column.
+	rcSpan* dst = spanPool->items;
+	for (int columnIndex = 0; columnIndex < numColumns; ++columnIndex)
+	{
+		const rcSpan* span = heightfield.spans[columnIndex];
+		if (span == NULL)
+		{
+			continue;
+		}
+		heightfield.spans[columnIndex] = dst;
+		for (; span != NULL; span = span->next)
+		{
+			*dst = *span;
+			dst->next = span->next != NULL ? dst + 1 : NULL;
+			dst++;
+		}
+	}
+
+	// Release the old pools; the free list pointed into them.
+	while (heightfield.pools)
+	{
+		rcSpanPool* next = heightfield.pools->next;
+		rcFree(heightfield.pools);
+		heightfield.pools = next;
+	}
+	heightfield.pools = spanPool;
+	heightfield.freelist = NULL;
+
+	return true;
+}
+
+bool rcSetSimdRasterization(const bool enabled)
+{
+#if defined(RC_RASTERIZE_SIMD)
+	s_simdRasterization = enabled;
+	return true;
+#else
+	rcIgnoreUnused(enabled);
+	return false;
+#endif
+}
+
+bool rcGetSimdRasterization()
+{
+#if defined(RC_RASTERIZE_SIMD)
+	return s_simdRasterization;
+#else
+	return false;
+#endif
+}
+
 bool rcRasterizeTriangle(rcContext* context,
                          const float* v0, const float* v1, const float* v2,
                          const unsigned char areaID, rcHeightfield& heightfield, const int flagMergeThreshold)
@@ -553,3 +1015,371 @@ bool rcRasterizeTriangles(rcContext* context,
 
 	return true;
 }
+
+/// Rasterizes indexed triangles, or a triangle list if tris is null, into the fragments of a column heightfield.
+template<class Index>
+static bool rasterizeTriangles(rcContext* context, const char* name, const float* verts, const Index* tris,
+                               const unsigned char* triAreaIDs, const int numTris,
+                               rcColumnHeightfield& heightfield, const int flagMergeThreshold)
+{
+	rcAssert(context != NULL);
+
+	rcScopedTimer timer(context, RC_TIMER_RASTERIZE_TRIANGLES);
+
+	const float inverseCellSize = 1.0f / heightfield.cs;
+	const float inverseCellHeight = 1.0f / heightfield.ch;
+	for (int triIndex = 0; triIndex < numTris; ++triIndex)
+	{
+		const float* v0 = tris ? &verts[tris[triIndex * 3 + 0] * 3] : &verts[(triIndex * 3 + 0) * 3];
+		const float* v1 = tris ? &verts[tris[triIndex * 3 + 1] * 3] : &verts[(triIndex * 3 + 1) * 3];
+		const float* v2 = tris ? &verts[tris[triIndex * 3 + 2] * 3] : &verts[(triIndex * 3 + 2) * 3];
+		if (!rasterizeTri(v0, v1, v2, triAreaIDs[triIndex], heightfield, heightfield.bmin, heightfield.bmax, heightfield.cs, inverseCellSize, inverseCellHeight, flagMergeThreshold))
+		{
+			context->log(RC_LOG_ERROR, "%s: Out of memory.", name);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool rcRasterizeTriangles(rcContext* context,
+                          const float* verts, const int /*nv*/,
+                          const int* tris, const unsigned char* triAreaIDs, const int numTris,
+                          rcColumnHeightfield& heightfield, const int flagMergeThreshold)
+{
+	return rasterizeTriangles(context, "rcRasterizeTriangles", verts, tris, triAreaIDs, numTris, heightfield, flagMergeThreshold);
+}
+
+bool rcRasterizeTriangles(rcContext* context,
+                          const float* verts, const int /*nv*/,
+                          const unsigned short* tris, const unsigned char* triAreaIDs, const int numTris,
+                          rcColumnHeightfield& heightfield, const int flagMergeThreshold)
+{
+	return rasterizeTriangles(context, "rcRasterizeTriangles", verts, tris, triAreaIDs, numTris, heightfield, flagMergeThreshold);
+}
+
+bool rcRasterizeTriangles(rcContext* context,
+                          const float* verts, const unsigned char* triAreaIDs, const int numTris,
+                          rcColumnHeightfield& heightfield, const int flagMergeThreshold)
+{
+	return rasterizeTriangles(context, "rcRasterizeTriangles", verts, (const int*)NULL, triAreaIDs, numTris, heightfield, flagMergeThreshold);
+}
+
+/// Merges a fragment into the sorted spans of a column, the same way addSpan merges a span into an rcHeightfield.
+/// The column must have room for one more span. Returns the new number of spans of the column.
+static int mergeColumnFragment(rcColumnSpan* column, const int count, const rcColumnFragment& fragment)
+{
+	int smin = fragment.smin;
+	int smax = fragment.smax;
+	unsigned int area = fragment.area;
+
+	// Skip the spans completely below the new span.
+	int first = 0;
+	while (first < count && (int)column[first].smax < smin)
+	{
+		first++;
+	}
+
+	// Merge the spans overlapping the new span, each merge can grow it over the next span.
+	int last = first;
+	while (last < count && (int)column[last].smin <= smax)
+	{
+		smin = rcMin(smin, (int)column[last].smin);
+		smax = rcMax(smax, (int)column[last].smax);
+		if (rcAbs(smax - (int)column[last].smax) <= (int)fragment.mergeThreshold)
+		{
+			// Higher area ID numbers indicate higher resolution priority.
+			area = rcMax(area, (unsigned int)column[last].area);
+		}
+		last++;
+	}
+
+	// Replace the merged spans with the new span.
+	if (last != first + 1)
+	{
+		memmove(&column[first + 1], &column[last], sizeof(rcColumnSpan) * (count - last));
+	}
+	column[first].smin = (unsigned int)smin;
+	column[first].smax = (unsigned int)smax;
+	column[first].area = area;
+	return count + 1 - (last - first);
+}
+
+bool rcSortColumnHeightfield(rcContext* context, rcColumnHeightfield& heightfield)
+{
+	rcAssert(context != NULL);
+
+	rcScopedTimer timer(context, RC_TIMER_RASTERIZE_TRIANGLES);
+
+	const int fragmentCount = heightfield.fragmentCount;
+	if (fragmentCount == 0)
+	{
+		return true;
+	}
+	const int numColumns = heightfield.width * heightfield.height;
+
+	// Sort the fragments by column with a counting sort, which keeps their order within a column.
+	rcScopedDelete<int> starts((int*)rcAlloc(sizeof(int) * (numColumns + 1), RC_ALLOC_TEMP));
+	rcScopedDelete<rcColumnFragment> sorted((rcColumnFragment*)rcAlloc(sizeof(rcColumnFragment) * fragmentCount, RC_ALLOC_TEMP));
+	if (!starts || !sorted)
+	{
+		context->log(RC_LOG_ERROR, "rcSortColumnHeightfield: Out of memory 'fragments' (%d).", fragmentCount);
+		return false;
+	}
+	memset(starts, 0, sizeof(int) * (numColumns + 1));
+	for (int i = 0; i < fragmentCount; ++i)
+	{
+		starts[heightfield.fragments[i].column + 1]++;
+	}
+	for (int i = 0; i < numColumns; ++i)
+	{
+		starts[i + 1] += starts[i];
+	}
+	for (int i = 0; i < fragmentCount; ++i)
+	{
+		sorted[starts[heightfield.fragments[i].column]++] = heightfield.fragments[i];
+	}
+	// Each start was advanced to the start of the next column.
+
+	// A column never has more spans than its old spans and its fragments together.
+	// The spans of a previous build are overwritten in place when there are no old spans.
+	const int capacity = heightfield.spanCount + fragmentCount;
+	rcColumnSpan* spans = heightfield.spans;
+	if (heightfield.spanCount > 0 || heightfield.spanCapacity < capacity)
+	{
+		spans = (rcColumnSpan*)rcAlloc(sizeof(rcColumnSpan) * capacity, RC_ALLOC_PERM);
+		if (spans == NULL)
+		{
+			context->log(RC_LOG_ERROR, "rcSortColumnHeightfield: Out of memory 'spans' (%d).", capacity);
+			return false;
+		}
+	}
+
+	// Merge the fragments of each column into its old spans, in the order they were rasterized.
+	int spanCount = 0;
+	int fragmentIndex = 0;
+	for (int columnIndex = 0; columnIndex < numColumns; ++columnIndex)
+	{
+		const int oldFirst = heightfield.columns[columnIndex];
+		const int oldCount = heightfield.columns[columnIndex + 1] - oldFirst;
+		rcColumnSpan* column = &spans[spanCount];
+		if (oldCount > 0)
+		{
+			memcpy(column, &heightfield.spans[oldFirst], sizeof(rcColumnSpan) * oldCount);
+		}
+		int count = oldCount;
+		for (; fragmentIndex < starts[columnIndex]; ++fragmentIndex)
+		{
+			count = mergeColumnFragment(column, count, sorted[fragmentIndex]);
+		}
+		heightfield.columns[columnIndex] = spanCount;
+		spanCount += count;
+	}
+	heightfield.columns[numColumns] = spanCount;
+
+	if (spans != heightfield.spans)
+	{
+		rcFree(heightfield.spans);
+		heightfield.spans = spans;
+		heightfield.spanCapacity = capacity;
+	}
+	heightfield.spanCount = spanCount;
+	heightfield.fragmentCount = 0;
+
+	return true;
+}
+
+bool rcRasterizeHeightmap(rcContext* context,
+                          const float* heights, const unsigned char* cellAreaIDs, const unsigned char* holes,
+                          const int sampleWidth, const int sampleHeight, const int sampleX, const int sampleZ,
+                          rcHeightfield& heightfield, const int flagMergeThreshold)
+{
+	rcAssert(context != NULL);
+
+	rcScopedTimer timer(context, RC_TIMER_RASTERIZE_TRIANGLES);
+
+	// The cells of the heightmap which overlap the heightfield grid.
+	const int x0 = rcMax(sampleX, 0);
+	const int z0 = rcMax(sampleZ, 0);
+	const int x1 = rcMin(sampleX + sampleWidth - 1, heightfield.width);
+	const int z1 = rcMin(sampleZ + sampleHeight - 1, heightfield.height);
+	const int cellWidth = sampleWidth - 1;
+	const float by = heightfield.bmax[1] - heightfield.bmin[1];
+	const float inverseCellHeight = 1.0f / heightfield.ch;
+
+	for (int z = z0; z < z1; ++z)
+	{
+		for (int x = x0; x < x1; ++x)
+		{
+			const int cell = (x - sampleX) + (z - sampleZ) * cellWidth;
+			if (holes && holes[cell])
+			{
+				continue;
+			}
+
+			// Both triangles of the cell cover the whole cell, so the span spans all four corners.
+			const float* h = &heights[(x - sampleX) + (z - sampleZ) * sampleWidth];
+			float spanMin = rcMin(rcMin(h[0], h[1]), rcMin(h[sampleWidth], h[sampleWidth + 1]));
+			float spanMax = rcMax(rcMax(h[0], h[1]), rcMax(h[sampleWidth], h[sampleWidth + 1]));
+			spanMin -= heightfield.bmin[1];
+			spanMax -= heightfield.bmin[1];
+
+			// Skip the span if it's completely outside the heightfield bounding box
+			if (spanMax < 0.0f || spanMin > by)
+			{
+				continue;
+			}
+			spanMin = rcMax(spanMin, 0.0f);
+			spanMax = rcMin(spanMax, by);
+
+			// Snap the span to the heightfield height grid, the same way as the triangles.
+			const unsigned short spanMinCellIndex = (unsigned short)rcClamp((int)floorf(spanMin * inverseCellHeight), 0, RC_SPAN_MAX_HEIGHT);
+			const unsigned short spanMaxCellIndex = (unsigned short)rcClamp((int)ceilf(spanMax * inverseCellHeight), (int)spanMinCellIndex + 1, RC_SPAN_MAX_HEIGHT);
+			const unsigned char areaID = cellAreaIDs ? cellAreaIDs[cell] : (unsigned char)RC_WALKABLE_AREA;
+
+			if (!addSpan(heightfield, x, z, spanMinCellIndex, spanMaxCellIndex, areaID, flagMergeThreshold))
+			{
+				context->log(RC_LOG_ERROR, "rcRasterizeHeightmap: Out of memory.");
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool rcRasterizationBackend::rasterize(rcContext* context, const rcConfig& config, const rcTriangleBuffers& triangles,
+									   rcHeightfield& heightfield)
+{
+	if (triangles.tris != NULL)
+	{
+		return rcRasterizeTriangles(context, triangles.verts, triangles.numVerts, triangles.tris, triangles.triAreaIDs,
+									triangles.numTris, heightfield, config.walkableClimb);
+	}
+	return rcRasterizeTriangles(context, triangles.verts, triangles.triAreaIDs, triangles.numTris, heightfield,
+								config.walkableClimb);
+}
+
+bool rcValidatingRasterizationBackend::rasterize(rcContext* context, const rcConfig& config,
+												 const rcTriangleBuffers& triangles, rcHeightfield& heightfield)
+{
+	rcAssert(context);
+	rcAssert(m_backend);
+
+	// The reference starts from the same spans, the triangles are added to what is already there.
+	rcHeightfield reference;
+	if (!rcCopyHeightfield(context, heightfield, reference))
+	{
+		return false;
+	}
+	if (!m_backend->rasterize(context, config, triangles, heightfield))
+	{
+		return false;
+	}
+	if (!rcRasterizationBackend::rasterize(context, config, triangles, reference))
+	{
+		return false;
+	}
+
+	const int mismatchCount = rcCompareHeightfields(context, heightfield, reference, 8);
+	if (mismatchCount != 0)
+	{
+		context->log(RC_LOG_WARNING, "rcValidatingRasterizationBackend: %d columns differ from the CPU rasterizer.",
+					 mismatchCount);
+		m_mismatchCount += mismatchCount > 0 ? mismatchCount : heightfield.width * heightfield.height;
+	}
+	return true;
+}
+
+bool rcCopyHeightfield(rcContext* context, const rcHeightfield& src, rcHeightfield& dst)
+{
+	rcAssert(context);
+
+	if (&src == &dst)
+	{
+		return true;
+	}
+	if (!rcResetHeightfield(context, dst, src.width, src.height, src.bmin, src.bmax, src.cs, src.ch))
+	{
+		return false;
+	}
+
+	const int numColumns = src.width * src.height;
+	int spanCount = 0;
+	for (int columnIndex = 0; columnIndex < numColumns; ++columnIndex)
+	{
+		for (const rcSpan* span = src.spans[columnIndex]; span != NULL; span = span->next)
+		{
+			spanCount++;
+		}
+	}
+	if (!rcReserveHeightfieldSpans(context, dst, spanCount))
+	{
+		return false;
+	}
+
+	for (int columnIndex = 0; columnIndex < numColumns; ++columnIndex)
+	{
+		rcSpan** tail = &dst.spans[columnIndex];
+		for (const rcSpan* span = src.spans[columnIndex]; span != NULL; span = span->next)
+		{
+			rcSpan* copy = allocSpan(dst);
+			copy->smin = span->smin;
+			copy->smax = span->smax;
+			copy->area = span->area;
+			copy->next = NULL;
+			*tail = copy;
+			tail = &copy->next;
+		}
+	}
+	return true;
+}
+
+int rcCompareHeightfields(rcContext* context, const rcHeightfield& a, const rcHeightfield& b, const int maxLoggedColumns)
+{
+	rcAssert(context);
+
+	if (a.width != b.width || a.height != b.height)
+	{
+		context->log(RC_LOG_WARNING, "rcCompareHeightfields: The sizes differ (%d x %d, %d x %d).",
+					 a.width, a.height, b.width, b.height);
+		return -1;
+	}
+
+	int mismatchCount = 0;
+	for (int z = 0; z < a.height; ++z)
+	{
+		for (int x = 0; x < a.width; ++x)
+		{
+			const rcSpan* spanA = a.spans[x + z * a.width];
+			const rcSpan* spanB = b.spans[x + z * b.width];
+			while (spanA != NULL && spanB != NULL &&
+				   spanA->smin == spanB->smin && spanA->smax == spanB->smax && spanA->area == spanB->area)
+			{
+				spanA = spanA->next;
+				spanB = spanB->next;
+			}
+			if (spanA == NULL && spanB == NULL)
+			{
+				continue;
+			}
+
+			if (mismatchCount < maxLoggedColumns)
+			{
+				if (spanA != NULL && spanB != NULL)
+				{
+					context->log(RC_LOG_WARNING, "rcCompareHeightfields: Column (%d, %d) differs, span %d-%d area %d, span %d-%d area %d.",
+								 x, z, (int)spanA->smin, (int)spanA->smax, (int)spanA->area,
+								 (int)spanB->smin, (int)spanB->smax, (int)spanB->area);
+				}
+				else
+				{
+					context->log(RC_LOG_WARNING, "rcCompareHeightfields: Column (%d, %d) differs in the number of spans.", x, z);
+				}
+			}
+			mismatchCount++;
+		}
+	}
+	return mismatchCount;
+}
@@ -36,17 +36,29 @@ struct LevelStackEntry
 };
 }  // namespace
 
-static void calculateDistanceField(rcCompactHeightfield& chf, unsigned short* src, unsigned short& maxDist)
+/// Splits the rows of the heightfield into bands processed by separate jobs.
+static void getBandRows(const int band, const int bandCount, const int h, int& y0, int& y1)
+{
+	y0 = (int)((long long)h * band / bandCount);
+	y1 = (int)((long long)h * (band + 1) / bandCount);
+}
+
+/// Returns the number of row bands to split a pass over the heightfield into.
+static int getBandCount(const rcJobDispatcher* dispatcher, const int h)
+{
+	if (!dispatcher || h <= 0)
+		return 1;
+	// A few bands per worker to balance uneven rows.
+	return rcMax(1, rcMin(h, dispatcher->getWorkerCount() * 4));
+}
+
+/// Initializes the distances of the spans in the rows [y0, y1), boundary spans to zero.
+static void markBoundaryCells(const rcCompactHeightfield& chf, unsigned short* src, const int y0, const int y1)
 {
 	const int w = chf.width;
-	const int h = chf.height;
-	
-	// Init distance and points.
-	for (int i = 0; i < chf.spanCount; ++i)
-		src[i] = 0xffff;
-	
+
 	// Mark boundary cells.
-	for (int y = 0; y < h; ++y)
+	for (int y = y0; y < y1; ++y)
 	{
 		for (int x = 0; x < w; ++x)
 		{
@@ -68,120 +80,233 @@ static void calculateDistanceField(rcCompactHeightfield& chf, unsigned short* sr
 							nc++;
 					}
 				}
-				if (nc != 4)
-					src[i] = 0;
+				src[i] = nc != 4 ? 0 : 0xffff;
 			}
 		}
 	}
-	
-			
-	// Pass 1
-	for (int y = 0; y < h; ++y)
+}
+
+/// Relaxes the distances of the spans in row y from their neighbours to the left and,
+/// if @p fromBelow is set, from the row below. Returns true if any distance was lowered.
+static bool relaxDistanceRowForward(const rcCompactHeightfield& chf, unsigned short* src, const int y,
+									const bool fromBelow)
+{
+	const int w = chf.width;
+	bool changed = false;
+	for (int x = 0; x < w; ++x)
 	{
-		for (int x = 0; x < w; ++x)
+		const rcCompactCell& c = chf.cells[x+y*w];
+		for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
 		{
-			const rcCompactCell& c = chf.cells[x+y*w];
-			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
+			const rcCompactSpan& s = chf.spans[i];
+			const unsigned short d = src[i];
+			
+			if (rcGetCon(s, 0) != RC_NOT_CONNECTED)
 			{
-				const rcCompactSpan& s = chf.spans[i];
+				// (-1,0)
+				const int ax = x + rcGetDirOffsetX(0);
+				const int ay = y + rcGetDirOffsetY(0);
+				const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, 0);
+				const rcCompactSpan& as = chf.spans[ai];
+				if (src[ai]+2 < src[i])
+					src[i] = src[ai]+2;
 				
-				if (rcGetCon(s, 0) != RC_NOT_CONNECTED)
+				// (-1,-1)
+				if (fromBelow && rcGetCon(as, 3) != RC_NOT_CONNECTED)
 				{
-					// (-1,0)
-					const int ax = x + rcGetDirOffsetX(0);
-					const int ay = y + rcGetDirOffsetY(0);
-					const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, 0);
-					const rcCompactSpan& as = chf.spans[ai];
-					if (src[ai]+2 < src[i])
-						src[i] = src[ai]+2;
-					
-					// (-1,-1)
-					if (rcGetCon(as, 3) != RC_NOT_CONNECTED)
-					{
-						const int aax = ax + rcGetDirOffsetX(3);
-						const int aay = ay + rcGetDirOffsetY(3);
-						const int aai = (int)chf.cells[aax+aay*w].index + rcGetCon(as, 3);
-						if (src[aai]+3 < src[i])
-							src[i] = src[aai]+3;
-					}
+					const int aax = ax + rcGetDirOffsetX(3);
+					const int aay = ay + rcGetDirOffsetY(3);
+					const int aai = (int)chf.cells[aax+aay*w].index + rcGetCon(as, 3);
+					if (src[aai]+3 < src[i])
+						src[i] = src[aai]+3;
 				}
-				if (rcGetCon(s, 3) != RC_NOT_CONNECTED)
+			}
+			if (fromBelow && rcGetCon(s, 3) != RC_NOT_CONNECTED)
+			{
+				// (0,-1)
+				const int ax = x + rcGetDirOffsetX(3);
+				const int ay = y + rcGetDirOffsetY(3);
+				const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, 3);
+				const rcCompactSpan& as = chf.spans[ai];
+				if (src[ai]+2 < src[i])
+					src[i] = src[ai]+2;
+				
+				// (1,-1)
+				if (rcGetCon(as, 2) != RC_NOT_CONNECTED)
 				{
-					// (0,-1)
-					const int ax = x + rcGetDirOffsetX(3);
-					const int ay = y + rcGetDirOffsetY(3);
-					const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, 3);
-					const rcCompactSpan& as = chf.spans[ai];
-					if (src[ai]+2 < src[i])
-						src[i] = src[ai]+2;
-					
-					// (1,-1)
-					if (rcGetCon(as, 2) != RC_NOT_CONNECTED)
-					{
-						const int aax = ax + rcGetDirOffsetX(2);
-						const int aay = ay + rcGetDirOffsetY(2);
-						const int aai = (int)chf.cells[aax+aay*w].index + rcGetCon(as, 2);
-						if (src[aai]+3 < src[i])
-							src[i] = src[aai]+3;
-					}
+					const int aax = ax + rcGetDirOffsetX(2);
+					const int aay = ay + rcGetDirOffsetY(2);
+					const int aai = (int)chf.cells[aax+aay*w].index + rcGetCon(as, 2);
+					if (src[aai]+3 < src[i])
+						src[i] = src[aai]+3;
 				}
 			}
+			if (src[i] != d)
+				changed = true;
 		}
 	}
-	
-	// Pass 2
-	for (int y = h-1; y >= 0; --y)
+	return changed;
+}
+
+/// Relaxes the distances of the spans in row y from their neighbours to the right and,
+/// if @p fromAbove is set, from the row above. Returns true if any distance was lowered.
+static bool relaxDistanceRowBackward(const rcCompactHeightfield& chf, unsigned short* src, const int y,
+									 const bool fromAbove)
+{
+	const int w = chf.width;
+	bool changed = false;
+	for (int x = w-1; x >= 0; --x)
 	{
-		for (int x = w-1; x >= 0; --x)
+		const rcCompactCell& c = chf.cells[x+y*w];
+		for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
 		{
-			const rcCompactCell& c = chf.cells[x+y*w];
-			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
+			const rcCompactSpan& s = chf.spans[i];
+			const unsigned short d = src[i];
+			
+			if (rcGetCon(s, 2) != RC_NOT_CONNECTED)
 			{
-				const rcCompactSpan& s = chf.spans[i];
+				// (1,0)
+				const int ax = x + rcGetDirOffsetX(2);
+				const int ay = y + rcGetDirOffsetY(2);
+				const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, 2);
+				const rcCompactSpan& as = chf.spans[ai];
+				if (src[ai]+2 < src[i])
+					src[i] = src[ai]+2;
 				
-				if (rcGetCon(s, 2) != RC_NOT_CONNECTED)
+				// (1,1)
+				if (fromAbove && rcGetCon(as, 1) != RC_NOT_CONNECTED)
 				{
-					// (1,0)
-					const int ax = x + rcGetDirOffsetX(2);
-					const int ay = y + rcGetDirOffsetY(2);
-					const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, 2);
-					const rcCompactSpan& as = chf.spans[ai];
-					if (src[ai]+2 < src[i])
-						src[i] = src[ai]+2;
-					
-					// (1,1)
-					if (rcGetCon(as, 1) != RC_NOT_CONNECTED)
-					{
-						const int aax = ax + rcGetDirOffsetX(1);
-						const int aay = ay + rcGetDirOffsetY(1);
-						const int aai = (int)chf.cells[aax+aay*w].index + rcGetCon(as, 1);
-						if (src[aai]+3 < src[i])
-							src[i] = src[aai]+3;
-					}
+					const int aax = ax + rcGetDirOffsetX(1);
+					const int aay = ay + rcGetDirOffsetY(1);
+					const int aai = (int)chf.cells[aax+aay*w].index + rcGetCon(as, 1);
+					if (src[aai]+3 < src[i])
+						src[i] = src[aai]+3;
 				}
-				if (rcGetCon(s, 1) != RC_NOT_CONNECTED)
+			}
+			if (fromAbove && rcGetCon(s, 1) != RC_NOT_CONNECTED)
+			{
+				// (0,1)
+				const int ax = x + rcGetDirOffsetX(1);
+				const int ay = y + rcGetDirOffsetY(1);
+				const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, 1);
+				const rcCompactSpan& as = chf.spans[ai];
+				if (src[ai]+2 < src[i])
+					src[i] = src[ai]+2;
+				
+				// (-1,1)
+				if (rcGetCon(as, 0) != RC_NOT_CONNECTED)
 				{
-					// (0,1)
-					const int ax = x + rcGetDirOffsetX(1);
-					const int ay = y + rcGetDirOffsetY(1);
-					const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, 1);
-					const rcCompactSpan& as = chf.spans[ai];
-					if (src[ai]+2 < src[i])
-						src[i] = src[ai]+2;
-					
-					// (-1,1)
-					if (rcGetCon(as, 0) != RC_NOT_CONNECTED)
-					{
-						const int aax = ax + rcGetDirOffsetX(0);
-						const int aay = ay + rcGetDirOffsetY(0);
-						const int aai = (int)chf.cells[aax+aay*w].index + rcGetCon(as, 0);
-						if (src[aai]+3 < src[i])
-							src[i] = src[aai]+3;
-					}
+					const int aax = ax + rcGetDirOffsetX(0);
+					const int aay = ay + rcGetDirOffsetY(0);
+					const int aai = (int)chf.cells[aax+aay*w].index + rcGetCon(as, 0);
+					if (src[aai]+3 < src[i])
+						src[i] = src[aai]+3;
 				}
 			}
+			if (src[i] != d)
+				changed = true;
 		}
-	}	
+	}
+	return changed;
+}
+
+struct rcDistanceFieldJob
+{
+	const rcCompactHeightfield* chf;
+	unsigned short* src;
+	unsigned short* dst;
+	int bandCount;
+	int threshold;
+};
+
+static void markBoundaryCellsJob(void* userData, const int jobIndex, const int /*workerIndex*/)
+{
+	const rcDistanceFieldJob* job = (const rcDistanceFieldJob*)userData;
+	int y0, y1;
+	getBandRows(jobIndex, job->bandCount, job->chf->height, y0, y1);
+	markBoundaryCells(*job->chf, job->src, y0, y1);
+}
+
+/// Runs the forward sweep within a band, leaving out the row below the band.
+static void sweepDistanceForwardJob(void* userData, const int jobIndex, const int /*workerIndex*/)
+{
+	const rcDistanceFieldJob* job = (const rcDistanceFieldJob*)userData;
+	int y0, y1;
+	getBandRows(jobIndex, job->bandCount, job->chf->height, y0, y1);
+	for (int y = y0; y < y1; ++y)
+		relaxDistanceRowForward(*job->chf, job->src, y, y > y0);
+}
+
+/// Runs the backward sweep within a band, leaving out the row above the band.
+static void sweepDistanceBackwardJob(void* userData, const int jobIndex, const int /*workerIndex*/)
+{
+	const rcDistanceFieldJob* job = (const rcDistanceFieldJob*)userData;
+	int y0, y1;
+	getBandRows(jobIndex, job->bandCount, job->chf->height, y0, y1);
+	for (int y = y1-1; y >= y0; --y)
+		relaxDistanceRowBackward(*job->chf, job->src, y, y < y1-1);
+}
+
+/// @par
+///
+/// Each sweep of the chamfer distance transform finds the shortest distances over the
+/// neighbours visited before a span, which do not depend on the order of the rows as long as
+/// each row follows its predecessor. With a dispatcher, the bands of rows are swept in
+/// separate jobs without the row across the band border, and the rows after each border
+/// are then relaxed in order until a row no longer changes, since the rows after it only
+/// depend on it. The result is identical to the serial sweeps.
+static void calculateDistanceField(rcCompactHeightfield& chf, unsigned short* src, unsigned short& maxDist,
+								   rcJobDispatcher* dispatcher)
+{
+	const int h = chf.height;
+	
+	if (!dispatcher)
+	{
+		markBoundaryCells(chf, src, 0, h);
+		for (int y = 0; y < h; ++y)
+			relaxDistanceRowForward(chf, src, y, true);
+		for (int y = h-1; y >= 0; --y)
+			relaxDistanceRowBackward(chf, src, y, true);
+	}
+	else
+	{
+		rcDistanceFieldJob job;
+		job.chf = &chf;
+		job.src = src;
+		job.dst = 0;
+		job.bandCount = getBandCount(dispatcher, h);
+		job.threshold = 0;
+
+		// Init distance and mark boundary cells, the rows are independent.
+		rcDispatchJobs(dispatcher, markBoundaryCellsJob, &job, job.bandCount);
+
+		// Pass 1
+		rcDispatchJobs(dispatcher, sweepDistanceForwardJob, &job, job.bandCount);
+		for (int band = 1; band < job.bandCount; ++band)
+		{
+			int y0, y1;
+			getBandRows(band, job.bandCount, h, y0, y1);
+			for (int y = y0; y < y1; ++y)
+			{
+				// The rows after an unchanged row are final.
+				if (!relaxDistanceRowForward(chf, src, y, true))
+					break;
+			}
+		}
+
+		// Pass 2
+		rcDispatchJobs(dispatcher, sweepDistanceBackwardJob, &job, job.bandCount);
+		for (int band = job.bandCount-2; band >= 0; --band)
+		{
+			int y0, y1;
+			getBandRows(band, job.bandCount, h, y0, y1);
+			for (int y = y1-1; y >= y0; --y)
+			{
+				if (!relaxDistanceRowBackward(chf, src, y, true))
+					break;
+			}
+		}
+	}
 	
 	maxDist = 0;
 	for (int i = 0; i < chf.spanCount; ++i)
@@ -189,15 +314,15 @@ static void calculateDistanceField(rcCompactHeightfield& chf, unsigned short* sr
 	
 }
 
-static unsigned short* boxBlur(rcCompactHeightfield& chf, int thr,
-							   unsigned short* src, unsigned short* dst)
+/// Blurs the distances of the spans in the rows [y0, y1).
+static void boxBlurRows(const rcCompactHeightfield& chf, int thr,
+						const unsigned short* src, unsigned short* dst, const int y0, const int y1)
 {
 	const int w = chf.width;
-	const int h = chf.height;
 	
 	thr *= 2;
 	
-	for (int y = 0; y < h; ++y)
+	for (int y = y0; y < y1; ++y)
 	{
 		for (int x = 0; x < w; ++x)
 		{
@@ -245,14 +370,44 @@ static unsigned short* boxBlur(rcCompactHeightfield& chf, int thr,
 			}
 		}
 	}
+}
+
+static void boxBlurJob(void* userData, const int jobIndex, const int /*workerIndex*/)
+{
+	const rcDistanceFieldJob* job = (const rcDistanceFieldJob*)userData;
+	int y0, y1;
+	getBandRows(jobIndex, job->bandCount, job->chf->height, y0, y1);
+	boxBlurRows(*job->chf, job->threshold, job->src, job->dst, y0, y1);
+}
+
+static unsigned short* boxBlur(rcCompactHeightfield& chf, int thr,
+							   unsigned short* src, unsigned short* dst,
+							   rcJobDispatcher* dispatcher)
+{
+	if (dispatcher)
+	{
+		rcDistanceFieldJob job;
+		job.chf = &chf;
+		job.src = src;
+		job.dst = dst;
+		job.bandCount = getBandCount(dispatcher, chf.height);
+		job.threshold = thr;
+		rcDispatchJobs(dispatcher, boxBlurJob, &job, job.bandCount);
+	}
+	else
+	{
+		boxBlurRows(chf, thr, src, dst, 0, chf.height);
+	}
 	return dst;
 }
 
 
+/// Floods a new region from the cell, within the rows [y0, y1).
 static bool floodRegion(int x, int y, int i,
 						unsigned short level, unsigned short r,
 						rcCompactHeightfield& chf,
 						unsigned short* srcReg, unsigned short* srcDist,
+						const int y0, const int y1,
 						rcTempVector<LevelStackEntry>& stack)
 {
 	const int w = chf.width;
@@ -287,6 +442,8 @@ static bool floodRegion(int x, int y, int i,
 			{
 				const int ax = cx + rcGetDirOffsetX(dir);
 				const int ay = cy + rcGetDirOffsetY(dir);
+				if (ay < y0 || ay >= y1)
+					continue;
 				const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(cs, dir);
 				if (chf.areas[ai] != area)
 					continue;
@@ -306,6 +463,8 @@ static bool floodRegion(int x, int y, int i,
 				{
 					const int ax2 = ax + rcGetDirOffsetX(dir2);
 					const int ay2 = ay + rcGetDirOffsetY(dir2);
+					if (ay2 < y0 || ay2 >= y1)
+						continue;
 					const int ai2 = (int)chf.cells[ax2+ay2*w].index + rcGetCon(as, dir2);
 					if (chf.areas[ai2] != area)
 						continue;
@@ -333,6 +492,8 @@ static bool floodRegion(int x, int y, int i,
 			{
 				const int ax = cx + rcGetDirOffsetX(dir);
 				const int ay = cy + rcGetDirOffsetY(dir);
+				if (ay < y0 || ay >= y1)
+					continue;
 				const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(cs, dir);
 				if (chf.areas[ai] != area)
 					continue;
@@ -358,33 +519,149 @@ struct DirtyEntry
 	unsigned short region;
 	unsigned short distance2;
 };
+/// Finds the region a cell expands to, the neighbour region within the rows [y0, y1) with the
+/// smallest distance. Returns zero if none of the neighbours have a region.
+static unsigned short findExpandRegion(const rcCompactHeightfield& chf, const int x, const int y, const int i,
+									   const unsigned short* srcReg, const unsigned short* srcDist,
+									   const int y0, const int y1, unsigned short& d2)
+{
+	const int w = chf.width;
+	unsigned short r = srcReg[i];
+	d2 = 0xffff;
+	const unsigned char area = chf.areas[i];
+	const rcCompactSpan& s = chf.spans[i];
+	for (int dir = 0; dir < 4; ++dir)
+	{
+		if (rcGetCon(s, dir) == RC_NOT_CONNECTED) continue;
+		const int ax = x + rcGetDirOffsetX(dir);
+		const int ay = y + rcGetDirOffsetY(dir);
+		if (ay < y0 || ay >= y1) continue;
+		const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, dir);
+		if (chf.areas[ai] != area) continue;
+		if (srcReg[ai] > 0 && (srcReg[ai] & RC_BORDER_REG) == 0)
+		{
+			if ((int)srcDist[ai]+2 < (int)d2)
+			{
+				r = srcReg[ai];
+				d2 = srcDist[ai]+2;
+			}
+		}
+	}
+	return r;
+}
+
+/// Collects the unassigned cells at or above the level in the rows [y0, y1).
+static void collectLevelCells(const rcCompactHeightfield& chf, const unsigned short level, const unsigned short* srcReg,
+							  const int y0, const int y1, rcTempVector<LevelStackEntry>& stack)
+{
+	const int w = chf.width;
+	for (int y = y0; y < y1; ++y)
+	{
+		for (int x = 0; x < w; ++x)
+		{
+			const rcCompactCell& c = chf.cells[x+y*w];
+			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
+			{
+				if (chf.dist[i] >= level && srcReg[i] == 0 && chf.areas[i] != RC_NULL_AREA)
+				{
+					stack.push_back(LevelStackEntry(x, y, i));
+				}
+			}
+		}
+	}
+}
+
+/// The minimum number of cells in an expansion pass worth splitting into jobs.
+static const int RC_MIN_PARALLEL_EXPAND_CELLS = 4096;
+
+struct rcExpandRegionsJob
+{
+	const rcCompactHeightfield* chf;
+	unsigned short level;
+	const unsigned short* srcReg;
+	const unsigned short* srcDist;
+	LevelStackEntry* stack;
+	int stackSize;
+	int jobCount;
+	unsigned short* regions;		// The region of each stack entry, zero if not expanded. [Size: stackSize]
+	unsigned short* distances;		// The distance of each expanded stack entry. [Size: stackSize]
+	rcTempVector<LevelStackEntry>* bandStacks;	// The cells collected from each row band. [Size: jobCount]
+};
+
+static void collectLevelCellsJob(void* userData, const int jobIndex, const int /*workerIndex*/)
+{
+	rcExpandRegionsJob* job = (rcExpandRegionsJob*)userData;
+	int y0, y1;
+	getBandRows(jobIndex, job->jobCount, job->chf->height, y0, y1);
+	job->bandStacks[jobIndex].clear();
+	collectLevelCells(*job->chf, job->level, job->srcReg, y0, y1, job->bandStacks[jobIndex]);
+}
+
+static void findExpandRegionsJob(void* userData, const int jobIndex, const int /*workerIndex*/)
+{
+	rcExpandRegionsJob* job = (rcExpandRegionsJob*)userData;
+	const int j0 = (int)((long long)job->stackSize * jobIndex / job->jobCount);
+	const int j1 = (int)((long long)job->stackSize * (jobIndex + 1) / job->jobCount);
+	for (int j = j0; j < j1; ++j)
+	{
+		const LevelStackEntry& entry = job->stack[j];
+		if (entry.index < 0)
+		{
+			job->regions[j] = 0;
+			continue;
+		}
+		job->regions[j] = findExpandRegion(*job->chf, entry.x, entry.y, entry.index, job->srcReg, job->srcDist,
+										   0, job->chf->height, job->distances[j]);
+	}
+}
+
+/// Expands the regions into the cells of the stack, or with @p fillStack into the unassigned
+/// cells of the rows [y0, y1) at or above the level. The regions only expand within the rows.
+/// A dispatcher may only be given for all rows of the heightfield.
 static void expandRegions(int maxIter, unsigned short level,
 					      rcCompactHeightfield& chf,
 					      unsigned short* srcReg, unsigned short* srcDist,
 					      rcTempVector<LevelStackEntry>& stack,
-					      bool fillStack)
+					      bool fillStack, const int y0, const int y1,
+					      rcJobDispatcher* dispatcher = 0)
 {
-	const int w = chf.width;
 	const int h = chf.height;
+	rcAssert(!dispatcher || (y0 == 0 && y1 == h));
+
+	rcExpandRegionsJob job;
+	job.chf = &chf;
+	job.level = level;
+	job.srcReg = srcReg;
+	job.srcDist = srcDist;
+	job.stack = 0;
+	job.stackSize = 0;
+	job.jobCount = 0;
+	job.regions = 0;
+	job.distances = 0;
+	job.bandStacks = 0;
 
 	if (fillStack)
 	{
 		// Find cells revealed by the raised level.
 		stack.clear();
-		for (int y = 0; y < h; ++y)
+		if (dispatcher)
 		{
-			for (int x = 0; x < w; ++x)
+			// Collect the rows in bands, and concatenate them in order.
+			rcTempVector<rcTempVector<LevelStackEntry> > bandStacks;
+			bandStacks.resize(getBandCount(dispatcher, h));
+			job.jobCount = bandStacks.size();
+			job.bandStacks = &bandStacks[0];
+			rcDispatchJobs(dispatcher, collectLevelCellsJob, &job, job.jobCount);
+			for (int band = 0; band < bandStacks.size(); ++band)
 			{
-				const rcCompactCell& c = chf.cells[x+y*w];
-				for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
-				{
-					if (chf.dist[i] >= level && srcReg[i] == 0 && chf.areas[i] != RC_NULL_AREA)
-					{
-						stack.push_back(LevelStackEntry(x, y, i));
-					}
-				}
+				for (int j = 0; j < bandStacks[band].size(); ++j)
+					stack.push_back(bandStacks[band][j]);
 			}
 		}
+		else
+		{
+			collectLevelCells(chf, level, srcReg, y0, y1, stack);
+		}
 	}
 	else // use cells in the input stack
 	{
@@ -397,6 +674,22 @@ static void expandRegions(int maxIter, unsigned short level,
 		}
 	}
 
+	// The neighbours are read from the regions of the previous iteration, so the cells
+	// of an iteration are independent and can be split into jobs.
+	const bool parallel = dispatcher && dispatcher->getWorkerCount() > 1 && stack.size() >= RC_MIN_PARALLEL_EXPAND_CELLS;
+	rcTempVector<unsigned short> regions;
+	rcTempVector<unsigned short> distances;
+	if (parallel)
+	{
+		regions.resize(stack.size());
+		distances.resize(stack.size());
+		job.stack = &stack[0];
+		job.stackSize = stack.size();
+		job.jobCount = dispatcher->getWorkerCount() * 4;
+		job.regions = &regions[0];
+		job.distances = &distances[0];
+	}
+
 	rcTempVector<DirtyEntry> dirtyEntries;
 	int iter = 0;
 	while (stack.size() > 0)
@@ -404,6 +697,9 @@ static void expandRegions(int maxIter, unsigned short level,
 		int failed = 0;
 		dirtyEntries.clear();
 		
+		if (parallel)
+			rcDispatchJobs(dispatcher, findExpandRegionsJob, &job, job.jobCount);
+
 		for (int j = 0; j < stack.size(); j++)
 		{
 			int x = stack[j].x;
@@ -415,25 +711,16 @@ static void expandRegions(int maxIter, unsigned short level,
 				continue;
 			}
 			
-			unsigned short r = srcReg[i];
-			unsigned short d2 = 0xffff;
-			const unsigned char area = chf.areas[i];
-			const rcCompactSpan& s = chf.spans[i];
-			for (int dir = 0; dir < 4; ++dir)
+			unsigned short d2;
+			unsigned short r;
+			if (parallel)
 			{
-				if (rcGetCon(s, dir) == RC_NOT_CONNECTED) continue;
-				const int ax = x + rcGetDirOffsetX(dir);
-				const int ay = y + rcGetDirOffsetY(dir);
-				const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, dir);
-				if (chf.areas[ai] != area) continue;
-				if (srcReg[ai] > 0 && (srcReg[ai] & RC_BORDER_REG) == 0)
-				{
-					if ((int)srcDist[ai]+2 < (int)d2)
-					{
-						r = srcReg[ai];
-						d2 = srcDist[ai]+2;
-					}
-				}
+				r = regions[j];
+				d2 = distances[j];
+			}
+			else
+			{
+				r = findExpandRegion(chf, x, y, i, srcReg, srcDist, y0, y1, d2);
 			}
 			if (r)
 			{
@@ -467,21 +754,19 @@ static void expandRegions(int maxIter, unsigned short level,
 
 
 
-static void sortCellsByLevel(unsigned short startLevel,
-							  rcCompactHeightfield& chf,
-							  const unsigned short* srcReg,
-							  unsigned int nbStacks, rcTempVector<LevelStackEntry>* stacks,
-							  unsigned short loglevelsPerStack) // the levels per stack (2 in our case) as a bit shift
+/// Puts the unassigned cells of the rows [y0, y1) in the level range into the appropriate stacks.
+static void sortRowsByLevel(unsigned short startLevel,
+							const rcCompactHeightfield& chf,
+							const unsigned short* srcReg,
+							unsigned int nbStacks, rcTempVector<LevelStackEntry>* stacks,
+							unsigned short loglevelsPerStack,
+							const int y0, const int y1)
 {
 	const int w = chf.width;
-	const int h = chf.height;
 	startLevel = startLevel >> loglevelsPerStack;
 
-	for (unsigned int j=0; j<nbStacks; ++j)
-		stacks[j].clear();
-
 	// put all cells in the level range into the appropriate stacks
-	for (int y = 0; y < h; ++y)
+	for (int y = y0; y < y1; ++y)
 	{
 		for (int x = 0; x < w; ++x)
 		{
@@ -504,6 +789,71 @@ static void sortCellsByLevel(unsigned short startLevel,
 	}
 }
 
+struct rcSortCellsJob
+{
+	const rcCompactHeightfield* chf;
+	const unsigned short* srcReg;
+	unsigned short startLevel;
+	unsigned short loglevelsPerStack;
+	unsigned int nbStacks;
+	int bandCount;
+	rcTempVector<LevelStackEntry>* bandStacks;	// The stacks of each row band. [Size: bandCount * nbStacks]
+};
+
+static void sortRowsByLevelJob(void* userData, const int jobIndex, const int /*workerIndex*/)
+{
+	const rcSortCellsJob* job = (const rcSortCellsJob*)userData;
+	int y0, y1;
+	getBandRows(jobIndex, job->bandCount, job->chf->height, y0, y1);
+	rcTempVector<LevelStackEntry>* stacks = &job->bandStacks[jobIndex * job->nbStacks];
+	for (unsigned int j = 0; j < job->nbStacks; ++j)
+		stacks[j].clear();
+	sortRowsByLevel(job->startLevel, *job->chf, job->srcReg, job->nbStacks, stacks, job->loglevelsPerStack, y0, y1);
+}
+
+static void sortCellsByLevel(unsigned short startLevel,
+							  rcCompactHeightfield& chf,
+							  const unsigned short* srcReg,
+							  unsigned int nbStacks, rcTempVector<LevelStackEntry>* stacks,
+							  unsigned short loglevelsPerStack, // the levels per stack (2 in our case) as a bit shift
+							  const int y0, const int y1,
+							  rcJobDispatcher* dispatcher = 0,
+							  rcTempVector<rcTempVector<LevelStackEntry> >* bandStacks = 0)
+{
+	for (unsigned int j=0; j<nbStacks; ++j)
+		stacks[j].clear();
+
+	if (!dispatcher)
+	{
+		sortRowsByLevel(startLevel, chf, srcReg, nbStacks, stacks, loglevelsPerStack, y0, y1);
+		return;
+	}
+	rcAssert(y0 == 0 && y1 == chf.height);
+
+	// Sort the rows in bands, and concatenate the stacks of the bands in order.
+	rcSortCellsJob job;
+	job.chf = &chf;
+	job.srcReg = srcReg;
+	job.startLevel = startLevel;
+	job.loglevelsPerStack = loglevelsPerStack;
+	job.nbStacks = nbStacks;
+	job.bandCount = getBandCount(dispatcher, chf.height);
+	if (bandStacks->size() < job.bandCount * (int)nbStacks)
+		bandStacks->resize(job.bandCount * nbStacks);
+	job.bandStacks = &(*bandStacks)[0];
+	rcDispatchJobs(dispatcher, sortRowsByLevelJob, &job, job.bandCount);
+
+	for (int band = 0; band < job.bandCount; ++band)
+	{
+		for (unsigned int j = 0; j < nbStacks; ++j)
+		{
+			const rcTempVector<LevelStackEntry>& src = job.bandStacks[band * nbStacks + j];
+			for (int k = 0; k < src.size(); ++k)
+				stacks[j].push_back(src[k]);
+		}
+	}
+}
+
 
 static void appendStacks(const rcTempVector<LevelStackEntry>& srcStack,
 						 rcTempVector<LevelStackEntry>& dstStack,
@@ -785,41 +1135,193 @@ static void walkContour(int x, int y, int i, int dir,
 }
 
 
-static bool mergeAndFilterRegions(rcContext* ctx, int minRegionArea, int mergeRegionSize,
-								  unsigned short& maxRegionId,
-								  rcCompactHeightfield& chf,
-								  unsigned short* srcReg, rcIntArray& overlaps)
+/// A pair of regions touching across the border of two watershed bands.
+struct rcBandContact
+{
+	unsigned short lower;	// The region below the band border.
+	unsigned short upper;	// The region above the band border.
+	int length;				// The number of span connections between the two regions across the border.
+};
+
+/// Returns the region a region of a band was merged into, following the regions merged since.
+static unsigned short findBandRegion(const rcTempVector<rcRegion>& regions, unsigned short id)
+{
+	while (regions[id].id != id)
+		id = regions[id].id;
+	return id;
+}
+
+static int compareBandContacts(const void* va, const void* vb)
+{
+	const rcBandContact* a = (const rcBandContact*)va;
+	const rcBandContact* b = (const rcBandContact*)vb;
+	if (a->lower != b->lower)
+		return a->lower < b->lower ? -1 : 1;
+	if (a->upper != b->upper)
+		return a->upper < b->upper ? -1 : 1;
+	return 0;
+}
+
+/// Merges the regions split by the borders of the bands of a banded watershed.
+///
+/// The two parts of a region split by a band border share a long straight border. At each band
+/// border, two regions on either side are merged if each is the neighbour the other shares the
+/// most of the band border with, ties going to the lower id. The result only depends on the
+/// regions, not on the order in which the bands were flooded.
+static void mergeBandRegions(const rcCompactHeightfield& chf, const unsigned short* srcReg, const int bandCount,
+							 rcTempVector<rcRegion>& regions)
 {
 	const int w = chf.width;
-	const int h = chf.height;
-	
-	const int nreg = maxRegionId+1;
-	rcTempVector<rcRegion> regions;
-	if (!regions.reserve(nreg)) {
-		ctx->log(RC_LOG_ERROR, "mergeAndFilterRegions: Out of memory 'regions' (%d).", nreg);
-		return false;
-	}
+	const int nreg = regions.size();
 
-	// Construct regions
-	for (int i = 0; i < nreg; ++i)
-		regions.push_back(rcRegion((unsigned short) i));
-	
-	// Find edge of a region and find connections around the contour.
-	for (int y = 0; y < h; ++y)
+	rcTempVector<rcBandContact> contacts;
+	rcTempVector<int> upperLength(nreg, 0);
+	rcTempVector<int> lowerLength(nreg, 0);
+	rcTempVector<unsigned short> bestUpper(nreg, 0);
+	rcTempVector<unsigned short> bestLower(nreg, 0);
+
+	for (int band = 1; band < bandCount; ++band)
 	{
+		int y0, y1;
+		getBandRows(band, bandCount, chf.height, y0, y1);
+		const int y = y0-1;
+
+		// Collect the connections across the border.
+		contacts.clear();
 		for (int x = 0; x < w; ++x)
 		{
 			const rcCompactCell& c = chf.cells[x+y*w];
 			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
 			{
-				unsigned short r = srcReg[i];
-				if (r == 0 || r >= nreg)
+				const rcCompactSpan& s = chf.spans[i];
+				if (rcGetCon(s, 1) == RC_NOT_CONNECTED)
 					continue;
-				
-				rcRegion& reg = regions[r];
-				reg.spanCount++;
-				
-				// Update floors.
+				const int ai = (int)chf.cells[x+y0*w].index + rcGetCon(s, 1);
+				const unsigned short ra = srcReg[i];
+				const unsigned short rb = srcReg[ai];
+				if (ra == 0 || rb == 0 || ra == rb || ra >= nreg || rb >= nreg ||
+					(ra & RC_BORDER_REG) || (rb & RC_BORDER_REG) || chf.areas[i] != chf.areas[ai])
+					continue;
+				rcBandContact contact;
+				contact.lower = ra;
+				contact.upper = rb;
+				contact.length = 1;
+				contacts.push_back(contact);
+			}
+		}
+		if (contacts.empty())
+			continue;
+
+		// Count the length of the border of each pair.
+		qsort(&contacts[0], contacts.size(), sizeof(rcBandContact), compareBandContacts);
+		int npairs = 0;
+		for (int i = 0; i < (int)contacts.size(); ++i)
+		{
+			if (npairs > 0 && compareBandContacts(&contacts[npairs-1], &contacts[i]) == 0)
+				contacts[npairs-1].length++;
+			else
+				contacts[npairs++] = contacts[i];
+		}
+
+		for (int i = 0; i < npairs; ++i)
+		{
+			const rcBandContact& pair = contacts[i];
+			if (pair.length > upperLength[pair.lower])
+			{
+				upperLength[pair.lower] = pair.length;
+				bestUpper[pair.lower] = pair.upper;
+			}
+			if (pair.length > lowerLength[pair.upper])
+			{
+				lowerLength[pair.upper] = pair.length;
+				bestLower[pair.upper] = pair.lower;
+			}
+		}
+
+		for (int i = 0; i < npairs; ++i)
+		{
+			const rcBandContact& pair = contacts[i];
+			if (bestUpper[pair.lower] != pair.upper || bestLower[pair.upper] != pair.lower)
+				continue;
+
+			// Either part may have been merged at a previous border already.
+			const unsigned short aid = findBandRegion(regions, pair.lower);
+			const unsigned short bid = findBandRegion(regions, pair.upper);
+			if (aid == bid)
+				continue;
+			rcRegion& rega = regions[aid];
+			rcRegion& regb = regions[bid];
+			if (rega.overlap || regb.overlap)
+				continue;
+			if (!canMergeWithRegion(rega, regb) || !canMergeWithRegion(regb, rega))
+				continue;
+			if (!mergeRegions(rega, regb))
+				continue;
+			regb.id = aid;
+
+			// The connections and floors are symmetric, so only the neighbours and floors
+			// taken over from B still refer to it.
+			for (int j = 0; j < rega.connections.size(); ++j)
+			{
+				const int n = rega.connections[j];
+				if (n != 0 && n < nreg)
+					replaceNeighbour(regions[n], bid, aid);
+			}
+			for (int j = 0; j < rega.floors.size(); ++j)
+			{
+				const int n = rega.floors[j];
+				if (n != 0 && n < nreg)
+					replaceNeighbour(regions[n], bid, aid);
+			}
+		}
+
+		for (int i = 0; i < npairs; ++i)
+		{
+			upperLength[contacts[i].lower] = 0;
+			lowerLength[contacts[i].upper] = 0;
+		}
+	}
+
+	for (int i = 0; i < nreg; ++i)
+		regions[i].id = findBandRegion(regions, (unsigned short)i);
+}
+
+static bool mergeAndFilterRegions(rcContext* ctx, int minRegionArea, int mergeRegionSize,
+								  unsigned short& maxRegionId,
+								  rcCompactHeightfield& chf,
+								  unsigned short* srcReg, rcIntArray& overlaps,
+								  const int bandCount = 1)
+{
+	const int w = chf.width;
+	const int h = chf.height;
+	
+	const int nreg = maxRegionId+1;
+	rcTempVector<rcRegion> regions;
+	if (!regions.reserve(nreg)) {
+		ctx->log(RC_LOG_ERROR, "mergeAndFilterRegions: Out of memory 'regions' (%d).", nreg);
+		return false;
+	}
+
+	// Construct regions
+	for (int i = 0; i < nreg; ++i)
+		regions.push_back(rcRegion((unsigned short) i));
+	
+	// Find edge of a region and find connections around the contour.
+	for (int y = 0; y < h; ++y)
+	{
+		for (int x = 0; x < w; ++x)
+		{
+			const rcCompactCell& c = chf.cells[x+y*w];
+			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
+			{
+				unsigned short r = srcReg[i];
+				if (r == 0 || r >= nreg)
+					continue;
+				
+				rcRegion& reg = regions[r];
+				reg.spanCount++;
+				
+				// Update floors.
 				for (int j = (int)c.index; j < ni; ++j)
 				{
 					if (i == j) continue;
@@ -858,6 +1360,10 @@ static bool mergeAndFilterRegions(rcContext* ctx, int minRegionArea, int mergeRe
 		}
 	}
 
+	// Join the regions split by the bands of a banded watershed before their sizes are checked.
+	if (bandCount > 1)
+		mergeBandRegions(chf, srcReg, bandCount, regions);
+
 	// Remove too small regions.
 	rcIntArray stack(32);
 	rcIntArray trace(32);
@@ -1256,6 +1762,11 @@ static bool mergeAndFilterLayerRegions(rcContext* ctx, int minRegionArea,
 ///
 /// @see rcCompactHeightfield, rcBuildRegions, rcBuildRegionsMonotone
 bool rcBuildDistanceField(rcContext* ctx, rcCompactHeightfield& chf)
+{
+	return rcBuildDistanceField(ctx, chf, 0);
+}
+
+bool rcBuildDistanceField(rcContext* ctx, rcCompactHeightfield& chf, rcJobDispatcher* dispatcher)
 {
 	rcAssert(ctx);
 	
@@ -1286,7 +1797,7 @@ bool rcBuildDistanceField(rcContext* ctx, rcCompactHeightfield& chf)
 	{
 		rcScopedTimer timerDist(ctx, RC_TIMER_BUILD_DISTANCEFIELD_DIST);
 
-		calculateDistanceField(chf, src, maxDist);
+		calculateDistanceField(chf, src, maxDist, dispatcher);
 		chf.maxDistance = maxDist;
 	}
 
@@ -1294,7 +1805,7 @@ bool rcBuildDistanceField(rcContext* ctx, rcCompactHeightfield& chf)
 		rcScopedTimer timerBlur(ctx, RC_TIMER_BUILD_DISTANCEFIELD_BLUR);
 
 		// Blur
-		if (boxBlur(chf, 1, src, dst) != src)
+		if (boxBlur(chf, 1, src, dst, dispatcher) != src)
 			rcSwap(src, dst);
 
 		// Store distance.
@@ -1335,73 +1846,19 @@ struct rcSweepSpan
 	unsigned short nei;	// neighbour id
 };
 
-/// @par
-/// 
-/// Non-null regions will consist of connected, non-overlapping walkable spans that form a single contour.
-/// Contours will form simple polygons.
-/// 
-/// If multiple regions form an area that is smaller than @p minRegionArea, then all spans will be
-/// re-assigned to the zero (null) region.
-/// 
-/// Partitioning can result in smaller than necessary regions. @p mergeRegionArea helps 
-/// reduce unnecessarily small regions.
-/// 
-/// See the #rcConfig documentation for more information on the configuration parameters.
-/// 
-/// The region data will be available via the rcCompactHeightfield::maxRegions
-/// and rcCompactSpan::reg fields.
-/// 
-/// @warning The distance field must be created using #rcBuildDistanceField before attempting to build regions.
-/// 
-/// @see rcCompactHeightfield, rcCompactSpan, rcBuildDistanceField, rcBuildRegionsMonotone, rcConfig
-bool rcBuildRegionsMonotone(rcContext* ctx, rcCompactHeightfield& chf,
-							const int borderSize, const int minRegionArea, const int mergeRegionArea)
+/// Sweeps the rows [y0, y1), giving each span the id of the region it continues from the row above or a new id
+/// counted up from @p id. If @p connectFirstRow is false, all the regions of the first row get new ids.
+static void sweepRows(const rcCompactHeightfield& chf, const int borderSize, const int y0, const int y1,
+					  const bool connectFirstRow, unsigned short* srcReg, rcSweepSpan* sweeps, rcIntArray& prev,
+					  unsigned short& id)
 {
-	rcAssert(ctx);
-	
-	rcScopedTimer timer(ctx, RC_TIMER_BUILD_REGIONS);
-	
 	const int w = chf.width;
-	const int h = chf.height;
-	unsigned short id = 1;
-	
-	rcScopedDelete<unsigned short> srcReg((unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount, RC_ALLOC_TEMP));
-	if (!srcReg)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildRegionsMonotone: Out of memory 'src' (%d).", chf.spanCount);
-		return false;
-	}
-	memset(srcReg,0,sizeof(unsigned short)*chf.spanCount);
-
-	const int nsweeps = rcMax(chf.width,chf.height);
-	rcScopedDelete<rcSweepSpan> sweeps((rcSweepSpan*)rcAlloc(sizeof(rcSweepSpan)*nsweeps, RC_ALLOC_TEMP));
-	if (!sweeps)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildRegionsMonotone: Out of memory 'sweeps' (%d).", nsweeps);
-		return false;
-	}
-	
-	
-	// Mark border regions.
-	if (borderSize > 0)
-	{
-		// Make sure border will not overflow.
-		const int bw = rcMin(w, borderSize);
-		const int bh = rcMin(h, borderSize);
-		// Paint regions
-		paintRectRegion(0, bw, 0, h, id|RC_BORDER_REG, chf, srcReg); id++;
-		paintRectRegion(w-bw, w, 0, h, id|RC_BORDER_REG, chf, srcReg); id++;
-		paintRectRegion(0, w, 0, bh, id|RC_BORDER_REG, chf, srcReg); id++;
-		paintRectRegion(0, w, h-bh, h, id|RC_BORDER_REG, chf, srcReg); id++;
-	}
-
-	chf.borderSize = borderSize;
-	
-	rcIntArray prev(256);
 
 	// Sweep one line at a time.
-	for (int y = borderSize; y < h-borderSize; ++y)
+	for (int y = y0; y < y1; ++y)
 	{
+		const bool connectRow = connectFirstRow || y > y0;
+
 		// Collect spans from this row.
 		prev.resize(id+1);
 		memset(&prev[0],0,sizeof(int)*id);
@@ -1436,7 +1893,7 @@ bool rcBuildRegionsMonotone(rcContext* ctx, rcCompactHeightfield& chf,
 				}
 
 				// -y
-				if (rcGetCon(s,3) != RC_NOT_CONNECTED)
+				if (connectRow && rcGetCon(s,3) != RC_NOT_CONNECTED)
 				{
 					const int ax = x + rcGetDirOffsetX(3);
 					const int ay = y + rcGetDirOffsetY(3);
@@ -1487,24 +1944,206 @@ bool rcBuildRegionsMonotone(rcContext* ctx, rcCompactHeightfield& chf,
 			}
 		}
 	}
+}
+
+/// The sweep of a band of rows. The ids of its regions are local to the band until they are remapped.
+struct rcSweepBand
+{
+	int y0, y1;
+	unsigned short firstRowIds;	///< The regions of the first row, they have the ids [1, firstRowIds].
+	unsigned short nextId;		///< The local ids are [1, nextId).
+	unsigned short* map;		///< The final ids of the local ids.
+	bool ok;
+};
+
+struct rcSweepRegionsJob
+{
+	const rcCompactHeightfield* chf;
+	unsigned short* srcReg;
+	rcSweepBand* bands;
+	int borderSize;
+};
+
+static void sweepBandJob(void* userData, const int jobIndex, const int /*workerIndex*/)
+{
+	const rcSweepRegionsJob* job = (const rcSweepRegionsJob*)userData;
+	const rcCompactHeightfield& chf = *job->chf;
+	rcSweepBand& band = job->bands[jobIndex];
+
+	const int nsweeps = rcMax(chf.width,chf.height);
+	rcScopedDelete<rcSweepSpan> sweeps((rcSweepSpan*)rcAlloc(sizeof(rcSweepSpan)*nsweeps, RC_ALLOC_TEMP));
+	band.ok = sweeps != 0;
+	if (!band.ok)
+		return;
+
+	// The row above the band belongs to the previous band, its regions are connected in the merge.
+	rcIntArray prev(256);
+	unsigned short id = 1;
+	sweepRows(chf, job->borderSize, band.y0, band.y0+1, false, job->srcReg, sweeps, prev, id);
+	band.firstRowIds = (unsigned short)(id-1);
+	sweepRows(chf, job->borderSize, band.y0+1, band.y1, true, job->srcReg, sweeps, prev, id);
+	band.nextId = id;
+}
 
+static void remapBandJob(void* userData, const int jobIndex, const int /*workerIndex*/)
+{
+	const rcSweepRegionsJob* job = (const rcSweepRegionsJob*)userData;
+	const rcCompactHeightfield& chf = *job->chf;
+	const rcSweepBand& band = job->bands[jobIndex];
+	const int w = chf.width;
+	unsigned short* srcReg = job->srcReg;
 
+	for (int y = band.y0; y < band.y1; ++y)
 	{
-		rcScopedTimer timerFilter(ctx, RC_TIMER_BUILD_REGIONS_FILTER);
+		for (int x = job->borderSize; x < w-job->borderSize; ++x)
+		{
+			const rcCompactCell& c = chf.cells[x+y*w];
+			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
+			{
+				if (srcReg[i] && (srcReg[i] & RC_BORDER_REG) == 0)
+					srcReg[i] = band.map[srcReg[i]];
+			}
+		}
+	}
+}
 
-		// Merge regions and filter out small regions.
-		rcIntArray overlaps;
-		chf.maxRegions = id;
-		if (!mergeAndFilterRegions(ctx, minRegionArea, mergeRegionArea, chf.maxRegions, chf, srcReg, overlaps))
+/// Gives the regions of the bands their final ids. The bands are visited in order and the first row of each
+/// is connected to the last row of the band above like the serial sweep does, the regions that do not continue
+/// a region of the band above take the next ids in the order they were created.
+static bool mergeSweepBands(const rcCompactHeightfield& chf, const int borderSize, rcSweepBand* bands,
+							const int bandCount, unsigned short* srcReg, unsigned short* maps, unsigned short& id)
+{
+	const int w = chf.width;
+
+	int maxFirstRowIds = 0;
+	for (int b = 0; b < bandCount; ++b)
+		maxFirstRowIds = rcMax(maxFirstRowIds, (int)bands[b].firstRowIds);
+	rcScopedDelete<rcSweepSpan> sweeps((rcSweepSpan*)rcAlloc(sizeof(rcSweepSpan)*(maxFirstRowIds+1), RC_ALLOC_TEMP));
+	if (!sweeps)
+		return false;
+
+	rcIntArray prev(256);
+	unsigned short* map = maps;
+	for (int b = 0; b < bandCount; ++b)
+	{
+		rcSweepBand& band = bands[b];
+		band.map = map;
+		map[0] = 0;
+
+		if (b > 0)
+		{
+			const unsigned short* above = bands[b-1].map;
+			const int y = band.y0;
+			prev.resize(id+1);
+			memset(&prev[0],0,sizeof(int)*id);
+			for (int i = 1; i <= (int)band.firstRowIds; ++i)
+			{
+				sweeps[i].ns = 0;
+				sweeps[i].nei = 0;
+			}
+
+			// -y, in the same span order as the sweep.
+			for (int x = borderSize; x < w-borderSize; ++x)
+			{
+				const rcCompactCell& c = chf.cells[x+y*w];
+				for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
+				{
+					const rcCompactSpan& s = chf.spans[i];
+					if (chf.areas[i] == RC_NULL_AREA) continue;
+					if (rcGetCon(s,3) == RC_NOT_CONNECTED) continue;
+
+					const unsigned short rid = srcReg[i];
+					const int ax = x + rcGetDirOffsetX(3);
+					const int ay = y + rcGetDirOffsetY(3);
+					const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, 3);
+					if (srcReg[ai] && (srcReg[ai] & RC_BORDER_REG) == 0 && chf.areas[i] == chf.areas[ai])
+					{
+						const unsigned short nr = above[srcReg[ai]];
+						if (!sweeps[rid].nei || sweeps[rid].nei == nr)
+						{
+							sweeps[rid].nei = nr;
+							sweeps[rid].ns++;
+							prev[nr]++;
+						}
+						else
+						{
+							sweeps[rid].nei = RC_NULL_NEI;
+						}
+					}
+				}
+			}
+		}
+
+		for (int i = 1; i < (int)band.nextId; ++i)
+		{
+			if (b > 0 && i <= (int)band.firstRowIds &&
+				sweeps[i].nei != RC_NULL_NEI && sweeps[i].nei != 0 &&
+				prev[sweeps[i].nei] == (int)sweeps[i].ns)
+			{
+				map[i] = sweeps[i].nei;
+			}
+			else
+			{
+				map[i] = id++;
+			}
+		}
+		map += band.nextId;
+	}
+	return true;
+}
+
+/// Sweeps the rows inside the border, giving the spans monotone region ids counted up from @p id.
+/// With a dispatcher, bands of rows are swept by separate jobs and merged into the ids of the serial sweep.
+static bool sweepRegions(const rcCompactHeightfield& chf, const int borderSize, unsigned short* srcReg,
+						 unsigned short& id, rcJobDispatcher* dispatcher)
+{
+	const int y0 = borderSize;
+	const int y1 = chf.height-borderSize;
+	const int bandCount = getBandCount(dispatcher, y1-y0);
+	if (bandCount <= 1)
+	{
+		const int nsweeps = rcMax(chf.width,chf.height);
+		rcScopedDelete<rcSweepSpan> sweeps((rcSweepSpan*)rcAlloc(sizeof(rcSweepSpan)*nsweeps, RC_ALLOC_TEMP));
+		if (!sweeps)
 			return false;
+		rcIntArray prev(256);
+		sweepRows(chf, borderSize, y0, y1, true, srcReg, sweeps, prev, id);
+		return true;
+	}
 
-		// Monotone partitioning does not generate overlapping regions.
+	rcScopedDelete<rcSweepBand> bands((rcSweepBand*)rcAlloc(sizeof(rcSweepBand)*bandCount, RC_ALLOC_TEMP));
+	if (!bands)
+		return false;
+	for (int b = 0; b < bandCount; ++b)
+	{
+		getBandRows(b, bandCount, y1-y0, bands[b].y0, bands[b].y1);
+		bands[b].y0 += y0;
+		bands[b].y1 += y0;
+		bands[b].firstRowIds = 0;
+		bands[b].nextId = 1;
+		bands[b].map = 0;
+		bands[b].ok = false;
 	}
-	
-	// Store the result out.
-	for (int i = 0; i < chf.spanCount; ++i)
-		chf.spans[i].reg = srcReg[i];
 
+	rcSweepRegionsJob job;
+	job.chf = &chf;
+	job.srcReg = srcReg;
+	job.bands = bands;
+	job.borderSize = borderSize;
+	rcDispatchJobs(dispatcher, sweepBandJob, &job, bandCount);
+
+	int mapSize = 0;
+	for (int b = 0; b < bandCount; ++b)
+	{
+		if (!bands[b].ok)
+			return false;
+		mapSize += bands[b].nextId;
+	}
+	rcScopedDelete<unsigned short> maps((unsigned short*)rcAlloc(sizeof(unsigned short)*mapSize, RC_ALLOC_TEMP));
+	if (!maps || !mergeSweepBands(chf, borderSize, bands, bandCount, srcReg, maps, id))
+		return false;
+
+	rcDispatchJobs(dispatcher, remapBandJob, &job, bandCount);
 	return true;
 }
 
@@ -1516,8 +2155,8 @@ bool rcBuildRegionsMonotone(rcContext* ctx, rcCompactHeightfield& chf,
 /// If multiple regions form an area that is smaller than @p minRegionArea, then all spans will be
 /// re-assigned to the zero (null) region.
 /// 
-/// Watershed partitioning can result in smaller than necessary regions, especially in diagonal corridors. 
-/// @p mergeRegionArea helps reduce unnecessarily small regions.
+/// Partitioning can result in smaller than necessary regions. @p mergeRegionArea helps 
+/// reduce unnecessarily small regions.
 /// 
 /// See the #rcConfig documentation for more information on the configuration parameters.
 /// 
@@ -1527,8 +2166,15 @@ bool rcBuildRegionsMonotone(rcContext* ctx, rcCompactHeightfield& chf,
 /// @warning The distance field must be created using #rcBuildDistanceField before attempting to build regions.
 /// 
 /// @see rcCompactHeightfield, rcCompactSpan, rcBuildDistanceField, rcBuildRegionsMonotone, rcConfig
-bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
-					const int borderSize, const int minRegionArea, const int mergeRegionArea)
+bool rcBuildRegionsMonotone(rcContext* ctx, rcCompactHeightfield& chf,
+							const int borderSize, const int minRegionArea, const int mergeRegionArea)
+{
+	return rcBuildRegionsMonotone(ctx, chf, borderSize, minRegionArea, mergeRegionArea, 0);
+}
+
+bool rcBuildRegionsMonotone(rcContext* ctx, rcCompactHeightfield& chf,
+							const int borderSize, const int minRegionArea, const int mergeRegionArea,
+							rcJobDispatcher* dispatcher)
 {
 	rcAssert(ctx);
 	
@@ -1536,55 +2182,100 @@ bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
 	
 	const int w = chf.width;
 	const int h = chf.height;
+	unsigned short id = 1;
 	
-	rcScopedDelete<unsigned short> buf((unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount*2, RC_ALLOC_TEMP));
-	if (!buf)
+	rcScopedDelete<unsigned short> srcReg((unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount, RC_ALLOC_TEMP));
+	if (!srcReg)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildRegions: Out of memory 'tmp' (%d).", chf.spanCount*4);
+		ctx->log(RC_LOG_ERROR, "rcBuildRegionsMonotone: Out of memory 'src' (%d).", chf.spanCount);
 		return false;
 	}
-	
-	ctx->startTimer(RC_TIMER_BUILD_REGIONS_WATERSHED);
-
-	const int LOG_NB_STACKS = 3;
-	const int NB_STACKS = 1 << LOG_NB_STACKS;
-	rcTempVector<LevelStackEntry> lvlStacks[NB_STACKS];
-	for (int i=0; i<NB_STACKS; ++i)
-		lvlStacks[i].reserve(256);
-
-	rcTempVector<LevelStackEntry> stack;
-	stack.reserve(256);
-	
-	unsigned short* srcReg = buf;
-	unsigned short* srcDist = buf+chf.spanCount;
-	
-	memset(srcReg, 0, sizeof(unsigned short)*chf.spanCount);
-	memset(srcDist, 0, sizeof(unsigned short)*chf.spanCount);
-	
-	unsigned short regionId = 1;
-	unsigned short level = (chf.maxDistance+1) & ~1;
-
-	// TODO: Figure better formula, expandIters defines how much the 
-	// watershed "overflows" and simplifies the regions. Tying it to
-	// agent radius was usually good indication how greedy it could be.
-//	const int expandIters = 4 + walkableRadius * 2;
-	const int expandIters = 8;
+	memset(srcReg,0,sizeof(unsigned short)*chf.spanCount);
 
+	// Mark border regions.
 	if (borderSize > 0)
 	{
 		// Make sure border will not overflow.
 		const int bw = rcMin(w, borderSize);
 		const int bh = rcMin(h, borderSize);
-		
 		// Paint regions
-		paintRectRegion(0, bw, 0, h, regionId|RC_BORDER_REG, chf, srcReg); regionId++;
-		paintRectRegion(w-bw, w, 0, h, regionId|RC_BORDER_REG, chf, srcReg); regionId++;
-		paintRectRegion(0, w, 0, bh, regionId|RC_BORDER_REG, chf, srcReg); regionId++;
-		paintRectRegion(0, w, h-bh, h, regionId|RC_BORDER_REG, chf, srcReg); regionId++;
+		paintRectRegion(0, bw, 0, h, id|RC_BORDER_REG, chf, srcReg); id++;
+		paintRectRegion(w-bw, w, 0, h, id|RC_BORDER_REG, chf, srcReg); id++;
+		paintRectRegion(0, w, 0, bh, id|RC_BORDER_REG, chf, srcReg); id++;
+		paintRectRegion(0, w, h-bh, h, id|RC_BORDER_REG, chf, srcReg); id++;
 	}
 
 	chf.borderSize = borderSize;
 	
+	if (!sweepRegions(chf, borderSize, srcReg, id, dispatcher))
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildRegionsMonotone: Out of memory 'sweeps'.");
+		return false;
+	}
+
+	{
+		rcScopedTimer timerFilter(ctx, RC_TIMER_BUILD_REGIONS_FILTER);
+
+		// Merge regions and filter out small regions.
+		rcIntArray overlaps;
+		chf.maxRegions = id;
+		if (!mergeAndFilterRegions(ctx, minRegionArea, mergeRegionArea, chf.maxRegions, chf, srcReg, overlaps))
+			return false;
+
+		// Monotone partitioning does not generate overlapping regions.
+	}
+	
+	// Store the result out.
+	for (int i = 0; i < chf.spanCount; ++i)
+		chf.spans[i].reg = srcReg[i];
+
+	return true;
+}
+
+/// @par
+/// 
+/// Non-null regions will consist of connected, non-overlapping walkable spans that form a single contour.
+/// Contours will form simple polygons.
+/// 
+/// If multiple regions form an area that is smaller than @p minRegionArea, then all spans will be
+/// re-assigned to the zero (null) region.
+/// 
+/// Watershed partitioning can result in smaller than necessary regions, especially in diagonal corridors. 
+/// @p mergeRegionArea helps reduce unnecessarily small regions.
+/// 
+/// See the #rcConfig documentation for more information on the configuration parameters.
+/// 
+/// The region data will be available via the rcCompactHeightfield::maxRegions
+/// and rcCompactSpan::reg fields.
+/// 
+/// @warning The distance field must be created using #rcBuildDistanceField before attempting to build regions.
+/// 
+/// @see rcCompactHeightfield, rcCompactSpan, rcBuildDistanceField, rcBuildRegionsMonotone, rcConfig
+/// The number of rows of a band of the watershed flooded by separate jobs.
+static const int RC_WATERSHED_BAND_ROWS = 64;
+
+/// Floods the levels of the distance field within the rows [y0, y1), giving the new regions
+/// the ids from @p regionId up to @p maxRegionId.
+static bool floodLevels(rcContext* ctx, rcCompactHeightfield& chf,
+						unsigned short* srcReg, unsigned short* srcDist,
+						const int y0, const int y1, const int expandIters,
+						unsigned short& regionId, const unsigned short maxRegionId,
+						rcJobDispatcher* dispatcher)
+{
+	const int LOG_NB_STACKS = 3;
+	const int NB_STACKS = 1 << LOG_NB_STACKS;
+	rcTempVector<LevelStackEntry> lvlStacks[NB_STACKS];
+	for (int i=0; i<NB_STACKS; ++i)
+		lvlStacks[i].reserve(256);
+
+	rcTempVector<LevelStackEntry> stack;
+	stack.reserve(256);
+
+	// Scratch stacks for sorting the cells in row bands.
+	rcTempVector<rcTempVector<LevelStackEntry> > bandStacks;
+
+	unsigned short level = (chf.maxDistance+1) & ~1;
+
 	int sId = -1;
 	while (level > 0)
 	{
@@ -1594,7 +2285,7 @@ bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
 //		ctx->startTimer(RC_TIMER_DIVIDE_TO_LEVELS);
 
 		if (sId == 0)
-			sortCellsByLevel(level, chf, srcReg, NB_STACKS, lvlStacks, 1);
+			sortCellsByLevel(level, chf, srcReg, NB_STACKS, lvlStacks, 1, y0, y1, dispatcher, &bandStacks);
 		else 
 			appendStacks(lvlStacks[sId-1], lvlStacks[sId], srcReg); // copy left overs from last level
 
@@ -1604,7 +2295,7 @@ bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
 			rcScopedTimer timerExpand(ctx, RC_TIMER_BUILD_REGIONS_EXPAND);
 
 			// Expand current regions until no empty connected cells found.
-			expandRegions(expandIters, level, chf, srcReg, srcDist, lvlStacks[sId], false);
+			expandRegions(expandIters, level, chf, srcReg, srcDist, lvlStacks[sId], false, y0, y1, dispatcher);
 		}
 		
 		{
@@ -1619,9 +2310,9 @@ bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
 				int i = current.index;
 				if (i >= 0 && srcReg[i] == 0)
 				{
-					if (floodRegion(x, y, i, level, regionId, chf, srcReg, srcDist, stack))
+					if (floodRegion(x, y, i, level, regionId, chf, srcReg, srcDist, y0, y1, stack))
 					{
-						if (regionId == 0xFFFF)
+						if (regionId == maxRegionId)
 						{
 							ctx->log(RC_LOG_ERROR, "rcBuildRegions: Region ID overflow");
 							return false;
@@ -1635,7 +2326,155 @@ bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
 	}
 	
 	// Expand current regions until no empty connected cells found.
-	expandRegions(expandIters*8, 0, chf, srcReg, srcDist, stack, true);
+	expandRegions(expandIters*8, 0, chf, srcReg, srcDist, stack, true, y0, y1, dispatcher);
+
+	return true;
+}
+
+struct rcWatershedJob
+{
+	rcCompactHeightfield* chf;
+	unsigned short* srcReg;
+	unsigned short* srcDist;
+	int bandCount;
+	int expandIters;
+	int* regionCounts;			// The number of regions of each band, -1 if the band overflowed. [Size: bandCount]
+	unsigned short* firstIds;	// The first region id of each band. [Size: bandCount]
+};
+
+static void floodWatershedBandJob(void* userData, const int jobIndex, const int /*workerIndex*/)
+{
+	rcWatershedJob* job = (rcWatershedJob*)userData;
+	int y0, y1;
+	getBandRows(jobIndex, job->bandCount, job->chf->height, y0, y1);
+
+	// The local ids must stay clear of the border flag until they are offset.
+	rcContext ctx(false);
+	unsigned short regionId = 1;
+	if (floodLevels(&ctx, *job->chf, job->srcReg, job->srcDist, y0, y1, job->expandIters, regionId,
+					(unsigned short)(RC_BORDER_REG-1), 0))
+		job->regionCounts[jobIndex] = regionId - 1;
+	else
+		job->regionCounts[jobIndex] = -1;
+}
+
+static void offsetWatershedBandJob(void* userData, const int jobIndex, const int /*workerIndex*/)
+{
+	const rcWatershedJob* job = (const rcWatershedJob*)userData;
+	const rcCompactHeightfield& chf = *job->chf;
+	int y0, y1;
+	getBandRows(jobIndex, job->bandCount, chf.height, y0, y1);
+	const int offset = job->firstIds[jobIndex] - 1;
+	for (int y = y0; y < y1; ++y)
+	{
+		for (int x = 0; x < chf.width; ++x)
+		{
+			const rcCompactCell& c = chf.cells[x+y*chf.width];
+			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
+			{
+				const unsigned short r = job->srcReg[i];
+				if (r != 0 && (r & RC_BORDER_REG) == 0)
+					job->srcReg[i] = (unsigned short)(r + offset);
+			}
+		}
+	}
+}
+
+bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
+					const int borderSize, const int minRegionArea, const int mergeRegionArea)
+{
+	return rcBuildRegions(ctx, chf, borderSize, minRegionArea, mergeRegionArea, 0);
+}
+
+bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
+					const int borderSize, const int minRegionArea, const int mergeRegionArea,
+					rcJobDispatcher* dispatcher)
+{
+	rcAssert(ctx);
+	
+	rcScopedTimer timer(ctx, RC_TIMER_BUILD_REGIONS);
+	
+	const int w = chf.width;
+	const int h = chf.height;
+	
+	rcScopedDelete<unsigned short> buf((unsigned short*)rcAlloc(sizeof(unsigned short)*chf.spanCount*2, RC_ALLOC_TEMP));
+	if (!buf)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildRegions: Out of memory 'tmp' (%d).", chf.spanCount*4);
+		return false;
+	}
+	
+	ctx->startTimer(RC_TIMER_BUILD_REGIONS_WATERSHED);
+
+	unsigned short* srcReg = buf;
+	unsigned short* srcDist = buf+chf.spanCount;
+	
+	memset(srcReg, 0, sizeof(unsigned short)*chf.spanCount);
+	memset(srcDist, 0, sizeof(unsigned short)*chf.spanCount);
+	
+	unsigned short regionId = 1;
+
+	// TODO: Figure better formula, expandIters defines how much the 
+	// watershed "overflows" and simplifies the regions. Tying it to
+	// agent radius was usually good indication how greedy it could be.
+//	const int expandIters = 4 + walkableRadius * 2;
+	const int expandIters = 8;
+
+	if (borderSize > 0)
+	{
+		// Make sure border will not overflow.
+		const int bw = rcMin(w, borderSize);
+		const int bh = rcMin(h, borderSize);
+		
+		// Paint regions
+		paintRectRegion(0, bw, 0, h, regionId|RC_BORDER_REG, chf, srcReg); regionId++;
+		paintRectRegion(w-bw, w, 0, h, regionId|RC_BORDER_REG, chf, srcReg); regionId++;
+		paintRectRegion(0, w, 0, bh, regionId|RC_BORDER_REG, chf, srcReg); regionId++;
+		paintRectRegion(0, w, h-bh, h, regionId|RC_BORDER_REG, chf, srcReg); regionId++;
+	}
+
+	chf.borderSize = borderSize;
+
+	// The bands only depend on the size of the heightfield, so that the regions do not
+	// depend on the number of workers.
+	const int bandCount = dispatcher ? rcMax(1, h / RC_WATERSHED_BAND_ROWS) : 1;
+	if (bandCount == 1)
+	{
+		if (!floodLevels(ctx, chf, srcReg, srcDist, 0, h, expandIters, regionId, 0xFFFF, dispatcher))
+			return false;
+	}
+	else
+	{
+		// Flood the bands with local region ids, then give each band its own range of ids.
+		rcTempVector<int> regionCounts(bandCount, 0);
+		rcTempVector<unsigned short> firstIds(bandCount, 0);
+
+		rcWatershedJob job;
+		job.chf = &chf;
+		job.srcReg = srcReg;
+		job.srcDist = srcDist;
+		job.bandCount = bandCount;
+		job.expandIters = expandIters;
+		job.regionCounts = &regionCounts[0];
+		job.firstIds = &firstIds[0];
+		rcDispatchJobs(dispatcher, floodWatershedBandJob, &job, bandCount);
+
+		for (int band = 0; band < bandCount; ++band)
+		{
+			if (regionCounts[band] < 0 || (int)regionId + regionCounts[band] > 0xFFFF)
+			{
+				ctx->log(RC_LOG_ERROR, "rcBuildRegions: Region ID overflow");
+				return false;
+			}
+			firstIds[band] = regionId;
+			regionId = (unsigned short)(regionId + regionCounts[band]);
+		}
+		rcDispatchJobs(dispatcher, offsetWatershedBandJob, &job, bandCount);
+
+		// Expand the regions across the band borders into the cells left empty.
+		rcTempVector<LevelStackEntry> stack;
+		expandRegions(expandIters*8, 0, chf, srcReg, srcDist, stack, true, 0, h, dispatcher);
+	}
 	
 	ctx->stopTimer(RC_TIMER_BUILD_REGIONS_WATERSHED);
 	
@@ -1645,7 +2484,7 @@ bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
 		// Merge regions and filter out small regions.
 		rcIntArray overlaps;
 		chf.maxRegions = regionId;
-		if (!mergeAndFilterRegions(ctx, minRegionArea, mergeRegionArea, chf.maxRegions, chf, srcReg, overlaps))
+		if (!mergeAndFilterRegions(ctx, minRegionArea, mergeRegionArea, chf.maxRegions, chf, srcReg, overlaps, bandCount))
 			return false;
 
 		// If overlapping regions were found during merging, split those regions.
@@ -1665,6 +2504,12 @@ bool rcBuildRegions(rcContext* ctx, rcCompactHeightfield& chf,
 
 bool rcBuildLayerRegions(rcContext* ctx, rcCompactHeightfield& chf,
 						 const int borderSize, const int minRegionArea)
+{
+	return rcBuildLayerRegions(ctx, chf, borderSize, minRegionArea, 0);
+}
+
+bool rcBuildLayerRegions(rcContext* ctx, rcCompactHeightfield& chf,
+						 const int borderSize, const int minRegionArea, rcJobDispatcher* dispatcher)
 {
 	rcAssert(ctx);
 	
@@ -1682,15 +2527,6 @@ bool rcBuildLayerRegions(rcContext* ctx, rcCompactHeightfield& chf,
 	}
 	memset(srcReg,0,sizeof(unsigned short)*chf.spanCount);
 	
-	const int nsweeps = rcMax(chf.width,chf.height);
-	rcScopedDelete<rcSweepSpan> sweeps((rcSweepSpan*)rcAlloc(sizeof(rcSweepSpan)*nsweeps, RC_ALLOC_TEMP));
-	if (!sweeps)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildLayerRegions: Out of memory 'sweeps' (%d).", nsweeps);
-		return false;
-	}
-	
-	
 	// Mark border regions.
 	if (borderSize > 0)
 	{
@@ -1706,98 +2542,12 @@ bool rcBuildLayerRegions(rcContext* ctx, rcCompactHeightfield& chf,
 
 	chf.borderSize = borderSize;
 	
-	rcIntArray prev(256);
-	
-	// Sweep one line at a time.
-	for (int y = borderSize; y < h-borderSize; ++y)
+	if (!sweepRegions(chf, borderSize, srcReg, id, dispatcher))
 	{
-		// Collect spans from this row.
-		prev.resize(id+1);
-		memset(&prev[0],0,sizeof(int)*id);
-		unsigned short rid = 1;
-		
-		for (int x = borderSize; x < w-borderSize; ++x)
-		{
-			const rcCompactCell& c = chf.cells[x+y*w];
-			
-			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
-			{
-				const rcCompactSpan& s = chf.spans[i];
-				if (chf.areas[i] == RC_NULL_AREA) continue;
-				
-				// -x
-				unsigned short previd = 0;
-				if (rcGetCon(s, 0) != RC_NOT_CONNECTED)
-				{
-					const int ax = x + rcGetDirOffsetX(0);
-					const int ay = y + rcGetDirOffsetY(0);
-					const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, 0);
-					if ((srcReg[ai] & RC_BORDER_REG) == 0 && chf.areas[i] == chf.areas[ai])
-						previd = srcReg[ai];
-				}
-				
-				if (!previd)
-				{
-					previd = rid++;
-					sweeps[previd].rid = previd;
-					sweeps[previd].ns = 0;
-					sweeps[previd].nei = 0;
-				}
-				
-				// -y
-				if (rcGetCon(s,3) != RC_NOT_CONNECTED)
-				{
-					const int ax = x + rcGetDirOffsetX(3);
-					const int ay = y + rcGetDirOffsetY(3);
-					const int ai = (int)chf.cells[ax+ay*w].index + rcGetCon(s, 3);
-					if (srcReg[ai] && (srcReg[ai] & RC_BORDER_REG) == 0 && chf.areas[i] == chf.areas[ai])
-					{
-						unsigned short nr = srcReg[ai];
-						if (!sweeps[previd].nei || sweeps[previd].nei == nr)
-						{
-							sweeps[previd].nei = nr;
-							sweeps[previd].ns++;
-							prev[nr]++;
-						}
-						else
-						{
-							sweeps[previd].nei = RC_NULL_NEI;
-						}
-					}
-				}
-				
-				srcReg[i] = previd;
-			}
-		}
-		
-		// Create unique ID.
-		for (int i = 1; i < rid; ++i)
-		{
-			if (sweeps[i].nei != RC_NULL_NEI && sweeps[i].nei != 0 &&
-				prev[sweeps[i].nei] == (int)sweeps[i].ns)
-			{
-				sweeps[i].id = sweeps[i].nei;
-			}
-			else
-			{
-				sweeps[i].id = id++;
-			}
-		}
-		
-		// Remap IDs
-		for (int x = borderSize; x < w-borderSize; ++x)
-		{
-			const rcCompactCell& c = chf.cells[x+y*w];
-			
-			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
-			{
-				if (srcReg[i] > 0 && srcReg[i] < rid)
-					srcReg[i] = sweeps[srcReg[i]].id;
-			}
-		}
+		ctx->log(RC_LOG_ERROR, "rcBuildLayerRegions: Out of memory 'sweeps'.");
+		return false;
 	}
-	
-	
+
 	{
 		rcScopedTimer timerFilter(ctx, RC_TIMER_BUILD_REGIONS_FILTER);
 
@@ -0,0 +1,292 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <string.h>
+#include "RecastTileBake.h"
+#include "RecastAssert.h"
+
+namespace
+{
+/// Writes little-endian values to a buffer whose size was checked by the caller.
+struct Writer
+{
+	unsigned char* p;
+
+	void u32(const unsigned int v)
+	{
+		p[0] = (unsigned char)(v & 0xff);
+		p[1] = (unsigned char)((v >> 8) & 0xff);
+		p[2] = (unsigned char)((v >> 16) & 0xff);
+		p[3] = (unsigned char)((v >> 24) & 0xff);
+		p += 4;
+	}
+
+	void i32(const int v) { u32((unsigned int)v); }
+
+	void f32(const float v)
+	{
+		unsigned int bits;
+		memcpy(&bits, &v, sizeof(bits));
+		u32(bits);
+	}
+
+	void u64(const uint64_t v)
+	{
+		u32((unsigned int)(v & 0xffffffffu));
+		u32((unsigned int)(v >> 32));
+	}
+};
+
+/// Reads little-endian values from a buffer whose size was checked by the caller.
+struct Reader
+{
+	const unsigned char* p;
+
+	unsigned int u32()
+	{
+		const unsigned int v = (unsigned int)p[0] | ((unsigned int)p[1] << 8) |
+			((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+		p += 4;
+		return v;
+	}
+
+	int i32() { return (int)u32(); }
+
+	float f32()
+	{
+		const unsigned int bits = u32();
+		float v;
+		memcpy(&v, &bits, sizeof(v));
+		return v;
+	}
+
+	uint64_t u64()
+	{
+		const uint64_t lo = u32();
+		const uint64_t hi = u32();
+		return lo | (hi << 32);
+	}
+};
+
+bool isValidJob(const rcTileBakeJob& job)
+{
+	return job.chunkCount >= 0 && job.chunkCount <= RC_TILEBAKE_MAX_CHUNKS;
+}
+
+/// Writes the job, the buffer must hold rcGetTileBakeJobSize bytes.
+void writeJob(const rcTileBakeJob& job, unsigned char* data)
+{
+	const rcConfig& cfg = job.buildCfg.cfg;
+	Writer w = { data };
+	w.i32(RC_TILEBAKE_JOB_MAGIC);
+	w.i32(RC_TILEBAKE_VERSION);
+	w.i32(job.tx);
+	w.i32(job.ty);
+	w.i32(cfg.tileSize);
+	w.i32(cfg.borderSize);
+	w.f32(cfg.cs);
+	w.f32(cfg.ch);
+	for (int i = 0; i < 3; ++i)
+		w.f32(cfg.bmin[i]);
+	for (int i = 0; i < 3; ++i)
+		w.f32(cfg.bmax[i]);
+	w.f32(cfg.walkableSlopeAngle);
+	w.i32(cfg.walkableHeight);
+	w.i32(cfg.walkableClimb);
+	w.i32(cfg.walkableRadius);
+	w.i32(cfg.maxEdgeLen);
+	w.f32(cfg.maxSimplificationError);
+	w.i32(cfg.minRegionArea);
+	w.i32(cfg.mergeRegionArea);
+	w.i32(cfg.maxVertsPerPoly);
+	w.f32(cfg.detailSampleDist);
+	w.f32(cfg.detailSampleMaxError);
+	w.i32(job.buildCfg.partitionType);
+	w.i32(job.buildCfg.filterFlags);
+	w.i32(job.buildCfg.buildEdgeClearance ? 1 : 0);
+	w.u64(job.settingsHash);
+	w.i32(job.chunkCount);
+	rcAssert(w.p - data == RC_TILEBAKE_JOB_BASE_SIZE);
+	for (int i = 0; i < job.chunkCount; ++i)
+		w.u64(job.chunkHashes[i]);
+}
+} // anonymous namespace
+
+uint64_t rcHashData64Init()
+{
+	return ((uint64_t)0xcbf29ce4u << 32) | 0x84222325u;
+}
+
+uint64_t rcHashData64(const void* data, const int size, uint64_t hash)
+{
+	const uint64_t prime = ((uint64_t)0x100u << 32) | 0x1b3u;
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (int i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= prime;
+	}
+	return hash;
+}
+
+int rcGetTileBakeJobSize(const rcTileBakeJob& job)
+{
+	return RC_TILEBAKE_JOB_BASE_SIZE + rcMax(job.chunkCount, 0) * 8;
+}
+
+bool rcWriteTileBakeJob(const rcTileBakeJob& job, unsigned char* data, const int dataSize, int* outDataSize)
+{
+	const int size = rcGetTileBakeJobSize(job);
+	if (!isValidJob(job) || !data || dataSize < size)
+		return false;
+	writeJob(job, data);
+	if (outDataSize)
+		*outDataSize = size;
+	return true;
+}
+
+bool rcReadTileBakeJob(const unsigned char* data, const int dataSize, rcTileBakeJob& job)
+{
+	if (!data || dataSize < RC_TILEBAKE_JOB_BASE_SIZE)
+		return false;
+
+	memset(&job, 0, sizeof(job));
+	rcConfig& cfg = job.buildCfg.cfg;
+	Reader r = { data };
+	if (r.i32() != RC_TILEBAKE_JOB_MAGIC)
+		return false;
+	if (r.i32() != RC_TILEBAKE_VERSION)
+		return false;
+	job.tx = r.i32();
+	job.ty = r.i32();
+	cfg.tileSize = r.i32();
+	cfg.borderSize = r.i32();
+	cfg.cs = r.f32();
+	cfg.ch = r.f32();
+	for (int i = 0; i < 3; ++i)
+		cfg.bmin[i] = r.f32();
+	for (int i = 0; i < 3; ++i)
+		cfg.bmax[i] = r.f32();
+	cfg.walkableSlopeAngle = r.f32();
+	cfg.walkableHeight = r.i32();
+	cfg.walkableClimb = r.i32();
+	cfg.walkableRadius = r.i32();
+	cfg.maxEdgeLen = r.i32();
+	cfg.maxSimplificationError = r.f32();
+	cfg.minRegionArea = r.i32();
+	cfg.mergeRegionArea = r.i32();
+	cfg.maxVertsPerPoly = r.i32();
+	cfg.detailSampleDist = r.f32();
+	cfg.detailSampleMaxError = r.f32();
+	job.buildCfg.partitionType = r.i32();
+	job.buildCfg.filterFlags = r.i32();
+	job.buildCfg.buildEdgeClearance = r.i32() != 0;
+	job.settingsHash = r.u64();
+	job.chunkCount = r.i32();
+	if (!isValidJob(job) || dataSize != rcGetTileBakeJobSize(job))
+		return false;
+	for (int i = 0; i < job.chunkCount; ++i)
+		job.chunkHashes[i] = r.u64();
+	return true;
+}
+
+uint64_t rcCalcTileBakeKey(const rcTileBakeJob& job)
+{
+	if (!isValidJob(job))
+		return 0;
+	unsigned char data[RC_TILEBAKE_JOB_BASE_SIZE + RC_TILEBAKE_MAX_CHUNKS * 8];
+	writeJob(job, data);
+	return rcHashData64(data, rcGetTileBakeJobSize(job), rcHashData64Init());
+}
+
+bool rcBakeTile(rcContext* context, const rcTileBakeJob& job, rcTileBuildCallbacks& callbacks,
+				rcTileBakeBlobHeader& header, unsigned char** outData, int* outDataSize)
+{
+	rcAssert(context);
+	rcAssert(outData && outDataSize);
+
+	*outData = 0;
+	*outDataSize = 0;
+	if (!isValidJob(job))
+	{
+		context->log(RC_LOG_ERROR, "rcBakeTile: Invalid chunk count (%d).", job.chunkCount);
+		return false;
+	}
+
+	if (!rcBuildTile(context, job.buildCfg, job.tx, job.ty, callbacks, outData, outDataSize))
+		return false;
+	if (!*outData)
+		*outDataSize = 0;
+
+	memset(&header, 0, sizeof(header));
+	header.magic = RC_TILEBAKE_BLOB_MAGIC;
+	header.version = RC_TILEBAKE_VERSION;
+	header.key = rcCalcTileBakeKey(job);
+	header.tx = job.tx;
+	header.ty = job.ty;
+	header.dataSize = *outDataSize;
+	header.dataHash = rcHashData64(*outData, *outDataSize, rcHashData64Init());
+	return true;
+}
+
+bool rcWriteTileBakeBlobHeader(const rcTileBakeBlobHeader& header, unsigned char* data, const int dataSize)
+{
+	if (!data || dataSize < RC_TILEBAKE_BLOB_HEADER_SIZE)
+		return false;
+	Writer w = { data };
+	w.i32(header.magic);
+	w.i32(header.version);
+	w.u64(header.key);
+	w.i32(header.tx);
+	w.i32(header.ty);
+	w.i32(header.dataSize);
+	w.u32(0); // Reserved, keeps the tile data 8-byte aligned in the blob.
+	w.u64(header.dataHash);
+	rcAssert(w.p - data == RC_TILEBAKE_BLOB_HEADER_SIZE);
+	return true;
+}
+
+bool rcReadTileBakeBlob(const unsigned char* blob, const int blobSize, rcTileBakeBlobHeader& header,
+						const unsigned char** data)
+{
+	rcAssert(data);
+
+	*data = 0;
+	if (!blob || blobSize < RC_TILEBAKE_BLOB_HEADER_SIZE)
+		return false;
+	Reader r = { blob };
+	header.magic = r.i32();
+	header.version = r.i32();
+	header.key = r.u64();
+	header.tx = r.i32();
+	header.ty = r.i32();
+	header.dataSize = r.i32();
+	const unsigned int reserved = r.u32();
+	header.dataHash = r.u64();
+	if (header.magic != RC_TILEBAKE_BLOB_MAGIC || header.version != RC_TILEBAKE_VERSION || reserved != 0)
+		return false;
+	if (header.dataSize < 0 || header.dataSize != blobSize - RC_TILEBAKE_BLOB_HEADER_SIZE)
+		return false;
+
+	const unsigned char* tileData = blob + RC_TILEBAKE_BLOB_HEADER_SIZE;
+	if (rcHashData64(tileData, header.dataSize, rcHashData64Init()) != header.dataHash)
+		return false;
+	if (header.dataSize > 0)
+		*data = tileData;
+	return true;
+}
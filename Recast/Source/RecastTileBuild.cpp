@@ -0,0 +1,1109 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "RecastTileBuild.h"
+#include "Recast.h"
+#include "RecastAlloc.h"
+#include "RecastAssert.h"
+
+#include <string.h>
+
+namespace
+{
+/// The intermediate results of a tile build, freed when going out of scope.
+/// A worker keeps its scratch between tiles, so that each build reuses the buffers of the previous one.
+struct rcTileBuildScratch
+{
+	rcTileBuildScratch() : solid(0), chf(0), cset(0), pmesh(0), dmesh(0) {}
+	~rcTileBuildScratch()
+	{
+		rcFreeHeightField(solid);
+		rcFreeCompactHeightfield(chf);
+		rcFreeContourSet(cset);
+		rcFreePolyMesh(pmesh);
+		rcFreePolyMeshDetail(dmesh);
+	}
+
+	/// Allocates the objects that are still missing.
+	bool init()
+	{
+		if (!solid)
+			solid = rcAllocHeightfield();
+		if (!chf)
+			chf = rcAllocCompactHeightfield();
+		if (!cset)
+			cset = rcAllocContourSet();
+		if (!pmesh)
+			pmesh = rcAllocPolyMesh();
+		if (!dmesh)
+			dmesh = rcAllocPolyMeshDetail();
+		return solid && chf && cset && pmesh && dmesh;
+	}
+
+	/// Releases the distance field, which is temporary memory and may live in the arena of the tile.
+	void endTile()
+	{
+		if (chf)
+		{
+			rcFree(chf->dist);
+			chf->dist = 0;
+		}
+	}
+
+	rcHeightfield* solid;
+	rcCompactHeightfield* chf;
+	rcContourSet* cset;
+	rcPolyMesh* pmesh;
+	rcPolyMeshDetail* dmesh;
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcTileBuildScratch(const rcTileBuildScratch&);
+	rcTileBuildScratch& operator=(const rcTileBuildScratch&);
+};
+
+/// A tile to build and its result, stored until the tile is handed out in order.
+struct rcTileBuildResult
+{
+	int tileIndex;
+	const rcCompactHeightfield* cachedChf;	///< The compact heightfield to start from, or null.
+	bool keepChf;							///< True to return a copy of the compact heightfield in chf.
+	rcCompactHeightfield* chf;
+	unsigned char* data;
+	int dataSize;
+	bool success;
+};
+
+/// Shared state of the tile build jobs.
+struct rcTileBuildJobs
+{
+	const rcTileBuildConfig* buildCfg;
+	rcTileBuildCallbacks* callbacks;
+	rcContext** contexts;
+	rcTempArena* arenas;	///< The temporary memory arenas of the workers, or null.
+	rcTileBuildScratch* scratch;	///< The intermediate results of the workers.
+	rcTileBuildResult* results;
+	int tilesX;
+};
+
+/// Owns the temporary memory arenas of the workers.
+struct rcTileBuildArenas
+{
+	rcTileBuildArenas() : items(0), count(0) {}
+	~rcTileBuildArenas()
+	{
+		for (int i = 0; i < count; ++i)
+			items[i].~rcTempArena();
+		rcFree(items);
+	}
+
+	bool init(const int n, const int size)
+	{
+		items = (rcTempArena*)rcAlloc(sizeof(rcTempArena) * n, RC_ALLOC_PERM);
+		if (!items)
+			return false;
+		for (; count < n; ++count)
+		{
+			rcTempArena* arena = ::new(rcNewTag(), (void*)&items[count]) rcTempArena();
+			if (!arena->init((size_t)size, rcGetAllocator()))
+			{
+				++count;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	rcTempArena* items;
+	int count;
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcTileBuildArenas(const rcTileBuildArenas&);
+	rcTileBuildArenas& operator=(const rcTileBuildArenas&);
+};
+
+/// Owns the intermediate results of the workers.
+struct rcTileBuildScratchArray
+{
+	rcTileBuildScratchArray() : items(0), count(0) {}
+	~rcTileBuildScratchArray()
+	{
+		for (int i = 0; i < count; ++i)
+			items[i].~rcTileBuildScratch();
+		rcFree(items);
+	}
+
+	bool init(const int n)
+	{
+		items = (rcTileBuildScratch*)rcAlloc(sizeof(rcTileBuildScratch) * n, RC_ALLOC_PERM);
+		if (!items)
+			return false;
+		for (; count < n; ++count)
+			::new(rcNewTag(), (void*)&items[count]) rcTileBuildScratch();
+		return true;
+	}
+
+	rcTileBuildScratch* items;
+	int count;
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcTileBuildScratchArray(const rcTileBuildScratchArray&);
+	rcTileBuildScratchArray& operator=(const rcTileBuildScratchArray&);
+};
+
+/// The per-worker state of a tiled build.
+struct rcTileBuildWorkers
+{
+	rcTileBuildWorkers() : disabledContext(false), contexts(0) {}
+	~rcTileBuildWorkers() { rcFree(contexts); }
+
+	/// Sets up the contexts, arenas and scratch of the workers of the dispatcher.
+	bool init(rcContext* context, const char* name, rcJobDispatcher* dispatcher, rcContext** workerContexts,
+			  const int tempArenaSize)
+	{
+		const int workerCount = rcMax(1, dispatcher->getWorkerCount());
+
+		// Workers without a context share one with logging and timers disabled,
+		// which never touches its state and is safe to use concurrently.
+		contexts = (rcContext**)rcAlloc(sizeof(rcContext*) * workerCount, RC_ALLOC_TEMP);
+		if (!contexts)
+		{
+			context->log(RC_LOG_ERROR, "%s: Out of memory 'contexts' (%d).", name, workerCount);
+			return false;
+		}
+		for (int i = 0; i < workerCount; ++i)
+			contexts[i] = workerContexts ? workerContexts[i] : &disabledContext;
+
+		if (tempArenaSize > 0 && !arenas.init(workerCount, tempArenaSize))
+		{
+			context->log(RC_LOG_ERROR, "%s: Out of memory 'arenas' (%d).", name, workerCount);
+			return false;
+		}
+
+		if (!scratch.init(workerCount))
+		{
+			context->log(RC_LOG_ERROR, "%s: Out of memory 'scratch' (%d).", name, workerCount);
+			return false;
+		}
+		return true;
+	}
+
+	rcContext disabledContext;
+	rcContext** contexts;
+	rcTileBuildArenas arenas;
+	rcTileBuildScratchArray scratch;
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcTileBuildWorkers(const rcTileBuildWorkers&);
+	rcTileBuildWorkers& operator=(const rcTileBuildWorkers&);
+};
+
+bool buildTile(rcContext* context, const rcTileBuildConfig& buildCfg, const int tx, const int ty,
+			   rcTileBuildCallbacks& callbacks, const rcCompactHeightfield* cachedChf, rcCompactHeightfield** outChf,
+			   rcTileBuildScratch& scratch, unsigned char** outData, int* outDataSize);
+
+void buildTileJob(void* userData, const int jobIndex, const int workerIndex)
+{
+	rcTileBuildJobs* jobs = (rcTileBuildJobs*)userData;
+	rcTileBuildResult& result = jobs->results[jobIndex];
+	const int tx = result.tileIndex % jobs->tilesX;
+	const int ty = result.tileIndex / jobs->tilesX;
+
+	// Without arenas the tile uses the arena bound by the caller, if any.
+	rcTempArena* arena = jobs->arenas ? &jobs->arenas[workerIndex] : rcGetTempArena();
+	rcTempArenaScope arenaScope(arena);
+
+	result.chf = 0;
+	result.data = 0;
+	result.dataSize = 0;
+	rcTileBuildScratch& scratch = jobs->scratch[workerIndex];
+	result.success = buildTile(jobs->contexts[workerIndex], *jobs->buildCfg, tx, ty, *jobs->callbacks,
+							   result.cachedChf, result.keepChf ? &result.chf : 0,
+							   scratch, &result.data, &result.dataSize);
+	scratch.endTile();
+
+	if (jobs->arenas)
+		arena->reset();
+}
+
+/// Hashes the settings used up to building the compact heightfield.
+unsigned int hashRasterConfig(const rcTileBuildConfig& buildCfg)
+{
+	const rcConfig& cfg = buildCfg.cfg;
+	unsigned int h = rcHashData(&cfg.cs, sizeof(cfg.cs));
+	h = rcHashData(&cfg.ch, sizeof(cfg.ch), h);
+	h = rcHashData(&cfg.walkableSlopeAngle, sizeof(cfg.walkableSlopeAngle), h);
+	h = rcHashData(&cfg.walkableHeight, sizeof(cfg.walkableHeight), h);
+	h = rcHashData(&cfg.walkableClimb, sizeof(cfg.walkableClimb), h);
+	h = rcHashData(&cfg.tileSize, sizeof(cfg.tileSize), h);
+	h = rcHashData(&cfg.borderSize, sizeof(cfg.borderSize), h);
+	h = rcHashData(cfg.bmin, sizeof(cfg.bmin), h);
+	h = rcHashData(cfg.bmax, sizeof(cfg.bmax), h);
+	h = rcHashData(&buildCfg.filterFlags, sizeof(buildCfg.filterFlags), h);
+	return h;
+}
+
+/// Hashes all settings affecting the tile data.
+unsigned int hashBuildConfig(const rcTileBuildConfig& buildCfg)
+{
+	const rcConfig& cfg = buildCfg.cfg;
+	unsigned int h = hashRasterConfig(buildCfg);
+	h = rcHashData(&cfg.walkableRadius, sizeof(cfg.walkableRadius), h);
+	h = rcHashData(&cfg.maxEdgeLen, sizeof(cfg.maxEdgeLen), h);
+	h = rcHashData(&cfg.maxSimplificationError, sizeof(cfg.maxSimplificationError), h);
+	h = rcHashData(&cfg.minRegionArea, sizeof(cfg.minRegionArea), h);
+	h = rcHashData(&cfg.mergeRegionArea, sizeof(cfg.mergeRegionArea), h);
+	h = rcHashData(&cfg.maxVertsPerPoly, sizeof(cfg.maxVertsPerPoly), h);
+	h = rcHashData(&cfg.detailSampleDist, sizeof(cfg.detailSampleDist), h);
+	h = rcHashData(&cfg.detailSampleMaxError, sizeof(cfg.detailSampleMaxError), h);
+	h = rcHashData(&buildCfg.partitionType, sizeof(buildCfg.partitionType), h);
+	h = rcHashData(&buildCfg.buildEdgeClearance, sizeof(buildCfg.buildEdgeClearance), h);
+	return h;
+}
+} // anonymous namespace
+
+unsigned int rcHashData(const void* data, const int size, unsigned int hash)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (int i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+rcTileBuildCache::rcTileBuildCache() :
+	m_entries(0),
+	m_tilesX(0),
+	m_tilesY(0),
+	m_keepCompactHeightfields(false)
+{
+}
+
+rcTileBuildCache::~rcTileBuildCache()
+{
+	purge();
+}
+
+void rcTileBuildCache::purge()
+{
+	invalidateAll();
+	rcFree(m_entries);
+	m_entries = 0;
+	m_tilesX = 0;
+	m_tilesY = 0;
+}
+
+bool rcTileBuildCache::init(const int tilesX, const int tilesY, const bool keepCompactHeightfields)
+{
+	purge();
+	m_keepCompactHeightfields = keepCompactHeightfields;
+	const int count = tilesX * tilesY;
+	if (count <= 0)
+		return true;
+	m_entries = (rcTileBuildCacheEntry*)rcAlloc(sizeof(rcTileBuildCacheEntry) * count, RC_ALLOC_PERM);
+	if (!m_entries)
+		return false;
+	memset(m_entries, 0, sizeof(rcTileBuildCacheEntry) * count);
+	m_tilesX = tilesX;
+	m_tilesY = tilesY;
+	return true;
+}
+
+void rcTileBuildCache::invalidateTile(const int tx, const int ty)
+{
+	rcTileBuildCacheEntry* entry = getEntry(tx, ty);
+	if (!entry)
+		return;
+	rcFreeCompactHeightfield(entry->chf);
+	entry->chf = 0;
+	entry->valid = false;
+}
+
+void rcTileBuildCache::invalidateAll()
+{
+	for (int ty = 0; ty < m_tilesY; ++ty)
+		for (int tx = 0; tx < m_tilesX; ++tx)
+			invalidateTile(tx, ty);
+}
+
+rcTileBuildCacheEntry* rcTileBuildCache::getEntry(const int tx, const int ty)
+{
+	if (tx < 0 || ty < 0 || tx >= m_tilesX || ty >= m_tilesY)
+		return 0;
+	return &m_entries[tx + ty * m_tilesX];
+}
+
+void rcCalcTileGridSize(const rcConfig& cfg, int* tilesX, int* tilesY)
+{
+	rcAssert(cfg.tileSize > 0);
+
+	int gw = 0, gh = 0;
+	rcCalcGridSize(cfg.bmin, cfg.bmax, cfg.cs, &gw, &gh);
+	*tilesX = (gw + cfg.tileSize - 1) / cfg.tileSize;
+	*tilesY = (gh + cfg.tileSize - 1) / cfg.tileSize;
+}
+
+void rcCalcTileConfig(const rcConfig& cfg, const int tx, const int ty, rcConfig& tileCfg)
+{
+	memcpy(&tileCfg, &cfg, sizeof(rcConfig));
+
+	const float tcs = cfg.tileSize * cfg.cs;
+	tileCfg.width = cfg.tileSize + cfg.borderSize * 2;
+	tileCfg.height = cfg.tileSize + cfg.borderSize * 2;
+	tileCfg.bmin[0] = cfg.bmin[0] + tx * tcs - cfg.borderSize * cfg.cs;
+	tileCfg.bmin[2] = cfg.bmin[2] + ty * tcs - cfg.borderSize * cfg.cs;
+	tileCfg.bmax[0] = cfg.bmin[0] + (tx + 1) * tcs + cfg.borderSize * cfg.cs;
+	tileCfg.bmax[2] = cfg.bmin[2] + (ty + 1) * tcs + cfg.borderSize * cfg.cs;
+}
+
+bool rcBuildTile(rcContext* context, const rcTileBuildConfig& buildCfg, const int tx, const int ty,
+				 rcTileBuildCallbacks& callbacks, unsigned char** outData, int* outDataSize)
+{
+	rcTileBuildScratch scratch;
+	return buildTile(context, buildCfg, tx, ty, callbacks, 0, 0, scratch, outData, outDataSize);
+}
+
+namespace
+{
+/// Rasterizes and filters the input of a tile into a compact heightfield.
+bool buildCompactHeightfield(rcContext* context, const rcTileBuildConfig& buildCfg, const rcConfig& cfg,
+							 const int tx, const int ty, rcTileInputCallbacks& callbacks, rcTileBuildScratch& scratch)
+{
+	if (!rcResetHeightfield(context, *scratch.solid, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch))
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTile: Could not create solid heightfield.");
+		return false;
+	}
+
+	if (!callbacks.rasterizeTile(context, cfg, tx, ty, *scratch.solid))
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTile: Could not rasterize tile (%d,%d).", tx, ty);
+		return false;
+	}
+
+	if (!rcBuildFilteredCompactHeightfield(context, buildCfg.filterFlags, cfg.walkableHeight, cfg.walkableClimb,
+										   *scratch.solid, *scratch.chf))
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTile: Could not build compact data.");
+		return false;
+	}
+
+	return true;
+}
+
+/// Erodes the compact heightfield of the scratch, and builds its regions, contours and polygon mesh.
+/// Sets @p empty if the tile has no contours, in which case the polygon mesh is not built.
+bool buildPolyMesh(rcContext* context, const rcTileBuildConfig& buildCfg, const rcConfig& cfg,
+				   const int tx, const int ty, rcTileInputCallbacks& callbacks, rcTileBuildScratch& scratch, bool* empty)
+{
+	*empty = false;
+
+	if (!rcErodeWalkableArea(context, cfg.walkableRadius, *scratch.chf))
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTile: Could not erode.");
+		return false;
+	}
+
+	if (!callbacks.markAreas(context, cfg, tx, ty, *scratch.chf))
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTile: Could not mark areas of tile (%d,%d).", tx, ty);
+		return false;
+	}
+
+	if (buildCfg.partitionType == RC_PARTITION_WATERSHED)
+	{
+		if (!rcBuildDistanceField(context, *scratch.chf))
+		{
+			context->log(RC_LOG_ERROR, "rcBuildTile: Could not build distance field.");
+			return false;
+		}
+		if (!rcBuildRegions(context, *scratch.chf, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea))
+		{
+			context->log(RC_LOG_ERROR, "rcBuildTile: Could not build watershed regions.");
+			return false;
+		}
+	}
+	else if (buildCfg.partitionType == RC_PARTITION_MONOTONE)
+	{
+		if (!rcBuildRegionsMonotone(context, *scratch.chf, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea))
+		{
+			context->log(RC_LOG_ERROR, "rcBuildTile: Could not build monotone regions.");
+			return false;
+		}
+	}
+	else
+	{
+		if (!rcBuildLayerRegions(context, *scratch.chf, cfg.borderSize, cfg.minRegionArea))
+		{
+			context->log(RC_LOG_ERROR, "rcBuildTile: Could not build layer regions.");
+			return false;
+		}
+	}
+
+	if (!rcBuildContours(context, *scratch.chf, cfg.maxSimplificationError, cfg.maxEdgeLen, *scratch.cset))
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTile: Could not create contours.");
+		return false;
+	}
+
+	// Empty tile.
+	if (scratch.cset->nconts == 0)
+	{
+		*empty = true;
+		return true;
+	}
+
+	if (!rcBuildPolyMesh(context, *scratch.cset, cfg.maxVertsPerPoly, *scratch.pmesh))
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTile: Could not triangulate contours.");
+		return false;
+	}
+
+	return true;
+}
+
+/// Builds a tile, starting from a copy of @p cachedChf if set, and returns a copy
+/// of the compact heightfield before erosion in @p outChf if set. The intermediate
+/// results are built into @p scratch, reusing the buffers of its previous tile.
+bool buildTile(rcContext* context, const rcTileBuildConfig& buildCfg, const int tx, const int ty,
+			   rcTileBuildCallbacks& callbacks, const rcCompactHeightfield* cachedChf, rcCompactHeightfield** outChf,
+			   rcTileBuildScratch& scratch, unsigned char** outData, int* outDataSize)
+{
+	rcAssert(context);
+	rcAssert(outData && outDataSize);
+
+	*outData = 0;
+	*outDataSize = 0;
+
+	rcConfig cfg;
+	rcCalcTileConfig(buildCfg.cfg, tx, ty, cfg);
+
+	if (!scratch.init())
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTile: Out of memory 'scratch'.");
+		return false;
+	}
+
+	if (cachedChf)
+	{
+		if (!rcCopyCompactHeightfield(context, *cachedChf, *scratch.chf))
+		{
+			context->log(RC_LOG_ERROR, "rcBuildTile: Could not copy the cached compact heightfield.");
+			return false;
+		}
+	}
+	else if (!buildCompactHeightfield(context, buildCfg, cfg, tx, ty, callbacks, scratch))
+	{
+		return false;
+	}
+
+	if (outChf)
+	{
+		*outChf = rcAllocCompactHeightfield();
+		if (!*outChf || !rcCopyCompactHeightfield(context, *scratch.chf, **outChf))
+		{
+			rcFreeCompactHeightfield(*outChf);
+			*outChf = 0;
+			context->log(RC_LOG_ERROR, "rcBuildTile: Could not copy the compact heightfield for the cache.");
+			return false;
+		}
+	}
+
+	bool empty = false;
+	if (!buildPolyMesh(context, buildCfg, cfg, tx, ty, callbacks, scratch, &empty))
+		return false;
+	if (empty)
+		return true;
+
+	if (buildCfg.buildEdgeClearance && !rcBuildPolyMeshEdgeClearance(context, *scratch.chf, *scratch.pmesh))
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTile: Could not build polymesh edge clearance.");
+		return false;
+	}
+
+	if (!rcBuildPolyMeshDetail(context, *scratch.pmesh, *scratch.chf, cfg.detailSampleDist, cfg.detailSampleMaxError, *scratch.dmesh))
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTile: Could not build polymesh detail.");
+		return false;
+	}
+
+	// Empty tile.
+	if (scratch.pmesh->npolys == 0)
+		return true;
+
+	if (!callbacks.createTileData(context, cfg, tx, ty, *scratch.pmesh, *scratch.dmesh, outData, outDataSize))
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTile: Could not create data for tile (%d,%d).", tx, ty);
+		return false;
+	}
+
+	return true;
+}
+
+} // anonymous namespace
+
+bool rcBuildTiles(rcContext* context, const rcTileBuildConfig& buildCfg, rcTileBuildCallbacks& callbacks,
+				  rcJobDispatcher* dispatcher, rcContext** workerContexts)
+{
+	return rcBuildTiles(context, buildCfg, callbacks, dispatcher, workerContexts, 0);
+}
+
+bool rcBuildTiles(rcContext* context, const rcTileBuildConfig& buildCfg, rcTileBuildCallbacks& callbacks,
+				  rcJobDispatcher* dispatcher, rcContext** workerContexts,
+				  rcTileBuildCache* cache, int* builtTileCount)
+{
+	rcAssert(context);
+
+	rcScopedTimer timer(context, RC_TIMER_TOTAL);
+
+	if (builtTileCount)
+		*builtTileCount = 0;
+
+	rcJobDispatcher serialDispatcher;
+	if (!dispatcher)
+		dispatcher = &serialDispatcher;
+
+	int tilesX = 0, tilesY = 0;
+	rcCalcTileGridSize(buildCfg.cfg, &tilesX, &tilesY);
+	const int tileCount = tilesX * tilesY;
+	if (tileCount == 0)
+		return true;
+
+	if (cache && (cache->getTilesX() != tilesX || cache->getTilesY() != tilesY))
+	{
+		if (!cache->init(tilesX, tilesY, cache->getKeepCompactHeightfields()))
+		{
+			context->log(RC_LOG_ERROR, "rcBuildTiles: Out of memory 'cache' (%d).", tileCount);
+			return false;
+		}
+	}
+
+	// Find the tiles to build, and the input hashes to store once they are built.
+	rcScopedDelete<int> pending((int*)rcAlloc(sizeof(int) * tileCount, RC_ALLOC_TEMP));
+	rcScopedDelete<unsigned int> inputHashes((unsigned int*)rcAlloc(sizeof(unsigned int) * tileCount, RC_ALLOC_TEMP));
+	rcScopedDelete<unsigned char> hashed((unsigned char*)rcAlloc(sizeof(unsigned char) * tileCount, RC_ALLOC_TEMP));
+	if (!pending || !inputHashes || !hashed)
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTiles: Out of memory 'pending' (%d).", tileCount);
+		return false;
+	}
+	const unsigned int rasterHash = hashRasterConfig(buildCfg);
+	const unsigned int buildHash = hashBuildConfig(buildCfg);
+	int pendingCount = 0;
+	for (int tileIndex = 0; tileIndex < tileCount; ++tileIndex)
+	{
+		inputHashes[tileIndex] = 0;
+		hashed[tileIndex] = 0;
+		if (cache)
+		{
+			const int tx = tileIndex % tilesX;
+			const int ty = tileIndex / tilesX;
+			rcConfig tileCfg;
+			rcCalcTileConfig(buildCfg.cfg, tx, ty, tileCfg);
+			hashed[tileIndex] = callbacks.getTileInputHash(tileCfg, tx, ty, &inputHashes[tileIndex]) ? 1 : 0;
+			const rcTileBuildCacheEntry* entry = cache->getEntry(tx, ty);
+			if (hashed[tileIndex] && entry->valid && entry->inputHash == inputHashes[tileIndex] && entry->buildHash == buildHash)
+				continue;
+		}
+		pending[pendingCount++] = tileIndex;
+	}
+	if (builtTileCount)
+		*builtTileCount = pendingCount;
+	if (pendingCount == 0)
+		return true;
+
+	const int batchSize = buildCfg.maxTilesInFlight > 0 ? rcMin(buildCfg.maxTilesInFlight, pendingCount) : pendingCount;
+
+	rcScopedDelete<rcTileBuildResult> results((rcTileBuildResult*)rcAlloc(sizeof(rcTileBuildResult) * batchSize, RC_ALLOC_TEMP));
+	if (!results)
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTiles: Out of memory 'results' (%d).", batchSize);
+		return false;
+	}
+
+	rcTileBuildWorkers workers;
+	if (!workers.init(context, "rcBuildTiles", dispatcher, workerContexts, buildCfg.tempArenaSize))
+		return false;
+
+	rcTileBuildJobs jobs;
+	jobs.buildCfg = &buildCfg;
+	jobs.callbacks = &callbacks;
+	jobs.contexts = workers.contexts;
+	jobs.arenas = workers.arenas.items;
+	jobs.scratch = workers.scratch.items;
+	jobs.results = results;
+	jobs.tilesX = tilesX;
+
+	const bool keepChf = cache && cache->getKeepCompactHeightfields();
+
+	bool success = true;
+	for (int first = 0; first < pendingCount; first += batchSize)
+	{
+		const int count = rcMin(batchSize, pendingCount - first);
+		for (int i = 0; i < count; ++i)
+		{
+			rcTileBuildResult& result = results[i];
+			result.tileIndex = pending[first + i];
+			result.cachedChf = 0;
+			result.keepChf = false;
+			if (keepChf && hashed[result.tileIndex])
+			{
+				// Start from the cached compact heightfield if the tile input did not change.
+				const rcTileBuildCacheEntry* entry = cache->getEntry(result.tileIndex % tilesX, result.tileIndex / tilesX);
+				if (entry->chf && entry->inputHash == inputHashes[result.tileIndex] && entry->rasterHash == rasterHash)
+					result.cachedChf = entry->chf;
+				else
+					result.keepChf = true;
+			}
+		}
+
+		rcDispatchJobs(dispatcher, buildTileJob, &jobs, count);
+
+		// Hand out the results in tile order.
+		for (int i = 0; i < count; ++i)
+		{
+			rcTileBuildResult& result = results[i];
+			const int tx = result.tileIndex % tilesX;
+			const int ty = result.tileIndex / tilesX;
+			if (!result.success)
+			{
+				context->log(RC_LOG_ERROR, "rcBuildTiles: Could not build tile (%d,%d).", tx, ty);
+				success = false;
+			}
+
+			if (cache && result.success)
+			{
+				rcTileBuildCacheEntry* entry = cache->getEntry(tx, ty);
+				if (!result.cachedChf)
+				{
+					rcFreeCompactHeightfield(entry->chf);
+					entry->chf = result.chf;
+					entry->rasterHash = rasterHash;
+					result.chf = 0;
+				}
+				entry->inputHash = inputHashes[result.tileIndex];
+				entry->buildHash = buildHash;
+				entry->valid = hashed[result.tileIndex] != 0;
+			}
+			else if (cache)
+			{
+				cache->invalidateTile(tx, ty);
+			}
+			rcFreeCompactHeightfield(result.chf);
+
+			if (result.data)
+				callbacks.addTile(tx, ty, result.data, result.dataSize);
+			else if (cache && result.success)
+				callbacks.removeTile(tx, ty);
+		}
+	}
+
+	return success;
+}
+
+namespace
+{
+/// The finished meshes of the bands of a banded build.
+struct rcBandMeshes
+{
+	explicit rcBandMeshes(const int count) : pmeshes(0), dmeshes(0), count(count)
+	{
+		pmeshes = (rcPolyMesh**)rcAlloc(sizeof(rcPolyMesh*) * count, RC_ALLOC_TEMP);
+		dmeshes = (rcPolyMeshDetail**)rcAlloc(sizeof(rcPolyMeshDetail*) * count, RC_ALLOC_TEMP);
+		if (pmeshes && dmeshes)
+		{
+			memset(pmeshes, 0, sizeof(rcPolyMesh*) * count);
+			memset(dmeshes, 0, sizeof(rcPolyMeshDetail*) * count);
+		}
+	}
+	~rcBandMeshes()
+	{
+		for (int i = 0; pmeshes && dmeshes && i < count; ++i)
+		{
+			rcFreePolyMesh(pmeshes[i]);
+			rcFreePolyMeshDetail(dmeshes[i]);
+		}
+		rcFree(pmeshes);
+		rcFree(dmeshes);
+	}
+
+	rcPolyMesh** pmeshes;		///< The polygon meshes of the bands, null for empty bands.
+	rcPolyMeshDetail** dmeshes;	///< The detail meshes of the bands, null for empty bands.
+	int count;
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcBandMeshes(const rcBandMeshes&);
+	rcBandMeshes& operator=(const rcBandMeshes&);
+};
+
+/// Calculates the configuration of a band spanning the whole width of the grid.
+void calcBandConfig(const rcConfig& cfg, const int gridWidth, const int band, rcConfig& bandCfg)
+{
+	memcpy(&bandCfg, &cfg, sizeof(rcConfig));
+
+	const float border = cfg.borderSize * cfg.cs;
+	bandCfg.width = gridWidth + cfg.borderSize * 2;
+	bandCfg.height = cfg.tileSize + cfg.borderSize * 2;
+	bandCfg.bmin[0] = cfg.bmin[0] - border;
+	bandCfg.bmax[0] = cfg.bmin[0] + gridWidth * cfg.cs + border;
+	bandCfg.bmin[2] = cfg.bmin[2] + band * cfg.tileSize * cfg.cs - border;
+	bandCfg.bmax[2] = cfg.bmin[2] + (band + 1) * cfg.tileSize * cfg.cs + border;
+}
+
+/// Builds the edge clearance and the detail mesh of a band once both of its borders are stitched.
+bool finishBand(rcContext* context, const rcTileBuildConfig& buildCfg, rcTileBuildScratch& scratch,
+				rcPolyMesh& pmesh, rcPolyMeshDetail** dmesh)
+{
+	const rcConfig& cfg = buildCfg.cfg;
+	if (buildCfg.buildEdgeClearance && !rcBuildPolyMeshEdgeClearance(context, *scratch.chf, pmesh))
+	{
+		context->log(RC_LOG_ERROR, "rcBuildBandedPolyMesh: Could not build polymesh edge clearance.");
+		return false;
+	}
+	*dmesh = rcAllocPolyMeshDetail();
+	if (!*dmesh || !rcBuildPolyMeshDetail(context, pmesh, *scratch.chf, cfg.detailSampleDist, cfg.detailSampleMaxError, **dmesh))
+	{
+		context->log(RC_LOG_ERROR, "rcBuildBandedPolyMesh: Could not build polymesh detail.");
+		return false;
+	}
+	scratch.endTile();
+	return true;
+}
+} // anonymous namespace
+
+bool rcBuildBandedPolyMesh(rcContext* context, const rcTileBuildConfig& buildCfg, rcTileInputCallbacks& callbacks,
+						   rcPolyMesh& mesh, rcPolyMeshDetail& dmesh)
+{
+	rcAssert(context);
+
+	const rcConfig& cfg = buildCfg.cfg;
+	rcAssert(cfg.tileSize > 0);
+
+	rcScopedTimer timer(context, RC_TIMER_TOTAL);
+
+	int gridWidth = 0, gridHeight = 0;
+	rcCalcGridSize(cfg.bmin, cfg.bmax, cfg.cs, &gridWidth, &gridHeight);
+	const int bandCount = (gridHeight + cfg.tileSize - 1) / cfg.tileSize;
+	rcBandMeshes bands(bandCount);
+	if (!bands.pmeshes || !bands.dmeshes)
+	{
+		context->log(RC_LOG_ERROR, "rcBuildBandedPolyMesh: Out of memory 'bands' (%d).", bandCount);
+		return false;
+	}
+
+	// Two bands are resident at a time. The previous band keeps its compact heightfield until its
+	// polygon mesh is stitched to the current band, and the heightfield and contours are shared.
+	rcTileBuildScratch scratch[2];
+	for (int band = 0; band <= bandCount; ++band)
+	{
+		rcTileBuildScratch& cur = scratch[band & 1];
+		rcTileBuildScratch& prev = scratch[(band + 1) & 1];
+		if (band < bandCount)
+		{
+			rcSwap(cur.solid, prev.solid);
+			rcSwap(cur.cset, prev.cset);
+
+			rcConfig bandCfg;
+			calcBandConfig(cfg, gridWidth, band, bandCfg);
+			bool empty = false;
+			if (!cur.init())
+			{
+				context->log(RC_LOG_ERROR, "rcBuildBandedPolyMesh: Out of memory 'scratch'.");
+				return false;
+			}
+			if (!buildCompactHeightfield(context, buildCfg, bandCfg, 0, band, callbacks, cur) ||
+				!buildPolyMesh(context, buildCfg, bandCfg, 0, band, callbacks, cur, &empty))
+			{
+				context->log(RC_LOG_ERROR, "rcBuildBandedPolyMesh: Could not build band %d.", band);
+				return false;
+			}
+			if (!empty && cur.pmesh->npolys > 0)
+			{
+				bands.pmeshes[band] = cur.pmesh;
+				cur.pmesh = 0;
+			}
+			if (band > 0 && bands.pmeshes[band - 1] && bands.pmeshes[band] &&
+				!rcStitchPolyMeshes(context, *bands.pmeshes[band - 1], *bands.pmeshes[band], cfg.walkableClimb))
+			{
+				context->log(RC_LOG_ERROR, "rcBuildBandedPolyMesh: Could not stitch band %d.", band);
+				return false;
+			}
+		}
+		if (band > 0 && bands.pmeshes[band - 1] &&
+			!finishBand(context, buildCfg, prev, *bands.pmeshes[band - 1], &bands.dmeshes[band - 1]))
+		{
+			return false;
+		}
+	}
+
+	// Merge the bands, keeping the region ids of different bands apart.
+	int meshCount = 0;
+	unsigned short regionBase = 0;
+	for (int band = 0; band < bandCount; ++band)
+	{
+		rcPolyMesh* pmesh = bands.pmeshes[band];
+		if (!pmesh)
+			continue;
+		unsigned short maxRegion = 0;
+		for (int i = 0; i < pmesh->npolys; ++i)
+		{
+			maxRegion = rcMax(maxRegion, pmesh->regs[i]);
+			pmesh->regs[i] = (unsigned short)(pmesh->regs[i] + regionBase);
+		}
+		regionBase = (unsigned short)(regionBase + maxRegion);
+		bands.pmeshes[meshCount] = pmesh;
+		bands.dmeshes[meshCount] = bands.dmeshes[band];
+		if (meshCount != band)
+		{
+			bands.pmeshes[band] = 0;
+			bands.dmeshes[band] = 0;
+		}
+		meshCount++;
+	}
+	if (!rcMergePolyMeshes(context, bands.pmeshes, meshCount, mesh) ||
+		!rcMergePolyMeshDetails(context, bands.dmeshes, meshCount, dmesh))
+	{
+		context->log(RC_LOG_ERROR, "rcBuildBandedPolyMesh: Could not merge the bands.");
+		return false;
+	}
+
+	// The outer edges of the merged mesh are walls, like the ones of a single tile build.
+	const int nvp = mesh.nvp;
+	for (int i = 0; i < mesh.npolys; ++i)
+	{
+		unsigned short* p = &mesh.polys[i * nvp * 2];
+		for (int j = 0; j < nvp; ++j)
+		{
+			if ((p[nvp + j] & 0x8000) && p[nvp + j] != RC_MESH_NULL_IDX)
+				p[nvp + j] = RC_MESH_NULL_IDX;
+		}
+	}
+
+	return true;
+}
+
+namespace
+{
+/// The data of a layer built by #rcBuildTileLayers.
+struct rcTileLayerData
+{
+	int layerIndex;
+	unsigned char* data;
+	int dataSize;
+};
+
+/// A tile to build layers for and its result, stored until the layers are handed out in order.
+struct rcTileLayerBuildResult
+{
+	int tx, ty;
+	rcTileLayerData* layers;	///< The layers, allocated as permanent memory to outlive the arena of the worker.
+	int layerCount;
+	bool success;
+};
+
+/// Shared state of the tile layer build jobs.
+struct rcTileLayerBuildJobs
+{
+	const rcTileBuildConfig* buildCfg;
+	rcTileLayerBuildCallbacks* callbacks;
+	rcContext** contexts;
+	rcTempArena* arenas;	///< The temporary memory arenas of the workers, or null.
+	rcTileBuildScratch* scratch;	///< The intermediate results of the workers.
+	rcTileLayerBuildResult* results;
+};
+
+/// Builds the heightfield layers of a tile and converts them into layer data.
+bool buildTileLayers(rcContext* context, const int workerIndex, const rcTileBuildConfig& buildCfg,
+					 rcTileLayerBuildCallbacks& callbacks, rcTileBuildScratch& scratch, rcTileLayerBuildResult& result)
+{
+	const int tx = result.tx;
+	const int ty = result.ty;
+
+	rcConfig cfg;
+	rcCalcTileConfig(buildCfg.cfg, tx, ty, cfg);
+
+	if (!scratch.init())
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTileLayers: Out of memory 'scratch'.");
+		return false;
+	}
+
+	if (!buildCompactHeightfield(context, buildCfg, cfg, tx, ty, callbacks, scratch))
+		return false;
+
+	if (!rcErodeWalkableArea(context, cfg.walkableRadius, *scratch.chf))
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTileLayers: Could not erode.");
+		return false;
+	}
+
+	if (!callbacks.markAreas(context, cfg, tx, ty, *scratch.chf))
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTileLayers: Could not mark areas of tile (%d,%d).", tx, ty);
+		return false;
+	}
+
+	rcHeightfieldLayerSet* lset = rcAllocHeightfieldLayerSet();
+	if (!lset)
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTileLayers: Out of memory 'lset'.");
+		return false;
+	}
+	if (!rcBuildHeightfieldLayers(context, *scratch.chf, cfg.borderSize, cfg.walkableHeight, *lset))
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTileLayers: Could not build heightfield layers.");
+		rcFreeHeightfieldLayerSet(lset);
+		return false;
+	}
+
+	bool success = true;
+	if (lset->nlayers > 0)
+	{
+		result.layers = (rcTileLayerData*)rcAlloc(sizeof(rcTileLayerData) * lset->nlayers, RC_ALLOC_PERM);
+		if (!result.layers)
+		{
+			context->log(RC_LOG_ERROR, "rcBuildTileLayers: Out of memory 'layers' (%d).", lset->nlayers);
+			success = false;
+		}
+		for (int i = 0; success && i < lset->nlayers; ++i)
+		{
+			rcTileLayerData& layer = result.layers[result.layerCount];
+			layer.layerIndex = i;
+			layer.data = 0;
+			layer.dataSize = 0;
+			if (!callbacks.createLayerData(context, workerIndex, cfg, tx, ty, i, lset->layers[i], &layer.data, &layer.dataSize))
+			{
+				context->log(RC_LOG_ERROR, "rcBuildTileLayers: Could not create data for layer %d of tile (%d,%d).", i, tx, ty);
+				success = false;
+			}
+			if (layer.data)
+				result.layerCount++;
+		}
+	}
+	rcFreeHeightfieldLayerSet(lset);
+	return success;
+}
+
+void buildTileLayersJob(void* userData, const int jobIndex, const int workerIndex)
+{
+	rcTileLayerBuildJobs* jobs = (rcTileLayerBuildJobs*)userData;
+	rcTileLayerBuildResult& result = jobs->results[jobIndex];
+
+	// Without arenas the tile uses the arena bound by the caller, if any.
+	rcTempArena* arena = jobs->arenas ? &jobs->arenas[workerIndex] : rcGetTempArena();
+	rcTempArenaScope arenaScope(arena);
+
+	result.layers = 0;
+	result.layerCount = 0;
+	rcTileBuildScratch& scratch = jobs->scratch[workerIndex];
+	result.success = buildTileLayers(jobs->contexts[workerIndex], workerIndex, *jobs->buildCfg, *jobs->callbacks,
+									 scratch, result);
+	scratch.endTile();
+
+	if (jobs->arenas)
+		arena->reset();
+}
+} // anonymous namespace
+
+bool rcBuildTileLayers(rcContext* context, const rcTileBuildConfig& buildCfg, rcTileLayerBuildCallbacks& callbacks,
+					   rcJobDispatcher* dispatcher, rcContext** workerContexts,
+					   const int minTx, const int minTy, const int maxTx, const int maxTy, int* layerCount)
+{
+	rcAssert(context);
+
+	rcScopedTimer timer(context, RC_TIMER_TOTAL);
+
+	if (layerCount)
+		*layerCount = 0;
+
+	rcJobDispatcher serialDispatcher;
+	if (!dispatcher)
+		dispatcher = &serialDispatcher;
+
+	int tilesX = 0, tilesY = 0;
+	rcCalcTileGridSize(buildCfg.cfg, &tilesX, &tilesY);
+	const int x0 = rcMax(minTx, 0);
+	const int y0 = rcMax(minTy, 0);
+	const int x1 = rcMin(maxTx, tilesX - 1);
+	const int y1 = rcMin(maxTy, tilesY - 1);
+	if (x0 > x1 || y0 > y1)
+		return true;
+
+	const int rangeWidth = x1 - x0 + 1;
+	const int tileCount = rangeWidth * (y1 - y0 + 1);
+	const int batchSize = buildCfg.maxTilesInFlight > 0 ? rcMin(buildCfg.maxTilesInFlight, tileCount) : tileCount;
+
+	rcScopedDelete<rcTileLayerBuildResult> results((rcTileLayerBuildResult*)rcAlloc(sizeof(rcTileLayerBuildResult) * batchSize, RC_ALLOC_TEMP));
+	if (!results)
+	{
+		context->log(RC_LOG_ERROR, "rcBuildTileLayers: Out of memory 'results' (%d).", batchSize);
+		return false;
+	}
+
+	rcTileBuildWorkers workers;
+	if (!workers.init(context, "rcBuildTileLayers", dispatcher, workerContexts, buildCfg.tempArenaSize))
+		return false;
+
+	rcTileLayerBuildJobs jobs;
+	jobs.buildCfg = &buildCfg;
+	jobs.callbacks = &callbacks;
+	jobs.contexts = workers.contexts;
+	jobs.arenas = workers.arenas.items;
+	jobs.scratch = workers.scratch.items;
+	jobs.results = results;
+
+	bool success = true;
+	for (int first = 0; first < tileCount; first += batchSize)
+	{
+		const int count = rcMin(batchSize, tileCount - first);
+		for (int i = 0; i < count; ++i)
+		{
+			results[i].tx = x0 + (first + i) % rangeWidth;
+			results[i].ty = y0 + (first + i) / rangeWidth;
+		}
+
+		rcDispatchJobs(dispatcher, buildTileLayersJob, &jobs, count);
+
+		// Hand out the layers in tile order, including the layers built before a tile failed.
+		for (int i = 0; i < count; ++i)
+		{
+			rcTileLayerBuildResult& result = results[i];
+			if (!result.success)
+			{
+				context->log(RC_LOG_ERROR, "rcBuildTileLayers: Could not build tile (%d,%d).", result.tx, result.ty);
+				success = false;
+			}
+			for (int j = 0; j < result.layerCount; ++j)
+			{
+				const rcTileLayerData& layer = result.layers[j];
+				callbacks.addLayer(result.tx, result.ty, layer.layerIndex, layer.data, layer.dataSize);
+			}
+			if (layerCount)
+				*layerCount += result.layerCount;
+			rcFree(result.layers);
+		}
+	}
+
+	return success;
+}
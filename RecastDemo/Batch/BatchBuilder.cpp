@@ -0,0 +1,626 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include "BatchBuilder.h"
+#include "InputGeom.h"
+#include "Sample.h"
+#include "Recast.h"
+#include "RecastChunkedMesh.h"
+#include "RecastTileBuild.h"
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+#include "DetourNavMeshQuery.h"
+
+static const int MAX_LAYERS = 32;
+static const int EXPECTED_LAYERS_PER_TILE = 4;
+
+static void setPolyFlags(unsigned char* areas, unsigned short* flags, const int npolys)
+{
+	// Same mapping as the samples, so that the test cases use the same include flags.
+	for (int i = 0; i < npolys; ++i)
+	{
+		if (areas[i] == RC_WALKABLE_AREA)
+			areas[i] = SAMPLE_POLYAREA_GROUND;
+
+		if (areas[i] == SAMPLE_POLYAREA_GROUND ||
+			areas[i] == SAMPLE_POLYAREA_GRASS ||
+			areas[i] == SAMPLE_POLYAREA_ROAD)
+		{
+			flags[i] = SAMPLE_POLYFLAGS_WALK;
+		}
+		else if (areas[i] == SAMPLE_POLYAREA_WATER)
+		{
+			flags[i] = SAMPLE_POLYFLAGS_SWIM;
+		}
+		else if (areas[i] == SAMPLE_POLYAREA_DOOR)
+		{
+			flags[i] = SAMPLE_POLYFLAGS_WALK | SAMPLE_POLYFLAGS_DOOR;
+		}
+	}
+}
+
+static void setOffMeshConnections(const InputGeom* geom, dtNavMeshCreateParams& params)
+{
+	params.offMeshConVerts = geom->getOffMeshConnectionVerts();
+	params.offMeshConRad = geom->getOffMeshConnectionRads();
+	params.offMeshConDir = geom->getOffMeshConnectionDirs();
+	params.offMeshConAreas = geom->getOffMeshConnectionAreas();
+	params.offMeshConFlags = geom->getOffMeshConnectionFlags();
+	params.offMeshConUserID = geom->getOffMeshConnectionId();
+	params.offMeshConCount = geom->getOffMeshConnectionCount();
+}
+
+// Rasterizes the chunks of the input mesh overlapping the xz-bounds of the heightfield.
+// The area ids of the triangles are in the order of the chunks of the mesh index.
+static bool rasterizeGeom(rcContext* ctx, const InputGeom* geom, const unsigned char* triAreas, const rcConfig& cfg,
+						  rcHeightfield& solid)
+{
+	const float* verts = geom->getMesh()->getVerts();
+	const int nverts = geom->getMesh()->getVertCount();
+	const rcTriMeshIndex* meshIndex = geom->getMeshIndex();
+
+	float tbmin[2], tbmax[2];
+	tbmin[0] = solid.bmin[0];
+	tbmin[1] = solid.bmin[2];
+	tbmax[0] = solid.bmax[0];
+	tbmax[1] = solid.bmax[2];
+
+	std::vector<int> cid(meshIndex->nchunks);
+	const int ncid = rcGetTriMeshChunksOverlappingRect(*meshIndex, tbmin, tbmax, &cid[0], (int)cid.size());
+	for (int i = 0; i < ncid; ++i)
+	{
+		const rcTriMeshIndexNode& node = meshIndex->nodes[cid[i]];
+		const int* tris = &meshIndex->tris[node.i*3];
+		if (!rcRasterizeTriangles(ctx, verts, nverts, tris, &triAreas[node.i], node.n, solid, cfg.walkableClimb))
+			return false;
+	}
+	return true;
+}
+
+static void filterSpans(rcContext* ctx, const rcConfig& cfg, rcHeightfield& solid)
+{
+	rcFilterLowHangingWalkableObstacles(ctx, cfg.walkableClimb, solid);
+	rcFilterLedgeSpans(ctx, cfg.walkableHeight, cfg.walkableClimb, solid);
+	rcFilterWalkableLowHeightSpans(ctx, cfg.walkableHeight, solid);
+}
+
+static void fillCreateParams(const BuildSettings& settings, const rcConfig& cfg, rcPolyMesh& pmesh,
+							 rcPolyMeshDetail& dmesh, dtNavMeshCreateParams& params)
+{
+	memset(&params, 0, sizeof(params));
+	params.verts = pmesh.verts;
+	params.vertCount = pmesh.nverts;
+	params.polys = pmesh.polys;
+	params.polyAreas = pmesh.areas;
+	params.polyFlags = pmesh.flags;
+	params.polyCount = pmesh.npolys;
+	params.nvp = pmesh.nvp;
+	params.polyEdgeClearance = pmesh.edgeClearance;
+	params.detailMeshes = dmesh.meshes;
+	params.detailVerts = dmesh.verts;
+	params.detailVertsCount = dmesh.nverts;
+	params.detailTris = dmesh.tris;
+	params.detailTriCount = dmesh.ntris;
+	params.walkableHeight = settings.agentHeight;
+	params.walkableRadius = settings.agentRadius;
+	params.walkableClimb = settings.agentMaxClimb;
+	rcVcopy(params.bmin, pmesh.bmin);
+	rcVcopy(params.bmax, pmesh.bmax);
+	params.cs = cfg.cs;
+	params.ch = cfg.ch;
+	params.buildBvTree = true;
+}
+
+BatchMeshProcess::~BatchMeshProcess()
+{
+	// Defined out of line to fix the weak v-tables warning
+}
+
+void BatchMeshProcess::process(struct dtNavMeshCreateParams* params, unsigned char* polyAreas, unsigned short* polyFlags)
+{
+	setPolyFlags(polyAreas, polyFlags, params->polyCount);
+	if (geom)
+		setOffMeshConnections(geom, *params);
+}
+
+// Builds the tiles of the "Tile Mesh" sample and adds them to the navigation mesh.
+class BatchTileCallbacks : public rcTileBuildCallbacks
+{
+public:
+	BatchTileCallbacks(const InputGeom* geom, const unsigned char* triAreas, const rcChunkedMesh* chunkedMesh,
+					   const BuildSettings& settings, dtNavMesh* navMesh) :
+		m_geom(geom), m_triAreas(triAreas), m_chunkedMesh(chunkedMesh), m_settings(settings), m_navMesh(navMesh)
+	{
+	}
+
+	virtual ~BatchTileCallbacks();
+
+	virtual bool rasterizeTile(rcContext* context, const rcConfig& tileCfg, const int /*tx*/, const int /*ty*/,
+							   rcHeightfield& heightfield)
+	{
+		if (m_chunkedMesh)
+			return rcRasterizeChunkedMeshTile(context, *m_chunkedMesh, tileCfg, heightfield);
+		return rasterizeGeom(context, m_geom, m_triAreas, tileCfg, heightfield);
+	}
+
+	virtual bool markAreas(rcContext* context, const rcConfig& /*tileCfg*/, const int /*tx*/, const int /*ty*/,
+						   rcCompactHeightfield& compactHeightfield)
+	{
+		return m_geom->markConvexVolumes(context, compactHeightfield);
+	}
+
+	virtual bool createTileData(rcContext* context, const rcConfig& tileCfg, const int tx, const int ty,
+								rcPolyMesh& polyMesh, rcPolyMeshDetail& detailMesh,
+								unsigned char** outData, int* outDataSize)
+	{
+		*outData = 0;
+		*outDataSize = 0;
+		if (!polyMesh.npolys)
+			return true;
+		if (tileCfg.maxVertsPerPoly > DT_VERTS_PER_POLYGON)
+		{
+			context->log(RC_LOG_ERROR, "buildTile: Too many vertices per polygon.");
+			return false;
+		}
+
+		setPolyFlags(polyMesh.areas, polyMesh.flags, polyMesh.npolys);
+
+		dtNavMeshCreateParams params;
+		fillCreateParams(m_settings, tileCfg, polyMesh, detailMesh, params);
+		setOffMeshConnections(m_geom, params);
+		params.tileX = tx;
+		params.tileY = ty;
+		if (!dtCreateNavMeshData(&params, outData, outDataSize))
+		{
+			context->log(RC_LOG_ERROR, "buildTile: Could not build Detour navmesh.");
+			return false;
+		}
+		return true;
+	}
+
+	virtual void addTile(const int /*tx*/, const int /*ty*/, unsigned char* data, const int dataSize)
+	{
+		if (dtStatusFailed(m_navMesh->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, 0)))
+			dtFree(data);
+	}
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	BatchTileCallbacks(const BatchTileCallbacks&);
+	BatchTileCallbacks& operator=(const BatchTileCallbacks&);
+
+	const InputGeom* m_geom;
+	const unsigned char* m_triAreas;
+	const rcChunkedMesh* m_chunkedMesh;
+	const BuildSettings& m_settings;
+	dtNavMesh* m_navMesh;
+};
+
+BatchTileCallbacks::~BatchTileCallbacks()
+{
+	// Defined out of line to fix the weak v-tables warning
+}
+
+// Builds the compressed layers of the "Temp Obstacles" sample and adds them to the tile cache.
+class BatchTileLayerCallbacks : public rcTileLayerBuildCallbacks
+{
+public:
+	/// @param[in]	compressors		The compressor of each worker of the dispatcher.
+	BatchTileLayerCallbacks(const InputGeom* geom, const unsigned char* triAreas, const rcChunkedMesh* chunkedMesh,
+							dtTileCacheCompressor** compressors, dtTileCache* tileCache) :
+		m_geom(geom), m_triAreas(triAreas), m_chunkedMesh(chunkedMesh), m_compressors(compressors),
+		m_tileCache(tileCache), m_dataSize(0)
+	{
+	}
+
+	virtual ~BatchTileLayerCallbacks();
+
+	virtual bool rasterizeTile(rcContext* context, const rcConfig& tileCfg, const int /*tx*/, const int /*ty*/,
+							   rcHeightfield& heightfield)
+	{
+		if (m_chunkedMesh)
+			return rcRasterizeChunkedMeshTile(context, *m_chunkedMesh, tileCfg, heightfield);
+		return rasterizeGeom(context, m_geom, m_triAreas, tileCfg, heightfield);
+	}
+
+	virtual bool markAreas(rcContext* context, const rcConfig& /*tileCfg*/, const int /*tx*/, const int /*ty*/,
+						   rcCompactHeightfield& compactHeightfield)
+	{
+		return m_geom->markConvexVolumes(context, compactHeightfield);
+	}
+
+	virtual bool createLayerData(rcContext* context, const int workerIndex, const rcConfig& /*tileCfg*/,
+								 const int tx, const int ty, const int layerIndex, const rcHeightfieldLayer& layer,
+								 unsigned char** outData, int* outDataSize)
+	{
+		*outData = 0;
+		*outDataSize = 0;
+		if (layerIndex >= MAX_LAYERS)
+			return true;
+
+		dtTileCacheLayerHeader header;
+		header.magic = DT_TILECACHE_MAGIC;
+		header.version = DT_TILECACHE_VERSION;
+		header.tx = tx;
+		header.ty = ty;
+		header.tlayer = layerIndex;
+		dtVcopy(header.bmin, layer.bmin);
+		dtVcopy(header.bmax, layer.bmax);
+		header.width = (unsigned char)layer.width;
+		header.height = (unsigned char)layer.height;
+		header.minx = (unsigned char)layer.minx;
+		header.maxx = (unsigned char)layer.maxx;
+		header.miny = (unsigned char)layer.miny;
+		header.maxy = (unsigned char)layer.maxy;
+		header.hmin = (unsigned short)layer.hmin;
+		header.hmax = (unsigned short)layer.hmax;
+
+		if (dtStatusFailed(dtBuildTileCacheLayer(m_compressors[workerIndex], &header, layer.heights, layer.areas,
+												 layer.cons, outData, outDataSize)))
+		{
+			context->log(RC_LOG_ERROR, "buildTileLayers: Could not compress layer %d of tile %d,%d.", layerIndex, tx, ty);
+			return false;
+		}
+		return true;
+	}
+
+	virtual void addLayer(const int /*tx*/, const int /*ty*/, const int /*layerIndex*/, unsigned char* data,
+						  const int dataSize)
+	{
+		if (dtStatusFailed(m_tileCache->addTile(data, dataSize, DT_COMPRESSEDTILE_FREE_DATA, 0)))
+		{
+			dtFree(data);
+			return;
+		}
+		m_dataSize += dataSize;
+	}
+
+	/// The compressed size of the layers added to the tile cache.
+	size_t getDataSize() const { return m_dataSize; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	BatchTileLayerCallbacks(const BatchTileLayerCallbacks&);
+	BatchTileLayerCallbacks& operator=(const BatchTileLayerCallbacks&);
+
+	const InputGeom* m_geom;
+	const unsigned char* m_triAreas;
+	const rcChunkedMesh* m_chunkedMesh;
+	dtTileCacheCompressor** m_compressors;
+	dtTileCache* m_tileCache;
+	size_t m_dataSize;
+};
+
+BatchTileLayerCallbacks::~BatchTileLayerCallbacks()
+{
+	// Defined out of line to fix the weak v-tables warning
+}
+
+BatchBuilder::BatchBuilder() :
+	m_geom(0),
+	m_chunkedMesh(0),
+	m_navMesh(0),
+	m_navQuery(0),
+	m_tileCache(0),
+	m_tileCount(0),
+	m_polyCount(0),
+	m_navMeshDataSize(0),
+	m_layerCount(0),
+	m_tileCacheDataSize(0)
+{
+}
+
+BatchBuilder::~BatchBuilder()
+{
+	cleanup();
+}
+
+void BatchBuilder::cleanup()
+{
+	dtFreeTileCache(m_tileCache);
+	m_tileCache = 0;
+	dtFreeNavMeshQuery(m_navQuery);
+	m_navQuery = 0;
+	dtFreeNavMesh(m_navMesh);
+	m_navMesh = 0;
+	m_tileCount = 0;
+	m_polyCount = 0;
+	m_navMeshDataSize = 0;
+	m_layerCount = 0;
+	m_tileCacheDataSize = 0;
+	m_triAreas.clear();
+}
+
+bool BatchBuilder::build(rcContext* ctx, const InputGeom* geom, const BuildSettings& settings, BatchBuildMode mode)
+{
+	cleanup();
+	if (!geom || !geom->getMesh())
+	{
+		ctx->log(RC_LOG_ERROR, "buildNavigation: Input mesh is not specified.");
+		return false;
+	}
+	m_geom = geom;
+	m_tmproc.geom = geom;
+
+	// Init build configuration from the settings, the same way the samples do.
+	rcConfig cfg;
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.cs = settings.cellSize;
+	cfg.ch = settings.cellHeight;
+	cfg.walkableSlopeAngle = settings.agentMaxSlope;
+	cfg.walkableHeight = (int)ceilf(settings.agentHeight / cfg.ch);
+	cfg.walkableClimb = (int)floorf(settings.agentMaxClimb / cfg.ch);
+	cfg.walkableRadius = (int)ceilf(settings.agentRadius / cfg.cs);
+	cfg.maxEdgeLen = (int)(settings.edgeMaxLen / settings.cellSize);
+	cfg.maxSimplificationError = settings.edgeMaxError;
+	cfg.minRegionArea = (int)rcSqr(settings.regionMinSize);
+	cfg.mergeRegionArea = (int)rcSqr(settings.regionMergeSize);
+	cfg.maxVertsPerPoly = (int)settings.vertsPerPoly;
+	cfg.detailSampleDist = settings.detailSampleDist < 0.9f ? 0 : settings.cellSize * settings.detailSampleDist;
+	cfg.detailSampleMaxError = settings.cellHeight * settings.detailSampleMaxError;
+	rcVcopy(cfg.bmin, geom->getNavMeshBoundsMin());
+	rcVcopy(cfg.bmax, geom->getNavMeshBoundsMax());
+	rcCalcGridSize(cfg.bmin, cfg.bmax, cfg.cs, &cfg.width, &cfg.height);
+	if (mode != BATCH_BUILD_SOLO)
+	{
+		cfg.tileSize = (int)settings.tileSize;
+		cfg.borderSize = cfg.walkableRadius + 3; // Reserve enough padding.
+	}
+
+	ctx->startTimer(RC_TIMER_TOTAL);
+
+	// The triangles are classified once for all tiles, in the order of the chunks of the mesh index.
+	const rcTriMeshIndex* meshIndex = geom->getMeshIndex();
+	if ((mode == BATCH_BUILD_SOLO || !m_chunkedMesh) && meshIndex->ntris > 0)
+	{
+		m_triAreas.assign(meshIndex->ntris, RC_NULL_AREA);
+		rcMarkWalkableTriangles(ctx, cfg.walkableSlopeAngle, geom->getMesh()->getVerts(), geom->getMesh()->getVertCount(),
+								meshIndex->tris, meshIndex->ntris, &m_triAreas[0]);
+	}
+
+	bool ok = false;
+	if (mode == BATCH_BUILD_SOLO)
+		ok = buildSolo(ctx, cfg, settings);
+	else if (mode == BATCH_BUILD_TILED)
+		ok = buildTiled(ctx, cfg, settings);
+	else
+		ok = buildTileCache(ctx, cfg, settings);
+	ctx->stopTimer(RC_TIMER_TOTAL);
+
+	if (ok)
+	{
+		m_navQuery = dtAllocNavMeshQuery();
+		if (!m_navQuery || dtStatusFailed(m_navQuery->init(m_navMesh, 2048)))
+		{
+			ctx->log(RC_LOG_ERROR, "buildNavigation: Could not init Detour navmesh query");
+			ok = false;
+		}
+	}
+	if (!ok)
+	{
+		cleanup();
+		return false;
+	}
+	updateStats();
+	return true;
+}
+
+bool BatchBuilder::buildSolo(rcContext* ctx, const rcConfig& cfg, const BuildSettings& settings)
+{
+	if (cfg.maxVertsPerPoly > DT_VERTS_PER_POLYGON)
+	{
+		ctx->log(RC_LOG_ERROR, "buildNavigation: Too many vertices per polygon.");
+		return false;
+	}
+
+	rcHeightfield* solid = rcAllocHeightfield();
+	rcCompactHeightfield* chf = rcAllocCompactHeightfield();
+	rcContourSet* cset = rcAllocContourSet();
+	rcPolyMesh* pmesh = rcAllocPolyMesh();
+	rcPolyMeshDetail* dmesh = rcAllocPolyMeshDetail();
+	unsigned char* navData = 0;
+	int navDataSize = 0;
+
+	bool ok = solid && chf && cset && pmesh && dmesh;
+	if (!ok)
+		ctx->log(RC_LOG_ERROR, "buildNavigation: Out of memory.");
+
+	ok = ok && rcCreateHeightfield(ctx, *solid, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch) &&
+		rasterizeGeom(ctx, m_geom, getTriAreas(), cfg, *solid);
+	if (ok)
+	{
+		filterSpans(ctx, cfg, *solid);
+		ok = rcBuildCompactHeightfield(ctx, cfg.walkableHeight, cfg.walkableClimb, *solid, *chf) &&
+			rcErodeWalkableArea(ctx, cfg.walkableRadius, *chf) && m_geom->markConvexVolumes(ctx, *chf);
+	}
+	if (ok)
+	{
+		if (settings.partitionType == SAMPLE_PARTITION_WATERSHED)
+			ok = rcBuildDistanceField(ctx, *chf) && rcBuildRegions(ctx, *chf, 0, cfg.minRegionArea, cfg.mergeRegionArea);
+		else if (settings.partitionType == SAMPLE_PARTITION_MONOTONE)
+			ok = rcBuildRegionsMonotone(ctx, *chf, 0, cfg.minRegionArea, cfg.mergeRegionArea);
+		else
+			ok = rcBuildLayerRegions(ctx, *chf, 0, cfg.minRegionArea);
+	}
+	ok = ok && rcBuildContours(ctx, *chf, cfg.maxSimplificationError, cfg.maxEdgeLen, *cset) &&
+		rcBuildPolyMesh(ctx, *cset, cfg.maxVertsPerPoly, *pmesh) &&
+		rcBuildPolyMeshDetail(ctx, *pmesh, *chf, cfg.detailSampleDist, cfg.detailSampleMaxError, *dmesh);
+	if (!ok)
+		ctx->log(RC_LOG_ERROR, "buildNavigation: Could not build the polygon mesh.");
+
+	if (ok)
+	{
+		setPolyFlags(pmesh->areas, pmesh->flags, pmesh->npolys);
+
+		dtNavMeshCreateParams params;
+		fillCreateParams(settings, cfg, *pmesh, *dmesh, params);
+		setOffMeshConnections(m_geom, params);
+		if (!dtCreateNavMeshData(&params, &navData, &navDataSize))
+		{
+			ctx->log(RC_LOG_ERROR, "Could not build Detour navmesh.");
+			ok = false;
+		}
+	}
+
+	rcFreeHeightField(solid);
+	rcFreeCompactHeightfield(chf);
+	rcFreeContourSet(cset);
+	rcFreePolyMesh(pmesh);
+	rcFreePolyMeshDetail(dmesh);
+	if (!ok)
+		return false;
+
+	m_navMesh = dtAllocNavMesh();
+	if (!m_navMesh || dtStatusFailed(m_navMesh->init(navData, navDataSize, DT_TILE_FREE_DATA)))
+	{
+		dtFree(navData);
+		ctx->log(RC_LOG_ERROR, "Could not init Detour navmesh");
+		return false;
+	}
+	return true;
+}
+
+bool BatchBuilder::initNavMesh(rcContext* ctx, const rcConfig& cfg, int maxTiles)
+{
+	// Max tiles and max polys affect how the tile IDs are caculated.
+	// There are 22 bits available for identifying a tile and a polygon.
+	const int tileBits = rcMin((int)dtIlog2(dtNextPow2(maxTiles)), 14);
+	const int polyBits = 22 - tileBits;
+
+	dtNavMeshParams params;
+	memset(&params, 0, sizeof(params));
+	rcVcopy(params.orig, cfg.bmin);
+	params.tileWidth = cfg.tileSize*cfg.cs;
+	params.tileHeight = cfg.tileSize*cfg.cs;
+	params.maxTiles = 1 << tileBits;
+	params.maxPolys = 1 << polyBits;
+
+	m_navMesh = dtAllocNavMesh();
+	if (!m_navMesh || dtStatusFailed(m_navMesh->init(&params)))
+	{
+		ctx->log(RC_LOG_ERROR, "buildTiledNavigation: Could not init navmesh.");
+		return false;
+	}
+	return true;
+}
+
+bool BatchBuilder::buildTiled(rcContext* ctx, const rcConfig& cfg, const BuildSettings& settings)
+{
+	int tw = 0, th = 0;
+	rcCalcTileGridSize(cfg, &tw, &th);
+	if (!initNavMesh(ctx, cfg, tw*th))
+		return false;
+
+	rcTileBuildConfig buildCfg;
+	memset(&buildCfg, 0, sizeof(buildCfg));
+	buildCfg.cfg = cfg;
+	if (settings.partitionType == SAMPLE_PARTITION_MONOTONE)
+		buildCfg.partitionType = RC_PARTITION_MONOTONE;
+	else if (settings.partitionType == SAMPLE_PARTITION_LAYERS)
+		buildCfg.partitionType = RC_PARTITION_LAYERS;
+	else
+		buildCfg.partitionType = RC_PARTITION_WATERSHED;
+	buildCfg.filterFlags = RC_FILTER_LOW_HANGING_OBSTACLES | RC_FILTER_LEDGE_SPANS | RC_FILTER_WALKABLE_LOW_HEIGHT;
+	buildCfg.tempArenaSize = 1024*1024;
+
+	BatchTileCallbacks callbacks(m_geom, getTriAreas(), m_chunkedMesh, settings, m_navMesh);
+	if (!rcBuildTiles(ctx, buildCfg, callbacks, 0, 0))
+	{
+		ctx->log(RC_LOG_ERROR, "buildTiledNavigation: Could not build tiles.");
+		return false;
+	}
+	return true;
+}
+
+bool BatchBuilder::buildTileCache(rcContext* ctx, const rcConfig& cfg, const BuildSettings& settings)
+{
+	int tw = 0, th = 0;
+	rcCalcTileGridSize(cfg, &tw, &th);
+
+	dtTileCacheParams tcparams;
+	memset(&tcparams, 0, sizeof(tcparams));
+	rcVcopy(tcparams.orig, cfg.bmin);
+	tcparams.cs = cfg.cs;
+	tcparams.ch = cfg.ch;
+	tcparams.width = cfg.tileSize;
+	tcparams.height = cfg.tileSize;
+	tcparams.walkableHeight = settings.agentHeight;
+	tcparams.walkableRadius = settings.agentRadius;
+	tcparams.walkableClimb = settings.agentMaxClimb;
+	tcparams.maxSimplificationError = settings.edgeMaxError;
+	tcparams.maxTiles = tw*th*EXPECTED_LAYERS_PER_TILE;
+	tcparams.maxObstacles = 128;
+
+	m_tileCache = dtAllocTileCache();
+	if (!m_tileCache || dtStatusFailed(m_tileCache->init(&tcparams, &m_talloc, &m_tcomp, &m_tmproc)))
+	{
+		ctx->log(RC_LOG_ERROR, "buildTiledNavigation: Could not init tile cache.");
+		return false;
+	}
+	if (!initNavMesh(ctx, cfg, tcparams.maxTiles))
+		return false;
+
+	rcTileBuildConfig buildCfg;
+	memset(&buildCfg, 0, sizeof(buildCfg));
+	buildCfg.cfg = cfg;
+	buildCfg.filterFlags = RC_FILTER_LOW_HANGING_OBSTACLES | RC_FILTER_LEDGE_SPANS | RC_FILTER_WALKABLE_LOW_HEIGHT;
+	buildCfg.tempArenaSize = 1024*1024;
+
+	// The layers are built serially, which needs one compressor.
+	dtTileCacheCompressor* compressors[1] = { &m_tcomp };
+	BatchTileLayerCallbacks callbacks(m_geom, getTriAreas(), m_chunkedMesh, compressors, m_tileCache);
+	if (!rcBuildTileLayers(ctx, buildCfg, callbacks, 0, 0, 0, 0, tw - 1, th - 1, &m_layerCount))
+	{
+		ctx->log(RC_LOG_ERROR, "buildTiledNavigation: Could not build tile layers.");
+		return false;
+	}
+	m_tileCacheDataSize = callbacks.getDataSize();
+
+	for (int y = 0; y < th; ++y)
+	{
+		for (int x = 0; x < tw; ++x)
+		{
+			if (dtStatusFailed(m_tileCache->buildNavMeshTilesAt(x, y, m_navMesh)))
+			{
+				ctx->log(RC_LOG_ERROR, "buildTiledNavigation: Could not build tile %d,%d.", x, y);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void BatchBuilder::updateStats()
+{
+	const dtNavMesh* nav = m_navMesh;
+	for (int i = 0; i < nav->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = nav->getTile(i);
+		if (!tile || !tile->header)
+			continue;
+		m_tileCount++;
+		m_polyCount += tile->header->polyCount;
+		m_navMeshDataSize += tile->dataSize;
+	}
+}
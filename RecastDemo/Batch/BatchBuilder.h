@@ -0,0 +1,120 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#ifndef RECASTBATCHBUILDER_H
+#define RECASTBATCHBUILDER_H
+
+#include <stddef.h>
+#include <vector>
+#include "Recast.h"
+#include "DetourTileCache.h"
+#include "DetourTileCacheBuilder.h"
+#include "DetourTileCacheCompressor.h"
+
+class InputGeom;
+class rcChunkedMesh;
+struct BuildSettings;
+class dtNavMesh;
+class dtNavMeshQuery;
+
+/// The kind of navigation mesh to build, matching the samples of the demo.
+enum BatchBuildMode
+{
+	BATCH_BUILD_SOLO,		///< A single tile, like the "Solo Mesh" sample.
+	BATCH_BUILD_TILED,		///< A tiled mesh, like the "Tile Mesh" sample.
+	BATCH_BUILD_TILECACHE	///< A tiled mesh built from tile cache layers, like the "Temp Obstacles" sample.
+};
+
+/// Sets the poly flags of a mesh from its areas the same way the demo samples do.
+struct BatchMeshProcess : public dtTileCacheMeshProcess
+{
+	const InputGeom* geom;
+
+	BatchMeshProcess() : geom(0) {}
+	virtual ~BatchMeshProcess();
+	virtual void process(struct dtNavMeshCreateParams* params, unsigned char* polyAreas, unsigned short* polyFlags);
+};
+
+/// Builds the navigation mesh of an input geometry without the demo's user interface.
+class BatchBuilder
+{
+public:
+	BatchBuilder();
+	~BatchBuilder();
+
+	/// Builds the navigation mesh, replacing the previous one.
+	///  @param[in]	ctx			The build context. The whole build is timed with #RC_TIMER_TOTAL.
+	///  @param[in]	geom		The input geometry, including its off-mesh connections and convex volumes.
+	///  @param[in]	settings	The build settings.
+	///  @param[in]	mode		The kind of navigation mesh to build.
+	/// @returns True if the build succeeded.
+	bool build(rcContext* ctx, const InputGeom* geom, const BuildSettings& settings, BatchBuildMode mode);
+
+	/// Rasterizes the tiles of the tiled builds from a chunked mesh instead of the triangles of the
+	/// input geometry. The solo build always uses the input geometry.
+	///  @param[in]	mesh	The chunked mesh of the input geometry, or null to use the geometry. [opt]
+	void setChunkedMesh(const rcChunkedMesh* mesh) { m_chunkedMesh = mesh; }
+
+	dtNavMesh* getNavMesh() { return m_navMesh; }
+	dtNavMeshQuery* getNavMeshQuery() { return m_navQuery; }
+	dtTileCache* getTileCache() { return m_tileCache; }
+
+	/// The number of tiles in the navigation mesh.
+	int getTileCount() const { return m_tileCount; }
+	/// The number of polygons in the navigation mesh.
+	int getPolyCount() const { return m_polyCount; }
+	/// The size of the tile data of the navigation mesh in bytes.
+	size_t getNavMeshDataSize() const { return m_navMeshDataSize; }
+	/// The number of tile cache layers. (Zero unless built with #BATCH_BUILD_TILECACHE.)
+	int getLayerCount() const { return m_layerCount; }
+	/// The compressed size of the tile cache layers in bytes.
+	size_t getTileCacheDataSize() const { return m_tileCacheDataSize; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	BatchBuilder(const BatchBuilder&);
+	BatchBuilder& operator=(const BatchBuilder&);
+
+	void cleanup();
+	bool buildSolo(rcContext* ctx, const rcConfig& cfg, const BuildSettings& settings);
+	bool buildTiled(rcContext* ctx, const rcConfig& cfg, const BuildSettings& settings);
+	bool buildTileCache(rcContext* ctx, const rcConfig& cfg, const BuildSettings& settings);
+	bool initNavMesh(rcContext* ctx, const rcConfig& cfg, int maxTiles);
+	void updateStats();
+	const unsigned char* getTriAreas() const { return m_triAreas.empty() ? 0 : &m_triAreas[0]; }
+
+	const InputGeom* m_geom;
+	const rcChunkedMesh* m_chunkedMesh;
+	dtNavMesh* m_navMesh;
+	dtNavMeshQuery* m_navQuery;
+	dtTileCache* m_tileCache;
+	dtTileCacheAlloc m_talloc;
+	dtTileCacheRLECompressor m_tcomp;
+	BatchMeshProcess m_tmproc;
+	/// The area ids of the input triangles in the order of rcTriMeshIndex::tris.
+	std::vector<unsigned char> m_triAreas;
+
+	int m_tileCount;
+	int m_polyCount;
+	size_t m_navMeshDataSize;
+	int m_layerCount;
+	size_t m_tileCacheDataSize;
+};
+
+#endif // RECASTBATCHBUILDER_H
@@ -0,0 +1,979 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+// Builds navigation meshes without the demo's user interface and runs the
+// query tests of a test case on them. The results are printed to stdout as
+// one JSON object per line, the log goes to stderr.
+//
+//   RecastBatch [options] <mesh.obj | mesh.gset | testcase.txt>
+//
+// With --tune the geometry is built once for each of a list of tile sizes and
+// a query workload is run on every build instead. The measurements of every
+// tile size are printed as the trade-off curve, followed by the recommended
+// tile size, nav mesh bit split and node budgets.
+//
+// The exit code is 0 on success, 1 on errors and 2 if a time limit was
+// exceeded or, with --strict, a test failed.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "BatchBuilder.h"
+#include "InputGeom.h"
+#include "PerfTimer.h"
+#include "Sample.h"
+#include "TestCase.h"
+#include "Recast.h"
+#include "RecastChunkedMesh.h"
+#include "RecastProfiler.h"
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshFile.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNode.h"
+
+#ifndef RECASTBATCH_MESH_DIR
+#define RECASTBATCH_MESH_DIR "Meshes"
+#endif
+
+namespace
+{
+
+/// A profiling context which prints the build log to stderr.
+class BatchContext : public rcProfilingContext
+{
+public:
+	bool verbose;
+
+	BatchContext() : verbose(false) {}
+
+protected:
+	virtual void doLog(const rcLogCategory category, const char* msg, const int len)
+	{
+		if (category == RC_LOG_PROGRESS && !verbose)
+			return;
+		const char* prefix = category == RC_LOG_ERROR ? "error: " : (category == RC_LOG_WARNING ? "warning: " : "");
+		fprintf(stderr, "%s%.*s\n", prefix, len, msg);
+	}
+};
+
+struct Options
+{
+	std::string input;
+	std::string meshDir;
+	std::string output;
+	std::string chunkedMesh;
+	BuildSettings settings;
+	bool settingsSet[15];
+	int mode;
+	int repeat;
+	float maxBuildMs;
+	float maxQueryMs;
+	bool strict;
+	bool verbose;
+	std::vector<int> tuneTileSizes;
+	int samples;
+};
+
+// The settings which can be set from the command line, in the order of settingsSet.
+enum SettingOption
+{
+	OPT_CELL_SIZE,
+	OPT_CELL_HEIGHT,
+	OPT_AGENT_HEIGHT,
+	OPT_AGENT_RADIUS,
+	OPT_AGENT_CLIMB,
+	OPT_AGENT_SLOPE,
+	OPT_REGION_MIN_SIZE,
+	OPT_REGION_MERGE_SIZE,
+	OPT_EDGE_MAX_LEN,
+	OPT_EDGE_MAX_ERROR,
+	OPT_VERTS_PER_POLY,
+	OPT_DETAIL_SAMPLE_DIST,
+	OPT_DETAIL_SAMPLE_ERROR,
+	OPT_PARTITION,
+	OPT_TILE_SIZE,
+	OPT_COUNT
+};
+
+const char* s_settingNames[OPT_COUNT] =
+{
+	"--cell-size",
+	"--cell-height",
+	"--agent-height",
+	"--agent-radius",
+	"--agent-climb",
+	"--agent-slope",
+	"--region-min-size",
+	"--region-merge-size",
+	"--edge-max-len",
+	"--edge-max-error",
+	"--verts-per-poly",
+	"--detail-sample-dist",
+	"--detail-sample-error",
+	"--partition",
+	"--tile-size",
+};
+
+float* getSetting(BuildSettings& settings, const int option)
+{
+	switch (option)
+	{
+	case OPT_CELL_SIZE: return &settings.cellSize;
+	case OPT_CELL_HEIGHT: return &settings.cellHeight;
+	case OPT_AGENT_HEIGHT: return &settings.agentHeight;
+	case OPT_AGENT_RADIUS: return &settings.agentRadius;
+	case OPT_AGENT_CLIMB: return &settings.agentMaxClimb;
+	case OPT_AGENT_SLOPE: return &settings.agentMaxSlope;
+	case OPT_REGION_MIN_SIZE: return &settings.regionMinSize;
+	case OPT_REGION_MERGE_SIZE: return &settings.regionMergeSize;
+	case OPT_EDGE_MAX_LEN: return &settings.edgeMaxLen;
+	case OPT_EDGE_MAX_ERROR: return &settings.edgeMaxError;
+	case OPT_VERTS_PER_POLY: return &settings.vertsPerPoly;
+	case OPT_DETAIL_SAMPLE_DIST: return &settings.detailSampleDist;
+	case OPT_DETAIL_SAMPLE_ERROR: return &settings.detailSampleMaxError;
+	case OPT_TILE_SIZE: return &settings.tileSize;
+	default: return 0;
+	}
+}
+
+// The defaults of the demo's samples.
+void resetSettings(BuildSettings& settings)
+{
+	memset(&settings, 0, sizeof(settings));
+	settings.cellSize = 0.3f;
+	settings.cellHeight = 0.2f;
+	settings.agentHeight = 2.0f;
+	settings.agentRadius = 0.6f;
+	settings.agentMaxClimb = 0.9f;
+	settings.agentMaxSlope = 45.0f;
+	settings.regionMinSize = 8;
+	settings.regionMergeSize = 20;
+	settings.edgeMaxLen = 12.0f;
+	settings.edgeMaxError = 1.3f;
+	settings.vertsPerPoly = 6.0f;
+	settings.detailSampleDist = 6.0f;
+	settings.detailSampleMaxError = 1.0f;
+	settings.partitionType = SAMPLE_PARTITION_WATERSHED;
+	settings.tileSize = 48;
+}
+
+void printUsage()
+{
+	fprintf(stderr,
+		"usage: RecastBatch [options] <mesh.obj | mesh.gset | testcase.txt>\n"
+		"\n"
+		"  --mode solo|tiled|tilecache  The kind of mesh to build. Defaults to the sample of\n"
+		"                               the test case, or solo.\n"
+		"  --meshes <dir>               The directory of the meshes of test cases.\n"
+		"  --output <file>              Writes the navigation mesh to a file.\n"
+		"  --chunked-mesh <file>        Writes the geometry to a chunked mesh file and rasterizes the\n"
+		"                               tiles of the tiled modes from the file.\n"
+		"  --repeat <n>                 Runs the tests n times and reports the fastest run.\n"
+		"  --max-build-ms <ms>          Fails if the build takes longer.\n"
+		"  --max-query-ms <ms>          Fails if the tests take longer.\n"
+		"  --strict                     Fails if a test finds no path.\n"
+		"  --verbose                    Prints the build progress log.\n"
+		"\n"
+		"  --tune <size,size,...>       Builds a tiled mesh for each tile size, runs the tests\n"
+		"                               and the path samples on it and recommends the tile size,\n"
+		"                               the tile and poly bits and the node budgets.\n"
+		"  --samples <n>                The number of random paths of --tune. Defaults to 0\n"
+		"                               with a test case and 200 otherwise.\n"
+		"\n"
+		"Build settings override the settings of a .gset file:\n"
+		"  --cell-size, --cell-height, --agent-height, --agent-radius, --agent-climb,\n"
+		"  --agent-slope, --region-min-size, --region-merge-size, --edge-max-len,\n"
+		"  --edge-max-error, --verts-per-poly, --detail-sample-dist, --detail-sample-error,\n"
+		"  --tile-size <value>\n"
+		"  --partition watershed|monotone|layers\n");
+}
+
+bool parseMode(const char* name, int& mode)
+{
+	if (strcmp(name, "solo") == 0)
+		mode = BATCH_BUILD_SOLO;
+	else if (strcmp(name, "tiled") == 0)
+		mode = BATCH_BUILD_TILED;
+	else if (strcmp(name, "tilecache") == 0)
+		mode = BATCH_BUILD_TILECACHE;
+	else
+		return false;
+	return true;
+}
+
+bool parsePartition(const char* name, float& partition)
+{
+	if (strcmp(name, "watershed") == 0)
+		partition = SAMPLE_PARTITION_WATERSHED;
+	else if (strcmp(name, "monotone") == 0)
+		partition = SAMPLE_PARTITION_MONOTONE;
+	else if (strcmp(name, "layers") == 0)
+		partition = SAMPLE_PARTITION_LAYERS;
+	else
+		return false;
+	return true;
+}
+
+// Parses a comma separated list of tile sizes.
+bool parseTileSizes(const char* list, std::vector<int>& sizes)
+{
+	sizes.clear();
+	const char* str = list;
+	while (*str)
+	{
+		char* end = 0;
+		const long size = strtol(str, &end, 10);
+		if (end == str || size <= 0 || size > 1024 || (*end != ',' && *end != '\0'))
+			return false;
+		sizes.push_back((int)size);
+		str = *end ? end + 1 : end;
+	}
+	return !sizes.empty();
+}
+
+bool parseArgs(int argc, char** argv, Options& opts)
+{
+	resetSettings(opts.settings);
+	memset(opts.settingsSet, 0, sizeof(opts.settingsSet));
+	opts.meshDir = RECASTBATCH_MESH_DIR;
+	opts.mode = -1;
+	opts.repeat = 1;
+	opts.maxBuildMs = 0;
+	opts.maxQueryMs = 0;
+	opts.strict = false;
+	opts.verbose = false;
+	opts.samples = -1;
+
+	// The partition is parsed into a float so that all settings share one path.
+	float partition = (float)opts.settings.partitionType;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : 0;
+
+		if (strcmp(arg, "--strict") == 0)
+		{
+			opts.strict = true;
+			continue;
+		}
+		if (strcmp(arg, "--verbose") == 0)
+		{
+			opts.verbose = true;
+			continue;
+		}
+		if (strncmp(arg, "--", 2) != 0)
+		{
+			if (!opts.input.empty())
+			{
+				fprintf(stderr, "error: More than one input file.\n");
+				return false;
+			}
+			opts.input = arg;
+			continue;
+		}
+
+		// All remaining options take a value.
+		if (!value)
+		{
+			fprintf(stderr, "error: Missing value for '%s'.\n", arg);
+			return false;
+		}
+		i++;
+
+		bool valid = true;
+		if (strcmp(arg, "--mode") == 0)
+			valid = parseMode(value, opts.mode);
+		else if (strcmp(arg, "--meshes") == 0)
+			opts.meshDir = value;
+		else if (strcmp(arg, "--output") == 0)
+			opts.output = value;
+		else if (strcmp(arg, "--chunked-mesh") == 0)
+			opts.chunkedMesh = value;
+		else if (strcmp(arg, "--repeat") == 0)
+			valid = (opts.repeat = atoi(value)) > 0;
+		else if (strcmp(arg, "--max-build-ms") == 0)
+			valid = (opts.maxBuildMs = (float)atof(value)) > 0;
+		else if (strcmp(arg, "--max-query-ms") == 0)
+			valid = (opts.maxQueryMs = (float)atof(value)) > 0;
+		else if (strcmp(arg, "--tune") == 0)
+			valid = parseTileSizes(value, opts.tuneTileSizes);
+		else if (strcmp(arg, "--samples") == 0)
+			valid = (opts.samples = atoi(value)) >= 0;
+		else
+		{
+			int option = 0;
+			while (option < OPT_COUNT && strcmp(arg, s_settingNames[option]) != 0)
+				option++;
+			if (option == OPT_COUNT)
+			{
+				fprintf(stderr, "error: Unknown option '%s'.\n", arg);
+				return false;
+			}
+			if (option == OPT_PARTITION)
+				valid = parsePartition(value, partition);
+			else
+				*getSetting(opts.settings, option) = (float)atof(value);
+			opts.settingsSet[option] = true;
+		}
+
+		if (!valid)
+		{
+			fprintf(stderr, "error: Invalid value '%s' for '%s'.\n", value, arg);
+			return false;
+		}
+	}
+	opts.settings.partitionType = (int)partition;
+
+	if (opts.input.empty())
+	{
+		fprintf(stderr, "error: No input file.\n");
+		return false;
+	}
+	if (!opts.tuneTileSizes.empty())
+	{
+		if (opts.mode == BATCH_BUILD_SOLO)
+		{
+			fprintf(stderr, "error: --tune needs a tiled mode.\n");
+			return false;
+		}
+		if (!opts.output.empty() || !opts.chunkedMesh.empty() || opts.maxBuildMs > 0 || opts.maxQueryMs > 0 ||
+			opts.strict)
+		{
+			fprintf(stderr, "error: --tune can not be combined with --output, --chunked-mesh, the time limits or --strict.\n");
+			return false;
+		}
+	}
+	return true;
+}
+
+// Applies the settings given on the command line over the settings of the geometry.
+void mergeSettings(const Options& opts, const BuildSettings* geomSettings, BuildSettings& settings)
+{
+	BuildSettings given = opts.settings;
+	resetSettings(settings);
+	if (geomSettings)
+		settings = *geomSettings;
+	for (int i = 0; i < OPT_COUNT; ++i)
+	{
+		if (!opts.settingsSet[i])
+			continue;
+		if (i == OPT_PARTITION)
+			settings.partitionType = opts.settings.partitionType;
+		else
+			*getSetting(settings, i) = *getSetting(given, i);
+	}
+}
+
+bool endsWith(const std::string& str, const char* suffix)
+{
+	const size_t len = strlen(suffix);
+	return str.size() >= len && str.compare(str.size() - len, len, suffix) == 0;
+}
+
+const char* getModeName(const int mode)
+{
+	switch (mode)
+	{
+	case BATCH_BUILD_TILED: return "tiled";
+	case BATCH_BUILD_TILECACHE: return "tilecache";
+	default: return "solo";
+	}
+}
+
+// 64-bit file offsets, chunked meshes can be larger than 2GB.
+int seekFile(FILE* fp, const uint64_t offset, const int origin)
+{
+#ifdef _WIN32
+	return _fseeki64(fp, (__int64)offset, origin);
+#else
+	return fseeko(fp, (off_t)offset, origin);
+#endif
+}
+
+uint64_t tellFile(FILE* fp)
+{
+#ifdef _WIN32
+	return (uint64_t)_ftelli64(fp);
+#else
+	return (uint64_t)ftello(fp);
+#endif
+}
+
+class FileChunkedMeshOutput : public rcChunkedMeshOutput
+{
+public:
+	explicit FileChunkedMeshOutput(FILE* fp) : m_fp(fp) {}
+
+	virtual bool write(const void* data, const int size)
+	{
+		return fwrite(data, 1, (size_t)size, m_fp) == (size_t)size;
+	}
+
+private:
+	FILE* m_fp;
+};
+
+// Not thread safe, the tiles of the batch builds are built serially.
+class FileChunkedMeshInput : public rcChunkedMeshInput
+{
+public:
+	explicit FileChunkedMeshInput(FILE* fp) : m_fp(fp) {}
+
+	virtual bool read(void* data, const uint64_t offset, const int size)
+	{
+		return seekFile(m_fp, offset, SEEK_SET) == 0 && fread(data, 1, (size_t)size, m_fp) == (size_t)size;
+	}
+
+	virtual uint64_t getSize()
+	{
+		if (seekFile(m_fp, 0, SEEK_END) != 0)
+			return 0;
+		return tellFile(m_fp);
+	}
+
+private:
+	FILE* m_fp;
+};
+
+// Writes the triangles of the geometry into a chunked mesh with one cell per tile.
+bool writeChunkedMesh(rcContext* ctx, const InputGeom& geom, const BuildSettings& settings, const std::string& path)
+{
+	FILE* fp = fopen(path.c_str(), "wb");
+	if (!fp)
+		return false;
+
+	const rcMeshLoaderObj* mesh = geom.getMesh();
+	FileChunkedMeshOutput out(fp);
+	rcChunkedMeshWriter writer;
+	bool ok = writer.init(ctx, geom.getNavMeshBoundsMin(), geom.getNavMeshBoundsMax(),
+						  settings.tileSize * settings.cellSize, 64*1024, &out) &&
+		writer.addTriangles(ctx, mesh->getVerts(), mesh->getVertCount(), mesh->getTris(), 0, mesh->getTriCount()) &&
+		writer.finish(ctx);
+	ok &= fclose(fp) == 0;
+	return ok;
+}
+
+bool writeNavMesh(const dtNavMesh* nav, const std::string& path)
+{
+	unsigned char* data = 0;
+	size_t dataSize = 0;
+	if (dtStatusFailed(dtCreateNavMeshFile(nav, &data, &dataSize)))
+		return false;
+	FILE* fp = fopen(path.c_str(), "wb");
+	bool ok = fp != 0;
+	if (fp)
+	{
+		ok = fwrite(data, 1, dataSize, fp) == dataSize;
+		ok &= fclose(fp) == 0;
+	}
+	dtFree(data);
+	return ok;
+}
+
+// The node budget of the tuning searches, the largest one a dtNavMeshQuery supports.
+const int TUNE_MAX_NODES = 65535;
+// The node budget of the path queue of dtCrowd, MAX_PATHQUEUE_NODES in DetourCrowd.cpp.
+const int CROWD_PATHQUEUE_NODES = 4096;
+const int MAX_SAMPLE_POLYS = 256;
+
+// A fixed sequence, so that every run of the tool uses the same samples.
+unsigned int s_sampleSeed = 1;
+
+float sampleRandom()
+{
+	s_sampleSeed = s_sampleSeed * 1103515245u + 12345u;
+	return (float)((s_sampleSeed >> 8) & 0xffff) / 65536.0f;
+}
+
+struct PathSample
+{
+	float spos[3];
+	float epos[3];
+};
+
+/// The outcome of one run of the tuning workload. Times are in microseconds.
+struct TuneWorkload
+{
+	int time;
+	int queries;
+	int failed;
+	int maxNodes;
+	int outOfNodes;
+};
+
+/// The measurements of the build with one tile size.
+struct TuneResult
+{
+	int tileSize;
+	float buildMs;
+	size_t memoryBytes;
+	int tiles;
+	int polys;
+	int maxTiles;
+	int maxTilePolys;
+	TuneWorkload workload;
+	double score;
+	bool pareto;
+};
+
+void generateSamples(const dtNavMeshQuery* query, const int count, std::vector<PathSample>& samples)
+{
+	dtQueryFilter filter;
+	s_sampleSeed = 1;
+	for (int i = 0; i < count; ++i)
+	{
+		PathSample sample;
+		dtPolyRef startRef = 0, endRef = 0;
+		if (dtStatusSucceed(query->findRandomPoint(&filter, sampleRandom, &startRef, sample.spos)) &&
+			dtStatusSucceed(query->findRandomPoint(&filter, sampleRandom, &endRef, sample.epos)))
+			samples.push_back(sample);
+	}
+}
+
+// Runs the path samples with the same queries as the path-finding tests of a test case.
+void runSamples(dtNavMeshQuery* query, const std::vector<PathSample>& samples, TuneWorkload& workload)
+{
+	const float halfExtents[3] = { 2, 4, 2 };
+	dtQueryFilter filter;
+	dtPolyRef polys[MAX_SAMPLE_POLYS];
+	float straight[MAX_SAMPLE_POLYS * 3];
+
+	for (size_t i = 0; i < samples.size(); ++i)
+	{
+		const PathSample& sample = samples[i];
+		const TimeVal start = getPerfTime();
+
+		dtPolyRef startRef = 0, endRef = 0;
+		float nspos[3], nepos[3];
+		query->findNearestPoly(sample.spos, halfExtents, &filter, &startRef, nspos);
+		query->findNearestPoly(sample.epos, halfExtents, &filter, &endRef, nepos);
+		int npolys = 0;
+		if (startRef && endRef)
+		{
+			const dtStatus status = query->findPath(startRef, endRef, nspos, nepos, &filter, polys, &npolys,
+													MAX_SAMPLE_POLYS);
+			workload.maxNodes = dtMax(workload.maxNodes, query->getNodePool()->getNodeCount());
+			if (dtStatusDetail(status, DT_OUT_OF_NODES))
+				workload.outOfNodes++;
+			int nstraight = 0;
+			if (npolys)
+				query->findStraightPath(nspos, nepos, polys, npolys, straight, 0, 0, &nstraight, MAX_SAMPLE_POLYS);
+		}
+
+		workload.time += getPerfTimeUsec(getPerfTime() - start);
+		workload.queries++;
+		if (!npolys)
+			workload.failed++;
+	}
+}
+
+void runTests(TestCase* test, dtNavMesh* nav, dtNavMeshQuery* query, TuneWorkload& workload)
+{
+	test->doTests(nav, query, false);
+	for (int i = 0; i < test->getTestCount(); ++i)
+	{
+		TestCase::TestResult res;
+		test->getTestResult(i, res);
+		workload.time += res.findNearestPolyTime + res.findPathTime + res.findStraightPathTime;
+		workload.queries++;
+		if (!res.raycast && res.npolys == 0)
+			workload.failed++;
+		workload.maxNodes = dtMax(workload.maxNodes, res.nodes);
+		if (res.outOfNodes)
+			workload.outOfNodes++;
+	}
+}
+
+// The number of tiles the nav mesh must have room for. Every cell of the grid can hold a tile of a
+// tiled mesh, a tile cache adds a tile for each of its layers.
+int getRequiredTileCount(const InputGeom& geom, const BuildSettings& settings, const BatchBuilder& builder,
+						 const int mode)
+{
+	if (mode == BATCH_BUILD_TILECACHE)
+		return builder.getLayerCount();
+	int gw = 0, gh = 0;
+	rcCalcGridSize(geom.getNavMeshBoundsMin(), geom.getNavMeshBoundsMax(), settings.cellSize, &gw, &gh);
+	const int ts = (int)settings.tileSize;
+	return ((gw + ts - 1) / ts) * ((gh + ts - 1) / ts);
+}
+
+int getMaxTilePolyCount(const dtNavMesh* nav)
+{
+	int maxPolys = 0;
+	for (int i = 0; i < nav->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = nav->getTile(i);
+		if (tile && tile->header)
+			maxPolys = dtMax(maxPolys, tile->header->polyCount);
+	}
+	return maxPolys;
+}
+
+// Marks the results which are not beaten in build time, memory and query time by any other result
+// and scores them by the sum of their costs relative to the best cost.
+void rankResults(std::vector<TuneResult>& results)
+{
+	double minBuild = 0, minMemory = 0, minQuery = 0;
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const TuneResult& res = results[i];
+		if (i == 0 || res.buildMs < minBuild)
+			minBuild = res.buildMs;
+		if (i == 0 || res.memoryBytes < minMemory)
+			minMemory = (double)res.memoryBytes;
+		if (i == 0 || res.workload.time < minQuery)
+			minQuery = res.workload.time;
+	}
+
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		TuneResult& res = results[i];
+		res.score = res.buildMs / dtMax(minBuild, 0.001) + res.memoryBytes / dtMax(minMemory, 1.0) +
+			res.workload.time / dtMax(minQuery, 1.0);
+		res.pareto = true;
+		for (size_t j = 0; j < results.size() && res.pareto; ++j)
+		{
+			const TuneResult& other = results[j];
+			if (j == i)
+				continue;
+			const bool notWorse = other.buildMs <= res.buildMs && other.memoryBytes <= res.memoryBytes &&
+				other.workload.time <= res.workload.time;
+			const bool better = other.buildMs < res.buildMs || other.memoryBytes < res.memoryBytes ||
+				other.workload.time < res.workload.time;
+			if (notWorse && better)
+				res.pareto = false;
+		}
+	}
+}
+
+// Builds the geometry with every tile size of the options and prints the measurements and the
+// recommended parameters.
+int tune(BatchContext& ctx, const Options& opts, const InputGeom& geom, const BuildSettings& baseSettings,
+		 const int mode, TestCase* test)
+{
+	const int sampleCount = opts.samples >= 0 ? opts.samples : (test ? 0 : 200);
+	if (!test && sampleCount == 0)
+	{
+		fprintf(stderr, "error: --tune needs a test case or path samples.\n");
+		return 1;
+	}
+
+	std::vector<PathSample> samples;
+	std::vector<TuneResult> results;
+	for (size_t i = 0; i < opts.tuneTileSizes.size(); ++i)
+	{
+		BuildSettings settings = baseSettings;
+		settings.tileSize = (float)opts.tuneTileSizes[i];
+
+		ctx.resetTimers();
+		BatchBuilder builder;
+		if (!builder.build(&ctx, &geom, settings, (BatchBuildMode)mode))
+		{
+			fprintf(stderr, "error: Could not build with tile size %d.\n", opts.tuneTileSizes[i]);
+			continue;
+		}
+
+		// The samples are picked on the first mesh, the same points are used with every tile size.
+		if (results.empty())
+			generateSamples(builder.getNavMeshQuery(), sampleCount, samples);
+
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		if (!query || dtStatusFailed(query->init(builder.getNavMesh(), TUNE_MAX_NODES)))
+		{
+			fprintf(stderr, "error: Could not init the navmesh query.\n");
+			dtFreeNavMeshQuery(query);
+			return 1;
+		}
+
+		TuneResult res;
+		memset(&res, 0, sizeof(res));
+		res.tileSize = opts.tuneTileSizes[i];
+		res.buildMs = ctx.getStageStats(RC_TIMER_TOTAL).time / 1000.0f;
+		res.tiles = builder.getTileCount();
+		res.polys = builder.getPolyCount();
+		res.maxTiles = getRequiredTileCount(geom, settings, builder, mode);
+		res.maxTilePolys = getMaxTilePolyCount(builder.getNavMesh());
+		// The tile array of the nav mesh grows with the tile bits.
+		res.memoryBytes = builder.getNavMeshDataSize() + builder.getTileCacheDataSize() +
+			dtNextPow2((unsigned int)dtMax(res.maxTiles, 1)) * sizeof(dtMeshTile);
+
+		// Every run measures the same queries, the fastest run is kept.
+		for (int run = 0; run < opts.repeat; ++run)
+		{
+			TuneWorkload workload;
+			memset(&workload, 0, sizeof(workload));
+			if (test)
+				runTests(test, builder.getNavMesh(), query, workload);
+			runSamples(query, samples, workload);
+			if (run == 0 || workload.time < res.workload.time)
+				res.workload = workload;
+		}
+		dtFreeNavMeshQuery(query);
+		results.push_back(res);
+	}
+	if (results.empty())
+		return 1;
+
+	rankResults(results);
+
+	// Candidates which fail more queries than the others are not recommended.
+	int minFailed = results[0].workload.failed;
+	for (size_t i = 1; i < results.size(); ++i)
+		minFailed = dtMin(minFailed, results[i].workload.failed);
+	size_t best = results.size();
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const TuneResult& res = results[i];
+		printf("{\"type\":\"tune\",\"mode\":\"%s\",\"tile_size\":%d,\"build_ms\":%.3f,\"memory_bytes\":%lu,"
+			   "\"query_ms\":%.3f,\"queries\":%d,\"failed\":%d,\"tiles\":%d,\"polys\":%d,\"max_tiles\":%d,"
+			   "\"max_tile_polys\":%d,\"max_nodes\":%d,\"out_of_nodes\":%d,\"pareto\":%s,\"score\":%.3f}\n",
+			   getModeName(mode), res.tileSize, res.buildMs, (unsigned long)res.memoryBytes,
+			   res.workload.time / 1000.0f, res.workload.queries, res.workload.failed, res.tiles, res.polys,
+			   res.maxTiles, res.maxTilePolys, res.workload.maxNodes, res.workload.outOfNodes,
+			   res.pareto ? "true" : "false", res.score);
+		if (res.workload.failed == minFailed && (best == results.size() || res.score < results[best].score))
+			best = i;
+	}
+
+	// The tile and poly bits must leave at least 10 salt bits of a 32-bit polygon reference.
+	const TuneResult& rec = results[best];
+	const int tileBits = (int)dtIlog2(dtNextPow2((unsigned int)dtMax(rec.maxTiles, 1)));
+	const int polyBits = (int)dtIlog2(dtNextPow2((unsigned int)dtMax(rec.maxTilePolys, 1)));
+	const bool fits32 = tileBits + polyBits <= 22;
+
+	// Headroom for searches longer than the workload, rounded like the hash of the node pool.
+	int maxNodes = TUNE_MAX_NODES;
+	if (rec.workload.outOfNodes == 0)
+	{
+		const unsigned int needed = (unsigned int)dtMax(64, rec.workload.maxNodes * 5 / 4);
+		maxNodes = (int)dtMin((unsigned int)TUNE_MAX_NODES, dtNextPow2(needed));
+	}
+
+	printf("{\"type\":\"recommendation\",\"mode\":\"%s\",\"tile_size\":%d,\"tile_bits\":%d,\"poly_bits\":%d,"
+		   "\"max_tiles\":%d,\"max_polys\":%d,\"polyref64\":%s,\"max_nodes\":%d,\"path_queue_nodes\":%d}\n",
+		   getModeName(mode), rec.tileSize, tileBits, polyBits, 1 << tileBits, 1 << polyBits,
+		   fits32 ? "false" : "true", maxNodes, maxNodes);
+
+	if (!fits32)
+		fprintf(stderr, "warning: %d tile bits and %d poly bits do not fit a 32-bit polygon reference, build with DT_POLYREF64.\n",
+				tileBits, polyBits);
+	if (rec.workload.outOfNodes > 0)
+		fprintf(stderr, "warning: %d queries ran out of %d nodes.\n", rec.workload.outOfNodes, TUNE_MAX_NODES);
+	if (maxNodes > CROWD_PATHQUEUE_NODES)
+		fprintf(stderr, "warning: The paths need more than the %d nodes of the crowd path queue.\n",
+				CROWD_PATHQUEUE_NODES);
+	return 0;
+}
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+	Options opts;
+	if (!parseArgs(argc, argv, opts))
+	{
+		printUsage();
+		return 1;
+	}
+
+	BatchContext ctx;
+	ctx.verbose = opts.verbose;
+	rcProfilingContext::enableAllocTracking();
+
+	// A test case names the geometry and the sample to build it with.
+	TestCase* test = 0;
+	std::string geomPath = opts.input;
+	int mode = opts.mode;
+	if (endsWith(opts.input, ".txt"))
+	{
+		test = new TestCase;
+		if (!test->load(opts.input))
+		{
+			fprintf(stderr, "error: Could not load test case '%s'.\n", opts.input.c_str());
+			delete test;
+			return 1;
+		}
+		geomPath = opts.meshDir + "/" + test->getGeomFileName();
+		if (mode < 0)
+		{
+			if (test->getSampleName() == "Tile Mesh")
+				mode = BATCH_BUILD_TILED;
+			else if (test->getSampleName() == "Temp Obstacles")
+				mode = BATCH_BUILD_TILECACHE;
+		}
+	}
+	if (mode < 0)
+		mode = opts.tuneTileSizes.empty() ? BATCH_BUILD_SOLO : BATCH_BUILD_TILED;
+	else if (mode == BATCH_BUILD_SOLO && !opts.tuneTileSizes.empty())
+		mode = BATCH_BUILD_TILED;
+
+	InputGeom geom;
+	if (!geom.load(&ctx, geomPath))
+	{
+		fprintf(stderr, "error: Could not load geometry '%s'.\n", geomPath.c_str());
+		delete test;
+		return 1;
+	}
+
+	BuildSettings settings;
+	mergeSettings(opts, geom.getBuildSettings(), settings);
+
+	if (!opts.tuneTileSizes.empty())
+	{
+		const int result = tune(ctx, opts, geom, settings, mode, test);
+		delete test;
+		rcProfilingContext::disableAllocTracking();
+		return result;
+	}
+
+	// The chunked mesh is only read during the build.
+	FILE* chunkedFile = 0;
+	rcChunkedMesh chunkedMesh;
+	if (!opts.chunkedMesh.empty())
+	{
+		if (writeChunkedMesh(&ctx, geom, settings, opts.chunkedMesh))
+			chunkedFile = fopen(opts.chunkedMesh.c_str(), "rb");
+		if (!chunkedFile)
+		{
+			fprintf(stderr, "error: Could not write '%s'.\n", opts.chunkedMesh.c_str());
+			delete test;
+			return 1;
+		}
+	}
+	FileChunkedMeshInput chunkedInput(chunkedFile);
+	if (chunkedFile && !chunkedMesh.init(&ctx, &chunkedInput))
+	{
+		fprintf(stderr, "error: Could not read '%s'.\n", opts.chunkedMesh.c_str());
+		fclose(chunkedFile);
+		delete test;
+		return 1;
+	}
+
+	BatchBuilder builder;
+	builder.setChunkedMesh(chunkedFile ? &chunkedMesh : 0);
+	const bool built = builder.build(&ctx, &geom, settings, (BatchBuildMode)mode);
+	if (chunkedFile)
+		fclose(chunkedFile);
+	if (!built)
+	{
+		fprintf(stderr, "error: Could not build '%s'.\n", geomPath.c_str());
+		delete test;
+		return 1;
+	}
+
+	int result = 0;
+
+	const rcProfileStageStats& total = ctx.getStageStats(RC_TIMER_TOTAL);
+	const float buildMs = total.time / 1000.0f;
+	printf("{\"type\":\"build\",\"input\":\"%s\",\"mode\":\"%s\",\"time_ms\":%.3f,\"tiles\":%d,\"polys\":%d,"
+		   "\"navmesh_bytes\":%lu,\"layers\":%d,\"tilecache_bytes\":%lu,\"alloc_bytes\":%lu,\"allocs\":%d}\n",
+		   geomPath.c_str(), getModeName(mode), buildMs, builder.getTileCount(), builder.getPolyCount(),
+		   (unsigned long)builder.getNavMeshDataSize(), builder.getLayerCount(),
+		   (unsigned long)builder.getTileCacheDataSize(), (unsigned long)total.allocatedBytes, total.allocationCount);
+
+	for (int i = 0; i < RC_MAX_TIMERS; ++i)
+	{
+		const rcTimerLabel label = (rcTimerLabel)i;
+		const rcProfileStageStats& stats = ctx.getStageStats(label);
+		if (label == RC_TIMER_TOTAL || stats.calls == 0)
+			continue;
+		printf("{\"type\":\"stage\",\"name\":\"%s\",\"calls\":%d,\"time_ms\":%.3f,\"alloc_bytes\":%lu,\"allocs\":%d}\n",
+			   rcProfilingContext::getLabelName(label), stats.calls, stats.time / 1000.0f,
+			   (unsigned long)stats.allocatedBytes, stats.allocationCount);
+	}
+
+	if (opts.maxBuildMs > 0 && buildMs > opts.maxBuildMs)
+	{
+		fprintf(stderr, "error: The build took %.3f ms, the limit is %.3f ms.\n", buildMs, opts.maxBuildMs);
+		result = 2;
+	}
+
+	if (!opts.output.empty())
+	{
+		if (!writeNavMesh(builder.getNavMesh(), opts.output))
+		{
+			fprintf(stderr, "error: Could not write '%s'.\n", opts.output.c_str());
+			delete test;
+			return 1;
+		}
+	}
+
+	if (test)
+	{
+		// Every run overwrites the results of the previous one, the fastest run is kept.
+		TestCase::TestResult* best = new TestCase::TestResult[test->getTestCount() > 0 ? test->getTestCount() : 1];
+		int bestTime = -1;
+		for (int run = 0; run < opts.repeat; ++run)
+		{
+			test->doTests(builder.getNavMesh(), builder.getNavMeshQuery(), false);
+			int time = 0;
+			for (int i = 0; i < test->getTestCount(); ++i)
+			{
+				TestCase::TestResult res;
+				test->getTestResult(i, res);
+				time += res.findNearestPolyTime + res.findPathTime + res.findStraightPathTime;
+			}
+			if (bestTime < 0 || time < bestTime)
+			{
+				bestTime = time;
+				for (int i = 0; i < test->getTestCount(); ++i)
+					test->getTestResult(i, best[i]);
+			}
+		}
+
+		int failed = 0;
+		for (int i = 0; i < test->getTestCount(); ++i)
+		{
+			const TestCase::TestResult& res = best[i];
+			// A path test fails if it found no polygons, a raycast never does.
+			const bool ok = res.raycast || res.npolys > 0;
+			if (!ok)
+				failed++;
+			printf("{\"type\":\"test\",\"index\":%d,\"kind\":\"%s\",\"ok\":%s,\"polys\":%d,\"straight\":%d,"
+				   "\"nearest_us\":%d,\"path_us\":%d,\"straight_us\":%d,\"nodes\":%d,\"out_of_nodes\":%s}\n",
+				   i, res.raycast ? "raycast" : "pathfind", ok ? "true" : "false", res.npolys, res.nstraight,
+				   res.findNearestPolyTime, res.findPathTime, res.findStraightPathTime, res.nodes,
+				   res.outOfNodes ? "true" : "false");
+		}
+		delete [] best;
+
+		const float queryMs = bestTime / 1000.0f;
+		printf("{\"type\":\"tests\",\"count\":%d,\"failed\":%d,\"runs\":%d,\"time_ms\":%.3f}\n",
+			   test->getTestCount(), failed, opts.repeat, queryMs);
+
+		if (opts.maxQueryMs > 0 && queryMs > opts.maxQueryMs)
+		{
+			fprintf(stderr, "error: The tests took %.3f ms, the limit is %.3f ms.\n", queryMs, opts.maxQueryMs);
+			result = 2;
+		}
+		if (opts.strict && failed > 0)
+		{
+			fprintf(stderr, "error: %d of %d tests failed.\n", failed, test->getTestCount());
+			result = 2;
+		}
+		delete test;
+	}
+
+	rcProfilingContext::disableAllocTracking();
+	return result;
+}
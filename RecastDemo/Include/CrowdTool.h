@@ -78,6 +78,14 @@ class CrowdToolState : public SampleToolState
 	ValueHistory m_crowdTotalTime;
 	ValueHistory m_crowdSampleCount;
 
+	// The stages of the crowd update, see dtCrowdUpdateTimes.
+	ValueHistory m_crowdPathTime;
+	ValueHistory m_crowdBoundaryTime;
+	ValueHistory m_crowdSteerTime;
+	ValueHistory m_crowdPlanningTime;
+	ValueHistory m_crowdMoveTime;
+	ValueHistory m_crowdNodesExpanded;
+
 	CrowdToolParams m_toolParams;
 
 	bool m_run;
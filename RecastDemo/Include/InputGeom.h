@@ -19,7 +19,7 @@
 #ifndef INPUTGEOM_H
 #define INPUTGEOM_H
 
-#include "ChunkyTriMesh.h"
+#include "RecastMeshIndex.h"
 #include "MeshLoaderObj.h"
 
 static const int MAX_CONVEXVOL_PTS = 12;
@@ -71,7 +71,7 @@ struct BuildSettings
 
 class InputGeom
 {
-	rcChunkyTriMesh* m_chunkyMesh;
+	rcTriMeshIndex* m_meshIndex;
 	rcMeshLoaderObj* m_mesh;
 	float m_meshBMin[3], m_meshBMax[3];
 	BuildSettings m_buildSettings;
@@ -98,11 +98,14 @@ class InputGeom
 	
 	bool loadMesh(class rcContext* ctx, const std::string& filepath);
 	bool loadGeomSet(class rcContext* ctx, const std::string& filepath);
+	bool loadCache(class rcContext* ctx, const std::string& filepath, const std::string& cachePath);
+	bool saveCache(const std::string& filepath, const std::string& cachePath) const;
 public:
 	InputGeom();
 	~InputGeom();
 	
-	
+	/// Loads an .obj or a .gset file. The loaded geometry is cached in a binary file next to it,
+	/// which is loaded instead as long as the source files do not change.
 	bool load(class rcContext* ctx, const std::string& filepath);
 	bool saveGeomSet(const BuildSettings* settings);
 	
@@ -112,7 +115,7 @@ public:
 	const float* getMeshBoundsMax() const { return m_meshBMax; }
 	const float* getNavMeshBoundsMin() const { return m_hasBuildSettings ? m_buildSettings.navMeshBMin : m_meshBMin; }
 	const float* getNavMeshBoundsMax() const { return m_hasBuildSettings ? m_buildSettings.navMeshBMax : m_meshBMax; }
-	const rcChunkyTriMesh* getChunkyMesh() const { return m_chunkyMesh; }
+	const rcTriMeshIndex* getMeshIndex() const { return m_meshIndex; }
 	const BuildSettings* getBuildSettings() const { return m_hasBuildSettings ? &m_buildSettings : 0; }
 	bool raycastMesh(float* src, float* dst, float& tmin);
 
@@ -139,6 +142,8 @@ public:
 						 const float minh, const float maxh, unsigned char area);
 	void deleteConvexVolume(int i);
 	void drawConvexVolumes(struct duDebugDraw* dd, bool hilight = false);
+	/// Applies the areas of all volumes to the compact heightfield in one pass.
+	bool markConvexVolumes(class rcContext* ctx, struct rcCompactHeightfield& chf) const;
 	///@}
 	
 private:
@@ -28,6 +28,9 @@ public:
 	~rcMeshLoaderObj();
 	
 	bool load(const std::string& fileName);
+	/// Copies a mesh which was loaded before, e.g. from a geometry cache, replacing the current mesh.
+	void setMesh(const std::string& fileName, const float* verts, int vertCount, const int* tris,
+				 const float* normals, int triCount);
 
 	const float* getVerts() const { return m_verts; }
 	const float* getNormals() const { return m_normals; }
@@ -22,6 +22,7 @@
 #include "Sample.h"
 #include "DetourNavMesh.h"
 #include "DetourNavMeshQuery.h"
+#include "ValueHistory.h"
 
 class NavMeshTesterTool : public SampleTool
 {
@@ -91,6 +92,13 @@ class NavMeshTesterTool : public SampleTool
 	static const int MAX_STEER_POINTS = 10;
 	float m_steerPoints[MAX_STEER_POINTS*3];
 	int m_steerPointCount;
+
+	// The work done by the queries of the last recalc. The counters need Detour built with DT_QUERY_STATS.
+	bool m_showQueryStats;
+	float m_queryTime;
+	dtQueryStats m_queryStats;
+	ValueHistory m_queryTimeHistory;
+	ValueHistory m_queryNodesHistory;
 	
 public:
 	NavMeshTesterTool();
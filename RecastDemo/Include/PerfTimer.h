@@ -29,5 +29,8 @@ typedef __int64 TimeVal;
 TimeVal getPerfTime();
 int getPerfTimeUsec(const TimeVal duration);
 
+// The current time in microseconds, used as the clock of the Detour stage timers.
+double getPerfClockUsec();
+
 #endif // PERFTIMER_H
 
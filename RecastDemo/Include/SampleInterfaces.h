@@ -73,6 +73,7 @@ public:
 	virtual void vertex(const float* pos, unsigned int color, const float* uv);
 	virtual void vertex(const float x, const float y, const float z, unsigned int color, const float u, const float v);
 	virtual void end();
+	virtual void drawBuffer(const duDebugDrawBuffer& buffer);
 };
 
 /// stdio file implementation.
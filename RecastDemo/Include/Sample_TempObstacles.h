@@ -22,7 +22,8 @@
 #include "Sample.h"
 #include "DetourNavMesh.h"
 #include "Recast.h"
-#include "ChunkyTriMesh.h"
+#include "RecastMeshIndex.h"
+#include "ValueHistory.h"
 
 
 class Sample_TempObstacles : public Sample
@@ -41,6 +42,12 @@ protected:
 	int m_cacheRawSize;
 	int m_cacheLayerCount;
 	unsigned int m_cacheBuildMemUsage;
+
+	// The tile cache updates of the last frames. The counters need Detour built with DT_QUERY_STATS.
+	bool m_showUpdateGraph;
+	ValueHistory m_cacheUpdateTime;
+	ValueHistory m_cacheTilesRebuilt;
+	ValueHistory m_cacheObstacleRequests;
 	
 	enum DrawMode
 	{
@@ -91,7 +98,8 @@ private:
 	Sample_TempObstacles(const Sample_TempObstacles&);
 	Sample_TempObstacles& operator=(const Sample_TempObstacles&);
 
-	int rasterizeTileLayers(const int tx, const int ty, const rcConfig& cfg, struct TileCacheData* tiles, const int maxTiles);
+	int rasterizeTileLayers(const int tx, const int ty, const rcConfig& cfg, struct TileCacheData* tiles, const int maxTiles,
+							const unsigned char* meshTriAreas = 0);
 };
 
 
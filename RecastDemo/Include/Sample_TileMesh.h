@@ -22,7 +22,7 @@
 #include "Sample.h"
 #include "DetourNavMesh.h"
 #include "Recast.h"
-#include "ChunkyTriMesh.h"
+#include "RecastMeshIndex.h"
 
 class Sample_TileMesh : public Sample
 {
@@ -32,6 +32,8 @@ protected:
 	float m_totalBuildTimeMs;
 
 	unsigned char* m_triareas;
+	/// The area ids of all input triangles while buildAllTiles runs, in the order of rcTriMeshIndex::tris.
+	unsigned char* m_meshTriAreas;
 	rcHeightfield* m_solid;
 	rcCompactHeightfield* m_chf;
 	rcContourSet* m_cset;
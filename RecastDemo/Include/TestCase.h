@@ -49,6 +49,8 @@ class TestCase
 			findNearestPolyTime(0),
 			findPathTime(0),
 			findStraightPathTime(0),
+			nodes(0),
+			outOfNodes(false),
 			next(0)
 		{
 		}
@@ -77,6 +79,9 @@ class TestCase
 		int findNearestPolyTime;
 		int findPathTime;
 		int findStraightPathTime;
+
+		int nodes;
+		bool outOfNodes;
 		
 		Test* next;
 	private:
@@ -92,6 +97,20 @@ class TestCase
 	void resetTimes();
 	
 public:
+	/// The outcome of a test of the last #doTests call. Times are in microseconds.
+	struct TestResult
+	{
+		bool raycast;
+		int npolys;
+		int nstraight;
+		int findNearestPolyTime;
+		int findPathTime;
+		int findStraightPathTime;
+		/// The number of search nodes used by the path search, and whether it ran out of them.
+		int nodes;
+		bool outOfNodes;
+	};
+
 	TestCase();
 	~TestCase();
 
@@ -100,7 +119,10 @@ public:
 	const std::string& getSampleName() const { return m_sampleName; }
 	const std::string& getGeomFileName() const { return m_geomFileName; }
 	
-	void doTests(class dtNavMesh* navmesh, class dtNavMeshQuery* navquery);
+	void doTests(class dtNavMesh* navmesh, class dtNavMeshQuery* navquery, bool printResults = true);
+
+	int getTestCount() const;
+	bool getTestResult(int i, TestResult& result) const;
 	
 	void handleRender();
 	bool handleRenderOverlay(double* proj, double* model, int* view);
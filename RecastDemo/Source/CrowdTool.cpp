@@ -154,6 +154,7 @@ void CrowdToolState::init(class Sample* sample)
 		m_crowd = crowd;
 	
 		crowd->init(MAX_AGENTS, m_sample->getAgentRadius(), nav);
+		crowd->setUpdateClock(getPerfClockUsec);
 		
 		// Make polygons with 'disabled' flag invalid.
 		crowd->getEditableFilter(0)->setExcludeFlags(SAMPLE_POLYFLAGS_DISABLED);
@@ -191,6 +192,10 @@ void CrowdToolState::init(class Sample* sample)
 		params.adaptiveDepth = 3;
 		
 		crowd->setObstacleAvoidanceParams(3, &params);
+		
+		// ORCA
+		params.solver = DT_OBSTACLE_AVOIDANCE_ORCA;
+		crowd->setObstacleAvoidanceParams(4, &params);
 	}
 }
 
@@ -626,6 +631,20 @@ void CrowdToolState::handleRenderOverlay(double* proj, double* model, int* view)
 		gp.setRect(300, 10, 500, 50, 8);
 		gp.setValueRange(0.0f, 2000.0f, 1, "");
 		drawGraph(&gp, &m_crowdSampleCount, 0, "Sample Count", duRGBA(96,96,96,128));
+
+		// The stages of the update. The nodes expanded are only counted when Detour is built with DT_QUERY_STATS.
+		gp.setRect(300, 220, 500, 200, 8);
+		gp.setValueRange(0.0f, 1.0f, 4, "ms");
+		drawGraphBackground(&gp);
+		drawGraph(&gp, &m_crowdPathTime, 1, "Paths", duRGBA(255,64,64,255));
+		drawGraph(&gp, &m_crowdBoundaryTime, 2, "Boundary", duRGBA(64,192,255,255));
+		drawGraph(&gp, &m_crowdSteerTime, 3, "Steering", duRGBA(192,255,64,255));
+		drawGraph(&gp, &m_crowdPlanningTime, 4, "Planning", duRGBA(255,192,64,255));
+		drawGraph(&gp, &m_crowdMoveTime, 5, "Movement", duRGBA(192,64,255,255));
+
+		gp.setRect(300, 220, 500, 50, 8);
+		gp.setValueRange(0.0f, 5000.0f, 1, "");
+		drawGraph(&gp, &m_crowdNodesExpanded, 0, "Nodes Expanded", duRGBA(96,96,96,128));
 	}
 	
 }
@@ -747,12 +766,17 @@ void CrowdToolState::setMoveTarget(const float* p, bool adjust)
 		}
 		else
 		{
-			for (int i = 0; i < crowd->getAgentCount(); ++i)
+			// All the agents head to the same target, share the search.
+			int group[MAX_AGENTS];
+			int ngroup = 0;
+			for (int i = 0; i < crowd->getAgentCount() && ngroup < MAX_AGENTS; ++i)
 			{
 				const dtCrowdAgent* ag = crowd->getAgent(i);
 				if (!ag->active) continue;
-				crowd->requestMoveTarget(i, m_targetRef, m_targetPos);
+				group[ngroup++] = i;
 			}
+			if (ngroup)
+				crowd->requestMoveTargetGroup(group, ngroup, m_targetRef, m_targetPos);
 		}
 	}
 }
@@ -852,6 +876,14 @@ void CrowdToolState::updateTick(const float dt)
 	
 	m_crowdSampleCount.addSample((float)crowd->getVelocitySampleCount());
 	m_crowdTotalTime.addSample(getPerfTimeUsec(endTime - startTime) / 1000.0f);
+
+	const dtCrowdUpdateTimes& times = crowd->getUpdateTimes();
+	m_crowdPathTime.addSample((float)(times.pathValidity + times.moveRequests + times.topologyOptimization) / 1000.0f);
+	m_crowdBoundaryTime.addSample((float)(times.proximityGrid + times.boundary + times.neighbours) / 1000.0f);
+	m_crowdSteerTime.addSample((float)(times.corners + times.steering) / 1000.0f);
+	m_crowdPlanningTime.addSample((float)times.planning / 1000.0f);
+	m_crowdMoveTime.addSample((float)(times.integrate + times.collisions + times.moveAlongSurface) / 1000.0f);
+	m_crowdNodesExpanded.addSample((float)crowd->getQueryStats().nodesExpanded);
 }
 
 
@@ -930,7 +962,7 @@ void CrowdTool::handleMenu()
 			params->m_obstacleAvoidance = !params->m_obstacleAvoidance;
 			m_state->updateAgentParams();
 		}
-		if (imguiSlider("Avoidance Quality", &params->m_obstacleAvoidanceType, 0.0f, 3.0f, 1.0f))
+		if (imguiSlider("Avoidance Quality", &params->m_obstacleAvoidanceType, 0.0f, 4.0f, 1.0f))
 		{
 			m_state->updateAgentParams();
 		}
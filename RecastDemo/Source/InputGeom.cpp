@@ -20,56 +20,19 @@
 #include <stdio.h>
 #include <ctype.h>
 #include <string.h>
+#include <stdint.h>
+#include <sys/stat.h>
 #include <algorithm>
 #include "Recast.h"
+#include "RecastAlloc.h"
 #include "InputGeom.h"
-#include "ChunkyTriMesh.h"
+#include "RecastMeshIndex.h"
 #include "MeshLoaderObj.h"
 #include "DebugDraw.h"
 #include "RecastDebugDraw.h"
 #include "DetourNavMesh.h"
 #include "Sample.h"
 
-static bool intersectSegmentTriangle(const float* sp, const float* sq,
-									 const float* a, const float* b, const float* c,
-									 float &t)
-{
-	float v, w;
-	float ab[3], ac[3], qp[3], ap[3], norm[3], e[3];
-	rcVsub(ab, b, a);
-	rcVsub(ac, c, a);
-	rcVsub(qp, sp, sq);
-	
-	// Compute triangle normal. Can be precalculated or cached if
-	// intersecting multiple segments against the same triangle
-	rcVcross(norm, ab, ac);
-	
-	// Compute denominator d. If d <= 0, segment is parallel to or points
-	// away from triangle, so exit early
-	float d = rcVdot(qp, norm);
-	if (d <= 0.0f) return false;
-	
-	// Compute intersection t value of pq with plane of triangle. A ray
-	// intersects iff 0 <= t. Segment intersects iff 0 <= t <= 1. Delay
-	// dividing by d until intersection has been found to pierce triangle
-	rcVsub(ap, sp, a);
-	t = rcVdot(ap, norm);
-	if (t < 0.0f) return false;
-	if (t > d) return false; // For segment; exclude this code line for a ray test
-	
-	// Compute barycentric coordinate components and test if within bounds
-	rcVcross(e, qp, ap);
-	v = rcVdot(ac, e);
-	if (v < 0.0f || v > d) return false;
-	w = -rcVdot(ab, e);
-	if (w < 0.0f || v + w > d) return false;
-	
-	// Segment/ray intersects triangle. Perform delayed division
-	t /= d;
-	
-	return true;
-}
-
 static char* parseRow(char* buf, char* bufEnd, char* row, int len)
 {
 	bool start = true;
@@ -105,9 +68,103 @@ static char* parseRow(char* buf, char* bufEnd, char* row, int len)
 }
 
 
+// The geometry cache stores everything load() reads from an .obj or a .gset file,
+// including the mesh index, so that loading it needs no parsing and no index build.
+// The header is followed by the sections of getCacheSectionSizes(), each aligned
+// to GEOMCACHE_ALIGN bytes and in native byte order, so the file can be mapped
+// into memory as is. A cache is stale once the size or the modification time of
+// one of its source files changed.
+static const int GEOMCACHE_MAGIC = 'R'<<24 | 'C'<<16 | 'G'<<8 | 'C';
+static const int GEOMCACHE_VERSION = 1;
+static const size_t GEOMCACHE_ALIGN = 16;
+static const int GEOMCACHE_SECTION_COUNT = 14;
+static const int GEOMCACHE_MAX_PATH = 4096;
+static const char* GEOMCACHE_EXTENSION = ".geomcache";
+
+struct GeomCacheStamp
+{
+	uint64_t size;
+	uint64_t mtime;
+};
+
+struct GeomCacheHeader
+{
+	int magic;
+	int version;
+	GeomCacheStamp source;		// The loaded .obj or .gset file.
+	GeomCacheStamp mesh;		// The .obj file of the mesh.
+	int meshPathLen;
+	int vertCount;
+	int triCount;
+	int nodeCount;
+	int indexTriCount;
+	int chunkCount;
+	int maxTrisPerChunk;
+	int offMeshConCount;
+	int volumeCount;
+	int hasBuildSettings;
+	BuildSettings buildSettings;
+	float meshBMin[3];
+	float meshBMax[3];
+};
+
+static bool getFileStamp(const std::string& path, GeomCacheStamp& stamp)
+{
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0)
+		return false;
+	memset(&stamp, 0, sizeof(stamp));
+	stamp.size = (uint64_t)st.st_size;
+	stamp.mtime = (uint64_t)st.st_mtime;
+	return true;
+}
+
+static bool isSameStamp(const GeomCacheStamp& a, const GeomCacheStamp& b)
+{
+	return a.size == b.size && a.mtime == b.mtime;
+}
+
+static size_t alignCacheSize(const size_t size)
+{
+	return (size + GEOMCACHE_ALIGN-1) & ~(GEOMCACHE_ALIGN-1);
+}
+
+// The sizes of the sections following the header, in the order of the file.
+static size_t getCacheSectionSizes(const GeomCacheHeader& header, size_t* sizes)
+{
+	sizes[0] = (size_t)header.meshPathLen;
+	sizes[1] = (size_t)header.vertCount*3*sizeof(float);
+	sizes[2] = (size_t)header.triCount*3*sizeof(int);
+	sizes[3] = (size_t)header.triCount*3*sizeof(float);
+	sizes[4] = (size_t)header.nodeCount*sizeof(rcTriMeshIndexNode);
+	sizes[5] = (size_t)header.indexTriCount*3*sizeof(int);
+	sizes[6] = (size_t)header.indexTriCount*sizeof(int);
+	sizes[7] = (size_t)header.offMeshConCount*3*2*sizeof(float);
+	sizes[8] = (size_t)header.offMeshConCount*sizeof(float);
+	sizes[9] = (size_t)header.offMeshConCount*sizeof(unsigned char);
+	sizes[10] = (size_t)header.offMeshConCount*sizeof(unsigned char);
+	sizes[11] = (size_t)header.offMeshConCount*sizeof(unsigned short);
+	sizes[12] = (size_t)header.offMeshConCount*sizeof(unsigned int);
+	sizes[13] = (size_t)header.volumeCount*sizeof(ConvexVolume);
+
+	size_t total = alignCacheSize(sizeof(GeomCacheHeader));
+	for (int i = 0; i < GEOMCACHE_SECTION_COUNT; ++i)
+		total += alignCacheSize(sizes[i]);
+	return total;
+}
+
+// Copies a section of the cache into a buffer allocated with the Recast allocator.
+template<class T>
+static T* allocCacheSection(const char* data, const size_t size)
+{
+	T* dst = (T*)rcAlloc(size > 0 ? size : 1, RC_ALLOC_PERM);
+	if (dst)
+		memcpy(dst, data, size);
+	return dst;
+}
 
 InputGeom::InputGeom() :
-	m_chunkyMesh(0),
+	m_meshIndex(0),
 	m_mesh(0),
 	m_hasBuildSettings(false),
 	m_offMeshConCount(0),
@@ -117,7 +174,7 @@ InputGeom::InputGeom() :
 
 InputGeom::~InputGeom()
 {
-	delete m_chunkyMesh;
+	rcFreeTriMeshIndex(m_meshIndex);
 	delete m_mesh;
 }
 		
@@ -125,8 +182,8 @@ bool InputGeom::loadMesh(rcContext* ctx, const std::string& filepath)
 {
 	if (m_mesh)
 	{
-		delete m_chunkyMesh;
-		m_chunkyMesh = 0;
+		rcFreeTriMeshIndex(m_meshIndex);
+		m_meshIndex = 0;
 		delete m_mesh;
 		m_mesh = 0;
 	}
@@ -147,15 +204,16 @@ bool InputGeom::loadMesh(rcContext* ctx, const std::string& filepath)
 
 	rcCalcBounds(m_mesh->getVerts(), m_mesh->getVertCount(), m_meshBMin, m_meshBMax);
 
-	m_chunkyMesh = new rcChunkyTriMesh;
-	if (!m_chunkyMesh)
+	m_meshIndex = rcAllocTriMeshIndex();
+	if (!m_meshIndex)
 	{
-		ctx->log(RC_LOG_ERROR, "buildTiledNavigation: Out of memory 'm_chunkyMesh'.");
+		ctx->log(RC_LOG_ERROR, "buildTiledNavigation: Out of memory 'm_meshIndex'.");
 		return false;
 	}
-	if (!rcCreateChunkyTriMesh(m_mesh->getVerts(), m_mesh->getTris(), m_mesh->getTriCount(), 256, m_chunkyMesh))
+	if (!rcBuildTriMeshIndex(ctx, m_mesh->getVerts(), m_mesh->getVertCount(), m_mesh->getTris(), m_mesh->getTriCount(),
+							 256, *m_meshIndex))
 	{
-		ctx->log(RC_LOG_ERROR, "buildTiledNavigation: Failed to build chunky mesh.");
+		ctx->log(RC_LOG_ERROR, "buildTiledNavigation: Failed to build mesh index.");
 		return false;
 	}		
 
@@ -296,6 +354,167 @@ bool InputGeom::loadGeomSet(rcContext* ctx, const std::string& filepath)
 	return true;
 }
 
+bool InputGeom::loadCache(rcContext* ctx, const std::string& filepath, const std::string& cachePath)
+{
+	FILE* fp = fopen(cachePath.c_str(), "rb");
+	if (!fp)
+		return false;
+
+	GeomCacheHeader header;
+	if (fread(&header, sizeof(header), 1, fp) != 1 ||
+		header.magic != GEOMCACHE_MAGIC || header.version != GEOMCACHE_VERSION)
+	{
+		fclose(fp);
+		return false;
+	}
+	if (header.meshPathLen <= 0 || header.meshPathLen > GEOMCACHE_MAX_PATH ||
+		header.vertCount < 0 || header.triCount < 0 || header.nodeCount < 0 || header.indexTriCount < 0 ||
+		header.offMeshConCount < 0 || header.offMeshConCount > MAX_OFFMESH_CONNECTIONS ||
+		header.volumeCount < 0 || header.volumeCount > MAX_VOLUMES)
+	{
+		fclose(fp);
+		return false;
+	}
+
+	size_t sizes[GEOMCACHE_SECTION_COUNT];
+	const size_t dataSize = getCacheSectionSizes(header, sizes);
+	char* data = new char[dataSize];
+	const size_t headerSize = alignCacheSize(sizeof(GeomCacheHeader));
+	bool ok = fseek(fp, (long)headerSize, SEEK_SET) == 0 &&
+		fread(data + headerSize, dataSize - headerSize, 1, fp) == 1;
+	fclose(fp);
+
+	const char* sections[GEOMCACHE_SECTION_COUNT];
+	size_t offset = headerSize;
+	for (int i = 0; i < GEOMCACHE_SECTION_COUNT; ++i)
+	{
+		sections[i] = data + offset;
+		offset += alignCacheSize(sizes[i]);
+	}
+	const std::string meshPath(sections[0], (size_t)header.meshPathLen);
+
+	// The cache is only used while its sources are unchanged.
+	GeomCacheStamp source, mesh;
+	ok = ok && getFileStamp(filepath, source) && isSameStamp(source, header.source) &&
+		getFileStamp(meshPath, mesh) && isSameStamp(mesh, header.mesh);
+	if (!ok)
+	{
+		delete [] data;
+		return false;
+	}
+
+	rcTriMeshIndex* meshIndex = rcAllocTriMeshIndex();
+	if (meshIndex)
+	{
+		meshIndex->nodes = allocCacheSection<rcTriMeshIndexNode>(sections[4], sizes[4]);
+		meshIndex->tris = allocCacheSection<int>(sections[5], sizes[5]);
+		meshIndex->triIds = allocCacheSection<int>(sections[6], sizes[6]);
+		meshIndex->nnodes = header.nodeCount;
+		meshIndex->ntris = header.indexTriCount;
+		meshIndex->nchunks = header.chunkCount;
+		meshIndex->maxTrisPerChunk = header.maxTrisPerChunk;
+	}
+	if (!meshIndex || !meshIndex->nodes || !meshIndex->tris || !meshIndex->triIds)
+	{
+		ctx->log(RC_LOG_ERROR, "loadCache: Out of memory 'm_meshIndex'.");
+		rcFreeTriMeshIndex(meshIndex);
+		delete [] data;
+		return false;
+	}
+
+	rcFreeTriMeshIndex(m_meshIndex);
+	m_meshIndex = meshIndex;
+	delete m_mesh;
+	m_mesh = new rcMeshLoaderObj;
+	m_mesh->setMesh(meshPath, (const float*)sections[1], header.vertCount, (const int*)sections[2],
+					(const float*)sections[3], header.triCount);
+	rcVcopy(m_meshBMin, header.meshBMin);
+	rcVcopy(m_meshBMax, header.meshBMax);
+	m_hasBuildSettings = header.hasBuildSettings != 0;
+	m_buildSettings = header.buildSettings;
+
+	m_offMeshConCount = header.offMeshConCount;
+	memcpy(m_offMeshConVerts, sections[7], sizes[7]);
+	memcpy(m_offMeshConRads, sections[8], sizes[8]);
+	memcpy(m_offMeshConDirs, sections[9], sizes[9]);
+	memcpy(m_offMeshConAreas, sections[10], sizes[10]);
+	memcpy(m_offMeshConFlags, sections[11], sizes[11]);
+	memcpy(m_offMeshConId, sections[12], sizes[12]);
+	m_volumeCount = header.volumeCount;
+	memcpy(m_volumes, sections[13], sizes[13]);
+
+	delete [] data;
+	ctx->log(RC_LOG_PROGRESS, "loadCache: Loaded '%s' from '%s'.", filepath.c_str(), cachePath.c_str());
+	return true;
+}
+
+bool InputGeom::saveCache(const std::string& filepath, const std::string& cachePath) const
+{
+	if (!m_mesh || !m_meshIndex)
+		return false;
+
+	GeomCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	if (!getFileStamp(filepath, header.source) || !getFileStamp(m_mesh->getFileName(), header.mesh))
+		return false;
+	header.magic = GEOMCACHE_MAGIC;
+	header.version = GEOMCACHE_VERSION;
+	header.meshPathLen = (int)m_mesh->getFileName().size();
+	header.vertCount = m_mesh->getVertCount();
+	header.triCount = m_mesh->getTriCount();
+	header.nodeCount = m_meshIndex->nnodes;
+	header.indexTriCount = m_meshIndex->ntris;
+	header.chunkCount = m_meshIndex->nchunks;
+	header.maxTrisPerChunk = m_meshIndex->maxTrisPerChunk;
+	header.offMeshConCount = m_offMeshConCount;
+	header.volumeCount = m_volumeCount;
+	header.hasBuildSettings = m_hasBuildSettings ? 1 : 0;
+	if (m_hasBuildSettings)
+		header.buildSettings = m_buildSettings;
+	rcVcopy(header.meshBMin, m_meshBMin);
+	rcVcopy(header.meshBMax, m_meshBMax);
+	if (header.meshPathLen <= 0 || header.meshPathLen > GEOMCACHE_MAX_PATH)
+		return false;
+
+	size_t sizes[GEOMCACHE_SECTION_COUNT];
+	getCacheSectionSizes(header, sizes);
+	const void* sections[GEOMCACHE_SECTION_COUNT] = {
+		m_mesh->getFileName().c_str(), m_mesh->getVerts(), m_mesh->getTris(), m_mesh->getNormals(),
+		m_meshIndex->nodes, m_meshIndex->tris, m_meshIndex->triIds,
+		m_offMeshConVerts, m_offMeshConRads, m_offMeshConDirs, m_offMeshConAreas, m_offMeshConFlags, m_offMeshConId,
+		m_volumes
+	};
+
+	// Written next to the cache and renamed, so that a partially written cache is never loaded.
+	const std::string tempPath = cachePath + ".tmp";
+	FILE* fp = fopen(tempPath.c_str(), "wb");
+	if (!fp)
+		return false;
+	static const char padding[GEOMCACHE_ALIGN] = { 0 };
+	bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+	size_t written = sizeof(header);
+	for (int i = -1; ok && i < GEOMCACHE_SECTION_COUNT; ++i)
+	{
+		const size_t pad = alignCacheSize(written) - written;
+		ok = pad == 0 || fwrite(padding, pad, 1, fp) == 1;
+		written += pad;
+		if (ok && i >= 0 && sizes[i] > 0)
+		{
+			ok = fwrite(sections[i], sizes[i], 1, fp) == 1;
+			written += sizes[i];
+		}
+	}
+	ok &= fclose(fp) == 0;
+
+	remove(cachePath.c_str());
+	if (!ok || rename(tempPath.c_str(), cachePath.c_str()) != 0)
+	{
+		remove(tempPath.c_str());
+		return false;
+	}
+	return true;
+}
+
 bool InputGeom::load(rcContext* ctx, const std::string& filepath)
 {
 	size_t extensionPos = filepath.find_last_of('.');
@@ -305,12 +524,19 @@ bool InputGeom::load(rcContext* ctx, const std::string& filepath)
 	std::string extension = filepath.substr(extensionPos);
 	std::transform(extension.begin(), extension.end(), extension.begin(), tolower);
 
-	if (extension == ".gset")
-		return loadGeomSet(ctx, filepath);
-	if (extension == ".obj")
-		return loadMesh(ctx, filepath);
+	if (extension != ".gset" && extension != ".obj")
+		return false;
 
-	return false;
+	const std::string cachePath = filepath + GEOMCACHE_EXTENSION;
+	if (loadCache(ctx, filepath, cachePath))
+		return true;
+
+	const bool loaded = extension == ".gset" ? loadGeomSet(ctx, filepath) : loadMesh(ctx, filepath);
+	if (!loaded)
+		return false;
+	if (!saveCache(filepath, cachePath))
+		ctx->log(RC_LOG_WARNING, "load: Could not write the geometry cache '%s'.", cachePath.c_str());
+	return true;
 }
 
 bool InputGeom::saveGeomSet(const BuildSettings* settings)
@@ -385,85 +611,11 @@ bool InputGeom::saveGeomSet(const BuildSettings* settings)
 	return true;
 }
 
-static bool isectSegAABB(const float* sp, const float* sq,
-						 const float* amin, const float* amax,
-						 float& tmin, float& tmax)
-{
-	static const float EPS = 1e-6f;
-	
-	float d[3];
-	d[0] = sq[0] - sp[0];
-	d[1] = sq[1] - sp[1];
-	d[2] = sq[2] - sp[2];
-	tmin = 0.0;
-	tmax = 1.0f;
-	
-	for (int i = 0; i < 3; i++)
-	{
-		if (fabsf(d[i]) < EPS)
-		{
-			if (sp[i] < amin[i] || sp[i] > amax[i])
-				return false;
-		}
-		else
-		{
-			const float ood = 1.0f / d[i];
-			float t1 = (amin[i] - sp[i]) * ood;
-			float t2 = (amax[i] - sp[i]) * ood;
-			if (t1 > t2) { float tmp = t1; t1 = t2; t2 = tmp; }
-			if (t1 > tmin) tmin = t1;
-			if (t2 < tmax) tmax = t2;
-			if (tmin > tmax) return false;
-		}
-	}
-	
-	return true;
-}
-
-
 bool InputGeom::raycastMesh(float* src, float* dst, float& tmin)
 {
-	// Prune hit ray.
-	float btmin, btmax;
-	if (!isectSegAABB(src, dst, m_meshBMin, m_meshBMax, btmin, btmax))
-		return false;
-	float p[2], q[2];
-	p[0] = src[0] + (dst[0]-src[0])*btmin;
-	p[1] = src[2] + (dst[2]-src[2])*btmin;
-	q[0] = src[0] + (dst[0]-src[0])*btmax;
-	q[1] = src[2] + (dst[2]-src[2])*btmax;
-	
-	int cid[512];
-	const int ncid = rcGetChunksOverlappingSegment(m_chunkyMesh, p, q, cid, 512);
-	if (!ncid)
+	if (!m_meshIndex)
 		return false;
-	
-	tmin = 1.0f;
-	bool hit = false;
-	const float* verts = m_mesh->getVerts();
-	
-	for (int i = 0; i < ncid; ++i)
-	{
-		const rcChunkyTriMeshNode& node = m_chunkyMesh->nodes[cid[i]];
-		const int* tris = &m_chunkyMesh->tris[node.i*3];
-		const int ntris = node.n;
-
-		for (int j = 0; j < ntris*3; j += 3)
-		{
-			float t = 1;
-			if (intersectSegmentTriangle(src, dst,
-										 &verts[tris[j]*3],
-										 &verts[tris[j+1]*3],
-										 &verts[tris[j+2]*3], t))
-			{
-				if (t < tmin)
-					tmin = t;
-				hit = true;
-			}
-		}
-	}
-	
-	return hit;
+	return rcRaycastTriMeshIndex(*m_meshIndex, m_mesh->getVerts(), src, dst, tmin);
 }
 
 void InputGeom::addOffMeshConnection(const float* spos, const float* epos, const float rad,
@@ -544,6 +696,21 @@ void InputGeom::deleteConvexVolume(int i)
 	m_volumes[i] = m_volumes[m_volumeCount];
 }
 
+bool InputGeom::markConvexVolumes(rcContext* ctx, rcCompactHeightfield& chf) const
+{
+	rcConvexVolume vols[MAX_VOLUMES];
+	for (int i = 0; i < m_volumeCount; ++i)
+	{
+		const ConvexVolume* vol = &m_volumes[i];
+		vols[i].verts = vol->verts;
+		vols[i].numVerts = vol->nverts;
+		vols[i].minY = vol->hmin;
+		vols[i].maxY = vol->hmax;
+		vols[i].areaId = (unsigned char)vol->area;
+	}
+	return rcMarkConvexPolyAreas(ctx, vols, m_volumeCount, chf);
+}
+
 void InputGeom::drawConvexVolumes(struct duDebugDraw* dd, bool /*hilight*/)
 {
 	dd->depthMask(false);
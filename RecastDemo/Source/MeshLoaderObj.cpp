@@ -38,7 +38,24 @@ rcMeshLoaderObj::~rcMeshLoaderObj()
 	delete [] m_normals;
 	delete [] m_tris;
 }
-		
+
+void rcMeshLoaderObj::setMesh(const std::string& fileName, const float* verts, int vertCount, const int* tris,
+							  const float* normals, int triCount)
+{
+	delete [] m_verts;
+	delete [] m_normals;
+	delete [] m_tris;
+	m_verts = new float[vertCount*3];
+	m_tris = new int[triCount*3];
+	m_normals = new float[triCount*3];
+	memcpy(m_verts, verts, vertCount*3*sizeof(float));
+	memcpy(m_tris, tris, triCount*3*sizeof(int));
+	memcpy(m_normals, normals, triCount*3*sizeof(float));
+	m_vertCount = vertCount;
+	m_triCount = triCount;
+	m_filename = fileName;
+}
+
 void rcMeshLoaderObj::addVertex(float x, float y, float z, int& cap)
 {
 	if (m_vertCount+1 > cap)
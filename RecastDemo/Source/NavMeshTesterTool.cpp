@@ -37,6 +37,7 @@
 #include "DetourDebugDraw.h"
 #include "DetourCommon.h"
 #include "DetourPathCorridor.h"
+#include "PerfTimer.h"
 
 #ifdef WIN32
 #	define snprintf _snprintf
@@ -188,8 +189,12 @@ NavMeshTesterTool::NavMeshTesterTool() :
 	m_eposSet(false),
 	m_pathIterNum(0),
 	m_pathIterPolyCount(0),
-	m_steerPointCount(0)
+	m_steerPointCount(0),
+	m_showQueryStats(false),
+	m_queryTime(0)
 {
+	memset(&m_queryStats, 0, sizeof(m_queryStats));
+
 	m_filter.setIncludeFlags(SAMPLE_POLYFLAGS_ALL ^ SAMPLE_POLYFLAGS_DISABLED);
 	m_filter.setExcludeFlags(0);
 
@@ -362,7 +367,11 @@ void NavMeshTesterTool::handleMenu()
 		}
 	}
 
-	
+	imguiSeparator();
+
+	if (imguiCheck("Show Query Stats", m_showQueryStats))
+		m_showQueryStats = !m_showQueryStats;
+
 	imguiSeparator();
 
 	imguiLabel("Include Flags");
@@ -636,6 +645,9 @@ void NavMeshTesterTool::recalc()
 {
 	if (!m_navMesh)
 		return;
+
+	const TimeVal startTime = getPerfTime();
+	m_navQuery->resetStats();
 	
 	if (m_sposSet)
 		m_navQuery->findNearestPoly(m_spos, m_polyPickExt, &m_filter, &m_startRef, 0);
@@ -964,6 +976,12 @@ void NavMeshTesterTool::recalc()
 											   m_polys, m_parent, &m_npolys, MAX_POLYS);
 		}
 	}
+
+	const TimeVal endTime = getPerfTime();
+	m_queryTime = getPerfTimeUsec(endTime - startTime) / 1000.0f;
+	m_queryStats = m_navQuery->getStats();
+	m_queryTimeHistory.addSample(m_queryTime);
+	m_queryNodesHistory.addSample((float)m_queryStats.nodesExpanded);
 }
 
 static void getPolyCenter(dtNavMesh* navMesh, dtPolyRef ref, float* center)
@@ -980,7 +998,8 @@ static void getPolyCenter(dtNavMesh* navMesh, dtPolyRef ref, float* center)
 		
 	for (int i = 0; i < (int)poly->vertCount; ++i)
 	{
-		const float* v = &tile->verts[poly->verts[i]*3];
+		float v[3];
+		dtGetTileVertex(tile, poly->verts[i], v);
 		center[0] += v[0];
 		center[1] += v[1];
 		center[2] += v[2];
@@ -1348,6 +1367,31 @@ void NavMeshTesterTool::handleRenderOverlay(double* proj, double* model, int* vi
 	// Tool help
 	const int h = view[3];
 	imguiDrawText(280, h-40, IMGUI_ALIGN_LEFT, "LMB+SHIFT: Set start location  LMB: Set end location", imguiRGBA(255,255,255,192));	
+
+	if (m_showQueryStats)
+	{
+		char text[128];
+		const unsigned int col = imguiRGBA(255,255,255,192);
+		snprintf(text, sizeof(text), "Query time: %.3f ms", m_queryTime);
+		imguiDrawText(280, h-60, IMGUI_ALIGN_LEFT, text, col);
+		snprintf(text, sizeof(text), "Nodes expanded: %d  Max nodes used: %d  Tiles touched: %d",
+				 m_queryStats.nodesExpanded, m_queryStats.maxNodesUsed, m_queryStats.tilesTouched);
+		imguiDrawText(280, h-80, IMGUI_ALIGN_LEFT, text, col);
+		snprintf(text, sizeof(text), "Filter calls: %d  Cost calls: %d  Out of nodes: %d",
+				 m_queryStats.filterCalls, m_queryStats.costCalls, m_queryStats.outOfNodesCount);
+		imguiDrawText(280, h-100, IMGUI_ALIGN_LEFT, text, col);
+
+		// One sample per recalc.
+		GraphParams gp;
+		gp.setRect(300, 10, 500, 200, 8);
+		gp.setValueRange(0.0f, 1.0f, 4, "ms");
+		drawGraphBackground(&gp);
+		drawGraph(&gp, &m_queryTimeHistory, 1, "Query Time", duRGBA(255,128,0,255));
+
+		gp.setRect(300, 10, 500, 50, 8);
+		gp.setValueRange(0.0f, 2048.0f, 1, "");
+		drawGraph(&gp, &m_queryNodesHistory, 0, "Nodes Expanded", duRGBA(96,96,96,128));
+	}
 }
 
 void NavMeshTesterTool::drawAgent(const float* pos, float r, float h, float c, const unsigned int col)
@@ -38,6 +38,14 @@ int getPerfTimeUsec(const TimeVal duration)
 	return (int)(duration*1000000 / freq);
 }
 
+double getPerfClockUsec()
+{
+	static __int64 freq = 0;
+	if (freq == 0)
+		QueryPerformanceFrequency((LARGE_INTEGER*)&freq);
+	return (double)getPerfTime()*1000000.0 / (double)freq;
+}
+
 #else
 
 // Linux, BSD, OSX
@@ -56,4 +64,9 @@ int getPerfTimeUsec(const TimeVal duration)
 	return (int)duration;
 }
 
+double getPerfClockUsec()
+{
+	return (double)getPerfTime();
+}
+
 #endif
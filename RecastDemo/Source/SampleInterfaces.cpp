@@ -258,6 +258,45 @@ void DebugDrawGL::end()
 	glPointSize(1.0f);
 }
 
+void DebugDrawGL::drawBuffer(const duDebugDrawBuffer& buffer)
+{
+	// One draw call per batch from the vertex arrays of the buffer.
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 0, buffer.getPositions());
+	glColorPointer(4, GL_UNSIGNED_BYTE, 0, buffer.getColors());
+	for (int i = 0; i < buffer.getBatchCount(); ++i)
+	{
+		const duDebugDrawBuffer::Batch& batch = buffer.getBatch(i);
+		depthMask(batch.depthMask);
+		GLenum mode = GL_POINTS;
+		switch (batch.prim)
+		{
+			case DU_DRAW_POINTS:
+				glPointSize(batch.size);
+				mode = GL_POINTS;
+				break;
+			case DU_DRAW_LINES:
+				glLineWidth(batch.size);
+				mode = GL_LINES;
+				break;
+			case DU_DRAW_TRIS:
+				mode = GL_TRIANGLES;
+				break;
+			case DU_DRAW_QUADS:
+				mode = GL_QUADS;
+				break;
+		}
+		glDrawArrays(mode, batch.first, batch.count);
+		glLineWidth(1.0f);
+		glPointSize(1.0f);
+	}
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	if (buffer.getBatchCount())
+		depthMask(buffer.getDepthMask());
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 FileIO::FileIO() :
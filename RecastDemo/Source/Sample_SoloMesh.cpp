@@ -437,6 +437,12 @@ bool Sample_SoloMesh::handleBuild()
 		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not create solid heightfield.");
 		return false;
 	}
+	// Reserve about one span per column up front, instead of growing the span pools piece by piece.
+	if (!rcReserveHeightfieldSpans(m_ctx, *m_solid, m_cfg.width*m_cfg.height))
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'spans'.");
+		return false;
+	}
 	
 	// Allocate array that can hold triangle area types.
 	// If you have multiple meshes you need to process, allocate
@@ -458,6 +464,12 @@ bool Sample_SoloMesh::handleBuild()
 		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not rasterize triangles.");
 		return false;
 	}
+	// Lay the spans out column by column for the filter and compaction passes.
+	if (!rcDefragmentHeightfield(m_ctx, *m_solid))
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not defragment solid heightfield.");
+		return false;
+	}
 
 	if (!m_keepInterResults)
 	{
@@ -513,9 +525,11 @@ bool Sample_SoloMesh::handleBuild()
 	}
 
 	// (Optional) Mark areas.
-	const ConvexVolume* vols = m_geom->getConvexVolumes();
-	for (int i  = 0; i < m_geom->getConvexVolumeCount(); ++i)
-		rcMarkConvexPolyArea(m_ctx, vols[i].verts, vols[i].nverts, vols[i].hmin, vols[i].hmax, (unsigned char)vols[i].area, *m_chf);
+	if (!m_geom->markConvexVolumes(m_ctx, *m_chf))
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not mark areas.");
+		return false;
+	}
 
 	
 	// Partition the heightfield so that we can use simple algorithm later to triangulate the walkable areas.
@@ -289,9 +289,10 @@ int Sample_TempObstacles::rasterizeTileLayers(
 							   const int tx, const int ty,
 							   const rcConfig& cfg,
 							   TileCacheData* tiles,
-							   const int maxTiles)
+							   const int maxTiles,
+							   const unsigned char* meshTriAreas)
 {
-	if (!m_geom || !m_geom->getMesh() || !m_geom->getChunkyMesh())
+	if (!m_geom || !m_geom->getMesh() || !m_geom->getMeshIndex())
 	{
 		m_ctx->log(RC_LOG_ERROR, "buildTile: Input mesh is not specified.");
 		return 0;
@@ -302,7 +303,7 @@ int Sample_TempObstacles::rasterizeTileLayers(
 	
 	const float* verts = m_geom->getMesh()->getVerts();
 	const int nverts = m_geom->getMesh()->getVertCount();
-	const rcChunkyTriMesh* chunkyMesh = m_geom->getChunkyMesh();
+	const rcTriMeshIndex* meshIndex = m_geom->getMeshIndex();
 	
 	// Tile bounds.
 	const float tcs = cfg.tileSize * cfg.cs;
@@ -337,10 +338,10 @@ int Sample_TempObstacles::rasterizeTileLayers(
 	// Allocate array that can hold triangle flags.
 	// If you have multiple meshes you need to process, allocate
 	// and array which can hold the max number of triangles you need to process.
-	rc.triareas = new unsigned char[chunkyMesh->maxTrisPerChunk];
+	rc.triareas = new unsigned char[meshIndex->maxTrisPerChunk];
 	if (!rc.triareas)
 	{
-		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'm_triareas' (%d).", chunkyMesh->maxTrisPerChunk);
+		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'm_triareas' (%d).", meshIndex->maxTrisPerChunk);
 		return 0;
 	}
 	
@@ -350,7 +351,7 @@ int Sample_TempObstacles::rasterizeTileLayers(
 	tbmax[0] = tcfg.bmax[0];
 	tbmax[1] = tcfg.bmax[2];
 	int cid[512];// TODO: Make grow when returning too many items.
-	const int ncid = rcGetChunksOverlappingRect(chunkyMesh, tbmin, tbmax, cid, 512);
+	const int ncid = rcGetTriMeshChunksOverlappingRect(*meshIndex, tbmin, tbmax, cid, 512);
 	if (!ncid)
 	{
 		return 0; // empty
@@ -358,15 +359,23 @@ int Sample_TempObstacles::rasterizeTileLayers(
 	
 	for (int i = 0; i < ncid; ++i)
 	{
-		const rcChunkyTriMeshNode& node = chunkyMesh->nodes[cid[i]];
-		const int* tris = &chunkyMesh->tris[node.i*3];
+		const rcTriMeshIndexNode& node = meshIndex->nodes[cid[i]];
+		const int* tris = &meshIndex->tris[node.i*3];
 		const int ntris = node.n;
 		
-		memset(rc.triareas, 0, ntris*sizeof(unsigned char));
-		rcMarkWalkableTriangles(m_ctx, tcfg.walkableSlopeAngle,
-								verts, nverts, tris, ntris, rc.triareas);
+		const unsigned char* triareas = rc.triareas;
+		if (meshTriAreas)
+		{
+			triareas = &meshTriAreas[node.i];
+		}
+		else
+		{
+			memset(rc.triareas, 0, ntris*sizeof(unsigned char));
+			rcMarkWalkableTriangles(m_ctx, tcfg.walkableSlopeAngle,
+									verts, nverts, tris, ntris, rc.triareas);
+		}
 		
-		if (!rcRasterizeTriangles(m_ctx, verts, nverts, tris, rc.triareas, ntris, *rc.solid, tcfg.walkableClimb))
+		if (!rcRasterizeTriangles(m_ctx, verts, nverts, tris, triareas, ntris, *rc.solid, tcfg.walkableClimb))
 			return 0;
 	}
 	
@@ -401,12 +410,10 @@ int Sample_TempObstacles::rasterizeTileLayers(
 	}
 	
 	// (Optional) Mark areas.
-	const ConvexVolume* vols = m_geom->getConvexVolumes();
-	for (int i  = 0; i < m_geom->getConvexVolumeCount(); ++i)
+	if (!m_geom->markConvexVolumes(m_ctx, *rc.chf))
 	{
-		rcMarkConvexPolyArea(m_ctx, vols[i].verts, vols[i].nverts,
-							 vols[i].hmin, vols[i].hmax,
-							 (unsigned char)vols[i].area, *rc.chf);
+		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not mark areas.");
+		return 0;
 	}
 	
 	rc.lset = rcAllocHeightfieldLayerSet();
@@ -842,6 +849,7 @@ Sample_TempObstacles::Sample_TempObstacles() :
 	m_cacheRawSize(0),
 	m_cacheLayerCount(0),
 	m_cacheBuildMemUsage(0),
+	m_showUpdateGraph(false),
 	m_drawMode(DRAWMODE_NAVMESH),
 	m_maxTiles(0),
 	m_maxPolysPerTile(0),
@@ -925,6 +933,9 @@ void Sample_TempObstacles::handleSettings()
 	snprintf(msg, 64, "Build Peak Mem Usage  %.1f kB", m_cacheBuildMemUsage/1024.0f);
 	imguiValue(msg);
 
+	if (imguiCheck("Show Update Graph", m_showUpdateGraph))
+		m_showUpdateGraph = !m_showUpdateGraph;
+
 	imguiSeparator();
 
 	imguiIndent();
@@ -1128,6 +1139,20 @@ void Sample_TempObstacles::handleRenderOverlay(double* proj, double* model, int*
 		m_tool->handleRenderOverlay(proj, model, view);
 	renderOverlayToolStates(proj, model, view);
 
+	if (m_showUpdateGraph)
+	{
+		GraphParams gp;
+		gp.setRect(300, 430, 500, 200, 8);
+		gp.setValueRange(0.0f, 10.0f, 5, "ms");
+		drawGraphBackground(&gp);
+		drawGraph(&gp, &m_cacheUpdateTime, 2, "Update Time", duRGBA(255,128,0,255));
+
+		gp.setRect(300, 430, 500, 50, 8);
+		gp.setValueRange(0.0f, 16.0f, 1, "");
+		drawGraph(&gp, &m_cacheTilesRebuilt, 0, "Tiles Rebuilt", duRGBA(64,192,255,255));
+		drawGraph(&gp, &m_cacheObstacleRequests, 1, "Obstacle Requests", duRGBA(96,96,96,128));
+	}
+
 	// Stats
 /*	imguiDrawRect(280,10,300,100,imguiRGBA(0,0,0,64));
 	
@@ -1316,13 +1341,20 @@ bool Sample_TempObstacles::handleBuild()
 	m_cacheCompressedSize = 0;
 	m_cacheRawSize = 0;
 	
+	// Classify the input triangles once, the tiles rasterize each chunk with its range of the area ids.
+	const rcTriMeshIndex* meshIndex = m_geom->getMeshIndex();
+	unsigned char* meshTriAreas = new unsigned char[meshIndex->ntris > 0 ? meshIndex->ntris : 1];
+	memset(meshTriAreas, 0, meshIndex->ntris*sizeof(unsigned char));
+	rcMarkWalkableTriangles(m_ctx, cfg.walkableSlopeAngle, m_geom->getMesh()->getVerts(),
+							m_geom->getMesh()->getVertCount(), meshIndex->tris, meshIndex->ntris, meshTriAreas);
+	
 	for (int y = 0; y < th; ++y)
 	{
 		for (int x = 0; x < tw; ++x)
 		{
 			TileCacheData tiles[MAX_LAYERS];
 			memset(tiles, 0, sizeof(tiles));
-			int ntiles = rasterizeTileLayers(x, y, cfg, tiles, MAX_LAYERS);
+			int ntiles = rasterizeTileLayers(x, y, cfg, tiles, MAX_LAYERS, meshTriAreas);
 
 			for (int i = 0; i < ntiles; ++i)
 			{
@@ -1341,6 +1373,7 @@ bool Sample_TempObstacles::handleBuild()
 			}
 		}
 	}
+	delete [] meshTriAreas;
 
 	// Build initial meshes
 	m_ctx->startTimer(RC_TIMER_TOTAL);
@@ -1380,7 +1413,14 @@ void Sample_TempObstacles::handleUpdate(const float dt)
 	if (!m_tileCache)
 		return;
 	
+	const TimeVal startTime = getPerfTime();
 	m_tileCache->update(dt, m_navMesh);
+	const TimeVal endTime = getPerfTime();
+
+	const dtTileCacheUpdateStats& stats = m_tileCache->getUpdateStats();
+	m_cacheUpdateTime.addSample(getPerfTimeUsec(endTime - startTime) / 1000.0f);
+	m_cacheTilesRebuilt.addSample((float)stats.tilesRebuilt);
+	m_cacheObstacleRequests.addSample((float)stats.obstacleRequests);
 }
 
 void Sample_TempObstacles::getTilePos(const float* pos, int& tx, int& ty)
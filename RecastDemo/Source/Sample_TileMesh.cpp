@@ -179,6 +179,7 @@ Sample_TileMesh::Sample_TileMesh() :
 	m_buildAll(true),
 	m_totalBuildTimeMs(0),
 	m_triareas(0),
+	m_meshTriAreas(0),
 	m_solid(0),
 	m_chf(0),
 	m_cset(0),
@@ -739,6 +740,13 @@ void Sample_TileMesh::buildAllTiles()
 	// Start the build process.
 	m_ctx->startTimer(RC_TIMER_TEMP);
 
+	// Classify the input triangles once, the tiles rasterize each chunk with its range of the area ids.
+	const rcTriMeshIndex* meshIndex = m_geom->getMeshIndex();
+	m_meshTriAreas = new unsigned char[meshIndex->ntris > 0 ? meshIndex->ntris : 1];
+	memset(m_meshTriAreas, 0, meshIndex->ntris*sizeof(unsigned char));
+	rcMarkWalkableTriangles(m_ctx, m_agentMaxSlope, m_geom->getMesh()->getVerts(), m_geom->getMesh()->getVertCount(),
+							meshIndex->tris, meshIndex->ntris, m_meshTriAreas);
+
 	for (int y = 0; y < th; ++y)
 	{
 		for (int x = 0; x < tw; ++x)
@@ -764,6 +772,9 @@ void Sample_TileMesh::buildAllTiles()
 			}
 		}
 	}
+
+	delete [] m_meshTriAreas;
+	m_meshTriAreas = 0;
 	
 	// Start the build process.	
 	m_ctx->stopTimer(RC_TIMER_TEMP);
@@ -793,7 +804,7 @@ void Sample_TileMesh::removeAllTiles()
 
 unsigned char* Sample_TileMesh::buildTileMesh(const int tx, const int ty, const float* bmin, const float* bmax, int& dataSize)
 {
-	if (!m_geom || !m_geom->getMesh() || !m_geom->getChunkyMesh())
+	if (!m_geom || !m_geom->getMesh() || !m_geom->getMeshIndex())
 	{
 		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Input mesh is not specified.");
 		return 0;
@@ -807,7 +818,7 @@ unsigned char* Sample_TileMesh::buildTileMesh(const int tx, const int ty, const
 	const float* verts = m_geom->getMesh()->getVerts();
 	const int nverts = m_geom->getMesh()->getVertCount();
 	const int ntris = m_geom->getMesh()->getTriCount();
-	const rcChunkyTriMesh* chunkyMesh = m_geom->getChunkyMesh();
+	const rcTriMeshIndex* meshIndex = m_geom->getMeshIndex();
 		
 	// Init build configuration from GUI
 	memset(&m_cfg, 0, sizeof(m_cfg));
@@ -883,10 +894,10 @@ unsigned char* Sample_TileMesh::buildTileMesh(const int tx, const int ty, const
 	// Allocate array that can hold triangle flags.
 	// If you have multiple meshes you need to process, allocate
 	// and array which can hold the max number of triangles you need to process.
-	m_triareas = new unsigned char[chunkyMesh->maxTrisPerChunk];
+	m_triareas = new unsigned char[meshIndex->maxTrisPerChunk];
 	if (!m_triareas)
 	{
-		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'm_triareas' (%d).", chunkyMesh->maxTrisPerChunk);
+		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'm_triareas' (%d).", meshIndex->maxTrisPerChunk);
 		return 0;
 	}
 	
@@ -896,7 +907,7 @@ unsigned char* Sample_TileMesh::buildTileMesh(const int tx, const int ty, const
 	tbmax[0] = m_cfg.bmax[0];
 	tbmax[1] = m_cfg.bmax[2];
 	int cid[512];// TODO: Make grow when returning too many items.
-	const int ncid = rcGetChunksOverlappingRect(chunkyMesh, tbmin, tbmax, cid, 512);
+	const int ncid = rcGetTriMeshChunksOverlappingRect(*meshIndex, tbmin, tbmax, cid, 512);
 	if (!ncid)
 		return 0;
 	
@@ -904,17 +915,26 @@ unsigned char* Sample_TileMesh::buildTileMesh(const int tx, const int ty, const
 	
 	for (int i = 0; i < ncid; ++i)
 	{
-		const rcChunkyTriMeshNode& node = chunkyMesh->nodes[cid[i]];
-		const int* ctris = &chunkyMesh->tris[node.i*3];
+		const rcTriMeshIndexNode& node = meshIndex->nodes[cid[i]];
+		const int* ctris = &meshIndex->tris[node.i*3];
 		const int nctris = node.n;
 		
 		m_tileTriCount += nctris;
 		
-		memset(m_triareas, 0, nctris*sizeof(unsigned char));
-		rcMarkWalkableTriangles(m_ctx, m_cfg.walkableSlopeAngle,
-								verts, nverts, ctris, nctris, m_triareas);
+		// All tiles share the area ids of buildAllTiles, a single tile classifies its chunks.
+		const unsigned char* triareas = m_triareas;
+		if (m_meshTriAreas)
+		{
+			triareas = &m_meshTriAreas[node.i];
+		}
+		else
+		{
+			memset(m_triareas, 0, nctris*sizeof(unsigned char));
+			rcMarkWalkableTriangles(m_ctx, m_cfg.walkableSlopeAngle,
+									verts, nverts, ctris, nctris, m_triareas);
+		}
 		
-		if (!rcRasterizeTriangles(m_ctx, verts, nverts, ctris, m_triareas, nctris, *m_solid, m_cfg.walkableClimb))
+		if (!rcRasterizeTriangles(m_ctx, verts, nverts, ctris, triareas, nctris, *m_solid, m_cfg.walkableClimb))
 			return 0;
 	}
 	
@@ -963,9 +983,11 @@ unsigned char* Sample_TileMesh::buildTileMesh(const int tx, const int ty, const
 	}
 
 	// (Optional) Mark areas.
-	const ConvexVolume* vols = m_geom->getConvexVolumes();
-	for (int i  = 0; i < m_geom->getConvexVolumeCount(); ++i)
-		rcMarkConvexPolyArea(m_ctx, vols[i].verts, vols[i].nverts, vols[i].hmin, vols[i].hmax, (unsigned char)vols[i].area, *m_chf);
+	if (!m_geom->markConvexVolumes(m_ctx, *m_chf))
+	{
+		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not mark areas.");
+		return 0;
+	}
 	
 	
 	// Partition the heightfield so that we can use simple algorithm later to triangulate the walkable areas.
@@ -1150,6 +1172,7 @@ unsigned char* Sample_TileMesh::buildTileMesh(const int tx, const int ty, const
 		params.cs = m_cfg.cs;
 		params.ch = m_cfg.ch;
 		params.buildBvTree = true;
+		params.buildWideBvTree = true;
 		
 		if (!dtCreateNavMeshData(&params, &navData, &navDataSize))
 		{
@@ -201,6 +201,39 @@ project "RecastDemo"
 			"Cocoa.framework",
 		}
 
+project "RecastBatch"
+	language "C++"
+	kind "ConsoleApp"
+	includedirs { 
+		"../RecastDemo/Batch",
+		"../RecastDemo/Include",
+		"../DebugUtils/Include",
+		"../Detour/Include",
+		"../DetourCrowd/Include",
+		"../DetourTileCache/Include",
+		"../Recast/Include"
+	}
+	files {
+		"../RecastDemo/Batch/*.h",
+		"../RecastDemo/Batch/*.cpp",
+		"../RecastDemo/Source/InputGeom.cpp",
+		"../RecastDemo/Source/MeshLoaderObj.cpp",
+		"../RecastDemo/Source/PerfTimer.cpp",
+		"../RecastDemo/Source/TestCase.cpp"
+	}
+
+	-- project dependencies
+	links {
+		"DebugUtils",
+		"Detour",
+		"DetourTileCache",
+		"Recast"
+	}
+
+	-- distribute executable in RecastDemo/Bin directory, test cases find their meshes in Bin/Meshes
+	targetdir "Bin"
+	debugdir "../RecastDemo/Bin/"
+
 project "Tests"
 	language "C++"
 	kind "ConsoleApp"
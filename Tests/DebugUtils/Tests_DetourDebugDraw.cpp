@@ -0,0 +1,166 @@
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "DebugDraw.h"
+#include "DetourDebugDraw.h"
+#include "DetourNavMesh.h"
+
+#include "../Detour/TestNavMeshUtils.h"
+
+namespace
+{
+const int CELLS = 4;
+
+struct Vertex
+{
+	float pos[3];
+	unsigned int color;
+	int prim;
+	bool depthMask;
+
+	bool operator==(const Vertex& other) const
+	{
+		return pos[0] == other.pos[0] && pos[1] == other.pos[1] && pos[2] == other.pos[2] &&
+			color == other.color && prim == other.prim && depthMask == other.depthMask;
+	}
+};
+
+// Records the submitted vertices, and counts the buffers drawn.
+class RecordingDebugDraw : public duDebugDraw
+{
+public:
+	RecordingDebugDraw() : prim(DU_DRAW_POINTS), mask(true), buffersCreated(0), buffersDestroyed(0), buffersDrawn(0) {}
+
+	void depthMask(bool state) override { mask = state; }
+	void texture(bool) override {}
+	void begin(duDebugDrawPrimitives p, float) override { prim = p; }
+	void vertex(const float* pos, unsigned int color) override { vertex(pos[0], pos[1], pos[2], color); }
+	void vertex(const float x, const float y, const float z, unsigned int color) override
+	{
+		Vertex v = { { x, y, z }, color, prim, mask };
+		vertices.push_back(v);
+	}
+	void vertex(const float* pos, unsigned int color, const float*) override { vertex(pos, color); }
+	void vertex(const float x, const float y, const float z, unsigned int color, const float, const float) override
+	{
+		vertex(x, y, z, color);
+	}
+	void end() override {}
+	unsigned int areaToCol(unsigned int area) override { return duRGBA(1, 2, 3, (int)area); }
+
+	duDebugDrawBuffer* createBuffer() override
+	{
+		buffersCreated++;
+		return duDebugDraw::createBuffer();
+	}
+	void destroyBuffer(duDebugDrawBuffer* buffer) override
+	{
+		buffersDestroyed++;
+		duDebugDraw::destroyBuffer(buffer);
+	}
+	void drawBuffer(const duDebugDrawBuffer& buffer) override
+	{
+		buffersDrawn++;
+		duDebugDraw::drawBuffer(buffer);
+	}
+
+	duDebugDrawPrimitives prim;
+	bool mask;
+	int buffersCreated;
+	int buffersDestroyed;
+	int buffersDrawn;
+	std::vector<Vertex> vertices;
+};
+} // anonymous namespace
+
+TEST_CASE("duDebugDrawBuffer", "[debugdraw]")
+{
+	RecordingDebugDraw dd;
+	duDebugDrawBuffer* buffer = dd.createBuffer();
+	REQUIRE(buffer);
+
+	// Empty batches are dropped, area colors come from the owner.
+	buffer->depthMask(false);
+	buffer->begin(DU_DRAW_LINES, 2.0f);
+	buffer->vertex(1.0f, 2.0f, 3.0f, buffer->areaToCol(7));
+	buffer->vertex(4.0f, 5.0f, 6.0f, 0xffffffffu);
+	buffer->end();
+	buffer->begin(DU_DRAW_TRIS);
+	buffer->end();
+	buffer->depthMask(true);
+
+	REQUIRE(buffer->getBatchCount() == 1);
+	REQUIRE(buffer->getBatch(0).prim == DU_DRAW_LINES);
+	REQUIRE(buffer->getBatch(0).size == 2.0f);
+	REQUIRE(!buffer->getBatch(0).depthMask);
+	REQUIRE(buffer->getBatch(0).count == 2);
+	REQUIRE(buffer->getColors()[0] == duRGBA(1, 2, 3, 7));
+
+	dd.drawBuffer(*buffer);
+	REQUIRE(dd.vertices.size() == 2);
+	REQUIRE(!dd.vertices[0].depthMask);
+	REQUIRE(dd.mask);
+
+	const unsigned int version = buffer->getVersion();
+	buffer->clear();
+	REQUIRE(buffer->getVersion() != version);
+	REQUIRE(buffer->getVertexCount() == 0);
+	REQUIRE(buffer->getBatchCount() == 0);
+	dd.destroyBuffer(buffer);
+}
+
+TEST_CASE("duNavMeshDebugCache", "[debugdraw]")
+{
+	dtNavMesh* nav = TestNavMesh::createNavMesh(4, 4, CELLS);
+	REQUIRE(nav);
+	for (int ty = 0; ty < 4; ++ty)
+		for (int tx = 0; tx < 4; ++tx)
+			REQUIRE(TestNavMesh::addTile(nav, tx, ty, CELLS));
+
+	RecordingDebugDraw immediate;
+	duDebugDrawNavMesh(&immediate, *nav, DU_DRAWNAVMESH_OFFMESHCONS);
+
+	RecordingDebugDraw dd;
+	duNavMeshDebugCache* cache = new duNavMeshDebugCache(&dd);
+
+	SECTION("Cached tiles draw the same vertices")
+	{
+		cache->draw(*nav, DU_DRAWNAVMESH_OFFMESHCONS);
+		REQUIRE(cache->getRecordedTileCount() == 16);
+		REQUIRE(dd.vertices == immediate.vertices);
+
+		dd.vertices.clear();
+		cache->draw(*nav, DU_DRAWNAVMESH_OFFMESHCONS);
+		REQUIRE(cache->getRecordedTileCount() == 0);
+		REQUIRE(dd.buffersDrawn == 32);
+		REQUIRE(dd.buffersCreated == 16);
+		REQUIRE(dd.vertices == immediate.vertices);
+
+		// New flags tessellate all tiles again.
+		cache->draw(*nav, DU_DRAWNAVMESH_COLOR_TILES);
+		REQUIRE(cache->getRecordedTileCount() == 16);
+	}
+
+	SECTION("Changed tiles and their neighbours are tessellated again")
+	{
+		cache->draw(*nav, 0);
+		REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(0, 0, 0), 0, 0)));
+		cache->draw(*nav, 0);
+		REQUIRE(cache->getRecordedTileCount() == 3);
+		REQUIRE(dd.buffersDestroyed == 1);
+
+		REQUIRE(TestNavMesh::addTile(nav, 0, 0, CELLS));
+		dd.vertices.clear();
+		cache->draw(*nav, 0);
+		REQUIRE(cache->getRecordedTileCount() == 4);
+
+		RecordingDebugDraw expected;
+		duDebugDrawNavMesh(&expected, *nav, 0);
+		REQUIRE(dd.vertices == expected.vertices);
+	}
+
+	delete cache;
+	REQUIRE(dd.buffersDestroyed == dd.buffersCreated);
+	dtFreeNavMesh(nav);
+}
@@ -0,0 +1,129 @@
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "DetourCommon.h"
+
+// TODO: Implement benchmarking for platforms other than posix.
+#ifdef __unix__
+#include <unistd.h>
+#ifdef _POSIX_TIMERS
+#include <time.h>
+#include <stdint.h>
+
+static int64_t CommonNowNanos()
+{
+	struct timespec tp;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &tp);
+	return tp.tv_nsec + 1000000000LL * tp.tv_sec;
+}
+
+static void printCommonBench(const char* name, const bool simd, const int calls, const int64_t nanos)
+{
+	char label[64];
+	snprintf(label, sizeof(label), "%s_%s:", name, simd ? "SIMD" : "Scalar");
+	printf("BM_%-35s %d calls in %10ld nanos: %10.2f nanos/call\n", label, calls, (long)nanos, double(nanos) / calls);
+}
+
+// Times the polygon tests on hexagons, the most common polygon size of the navigation meshes,
+// with the scalar and the SIMD versions. The sums keep the calls from being optimized away.
+TEST_CASE("Bench DetourCommon polygon tests", "[detour]")
+{
+	const int polyCount = 1024;
+	const int nverts = 6;
+	const int repeats = 200;
+	std::vector<float> polys(polyCount * nverts * 3);
+	std::vector<float> points(polyCount * 3);
+	unsigned int seed = 4321;
+	for (int i = 0; i < polyCount; ++i)
+	{
+		seed = seed * 1103515245u + 12345u;
+		const float cx = (float)(seed % 100), cz = (float)((seed >> 8) % 100);
+		for (int j = 0; j < nverts; ++j)
+		{
+			const float a = -j * 6.2831853f / nverts;
+			float* v = &polys[(i * nverts + j) * 3];
+			v[0] = cx + cosf(a) * 2.0f;
+			v[1] = 0.0f;
+			v[2] = cz + sinf(a) * 2.0f;
+		}
+		points[i * 3 + 0] = cx + (float)((seed >> 4) % 5) - 2.0f;
+		points[i * 3 + 1] = 0.0f;
+		points[i * 3 + 2] = cz + (float)((seed >> 12) % 5) - 2.0f;
+	}
+
+	const bool simd = dtGetSimdGeometry();
+	const int calls = polyCount * repeats;
+	float sum = 0.0f;
+	int count = 0;
+	for (int pass = 0; pass < (simd ? 2 : 1); ++pass)
+	{
+		dtSetSimdGeometry(pass == 1);
+
+		int64_t begin = CommonNowNanos();
+		for (int r = 0; r < repeats; ++r)
+			for (int i = 0; i < polyCount; ++i)
+				count += dtPointInPolygon(&points[i * 3], &polys[i * nverts * 3], nverts) ? 1 : 0;
+		printCommonBench("dtPointInPolygon", pass == 1, calls, CommonNowNanos() - begin);
+
+		begin = CommonNowNanos();
+		for (int r = 0; r < repeats; ++r)
+		{
+			for (int i = 0; i < polyCount; ++i)
+			{
+				float ed[nverts], et[nverts];
+				count += dtDistancePtPolyEdgesSqr(&points[i * 3], &polys[i * nverts * 3], nverts, ed, et) ? 1 : 0;
+				sum += ed[0];
+			}
+		}
+		printCommonBench("dtDistancePtPolyEdgesSqr", pass == 1, calls, CommonNowNanos() - begin);
+
+		begin = CommonNowNanos();
+		for (int r = 0; r < repeats; ++r)
+		{
+			for (int i = 0; i < polyCount; ++i)
+			{
+				float tmin, tmax;
+				int segMin, segMax;
+				const float* end = &points[((i + 1) % polyCount) * 3];
+				if (dtIntersectSegmentPoly2D(&points[i * 3], end, &polys[i * nverts * 3], nverts, tmin, tmax, segMin, segMax))
+					sum += tmax;
+			}
+		}
+		printCommonBench("dtIntersectSegmentPoly2D", pass == 1, calls, CommonNowNanos() - begin);
+	}
+	dtSetSimdGeometry(simd);
+
+	// The polygon overlap and the closest point on a triangle have no SIMD versions, they are timed for comparison.
+	int64_t begin = CommonNowNanos();
+	for (int r = 0; r < repeats; ++r)
+	{
+		for (int i = 0; i < polyCount; ++i)
+		{
+			const float* other = &polys[((i + r + 1) % polyCount) * nverts * 3];
+			count += dtOverlapPolyPoly2D(&polys[i * nverts * 3], nverts, other, nverts) ? 1 : 0;
+		}
+	}
+	printCommonBench("dtOverlapPolyPoly2D", false, calls, CommonNowNanos() - begin);
+
+	begin = CommonNowNanos();
+	for (int r = 0; r < repeats; ++r)
+	{
+		for (int i = 0; i < polyCount; ++i)
+		{
+			const float* v = &polys[i * nverts * 3];
+			float closest[3];
+			dtClosestPtPointTriangle(closest, &points[i * 3], &v[0], &v[3], &v[6]);
+			sum += closest[0];
+		}
+	}
+	printCommonBench("dtClosestPtPointTriangle", false, calls, CommonNowNanos() - begin);
+
+	REQUIRE(count >= 0);
+	REQUIRE(sum == sum);
+}
+
+#endif  // _POSIX_TIMERS
+#endif  // __unix__
@@ -0,0 +1,288 @@
+#ifndef TESTNAVMESHUTILS_H
+#define TESTNAVMESHUTILS_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "DetourAlloc.h"
+#include "DetourJobDispatcher.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+
+// Helpers for building simple tiled navigation meshes in tests.
+// Each tile is a flat grid of square cells at y = 0, one quad polygon per cell.
+// Cells for which the blocked function returns true are left out.
+namespace TestNavMesh
+{
+typedef bool (*BlockedFunc)(int cellX, int cellZ);
+
+static const int CELL_VOXELS = 4;
+static const float CELL_SIZE = 1.0f;
+
+// Creates the tile data for a tile of cellsPerTile x cellsPerTile cells.
+// Off-mesh connections are bidirectional with a radius of half a cell, their user ids are their indices.
+inline unsigned char* createTileData(int tx, int ty, int cellsPerTile, BlockedFunc blocked, int* outDataSize,
+									 bool wideBvTree = false, bool quantizeVerts = false,
+									 const float* offMeshConVerts = 0, int offMeshConCount = 0,
+									 bool buildWallDistances = false, float cellSize = CELL_SIZE)
+{
+	const int nvp = 4;
+	const int vertsPerSide = cellsPerTile + 1;
+	const float cs = cellSize / CELL_VOXELS;
+
+	std::vector<unsigned short> verts;
+	for (int z = 0; z < vertsPerSide; ++z)
+	{
+		for (int x = 0; x < vertsPerSide; ++x)
+		{
+			verts.push_back((unsigned short)(x * CELL_VOXELS));
+			verts.push_back(0);
+			verts.push_back((unsigned short)(z * CELL_VOXELS));
+		}
+	}
+
+	std::vector<int> polyIndex(cellsPerTile * cellsPerTile, -1);
+	int npolys = 0;
+	for (int z = 0; z < cellsPerTile; ++z)
+		for (int x = 0; x < cellsPerTile; ++x)
+			if (!blocked || !blocked(tx * cellsPerTile + x, ty * cellsPerTile + z))
+				polyIndex[x + z * cellsPerTile] = npolys++;
+	if (!npolys)
+		return 0;
+
+	std::vector<unsigned short> polys(npolys * nvp * 2, 0xffff);
+	std::vector<unsigned short> flags(npolys, 1);
+	std::vector<unsigned char> areas(npolys, 0);
+	for (int z = 0; z < cellsPerTile; ++z)
+	{
+		for (int x = 0; x < cellsPerTile; ++x)
+		{
+			const int idx = polyIndex[x + z * cellsPerTile];
+			if (idx < 0)
+				continue;
+			unsigned short* p = &polys[idx * nvp * 2];
+			p[0] = (unsigned short)(x + z * vertsPerSide);
+			p[1] = (unsigned short)(x + (z + 1) * vertsPerSide);
+			p[2] = (unsigned short)(x + 1 + (z + 1) * vertsPerSide);
+			p[3] = (unsigned short)(x + 1 + z * vertsPerSide);
+
+			// Edge neighbours in the order x-, z+, x+, z-.
+			const int dx[4] = { -1, 0, 1, 0 };
+			const int dz[4] = { 0, 1, 0, -1 };
+			for (int j = 0; j < 4; ++j)
+			{
+				const int nx = x + dx[j];
+				const int nz = z + dz[j];
+				if (nx < 0 || nz < 0 || nx >= cellsPerTile || nz >= cellsPerTile)
+					p[nvp + j] = (unsigned short)(0x8000 | j); // Portal to neighbour tile.
+				else if (polyIndex[nx + nz * cellsPerTile] >= 0)
+					p[nvp + j] = (unsigned short)polyIndex[nx + nz * cellsPerTile];
+			}
+		}
+	}
+
+	const float tileWorldSize = cellsPerTile * cellSize;
+
+	dtNavMeshCreateParams params;
+	memset(&params, 0, sizeof(params));
+	params.verts = &verts[0];
+	params.vertCount = vertsPerSide * vertsPerSide;
+	params.polys = &polys[0];
+	params.polyAreas = &areas[0];
+	params.polyFlags = &flags[0];
+	params.polyCount = npolys;
+	params.nvp = nvp;
+	params.walkableHeight = 2.0f;
+	params.walkableRadius = 0.5f;
+	params.walkableClimb = 0.5f;
+	params.tileX = tx;
+	params.tileY = ty;
+	params.tileLayer = 0;
+	params.bmin[0] = tx * tileWorldSize;
+	params.bmin[1] = -1.0f;
+	params.bmin[2] = ty * tileWorldSize;
+	params.bmax[0] = (tx + 1) * tileWorldSize;
+	params.bmax[1] = 1.0f;
+	params.bmax[2] = (ty + 1) * tileWorldSize;
+	params.cs = cs;
+	params.ch = cs;
+	params.buildBvTree = true;
+	params.buildWideBvTree = wideBvTree;
+	params.quantizeVerts = quantizeVerts;
+	params.buildWallDistances = buildWallDistances;
+
+	std::vector<float> offMeshRads(offMeshConCount + 1, cellSize * 0.5f);
+	std::vector<unsigned char> offMeshDirs(offMeshConCount + 1, 1);
+	std::vector<unsigned char> offMeshAreas(offMeshConCount + 1, 0);
+	std::vector<unsigned short> offMeshFlags(offMeshConCount + 1, 1);
+	std::vector<unsigned int> offMeshIds(offMeshConCount + 1, 0);
+	for (int i = 0; i < offMeshConCount; ++i)
+		offMeshIds[i] = (unsigned int)i;
+	params.offMeshConVerts = offMeshConVerts;
+	params.offMeshConRad = &offMeshRads[0];
+	params.offMeshConDir = &offMeshDirs[0];
+	params.offMeshConAreas = &offMeshAreas[0];
+	params.offMeshConFlags = &offMeshFlags[0];
+	params.offMeshConUserID = &offMeshIds[0];
+	params.offMeshConCount = offMeshConCount;
+
+	unsigned char* data = 0;
+	if (!dtCreateNavMeshData(&params, &data, outDataSize))
+		return 0;
+	return data;
+}
+
+// Counts its allocations and tags them, so that memory freed by the wrong allocator is detected.
+struct CountingAllocator : public dtAllocator
+{
+	static const unsigned int TAG = 0x44544131u;
+	static const size_t HEADER = 16;
+
+	std::atomic<int> allocs;
+	std::atomic<int> live;
+	std::atomic<int> foreign;
+	std::atomic<size_t> liveBytes;
+
+	CountingAllocator() : allocs(0), live(0), foreign(0), liveBytes(0) {}
+
+	void* alloc(size_t size, dtAllocHint) override
+	{
+		unsigned char* mem = (unsigned char*)malloc(size + HEADER);
+		if (!mem)
+			return 0;
+		*(unsigned int*)mem = TAG;
+		*(size_t*)(mem + 8) = size;
+		allocs++;
+		live++;
+		liveBytes += size;
+		return mem + HEADER;
+	}
+
+	void free(void* ptr) override
+	{
+		if (!ptr)
+			return;
+		unsigned char* mem = (unsigned char*)ptr - HEADER;
+		if (*(unsigned int*)mem != TAG)
+		{
+			foreign++;
+			return;
+		}
+		*(unsigned int*)mem = 0;
+		live--;
+		liveBytes -= *(size_t*)(mem + 8);
+		::free(mem);
+	}
+};
+
+// Initializes an empty nav mesh which can hold tilesX * tilesY tiles.
+inline dtNavMesh* createNavMesh(int tilesX, int tilesY, int cellsPerTile, int navMeshFlags = 0,
+								dtAllocator* allocator = 0)
+{
+	dtNavMeshParams params;
+	memset(&params, 0, sizeof(params));
+	params.tileWidth = cellsPerTile * CELL_SIZE;
+	params.tileHeight = cellsPerTile * CELL_SIZE;
+	params.maxTiles = tilesX * tilesY;
+	params.maxPolys = cellsPerTile * cellsPerTile;
+
+	dtNavMesh* nav = dtAllocNavMesh();
+	if (!nav || dtStatusFailed(nav->init(&params, navMeshFlags, allocator)))
+	{
+		dtFreeNavMesh(nav);
+		return 0;
+	}
+	return nav;
+}
+
+// Adds a tile to the nav mesh, the nav mesh takes ownership of the data.
+inline dtTileRef addTile(dtNavMesh* nav, int tx, int ty, int cellsPerTile, BlockedFunc blocked = 0,
+						bool wideBvTree = false, bool quantizeVerts = false)
+{
+	int dataSize = 0;
+	unsigned char* data = createTileData(tx, ty, cellsPerTile, blocked, &dataSize, wideBvTree, quantizeVerts);
+	if (!data)
+		return 0;
+	// The nav mesh frees the data with its own allocator.
+	dtAllocator* allocator = nav->getAllocator();
+	if (allocator != dtGetDefaultAllocator())
+	{
+		unsigned char* copy = (unsigned char*)allocator->alloc(dataSize, DT_ALLOC_PERM);
+		if (copy)
+			memcpy(copy, data, dataSize);
+		dtFree(data);
+		data = copy;
+		if (!data)
+			return 0;
+	}
+	dtTileRef ref = 0;
+	if (dtStatusFailed(nav->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, &ref)))
+	{
+		allocator->free(data);
+		return 0;
+	}
+	return ref;
+}
+
+// Creates a nav mesh with all tiles of the grid added.
+inline dtNavMesh* createGrid(int tilesX, int tilesY, int cellsPerTile, BlockedFunc blocked = 0,
+							 bool wideBvTree = false, bool quantizeVerts = false, dtAllocator* allocator = 0)
+{
+	dtNavMesh* nav = createNavMesh(tilesX, tilesY, cellsPerTile, 0, allocator);
+	if (!nav)
+		return 0;
+	for (int y = 0; y < tilesY; ++y)
+		for (int x = 0; x < tilesX; ++x)
+			addTile(nav, x, y, cellsPerTile, blocked, wideBvTree, quantizeVerts);
+	return nav;
+}
+
+// Creates a 2x1 grid of 4x4 cell tiles, the left tile is added from the data with the tile flags.
+inline dtNavMesh* createOffMeshGrid(unsigned char* leftData, int leftDataSize, int leftTileFlags)
+{
+	dtNavMeshParams params;
+	memset(&params, 0, sizeof(params));
+	params.tileWidth = 4 * CELL_SIZE;
+	params.tileHeight = 4 * CELL_SIZE;
+	params.maxTiles = 2;
+	params.maxPolys = 32;
+	dtNavMesh* nav = dtAllocNavMesh();
+	if (!nav || dtStatusFailed(nav->init(&params)))
+	{
+		dtFreeNavMesh(nav);
+		return 0;
+	}
+	nav->addTile(leftData, leftDataSize, leftTileFlags, 0, 0);
+	addTile(nav, 1, 0, 4);
+	return nav;
+}
+
+// Runs the jobs on a set of threads, handing out job indices in arbitrary order.
+struct ThreadDispatcher : public dtJobDispatcher
+{
+	int workers;
+	explicit ThreadDispatcher(int n) : workers(n) {}
+
+	int getWorkerCount() const override { return workers; }
+
+	void dispatch(dtJobFunc func, void* userData, const int jobCount) override
+	{
+		std::atomic<int> next(0);
+		std::vector<std::thread> threads;
+		for (int w = 0; w < workers; ++w)
+		{
+			threads.emplace_back([&, w]() {
+				for (int i = next++; i < jobCount; i = next++)
+					func(userData, jobCount - 1 - i, w);
+			});
+		}
+		for (std::thread& t : threads)
+			t.join();
+	}
+};
+} // namespace TestNavMesh
+
+#endif // TESTNAVMESHUTILS_H
@@ -1,6 +1,10 @@
+#include <math.h>
+#include <string.h>
+
 #include "catch2/catch_all.hpp"
 
 #include "DetourCommon.h"
+#include "DetourNode.h"
 
 TEST_CASE("dtRandomPointInConvexPoly")
 {
@@ -31,3 +35,180 @@ TEST_CASE("dtRandomPointInConvexPoly")
 		REQUIRE(out[2] == Catch::Approx(0));
 	}
 }
+
+namespace
+{
+unsigned int s_seed = 12345;
+float randomFloat()
+{
+	s_seed = s_seed * 1103515245u + 12345u;
+	return ((s_seed >> 8) & 0xffff) / 65535.0f;
+}
+
+// A convex polygon around a random center. Every other polygon has its vertices on a coarse grid,
+// which gives axis-aligned and degenerate edges.
+int randomPoly(float* verts, const int maxVerts)
+{
+	const bool snapped = randomFloat() < 0.5f;
+	const int nverts = 3 + (int)(randomFloat() * (maxVerts - 2)) % (maxVerts - 2);
+	const float cx = randomFloat() * 10.0f, cz = randomFloat() * 10.0f;
+	const float r = 0.5f + randomFloat() * 3.0f;
+	const float a0 = randomFloat() * 6.28f;
+	for (int i = 0; i < nverts; ++i)
+	{
+		const float a = a0 - i * 6.28f / nverts;
+		verts[i * 3 + 0] = cx + cosf(a) * r;
+		verts[i * 3 + 1] = randomFloat();
+		verts[i * 3 + 2] = cz + sinf(a) * r;
+		if (snapped)
+		{
+			verts[i * 3 + 0] = floorf(verts[i * 3 + 0]);
+			verts[i * 3 + 2] = floorf(verts[i * 3 + 2]);
+		}
+	}
+	return nverts;
+}
+
+void randomPoint(float* pt, const float* poly)
+{
+	pt[0] = poly[0] + randomFloat() * 8.0f - 4.0f;
+	pt[1] = 0.0f;
+	pt[2] = poly[2] + randomFloat() * 8.0f - 4.0f;
+	if (randomFloat() < 0.1f)
+	{
+		pt[0] = poly[0];
+		pt[2] = poly[2];
+	}
+}
+} // anonymous namespace
+
+TEST_CASE("DetourCommon SIMD polygon tests", "[detour]")
+{
+	if (!dtGetSimdGeometry())
+	{
+		SKIP("The SIMD polygon tests are not available.");
+	}
+
+	const int maxVerts = 8;
+	float polya[maxVerts * 3], polyb[maxVerts * 3];
+	float pt[3], end[3];
+	for (int iter = 0; iter < 5000; ++iter)
+	{
+		const int na = randomPoly(polya, maxVerts);
+		const int nb = randomPoly(polyb, maxVerts);
+		randomPoint(pt, polya);
+		randomPoint(end, polya);
+
+		bool inside[2], edgesInside[2], hit[2], overlap[2];
+		float ed[2][maxVerts], et[2][maxVerts];
+		float tmin[2], tmax[2];
+		int segMin[2], segMax[2];
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			REQUIRE(dtSetSimdGeometry(pass == 0));
+			inside[pass] = dtPointInPolygon(pt, polya, na);
+			edgesInside[pass] = dtDistancePtPolyEdgesSqr(pt, polya, na, ed[pass], et[pass]);
+			hit[pass] = dtIntersectSegmentPoly2D(pt, end, polya, na, tmin[pass], tmax[pass], segMin[pass], segMax[pass]);
+			overlap[pass] = dtOverlapPolyPoly2D(polya, na, polyb, nb);
+		}
+		REQUIRE(dtSetSimdGeometry(true));
+
+		REQUIRE(inside[0] == inside[1]);
+		REQUIRE(edgesInside[0] == edgesInside[1]);
+		REQUIRE(edgesInside[0] == inside[0]);
+		REQUIRE(memcmp(ed[0], ed[1], sizeof(float) * na) == 0);
+		REQUIRE(memcmp(et[0], et[1], sizeof(float) * na) == 0);
+		REQUIRE(hit[0] == hit[1]);
+		REQUIRE(overlap[0] == overlap[1]);
+		if (hit[0])
+		{
+			REQUIRE(tmin[0] == tmin[1]);
+			REQUIRE(tmax[0] == tmax[1]);
+			REQUIRE(segMin[0] == segMin[1]);
+			REQUIRE(segMax[0] == segMax[1]);
+		}
+	}
+}
+
+TEST_CASE("dtNodeQueue", "[detour]")
+{
+	const int count = 300;
+	dtNode nodes[count];
+	dtNodeQueue queue(count);
+	unsigned int seed = 777;
+	for (int i = 0; i < count; ++i)
+	{
+		seed = seed * 1103515245u + 12345u;
+		nodes[i].total = (float)((seed >> 8) % 1000);
+		queue.push(&nodes[i]);
+	}
+
+	SECTION("Pops nodes in increasing order")
+	{
+		float prev = -1.0f;
+		for (int i = 0; i < count; ++i)
+		{
+			REQUIRE(!queue.empty());
+			REQUIRE(queue.top()->total >= prev);
+			prev = queue.pop()->total;
+		}
+		REQUIRE(queue.empty());
+	}
+
+	SECTION("Modify moves a node up")
+	{
+		nodes[count / 2].total = -1.0f;
+		queue.modify(&nodes[count / 2]);
+		REQUIRE(queue.pop() == &nodes[count / 2]);
+		REQUIRE(queue.top()->total >= 0.0f);
+	}
+}
+
+TEST_CASE("dtNodePool", "[detour]")
+{
+	dtNodePool pool(64, 16);
+
+	SECTION("Finds nodes by ref and state")
+	{
+		for (dtPolyRef ref = 1; ref <= 32; ++ref)
+		{
+			REQUIRE(pool.getNode(ref, 0));
+			REQUIRE(pool.getNode(ref, 1));
+		}
+		REQUIRE(pool.getNodeCount() == 64);
+		REQUIRE(!pool.getNode(33, 0));
+		for (dtPolyRef ref = 1; ref <= 32; ++ref)
+		{
+			dtNode* node = pool.findNode(ref, 1);
+			REQUIRE(node);
+			REQUIRE(node->id == ref);
+			REQUIRE(node->state == 1);
+			REQUIRE(pool.getNode(ref, 1) == node);
+			dtNode* nodes[DT_MAX_STATES_PER_NODE];
+			REQUIRE(pool.findNodes(ref, nodes, DT_MAX_STATES_PER_NODE) == 2);
+		}
+
+		// Every node is visited once when iterating over the buckets.
+		int visited = 0;
+		for (int i = 0; i < pool.getHashSize(); ++i)
+			for (dtNodeIndex j = pool.getFirst(i); j != DT_NULL_IDX; j = pool.getNext(j))
+				visited++;
+		REQUIRE(visited == 64);
+	}
+
+	SECTION("Clear forgets the nodes over many generations")
+	{
+		for (int i = 0; i < 600; ++i)
+		{
+			pool.clear();
+			REQUIRE(pool.getNodeCount() == 0);
+			REQUIRE(!pool.findNode((dtPolyRef)(i + 1), 0));
+			REQUIRE(!pool.findNode((dtPolyRef)i, 0));
+			REQUIRE(pool.getNode((dtPolyRef)(i + 1), 0));
+			REQUIRE(pool.findNode((dtPolyRef)(i + 1), 0));
+		}
+		pool.clear();
+		for (int i = 0; i < pool.getHashSize(); ++i)
+			REQUIRE(pool.getFirst(i) == DT_NULL_IDX);
+	}
+}
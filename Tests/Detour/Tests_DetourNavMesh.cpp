@@ -0,0 +1,3163 @@
+#include <algorithm>
+#include <float.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNavMeshFile.h"
+#include "DetourFindPath.h"
+#include "Recast.h"
+
+#include "TestNavMeshUtils.h"
+
+TEST_CASE("dtNavMesh deferred tile release", "[detour]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(2, 1, 4);
+	REQUIRE(nav);
+	nav->setDeferredTileRelease(true);
+
+	const dtMeshTile* left = nav->getTileAt(0, 0, 0);
+	const dtMeshTile* right = nav->getTileAt(1, 0, 0);
+	REQUIRE(left);
+	REQUIRE(right);
+
+	const dtPolyRef oldRef = nav->getPolyRefBase(right);
+	REQUIRE(nav->isValidPolyRef(oldRef));
+
+	const unsigned int epoch = nav->getEpoch();
+	REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRef(right), 0, 0)));
+	REQUIRE(nav->getEpoch() == epoch + 1);
+
+	SECTION("Retired tile stays readable but unreachable")
+	{
+		REQUIRE(right->header);
+		REQUIRE(right->polys);
+		REQUIRE((right->flags & DT_TILE_RETIRED) != 0);
+		REQUIRE(!nav->isValidPolyRef(oldRef));
+		REQUIRE(!nav->getTileByRef(nav->getTileRef(right)));
+		REQUIRE(!nav->getTileAt(1, 0, 0));
+
+		// The links of the left tile pointing to the removed tile are retired too.
+		REQUIRE(nav->getRetiredCount() > 1);
+		for (int i = 0; i < left->header->polyCount; ++i)
+			for (unsigned int j = left->polys[i].firstLink; j != DT_NULL_LINK; j = left->links[j].next)
+				REQUIRE(nav->decodePolyIdTile(left->links[j].ref) == nav->decodePolyIdTile(nav->getPolyRefBase(left)));
+	}
+
+	SECTION("Retired items are released once readers have moved on")
+	{
+		REQUIRE(nav->releaseRetiredTiles(epoch) == 0);
+		REQUIRE(right->header);
+
+		REQUIRE(nav->releaseRetiredTiles(nav->getEpoch()) == 1);
+		REQUIRE(nav->getRetiredCount() == 0);
+		REQUIRE(!right->header);
+
+		// The slot can be reused and the tiles connect again.
+		REQUIRE(TestNavMesh::addTile(nav, 1, 0, 4));
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(query->init(nav, 256)));
+		dtQueryFilter filter;
+		const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+		const float startPos[3] = { 0.5f, 0.0f, 0.5f };
+		const float endPos[3] = { 7.5f, 0.0f, 3.5f };
+		dtPolyRef startRef = 0, endRef = 0;
+		float nearest[3];
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, nearest)));
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &endRef, nearest)));
+		dtPolyRef path[64];
+		int pathCount = 0;
+		const dtStatus status = query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, 64);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(path[pathCount - 1] == endRef);
+		dtFreeNavMeshQuery(query);
+	}
+
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtNavMesh queries concurrent with tile updates", "[detour]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(2, 1, 4);
+	REQUIRE(nav);
+	nav->setDeferredTileRelease(true);
+
+	// The epoch observed by the running query, or -1 between queries.
+	std::atomic<long long> readerEpoch(-1);
+	std::atomic<bool> done(false);
+	std::atomic<int> queries(0);
+	std::atomic<int> failures(0);
+
+	std::thread reader([&]() {
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		if (!query || dtStatusFailed(query->init(nav, 256)))
+		{
+			failures++;
+			done = true;
+		}
+		dtQueryFilter filter;
+		const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+		const float startPos[3] = { 0.5f, 0.0f, 0.5f };
+		const float endPos[3] = { 7.5f, 0.0f, 3.5f };
+		while (!done)
+		{
+			// Announce the epoch, then make sure it was not advanced before the announcement was seen.
+			unsigned int epoch = nav->getEpoch();
+			readerEpoch = epoch;
+			while (nav->getEpoch() != epoch)
+			{
+				epoch = nav->getEpoch();
+				readerEpoch = epoch;
+			}
+
+			dtPolyRef startRef = 0;
+			float nearest[3];
+			if (dtStatusFailed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, nearest)) || !startRef)
+				failures++;
+			dtPolyRef path[64];
+			int pathCount = 0;
+			// The right tile may be there or not, the search must end either way.
+			const dtMeshTile* right = nav->getTileAt(1, 0, 0);
+			const dtPolyRef endRef = right ? nav->getPolyRefBase(right) + 15 : startRef;
+			if (dtStatusFailed(query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, 64)) &&
+				nav->isValidPolyRef(endRef))
+				failures++;
+			readerEpoch = -1;
+			queries++;
+		}
+		dtFreeNavMeshQuery(query);
+	});
+
+	for (int i = 0; i < 200 && !done; ++i)
+	{
+		const dtMeshTile* right = nav->getTileAt(1, 0, 0);
+		if (right)
+			nav->removeTile(nav->getTileRef(right), 0, 0);
+		else
+			TestNavMesh::addTile(nav, 1, 0, 4);
+		const long long oldest = readerEpoch;
+		nav->releaseRetiredTiles(oldest < 0 ? nav->getEpoch() : (unsigned int)oldest);
+		if ((i % 16) == 0)
+			std::this_thread::yield();
+	}
+	while (queries == 0 && failures == 0)
+		std::this_thread::yield();
+	done = true;
+	reader.join();
+
+	REQUIRE(failures == 0);
+	REQUIRE(queries > 0);
+
+	// Everything retired is released once the reader is gone.
+	nav->releaseRetiredTiles(nav->getEpoch());
+	REQUIRE(nav->getRetiredCount() == 0);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtNavMesh generation", "[detour]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(2, 1, 4);
+	REQUIRE(nav);
+	const dtMeshTile* left = nav->getTileAt(0, 0, 0);
+	const dtMeshTile* right = nav->getTileAt(1, 0, 0);
+	REQUIRE(left);
+	REQUIRE(right);
+	const dtPolyRef leftRef = nav->getPolyRefBase(left);
+	const dtPolyRef rightRef = nav->getPolyRefBase(right);
+
+	// Each added tile advanced the generation.
+	REQUIRE(nav->getGeneration() == 2);
+	REQUIRE(nav->getTileGeneration(leftRef) == 1);
+	REQUIRE(nav->getTileGeneration(rightRef) == 2);
+
+	SECTION("Polygon state changes update the tile")
+	{
+		unsigned short flags = 0;
+		REQUIRE(dtStatusSucceed(nav->getPolyFlags(leftRef, &flags)));
+		REQUIRE(dtStatusSucceed(nav->setPolyFlags(leftRef, flags)));
+		REQUIRE(nav->getGeneration() == 2);
+
+		REQUIRE(dtStatusSucceed(nav->setPolyFlags(leftRef, 0)));
+		REQUIRE(nav->getGeneration() == 3);
+		REQUIRE(nav->getTileGeneration(leftRef) == 3);
+		REQUIRE(nav->getTileGeneration(rightRef) == 2);
+
+		REQUIRE(dtStatusSucceed(nav->setPolyArea(rightRef, 5)));
+		REQUIRE(nav->getGeneration() == 4);
+		REQUIRE(nav->getTileGeneration(rightRef) == 4);
+	}
+
+	SECTION("Removed tiles keep the generation for stale references")
+	{
+		REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRef(right), 0, 0)));
+		REQUIRE(!nav->isValidPolyRef(rightRef));
+		REQUIRE(nav->getGeneration() == 3);
+		REQUIRE(nav->getTileGeneration(rightRef) == 3);
+		REQUIRE(nav->getTileGeneration(leftRef) == 1);
+	}
+
+	SECTION("Changes are reported to the listener")
+	{
+		struct Listener : public dtNavMeshChangeListener
+		{
+			std::vector<dtNavMeshChange> changes;
+			void navMeshChanged(const dtNavMesh*, const dtNavMeshChange& change) override
+			{
+				changes.push_back(change);
+			}
+		};
+		Listener listener;
+		nav->setChangeListener(&listener);
+		REQUIRE(nav->getChangeListener() == &listener);
+
+		unsigned short flags = 0;
+		REQUIRE(dtStatusSucceed(nav->getPolyFlags(leftRef, &flags)));
+		REQUIRE(dtStatusSucceed(nav->setPolyFlags(leftRef, flags)));
+		REQUIRE(listener.changes.empty());
+
+		REQUIRE(dtStatusSucceed(nav->setPolyFlags(leftRef, 0)));
+		REQUIRE(dtStatusSucceed(nav->setPolyArea(rightRef + 1, 5)));
+		const int stateSize = nav->getTileStateSize(left);
+		std::vector<unsigned char> state(stateSize);
+		REQUIRE(dtStatusSucceed(nav->storeTileState(left, &state[0], stateSize)));
+		REQUIRE(dtStatusSucceed(nav->restoreTileState(const_cast<dtMeshTile*>(left), &state[0], stateSize)));
+
+		const dtTileRef rightTileRef = nav->getTileRef(right);
+		unsigned char* data = 0;
+		int dataSize = 0;
+		REQUIRE(dtStatusSucceed(nav->removeTile(rightTileRef, &data, &dataSize)));
+		REQUIRE(listener.changes.size() == 4);
+
+		// Adding a tile reports its new reference.
+		const dtTileRef addedRef = TestNavMesh::addTile(nav, 1, 0, 4);
+		REQUIRE(addedRef != 0);
+		REQUIRE(listener.changes.size() == 5);
+
+		const dtNavMeshChange* c = &listener.changes[0];
+		REQUIRE(c[0].type == DT_CHANGE_POLY_FLAGS);
+		REQUIRE(c[0].polyRef == leftRef);
+		REQUIRE(c[0].tileRef == nav->getTileRef(left));
+		REQUIRE(c[0].generation == 3);
+		REQUIRE(c[1].type == DT_CHANGE_POLY_AREA);
+		REQUIRE(c[1].polyRef == rightRef + 1);
+		REQUIRE(c[1].tileX == 1);
+		REQUIRE(c[2].type == DT_CHANGE_TILE_STATE);
+		REQUIRE(c[2].polyRef == 0);
+		REQUIRE(c[2].tileX == 0);
+		REQUIRE(c[3].type == DT_CHANGE_TILE_REMOVED);
+		REQUIRE(c[3].tileRef == rightTileRef);
+		REQUIRE(c[3].tileX == 1);
+		REQUIRE(c[3].tileY == 0);
+		REQUIRE(c[4].type == DT_CHANGE_TILE_ADDED);
+		REQUIRE(c[4].tileRef == addedRef);
+		REQUIRE(c[4].generation == nav->getGeneration());
+		for (size_t i = 0; i < listener.changes.size(); ++i)
+			REQUIRE(listener.changes[i].generation == 3 + i);
+
+		nav->setChangeListener(0);
+		REQUIRE(dtStatusSucceed(nav->setPolyFlags(leftRef, 1)));
+		REQUIRE(listener.changes.size() == 5);
+	}
+
+	dtFreeNavMesh(nav);
+}
+
+namespace
+{
+// Returns the reference the polygon links to through the specified edge, or zero.
+dtPolyRef getLinkRef(const dtMeshTile* tile, int polyIndex, unsigned char edge)
+{
+	for (unsigned int i = tile->polys[polyIndex].firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+	{
+		if (tile->links[i].edge == edge)
+			return tile->links[i].ref;
+	}
+	return 0;
+}
+} // anonymous namespace
+
+TEST_CASE("Off-mesh connections resolved at build time", "[detour]")
+{
+	// The tile polygons are at y = -1.
+	const float conVerts[] =
+	{
+		0.5f, -1, 0.5f,	2.5f, -1, 2.5f,		// Inside the tile.
+		3.5f, -1, 1.5f,	5.5f, -1, 1.5f,		// To the x+ neighbour.
+		1.5f, -1, 3.5f,	1.5f, -1, 10.5f,		// To a missing z+ neighbour.
+		2.5f, -1, 0.5f,	2.5f, -1, 3.5f,		// Inside the tile.
+	};
+	int dataSize = 0;
+	unsigned char* data = TestNavMesh::createTileData(0, 0, 4, 0, &dataSize, false, false, conVerts, 4);
+	REQUIRE(data);
+	const dtMeshHeader* header = (const dtMeshHeader*)data;
+	REQUIRE(header->offMeshConCount == 4);
+
+	// The connections are grouped by the side of their end point.
+	const int sideBase[DT_OFFMESH_SIDE_GROUPS] = { 0, 1, 1, 2, 2, 2, 2, 2, 2 };
+	for (int i = 0; i < DT_OFFMESH_SIDE_GROUPS; ++i)
+		REQUIRE(header->offMeshSideBase[i] == sideBase[i]);
+
+	dtNavMesh* nav = TestNavMesh::createOffMeshGrid(data, dataSize, 0);
+	REQUIRE(nav);
+	const dtMeshTile* tile = nav->getTileAt(0, 0, 0);
+	REQUIRE(tile);
+	const dtMeshTile* right = nav->getTileAt(1, 0, 0);
+	REQUIRE(tile);
+	REQUIRE(right);
+
+	const unsigned int userIds[] = { 1, 2, 0, 3 };
+	const unsigned short startPolys[] = { 7, 13, 0, 2 };
+	const unsigned short endPolys[] = { DT_OFFMESH_CON_NO_POLY, DT_OFFMESH_CON_NO_POLY, 10, 14 };
+	for (int i = 0; i < 4; ++i)
+	{
+		const dtOffMeshConnection& con = tile->offMeshCons[i];
+		REQUIRE(con.userId == userIds[i]);
+		REQUIRE((con.flags & DT_OFFMESH_CON_RESOLVED) != 0);
+		REQUIRE(con.startPoly == startPolys[i]);
+		REQUIRE(con.endPoly == endPolys[i]);
+	}
+
+	// The connection to the neighbour is still connected when the neighbour is added.
+	const dtPolyRef base = nav->getPolyRefBase(tile);
+	const int offMeshPoly = tile->offMeshCons[0].poly;
+	REQUIRE(getLinkRef(tile, offMeshPoly, 0) == (base | 7));
+	REQUIRE(getLinkRef(tile, offMeshPoly, 1) == (nav->getPolyRefBase(right) | 5));
+	REQUIRE(getLinkRef(right, 5, 0xff) == (base | (dtPolyRef)offMeshPoly));
+	REQUIRE(getLinkRef(tile, tile->offMeshCons[1].poly, 1) == 0);
+
+	SECTION("Unresolved connections are searched for when the tile is added")
+	{
+		std::vector<unsigned char> copy(data, data + dataSize);
+		dtOffMeshConnection* cons = (dtOffMeshConnection*)(&copy[0] + ((const unsigned char*)tile->offMeshCons - data));
+		for (int i = 0; i < 4; ++i)
+			cons[i].flags &= ~DT_OFFMESH_CON_RESOLVED;
+
+		dtNavMesh* search = TestNavMesh::createOffMeshGrid(&copy[0], dataSize, 0);
+		REQUIRE(search);
+		const dtMeshTile* searched = search->getTileAt(0, 0, 0);
+		REQUIRE(searched);
+		REQUIRE(search->getPolyRefBase(searched) == base);
+		for (int i = 0; i < header->polyCount; ++i)
+		{
+			REQUIRE(getLinkRef(searched, i, 0) == getLinkRef(tile, i, 0));
+			REQUIRE(getLinkRef(searched, i, 1) == getLinkRef(tile, i, 1));
+			REQUIRE(getLinkRef(searched, i, 0xff) == getLinkRef(tile, i, 0xff));
+		}
+		dtFreeNavMesh(search);
+	}
+
+	dtFreeNavMesh(nav);
+	dtFree(data);
+}
+
+TEST_CASE("Portal edges", "[detour]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(2, 1, 4);
+	REQUIRE(nav);
+	const dtMeshTile* left = nav->getTileAt(0, 0, 0);
+	const dtMeshTile* right = nav->getTileAt(1, 0, 0);
+	REQUIRE(left);
+	REQUIRE(right);
+
+	// Each of the four sides has one portal edge per border cell.
+	REQUIRE(left->header->portalEdgeCount == 16);
+	const int sideBase[8] = { 0, 4, 4, 8, 8, 12, 12, 16 };
+	for (int side = 0; side < 8; ++side)
+		REQUIRE(left->header->portalSideBase[side] == sideBase[side]);
+	for (int i = 0; i < left->header->portalEdgeCount; ++i)
+	{
+		const dtPortalEdge& edge = left->portalEdges[i];
+		REQUIRE(left->polys[edge.poly].neis[edge.edge] == (DT_EXT_LINK | edge.side));
+		REQUIRE(edge.bmax == edge.bmin + 1.0f);
+		if (i > 0 && left->portalEdges[i-1].side == edge.side)
+			REQUIRE(left->portalEdges[i-1].bmin < edge.bmin);
+	}
+
+	// The border cells are stitched to the cell next to them.
+	const dtPolyRef rightBase = nav->getPolyRefBase(right);
+	for (int z = 0; z < 4; ++z)
+	{
+		const dtPoly* poly = &left->polys[3 + z * 4];
+		int links = 0;
+		for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = left->links[i].next)
+		{
+			const dtLink& link = left->links[i];
+			if (link.side != 0)
+				continue;
+			REQUIRE(link.ref == (rightBase | (dtPolyRef)(z * 4)));
+			REQUIRE(link.bmin == 0);
+			REQUIRE(link.bmax == 255);
+			links++;
+		}
+		REQUIRE(links == 1);
+	}
+
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtNavMesh link overflow", "[detour]")
+{
+	// Bidirectional connections from the left tile all land in the right tile,
+	// which was built without knowing about them.
+	static const int CON_COUNT = 40;
+	std::vector<float> conVerts;
+	for (int i = 0; i < CON_COUNT; ++i)
+	{
+		const float x = 0.5f + (float)(i % 4);
+		const float z = 0.5f + (float)((i / 4) % 4);
+		const float verts[6] = { x, -1, z, x + 4, -1, z };
+		conVerts.insert(conVerts.end(), verts, verts + 6);
+	}
+	int dataSize = 0;
+	unsigned char* data = TestNavMesh::createTileData(0, 0, 4, 0, &dataSize, false, false, &conVerts[0], CON_COUNT);
+	REQUIRE(data);
+
+	dtNavMeshParams params;
+	memset(&params, 0, sizeof(params));
+	params.tileWidth = 4 * TestNavMesh::CELL_SIZE;
+	params.tileHeight = 4 * TestNavMesh::CELL_SIZE;
+	params.maxTiles = 2;
+	params.maxPolys = 64;
+	dtNavMesh* nav = dtAllocNavMesh();
+	REQUIRE(nav);
+	REQUIRE(dtStatusSucceed(nav->init(&params, DT_NAVMESH_PORTAL_CACHE)));
+	const bool deferred = GENERATE(false, true);
+	nav->setDeferredTileRelease(deferred);
+
+	REQUIRE(dtStatusSucceed(nav->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, 0)));
+	const dtMeshTile* left = nav->getTileAt(0, 0, 0);
+	REQUIRE(left);
+	REQUIRE(left->linkCapacity == left->header->maxLinkCount);
+
+	dtNavMeshLinkStats stats;
+	nav->getLinkStats(&stats);
+	REQUIRE(stats.overflowTileCount == 0);
+	REQUIRE(stats.linkCount == left->linkCount);
+
+	REQUIRE(TestNavMesh::addTile(nav, 1, 0, 4));
+	const dtMeshTile* right = nav->getTileAt(1, 0, 0);
+	REQUIRE(right);
+	REQUIRE(right->linkCapacity > right->header->maxLinkCount);
+	REQUIRE(right->linkCount > right->header->maxLinkCount);
+
+	// Every connection is linked back from the polygon it lands on.
+	int backLinks = 0;
+	for (int i = 0; i < right->header->polyCount; ++i)
+	{
+		for (unsigned int j = right->polys[i].firstLink; j != DT_NULL_LINK; j = right->links[j].next)
+		{
+			if (right->links[j].edge == 0xff)
+				backLinks++;
+		}
+	}
+	REQUIRE(backLinks == CON_COUNT);
+
+	nav->getLinkStats(&stats);
+	REQUIRE(stats.overflowTileCount == 1);
+	REQUIRE(stats.overflowCount >= 1);
+	REQUIRE(stats.lostLinkCount == 0);
+	REQUIRE(stats.linkCount == left->linkCount + right->linkCount);
+	REQUIRE(stats.linkCapacity == left->linkCapacity + right->linkCapacity);
+	REQUIRE(stats.builtLinkCapacity == left->header->maxLinkCount + right->header->maxLinkCount);
+
+	// The portal cache followed the links.
+	float left0[3], right0[3];
+	const dtPolyRef rightRef = nav->getPolyRefBase(right);
+	const dtPolyRef leftRef = nav->getPolyRefBase(left) | 3;
+	int portals = 0;
+	for (unsigned int j = right->polys[0].firstLink; j != DT_NULL_LINK; j = right->links[j].next)
+	{
+		if (right->links[j].ref == leftRef)
+		{
+			dtVcopy(left0, &right->linkPortals[j*6]);
+			dtVcopy(right0, &right->linkPortals[j*6+3]);
+			REQUIRE(left0[0] == 4.0f);
+			REQUIRE(right0[0] == 4.0f);
+			portals++;
+		}
+	}
+	REQUIRE(portals == 1);
+
+	// Old link arrays are retired like removed tiles.
+	if (deferred)
+	{
+		REQUIRE(nav->getRetiredCount() > 0);
+		nav->releaseRetiredTiles(nav->getEpoch() + 1);
+		REQUIRE(nav->getRetiredCount() == 0);
+	}
+	else
+	{
+		REQUIRE(nav->getRetiredCount() == 0);
+	}
+	REQUIRE(nav->isValidPolyRef(rightRef));
+
+	// The grown links and the links left in the tile data are both counted.
+	dtNavMeshMemStats memStats;
+	nav->getTileMemStats(right, &memStats);
+	REQUIRE(memStats.links == sizeof(dtLink) * (right->header->maxLinkCount + right->linkCapacity));
+	REQUIRE(memStats.unusedLinks == sizeof(dtLink) * (right->header->maxLinkCount + right->linkCapacity - right->linkCount));
+	REQUIRE(memStats.linkPortals == sizeof(float) * 6 * right->linkCapacity);
+	REQUIRE(memStats.total == (size_t)right->dataSize + memStats.links + memStats.linkPortals -
+			sizeof(dtLink) * right->header->maxLinkCount);
+
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtNavMesh link overflow of a removed tile", "[detour]")
+{
+	static const int CON_COUNT = 40;
+	std::vector<float> conVerts;
+	for (int i = 0; i < CON_COUNT; ++i)
+	{
+		const float x = 0.5f + (float)(i % 4);
+		const float z = 0.5f + (float)((i / 4) % 4);
+		const float verts[6] = { x, -1, z, x + 4, -1, z };
+		conVerts.insert(conVerts.end(), verts, verts + 6);
+	}
+
+	TestNavMesh::CountingAllocator allocator;
+	dtNavMeshParams params;
+	memset(&params, 0, sizeof(params));
+	params.tileWidth = 4 * TestNavMesh::CELL_SIZE;
+	params.tileHeight = 4 * TestNavMesh::CELL_SIZE;
+	params.maxTiles = 2;
+	params.maxPolys = 64;
+	dtNavMesh* nav = dtAllocNavMesh();
+	REQUIRE(nav);
+	REQUIRE(dtStatusSucceed(nav->init(&params, DT_NAVMESH_PORTAL_CACHE, &allocator)));
+	nav->setDeferredTileRelease(true);
+
+	int dataSize = 0;
+	unsigned char* data = TestNavMesh::createTileData(0, 0, 4, 0, &dataSize, false, false, &conVerts[0], CON_COUNT);
+	REQUIRE(data);
+	unsigned char* copy = (unsigned char*)allocator.alloc(dataSize, DT_ALLOC_PERM);
+	REQUIRE(copy);
+	memcpy(copy, data, dataSize);
+	dtFree(data);
+	dtTileRef leftRef = 0;
+	REQUIRE(dtStatusSucceed(nav->addTile(copy, dataSize, DT_TILE_FREE_DATA, 0, &leftRef)));
+
+	// The links of the right tile grow, retiring its old link arrays.
+	const dtTileRef rightRef = TestNavMesh::addTile(nav, 1, 0, 4);
+	REQUIRE(rightRef);
+	const dtMeshTile* right = nav->getTileByRef(rightRef);
+	REQUIRE(right->linkCapacity > right->header->maxLinkCount);
+	REQUIRE(nav->getRetiredCount() > 0);
+
+	// Removing the tile keeps the retired link arrays until their epoch has passed.
+	REQUIRE(dtStatusSucceed(nav->removeTile(rightRef, 0, 0)));
+	REQUIRE(dtStatusSucceed(nav->removeTile(leftRef, 0, 0)));
+	nav->releaseRetiredTiles(nav->getEpoch() + 1);
+	REQUIRE(nav->getRetiredCount() == 0);
+
+	dtFreeNavMesh(nav);
+	REQUIRE(allocator.live == 0);
+	REQUIRE(allocator.foreign == 0);
+}
+
+TEST_CASE("dtNavMesh::getMemStats", "[detour]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(2, 2, 4);
+	REQUIRE(nav);
+
+	// The sections of the tile data add up to the tile data.
+	dtNavMeshMemStats tileSum;
+	memset(&tileSum, 0, sizeof(tileSum));
+	size_t dataSize = 0;
+	for (int i = 0; i < nav->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = static_cast<const dtNavMesh*>(nav)->getTile(i);
+		if (!tile->header)
+			continue;
+		dtNavMeshMemStats stats;
+		nav->getTileMemStats(tile, &stats);
+		REQUIRE(stats.tileCount == 1);
+		REQUIRE(stats.tiles == 0);
+		REQUIRE(stats.other == 0);
+		REQUIRE(stats.total == (size_t)tile->dataSize);
+		REQUIRE(stats.headers > 0);
+		REQUIRE(stats.polys == sizeof(dtPoly) * tile->header->polyCount);
+		REQUIRE(stats.unusedLinks == sizeof(dtLink) * (tile->header->maxLinkCount - tile->linkCount));
+		tileSum.total += stats.total;
+		dataSize += (size_t)tile->dataSize;
+	}
+
+	dtNavMeshMemStats stats;
+	nav->getMemStats(&stats);
+	REQUIRE(stats.tileCount == 4);
+	REQUIRE(stats.tiles > sizeof(dtNavMesh));
+	REQUIRE(stats.total == stats.tiles + tileSum.total);
+	REQUIRE(stats.total == stats.tiles + stats.headers + stats.polys + stats.verts + stats.links + stats.linkPortals +
+			stats.detail + stats.bvTree + stats.offMeshCons + stats.portalEdges + stats.edgeClearance +
+			stats.wallDistance + stats.other);
+	REQUIRE(stats.total - stats.tiles == dataSize);
+
+	SECTION("Queries")
+	{
+		TestNavMesh::CountingAllocator allocator;
+		dtNavMeshQuery* query = dtAllocObject<dtNavMeshQuery>(&allocator);
+		REQUIRE(query);
+		REQUIRE(dtStatusSucceed(query->init(nav, 512, 0, &allocator)));
+		dtNavMeshQueryMemStats queryStats;
+		query->getMemStats(&queryStats);
+		REQUIRE(queryStats.query == sizeof(dtNavMeshQuery));
+		REQUIRE(queryStats.backSearch == 0);
+		REQUIRE(queryStats.total == queryStats.query + queryStats.nodePool + queryStats.tinyNodePool +
+				queryStats.openList + queryStats.backSearch);
+		REQUIRE(queryStats.total == query->getMemUsed());
+		REQUIRE(queryStats.total == allocator.liveBytes);
+
+		REQUIRE(dtStatusSucceed(query->init(nav, 2048, 2048, &allocator)));
+		dtNavMeshQueryMemStats largerStats;
+		query->getMemStats(&largerStats);
+		REQUIRE(largerStats.nodePool > queryStats.nodePool);
+		REQUIRE(largerStats.backSearch > 0);
+		REQUIRE(largerStats.total == allocator.liveBytes);
+		dtFreeObject(&allocator, query);
+	}
+
+	dtFreeNavMesh(nav);
+}
+
+namespace
+{
+bool isCheckerBlocked(int cellX, int cellZ)
+{
+	return ((cellX / 3) + (cellZ / 2)) % 4 == 0;
+}
+} // anonymous namespace
+
+TEST_CASE("dtNavMeshQuery::findNearestPolys", "[detour]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(3, 3, 8, isCheckerBlocked);
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 256)));
+	dtQueryFilter filter;
+
+	// Points inside, on and outside the mesh, with varying search extents.
+	const int count = 500;
+	std::vector<float> centers(count * 3);
+	std::vector<float> halfExtents(count * 3);
+	unsigned int seed = 12345;
+	for (int i = 0; i < count; ++i)
+	{
+		seed = seed * 1103515245u + 12345u;
+		centers[i * 3 + 0] = ((seed >> 8) % 2800) / 100.0f - 2.0f;
+		seed = seed * 1103515245u + 12345u;
+		centers[i * 3 + 1] = ((seed >> 8) % 300) / 100.0f - 1.5f;
+		seed = seed * 1103515245u + 12345u;
+		centers[i * 3 + 2] = ((seed >> 8) % 2800) / 100.0f - 2.0f;
+		halfExtents[i * 3 + 0] = 0.25f + (i % 5) * 0.5f;
+		halfExtents[i * 3 + 1] = 1.0f;
+		halfExtents[i * 3 + 2] = 0.25f + (i % 3) * 1.5f;
+	}
+
+	std::vector<dtPolyRef> refs(count);
+	std::vector<float> points(count * 3, -1.0f);
+	bool overPoly[count];
+	REQUIRE(dtStatusSucceed(query->findNearestPolys(&centers[0], &halfExtents[0], count, &filter, &refs[0], &points[0], overPoly)));
+
+	int found = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		dtPolyRef ref = 0;
+		float pt[3] = { -1.0f, -1.0f, -1.0f };
+		bool over = false;
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(&centers[i * 3], &halfExtents[i * 3], &filter, &ref, pt, &over)));
+		REQUIRE(refs[i] == ref);
+		REQUIRE(points[i * 3 + 0] == pt[0]);
+		REQUIRE(points[i * 3 + 1] == pt[1]);
+		REQUIRE(points[i * 3 + 2] == pt[2]);
+		if (ref)
+		{
+			REQUIRE(overPoly[i] == over);
+			found++;
+		}
+	}
+	REQUIRE(found > 0);
+	REQUIRE(found < count);
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("Wide BV tree", "[detour]")
+{
+	dtNavMesh* binaryNav = TestNavMesh::createGrid(2, 2, 16, isCheckerBlocked);
+	dtNavMesh* wideNav = TestNavMesh::createGrid(2, 2, 16, isCheckerBlocked, true);
+	REQUIRE(binaryNav);
+	REQUIRE(wideNav);
+
+	const dtMeshTile* tile = wideNav->getTileAt(0, 0, 0);
+	REQUIRE(tile->bvWideTree);
+	REQUIRE(tile->header->bvWideNodeCount > 0);
+	REQUIRE(tile->header->bvWideNodeCount < tile->header->polyCount);
+	REQUIRE(!binaryNav->getTileAt(0, 0, 0)->bvWideTree);
+
+	dtNavMeshQuery* binaryQuery = dtAllocNavMeshQuery();
+	dtNavMeshQuery* wideQuery = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(binaryQuery->init(binaryNav, 256)));
+	REQUIRE(dtStatusSucceed(wideQuery->init(wideNav, 256)));
+	dtQueryFilter filter;
+
+	SECTION("Queries return the same polygons in the same order")
+	{
+		unsigned int seed = 4321;
+		for (int i = 0; i < 200; ++i)
+		{
+			float center[3], halfExtents[3];
+			for (int j = 0; j < 3; ++j)
+			{
+				seed = seed * 1103515245u + 12345u;
+				center[j] = ((seed >> 8) % 3600) / 100.0f - 2.0f;
+				seed = seed * 1103515245u + 12345u;
+				halfExtents[j] = ((seed >> 8) % 400) / 100.0f;
+			}
+			center[1] = 0.0f;
+
+			static const int MAX_POLYS = 1024;
+			dtPolyRef binaryPolys[MAX_POLYS], widePolys[MAX_POLYS];
+			int binaryCount = 0, wideCount = 0;
+			REQUIRE(dtStatusSucceed(binaryQuery->queryPolygons(center, halfExtents, &filter, binaryPolys, &binaryCount, MAX_POLYS)));
+			REQUIRE(dtStatusSucceed(wideQuery->queryPolygons(center, halfExtents, &filter, widePolys, &wideCount, MAX_POLYS)));
+			REQUIRE(binaryCount == wideCount);
+			for (int j = 0; j < binaryCount; ++j)
+				REQUIRE(binaryPolys[j] == widePolys[j]);
+
+			dtPolyRef binaryRef = 0, wideRef = 0;
+			float binaryPt[3], widePt[3];
+			REQUIRE(dtStatusSucceed(binaryQuery->findNearestPoly(center, halfExtents, &filter, &binaryRef, binaryPt)));
+			REQUIRE(dtStatusSucceed(wideQuery->findNearestPoly(center, halfExtents, &filter, &wideRef, widePt)));
+			REQUIRE(binaryRef == wideRef);
+		}
+	}
+
+	SECTION("Endian swap round trip")
+	{
+		int dataSize = 0;
+		unsigned char* data = TestNavMesh::createTileData(0, 0, 16, isCheckerBlocked, &dataSize, true);
+		REQUIRE(data);
+		std::vector<unsigned char> original(data, data + dataSize);
+		REQUIRE(dtNavMeshDataSwapEndian(data, dataSize));
+		REQUIRE(dtNavMeshHeaderSwapEndian(data, dataSize));
+		REQUIRE(dtNavMeshHeaderSwapEndian(data, dataSize));
+		REQUIRE(dtNavMeshDataSwapEndian(data, dataSize));
+		REQUIRE(std::vector<unsigned char>(data, data + dataSize) == original);
+		dtFree(data);
+	}
+
+	dtFreeNavMeshQuery(binaryQuery);
+	dtFreeNavMeshQuery(wideQuery);
+	dtFreeNavMesh(binaryNav);
+	dtFreeNavMesh(wideNav);
+}
+
+namespace
+{
+bool isWallBlocked(int cellX, int cellZ)
+{
+	// Walls with alternating gaps force long detours.
+	return (cellX % 6) == 3 && ((cellX / 6) % 2 == 0 ? cellZ < 20 : cellZ > 3);
+}
+
+bool isLinked(const dtNavMesh* nav, dtPolyRef from, dtPolyRef to)
+{
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	nav->getTileAndPolyByRefUnsafe(from, &tile, &poly);
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+		if (tile->links[i].ref == to)
+			return true;
+	return false;
+}
+} // anonymous namespace
+
+TEST_CASE("Bidirectional findPath", "[detour]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(3, 3, 8, isWallBlocked);
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 1024, 1024)));
+	dtQueryFilter filter;
+
+	const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+	const float startPos[3] = { 0.5f, 0.0f, 0.5f };
+	const float endPos[3] = { 23.5f, 0.0f, 0.5f };
+	dtPolyRef startRef = 0, endRef = 0;
+	float nearest[3];
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, nearest)));
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &endRef, nearest)));
+
+	static const int MAX_PATH = 256;
+	dtPolyRef path[MAX_PATH], bidirPath[MAX_PATH];
+	int pathCount = 0, bidirCount = 0;
+	REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, MAX_PATH)));
+	const dtStatus status = query->findPath(startRef, endRef, startPos, endPos, &filter,
+											bidirPath, &bidirCount, MAX_PATH, DT_FINDPATH_BIDIRECTIONAL);
+	REQUIRE(dtStatusSucceed(status));
+	REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+
+	SECTION("Path is connected and as long as the unidirectional path")
+	{
+		REQUIRE(bidirPath[0] == startRef);
+		REQUIRE(bidirPath[bidirCount - 1] == endRef);
+		for (int i = 0; i < bidirCount - 1; ++i)
+			REQUIRE(isLinked(nav, bidirPath[i], bidirPath[i + 1]));
+		REQUIRE(bidirCount == pathCount);
+	}
+
+	SECTION("Sliced search finds the same path")
+	{
+		REQUIRE(dtStatusInProgress(query->initSlicedFindPath(startRef, endRef, startPos, endPos, &filter, DT_FINDPATH_BIDIRECTIONAL)));
+		dtStatus sliced = DT_IN_PROGRESS;
+		while (dtStatusInProgress(sliced))
+			sliced = query->updateSlicedFindPath(7, 0);
+		REQUIRE(dtStatusSucceed(sliced));
+		dtPolyRef slicedPath[MAX_PATH];
+		int slicedCount = 0;
+		REQUIRE(dtStatusSucceed(query->finalizeSlicedFindPath(slicedPath, &slicedCount, MAX_PATH)));
+		REQUIRE(slicedCount == bidirCount);
+		for (int i = 0; i < slicedCount; ++i)
+			REQUIRE(slicedPath[i] == bidirPath[i]);
+	}
+
+	SECTION("Small path buffer")
+	{
+		dtPolyRef shortPath[8];
+		int shortCount = 0;
+		const dtStatus res = query->findPath(startRef, endRef, startPos, endPos, &filter,
+											 shortPath, &shortCount, 8, DT_FINDPATH_BIDIRECTIONAL);
+		REQUIRE(dtStatusDetail(res, DT_BUFFER_TOO_SMALL));
+		REQUIRE(shortCount == 8);
+		for (int i = 0; i < shortCount; ++i)
+			REQUIRE(shortPath[i] == bidirPath[i]);
+	}
+
+	SECTION("Invalid options")
+	{
+		REQUIRE(dtStatusFailed(query->initSlicedFindPath(startRef, endRef, startPos, endPos, &filter,
+														 DT_FINDPATH_BIDIRECTIONAL | DT_FINDPATH_ANY_ANGLE)));
+
+		dtNavMeshQuery* noBack = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(noBack->init(nav, 1024)));
+		REQUIRE(dtStatusDetail(noBack->findPath(startRef, endRef, startPos, endPos, &filter,
+												bidirPath, &bidirCount, MAX_PATH, DT_FINDPATH_BIDIRECTIONAL), DT_INVALID_PARAM));
+		dtFreeNavMeshQuery(noBack);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+// A filter which does not derive from dtQueryFilter and makes a band across the grid costly.
+struct ThreatFilter
+{
+	bool passFilter(const dtPolyRef, const dtMeshTile*, const dtPoly*) const
+	{
+		return true;
+	}
+
+	static bool isThreatened(const float* pos)
+	{
+		return pos[0] > 6.0f && pos[0] < 10.0f && pos[2] < 6.0f;
+	}
+
+	float getCost(const float* pa, const float* pb,
+				  const dtPolyRef, const dtMeshTile*, const dtPoly*,
+				  const dtPolyRef, const dtMeshTile*, const dtPoly*,
+				  const dtPolyRef, const dtMeshTile*, const dtPoly*) const
+	{
+		float mid[3];
+		dtVlerp(mid, pa, pb, 0.5f);
+		return dtVdist(pa, pb) * (isThreatened(mid) ? 100.0f : 1.0f);
+	}
+};
+
+// Forwards to a dtQueryFilter, the paths must be the same as with the filter itself.
+struct ForwardingFilter
+{
+	dtQueryFilter filter;
+
+	bool passFilter(const dtPolyRef ref, const dtMeshTile* tile, const dtPoly* poly) const
+	{
+		return filter.passFilter(ref, tile, poly);
+	}
+
+	float getCost(const float* pa, const float* pb,
+				  const dtPolyRef prevRef, const dtMeshTile* prevTile, const dtPoly* prevPoly,
+				  const dtPolyRef curRef, const dtMeshTile* curTile, const dtPoly* curPoly,
+				  const dtPolyRef nextRef, const dtMeshTile* nextTile, const dtPoly* nextPoly) const
+	{
+		return filter.getCost(pa, pb, prevRef, prevTile, prevPoly, curRef, curTile, curPoly, nextRef, nextTile, nextPoly);
+	}
+};
+
+TEST_CASE("Templated findPath", "[detour]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(2, 2, 8);
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 1024)));
+	dtQueryFilter filter;
+
+	const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+	const float startPos[3] = { 0.5f, 0.0f, 0.5f };
+	const float endPos[3] = { 15.5f, 0.0f, 0.5f };
+	dtPolyRef startRef = 0, endRef = 0;
+	float nearest[3];
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, nearest)));
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &endRef, nearest)));
+
+	static const int MAX_PATH = 256;
+	dtPolyRef path[MAX_PATH], templPath[MAX_PATH];
+	int pathCount = 0, templCount = 0;
+	REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, MAX_PATH)));
+
+	SECTION("Same path as the dtQueryFilter")
+	{
+		ForwardingFilter forwarding;
+		REQUIRE(dtStatusSucceed(query->findPath<ForwardingFilter>(startRef, endRef, startPos, endPos, &forwarding,
+																	templPath, &templCount, MAX_PATH)));
+		REQUIRE(templCount == pathCount);
+		for (int i = 0; i < pathCount; ++i)
+			REQUIRE(templPath[i] == path[i]);
+	}
+
+	SECTION("Custom costs avoid the threatened band")
+	{
+		ThreatFilter threat;
+		REQUIRE(dtStatusSucceed(query->findPath<ThreatFilter>(startRef, endRef, startPos, endPos, &threat,
+																templPath, &templCount, MAX_PATH)));
+		REQUIRE(templPath[0] == startRef);
+		REQUIRE(templPath[templCount - 1] == endRef);
+		REQUIRE(templCount > pathCount);
+		for (int i = 0; i < templCount; ++i)
+		{
+			if (i + 1 < templCount)
+				REQUIRE(isLinked(nav, templPath[i], templPath[i + 1]));
+			const dtMeshTile* tile = 0;
+			const dtPoly* poly = 0;
+			nav->getTileAndPolyByRefUnsafe(templPath[i], &tile, &poly);
+			float center[3] = { 0.0f, 0.0f, 0.0f };
+			for (int j = 0; j < poly->vertCount; ++j)
+			{
+				float v[3];
+				dtGetTileVertex(tile, poly->verts[j], v);
+				dtVmad(center, center, v, 1.0f / poly->vertCount);
+			}
+			REQUIRE(!ThreatFilter::isThreatened(center));
+		}
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("Any-angle findPath", "[detour]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(2, 2, 8);
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 1024)));
+	dtQueryFilter filter;
+
+	const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+	const float startPos[3] = { 0.5f, 0.0f, 0.5f };
+	const float endPos[3] = { 15.5f, 0.0f, 9.5f };
+	dtPolyRef startRef = 0, endRef = 0;
+	float nearest[3];
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, nearest)));
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &endRef, nearest)));
+
+	static const int MAX_PATH = 256;
+	dtPolyRef path[MAX_PATH], anyPath[MAX_PATH];
+	int pathCount = 0, anyCount = 0;
+	REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, MAX_PATH)));
+	const dtStatus status = query->findPath(startRef, endRef, startPos, endPos, &filter,
+											anyPath, &anyCount, MAX_PATH, DT_FINDPATH_ANY_ANGLE);
+	REQUIRE(dtStatusSucceed(status));
+	REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+
+	SECTION("Path is connected and has fewer corners")
+	{
+		REQUIRE(anyPath[0] == startRef);
+		REQUIRE(anyPath[anyCount - 1] == endRef);
+		for (int i = 0; i < anyCount - 1; ++i)
+			REQUIRE(isLinked(nav, anyPath[i], anyPath[i + 1]));
+		REQUIRE(anyCount <= pathCount);
+
+		// The corridor follows the shortcuts instead of zig-zagging between edge midpoints.
+		float straight[MAX_PATH * 3];
+		int straightCount = 0, anyStraightCount = 0;
+		REQUIRE(dtStatusSucceed(query->findStraightPath(startPos, endPos, path, pathCount,
+														straight, 0, 0, &straightCount, MAX_PATH)));
+		REQUIRE(dtStatusSucceed(query->findStraightPath(startPos, endPos, anyPath, anyCount,
+														straight, 0, 0, &anyStraightCount, MAX_PATH)));
+		REQUIRE(anyStraightCount < straightCount);
+	}
+
+	SECTION("Sliced search finds the same path")
+	{
+		REQUIRE(dtStatusInProgress(query->initSlicedFindPath(startRef, endRef, startPos, endPos, &filter, DT_FINDPATH_ANY_ANGLE)));
+		dtStatus sliced = DT_IN_PROGRESS;
+		while (dtStatusInProgress(sliced))
+			sliced = query->updateSlicedFindPath(7, 0);
+		REQUIRE(dtStatusSucceed(sliced));
+		dtPolyRef slicedPath[MAX_PATH];
+		int slicedCount = 0;
+		REQUIRE(dtStatusSucceed(query->finalizeSlicedFindPath(slicedPath, &slicedCount, MAX_PATH)));
+		REQUIRE(slicedCount == anyCount);
+		for (int i = 0; i < slicedCount; ++i)
+			REQUIRE(slicedPath[i] == anyPath[i]);
+	}
+
+	SECTION("Not combined with bidirectional searches")
+	{
+		dtNavMeshQuery* bidir = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(bidir->init(nav, 1024, 1024)));
+		REQUIRE(dtStatusDetail(bidir->findPath(startRef, endRef, startPos, endPos, &filter, anyPath, &anyCount, MAX_PATH,
+											   DT_FINDPATH_ANY_ANGLE | DT_FINDPATH_BIDIRECTIONAL), DT_INVALID_PARAM));
+		dtFreeNavMeshQuery(bidir);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtNavMeshQuery stats", "[detour]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(3, 3, 8, isWallBlocked);
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 1024)));
+	dtQueryFilter filter;
+
+	const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+	const float startPos[3] = { 0.5f, 0.0f, 0.5f };
+	const float endPos[3] = { 23.5f, 0.0f, 0.5f };
+	dtPolyRef startRef = 0, endRef = 0;
+	float nearest[3];
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, nearest)));
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &endRef, nearest)));
+
+	static const int MAX_PATH = 256;
+	dtPolyRef path[MAX_PATH];
+	int pathCount = 0;
+
+	query->resetStats();
+	REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, MAX_PATH)));
+	const dtQueryStats stats = query->getStats();
+
+	// The small node pool runs out of nodes.
+	dtNavMeshQuery* tiny = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(tiny->init(nav, 8)));
+	const dtStatus tinyStatus = tiny->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, MAX_PATH);
+	REQUIRE(dtStatusDetail(tinyStatus, DT_OUT_OF_NODES));
+
+	float t = 0, hitNormal[3];
+	const float rayEnd[3] = { 4.5f, 0.0f, 0.5f };
+	query->raycast(startRef, startPos, rayEnd, &filter, &t, hitNormal, path, &pathCount, MAX_PATH);
+	float resultPos[3];
+	query->moveAlongSurface(startRef, startPos, rayEnd, &filter, resultPos, path, &pathCount, MAX_PATH);
+	query->findPolysAroundCircle(startRef, startPos, 3.0f, &filter, path, 0, 0, &pathCount, MAX_PATH);
+
+#ifdef DT_QUERY_STATS
+	CHECK(stats.queryCount == 1);
+	CHECK(stats.nodesExpanded > 0);
+	CHECK(stats.maxNodesUsed >= stats.nodesExpanded);
+	CHECK(stats.maxNodesUsed <= 1024);
+	CHECK(stats.tilesTouched >= 2);
+	CHECK(stats.filterCalls >= stats.nodesExpanded);
+	CHECK(stats.costCalls > 0);
+	CHECK(stats.outOfNodesCount == 0);
+
+	CHECK(tiny->getStats().queryCount == 1);
+	CHECK(tiny->getStats().maxNodesUsed == 8);
+	CHECK(tiny->getStats().outOfNodesCount == 1);
+
+	CHECK(query->getStats().queryCount == 4);
+	CHECK(query->getStats().nodesExpanded > stats.nodesExpanded);
+
+	dtQueryStats sum = stats;
+	dtAddQueryStats(&sum, &tiny->getStats());
+	CHECK(sum.queryCount == 2);
+	CHECK(sum.maxNodesUsed == stats.maxNodesUsed);
+	CHECK(sum.outOfNodesCount == 1);
+#else
+	// Compiled out, the counters stay zero.
+	CHECK(stats.queryCount == 0);
+	CHECK(stats.nodesExpanded == 0);
+	CHECK(query->getStats().queryCount == 0);
+	CHECK(tiny->getStats().outOfNodesCount == 0);
+#endif
+
+	query->resetStats();
+	CHECK(query->getStats().queryCount == 0);
+	CHECK(query->getStats().nodesExpanded == 0);
+
+	dtFreeNavMeshQuery(tiny);
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+namespace
+{
+// A clock that advances by one microsecond each time it is read.
+double s_fakeTime = 0.0;
+double fakeTime()
+{
+	return s_fakeTime += 1.0;
+}
+} // anonymous namespace
+
+TEST_CASE("Time budgeted sliced findPath", "[detour]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(3, 3, 8, isWallBlocked);
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 1024)));
+	dtQueryFilter filter;
+
+	const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+	const float startPos[3] = { 0.5f, 0.0f, 0.5f };
+	const float endPos[3] = { 23.5f, 0.0f, 0.5f };
+	dtPolyRef startRef = 0, endRef = 0;
+	float nearest[3];
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, nearest)));
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &endRef, nearest)));
+
+	static const int MAX_PATH = 256;
+	dtPolyRef path[MAX_PATH], slicedPath[MAX_PATH];
+	int pathCount = 0, slicedCount = 0;
+	REQUIRE(dtStatusInProgress(query->initSlicedFindPath(startRef, endRef, startPos, endPos, &filter)));
+	REQUIRE(dtStatusSucceed(query->updateSlicedFindPath(1 << 30, 0)));
+	REQUIRE(dtStatusSucceed(query->finalizeSlicedFindPath(path, &pathCount, MAX_PATH)));
+
+	REQUIRE(dtStatusInProgress(query->initSlicedFindPath(startRef, endRef, startPos, endPos, &filter)));
+
+	SECTION("Updates stop at the deadline")
+	{
+		// The clock is read once at the start and once per slice.
+		dtTimeBudget budget;
+		dtInitTimeBudget(budget, fakeTime, 3.0, 4);
+		int iters = 0;
+		double used = 0.0;
+		REQUIRE(dtStatusInProgress(query->updateSlicedFindPath(budget, &iters, &used)));
+		REQUIRE(iters == 8);
+		REQUIRE(used == 2.0);
+
+		// An exhausted budget still makes progress.
+		REQUIRE(dtStatusInProgress(query->updateSlicedFindPath(budget, &iters, &used)));
+		REQUIRE(iters == 4);
+		REQUIRE(used == 1.0);
+	}
+
+	SECTION("Budgeted search finds the same path")
+	{
+		int totalIters = 0;
+		dtStatus status = DT_IN_PROGRESS;
+		while (dtStatusInProgress(status))
+		{
+			dtTimeBudget budget;
+			dtInitTimeBudget(budget, fakeTime, 10.0);
+			int iters = 0;
+			status = query->updateSlicedFindPath(budget, &iters);
+			REQUIRE(iters > 0);
+			totalIters += iters;
+		}
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(totalIters > pathCount);
+		REQUIRE(dtStatusSucceed(query->finalizeSlicedFindPath(slicedPath, &slicedCount, MAX_PATH)));
+		REQUIRE(slicedCount == pathCount);
+		for (int i = 0; i < slicedCount; ++i)
+			REQUIRE(slicedPath[i] == path[i]);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("Navigation mesh file", "[detour]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(3, 3, 8, isWallBlocked);
+	REQUIRE(nav);
+	// Reload one tile so that the salts are not all the same.
+	REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(1, 1, 0), 0, 0)));
+	REQUIRE(TestNavMesh::addTile(nav, 1, 1, 8, isWallBlocked));
+
+	unsigned char* data = 0;
+	size_t dataSize = 0;
+	REQUIRE(dtStatusFailed(dtCreateNavMeshFile(nav, &data, &dataSize, 1000)));
+	REQUIRE(dtStatusSucceed(dtCreateNavMeshFile(nav, &data, &dataSize)));
+	REQUIRE(dataSize % DT_NAVMESH_FILE_PAGE_SIZE == 0);
+
+	const dtNavMeshFileHeader* header = 0;
+	const dtNavMeshFileTile* tiles = 0;
+	REQUIRE(dtStatusSucceed(dtGetNavMeshFileTiles(data, dataSize, &header, &tiles)));
+	REQUIRE(header->tileCount == 9);
+
+	SECTION("Tiles are loaded in place with their references")
+	{
+		dtNavMesh* loaded = dtAllocNavMesh();
+		REQUIRE(dtStatusSucceed(dtInitNavMeshFromFile(loaded, data, dataSize)));
+		for (int i = 0; i < header->tileCount; ++i)
+		{
+			const dtTileRef ref = dtGetNavMeshFileTileRef(tiles[i]);
+			const dtMeshTile* tile = loaded->getTileByRef(ref);
+			REQUIRE(tile);
+			REQUIRE(tile->data == data + (size_t)tiles[i].page * DT_NAVMESH_FILE_PAGE_SIZE);
+			REQUIRE(((size_t)(tile->data - data) % DT_NAVMESH_FILE_PAGE_SIZE) == 0);
+			REQUIRE(nav->getTileByRef(ref));
+		}
+
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		dtNavMeshQuery* loadedQuery = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(query->init(nav, 1024)));
+		REQUIRE(dtStatusSucceed(loadedQuery->init(loaded, 1024)));
+		dtQueryFilter filter;
+		const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+		const float startPos[3] = { 0.5f, 0.0f, 0.5f };
+		const float endPos[3] = { 23.5f, 0.0f, 0.5f };
+		dtPolyRef startRef = 0, endRef = 0;
+		float nearest[3];
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, nearest)));
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &endRef, nearest)));
+
+		dtPolyRef path[256], loadedPath[256];
+		int pathCount = 0, loadedCount = 0;
+		REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, 256)));
+		REQUIRE(dtStatusSucceed(loadedQuery->findPath(startRef, endRef, startPos, endPos, &filter, loadedPath, &loadedCount, 256)));
+		REQUIRE(loadedCount == pathCount);
+		for (int i = 0; i < pathCount; ++i)
+			REQUIRE(loadedPath[i] == path[i]);
+
+		dtFreeNavMeshQuery(loadedQuery);
+		dtFreeNavMeshQuery(query);
+		dtFreeNavMesh(loaded);
+	}
+
+	SECTION("Invalid files are rejected")
+	{
+		const dtNavMeshFileTile& last = tiles[header->tileCount - 1];
+		const size_t end = (size_t)last.page * DT_NAVMESH_FILE_PAGE_SIZE + last.dataSize;
+		REQUIRE(dtStatusSucceed(dtGetNavMeshFileTiles(data, end, 0, 0)));
+		REQUIRE(dtStatusDetail(dtGetNavMeshFileTiles(data, end - 1, 0, 0), DT_INVALID_PARAM));
+		REQUIRE(dtStatusDetail(dtGetNavMeshFileTiles(data, sizeof(dtNavMeshFileHeader), 0, 0), DT_INVALID_PARAM));
+		std::vector<unsigned char> copy(data, data + dataSize);
+		((dtNavMeshFileHeader*)&copy[0])->version++;
+		REQUIRE(dtStatusDetail(dtGetNavMeshFileTiles(&copy[0], dataSize, 0, 0), DT_WRONG_VERSION));
+		((dtNavMeshFileHeader*)&copy[0])->magic = 0;
+		dtNavMesh* loaded = dtAllocNavMesh();
+		REQUIRE(dtStatusDetail(dtInitNavMeshFromFile(loaded, &copy[0], dataSize), DT_WRONG_MAGIC));
+		dtFreeNavMesh(loaded);
+	}
+
+	dtFree(data);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtNavMesh sparse tiles", "[detour]")
+{
+	const int cellsPerTile = 4;
+	dtNavMeshParams params;
+	memset(&params, 0, sizeof(params));
+	params.tileWidth = cellsPerTile * TestNavMesh::CELL_SIZE;
+	params.tileHeight = cellsPerTile * TestNavMesh::CELL_SIZE;
+	params.maxTiles = 0;
+	params.maxPolys = cellsPerTile * cellsPerTile;
+
+	dtNavMesh* nav = dtAllocNavMesh();
+	REQUIRE(dtStatusSucceed(nav->init(&params, DT_NAVMESH_SPARSE_TILES)));
+	REQUIRE(nav->getFlags() == DT_NAVMESH_SPARSE_TILES);
+	REQUIRE(nav->getMaxTiles() == 0);
+	REQUIRE(!nav->getTileAt(0, 0, 0));
+
+	// Scattered tiles far apart, enough to grow both the tile pages and the lookup.
+	const int tileCount = 300;
+	std::vector<dtTileRef> refs;
+	for (int i = 0; i < tileCount; ++i)
+	{
+		const int tx = (i % 20) * 37 - 5000;
+		const int ty = (i / 20) * 53 + 7000;
+		const dtTileRef ref = TestNavMesh::addTile(nav, tx, ty, cellsPerTile);
+		REQUIRE(ref);
+		refs.push_back(ref);
+	}
+	REQUIRE(nav->getMaxTiles() >= tileCount);
+
+	// Pointers to the first tiles are not moved when more tiles are added.
+	const dtMeshTile* first = nav->getTileByRef(refs[0]);
+	REQUIRE(first == nav->getTileAt(-5000, 7000, 0));
+
+	// Remove every other tile and make sure the rest are still found.
+	for (int i = 0; i < tileCount; i += 2)
+		REQUIRE(dtStatusSucceed(nav->removeTile(refs[i], 0, 0)));
+	for (int i = 0; i < tileCount; ++i)
+	{
+		const int tx = (i % 20) * 37 - 5000;
+		const int ty = (i / 20) * 53 + 7000;
+		const dtMeshTile* tile = nav->getTileAt(tx, ty, 0);
+		if (i & 1)
+		{
+			REQUIRE(tile);
+			REQUIRE(nav->getTileRef(tile) == refs[i]);
+			REQUIRE(nav->getTileRefAt(tx, ty, 0) == refs[i]);
+			const dtMeshTile* tiles[4];
+			REQUIRE(nav->getTilesAt(tx, ty, tiles, 4) == 1);
+		}
+		else
+		{
+			REQUIRE(!tile);
+			REQUIRE(!nav->getTileByRef(refs[i]));
+		}
+	}
+
+	SECTION("Neighbour tiles connect")
+	{
+		// A 3x3 grid of tiles next to each other finds the same path as a dense navigation mesh.
+		dtNavMesh* dense = TestNavMesh::createGrid(3, 3, cellsPerTile);
+		REQUIRE(dense);
+		for (int y = 0; y < 3; ++y)
+			for (int x = 0; x < 3; ++x)
+				REQUIRE(TestNavMesh::addTile(nav, x, y, cellsPerTile));
+
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		dtNavMeshQuery* denseQuery = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(query->init(nav, 1024)));
+		REQUIRE(dtStatusSucceed(denseQuery->init(dense, 1024)));
+		dtQueryFilter filter;
+		const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+		const float startPos[3] = { 0.5f, 0.0f, 0.5f };
+		const float endPos[3] = { 11.5f, 0.0f, 11.5f };
+		dtPolyRef startRef = 0, endRef = 0, denseStartRef = 0, denseEndRef = 0;
+		float nearest[3];
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, nearest)));
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &endRef, nearest)));
+		REQUIRE(dtStatusSucceed(denseQuery->findNearestPoly(startPos, halfExtents, &filter, &denseStartRef, nearest)));
+		REQUIRE(dtStatusSucceed(denseQuery->findNearestPoly(endPos, halfExtents, &filter, &denseEndRef, nearest)));
+
+		dtPolyRef path[256], densePath[256];
+		int pathCount = 0, densePathCount = 0;
+		REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, 256)));
+		REQUIRE(dtStatusSucceed(denseQuery->findPath(denseStartRef, denseEndRef, startPos, endPos, &filter, densePath, &densePathCount, 256)));
+		REQUIRE(pathCount > 1);
+		REQUIRE(path[pathCount - 1] == endRef);
+		REQUIRE(pathCount == densePathCount);
+
+		dtFreeNavMeshQuery(denseQuery);
+		dtFreeNavMeshQuery(query);
+		dtFreeNavMesh(dense);
+	}
+
+	SECTION("Tiles are restored with their references")
+	{
+		int dataSize = 0;
+		unsigned char* data = TestNavMesh::createTileData(-5000, 7000, cellsPerTile, 0, &dataSize);
+		REQUIRE(data);
+		dtTileRef ref = 0;
+		// The slot of a loaded tile can not be reused.
+		REQUIRE(dtStatusFailed(nav->addTile(data, dataSize, DT_TILE_FREE_DATA, refs[1], &ref)));
+		REQUIRE(dtStatusSucceed(nav->addTile(data, dataSize, DT_TILE_FREE_DATA, refs[0], &ref)));
+		REQUIRE(ref == refs[0]);
+		REQUIRE(nav->getTileAt(-5000, 7000, 0) == first);
+	}
+
+	SECTION("Files keep the flags")
+	{
+		unsigned char* data = 0;
+		size_t dataSize = 0;
+		REQUIRE(dtStatusSucceed(dtCreateNavMeshFile(nav, &data, &dataSize)));
+		dtNavMesh* loaded = dtAllocNavMesh();
+		REQUIRE(dtStatusSucceed(dtInitNavMeshFromFile(loaded, data, dataSize)));
+		REQUIRE(loaded->getFlags() == DT_NAVMESH_SPARSE_TILES);
+		for (int i = 1; i < tileCount; i += 2)
+			REQUIRE(loaded->getTileByRef(refs[i]));
+		dtFreeNavMesh(loaded);
+		dtFree(data);
+	}
+
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtNavMesh sparse tile limit", "[detour]")
+{
+	dtNavMeshParams params;
+	memset(&params, 0, sizeof(params));
+	params.tileWidth = 4.0f;
+	params.tileHeight = 4.0f;
+	params.maxTiles = 70;
+	params.maxPolys = 16;
+
+	dtNavMesh* nav = dtAllocNavMesh();
+	REQUIRE(dtStatusSucceed(nav->init(&params, DT_NAVMESH_SPARSE_TILES)));
+	for (int i = 0; i < 70; ++i)
+		REQUIRE(TestNavMesh::addTile(nav, i, 0, 4));
+	REQUIRE(nav->getMaxTiles() == 70);
+	REQUIRE(!TestNavMesh::addTile(nav, 70, 0, 4));
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtNavMesh portal cache", "[detour]")
+{
+	dtNavMesh* nav = TestNavMesh::createNavMesh(3, 3, 8, DT_NAVMESH_PORTAL_CACHE);
+	dtNavMesh* uncached = TestNavMesh::createGrid(3, 3, 8, isWallBlocked);
+	REQUIRE(nav);
+	REQUIRE(uncached);
+	for (int y = 0; y < 3; ++y)
+		for (int x = 0; x < 3; ++x)
+			REQUIRE(TestNavMesh::addTile(nav, x, y, 8, isWallBlocked));
+	// Reload a tile so that the cache is rebuilt for reused links too.
+	dtNavMesh* meshes[2] = { nav, uncached };
+	for (int i = 0; i < 2; ++i)
+	{
+		REQUIRE(dtStatusSucceed(meshes[i]->removeTile(meshes[i]->getTileRefAt(1, 1, 0), 0, 0)));
+		REQUIRE(TestNavMesh::addTile(meshes[i], 1, 1, 8, isWallBlocked));
+	}
+	REQUIRE(nav->getTileAt(1, 1, 0)->linkPortals);
+	REQUIRE(!uncached->getTileAt(1, 1, 0)->linkPortals);
+
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	dtNavMeshQuery* uncachedQuery = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+	REQUIRE(dtStatusSucceed(uncachedQuery->init(uncached, 2048)));
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+	const float startPos[3] = { 0.5f, 0.0f, 0.5f };
+	const float endPos[3] = { 23.5f, 0.0f, 20.5f };
+
+	// Both meshes are built the same way, so the references match.
+	dtPolyRef startRef = 0, endRef = 0;
+	float nearest[3];
+	REQUIRE(dtStatusSucceed(uncachedQuery->findNearestPoly(startPos, halfExtents, &filter, &startRef, nearest)));
+	REQUIRE(dtStatusSucceed(uncachedQuery->findNearestPoly(endPos, halfExtents, &filter, &endRef, nearest)));
+	dtPolyRef path[512];
+	int pathCount = 0;
+	REQUIRE(dtStatusSucceed(uncachedQuery->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, 512)));
+	REQUIRE(pathCount > 10);
+	for (int i = 0; i < pathCount; ++i)
+		REQUIRE(nav->isValidPolyRef(path[i]));
+
+	// Every portal crossing is returned with DT_STRAIGHTPATH_ALL_CROSSINGS.
+	const int options[2] = { 0, DT_STRAIGHTPATH_ALL_CROSSINGS };
+	for (int k = 0; k < 2; ++k)
+	{
+		float straight[3 * 512], uncachedStraight[3 * 512];
+		int straightCount = 0, uncachedStraightCount = 0;
+		REQUIRE(dtStatusSucceed(query->findStraightPath(startPos, endPos, path, pathCount,
+														straight, 0, 0, &straightCount, 512, options[k])));
+		REQUIRE(dtStatusSucceed(uncachedQuery->findStraightPath(startPos, endPos, path, pathCount,
+																uncachedStraight, 0, 0, &uncachedStraightCount, 512, options[k])));
+		REQUIRE(straightCount > 2);
+		REQUIRE(straightCount == uncachedStraightCount);
+		for (int i = 0; i < straightCount * 3; ++i)
+			REQUIRE(straight[i] == uncachedStraight[i]);
+	}
+
+	dtFreeNavMeshQuery(uncachedQuery);
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(uncached);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("Quantized tile vertices", "[detour]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(3, 3, 8, isWallBlocked);
+	dtNavMesh* quantNav = TestNavMesh::createGrid(3, 3, 8, isWallBlocked, false, true);
+	REQUIRE(nav);
+	REQUIRE(quantNav);
+
+	SECTION("Vertices decode to the float vertices")
+	{
+		for (int i = 0; i < nav->getMaxTiles(); ++i)
+		{
+			const dtMeshTile* tile = static_cast<const dtNavMesh*>(nav)->getTile(i);
+			const dtMeshTile* quantTile = static_cast<const dtNavMesh*>(quantNav)->getTile(i);
+			if (!tile->header)
+				continue;
+			REQUIRE(!tile->quantVerts);
+			REQUIRE(quantTile->quantVerts);
+			REQUIRE(quantTile->header->quantVertCount == quantTile->header->vertCount);
+			REQUIRE(quantTile->dataSize < tile->dataSize);
+			for (int j = 0; j < tile->header->vertCount; ++j)
+			{
+				float v[3], qv[3];
+				dtGetTileVertex(tile, j, v);
+				dtGetTileVertex(quantTile, j, qv);
+				REQUIRE(v[0] == qv[0]);
+				REQUIRE(v[1] == qv[1]);
+				REQUIRE(v[2] == qv[2]);
+			}
+		}
+	}
+
+	SECTION("Queries return the same results")
+	{
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		dtNavMeshQuery* quantQuery = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+		REQUIRE(dtStatusSucceed(quantQuery->init(quantNav, 2048)));
+		dtQueryFilter filter;
+		const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+		const float startPos[3] = { 0.5f, 0.0f, 0.5f };
+		const float endPos[3] = { 23.5f, 0.0f, 20.5f };
+
+		dtPolyRef startRef = 0, endRef = 0, quantRef = 0;
+		float nearest[3], quantNearest[3];
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, nearest)));
+		REQUIRE(dtStatusSucceed(quantQuery->findNearestPoly(startPos, halfExtents, &filter, &quantRef, quantNearest)));
+		REQUIRE(startRef == quantRef);
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &endRef, nearest)));
+
+		dtPolyRef path[512], quantPath[512];
+		int pathCount = 0, quantPathCount = 0;
+		REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, 512)));
+		REQUIRE(dtStatusSucceed(quantQuery->findPath(startRef, endRef, startPos, endPos, &filter, quantPath, &quantPathCount, 512)));
+		REQUIRE(pathCount > 10);
+		REQUIRE(pathCount == quantPathCount);
+		for (int i = 0; i < pathCount; ++i)
+			REQUIRE(path[i] == quantPath[i]);
+
+		float straight[3 * 512], quantStraight[3 * 512];
+		int straightCount = 0, quantStraightCount = 0;
+		REQUIRE(dtStatusSucceed(query->findStraightPath(startPos, endPos, path, pathCount,
+														straight, 0, 0, &straightCount, 512, DT_STRAIGHTPATH_ALL_CROSSINGS)));
+		REQUIRE(dtStatusSucceed(quantQuery->findStraightPath(startPos, endPos, path, pathCount,
+															 quantStraight, 0, 0, &quantStraightCount, 512, DT_STRAIGHTPATH_ALL_CROSSINGS)));
+		REQUIRE(straightCount == quantStraightCount);
+		for (int i = 0; i < straightCount * 3; ++i)
+			REQUIRE(straight[i] == quantStraight[i]);
+
+		for (int i = 0; i < pathCount; ++i)
+		{
+			float center[3] = { 0, 0, 0 }, height = 0, quantHeight = 0;
+			const dtMeshTile* tile = 0;
+			const dtPoly* poly = 0;
+			nav->getTileAndPolyByRefUnsafe(path[i], &tile, &poly);
+			for (int j = 0; j < poly->vertCount; ++j)
+			{
+				float v[3];
+				dtGetTileVertex(tile, poly->verts[j], v);
+				dtVadd(center, center, v);
+			}
+			dtVscale(center, center, 1.0f / poly->vertCount);
+			REQUIRE(dtStatusSucceed(query->getPolyHeight(path[i], center, &height)));
+			REQUIRE(dtStatusSucceed(quantQuery->getPolyHeight(path[i], center, &quantHeight)));
+			REQUIRE(height == quantHeight);
+		}
+
+		dtFreeNavMeshQuery(quantQuery);
+		dtFreeNavMeshQuery(query);
+	}
+
+	SECTION("Endian swap round trip")
+	{
+		int dataSize = 0;
+		unsigned char* data = TestNavMesh::createTileData(0, 0, 8, isWallBlocked, &dataSize, false, true);
+		REQUIRE(data);
+		std::vector<unsigned char> original(data, data + dataSize);
+		REQUIRE(dtNavMeshDataSwapEndian(data, dataSize));
+		REQUIRE(dtNavMeshHeaderSwapEndian(data, dataSize));
+		REQUIRE(dtNavMeshHeaderSwapEndian(data, dataSize));
+		REQUIRE(dtNavMeshDataSwapEndian(data, dataSize));
+		REQUIRE(std::vector<unsigned char>(data, data + dataSize) == original);
+		dtFree(data);
+	}
+
+	dtFreeNavMesh(quantNav);
+	dtFreeNavMesh(nav);
+}
+
+namespace
+{
+// Creates a tile with a single quad polygon whose detail mesh is a bumpy 4x4 grid of quads.
+unsigned char* createDetailTileData(bool quantizeDetailVerts, bool buildDetailGrids, int* dataSize)
+{
+	static const int N = 4;
+	unsigned short verts[4 * 3] = { 0,0,0, 0,0,16, 16,0,16, 16,0,0 };
+	unsigned short polys[4 * 2] = { 0,1,2,3, 0x8000,0x8001,0x8002,0x8003 };
+	unsigned short flags = 1;
+	unsigned char area = 0;
+
+	// The polygon vertices come first, followed by the rest of the lattice.
+	int lattice[(N + 1) * (N + 1)];
+	const int corners[4][2] = { { 0, 0 }, { 0, N }, { N, N }, { N, 0 } };
+	for (int i = 0; i < (N + 1) * (N + 1); ++i)
+		lattice[i] = -1;
+	for (int i = 0; i < 4; ++i)
+		lattice[corners[i][0] + corners[i][1] * (N + 1)] = i;
+	float detailVerts[(N + 1) * (N + 1) * 3];
+	int nverts = 4;
+	for (int z = 0; z <= N; ++z)
+	{
+		for (int x = 0; x <= N; ++x)
+		{
+			int& idx = lattice[x + z * (N + 1)];
+			if (idx < 0)
+				idx = nverts++;
+			float* v = &detailVerts[idx * 3];
+			v[0] = (float)x;
+			v[1] = 0.03f * x * (N - x) * z * (N - z) * (1.0f + 0.2f * ((x + z) % 3));
+			v[2] = (float)z;
+		}
+	}
+
+	unsigned char detailTris[N * N * 2 * 4];
+	int ntris = 0;
+	for (int z = 0; z < N; ++z)
+	{
+		for (int x = 0; x < N; ++x)
+		{
+			const int quad[4][2] = { { x, z }, { x, z + 1 }, { x + 1, z + 1 }, { x + 1, z } };
+			const int triVerts[2][3] = { { 0, 1, 2 }, { 0, 2, 3 } };
+			for (int i = 0; i < 2; ++i)
+			{
+				unsigned char* t = &detailTris[ntris++ * 4];
+				t[3] = 0;
+				for (int k = 0; k < 3; ++k)
+				{
+					const int* a = quad[triVerts[i][k]];
+					const int* b = quad[triVerts[i][(k + 1) % 3]];
+					t[k] = (unsigned char)lattice[a[0] + a[1] * (N + 1)];
+					const bool onBoundary = (a[0] == b[0] && (a[0] == 0 || a[0] == N)) ||
+											(a[1] == b[1] && (a[1] == 0 || a[1] == N));
+					if (onBoundary)
+						t[3] |= (unsigned char)(DT_DETAIL_EDGE_BOUNDARY << (k * 2));
+				}
+			}
+		}
+	}
+	unsigned int detailMeshes[4] = { 0, (unsigned int)nverts, 0, (unsigned int)ntris };
+
+	dtNavMeshCreateParams params;
+	memset(&params, 0, sizeof(params));
+	params.verts = verts;
+	params.vertCount = 4;
+	params.polys = polys;
+	params.polyAreas = &area;
+	params.polyFlags = &flags;
+	params.polyCount = 1;
+	params.nvp = 4;
+	params.detailMeshes = detailMeshes;
+	params.detailVerts = detailVerts;
+	params.detailVertsCount = nverts;
+	params.detailTris = detailTris;
+	params.detailTriCount = ntris;
+	params.walkableHeight = 2.0f;
+	params.walkableRadius = 0.5f;
+	params.walkableClimb = 0.5f;
+	params.bmax[0] = 4.0f;
+	params.bmax[1] = 1.0f;
+	params.bmax[2] = 4.0f;
+	params.cs = 0.25f;
+	params.ch = 0.25f;
+	params.buildBvTree = true;
+	params.quantizeDetailVerts = quantizeDetailVerts;
+	params.buildDetailGrids = buildDetailGrids;
+
+	unsigned char* data = 0;
+	if (!dtCreateNavMeshData(&params, &data, dataSize))
+		return 0;
+	return data;
+}
+} // anonymous namespace
+
+TEST_CASE("Quantized detail vertices", "[detour]")
+{
+	int dataSize = 0, quantDataSize = 0;
+	unsigned char* data = createDetailTileData(false, false, &dataSize);
+	unsigned char* quantData = createDetailTileData(true, false, &quantDataSize);
+	REQUIRE(data);
+	REQUIRE(quantData);
+	REQUIRE(quantDataSize < dataSize);
+
+	SECTION("Endian swap round trip")
+	{
+		std::vector<unsigned char> original(quantData, quantData + quantDataSize);
+		REQUIRE(dtNavMeshDataSwapEndian(quantData, quantDataSize));
+		REQUIRE(dtNavMeshHeaderSwapEndian(quantData, quantDataSize));
+		REQUIRE(dtNavMeshHeaderSwapEndian(quantData, quantDataSize));
+		REQUIRE(dtNavMeshDataSwapEndian(quantData, quantDataSize));
+		REQUIRE(std::vector<unsigned char>(quantData, quantData + quantDataSize) == original);
+	}
+
+	dtNavMesh* nav = TestNavMesh::createNavMesh(1, 1, 4);
+	dtNavMesh* quantNav = TestNavMesh::createNavMesh(1, 1, 4);
+	REQUIRE(nav);
+	REQUIRE(quantNav);
+	REQUIRE(dtStatusSucceed(nav->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, 0)));
+	REQUIRE(dtStatusSucceed(quantNav->addTile(quantData, quantDataSize, DT_TILE_FREE_DATA, 0, 0)));
+	const dtPolyRef base = nav->getPolyRefBase(nav->getTileAt(0, 0, 0));
+	REQUIRE(base == quantNav->getPolyRefBase(quantNav->getTileAt(0, 0, 0)));
+
+	const dtMeshTile* quantTile = static_cast<const dtNavMesh*>(quantNav)->getTileAt(0, 0, 0);
+	REQUIRE(quantTile->quantDetailVerts);
+	REQUIRE(quantTile->header->quantDetailVertCount == 21);
+	REQUIRE(!nav->getTileAt(0, 0, 0)->quantDetailVerts);
+
+	SECTION("Heights match within the quantization step")
+	{
+		const dtMeshTile* tile = static_cast<const dtNavMesh*>(nav)->getTileAt(0, 0, 0);
+		for (int i = 0; i < tile->header->detailVertCount; ++i)
+		{
+			float v[3], qv[3];
+			dtGetDetailVertex(tile, i, v);
+			dtGetDetailVertex(quantTile, i, qv);
+			REQUIRE(dtVdist(v, qv) < 1e-4f);
+		}
+
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		dtNavMeshQuery* quantQuery = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(query->init(nav, 64)));
+		REQUIRE(dtStatusSucceed(quantQuery->init(quantNav, 64)));
+		for (int z = 0; z < 8; ++z)
+		{
+			for (int x = 0; x < 8; ++x)
+			{
+				const float pos[3] = { 0.25f + x * 0.5f, 0.0f, 0.25f + z * 0.5f };
+				float height = 0, quantHeight = 0;
+				REQUIRE(dtStatusSucceed(query->getPolyHeight(base, pos, &height)));
+				REQUIRE(dtStatusSucceed(quantQuery->getPolyHeight(base, pos, &quantHeight)));
+				REQUIRE(height >= 0.0f);
+				REQUIRE(dtAbs(height - quantHeight) < 1e-4f);
+
+				float closest[3], quantClosest[3];
+				REQUIRE(dtStatusSucceed(query->closestPointOnPoly(base, pos, closest, 0)));
+				REQUIRE(dtStatusSucceed(quantQuery->closestPointOnPoly(base, pos, quantClosest, 0)));
+				REQUIRE(dtVdist(closest, quantClosest) < 1e-4f);
+			}
+		}
+		dtFreeNavMeshQuery(quantQuery);
+		dtFreeNavMeshQuery(query);
+	}
+
+	dtFreeNavMesh(quantNav);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("Detail grids", "[detour]")
+{
+	int dataSize = 0, gridDataSize = 0;
+	unsigned char* data = createDetailTileData(false, false, &dataSize);
+	unsigned char* gridData = createDetailTileData(true, true, &gridDataSize);
+	REQUIRE(data);
+	REQUIRE(gridData);
+
+	SECTION("Endian swap round trip")
+	{
+		std::vector<unsigned char> original(gridData, gridData + gridDataSize);
+		REQUIRE(dtNavMeshDataSwapEndian(gridData, gridDataSize));
+		REQUIRE(dtNavMeshHeaderSwapEndian(gridData, gridDataSize));
+		REQUIRE(dtNavMeshHeaderSwapEndian(gridData, gridDataSize));
+		REQUIRE(dtNavMeshDataSwapEndian(gridData, gridDataSize));
+		REQUIRE(std::vector<unsigned char>(gridData, gridData + gridDataSize) == original);
+	}
+
+	dtNavMesh* nav = TestNavMesh::createNavMesh(1, 1, 4);
+	dtNavMesh* gridNav = TestNavMesh::createNavMesh(1, 1, 4);
+	REQUIRE(nav);
+	REQUIRE(gridNav);
+	REQUIRE(dtStatusSucceed(nav->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, 0)));
+	REQUIRE(dtStatusSucceed(gridNav->addTile(gridData, gridDataSize, DT_TILE_FREE_DATA, 0, 0)));
+	const dtPolyRef base = nav->getPolyRefBase(nav->getTileAt(0, 0, 0));
+
+	const dtMeshTile* gridTile = static_cast<const dtNavMesh*>(gridNav)->getTileAt(0, 0, 0);
+	REQUIRE(!nav->getTileAt(0, 0, 0)->detailGrids);
+	REQUIRE(gridTile->detailGrids);
+	REQUIRE(gridTile->detailGrids[0].size > 1);
+	REQUIRE(gridTile->header->detailGridTriCount >= gridTile->detailMeshes[0].triCount);
+
+	SECTION("Heights match the linear search")
+	{
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		dtNavMeshQuery* gridQuery = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(query->init(nav, 64)));
+		REQUIRE(dtStatusSucceed(gridQuery->init(gridNav, 64)));
+
+		// Include the points on the detail and the grid cell edges.
+		for (int z = 0; z <= 32; ++z)
+		{
+			for (int x = 0; x <= 32; ++x)
+			{
+				const float pos[3] = { x * 0.125f, 0.0f, z * 0.125f };
+				float height = 0, gridHeight = 0;
+				const dtStatus status = query->getPolyHeight(base, pos, &height);
+				REQUIRE(gridQuery->getPolyHeight(base, pos, &gridHeight) == status);
+				if (dtStatusSucceed(status))
+					REQUIRE(dtAbs(height - gridHeight) < 1e-4f);
+			}
+		}
+		dtFreeNavMeshQuery(gridQuery);
+		dtFreeNavMeshQuery(query);
+	}
+
+	dtFreeNavMesh(gridNav);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("Batched raycasts", "[detour]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(3, 3, 8, isWallBlocked);
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 256)));
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+
+	// Groups of rays starting from the same agent position towards random targets.
+	static const int GROUPS = 12;
+	static const int RAYS_PER_GROUP = 23;
+	static const int COUNT = GROUPS * RAYS_PER_GROUP;
+	static const int MAX_PATH = 16;
+	std::vector<dtPolyRef> startRefs(COUNT);
+	std::vector<float> startPos(COUNT * 3), endPos(COUNT * 3);
+	unsigned int seed = 9876;
+	int n = 0;
+	while (n < COUNT)
+	{
+		float center[3];
+		seed = seed * 1103515245u + 12345u;
+		center[0] = ((seed >> 8) % 2400) / 100.0f;
+		center[1] = 0.0f;
+		seed = seed * 1103515245u + 12345u;
+		center[2] = ((seed >> 8) % 2400) / 100.0f;
+		dtPolyRef ref = 0;
+		float pt[3];
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(center, halfExtents, &filter, &ref, pt)));
+		if (!ref)
+			continue;
+		for (int i = 0; i < RAYS_PER_GROUP; ++i, ++n)
+		{
+			startRefs[n] = ref;
+			dtVcopy(&startPos[n * 3], pt);
+			seed = seed * 1103515245u + 12345u;
+			endPos[n * 3 + 0] = pt[0] + ((seed >> 8) % 1600) / 100.0f - 8.0f;
+			endPos[n * 3 + 1] = 0.0f;
+			seed = seed * 1103515245u + 12345u;
+			endPos[n * 3 + 2] = pt[2] + ((seed >> 8) % 1600) / 100.0f - 8.0f;
+		}
+	}
+
+	const unsigned int options[2] = { 0, DT_RAYCAST_USE_COSTS };
+	for (int k = 0; k < 2; ++k)
+	{
+		std::vector<dtPolyRef> paths(COUNT * MAX_PATH);
+		std::vector<dtRaycastHit> hits(COUNT);
+		for (int i = 0; i < COUNT; ++i)
+		{
+			hits[i].path = &paths[i * MAX_PATH];
+			// Some of the rays get a small path buffer.
+			hits[i].maxPath = (i % 5) == 0 ? 2 : MAX_PATH;
+		}
+		const dtStatus status = query->raycasts(&startRefs[0], &startPos[0], &endPos[0], COUNT, &filter, options[k], &hits[0]);
+		REQUIRE(dtStatusSucceed(status));
+
+		bool bufferTooSmall = false;
+		int wallHits = 0;
+		for (int i = 0; i < COUNT; ++i)
+		{
+			dtPolyRef path[MAX_PATH];
+			dtRaycastHit hit;
+			hit.path = path;
+			hit.maxPath = hits[i].maxPath;
+			const dtStatus rayStatus = query->raycast(startRefs[i], &startPos[i * 3], &endPos[i * 3], &filter, options[k], &hit);
+			REQUIRE(dtStatusSucceed(rayStatus));
+			bufferTooSmall |= dtStatusDetail(rayStatus, DT_BUFFER_TOO_SMALL);
+
+			REQUIRE(hit.t == hits[i].t);
+			REQUIRE(hit.pathCount == hits[i].pathCount);
+			REQUIRE(hit.pathCost == hits[i].pathCost);
+			for (int j = 0; j < hit.pathCount; ++j)
+				REQUIRE(hit.path[j] == hits[i].path[j]);
+			if (hit.t < 1.0f)
+			{
+				wallHits++;
+				REQUIRE(hit.hitEdgeIndex == hits[i].hitEdgeIndex);
+				REQUIRE(hit.hitNormal[0] == hits[i].hitNormal[0]);
+				REQUIRE(hit.hitNormal[2] == hits[i].hitNormal[2]);
+			}
+		}
+		REQUIRE(wallHits > 0);
+		REQUIRE(wallHits < COUNT);
+		REQUIRE(bufferTooSmall == dtStatusDetail(status, DT_BUFFER_TOO_SMALL));
+	}
+
+	SECTION("Invalid input")
+	{
+		dtRaycastHit hit;
+		hit.path = 0;
+		hit.maxPath = 0;
+		const dtPolyRef badRef = 0;
+		REQUIRE(dtStatusFailed(query->raycasts(&badRef, &startPos[0], &endPos[0], 1, &filter, 0, &hit)));
+		REQUIRE(dtStatusFailed(query->raycasts(&startRefs[0], &startPos[0], &endPos[0], 1, 0, 0, &hit)));
+		REQUIRE(dtStatusSucceed(query->raycasts(&startRefs[0], &startPos[0], &endPos[0], 0, &filter, 0, &hit)));
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+namespace
+{
+int s_globalAllocs = 0;
+
+void* countingAlloc(size_t size, dtAllocHint)
+{
+	s_globalAllocs++;
+	return malloc(size);
+}
+
+void countingFree(void* ptr)
+{
+	free(ptr);
+}
+} // anonymous namespace
+
+TEST_CASE("Batched surface moves", "[detour]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(3, 3, 8, isWallBlocked);
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 256)));
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+
+	// Short moves, most of them within their start polygon, and longer moves into walls.
+	static const int COUNT = 150;
+	static const int MAX_VISITED = 16;
+	std::vector<dtSurfaceMove> moves(COUNT);
+	std::vector<dtPolyRef> visited(COUNT * MAX_VISITED);
+	unsigned int seed = 4321;
+	int n = 0;
+	while (n < COUNT)
+	{
+		float center[3];
+		seed = seed * 1103515245u + 12345u;
+		center[0] = ((seed >> 8) % 2400) / 100.0f;
+		center[1] = 0.0f;
+		seed = seed * 1103515245u + 12345u;
+		center[2] = ((seed >> 8) % 2400) / 100.0f;
+		dtSurfaceMove& move = moves[n];
+		if (dtStatusFailed(query->findNearestPoly(center, halfExtents, &filter, &move.startRef, move.startPos)) ||
+			!move.startRef)
+			continue;
+		const float range = (n % 3) == 0 ? 6.0f : 0.5f;
+		seed = seed * 1103515245u + 12345u;
+		move.endPos[0] = move.startPos[0] + ((seed >> 8) % 1000) / 1000.0f * range * 2.0f - range;
+		move.endPos[1] = move.startPos[1];
+		seed = seed * 1103515245u + 12345u;
+		move.endPos[2] = move.startPos[2] + ((seed >> 8) % 1000) / 1000.0f * range * 2.0f - range;
+		move.filter = &filter;
+		move.visited = &visited[n * MAX_VISITED];
+		move.maxVisited = MAX_VISITED;
+		n++;
+	}
+	// Invalid moves fail on their own.
+	moves[5].startRef = 0;
+	moves[7].filter = 0;
+
+	REQUIRE(dtStatusSucceed(query->moveAlongSurfaceBatch(&moves[0], COUNT)));
+
+	for (int i = 0; i < COUNT; ++i)
+	{
+		const dtSurfaceMove& move = moves[i];
+		if (i == 5 || i == 7)
+		{
+			REQUIRE(move.status == (DT_FAILURE | DT_INVALID_PARAM));
+			continue;
+		}
+
+		float result[3];
+		dtPolyRef path[MAX_VISITED];
+		int pathCount = 0;
+		const dtStatus status = query->moveAlongSurface(move.startRef, move.startPos, move.endPos, &filter,
+														result, path, &pathCount, MAX_VISITED);
+		REQUIRE(move.status == status);
+		REQUIRE(move.visitedCount == pathCount);
+		for (int j = 0; j < pathCount; ++j)
+			REQUIRE(move.visited[j] == path[j]);
+		float h = move.startPos[1];
+		query->getPolyHeight(pathCount ? path[pathCount - 1] : move.startRef, result, &h);
+		REQUIRE(move.resultPos[0] == result[0]);
+		REQUIRE(move.resultPos[1] == h);
+		REQUIRE(move.resultPos[2] == result[2]);
+	}
+
+	REQUIRE(dtStatusSucceed(query->moveAlongSurfaceBatch(0, 0)));
+	REQUIRE(dtStatusFailed(query->moveAlongSurfaceBatch(0, 1)));
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("Per-instance allocators", "[detour]")
+{
+	TestNavMesh::CountingAllocator allocator;
+	dtNavMesh* nav = TestNavMesh::createGrid(3, 3, 8, isWallBlocked, false, false, &allocator);
+	REQUIRE(nav);
+	REQUIRE(nav->getAllocator() == &allocator);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 256, 64, &allocator)));
+	const int navAllocs = allocator.allocs;
+	REQUIRE(navAllocs > 0);
+
+	// The queries only allocate from the allocator of the query.
+	dtAllocSetCustom(countingAlloc, countingFree);
+	s_globalAllocs = 0;
+	dtQueryFilter filter;
+	const float centers[6] = { 0.5f, 0.0f, 0.5f, 23.5f, 0.0f, 0.5f };
+	const float halfExtents[6] = { 0.5f, 1.0f, 0.5f, 0.5f, 1.0f, 0.5f };
+	dtPolyRef refs[2];
+	float points[6];
+	bool overPoly[2];
+	REQUIRE(dtStatusSucceed(query->findNearestPolys(centers, halfExtents, 2, &filter, refs, points, overPoly)));
+	REQUIRE(refs[0]);
+	REQUIRE(refs[1]);
+	dtPolyRef path[64];
+	int pathCount = 0;
+	REQUIRE(dtStatusSucceed(query->findPath(refs[0], refs[1], &points[0], &points[3], &filter, path, &pathCount, 64,
+											DT_FINDPATH_BIDIRECTIONAL)));
+	REQUIRE(pathCount > 1);
+	REQUIRE(s_globalAllocs == 0);
+	REQUIRE(allocator.allocs > navAllocs);
+	dtAllocSetCustom(0, 0);
+
+	// Initializing the query with another allocator releases the node pools to the previous one.
+	const int live = allocator.live;
+	REQUIRE(dtStatusSucceed(query->init(nav, 256)));
+	REQUIRE(allocator.live < live);
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+	REQUIRE(allocator.live == 0);
+	REQUIRE(allocator.foreign == 0);
+}
+
+namespace
+{
+// Builds the tile data of two rooms joined by a doorway which is 6 cells wide, eroded by one cell.
+unsigned char* buildDoorwayTile(const bool edgeClearance, int* dataSize)
+{
+	const int size = 40;
+	const float cs = 0.3f;
+	const float ch = 0.2f;
+	const float bmin[3] = { 0.0f, 0.0f, 0.0f };
+	const float bmax[3] = { size * cs, 10.0f, size * cs };
+
+	rcContext ctx(false);
+	rcHeightfield solid;
+	REQUIRE(rcCreateHeightfield(&ctx, solid, size, size, bmin, bmax, cs, ch));
+	for (int z = 0; z < size; ++z)
+	{
+		for (int x = 0; x < size; ++x)
+		{
+			const bool wall = (x == 19 || x == 20) && (z < 17 || z >= 23);
+			REQUIRE(rcAddSpan(&ctx, solid, x, z, 0, wall ? 40 : 1, wall ? RC_NULL_AREA : RC_WALKABLE_AREA, 1));
+		}
+	}
+
+	rcCompactHeightfield chf;
+	REQUIRE(rcBuildCompactHeightfield(&ctx, 10, 2, solid, chf));
+	REQUIRE(rcErodeWalkableArea(&ctx, 1, chf));
+	REQUIRE(rcBuildRegionsMonotone(&ctx, chf, 0, 8, 20));
+	rcContourSet cset;
+	REQUIRE(rcBuildContours(&ctx, chf, 1.3f, 12, cset));
+	rcPolyMesh pmesh;
+	REQUIRE(rcBuildPolyMesh(&ctx, cset, 6, pmesh));
+	REQUIRE(!pmesh.edgeClearance);
+	if (edgeClearance)
+	{
+		// Builds the distance field, which the monotone regions do not need.
+		REQUIRE(rcBuildPolyMeshEdgeClearance(&ctx, chf, pmesh));
+		REQUIRE(pmesh.edgeClearance);
+		REQUIRE(chf.dist);
+
+		rcPolyMesh copy;
+		REQUIRE(rcCopyPolyMesh(&ctx, pmesh, copy));
+		REQUIRE(memcmp(copy.edgeClearance, pmesh.edgeClearance, sizeof(unsigned short) * pmesh.npolys * pmesh.nvp) == 0);
+	}
+	for (int i = 0; i < pmesh.npolys; ++i)
+		pmesh.flags[i] = 1;
+
+	dtNavMeshCreateParams params;
+	memset(&params, 0, sizeof(params));
+	params.verts = pmesh.verts;
+	params.vertCount = pmesh.nverts;
+	params.polys = pmesh.polys;
+	params.polyAreas = pmesh.areas;
+	params.polyFlags = pmesh.flags;
+	params.polyCount = pmesh.npolys;
+	params.nvp = pmesh.nvp;
+	params.polyEdgeClearance = pmesh.edgeClearance;
+	params.walkableHeight = 2.0f;
+	params.walkableRadius = cs;
+	params.walkableClimb = 0.4f;
+	rcVcopy(params.bmin, pmesh.bmin);
+	rcVcopy(params.bmax, pmesh.bmax);
+	params.cs = cs;
+	params.ch = ch;
+	params.buildBvTree = true;
+
+	unsigned char* data = 0;
+	if (!dtCreateNavMeshData(&params, &data, dataSize))
+		return 0;
+	return data;
+}
+
+// Returns true if a path for an agent of the radius goes through the doorway.
+bool findPathThroughDoorway(dtNavMeshQuery* query, const float radius)
+{
+	dtQueryFilter filter;
+	filter.setAgentRadius(radius);
+	const float startPos[3] = { 3.0f, 0.2f, 6.0f };
+	const float endPos[3] = { 9.0f, 0.2f, 6.0f };
+	const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+	dtPolyRef startRef = 0, endRef = 0;
+	float startNearest[3], endNearest[3];
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, startNearest)));
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &endRef, endNearest)));
+	REQUIRE(startRef);
+	REQUIRE(endRef);
+
+	dtPolyRef path[256];
+	int pathCount = 0;
+	const dtStatus status = query->findPath(startRef, endRef, startNearest, endNearest, &filter, path, &pathCount, 256);
+	REQUIRE(dtStatusSucceed(status));
+	const bool reached = pathCount > 0 && path[pathCount - 1] == endRef;
+
+	// The templated search takes the radius from filters deriving from dtQueryFilter.
+	int templatedCount = 0;
+	REQUIRE(dtStatusSucceed(query->findPath<dtQueryFilter>(startRef, endRef, startNearest, endNearest, &filter,
+														   path, &templatedCount, 256)));
+	REQUIRE(templatedCount == pathCount);
+
+	// The ray through the doorway hits its edge as a wall when the agent does not fit.
+	const float rayStart[3] = { 3.0f, 0.2f, 6.0f };
+	const float rayEnd[3] = { 9.0f, 0.2f, 6.0f };
+	float t = 0.0f;
+	float normal[3];
+	int visitedCount = 0;
+	REQUIRE(dtStatusSucceed(query->raycast(startRef, rayStart, rayEnd, &filter, &t, normal, path, &visitedCount, 256)));
+	REQUIRE((t == FLT_MAX) == reached);
+	return reached;
+}
+} // anonymous namespace
+
+TEST_CASE("Polygon edge clearance", "[detour]")
+{
+	int dataSize = 0;
+	unsigned char* data = buildDoorwayTile(true, &dataSize);
+	REQUIRE(data);
+	dtNavMesh* nav = dtAllocNavMesh();
+	REQUIRE(dtStatusSucceed(nav->init(data, dataSize, DT_TILE_FREE_DATA)));
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+
+	const dtMeshTile* tile = nav->getTileAt(0, 0, 0);
+	REQUIRE(tile);
+	REQUIRE(tile->edgeClearance);
+	REQUIRE(tile->header->edgeClearanceCount == tile->header->polyCount * DT_VERTS_PER_POLYGON);
+
+	SECTION("Agents wider than the doorway do not pass")
+	{
+		REQUIRE(findPathThroughDoorway(query, 0.0f));
+		REQUIRE(findPathThroughDoorway(query, 0.4f));
+		REQUIRE(!findPathThroughDoorway(query, 1.0f));
+	}
+
+	SECTION("Narrow portals are walls")
+	{
+		dtQueryFilter filter;
+		filter.setAgentRadius(1.0f);
+		const float center[3] = { 3.0f, 0.2f, 6.0f };
+		const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+		dtPolyRef startRef = 0;
+		float nearest[3];
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(center, halfExtents, &filter, &startRef, nearest)));
+
+		// The polygons reachable by the wide agent are all on the start side of the doorway's far end.
+		const float doorwayEnd = 21 * 0.3f + 0.01f;
+		dtPolyRef polys[256];
+		int polyCount = 0;
+		REQUIRE(dtStatusSucceed(query->findPolysAroundCircle(startRef, nearest, 20.0f, &filter, polys, 0, 0,
+															 &polyCount, 256)));
+		REQUIRE(polyCount > 0);
+		for (int i = 0; i < polyCount; ++i)
+		{
+			const dtMeshTile* polyTile = 0;
+			const dtPoly* poly = 0;
+			nav->getTileAndPolyByRefUnsafe(polys[i], &polyTile, &poly);
+			for (int j = 0; j < (int)poly->vertCount; ++j)
+			{
+				float pos[3];
+				dtGetTileVertex(polyTile, poly->verts[j], pos);
+				REQUIRE(pos[0] <= doorwayEnd);
+			}
+		}
+
+		// Moving towards the other room stops at the doorway.
+		const float target[3] = { 9.0f, 0.2f, 6.0f };
+		float result[3];
+		dtPolyRef visited[64];
+		int visitedCount = 0;
+		REQUIRE(dtStatusSucceed(query->moveAlongSurface(startRef, nearest, target, &filter, result, visited,
+														&visitedCount, 64)));
+		REQUIRE(result[0] <= doorwayEnd);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+
+	// Tiles built without clearances let every agent through.
+	data = buildDoorwayTile(false, &dataSize);
+	REQUIRE(data);
+	nav = dtAllocNavMesh();
+	REQUIRE(dtStatusSucceed(nav->init(data, dataSize, DT_TILE_FREE_DATA)));
+	query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+	REQUIRE(!nav->getTileAt(0, 0, 0)->edgeClearance);
+	REQUIRE(nav->getTileAt(0, 0, 0)->header->edgeClearanceCount == 0);
+	REQUIRE(findPathThroughDoorway(query, 1.0f));
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+namespace
+{
+bool isPillarCell(int x, int z)
+{
+	return x >= 6 && x < 10 && z >= 6 && z < 10;
+}
+} // anonymous namespace
+
+TEST_CASE("Wall distances", "[detour]")
+{
+	const int cells = 16;
+	int dataSize = 0;
+	unsigned char* data = TestNavMesh::createTileData(0, 0, cells, isPillarCell, &dataSize, false, false, 0, 0, true);
+	REQUIRE(data);
+
+	SECTION("Endian swap round trip")
+	{
+		std::vector<unsigned char> original(data, data + dataSize);
+		REQUIRE(dtNavMeshDataSwapEndian(data, dataSize));
+		REQUIRE(dtNavMeshHeaderSwapEndian(data, dataSize));
+		REQUIRE(dtNavMeshHeaderSwapEndian(data, dataSize));
+		REQUIRE(dtNavMeshDataSwapEndian(data, dataSize));
+		REQUIRE(std::vector<unsigned char>(data, data + dataSize) == original);
+	}
+
+	dtNavMesh* nav = TestNavMesh::createNavMesh(1, 1, cells);
+	REQUIRE(nav);
+	REQUIRE(dtStatusSucceed(nav->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, 0)));
+	const dtMeshTile* tile = static_cast<const dtNavMesh*>(nav)->getTileAt(0, 0, 0);
+	REQUIRE(tile->wallDistGrids);
+	REQUIRE(tile->header->wallDistGridCount == tile->header->polyCount);
+	REQUIRE(tile->wallDistGrids[0].size[0] == 3);
+	REQUIRE(tile->wallDistGrids[0].size[1] == 3);
+
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 512)));
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 0.1f, 1.0f, 0.1f };
+
+	SECTION("Lookups are close to the search")
+	{
+		// The unlinked tile borders are walls for the search too.
+		for (int z = 0; z < cells * 4; ++z)
+		{
+			for (int x = 0; x < cells * 4; ++x)
+			{
+				const float pos[3] = { (x + 0.5f) * 0.25f, 0.0f, (z + 0.5f) * 0.25f };
+				dtPolyRef ref = 0;
+				float nearest[3];
+				query->findNearestPoly(pos, halfExtents, &filter, &ref, nearest);
+				if (!ref)
+					continue;
+				float exact = 0, hitPos[3], hitNormal[3];
+				REQUIRE(dtStatusSucceed(query->findDistanceToWall(ref, pos, 100.0f, &filter, &exact, hitPos, hitNormal)));
+				float dist = 0;
+				REQUIRE(dtStatusSucceed(query->getWallDistance(ref, pos, &dist)));
+				REQUIRE(dtAbs(dist - exact) <= 0.5f);
+			}
+		}
+	}
+
+	SECTION("Tiles without wall distances fail")
+	{
+		dtNavMesh* plainNav = TestNavMesh::createGrid(1, 1, cells, isPillarCell);
+		REQUIRE(plainNav);
+		dtNavMeshQuery* plainQuery = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(plainQuery->init(plainNav, 64)));
+		const float pos[3] = { 1.5f, 0.0f, 1.5f };
+		dtPolyRef ref = 0;
+		float nearest[3];
+		REQUIRE(dtStatusSucceed(plainQuery->findNearestPoly(pos, halfExtents, &filter, &ref, nearest)));
+		float dist = 0;
+		REQUIRE(dtStatusFailed(plainQuery->getWallDistance(ref, pos, &dist)));
+		dtFreeNavMeshQuery(plainQuery);
+		dtFreeNavMesh(plainNav);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+namespace
+{
+// Creates a tile of 16 rows of quads, the quads of a row are 1, 2, 4 or 8 cells wide.
+unsigned char* createUnevenTileData(int bvTreeSplit, bool wideBvTree, int* dataSize)
+{
+	const int nvp = 4;
+	std::vector<unsigned short> verts;
+	std::vector<unsigned short> polys;
+	for (int z = 0; z < 16; ++z)
+	{
+		const int width = 1 << (z % 4);
+		for (int x = 0; x < 32; x += width)
+		{
+			const unsigned short base = (unsigned short)(verts.size() / 3);
+			const int corners[4][2] = { { x, z }, { x, z + 1 }, { x + width, z + 1 }, { x + width, z } };
+			for (int i = 0; i < 4; ++i)
+			{
+				verts.push_back((unsigned short)(corners[i][0] * 4));
+				verts.push_back((unsigned short)(z % 3));
+				verts.push_back((unsigned short)(corners[i][1] * 4));
+			}
+			for (int i = 0; i < nvp; ++i)
+				polys.push_back((unsigned short)(base + i));
+			for (int i = 0; i < nvp; ++i)
+				polys.push_back(0xffff);
+		}
+	}
+	const int npolys = (int)polys.size() / (nvp * 2);
+	std::vector<unsigned short> flags(npolys, 1);
+	std::vector<unsigned char> areas(npolys, 0);
+
+	dtNavMeshCreateParams params;
+	memset(&params, 0, sizeof(params));
+	params.verts = &verts[0];
+	params.vertCount = (int)verts.size() / 3;
+	params.polys = &polys[0];
+	params.polyAreas = &areas[0];
+	params.polyFlags = &flags[0];
+	params.polyCount = npolys;
+	params.nvp = nvp;
+	params.walkableHeight = 2.0f;
+	params.walkableRadius = 0.5f;
+	params.walkableClimb = 0.5f;
+	params.bmax[0] = 32.0f;
+	params.bmax[1] = 1.0f;
+	params.bmax[2] = 16.0f;
+	params.cs = 0.25f;
+	params.ch = 0.25f;
+	params.buildBvTree = true;
+	params.buildWideBvTree = wideBvTree;
+	params.bvTreeSplit = bvTreeSplit;
+
+	unsigned char* data = 0;
+	if (!dtCreateNavMeshData(&params, &data, dataSize))
+		return 0;
+	return data;
+}
+} // anonymous namespace
+
+TEST_CASE("BV tree splits", "[detour]")
+{
+	// Binary and wide trees with median and surface area heuristic splits.
+	const int splits[4] = { DT_BVTREE_SPLIT_MEDIAN, DT_BVTREE_SPLIT_MEDIAN, DT_BVTREE_SPLIT_SAH, DT_BVTREE_SPLIT_SAH };
+	dtNavMesh* navs[4];
+	dtNavMeshQuery* queries[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		int dataSize = 0;
+		unsigned char* data = createUnevenTileData(splits[i], (i % 2) == 1, &dataSize);
+		REQUIRE(data);
+		navs[i] = TestNavMesh::createNavMesh(1, 1, 32);
+		REQUIRE(navs[i]);
+		REQUIRE(dtStatusSucceed(navs[i]->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, 0)));
+		queries[i] = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(queries[i]->init(navs[i], 64)));
+	}
+
+	// Every polygon is in one leaf of the binary tree.
+	const dtMeshTile* sahTile = static_cast<const dtNavMesh*>(navs[2])->getTileAt(0, 0, 0);
+	const int polyCount = sahTile->header->polyCount;
+	REQUIRE(sahTile->header->bvNodeCount == polyCount * 2 - 1);
+	std::vector<int> leafCounts(polyCount, 0);
+	for (int i = 0; i < sahTile->header->bvNodeCount; ++i)
+	{
+		if (sahTile->bvTree[i].i >= 0)
+			leafCounts[sahTile->bvTree[i].i]++;
+	}
+	for (int i = 0; i < polyCount; ++i)
+		REQUIRE(leafCounts[i] == 1);
+	REQUIRE(static_cast<const dtNavMesh*>(navs[3])->getTileAt(0, 0, 0)->bvWideTree);
+
+	dtQueryFilter filter;
+	unsigned int seed = 1234;
+	for (int i = 0; i < 200; ++i)
+	{
+		float center[3], halfExtents[3];
+		for (int j = 0; j < 3; ++j)
+		{
+			seed = seed * 1103515245u + 12345u;
+			center[j] = ((seed >> 8) % 3400) / 100.0f - 1.0f;
+			seed = seed * 1103515245u + 12345u;
+			halfExtents[j] = ((seed >> 8) % 300) / 100.0f;
+		}
+		center[1] = 0.5f;
+
+		static const int MAX_POLYS = 512;
+		std::vector<dtPolyRef> found[4];
+		for (int k = 0; k < 4; ++k)
+		{
+			dtPolyRef polys[MAX_POLYS];
+			int count = 0;
+			REQUIRE(dtStatusSucceed(queries[k]->queryPolygons(center, halfExtents, &filter, polys, &count, MAX_POLYS)));
+			found[k].assign(polys, polys + count);
+		}
+		// The trees of the same split visit the polygons in the same order.
+		REQUIRE(found[0] == found[1]);
+		REQUIRE(found[2] == found[3]);
+		std::sort(found[0].begin(), found[0].end());
+		std::sort(found[2].begin(), found[2].end());
+		REQUIRE(found[0] == found[2]);
+	}
+
+	for (int i = 0; i < 4; ++i)
+	{
+		dtFreeNavMeshQuery(queries[i]);
+		dtFreeNavMesh(navs[i]);
+	}
+}
+
+TEST_CASE("Tile data in caller buffers", "[detour]")
+{
+	// A row of two quads with an off-mesh connection, a wide BV tree and wall distances.
+	unsigned short verts[6 * 3] = { 0,0,0, 0,0,16, 16,0,16, 16,0,0, 32,0,16, 32,0,0 };
+	unsigned short polys[2 * 8] = {
+		0,1,2,3, 0xffff,0xffff,1,0xffff,
+		3,2,4,5, 0,0xffff,0xffff,0xffff
+	};
+	unsigned short flags[2] = { 1, 1 };
+	unsigned char areas[2] = { 0, 0 };
+	float offMeshConVerts[6] = { 1.0f, 0.0f, 1.0f, 7.0f, 0.0f, 3.0f };
+	float offMeshConRad = 0.5f;
+	unsigned char offMeshConDir = 1;
+	unsigned char offMeshConArea = 0;
+	unsigned short offMeshConFlags = 1;
+
+	dtNavMeshCreateParams params;
+	memset(&params, 0, sizeof(params));
+	params.verts = verts;
+	params.vertCount = 6;
+	params.polys = polys;
+	params.polyAreas = areas;
+	params.polyFlags = flags;
+	params.polyCount = 2;
+	params.nvp = 4;
+	params.offMeshConVerts = offMeshConVerts;
+	params.offMeshConRad = &offMeshConRad;
+	params.offMeshConDir = &offMeshConDir;
+	params.offMeshConAreas = &offMeshConArea;
+	params.offMeshConFlags = &offMeshConFlags;
+	params.offMeshConCount = 1;
+	params.walkableHeight = 2.0f;
+	params.walkableRadius = 0.5f;
+	params.walkableClimb = 0.5f;
+	params.bmax[0] = 8.0f;
+	params.bmax[1] = 1.0f;
+	params.bmax[2] = 4.0f;
+	params.cs = 0.25f;
+	params.ch = 0.25f;
+	params.buildBvTree = true;
+	params.buildWideBvTree = true;
+	params.buildWallDistances = true;
+
+	unsigned char* created = 0;
+	int createdSize = 0;
+	REQUIRE(dtCreateNavMeshData(&params, &created, &createdSize));
+
+	int size = 0;
+	REQUIRE(dtCalcNavMeshDataSize(&params, &size));
+	REQUIRE(size == createdSize);
+
+	// The tile is written to a slot of an arena, and matches the allocated tile data.
+	const int slot = 64;
+	std::vector<unsigned int> arena((slot + size + 64) / 4, 0xdeadbeefu);
+	unsigned char* buffer = (unsigned char*)&arena[0] + slot;
+	int written = 0;
+	REQUIRE(!dtWriteNavMeshData(&params, buffer, size - 1, &written));
+	REQUIRE(!dtWriteNavMeshData(&params, buffer + 1, size + 4, &written));
+	REQUIRE(dtWriteNavMeshData(&params, buffer, size + 4, &written));
+	REQUIRE(written == size);
+	REQUIRE(memcmp(buffer, created, size) == 0);
+	REQUIRE(arena[(slot + size) / 4 + 1] == 0xdeadbeefu);
+	dtFree(created);
+
+	// The nav mesh uses the buffer in place and leaves it to the caller.
+	dtNavMesh* nav = TestNavMesh::createNavMesh(1, 1, 8);
+	REQUIRE(nav);
+	dtTileRef tileRef = 0;
+	REQUIRE(dtStatusSucceed(nav->addTile(buffer, written, 0, 0, &tileRef)));
+	REQUIRE(nav->getTileByRef(tileRef)->header == (const dtMeshHeader*)buffer);
+
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(query);
+	REQUIRE(dtStatusSucceed(query->init(nav, 64)));
+	dtQueryFilter filter;
+	const float center[3] = { 6.0f, 0.0f, 2.0f };
+	const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+	dtPolyRef ref = 0;
+	float nearest[3];
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(center, halfExtents, &filter, &ref, nearest)));
+	REQUIRE(ref);
+
+	unsigned char* removedData = 0;
+	REQUIRE(dtStatusSucceed(nav->removeTile(tileRef, &removedData, 0)));
+	REQUIRE(removedData == buffer);
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+namespace
+{
+// A wall in the middle of every tile of 8 cells, so that all tiles are the same.
+bool isRoomBlocked(int cellX, int cellZ)
+{
+	const int x = cellX % 8;
+	const int z = cellZ % 8;
+	return x >= 2 && x < 6 && z == 4;
+}
+} // anonymous namespace
+
+TEST_CASE("dtNavMesh::addTileInstance", "[detour]")
+{
+	static const int CELLS = 8;
+	static const int TILES_X = 3;
+	static const int TILES_Y = 2;
+	const float tileSize = CELLS * TestNavMesh::CELL_SIZE;
+	const bool quantizeVerts = GENERATE(false, true);
+
+	// A connection over the wall of each tile.
+	float conVerts[TILES_X * TILES_Y][6];
+	for (int i = 0; i < TILES_X * TILES_Y; ++i)
+	{
+		const float x = (i % TILES_X) * tileSize;
+		const float z = (i / TILES_X) * tileSize;
+		const float verts[6] = { x + 3.5f, -1.0f, z + 3.5f, x + 3.5f, -1.0f, z + 5.5f };
+		memcpy(conVerts[i], verts, sizeof(verts));
+	}
+
+	int sharedSize = 0;
+	unsigned char* shared = TestNavMesh::createTileData(0, 0, CELLS, isRoomBlocked, &sharedSize, false,
+														quantizeVerts, conVerts[0], 1, true);
+	REQUIRE(shared);
+	const std::vector<unsigned char> original(shared, shared + sharedSize);
+
+	// The same tiles built one by one.
+	dtNavMesh* reference = TestNavMesh::createNavMesh(TILES_X, TILES_Y, CELLS);
+	REQUIRE(reference);
+	for (int i = 0; i < TILES_X * TILES_Y; ++i)
+	{
+		int dataSize = 0;
+		unsigned char* data = TestNavMesh::createTileData(i % TILES_X, i / TILES_X, CELLS, isRoomBlocked, &dataSize,
+														  false, quantizeVerts, conVerts[i], 1, true);
+		REQUIRE(data);
+		REQUIRE(dtStatusSucceed(reference->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, 0)));
+	}
+
+	TestNavMesh::CountingAllocator allocator;
+	dtNavMesh* nav = TestNavMesh::createNavMesh(TILES_X, TILES_Y, CELLS, 0, &allocator);
+	REQUIRE(nav);
+	const int emptyLive = allocator.live;
+	dtTileRef refs[TILES_X * TILES_Y];
+	for (int i = 0; i < TILES_X * TILES_Y; ++i)
+	{
+		const float offset[3] = { (i % TILES_X) * tileSize, 0.0f, (i / TILES_X) * tileSize };
+		REQUIRE(dtStatusSucceed(nav->addTileInstance(shared, sharedSize, offset, 0, &refs[i])));
+	}
+	REQUIRE(allocator.live == emptyLive + TILES_X * TILES_Y);
+
+	// The instances match the tiles built at their locations.
+	for (int i = 0; i < TILES_X * TILES_Y; ++i)
+	{
+		const dtMeshTile* expected = reference->getTileAt(i % TILES_X, i / TILES_X, 0);
+		const dtMeshTile* tile = nav->getTileAt(i % TILES_X, i / TILES_X, 0);
+		REQUIRE(expected);
+		REQUIRE(tile);
+		REQUIRE(nav->getTileRef(tile) == refs[i]);
+		REQUIRE((tile->flags & DT_TILE_INSTANCE) != 0);
+		REQUIRE(tile->sharedData == shared);
+		REQUIRE(tile->dataSize < sharedSize);
+		REQUIRE(dtVdist(tile->header->bmin, expected->header->bmin) == 0.0f);
+		REQUIRE(tile->header->vertCount == expected->header->vertCount);
+		for (int j = 0; j < tile->header->vertCount; ++j)
+		{
+			float a[3], b[3];
+			dtGetTileVertex(tile, j, a);
+			dtGetTileVertex(expected, j, b);
+			REQUIRE(dtVdist(a, b) < 1e-4f);
+		}
+		REQUIRE(tile->linkCount == expected->linkCount);
+		REQUIRE(tile->header->offMeshConCount == 1);
+		REQUIRE(dtVdist(tile->offMeshCons[0].pos, expected->offMeshCons[0].pos) < 1e-4f);
+		REQUIRE(dtVdist(&tile->offMeshCons[0].pos[3], &expected->offMeshCons[0].pos[3]) < 1e-4f);
+		REQUIRE(tile->header->wallDistGridCount == expected->header->wallDistGridCount);
+		for (int j = 0; j < tile->header->wallDistGridCount; ++j)
+		{
+			REQUIRE(tile->wallDistGrids[j].bmin[0] == Catch::Approx(expected->wallDistGrids[j].bmin[0]));
+			REQUIRE(tile->wallDistGrids[j].bmin[1] == Catch::Approx(expected->wallDistGrids[j].bmin[1]));
+		}
+	}
+
+	// Paths through the instances are the same as through the tiles.
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	dtNavMeshQuery* referenceQuery = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+	REQUIRE(dtStatusSucceed(referenceQuery->init(reference, 2048)));
+	const dtQueryFilter filter;
+	const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+	const float start[3] = { 0.5f, 0.0f, 0.5f };
+	const float end[3] = { TILES_X * tileSize - 0.5f, 0.0f, TILES_Y * tileSize - 0.5f };
+	dtPolyRef path[2][256];
+	int pathCount[2] = { 0, 0 };
+	dtNavMeshQuery* queries[2] = { query, referenceQuery };
+	for (int k = 0; k < 2; ++k)
+	{
+		dtPolyRef startRef = 0, endRef = 0;
+		float nearest[3];
+		REQUIRE(dtStatusSucceed(queries[k]->findNearestPoly(start, halfExtents, &filter, &startRef, nearest)));
+		REQUIRE(dtStatusSucceed(queries[k]->findNearestPoly(end, halfExtents, &filter, &endRef, nearest)));
+		REQUIRE(dtStatusSucceed(queries[k]->findPath(startRef, endRef, start, end, &filter, path[k], &pathCount[k], 256)));
+	}
+	REQUIRE(pathCount[0] > 2 * (TILES_X + TILES_Y));
+	REQUIRE(pathCount[0] == pathCount[1]);
+	REQUIRE(std::equal(path[0], path[0] + pathCount[0], path[1]));
+
+	// Flags are per instance.
+	const dtMeshTile* first = nav->getTileAt(0, 0, 0);
+	REQUIRE(dtStatusSucceed(nav->setPolyFlags(nav->getPolyRefBase(first), 0)));
+	unsigned short polyFlags = 0;
+	REQUIRE(dtStatusSucceed(nav->getPolyFlags(nav->getPolyRefBase(nav->getTileAt(1, 0, 0)), &polyFlags)));
+	REQUIRE(polyFlags == 1);
+
+	// The shared data is left as it was.
+	REQUIRE(std::equal(original.begin(), original.end(), shared));
+
+	SECTION("Invalid placements")
+	{
+		const float offGrid[3] = { 0.5f * tileSize, 0.0f, 0.0f };
+		REQUIRE(nav->addTileInstance(shared, sharedSize, offGrid, 0, 0) == (DT_FAILURE | DT_INVALID_PARAM));
+		const float occupied[3] = { tileSize, 0.0f, 0.0f };
+		REQUIRE(dtStatusDetail(nav->addTileInstance(shared, sharedSize, occupied, 0, 0), DT_ALREADY_OCCUPIED));
+		REQUIRE(allocator.live == emptyLive + TILES_X * TILES_Y);
+	}
+
+	SECTION("Memory stats")
+	{
+		dtNavMeshMemStats stats;
+		nav->getTileMemStats(first, &stats);
+		REQUIRE(stats.total == (size_t)first->dataSize);
+		REQUIRE(stats.bvTree == 0);
+	}
+
+	SECTION("Instances are not stored in files")
+	{
+		unsigned char* file = 0;
+		size_t fileSize = 0;
+		REQUIRE(dtStatusSucceed(dtCreateNavMeshFile(nav, &file, &fileSize, DT_NAVMESH_FILE_PAGE_SIZE)));
+		const dtNavMeshFileHeader* header = 0;
+		REQUIRE(dtStatusSucceed(dtGetNavMeshFileTiles(file, fileSize, &header, 0)));
+		REQUIRE(header->tileCount == 0);
+		dtFree(file);
+	}
+
+	SECTION("Removed instances free the instance data")
+	{
+		for (int i = 0; i < TILES_X * TILES_Y; ++i)
+		{
+			unsigned char* data = shared;
+			int dataSize = -1;
+			REQUIRE(dtStatusSucceed(nav->removeTile(refs[i], &data, &dataSize)));
+			REQUIRE(data == 0);
+			REQUIRE(dataSize == 0);
+		}
+		REQUIRE(allocator.live == emptyLive);
+		REQUIRE(std::equal(original.begin(), original.end(), shared));
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMeshQuery(referenceQuery);
+	dtFreeNavMesh(nav);
+	dtFreeNavMesh(reference);
+	dtFree(shared);
+}
+
+namespace
+{
+// Adds the tile at (tx, ty) as the specified layer.
+dtTileRef addLayerTile(dtNavMesh* nav, const int tx, const int ty, const int layer)
+{
+	int dataSize = 0;
+	unsigned char* data = TestNavMesh::createTileData(tx, ty, 2, 0, &dataSize);
+	if (!data)
+		return 0;
+	((dtMeshHeader*)data)->layer = layer;
+	dtTileRef ref = 0;
+	if (dtStatusFailed(nav->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, &ref)))
+	{
+		dtFree(data);
+		return 0;
+	}
+	return ref;
+}
+
+// Requires both nav meshes to find the same tile locations, the tiles of a location in any order.
+void requireSameTileLookup(const dtNavMesh* a, const dtNavMesh* b)
+{
+	for (int y = -1; y <= 3; ++y)
+	{
+		for (int x = -1; x <= 3; ++x)
+		{
+			for (int layer = -1; layer <= 10; ++layer)
+			{
+				const dtMeshTile* tileA = a->getTileAt(x, y, layer);
+				const dtMeshTile* tileB = b->getTileAt(x, y, layer);
+				REQUIRE((tileA != 0) == (tileB != 0));
+				if (tileA)
+					REQUIRE(a->getTileRef(tileA) == b->getTileRef(tileB));
+			}
+
+			const dtMeshTile* tilesA[16];
+			const dtMeshTile* tilesB[16];
+			const int countA = a->getTilesAt(x, y, tilesA, 16);
+			const int countB = b->getTilesAt(x, y, tilesB, 16);
+			REQUIRE(countA == countB);
+			std::vector<dtTileRef> refsA, refsB;
+			for (int i = 0; i < countA; ++i)
+			{
+				REQUIRE(tilesA[i]->header->x == x);
+				REQUIRE(tilesA[i]->header->y == y);
+				refsA.push_back(a->getTileRef(tilesA[i]));
+				refsB.push_back(b->getTileRef(tilesB[i]));
+			}
+			std::sort(refsA.begin(), refsA.end());
+			std::sort(refsB.begin(), refsB.end());
+			REQUIRE(refsA == refsB);
+		}
+	}
+}
+}
+
+TEST_CASE("dtNavMesh::setTileGrid", "[detour]")
+{
+	const int layers = 10;
+	const int navMeshFlags = GENERATE(0, (int)DT_NAVMESH_SPARSE_TILES);
+	dtNavMesh* nav = TestNavMesh::createNavMesh(2, 2 * layers, 2, navMeshFlags);
+	dtNavMesh* reference = TestNavMesh::createNavMesh(2, 2 * layers, 2, navMeshFlags);
+	REQUIRE(nav);
+	REQUIRE(reference);
+
+	SECTION("Invalid grids are rejected")
+	{
+		REQUIRE(nav->setTileGrid(0, 0, -1, 1, 1) == (DT_FAILURE | DT_INVALID_PARAM));
+		REQUIRE(nav->setTileGrid(0, 0, 2, 2, 0) == (DT_FAILURE | DT_INVALID_PARAM));
+		REQUIRE(nav->setTileGrid(0, 0, 0, 0, 0) == DT_SUCCESS);
+	}
+
+	SECTION("The grid finds the same tiles as the hash lookup")
+	{
+		// The grid covers the first row with 4 layers, the other tiles are in the hash lookup only.
+		const bool gridFirst = GENERATE(true, false);
+		if (gridFirst)
+			REQUIRE(dtStatusSucceed(nav->setTileGrid(0, 0, 2, 1, 4)));
+		for (int layer = 0; layer < layers; ++layer)
+		{
+			for (int y = 0; y < 2; ++y)
+			{
+				for (int x = 0; x < 2; ++x)
+				{
+					REQUIRE(addLayerTile(nav, x, y, layer));
+					REQUIRE(addLayerTile(reference, x, y, layer));
+				}
+			}
+		}
+		if (!gridFirst)
+			REQUIRE(dtStatusSucceed(nav->setTileGrid(0, 0, 2, 1, 4)));
+		requireSameTileLookup(nav, reference);
+
+		// Removing the tiles updates the grid and the tiles outside of it.
+		for (int layer = 0; layer < layers; layer += 3)
+		{
+			REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(0, 0, layer), 0, 0)));
+			REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(1, 1, layer), 0, 0)));
+			REQUIRE(dtStatusSucceed(reference->removeTile(reference->getTileRefAt(0, 0, layer), 0, 0)));
+			REQUIRE(dtStatusSucceed(reference->removeTile(reference->getTileRefAt(1, 1, layer), 0, 0)));
+		}
+		requireSameTileLookup(nav, reference);
+
+		// The grid can be removed again.
+		REQUIRE(dtStatusSucceed(nav->setTileGrid(0, 0, 0, 0, 0)));
+		requireSameTileLookup(nav, reference);
+	}
+
+	SECTION("Without tiles outside of the grid the layers are returned in layer order")
+	{
+		REQUIRE(dtStatusSucceed(nav->setTileGrid(0, 0, 2, 2, layers)));
+		for (int layer = layers - 1; layer >= 0; --layer)
+			REQUIRE(addLayerTile(nav, 1, 1, layer));
+
+		const dtMeshTile* tiles[16];
+		REQUIRE(nav->getTilesAt(1, 1, tiles, 16) == layers);
+		for (int i = 0; i < layers; ++i)
+			REQUIRE(tiles[i]->header->layer == i);
+		REQUIRE(nav->getTilesAt(1, 1, tiles, 3) == 3);
+		REQUIRE(nav->getTilesAt(0, 1, tiles, 16) == 0);
+		REQUIRE(nav->getTileAt(1, 1, 7)->header->layer == 7);
+		REQUIRE(!nav->getTileAt(1, 1, layers));
+
+		// The grid is part of the memory of the tiles.
+		dtNavMeshMemStats withGrid, withoutGrid;
+		nav->getMemStats(&withGrid);
+		REQUIRE(dtStatusSucceed(nav->setTileGrid(0, 0, 0, 0, 0)));
+		nav->getMemStats(&withoutGrid);
+		REQUIRE(withGrid.tiles - withoutGrid.tiles == sizeof(dtMeshTile*) * 4 * layers + sizeof(unsigned short) * 4);
+	}
+
+	dtFreeNavMesh(nav);
+	dtFreeNavMesh(reference);
+}
+
+namespace
+{
+dtTileRef addPendingTile(dtNavMesh* nav, const int tx, const int ty)
+{
+	int dataSize = 0;
+	unsigned char* data = TestNavMesh::createTileData(tx, ty, 2, 0, &dataSize);
+	dtTileRef ref = 0;
+	if (!data || dtStatusFailed(nav->addTile(data, dataSize, DT_TILE_FREE_DATA | DT_TILE_PENDING_LINKS, 0, &ref)))
+	{
+		dtFree(data);
+		return 0;
+	}
+	return ref;
+}
+
+int getLinkCount(const dtNavMesh* nav)
+{
+	dtNavMeshLinkStats stats;
+	nav->getLinkStats(&stats);
+	return stats.linkCount;
+}
+} // anonymous namespace
+
+TEST_CASE("dtNavMesh pending tile links", "[detour]")
+{
+	dtNavMesh* reference = TestNavMesh::createGrid(3, 3, 2);
+	dtNavMesh* nav = TestNavMesh::createNavMesh(3, 3, 2);
+	REQUIRE(reference);
+	REQUIRE(nav);
+
+	// The center tile is connected right away, the tiles around it are pending.
+	TestNavMesh::addTile(nav, 1, 1, 2);
+	const int centerLinks = getLinkCount(nav);
+	for (int y = 0; y < 3; ++y)
+		for (int x = 0; x < 3; ++x)
+			if (x != 1 || y != 1)
+				REQUIRE(addPendingTile(nav, x, y));
+	CHECK(nav->getPendingTileCount() == 8);
+	CHECK(getLinkCount(nav) == centerLinks * 9);
+	CHECK(nav->getTileAt(0, 0, 0)->flags & DT_TILE_PENDING_LINKS);
+
+	SECTION("Connecting the pending tiles gives the same links")
+	{
+		const unsigned int epoch = nav->getEpoch();
+		int connected = 0;
+		REQUIRE(nav->connectPendingTiles(3, &connected) == (DT_SUCCESS | DT_IN_PROGRESS));
+		CHECK(connected == 3);
+		CHECK(nav->getPendingTileCount() == 5);
+		CHECK(nav->getEpoch() == epoch + 3);
+		CHECK(!(nav->getTileAt(0, 0, 0)->flags & DT_TILE_PENDING_LINKS));
+		CHECK(nav->getTileAt(2, 2, 0)->flags & DT_TILE_PENDING_LINKS);
+
+		REQUIRE(nav->connectPendingTiles(100, &connected) == DT_SUCCESS);
+		CHECK(connected == 5);
+		CHECK(nav->getPendingTileCount() == 0);
+		CHECK(getLinkCount(nav) == getLinkCount(reference));
+		REQUIRE(nav->connectPendingTiles(1, &connected) == DT_SUCCESS);
+		CHECK(connected == 0);
+		CHECK(nav->connectPendingTiles(0) == (DT_FAILURE | DT_INVALID_PARAM));
+	}
+
+	SECTION("Removed pending tiles are not connected")
+	{
+		REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(0, 0, 0), 0, 0)));
+		CHECK(nav->getPendingTileCount() == 7);
+		REQUIRE(addPendingTile(nav, 0, 0));
+		CHECK(nav->getPendingTileCount() == 8);
+		REQUIRE(nav->connectPendingTiles(8) == DT_SUCCESS);
+		CHECK(getLinkCount(nav) == getLinkCount(reference));
+	}
+
+	dtFreeNavMesh(nav);
+	dtFreeNavMesh(reference);
+}
+
+TEST_CASE("Multi-goal findPath", "[detour]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(3, 3, 8, isWallBlocked);
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+	dtQueryFilter filter;
+
+	// The goals are listed from the most to the least expensive one.
+	static const int GOAL_COUNT = 4;
+	const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+	const float startPos[3] = { 0.5f, 0.0f, 0.5f };
+	const float goalPositions[GOAL_COUNT * 3] = {
+		23.5f, 0.0f, 0.5f,
+		12.5f, 0.0f, 12.5f,
+		5.5f, 0.0f, 20.5f,
+		0.5f, 0.0f, 12.5f,
+	};
+	dtPolyRef startRef = 0;
+	dtPolyRef goalRefs[GOAL_COUNT];
+	float nearest[3];
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, nearest)));
+	for (int i = 0; i < GOAL_COUNT; ++i)
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(&goalPositions[i * 3], halfExtents, &filter, &goalRefs[i], nearest)));
+
+	// The cost of each goal on its own.
+	float costs[GOAL_COUNT];
+	for (int i = 0; i < GOAL_COUNT; ++i)
+	{
+		int goal = -1, count = 0;
+		REQUIRE(dtStatusSucceed(query->findNearestGoals(startRef, startPos, &goalRefs[i], &goalPositions[i * 3], 1,
+														&filter, &goal, &costs[i], &count, 1)));
+		REQUIRE(count == 1);
+		REQUIRE(goal == 0);
+	}
+	for (int i = 1; i < GOAL_COUNT; ++i)
+		REQUIRE(costs[i] < costs[i - 1]);
+
+	static const int MAX_PATH = 256;
+	dtPolyRef path[MAX_PATH];
+	int pathCount = 0;
+
+	SECTION("Path to the cheapest goal")
+	{
+		int goal = -1;
+		const dtStatus status = query->findPathToNearest(startRef, startPos, goalRefs, goalPositions, GOAL_COUNT,
+														 &filter, path, &pathCount, MAX_PATH, &goal);
+		REQUIRE(status == DT_SUCCESS);
+		REQUIRE(goal == 3);
+		REQUIRE(path[0] == startRef);
+		REQUIRE(path[pathCount - 1] == goalRefs[3]);
+		for (int i = 0; i < pathCount - 1; ++i)
+			REQUIRE(isLinked(nav, path[i], path[i + 1]));
+
+		dtPolyRef singlePath[MAX_PATH];
+		int singleCount = 0;
+		REQUIRE(dtStatusSucceed(query->findPath(startRef, goalRefs[3], startPos, &goalPositions[9], &filter,
+												singlePath, &singleCount, MAX_PATH)));
+		REQUIRE(singleCount == pathCount);
+	}
+
+	SECTION("Cheapest goals in order")
+	{
+		int goals[GOAL_COUNT];
+		float goalCosts[GOAL_COUNT];
+		int count = 0;
+		REQUIRE(dtStatusSucceed(query->findNearestGoals(startRef, startPos, goalRefs, goalPositions, GOAL_COUNT,
+														&filter, goals, goalCosts, &count, GOAL_COUNT)));
+		REQUIRE(count == GOAL_COUNT);
+		for (int i = 0; i < GOAL_COUNT; ++i)
+		{
+			REQUIRE(goals[i] == GOAL_COUNT - 1 - i);
+			REQUIRE(goalCosts[i] == Catch::Approx(costs[goals[i]]).epsilon(0.05));
+		}
+
+		// The paths to the goals found are kept by the query.
+		REQUIRE(dtStatusSucceed(query->getPathFromDijkstraSearch(goalRefs[1], path, &pathCount, MAX_PATH)));
+		REQUIRE(path[0] == startRef);
+		REQUIRE(path[pathCount - 1] == goalRefs[1]);
+
+		// Fewer goals stop the search earlier.
+		const int fullNodes = query->getNodePool()->getNodeCount();
+		REQUIRE(dtStatusSucceed(query->findNearestGoals(startRef, startPos, goalRefs, goalPositions, GOAL_COUNT,
+														&filter, goals, goalCosts, &count, 2)));
+		REQUIRE(count == 2);
+		REQUIRE(goals[0] == 3);
+		REQUIRE(goals[1] == 2);
+		REQUIRE(query->getNodePool()->getNodeCount() < fullNodes);
+	}
+
+	SECTION("Unreachable goals")
+	{
+		REQUIRE(dtStatusSucceed(nav->setPolyFlags(goalRefs[3], 2)));
+		filter.setIncludeFlags(1);
+		int goals[GOAL_COUNT];
+		float goalCosts[GOAL_COUNT];
+		int count = 0;
+		REQUIRE(dtStatusSucceed(query->findNearestGoals(startRef, startPos, goalRefs, goalPositions, GOAL_COUNT,
+														&filter, goals, goalCosts, &count, GOAL_COUNT)));
+		REQUIRE(count == GOAL_COUNT - 1);
+		REQUIRE(goals[0] == 2);
+
+		int goal = 0;
+		const dtStatus status = query->findPathToNearest(startRef, startPos, &goalRefs[3], &goalPositions[9], 1,
+														 &filter, path, &pathCount, MAX_PATH, &goal);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(goal == -1);
+		REQUIRE(path[0] == startRef);
+	}
+
+	SECTION("Sliced search finds the same path")
+	{
+		int goal = -1;
+		REQUIRE(dtStatusSucceed(query->findPathToNearest(startRef, startPos, goalRefs, goalPositions, GOAL_COUNT,
+														 &filter, path, &pathCount, MAX_PATH, &goal)));
+		REQUIRE(dtStatusInProgress(query->initSlicedFindPathToNearest(startRef, startPos, goalRefs, goalPositions,
+																	  GOAL_COUNT, &filter)));
+		dtStatus sliced = DT_IN_PROGRESS;
+		while (dtStatusInProgress(sliced))
+			sliced = query->updateSlicedFindPath(3, 0);
+		REQUIRE(sliced == DT_SUCCESS);
+		dtPolyRef slicedPath[MAX_PATH];
+		int slicedCount = 0, slicedGoal = -1;
+		REQUIRE(query->finalizeSlicedFindPathToNearest(slicedPath, &slicedCount, MAX_PATH, &slicedGoal) == DT_SUCCESS);
+		REQUIRE(slicedGoal == goal);
+		REQUIRE(slicedCount == pathCount);
+		for (int i = 0; i < slicedCount; ++i)
+			REQUIRE(slicedPath[i] == path[i]);
+	}
+
+	SECTION("Invalid parameters")
+	{
+		int goal = 0;
+		REQUIRE(query->findPathToNearest(startRef, startPos, goalRefs, goalPositions, 0, &filter,
+										 path, &pathCount, MAX_PATH, &goal) == (DT_FAILURE | DT_INVALID_PARAM));
+		REQUIRE(goal == -1);
+		const dtPolyRef badRefs[2] = { goalRefs[0], 0 };
+		REQUIRE(dtStatusFailed(query->findPathToNearest(startRef, startPos, badRefs, goalPositions, 2, &filter,
+														path, &pathCount, MAX_PATH)));
+		REQUIRE(dtStatusFailed(query->initSlicedFindPathToNearest(startRef, startPos, 0, goalPositions, 1, &filter)));
+		int count = 0;
+		REQUIRE(dtStatusFailed(query->findNearestGoals(startRef, startPos, goalRefs, goalPositions, GOAL_COUNT,
+													   &filter, &goal, 0, &count, 1)));
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtNavMeshQuery::findDistances", "[detour]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(3, 3, 8, isWallBlocked);
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+	dtQueryFilter filter;
+
+	// Targets on a lattice across the grid, some of them inside the walls.
+	const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+	const float startPos[3] = { 0.5f, 0.0f, 0.5f };
+	dtPolyRef startRef = 0;
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, 0)));
+	std::vector<dtPolyRef> targetRefs;
+	std::vector<float> targetPositions;
+	for (int z = 0; z < 24; z += 5)
+	{
+		for (int x = 0; x < 24; x += 5)
+		{
+			const float pos[3] = { x + 0.5f, 0.0f, z + 0.5f };
+			dtPolyRef ref = 0;
+			float nearest[3];
+			query->findNearestPoly(pos, halfExtents, &filter, &ref, nearest);
+			targetRefs.push_back(ref);
+			targetPositions.insert(targetPositions.end(), nearest, nearest + 3);
+		}
+	}
+	const int targetCount = (int)targetRefs.size();
+
+	std::vector<float> costs(targetCount);
+	int reached = 0;
+	REQUIRE(query->findDistances(startRef, startPos, &targetRefs[0], &targetPositions[0], targetCount,
+								 &filter, FLT_MAX, &costs[0], &reached) == DT_SUCCESS);
+
+	SECTION("Costs match the searches to each target")
+	{
+		int expectedReached = 0;
+		for (int i = 0; i < targetCount; ++i)
+		{
+			if (!targetRefs[i])
+			{
+				REQUIRE(costs[i] == FLT_MAX);
+				continue;
+			}
+			expectedReached++;
+			int goal = -1, count = 0;
+			float cost = 0;
+			REQUIRE(dtStatusSucceed(query->findNearestGoals(startRef, startPos, &targetRefs[i], &targetPositions[i * 3], 1,
+															&filter, &goal, &cost, &count, 1)));
+			REQUIRE(count == 1);
+			REQUIRE(costs[i] == Catch::Approx(cost).epsilon(0.05));
+		}
+		REQUIRE(reached == expectedReached);
+	}
+
+	SECTION("Paths to the targets are kept by the query")
+	{
+		const int last = targetCount - 1;
+		REQUIRE(targetRefs[last]);
+		REQUIRE(dtStatusSucceed(query->findDistances(startRef, startPos, &targetRefs[last], 0, 1, &filter, FLT_MAX,
+													 &costs[last])));
+		dtPolyRef path[256];
+		int pathCount = 0;
+		REQUIRE(dtStatusSucceed(query->getPathFromDijkstraSearch(targetRefs[last], path, &pathCount, 256)));
+		REQUIRE(path[0] == startRef);
+		REQUIRE(path[pathCount - 1] == targetRefs[last]);
+		for (int i = 0; i < pathCount - 1; ++i)
+			REQUIRE(isLinked(nav, path[i], path[i + 1]));
+	}
+
+	SECTION("Cost limit")
+	{
+		const float maxCost = 15.0f;
+		std::vector<float> limited(targetCount);
+		int limitedReached = 0;
+		REQUIRE(dtStatusSucceed(query->findDistances(startRef, startPos, &targetRefs[0], &targetPositions[0],
+													 targetCount, &filter, maxCost, &limited[0], &limitedReached)));
+		REQUIRE(limitedReached > 0);
+		REQUIRE(limitedReached < reached);
+		for (int i = 0; i < targetCount; ++i)
+		{
+			if (costs[i] <= maxCost)
+				REQUIRE(limited[i] == Catch::Approx(costs[i]));
+			else
+				REQUIRE(limited[i] == FLT_MAX);
+		}
+	}
+
+	SECTION("Invalid parameters")
+	{
+		REQUIRE(query->findDistances(startRef, startPos, &targetRefs[0], 0, targetCount, &filter, -1.0f,
+									 &costs[0]) == (DT_FAILURE | DT_INVALID_PARAM));
+		REQUIRE(query->findDistances(startRef, startPos, 0, 0, 1, &filter, FLT_MAX,
+									 &costs[0]) == (DT_FAILURE | DT_INVALID_PARAM));
+		REQUIRE(query->findDistances(startRef, startPos, 0, 0, 0, &filter, FLT_MAX, 0) == DT_SUCCESS);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
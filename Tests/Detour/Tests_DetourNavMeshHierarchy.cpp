@@ -0,0 +1,108 @@
+#include "catch2/catch_all.hpp"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshHierarchy.h"
+#include "DetourNavMeshQuery.h"
+
+#include "TestNavMeshUtils.h"
+
+namespace
+{
+// Walls across the grid with alternating gaps, forcing a long serpentine path.
+bool isSerpentineWall(int cellX, int cellZ)
+{
+	if (cellX == 7 || cellX == 23)
+		return cellZ != 31;
+	if (cellX == 15)
+		return cellZ != 0;
+	return false;
+}
+
+bool isPathConnected(const dtNavMesh* nav, const dtPolyRef* path, const int pathCount)
+{
+	for (int i = 0; i + 1 < pathCount; ++i)
+	{
+		const dtMeshTile* tile = 0;
+		const dtPoly* poly = 0;
+		nav->getTileAndPolyByRefUnsafe(path[i], &tile, &poly);
+		bool linked = false;
+		for (unsigned int j = poly->firstLink; j != DT_NULL_LINK; j = tile->links[j].next)
+			linked |= tile->links[j].ref == path[i + 1];
+		if (!linked)
+			return false;
+	}
+	return true;
+}
+} // anonymous namespace
+
+TEST_CASE("dtNavMeshHierarchy", "[detour]")
+{
+	// 8x8 tiles of 4x4 cells.
+	dtNavMesh* nav = TestNavMesh::createGrid(8, 8, 4, isSerpentineWall);
+	REQUIRE(nav);
+
+	dtQueryFilter filter;
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 128)));
+
+	dtNavMeshHierarchy* hierarchy = dtAllocNavMeshHierarchy();
+	REQUIRE(dtStatusSucceed(hierarchy->init(nav, &filter, 512)));
+	int updated = 0;
+	REQUIRE(dtStatusSucceed(hierarchy->update(&updated)));
+	REQUIRE(updated == 64);
+	REQUIRE(dtStatusSucceed(hierarchy->update(&updated)));
+	REQUIRE(updated == 0);
+
+	const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+	const float startPos[3] = { 0.5f, 0.0f, 0.5f };
+	const float endPos[3] = { 31.5f, 0.0f, 0.5f };
+	dtPolyRef startRef = 0, endRef = 0;
+	float nearest[3];
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, nearest)));
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &endRef, nearest)));
+
+	static const int MAX_PATH = 512;
+	dtPolyRef path[MAX_PATH];
+	int pathCount = 0;
+
+	SECTION("The direct search runs out of nodes")
+	{
+		const dtStatus status = query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, MAX_PATH);
+		REQUIRE(dtStatusDetail(status, DT_PARTIAL_RESULT));
+	}
+
+	SECTION("The hierarchical search finds the whole path")
+	{
+		const dtStatus status = hierarchy->findPath(query, startRef, endRef, startPos, endPos, path, &pathCount, MAX_PATH);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(path[0] == startRef);
+		REQUIRE(path[pathCount - 1] == endRef);
+		REQUIRE(isPathConnected(nav, path, pathCount));
+		// Three passes along the grid.
+		REQUIRE(pathCount >= 32 * 3);
+	}
+
+	SECTION("Only changed tiles are re-costed")
+	{
+		// Block the first gap, the path has to end.
+		const dtMeshTile* gapTile = nav->getTileAt(1, 7, 0);
+		REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRef(gapTile), 0, 0)));
+		REQUIRE(dtStatusSucceed(hierarchy->update(&updated)));
+		REQUIRE(updated == 1);
+		dtStatus status = hierarchy->findPath(query, startRef, endRef, startPos, endPos, path, &pathCount, MAX_PATH);
+		REQUIRE(dtStatusDetail(status, DT_PARTIAL_RESULT));
+
+		REQUIRE(TestNavMesh::addTile(nav, 1, 7, 4, isSerpentineWall));
+		REQUIRE(dtStatusSucceed(hierarchy->update(&updated)));
+		REQUIRE(updated == 1);
+		status = hierarchy->findPath(query, startRef, endRef, startPos, endPos, path, &pathCount, MAX_PATH);
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(path[pathCount - 1] == endRef);
+		REQUIRE(isPathConnected(nav, path, pathCount));
+	}
+
+	dtFreeNavMeshHierarchy(hierarchy);
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
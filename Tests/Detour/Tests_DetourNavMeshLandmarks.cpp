@@ -0,0 +1,220 @@
+#include "catch2/catch_all.hpp"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshLandmarks.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNode.h"
+
+#include "TestNavMeshUtils.h"
+
+namespace
+{
+// Walls across the grid with alternating gaps, forcing a long serpentine path.
+bool isSerpentineWall(int cellX, int cellZ)
+{
+	if (cellX == 7 || cellX == 23)
+		return cellZ != 31;
+	if (cellX == 15)
+		return cellZ != 0;
+	return false;
+}
+
+// A wall between the start and the end with a gap at the far side.
+bool isTrapWall(int cellX, int cellZ)
+{
+	return cellX == 16 && cellZ < 28;
+}
+
+const int MAX_PATH = 1024;
+
+// Returns the cost of a polygon path through the portal midpoints, the same as the path searches measure it.
+float getMidpointCost(const dtNavMesh* nav, const float* startPos, const float* endPos,
+					  const dtPolyRef* path, const int pathCount)
+{
+	float pos[3];
+	dtVcopy(pos, startPos);
+	float cost = 0.0f;
+	for (int i = 0; i + 1 < pathCount; ++i)
+	{
+		const dtMeshTile* tile = 0;
+		const dtPoly* poly = 0;
+		nav->getTileAndPolyByRefUnsafe(path[i], &tile, &poly);
+		for (unsigned int j = poly->firstLink; j != DT_NULL_LINK; j = tile->links[j].next)
+		{
+			const dtLink& link = tile->links[j];
+			if (link.ref != path[i + 1])
+				continue;
+			float mid[3];
+			dtVlerp(mid, &tile->verts[poly->verts[link.edge] * 3],
+					&tile->verts[poly->verts[(link.edge + 1) % poly->vertCount] * 3], 0.5f);
+			cost += dtVdist(pos, mid);
+			dtVcopy(pos, mid);
+			break;
+		}
+	}
+	return cost + dtVdist(pos, endPos);
+}
+
+// Returns the length of the straight path of a polygon path, or a negative value if there is none.
+float getPathLength(dtNavMeshQuery* query, const float* startPos, const float* endPos,
+					const dtPolyRef* path, const int pathCount)
+{
+	static float straight[MAX_PATH * 3];
+	int straightCount = 0;
+	if (dtStatusFailed(query->findStraightPath(startPos, endPos, path, pathCount, straight, 0, 0,
+											   &straightCount, MAX_PATH)))
+		return -1.0f;
+	float length = 0.0f;
+	for (int i = 0; i + 1 < straightCount; ++i)
+		length += dtVdist(&straight[i * 3], &straight[(i + 1) * 3]);
+	return length;
+}
+
+// Checks that the landmark bound between cells does not exceed the cost of the path between their centers.
+void checkBounds(const dtNavMesh* nav, dtNavMeshQuery* query, const dtNavMeshLandmarks* landmarks, const dtQueryFilter* filter)
+{
+	static dtPolyRef path[MAX_PATH];
+	const float halfExtents[3] = { 0.25f, 1.0f, 0.25f };
+	for (int i = 0; i < 64; ++i)
+	{
+		const int a = (i * 37) % 1024, b = (i * 101 + 500) % 1024;
+		const float startPos[3] = { (a % 32) + 0.5f, 0.0f, (a / 32) + 0.5f };
+		const float endPos[3] = { (b % 32) + 0.5f, 0.0f, (b / 32) + 0.5f };
+		dtPolyRef startRef = 0, endRef = 0;
+		float nearest[3];
+		query->findNearestPoly(startPos, halfExtents, filter, &startRef, nearest);
+		query->findNearestPoly(endPos, halfExtents, filter, &endRef, nearest);
+		if (!startRef || !endRef)
+			continue;
+
+		const float* startDists = landmarks->getPolyDistances(startRef);
+		const float* endDists = landmarks->getPolyDistances(endRef);
+		REQUIRE(startDists);
+		REQUIRE(endDists);
+		const float bound = landmarks->getLowerBound(startDists, endDists);
+
+		int pathCount = 0;
+		const dtStatus status = query->findPath(startRef, endRef, startPos, endPos, filter, path, &pathCount, MAX_PATH);
+		if (dtStatusDetail(status, DT_PARTIAL_RESULT))
+			continue;
+		REQUIRE(bound > 0.0f);
+		REQUIRE(bound <= getMidpointCost(nav, startPos, endPos, path, pathCount) + 0.001f);
+	}
+}
+} // anonymous namespace
+
+TEST_CASE("dtNavMeshLandmarks", "[detour]")
+{
+	// 8x8 tiles of 4x4 cells.
+	dtNavMesh* nav = TestNavMesh::createGrid(8, 8, 4, isSerpentineWall);
+	REQUIRE(nav);
+
+	dtQueryFilter filter;
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048, 2048)));
+
+	dtNavMeshLandmarks* landmarks = dtAllocNavMeshLandmarks();
+	REQUIRE(dtStatusSucceed(landmarks->init(nav, 4)));
+	int updated = 0;
+	REQUIRE(dtStatusSucceed(landmarks->update(&updated)));
+	REQUIRE(updated == 64);
+	REQUIRE(dtStatusSucceed(landmarks->update(&updated)));
+	REQUIRE(updated == 0);
+	for (int i = 0; i < landmarks->getLandmarkCount(); ++i)
+		REQUIRE(nav->isValidPolyRef(landmarks->getLandmark(i)));
+
+	const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+	const float startPos[3] = { 0.5f, 0.0f, 0.5f };
+	const float endPos[3] = { 31.5f, 0.0f, 0.5f };
+	dtPolyRef startRef = 0, endRef = 0;
+	float nearest[3];
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, nearest)));
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &endRef, nearest)));
+
+	dtPolyRef path[MAX_PATH];
+	int pathCount = 0;
+
+	SECTION("The bounds do not exceed the path lengths")
+	{
+		checkBounds(nav, query, landmarks, &filter);
+	}
+
+	SECTION("Path searches visit fewer nodes with the same result")
+	{
+		// The straight line distance leads the search into the wall.
+		dtNavMesh* trap = TestNavMesh::createGrid(8, 8, 4, isTrapWall);
+		REQUIRE(trap);
+		REQUIRE(dtStatusSucceed(query->init(trap, 2048, 2048)));
+		dtNavMeshLandmarks* trapLandmarks = dtAllocNavMeshLandmarks();
+		REQUIRE(dtStatusSucceed(trapLandmarks->init(trap, 4)));
+		REQUIRE(dtStatusSucceed(trapLandmarks->update()));
+		const float trapStartPos[3] = { 8.5f, 0.0f, 0.5f };
+		const float trapEndPos[3] = { 24.5f, 0.0f, 0.5f };
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(trapStartPos, halfExtents, &filter, &startRef, nearest)));
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(trapEndPos, halfExtents, &filter, &endRef, nearest)));
+
+		const unsigned int options[] = { 0, DT_FINDPATH_BIDIRECTIONAL, DT_FINDPATH_ANY_ANGLE };
+		for (int i = 0; i < 3; ++i)
+		{
+			INFO("options " << options[i]);
+			REQUIRE(dtStatusSucceed(query->setLandmarks(0)));
+			REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, trapStartPos, trapEndPos, &filter, path, &pathCount,
+													MAX_PATH, options[i])));
+			REQUIRE(path[pathCount - 1] == endRef);
+			const float length = getPathLength(query, trapStartPos, trapEndPos, path, pathCount);
+			const int nodeCount = query->getNodePool()->getNodeCount();
+
+			REQUIRE(dtStatusSucceed(query->setLandmarks(trapLandmarks)));
+			REQUIRE(query->getLandmarks() == trapLandmarks);
+			const dtStatus status = query->findPath(startRef, endRef, trapStartPos, trapEndPos, &filter, path, &pathCount,
+													MAX_PATH, options[i]);
+			REQUIRE(dtStatusSucceed(status));
+			REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+			REQUIRE(path[pathCount - 1] == endRef);
+			REQUIRE(getPathLength(query, trapStartPos, trapEndPos, path, pathCount) <= length * 1.02f);
+			REQUIRE(query->getNodePool()->getNodeCount() < nodeCount);
+		}
+
+		REQUIRE(dtStatusInProgress(query->initSlicedFindPath(startRef, endRef, trapStartPos, trapEndPos, &filter)));
+		REQUIRE(dtStatusSucceed(query->updateSlicedFindPath(100000, 0)));
+		REQUIRE(dtStatusSucceed(query->finalizeSlicedFindPath(path, &pathCount, MAX_PATH)));
+		REQUIRE(path[pathCount - 1] == endRef);
+
+		dtFreeNavMeshLandmarks(trapLandmarks);
+		dtFreeNavMesh(trap);
+	}
+
+	SECTION("Removed tiles keep the distances, added tiles recompute them")
+	{
+		// Block the first gap.
+		const dtMeshTile* gapTile = nav->getTileAt(1, 7, 0);
+		REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRef(gapTile), 0, 0)));
+		REQUIRE(dtStatusSucceed(landmarks->update(&updated)));
+		REQUIRE(updated == 0);
+		checkBounds(nav, query, landmarks, &filter);
+
+		REQUIRE(TestNavMesh::addTile(nav, 1, 7, 4, isSerpentineWall));
+		REQUIRE(dtStatusSucceed(landmarks->update(&updated)));
+		REQUIRE(updated == 64);
+		checkBounds(nav, query, landmarks, &filter);
+	}
+
+	SECTION("The landmarks must belong to the nav mesh of the query")
+	{
+		dtNavMesh* other = TestNavMesh::createGrid(1, 1, 4);
+		REQUIRE(other);
+		dtNavMeshQuery* otherQuery = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(otherQuery->init(other, 64)));
+		REQUIRE(dtStatusFailed(otherQuery->setLandmarks(landmarks)));
+		REQUIRE(dtStatusSucceed(query->setLandmarks(landmarks)));
+		REQUIRE(dtStatusSucceed(query->init(other, 64)));
+		REQUIRE(!query->getLandmarks());
+		dtFreeNavMeshQuery(otherQuery);
+		dtFreeNavMesh(other);
+	}
+
+	dtFreeNavMeshLandmarks(landmarks);
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
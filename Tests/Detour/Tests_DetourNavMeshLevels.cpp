@@ -0,0 +1,271 @@
+#include "catch2/catch_all.hpp"
+
+#include <string.h>
+
+#include "DetourCommon.h"
+#include "DetourCrowd.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshLevels.h"
+#include "DetourNavMeshQuery.h"
+
+#include "TestNavMeshUtils.h"
+
+namespace
+{
+const int TILES = 4;
+const int FINE_CELLS = 8;
+const int COARSE_CELLS = 4;
+const float COARSE_CELL_SIZE = 2.0f;
+
+// A hole at [8, 16) x [12, 20), aligned to the cells of both levels.
+bool isHole(float x, float z)
+{
+	return x >= 8.0f && x < 16.0f && z >= 12.0f && z < 20.0f;
+}
+
+bool isFineBlocked(int cellX, int cellZ)
+{
+	return isHole(cellX + 0.5f, cellZ + 0.5f);
+}
+
+bool isCoarseBlocked(int cellX, int cellZ)
+{
+	return isHole((cellX + 0.5f) * COARSE_CELL_SIZE, (cellZ + 0.5f) * COARSE_CELL_SIZE);
+}
+
+// The same world as the fine grid with cells of twice the size.
+dtTileRef addCoarseTile(dtNavMesh* nav, int tx, int ty)
+{
+	int dataSize = 0;
+	unsigned char* data = TestNavMesh::createTileData(tx, ty, COARSE_CELLS, isCoarseBlocked, &dataSize,
+													  false, false, 0, 0, false, COARSE_CELL_SIZE);
+	if (!data)
+		return 0;
+	dtTileRef ref = 0;
+	if (dtStatusFailed(nav->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, &ref)))
+	{
+		dtFree(data);
+		return 0;
+	}
+	return ref;
+}
+
+dtNavMesh* createCoarseGrid()
+{
+	dtNavMeshParams params;
+	memset(&params, 0, sizeof(params));
+	params.tileWidth = COARSE_CELLS * COARSE_CELL_SIZE;
+	params.tileHeight = COARSE_CELLS * COARSE_CELL_SIZE;
+	params.maxTiles = TILES * TILES;
+	params.maxPolys = COARSE_CELLS * COARSE_CELLS;
+
+	dtNavMesh* nav = dtAllocNavMesh();
+	if (!nav || dtStatusFailed(nav->init(&params)))
+	{
+		dtFreeNavMesh(nav);
+		return 0;
+	}
+	for (int y = 0; y < TILES; ++y)
+		for (int x = 0; x < TILES; ++x)
+			addCoarseTile(nav, x, y);
+	return nav;
+}
+
+void getPolyCenter(const dtNavMesh* nav, dtPolyRef ref, float* center)
+{
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	nav->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+	dtVset(center, 0, 0, 0);
+	for (int i = 0; i < poly->vertCount; ++i)
+		dtVadd(center, center, &tile->verts[poly->verts[i] * 3]);
+	dtVscale(center, center, 1.0f / poly->vertCount);
+}
+
+// True if both objects map every polygon of both levels the same.
+bool sameMapping(const dtNavMeshLevels* a, const dtNavMeshLevels* b)
+{
+	for (int level = 0; level < 2; ++level)
+	{
+		const dtNavMesh* nav = level ? a->getCoarseNavMesh() : a->getFineNavMesh();
+		for (int i = 0; i < nav->getMaxTiles(); ++i)
+		{
+			const dtMeshTile* tile = nav->getTile(i);
+			if (!tile->header)
+				continue;
+			const dtPolyRef base = nav->getPolyRefBase(tile);
+			for (int j = 0; j < tile->header->polyCount; ++j)
+			{
+				const dtPolyRef ref = base | (dtPolyRef)j;
+				if (level ? a->getFinePoly(ref) != b->getFinePoly(ref) : a->getCoarsePoly(ref) != b->getCoarsePoly(ref))
+					return false;
+			}
+		}
+	}
+	return true;
+}
+} // anonymous namespace
+
+TEST_CASE("dtNavMeshLevels", "[detour]")
+{
+	dtNavMesh* fine = TestNavMesh::createGrid(TILES, TILES, FINE_CELLS, isFineBlocked);
+	dtNavMesh* coarse = createCoarseGrid();
+	REQUIRE(fine);
+	REQUIRE(coarse);
+
+	dtQueryFilter filter;
+	const float halfExtents[3] = { COARSE_CELL_SIZE, 1.0f, COARSE_CELL_SIZE };
+	dtNavMeshLevels* levels = dtAllocNavMeshLevels();
+	REQUIRE(dtStatusSucceed(levels->init(fine, coarse, halfExtents, &filter)));
+	int updated = 0;
+	REQUIRE(dtStatusSucceed(levels->update(&updated)));
+	REQUIRE(updated == TILES * TILES * 2);
+	REQUIRE(dtStatusSucceed(levels->update(&updated)));
+	REQUIRE(updated == 0);
+
+	SECTION("Every polygon maps to the polygon at its center")
+	{
+		for (int level = 0; level < 2; ++level)
+		{
+			const dtNavMesh* nav = level ? coarse : fine;
+			const dtNavMesh* otherNav = level ? fine : coarse;
+			int polyCount = 0;
+			for (int i = 0; i < nav->getMaxTiles(); ++i)
+			{
+				const dtMeshTile* tile = nav->getTile(i);
+				if (!tile->header)
+					continue;
+				for (int j = 0; j < tile->header->polyCount; ++j)
+				{
+					const dtPolyRef ref = nav->getPolyRefBase(tile) | (dtPolyRef)j;
+					const dtPolyRef mapped = level ? levels->getFinePoly(ref) : levels->getCoarsePoly(ref);
+					REQUIRE(otherNav->isValidPolyRef(mapped));
+
+					// The center of a coarse cell is a corner of the fine cells, the fine cell touches it.
+					float center[3], otherCenter[3];
+					getPolyCenter(nav, ref, center);
+					getPolyCenter(otherNav, mapped, otherCenter);
+					const float maxDist = (level ? 0.5f : COARSE_CELL_SIZE * 0.5f) + 0.01f;
+					REQUIRE(dtMathFabsf(center[0] - otherCenter[0]) <= maxDist);
+					REQUIRE(dtMathFabsf(center[2] - otherCenter[2]) <= maxDist);
+					polyCount++;
+				}
+			}
+			REQUIRE(polyCount == (level ? 256 - 16 : 1024 - 64));
+		}
+		REQUIRE(levels->getCoarsePoly(0) == 0);
+		REQUIRE(levels->getFinePoly(0) == 0);
+	}
+
+	SECTION("Locations move between the levels")
+	{
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(query->init(fine, 16)));
+		for (int i = 0; i < 200; ++i)
+		{
+			float pos[3] = { (i * 37 % 320) / 10.0f + 0.05f, 0.0f, (i * 53 % 320) / 10.0f + 0.05f };
+			if (isHole(pos[0], pos[2]))
+				continue;
+			const float ext[3] = { 0.1f, 1.0f, 0.1f };
+			dtPolyRef fineRef = 0;
+			float finePos[3];
+			REQUIRE(dtStatusSucceed(query->findNearestPoly(pos, ext, &filter, &fineRef, finePos)));
+			REQUIRE(fineRef);
+
+			dtPolyRef coarseRef = 0;
+			float coarsePos[3];
+			REQUIRE(dtStatusSucceed(levels->findCoarseLocation(fineRef, finePos, &coarseRef, coarsePos)));
+			REQUIRE(coarse->isValidPolyRef(coarseRef));
+			REQUIRE(coarsePos[0] == Catch::Approx(finePos[0]));
+			REQUIRE(coarsePos[2] == Catch::Approx(finePos[2]));
+
+			dtPolyRef backRef = 0;
+			float backPos[3];
+			REQUIRE(dtStatusSucceed(levels->findFineLocation(coarseRef, coarsePos, &backRef, backPos)));
+			REQUIRE(backPos[0] == Catch::Approx(finePos[0]));
+			REQUIRE(backPos[2] == Catch::Approx(finePos[2]));
+		}
+		dtFreeNavMeshQuery(query);
+	}
+
+	SECTION("Changed tiles update the tiles of the other level")
+	{
+		REQUIRE(dtStatusSucceed(coarse->removeTile(coarse->getTileRefAt(1, 1, 0), 0, 0)));
+		REQUIRE(dtStatusSucceed(fine->removeTile(fine->getTileRefAt(3, 2, 0), 0, 0)));
+		REQUIRE(dtStatusSucceed(levels->update(&updated)));
+		// The removed tiles and the tiles within the half extents of them on the other level.
+		REQUIRE(updated > 2);
+		REQUIRE(updated < TILES * TILES * 2);
+
+		dtNavMeshLevels* fresh = dtAllocNavMeshLevels();
+		REQUIRE(dtStatusSucceed(fresh->init(fine, coarse, halfExtents, &filter)));
+		REQUIRE(dtStatusSucceed(fresh->update()));
+		REQUIRE(sameMapping(levels, fresh));
+		dtFreeNavMeshLevels(fresh);
+
+		REQUIRE(addCoarseTile(coarse, 1, 1));
+		REQUIRE(TestNavMesh::addTile(fine, 3, 2, FINE_CELLS, isFineBlocked));
+		REQUIRE(dtStatusSucceed(levels->update(&updated)));
+		REQUIRE(updated > 2);
+
+		fresh = dtAllocNavMeshLevels();
+		REQUIRE(dtStatusSucceed(fresh->init(fine, coarse, halfExtents, &filter)));
+		REQUIRE(dtStatusSucceed(fresh->update()));
+		REQUIRE(sameMapping(levels, fresh));
+		dtFreeNavMeshLevels(fresh);
+	}
+
+	SECTION("A crowd agent switches to the coarse level")
+	{
+		dtCrowd* fineCrowd = dtAllocCrowd();
+		dtCrowd* coarseCrowd = dtAllocCrowd();
+		REQUIRE(fineCrowd->init(4, 0.6f, fine));
+		REQUIRE(coarseCrowd->init(4, 0.6f, coarse));
+
+		dtCrowdAgentParams params;
+		memset(&params, 0, sizeof(params));
+		params.radius = 0.4f;
+		params.height = 2.0f;
+		params.maxAcceleration = 8.0f;
+		params.maxSpeed = 3.5f;
+		params.collisionQueryRange = 4.0f;
+		params.pathOptimizationRange = 10.0f;
+		const float start[3] = { 2.5f, 0.0f, 2.5f };
+		const int fineIdx = fineCrowd->addAgent(start, &params);
+		REQUIRE(fineIdx >= 0);
+
+		const float targetPos[3] = { 29.5f, 0.0f, 29.5f };
+		const float ext[3] = { 0.5f, 1.0f, 0.5f };
+		dtPolyRef targetRef = 0;
+		float target[3];
+		REQUIRE(dtStatusSucceed(fineCrowd->getNavMeshQuery()->findNearestPoly(targetPos, ext, &filter, &targetRef, target)));
+		REQUIRE(fineCrowd->requestMoveTarget(fineIdx, targetRef, target));
+		for (int i = 0; i < 10; ++i)
+			fineCrowd->update(0.1f, 0);
+
+		// Move the agent and its target to the coarse level.
+		const dtCrowdAgent* ag = fineCrowd->getAgent(fineIdx);
+		dtPolyRef coarseRef = 0;
+		float coarsePos[3];
+		REQUIRE(dtStatusSucceed(levels->findCoarseLocation(ag->corridor.getFirstPoly(), ag->npos, &coarseRef, coarsePos)));
+		dtPolyRef coarseTargetRef = 0;
+		float coarseTarget[3];
+		REQUIRE(dtStatusSucceed(levels->findCoarseLocation(targetRef, target, &coarseTargetRef, coarseTarget)));
+		fineCrowd->removeAgent(fineIdx);
+
+		const int coarseIdx = coarseCrowd->addAgent(coarsePos, &params);
+		REQUIRE(coarseIdx >= 0);
+		REQUIRE(coarseCrowd->getAgent(coarseIdx)->corridor.getFirstPoly() == coarseRef);
+		REQUIRE(coarseCrowd->requestMoveTarget(coarseIdx, coarseTargetRef, coarseTarget));
+		for (int i = 0; i < 10; ++i)
+			coarseCrowd->update(0.1f, 0);
+		REQUIRE(dtVdist2D(coarseCrowd->getAgent(coarseIdx)->npos, coarseTarget) < dtVdist2D(coarsePos, coarseTarget));
+
+		dtFreeCrowd(fineCrowd);
+		dtFreeCrowd(coarseCrowd);
+	}
+
+	dtFreeNavMeshLevels(levels);
+	dtFreeNavMesh(coarse);
+	dtFreeNavMesh(fine);
+}
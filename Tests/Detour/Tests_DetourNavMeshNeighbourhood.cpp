@@ -0,0 +1,152 @@
+#include "catch2/catch_all.hpp"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshNeighbourhood.h"
+#include "DetourNavMeshQuery.h"
+
+#include "TestNavMeshUtils.h"
+
+namespace
+{
+// Pillars of one cell spread over the grid.
+bool isPillar(int cellX, int cellZ)
+{
+	return cellX % 5 == 2 && cellZ % 5 == 2;
+}
+
+const int MAX_RESULT = 128;
+const float RADIUS = 3.0f;
+
+struct Results
+{
+	dtStatus status;
+	dtPolyRef refs[MAX_RESULT];
+	dtPolyRef parents[MAX_RESULT];
+	float costs[MAX_RESULT];
+	int count;
+};
+
+// Requires the searches with the neighbourhood to return the same as the searches without it.
+void requireSameResults(const dtNavMeshQuery* query, const dtQueryFilter* filter, dtNavMeshNeighbourhood* neighbourhood,
+						const float* center)
+{
+	const float halfExtents[3] = { 0.1f, 2.0f, 0.1f };
+	dtPolyRef startRef = 0;
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(center, halfExtents, filter, &startRef, 0)));
+	REQUIRE(startRef);
+
+	Results expected, results;
+	expected.status = query->findPolysAroundCircle(startRef, center, RADIUS, filter, expected.refs, expected.parents,
+												   expected.costs, &expected.count, MAX_RESULT);
+	results.status = query->findPolysAroundCircle(startRef, center, RADIUS, filter, neighbourhood, results.refs,
+												  results.parents, results.costs, &results.count, MAX_RESULT);
+	REQUIRE(results.status == expected.status);
+	REQUIRE(results.count == expected.count);
+	for (int i = 0; i < expected.count; ++i)
+	{
+		REQUIRE(results.refs[i] == expected.refs[i]);
+		REQUIRE(results.parents[i] == expected.parents[i]);
+		REQUIRE(results.costs[i] == expected.costs[i]);
+	}
+
+	expected.status = query->findLocalNeighbourhood(startRef, center, RADIUS, filter, expected.refs, expected.parents,
+													&expected.count, MAX_RESULT);
+	results.status = query->findLocalNeighbourhood(startRef, center, RADIUS, filter, neighbourhood, results.refs,
+												   results.parents, &results.count, MAX_RESULT);
+	REQUIRE(results.status == expected.status);
+	REQUIRE(results.count == expected.count);
+	for (int i = 0; i < expected.count; ++i)
+	{
+		REQUIRE(results.refs[i] == expected.refs[i]);
+		REQUIRE(results.parents[i] == expected.parents[i]);
+	}
+}
+} // anonymous namespace
+
+TEST_CASE("dtNavMeshNeighbourhood", "[detour]")
+{
+	// 3x3 tiles of 8x8 cells, one polygon per cell.
+	dtNavMesh* nav = TestNavMesh::createGrid(3, 3, 8, isPillar);
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+	dtQueryFilter filter;
+
+	dtNavMeshNeighbourhood* neighbourhood = dtAllocNavMeshNeighbourhood();
+	REQUIRE(neighbourhood);
+	REQUIRE(dtStatusSucceed(neighbourhood->init(256, 1.0f)));
+
+	SECTION("Results match the searches while moving")
+	{
+		// A diagonal walk across the tile borders, in small steps.
+		float center[3] = { 1.5f, 0.0f, 1.3f };
+		for (int step = 0; step < 100; ++step)
+		{
+			requireSameResults(query, &filter, neighbourhood, center);
+			center[0] += 0.2f;
+			center[2] += 0.17f;
+		}
+
+		// The polygons are reused, and only the ones that came into range are read again.
+		REQUIRE(neighbourhood->getSearchCount() > 1);
+		REQUIRE(neighbourhood->getReuseCount() > neighbourhood->getSearchCount());
+		REQUIRE(neighbourhood->getReadCount() < neighbourhood->getSearchCount() * neighbourhood->getPolyCount());
+	}
+
+	SECTION("Flag changes are detected")
+	{
+		const float center[3] = { 10.5f, 0.0f, 10.5f };
+		requireSameResults(query, &filter, neighbourhood, center);
+		const int reads = neighbourhood->getReadCount();
+
+		// Blocks a polygon inside the kept set.
+		const float blockPos[3] = { 11.5f, 0.0f, 10.5f };
+		const float halfExtents[3] = { 0.1f, 2.0f, 0.1f };
+		dtPolyRef blockRef = 0;
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(blockPos, halfExtents, &filter, &blockRef, 0)));
+		REQUIRE(dtStatusSucceed(nav->setPolyFlags(blockRef, 0)));
+		requireSameResults(query, &filter, neighbourhood, center);
+		REQUIRE(neighbourhood->getReadCount() > reads);
+
+		// Only the polygons of the changed tile are read again.
+		REQUIRE(neighbourhood->getReadCount() - reads < neighbourhood->getPolyCount());
+		REQUIRE(dtStatusSucceed(nav->setPolyFlags(blockRef, 1)));
+		requireSameResults(query, &filter, neighbourhood, center);
+	}
+
+	SECTION("Tile changes are detected")
+	{
+		const float center[3] = { 8.2f, 0.0f, 8.3f };
+		requireSameResults(query, &filter, neighbourhood, center);
+
+		REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(0, 0, 0), 0, 0)));
+		requireSameResults(query, &filter, neighbourhood, center);
+		REQUIRE(TestNavMesh::addTile(nav, 0, 0, 8, isPillar));
+		requireSameResults(query, &filter, neighbourhood, center);
+	}
+
+	SECTION("A different filter drops the polygons")
+	{
+		const float center[3] = { 4.5f, 0.0f, 4.5f };
+		requireSameResults(query, &filter, neighbourhood, center);
+		dtQueryFilter other;
+		other.setIncludeFlags(1);
+		requireSameResults(query, &other, neighbourhood, center);
+		REQUIRE(neighbourhood->getSearchCount() == 2);
+	}
+
+	SECTION("Too small neighbourhoods fall back to the searches")
+	{
+		dtNavMeshNeighbourhood* small = dtAllocNavMeshNeighbourhood();
+		REQUIRE(dtStatusSucceed(small->init(4, 1.0f)));
+		const float center[3] = { 4.5f, 0.0f, 4.5f };
+		requireSameResults(query, &filter, small, center);
+		REQUIRE(small->getRadius() < 0.0f);
+		dtFreeNavMeshNeighbourhood(small);
+	}
+
+	dtFreeNavMeshNeighbourhood(neighbourhood);
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
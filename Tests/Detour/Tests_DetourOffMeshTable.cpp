@@ -0,0 +1,167 @@
+#include "catch2/catch_all.hpp"
+
+#include <string.h>
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourOffMeshTable.h"
+
+#include "TestNavMeshUtils.h"
+
+namespace
+{
+// Returns the reference of the connection that ends at the position, or zero.
+dtPolyRef findConnection(const dtNavMesh* nav, const dtMeshTile* tile, float x, float z)
+{
+	for (int i = 0; i < tile->header->offMeshConCount; ++i)
+	{
+		const dtOffMeshConnection* con = &tile->offMeshCons[i];
+		if (con->pos[3] == x && con->pos[5] == z)
+			return nav->getPolyRefBase(tile) | (dtPolyRef)con->poly;
+	}
+	return 0;
+}
+
+// Requires the endpoints of the table to match the navigation mesh for the previous polygon.
+void requireSameEndPoints(const dtNavMesh* nav, const dtOffMeshConnectionTable* table, dtPolyRef prevRef, dtPolyRef ref)
+{
+	float navStart[3], navEnd[3];
+	float start[3], end[3];
+	REQUIRE(dtStatusSucceed(nav->getOffMeshConnectionPolyEndPoints(prevRef, ref, navStart, navEnd)));
+	REQUIRE(dtStatusSucceed(table->getEndPoints(prevRef, ref, start, end)));
+	REQUIRE(dtVequal(start, navStart));
+	REQUIRE(dtVequal(end, navEnd));
+}
+} // anonymous namespace
+
+TEST_CASE("dtOffMeshConnectionTable", "[detour]")
+{
+	// The tile polygons are at y = -1.
+	const float conVerts[] =
+	{
+		0.5f, -1, 0.5f,	2.5f, -1, 2.5f,		// Inside the tile.
+		3.5f, -1, 1.5f,	5.5f, -1, 1.5f,		// To the x+ neighbour.
+		1.5f, -1, 3.5f,	1.5f, -1, 10.5f,		// To a missing z+ neighbour.
+	};
+	int dataSize = 0;
+	unsigned char* data = TestNavMesh::createTileData(0, 0, 4, 0, &dataSize, false, false, conVerts, 3);
+	REQUIRE(data);
+	dtNavMesh* nav = TestNavMesh::createOffMeshGrid(data, dataSize, DT_TILE_FREE_DATA);
+	REQUIRE(nav);
+	const dtMeshTile* tile = nav->getTileAt(0, 0, 0);
+	REQUIRE(tile);
+	const dtPolyRef base = nav->getPolyRefBase(tile);
+
+	dtQueryFilter filter;
+	filter.setAreaCost(0, 2.0f);
+	dtOffMeshConnectionTable* table = dtAllocOffMeshConnectionTable();
+	REQUIRE(table);
+	REQUIRE(dtStatusSucceed(table->init(nav, &filter)));
+
+	// Nothing is found before the first update.
+	const dtPolyRef conRef = base | (dtPolyRef)tile->offMeshCons[0].poly;
+	REQUIRE(table->getConnection(conRef) == 0);
+
+	int updated = 0;
+	REQUIRE(dtStatusSucceed(table->update(&updated)));
+	REQUIRE(updated == 2);
+	REQUIRE(table->getConnectionCount() == 3);
+	REQUIRE(dtStatusSucceed(table->update(&updated)));
+	REQUIRE(updated == 0);
+
+	SECTION("Entries match the navigation mesh")
+	{
+		for (int i = 0; i < tile->header->offMeshConCount; ++i)
+		{
+			const dtOffMeshConnection* con = &tile->offMeshCons[i];
+			const dtPolyRef ref = base | (dtPolyRef)con->poly;
+			const dtOffMeshConnectionEntry* entry = table->getConnection(ref);
+			REQUIRE(entry);
+			REQUIRE(entry->ref == ref);
+			REQUIRE(nav->getOffMeshConnectionByRef(ref) == con);
+			REQUIRE(dtVequal(entry->startPos, &con->pos[0]));
+			REQUIRE(dtVequal(entry->endPos, &con->pos[3]));
+			REQUIRE(entry->userId == con->userId);
+			REQUIRE(entry->bidir == 1);
+			REQUIRE(entry->startRef != 0);
+			REQUIRE(entry->length == Catch::Approx(dtVdist(&con->pos[0], &con->pos[3])));
+			REQUIRE(entry->cost[0] == Catch::Approx(entry->length * 2.0f));
+			REQUIRE(entry->cost[1] == Catch::Approx(entry->length * 2.0f));
+
+			requireSameEndPoints(nav, table, entry->startRef, ref);
+			requireSameEndPoints(nav, table, entry->endRef, ref);
+			requireSameEndPoints(nav, table, 0, ref);
+
+			float cost = 0.0f;
+			REQUIRE(dtStatusSucceed(table->getCost(entry->endRef, ref, &cost)));
+			REQUIRE(cost == entry->cost[1]);
+		}
+
+		// The connection to the missing neighbour has no end polygon.
+		REQUIRE(table->getConnection(findConnection(nav, tile, 1.5f, 10.5f))->endRef == 0);
+	}
+
+	SECTION("Ground polygons and stale references are not found")
+	{
+		REQUIRE(table->getConnection(base) == 0);
+		REQUIRE(table->getConnection(0) == 0);
+		float start[3], end[3];
+		REQUIRE(dtStatusFailed(table->getEndPoints(0, base, start, end)));
+	}
+
+	SECTION("Flag changes rebuild the tile")
+	{
+		REQUIRE(dtStatusSucceed(nav->setPolyFlags(conRef, 2)));
+		REQUIRE(table->getConnection(conRef) == 0);
+		REQUIRE(dtStatusSucceed(table->update(&updated)));
+		REQUIRE(updated == 1);
+		const dtOffMeshConnectionEntry* entry = table->getConnection(conRef);
+		REQUIRE(entry);
+		REQUIRE(entry->flags == 2);
+	}
+
+	SECTION("Neighbour changes relink the connections")
+	{
+		const dtPolyRef rightRef = findConnection(nav, tile, 5.5f, 1.5f);
+		REQUIRE(rightRef);
+		REQUIRE(table->getConnection(rightRef)->endRef != 0);
+
+		REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(1, 0, 0), 0, 0)));
+		REQUIRE(table->getConnection(rightRef) == 0);
+		REQUIRE(dtStatusSucceed(table->update(&updated)));
+		REQUIRE(updated == 1);
+		REQUIRE(table->getConnectionCount() == 3);
+		REQUIRE(table->getConnection(rightRef)->endRef == 0);
+		requireSameEndPoints(nav, table, 0, rightRef);
+
+		REQUIRE(TestNavMesh::addTile(nav, 1, 0, 4));
+		REQUIRE(dtStatusSucceed(table->update(&updated)));
+		const dtOffMeshConnectionEntry* entry = table->getConnection(rightRef);
+		REQUIRE(entry->endRef == (nav->getPolyRefBase(nav->getTileAt(1, 0, 0)) | 5));
+		requireSameEndPoints(nav, table, entry->endRef, rightRef);
+	}
+
+	SECTION("Without a filter the cost is the length")
+	{
+		dtOffMeshConnectionTable* lengths = dtAllocOffMeshConnectionTable();
+		REQUIRE(dtStatusSucceed(lengths->init(nav, 0)));
+		REQUIRE(dtStatusSucceed(lengths->update()));
+		float cost = 0.0f;
+		REQUIRE(dtStatusSucceed(lengths->getCost(0, conRef, &cost)));
+		REQUIRE(cost == lengths->getConnection(conRef)->length);
+		dtFreeOffMeshConnectionTable(lengths);
+	}
+
+	SECTION("Invalidate rebuilds all tiles")
+	{
+		table->invalidate();
+		REQUIRE(table->getConnection(conRef) == 0);
+		REQUIRE(dtStatusSucceed(table->update(&updated)));
+		REQUIRE(updated == 2);
+		REQUIRE(table->getConnection(conRef));
+	}
+
+	dtFreeOffMeshConnectionTable(table);
+	dtFreeNavMesh(nav);
+}
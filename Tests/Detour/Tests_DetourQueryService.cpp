@@ -0,0 +1,186 @@
+#include <atomic>
+#include <float.h>
+#include <string.h>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourQueryService.h"
+
+#include "TestNavMeshUtils.h"
+
+namespace
+{
+bool isPillarBlocked(int cellX, int cellZ)
+{
+	return (cellX % 4) == 2 && (cellZ % 4) == 2;
+}
+
+void countCompleted(dtQueryRequest*, void* userData)
+{
+	(*(std::atomic<int>*)userData)++;
+}
+} // anonymous namespace
+
+TEST_CASE("dtQueryService", "[detour]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(4, 4, 8, isPillarBlocked);
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+
+	// Mixed requests across the grid, the paths run between opposite corners of the cells.
+	const int maxPath = 256;
+	const int requestCount = 60;
+	std::vector<dtQueryRequest> requests(requestCount);
+	std::vector<dtPolyRef> paths(requestCount * maxPath);
+	std::atomic<int> completed(0);
+	for (int i = 0; i < requestCount; ++i)
+	{
+		dtQueryRequest& r = requests[i];
+		memset(&r, 0, sizeof(r));
+		r.type = i % 3;
+		r.filter = &filter;
+		const float start[3] = { 0.5f + (i % 8), 0.0f, 0.5f + (i / 8) };
+		const float end[3] = { 31.5f - (i % 16), 0.0f, 31.5f - (i / 4) };
+		dtVcopy(r.startPos, start);
+		dtVcopy(r.endPos, end);
+		dtVcopy(r.halfExtents, halfExtents);
+		query->findNearestPoly(start, halfExtents, &filter, &r.startRef, 0);
+		query->findNearestPoly(end, halfExtents, &filter, &r.endRef, 0);
+		r.path = &paths[i * maxPath];
+		r.maxPath = maxPath;
+		r.callback = countCompleted;
+		r.userData = &completed;
+	}
+
+	dtQueryService* service = dtAllocQueryService();
+	REQUIRE(service);
+	SECTION("Fails before initialization")
+	{
+		REQUIRE(dtStatusFailed(service->run(&requests[0], requestCount)));
+	}
+
+	// The local pool is too small for the long paths, which then use the path pool.
+	REQUIRE(dtStatusSucceed(service->init(nav, 4, 16, 2048)));
+	service->setLocalPathDistance(1000.0f);
+
+	TestNavMesh::ThreadDispatcher dispatcher(4);
+	TestNavMesh::ThreadDispatcher tooManyWorkers(5);
+	REQUIRE(dtStatusFailed(service->setJobDispatcher(&tooManyWorkers)));
+
+	SECTION("Serial")
+	{
+	}
+	SECTION("Threaded")
+	{
+		REQUIRE(dtStatusSucceed(service->setJobDispatcher(&dispatcher)));
+	}
+
+	REQUIRE(dtStatusSucceed(service->run(&requests[0], requestCount)));
+	REQUIRE(completed == requestCount);
+
+	// The results match the queries run directly.
+	std::vector<dtPolyRef> path(maxPath);
+	for (int i = 0; i < requestCount; ++i)
+	{
+		const dtQueryRequest& r = requests[i];
+		REQUIRE(dtStatusSucceed(r.status));
+		if (r.type == DT_QUERY_FIND_PATH)
+		{
+			int pathCount = 0;
+			REQUIRE(dtStatusSucceed(query->findPath(r.startRef, r.endRef, r.startPos, r.endPos, &filter,
+											   &path[0], &pathCount, maxPath)));
+			REQUIRE(r.pathCount == pathCount);
+			REQUIRE(memcmp(r.path, &path[0], sizeof(dtPolyRef) * pathCount) == 0);
+			REQUIRE(!dtStatusDetail(r.status, DT_OUT_OF_NODES));
+		}
+		else if (r.type == DT_QUERY_RAYCAST)
+		{
+			float t = 0, normal[3];
+			int pathCount = 0;
+			REQUIRE(dtStatusSucceed(query->raycast(r.startRef, r.startPos, r.endPos, &filter, &t, normal,
+												   &path[0], &pathCount, maxPath)));
+			REQUIRE(r.t == t);
+			REQUIRE(r.pathCount == pathCount);
+		}
+		else
+		{
+			dtPolyRef ref = 0;
+			float pt[3];
+			REQUIRE(dtStatusSucceed(query->findNearestPoly(r.startPos, halfExtents, &filter, &ref, pt)));
+			REQUIRE(r.nearestRef == ref);
+			REQUIRE(dtVequal(r.nearestPt, pt));
+		}
+	}
+
+	dtFreeQueryService(service);
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtQueryService distance matrix", "[detour]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(4, 4, 8, isPillarBlocked);
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+
+	// One row per source, every row searches to all the targets.
+	const int sourceCount = 12;
+	const int targetCount = 20;
+	std::vector<dtPolyRef> targetRefs(targetCount);
+	std::vector<float> targetPositions(targetCount * 3);
+	for (int i = 0; i < targetCount; ++i)
+	{
+		const float pos[3] = { 1.5f + (i % 5) * 7, 0.0f, 0.5f + (i / 5) * 8 };
+		query->findNearestPoly(pos, halfExtents, &filter, &targetRefs[i], &targetPositions[i * 3]);
+	}
+	std::vector<dtQueryRequest> requests(sourceCount);
+	std::vector<float> costs(sourceCount * targetCount);
+	for (int i = 0; i < sourceCount; ++i)
+	{
+		dtQueryRequest& r = requests[i];
+		memset(&r, 0, sizeof(r));
+		r.type = DT_QUERY_FIND_DISTANCES;
+		r.filter = &filter;
+		const float start[3] = { 0.5f + (i % 4) * 9, 0.0f, 31.5f - (i / 4) * 10 };
+		query->findNearestPoly(start, halfExtents, &filter, &r.startRef, r.startPos);
+		r.targetRefs = &targetRefs[0];
+		r.targetPositions = &targetPositions[0];
+		r.targetCount = targetCount;
+		r.maxCost = FLT_MAX;
+		r.costs = &costs[i * targetCount];
+	}
+
+	dtQueryService* service = dtAllocQueryService();
+	REQUIRE(service);
+	REQUIRE(dtStatusSucceed(service->init(nav, 4, 16, 2048)));
+	TestNavMesh::ThreadDispatcher dispatcher(4);
+	REQUIRE(dtStatusSucceed(service->setJobDispatcher(&dispatcher)));
+	REQUIRE(dtStatusSucceed(service->run(&requests[0], sourceCount)));
+
+	// The rows match the searches run directly.
+	std::vector<float> row(targetCount);
+	for (int i = 0; i < sourceCount; ++i)
+	{
+		const dtQueryRequest& r = requests[i];
+		REQUIRE(r.status == DT_SUCCESS);
+		REQUIRE(r.reachedCount == targetCount);
+		int reached = 0;
+		REQUIRE(dtStatusSucceed(query->findDistances(r.startRef, r.startPos, &targetRefs[0], &targetPositions[0],
+													 targetCount, &filter, FLT_MAX, &row[0], &reached)));
+		REQUIRE(memcmp(&row[0], r.costs, sizeof(float) * targetCount) == 0);
+	}
+
+	dtFreeQueryService(service);
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
@@ -0,0 +1,134 @@
+#include "catch2/catch_all.hpp"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourRandomPointIndex.h"
+
+#include "TestNavMeshUtils.h"
+
+namespace
+{
+unsigned int s_seed = 1;
+
+float frand()
+{
+	s_seed = s_seed * 1103515245u + 12345u;
+	return (float)((s_seed >> 8) & 0xffff) / 65536.0f;
+}
+
+// Leaves only one cell of the first tile open.
+bool isFirstTileBlocked(int cellX, int cellZ)
+{
+	return cellX < 4 && cellZ < 4 && (cellX != 0 || cellZ != 0);
+}
+} // anonymous namespace
+
+TEST_CASE("dtRandomPointIndex", "[detour]")
+{
+	// 2x2 tiles of 4x4 cells, the first tile has 1 cell and the others 16.
+	dtNavMesh* nav = TestNavMesh::createGrid(2, 2, 4, isFirstTileBlocked);
+	REQUIRE(nav);
+
+	dtQueryFilter filter;
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 128)));
+
+	dtRandomPointIndex* index = dtAllocRandomPointIndex();
+	REQUIRE(dtStatusSucceed(index->init(nav, &filter)));
+	int updated = 0;
+	REQUIRE(dtStatusSucceed(index->update(&updated)));
+	REQUIRE(updated == 4);
+	REQUIRE(dtStatusSucceed(index->update(&updated)));
+	REQUIRE(updated == 0);
+	REQUIRE(index->getTotalArea() == Catch::Approx(49.0f));
+
+	s_seed = 1;
+	dtPolyRef ref = 0;
+	float pt[3];
+
+	SECTION("Points are distributed by area")
+	{
+		const int sampleCount = 4900;
+		int counts[4] = { 0, 0, 0, 0 };
+		for (int i = 0; i < sampleCount; ++i)
+		{
+			REQUIRE(dtStatusSucceed(index->findRandomPoint(query, frand, &ref, pt)));
+			REQUIRE(nav->isValidPolyRef(ref));
+			const int tx = (int)(pt[0] / 4.0f);
+			const int tz = (int)(pt[2] / 4.0f);
+			REQUIRE(tx >= 0);
+			REQUIRE(tx < 2);
+			REQUIRE(tz >= 0);
+			REQUIRE(tz < 2);
+			const dtMeshTile* tile = 0;
+			const dtPoly* poly = 0;
+			nav->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+			REQUIRE(tile->header->x == tx);
+			REQUIRE(tile->header->y == tz);
+			counts[tx + tz * 2]++;
+		}
+		// 100 and 1600 points are expected.
+		REQUIRE(counts[0] > 50);
+		REQUIRE(counts[0] < 150);
+		for (int i = 1; i < 4; ++i)
+		{
+			REQUIRE(counts[i] > 1450);
+			REQUIRE(counts[i] < 1750);
+		}
+	}
+
+	SECTION("Only polygons which pass the filter are returned")
+	{
+		dtQueryFilter excludeAll;
+		excludeAll.setIncludeFlags(0);
+		dtRandomPointIndex* empty = dtAllocRandomPointIndex();
+		REQUIRE(dtStatusSucceed(empty->init(nav, &excludeAll)));
+		REQUIRE(dtStatusSucceed(empty->update()));
+		REQUIRE(empty->getTotalArea() == 0.0f);
+		REQUIRE(dtStatusFailed(empty->findRandomPoint(query, frand, &ref, pt)));
+		dtFreeRandomPointIndex(empty);
+	}
+
+	SECTION("Only changed tiles are rebuilt")
+	{
+		REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(1, 1, 0), 0, 0)));
+		REQUIRE(dtStatusFailed(index->findRandomPoint(query, frand, &ref, pt)));
+		REQUIRE(dtStatusSucceed(index->update(&updated)));
+		REQUIRE(updated == 1);
+		REQUIRE(index->getTotalArea() == Catch::Approx(33.0f));
+		for (int i = 0; i < 100; ++i)
+		{
+			REQUIRE(dtStatusSucceed(index->findRandomPoint(query, frand, &ref, pt)));
+			REQUIRE(!(pt[0] > 4.0f && pt[2] > 4.0f));
+		}
+
+		REQUIRE(TestNavMesh::addTile(nav, 1, 1, 4, isFirstTileBlocked));
+		REQUIRE(dtStatusSucceed(index->update(&updated)));
+		REQUIRE(updated == 1);
+		REQUIRE(index->getTotalArea() == Catch::Approx(49.0f));
+	}
+
+	SECTION("Tiles with changed polygon flags are rebuilt")
+	{
+		const dtMeshTile* tile = nav->getTileAt(0, 0, 0);
+		REQUIRE(tile->header->polyCount == 1);
+		REQUIRE(dtStatusSucceed(nav->setPolyFlags(nav->getPolyRefBase(tile), 0)));
+		REQUIRE(dtStatusFailed(index->findRandomPoint(query, frand, &ref, pt)));
+		REQUIRE(dtStatusSucceed(index->update(&updated)));
+		REQUIRE(updated == 1);
+		REQUIRE(index->getTotalArea() == Catch::Approx(48.0f));
+	}
+
+	SECTION("Invalidated tiles are rebuilt")
+	{
+		index->invalidate();
+		REQUIRE(dtStatusFailed(index->findRandomPoint(query, frand, &ref, pt)));
+		REQUIRE(dtStatusSucceed(index->update(&updated)));
+		REQUIRE(updated == 4);
+		REQUIRE(dtStatusSucceed(index->findRandomPoint(query, frand, &ref, pt)));
+	}
+
+	dtFreeRandomPointIndex(index);
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
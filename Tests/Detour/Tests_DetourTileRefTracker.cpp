@@ -0,0 +1,84 @@
+#include "catch2/catch_all.hpp"
+
+#include "DetourNavMesh.h"
+#include "DetourTileRefTracker.h"
+
+#include "TestNavMeshUtils.h"
+
+TEST_CASE("dtTileRefTracker", "[detour]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(2, 2, 4);
+	REQUIRE(nav);
+	const bool trackGenerations = GENERATE(false, true);
+	dtTileRefTracker tracker;
+	tracker.init(nav, trackGenerations);
+
+	// All tiles are reported until they are committed.
+	REQUIRE(!tracker.isUpToDate());
+	REQUIRE(dtStatusSucceed(tracker.update()));
+	REQUIRE(tracker.getMaxTiles() == nav->getMaxTiles());
+	REQUIRE(tracker.getChangedTileCount() == 4);
+	REQUIRE(tracker.hasEpochChanged());
+	REQUIRE(dtStatusSucceed(tracker.update()));
+	REQUIRE(tracker.getChangedTileCount() == 4);
+	tracker.commit();
+	REQUIRE(tracker.isUpToDate());
+	REQUIRE(dtStatusSucceed(tracker.update()));
+	REQUIRE(tracker.getChangedTileCount() == 0);
+	REQUIRE(!tracker.hasEpochChanged());
+
+	// Removed and added tiles are reported.
+	const dtTileRef ref = nav->getTileRefAt(1, 1, 0);
+	const int tileIndex = (int)nav->decodePolyIdTile((dtPolyRef)ref);
+	REQUIRE(dtStatusSucceed(nav->removeTile(ref, 0, 0)));
+	REQUIRE(!tracker.isUpToDate());
+	REQUIRE(!tracker.isEpochUpToDate());
+	REQUIRE(dtStatusSucceed(tracker.update()));
+	REQUIRE(tracker.getChangedTileCount() == 1);
+	REQUIRE(tracker.getChangedTile(0) == tileIndex);
+	REQUIRE(tracker.getTileRef(tileIndex) == 0);
+	REQUIRE(TestNavMesh::addTile(nav, 1, 1, 4));
+	REQUIRE(dtStatusSucceed(tracker.update()));
+	REQUIRE(tracker.getChangedTileCount() == 1);
+	REQUIRE(tracker.getTileRef(tracker.getChangedTile(0)) == nav->getTileRefAt(1, 1, 0));
+	tracker.commit();
+	REQUIRE(tracker.isUpToDate());
+
+	// Changed polygon flags are only reported with generation tracking.
+	const dtMeshTile* tile = nav->getTileAt(0, 0, 0);
+	REQUIRE(dtStatusSucceed(nav->setPolyFlags(nav->getPolyRefBase(tile), 0)));
+	REQUIRE(tracker.isEpochUpToDate());
+	REQUIRE(tracker.isUpToDate() == !trackGenerations);
+	REQUIRE(dtStatusSucceed(tracker.update()));
+	REQUIRE(tracker.getChangedTileCount() == (trackGenerations ? 1 : 0));
+	REQUIRE(!tracker.hasEpochChanged());
+	tracker.commit();
+	REQUIRE(tracker.isUpToDate());
+
+	// Invalidated tiles are reported again.
+	tracker.invalidate();
+	REQUIRE(!tracker.isUpToDate());
+	REQUIRE(dtStatusSucceed(tracker.update()));
+	REQUIRE(tracker.getChangedTileCount() == 4);
+
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtGrowTileTable", "[detour]")
+{
+	int* table = 0;
+	REQUIRE(dtGrowTileTable(table, 0, 4));
+	REQUIRE(table);
+	for (int i = 0; i < 4; ++i)
+	{
+		REQUIRE(table[i] == 0);
+		table[i] = i + 1;
+	}
+	int* grown = table;
+	REQUIRE(dtGrowTileTable(table, 4, 2));
+	REQUIRE(table == grown);
+	REQUIRE(dtGrowTileTable(table, 4, 8));
+	for (int i = 0; i < 8; ++i)
+		REQUIRE(table[i] == (i < 4 ? i + 1 : 0));
+	dtFree(table);
+}
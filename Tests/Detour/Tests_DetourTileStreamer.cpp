@@ -0,0 +1,266 @@
+#include <map>
+#include <utility>
+
+#include "catch2/catch_all.hpp"
+
+#include "DetourNavMesh.h"
+#include "DetourTileStreamer.h"
+
+#include "TestNavMeshUtils.h"
+
+namespace
+{
+const int TILES_X = 8;
+const int CELLS = 4;
+
+// Serves the tiles of a TILES_X x 1 grid after a number of polls.
+class TestTileSource : public dtTileSource
+{
+public:
+	TestTileSource() : delay(0), frees(0), cancels(0) {}
+
+	bool requestTile(int tx, int ty) override
+	{
+		requests[std::make_pair(tx, ty)] = delay;
+		return true;
+	}
+
+	dtTileSourceState pollTile(int tx, int ty, unsigned char** data, int* dataSize, bool* changed) override
+	{
+		std::map<std::pair<int, int>, int>::iterator it = requests.find(std::make_pair(tx, ty));
+		if (it == requests.end())
+			return DT_TILE_SOURCE_FAILED;
+		if (it->second-- > 0)
+			return DT_TILE_SOURCE_PENDING;
+		requests.erase(it);
+		if (tx < 0 || tx >= TILES_X || ty != 0)
+			return DT_TILE_SOURCE_MISSING;
+		*data = TestNavMesh::createTileData(tx, ty, CELLS, 0, dataSize);
+		*changed = changedTiles.erase(std::make_pair(tx, ty)) > 0;
+		return *data ? DT_TILE_SOURCE_READY : DT_TILE_SOURCE_FAILED;
+	}
+
+	void cancelTile(int tx, int ty) override
+	{
+		requests.erase(std::make_pair(tx, ty));
+		cancels++;
+	}
+
+	void freeTile(unsigned char* data, int /*dataSize*/) override
+	{
+		dtFree(data);
+		frees++;
+	}
+
+	int delay;
+	int frees;
+	int cancels;
+	std::map<std::pair<int, int>, int> requests;
+	std::map<std::pair<int, int>, bool> changedTiles;
+};
+
+bool isResident(const dtNavMesh* nav, int tx)
+{
+	return nav->getTileAt(tx, 0, 0) != 0;
+}
+
+// Center of a tile of the grid.
+void tileCenter(int tx, float* pos)
+{
+	pos[0] = (tx + 0.5f) * CELLS * TestNavMesh::CELL_SIZE;
+	pos[1] = 0.0f;
+	pos[2] = 0.5f * CELLS * TestNavMesh::CELL_SIZE;
+}
+} // namespace
+
+TEST_CASE("dtTileStreamer", "[detour]")
+{
+	dtNavMesh* nav = TestNavMesh::createNavMesh(TILES_X, 2, CELLS);
+	REQUIRE(nav);
+	TestTileSource source;
+	dtTileStreamer* streamer = dtAllocTileStreamer();
+	REQUIRE(streamer);
+
+	dtTileStreamerParams params;
+	params.loadRadius = 2.5f;
+	params.unloadRadius = 6.0f;
+	params.maxResidentBytes = 0;
+	params.maxPendingLoads = 8;
+	params.maxEntries = 32;
+	params.maxLinkedTilesPerUpdate = 0;
+
+	SECTION("Invalid parameters")
+	{
+		dtTileStreamerParams bad = params;
+		bad.unloadRadius = 1.0f;
+		CHECK(dtStatusFailed(streamer->init(nav, &source, &bad)));
+		bad = params;
+		bad.maxEntries = nav->getMaxTiles() - 1;
+		CHECK(dtStatusFailed(streamer->init(nav, &source, &bad)));
+
+		nav->setDeferredTileRelease(true);
+		CHECK(dtStatusFailed(streamer->init(nav, &source, &params)));
+		nav->setDeferredTileRelease(false);
+	}
+
+	REQUIRE(dtStatusSucceed(streamer->init(nav, &source, &params)));
+	float focus[3];
+
+	SECTION("Working set follows the focus point")
+	{
+		// Tiles within 2.5 units of the first tile: two grid tiles and three missing ones.
+		source.delay = 1;
+		tileCenter(0, focus);
+		int loaded = -1;
+		REQUIRE(dtStatusSucceed(streamer->update(focus, 1, &loaded)));
+		CHECK(loaded == 0);
+		CHECK(streamer->getPendingLoadCount() == 5);
+		REQUIRE(dtStatusSucceed(streamer->update(focus, 1, &loaded)));
+		CHECK(loaded == 0);
+		REQUIRE(dtStatusSucceed(streamer->update(focus, 1, &loaded)));
+		CHECK(loaded == 2);
+		CHECK(streamer->getPendingLoadCount() == 0);
+		CHECK(streamer->getResidentTileCount() == 2);
+		CHECK(isResident(nav, 0));
+		CHECK(isResident(nav, 1));
+
+		// Missing tiles are not requested again.
+		streamer->update(focus, 1);
+		CHECK(source.requests.empty());
+
+		// Tile 1 is within the unload radius of tile 3 and stays resident.
+		source.delay = 0;
+		tileCenter(3, focus);
+		int unloaded = -1;
+		streamer->update(focus, 1, &loaded, &unloaded);
+		CHECK(unloaded == 1);
+		streamer->update(focus, 1, &loaded, &unloaded);
+		CHECK(loaded == 3);
+		CHECK(unloaded == 0);
+		CHECK(!isResident(nav, 0));
+		CHECK(isResident(nav, 1));
+		CHECK(isResident(nav, 2));
+		CHECK(isResident(nav, 3));
+		CHECK(isResident(nav, 4));
+		CHECK(source.frees == 1);
+
+		// Tiles near any of the focus points are kept.
+		float focuses[6];
+		tileCenter(3, &focuses[0]);
+		tileCenter(7, &focuses[3]);
+		streamer->update(focuses, 2);
+		streamer->update(focuses, 2);
+		CHECK(streamer->getResidentTileCount() == 6);
+		CHECK(isResident(nav, 6));
+		CHECK(isResident(nav, 7));
+
+		int size = 0;
+		dtFree(TestNavMesh::createTileData(0, 0, CELLS, 0, &size));
+		CHECK(streamer->getResidentBytes() == (size_t)size * 6);
+
+		streamer->unloadAll();
+		CHECK(streamer->getResidentTileCount() == 0);
+		CHECK(streamer->getResidentBytes() == 0);
+		CHECK(source.frees == 7);
+	}
+
+	SECTION("Unloaded tiles keep their references")
+	{
+		tileCenter(0, focus);
+		streamer->update(focus, 1);
+		streamer->update(focus, 1);
+		const dtTileRef tileRef = nav->getTileRefAt(0, 0, 0);
+		REQUIRE(tileRef);
+		const dtPolyRef polyRef = nav->getPolyRefBase(nav->getTileByRef(tileRef)) | 3;
+		CHECK(nav->isValidPolyRef(polyRef));
+
+		tileCenter(7, focus);
+		streamer->update(focus, 1);
+		CHECK(!isResident(nav, 0));
+		CHECK(!nav->isValidPolyRef(polyRef));
+
+		// Unchanged tiles get their previous reference back.
+		tileCenter(0, focus);
+		streamer->update(focus, 1);
+		streamer->update(focus, 1);
+		CHECK(nav->getTileRefAt(0, 0, 0) == tileRef);
+		CHECK(nav->isValidPolyRef(polyRef));
+
+		// Changed tiles get a new reference, old polygon references stay stale.
+		tileCenter(7, focus);
+		streamer->update(focus, 1);
+		source.changedTiles[std::make_pair(0, 0)] = true;
+		tileCenter(0, focus);
+		streamer->update(focus, 1);
+		streamer->update(focus, 1);
+		REQUIRE(isResident(nav, 0));
+		CHECK(nav->getTileRefAt(0, 0, 0) != tileRef);
+		CHECK(!nav->isValidPolyRef(polyRef));
+	}
+
+	SECTION("Memory budget")
+	{
+		int size = 0;
+		dtFree(TestNavMesh::createTileData(0, 0, CELLS, 0, &size));
+
+		// Three tiles are in range, the farthest one is evicted.
+		tileCenter(3, focus);
+		focus[0] += 0.25f;
+		streamer->update(focus, 1);
+		streamer->update(focus, 1);
+		CHECK(streamer->getResidentTileCount() == 3);
+
+		streamer->setMaxResidentBytes((size_t)size * 2);
+		int unloaded = 0;
+		streamer->update(focus, 1, 0, &unloaded);
+		CHECK(unloaded == 1);
+		CHECK(streamer->getResidentBytes() <= (size_t)size * 2);
+		CHECK(!isResident(nav, 2));
+		CHECK(isResident(nav, 3));
+		CHECK(isResident(nav, 4));
+
+		// The evicted tile is loaded again once the budget allows it.
+		streamer->update(focus, 1);
+		CHECK(source.requests.empty());
+		streamer->setMaxResidentBytes(0);
+		streamer->update(focus, 1);
+		streamer->update(focus, 1);
+		CHECK(isResident(nav, 2));
+	}
+
+	SECTION("Pending loads are limited and cancelled")
+	{
+		dtTileStreamerParams limited = params;
+		limited.maxPendingLoads = 2;
+		REQUIRE(dtStatusSucceed(streamer->init(nav, &source, &limited)));
+		source.delay = 100;
+		tileCenter(3, focus);
+		streamer->update(focus, 1);
+		CHECK(streamer->getPendingLoadCount() == 2);
+		CHECK(source.requests.count(std::make_pair(3, 0)) == 1);
+
+		streamer->update(0, 0);
+		CHECK(source.cancels == 2);
+		CHECK(source.requests.empty());
+		CHECK(streamer->getPendingLoadCount() == 0);
+	}
+
+	SECTION("Neighbour links are spread over updates")
+	{
+		dtTileStreamerParams linked = params;
+		linked.maxLinkedTilesPerUpdate = 1;
+		REQUIRE(dtStatusSucceed(streamer->init(nav, &source, &linked)));
+		source.delay = 0;
+		tileCenter(0, focus);
+		int loaded = 0;
+		for (int i = 0; i < 4 && !loaded; ++i)
+			streamer->update(focus, 1, &loaded);
+		REQUIRE(loaded == 2);
+		CHECK(nav->getPendingTileCount() == 1);
+		streamer->update(focus, 1);
+		CHECK(nav->getPendingTileCount() == 0);
+	}
+
+	dtFreeTileStreamer(streamer);
+	dtFreeNavMesh(nav);
+}
@@ -0,0 +1,1153 @@
+#include <float.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "DetourCommon.h"
+#include "DetourCrowd.h"
+
+#include "../Detour/TestNavMeshUtils.h"
+
+namespace
+{
+bool isPillarBlocked(int cellX, int cellZ)
+{
+	return (cellX % 5) == 2 && (cellZ % 5) == 2;
+}
+
+// A clock that advances by one microsecond each time it is read.
+double s_fakeTime = 0.0;
+double fakeTime()
+{
+	return s_fakeTime += 1.0;
+}
+
+// Two groups of agents crossing each other through a field of pillars.
+dtCrowd* createCrowd(dtNavMesh* nav, const int agentCount, dtAllocator* allocator = 0)
+{
+	dtCrowd* crowd = dtAllocCrowd();
+	if (!crowd->init(agentCount, 0.6f, nav, 8, 1, DT_CROWDAGENT_MAX_NEIGHBOURS, DT_LOCAL_BOUNDARY_MAX_SEGS,
+					 DT_LOCAL_BOUNDARY_MAX_POLYS, allocator))
+	{
+		dtFreeCrowd(crowd);
+		return 0;
+	}
+
+	dtCrowdAgentParams params;
+	memset(&params, 0, sizeof(params));
+	params.radius = 0.4f;
+	params.height = 2.0f;
+	params.maxAcceleration = 8.0f;
+	params.maxSpeed = 3.5f;
+	params.collisionQueryRange = params.radius * 12.0f;
+	params.pathOptimizationRange = params.radius * 30.0f;
+	params.separationWeight = 2.0f;
+	params.updateFlags = DT_CROWD_ANTICIPATE_TURNS | DT_CROWD_OPTIMIZE_VIS | DT_CROWD_OPTIMIZE_TOPO |
+		DT_CROWD_OBSTACLE_AVOIDANCE | DT_CROWD_SEPARATION;
+	params.obstacleAvoidanceType = 3;
+
+	const dtNavMeshQuery* query = crowd->getNavMeshQuery();
+	for (int i = 0; i < agentCount; ++i)
+	{
+		const bool left = (i & 1) == 0;
+		const float pos[3] = { left ? 1.5f : 30.5f, 0.0f, 1.0f + (i / 2) * 0.9f };
+		const float target[3] = { left ? 30.5f : 1.5f, 0.0f, 31.0f - (i / 2) * 0.9f };
+		const int idx = crowd->addAgent(pos, &params);
+		if (idx < 0)
+			continue;
+		dtPolyRef ref = 0;
+		float nearest[3];
+		query->findNearestPoly(target, crowd->getQueryHalfExtents(), crowd->getFilter(0), &ref, nearest);
+		crowd->requestMoveTarget(idx, ref, nearest);
+	}
+	return crowd;
+}
+} // anonymous namespace
+
+TEST_CASE("dtCrowd::setJobDispatcher", "[crowd]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(2, 2, 16, isPillarBlocked);
+	REQUIRE(nav);
+
+	const int agentCount = 64;
+	dtCrowd* serial = createCrowd(nav, agentCount);
+	dtCrowd* threaded = createCrowd(nav, agentCount);
+	REQUIRE(serial);
+	REQUIRE(threaded);
+
+	TestNavMesh::ThreadDispatcher dispatcher(3);
+	REQUIRE(threaded->setJobDispatcher(&dispatcher));
+
+	std::vector<float> startPos(agentCount * 3);
+	for (int i = 0; i < agentCount; ++i)
+		dtVcopy(&startPos[i * 3], serial->getAgent(i)->npos);
+
+	// The updates are deterministic regardless of the number of workers.
+	for (int frame = 0; frame < 120; ++frame)
+	{
+		serial->update(1.0f / 30.0f, 0);
+		threaded->update(1.0f / 30.0f, 0);
+		REQUIRE(serial->getVelocitySampleCount() == threaded->getVelocitySampleCount());
+	}
+
+	int moved = 0;
+	for (int i = 0; i < agentCount; ++i)
+	{
+		const dtCrowdAgent* a = serial->getAgent(i);
+		const dtCrowdAgent* b = threaded->getAgent(i);
+		REQUIRE(a->active);
+		REQUIRE(memcmp(a->npos, b->npos, sizeof(a->npos)) == 0);
+		REQUIRE(memcmp(a->vel, b->vel, sizeof(a->vel)) == 0);
+		REQUIRE(a->corridor.getPathCount() == b->corridor.getPathCount());
+		if (dtVdist2D(a->npos, &startPos[i * 3]) > 5.0f)
+			moved++;
+	}
+	REQUIRE(moved > agentCount / 2);
+
+	REQUIRE(threaded->setJobDispatcher(0));
+	dtFreeCrowd(serial);
+	dtFreeCrowd(threaded);
+	dtFreeNavMesh(nav);
+}
+
+namespace
+{
+int s_globalAllocs = 0;
+
+void* countingAlloc(size_t size, dtAllocHint)
+{
+	s_globalAllocs++;
+	return malloc(size);
+}
+
+void countingFree(void* ptr)
+{
+	free(ptr);
+}
+} // anonymous namespace
+
+TEST_CASE("dtCrowd allocator", "[crowd]")
+{
+	TestNavMesh::CountingAllocator allocator;
+	dtNavMesh* nav = TestNavMesh::createGrid(2, 2, 16, isPillarBlocked, false, false, &allocator);
+	REQUIRE(nav);
+	const int navLive = allocator.live;
+
+	// The crowd and all of its queries and agents use the allocator of the crowd.
+	dtAllocSetCustom(countingAlloc, countingFree);
+	s_globalAllocs = 0;
+	dtCrowd* crowd = createCrowd(nav, 32, &allocator);
+	REQUIRE(crowd);
+	REQUIRE(s_globalAllocs == 1);
+	TestNavMesh::ThreadDispatcher dispatcher(3);
+	REQUIRE(crowd->setJobDispatcher(&dispatcher));
+	for (int frame = 0; frame < 30; ++frame)
+		crowd->update(1.0f / 30.0f, 0);
+	REQUIRE(s_globalAllocs == 1);
+	REQUIRE(allocator.live > navLive);
+	dtAllocSetCustom(0, 0);
+
+	dtFreeCrowd(crowd);
+	REQUIRE(allocator.live == navLive);
+	dtFreeNavMesh(nav);
+	REQUIRE(allocator.live == 0);
+	REQUIRE(allocator.foreign == 0);
+}
+
+TEST_CASE("dtCrowd::getMemStats", "[crowd]")
+{
+	TestNavMesh::CountingAllocator allocator;
+	dtNavMesh* nav = TestNavMesh::createGrid(2, 2, 16, isPillarBlocked, false, false, &allocator);
+	REQUIRE(nav);
+	const size_t navBytes = allocator.liveBytes;
+
+	// Everything but the crowd object itself is allocated with the allocator of the crowd.
+	dtCrowd* crowd = createCrowd(nav, 32, &allocator);
+	REQUIRE(crowd);
+	dtCrowdMemStats stats;
+	crowd->getMemStats(&stats);
+	REQUIRE(stats.total == stats.agents + stats.corridors + stats.boundaries + stats.proximityGrid + stats.pathQueue +
+			stats.navQueries + stats.obstacleAvoidance + stats.flowField + stats.snapshots);
+	REQUIRE(stats.corridors > 0);
+	REQUIRE(stats.boundaries > 0);
+	REQUIRE(stats.pathQueue > 0);
+	REQUIRE(stats.navQueries > 0);
+	REQUIRE(stats.total - sizeof(dtCrowd) == allocator.liveBytes - navBytes);
+
+	// The workers add their own queries.
+	TestNavMesh::ThreadDispatcher dispatcher(3);
+	REQUIRE(crowd->setJobDispatcher(&dispatcher));
+	dtCrowdMemStats workerStats;
+	crowd->getMemStats(&workerStats);
+	REQUIRE(workerStats.navQueries > stats.navQueries);
+	REQUIRE(workerStats.obstacleAvoidance > stats.obstacleAvoidance);
+	REQUIRE(workerStats.total - sizeof(dtCrowd) == allocator.liveBytes - navBytes);
+
+	// The memory does not change during the updates and grows with the number of agents.
+	for (int frame = 0; frame < 10; ++frame)
+		crowd->update(1.0f / 30.0f, 0);
+	crowd->getMemStats(&stats);
+	REQUIRE(stats.total == workerStats.total);
+
+	dtCrowd* larger = createCrowd(nav, 64, &allocator);
+	REQUIRE(larger);
+	dtCrowdMemStats largerStats;
+	larger->getMemStats(&largerStats);
+	REQUIRE(largerStats.agents > stats.agents);
+	REQUIRE(largerStats.corridors == stats.corridors * 2);
+
+	dtFreeCrowd(larger);
+	dtFreeCrowd(crowd);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtProximityGrid", "[crowd]")
+{
+	dtProximityGrid* grid = dtAllocProximityGrid();
+	REQUIRE(grid->init(64, 2.0f));
+
+	SECTION("Items are found in the cells they overlap")
+	{
+		grid->clear();
+		grid->addItem(100000, 1.0f, 1.0f, 1.0f, 1.0f);
+		grid->addItem(7, -3.0f, -3.0f, 3.0f, -1.0f);
+		grid->addItem(8, 9.0f, 9.0f, 9.0f, 9.0f);
+		grid->build();
+
+		unsigned int ids[8];
+		int n = grid->queryItems(0.0f, 0.0f, 1.5f, 1.5f, ids, 8);
+		REQUIRE(n == 1);
+		REQUIRE(ids[0] == 100000);
+
+		// The box item is stored in eight cells, but reported once.
+		n = grid->queryItems(-4.0f, -4.0f, 4.0f, 0.5f, ids, 8);
+		REQUIRE(n == 2);
+
+		n = grid->queryItems(20.0f, 20.0f, 30.0f, 30.0f, ids, 8);
+		REQUIRE(n == 0);
+
+		// The rows of cells are contiguous.
+		int cells[4];
+		REQUIRE(grid->getCellRange(-100.0f, -100.0f, 100.0f, 100.0f, cells));
+		int total = 0;
+		for (int y = cells[1]; y <= cells[3]; ++y)
+		{
+			int count = 0;
+			grid->getRowItems(cells[0], cells[2], y, count);
+			total += count;
+		}
+		REQUIRE(total == 10);
+		REQUIRE(grid->getItemCountAt(-2, -2) == 1);
+	}
+
+	SECTION("Far apart items coarsen the cells")
+	{
+		grid->clear();
+		grid->addItem(1, 0.0f, 0.0f, 0.0f, 0.0f);
+		grid->addItem(2, 5000.0f, -5000.0f, 5000.0f, -5000.0f);
+		grid->build();
+		REQUIRE(grid->getCellSize() > 2.0f);
+
+		unsigned int ids[8];
+		const int n = grid->queryItems(4999.0f, -5001.0f, 5001.0f, -4999.0f, ids, 8);
+		REQUIRE(n == 1);
+		REQUIRE(ids[0] == 2);
+	}
+
+	dtFreeProximityGrid(grid);
+}
+
+TEST_CASE("dtCrowd neighbours", "[crowd]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(1, 1, 16);
+	REQUIRE(nav);
+
+	const int maxNeighbours = 16;
+	dtCrowd* crowd = dtAllocCrowd();
+	REQUIRE(crowd->init(32, 0.6f, nav, 8, 1, maxNeighbours));
+	REQUIRE(crowd->getMaxNeighbours() == maxNeighbours);
+
+	dtCrowdAgentParams params;
+	memset(&params, 0, sizeof(params));
+	params.radius = 0.4f;
+	params.height = 2.0f;
+	params.maxAcceleration = 8.0f;
+	params.maxSpeed = 3.5f;
+	params.collisionQueryRange = 10.0f;
+	params.pathOptimizationRange = 10.0f;
+	params.updateFlags = DT_CROWD_OBSTACLE_AVOIDANCE;
+
+	// A dense block of agents, each one sees all of the others.
+	const int agentCount = 25;
+	for (int i = 0; i < agentCount; ++i)
+	{
+		params.maxNeighbours = (unsigned char)(i == 0 ? 3 : 0);
+		const float pos[3] = { 6.0f + (i % 5) * 0.9f, 0.0f, 6.0f + (i / 5) * 0.9f };
+		REQUIRE(crowd->addAgent(pos, &params) == i);
+	}
+	crowd->update(1.0f / 30.0f, 0);
+
+	for (int i = 0; i < agentCount; ++i)
+	{
+		const dtCrowdAgent* ag = crowd->getAgent(i);
+		REQUIRE(ag->nneis == (i == 0 ? 3 : maxNeighbours));
+		for (int j = 0; j < ag->nneis; ++j)
+		{
+			REQUIRE(ag->neis[j].idx != i);
+			if (j > 0)
+				REQUIRE(ag->neis[j - 1].dist <= ag->neis[j].dist);
+		}
+	}
+
+	dtFreeCrowd(crowd);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtCrowd clusters", "[crowd]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(2, 2, 16, isPillarBlocked);
+	REQUIRE(nav);
+
+	const int agentCount = 64;
+	dtCrowd* single = createCrowd(nav, agentCount);
+	dtCrowd* clustered = createCrowd(nav, agentCount);
+	REQUIRE(single);
+	REQUIRE(clustered);
+	clustered->setClusterSize(4.0f);
+	REQUIRE(clustered->getClusterSize() == 4.0f);
+
+	single->update(1.0f / 30.0f, 0);
+	clustered->update(1.0f / 30.0f, 0);
+	REQUIRE(single->getClusterCount() == 0);
+	REQUIRE(clustered->getClusterCount() > 1);
+	REQUIRE(clustered->getClusterCount() < agentCount / 2);
+
+	// The neighbours are the same, the boundaries are searched from fewer agents.
+	for (int i = 0; i < agentCount; ++i)
+	{
+		const dtCrowdAgent* a = single->getAgent(i);
+		const dtCrowdAgent* b = clustered->getAgent(i);
+		REQUIRE(a->nneis == b->nneis);
+		for (int j = 0; j < a->nneis; ++j)
+		{
+			REQUIRE(a->neis[j].idx == b->neis[j].idx);
+			REQUIRE(a->neis[j].dist == b->neis[j].dist);
+		}
+		REQUIRE(b->boundary.hasPoly(b->corridor.getFirstPoly()));
+		REQUIRE(b->boundary.getSegmentCount() > 0);
+	}
+
+	// Clustered updates are deterministic regardless of the number of workers.
+	dtCrowd* threaded = createCrowd(nav, agentCount);
+	REQUIRE(threaded);
+	threaded->setClusterSize(4.0f);
+	TestNavMesh::ThreadDispatcher dispatcher(3);
+	REQUIRE(threaded->setJobDispatcher(&dispatcher));
+	threaded->update(1.0f / 30.0f, 0);
+	for (int frame = 0; frame < 120; ++frame)
+	{
+		clustered->update(1.0f / 30.0f, 0);
+		threaded->update(1.0f / 30.0f, 0);
+	}
+	int moved = 0;
+	for (int i = 0; i < agentCount; ++i)
+	{
+		const dtCrowdAgent* a = clustered->getAgent(i);
+		const dtCrowdAgent* b = threaded->getAgent(i);
+		REQUIRE(memcmp(a->npos, b->npos, sizeof(a->npos)) == 0);
+		REQUIRE(memcmp(a->vel, b->vel, sizeof(a->vel)) == 0);
+		if (dtVdist2D(a->npos, single->getAgent(i)->npos) > 5.0f)
+			moved++;
+	}
+	REQUIRE(moved > agentCount / 2);
+
+	clustered->setClusterSize(0.0f);
+	clustered->update(1.0f / 30.0f, 0);
+	REQUIRE(clustered->getClusterCount() == 0);
+
+	dtFreeCrowd(threaded);
+	dtFreeCrowd(clustered);
+	dtFreeCrowd(single);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtCrowd active agents", "[crowd]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(1, 1, 16);
+	REQUIRE(nav);
+
+	const int maxAgents = 8;
+	dtCrowd* crowd = dtAllocCrowd();
+	REQUIRE(crowd->init(maxAgents, 0.6f, nav));
+
+	dtCrowdAgentParams params;
+	memset(&params, 0, sizeof(params));
+	params.radius = 0.4f;
+	params.height = 2.0f;
+	params.maxAcceleration = 8.0f;
+	params.maxSpeed = 3.5f;
+	params.collisionQueryRange = 5.0f;
+	params.pathOptimizationRange = 10.0f;
+
+	// Slots are handed out in order until the pool is full.
+	for (int i = 0; i < maxAgents; ++i)
+	{
+		const float pos[3] = { 1.0f + i * 1.5f, 0.0f, 2.0f };
+		REQUIRE(crowd->addAgent(pos, &params) == i);
+	}
+	const float pos[3] = { 2.0f, 0.0f, 6.0f };
+	REQUIRE(crowd->addAgent(pos, &params) == -1);
+	REQUIRE(crowd->getActiveAgentCount() == maxAgents);
+
+	// Removing an agent moves the last active agent to its place, removing it twice does nothing.
+	crowd->removeAgent(2);
+	crowd->removeAgent(2);
+	crowd->removeAgent(5);
+	crowd->removeAgent(-1);
+	crowd->removeAgent(maxAgents);
+	REQUIRE(crowd->getActiveAgentCount() == maxAgents - 2);
+
+	dtCrowdAgent* agents[maxAgents];
+	REQUIRE(crowd->getActiveAgents(agents, maxAgents) == maxAgents - 2);
+	const int expected[] = { 0, 1, 7, 3, 4, 6 };
+	for (int i = 0; i < maxAgents - 2; ++i)
+		REQUIRE(agents[i] - crowd->getAgent(0) == expected[i]);
+	REQUIRE(crowd->getActiveAgents(agents, 2) == 2);
+
+	// The most recently freed slot is reused first.
+	REQUIRE(crowd->addAgent(pos, &params) == 5);
+	REQUIRE(crowd->addAgent(pos, &params) == 2);
+	REQUIRE(crowd->addAgent(pos, &params) == -1);
+	REQUIRE(crowd->getActiveAgentCount() == maxAgents);
+
+	crowd->update(1.0f / 30.0f, 0);
+	for (int i = 0; i < maxAgents; ++i)
+		REQUIRE(crowd->getAgent(i)->active);
+
+	dtFreeCrowd(crowd);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtCrowd path optimization budget", "[crowd]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(2, 2, 16, isPillarBlocked);
+	REQUIRE(nav);
+
+	const int agentCount = 32;
+	dtCrowd* crowd = createCrowd(nav, agentCount);
+	REQUIRE(crowd);
+	REQUIRE(crowd->getTopologyOptimizationMaxAgents() == 1);
+	REQUIRE(crowd->getTopologyOptimizationInterval() == 0.5f);
+
+	crowd->setTopologyOptimizationBudget(0, -1.0f);
+	REQUIRE(crowd->getTopologyOptimizationMaxAgents() == 1);
+	REQUIRE(crowd->getTopologyOptimizationInterval() == 0.0f);
+	crowd->setTopologyOptimizationBudget(agentCount * 2, 0.25f);
+	REQUIRE(crowd->getTopologyOptimizationMaxAgents() == agentCount);
+	crowd->setTopologyOptimizationBudget(8, 0.25f);
+	REQUIRE(crowd->getTopologyOptimizationMaxAgents() == 8);
+
+	// Reusing the visibility optimizations still gets the agents across.
+	std::vector<float> startPos(agentCount * 3);
+	for (int i = 0; i < agentCount; ++i)
+	{
+		dtCrowdAgentParams params = crowd->getAgent(i)->params;
+		params.pathOptimizationReuseDist = params.radius * 0.5f;
+		crowd->updateAgentParameters(i, &params);
+		dtVcopy(&startPos[i * 3], crowd->getAgent(i)->npos);
+	}
+	for (int frame = 0; frame < 120; ++frame)
+		crowd->update(1.0f / 30.0f, 0);
+
+	int moved = 0;
+	for (int i = 0; i < agentCount; ++i)
+	{
+		if (dtVdist2D(crowd->getAgent(i)->npos, &startPos[i * 3]) > 5.0f)
+			moved++;
+	}
+	REQUIRE(moved > agentCount / 2);
+
+	dtFreeCrowd(crowd);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtCrowd snapshots", "[crowd]")
+{
+	SECTION("The update publishes the agent states")
+	{
+		dtNavMesh* nav = TestNavMesh::createGrid(2, 2, 16, isPillarBlocked);
+		REQUIRE(nav);
+		dtCrowd* crowd = createCrowd(nav, 16);
+		REQUIRE(crowd);
+
+		dtCrowdAgentSnapshot states[16];
+		int stateCount = -1;
+		REQUIRE(dtStatusFailed(crowd->getSnapshots()->read(states, &stateCount, 16)));
+		REQUIRE(crowd->initSnapshots(true));
+		REQUIRE(dtStatusFailed(crowd->getSnapshots()->read(states, &stateCount, 16)));
+		REQUIRE(stateCount == 0);
+
+		crowd->removeAgent(3);
+		for (int frame = 0; frame < 5; ++frame)
+			crowd->update(0.1f, 0);
+
+		unsigned int frame = 0;
+		REQUIRE(crowd->getSnapshots()->read(states, &stateCount, 16, &frame) == DT_SUCCESS);
+		REQUIRE(frame == 5);
+		REQUIRE(stateCount == crowd->getActiveAgentCount());
+		for (int i = 0; i < stateCount; ++i)
+		{
+			const dtCrowdAgent* ag = crowd->getAgent(states[i].idx);
+			REQUIRE(ag->active);
+			REQUIRE(dtVequal(states[i].pos, ag->npos));
+			REQUIRE(dtVequal(states[i].vel, ag->vel));
+			REQUIRE(dtVequal(states[i].targetPos, ag->targetPos));
+			REQUIRE(states[i].targetRef == ag->targetRef);
+			REQUIRE(states[i].state == ag->state);
+			REQUIRE(states[i].targetState == ag->targetState);
+		}
+
+		REQUIRE(crowd->getSnapshots()->read(states, &stateCount, 4) == (DT_SUCCESS | DT_BUFFER_TOO_SMALL));
+		REQUIRE(stateCount == 4);
+
+		dtFreeCrowd(crowd);
+		dtFreeNavMesh(nav);
+	}
+
+	SECTION("Readers on other threads see complete snapshots")
+	{
+		const int maxStates = 64;
+		dtCrowdSnapshotBuffer snapshots;
+		REQUIRE(snapshots.init(maxStates));
+
+		// Every state of a snapshot is tagged with its frame, a torn copy mixes two frames.
+		std::atomic<bool> done(false);
+		std::atomic<int> tornCount(0);
+		std::atomic<int> readCount(0);
+		std::vector<std::thread> readers;
+		for (int r = 0; r < 2; ++r)
+		{
+			readers.emplace_back([&]() {
+				dtCrowdAgentSnapshot states[maxStates];
+				while (!done)
+				{
+					int stateCount = 0;
+					unsigned int frame = 0;
+					if (dtStatusFailed(snapshots.read(states, &stateCount, maxStates, &frame)))
+						continue;
+					if (stateCount != (int)(frame % maxStates))
+						tornCount++;
+					for (int i = 0; i < stateCount; ++i)
+					{
+						if (states[i].idx != (int)frame || states[i].pos[0] != (float)frame)
+							tornCount++;
+					}
+					readCount++;
+				}
+			});
+		}
+
+		for (unsigned int frame = 1; frame <= 20000; ++frame)
+		{
+			dtCrowdAgentSnapshot* states = snapshots.beginPublish();
+			const int count = (int)(frame % maxStates);
+			for (int i = 0; i < count; ++i)
+			{
+				memset(&states[i], 0, sizeof(states[i]));
+				states[i].idx = (int)frame;
+				states[i].pos[0] = (float)frame;
+			}
+			snapshots.endPublish(count, frame);
+		}
+		while (readCount == 0)
+			std::this_thread::yield();
+		done = true;
+		for (std::thread& t : readers)
+			t.join();
+
+		REQUIRE(tornCount == 0);
+		REQUIRE(readCount > 0);
+	}
+}
+
+TEST_CASE("dtLocalBoundary", "[crowd]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(2, 2, 16, isPillarBlocked);
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 512)));
+	dtQueryFilter filter;
+
+	// Between four pillars.
+	const float pos[3] = { 9.6f, 0.0f, 9.3f };
+	const float halfExtents[3] = { 1.0f, 1.0f, 1.0f };
+	dtPolyRef ref = 0;
+	float nearest[3];
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(pos, halfExtents, &filter, &ref, nearest)));
+	REQUIRE(ref);
+
+	const float range = 5.0f;
+	dtLocalBoundary direct;
+	REQUIRE(direct.init(8, 64));
+	direct.update(ref, pos, range, query, &filter);
+	REQUIRE(direct.getPolyCount() > 16);
+	REQUIRE(direct.getSegmentCount() == 8);
+	REQUIRE(direct.isValid(query, &filter));
+
+	SECTION("Cached segments match the queried segments")
+	{
+		dtWallSegmentCache cache;
+		REQUIRE(cache.init(256, 1024));
+
+		dtLocalBoundary cached;
+		REQUIRE(cached.init(8, 64));
+		cached.updatePolys(ref, pos, range, query, &filter);
+		REQUIRE(cached.getSegmentCount() == 0);
+		for (int i = 0; i < cached.getPolyCount(); ++i)
+			REQUIRE(cache.addPoly(cached.getPoly(i), &filter, query));
+
+		// The polygons are only added once.
+		const int polyCount = cache.getPolyCount();
+		for (int i = 0; i < cached.getPolyCount(); ++i)
+			REQUIRE(cache.addPoly(cached.getPoly(i), &filter, query));
+		REQUIRE(cache.getPolyCount() == polyCount);
+		REQUIRE(polyCount == cached.getPolyCount());
+
+		cached.updateSegments(range, query, &filter, &cache);
+		REQUIRE(cached.getSegmentCount() == direct.getSegmentCount());
+		for (int i = 0; i < direct.getSegmentCount(); ++i)
+			REQUIRE(memcmp(cached.getSegment(i), direct.getSegment(i), sizeof(float) * 6) == 0);
+
+		cache.clear();
+		REQUIRE(cache.getPolyCount() == 0);
+		const float* segs = 0;
+		int nsegs = 0;
+		REQUIRE(!cache.getSegments(ref, &filter, &segs, &nsegs));
+	}
+
+	SECTION("Segments missing from a full cache are queried")
+	{
+		dtWallSegmentCache cache;
+		REQUIRE(cache.init(4, 8));
+
+		dtLocalBoundary cached;
+		REQUIRE(cached.init(8, 64));
+		cached.updatePolys(ref, pos, range, query, &filter);
+		for (int i = 0; i < cached.getPolyCount(); ++i)
+			cache.addPoly(cached.getPoly(i), &filter, query);
+		REQUIRE(cache.getPolyCount() <= 4);
+		REQUIRE(cache.getSegmentCount() <= 8);
+
+		cached.updateSegments(range, query, &filter, &cache);
+		REQUIRE(cached.getSegmentCount() == direct.getSegmentCount());
+		for (int i = 0; i < direct.getSegmentCount(); ++i)
+			REQUIRE(memcmp(cached.getSegment(i), direct.getSegment(i), sizeof(float) * 6) == 0);
+	}
+
+	SECTION("The crowd shares the segments of overlapping boundaries")
+	{
+		dtCrowd* crowd = createCrowd(nav, 64);
+		REQUIRE(crowd);
+		crowd->update(1.0f / 30.0f, 0);
+
+		int boundaryPolys = 0;
+		for (int i = 0; i < crowd->getAgentCount(); ++i)
+		{
+			REQUIRE(crowd->getAgent(i)->boundary.getMaxSegments() == DT_LOCAL_BOUNDARY_MAX_SEGS);
+			boundaryPolys += crowd->getAgent(i)->boundary.getPolyCount();
+		}
+		const int cachedPolys = crowd->getWallSegmentCache()->getPolyCount();
+		REQUIRE(cachedPolys > 0);
+		REQUIRE(cachedPolys < boundaryPolys / 2);
+		dtFreeCrowd(crowd);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtCrowd path validation", "[crowd]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(2, 2, 16, isPillarBlocked);
+	REQUIRE(nav);
+	dtCrowd* crowd = createCrowd(nav, 8);
+	REQUIRE(crowd);
+
+	crowd->update(1.0f / 30.0f, 0);
+#ifdef DT_QUERY_STATS
+	// The first update searches the paths of the agents.
+	CHECK(crowd->getQueryStats().queryCount > 0);
+	CHECK(crowd->getQueryStats().nodesExpanded > 0);
+#else
+	CHECK(crowd->getQueryStats().queryCount == 0);
+#endif
+
+	for (int frame = 1; frame < 10; ++frame)
+		crowd->update(1.0f / 30.0f, 0);
+
+	// Nothing has changed since the paths were found.
+	for (int i = 0; i < crowd->getAgentCount(); ++i)
+	{
+		const dtCrowdAgent* ag = crowd->getAgent(i);
+		REQUIRE(ag->targetState == DT_CROWDAGENT_TARGET_VALID);
+		REQUIRE(!ag->pathChanged);
+		REQUIRE(ag->pathGeneration == nav->getGeneration());
+	}
+
+	// Block a polygon ahead of the first agent.
+	const dtCrowdAgent* ag = crowd->getAgent(0);
+	REQUIRE(ag->corridor.getPathCount() > 3);
+	const dtPolyRef blocked = ag->corridor.getPath()[2];
+	REQUIRE(dtStatusSucceed(nav->setPolyFlags(blocked, 0)));
+
+	crowd->update(1.0f / 30.0f, 0);
+	REQUIRE(ag->pathGeneration == nav->getGeneration());
+	// The corridor is repaired around the polygon without a replan.
+	REQUIRE(!ag->targetReplan);
+	REQUIRE(ag->targetState == DT_CROWDAGENT_TARGET_VALID);
+	for (int i = 0; i < ag->corridor.getPathCount(); ++i)
+		REQUIRE(ag->corridor.getPath()[i] != blocked);
+
+	// Blocking the target polygon cannot be repaired.
+	const dtPolyRef target = ag->corridor.getLastPoly();
+	REQUIRE(dtStatusSucceed(nav->setPolyFlags(target, 0)));
+	crowd->update(1.0f / 30.0f, 0);
+	REQUIRE(ag->targetRef != target);
+	REQUIRE(ag->targetReplan);
+
+	for (int frame = 0; frame < 10; ++frame)
+		crowd->update(1.0f / 30.0f, 0);
+	for (int i = 0; i < ag->corridor.getPathCount(); ++i)
+	{
+		REQUIRE(ag->corridor.getPath()[i] != blocked);
+		REQUIRE(ag->corridor.getPath()[i] != target);
+	}
+
+	// Changing the filter validates the paths using it.
+	crowd->getEditableFilter(0)->setIncludeFlags(0);
+	crowd->update(1.0f / 30.0f, 0);
+	for (int i = 0; i < crowd->getAgentCount(); ++i)
+		REQUIRE(crowd->getAgent(i)->state == DT_CROWDAGENT_STATE_INVALID);
+
+	dtFreeCrowd(crowd);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtCrowd group move request", "[crowd]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(2, 2, 16, isPillarBlocked);
+	REQUIRE(nav);
+	dtCrowd* crowd = createCrowd(nav, 16);
+	REQUIRE(crowd);
+	const dtNavMeshQuery* query = crowd->getNavMeshQuery();
+
+	const float target[3] = { 16.5f, 0.0f, 29.5f };
+	dtPolyRef targetRef = 0;
+	float nearest[3];
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(target, crowd->getQueryHalfExtents(), crowd->getFilter(0), &targetRef, nearest)));
+
+	// The last agent uses another filter and is given a regular request.
+	crowd->getEditableAgent(15)->params.queryFilterType = 1;
+	int group[16];
+	for (int i = 0; i < 16; ++i)
+		group[i] = i;
+	REQUIRE(crowd->requestMoveTargetGroup(group, 16, targetRef, nearest) == 15);
+	REQUIRE(crowd->getFlowField()->getTargetRef() == targetRef);
+	REQUIRE(crowd->getAgent(15)->targetState == DT_CROWDAGENT_TARGET_REQUESTING);
+
+	for (int i = 0; i < 15; ++i)
+	{
+		const dtCrowdAgent* ag = crowd->getAgent(i);
+		REQUIRE(ag->targetState == DT_CROWDAGENT_TARGET_VALID);
+		REQUIRE(ag->targetRef == targetRef);
+		REQUIRE(ag->corridor.getLastPoly() == targetRef);
+
+		// The path is connected, and costs decrease towards the target.
+		const dtPolyRef* path = ag->corridor.getPath();
+		float prevCost = FLT_MAX;
+		for (int j = 0; j < ag->corridor.getPathCount(); ++j)
+		{
+			float cost = 0;
+			REQUIRE(crowd->getFlowField()->getCost(path[j], &cost));
+			REQUIRE(cost < prevCost);
+			prevCost = cost;
+			if (j > 0)
+			{
+				const dtMeshTile* tile = 0;
+				const dtPoly* poly = 0;
+				nav->getTileAndPolyByRefUnsafe(path[j - 1], &tile, &poly);
+				bool linked = false;
+				for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+					linked |= tile->links[k].ref == path[j];
+				REQUIRE(linked);
+			}
+		}
+		REQUIRE(prevCost == 0.0f);
+	}
+
+	for (int frame = 0; frame < 300; ++frame)
+		crowd->update(1.0f / 30.0f, 0);
+	int arrived = 0;
+	for (int i = 0; i < 16; ++i)
+	{
+		if (dtVdist2D(crowd->getAgent(i)->npos, nearest) < 4.0f)
+			arrived++;
+	}
+	REQUIRE(arrived > 8);
+
+	SECTION("Invalid requests")
+	{
+		REQUIRE(crowd->requestMoveTargetGroup(group, 0, targetRef, nearest) == -1);
+		REQUIRE(crowd->requestMoveTargetGroup(group, 16, 0, nearest) == -1);
+		const int bad[2] = { 0, 100 };
+		REQUIRE(crowd->requestMoveTargetGroup(bad, 2, targetRef, nearest) == -1);
+	}
+
+	dtFreeCrowd(crowd);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtCrowd agent LOD", "[crowd]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(2, 2, 16, isPillarBlocked);
+	REQUIRE(nav);
+
+	const int agentCount = 64;
+	dtCrowd* full = createCrowd(nav, agentCount);
+	dtCrowd* reduced = createCrowd(nav, agentCount);
+	REQUIRE(full);
+	REQUIRE(reduced);
+	REQUIRE(reduced->getLODUpdateInterval() == 4);
+
+	// Every fourth agent is frozen, every fourth follows its corridor, and the rest are reduced.
+	std::vector<float> startPos(agentCount * 3);
+	for (int i = 0; i < agentCount; ++i)
+	{
+		dtCrowdAgentParams params = reduced->getAgent(i)->params;
+		params.lod = (unsigned char)(i % 4 == 0 ? DT_CROWDAGENT_LOD_FROZEN :
+									 i % 4 == 1 ? DT_CROWDAGENT_LOD_CORRIDOR : DT_CROWDAGENT_LOD_REDUCED);
+		reduced->updateAgentParameters(i, &params);
+		dtVcopy(&startPos[i * 3], reduced->getAgent(i)->npos);
+	}
+
+	int fullSamples = 0;
+	int reducedSamples = 0;
+	for (int frame = 0; frame < 120; ++frame)
+	{
+		full->update(1.0f / 30.0f, 0);
+		reduced->update(1.0f / 30.0f, 0);
+		fullSamples += full->getVelocitySampleCount();
+		reducedSamples += reduced->getVelocitySampleCount();
+	}
+	// Half of the agents plan their velocity once every four frames.
+	REQUIRE(reducedSamples * 4 < fullSamples);
+
+	for (int i = 0; i < agentCount; ++i)
+	{
+		const dtCrowdAgent* ag = reduced->getAgent(i);
+		const float moved = dtVdist2D(ag->npos, &startPos[i * 3]);
+		if (ag->params.lod == DT_CROWDAGENT_LOD_FROZEN)
+		{
+			REQUIRE(moved == 0.0f);
+			REQUIRE(dtVlen(ag->vel) == 0.0f);
+		}
+		else
+		{
+			REQUIRE(moved > 1.0f);
+		}
+		if (ag->params.lod == DT_CROWDAGENT_LOD_CORRIDOR)
+			REQUIRE(ag->nneis == 0);
+	}
+
+	dtFreeCrowd(full);
+	dtFreeCrowd(reduced);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtCrowd sleeping agents", "[crowd]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(2, 1, 8);
+	REQUIRE(nav);
+	dtCrowd* crowd = dtAllocCrowd();
+	REQUIRE(crowd->init(8, 0.6f, nav));
+	REQUIRE(crowd->getSleepDelay() == 1.0f);
+	crowd->setSleepDelay(0.5f);
+
+	dtCrowdAgentParams params;
+	memset(&params, 0, sizeof(params));
+	params.radius = 0.4f;
+	params.height = 2.0f;
+	params.maxAcceleration = 8.0f;
+	params.maxSpeed = 3.5f;
+	params.collisionQueryRange = params.radius * 12.0f;
+	params.pathOptimizationRange = params.radius * 30.0f;
+	params.updateFlags = DT_CROWD_SLEEP;
+
+	// An idle agent, and an agent in the other tile walking straight through it.
+	const float idlePos[3] = { 11.0f, 0.0f, 4.0f };
+	const float walkerPos[3] = { 2.0f, 0.0f, 4.0f };
+	const int idle = crowd->addAgent(idlePos, &params);
+	const int walker = crowd->addAgent(walkerPos, &params);
+	REQUIRE(idle >= 0);
+	REQUIRE(walker >= 0);
+
+	const float dt = 1.0f / 30.0f;
+	for (int frame = 0; frame < 20; ++frame)
+		crowd->update(dt, 0);
+	REQUIRE(crowd->getAgent(idle)->state == DT_CROWDAGENT_STATE_SLEEPING);
+	REQUIRE(crowd->getAgent(walker)->state == DT_CROWDAGENT_STATE_SLEEPING);
+
+	SECTION("Agents without the flag stay awake")
+	{
+		params.updateFlags = 0;
+		crowd->updateAgentParameters(idle, &params);
+		REQUIRE(crowd->getAgent(idle)->state == DT_CROWDAGENT_STATE_WALKING);
+		for (int frame = 0; frame < 20; ++frame)
+			crowd->update(dt, 0);
+		CHECK(crowd->getAgent(idle)->state == DT_CROWDAGENT_STATE_WALKING);
+	}
+
+	SECTION("A move request wakes the agent until it has arrived")
+	{
+		const float target[3] = { 13.0f, 0.0f, 2.0f };
+		dtPolyRef ref = 0;
+		float nearest[3];
+		crowd->getNavMeshQuery()->findNearestPoly(target, crowd->getQueryHalfExtents(), crowd->getFilter(0), &ref, nearest);
+		REQUIRE(crowd->requestMoveTarget(idle, ref, nearest));
+		REQUIRE(crowd->getAgent(idle)->state == DT_CROWDAGENT_STATE_WALKING);
+
+		bool slept = false;
+		for (int frame = 0; frame < 300 && !slept; ++frame)
+		{
+			crowd->update(dt, 0);
+			slept = crowd->getAgent(idle)->state == DT_CROWDAGENT_STATE_SLEEPING;
+		}
+		REQUIRE(slept);
+		CHECK(dtVdist2D(crowd->getAgent(idle)->npos, nearest) < params.radius);
+		CHECK(dtVlen(crowd->getAgent(idle)->vel) == 0.0f);
+	}
+
+	SECTION("A moving agent wakes the sleeping agents it runs into")
+	{
+		const float target[3] = { 15.0f, 0.0f, 4.0f };
+		dtPolyRef ref = 0;
+		float nearest[3];
+		crowd->getNavMeshQuery()->findNearestPoly(target, crowd->getQueryHalfExtents(), crowd->getFilter(0), &ref, nearest);
+		REQUIRE(crowd->requestMoveTarget(walker, ref, nearest));
+
+		bool woken = false;
+		for (int frame = 0; frame < 120 && !woken; ++frame)
+		{
+			crowd->update(dt, 0);
+			woken = crowd->getAgent(idle)->state == DT_CROWDAGENT_STATE_WALKING;
+		}
+		REQUIRE(woken);
+		CHECK(dtVdist2D(crowd->getAgent(walker)->npos, idlePos) < 2.0f * params.radius);
+	}
+
+	SECTION("A change of the tile under the agent wakes it")
+	{
+		const dtPolyRef ref = crowd->getAgent(idle)->corridor.getFirstPoly();
+		REQUIRE(dtStatusSucceed(nav->setPolyFlags(ref, 3)));
+		crowd->update(dt, 0);
+		CHECK(crowd->getAgent(idle)->state == DT_CROWDAGENT_STATE_WALKING);
+		CHECK(crowd->getAgent(walker)->state == DT_CROWDAGENT_STATE_SLEEPING);
+	}
+
+	dtFreeCrowd(crowd);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtPathQueue", "[crowd]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(2, 2, 16, isPillarBlocked);
+	REQUIRE(nav);
+	dtQueryFilter filter;
+
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 256)));
+	const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+	const int requestCount = 12;
+	dtPolyRef startRefs[requestCount], endRefs[requestCount];
+	float startPos[requestCount * 3], endPos[requestCount * 3];
+	for (int i = 0; i < requestCount; ++i)
+	{
+		const float s[3] = { 0.5f, 0.0f, 0.5f + i * 2.5f };
+		const float e[3] = { 31.5f, 0.0f, 31.5f - i * 2.5f };
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(s, halfExtents, &filter, &startRefs[i], &startPos[i * 3])));
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(e, halfExtents, &filter, &endRefs[i], &endPos[i * 3])));
+	}
+	dtFreeNavMeshQuery(query);
+
+	// Runs the requests to completion, collecting the results and the latencies.
+	struct Result
+	{
+		std::vector<dtPolyRef> path;
+		dtPathQueueRequestStats stats;
+	};
+	auto run = [&](dtPathQueue& pathq, std::vector<Result>& results, bool budgeted) {
+		std::vector<dtPathQueueRef> refs(requestCount);
+		for (int i = 0; i < requestCount; ++i)
+		{
+			// Every third request is urgent.
+			refs[i] = pathq.request(startRefs[i], endRefs[i], &startPos[i * 3], &endPos[i * 3], &filter, i % 3 == 0 ? 0 : 1);
+			REQUIRE(refs[i] != DT_PATHQ_INVALID);
+		}
+		results.resize(requestCount);
+		int done = 0;
+		for (int update = 0; update < 1000 && done < requestCount; ++update)
+		{
+			if (budgeted)
+			{
+				dtTimeBudget budget;
+				dtInitTimeBudget(budget, fakeTime, 16.0, 4);
+				int iters = 0;
+				pathq.update(budget, &iters);
+				REQUIRE(iters <= 3 * 16 * 4);
+			}
+			else
+			{
+				pathq.update(40);
+			}
+			for (int i = 0; i < requestCount; ++i)
+			{
+				if (refs[i] == DT_PATHQ_INVALID || !dtStatusSucceed(pathq.getRequestStatus(refs[i])))
+					continue;
+				REQUIRE(dtStatusSucceed(pathq.getRequestStats(refs[i], &results[i].stats)));
+				dtPolyRef path[256];
+				int npath = 0;
+				REQUIRE(dtStatusSucceed(pathq.getPathResult(refs[i], path, &npath, 256)));
+				results[i].path.assign(path, path + npath);
+				refs[i] = DT_PATHQ_INVALID;
+				done++;
+			}
+		}
+		REQUIRE(done == requestCount);
+	};
+
+	dtPathQueue serial;
+	REQUIRE(serial.init(256, 1024, nav, 16, 3));
+	REQUIRE(serial.getMaxRequests() == 16);
+	std::vector<Result> serialResults;
+	run(serial, serialResults, false);
+
+	SECTION("Urgent requests are served first")
+	{
+		for (int i = 0; i < requestCount; ++i)
+		{
+			REQUIRE(serialResults[i].path.back() == endRefs[i]);
+			REQUIRE(serialResults[i].stats.iterations > 0);
+			REQUIRE(serialResults[i].stats.searchUpdates > 0);
+			for (int j = 0; j < requestCount; ++j)
+			{
+				if (i % 3 == 0 && j % 3 != 0)
+					REQUIRE(serialResults[i].stats.waitUpdates <= serialResults[j].stats.waitUpdates);
+			}
+		}
+		REQUIRE(serialResults[requestCount - 1].stats.waitUpdates > 0);
+	}
+
+	SECTION("Concurrent searches match the serial searches")
+	{
+		TestNavMesh::ThreadDispatcher dispatcher(2);
+		dtPathQueue threaded;
+		REQUIRE(threaded.init(256, 1024, nav, 16, 3));
+		threaded.setJobDispatcher(&dispatcher);
+		std::vector<Result> threadedResults;
+		run(threaded, threadedResults, false);
+		for (int i = 0; i < requestCount; ++i)
+		{
+			REQUIRE(threadedResults[i].path == serialResults[i].path);
+			REQUIRE(threadedResults[i].stats.waitUpdates == serialResults[i].stats.waitUpdates);
+			REQUIRE(threadedResults[i].stats.iterations == serialResults[i].stats.iterations);
+		}
+	}
+
+	SECTION("Repeated requests are served from the cache")
+	{
+		dtPathQueue cached;
+		REQUIRE(cached.init(256, 1024, nav, 16, 3));
+		REQUIRE(cached.initPathCache(16));
+		std::vector<Result> firstResults, repeatResults;
+		run(cached, firstResults, false);
+		REQUIRE(cached.getPathCache()->getPathCount() == requestCount);
+		REQUIRE(cached.getPathCache()->getHitCount() == 0);
+
+		run(cached, repeatResults, false);
+		REQUIRE(cached.getPathCache()->getHitCount() == requestCount);
+		for (int i = 0; i < requestCount; ++i)
+		{
+			REQUIRE(repeatResults[i].path == serialResults[i].path);
+			REQUIRE(repeatResults[i].stats.iterations == 0);
+		}
+
+		// A request from further along a cached path gets the rest of it.
+		const std::vector<dtPolyRef>& path = serialResults[0].path;
+		REQUIRE(path.size() > 4);
+		const float* pos = &startPos[0];
+		dtPathQueueRef ref = cached.request(path[3], endRefs[0], pos, &endPos[0], &filter);
+		REQUIRE(dtStatusSucceed(cached.getRequestStatus(ref)));
+		dtPolyRef result[256];
+		int nresult = 0;
+		REQUIRE(dtStatusSucceed(cached.getPathResult(ref, result, &nresult, 256)));
+		REQUIRE(std::vector<dtPolyRef>(result, result + nresult) == std::vector<dtPolyRef>(path.begin() + 3, path.end()));
+
+		// Changing a tile on the path drops the cached path.
+		REQUIRE(dtStatusSucceed(nav->setPolyArea(path[1], 1)));
+		ref = cached.request(startRefs[0], endRefs[0], pos, &endPos[0], &filter);
+		REQUIRE(cached.getRequestStatus(ref) == 0);
+		REQUIRE(cached.getPathCache()->getPathCount() == requestCount - 1);
+
+		// The least recently used paths are evicted.
+		REQUIRE(cached.initPathCache(4));
+		run(cached, firstResults, false);
+		REQUIRE(cached.getPathCache()->getPathCount() == 4);
+	}
+
+	SECTION("Time budgeted updates find the same paths")
+	{
+		dtPathQueue budgeted;
+		REQUIRE(budgeted.init(256, 1024, nav, 16, 3));
+		std::vector<Result> budgetedResults;
+		run(budgeted, budgetedResults, true);
+		for (int i = 0; i < requestCount; ++i)
+			REQUIRE(budgetedResults[i].path == serialResults[i].path);
+	}
+
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtCrowd::getUpdateTimes", "[crowd]")
+{
+	dtNavMesh* nav = TestNavMesh::createGrid(2, 2, 16, isPillarBlocked);
+	REQUIRE(nav);
+	dtCrowd* crowd = createCrowd(nav, 16);
+	REQUIRE(crowd);
+
+	// Nothing is measured without a clock.
+	crowd->update(1.0f / 30.0f, 0);
+	const dtCrowdUpdateTimes& times = crowd->getUpdateTimes();
+	REQUIRE(times.total == 0.0);
+
+	// The clock is read once at the start and once after each of the 13 stages.
+	crowd->setUpdateClock(fakeTime);
+	crowd->update(1.0f / 30.0f, 0);
+	const double stages[] = {
+		times.pathValidity, times.moveRequests, times.topologyOptimization, times.proximityGrid, times.boundary,
+		times.neighbours, times.corners, times.steering, times.planning, times.integrate, times.collisions,
+		times.moveAlongSurface, times.other
+	};
+	for (const double t : stages)
+		REQUIRE(t == 1.0);
+	REQUIRE(times.total == 13.0);
+
+	crowd->setUpdateClock(0);
+	crowd->update(1.0f / 30.0f, 0);
+	REQUIRE(times.total == 0.0);
+
+	dtFreeCrowd(crowd);
+	dtFreeNavMesh(nav);
+}
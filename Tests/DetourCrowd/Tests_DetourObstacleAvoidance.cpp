@@ -0,0 +1,193 @@
+#include <float.h>
+#include <stdlib.h>
+
+#include "catch2/catch_all.hpp"
+
+#include "DetourCommon.h"
+#include "DetourObstacleAvoidance.h"
+
+namespace
+{
+float randomRange(const float range)
+{
+	return (rand() / (float)RAND_MAX * 2.0f - 1.0f) * range;
+}
+
+dtObstacleAvoidanceParams createParams()
+{
+	dtObstacleAvoidanceParams params;
+	params.velBias = 0.4f;
+	params.weightDesVel = 2.0f;
+	params.weightCurVel = 0.75f;
+	params.weightSide = 0.75f;
+	params.weightToi = 2.5f;
+	params.horizTime = 2.5f;
+	params.gridSize = 33;
+	params.adaptiveDivs = 7;
+	params.adaptiveRings = 2;
+	params.adaptiveDepth = 5;
+	return params;
+}
+
+// Adds a random set of moving circles and walls around the position.
+void addRandomObstacles(dtObstacleAvoidanceQuery* query, const float* pos)
+{
+	query->reset();
+	const int ncircles = rand() % 8;
+	for (int i = 0; i < ncircles; ++i)
+	{
+		const float p[3] = { pos[0] + randomRange(3.0f), 0.0f, pos[2] + randomRange(3.0f) };
+		const float vel[3] = { randomRange(1.0f), 0.0f, randomRange(1.0f) };
+		const float dvel[3] = { randomRange(1.0f), 0.0f, randomRange(1.0f) };
+		query->addCircle(p, 0.3f + randomRange(0.2f), vel, dvel);
+	}
+	const int nsegments = rand() % 8;
+	for (int i = 0; i < nsegments; ++i)
+	{
+		const float p[3] = { pos[0] + randomRange(3.0f), 0.0f, pos[2] + randomRange(3.0f) };
+		const float q[3] = { pos[0] + randomRange(3.0f), 0.0f, pos[2] + randomRange(3.0f) };
+		query->addSegment(p, q);
+	}
+}
+
+// The chosen velocity must be the first sample with the lowest penalty.
+void requireBestSample(const dtObstacleAvoidanceDebugData* debug, const float* nvel)
+{
+	REQUIRE(debug->getSampleCount() > 0);
+	int best = 0;
+	for (int i = 0; i < debug->getSampleCount(); ++i)
+	{
+		const float penalty = debug->getSampleDesiredVelocityPenalty(i) + debug->getSampleCurrentVelocityPenalty(i) +
+			debug->getSamplePreferredSidePenalty(i) + debug->getSampleCollisionTimePenalty(i);
+		REQUIRE(debug->getSamplePenalty(i) == penalty);
+		if (debug->getSamplePenalty(i) < debug->getSamplePenalty(best))
+			best = i;
+	}
+	const float* bestVel = debug->getSampleVelocity(best);
+	REQUIRE(nvel[0] == bestVel[0]);
+	REQUIRE(nvel[2] == bestVel[2]);
+}
+} // anonymous namespace
+
+TEST_CASE("dtObstacleAvoidanceQuery", "[crowd]")
+{
+	dtObstacleAvoidanceQuery* query = dtAllocObstacleAvoidanceQuery();
+	REQUIRE(query->init(16, 16));
+	dtObstacleAvoidanceDebugData* debug = dtAllocObstacleAvoidanceDebugData();
+	REQUIRE(debug->init(33 * 33));
+	const dtObstacleAvoidanceParams params = createParams();
+	const float pos[3] = { 0.0f, 0.0f, 0.0f };
+	const float rad = 0.5f;
+	const float vmax = 2.0f;
+
+	SECTION("Grid sampling picks the best sample")
+	{
+		srand(1);
+		for (int iter = 0; iter < 50; ++iter)
+		{
+			addRandomObstacles(query, pos);
+			const float vel[3] = { randomRange(1.0f), 0.0f, randomRange(1.0f) };
+			const float dvel[3] = { randomRange(vmax), 0.0f, randomRange(vmax) };
+			float nvel[3];
+			const int ns = query->sampleVelocityGrid(pos, rad, vmax, vel, dvel, nvel, &params, debug);
+			REQUIRE(ns >= debug->getSampleCount());
+			requireBestSample(debug, nvel);
+		}
+	}
+
+	SECTION("Grid sampling without obstacles follows the desired velocity")
+	{
+		query->reset();
+		const float vel[3] = { 0.0f, 0.0f, 0.0f };
+		const float dvel[3] = { 1.0f, 0.0f, 0.5f };
+		float nvel[3];
+		query->sampleVelocityGrid(pos, rad, vmax, vel, dvel, nvel, &params, debug);
+		const float cs = vmax * 2 * (1 - params.velBias) / (float)(params.gridSize - 1);
+		REQUIRE(dtVdist2D(nvel, dvel) <= cs);
+		requireBestSample(debug, nvel);
+	}
+
+	SECTION("Adaptive sampling avoids a wall ahead")
+	{
+		query->reset();
+		const float p[3] = { -2.0f, 0.0f, 1.0f };
+		const float q[3] = { 2.0f, 0.0f, 1.0f };
+		query->addSegment(p, q);
+		const float vel[3] = { 0.0f, 0.0f, 1.0f };
+		const float dvel[3] = { 0.0f, 0.0f, vmax };
+		float nvel[3];
+		const int ns = query->sampleVelocityAdaptive(pos, rad, vmax, vel, dvel, nvel, &params, debug);
+		REQUIRE(ns > 0);
+		REQUIRE(nvel[2] < dvel[2] * 0.5f);
+	}
+
+	SECTION("ORCA without obstacles follows the desired velocity")
+	{
+		query->reset();
+		dtObstacleAvoidanceParams orca = params;
+		orca.solver = DT_OBSTACLE_AVOIDANCE_ORCA;
+		const float vel[3] = { 0.0f, 0.0f, 0.0f };
+		const float dvel[3] = { 1.0f, 0.0f, 0.5f };
+		float nvel[3];
+		REQUIRE(query->solveVelocityORCA(pos, rad, vmax, vel, dvel, nvel, &orca, debug) == 0);
+		REQUIRE(nvel[0] == Catch::Approx(dvel[0]));
+		REQUIRE(nvel[2] == Catch::Approx(dvel[2]));
+
+		const float fast[3] = { 4.0f, 0.0f, 0.0f };
+		query->solveVelocityORCA(pos, rad, vmax, vel, fast, nvel, &orca, debug);
+		REQUIRE(nvel[0] == Catch::Approx(vmax));
+		REQUIRE(nvel[2] == Catch::Approx(0.0f));
+	}
+
+	SECTION("ORCA stops before a wall ahead")
+	{
+		query->reset();
+		const float p[3] = { -2.0f, 0.0f, 1.0f };
+		const float q[3] = { 2.0f, 0.0f, 1.0f };
+		query->addSegment(p, q);
+		const float vel[3] = { 0.0f, 0.0f, 1.0f };
+		const float dvel[3] = { 0.0f, 0.0f, vmax };
+		float nvel[3];
+		REQUIRE(query->solveVelocityORCA(pos, rad, vmax, vel, dvel, nvel, &params, debug) == 1);
+		REQUIRE(nvel[2] * params.horizTime <= 1.0f - rad + 0.001f);
+	}
+
+	SECTION("ORCA agents pass each other")
+	{
+		// Two agents swapping places, each avoiding the other.
+		const int agentCount = 2;
+		float apos[agentCount][3] = { { 0.0f, 0.0f, 0.0f }, { 0.1f, 0.0f, 6.0f } };
+		float avel[agentCount][3] = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+		const float targets[agentCount][3] = { { 0.1f, 0.0f, 6.0f }, { 0.0f, 0.0f, 0.0f } };
+		const float dt = 0.1f;
+		float minDist = FLT_MAX;
+		for (int iter = 0; iter < 100; ++iter)
+		{
+			float nvels[agentCount][3];
+			for (int i = 0; i < agentCount; ++i)
+			{
+				const int j = 1 - i;
+				query->reset();
+				query->addCircle(apos[j], rad, avel[j], avel[j]);
+				float dvel[3];
+				dtVsub(dvel, targets[i], apos[i]);
+				dvel[1] = 0;
+				if (dtVlen(dvel) > vmax)
+					dtVscale(dvel, dvel, vmax / dtVlen(dvel));
+				query->solveVelocityORCA(apos[i], rad, vmax, avel[i], dvel, nvels[i], &params);
+			}
+			for (int i = 0; i < agentCount; ++i)
+			{
+				dtVcopy(avel[i], nvels[i]);
+				dtVmad(apos[i], apos[i], avel[i], dt);
+			}
+			minDist = dtMin(minDist, dtVdist2D(apos[0], apos[1]));
+		}
+		REQUIRE(minDist >= rad * 2 * 0.99f);
+		REQUIRE(dtVdist2D(apos[0], targets[0]) < 0.1f);
+		REQUIRE(dtVdist2D(apos[1], targets[1]) < 0.1f);
+	}
+
+	dtFreeObstacleAvoidanceDebugData(debug);
+	dtFreeObstacleAvoidanceQuery(query);
+}
@@ -1,7 +1,12 @@
 #include "catch2/catch_all.hpp"
 
+#include "DetourCommon.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourOffMeshTable.h"
 #include "DetourPathCorridor.h"
 
+#include "../Detour/TestNavMeshUtils.h"
+
 TEST_CASE("dtMergeCorridorStartMoved")
 {
     SECTION("Should handle empty input")
@@ -117,3 +122,356 @@ TEST_CASE("dtMergeCorridorStartMoved")
         CHECK_THAT(path, Catch::Matchers::RangeEquals(expectedPath));
     }
 }
+
+TEST_CASE("dtPathCorridor::repairPath")
+{
+    dtNavMesh* nav = TestNavMesh::createGrid(1, 1, 8);
+    REQUIRE(nav);
+    dtNavMeshQuery* query = dtAllocNavMeshQuery();
+    REQUIRE(dtStatusSucceed(query->init(nav, 256)));
+    dtQueryFilter filter;
+
+    // A corridor along the first row of cells.
+    const float halfExtents[3] = {0.1f, 1.0f, 0.1f};
+    const float startPos[3] = {0.5f, 0.0f, 0.5f};
+    const float endPos[3] = {7.5f, 0.0f, 0.5f};
+    dtPolyRef startRef = 0, endRef = 0;
+    query->findNearestPoly(startPos, halfExtents, &filter, &startRef, 0);
+    query->findNearestPoly(endPos, halfExtents, &filter, &endRef, 0);
+    dtPolyRef path[16];
+    int npath = 0;
+    REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &filter, path, &npath, 16)));
+    REQUIRE(npath == 8);
+
+    dtPathCorridor corridor;
+    REQUIRE(corridor.init(16));
+    corridor.reset(startRef, startPos);
+    corridor.setCorridor(endPos, path, npath);
+
+    SECTION("Should keep a valid corridor")
+    {
+        CHECK(corridor.repairPath(64, query, &filter));
+        CHECK_THAT(std::vector<dtPolyRef>(corridor.getPath(), corridor.getPath() + corridor.getPathCount()),
+                   Catch::Matchers::RangeEquals(std::vector<dtPolyRef>(path, path + npath)));
+    }
+
+    SECTION("Should search around invalid polygons")
+    {
+        nav->setPolyFlags(path[3], 0);
+        nav->setPolyFlags(path[5], 0);
+        REQUIRE(corridor.repairPath(64, query, &filter));
+        CHECK(corridor.isValid(corridor.getPathCount(), query, &filter));
+        CHECK(corridor.getFirstPoly() == startRef);
+        CHECK(corridor.getLastPoly() == endRef);
+        for (int i = 0; i < corridor.getPathCount(); ++i)
+            for (int j = i + 1; j < corridor.getPathCount(); ++j)
+                CHECK(corridor.getPath()[i] != corridor.getPath()[j]);
+
+        // The repaired corridor leads to the target.
+        float straight[16 * 3];
+        int nstraight = 0;
+        REQUIRE(dtStatusSucceed(query->findStraightPath(startPos, endPos, corridor.getPath(), corridor.getPathCount(),
+                                                        straight, 0, 0, &nstraight, 16)));
+        CHECK(dtVdist(&straight[(nstraight - 1) * 3], endPos) < 0.01f);
+    }
+
+    SECTION("Should fail when the target polygon is invalid")
+    {
+        nav->setPolyFlags(endRef, 0);
+        CHECK(!corridor.repairPath(64, query, &filter));
+    }
+
+    SECTION("Should fail when the search runs out of iterations")
+    {
+        nav->setPolyFlags(path[3], 0);
+        CHECK(!corridor.repairPath(1, query, &filter));
+        CHECK(!corridor.isValid(corridor.getPathCount(), query, &filter));
+    }
+
+    SECTION("Should fail when the repaired corridor does not fit")
+    {
+        dtPathCorridor small;
+        REQUIRE(small.init(npath));
+        small.reset(startRef, startPos);
+        small.setCorridor(endPos, path, npath);
+        nav->setPolyFlags(path[3], 0);
+        CHECK(!small.repairPath(64, query, &filter));
+    }
+
+    dtFreeNavMeshQuery(query);
+    dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtPathCorridor::optimizePathVisibility")
+{
+    dtNavMesh* nav = TestNavMesh::createGrid(1, 1, 8);
+    REQUIRE(nav);
+    dtNavMeshQuery* query = dtAllocNavMeshQuery();
+    REQUIRE(dtStatusSucceed(query->init(nav, 256)));
+    dtQueryFilter filter;
+
+    // A detour through the second row of cells, the first row is a straight shortcut.
+    const int cells[][2] = {{0, 0}, {0, 1}, {1, 1}, {2, 1}, {3, 1}, {3, 0}};
+    const int npath = 6;
+    const float halfExtents[3] = {0.1f, 1.0f, 0.1f};
+    dtPolyRef path[npath];
+    for (int i = 0; i < npath; ++i)
+    {
+        const float pos[3] = {cells[i][0] + 0.5f, 0.0f, cells[i][1] + 0.5f};
+        REQUIRE(dtStatusSucceed(query->findNearestPoly(pos, halfExtents, &filter, &path[i], 0)));
+    }
+    const float startPos[3] = {0.5f, 0.0f, 0.5f};
+    const float next[3] = {3.5f, 0.0f, 0.5f};
+    const float range = 3.2f;
+    const float reuseDist = 0.5f;
+
+    dtPathCorridor corridor;
+    REQUIRE(corridor.init(16));
+    corridor.reset(path[0], startPos);
+    corridor.setCorridor(next, path, npath);
+
+    SECTION("Should shortcut the same as without the cache")
+    {
+        dtPathCorridor uncached;
+        REQUIRE(uncached.init(16));
+        uncached.reset(path[0], startPos);
+        uncached.setCorridor(next, path, npath);
+        uncached.optimizePathVisibility(next, range, query, &filter);
+        corridor.optimizePathVisibility(next, range, query, &filter, reuseDist);
+        REQUIRE(corridor.getPathCount() == 4);
+        CHECK_THAT(std::vector<dtPolyRef>(corridor.getPath(), corridor.getPath() + corridor.getPathCount()),
+                   Catch::Matchers::RangeEquals(std::vector<dtPolyRef>(uncached.getPath(), uncached.getPath() + uncached.getPathCount())));
+        CHECK(corridor.getLastPoly() == path[npath - 1]);
+    }
+
+    SECTION("Should skip the raycast while the corridor and the ray are unchanged")
+    {
+        query->resetStats();
+        corridor.optimizePathVisibility(next, range, query, &filter, reuseDist);
+        corridor.optimizePathVisibility(next, range, query, &filter, reuseDist);
+        const float moved[3] = {next[0], next[1], next[2] + 0.2f};
+        corridor.optimizePathVisibility(moved, range, query, &filter, reuseDist);
+        CHECK(corridor.getPathCount() == 4);
+#ifdef DT_QUERY_STATS
+        CHECK(query->getStats().queryCount == 1);
+#endif
+
+        // Moving the point further than the reuse distance casts the ray again.
+        const float far[3] = {next[0], next[1], next[2] + 0.6f};
+        corridor.optimizePathVisibility(far, range, query, &filter, reuseDist);
+#ifdef DT_QUERY_STATS
+        CHECK(query->getStats().queryCount == 2);
+#endif
+    }
+
+    SECTION("Should raycast again when the corridor changes")
+    {
+        corridor.optimizePathVisibility(next, range, query, &filter, reuseDist);
+        REQUIRE(corridor.getPathCount() == 4);
+        corridor.setCorridor(next, path, npath);
+        corridor.optimizePathVisibility(next, range, query, &filter, reuseDist);
+        CHECK(corridor.getPathCount() == 4);
+    }
+
+    SECTION("Should raycast again when the navigation mesh changes")
+    {
+        // The blocked shortcut keeps the detour.
+        const float blockedPos[3] = {1.5f, 0.0f, 0.5f};
+        dtPolyRef blocked = 0;
+        REQUIRE(dtStatusSucceed(query->findNearestPoly(blockedPos, halfExtents, &filter, &blocked, 0)));
+        nav->setPolyFlags(blocked, 0);
+        corridor.optimizePathVisibility(next, range, query, &filter, reuseDist);
+        REQUIRE(corridor.getPathCount() == npath);
+
+        nav->setPolyFlags(blocked, 1);
+        corridor.optimizePathVisibility(next, range, query, &filter, reuseDist);
+        CHECK(corridor.getPathCount() == 4);
+    }
+
+    dtFreeNavMeshQuery(query);
+    dtFreeNavMesh(nav);
+}
+
+namespace
+{
+// A wall across most of the grid, the corridors around it have corners.
+bool isCornerWallBlocked(int cellX, int cellZ)
+{
+    return cellX == 8 && cellZ < 12;
+}
+
+// Finds the corners of the corridor with a new corridor, which has no cached portals.
+int findUncachedCorners(const dtPathCorridor& corridor, float* verts, unsigned char* flags, dtPolyRef* polys,
+                        const int maxCorners, dtNavMeshQuery* query, const dtQueryFilter* filter)
+{
+    dtPathCorridor uncached;
+    if (!uncached.init(256))
+        return -1;
+    uncached.reset(corridor.getFirstPoly(), corridor.getPos());
+    uncached.setCorridor(corridor.getTarget(), corridor.getPath(), corridor.getPathCount());
+    return uncached.findCorners(verts, flags, polys, maxCorners, query, filter);
+}
+} // anonymous namespace
+
+TEST_CASE("dtPathCorridor::findCorners")
+{
+    dtNavMesh* nav = TestNavMesh::createGrid(2, 2, 8, isCornerWallBlocked);
+    REQUIRE(nav);
+    dtNavMeshQuery* query = dtAllocNavMeshQuery();
+    REQUIRE(dtStatusSucceed(query->init(nav, 1024)));
+    dtQueryFilter filter;
+
+    const float halfExtents[3] = {0.1f, 1.0f, 0.1f};
+    const float startPos[3] = {0.5f, 0.0f, 0.5f};
+    const float endPos[3] = {15.5f, 0.0f, 0.5f};
+    dtPolyRef startRef = 0, endRef = 0;
+    query->findNearestPoly(startPos, halfExtents, &filter, &startRef, 0);
+    query->findNearestPoly(endPos, halfExtents, &filter, &endRef, 0);
+    dtPolyRef path[256];
+    int npath = 0;
+    REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &filter, path, &npath, 256)));
+    REQUIRE(npath > 16);
+
+    dtPathCorridor corridor;
+    REQUIRE(corridor.init(256));
+    corridor.reset(startRef, startPos);
+    corridor.setCorridor(endPos, path, npath);
+
+    const int maxCorners = 4;
+    float verts[maxCorners * 3], uncachedVerts[maxCorners * 3];
+    unsigned char flags[maxCorners], uncachedFlags[maxCorners];
+    dtPolyRef polys[maxCorners], uncachedPolys[maxCorners];
+
+    SECTION("Should find the same corners as without cached portals while moving")
+    {
+        for (int step = 0; step < 200; ++step)
+        {
+            const int ncorners = corridor.findCorners(verts, flags, polys, maxCorners, query, &filter);
+            const int expected = findUncachedCorners(corridor, uncachedVerts, uncachedFlags, uncachedPolys,
+                                                     maxCorners, query, &filter);
+            REQUIRE(ncorners == expected);
+            for (int i = 0; i < ncorners; ++i)
+            {
+                CHECK(dtVequal(&verts[i * 3], &uncachedVerts[i * 3]));
+                CHECK(flags[i] == uncachedFlags[i]);
+                CHECK(polys[i] == uncachedPolys[i]);
+            }
+            // The target is pruned once it is reached.
+            if (!ncorners)
+                break;
+
+            // Step toward the first corner.
+            float dir[3], npos[3];
+            dtVsub(dir, &verts[0], corridor.getPos());
+            dir[1] = 0.0f;
+            const float dist = dtVlen(dir);
+            dtVmad(npos, corridor.getPos(), dir, dtMin(0.3f, dist) / dist);
+            REQUIRE(corridor.movePosition(npos, query, &filter));
+        }
+        CHECK(corridor.getPathCount() == 1);
+    }
+
+    SECTION("Should not reuse the portals after the navigation mesh changes")
+    {
+        corridor.findCorners(verts, flags, polys, maxCorners, query, &filter);
+
+        // The corridor keeps its polygons, the change is detected by the generation.
+        const float pos[3] = {7.5f, 0.0f, 8.5f};
+        dtPolyRef ref = 0;
+        REQUIRE(dtStatusSucceed(query->findNearestPoly(pos, halfExtents, &filter, &ref, 0)));
+        nav->setPolyFlags(ref, 0);
+        const int ncorners = corridor.findCorners(verts, flags, polys, maxCorners, query, &filter);
+        const int expected = findUncachedCorners(corridor, uncachedVerts, uncachedFlags, uncachedPolys,
+                                                 maxCorners, query, &filter);
+        REQUIRE(ncorners == expected);
+        for (int i = 0; i < ncorners; ++i)
+            CHECK(dtVequal(&verts[i * 3], &uncachedVerts[i * 3]));
+    }
+
+    SECTION("Should find the same straight path with a portal cache")
+    {
+        float portals[8 * 6];
+        unsigned char types[8];
+        dtPortalCache cache;
+        cache.portals = portals;
+        cache.types = types;
+        cache.count = 0;
+        cache.capacity = 8;
+
+        float straight[32 * 3], expectedStraight[32 * 3];
+        int count = 0, expectedCount = 0;
+        REQUIRE(dtStatusSucceed(query->findStraightPath(startPos, endPos, path, npath, expectedStraight, 0, 0,
+                                                        &expectedCount, 32)));
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            REQUIRE(dtStatusSucceed(query->findStraightPath(startPos, endPos, path, npath, straight, 0, 0,
+                                                            &count, 32, 0, &cache)));
+            CHECK(cache.count == 8);
+            REQUIRE(count == expectedCount);
+            for (int i = 0; i < count; ++i)
+                CHECK(dtVequal(&straight[i * 3], &expectedStraight[i * 3]));
+        }
+    }
+
+    dtFreeNavMeshQuery(query);
+    dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtPathCorridor::moveOverOffmeshConnection")
+{
+    // One tile of 4x4 cells at y = -1, with a connection between two of its polygons.
+    const float conVerts[] = {0.5f, -1, 0.5f, 2.5f, -1, 2.5f};
+    int dataSize = 0;
+    unsigned char* data = TestNavMesh::createTileData(0, 0, 4, 0, &dataSize, false, false, conVerts, 1);
+    REQUIRE(data);
+    dtNavMeshParams params;
+    memset(&params, 0, sizeof(params));
+    params.tileWidth = 4 * TestNavMesh::CELL_SIZE;
+    params.tileHeight = 4 * TestNavMesh::CELL_SIZE;
+    params.maxTiles = 1;
+    params.maxPolys = 32;
+    dtNavMesh* nav = dtAllocNavMesh();
+    REQUIRE(dtStatusSucceed(nav->init(&params)));
+    REQUIRE(dtStatusSucceed(nav->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, 0)));
+    dtNavMeshQuery* query = dtAllocNavMeshQuery();
+    REQUIRE(dtStatusSucceed(query->init(nav, 256)));
+    dtOffMeshConnectionTable* table = dtAllocOffMeshConnectionTable();
+    REQUIRE(dtStatusSucceed(table->init(nav, 0)));
+    REQUIRE(dtStatusSucceed(table->update()));
+
+    const dtMeshTile* tile = nav->getTileAt(0, 0, 0);
+    const dtPolyRef conRef = nav->getPolyRefBase(tile) | (dtPolyRef)tile->offMeshCons[0].poly;
+    const dtOffMeshConnectionEntry* entry = table->getConnection(conRef);
+    REQUIRE(entry);
+    REQUIRE(entry->startRef);
+    REQUIRE(entry->endRef);
+
+    // Both directions give the same endpoints with and without the table.
+    const dtPolyRef ends[2] = {entry->startRef, entry->endRef};
+    for (int i = 0; i < 2; ++i)
+    {
+        const dtPolyRef path[3] = {ends[i], conRef, ends[1 - i]};
+        float expectedStart[3], expectedEnd[3], start[3], end[3];
+        dtPolyRef expectedRefs[2], refs[2];
+        const float* pos = i == 0 ? entry->startPos : entry->endPos;
+
+        dtPathCorridor corridor;
+        REQUIRE(corridor.init(16));
+        corridor.reset(ends[i], pos);
+        corridor.setCorridor(pos, path, 3);
+        REQUIRE(corridor.moveOverOffmeshConnection(conRef, expectedRefs, expectedStart, expectedEnd, query));
+
+        corridor.reset(ends[i], pos);
+        corridor.setCorridor(pos, path, 3);
+        REQUIRE(corridor.moveOverOffmeshConnection(conRef, refs, start, end, query, table));
+        CHECK(refs[0] == expectedRefs[0]);
+        CHECK(refs[1] == expectedRefs[1]);
+        CHECK(dtVequal(start, expectedStart));
+        CHECK(dtVequal(end, expectedEnd));
+        CHECK(dtVequal(corridor.getPos(), end));
+    }
+
+    dtFreeOffMeshConnectionTable(table);
+    dtFreeNavMeshQuery(query);
+    dtFreeNavMesh(nav);
+}
@@ -0,0 +1,1188 @@
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "DetourNavMesh.h"
+#include "DetourTileCache.h"
+#include "DetourTileCacheArchive.h"
+#include "DetourTileCacheBuilder.h"
+#include "DetourTileCacheCompressor.h"
+
+#include "../Detour/TestNavMeshUtils.h"
+
+namespace
+{
+static const int TILE_CELLS = 32;
+static const float CELL_SIZE = 0.5f;
+static const float CELL_HEIGHT = 0.2f;
+
+// Stores the layers uncompressed.
+struct CopyCompressor : public dtTileCacheCompressor
+{
+	int maxCompressedSize(const int bufferSize) override { return bufferSize; }
+
+	dtStatus compress(const unsigned char* buffer, const int bufferSize,
+					  unsigned char* compressed, const int maxCompressedSize, int* compressedSize) override
+	{
+		if (bufferSize > maxCompressedSize)
+			return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+		memcpy(compressed, buffer, bufferSize);
+		*compressedSize = bufferSize;
+		return DT_SUCCESS;
+	}
+
+	dtStatus decompress(const unsigned char* compressed, const int compressedSize,
+						unsigned char* buffer, const int maxBufferSize, int* bufferSize) override
+	{
+		if (compressedSize > maxBufferSize)
+			return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+		memcpy(buffer, compressed, compressedSize);
+		*bufferSize = compressedSize;
+		return DT_SUCCESS;
+	}
+};
+
+// A clock that advances by one microsecond each time it is read.
+double s_fakeTime = 0.0;
+double fakeTime()
+{
+	return s_fakeTime += 1.0;
+}
+
+// A tile cache and nav mesh of tilesX * tilesY flat tiles at y = 0.
+struct TileCacheFixture
+{
+	CopyCompressor comp;
+	dtTileCacheAlloc alloc;
+	dtTileCache* tileCache;
+	dtNavMesh* nav;
+
+	TileCacheFixture(int tilesX, int tilesY, int maxObstacles, int maxTouchedTiles = 0,
+					 dtTileCacheCompressor* compressor = 0, int rebuildMode = DT_TILECACHE_REBUILD_FULL,
+					 int layerCacheSize = 0) :
+		tileCache(0), nav(0)
+	{
+		dtTileCacheCompressor* tcomp = compressor ? compressor : &comp;
+		const float tileWorldSize = TILE_CELLS * CELL_SIZE;
+
+		dtTileCacheParams tcparams;
+		memset(&tcparams, 0, sizeof(tcparams));
+		tcparams.cs = CELL_SIZE;
+		tcparams.ch = CELL_HEIGHT;
+		tcparams.width = TILE_CELLS;
+		tcparams.height = TILE_CELLS;
+		tcparams.walkableHeight = 2.0f;
+		tcparams.walkableRadius = 0.5f;
+		tcparams.walkableClimb = 0.5f;
+		tcparams.maxSimplificationError = 1.3f;
+		tcparams.maxTiles = tilesX * tilesY;
+		tcparams.maxObstacles = maxObstacles;
+		tcparams.maxTouchedTiles = maxTouchedTiles;
+		tcparams.rebuildMode = rebuildMode;
+		tcparams.layerCacheSize = layerCacheSize;
+		tileCache = dtAllocTileCache();
+		REQUIRE(dtStatusSucceed(tileCache->init(&tcparams, &alloc, tcomp, 0)));
+
+		dtNavMeshParams params;
+		memset(&params, 0, sizeof(params));
+		params.tileWidth = tileWorldSize;
+		params.tileHeight = tileWorldSize;
+		params.maxTiles = tilesX * tilesY;
+		params.maxPolys = 1024;
+		nav = dtAllocNavMesh();
+		REQUIRE(dtStatusSucceed(nav->init(&params)));
+
+		const int gridSize = TILE_CELLS * TILE_CELLS;
+		std::vector<unsigned char> heights(gridSize, 0);
+		std::vector<unsigned char> areas(gridSize, DT_TILECACHE_WALKABLE_AREA);
+		std::vector<unsigned char> cons(gridSize, 0);
+		for (int z = 0; z < TILE_CELLS; ++z)
+		{
+			for (int x = 0; x < TILE_CELLS; ++x)
+			{
+				// Connections in the order x-, z+, x+, z-.
+				unsigned char con = 0;
+				if (x > 0) con |= 1;
+				if (z < TILE_CELLS - 1) con |= 2;
+				if (x < TILE_CELLS - 1) con |= 4;
+				if (z > 0) con |= 8;
+				cons[x + z * TILE_CELLS] = con;
+			}
+		}
+
+		for (int ty = 0; ty < tilesY; ++ty)
+		{
+			for (int tx = 0; tx < tilesX; ++tx)
+			{
+				dtTileCacheLayerHeader header;
+				memset(&header, 0, sizeof(header));
+				header.magic = DT_TILECACHE_MAGIC;
+				header.version = DT_TILECACHE_VERSION;
+				header.tx = tx;
+				header.ty = ty;
+				header.bmin[0] = tx * tileWorldSize;
+				header.bmin[1] = -1.0f;
+				header.bmin[2] = ty * tileWorldSize;
+				header.bmax[0] = (tx + 1) * tileWorldSize;
+				header.bmax[1] = 1.0f;
+				header.bmax[2] = (ty + 1) * tileWorldSize;
+				header.width = TILE_CELLS;
+				header.height = TILE_CELLS;
+				header.maxx = TILE_CELLS - 1;
+				header.maxy = TILE_CELLS - 1;
+
+				unsigned char* data = 0;
+				int dataSize = 0;
+				REQUIRE(dtStatusSucceed(dtBuildTileCacheLayer(tcomp, &header, &heights[0], &areas[0], &cons[0], &data, &dataSize)));
+				REQUIRE(dtStatusSucceed(tileCache->addTile(data, dataSize, DT_COMPRESSEDTILE_FREE_DATA, 0)));
+				REQUIRE(dtStatusSucceed(tileCache->buildNavMeshTilesAt(tx, ty, nav)));
+			}
+		}
+	}
+
+	~TileCacheFixture()
+	{
+		dtFreeTileCache(tileCache);
+		dtFreeNavMesh(nav);
+	}
+
+	// Adds obstacles straddling the tile corners.
+	void addObstacles()
+	{
+		const float tileWorldSize = TILE_CELLS * CELL_SIZE;
+		const float bmin0[3] = { tileWorldSize - 2.0f, 0.0f, tileWorldSize - 2.0f };
+		const float bmax0[3] = { tileWorldSize + 2.0f, 1.0f, tileWorldSize + 2.0f };
+		REQUIRE(dtStatusSucceed(tileCache->addBoxObstacle(bmin0, bmax0, 0)));
+		const float pos1[3] = { 2.0f * tileWorldSize, 0.0f, tileWorldSize };
+		REQUIRE(dtStatusSucceed(tileCache->addObstacle(pos1, 1.5f, 1.0f, 0)));
+		const float center2[3] = { tileWorldSize, 0.0f, 2.0f * tileWorldSize };
+		const float halfExtents2[3] = { 3.0f, 1.0f, 0.5f };
+		REQUIRE(dtStatusSucceed(tileCache->addBoxObstacle(center2, halfExtents2, 0.7f, 0)));
+	}
+
+	// Updates until the tile cache is up to date, returns the number of updates.
+	int updateAll()
+	{
+		int updates = 0;
+		for (bool upToDate = false; !upToDate; ++updates)
+			REQUIRE(dtStatusSucceed(tileCache->update(0, nav, &upToDate)));
+		return updates;
+	}
+
+	std::vector<unsigned char> getTileData(int tx, int ty) const
+	{
+		const dtMeshTile* tile = nav->getTileAt(tx, ty, 0);
+		if (!tile || !tile->header)
+			return std::vector<unsigned char>();
+		return std::vector<unsigned char>(tile->data, tile->data + tile->dataSize);
+	}
+
+	// The total area of the polygons of all tiles.
+	float getPolyArea() const
+	{
+		float area = 0.0f;
+		for (int i = 0; i < nav->getMaxTiles(); ++i)
+		{
+			const dtMeshTile* tile = static_cast<const dtNavMesh*>(nav)->getTile(i);
+			if (!tile || !tile->header)
+				continue;
+			for (int j = 0; j < tile->header->polyCount; ++j)
+			{
+				const dtPoly& poly = tile->polys[j];
+				const float* a = &tile->verts[poly.verts[0] * 3];
+				for (int k = 2; k < poly.vertCount; ++k)
+				{
+					const float* b = &tile->verts[poly.verts[k - 1] * 3];
+					const float* c = &tile->verts[poly.verts[k] * 3];
+					area += fabsf((b[0] - a[0]) * (c[2] - a[2]) - (c[0] - a[0]) * (b[2] - a[2])) * 0.5f;
+				}
+			}
+		}
+		return area;
+	}
+};
+} // anonymous namespace
+
+TEST_CASE("dtTileCache::setJobDispatcher", "[tilecache]")
+{
+	TileCacheFixture serial(3, 3, 16);
+	TileCacheFixture threaded(3, 3, 16);
+
+	TestNavMesh::ThreadDispatcher dispatcher(4);
+	dtTileCacheAlloc workerAllocs[4];
+	dtTileCacheAlloc* allocs[4] = { &workerAllocs[0], &workerAllocs[1], &workerAllocs[2], &workerAllocs[3] };
+	REQUIRE(dtStatusFailed(threaded.tileCache->setJobDispatcher(&dispatcher, 0)));
+	REQUIRE(dtStatusSucceed(threaded.tileCache->setJobDispatcher(&dispatcher, allocs)));
+
+	serial.addObstacles();
+	threaded.addObstacles();
+
+	SECTION("All touched tiles are rebuilt in one update")
+	{
+		bool upToDate = false;
+		REQUIRE(dtStatusSucceed(threaded.tileCache->update(0, threaded.nav, &upToDate)));
+		REQUIRE(upToDate);
+		for (int i = 0; i < threaded.tileCache->getObstacleCount(); ++i)
+		{
+			const dtTileCacheObstacle* ob = threaded.tileCache->getObstacle(i);
+			REQUIRE((ob->state == DT_OBSTACLE_EMPTY || ob->state == DT_OBSTACLE_PROCESSED));
+		}
+	}
+
+	SECTION("Concurrent rebuilds match the serial rebuilds")
+	{
+		const int updates = serial.updateAll();
+		REQUIRE(updates > 2);
+
+		bool upToDate = false;
+		REQUIRE(dtStatusSucceed(threaded.tileCache->update(0, threaded.nav, &upToDate)));
+		REQUIRE(upToDate);
+
+		TileCacheFixture empty(3, 3, 16);
+		int changed = 0;
+		for (int ty = 0; ty < 3; ++ty)
+		{
+			for (int tx = 0; tx < 3; ++tx)
+			{
+				REQUIRE(threaded.getTileData(tx, ty) == serial.getTileData(tx, ty));
+				if (serial.getTileData(tx, ty) != empty.getTileData(tx, ty))
+					changed++;
+			}
+		}
+		REQUIRE(changed >= 3);
+	}
+}
+
+TEST_CASE("Time budgeted dtTileCache::update", "[tilecache]")
+{
+	TileCacheFixture fixture(3, 3, 16);
+	fixture.addObstacles();
+
+	// The clock is read once when the budget is initialized and once per tile.
+	dtTimeBudget budget;
+	dtInitTimeBudget(budget, fakeTime, 2.0);
+	bool upToDate = true;
+	int builtTiles = 0;
+	REQUIRE(dtStatusSucceed(fixture.tileCache->update(0, fixture.nav, budget, &upToDate, &builtTiles)));
+	REQUIRE(!upToDate);
+	REQUIRE(builtTiles == 2);
+#ifdef DT_QUERY_STATS
+	CHECK(fixture.tileCache->getUpdateStats().obstacleRequests > 0);
+	CHECK(fixture.tileCache->getUpdateStats().tilesRebuilt == 2);
+	CHECK(fixture.tileCache->getUpdateStats().failedTiles == 0);
+	CHECK(fixture.tileCache->getUpdateStats().pendingTiles > 0);
+#else
+	CHECK(fixture.tileCache->getUpdateStats().tilesRebuilt == 0);
+#endif
+
+	// An exhausted budget still makes progress.
+	REQUIRE(dtStatusSucceed(fixture.tileCache->update(0, fixture.nav, budget, &upToDate, &builtTiles)));
+	REQUIRE(builtTiles == 1);
+
+	dtInitTimeBudget(budget, fakeTime, 1000.0);
+	REQUIRE(dtStatusSucceed(fixture.tileCache->update(0, fixture.nav, budget, &upToDate, &builtTiles)));
+	REQUIRE(upToDate);
+}
+
+TEST_CASE("dtTileCache obstacle batches", "[tilecache]")
+{
+	const float tileWorldSize = TILE_CELLS * CELL_SIZE;
+
+	SECTION("Requests grow past the initial capacity")
+	{
+		TileCacheFixture fixture(3, 3, 512);
+		std::vector<dtObstacleRef> refs;
+		for (int i = 0; i < 300; ++i)
+		{
+			const float pos[3] = { 1.0f + (i % 20) * 2.0f, 0.0f, 1.0f + (i / 20) * 2.0f };
+			dtObstacleRef ref = 0;
+			REQUIRE(dtStatusSucceed(fixture.tileCache->addObstacle(pos, 0.5f, 1.0f, &ref)));
+			refs.push_back(ref);
+		}
+		REQUIRE(fixture.updateAll() <= 9 + 1);
+		for (size_t i = 0; i < refs.size(); ++i)
+			REQUIRE(fixture.tileCache->getObstacleByRef(refs[i])->state == DT_OBSTACLE_PROCESSED);
+
+		REQUIRE(dtStatusSucceed(fixture.tileCache->removeObstacles(&refs[0], (int)refs.size())));
+		fixture.updateAll();
+		for (size_t i = 0; i < refs.size(); ++i)
+			REQUIRE(!fixture.tileCache->getObstacleByRef(refs[i]));
+	}
+
+	SECTION("Batches rebuild each touched tile once")
+	{
+		TileCacheFixture fixture(3, 3, 16);
+		dtTileCacheObstacleDesc descs[4];
+		memset(descs, 0, sizeof(descs));
+		for (int i = 0; i < 4; ++i)
+		{
+			// Four obstacles around the shared corner of four tiles.
+			descs[i].type = i % 2 ? DT_OBSTACLE_BOX : DT_OBSTACLE_CYLINDER;
+			const float x = tileWorldSize + (i % 2 ? 0.5f : -0.5f);
+			const float z = tileWorldSize + (i / 2 ? 0.5f : -0.5f);
+			descs[i].pos[0] = x;
+			descs[i].pos[2] = z;
+			descs[i].radius = 1.0f;
+			descs[i].height = 1.0f;
+			descs[i].bmin[0] = x - 1.0f;
+			descs[i].bmin[2] = z - 1.0f;
+			descs[i].bmax[0] = x + 1.0f;
+			descs[i].bmax[1] = 1.0f;
+			descs[i].bmax[2] = z + 1.0f;
+		}
+		dtObstacleRef refs[4];
+		REQUIRE(dtStatusSucceed(fixture.tileCache->addObstacles(descs, 4, refs)));
+		REQUIRE(fixture.updateAll() == 4);
+
+		REQUIRE(dtStatusSucceed(fixture.tileCache->removeObstacles(refs, 4)));
+		REQUIRE(fixture.updateAll() == 4);
+	}
+
+	SECTION("Failed batches add nothing")
+	{
+		TileCacheFixture fixture(3, 3, 2);
+		dtTileCacheObstacleDesc descs[3];
+		memset(descs, 0, sizeof(descs));
+		descs[1].type = 0xff;
+		REQUIRE(dtStatusDetail(fixture.tileCache->addObstacles(descs, 2, 0), DT_INVALID_PARAM));
+		descs[1].type = DT_OBSTACLE_CYLINDER;
+		REQUIRE(dtStatusDetail(fixture.tileCache->addObstacles(descs, 3, 0), DT_OUT_OF_MEMORY));
+		REQUIRE(dtStatusSucceed(fixture.tileCache->addObstacles(descs, 2, 0)));
+	}
+
+	SECTION("Obstacles can touch more tiles than the default limit")
+	{
+		const float bmin[3] = { 1.0f, 0.0f, 1.0f };
+		const float bmax[3] = { 3.0f * tileWorldSize - 1.0f, 1.0f, 3.0f * tileWorldSize - 1.0f };
+
+		TileCacheFixture fixture(3, 3, 16, 9);
+		dtObstacleRef ref = 0;
+		REQUIRE(dtStatusSucceed(fixture.tileCache->addBoxObstacle(bmin, bmax, &ref)));
+		REQUIRE(fixture.updateAll() == 9);
+		REQUIRE(fixture.tileCache->getObstacleByRef(ref)->ntouched == 9);
+
+		TileCacheFixture limited(3, 3, 16);
+		REQUIRE(dtStatusSucceed(limited.tileCache->addBoxObstacle(bmin, bmax, &ref)));
+		REQUIRE(limited.updateAll() == DT_MAX_TOUCHED_TILES);
+	}
+}
+
+TEST_CASE("dtTileCache obstacle index", "[tilecache]")
+{
+	const float tileWorldSize = TILE_CELLS * CELL_SIZE;
+	TileCacheFixture fixture(4, 4, 256);
+
+	// Obstacles on a grid, some straddling the tile borders.
+	std::vector<dtObstacleRef> refs;
+	for (int z = 0; z < 16; ++z)
+	{
+		for (int x = 0; x < 16; ++x)
+		{
+			const float pos[3] = { (x + 0.5f) * tileWorldSize / 4.0f, 0.0f, (z + 0.5f) * tileWorldSize / 4.0f };
+			dtObstacleRef ref = 0;
+			REQUIRE(dtStatusSucceed(fixture.tileCache->addObstacle(pos, 2.5f, 1.0f, &ref)));
+			refs.push_back(ref);
+		}
+	}
+	fixture.updateAll();
+
+	SECTION("Incremental rebuilds match full rebuilds")
+	{
+		std::vector<std::vector<unsigned char> > incremental;
+		for (int ty = 0; ty < 4; ++ty)
+			for (int tx = 0; tx < 4; ++tx)
+				incremental.push_back(fixture.getTileData(tx, ty));
+		for (int ty = 0; ty < 4; ++ty)
+		{
+			for (int tx = 0; tx < 4; ++tx)
+			{
+				REQUIRE(dtStatusSucceed(fixture.tileCache->buildNavMeshTilesAt(tx, ty, fixture.nav)));
+				REQUIRE(fixture.getTileData(tx, ty) == incremental[tx + ty * 4]);
+			}
+		}
+	}
+
+	SECTION("Removed obstacles are no longer indexed")
+	{
+		// Remove every other obstacle, and the rest in a second batch.
+		std::vector<dtObstacleRef> even, odd;
+		for (size_t i = 0; i < refs.size(); ++i)
+			(i % 2 ? odd : even).push_back(refs[i]);
+		REQUIRE(dtStatusSucceed(fixture.tileCache->removeObstacles(&even[0], (int)even.size())));
+		fixture.updateAll();
+		REQUIRE(dtStatusSucceed(fixture.tileCache->removeObstacles(&odd[0], (int)odd.size())));
+		fixture.updateAll();
+
+		TileCacheFixture empty(4, 4, 1);
+		for (int ty = 0; ty < 4; ++ty)
+			for (int tx = 0; tx < 4; ++tx)
+				REQUIRE(fixture.getTileData(tx, ty) == empty.getTileData(tx, ty));
+		for (int i = 0; i < fixture.tileCache->getObstacleCount(); ++i)
+			REQUIRE(fixture.tileCache->getObstacle(i)->state == DT_OBSTACLE_EMPTY);
+	}
+}
+
+TEST_CASE("dtTileCacheRLECompressor", "[tilecache]")
+{
+	dtTileCacheRLECompressor rle;
+	CopyCompressor copy;
+	dtTileCacheDeltaCompressor delta(&copy);
+
+	// A layer like buffer with sloped heights, two area types and mostly uniform connections.
+	const int gridSize = 48 * 48;
+	std::vector<unsigned char> layer(gridSize * 3);
+	for (int i = 0; i < gridSize; ++i)
+	{
+		layer[i] = (unsigned char)(10 + (i % 48) / 8);
+		layer[gridSize + i] = i < gridSize / 3 ? 63 : 1;
+		layer[gridSize * 2 + i] = (unsigned char)(i % 48 == 0 ? 0x0e : 0x0f);
+	}
+	std::vector<unsigned char> noise(1000);
+	unsigned int seed = 1;
+	for (size_t i = 0; i < noise.size(); ++i)
+	{
+		seed = seed * 1103515245 + 12345;
+		noise[i] = (unsigned char)(seed >> 16);
+	}
+
+	dtTileCacheCompressor* comps[2] = { &rle, &delta };
+	const std::vector<unsigned char>* buffers[2] = { &layer, &noise };
+	for (int c = 0; c < 2; ++c)
+	{
+		for (int b = 0; b < 2; ++b)
+		{
+			const std::vector<unsigned char>& buffer = *buffers[b];
+			const int bufferSize = (int)buffer.size();
+			std::vector<unsigned char> compressed(comps[c]->maxCompressedSize(bufferSize));
+			int compressedSize = 0;
+			REQUIRE(dtStatusSucceed(comps[c]->compress(&buffer[0], bufferSize, &compressed[0], (int)compressed.size(), &compressedSize)));
+
+			// The tile cache passes a larger buffer than needed when decompressing.
+			std::vector<unsigned char> decompressed(bufferSize * 2);
+			int decompressedSize = 0;
+			REQUIRE(dtStatusSucceed(comps[c]->decompress(&compressed[0], compressedSize, &decompressed[0], (int)decompressed.size(), &decompressedSize)));
+			REQUIRE(decompressedSize == bufferSize);
+			decompressed.resize(decompressedSize);
+			REQUIRE(decompressed == buffer);
+
+			if (comps[c] == &rle && b == 0)
+				REQUIRE(compressedSize * 4 < bufferSize);
+		}
+	}
+
+	SECTION("Corrupt and truncated data fails")
+	{
+		std::vector<unsigned char> compressed(rle.maxCompressedSize((int)layer.size()));
+		int compressedSize = 0;
+		REQUIRE(dtStatusSucceed(rle.compress(&layer[0], (int)layer.size(), &compressed[0], (int)compressed.size(), &compressedSize)));
+		std::vector<unsigned char> decompressed(layer.size());
+		int decompressedSize = 0;
+		REQUIRE(dtStatusFailed(rle.decompress(&compressed[0], compressedSize, &decompressed[0], (int)layer.size() - 1, &decompressedSize)));
+		const unsigned char literals[2] = { 10, 1 };
+		REQUIRE(dtStatusFailed(rle.decompress(literals, 2, &decompressed[0], (int)decompressed.size(), &decompressedSize)));
+		REQUIRE(dtStatusFailed(rle.compress(&layer[0], (int)layer.size(), &compressed[0], 4, &compressedSize)));
+	}
+
+	SECTION("Tile cache builds match uncompressed builds")
+	{
+		TileCacheFixture uncompressed(2, 2, 16);
+		TileCacheFixture compressed(2, 2, 16, 0, &rle);
+		uncompressed.addObstacles();
+		compressed.addObstacles();
+		uncompressed.updateAll();
+		compressed.updateAll();
+		for (int i = 0; i < 4; ++i)
+		{
+			REQUIRE(compressed.tileCache->getTile(i)->dataSize < uncompressed.tileCache->getTile(i)->dataSize / 4);
+			REQUIRE(compressed.getTileData(i % 2, i / 2) == uncompressed.getTileData(i % 2, i / 2));
+		}
+	}
+}
+
+TEST_CASE("dtTileCache dirty region rebuilds", "[tilecache]")
+{
+	const float tileWorldSize = TILE_CELLS * CELL_SIZE;
+	TileCacheFixture full(3, 3, 16);
+	TileCacheFixture dirty(3, 3, 16, 0, 0, DT_TILECACHE_REBUILD_DIRTY_REGIONS);
+
+	SECTION("Tiles without obstacles match full rebuilds")
+	{
+		for (int i = 0; i < 9; ++i)
+			REQUIRE(dirty.getTileData(i % 3, i / 3) == full.getTileData(i % 3, i / 3));
+	}
+
+	SECTION("Obstacles cut the same area as full rebuilds")
+	{
+		full.addObstacles();
+		dirty.addObstacles();
+		full.updateAll();
+		dirty.updateAll();
+		const float fullArea = full.getPolyArea();
+		REQUIRE(fullArea < 9.0f * tileWorldSize * tileWorldSize);
+		REQUIRE(dirty.getPolyArea() == Catch::Approx(fullArea).epsilon(0.01));
+	}
+
+	SECTION("Rebuilds do not depend on the obstacle history")
+	{
+		const float pos[3] = { tileWorldSize * 0.5f, 0.0f, tileWorldSize * 0.5f };
+		const float bmin[3] = { tileWorldSize * 0.6f, 0.0f, tileWorldSize * 0.2f };
+		const float bmax[3] = { tileWorldSize * 0.8f, 1.0f, tileWorldSize * 0.9f };
+		dtObstacleRef cylinder = 0, box = 0;
+		REQUIRE(dtStatusSucceed(dirty.tileCache->addObstacle(pos, 1.0f, 1.0f, &cylinder)));
+		dirty.updateAll();
+		REQUIRE(dtStatusSucceed(dirty.tileCache->addBoxObstacle(bmin, bmax, &box)));
+		dirty.updateAll();
+		REQUIRE(dtStatusSucceed(dirty.tileCache->removeObstacle(cylinder)));
+		dirty.updateAll();
+
+		TileCacheFixture boxOnly(3, 3, 16, 0, 0, DT_TILECACHE_REBUILD_DIRTY_REGIONS);
+		REQUIRE(dtStatusSucceed(boxOnly.tileCache->addBoxObstacle(bmin, bmax, 0)));
+		boxOnly.updateAll();
+		REQUIRE(dirty.getTileData(0, 0) == boxOnly.getTileData(0, 0));
+
+		REQUIRE(dtStatusSucceed(dirty.tileCache->removeObstacle(box)));
+		dirty.updateAll();
+		REQUIRE(dirty.getTileData(0, 0) == full.getTileData(0, 0));
+	}
+}
+
+TEST_CASE("dtTileCache layer cache", "[tilecache]")
+{
+	TileCacheFixture full(3, 3, 16);
+	TileCacheFixture cached(3, 3, 16, 0, 0, DT_TILECACHE_REBUILD_FULL, 1 << 30);
+	const dtTileCacheLayerCacheStats& stats = cached.tileCache->getLayerCacheStats();
+	REQUIRE(stats.misses == 9);
+	REQUIRE(stats.hits == 0);
+	REQUIRE(stats.layerCount == 9);
+	const int layerSize = stats.memory / 9;
+	REQUIRE(layerSize > TILE_CELLS * TILE_CELLS * 4);
+	CHECK(full.tileCache->getLayerCacheStats().misses == 0);
+
+	SECTION("Cached layers build the same tiles")
+	{
+		full.addObstacles();
+		cached.addObstacles();
+		full.updateAll();
+		cached.updateAll();
+		REQUIRE(stats.misses == 9);
+		REQUIRE(stats.hits > 0);
+		for (int i = 0; i < 9; ++i)
+			REQUIRE(cached.getTileData(i % 3, i / 3) == full.getTileData(i % 3, i / 3));
+
+		cached.tileCache->resetLayerCacheStats();
+		REQUIRE(stats.hits == 0);
+		REQUIRE(stats.layerCount == 9);
+	}
+
+	SECTION("The least recently built layers are evicted")
+	{
+		TileCacheFixture limited(3, 3, 16, 0, 0, DT_TILECACHE_REBUILD_FULL, layerSize * 2);
+		const dtTileCacheLayerCacheStats& limitedStats = limited.tileCache->getLayerCacheStats();
+		REQUIRE(limitedStats.layerCount == 2);
+		REQUIRE(limitedStats.evictions == 7);
+		REQUIRE(limitedStats.memory == layerSize * 2);
+
+		REQUIRE(dtStatusSucceed(limited.tileCache->buildNavMeshTilesAt(1, 2, limited.nav)));
+		REQUIRE(limitedStats.hits == 1);
+		REQUIRE(dtStatusSucceed(limited.tileCache->buildNavMeshTilesAt(0, 0, limited.nav)));
+		REQUIRE(limitedStats.misses == 10);
+		REQUIRE(dtStatusSucceed(limited.tileCache->buildNavMeshTilesAt(1, 2, limited.nav)));
+		REQUIRE(limitedStats.hits == 2);
+		REQUIRE(dtStatusSucceed(limited.tileCache->buildNavMeshTilesAt(2, 2, limited.nav)));
+		REQUIRE(limitedStats.misses == 11);
+		REQUIRE(limitedStats.evictions == 9);
+	}
+
+	SECTION("Removed tiles leave the cache")
+	{
+		dtCompressedTileRef ref = 0;
+		REQUIRE(cached.tileCache->getTilesAt(1, 1, &ref, 1) == 1);
+		REQUIRE(dtStatusSucceed(cached.tileCache->removeTile(ref, 0, 0)));
+		REQUIRE(stats.layerCount == 8);
+		REQUIRE(stats.memory == layerSize * 8);
+	}
+}
+
+TEST_CASE("dtTileCache::getMemStats", "[tilecache]")
+{
+	TileCacheFixture full(3, 3, 16);
+	dtTileCacheMemStats stats;
+	full.tileCache->getMemStats(&stats);
+	REQUIRE(stats.total == stats.tiles + stats.compressed + stats.obstacles + stats.updates + stats.layerCache);
+	REQUIRE(stats.obstacles > 0);
+	REQUIRE(stats.updates > 0);
+	REQUIRE(stats.layerCache == 0);
+
+	size_t compressed = 0;
+	for (int i = 0; i < full.tileCache->getTileCount(); ++i)
+	{
+		const dtCompressedTile* tile = full.tileCache->getTile(i);
+		if (tile->data)
+			compressed += (size_t)tile->dataSize;
+	}
+	REQUIRE(compressed > 0);
+	REQUIRE(stats.compressed == compressed);
+
+	// The obstacles do not allocate.
+	full.addObstacles();
+	full.updateAll();
+	dtTileCacheMemStats obstacleStats;
+	full.tileCache->getMemStats(&obstacleStats);
+	REQUIRE(obstacleStats.total == stats.total);
+
+	// The cached layers are counted.
+	TileCacheFixture cached(3, 3, 16, 0, 0, DT_TILECACHE_REBUILD_FULL, 1 << 30);
+	dtTileCacheMemStats cachedStats;
+	cached.tileCache->getMemStats(&cachedStats);
+	REQUIRE(cachedStats.layerCache > (size_t)cached.tileCache->getLayerCacheStats().memory);
+	REQUIRE(cachedStats.total == stats.total + cachedStats.layerCache);
+}
+
+TEST_CASE("dtUpdateTileCacheRegions", "[tilecache]")
+{
+	// Three strips of walkable cells separated by two walls.
+	const int size = 32;
+	const int gridSize = size * size;
+	dtTileCacheLayerHeader header;
+	memset(&header, 0, sizeof(header));
+	header.width = size;
+	header.height = size;
+	std::vector<unsigned char> baseGrids(gridSize * 3, 0), grids(gridSize * 3, 0);
+	std::vector<unsigned short> baseRegs(gridSize, 0), regs(gridSize, 0);
+	for (int i = 0; i < gridSize; ++i)
+	{
+		const int x = i % size;
+		baseGrids[gridSize + i] = (x == 10 || x == 21) ? DT_TILECACHE_NULL_AREA : DT_TILECACHE_WALKABLE_AREA;
+	}
+	for (int i = 0; i < gridSize; ++i)
+	{
+		// Connections in the order x-, z+, x+, z-, within the strips.
+		const int x = i % size, z = i / size;
+		unsigned char con = 0;
+		if (x > 0 && baseGrids[gridSize + i - 1] != DT_TILECACHE_NULL_AREA) con |= 1;
+		if (z < size - 1) con |= 2;
+		if (x < size - 1 && baseGrids[gridSize + i + 1] != DT_TILECACHE_NULL_AREA) con |= 4;
+		if (z > 0) con |= 8;
+		baseGrids[gridSize * 2 + i] = con;
+	}
+	dtTileCacheLayer base, layer;
+	memset(&base, 0, sizeof(base));
+	base.header = &header;
+	base.heights = &baseGrids[0];
+	base.areas = &baseGrids[gridSize];
+	base.cons = &baseGrids[gridSize * 2];
+	base.regs = &baseRegs[0];
+	layer = base;
+	layer.heights = &grids[0];
+	layer.areas = &grids[gridSize];
+	layer.cons = &grids[gridSize * 2];
+	layer.regs = &regs[0];
+
+	dtTileCacheAlloc alloc;
+	REQUIRE(dtStatusSucceed(dtBuildTileCacheRegions(&alloc, base, 0)));
+	dtTileCacheContourSet* baseContours = dtAllocTileCacheContourSet(&alloc);
+	dtTileCacheContourSet* contours = dtAllocTileCacheContourSet(&alloc);
+	REQUIRE(dtStatusSucceed(dtBuildTileCacheContours(&alloc, base, 0, 1.3f, *baseContours)));
+
+	// An obstacle in the last strip.
+	grids = baseGrids;
+	for (int y = 10; y < 15; ++y)
+		for (int x = 24; x < 29; ++x)
+			layer.areas[x + y * size] = DT_TILECACHE_NULL_AREA;
+
+	unsigned char dirtyRegs[256];
+	REQUIRE(dtStatusSucceed(dtUpdateTileCacheRegions(&alloc, layer, base, 0, dirtyRegs, 256)));
+	REQUIRE(dtStatusSucceed(dtUpdateTileCacheContours(&alloc, layer, 0, 1.3f, *baseContours, dirtyRegs, *contours)));
+	for (int i = 0; i < gridSize; ++i)
+	{
+		const int x = i % size;
+		REQUIRE((layer.regs[i] == DT_TILECACHE_NULL_REG) == (layer.areas[i] == DT_TILECACHE_NULL_AREA));
+		if (x < 21)
+		{
+			// The first strips keep their regions and contours.
+			REQUIRE(layer.regs[i] == base.regs[i]);
+			if (layer.regs[i] != DT_TILECACHE_NULL_REG)
+			{
+				const dtTileCacheContour& cont = contours->conts[layer.regs[i]];
+				const dtTileCacheContour& baseCont = baseContours->conts[base.regs[i]];
+				REQUIRE(!dirtyRegs[layer.regs[i]]);
+				REQUIRE(cont.nverts == baseCont.nverts);
+				REQUIRE(memcmp(cont.verts, baseCont.verts, cont.nverts * 4) == 0);
+			}
+		}
+		else if (layer.regs[i] != DT_TILECACHE_NULL_REG)
+		{
+			REQUIRE(dirtyRegs[layer.regs[i]]);
+		}
+	}
+
+	dtTileCachePolyMesh* mesh = dtAllocTileCachePolyMesh(&alloc);
+	REQUIRE(dtStatusSucceed(dtBuildTileCachePolyMesh(&alloc, *contours, *mesh)));
+	REQUIRE(mesh->npolys > 0);
+	dtFreeTileCachePolyMesh(&alloc, mesh);
+	dtFreeTileCacheContourSet(&alloc, contours);
+	dtFreeTileCacheContourSet(&alloc, baseContours);
+}
+
+TEST_CASE("Tile cache layers with more than 255 regions", "[tilecache]")
+{
+	// A full size layer cut by walls into cells of 3x3, each cell is its own region.
+	const int size = 255;
+	const int gridSize = size * size;
+	dtTileCacheLayerHeader header;
+	memset(&header, 0, sizeof(header));
+	header.width = size;
+	header.height = size;
+	std::vector<unsigned char> grids(gridSize * 3, 0);
+	std::vector<unsigned short> regs(gridSize, 0);
+	for (int i = 0; i < gridSize; ++i)
+	{
+		const int x = i % size, z = i / size;
+		grids[gridSize + i] = (x % 4 == 3 || z % 4 == 3) ? DT_TILECACHE_NULL_AREA : DT_TILECACHE_WALKABLE_AREA;
+	}
+	for (int i = 0; i < gridSize; ++i)
+	{
+		const int x = i % size, z = i / size;
+		unsigned char con = 0;
+		if (x > 0 && grids[gridSize + i - 1] != DT_TILECACHE_NULL_AREA) con |= 1;
+		if (z < size - 1 && grids[gridSize + i + size] != DT_TILECACHE_NULL_AREA) con |= 2;
+		if (x < size - 1 && grids[gridSize + i + 1] != DT_TILECACHE_NULL_AREA) con |= 4;
+		if (z > 0 && grids[gridSize + i - size] != DT_TILECACHE_NULL_AREA) con |= 8;
+		grids[gridSize * 2 + i] = con;
+	}
+	dtTileCacheLayer layer;
+	memset(&layer, 0, sizeof(layer));
+	layer.header = &header;
+	layer.heights = &grids[0];
+	layer.areas = &grids[gridSize];
+	layer.cons = &grids[gridSize * 2];
+	layer.regs = &regs[0];
+
+	dtTileCacheAlloc alloc;
+	REQUIRE(dtStatusSucceed(dtBuildTileCacheRegions(&alloc, layer, 0)));
+	const int cellsPerSide = (size + 1) / 4;
+	REQUIRE(layer.regCount == cellsPerSide * cellsPerSide);
+	for (int i = 0; i < gridSize; ++i)
+	{
+		REQUIRE((layer.regs[i] == DT_TILECACHE_NULL_REG) == (layer.areas[i] == DT_TILECACHE_NULL_AREA));
+		if (layer.regs[i] != DT_TILECACHE_NULL_REG)
+			REQUIRE(layer.regs[i] < layer.regCount);
+	}
+
+	dtTileCacheContourSet* contours = dtAllocTileCacheContourSet(&alloc);
+	dtTileCachePolyMesh* mesh = dtAllocTileCachePolyMesh(&alloc);
+	REQUIRE(dtStatusSucceed(dtBuildTileCacheContours(&alloc, layer, 0, 1.3f, *contours)));
+	REQUIRE(contours->nconts == layer.regCount);
+	REQUIRE(dtStatusSucceed(dtBuildTileCachePolyMesh(&alloc, *contours, *mesh)));
+	REQUIRE(mesh->npolys == layer.regCount);
+	dtFreeTileCachePolyMesh(&alloc, mesh);
+	dtFreeTileCacheContourSet(&alloc, contours);
+}
+
+namespace
+{
+struct VectorArchiveOutput : public dtTileCacheArchiveOutput
+{
+	std::vector<unsigned char> bytes;
+
+	bool write(const void* data, const int size) override
+	{
+		const unsigned char* p = (const unsigned char*)data;
+		bytes.insert(bytes.end(), p, p + size);
+		return true;
+	}
+};
+
+struct VectorArchiveInput : public dtTileCacheArchiveInput
+{
+	const std::vector<unsigned char>& bytes;
+	size_t pos;
+
+	explicit VectorArchiveInput(const std::vector<unsigned char>& b) : bytes(b), pos(0) {}
+
+	bool read(void* data, const int size) override
+	{
+		if (pos + size > bytes.size())
+			return false;
+		memcpy(data, &bytes[pos], size);
+		pos += size;
+		return true;
+	}
+};
+} // anonymous namespace
+
+TEST_CASE("dtTileCache archives", "[tilecache]")
+{
+	TileCacheFixture fixture(3, 2, 8);
+	const dtTileCache* tileCache = fixture.tileCache;
+
+	VectorArchiveOutput out;
+	REQUIRE(dtStatusSucceed(dtWriteTileCacheArchiveHeader(&out, tileCache->getParams(), fixture.nav->getParams())));
+	for (int i = 0; i < tileCache->getTileCount(); ++i)
+	{
+		const dtCompressedTile* tile = tileCache->getTile(i);
+		if (!tile || !tile->header)
+			continue;
+		REQUIRE(dtStatusSucceed(dtWriteTileCacheArchiveLayer(&out, tile->data, tile->dataSize)));
+	}
+	REQUIRE(dtStatusSucceed(dtWriteTileCacheArchiveEnd(&out)));
+	REQUIRE(out.bytes.size() % 4 == 0);
+
+	SECTION("Archives restore the layers")
+	{
+		VectorArchiveInput in(out.bytes);
+		dtTileCacheArchiveHeader header;
+		REQUIRE(dtStatusSucceed(dtReadTileCacheArchiveHeader(&in, &header)));
+		REQUIRE(memcmp(&header.cacheParams, tileCache->getParams(), sizeof(dtTileCacheParams)) == 0);
+		REQUIRE(memcmp(&header.meshParams, fixture.nav->getParams(), sizeof(dtNavMeshParams)) == 0);
+
+		CopyCompressor comp;
+		dtTileCacheAlloc alloc;
+		dtTileCache* loaded = dtAllocTileCache();
+		dtNavMesh* nav = dtAllocNavMesh();
+		REQUIRE(dtStatusSucceed(loaded->init(&header.cacheParams, &alloc, &comp, 0)));
+		REQUIRE(dtStatusSucceed(nav->init(&header.meshParams)));
+		int layerCount = 0;
+		REQUIRE(dtStatusSucceed(dtAddTileCacheArchiveLayers(&in, loaded, &layerCount)));
+		REQUIRE(layerCount == 6);
+		REQUIRE(in.pos == out.bytes.size());
+
+		for (int ty = 0; ty < 2; ++ty)
+		{
+			for (int tx = 0; tx < 3; ++tx)
+			{
+				REQUIRE(dtStatusSucceed(loaded->buildNavMeshTilesAt(tx, ty, nav)));
+				const dtMeshTile* tile = nav->getTileAt(tx, ty, 0);
+				REQUIRE(tile);
+				REQUIRE(std::vector<unsigned char>(tile->data, tile->data + tile->dataSize) == fixture.getTileData(tx, ty));
+			}
+		}
+		dtFreeNavMesh(nav);
+		dtFreeTileCache(loaded);
+	}
+
+	SECTION("Corrupt and truncated archives fail")
+	{
+		std::vector<unsigned char> bytes(out.bytes);
+		bytes[0] ^= 0xff;
+		VectorArchiveInput wrongMagic(bytes);
+		dtTileCacheArchiveHeader header;
+		REQUIRE((dtReadTileCacheArchiveHeader(&wrongMagic, &header) & DT_WRONG_MAGIC));
+
+		// The first layer is cut short.
+		bytes = out.bytes;
+		bytes.resize(sizeof(dtTileCacheArchiveHeader) + 64);
+		VectorArchiveInput truncated(bytes);
+		REQUIRE(dtStatusSucceed(dtReadTileCacheArchiveHeader(&truncated, &header)));
+		unsigned char* data = 0;
+		int dataSize = 0;
+		REQUIRE(dtStatusFailed(dtReadTileCacheArchiveLayer(&truncated, &data, &dataSize)));
+		REQUIRE(!data);
+
+		const unsigned char notALayer[64] = { 0 };
+		VectorArchiveOutput rejected;
+		REQUIRE(dtStatusFailed(dtWriteTileCacheArchiveLayer(&rejected, notALayer, sizeof(notALayer))));
+		REQUIRE(rejected.bytes.empty());
+	}
+}
+
+namespace
+{
+// Whether the tiles of both nav meshes have the same references and polygons.
+bool sameTiles(const dtNavMesh* a, const dtNavMesh* b, int tilesX, int tilesY)
+{
+	for (int ty = 0; ty < tilesY; ++ty)
+	{
+		for (int tx = 0; tx < tilesX; ++tx)
+		{
+			const dtMeshTile* ta = a->getTileAt(tx, ty, 0);
+			const dtMeshTile* tb = b->getTileAt(tx, ty, 0);
+			if (!ta || !tb)
+			{
+				if (ta != tb)
+					return false;
+				continue;
+			}
+			if (a->getTileRef(ta) != b->getTileRef(tb) ||
+				ta->header->polyCount != tb->header->polyCount || ta->header->vertCount != tb->header->vertCount ||
+				memcmp(ta->verts, tb->verts, sizeof(float) * 3 * ta->header->vertCount) != 0)
+				return false;
+			for (int i = 0; i < ta->header->polyCount; ++i)
+			{
+				if (memcmp(ta->polys[i].verts, tb->polys[i].verts, sizeof(ta->polys[i].verts)) != 0)
+					return false;
+			}
+		}
+	}
+	return true;
+}
+} // anonymous namespace
+
+TEST_CASE("dtTileCache snapshots", "[tilecache]")
+{
+	TileCacheFixture fixture(3, 3, 8);
+	fixture.addObstacles();
+
+	VectorArchiveOutput pending;
+	REQUIRE(dtStatusFailed(dtWriteTileCacheSnapshot(&pending, fixture.tileCache, fixture.nav)));
+	REQUIRE(pending.bytes.empty());
+
+	fixture.updateAll();
+	REQUIRE(fixture.tileCache->isUpToDate());
+	VectorArchiveOutput out;
+	REQUIRE(dtStatusSucceed(dtWriteTileCacheSnapshot(&out, fixture.tileCache, fixture.nav)));
+	REQUIRE(out.bytes.size() % 4 == 0);
+
+	std::vector<dtObstacleRef> refs;
+	for (int i = 0; i < fixture.tileCache->getObstacleCount(); ++i)
+	{
+		const dtTileCacheObstacle* ob = fixture.tileCache->getObstacle(i);
+		if (ob->state == DT_OBSTACLE_PROCESSED)
+			refs.push_back(fixture.tileCache->getObstacleRef(ob));
+	}
+	REQUIRE(refs.size() == 3);
+
+	SECTION("Snapshots restore the obstacles and the tiles")
+	{
+		// The restored fixture starts with the tiles built without obstacles.
+		TileCacheFixture restored(3, 3, 8);
+		REQUIRE(!sameTiles(fixture.nav, restored.nav, 3, 3));
+		VectorArchiveInput in(out.bytes);
+		REQUIRE(dtStatusSucceed(dtRestoreTileCacheSnapshot(&in, restored.tileCache, restored.nav)));
+		REQUIRE(in.pos == out.bytes.size());
+		REQUIRE(restored.tileCache->isUpToDate());
+		REQUIRE(sameTiles(fixture.nav, restored.nav, 3, 3));
+
+		for (size_t i = 0; i < refs.size(); ++i)
+		{
+			const dtTileCacheObstacle* ob = restored.tileCache->getObstacleByRef(refs[i]);
+			REQUIRE(ob);
+			REQUIRE(ob->state == DT_OBSTACLE_PROCESSED);
+			REQUIRE(ob->ntouched == fixture.tileCache->getObstacleByRef(refs[i])->ntouched);
+		}
+
+		// The restored obstacles are linked to their tiles, and removed like the originals.
+		REQUIRE(dtStatusSucceed(fixture.tileCache->removeObstacle(refs[1])));
+		REQUIRE(dtStatusSucceed(restored.tileCache->removeObstacle(refs[1])));
+		fixture.updateAll();
+		restored.updateAll();
+		REQUIRE(sameTiles(fixture.nav, restored.nav, 3, 3));
+
+		// New obstacles do not take the restored slots.
+		dtObstacleRef added = 0;
+		const float pos[3] = { 4.0f, 0.0f, 4.0f };
+		REQUIRE(dtStatusSucceed(restored.tileCache->addObstacle(pos, 1.0f, 1.0f, &added)));
+		REQUIRE(added != refs[0]);
+		REQUIRE(added != refs[2]);
+	}
+
+	SECTION("Occupied obstacle slots fail the restore")
+	{
+		TileCacheFixture restored(3, 3, 8);
+		restored.addObstacles();
+		restored.updateAll();
+		VectorArchiveInput in(out.bytes);
+		REQUIRE(dtStatusFailed(dtRestoreTileCacheSnapshot(&in, restored.tileCache, restored.nav)));
+		for (size_t i = 0; i < refs.size(); ++i)
+			REQUIRE(restored.tileCache->getObstacleByRef(refs[i]));
+	}
+
+	SECTION("A slot claimed twice fails the batch")
+	{
+		TileCacheFixture restored(3, 3, 8);
+		dtTileCacheObstacleState states[2];
+		memset(states, 0, sizeof(states));
+		states[0].ref = refs[0];
+		states[0].type = DT_OBSTACLE_CYLINDER;
+		states[0].cylinder.radius = 1.0f;
+		states[0].cylinder.height = 1.0f;
+		states[1] = states[0];
+		REQUIRE(dtStatusFailed(restored.tileCache->restoreObstacles(states, 2)));
+		for (int i = 0; i < restored.tileCache->getObstacleCount(); ++i)
+			REQUIRE(restored.tileCache->getObstacle(i)->state == DT_OBSTACLE_EMPTY);
+	}
+}
+
+namespace
+{
+// A flat layer of heights 0 with all cells walkable.
+struct MarkLayer
+{
+	dtTileCacheLayerHeader header;
+	std::vector<unsigned char> heights;
+	std::vector<unsigned char> areas;
+	dtTileCacheLayer layer;
+
+	explicit MarkLayer(int size) : heights(size * size, 0), areas(size * size, DT_TILECACHE_WALKABLE_AREA)
+	{
+		memset(&header, 0, sizeof(header));
+		header.width = (unsigned char)size;
+		header.height = (unsigned char)size;
+		memset(&layer, 0, sizeof(layer));
+		layer.header = &header;
+		layer.heights = &heights[0];
+		layer.areas = &areas[0];
+	}
+
+	int countMarked() const
+	{
+		int n = 0;
+		for (size_t i = 0; i < areas.size(); ++i)
+			n += areas[i] == 0 ? 1 : 0;
+		return n;
+	}
+};
+} // anonymous namespace
+
+TEST_CASE("dtMarkConvexPolygonArea", "[tilecache]")
+{
+	const float orig[3] = { 0.0f, 0.0f, 0.0f };
+
+	SECTION("Cells with their center inside are marked, in either winding")
+	{
+		// A square over cells 2..5 and a triangle, clockwise and counterclockwise.
+		const float square[4 * 3] = { 2, 0, 2, 6, 0, 2, 6, 0, 6, 2, 0, 6 };
+		const float reversed[4 * 3] = { 2, 0, 6, 6, 0, 6, 6, 0, 2, 2, 0, 2 };
+		MarkLayer a(16), b(16);
+		REQUIRE(dtStatusSucceed(dtMarkConvexPolygonArea(a.layer, orig, 1.0f, 1.0f, square, 4, 0.0f, 1.0f, 0)));
+		REQUIRE(dtStatusSucceed(dtMarkConvexPolygonArea(b.layer, orig, 1.0f, 1.0f, reversed, 4, 0.0f, 1.0f, 0)));
+		REQUIRE(a.countMarked() == 16);
+		REQUIRE(a.areas == b.areas);
+
+		const float triangle[3 * 3] = { 1, 0, 1, 13, 0, 3, 4, 0, 14 };
+		MarkLayer c(16);
+		REQUIRE(dtStatusSucceed(dtMarkConvexPolygonArea(c.layer, orig, 1.0f, 1.0f, triangle, 3, 0.0f, 1.0f, 0)));
+		for (int z = 0; z < 16; ++z)
+		{
+			for (int x = 0; x < 16; ++x)
+			{
+				// Inside all edges of the counterclockwise triangle, seen from above.
+				const float px = x + 0.5f, pz = z + 0.5f;
+				bool inside = true;
+				for (int i = 0, j = 2; i < 3; j = i++)
+				{
+					const float* p = &triangle[j * 3];
+					const float* q = &triangle[i * 3];
+					if ((q[0] - p[0]) * (pz - p[2]) - (q[2] - p[2]) * (px - p[0]) < 0.0f)
+						inside = false;
+				}
+				REQUIRE((c.areas[x + z * 16] == 0) == inside);
+			}
+		}
+	}
+
+	SECTION("Cells outside the height range and the layer are not marked")
+	{
+		const float square[4 * 3] = { -4, 0, -4, 4, 0, -4, 4, 0, 4, -4, 0, 4 };
+		MarkLayer a(16);
+		a.heights[0] = 5;
+		REQUIRE(dtStatusSucceed(dtMarkConvexPolygonArea(a.layer, orig, 1.0f, 1.0f, square, 4, 0.0f, 2.0f, 0)));
+		REQUIRE(a.countMarked() == 15);
+		REQUIRE(a.areas[0] == DT_TILECACHE_WALKABLE_AREA);
+		REQUIRE(dtStatusFailed(dtMarkConvexPolygonArea(a.layer, orig, 1.0f, 1.0f, square, 2, 0.0f, 2.0f, 0)));
+	}
+}
+
+TEST_CASE("dtMarkObstacleAreas", "[tilecache]")
+{
+	// More obstacles than one batch, of every type.
+	const float orig[3] = { 0.0f, -1.0f, 0.0f };
+	const float cs = 0.5f, ch = 0.2f;
+	TileCacheFixture fixture(1, 1, 64);
+	for (int i = 0; i < 40; ++i)
+	{
+		const float x = (float)(i % 8) * 2.0f + 0.7f, z = (float)(i / 8) * 3.0f + 0.3f;
+		dtTileCacheObstacleDesc desc;
+		memset(&desc, 0, sizeof(desc));
+		desc.type = (unsigned char)(i % 4);
+		desc.pos[0] = x;
+		desc.pos[2] = z;
+		desc.radius = 0.8f;
+		desc.height = 2.0f;
+		desc.bmin[0] = x - 0.6f;
+		desc.bmin[1] = -1.0f;
+		desc.bmin[2] = z - 0.4f;
+		desc.bmax[0] = x + 0.5f;
+		desc.bmax[1] = 1.0f;
+		desc.bmax[2] = z + 0.9f;
+		desc.halfExtents[0] = 1.2f;
+		desc.halfExtents[1] = 2.0f;
+		desc.halfExtents[2] = 0.4f;
+		desc.yRadians = 0.3f * i;
+		const float verts[5 * 3] = { x, 0, z - 1.0f, x + 1.0f, 0, z - 0.3f, x + 0.6f, 0, z + 0.8f,
+									 x - 0.6f, 0, z + 0.8f, x - 1.0f, 0, z - 0.3f };
+		memcpy(desc.verts, verts, sizeof(verts));
+		desc.nverts = 5;
+		desc.hmin = -1.0f;
+		desc.hmax = 1.0f;
+		REQUIRE(dtStatusSucceed(fixture.tileCache->addObstacles(&desc, 1, 0)));
+	}
+
+	std::vector<const dtTileCacheObstacle*> obstacles;
+	for (int i = 0; i < fixture.tileCache->getObstacleCount(); ++i)
+	{
+		if (fixture.tileCache->getObstacle(i)->state != DT_OBSTACLE_EMPTY)
+			obstacles.push_back(fixture.tileCache->getObstacle(i));
+	}
+	REQUIRE(obstacles.size() == 40);
+
+	MarkLayer fused(TILE_CELLS), single(TILE_CELLS);
+	REQUIRE(dtStatusSucceed(dtMarkObstacleAreas(fused.layer, orig, cs, ch, &obstacles[0], (int)obstacles.size(), 0)));
+	for (size_t i = 0; i < obstacles.size(); ++i)
+	{
+		const dtTileCacheObstacle* ob = obstacles[i];
+		if (ob->type == DT_OBSTACLE_CYLINDER)
+			dtMarkCylinderArea(single.layer, orig, cs, ch, ob->cylinder.pos, ob->cylinder.radius, ob->cylinder.height, 0);
+		else if (ob->type == DT_OBSTACLE_BOX)
+			dtMarkBoxArea(single.layer, orig, cs, ch, ob->box.bmin, ob->box.bmax, 0);
+		else if (ob->type == DT_OBSTACLE_ORIENTED_BOX)
+			dtMarkBoxArea(single.layer, orig, cs, ch, ob->orientedBox.center, ob->orientedBox.halfExtents,
+						  ob->orientedBox.rotAux, 0);
+		else
+		{
+			float verts[DT_MAX_OBSTACLE_POLYGON_VERTS * 3];
+			for (int j = 0; j < ob->convexPolygon.nverts; ++j)
+			{
+				verts[j * 3 + 0] = ob->convexPolygon.verts[j * 2 + 0];
+				verts[j * 3 + 1] = 0.0f;
+				verts[j * 3 + 2] = ob->convexPolygon.verts[j * 2 + 1];
+			}
+			dtMarkConvexPolygonArea(single.layer, orig, cs, ch, verts, ob->convexPolygon.nverts,
+									ob->convexPolygon.hmin, ob->convexPolygon.hmax, 0);
+		}
+	}
+	REQUIRE(fused.countMarked() > 0);
+	REQUIRE(fused.areas == single.areas);
+}
+
+TEST_CASE("dtTileCache convex polygon obstacles", "[tilecache]")
+{
+	// A square on the cell borders around the corner of four tiles, and the box covering the same cells.
+	const float tileWorldSize = TILE_CELLS * CELL_SIZE;
+	const float lo = tileWorldSize - 2.0f, hi = tileWorldSize + 2.0f;
+	const float square[4 * 3] = { lo, 0, lo, hi, 0, lo, hi, 0, hi, lo, 0, hi };
+	const float bmin[3] = { lo, -2.0f, lo };
+	const float bmax[3] = { hi - 0.1f, 1.0f, hi - 0.1f };
+
+	TileCacheFixture polygon(3, 3, 8), box(3, 3, 8), empty(3, 3, 8);
+	dtObstacleRef ref = 0;
+	REQUIRE(dtStatusSucceed(polygon.tileCache->addConvexObstacle(square, 4, -2.0f, 1.0f, &ref)));
+	REQUIRE(dtStatusSucceed(box.tileCache->addBoxObstacle(bmin, bmax, 0)));
+	REQUIRE(polygon.updateAll() == 4);
+	box.updateAll();
+	REQUIRE(polygon.tileCache->getObstacleByRef(ref)->ntouched == 4);
+	REQUIRE(polygon.getPolyArea() < empty.getPolyArea());
+	REQUIRE(sameTiles(polygon.nav, box.nav, 3, 3));
+
+	REQUIRE(dtStatusSucceed(polygon.tileCache->removeObstacle(ref)));
+	polygon.updateAll();
+	for (int ty = 0; ty < 3; ++ty)
+		for (int tx = 0; tx < 3; ++tx)
+			REQUIRE(polygon.getTileData(tx, ty) == empty.getTileData(tx, ty));
+
+	REQUIRE(dtStatusDetail(polygon.tileCache->addConvexObstacle(square, 2, -2.0f, 1.0f, 0), DT_INVALID_PARAM));
+	REQUIRE(dtStatusDetail(polygon.tileCache->addConvexObstacle(square, DT_MAX_OBSTACLE_POLYGON_VERTS + 1, -2.0f, 1.0f, 0),
+						   DT_INVALID_PARAM));
+}
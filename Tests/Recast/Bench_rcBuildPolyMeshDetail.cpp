@@ -0,0 +1,144 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "Recast.h"
+
+// TODO: Implement benchmarking for platforms other than posix.
+#ifdef __unix__
+#include <unistd.h>
+#ifdef _POSIX_TIMERS
+#include <time.h>
+#include <stdint.h>
+
+static int64_t DetailNowNanos()
+{
+	struct timespec tp;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &tp);
+	return tp.tv_nsec + 1000000000LL * tp.tv_sec;
+}
+
+// Reads the vertices and faces of an .obj file, triangulating the faces as fans.
+static bool loadObj(const char* path, std::vector<float>& verts, std::vector<int>& tris)
+{
+	FILE* fp = fopen(path, "r");
+	if (!fp)
+		return false;
+	char line[512];
+	while (fgets(line, sizeof(line), fp))
+	{
+		if (line[0] == 'v' && line[1] == ' ')
+		{
+			float v[3];
+			if (sscanf(line + 2, "%f %f %f", &v[0], &v[1], &v[2]) == 3)
+				verts.insert(verts.end(), v, v + 3);
+		}
+		else if (line[0] == 'f' && line[1] == ' ')
+		{
+			int face[32];
+			int n = 0;
+			for (char* s = line + 2; *s && n < 32; )
+			{
+				while (*s == ' ' || *s == '\t')
+					++s;
+				if (*s == '\0' || *s == '\n' || *s == '\r')
+					break;
+				const int vi = atoi(s);
+				face[n++] = vi < 0 ? (int)verts.size() / 3 + vi : vi - 1;
+				while (*s && *s != ' ' && *s != '\t')
+					++s;
+			}
+			for (int i = 2; i < n; ++i)
+			{
+				tris.push_back(face[0]);
+				tris.push_back(face[i - 1]);
+				tris.push_back(face[i]);
+			}
+		}
+	}
+	fclose(fp);
+	return true;
+}
+
+// Builds the detail mesh of the demo's nav_test.obj solo mesh with the default and a dense sampling.
+TEST_CASE("Bench rcBuildPolyMeshDetail", "[recast]")
+{
+	std::vector<float> verts;
+	std::vector<int> tris;
+	if (!loadObj(RC_TEST_MESH_DIR "/nav_test.obj", verts, tris))
+	{
+		WARN("Could not load nav_test.obj, skipping.");
+		return;
+	}
+	const int nverts = (int)verts.size() / 3;
+	const int ntris = (int)tris.size() / 3;
+
+	rcConfig cfg;
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.cs = 0.3f;
+	cfg.ch = 0.2f;
+	cfg.walkableSlopeAngle = 45.0f;
+	cfg.walkableHeight = (int)ceilf(2.0f / cfg.ch);
+	cfg.walkableClimb = (int)floorf(0.9f / cfg.ch);
+	cfg.walkableRadius = (int)ceilf(0.6f / cfg.cs);
+	cfg.maxEdgeLen = (int)(12.0f / cfg.cs);
+	cfg.maxSimplificationError = 1.3f;
+	cfg.minRegionArea = 8 * 8;
+	cfg.mergeRegionArea = 20 * 20;
+	cfg.maxVertsPerPoly = 6;
+	rcCalcBounds(&verts[0], nverts, cfg.bmin, cfg.bmax);
+	rcCalcGridSize(cfg.bmin, cfg.bmax, cfg.cs, &cfg.width, &cfg.height);
+
+	rcContext ctx(false);
+	rcHeightfield* solid = rcAllocHeightfield();
+	REQUIRE(rcCreateHeightfield(&ctx, *solid, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch));
+	std::vector<unsigned char> areas(ntris, 0);
+	rcMarkWalkableTriangles(&ctx, cfg.walkableSlopeAngle, &verts[0], nverts, &tris[0], ntris, &areas[0]);
+	REQUIRE(rcRasterizeTriangles(&ctx, &verts[0], nverts, &tris[0], &areas[0], ntris, *solid, cfg.walkableClimb));
+	rcFilterLowHangingWalkableObstacles(&ctx, cfg.walkableClimb, *solid);
+	rcFilterLedgeSpans(&ctx, cfg.walkableHeight, cfg.walkableClimb, *solid);
+	rcFilterWalkableLowHeightSpans(&ctx, cfg.walkableHeight, *solid);
+
+	rcCompactHeightfield* chf = rcAllocCompactHeightfield();
+	REQUIRE(rcBuildCompactHeightfield(&ctx, cfg.walkableHeight, cfg.walkableClimb, *solid, *chf));
+	rcFreeHeightField(solid);
+	REQUIRE(rcErodeWalkableArea(&ctx, cfg.walkableRadius, *chf));
+	REQUIRE(rcBuildDistanceField(&ctx, *chf));
+	REQUIRE(rcBuildRegions(&ctx, *chf, 0, cfg.minRegionArea, cfg.mergeRegionArea));
+
+	rcContourSet* cset = rcAllocContourSet();
+	REQUIRE(rcBuildContours(&ctx, *chf, cfg.maxSimplificationError, cfg.maxEdgeLen, *cset));
+	rcPolyMesh* pmesh = rcAllocPolyMesh();
+	REQUIRE(rcBuildPolyMesh(&ctx, *cset, cfg.maxVertsPerPoly, *pmesh));
+
+	const float sampleDists[2] = { 6.0f, 2.0f };
+	for (int i = 0; i < 2; ++i)
+	{
+		const int iterations = 5;
+		int64_t nanos = 0;
+		int detailTris = 0;
+		for (int iter = 0; iter < iterations; ++iter)
+		{
+			rcPolyMeshDetail* dmesh = rcAllocPolyMeshDetail();
+			const int64_t begin = DetailNowNanos();
+			REQUIRE(rcBuildPolyMeshDetail(&ctx, *pmesh, *chf, sampleDists[i] * cfg.cs, 1.0f * cfg.ch, *dmesh));
+			nanos += DetailNowNanos() - begin;
+			detailTris = dmesh->ntris;
+			rcFreePolyMeshDetail(dmesh);
+		}
+		printf("BM_rcBuildPolyMeshDetail_SampleDist%d: %d polys, %d tris in %10ld nanos: %10.2f nanos/poly\n",
+			   (int)sampleDists[i], pmesh->npolys, detailTris, (long)(nanos / iterations),
+			   double(nanos) / iterations / pmesh->npolys);
+	}
+
+	rcFreePolyMesh(pmesh);
+	rcFreeContourSet(cset);
+	rcFreeCompactHeightfield(chf);
+}
+
+#endif  // _POSIX_TIMERS
+#endif  // __unix__
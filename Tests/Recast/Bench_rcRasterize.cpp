@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "Recast.h"
+
+// TODO: Implement benchmarking for platforms other than posix.
+#ifdef __unix__
+#include <unistd.h>
+#ifdef _POSIX_TIMERS
+#include <time.h>
+#include <stdint.h>
+
+static int64_t RasterizeNowNanos()
+{
+	struct timespec tp;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &tp);
+	return tp.tv_nsec + 1000000000LL * tp.tv_sec;
+}
+
+// Rasterizes a bumpy terrain of 200k triangles with the scalar and the SIMD rasterizers.
+TEST_CASE("Bench rcRasterizeTriangles", "[recast]")
+{
+	const int quads = 316;
+	const float size = 100.0f;
+	std::vector<float> verts;
+	std::vector<int> tris;
+	for (int z = 0; z <= quads; ++z)
+	{
+		for (int x = 0; x <= quads; ++x)
+		{
+			const unsigned int h = ((unsigned int)x * 73856093u) ^ ((unsigned int)z * 19349663u);
+			verts.push_back(x * size / quads);
+			verts.push_back((h % 1000) / 1000.0f * 2.0f);
+			verts.push_back(z * size / quads);
+		}
+	}
+	for (int z = 0; z < quads; ++z)
+	{
+		for (int x = 0; x < quads; ++x)
+		{
+			const int i = x + z * (quads + 1);
+			tris.push_back(i); tris.push_back(i + quads + 1); tris.push_back(i + 1);
+			tris.push_back(i + 1); tris.push_back(i + quads + 1); tris.push_back(i + quads + 2);
+		}
+	}
+	const int ntris = (int)tris.size() / 3;
+	std::vector<unsigned char> areas(ntris, RC_WALKABLE_AREA);
+
+	const float bmin[3] = { 0, -1, 0 };
+	const float bmax[3] = { size, 3, size };
+	const float cellSize = 0.3f;
+	const float cellHeight = 0.2f;
+	int width;
+	int height;
+	rcCalcGridSize(bmin, bmax, cellSize, &width, &height);
+
+	rcContext ctx(false);
+	const bool simd = rcGetSimdRasterization();
+	for (int pass = 0; pass < (simd ? 2 : 1); ++pass)
+	{
+		rcSetSimdRasterization(pass == 1);
+		rcHeightfield solid;
+		REQUIRE(rcCreateHeightfield(&ctx, solid, width, height, bmin, bmax, cellSize, cellHeight));
+		const int64_t begin = RasterizeNowNanos();
+		REQUIRE(rcRasterizeTriangles(&ctx, &verts[0], (int)verts.size() / 3, &tris[0], &areas[0], ntris, solid));
+		const int64_t nanos = RasterizeNowNanos() - begin;
+		printf("BM_%-35s %d triangles in %10ld nanos: %10.2f nanos/tri\n", pass == 1 ? "rcRasterizeTriangles_SIMD:" : "rcRasterizeTriangles_Scalar:",
+			   ntris, (long)nanos, double(nanos) / ntris);
+	}
+	rcSetSimdRasterization(simd);
+}
+
+// Rasterizes a bumpy terrain with one sample per cell corner as a heightmap and as triangles.
+TEST_CASE("Bench rcRasterizeHeightmap", "[recast]")
+{
+	const int cells = 320;
+	const float cellSize = 0.3f;
+	const float cellHeight = 0.2f;
+	const int samples = cells + 1;
+	std::vector<float> heights;
+	std::vector<float> verts;
+	for (int z = 0; z < samples; ++z)
+	{
+		for (int x = 0; x < samples; ++x)
+		{
+			const unsigned int h = ((unsigned int)x * 73856093u) ^ ((unsigned int)z * 19349663u);
+			heights.push_back((h % 1000) / 1000.0f * 0.5f);
+			verts.push_back(x * cellSize);
+			verts.push_back(heights.back());
+			verts.push_back(z * cellSize);
+		}
+	}
+	std::vector<int> tris;
+	for (int z = 0; z < cells; ++z)
+	{
+		for (int x = 0; x < cells; ++x)
+		{
+			const int i = x + z * samples;
+			tris.push_back(i); tris.push_back(i + samples); tris.push_back(i + samples + 1);
+			tris.push_back(i); tris.push_back(i + samples + 1); tris.push_back(i + 1);
+		}
+	}
+	const int ntris = (int)tris.size() / 3;
+	std::vector<unsigned char> areas(ntris, RC_WALKABLE_AREA);
+
+	const float bmin[3] = { 0, -1, 0 };
+	const float bmax[3] = { cells * cellSize, 3, cells * cellSize };
+
+	rcContext ctx(false);
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		rcHeightfield solid;
+		REQUIRE(rcCreateHeightfield(&ctx, solid, cells, cells, bmin, bmax, cellSize, cellHeight));
+		const int64_t begin = RasterizeNowNanos();
+		if (pass == 0)
+			REQUIRE(rcRasterizeTriangles(&ctx, &verts[0], (int)verts.size() / 3, &tris[0], &areas[0], ntris, solid));
+		else
+			REQUIRE(rcRasterizeHeightmap(&ctx, &heights[0], 0, 0, samples, samples, 0, 0, solid));
+		const int64_t nanos = RasterizeNowNanos() - begin;
+		printf("BM_%-35s %d cells in %10ld nanos: %10.2f nanos/cell\n", pass == 1 ? "rcRasterizeHeightmap:" : "rcRasterizeHeightmap_Triangles:",
+			   cells * cells, (long)nanos, double(nanos) / (cells * cells));
+	}
+}
+
+#endif  // _POSIX_TIMERS
+#endif  // __unix__
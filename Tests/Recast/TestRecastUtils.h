@@ -0,0 +1,132 @@
+#ifndef TESTRECASTUTILS_H
+#define TESTRECASTUTILS_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "Recast.h"
+#include "RecastAlloc.h"
+
+// Helpers shared by the Recast tests.
+namespace TestRecast
+{
+// Runs the jobs on a set of threads, handing out job indices in arbitrary order.
+struct ThreadDispatcher : public rcJobDispatcher
+{
+	int workers;
+	explicit ThreadDispatcher(int n) : workers(n) {}
+
+	int getWorkerCount() const override { return workers; }
+
+	void dispatch(rcJobFunc func, void* userData, const int jobCount) override
+	{
+		std::atomic<int> next(0);
+		std::vector<std::thread> threads;
+		for (int w = 0; w < workers; ++w)
+		{
+			threads.emplace_back([&, w]() {
+				for (int i = next++; i < jobCount; i = next++)
+					func(userData, jobCount - 1 - i, w);
+			});
+		}
+		for (std::thread& t : threads)
+			t.join();
+	}
+};
+
+// Counts its allocations and tags them, so that memory freed by the wrong allocator is detected.
+struct CountingAllocator : public rcAllocator
+{
+	static const unsigned int TAG = 0x52434131u;
+	static const size_t HEADER = 16;
+
+	std::atomic<int> allocs;
+	std::atomic<int> live;
+	std::atomic<int> foreign;
+
+	CountingAllocator() : allocs(0), live(0), foreign(0) {}
+
+	void* alloc(size_t size, rcAllocHint) override
+	{
+		unsigned char* mem = (unsigned char*)malloc(size + HEADER);
+		if (!mem)
+			return 0;
+		*(unsigned int*)mem = TAG;
+		allocs++;
+		live++;
+		return mem + HEADER;
+	}
+
+	void free(void* ptr) override
+	{
+		unsigned char* mem = (unsigned char*)ptr - HEADER;
+		if (*(unsigned int*)mem != TAG)
+		{
+			foreign++;
+			return;
+		}
+		*(unsigned int*)mem = 0;
+		live--;
+		::free(mem);
+	}
+};
+
+// Builds the compact heightfield of a bumpy terrain with steep, unwalkable parts.
+inline rcCompactHeightfield* buildTerrain(rcContext& ctx)
+{
+	const int quads = 40;
+	const float size = 60.0f;
+	std::vector<float> verts;
+	std::vector<int> tris;
+	for (int z = 0; z <= quads; ++z)
+	{
+		for (int x = 0; x <= quads; ++x)
+		{
+			const unsigned int h = ((unsigned int)x * 73856093u) ^ ((unsigned int)z * 19349663u);
+			verts.push_back(x * size / quads);
+			verts.push_back((h % 7) == 0 ? 2.0f : (h % 100) / 100.0f * 0.3f);
+			verts.push_back(z * size / quads);
+		}
+	}
+	for (int z = 0; z < quads; ++z)
+	{
+		for (int x = 0; x < quads; ++x)
+		{
+			const int i = x + z * (quads + 1);
+			tris.push_back(i); tris.push_back(i + quads + 1); tris.push_back(i + 1);
+			tris.push_back(i + 1); tris.push_back(i + quads + 1); tris.push_back(i + quads + 2);
+		}
+	}
+	const int nverts = (int)verts.size() / 3;
+	const int ntris = (int)tris.size() / 3;
+
+	const float bmin[3] = { 0, -1, 0 };
+	const float bmax[3] = { size, 3, size };
+	const float cs = 0.3f;
+	const float ch = 0.2f;
+	const float walkableSlopeAngle = 45.0f;
+	const int walkableHeight = 10;
+	const int walkableClimb = 2;
+	int width;
+	int height;
+	rcCalcGridSize(bmin, bmax, cs, &width, &height);
+
+	rcHeightfield* solid = rcAllocHeightfield();
+	REQUIRE(rcCreateHeightfield(&ctx, *solid, width, height, bmin, bmax, cs, ch));
+	std::vector<unsigned char> areas(ntris, 0);
+	rcMarkWalkableTriangles(&ctx, walkableSlopeAngle, &verts[0], nverts, &tris[0], ntris, &areas[0]);
+	REQUIRE(rcRasterizeTriangles(&ctx, &verts[0], nverts, &tris[0], &areas[0], ntris, *solid, walkableClimb));
+	rcFilterLedgeSpans(&ctx, walkableHeight, walkableClimb, *solid);
+
+	rcCompactHeightfield* chf = rcAllocCompactHeightfield();
+	REQUIRE(rcBuildCompactHeightfield(&ctx, walkableHeight, walkableClimb, *solid, *chf));
+	rcFreeHeightField(solid);
+	REQUIRE(rcErodeWalkableArea(&ctx, 1, *chf));
+	return chf;
+}
+} // namespace TestRecast
+
+#endif // TESTRECASTUTILS_H
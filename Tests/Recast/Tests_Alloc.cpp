@@ -258,3 +258,135 @@ TEST_CASE("rcVector", "[recast, alloc]")
 		v.clear();
 	}
 }
+
+namespace
+{
+struct CountingAllocator : public rcAllocator
+{
+	int allocs;
+	int frees;
+	CountingAllocator() : allocs(0), frees(0) {}
+	void* alloc(size_t size, rcAllocHint hint) override
+	{
+		allocs++;
+		return rcAllocator::alloc(size, hint);
+	}
+	void free(void* ptr) override
+	{
+		frees++;
+		rcAllocator::free(ptr);
+	}
+};
+} // anonymous namespace
+
+TEST_CASE("rcAllocatorScope", "[recast, alloc]")
+{
+	CountingAllocator allocator;
+	REQUIRE(rcGetAllocator() == 0);
+
+	SECTION("Allocations use the bound allocator")
+	{
+		{
+			rcAllocatorScope scope(&allocator);
+			REQUIRE(rcGetAllocator() == &allocator);
+			void* perm = rcAlloc(10, RC_ALLOC_PERM);
+			void* temp = rcAlloc(10, RC_ALLOC_TEMP);
+			REQUIRE(allocator.allocs == 2);
+			rcFree(perm);
+			rcFree(temp);
+			rcFree(0);
+			REQUIRE(allocator.frees == 2);
+
+			// Nested scopes restore the previous allocator.
+			{
+				rcAllocatorScope inner(0);
+				REQUIRE(rcGetAllocator() == 0);
+				rcFree(rcAlloc(10, RC_ALLOC_PERM));
+			}
+			REQUIRE(rcGetAllocator() == &allocator);
+			REQUIRE(allocator.allocs == 2);
+		}
+		REQUIRE(rcGetAllocator() == 0);
+	}
+
+	SECTION("A bound arena takes precedence for temporary memory")
+	{
+		rcTempArena arena;
+		REQUIRE(arena.init(256, &allocator));
+		REQUIRE(allocator.allocs == 1);
+
+		rcAllocatorScope scope(&allocator);
+		rcTempArenaScope arenaScope(&arena);
+		void* temp = rcAlloc(10, RC_ALLOC_TEMP);
+		void* perm = rcAlloc(10, RC_ALLOC_PERM);
+		REQUIRE(arena.owns(temp));
+		REQUIRE(allocator.allocs == 2);
+		rcFree(temp);
+		rcFree(perm);
+		REQUIRE(allocator.frees == 1);
+	}
+}
+
+TEST_CASE("rcTempArena", "[recast, alloc]")
+{
+	rcTempArena arena;
+	REQUIRE(arena.init(256));
+	REQUIRE(arena.getCapacity() == 256);
+
+	SECTION("Temporary allocations use the bound arena")
+	{
+		{
+			rcTempArenaScope scope(&arena);
+			REQUIRE(rcGetTempArena() == &arena);
+
+			void* temp = rcAlloc(10, RC_ALLOC_TEMP);
+			void* perm = rcAlloc(10, RC_ALLOC_PERM);
+			REQUIRE(arena.owns(temp));
+			REQUIRE(!arena.owns(perm));
+			REQUIRE(((uintptr_t)temp & 15) == 0);
+			REQUIRE(arena.getUsedSize() == 16);
+			rcFree(temp);
+			rcFree(perm);
+			REQUIRE(arena.getUsedSize() == 16);
+
+			// Nested scopes restore the previous arena.
+			{
+				rcTempArenaScope inner(0);
+				REQUIRE(rcGetTempArena() == 0);
+				void* global = rcAlloc(10, RC_ALLOC_TEMP);
+				REQUIRE(!arena.owns(global));
+				rcFree(global);
+			}
+			REQUIRE(rcGetTempArena() == &arena);
+		}
+		REQUIRE(rcGetTempArena() == 0);
+	}
+
+	SECTION("Full arenas add blocks and merge them on reset")
+	{
+		rcTempArenaScope scope(&arena);
+		{
+			rcTempVector<int> v;
+			for (int i = 0; i < 1000; ++i)
+				v.push_back(i);
+			for (int i = 0; i < 1000; ++i)
+				REQUIRE(v[i] == i);
+			REQUIRE(arena.owns(v.data()));
+		}
+		REQUIRE(arena.getCapacity() > 256);
+
+		const size_t capacity = arena.getCapacity();
+		const size_t peak = arena.getPeakSize();
+		REQUIRE(peak == arena.getUsedSize());
+		arena.reset();
+		REQUIRE(arena.getUsedSize() == 0);
+		REQUIRE(arena.getPeakSize() == peak);
+		REQUIRE(arena.getCapacity() == capacity);
+
+		// The same allocations fit into the merged block.
+		rcTempVector<int> w;
+		for (int i = 0; i < 1000; ++i)
+			w.push_back(i);
+		REQUIRE(arena.getCapacity() == capacity);
+	}
+}
@@ -1,9 +1,13 @@
+#include <math.h>
 #include <stdio.h>
 #include <string.h>
+#include <vector>
 
 #include "catch2/catch_all.hpp"
 
 #include "Recast.h"
+#include "RecastAlloc.h"
+#include "TestRecastUtils.h"
 
 TEST_CASE("rcSwap", "[recast]")
 {
@@ -434,6 +438,111 @@ TEST_CASE("rcCreateHeightfield", "[recast]")
 	}
 }
 
+TEST_CASE("rcHeightfield span pools", "[recast]")
+{
+	rcContext ctx;
+
+	// Two quads on top of each other, two spans per column.
+	const float verts[] = {
+		0, 0, 0,   4, 0, 0,   4, 0, 4,   0, 0, 4,
+		0, 2, 0,   4, 2, 0,   4, 2, 4,   0, 2, 4,
+	};
+	const int tris[] = { 0, 2, 1,  0, 3, 2,  4, 6, 5,  4, 7, 6 };
+	const unsigned char areas[] = { 1, 1, 2, 2 };
+	const float bmin[3] = { 0, -1, 0 };
+	const float bmax[3] = { 4, 3, 4 };
+	const float cellSize = 0.5f;
+	const float cellHeight = 0.5f;
+	const int width = 8;
+	const int height = 8;
+
+	rcHeightfield solid;
+	REQUIRE(rcCreateHeightfield(&ctx, solid, width, height, bmin, bmax, cellSize, cellHeight));
+
+	SECTION("Reserved spans are allocated in one pool")
+	{
+		// One more for the new span while it is merged with the existing ones.
+		const int spanCount = width * height * 2 + 1;
+		REQUIRE(rcReserveHeightfieldSpans(&ctx, solid, spanCount));
+		REQUIRE(solid.pools);
+		REQUIRE(solid.pools->spanCount == spanCount);
+		REQUIRE(rcReserveHeightfieldSpans(&ctx, solid, width * height));
+		REQUIRE(!solid.pools->next);
+
+		REQUIRE(rcRasterizeTriangles(&ctx, verts, 8, tris, areas, 4, solid));
+		REQUIRE(!solid.pools->next);
+	}
+
+	SECTION("Defragment spans column by column")
+	{
+		solid.spansPerPool = 5;
+		REQUIRE(rcRasterizeTriangles(&ctx, verts, 8, tris, areas, 4, solid));
+		REQUIRE(solid.pools->next);
+
+		std::vector<int> before;
+		for (int i = 0; i < width * height; ++i)
+			for (const rcSpan* s = solid.spans[i]; s; s = s->next)
+				before.push_back(i << 24 | s->smin << 12 | s->smax << 4 | s->area);
+		REQUIRE(before.size() == (size_t)(width * height * 2));
+
+		REQUIRE(rcDefragmentHeightfield(&ctx, solid));
+		REQUIRE(solid.pools);
+		REQUIRE(!solid.pools->next);
+		REQUIRE(solid.pools->spanCount == width * height * 2);
+		REQUIRE(!solid.freelist);
+
+		std::vector<int> after;
+		const rcSpan* expected = solid.pools->items;
+		for (int i = 0; i < width * height; ++i)
+		{
+			for (const rcSpan* s = solid.spans[i]; s; s = s->next)
+			{
+				REQUIRE(s == expected++);
+				after.push_back(i << 24 | s->smin << 12 | s->smax << 4 | s->area);
+			}
+		}
+		REQUIRE(after == before);
+
+		// New spans are allocated from a new pool.
+		const float top[] = { 0, 3, 0,   4, 3, 0,   0, 3, 4 };
+		REQUIRE(rcRasterizeTriangle(&ctx, &top[0], &top[6], &top[3], 3, solid));
+		REQUIRE(solid.pools->next);
+	}
+
+	SECTION("Reset keeps the span pools")
+	{
+		REQUIRE(rcRasterizeTriangles(&ctx, verts, 8, tris, areas, 4, solid));
+		const rcSpanPool* pools = solid.pools;
+		rcSpan** spans = solid.spans;
+		REQUIRE(pools);
+		REQUIRE(!pools->next);
+
+		REQUIRE(rcResetHeightfield(&ctx, solid, width, height, bmin, bmax, cellSize, cellHeight));
+		REQUIRE(solid.spans == spans);
+		REQUIRE(solid.pools == pools);
+		for (int i = 0; i < width * height; ++i)
+			REQUIRE(!solid.spans[i]);
+		int freeCount = 0;
+		for (const rcSpan* s = solid.freelist; s; s = s->next)
+			freeCount++;
+		REQUIRE(freeCount == pools->spanCount);
+
+		// The same input fits in the pool of the previous build.
+		REQUIRE(rcRasterizeTriangles(&ctx, verts, 8, tris, areas, 4, solid));
+		REQUIRE(solid.pools == pools);
+		REQUIRE(!solid.pools->next);
+		REQUIRE(rcGetHeightFieldSpanCount(&ctx, solid) == width * height * 2);
+
+		// A different size replaces the column array.
+		REQUIRE(rcResetHeightfield(&ctx, solid, 4, 4, bmin, bmax, 1.0f, cellHeight));
+		REQUIRE(solid.width == 4);
+		REQUIRE(solid.height == 4);
+		REQUIRE(solid.cs == 1.0f);
+		REQUIRE(rcRasterizeTriangles(&ctx, verts, 8, tris, areas, 4, solid));
+		REQUIRE(rcGetHeightFieldSpanCount(&ctx, solid) == 4 * 4 * 2);
+	}
+}
+
 TEST_CASE("rcMarkWalkableTriangles", "[recast]")
 {
 	rcContext* ctx = 0;
@@ -511,6 +620,107 @@ TEST_CASE("rcClearUnwalkableTriangles", "[recast]")
 	}
 }
 
+TEST_CASE("rcMarkWalkableTriangles batches", "[recast]")
+{
+	// Random slopes over a jittered grid, with degenerate triangles and a count that is not a
+	// multiple of the batch size.
+	const int gridSize = 128;
+	std::vector<float> verts;
+	unsigned int seed = 7;
+	for (int z = 0; z < gridSize; ++z)
+	{
+		for (int x = 0; x < gridSize; ++x)
+		{
+			seed = seed * 1103515245u + 12345u;
+			verts.push_back((float)x);
+			verts.push_back((float)((seed >> 8) & 0xff) / 64.0f);
+			verts.push_back((float)z);
+		}
+	}
+	std::vector<int> tris;
+	for (int z = 0; z < gridSize - 1; ++z)
+	{
+		for (int x = 0; x < gridSize - 1; ++x)
+		{
+			const int i = z * gridSize + x;
+			const int a[] = { i, i + gridSize, i + 1, i + 1, i + gridSize, i + gridSize + 1 };
+			tris.insert(tris.end(), a, a + 6);
+			if (x == z)
+			{
+				const int degenerate[] = { i, i, i + 1 };
+				tris.insert(tris.end(), degenerate, degenerate + 3);
+			}
+		}
+	}
+	tris.push_back(0);
+	tris.push_back(gridSize);
+	tris.push_back(1);
+	const int ntris = (int)tris.size() / 3;
+	REQUIRE(ntris % 4 != 0);
+
+	const float walkableSlopeAngle = 45.0f;
+	const float walkableThr = cosf(walkableSlopeAngle / 180.0f * RC_PI);
+	std::vector<unsigned char> expected(ntris, 42);
+	int walkableCount = 0;
+	for (int i = 0; i < ntris; ++i)
+	{
+		const float* v0 = &verts[tris[i * 3 + 0] * 3];
+		float e0[3], e1[3], n[3];
+		rcVsub(e0, &verts[tris[i * 3 + 1] * 3], v0);
+		rcVsub(e1, &verts[tris[i * 3 + 2] * 3], v0);
+		rcVcross(n, e0, e1);
+		rcVnormalize(n);
+		if (n[1] > walkableThr)
+		{
+			expected[i] = RC_WALKABLE_AREA;
+			walkableCount++;
+		}
+	}
+	REQUIRE(walkableCount > 0);
+	REQUIRE(walkableCount < ntris);
+
+	SECTION("Mark")
+	{
+		std::vector<unsigned char> serial(ntris, 42);
+		rcMarkWalkableTriangles(0, walkableSlopeAngle, &verts[0], gridSize * gridSize, &tris[0], ntris, &serial[0]);
+		REQUIRE(serial == expected);
+
+		TestRecast::ThreadDispatcher dispatcher(3);
+		std::vector<unsigned char> parallel(ntris, 42);
+		rcMarkWalkableTriangles(0, walkableSlopeAngle, &verts[0], gridSize * gridSize, &tris[0], ntris, &parallel[0],
+								&dispatcher);
+		REQUIRE(parallel == expected);
+	}
+
+	SECTION("Clear")
+	{
+		std::vector<unsigned char> cleared(expected);
+		for (int i = 0; i < ntris; ++i)
+		{
+			if (cleared[i] != RC_WALKABLE_AREA)
+				cleared[i] = RC_NULL_AREA;
+		}
+		// The degenerate triangles are neither walkable nor cleared.
+		for (int i = 0; i < ntris; ++i)
+		{
+			const int* t = &tris[i * 3];
+			if (t[0] == t[1])
+				cleared[i] = 42;
+		}
+
+		TestRecast::ThreadDispatcher dispatcher(3);
+		std::vector<unsigned char> areas(ntris, 42);
+		for (int i = 0; i < ntris; ++i)
+		{
+			if (expected[i] == RC_WALKABLE_AREA)
+				areas[i] = RC_WALKABLE_AREA;
+		}
+		rcClearUnwalkableTriangles(0, walkableSlopeAngle, &verts[0], gridSize * gridSize, &tris[0], ntris, &areas[0],
+								   &dispatcher);
+		REQUIRE(areas == cleared);
+	}
+}
+
 TEST_CASE("rcAddSpan", "[recast]")
 {
 	rcContext ctx(false);
@@ -935,3 +1145,631 @@ TEST_CASE("rcRasterizeTriangles", "[recast]")
 		REQUIRE(!solid.spans[1 + 2 * width]->next);
 	}
 }
+
+TEST_CASE("rcRasterizeTriangles SIMD", "[recast]")
+{
+	if (!rcGetSimdRasterization())
+	{
+		SKIP("SIMD rasterization is not available.");
+	}
+
+	rcContext ctx;
+
+	// Random large and small triangles of various slopes, some of them crossing the heightfield bounds.
+	const int numTris = 4000;
+	std::vector<float> verts;
+	std::vector<unsigned char> areas;
+	unsigned int seed = 12345;
+	for (int i = 0; i < numTris; ++i)
+	{
+		float center[3];
+		for (int j = 0; j < 12; ++j)
+		{
+			seed = seed * 1103515245u + 12345u;
+			const float r = ((seed >> 8) & 0xffff) / 65535.0f;
+			if (j < 3)
+				center[j] = r * 24.0f - 2.0f;
+			else if (i % 2)
+				verts.push_back(center[j % 3] + r - 0.5f);
+			else
+				verts.push_back(r * 24.0f - 2.0f);
+		}
+	}
+	for (int i = 0; i < numTris; ++i)
+		areas.push_back((unsigned char)(1 + i % 3));
+
+	const float bmin[3] = { 0, 0, 0 };
+	const float bmax[3] = { 20, 20, 20 };
+	const float cellSize = 0.3f;
+	const float cellHeight = 0.2f;
+	int width;
+	int height;
+	rcCalcGridSize(bmin, bmax, cellSize, &width, &height);
+
+	rcHeightfield simd;
+	rcHeightfield scalar;
+	REQUIRE(rcCreateHeightfield(&ctx, simd, width, height, bmin, bmax, cellSize, cellHeight));
+	REQUIRE(rcCreateHeightfield(&ctx, scalar, width, height, bmin, bmax, cellSize, cellHeight));
+
+	REQUIRE(rcRasterizeTriangles(&ctx, &verts[0], &areas[0], numTris, simd, 1));
+	REQUIRE(rcSetSimdRasterization(false));
+	REQUIRE(rcRasterizeTriangles(&ctx, &verts[0], &areas[0], numTris, scalar, 1));
+	REQUIRE(rcSetSimdRasterization(true));
+
+	int spanCount = 0;
+	for (int i = 0; i < width * height; ++i)
+	{
+		const rcSpan* a = simd.spans[i];
+		const rcSpan* b = scalar.spans[i];
+		for (; a && b; a = a->next, b = b->next)
+		{
+			REQUIRE(a->smin == b->smin);
+			REQUIRE(a->smax == b->smax);
+			REQUIRE(a->area == b->area);
+			spanCount++;
+		}
+		REQUIRE(!a);
+		REQUIRE(!b);
+	}
+	REQUIRE(spanCount > 0);
+}
+
+namespace
+{
+// Requires both compact heightfields to have the same cells, spans and areas.
+void requireSameCompactHeightfields(const rcCompactHeightfield& a, const rcCompactHeightfield& b)
+{
+	REQUIRE(a.width == b.width);
+	REQUIRE(a.height == b.height);
+	REQUIRE(a.spanCount == b.spanCount);
+	for (int i = 0; i < a.width * a.height; ++i)
+	{
+		REQUIRE(a.cells[i].index == b.cells[i].index);
+		REQUIRE(a.cells[i].count == b.cells[i].count);
+	}
+	for (int i = 0; i < a.spanCount; ++i)
+	{
+		REQUIRE(a.spans[i].y == b.spans[i].y);
+		REQUIRE(a.spans[i].h == b.spans[i].h);
+		REQUIRE(a.spans[i].con == b.spans[i].con);
+		REQUIRE(a.areas[i] == b.areas[i]);
+	}
+}
+}
+
+TEST_CASE("rcColumnHeightfield", "[recast]")
+{
+	rcContext ctx;
+
+	// Random triangles between a stack of floors, each floor made of two triangles with its own area.
+	const int numFloors = 12;
+	const int numRandomTris = 3000;
+	std::vector<float> verts;
+	std::vector<unsigned char> areas;
+	for (int floor = 0; floor < numFloors; ++floor)
+	{
+		const float y = 0.5f + floor * 1.6f;
+		const float quad[] = { 1, y, 1,  1, y, 18,  18, y, 18,  1, y, 1,  18, y, 18,  18, y + 0.3f, 1 };
+		verts.insert(verts.end(), quad, quad + 18);
+		areas.push_back((unsigned char)(1 + floor % 4));
+		areas.push_back((unsigned char)(1 + floor % 4));
+	}
+	unsigned int seed = 4321;
+	for (int i = 0; i < numRandomTris; ++i)
+	{
+		float center[3];
+		for (int j = 0; j < 12; ++j)
+		{
+			seed = seed * 1103515245u + 12345u;
+			const float r = ((seed >> 8) & 0xffff) / 65535.0f;
+			if (j < 3)
+				center[j] = r * 22.0f - 1.0f;
+			else
+				verts.push_back(center[j % 3] + r - 0.5f);
+		}
+		areas.push_back((unsigned char)(i % 5 == 0 ? RC_NULL_AREA : 1 + i % 3));
+	}
+	const int numTris = (int)areas.size();
+	const int firstBatch = numTris / 3;
+
+	const float bmin[3] = { 0, 0, 0 };
+	const float bmax[3] = { 20, 20, 20 };
+	const float cellSize = 0.3f;
+	const float cellHeight = 0.2f;
+	const int walkableHeight = 10;
+	const int walkableClimb = 4;
+	int width;
+	int height;
+	rcCalcGridSize(bmin, bmax, cellSize, &width, &height);
+
+	// The triangles are rasterized in two batches with different merge thresholds.
+	rcHeightfield reference;
+	REQUIRE(rcCreateHeightfield(&ctx, reference, width, height, bmin, bmax, cellSize, cellHeight));
+	REQUIRE(rcRasterizeTriangles(&ctx, &verts[0], &areas[0], firstBatch, reference, 1));
+	REQUIRE(rcRasterizeTriangles(&ctx, &verts[firstBatch * 9], &areas[firstBatch], numTris - firstBatch, reference, walkableClimb));
+
+	rcColumnHeightfield columns;
+	REQUIRE(rcCreateColumnHeightfield(&ctx, columns, width, height, bmin, bmax, cellSize, cellHeight));
+	REQUIRE(rcRasterizeTriangles(&ctx, &verts[0], &areas[0], firstBatch, columns, 1));
+
+	SECTION("Sorting once or after each batch gives the spans of the heightfield")
+	{
+		const bool sortBatches = GENERATE(false, true);
+		if (sortBatches)
+		{
+			REQUIRE(rcSortColumnHeightfield(&ctx, columns));
+			REQUIRE(columns.fragmentCount == 0);
+		}
+		REQUIRE(rcRasterizeTriangles(&ctx, &verts[firstBatch * 9], &areas[firstBatch], numTris - firstBatch, columns, walkableClimb));
+		REQUIRE(rcSortColumnHeightfield(&ctx, columns));
+
+		int spanCount = 0;
+		for (int i = 0; i < width * height; ++i)
+		{
+			int k = columns.columns[i];
+			const rcSpan* span = reference.spans[i];
+			for (; span && k < columns.columns[i + 1]; span = span->next, ++k)
+			{
+				REQUIRE(span->smin == columns.spans[k].smin);
+				REQUIRE(span->smax == columns.spans[k].smax);
+				REQUIRE(span->area == columns.spans[k].area);
+				spanCount++;
+			}
+			REQUIRE(!span);
+			REQUIRE(k == columns.columns[i + 1]);
+		}
+		REQUIRE(spanCount == columns.spanCount);
+		REQUIRE(spanCount > width * height * 4);
+	}
+
+	SECTION("Filtering and compacting gives the compact heightfield of the heightfield")
+	{
+		REQUIRE(rcRasterizeTriangles(&ctx, &verts[firstBatch * 9], &areas[firstBatch], numTris - firstBatch, columns, walkableClimb));
+		REQUIRE(rcSortColumnHeightfield(&ctx, columns));
+
+		rcCompactHeightfield expected;
+		rcCompactHeightfield actual;
+		const bool fused = GENERATE(false, true);
+		if (fused)
+		{
+			const int flags = RC_FILTER_LOW_HANGING_OBSTACLES | RC_FILTER_LEDGE_SPANS | RC_FILTER_WALKABLE_LOW_HEIGHT;
+			REQUIRE(rcBuildFilteredCompactHeightfield(&ctx, flags, walkableHeight, walkableClimb, reference, expected));
+			REQUIRE(rcBuildFilteredCompactHeightfield(&ctx, flags, walkableHeight, walkableClimb, columns, actual));
+		}
+		else
+		{
+			rcFilterLowHangingWalkableObstacles(&ctx, walkableClimb, reference);
+			rcFilterLedgeSpans(&ctx, walkableHeight, walkableClimb, reference);
+			rcFilterWalkableLowHeightSpans(&ctx, walkableHeight, reference);
+			REQUIRE(rcBuildCompactHeightfield(&ctx, walkableHeight, walkableClimb, reference, expected));
+
+			rcFilterLowHangingWalkableObstacles(&ctx, walkableClimb, columns);
+			rcFilterLedgeSpans(&ctx, walkableHeight, walkableClimb, columns);
+			rcFilterWalkableLowHeightSpans(&ctx, walkableHeight, columns);
+			REQUIRE(rcBuildCompactHeightfield(&ctx, walkableHeight, walkableClimb, columns, actual));
+		}
+		REQUIRE(expected.spanCount > 0);
+		requireSameCompactHeightfields(expected, actual);
+	}
+
+	SECTION("Creating the heightfield again clears it and keeps its arrays")
+	{
+		REQUIRE(rcSortColumnHeightfield(&ctx, columns));
+		const rcColumnSpan* spans = columns.spans;
+		const int spanCount = columns.spanCount;
+
+		REQUIRE(rcCreateColumnHeightfield(&ctx, columns, width, height, bmin, bmax, cellSize, cellHeight));
+		REQUIRE(columns.spanCount == 0);
+		REQUIRE(columns.columns[width * height] == 0);
+		REQUIRE(rcRasterizeTriangles(&ctx, &verts[0], &areas[0], firstBatch, columns, 1));
+		REQUIRE(rcSortColumnHeightfield(&ctx, columns));
+		REQUIRE(columns.spans == spans);
+		REQUIRE(columns.spanCount == spanCount);
+	}
+}
+
+namespace
+{
+// Rasterizes on the CPU, then raises the top of the first span it finds.
+class OffByOneBackend : public rcRasterizationBackend
+{
+public:
+	virtual bool rasterize(rcContext* context, const rcConfig& config, const rcTriangleBuffers& triangles,
+						   rcHeightfield& heightfield)
+	{
+		if (!rcRasterizationBackend::rasterize(context, config, triangles, heightfield))
+			return false;
+		for (int i = 0; i < heightfield.width * heightfield.height; ++i)
+		{
+			if (heightfield.spans[i])
+			{
+				heightfield.spans[i]->smax++;
+				break;
+			}
+		}
+		return true;
+	}
+};
+
+class FailingBackend : public rcRasterizationBackend
+{
+public:
+	virtual bool rasterize(rcContext*, const rcConfig&, const rcTriangleBuffers&, rcHeightfield&) { return false; }
+};
+}
+
+TEST_CASE("rcRasterizationBackend", "[recast]")
+{
+	rcContext ctx;
+
+	// A grid of sloped quads with a raised triangle over it.
+	std::vector<float> verts;
+	std::vector<int> tris;
+	std::vector<unsigned char> areas;
+	const int quads = 8;
+	for (int z = 0; z <= quads; ++z)
+	{
+		for (int x = 0; x <= quads; ++x)
+		{
+			verts.push_back((float)x);
+			verts.push_back(0.1f * (float)(x + z));
+			verts.push_back((float)z);
+		}
+	}
+	for (int z = 0; z < quads; ++z)
+	{
+		for (int x = 0; x < quads; ++x)
+		{
+			const int i = x + z * (quads + 1);
+			tris.push_back(i); tris.push_back(i + quads + 1); tris.push_back(i + 1);
+			tris.push_back(i + 1); tris.push_back(i + quads + 1); tris.push_back(i + quads + 2);
+		}
+	}
+	const int raised = (int)verts.size() / 3;
+	const float top[9] = { 1, 4, 1, 2, 4, 6, 6, 4, 2 };
+	verts.insert(verts.end(), top, top + 9);
+	tris.push_back(raised); tris.push_back(raised + 1); tris.push_back(raised + 2);
+	for (size_t i = 0; i < tris.size() / 3; ++i)
+		areas.push_back((unsigned char)(1 + i % 2));
+
+	rcConfig cfg;
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.cs = 0.5f;
+	cfg.ch = 0.2f;
+	cfg.walkableClimb = 2;
+	const float bmax[3] = { (float)quads, 5, (float)quads };
+	rcVcopy(cfg.bmax, bmax);
+	rcCalcGridSize(cfg.bmin, cfg.bmax, cfg.cs, &cfg.width, &cfg.height);
+
+	rcTriangleBuffers indexed;
+	indexed.verts = &verts[0];
+	indexed.numVerts = (int)verts.size() / 3;
+	indexed.tris = &tris[0];
+	indexed.triAreaIDs = &areas[0];
+	indexed.numTris = (int)areas.size();
+
+	rcHeightfield expected;
+	REQUIRE(rcCreateHeightfield(&ctx, expected, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch));
+	REQUIRE(rcRasterizeTriangles(&ctx, indexed.verts, indexed.numVerts, indexed.tris, indexed.triAreaIDs,
+								 indexed.numTris, expected, cfg.walkableClimb));
+	REQUIRE(rcGetHeightFieldSpanCount(&ctx, expected) > cfg.width * cfg.height);
+
+	SECTION("The default backend is the CPU rasterizer")
+	{
+		rcRasterizationBackend backend;
+		rcHeightfield solid;
+		REQUIRE(rcCreateHeightfield(&ctx, solid, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch));
+		REQUIRE(backend.rasterize(&ctx, cfg, indexed, solid));
+		REQUIRE(rcCompareHeightfields(&ctx, solid, expected, 0) == 0);
+
+		// The same triangles as a triangle list.
+		std::vector<float> list;
+		for (size_t i = 0; i < tris.size(); ++i)
+			list.insert(list.end(), &verts[tris[i] * 3], &verts[tris[i] * 3] + 3);
+		rcTriangleBuffers soup = indexed;
+		soup.verts = &list[0];
+		soup.numVerts = (int)list.size() / 3;
+		soup.tris = NULL;
+		rcHeightfield fromList;
+		REQUIRE(rcCreateHeightfield(&ctx, fromList, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch));
+		REQUIRE(backend.rasterize(&ctx, cfg, soup, fromList));
+		REQUIRE(rcCompareHeightfields(&ctx, fromList, expected, 0) == 0);
+	}
+
+	SECTION("Validation passes for the CPU rasterizer")
+	{
+		rcRasterizationBackend cpu;
+		rcValidatingRasterizationBackend validating(&cpu);
+		rcHeightfield solid;
+		REQUIRE(rcCreateHeightfield(&ctx, solid, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch));
+		REQUIRE(validating.rasterize(&ctx, cfg, indexed, solid));
+		REQUIRE(validating.rasterize(&ctx, cfg, indexed, solid));
+		REQUIRE(validating.getMismatchCount() == 0);
+	}
+
+	SECTION("Validation counts the differing columns")
+	{
+		OffByOneBackend broken;
+		rcValidatingRasterizationBackend validating(&broken);
+		rcHeightfield solid;
+		REQUIRE(rcCreateHeightfield(&ctx, solid, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch));
+		REQUIRE(validating.rasterize(&ctx, cfg, indexed, solid));
+		REQUIRE(validating.getMismatchCount() == 1);
+
+		// The heightfield holds the result of the validated backend.
+		REQUIRE(rcCompareHeightfields(&ctx, solid, expected, 0) == 1);
+		validating.resetMismatchCount();
+		REQUIRE(validating.getMismatchCount() == 0);
+	}
+
+	SECTION("Validation fails with the backend")
+	{
+		FailingBackend failing;
+		rcValidatingRasterizationBackend validating(&failing);
+		rcHeightfield solid;
+		REQUIRE(rcCreateHeightfield(&ctx, solid, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch));
+		REQUIRE(!validating.rasterize(&ctx, cfg, indexed, solid));
+	}
+
+	SECTION("Copy and compare")
+	{
+		rcHeightfield copy;
+		REQUIRE(rcCopyHeightfield(&ctx, expected, copy));
+		REQUIRE(copy.width == expected.width);
+		REQUIRE(copy.cs == expected.cs);
+		REQUIRE(rcGetHeightFieldSpanCount(&ctx, copy) == rcGetHeightFieldSpanCount(&ctx, expected));
+		REQUIRE(rcCompareHeightfields(&ctx, copy, expected, 0) == 0);
+
+		// Copying over a heightfield replaces its spans.
+		REQUIRE(rcCopyHeightfield(&ctx, expected, copy));
+		REQUIRE(rcCompareHeightfields(&ctx, copy, expected, 0) == 0);
+
+		copy.spans[0]->area = 63;
+		REQUIRE(rcCompareHeightfields(&ctx, copy, expected, 4) == 1);
+		copy.spans[0]->area = expected.spans[0]->area;
+		int layered = 0;
+		while (!copy.spans[layered] || !copy.spans[layered]->next)
+			layered++;
+		copy.spans[layered]->next = NULL;
+		REQUIRE(rcCompareHeightfields(&ctx, copy, expected, 4) == 1);
+
+		rcHeightfield smaller;
+		REQUIRE(rcCreateHeightfield(&ctx, smaller, cfg.width - 1, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch));
+		REQUIRE(rcCompareHeightfields(&ctx, smaller, expected, 0) == -1);
+	}
+}
+
+TEST_CASE("rcRasterizeHeightmap", "[recast]")
+{
+	rcContext ctx;
+
+	// A bumpy heightmap which starts two cells before the heightfield and reaches
+	// above its bounds, with a few holes.
+	const int sampleWidth = 13;
+	const int sampleHeight = 11;
+	const int sampleX = -2;
+	const int sampleZ = 1;
+	const float cs = 0.5f;
+	std::vector<float> heights(sampleWidth * sampleHeight);
+	for (int z = 0; z < sampleHeight; ++z)
+		for (int x = 0; x < sampleWidth; ++x)
+			heights[x + z * sampleWidth] = 0.1f * (float)((x * 7 + z * 3) % 5) + 0.02f * (float)(x * z) - 0.3f;
+	const int cellCount = (sampleWidth - 1) * (sampleHeight - 1);
+	std::vector<unsigned char> holes(cellCount, 0);
+	holes[3] = holes[17] = holes[40] = 1;
+
+	float bmin[3] = { 0.0f, 0.0f, 0.0f };
+	float bmax[3] = { 4.0f, 2.0f, 6.0f };
+	int width = 0, height = 0;
+	rcCalcGridSize(bmin, bmax, cs, &width, &height);
+
+	// The same terrain as two triangles per cell.
+	std::vector<float> verts;
+	for (int z = 0; z < sampleHeight; ++z)
+	{
+		for (int x = 0; x < sampleWidth; ++x)
+		{
+			verts.push_back(bmin[0] + (float)(sampleX + x) * cs);
+			verts.push_back(heights[x + z * sampleWidth]);
+			verts.push_back(bmin[2] + (float)(sampleZ + z) * cs);
+		}
+	}
+	std::vector<int> tris;
+	for (int z = 0; z < sampleHeight - 1; ++z)
+	{
+		for (int x = 0; x < sampleWidth - 1; ++x)
+		{
+			if (holes[x + z * (sampleWidth - 1)])
+				continue;
+			const int i = x + z * sampleWidth;
+			tris.push_back(i); tris.push_back(i + sampleWidth); tris.push_back(i + sampleWidth + 1);
+			tris.push_back(i); tris.push_back(i + sampleWidth + 1); tris.push_back(i + 1);
+		}
+	}
+	const int numTris = (int)tris.size() / 3;
+
+	SECTION("Cells match their triangles")
+	{
+		std::vector<unsigned char> triAreas(numTris, RC_NULL_AREA);
+		rcMarkWalkableTriangles(&ctx, 40.0f, &verts[0], (int)verts.size() / 3, &tris[0], numTris, &triAreas[0]);
+		std::vector<unsigned char> cellAreas(cellCount, RC_NULL_AREA);
+		rcMarkWalkableHeightmapCells(&ctx, 40.0f, &heights[0], sampleWidth, sampleHeight, cs, &cellAreas[0]);
+
+		// A cell is walkable when both of its triangles are, the triangles get the area of their cell.
+		int t = 0;
+		int walkable = 0;
+		for (int i = 0; i < cellCount; ++i)
+		{
+			if (holes[i])
+				continue;
+			const bool both = triAreas[t] == RC_WALKABLE_AREA && triAreas[t + 1] == RC_WALKABLE_AREA;
+			REQUIRE((cellAreas[i] == RC_WALKABLE_AREA) == both);
+			walkable += both ? 1 : 0;
+			triAreas[t] = triAreas[t + 1] = cellAreas[i];
+			t += 2;
+		}
+		REQUIRE(walkable > 0);
+		REQUIRE(walkable < cellCount - 3);
+
+		rcHeightfield expected;
+		REQUIRE(rcCreateHeightfield(&ctx, expected, width, height, bmin, bmax, cs, 0.2f));
+		REQUIRE(rcRasterizeTriangles(&ctx, &verts[0], (int)verts.size() / 3, &tris[0], &triAreas[0], numTris, expected, 2));
+
+		rcHeightfield actual;
+		REQUIRE(rcCreateHeightfield(&ctx, actual, width, height, bmin, bmax, cs, 0.2f));
+		REQUIRE(rcRasterizeHeightmap(&ctx, &heights[0], &cellAreas[0], &holes[0], sampleWidth, sampleHeight,
+									 sampleX, sampleZ, actual, 2));
+
+		REQUIRE(rcGetHeightFieldSpanCount(&ctx, expected) > 0);
+		REQUIRE(rcCompareHeightfields(&ctx, expected, actual, 4) == 0);
+	}
+
+	SECTION("Cells are walkable without area ids")
+	{
+		rcHeightfield actual;
+		REQUIRE(rcCreateHeightfield(&ctx, actual, width, height, bmin, bmax, cs, 0.2f));
+		REQUIRE(rcRasterizeHeightmap(&ctx, &heights[0], 0, 0, sampleWidth, sampleHeight, sampleX, sampleZ, actual));
+
+		// The columns below the top of the heightfield have a single walkable span.
+		int covered = 0;
+		for (int i = 0; i < width * height; ++i)
+		{
+			if (!actual.spans[i])
+				continue;
+			REQUIRE(actual.spans[i]->area == RC_WALKABLE_AREA);
+			REQUIRE(actual.spans[i]->next == 0);
+			covered++;
+		}
+		REQUIRE(covered > width * height / 2);
+		REQUIRE(covered < width * height);
+	}
+}
+
+TEST_CASE("rcBuildPolyMesh vertex welding", "[recast]")
+{
+	rcContext ctx(false);
+
+	// A grid of square regions sharing their corners, with small height differences
+	// between the corners, and one more region above the first one.
+	const int n = 64;
+	rcContourSet cset;
+	cset.nconts = n * n + 1;
+	cset.conts = (rcContour*)rcAlloc(sizeof(rcContour) * cset.nconts, RC_ALLOC_PERM);
+	REQUIRE(cset.conts);
+	memset(cset.conts, 0, sizeof(rcContour) * cset.nconts);
+	const float bmin[3] = { 0.0f, 0.0f, 0.0f };
+	const float bmax[3] = { n * 1.2f, 10.0f, n * 1.2f };
+	rcVcopy(cset.bmin, bmin);
+	rcVcopy(cset.bmax, bmax);
+	cset.cs = 0.3f;
+	cset.ch = 0.2f;
+	cset.width = n * 4;
+	cset.height = n * 4;
+	const int corners[4][2] = { { 0, 0 }, { 0, 1 }, { 1, 1 }, { 1, 0 } };
+	for (int i = 0; i < cset.nconts; ++i)
+	{
+		const int cx = i < n * n ? i % n : 0;
+		const int cz = i < n * n ? i / n : 0;
+		rcContour& cont = cset.conts[i];
+		cont.nverts = 4;
+		cont.verts = (int*)rcAlloc(sizeof(int) * 4 * 4, RC_ALLOC_PERM);
+		REQUIRE(cont.verts);
+		cont.reg = (unsigned short)(i + 1);
+		cont.area = RC_WALKABLE_AREA;
+		for (int j = 0; j < 4; ++j)
+		{
+			const int x = cx + corners[j][0];
+			const int z = cz + corners[j][1];
+			cont.verts[j * 4 + 0] = x * 4;
+			cont.verts[j * 4 + 1] = i < n * n ? (x + z) % 3 : 20;
+			cont.verts[j * 4 + 2] = z * 4;
+			cont.verts[j * 4 + 3] = 0;
+		}
+	}
+
+	rcPolyMesh mesh;
+	REQUIRE(rcBuildPolyMesh(&ctx, cset, 6, mesh));
+	REQUIRE(mesh.npolys == n * n + 1);
+	REQUIRE(mesh.nverts == (n + 1) * (n + 1) + 4);
+
+	// The shared edges connect the grid, the region above is not connected.
+	int neighbourCount = 0;
+	for (int i = 0; i < mesh.npolys; ++i)
+	{
+		const unsigned short* p = &mesh.polys[i * mesh.nvp * 2];
+		for (int j = 0; j < mesh.nvp; ++j)
+		{
+			if (p[mesh.nvp + j] != RC_MESH_NULL_IDX)
+			{
+				REQUIRE(mesh.regs[i] <= n * n);
+				neighbourCount++;
+			}
+		}
+	}
+	REQUIRE(neighbourCount == 4 * n * (n - 1));
+}
+
+TEST_CASE("rcBuildPolyMesh border vertex removal", "[recast]")
+{
+	rcContext ctx(false);
+
+	// A grid of square regions with border vertices in the middle of their sides.
+	const int n = 32;
+	rcContourSet cset;
+	cset.nconts = n * n;
+	cset.conts = (rcContour*)rcAlloc(sizeof(rcContour) * cset.nconts, RC_ALLOC_PERM);
+	REQUIRE(cset.conts);
+	memset(cset.conts, 0, sizeof(rcContour) * cset.nconts);
+	const float bmin[3] = { 0.0f, 0.0f, 0.0f };
+	const float bmax[3] = { n * 1.2f, 10.0f, n * 1.2f };
+	rcVcopy(cset.bmin, bmin);
+	rcVcopy(cset.bmax, bmax);
+	cset.cs = 0.3f;
+	cset.ch = 0.2f;
+	cset.width = n * 4;
+	cset.height = n * 4;
+	const int points[8][2] = { { 0, 0 }, { 0, 2 }, { 0, 4 }, { 2, 4 }, { 4, 4 }, { 4, 2 }, { 4, 0 }, { 2, 0 } };
+	for (int i = 0; i < cset.nconts; ++i)
+	{
+		rcContour& cont = cset.conts[i];
+		cont.nverts = 8;
+		cont.verts = (int*)rcAlloc(sizeof(int) * 8 * 4, RC_ALLOC_PERM);
+		REQUIRE(cont.verts);
+		cont.reg = (unsigned short)(i + 1);
+		cont.area = RC_WALKABLE_AREA;
+		for (int j = 0; j < 8; ++j)
+		{
+			cont.verts[j * 4 + 0] = (i % n) * 4 + points[j][0];
+			cont.verts[j * 4 + 1] = 0;
+			cont.verts[j * 4 + 2] = (i / n) * 4 + points[j][1];
+			cont.verts[j * 4 + 3] = (j & 1) ? RC_BORDER_VERTEX : 0;
+		}
+	}
+
+	rcPolyMesh mesh;
+	REQUIRE(rcBuildPolyMesh(&ctx, cset, 6, mesh));
+
+	// The interior border vertices are gone, every vertex left is used and the area is kept.
+	REQUIRE(mesh.nverts < (n + 1) * (n + 1) + 4 * n);
+	std::vector<bool> used(mesh.nverts, false);
+	int area2 = 0;
+	for (int i = 0; i < mesh.npolys; ++i)
+	{
+		const unsigned short* p = &mesh.polys[i * mesh.nvp * 2];
+		int nv = 0;
+		while (nv < mesh.nvp && p[nv] != RC_MESH_NULL_IDX)
+			nv++;
+		REQUIRE(nv >= 3);
+		for (int j = 0, k = nv - 1; j < nv; k = j++)
+		{
+			REQUIRE(p[j] < mesh.nverts);
+			used[p[j]] = true;
+			const unsigned short* a = &mesh.verts[p[k] * 3];
+			const unsigned short* b = &mesh.verts[p[j] * 3];
+			area2 += (int)a[0] * (int)b[2] - (int)b[0] * (int)a[2];
+		}
+	}
+	for (int i = 0; i < mesh.nverts; ++i)
+		REQUIRE(used[i]);
+	REQUIRE(rcAbs(area2) == 2 * (n * 4) * (n * 4));
+}
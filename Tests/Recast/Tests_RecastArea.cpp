@@ -0,0 +1,286 @@
+#include <math.h>
+#include <string.h>
+
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "Recast.h"
+
+#include "TestRecastUtils.h"
+
+namespace
+{
+// Marks the spans of the cells whose centers are inside the polygon by testing every cell.
+void markConvexPolyAreaReference(const float* verts, const int numVerts, const float minY, const float maxY,
+								 const unsigned char areaId, rcCompactHeightfield& chf)
+{
+	float bmin[3], bmax[3];
+	rcVcopy(bmin, verts);
+	rcVcopy(bmax, verts);
+	for (int i = 1; i < numVerts; ++i)
+	{
+		rcVmin(bmin, &verts[i * 3]);
+		rcVmax(bmax, &verts[i * 3]);
+	}
+	const int minx = rcMax(0, (int)((bmin[0] - chf.bmin[0]) / chf.cs));
+	const int minz = rcMax(0, (int)((bmin[2] - chf.bmin[2]) / chf.cs));
+	const int maxx = rcMin(chf.width - 1, (int)((bmax[0] - chf.bmin[0]) / chf.cs));
+	const int maxz = rcMin(chf.height - 1, (int)((bmax[2] - chf.bmin[2]) / chf.cs));
+	const int miny = (int)((minY - chf.bmin[1]) / chf.ch);
+	const int maxy = (int)((maxY - chf.bmin[1]) / chf.ch);
+	for (int z = minz; z <= maxz; ++z)
+	{
+		for (int x = minx; x <= maxx; ++x)
+		{
+			const float px = chf.bmin[0] + ((float)x + 0.5f) * chf.cs;
+			const float pz = chf.bmin[2] + ((float)z + 0.5f) * chf.cs;
+			bool inside = false;
+			for (int i = 0, j = numVerts - 1; i < numVerts; j = i++)
+			{
+				const float* vi = &verts[i * 3];
+				const float* vj = &verts[j * 3];
+				if ((vi[2] > pz) != (vj[2] > pz) && px < (vj[0] - vi[0]) * (pz - vi[2]) / (vj[2] - vi[2]) + vi[0])
+					inside = !inside;
+			}
+			if (!inside)
+				continue;
+			const rcCompactCell& cell = chf.cells[x + z * chf.width];
+			for (int i = (int)cell.index, ni = (int)(cell.index + cell.count); i < ni; ++i)
+			{
+				if (chf.areas[i] != RC_NULL_AREA && (int)chf.spans[i].y >= miny && (int)chf.spans[i].y <= maxy)
+					chf.areas[i] = areaId;
+			}
+		}
+	}
+}
+
+// A bumpy ground with platforms above it, so that some columns have two spans.
+rcCompactHeightfield* buildLayeredField(rcContext& ctx)
+{
+	const int quads = 40;
+	const float size = 61.0f;
+	std::vector<float> verts;
+	std::vector<int> tris;
+	for (int z = 0; z <= quads; ++z)
+	{
+		for (int x = 0; x <= quads; ++x)
+		{
+			const unsigned int h = ((unsigned int)x * 73856093u) ^ ((unsigned int)z * 19349663u);
+			verts.push_back(x * size / quads);
+			verts.push_back((h % 7) == 0 ? 1.0f : (h % 100) / 100.0f * 0.3f);
+			verts.push_back(z * size / quads);
+		}
+	}
+	for (int z = 0; z < quads; ++z)
+	{
+		for (int x = 0; x < quads; ++x)
+		{
+			const int i = x + z * (quads + 1);
+			tris.push_back(i); tris.push_back(i + quads + 1); tris.push_back(i + 1);
+			tris.push_back(i + 1); tris.push_back(i + quads + 1); tris.push_back(i + quads + 2);
+		}
+	}
+	for (int i = 0; i < 12; ++i)
+	{
+		const float x0 = 3.0f + (i % 4) * 14.0f + (i % 3);
+		const float z0 = 4.0f + (i / 4) * 18.0f;
+		const float x1 = x0 + 6.0f + (i % 5), z1 = z0 + 5.0f + (i % 2) * 3.0f;
+		const float y = 3.0f + (i % 3) * 0.2f;
+		const int base = (int)verts.size() / 3;
+		const float quad[] = { x0, y, z0, x0, y, z1, x1, y, z1, x1, y, z0 };
+		verts.insert(verts.end(), quad, quad + 12);
+		tris.push_back(base); tris.push_back(base + 1); tris.push_back(base + 2);
+		tris.push_back(base); tris.push_back(base + 2); tris.push_back(base + 3);
+	}
+	const int nverts = (int)verts.size() / 3;
+	const int ntris = (int)tris.size() / 3;
+
+	const float bmin[3] = { 0, -1, 0 };
+	const float bmax[3] = { size, 5, size };
+	int width, height;
+	rcCalcGridSize(bmin, bmax, 0.3f, &width, &height);
+	rcHeightfield* solid = rcAllocHeightfield();
+	REQUIRE(rcCreateHeightfield(&ctx, *solid, width, height, bmin, bmax, 0.3f, 0.2f));
+	std::vector<unsigned char> areas(ntris, 0);
+	rcMarkWalkableTriangles(&ctx, 45.0f, &verts[0], nverts, &tris[0], ntris, &areas[0]);
+	REQUIRE(rcRasterizeTriangles(&ctx, &verts[0], nverts, &tris[0], &areas[0], ntris, *solid, 2));
+
+	rcCompactHeightfield* chf = rcAllocCompactHeightfield();
+	REQUIRE(rcBuildCompactHeightfield(&ctx, 10, 2, *solid, *chf));
+	rcFreeHeightField(solid);
+
+	// Random walkable areas, with a few removed spans.
+	unsigned int seed = 777;
+	for (int i = 0; i < chf->spanCount; ++i)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		const unsigned int r = (seed >> 16) % 100;
+		if (chf->areas[i] != RC_NULL_AREA)
+			chf->areas[i] = r < 3 ? RC_NULL_AREA : (unsigned char)(r < 60 ? RC_WALKABLE_AREA : 1 + r % 5);
+	}
+	return chf;
+}
+
+struct Volumes
+{
+	std::vector<float> verts;
+	std::vector<rcConvexVolume> volumes;
+};
+
+// Regular polygons of random sizes, plus squares whose edges lie on cell centers.
+void makeVolumes(const rcCompactHeightfield& chf, const int count, Volumes& out)
+{
+	const float size = chf.width * chf.cs;
+	unsigned int seed = 12345;
+	std::vector<int> numVerts;
+	for (int i = 0; i < count; ++i)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		const int nverts = 3 + (int)((seed >> 16) % 10);
+		const float cx = (float)((seed >> 8) % 1000) / 1000.0f * size;
+		seed = seed * 1664525u + 1013904223u;
+		const float cz = (float)((seed >> 8) % 1000) / 1000.0f * size;
+		const float r = 0.5f + (float)((seed >> 20) % 100) / 100.0f * 6.0f;
+		const float rot = (float)(seed % 628) / 100.0f;
+		if (i % 5 == 4)
+		{
+			// Edges through the cell centers.
+			const float x0 = chf.bmin[0] + ((int)(cx / chf.cs) + 0.5f) * chf.cs;
+			const float z0 = chf.bmin[2] + ((int)(cz / chf.cs) + 0.5f) * chf.cs;
+			const float d = (float)(int)(r / chf.cs) * chf.cs;
+			const float square[] = { x0, 0, z0, x0, 0, z0 + d, x0 + d, 0, z0 + d, x0 + d, 0, z0 };
+			out.verts.insert(out.verts.end(), square, square + 12);
+			numVerts.push_back(4);
+			continue;
+		}
+		for (int j = 0; j < nverts; ++j)
+		{
+			const float a = rot - j * 2.0f * RC_PI / nverts;
+			out.verts.push_back(cx + cosf(a) * r);
+			out.verts.push_back(0);
+			out.verts.push_back(cz + sinf(a) * r);
+		}
+		numVerts.push_back(nverts);
+	}
+	int base = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		rcConvexVolume volume;
+		volume.verts = &out.verts[base * 3];
+		volume.numVerts = numVerts[i];
+		volume.minY = (i % 3) == 0 ? 1.0f : -1.0f;
+		volume.maxY = (i % 7) == 0 ? 0.2f : 3.0f;
+		volume.areaId = (unsigned char)(1 + i % 50);
+		out.volumes.push_back(volume);
+		base += numVerts[i];
+	}
+}
+}
+
+TEST_CASE("rcMarkConvexPolyArea", "[recast]")
+{
+	rcContext ctx(false);
+	rcCompactHeightfield* chf = TestRecast::buildTerrain(ctx);
+	const std::vector<unsigned char> original(chf->areas, chf->areas + chf->spanCount);
+
+	Volumes volumes;
+	makeVolumes(*chf, 500, volumes);
+
+	std::vector<unsigned char> expected;
+	for (size_t i = 0; i < volumes.volumes.size(); ++i)
+	{
+		const rcConvexVolume& v = volumes.volumes[i];
+		markConvexPolyAreaReference(v.verts, v.numVerts, v.minY, v.maxY, v.areaId, *chf);
+	}
+	expected.assign(chf->areas, chf->areas + chf->spanCount);
+	REQUIRE(expected != original);
+
+	SECTION("One call per volume")
+	{
+		memcpy(chf->areas, &original[0], chf->spanCount);
+		for (size_t i = 0; i < volumes.volumes.size(); ++i)
+		{
+			const rcConvexVolume& v = volumes.volumes[i];
+			rcMarkConvexPolyArea(&ctx, v.verts, v.numVerts, v.minY, v.maxY, v.areaId, *chf);
+		}
+		REQUIRE(memcmp(chf->areas, &expected[0], chf->spanCount) == 0);
+	}
+
+	SECTION("All volumes in one sweep")
+	{
+		memcpy(chf->areas, &original[0], chf->spanCount);
+		REQUIRE(rcMarkConvexPolyAreas(&ctx, &volumes.volumes[0], (int)volumes.volumes.size(), *chf));
+		REQUIRE(memcmp(chf->areas, &expected[0], chf->spanCount) == 0);
+	}
+
+	SECTION("Volumes outside the heightfield")
+	{
+		const float outside[] = { -10, 0, -10, -10, 0, -5, -5, 0, -5 };
+		rcConvexVolume v = { outside, 3, -1.0f, 3.0f, 7 };
+		memcpy(chf->areas, &original[0], chf->spanCount);
+		REQUIRE(rcMarkConvexPolyAreas(&ctx, &v, 1, *chf));
+		REQUIRE(rcMarkConvexPolyAreas(&ctx, 0, 0, *chf));
+		REQUIRE(memcmp(chf->areas, &original[0], chf->spanCount) == 0);
+	}
+
+	rcFreeCompactHeightfield(chf);
+}
+
+TEST_CASE("rcErodeWalkableArea and rcMedianFilterWalkableArea SIMD", "[recast]")
+{
+	if (!rcGetSimdAreaFilters())
+	{
+		SKIP("The SIMD area filters are not available.");
+	}
+
+	rcContext ctx(false);
+	rcCompactHeightfield* chf = buildLayeredField(ctx);
+	int multiSpanColumns = 0;
+	for (int i = 0; i < chf->width * chf->height; ++i)
+		multiSpanColumns += chf->cells[i].count > 1 ? 1 : 0;
+	REQUIRE(multiSpanColumns > 100);
+	REQUIRE(chf->width % 16 != 0);
+	const std::vector<unsigned char> original(chf->areas, chf->areas + chf->spanCount);
+
+	std::vector<unsigned char> scalar;
+	std::vector<unsigned char> simd;
+
+	SECTION("Erosion")
+	{
+		for (int radius = 1; radius <= 5; ++radius)
+		{
+			REQUIRE(rcSetSimdAreaFilters(false));
+			memcpy(chf->areas, &original[0], chf->spanCount);
+			REQUIRE(rcErodeWalkableArea(&ctx, radius, *chf));
+			scalar.assign(chf->areas, chf->areas + chf->spanCount);
+
+			REQUIRE(rcSetSimdAreaFilters(true));
+			memcpy(chf->areas, &original[0], chf->spanCount);
+			REQUIRE(rcErodeWalkableArea(&ctx, radius, *chf));
+			simd.assign(chf->areas, chf->areas + chf->spanCount);
+
+			REQUIRE(scalar != original);
+			REQUIRE(simd == scalar);
+		}
+	}
+
+	SECTION("Median filter")
+	{
+		REQUIRE(rcSetSimdAreaFilters(false));
+		memcpy(chf->areas, &original[0], chf->spanCount);
+		REQUIRE(rcMedianFilterWalkableArea(&ctx, *chf));
+		scalar.assign(chf->areas, chf->areas + chf->spanCount);
+
+		REQUIRE(rcSetSimdAreaFilters(true));
+		memcpy(chf->areas, &original[0], chf->spanCount);
+		REQUIRE(rcMedianFilterWalkableArea(&ctx, *chf));
+		simd.assign(chf->areas, chf->areas + chf->spanCount);
+
+		REQUIRE(scalar != original);
+		REQUIRE(simd == scalar);
+	}
+
+	rcSetSimdAreaFilters(true);
+	rcFreeCompactHeightfield(chf);
+}
@@ -0,0 +1,278 @@
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "Recast.h"
+#include "RecastChunkedMesh.h"
+
+namespace
+{
+struct MemoryOutput : public rcChunkedMeshOutput
+{
+	std::vector<unsigned char> data;
+
+	bool write(const void* src, const int size) override
+	{
+		data.insert(data.end(), (const unsigned char*)src, (const unsigned char*)src + size);
+		return true;
+	}
+};
+
+struct MemoryInput : public rcChunkedMeshInput
+{
+	const std::vector<unsigned char>& data;
+	int reads;
+
+	explicit MemoryInput(const std::vector<unsigned char>& d) : data(d), reads(0) {}
+
+	bool read(void* dst, const uint64_t offset, const int size) override
+	{
+		if (offset + size > data.size())
+			return false;
+		memcpy(dst, &data[(size_t)offset], size);
+		reads++;
+		return true;
+	}
+
+	uint64_t getSize() override { return data.size(); }
+};
+
+// A bumpy terrain with a few steep triangles, a large ramp spanning many cells and triangles outside the grid.
+struct TestMesh
+{
+	std::vector<float> verts;
+	std::vector<int> tris;
+
+	TestMesh()
+	{
+		const int quads = 30;
+		const float size = 60.0f;
+		for (int z = 0; z <= quads; ++z)
+		{
+			for (int x = 0; x <= quads; ++x)
+			{
+				const unsigned int h = ((unsigned int)x * 73856093u) ^ ((unsigned int)z * 19349663u);
+				verts.push_back(x * size / quads);
+				verts.push_back((h % 9) == 0 ? 3.0f : (h % 100) / 100.0f * 0.3f);
+				verts.push_back(z * size / quads);
+			}
+		}
+		for (int z = 0; z < quads; ++z)
+		{
+			for (int x = 0; x < quads; ++x)
+			{
+				const int i = x + z * (quads + 1);
+				addTri(i, i + quads + 1, i + 1);
+				addTri(i + 1, i + quads + 1, i + quads + 2);
+			}
+		}
+		addVertTri(5, 2, 5, 55, 2, 12, 55, 4, 5);
+		addVertTri(-10, 1, -10, -10, 1, 70, -5, 1, -10);
+		addVertTri(70, 1, 70, 75, 1, 80, 80, 1, 70);
+	}
+
+	void addTri(const int a, const int b, const int c)
+	{
+		tris.push_back(a);
+		tris.push_back(b);
+		tris.push_back(c);
+	}
+
+	void addVertTri(float ax, float ay, float az, float bx, float by, float bz, float cx, float cy, float cz)
+	{
+		const int first = getVertCount();
+		const float v[9] = { ax, ay, az, bx, by, bz, cx, cy, cz };
+		verts.insert(verts.end(), v, v + 9);
+		addTri(first, first + 1, first + 2);
+	}
+
+	int getVertCount() const { return (int)verts.size() / 3; }
+	int getTriCount() const { return (int)tris.size() / 3; }
+};
+
+void writeMesh(const TestMesh& mesh, const float cellSize, const int maxBuffered, std::vector<unsigned char>& data)
+{
+	rcContext ctx(false);
+	const float bmin[3] = { 0, 0, 0 };
+	const float bmax[3] = { 60, 5, 60 };
+	MemoryOutput out;
+	rcChunkedMeshWriter writer;
+	REQUIRE(writer.init(&ctx, bmin, bmax, cellSize, maxBuffered, &out));
+	// Two batches, with the vertices of the second one relative to its own vertex array.
+	const int half = mesh.getTriCount() / 2;
+	REQUIRE(writer.addTriangles(&ctx, &mesh.verts[0], mesh.getVertCount(), &mesh.tris[0], 0, half));
+	REQUIRE(writer.addTriangles(&ctx, &mesh.verts[0], mesh.getVertCount(), &mesh.tris[half * 3], 0,
+								mesh.getTriCount() - half));
+	REQUIRE(writer.finish(&ctx));
+	data.swap(out.data);
+}
+
+std::vector<std::vector<float> > sortedTris(const float* verts, const int ntris)
+{
+	std::vector<std::vector<float> > result;
+	for (int i = 0; i < ntris; ++i)
+		result.push_back(std::vector<float>(verts + i * 9, verts + i * 9 + 9));
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+bool sameSpans(const rcHeightfield& a, const rcHeightfield& b)
+{
+	for (int i = 0; i < a.width * a.height; ++i)
+	{
+		const rcSpan* sa = a.spans[i];
+		const rcSpan* sb = b.spans[i];
+		for (; sa && sb; sa = sa->next, sb = sb->next)
+		{
+			if (sa->smin != sb->smin || sa->smax != sb->smax || sa->area != sb->area)
+				return false;
+		}
+		if (sa || sb)
+			return false;
+	}
+	return true;
+}
+} // anonymous namespace
+
+TEST_CASE("rcChunkedMesh", "[recast, chunkedmesh]")
+{
+	rcContext ctx(false);
+	const TestMesh mesh;
+	const int maxBuffered = GENERATE(40, 1000000);
+
+	std::vector<unsigned char> data;
+	writeMesh(mesh, 8.0f, maxBuffered, data);
+
+	MemoryInput in(data);
+	rcChunkedMesh chunked;
+	REQUIRE(chunked.init(&ctx, &in));
+	REQUIRE(chunked.getHeader().width == 8);
+	REQUIRE(chunked.getHeader().height == 8);
+	REQUIRE(chunked.getHeader().bmin[0] == -10.0f);
+	REQUIRE(chunked.getHeader().bmax[2] == 80.0f);
+
+	SECTION("Every overlapping triangle is read once")
+	{
+		const float rects[][6] = {
+			{ 10, 0, 10, 20, 0, 20 },
+			{ 0, 0, 0, 60, 0, 60 },
+			{ -100, 0, -100, 200, 0, 200 },
+			{ 30.5f, 0, 7, 30.7f, 0, 9 },
+			{ 72, 0, 72, 73, 0, 73 },
+			{ 100, 0, 100, 110, 0, 110 },
+		};
+		for (int r = 0; r < 6; ++r)
+		{
+			const float* bmin = &rects[r][0];
+			const float* bmax = &rects[r][3];
+
+			std::vector<float> expected;
+			for (int i = 0; i < mesh.getTriCount(); ++i)
+			{
+				float tmin[3], tmax[3];
+				const int* t = &mesh.tris[i * 3];
+				rcVcopy(tmin, &mesh.verts[t[0] * 3]);
+				rcVcopy(tmax, &mesh.verts[t[0] * 3]);
+				for (int j = 1; j < 3; ++j)
+				{
+					rcVmin(tmin, &mesh.verts[t[j] * 3]);
+					rcVmax(tmax, &mesh.verts[t[j] * 3]);
+				}
+				if (tmin[0] <= bmax[0] && tmax[0] >= bmin[0] && tmin[2] <= bmax[2] && tmax[2] >= bmin[2])
+				{
+					for (int j = 0; j < 3; ++j)
+						expected.insert(expected.end(), &mesh.verts[t[j] * 3], &mesh.verts[t[j] * 3] + 3);
+				}
+			}
+
+			const int maxTris = chunked.getMaxTriangleCount(bmin, bmax);
+			std::vector<float> verts(maxTris * 9 + 9);
+			std::vector<unsigned char> areas(maxTris + 1);
+			int ntris = -1;
+			REQUIRE(chunked.readTriangles(&ctx, bmin, bmax, &verts[0], &areas[0], maxTris, &ntris));
+			REQUIRE(ntris == (int)expected.size() / 9);
+			REQUIRE(sortedTris(&verts[0], ntris) == sortedTris(expected.empty() ? 0 : &expected[0], ntris));
+			for (int i = 0; i < ntris; ++i)
+				REQUIRE(areas[i] == RC_WALKABLE_AREA);
+
+			// A buffer that is too small fails.
+			if (ntris > 0)
+				REQUIRE_FALSE(chunked.readTriangles(&ctx, bmin, bmax, &verts[0], &areas[0], ntris - 1, &ntris));
+		}
+	}
+
+	SECTION("Rasterizing a tile matches rasterizing the whole mesh")
+	{
+		rcConfig cfg;
+		memset(&cfg, 0, sizeof(cfg));
+		cfg.walkableSlopeAngle = 45.0f;
+		cfg.walkableClimb = 2;
+		const float cs = 0.3f;
+		const float ch = 0.2f;
+		const float tiles[][6] = {
+			{ 0, -1, 0, 15, 6, 15 },
+			{ 22.4f, -1, 3.1f, 41, 6, 20.5f },
+			{ 40, -1, 40, 60, 6, 60 },
+		};
+		for (int t = 0; t < 3; ++t)
+		{
+			int width, height;
+			rcCalcGridSize(&tiles[t][0], &tiles[t][3], cs, &width, &height);
+
+			rcHeightfield* expected = rcAllocHeightfield();
+			rcHeightfield* actual = rcAllocHeightfield();
+			REQUIRE(rcCreateHeightfield(&ctx, *expected, width, height, &tiles[t][0], &tiles[t][3], cs, ch));
+			REQUIRE(rcCreateHeightfield(&ctx, *actual, width, height, &tiles[t][0], &tiles[t][3], cs, ch));
+
+			std::vector<unsigned char> areas(mesh.getTriCount(), 0);
+			rcMarkWalkableTriangles(&ctx, cfg.walkableSlopeAngle, &mesh.verts[0], mesh.getVertCount(), &mesh.tris[0],
+									mesh.getTriCount(), &areas[0]);
+			REQUIRE(rcRasterizeTriangles(&ctx, &mesh.verts[0], mesh.getVertCount(), &mesh.tris[0], &areas[0],
+										 mesh.getTriCount(), *expected, cfg.walkableClimb));
+			REQUIRE(rcRasterizeChunkedMeshTile(&ctx, chunked, cfg, *actual));
+			REQUIRE(sameSpans(*expected, *actual));
+
+			rcFreeHeightField(expected);
+			rcFreeHeightField(actual);
+		}
+	}
+}
+
+TEST_CASE("rcChunkedMesh with invalid input", "[recast, chunkedmesh]")
+{
+	rcContext ctx(false);
+	const TestMesh mesh;
+	std::vector<unsigned char> data;
+	writeMesh(mesh, 8.0f, 1000, data);
+
+	SECTION("Truncated data")
+	{
+		std::vector<unsigned char> truncated(data.begin() + 1, data.end());
+		MemoryInput in(truncated);
+		rcChunkedMesh chunked;
+		REQUIRE_FALSE(chunked.init(&ctx, &in));
+		REQUIRE(chunked.getMaxTriangleCount(&mesh.verts[0], &mesh.verts[0]) == 0);
+	}
+
+	SECTION("Wrong magic number")
+	{
+		data[data.size() - sizeof(rcChunkedMeshHeader)] ^= 1;
+		MemoryInput in(data);
+		rcChunkedMesh chunked;
+		REQUIRE_FALSE(chunked.init(&ctx, &in));
+	}
+
+	SECTION("Invalid vertex indices are rejected")
+	{
+		const float bmin[3] = { 0, 0, 0 };
+		const float bmax[3] = { 60, 5, 60 };
+		const int tris[3] = { 0, 1, mesh.getVertCount() };
+		MemoryOutput out;
+		rcChunkedMeshWriter writer;
+		REQUIRE(writer.init(&ctx, bmin, bmax, 8.0f, 1000, &out));
+		REQUIRE_FALSE(writer.addTriangles(&ctx, &mesh.verts[0], mesh.getVertCount(), tris, 0, 1));
+		REQUIRE_FALSE(writer.init(&ctx, bmin, bmax, 0.0f, 1000, &out));
+	}
+}
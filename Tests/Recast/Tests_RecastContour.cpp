@@ -0,0 +1,163 @@
+#include <float.h>
+#include <string.h>
+
+#include "catch2/catch_all.hpp"
+
+#include "Recast.h"
+#include "RecastAlloc.h"
+
+#include "TestRecastUtils.h"
+
+namespace
+{
+// Returns true if both contour sets have the same contours in the same order.
+bool sameContours(const rcContourSet& a, const rcContourSet& b)
+{
+	if (a.nconts != b.nconts)
+		return false;
+	for (int i = 0; i < a.nconts; ++i)
+	{
+		const rcContour& ca = a.conts[i];
+		const rcContour& cb = b.conts[i];
+		if (ca.nverts != cb.nverts || ca.nrverts != cb.nrverts || ca.reg != cb.reg || ca.area != cb.area)
+			return false;
+		if (memcmp(ca.verts, cb.verts, sizeof(int) * ca.nverts * 4) != 0 ||
+			memcmp(ca.rverts, cb.rverts, sizeof(int) * ca.nrverts * 4) != 0)
+			return false;
+	}
+	return true;
+}
+
+// The squared distance from the point to the segment on the xz-plane.
+float distancePtSegSqr(const int* p, const int* a, const int* b)
+{
+	const float abx = (float)(b[0] - a[0]), abz = (float)(b[2] - a[2]);
+	const float d = abx * abx + abz * abz;
+	float t = d > 0 ? (abx * (p[0] - a[0]) + abz * (p[2] - a[2])) / d : 0.0f;
+	t = t < 0 ? 0 : (t > 1 ? 1 : t);
+	const float dx = a[0] + t * abx - p[0], dz = a[2] + t * abz - p[2];
+	return dx * dx + dz * dz;
+}
+}
+
+TEST_CASE("rcBuildContours simplification", "[recast]")
+{
+	rcContext ctx(false);
+	rcCompactHeightfield* chf = TestRecast::buildTerrain(ctx);
+	REQUIRE(rcBuildDistanceField(&ctx, *chf));
+	REQUIRE(rcBuildRegions(&ctx, *chf, 0, 8, 20));
+
+	const float maxErrors[] = { 0.0f, 1.3f, 4.0f };
+	for (const float maxError : maxErrors)
+	{
+		const int maxEdgeLen = 6;
+		rcContourSet* cset = rcAllocContourSet();
+		REQUIRE(rcBuildContours(&ctx, *chf, maxError, maxEdgeLen, *cset, RC_CONTOUR_TESS_WALL_EDGES));
+		REQUIRE(cset->nconts > 10);
+		for (int i = 0; i < cset->nconts; ++i)
+		{
+			const rcContour& c = cset->conts[i];
+			REQUIRE(c.nverts <= c.nrverts);
+			for (int j = 0; j < c.nverts; ++j)
+			{
+				// The wall edges are split until they are short enough.
+				const int* a = &c.verts[j * 4];
+				const int* b = &c.verts[((j + 1) % c.nverts) * 4];
+				if ((a[3] & RC_CONTOUR_REG_MASK) == 0)
+				{
+					const int dx = b[0] - a[0], dz = b[2] - a[2];
+					REQUIRE(dx * dx + dz * dz <= maxEdgeLen * maxEdgeLen);
+				}
+			}
+			// The raw vertices of the walls are within the error tolerance of the simplified contour.
+			for (int j = 0; j < c.nrverts; ++j)
+			{
+				const int* r = &c.rverts[j * 4];
+				if ((r[3] & RC_CONTOUR_REG_MASK) != 0)
+					continue;
+				float mind = FLT_MAX;
+				for (int k = 0; k < c.nverts; ++k)
+					mind = rcMin(mind, distancePtSegSqr(r, &c.verts[k * 4], &c.verts[((k + 1) % c.nverts) * 4]));
+				REQUIRE(mind <= maxError * maxError + 1e-3f);
+			}
+		}
+		rcFreeContourSet(cset);
+	}
+	rcFreeCompactHeightfield(chf);
+}
+
+TEST_CASE("rcBuildContours with a job dispatcher", "[recast]")
+{
+	rcContext ctx(false);
+	rcCompactHeightfield* chf = TestRecast::buildTerrain(ctx);
+	REQUIRE(rcBuildDistanceField(&ctx, *chf));
+	REQUIRE(rcBuildRegions(&ctx, *chf, 0, 8, 20));
+
+	rcContourSet* serial = rcAllocContourSet();
+	REQUIRE(rcBuildContours(&ctx, *chf, 1.3f, 40, *serial));
+	REQUIRE(serial->nconts > 10);
+
+	SECTION("Threads")
+	{
+		TestRecast::ThreadDispatcher dispatcher(4);
+		rcContext contexts[4] = { rcContext(false), rcContext(false), rcContext(false), rcContext(false) };
+		rcContext* workerContexts[4] = { &contexts[0], &contexts[1], &contexts[2], &contexts[3] };
+
+		rcContourSet* parallel = rcAllocContourSet();
+		REQUIRE(rcBuildContours(&ctx, *chf, 1.3f, 40, *parallel, RC_CONTOUR_TESS_WALL_EDGES, &dispatcher, workerContexts));
+		REQUIRE(sameContours(*parallel, *serial));
+
+		// Rebuilding reuses the contour array of the previous build.
+		REQUIRE(rcBuildContours(&ctx, *chf, 1.3f, 40, *parallel, RC_CONTOUR_TESS_WALL_EDGES, &dispatcher, workerContexts));
+		REQUIRE(sameContours(*parallel, *serial));
+		rcFreeContourSet(parallel);
+	}
+
+	SECTION("Threads with a temporary memory arena")
+	{
+		// The scratch buffers are grown by the workers and freed by the calling thread.
+		rcTempArena arena;
+		REQUIRE(arena.init(4096));
+		rcTempArenaScope scope(&arena);
+		TestRecast::ThreadDispatcher dispatcher(4);
+
+		rcContourSet* parallel = rcAllocContourSet();
+		REQUIRE(rcBuildContours(&ctx, *chf, 1.3f, 40, *parallel, RC_CONTOUR_TESS_WALL_EDGES, &dispatcher, 0));
+		REQUIRE(arena.getPeakSize() > 0);
+		REQUIRE(sameContours(*parallel, *serial));
+		rcFreeContourSet(parallel);
+	}
+
+	SECTION("Threads with a bound allocator")
+	{
+		TestRecast::CountingAllocator allocator;
+		{
+			rcAllocatorScope scope(&allocator);
+			TestRecast::ThreadDispatcher dispatcher(4);
+
+			rcContourSet* parallel = rcAllocContourSet();
+			REQUIRE(rcBuildContours(&ctx, *chf, 1.3f, 40, *parallel, RC_CONTOUR_TESS_WALL_EDGES, &dispatcher, 0));
+			REQUIRE(sameContours(*parallel, *serial));
+			rcFreeContourSet(parallel);
+		}
+		REQUIRE(allocator.allocs > 0);
+		REQUIRE(allocator.live == 0);
+		REQUIRE(allocator.foreign == 0);
+	}
+
+	SECTION("Serial dispatcher")
+	{
+		rcJobDispatcher dispatcher;
+		rcContourSet* parallel = rcAllocContourSet();
+		REQUIRE(rcBuildContours(&ctx, *chf, 1.3f, 40, *parallel, RC_CONTOUR_TESS_WALL_EDGES | RC_CONTOUR_TESS_AREA_EDGES,
+								&dispatcher, 0));
+		rcContourSet* expected = rcAllocContourSet();
+		REQUIRE(rcBuildContours(&ctx, *chf, 1.3f, 40, *expected, RC_CONTOUR_TESS_WALL_EDGES | RC_CONTOUR_TESS_AREA_EDGES));
+		REQUIRE(sameContours(*parallel, *expected));
+		rcFreeContourSet(expected);
+		rcFreeContourSet(parallel);
+	}
+
+	rcFreeContourSet(serial);
+	rcFreeCompactHeightfield(chf);
+}
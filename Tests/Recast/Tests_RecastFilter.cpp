@@ -336,4 +336,74 @@ TEST_CASE("rcFilterWalkableLowHeightSpans", "[recast, filtering]")
 		rcFree(overheadSpan);
 		rcFree(span);
 	}
-}
\ No newline at end of file
+}
+
+// Fills the heightfield with random stacks of spans, so that the filters see ledges, steps and low ceilings.
+static void addRandomSpans(rcContext* context, rcHeightfield& heightfield, unsigned int seed)
+{
+	for (int z = 0; z < heightfield.height; ++z)
+	{
+		for (int x = 0; x < heightfield.width; ++x)
+		{
+			int top = 0;
+			seed = seed * 1103515245u + 12345u;
+			const int count = (int)(seed >> 16) % 4;
+			for (int i = 0; i < count; ++i)
+			{
+				seed = seed * 1103515245u + 12345u;
+				const int smin = top + (int)(seed >> 16) % 12;
+				seed = seed * 1103515245u + 12345u;
+				const int smax = smin + 1 + (int)(seed >> 16) % 6;
+				seed = seed * 1103515245u + 12345u;
+				const unsigned char area = (seed >> 16) % 3 == 0 ? RC_NULL_AREA : (unsigned char)(1 + (seed >> 20) % 2);
+				REQUIRE(rcAddSpan(context, heightfield, x, z, (unsigned short)smin, (unsigned short)smax, area, 1));
+				top = smax + 1;
+			}
+		}
+	}
+}
+
+TEST_CASE("rcBuildFilteredCompactHeightfield", "[recast, filtering]")
+{
+	rcContext context;
+	const int walkableHeight = 4;
+	const int walkableClimb = 2;
+	const float bmin[3] = { 0.0f, 0.0f, 0.0f };
+	const float bmax[3] = { 32.0f, 64.0f, 32.0f };
+
+	SECTION("Matches the separate filters followed by rcBuildCompactHeightfield")
+	{
+		for (int filterFlags = 0; filterFlags < 8; ++filterFlags)
+		{
+			rcHeightfield separate;
+			rcHeightfield fused;
+			REQUIRE(rcCreateHeightfield(&context, separate, 32, 32, bmin, bmax, 1.0f, 1.0f));
+			REQUIRE(rcCreateHeightfield(&context, fused, 32, 32, bmin, bmax, 1.0f, 1.0f));
+			addRandomSpans(&context, separate, 1234u + filterFlags);
+			addRandomSpans(&context, fused, 1234u + filterFlags);
+
+			if (filterFlags & RC_FILTER_LOW_HANGING_OBSTACLES)
+				rcFilterLowHangingWalkableObstacles(&context, walkableClimb, separate);
+			if (filterFlags & RC_FILTER_LEDGE_SPANS)
+				rcFilterLedgeSpans(&context, walkableHeight, walkableClimb, separate);
+			if (filterFlags & RC_FILTER_WALKABLE_LOW_HEIGHT)
+				rcFilterWalkableLowHeightSpans(&context, walkableHeight, separate);
+
+			rcCompactHeightfield expected;
+			rcCompactHeightfield actual;
+			REQUIRE(rcBuildCompactHeightfield(&context, walkableHeight, walkableClimb, separate, expected));
+			REQUIRE(rcBuildFilteredCompactHeightfield(&context, filterFlags, walkableHeight, walkableClimb, fused, actual));
+
+			REQUIRE(actual.spanCount == expected.spanCount);
+			REQUIRE(actual.width * actual.height == expected.width * expected.height);
+			REQUIRE(memcmp(actual.cells, expected.cells, sizeof(rcCompactCell) * expected.width * expected.height) == 0);
+			REQUIRE(memcmp(actual.areas, expected.areas, expected.spanCount) == 0);
+			for (int i = 0; i < expected.spanCount; ++i)
+			{
+				REQUIRE(actual.spans[i].y == expected.spans[i].y);
+				REQUIRE(actual.spans[i].h == expected.spans[i].h);
+				REQUIRE(actual.spans[i].con == expected.spans[i].con);
+			}
+		}
+	}
+}
@@ -0,0 +1,281 @@
+#include <math.h>
+#include <string.h>
+
+#include "catch2/catch_all.hpp"
+
+#include "Recast.h"
+#include "RecastAlloc.h"
+
+#include "TestRecastUtils.h"
+
+namespace
+{
+// Returns true if d is clearly inside the circumcircle of the triangle a,b,c on the xz-plane.
+bool insideCircumCircle(const float* a, const float* b, const float* c, const float* d)
+{
+	const float bx = b[0] - a[0], bz = b[2] - a[2];
+	const float cx = c[0] - a[0], cz = c[2] - a[2];
+	const float den = 2.0f * (bx * cz - bz * cx);
+	if (fabsf(den) < 1e-6f)
+		return false;
+	const float ux = (cz * (bx * bx + bz * bz) - bz * (cx * cx + cz * cz)) / den;
+	const float uz = (bx * (cx * cx + cz * cz) - cx * (bx * bx + bz * bz)) / den;
+	const float r = sqrtf(ux * ux + uz * uz);
+	const float dx = d[0] - a[0] - ux, dz = d[2] - a[2] - uz;
+	return sqrtf(dx * dx + dz * dz) < r * (1.0f - 1e-3f);
+}
+
+float triArea(const float* a, const float* b, const float* c)
+{
+	return (b[0] - a[0]) * (c[2] - a[2]) - (b[2] - a[2]) * (c[0] - a[0]);
+}
+} // anonymous namespace
+
+TEST_CASE("rcBuildPolyMeshDetail with a job dispatcher", "[recast]")
+{
+	rcContext ctx(false);
+	rcCompactHeightfield* chf = TestRecast::buildTerrain(ctx);
+	REQUIRE(rcBuildDistanceField(&ctx, *chf));
+	REQUIRE(rcBuildRegions(&ctx, *chf, 0, 8, 20));
+
+	rcContourSet* cset = rcAllocContourSet();
+	REQUIRE(rcBuildContours(&ctx, *chf, 1.3f, 40, *cset));
+	rcPolyMesh* pmesh = rcAllocPolyMesh();
+	REQUIRE(rcBuildPolyMesh(&ctx, *cset, 6, *pmesh));
+	REQUIRE(pmesh->npolys > 10);
+
+	const float sampleDist = 6.0f * chf->cs;
+	const float sampleMaxError = 1.0f * chf->ch;
+
+	rcPolyMeshDetail* serial = rcAllocPolyMeshDetail();
+	REQUIRE(rcBuildPolyMeshDetail(&ctx, *pmesh, *chf, sampleDist, sampleMaxError, *serial));
+	REQUIRE(serial->ntris > pmesh->npolys);
+
+	SECTION("Threads")
+	{
+		TestRecast::ThreadDispatcher dispatcher(4);
+		rcContext contexts[4] = { rcContext(false), rcContext(false), rcContext(false), rcContext(false) };
+		rcContext* workerContexts[4] = { &contexts[0], &contexts[1], &contexts[2], &contexts[3] };
+
+		rcPolyMeshDetail* parallel = rcAllocPolyMeshDetail();
+		REQUIRE(rcBuildPolyMeshDetail(&ctx, *pmesh, *chf, sampleDist, sampleMaxError, *parallel, &dispatcher, workerContexts));
+
+		REQUIRE(parallel->nmeshes == serial->nmeshes);
+		REQUIRE(parallel->nverts == serial->nverts);
+		REQUIRE(parallel->ntris == serial->ntris);
+		REQUIRE(memcmp(parallel->meshes, serial->meshes, sizeof(unsigned int) * serial->nmeshes * 4) == 0);
+		REQUIRE(memcmp(parallel->verts, serial->verts, sizeof(float) * serial->nverts * 3) == 0);
+		REQUIRE(memcmp(parallel->tris, serial->tris, sizeof(unsigned char) * serial->ntris * 4) == 0);
+		rcFreePolyMeshDetail(parallel);
+	}
+
+	SECTION("Threads with a temporary memory arena")
+	{
+		// The scratch buffers are grown by the workers and freed by the calling thread.
+		rcTempArena arena;
+		REQUIRE(arena.init(4096));
+		rcTempArenaScope scope(&arena);
+		TestRecast::ThreadDispatcher dispatcher(4);
+
+		rcPolyMeshDetail* parallel = rcAllocPolyMeshDetail();
+		REQUIRE(rcBuildPolyMeshDetail(&ctx, *pmesh, *chf, sampleDist, sampleMaxError, *parallel, &dispatcher, 0));
+		REQUIRE(arena.getPeakSize() > 0);
+
+		REQUIRE(parallel->nverts == serial->nverts);
+		REQUIRE(parallel->ntris == serial->ntris);
+		REQUIRE(memcmp(parallel->verts, serial->verts, sizeof(float) * serial->nverts * 3) == 0);
+		REQUIRE(memcmp(parallel->tris, serial->tris, sizeof(unsigned char) * serial->ntris * 4) == 0);
+		rcFreePolyMeshDetail(parallel);
+	}
+
+	SECTION("Threads with a bound allocator")
+	{
+		TestRecast::CountingAllocator allocator;
+		{
+			rcAllocatorScope scope(&allocator);
+			TestRecast::ThreadDispatcher dispatcher(4);
+
+			rcPolyMeshDetail* parallel = rcAllocPolyMeshDetail();
+			REQUIRE(rcBuildPolyMeshDetail(&ctx, *pmesh, *chf, sampleDist, sampleMaxError, *parallel, &dispatcher, 0));
+			REQUIRE(parallel->ntris == serial->ntris);
+			REQUIRE(memcmp(parallel->tris, serial->tris, sizeof(unsigned char) * serial->ntris * 4) == 0);
+			rcFreePolyMeshDetail(parallel);
+		}
+		REQUIRE(allocator.allocs > 0);
+		REQUIRE(allocator.live == 0);
+		REQUIRE(allocator.foreign == 0);
+	}
+
+	SECTION("Serial dispatcher")
+	{
+		rcJobDispatcher dispatcher;
+		rcPolyMeshDetail* parallel = rcAllocPolyMeshDetail();
+		REQUIRE(rcBuildPolyMeshDetail(&ctx, *pmesh, *chf, sampleDist, sampleMaxError, *parallel, &dispatcher, 0));
+
+		REQUIRE(parallel->nverts == serial->nverts);
+		REQUIRE(parallel->ntris == serial->ntris);
+		REQUIRE(memcmp(parallel->meshes, serial->meshes, sizeof(unsigned int) * serial->nmeshes * 4) == 0);
+		REQUIRE(memcmp(parallel->verts, serial->verts, sizeof(float) * serial->nverts * 3) == 0);
+		REQUIRE(memcmp(parallel->tris, serial->tris, sizeof(unsigned char) * serial->ntris * 4) == 0);
+		rcFreePolyMeshDetail(parallel);
+	}
+
+	rcFreePolyMeshDetail(serial);
+	rcFreePolyMesh(pmesh);
+	rcFreeContourSet(cset);
+	rcFreeCompactHeightfield(chf);
+}
+
+TEST_CASE("rcBuildPolyMeshDetail triangulation", "[recast]")
+{
+	rcContext ctx(false);
+	rcCompactHeightfield* chf = TestRecast::buildTerrain(ctx);
+	REQUIRE(rcBuildDistanceField(&ctx, *chf));
+	REQUIRE(rcBuildRegions(&ctx, *chf, 0, 8, 20));
+
+	rcContourSet* cset = rcAllocContourSet();
+	REQUIRE(rcBuildContours(&ctx, *chf, 1.3f, 40, *cset));
+	rcPolyMesh* pmesh = rcAllocPolyMesh();
+	REQUIRE(rcBuildPolyMesh(&ctx, *cset, 6, *pmesh));
+
+	// Dense sampling adds many interior vertices to each polygon.
+	rcPolyMeshDetail* dmesh = rcAllocPolyMeshDetail();
+	REQUIRE(rcBuildPolyMeshDetail(&ctx, *pmesh, *chf, 2.0f * chf->cs, 0.5f * chf->ch, *dmesh));
+
+	int interiorPolys = 0;
+	for (int i = 0; i < dmesh->nmeshes; ++i)
+	{
+		const unsigned int* m = &dmesh->meshes[i * 4];
+		const float* verts = &dmesh->verts[m[0] * 3];
+		const unsigned char* tris = &dmesh->tris[m[2] * 4];
+		const int ntris = (int)m[3];
+
+		// The detail triangles have the winding of the polygon and cover it.
+		const unsigned short* p = &pmesh->polys[i * pmesh->nvp * 2];
+		float polyArea = 0;
+		for (int j = 2; j < pmesh->nvp && p[j] != RC_MESH_NULL_IDX; ++j)
+		{
+			const unsigned short* va = &pmesh->verts[p[0] * 3];
+			const unsigned short* vb = &pmesh->verts[p[j - 1] * 3];
+			const unsigned short* vc = &pmesh->verts[p[j] * 3];
+			polyArea += ((vb[0] - va[0]) * (vc[2] - va[2]) - (vb[2] - va[2]) * (vc[0] - va[0])) * pmesh->cs * pmesh->cs;
+		}
+		float area = 0;
+		for (int j = 0; j < ntris; ++j)
+		{
+			const unsigned char* t = &tris[j * 4];
+			const float a = triArea(&verts[t[0] * 3], &verts[t[1] * 3], &verts[t[2] * 3]);
+			REQUIRE(a * polyArea >= 0);
+			area += a;
+		}
+		REQUIRE(fabsf(area - polyArea) <= fabsf(polyArea) * 1e-3f + 1e-3f);
+
+		// Triangulations with interior vertices are Delaunay.
+		bool interior = false;
+		for (int v = 0; v < (int)m[1] && !interior; ++v)
+		{
+			bool onBoundary = false;
+			for (int j = 0; j < ntris && !onBoundary; ++j)
+			{
+				const unsigned char* t = &tris[j * 4];
+				for (int k = 0; k < 3; ++k)
+				{
+					const bool boundary = ((t[3] >> (k * 2)) & 0x3) != 0;
+					if (boundary && (t[k] == v || t[(k + 1) % 3] == v))
+						onBoundary = true;
+				}
+			}
+			interior = !onBoundary;
+		}
+		if (!interior)
+			continue;
+		interiorPolys++;
+		for (int j = 0; j < ntris; ++j)
+		{
+			const unsigned char* t = &tris[j * 4];
+			for (int k = 0; k < (int)m[1]; ++k)
+			{
+				if (k == t[0] || k == t[1] || k == t[2])
+					continue;
+				REQUIRE(!insideCircumCircle(&verts[t[0] * 3], &verts[t[1] * 3], &verts[t[2] * 3], &verts[k * 3]));
+			}
+		}
+	}
+	REQUIRE(interiorPolys > 5);
+
+	rcFreePolyMeshDetail(dmesh);
+	rcFreePolyMesh(pmesh);
+	rcFreeContourSet(cset);
+	rcFreeCompactHeightfield(chf);
+}
+
+TEST_CASE("Rebuilding into the results of a previous build", "[recast]")
+{
+	// All memory comes from one allocator, so that a rebuild frees the buffers it replaces with it.
+	TestRecast::CountingAllocator allocator;
+	{
+		rcAllocatorScope allocatorScope(&allocator);
+		rcContext ctx(false);
+		rcCompactHeightfield* chf = TestRecast::buildTerrain(ctx);
+		rcCompactHeightfield* copy = rcAllocCompactHeightfield();
+		REQUIRE(rcCopyCompactHeightfield(&ctx, *chf, *copy));
+		const rcCompactSpan* copySpans = copy->spans;
+		int allocs = allocator.allocs;
+		REQUIRE(rcCopyCompactHeightfield(&ctx, *chf, *copy));
+		REQUIRE(allocator.allocs == allocs);
+		REQUIRE(copy->spans == copySpans);
+
+		REQUIRE(rcBuildDistanceField(&ctx, *chf));
+		REQUIRE(rcBuildRegions(&ctx, *chf, 0, 8, 20));
+
+		const float sampleDist = 6.0f * chf->cs;
+		const float sampleMaxError = 1.0f * chf->ch;
+
+		rcContourSet* cset = rcAllocContourSet();
+		rcPolyMesh* pmesh = rcAllocPolyMesh();
+		rcPolyMeshDetail* dmesh = rcAllocPolyMeshDetail();
+		REQUIRE(rcBuildContours(&ctx, *chf, 1.3f, 40, *cset));
+		REQUIRE(rcBuildPolyMesh(&ctx, *cset, 6, *pmesh));
+		REQUIRE(rcBuildPolyMeshDetail(&ctx, *pmesh, *chf, sampleDist, sampleMaxError, *dmesh));
+		REQUIRE(pmesh->npolys > 10);
+
+		const std::vector<unsigned short> polys(pmesh->polys, pmesh->polys + pmesh->npolys * 2 * pmesh->nvp);
+		const std::vector<unsigned short> verts(pmesh->verts, pmesh->verts + pmesh->nverts * 3);
+		const std::vector<float> detailVerts(dmesh->verts, dmesh->verts + dmesh->nverts * 3);
+		const std::vector<unsigned char> detailTris(dmesh->tris, dmesh->tris + dmesh->ntris * 4);
+		const rcContour* conts = cset->conts;
+		const unsigned short* meshPolys = pmesh->polys;
+		const float* meshDetailVerts = dmesh->verts;
+
+		// With the temporary memory in an arena, a rebuild only allocates the vertices of the contours.
+		{
+			rcTempArena arena;
+			REQUIRE(arena.init(1 << 20));
+			rcTempArenaScope arenaScope(&arena);
+
+			allocs = allocator.allocs;
+			REQUIRE(rcBuildContours(&ctx, *chf, 1.3f, 40, *cset));
+			REQUIRE(allocator.allocs - allocs >= cset->nconts * 2);
+			allocs = allocator.allocs;
+			REQUIRE(rcBuildPolyMesh(&ctx, *cset, 6, *pmesh));
+			REQUIRE(rcBuildPolyMeshDetail(&ctx, *pmesh, *chf, sampleDist, sampleMaxError, *dmesh));
+			REQUIRE(allocator.allocs == allocs);
+		}
+		REQUIRE(cset->conts == conts);
+		REQUIRE(pmesh->polys == meshPolys);
+		REQUIRE(dmesh->verts == meshDetailVerts);
+
+		REQUIRE(std::vector<unsigned short>(pmesh->polys, pmesh->polys + pmesh->npolys * 2 * pmesh->nvp) == polys);
+		REQUIRE(std::vector<unsigned short>(pmesh->verts, pmesh->verts + pmesh->nverts * 3) == verts);
+		REQUIRE(std::vector<float>(dmesh->verts, dmesh->verts + dmesh->nverts * 3) == detailVerts);
+		REQUIRE(std::vector<unsigned char>(dmesh->tris, dmesh->tris + dmesh->ntris * 4) == detailTris);
+
+		rcFreePolyMeshDetail(dmesh);
+		rcFreePolyMesh(pmesh);
+		rcFreeContourSet(cset);
+		rcFreeCompactHeightfield(copy);
+		rcFreeCompactHeightfield(chf);
+	}
+	REQUIRE(allocator.live == 0);
+	REQUIRE(allocator.foreign == 0);
+}
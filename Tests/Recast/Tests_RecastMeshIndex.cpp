@@ -0,0 +1,288 @@
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "Recast.h"
+#include "RecastMeshIndex.h"
+#include "TestRecastUtils.h"
+
+namespace
+{
+// A soup of small triangles scattered over a few floors.
+struct TriangleSoup
+{
+	std::vector<float> verts;
+	std::vector<int> tris;
+
+	explicit TriangleSoup(const int count)
+	{
+		unsigned int seed = 12345u;
+		for (int i = 0; i < count; ++i)
+		{
+			float c[3];
+			for (int j = 0; j < 3; ++j)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				c[j] = (seed >> 8) / 16777216.0f * 100.0f;
+			}
+			c[1] = floorf(c[1] / 25.0f) * 5.0f;
+			for (int k = 0; k < 3; ++k)
+			{
+				for (int j = 0; j < 3; ++j)
+				{
+					seed = seed * 1664525u + 1013904223u;
+					verts.push_back(c[j] + ((seed >> 8) / 16777216.0f - 0.5f) * 3.0f);
+				}
+				tris.push_back((int)verts.size() / 3 - 1);
+			}
+		}
+	}
+
+	int getVertCount() const { return (int)verts.size() / 3; }
+	int getTriCount() const { return (int)tris.size() / 3; }
+};
+
+bool intersectSegmentTriangle(const float* sp, const float* sq, const float* a, const float* b, const float* c,
+							  float& t)
+{
+	float ab[3], ac[3], qp[3], ap[3], norm[3], e[3];
+	rcVsub(ab, b, a);
+	rcVsub(ac, c, a);
+	rcVsub(qp, sp, sq);
+	rcVcross(norm, ab, ac);
+	const float d = rcVdot(qp, norm);
+	if (d <= 0.0f) return false;
+	rcVsub(ap, sp, a);
+	t = rcVdot(ap, norm);
+	if (t < 0.0f || t > d) return false;
+	rcVcross(e, qp, ap);
+	const float v = rcVdot(ac, e);
+	if (v < 0.0f || v > d) return false;
+	const float w = -rcVdot(ab, e);
+	if (w < 0.0f || v + w > d) return false;
+	t /= d;
+	return true;
+}
+
+void triBounds(const TriangleSoup& soup, const int tri, float* bmin, float* bmax)
+{
+	const float* v = &soup.verts[0];
+	const int* t = &soup.tris[tri * 3];
+	rcVcopy(bmin, &v[t[0] * 3]);
+	rcVcopy(bmax, &v[t[0] * 3]);
+	for (int j = 1; j < 3; ++j)
+	{
+		rcVmin(bmin, &v[t[j] * 3]);
+		rcVmax(bmax, &v[t[j] * 3]);
+	}
+}
+
+// Returns the input triangles of the chunks, sorted.
+std::vector<int> chunkTris(const rcTriMeshIndex& index, const int* ids, const int count)
+{
+	std::vector<int> result;
+	for (int i = 0; i < count; ++i)
+	{
+		const rcTriMeshIndexNode& node = index.nodes[ids[i]];
+		for (int j = 0; j < node.n; ++j)
+			result.push_back(index.triIds[node.i + j]);
+	}
+	std::sort(result.begin(), result.end());
+	return result;
+}
+} // anonymous namespace
+
+TEST_CASE("rcBuildTriMeshIndex", "[recast, meshindex]")
+{
+	rcContext ctx(false);
+	const TriangleSoup soup(5000);
+	const int trisPerChunk = 64;
+
+	rcTriMeshIndex* index = rcAllocTriMeshIndex();
+	REQUIRE(index);
+	REQUIRE(rcBuildTriMeshIndex(&ctx, &soup.verts[0], soup.getVertCount(), &soup.tris[0], soup.getTriCount(),
+								trisPerChunk, *index));
+	REQUIRE(index->ntris == soup.getTriCount());
+
+	SECTION("Every triangle is stored once, in a chunk that bounds it")
+	{
+		std::vector<int> seen(soup.getTriCount(), 0);
+		int chunks = 0;
+		int maxTris = 0;
+		for (int i = 0; i < index->nnodes; ++i)
+		{
+			const rcTriMeshIndexNode& node = index->nodes[i];
+			if (node.i < 0)
+			{
+				REQUIRE(i - node.i <= index->nnodes);
+				continue;
+			}
+			chunks++;
+			maxTris = std::max(maxTris, node.n);
+			REQUIRE(node.n <= trisPerChunk);
+			for (int j = node.i; j < node.i + node.n; ++j)
+			{
+				const int tri = index->triIds[j];
+				seen[tri]++;
+				REQUIRE(memcmp(&index->tris[j * 3], &soup.tris[tri * 3], sizeof(int) * 3) == 0);
+				float bmin[3], bmax[3];
+				triBounds(soup, tri, bmin, bmax);
+				for (int k = 0; k < 3; ++k)
+				{
+					REQUIRE(bmin[k] >= node.bmin[k]);
+					REQUIRE(bmax[k] <= node.bmax[k]);
+				}
+			}
+		}
+		REQUIRE(std::count(seen.begin(), seen.end(), 1) == soup.getTriCount());
+		REQUIRE(index->nchunks == chunks);
+		REQUIRE(index->maxTrisPerChunk == maxTris);
+	}
+
+	SECTION("The parallel build produces the same index")
+	{
+		TestRecast::ThreadDispatcher dispatcher(4);
+		rcTriMeshIndex parallel;
+		REQUIRE(rcBuildTriMeshIndex(&ctx, &soup.verts[0], soup.getVertCount(), &soup.tris[0], soup.getTriCount(),
+									trisPerChunk, parallel, &dispatcher));
+		REQUIRE(parallel.nnodes == index->nnodes);
+		REQUIRE(memcmp(parallel.nodes, index->nodes, sizeof(rcTriMeshIndexNode) * index->nnodes) == 0);
+		REQUIRE(memcmp(parallel.tris, index->tris, sizeof(int) * 3 * index->ntris) == 0);
+		REQUIRE(memcmp(parallel.triIds, index->triIds, sizeof(int) * index->ntris) == 0);
+	}
+
+	SECTION("Rectangle and box queries return every overlapping triangle")
+	{
+		std::vector<int> ids(index->nchunks);
+		const float boxes[][6] = {
+			{ 10, 0, 10, 30, 6, 25 },
+			{ -5, -5, -5, 105, 105, 105 },
+			{ 50, 12, 50, 51, 13, 51 },
+			{ 200, 0, 200, 210, 1, 210 },
+		};
+		for (int b = 0; b < 4; ++b)
+		{
+			const float* bmin = &boxes[b][0];
+			const float* bmax = &boxes[b][3];
+			const float rmin[2] = { bmin[0], bmin[2] };
+			const float rmax[2] = { bmax[0], bmax[2] };
+			const std::vector<int> inRect = chunkTris(*index, &ids[0],
+				rcGetTriMeshChunksOverlappingRect(*index, rmin, rmax, &ids[0], (int)ids.size()));
+			const std::vector<int> inBox = chunkTris(*index, &ids[0],
+				rcGetTriMeshChunksOverlappingBox(*index, bmin, bmax, &ids[0], (int)ids.size()));
+
+			for (int i = 0; i < soup.getTriCount(); ++i)
+			{
+				float tmin[3], tmax[3];
+				triBounds(soup, i, tmin, tmax);
+				const bool rect = tmin[0] <= bmax[0] && tmax[0] >= bmin[0] && tmin[2] <= bmax[2] && tmax[2] >= bmin[2];
+				const bool box = rect && tmin[1] <= bmax[1] && tmax[1] >= bmin[1];
+				if (rect)
+					REQUIRE(std::binary_search(inRect.begin(), inRect.end(), i));
+				if (box)
+					REQUIRE(std::binary_search(inBox.begin(), inBox.end(), i));
+			}
+			REQUIRE(inBox.size() <= inRect.size());
+		}
+
+		// The results are capped at the buffer size.
+		const float rmin[2] = { -5, -5 };
+		const float rmax[2] = { 105, 105 };
+		REQUIRE(rcGetTriMeshChunksOverlappingRect(*index, rmin, rmax, &ids[0], 3) == 3);
+	}
+
+	SECTION("Raycasts hit the closest front facing triangle")
+	{
+		unsigned int seed = 777u;
+		int hits = 0;
+		for (int r = 0; r < 500; ++r)
+		{
+			float sp[3], sq[3];
+			for (int j = 0; j < 3; ++j)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				sp[j] = (seed >> 8) / 16777216.0f * 100.0f;
+				seed = seed * 1664525u + 1013904223u;
+				sq[j] = (seed >> 8) / 16777216.0f * 100.0f;
+			}
+
+			bool expectHit = false;
+			float expectT = 1.0f;
+			for (int i = 0; i < soup.getTriCount(); ++i)
+			{
+				const int* t = &soup.tris[i * 3];
+				float th = 1.0f;
+				if (intersectSegmentTriangle(sp, sq, &soup.verts[t[0] * 3], &soup.verts[t[1] * 3],
+											 &soup.verts[t[2] * 3], th))
+				{
+					expectHit = true;
+					expectT = std::min(expectT, th);
+				}
+			}
+
+			float t = -1.0f;
+			const bool hit = rcRaycastTriMeshIndex(*index, &soup.verts[0], sp, sq, t);
+			REQUIRE(hit == expectHit);
+			if (hit)
+			{
+				REQUIRE(t == expectT);
+				hits++;
+			}
+		}
+		REQUIRE(hits > 0);
+
+		// Segment queries return the chunks of the hit triangles.
+		const float sp[3] = { -1, 2.5f, 50 };
+		const float sq[3] = { 101, 2.5f, 50 };
+		std::vector<int> ids(index->nchunks);
+		const int n = rcGetTriMeshChunksOverlappingSegment(*index, sp, sq, &ids[0], (int)ids.size());
+		const std::vector<int> crossed = chunkTris(*index, &ids[0], n);
+		for (int i = 0; i < soup.getTriCount(); ++i)
+		{
+			const int* t = &soup.tris[i * 3];
+			float th = 1.0f;
+			float rsp[3] = { sp[0], sp[1], sp[2] };
+			float rsq[3] = { sq[0], sq[1], sq[2] };
+			if (intersectSegmentTriangle(rsp, rsq, &soup.verts[t[0] * 3], &soup.verts[t[1] * 3], &soup.verts[t[2] * 3], th) ||
+				intersectSegmentTriangle(rsq, rsp, &soup.verts[t[0] * 3], &soup.verts[t[1] * 3], &soup.verts[t[2] * 3], th))
+				REQUIRE(std::binary_search(crossed.begin(), crossed.end(), i));
+		}
+	}
+
+	rcFreeTriMeshIndex(index);
+}
+
+TEST_CASE("rcBuildTriMeshIndex with invalid input", "[recast, meshindex]")
+{
+	rcContext ctx(false);
+	const TriangleSoup soup(10);
+	rcTriMeshIndex index;
+
+	SECTION("An empty mesh has no nodes")
+	{
+		REQUIRE(rcBuildTriMeshIndex(&ctx, &soup.verts[0], soup.getVertCount(), &soup.tris[0], 0, 16, index));
+		REQUIRE(index.nnodes == 0);
+		const float bmin[2] = { 0, 0 };
+		const float bmax[2] = { 100, 100 };
+		int id = -1;
+		REQUIRE(rcGetTriMeshChunksOverlappingRect(index, bmin, bmax, &id, 1) == 0);
+	}
+
+	SECTION("The chunk size must be positive")
+	{
+		REQUIRE_FALSE(rcBuildTriMeshIndex(&ctx, &soup.verts[0], soup.getVertCount(), &soup.tris[0],
+										  soup.getTriCount(), 0, index));
+	}
+
+	SECTION("Vertex indices must be in range")
+	{
+		std::vector<int> tris(soup.tris);
+		tris[7] = soup.getVertCount();
+		REQUIRE_FALSE(rcBuildTriMeshIndex(&ctx, &soup.verts[0], soup.getVertCount(), &tris[0],
+										  soup.getTriCount(), 4, index));
+		REQUIRE(index.nnodes == 0);
+	}
+}
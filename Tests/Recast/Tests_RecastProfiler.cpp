@@ -0,0 +1,155 @@
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "Recast.h"
+#include "RecastAlloc.h"
+#include "RecastProfiler.h"
+
+TEST_CASE("rcProfilingContext", "[recast, profiler]")
+{
+	rcProfilingContext ctx;
+	REQUIRE(ctx.init(16, 3));
+	REQUIRE(ctx.getThreadId() == 3);
+
+	SECTION("Nested scopes are recorded in start order")
+	{
+		{
+			rcScopedTimer total(&ctx, RC_TIMER_TOTAL);
+			for (int i = 0; i < 2; ++i)
+			{
+				rcScopedTimer regions(&ctx, RC_TIMER_BUILD_REGIONS);
+				rcScopedTimer watershed(&ctx, RC_TIMER_BUILD_REGIONS_WATERSHED);
+			}
+		}
+
+		REQUIRE(ctx.getEventCount() == 5);
+		REQUIRE(ctx.getDroppedEventCount() == 0);
+		const int labels[5] = { RC_TIMER_TOTAL, RC_TIMER_BUILD_REGIONS, RC_TIMER_BUILD_REGIONS_WATERSHED,
+								RC_TIMER_BUILD_REGIONS, RC_TIMER_BUILD_REGIONS_WATERSHED };
+		const int depths[5] = { 0, 1, 2, 1, 2 };
+		for (int i = 0; i < 5; ++i)
+		{
+			const rcProfileEvent& event = ctx.getEvent(i);
+			CHECK(event.label == labels[i]);
+			CHECK(event.depth == depths[i]);
+			CHECK(event.start >= ctx.getEvent(0).start);
+			CHECK(event.start + event.duration <= ctx.getEvent(0).start + ctx.getEvent(0).duration);
+		}
+
+		CHECK(ctx.getStageStats(RC_TIMER_TOTAL).calls == 1);
+		CHECK(ctx.getStageStats(RC_TIMER_BUILD_REGIONS).calls == 2);
+		CHECK(ctx.getStageStats(RC_TIMER_BUILD_REGIONS_WATERSHED).calls == 2);
+		CHECK(ctx.getAccumulatedTime(RC_TIMER_BUILD_REGIONS) >= 0);
+		CHECK(ctx.getAccumulatedTime(RC_TIMER_BUILD_CONTOURS) == -1);
+
+		ctx.resetTimers();
+		CHECK(ctx.getEventCount() == 0);
+		CHECK(ctx.getStageStats(RC_TIMER_TOTAL).calls == 0);
+	}
+
+	SECTION("Scopes beyond the event storage are still counted")
+	{
+		for (int i = 0; i < 20; ++i)
+		{
+			rcScopedTimer timer(&ctx, RC_TIMER_TEMP);
+		}
+		CHECK(ctx.getEventCount() == 16);
+		CHECK(ctx.getDroppedEventCount() == 4);
+		CHECK(ctx.getStageStats(RC_TIMER_TEMP).calls == 20);
+	}
+
+	SECTION("Unmatched scopes are closed by their parent")
+	{
+		ctx.startTimer(RC_TIMER_TOTAL);
+		ctx.startTimer(RC_TIMER_BUILD_CONTOURS);
+		ctx.stopTimer(RC_TIMER_TEMP);
+		ctx.stopTimer(RC_TIMER_TOTAL);
+		CHECK(ctx.getStageStats(RC_TIMER_TOTAL).calls == 1);
+		CHECK(ctx.getStageStats(RC_TIMER_BUILD_CONTOURS).calls == 1);
+		CHECK(ctx.getStageStats(RC_TIMER_TEMP).calls == 0);
+	}
+
+	SECTION("Disabled timers record nothing")
+	{
+		ctx.enableTimer(false);
+		{
+			rcScopedTimer timer(&ctx, RC_TIMER_TOTAL);
+		}
+		ctx.enableTimer(true);
+		CHECK(ctx.getEventCount() == 0);
+	}
+}
+
+TEST_CASE("rcProfilingContext allocation tracking", "[recast, profiler]")
+{
+	rcProfilingContext ctx;
+	REQUIRE(ctx.init(16, 0));
+
+	rcProfilingContext::enableAllocTracking();
+
+	void* outside = rcAlloc(100, RC_ALLOC_TEMP);
+	{
+		rcScopedTimer total(&ctx, RC_TIMER_TOTAL);
+		rcFree(rcAlloc(10, RC_ALLOC_TEMP));
+		{
+			rcScopedTimer temp(&ctx, RC_TIMER_TEMP);
+			rcFree(rcAlloc(20, RC_ALLOC_TEMP));
+			rcFree(rcAlloc(30, RC_ALLOC_TEMP));
+		}
+	}
+
+	// Allocations of other threads are not attributed to the context.
+	{
+		rcScopedTimer temp(&ctx, RC_TIMER_TEMP);
+		std::thread other([]() { rcFree(rcAlloc(1000, RC_ALLOC_TEMP)); });
+		other.join();
+	}
+
+	rcProfilingContext::disableAllocTracking();
+	rcFree(outside);
+
+	CHECK(ctx.getStageStats(RC_TIMER_TOTAL).allocatedBytes == 60);
+	CHECK(ctx.getStageStats(RC_TIMER_TOTAL).allocationCount == 3);
+	CHECK(ctx.getStageStats(RC_TIMER_TEMP).allocatedBytes == 50);
+	CHECK(ctx.getStageStats(RC_TIMER_TEMP).allocationCount == 2);
+	REQUIRE(ctx.getEventCount() == 3);
+	CHECK(ctx.getEvent(0).allocatedBytes == 60);
+	CHECK(ctx.getEvent(1).allocatedBytes == 50);
+	CHECK(ctx.getEvent(2).allocatedBytes == 0);
+}
+
+TEST_CASE("rcProfilingContext Chrome trace export", "[recast, profiler]")
+{
+	rcProfilingContext main;
+	rcProfilingContext worker;
+	REQUIRE(main.init(8, 0));
+	REQUIRE(worker.init(8, 1));
+
+	{
+		rcScopedTimer total(&main, RC_TIMER_TOTAL);
+		rcScopedTimer rasterize(&worker, RC_TIMER_RASTERIZE_TRIANGLES);
+	}
+
+	const rcProfilingContext* contexts[2] = { &main, &worker };
+	const int length = rcProfilingContext::exportChromeTrace(contexts, 2, 0, 0);
+	REQUIRE(length > 0);
+
+	std::vector<char> buffer(length + 1);
+	REQUIRE(rcProfilingContext::exportChromeTrace(contexts, 2, &buffer[0], length + 1) == length);
+	const std::string json(&buffer[0]);
+	CHECK((int)json.size() == length);
+	CHECK(json.find("{\"traceEvents\":[") == 0);
+	CHECK(json.find("\"name\":\"Total\",\"cat\":\"recast\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":0,") != std::string::npos);
+	CHECK(json.find("\"name\":\"Rasterize\",\"cat\":\"recast\",\"ph\":\"X\",\"pid\":0,\"tid\":1,") != std::string::npos);
+
+	// Truncated output is null terminated.
+	char small[16];
+	memset(small, 'x', sizeof(small));
+	CHECK(rcProfilingContext::exportChromeTrace(contexts, 2, small, sizeof(small)) == length);
+	CHECK(small[sizeof(small) - 1] == '\0');
+	CHECK(strncmp(small, json.c_str(), sizeof(small) - 1) == 0);
+}
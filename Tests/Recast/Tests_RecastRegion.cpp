@@ -0,0 +1,133 @@
+#include "catch2/catch_all.hpp"
+
+#include "Recast.h"
+
+#include "TestRecastUtils.h"
+
+TEST_CASE("rcBuildRegions with a job dispatcher", "[recast]")
+{
+	rcContext ctx(false);
+	rcCompactHeightfield* serial = TestRecast::buildTerrain(ctx);
+	rcCompactHeightfield* parallel = TestRecast::buildTerrain(ctx);
+	REQUIRE(serial->spanCount == parallel->spanCount);
+
+	const int borderSize = 4;
+	const int minRegionArea = 8;
+	const int mergeRegionArea = 20;
+
+	REQUIRE(rcBuildDistanceField(&ctx, *serial));
+	REQUIRE(rcBuildRegions(&ctx, *serial, borderSize, minRegionArea, mergeRegionArea));
+
+	TestRecast::ThreadDispatcher dispatcher(4);
+	REQUIRE(rcBuildDistanceField(&ctx, *parallel, &dispatcher));
+	REQUIRE(rcBuildRegions(&ctx, *parallel, borderSize, minRegionArea, mergeRegionArea, &dispatcher));
+
+	// The distance field is the same as the serial one. The terrain is over two bands high, so
+	// the watershed is flooded in bands, whose regions are merged back to about as many.
+	REQUIRE(serial->height >= 128);
+	REQUIRE(serial->maxDistance == parallel->maxDistance);
+	REQUIRE(serial->maxRegions > 10);
+	REQUIRE(parallel->maxRegions * 10 >= serial->maxRegions * 9);
+	REQUIRE(parallel->maxRegions * 10 <= serial->maxRegions * 11);
+	int mismatches = 0;
+	int unassigned = 0;
+	for (int i = 0; i < serial->spanCount; ++i)
+	{
+		if (serial->dist[i] != parallel->dist[i])
+			mismatches++;
+		if (serial->spans[i].reg != 0 && parallel->spans[i].reg == 0)
+			unassigned++;
+	}
+	REQUIRE(mismatches == 0);
+	REQUIRE(unassigned == 0);
+
+	// The regions do not depend on the number of workers.
+	rcCompactHeightfield* other = TestRecast::buildTerrain(ctx);
+	TestRecast::ThreadDispatcher otherDispatcher(7);
+	rcJobDispatcher serialDispatcher;
+	rcJobDispatcher* dispatchers[] = { &otherDispatcher, &serialDispatcher };
+	for (int d = 0; d < 2; ++d)
+	{
+		REQUIRE(rcBuildDistanceField(&ctx, *other, dispatchers[d]));
+		REQUIRE(rcBuildRegions(&ctx, *other, borderSize, minRegionArea, mergeRegionArea, dispatchers[d]));
+		REQUIRE(other->maxRegions == parallel->maxRegions);
+		for (int i = 0; i < serial->spanCount; ++i)
+		{
+			if (other->dist[i] != parallel->dist[i] || other->spans[i].reg != parallel->spans[i].reg)
+				mismatches++;
+		}
+		REQUIRE(mismatches == 0);
+	}
+	rcFreeCompactHeightfield(other);
+
+	// The workers use the allocator bound by the caller.
+	TestRecast::CountingAllocator allocator;
+	{
+		rcAllocatorScope scope(&allocator);
+		rcCompactHeightfield* scoped = TestRecast::buildTerrain(ctx);
+		REQUIRE(rcBuildDistanceField(&ctx, *scoped, &dispatcher));
+		REQUIRE(rcBuildRegions(&ctx, *scoped, borderSize, minRegionArea, mergeRegionArea, &dispatcher));
+		for (int i = 0; i < serial->spanCount; ++i)
+		{
+			if (scoped->dist[i] != parallel->dist[i] || scoped->spans[i].reg != parallel->spans[i].reg)
+				mismatches++;
+		}
+		REQUIRE(mismatches == 0);
+		rcFreeCompactHeightfield(scoped);
+	}
+	REQUIRE(allocator.allocs > 0);
+	REQUIRE(allocator.live == 0);
+	REQUIRE(allocator.foreign == 0);
+
+	rcFreeCompactHeightfield(parallel);
+	rcFreeCompactHeightfield(serial);
+}
+
+TEST_CASE("rcBuildRegionsMonotone and rcBuildLayerRegions with a job dispatcher", "[recast]")
+{
+	rcContext ctx(false);
+	rcCompactHeightfield* serial = TestRecast::buildTerrain(ctx);
+	rcCompactHeightfield* parallel = TestRecast::buildTerrain(ctx);
+	REQUIRE(serial->spanCount == parallel->spanCount);
+
+	const int minRegionArea = 8;
+	const int mergeRegionArea = 20;
+	TestRecast::ThreadDispatcher dispatcher(4);
+	TestRecast::ThreadDispatcher oddDispatcher(7);
+	rcJobDispatcher serialDispatcher;
+	rcJobDispatcher* dispatchers[] = { &dispatcher, &oddDispatcher, &serialDispatcher };
+
+	const int borderSizes[] = { 0, 4 };
+	for (int bi = 0; bi < 2; ++bi)
+	{
+		const int borderSize = borderSizes[bi];
+		for (int layers = 0; layers < 2; ++layers)
+		{
+			if (layers)
+				REQUIRE(rcBuildLayerRegions(&ctx, *serial, borderSize, minRegionArea));
+			else
+				REQUIRE(rcBuildRegionsMonotone(&ctx, *serial, borderSize, minRegionArea, mergeRegionArea));
+			REQUIRE(serial->maxRegions > 5);
+
+			for (int di = 0; di < 3; ++di)
+			{
+				if (layers)
+					REQUIRE(rcBuildLayerRegions(&ctx, *parallel, borderSize, minRegionArea, dispatchers[di]));
+				else
+					REQUIRE(rcBuildRegionsMonotone(&ctx, *parallel, borderSize, minRegionArea, mergeRegionArea, dispatchers[di]));
+
+				REQUIRE(serial->maxRegions == parallel->maxRegions);
+				int mismatches = 0;
+				for (int i = 0; i < serial->spanCount; ++i)
+				{
+					if (serial->spans[i].reg != parallel->spans[i].reg)
+						mismatches++;
+				}
+				REQUIRE(mismatches == 0);
+			}
+		}
+	}
+
+	rcFreeCompactHeightfield(parallel);
+	rcFreeCompactHeightfield(serial);
+}
@@ -0,0 +1,274 @@
+#include <string.h>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "Recast.h"
+#include "RecastAlloc.h"
+#include "RecastTileBake.h"
+
+namespace
+{
+// Input chunks of walkable quads, addressed by their content hash, and tile data holding the polygon mesh.
+struct ChunkTileBuilder : public rcTileBuildCallbacks
+{
+	std::vector<std::vector<float> > chunks;
+	std::vector<uint64_t> hashes;
+	const rcTileBakeJob* job;
+
+	ChunkTileBuilder() : job(0) {}
+
+	uint64_t addQuad(const float x0, const float z0, const float x1, const float z1, const float y)
+	{
+		const float v[4 * 3] = { x0, y, z0, x0, y, z1, x1, y, z1, x1, y, z0 };
+		chunks.push_back(std::vector<float>(v, v + 12));
+		hashes.push_back(rcHashData64(v, sizeof(v), rcHashData64Init()));
+		return hashes.back();
+	}
+
+	bool rasterizeTile(rcContext* context, const rcConfig& tileCfg, const int, const int, rcHeightfield& heightfield) override
+	{
+		const int tris[2 * 3] = { 0, 1, 2, 0, 2, 3 };
+		for (int i = 0; i < job->chunkCount; ++i)
+		{
+			size_t chunk = 0;
+			while (chunk < hashes.size() && hashes[chunk] != job->chunkHashes[i])
+				chunk++;
+			if (chunk == hashes.size())
+				return false;
+			unsigned char areas[2] = { 0, 0 };
+			rcMarkWalkableTriangles(context, tileCfg.walkableSlopeAngle, &chunks[chunk][0], 4, tris, 2, areas);
+			if (!rcRasterizeTriangles(context, &chunks[chunk][0], 4, tris, areas, 2, heightfield, tileCfg.walkableClimb))
+				return false;
+		}
+		return true;
+	}
+
+	bool createTileData(rcContext*, const rcConfig&, const int, const int,
+						rcPolyMesh& polyMesh, rcPolyMeshDetail&, unsigned char** outData, int* outDataSize) override
+	{
+		const int vertsSize = polyMesh.nverts * 3 * (int)sizeof(unsigned short);
+		const int polysSize = polyMesh.npolys * polyMesh.nvp * 2 * (int)sizeof(unsigned short);
+		unsigned char* data = (unsigned char*)rcAlloc(vertsSize + polysSize, RC_ALLOC_PERM);
+		memcpy(data, polyMesh.verts, vertsSize);
+		memcpy(data + vertsSize, polyMesh.polys, polysSize);
+		*outData = data;
+		*outDataSize = vertsSize + polysSize;
+		return true;
+	}
+
+	void addTile(const int, const int, unsigned char* data, const int) override
+	{
+		rcFree(data);
+	}
+};
+
+rcTileBakeJob makeJob()
+{
+	rcTileBakeJob job;
+	memset(&job, 0, sizeof(job));
+	rcConfig& cfg = job.buildCfg.cfg;
+	cfg.cs = 0.5f;
+	cfg.ch = 0.2f;
+	cfg.walkableSlopeAngle = 45.0f;
+	cfg.walkableHeight = 10;
+	cfg.walkableClimb = 4;
+	cfg.walkableRadius = 2;
+	cfg.maxEdgeLen = 24;
+	cfg.maxSimplificationError = 1.3f;
+	cfg.minRegionArea = 8;
+	cfg.mergeRegionArea = 20;
+	cfg.maxVertsPerPoly = 6;
+	cfg.tileSize = 16;
+	cfg.borderSize = cfg.walkableRadius + 3;
+	cfg.detailSampleDist = 3.0f;
+	cfg.detailSampleMaxError = 0.2f;
+	cfg.bmin[0] = 0.0f; cfg.bmin[1] = -1.0f; cfg.bmin[2] = 0.0f;
+	cfg.bmax[0] = 24.0f; cfg.bmax[1] = 1.0f; cfg.bmax[2] = 16.0f;
+	job.buildCfg.partitionType = RC_PARTITION_MONOTONE;
+	job.buildCfg.filterFlags = RC_FILTER_LOW_HANGING_OBSTACLES | RC_FILTER_LEDGE_SPANS | RC_FILTER_WALKABLE_LOW_HEIGHT;
+	job.tx = 1;
+	job.ty = 0;
+	job.settingsHash = 42;
+	return job;
+}
+
+std::vector<unsigned char> makeBlob(const rcTileBakeBlobHeader& header, const unsigned char* data)
+{
+	std::vector<unsigned char> blob(RC_TILEBAKE_BLOB_HEADER_SIZE + header.dataSize);
+	REQUIRE(rcWriteTileBakeBlobHeader(header, &blob[0], (int)blob.size()));
+	if (header.dataSize > 0)
+		memcpy(&blob[RC_TILEBAKE_BLOB_HEADER_SIZE], data, header.dataSize);
+	return blob;
+}
+} // anonymous namespace
+
+TEST_CASE("rcHashData64", "[recast, bake]")
+{
+	// FNV-1a reference values.
+	REQUIRE(rcHashData64("", 0, rcHashData64Init()) == (((uint64_t)0xcbf29ce4u << 32) | 0x84222325u));
+	REQUIRE(rcHashData64("a", 1, rcHashData64Init()) == (((uint64_t)0xaf63dc4cu << 32) | 0x8601ec8cu));
+	REQUIRE(rcHashData64("foobar", 6, rcHashData64Init()) == (((uint64_t)0x85944171u << 32) | 0xf73967e8u));
+}
+
+TEST_CASE("rcTileBakeJob serialization", "[recast, bake]")
+{
+	rcTileBakeJob job = makeJob();
+	job.chunkCount = 3;
+	job.chunkHashes[0] = 1;
+	job.chunkHashes[1] = ((uint64_t)0xdeadbeefu << 32) | 0x12345678u;
+	job.chunkHashes[2] = 3;
+
+	const int size = rcGetTileBakeJobSize(job);
+	REQUIRE(size == RC_TILEBAKE_JOB_BASE_SIZE + 3 * 8);
+	std::vector<unsigned char> data(size);
+	int written = 0;
+	REQUIRE(rcWriteTileBakeJob(job, &data[0], size, &written));
+	REQUIRE(written == size);
+
+	SECTION("The job reads back unchanged")
+	{
+		rcTileBakeJob read;
+		REQUIRE(rcReadTileBakeJob(&data[0], size, read));
+		REQUIRE(memcmp(&read.buildCfg.cfg.bmin, &job.buildCfg.cfg.bmin, sizeof(job.buildCfg.cfg.bmin)) == 0);
+		REQUIRE(read.buildCfg.cfg.cs == job.buildCfg.cfg.cs);
+		REQUIRE(read.buildCfg.cfg.detailSampleMaxError == job.buildCfg.cfg.detailSampleMaxError);
+		REQUIRE(read.buildCfg.partitionType == job.buildCfg.partitionType);
+		REQUIRE(read.buildCfg.filterFlags == job.buildCfg.filterFlags);
+		REQUIRE(read.tx == 1);
+		REQUIRE(read.ty == 0);
+		REQUIRE(read.settingsHash == 42);
+		REQUIRE(read.chunkCount == 3);
+		REQUIRE(read.chunkHashes[1] == job.chunkHashes[1]);
+		REQUIRE(rcCalcTileBakeKey(read) == rcCalcTileBakeKey(job));
+	}
+
+	SECTION("The layout is little-endian")
+	{
+		REQUIRE(data[0] == 'J');
+		REQUIRE(data[3] == 'R');
+		REQUIRE(data[RC_TILEBAKE_JOB_BASE_SIZE + 8] == 0x78);
+		REQUIRE(data[RC_TILEBAKE_JOB_BASE_SIZE + 15] == 0xde);
+	}
+
+	SECTION("Invalid data is rejected")
+	{
+		rcTileBakeJob read;
+		REQUIRE_FALSE(rcReadTileBakeJob(&data[0], size - 1, read));
+		REQUIRE_FALSE(rcReadTileBakeJob(&data[0], RC_TILEBAKE_JOB_BASE_SIZE - 1, read));
+		data[4]++;
+		REQUIRE_FALSE(rcReadTileBakeJob(&data[0], size, read));
+		REQUIRE_FALSE(rcWriteTileBakeJob(job, &data[0], size - 1));
+		job.chunkCount = RC_TILEBAKE_MAX_CHUNKS + 1;
+		REQUIRE_FALSE(rcWriteTileBakeJob(job, &data[0], size));
+		REQUIRE(rcCalcTileBakeKey(job) == 0);
+	}
+
+	SECTION("The key covers the content of the job")
+	{
+		const uint64_t key = rcCalcTileBakeKey(job);
+		rcTileBakeJob other = job;
+		other.buildCfg.maxTilesInFlight = 4;
+		other.buildCfg.tempArenaSize = 1024;
+		other.buildCfg.cfg.width = 100;
+		REQUIRE(rcCalcTileBakeKey(other) == key);
+		other.chunkHashes[2] = 4;
+		REQUIRE(rcCalcTileBakeKey(other) != key);
+		other = job;
+		other.buildCfg.cfg.walkableClimb++;
+		REQUIRE(rcCalcTileBakeKey(other) != key);
+		other = job;
+		other.settingsHash++;
+		REQUIRE(rcCalcTileBakeKey(other) != key);
+		other = job;
+		other.ty++;
+		REQUIRE(rcCalcTileBakeKey(other) != key);
+	}
+}
+
+TEST_CASE("rcBakeTile", "[recast, bake]")
+{
+	rcContext context;
+	ChunkTileBuilder builder;
+	rcTileBakeJob job = makeJob();
+	job.chunkCount = 2;
+	job.chunkHashes[0] = builder.addQuad(0.0f, 0.0f, 12.0f, 16.0f, 0.0f);
+	job.chunkHashes[1] = builder.addQuad(12.0f, 0.0f, 24.0f, 16.0f, 0.0f);
+	builder.job = &job;
+
+	rcTileBakeBlobHeader header;
+	unsigned char* data = 0;
+	int dataSize = 0;
+	REQUIRE(rcBakeTile(&context, job, builder, header, &data, &dataSize));
+	REQUIRE(data);
+	REQUIRE(header.key == rcCalcTileBakeKey(job));
+	REQUIRE(header.tx == 1);
+	REQUIRE(header.ty == 0);
+	REQUIRE(header.dataSize == dataSize);
+
+	SECTION("A job read back from its serialized form bakes the same tile")
+	{
+		std::vector<unsigned char> jobData(rcGetTileBakeJobSize(job));
+		REQUIRE(rcWriteTileBakeJob(job, &jobData[0], (int)jobData.size()));
+		rcTileBakeJob remote;
+		REQUIRE(rcReadTileBakeJob(&jobData[0], (int)jobData.size(), remote));
+		builder.job = &remote;
+
+		rcTileBakeBlobHeader remoteHeader;
+		unsigned char* remoteData = 0;
+		int remoteDataSize = 0;
+		REQUIRE(rcBakeTile(&context, remote, builder, remoteHeader, &remoteData, &remoteDataSize));
+		REQUIRE(remoteHeader.key == header.key);
+		REQUIRE(remoteHeader.dataHash == header.dataHash);
+		REQUIRE(remoteDataSize == dataSize);
+		REQUIRE(memcmp(remoteData, data, dataSize) == 0);
+		rcFree(remoteData);
+	}
+
+	SECTION("The baked tile matches the tiled build")
+	{
+		unsigned char* tileData = 0;
+		int tileDataSize = 0;
+		REQUIRE(rcBuildTile(&context, job.buildCfg, job.tx, job.ty, builder, &tileData, &tileDataSize));
+		REQUIRE(tileDataSize == dataSize);
+		REQUIRE(memcmp(tileData, data, dataSize) == 0);
+		rcFree(tileData);
+	}
+
+	SECTION("Blobs are validated")
+	{
+		std::vector<unsigned char> blob = makeBlob(header, data);
+		rcTileBakeBlobHeader read;
+		const unsigned char* readData = 0;
+		REQUIRE(rcReadTileBakeBlob(&blob[0], (int)blob.size(), read, &readData));
+		REQUIRE(read.key == header.key);
+		REQUIRE(read.dataSize == dataSize);
+		REQUIRE(readData == &blob[RC_TILEBAKE_BLOB_HEADER_SIZE]);
+
+		REQUIRE_FALSE(rcReadTileBakeBlob(&blob[0], (int)blob.size() - 1, read, &readData));
+		REQUIRE(readData == 0);
+		blob.back() ^= 1;
+		REQUIRE_FALSE(rcReadTileBakeBlob(&blob[0], (int)blob.size(), read, &readData));
+	}
+
+	SECTION("Empty tiles are baked too")
+	{
+		job.chunkCount = 0;
+		rcTileBakeBlobHeader emptyHeader;
+		unsigned char* emptyData = 0;
+		int emptyDataSize = 0;
+		REQUIRE(rcBakeTile(&context, job, builder, emptyHeader, &emptyData, &emptyDataSize));
+		REQUIRE(emptyData == 0);
+		REQUIRE(emptyHeader.dataSize == 0);
+		REQUIRE(emptyHeader.key != header.key);
+
+		std::vector<unsigned char> blob = makeBlob(emptyHeader, emptyData);
+		rcTileBakeBlobHeader read;
+		const unsigned char* readData = 0;
+		REQUIRE(rcReadTileBakeBlob(&blob[0], (int)blob.size(), read, &readData));
+		REQUIRE(read.dataSize == 0);
+		REQUIRE(readData == 0);
+	}
+
+	rcFree(data);
+}
@@ -0,0 +1,764 @@
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "Recast.h"
+#include "RecastAlloc.h"
+#include "RecastTileBuild.h"
+
+#include "TestRecastUtils.h"
+
+namespace
+{
+// A flat walkable plane covering the whole tile grid.
+struct PlaneTileBuilder : public rcTileBuildCallbacks
+{
+	float verts[4 * 3];
+	int tris[2 * 3];
+	std::vector<int> added;
+
+	PlaneTileBuilder(const float* bmin, const float* bmax)
+	{
+		const float v[4 * 3] = {
+			bmin[0], 0.0f, bmin[2],
+			bmin[0], 0.0f, bmax[2],
+			bmax[0], 0.0f, bmax[2],
+			bmax[0], 0.0f, bmin[2],
+		};
+		const int t[2 * 3] = { 0, 1, 2, 0, 2, 3 };
+		memcpy(verts, v, sizeof(verts));
+		memcpy(tris, t, sizeof(tris));
+	}
+
+	bool rasterizeTile(rcContext* context, const rcConfig& tileCfg, const int, const int, rcHeightfield& heightfield) override
+	{
+		unsigned char areas[2] = { 0, 0 };
+		rcMarkWalkableTriangles(context, tileCfg.walkableSlopeAngle, verts, 4, tris, 2, areas);
+		return rcRasterizeTriangles(context, verts, 4, tris, areas, 2, heightfield, tileCfg.walkableClimb);
+	}
+
+	bool createTileData(rcContext*, const rcConfig&, const int tx, const int ty,
+						rcPolyMesh& polyMesh, rcPolyMeshDetail&, unsigned char** outData, int* outDataSize) override
+	{
+		int* data = (int*)rcAlloc(sizeof(int) * 3, RC_ALLOC_PERM);
+		data[0] = tx;
+		data[1] = ty;
+		data[2] = polyMesh.npolys;
+		*outData = (unsigned char*)data;
+		*outDataSize = sizeof(int) * 3;
+		return true;
+	}
+
+	void addTile(const int tx, const int ty, unsigned char* data, const int dataSize) override
+	{
+		REQUIRE(dataSize == sizeof(int) * 3);
+		const int* tile = (const int*)data;
+		REQUIRE(tile[0] == tx);
+		REQUIRE(tile[1] == ty);
+		REQUIRE(tile[2] > 0);
+		added.push_back(tx);
+		added.push_back(ty);
+		added.push_back(tile[2]);
+		rcFree(data);
+	}
+};
+
+// A plane whose tiles have an input version, which is used as the tile input hash.
+struct VersionedTileBuilder : public PlaneTileBuilder
+{
+	int versions[6];
+	bool empty[6];
+	int rasterized;
+	std::vector<int> removed;
+
+	VersionedTileBuilder(const float* bmin, const float* bmax) : PlaneTileBuilder(bmin, bmax), rasterized(0)
+	{
+		for (int i = 0; i < 6; ++i)
+		{
+			versions[i] = 0;
+			empty[i] = false;
+		}
+	}
+
+	bool rasterizeTile(rcContext* context, const rcConfig& tileCfg, const int tx, const int ty, rcHeightfield& heightfield) override
+	{
+		rasterized++;
+		if (empty[tx + ty * 3])
+			return true;
+		return PlaneTileBuilder::rasterizeTile(context, tileCfg, tx, ty, heightfield);
+	}
+
+	bool getTileInputHash(const rcConfig&, const int tx, const int ty, unsigned int* hash) override
+	{
+		*hash = rcHashData(&versions[tx + ty * 3], sizeof(int));
+		*hash = rcHashData(&empty[tx + ty * 3], sizeof(bool), *hash);
+		return true;
+	}
+
+	void removeTile(const int tx, const int ty) override
+	{
+		removed.push_back(tx);
+		removed.push_back(ty);
+	}
+
+	void reset()
+	{
+		added.clear();
+		removed.clear();
+		rasterized = 0;
+	}
+};
+
+// Two stacked floors covering the whole tile grid, which give every tile two layers.
+struct TwoFloorLayerBuilder : public rcTileLayerBuildCallbacks
+{
+	float verts[8 * 3];
+	int tris[4 * 3];
+	int workerCount;
+	std::vector<int> workerLayers;
+	std::vector<int> added;
+
+	TwoFloorLayerBuilder(const float* bmin, const float* bmax, const int workers) :
+		workerCount(workers), workerLayers(workers, 0)
+	{
+		for (int floor = 0; floor < 2; ++floor)
+		{
+			const float y = floor * 4.0f;
+			const float v[4 * 3] = {
+				bmin[0], y, bmin[2],
+				bmin[0], y, bmax[2],
+				bmax[0], y, bmax[2],
+				bmax[0], y, bmin[2],
+			};
+			const int b = floor * 4;
+			const int t[2 * 3] = { b + 0, b + 1, b + 2, b + 0, b + 2, b + 3 };
+			memcpy(&verts[floor * 4 * 3], v, sizeof(v));
+			memcpy(&tris[floor * 2 * 3], t, sizeof(t));
+		}
+	}
+
+	bool rasterizeTile(rcContext* context, const rcConfig& tileCfg, const int, const int, rcHeightfield& heightfield) override
+	{
+		unsigned char areas[4] = { 0, 0, 0, 0 };
+		rcMarkWalkableTriangles(context, tileCfg.walkableSlopeAngle, verts, 8, tris, 4, areas);
+		return rcRasterizeTriangles(context, verts, 8, tris, areas, 4, heightfield, tileCfg.walkableClimb);
+	}
+
+	bool createLayerData(rcContext*, const int workerIndex, const rcConfig&, const int tx, const int ty,
+						 const int layerIndex, const rcHeightfieldLayer& layer,
+						 unsigned char** outData, int* outDataSize) override
+	{
+		// Only one job runs per worker at a time, so the counters of the workers need no locking.
+		if (workerIndex < 0 || workerIndex >= workerCount)
+			return false;
+		workerLayers[workerIndex]++;
+		int* data = (int*)rcAlloc(sizeof(int) * 5, RC_ALLOC_PERM);
+		data[0] = tx;
+		data[1] = ty;
+		data[2] = layerIndex;
+		data[3] = layer.hmin;
+		data[4] = (layer.maxx - layer.minx + 1) * (layer.maxy - layer.miny + 1);
+		*outData = (unsigned char*)data;
+		*outDataSize = sizeof(int) * 5;
+		return true;
+	}
+
+	void addLayer(const int tx, const int ty, const int layerIndex, unsigned char* data, const int dataSize) override
+	{
+		REQUIRE(dataSize == sizeof(int) * 5);
+		const int* layer = (const int*)data;
+		REQUIRE(layer[0] == tx);
+		REQUIRE(layer[1] == ty);
+		REQUIRE(layer[2] == layerIndex);
+		added.insert(added.end(), layer, layer + 5);
+		rcFree(data);
+	}
+};
+
+// A ground plane with box obstacles and a raised platform, some of them crossing the band borders
+// of the banded builds.
+struct BoxesInputBuilder : public rcTileInputCallbacks
+{
+	std::vector<float> verts;
+	std::vector<int> tris;
+
+	BoxesInputBuilder(const float* bmin, const float* bmax)
+	{
+		const float ground[6] = { bmin[0], -0.5f, bmin[2], bmax[0], 0.0f, bmax[2] };
+		addBox(ground);
+		for (int z = 0; z < 5; ++z)
+		{
+			const float pillar[6] = { 3.0f + z * 2.0f, 0.0f, z * 8.0f + 3.0f, 4.5f + z * 2.0f, 2.5f, z * 8.0f + 5.0f };
+			addBox(pillar);
+		}
+		const float crossing[6] = { 10.0f, 0.0f, 14.0f, 13.0f, 2.5f, 18.0f };
+		addBox(crossing);
+		const float platform[6] = { 16.0f, 0.0f, 20.0f, 22.0f, 1.2f, 30.0f };
+		addBox(platform);
+	}
+
+	void addBox(const float* b)
+	{
+		const int base = (int)verts.size() / 3;
+		for (int i = 0; i < 8; ++i)
+		{
+			verts.push_back(b[(i & 1) ? 3 : 0]);
+			verts.push_back(b[(i & 2) ? 4 : 1]);
+			verts.push_back(b[(i & 4) ? 5 : 2]);
+		}
+		// The top and the sides, wound to face outwards.
+		const int faces[5][4] = { { 2, 6, 7, 3 }, { 0, 4, 6, 2 }, { 1, 3, 7, 5 }, { 0, 2, 3, 1 }, { 4, 5, 7, 6 } };
+		for (int f = 0; f < 5; ++f)
+		{
+			tris.push_back(base + faces[f][0]); tris.push_back(base + faces[f][1]); tris.push_back(base + faces[f][2]);
+			tris.push_back(base + faces[f][0]); tris.push_back(base + faces[f][2]); tris.push_back(base + faces[f][3]);
+		}
+	}
+
+	bool rasterizeTile(rcContext* context, const rcConfig& tileCfg, const int, const int, rcHeightfield& heightfield) override
+	{
+		const int ntris = (int)tris.size() / 3;
+		std::vector<unsigned char> areas(ntris, 0);
+		rcMarkWalkableTriangles(context, tileCfg.walkableSlopeAngle, &verts[0], (int)verts.size() / 3, &tris[0], ntris, &areas[0]);
+		return rcRasterizeTriangles(context, &verts[0], (int)verts.size() / 3, &tris[0], &areas[0], ntris,
+									heightfield, tileCfg.walkableClimb);
+	}
+};
+
+// Keeps copies of the polygon and detail meshes of the tiles.
+struct MeshCollector : public rcTileBuildCallbacks
+{
+	BoxesInputBuilder input;
+	std::vector<rcPolyMesh*> pmeshes;
+	std::vector<rcPolyMeshDetail*> dmeshes;
+
+	MeshCollector(const float* bmin, const float* bmax) : input(bmin, bmax) {}
+
+	~MeshCollector()
+	{
+		for (size_t i = 0; i < pmeshes.size(); ++i)
+		{
+			rcFreePolyMesh(pmeshes[i]);
+			rcFreePolyMeshDetail(dmeshes[i]);
+		}
+	}
+
+	bool rasterizeTile(rcContext* context, const rcConfig& tileCfg, const int tx, const int ty, rcHeightfield& heightfield) override
+	{
+		return input.rasterizeTile(context, tileCfg, tx, ty, heightfield);
+	}
+
+	bool createTileData(rcContext* context, const rcConfig&, const int, const int,
+						rcPolyMesh& polyMesh, rcPolyMeshDetail& detailMesh, unsigned char** outData, int* outDataSize) override
+	{
+		rcPolyMesh* pmesh = rcAllocPolyMesh();
+		rcPolyMeshDetail* dmesh = rcAllocPolyMeshDetail();
+		if (!rcCopyPolyMesh(context, polyMesh, *pmesh))
+			return false;
+		dmesh->nmeshes = dmesh->maxmeshes = detailMesh.nmeshes;
+		dmesh->nverts = dmesh->maxverts = detailMesh.nverts;
+		dmesh->ntris = dmesh->maxtris = detailMesh.ntris;
+		dmesh->meshes = (unsigned int*)rcAlloc(sizeof(unsigned int) * detailMesh.nmeshes * 4, RC_ALLOC_PERM);
+		dmesh->verts = (float*)rcAlloc(sizeof(float) * detailMesh.nverts * 3, RC_ALLOC_PERM);
+		dmesh->tris = (unsigned char*)rcAlloc(detailMesh.ntris * 4, RC_ALLOC_PERM);
+		memcpy(dmesh->meshes, detailMesh.meshes, sizeof(unsigned int) * detailMesh.nmeshes * 4);
+		memcpy(dmesh->verts, detailMesh.verts, sizeof(float) * detailMesh.nverts * 3);
+		memcpy(dmesh->tris, detailMesh.tris, detailMesh.ntris * 4);
+		pmeshes.push_back(pmesh);
+		dmeshes.push_back(dmesh);
+		*outData = (unsigned char*)rcAlloc(1, RC_ALLOC_PERM);
+		*outDataSize = 1;
+		return true;
+	}
+
+	void addTile(const int, const int, unsigned char* data, const int) override
+	{
+		rcFree(data);
+	}
+};
+
+// Welds the vertices of the meshes like rcMergePolyMeshes, comparing every vertex with all the previous ones.
+void referenceMerge(rcPolyMesh** meshes, const int nmeshes, const rcPolyMesh& merged,
+					std::vector<unsigned short>& verts, std::vector<unsigned short>& polys)
+{
+	for (int i = 0; i < nmeshes; ++i)
+	{
+		const rcPolyMesh* pmesh = meshes[i];
+		const unsigned short ox = (unsigned short)floorf((pmesh->bmin[0] - merged.bmin[0]) / merged.cs + 0.5f);
+		const unsigned short oz = (unsigned short)floorf((pmesh->bmin[2] - merged.bmin[2]) / merged.cs + 0.5f);
+		std::vector<unsigned short> vremap(pmesh->nverts);
+		for (int j = 0; j < pmesh->nverts; ++j)
+		{
+			const unsigned short x = (unsigned short)(pmesh->verts[j * 3 + 0] + ox);
+			const unsigned short y = pmesh->verts[j * 3 + 1];
+			const unsigned short z = (unsigned short)(pmesh->verts[j * 3 + 2] + oz);
+			int found = -1;
+			for (int k = 0; k < (int)verts.size() / 3; ++k)
+			{
+				if (verts[k * 3 + 0] == x && rcAbs(verts[k * 3 + 1] - y) <= 2 && verts[k * 3 + 2] == z)
+					found = k;
+			}
+			if (found == -1)
+			{
+				found = (int)verts.size() / 3;
+				verts.push_back(x);
+				verts.push_back(y);
+				verts.push_back(z);
+			}
+			vremap[j] = (unsigned short)found;
+		}
+		for (int j = 0; j < pmesh->npolys; ++j)
+		{
+			const unsigned short* p = &pmesh->polys[j * pmesh->nvp * 2];
+			for (int k = 0; k < pmesh->nvp; ++k)
+				polys.push_back(p[k] == RC_MESH_NULL_IDX ? RC_MESH_NULL_IDX : vremap[p[k]]);
+		}
+	}
+}
+
+// Checks that the merged mesh has the vertices and polygons of the reference merge.
+void checkMerge(rcPolyMesh** meshes, const int nmeshes, const rcPolyMesh& merged)
+{
+	std::vector<unsigned short> verts, polys;
+	referenceMerge(meshes, nmeshes, merged, verts, polys);
+	REQUIRE(merged.nverts * 3 == (int)verts.size());
+	REQUIRE(merged.npolys * merged.nvp == (int)polys.size());
+	REQUIRE(memcmp(merged.verts, &verts[0], sizeof(unsigned short) * verts.size()) == 0);
+	for (int i = 0; i < merged.npolys; ++i)
+		REQUIRE(memcmp(&merged.polys[i * merged.nvp * 2], &polys[i * merged.nvp], sizeof(unsigned short) * merged.nvp) == 0);
+}
+
+bool samePolyMesh(const rcPolyMesh& a, const rcPolyMesh& b)
+{
+	return a.nverts == b.nverts && a.npolys == b.npolys && a.nvp == b.nvp &&
+		memcmp(a.verts, b.verts, sizeof(unsigned short) * a.nverts * 3) == 0 &&
+		memcmp(a.polys, b.polys, sizeof(unsigned short) * a.npolys * a.nvp * 2) == 0 &&
+		memcmp(a.regs, b.regs, sizeof(unsigned short) * a.npolys) == 0 &&
+		memcmp(a.flags, b.flags, sizeof(unsigned short) * a.npolys) == 0 &&
+		memcmp(a.areas, b.areas, a.npolys) == 0 &&
+		(a.edgeClearance == 0) == (b.edgeClearance == 0) &&
+		(!a.edgeClearance || memcmp(a.edgeClearance, b.edgeClearance, sizeof(unsigned short) * a.npolys * a.nvp) == 0);
+}
+
+bool samePolyMeshDetail(const rcPolyMeshDetail& a, const rcPolyMeshDetail& b)
+{
+	return a.nmeshes == b.nmeshes && a.nverts == b.nverts && a.ntris == b.ntris &&
+		memcmp(a.meshes, b.meshes, sizeof(unsigned int) * a.nmeshes * 4) == 0 &&
+		memcmp(a.verts, b.verts, sizeof(float) * a.nverts * 3) == 0 &&
+		memcmp(a.tris, b.tris, a.ntris * 4) == 0;
+}
+
+// The area of a polygon of the mesh in square cells.
+float polyArea(const rcPolyMesh& mesh, const int i)
+{
+	const unsigned short* p = &mesh.polys[i * mesh.nvp * 2];
+	const unsigned short* a = &mesh.verts[p[0] * 3];
+	float area = 0.0f;
+	for (int j = 2; j < mesh.nvp && p[j] != RC_MESH_NULL_IDX; ++j)
+	{
+		const unsigned short* b = &mesh.verts[p[j - 1] * 3];
+		const unsigned short* c = &mesh.verts[p[j] * 3];
+		area += 0.5f * (float)rcAbs(((int)b[0] - a[0]) * ((int)c[2] - a[2]) - ((int)c[0] - a[0]) * ((int)b[2] - a[2]));
+	}
+	return area;
+}
+
+float polyMeshArea(const rcPolyMesh& mesh)
+{
+	float area = 0.0f;
+	for (int i = 0; i < mesh.npolys; ++i)
+		area += polyArea(mesh, i);
+	return area;
+}
+
+// The number of groups of polygons connected through their neighbours, ignoring groups smaller than minArea
+// square cells.
+int countPolyMeshComponents(const rcPolyMesh& mesh, const float minArea)
+{
+	std::vector<bool> visited(mesh.npolys, false);
+	std::vector<int> stack;
+	int count = 0;
+	for (int i = 0; i < mesh.npolys; ++i)
+	{
+		if (visited[i])
+			continue;
+		visited[i] = true;
+		stack.push_back(i);
+		float area = 0.0f;
+		while (!stack.empty())
+		{
+			const int cur = stack.back();
+			const unsigned short* p = &mesh.polys[cur * mesh.nvp * 2];
+			stack.pop_back();
+			area += polyArea(mesh, cur);
+			for (int j = 0; j < mesh.nvp; ++j)
+			{
+				const unsigned short nei = p[mesh.nvp + j];
+				if (nei & 0x8000 || visited[nei])
+					continue;
+				visited[nei] = true;
+				stack.push_back(nei);
+			}
+		}
+		if (area >= minArea)
+			count++;
+	}
+	return count;
+}
+
+rcTileBuildConfig makeConfig()
+{
+	rcTileBuildConfig buildCfg;
+	memset(&buildCfg, 0, sizeof(buildCfg));
+	rcConfig& cfg = buildCfg.cfg;
+	cfg.cs = 0.5f;
+	cfg.ch = 0.2f;
+	cfg.walkableSlopeAngle = 45.0f;
+	cfg.walkableHeight = 10;
+	cfg.walkableClimb = 4;
+	cfg.walkableRadius = 2;
+	cfg.maxEdgeLen = 24;
+	cfg.maxSimplificationError = 1.3f;
+	cfg.minRegionArea = 8;
+	cfg.mergeRegionArea = 20;
+	cfg.maxVertsPerPoly = 6;
+	cfg.tileSize = 16;
+	cfg.borderSize = cfg.walkableRadius + 3;
+	cfg.detailSampleDist = 3.0f;
+	cfg.detailSampleMaxError = 0.2f;
+	cfg.bmin[0] = 0.0f; cfg.bmin[1] = -1.0f; cfg.bmin[2] = 0.0f;
+	cfg.bmax[0] = 24.0f; cfg.bmax[1] = 1.0f; cfg.bmax[2] = 16.0f;
+	buildCfg.partitionType = RC_PARTITION_MONOTONE;
+	buildCfg.filterFlags = RC_FILTER_LOW_HANGING_OBSTACLES | RC_FILTER_LEDGE_SPANS | RC_FILTER_WALKABLE_LOW_HEIGHT;
+	return buildCfg;
+}
+} // anonymous namespace
+
+TEST_CASE("rcCalcTileGridSize", "[recast, tiles]")
+{
+	rcTileBuildConfig buildCfg = makeConfig();
+	int tilesX = 0, tilesY = 0;
+	rcCalcTileGridSize(buildCfg.cfg, &tilesX, &tilesY);
+	REQUIRE(tilesX == 3);
+	REQUIRE(tilesY == 2);
+
+	rcConfig tileCfg;
+	rcCalcTileConfig(buildCfg.cfg, 1, 1, tileCfg);
+	const int size = buildCfg.cfg.tileSize + buildCfg.cfg.borderSize * 2;
+	REQUIRE(tileCfg.width == size);
+	REQUIRE(tileCfg.height == size);
+	REQUIRE(tileCfg.bmin[0] == Catch::Approx(8.0f - 2.5f));
+	REQUIRE(tileCfg.bmin[2] == Catch::Approx(8.0f - 2.5f));
+	REQUIRE(tileCfg.bmax[0] == Catch::Approx(16.0f + 2.5f));
+	REQUIRE(tileCfg.bmax[2] == Catch::Approx(16.0f + 2.5f));
+}
+
+TEST_CASE("rcBuildTiles", "[recast, tiles]")
+{
+	rcContext context;
+	rcTileBuildConfig buildCfg = makeConfig();
+
+	PlaneTileBuilder serial(buildCfg.cfg.bmin, buildCfg.cfg.bmax);
+	REQUIRE(rcBuildTiles(&context, buildCfg, serial, 0, 0));
+
+	SECTION("Tiles are delivered in row-major order")
+	{
+		REQUIRE(serial.added.size() == 3 * 6);
+		for (int i = 0; i < 6; ++i)
+		{
+			REQUIRE(serial.added[i * 3 + 0] == i % 3);
+			REQUIRE(serial.added[i * 3 + 1] == i / 3);
+		}
+	}
+
+	SECTION("Concurrent builds match the serial build")
+	{
+		TestRecast::ThreadDispatcher dispatcher(4);
+		rcContext workerContexts[4];
+		rcContext* contexts[4] = { &workerContexts[0], &workerContexts[1], &workerContexts[2], &workerContexts[3] };
+
+		PlaneTileBuilder threaded(buildCfg.cfg.bmin, buildCfg.cfg.bmax);
+		REQUIRE(rcBuildTiles(&context, buildCfg, threaded, &dispatcher, contexts));
+		REQUIRE(threaded.added == serial.added);
+
+		// Small batches bound the number of tiles in flight.
+		buildCfg.maxTilesInFlight = 4;
+		PlaneTileBuilder batched(buildCfg.cfg.bmin, buildCfg.cfg.bmax);
+		REQUIRE(rcBuildTiles(&context, buildCfg, batched, &dispatcher, 0));
+		REQUIRE(batched.added == serial.added);
+	}
+
+	SECTION("Builds with temporary memory arenas match the serial build")
+	{
+		TestRecast::ThreadDispatcher dispatcher(4);
+		buildCfg.tempArenaSize = 1024;
+		PlaneTileBuilder threaded(buildCfg.cfg.bmin, buildCfg.cfg.bmax);
+		REQUIRE(rcBuildTiles(&context, buildCfg, threaded, &dispatcher, 0));
+		REQUIRE(threaded.added == serial.added);
+
+		// An arena bound by the caller is used by serial builds.
+		rcTempArena arena;
+		REQUIRE(arena.init(1024));
+		rcTempArenaScope scope(&arena);
+		buildCfg.tempArenaSize = 0;
+		PlaneTileBuilder bound(buildCfg.cfg.bmin, buildCfg.cfg.bmax);
+		REQUIRE(rcBuildTiles(&context, buildCfg, bound, 0, 0));
+		REQUIRE(bound.added == serial.added);
+		REQUIRE(arena.getPeakSize() > 0);
+	}
+}
+
+TEST_CASE("rcBuildTiles with a build cache", "[recast, tiles]")
+{
+	rcContext context;
+	rcTileBuildConfig buildCfg = makeConfig();
+	TestRecast::ThreadDispatcher dispatcher(2);
+
+	PlaneTileBuilder reference(buildCfg.cfg.bmin, buildCfg.cfg.bmax);
+	REQUIRE(rcBuildTiles(&context, buildCfg, reference, 0, 0));
+
+	VersionedTileBuilder builder(buildCfg.cfg.bmin, buildCfg.cfg.bmax);
+	rcTileBuildCache cache;
+	REQUIRE(cache.init(0, 0, true));
+
+	// The first build builds all tiles and sizes the cache to the grid.
+	int built = 0;
+	REQUIRE(rcBuildTiles(&context, buildCfg, builder, &dispatcher, 0, &cache, &built));
+	REQUIRE(built == 6);
+	REQUIRE(builder.rasterized == 6);
+	REQUIRE(builder.added == reference.added);
+	REQUIRE(cache.getTilesX() == 3);
+	REQUIRE(cache.getTilesY() == 2);
+
+	SECTION("Unchanged tiles are skipped")
+	{
+		builder.reset();
+		REQUIRE(rcBuildTiles(&context, buildCfg, builder, &dispatcher, 0, &cache, &built));
+		REQUIRE(built == 0);
+		REQUIRE(builder.rasterized == 0);
+		REQUIRE(builder.added.empty());
+
+		builder.versions[1] = 1;
+		REQUIRE(rcBuildTiles(&context, buildCfg, builder, &dispatcher, 0, &cache, &built));
+		REQUIRE(built == 1);
+		REQUIRE(builder.rasterized == 1);
+		REQUIRE(builder.added.size() == 3);
+		REQUIRE(builder.added[0] == 1);
+		REQUIRE(builder.added[1] == 0);
+
+		cache.invalidateTile(2, 1);
+		builder.reset();
+		REQUIRE(rcBuildTiles(&context, buildCfg, builder, &dispatcher, 0, &cache, &built));
+		REQUIRE(built == 1);
+		REQUIRE(builder.rasterized == 1);
+	}
+
+	SECTION("Tiles that become empty are removed")
+	{
+		builder.reset();
+		builder.empty[5] = true;
+		REQUIRE(rcBuildTiles(&context, buildCfg, builder, &dispatcher, 0, &cache, &built));
+		REQUIRE(built == 1);
+		REQUIRE(builder.added.empty());
+		REQUIRE(builder.removed.size() == 2);
+		REQUIRE(builder.removed[0] == 2);
+		REQUIRE(builder.removed[1] == 1);
+	}
+
+	SECTION("Later settings reuse the cached compact heightfields")
+	{
+		builder.reset();
+		buildCfg.cfg.detailSampleMaxError = 0.5f;
+		buildCfg.partitionType = RC_PARTITION_WATERSHED;
+		REQUIRE(rcBuildTiles(&context, buildCfg, builder, &dispatcher, 0, &cache, &built));
+		REQUIRE(built == 6);
+		REQUIRE(builder.rasterized == 0);
+
+		PlaneTileBuilder changed(buildCfg.cfg.bmin, buildCfg.cfg.bmax);
+		REQUIRE(rcBuildTiles(&context, buildCfg, changed, 0, 0));
+		REQUIRE(builder.added == changed.added);
+
+		// Rasterization settings rebuild from the input.
+		builder.reset();
+		buildCfg.cfg.walkableClimb = 3;
+		REQUIRE(rcBuildTiles(&context, buildCfg, builder, &dispatcher, 0, &cache, &built));
+		REQUIRE(built == 6);
+		REQUIRE(builder.rasterized == 6);
+	}
+
+	SECTION("Without the compact heightfields")
+	{
+		REQUIRE(cache.init(3, 2, false));
+		REQUIRE(rcBuildTiles(&context, buildCfg, builder, &dispatcher, 0, &cache, &built));
+		builder.reset();
+		buildCfg.cfg.detailSampleMaxError = 0.5f;
+		REQUIRE(rcBuildTiles(&context, buildCfg, builder, &dispatcher, 0, &cache, &built));
+		REQUIRE(built == 6);
+		REQUIRE(builder.rasterized == 6);
+	}
+}
+
+TEST_CASE("rcBuildTileLayers", "[recast, tiles]")
+{
+	rcContext context;
+	rcTileBuildConfig buildCfg = makeConfig();
+	buildCfg.cfg.bmax[1] = 5.0f;
+
+	TwoFloorLayerBuilder serial(buildCfg.cfg.bmin, buildCfg.cfg.bmax, 1);
+	int layerCount = 0;
+	REQUIRE(rcBuildTileLayers(&context, buildCfg, serial, 0, 0, 0, 0, 2, 1, &layerCount));
+
+	SECTION("Layers are delivered in tile and layer order")
+	{
+		REQUIRE(layerCount == 6 * 2);
+		REQUIRE(serial.added.size() == 6 * 2 * 5);
+		for (int i = 0; i < 6 * 2; ++i)
+		{
+			const int* layer = &serial.added[i * 5];
+			REQUIRE(layer[0] == (i / 2) % 3);
+			REQUIRE(layer[1] == (i / 2) / 3);
+			REQUIRE(layer[2] == i % 2);
+			REQUIRE(layer[4] > 0);
+		}
+		// The lower floor is the first layer.
+		REQUIRE(serial.added[3] < serial.added[5 + 3]);
+	}
+
+	SECTION("Concurrent builds match the serial build")
+	{
+		TestRecast::ThreadDispatcher dispatcher(4);
+		buildCfg.tempArenaSize = 1024;
+		TwoFloorLayerBuilder threaded(buildCfg.cfg.bmin, buildCfg.cfg.bmax, 4);
+		REQUIRE(rcBuildTileLayers(&context, buildCfg, threaded, &dispatcher, 0, 0, 0, 2, 1));
+		REQUIRE(threaded.added == serial.added);
+		int built = 0;
+		for (int i = 0; i < 4; ++i)
+			built += threaded.workerLayers[i];
+		REQUIRE(built == layerCount);
+
+		buildCfg.maxTilesInFlight = 4;
+		TwoFloorLayerBuilder batched(buildCfg.cfg.bmin, buildCfg.cfg.bmax, 4);
+		REQUIRE(rcBuildTileLayers(&context, buildCfg, batched, &dispatcher, 0, 0, 0, 2, 1));
+		REQUIRE(batched.added == serial.added);
+	}
+
+	SECTION("Tile ranges are clamped to the grid")
+	{
+		TwoFloorLayerBuilder range(buildCfg.cfg.bmin, buildCfg.cfg.bmax, 1);
+		REQUIRE(rcBuildTileLayers(&context, buildCfg, range, 0, 0, 1, 1, 5, 5, &layerCount));
+		REQUIRE(layerCount == 2 * 2);
+		const std::vector<int> expected(serial.added.begin() + 4 * 2 * 5, serial.added.end());
+		REQUIRE(range.added == expected);
+
+		TwoFloorLayerBuilder empty(buildCfg.cfg.bmin, buildCfg.cfg.bmax, 1);
+		REQUIRE(rcBuildTileLayers(&context, buildCfg, empty, 0, 0, 3, 0, 5, 5, &layerCount));
+		REQUIRE(layerCount == 0);
+		REQUIRE(empty.added.empty());
+	}
+}
+
+TEST_CASE("rcBuildBandedPolyMesh", "[recast, tiles]")
+{
+	rcContext context;
+	rcTileBuildConfig buildCfg = makeConfig();
+	buildCfg.cfg.bmax[1] = 4.0f;
+	buildCfg.cfg.bmax[2] = 40.0f;
+	BoxesInputBuilder input(buildCfg.cfg.bmin, buildCfg.cfg.bmax);
+
+	// Five bands, and a single band covering the whole grid.
+	rcPolyMesh* banded = rcAllocPolyMesh();
+	rcPolyMeshDetail* bandedDetail = rcAllocPolyMeshDetail();
+	REQUIRE(rcBuildBandedPolyMesh(&context, buildCfg, input, *banded, *bandedDetail));
+	rcTileBuildConfig singleCfg = buildCfg;
+	singleCfg.cfg.tileSize = 80;
+	rcPolyMesh* single = rcAllocPolyMesh();
+	rcPolyMeshDetail* singleDetail = rcAllocPolyMeshDetail();
+	REQUIRE(rcBuildBandedPolyMesh(&context, singleCfg, input, *single, *singleDetail));
+
+	REQUIRE(banded->npolys > single->npolys);
+	REQUIRE(bandedDetail->nmeshes == banded->npolys);
+	REQUIRE(polyMeshArea(*banded) == Catch::Approx(polyMeshArea(*single)).epsilon(0.02));
+
+	// The ground and the platform are connected across the band borders. Small regions touching a band border
+	// are kept like in tiled builds, so the slivers around the crossing box are not counted.
+	const float minArea = (float)buildCfg.cfg.minRegionArea;
+	REQUIRE(countPolyMeshComponents(*single, minArea) == 2);
+	REQUIRE(countPolyMeshComponents(*banded, minArea) == 2);
+	// Every other edge on a band border has a neighbour across it.
+	const int nvp = banded->nvp;
+	int borderEdges = 0;
+	for (int i = 0; i < banded->npolys; ++i)
+	{
+		const unsigned short* p = &banded->polys[i * nvp * 2];
+		for (int j = 0; j < nvp && p[j] != RC_MESH_NULL_IDX; ++j)
+		{
+			const int nj = (j + 1 < nvp && p[j + 1] != RC_MESH_NULL_IDX) ? j + 1 : 0;
+			const int za = banded->verts[p[j] * 3 + 2];
+			const int zb = banded->verts[p[nj] * 3 + 2];
+			if (za != zb || za == 0 || za % buildCfg.cfg.tileSize != 0)
+				continue;
+			// The slivers beside the box crossing the border are cut off by its walls.
+			const int xa = banded->verts[p[j] * 3 + 0];
+			const int xb = banded->verts[p[nj] * 3 + 0];
+			if (rcMax(xa, xb) > 18 && rcMin(xa, xb) < 28)
+				continue;
+			REQUIRE(p[nvp + j] != RC_MESH_NULL_IDX);
+			borderEdges++;
+		}
+	}
+	REQUIRE(borderEdges > 0);
+
+	rcFreePolyMesh(banded);
+	rcFreePolyMeshDetail(bandedDetail);
+	rcFreePolyMesh(single);
+	rcFreePolyMeshDetail(singleDetail);
+}
+
+TEST_CASE("rcMergePolyMeshes", "[recast, tiles]")
+{
+	rcContext context;
+	rcTileBuildConfig buildCfg = makeConfig();
+	buildCfg.cfg.bmax[1] = 4.0f;
+	buildCfg.cfg.bmax[2] = 40.0f;
+	buildCfg.cfg.tileSize = 8;
+	MeshCollector collector(buildCfg.cfg.bmin, buildCfg.cfg.bmax);
+	REQUIRE(rcBuildTiles(&context, buildCfg, collector, 0, 0));
+	REQUIRE(collector.pmeshes.size() > 10);
+
+	std::vector<rcPolyMesh*> pmeshes = collector.pmeshes;
+	SECTION("Meshes meeting at their borders")
+	{
+	}
+	SECTION("Overlapping meshes")
+	{
+		// A mesh merged twice overlaps itself, so all the vertices are welded serially.
+		pmeshes.push_back(pmeshes[pmeshes.size() / 2]);
+	}
+	const int nmeshes = (int)pmeshes.size();
+
+	rcPolyMesh* serial = rcAllocPolyMesh();
+	REQUIRE(rcMergePolyMeshes(&context, &pmeshes[0], nmeshes, *serial));
+	checkMerge(&pmeshes[0], nmeshes, *serial);
+
+	TestRecast::ThreadDispatcher dispatcher(4);
+	rcPolyMesh* threaded = rcAllocPolyMesh();
+	REQUIRE(rcMergePolyMeshes(&context, &pmeshes[0], nmeshes, *threaded, &dispatcher));
+	REQUIRE(samePolyMesh(*serial, *threaded));
+
+	rcPolyMeshDetail* serialDetail = rcAllocPolyMeshDetail();
+	rcPolyMeshDetail* threadedDetail = rcAllocPolyMeshDetail();
+	REQUIRE(rcMergePolyMeshDetails(&context, &collector.dmeshes[0], (int)collector.dmeshes.size(), *serialDetail));
+	REQUIRE(rcMergePolyMeshDetails(&context, &collector.dmeshes[0], (int)collector.dmeshes.size(), *threadedDetail, &dispatcher));
+	int npolys = 0;
+	for (size_t i = 0; i < collector.pmeshes.size(); ++i)
+		npolys += collector.pmeshes[i]->npolys;
+	REQUIRE(serialDetail->nmeshes == npolys);
+	REQUIRE(samePolyMeshDetail(*serialDetail, *threadedDetail));
+
+	rcFreePolyMesh(serial);
+	rcFreePolyMesh(threaded);
+	rcFreePolyMeshDetail(serialDetail);
+	rcFreePolyMeshDetail(threadedDetail);
+}